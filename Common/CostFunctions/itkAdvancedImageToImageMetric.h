@@ -23,8 +23,10 @@
 #include "itkImageSamplerBase.h"
 #include "itkGradientImageFilter.h"
 #include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
 #include "itkReducedDimensionBSplineInterpolateImageFunction.h"
 #include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkLimiterFunctionBase.h"
 #include "itkFixedArray.h"
 #include "itkAdvancedTransform.h"
@@ -36,7 +38,16 @@
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
 
+#include "itkParallelTasks.h"
 #include "itkPlatformMultiThreader.h"
+#include "itkProcessGroup.h"
+#include "itkTransformEvaluationCache.h"
+#include "itkImageExtremaCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 namespace itk
 {
@@ -129,6 +140,7 @@ public:
 
   typedef ImageMaskSpatialObject<itkGetStaticConstMacro(FixedImageDimension)>  FixedImageMaskSpatialObject2Type;
   typedef ImageMaskSpatialObject<itkGetStaticConstMacro(MovingImageDimension)> MovingImageMaskSpatialObject2Type;
+  typedef BitPackedImageMask<itkGetStaticConstMacro(MovingImageDimension)>     MovingImageBitPackedMaskType;
 
   /** Some useful extra typedefs. */
   typedef typename FixedImageType::PixelType             FixedImagePixelType;
@@ -140,6 +152,8 @@ public:
   typedef typename ImageSamplerType::Pointer                      ImageSamplerPointer;
   typedef typename ImageSamplerType::OutputVectorContainerType    ImageSampleContainerType;
   typedef typename ImageSamplerType::OutputVectorContainerPointer ImageSampleContainerPointer;
+  typedef typename ImageSamplerType::ImageSampleArraysType        ImageSampleArraysType;
+  typedef typename ImageSamplerType::ImageSampleLatticeType       ImageSampleLatticeType;
 
   /** Typedefs for Limiter support. */
   typedef LimiterFunctionBase<RealType, FixedImageDimension>  FixedImageLimiterType;
@@ -153,6 +167,10 @@ public:
   typedef typename TransformType::ScalarType                                       ScalarType;
   typedef AdvancedTransform<ScalarType, FixedImageDimension, MovingImageDimension> AdvancedTransformType;
   typedef typename AdvancedTransformType::NumberOfParametersType                   NumberOfParametersType;
+  typedef TransformEvaluationCache<AdvancedTransformType>                          TransformEvaluationCacheType;
+  typedef typename TransformEvaluationCacheType::Pointer                           TransformEvaluationCachePointer;
+  typedef ImageExtremaCache                                                        ImageExtremaCacheType;
+  typedef ImageExtremaCacheType::Pointer                                           ImageExtremaCachePointer;
 
   /** Typedef's for the B-spline transform. */
   typedef AdvancedCombinationTransform<ScalarType, FixedImageDimension>          CombinationTransformType;
@@ -284,6 +302,186 @@ public:
   itkGetConstReferenceMacro(UseMultiThread, bool);
   itkBooleanMacro(UseMultiThread);
 
+  /** Get whether GetValueAndDerivative() may run concurrently with that of other
+   * metrics sharing the same transform, once BeforeThreadedGetValueAndDerivative()
+   * has been called with UseMetricSingleThreaded on. See CombinationImageToImageMetric.
+   */
+  itkGetConstMacro(ConcurrentEvaluationSupported, bool);
+
+  /** Select the use of the persistent thread pool for the multi-threaded
+   * computations. When true (the default), the work units are executed by
+   * ParallelTasks, the task-parallel runtime of elastix, on the process-wide
+   * ITK thread pool, whose workers stay alive during the whole registration.
+   * When false, every call spawns and joins its own threads via the
+   * PlatformMultiThreader.
+   */
+  itkSetMacro(UseThreadPool, bool);
+  itkGetConstReferenceMacro(UseThreadPool, bool);
+  itkBooleanMacro(UseThreadPool);
+
+  /** Select dynamic scheduling of the samples over the threads. When false
+   * (the default), every thread processes one contiguous block of
+   * sampleContainerSize / numberOfThreads samples. When true, the threads
+   * repeatedly claim small chunks of samples from a shared counter, so that
+   * threads whose samples are cheap (e.g. because they map outside the moving
+   * mask) take over the work of the others. The chunk size is adapted to the
+   * observed cost per sample.
+   */
+  itkSetMacro(UseDynamicSampleScheduling, bool);
+  itkGetConstReferenceMacro(UseDynamicSampleScheduling, bool);
+  itkBooleanMacro(UseDynamicSampleScheduling);
+
+  /** Select the distribution of the samples over the processes of the ProcessGroup,
+   * when elastix runs on several MPI processes. Every process then evaluates a
+   * contiguous part of the samples in the multi-threaded GetValue() and
+   * GetValueAndDerivative(), and the partial sums of the value and the derivative
+   * are added over all processes. Every process must use the same images, samples
+   * and parameters. It has an effect only for metrics that report
+   * GetDistributedSampleEvaluationSupported(). The default is false.
+   */
+  itkSetMacro(UseDistributedSampleEvaluation, bool);
+  itkGetConstReferenceMacro(UseDistributedSampleEvaluation, bool);
+  itkBooleanMacro(UseDistributedSampleEvaluation);
+
+  /** Get whether this metric can distribute its samples over the processes. */
+  itkGetConstMacro(DistributedSampleEvaluationSupported, bool);
+
+  /** Select the deterministic reduction of the multi-threaded GetValue() and
+   * GetValueAndDerivative(). The contributions of the samples are then stored
+   * per sample, for blocks of a fixed number of samples, and added in sample
+   * order, so that the value and the derivative do not depend on the number of
+   * threads or on the scheduling of the samples. It has an effect only for the
+   * metrics that support it, see GetDeterministicReductionSupported(). The default is false.
+   */
+  itkSetMacro(UseDeterministicReduction, bool);
+  itkGetConstReferenceMacro(UseDeterministicReduction, bool);
+  itkBooleanMacro(UseDeterministicReduction);
+
+  /** Get whether this metric can add the sample contributions in sample order. */
+  itkGetConstMacro(DeterministicReductionSupported, bool);
+
+  /** Set the minimum number of samples that each thread should process. When
+   * nonzero, Initialize() reduces the number of threads of the coming
+   * resolution to the number of samples divided by this minimum, within the
+   * number of threads set by SetNumberOfWorkUnits(). For a small number of
+   * samples, the overhead of the threads and of accumulating their derivatives
+   * exceeds the gain of using them. The default is 0: always use all threads.
+   */
+  itkSetMacro(MinimumNumberOfSamplesPerThread, SizeValueType);
+  itkGetConstMacro(MinimumNumberOfSamplesPerThread, SizeValueType);
+
+  /** Select reading the samples from a structure-of-arrays copy of the
+   * sample container, see ImageSampleArrays, in the threaded loops that
+   * support it. The coordinates and values are then read from separate
+   * contiguous arrays, instead of strided from the array of samples.
+   */
+  itkSetMacro(UseSampleArrays, bool);
+  itkGetConstReferenceMacro(UseSampleArrays, bool);
+  itkBooleanMacro(UseSampleArrays);
+
+  /** Select implicit samples: a grid or full image sampler then does not store its
+   * samples, but only describes the lattice of voxels, see ImageSampleLattice. The
+   * threads compute the points and values of the samples they process on the fly.
+   * Only used by metrics that support it, in their multi-threaded code, and when no
+   * fixed image mask is given. Takes effect at the next Initialize().
+   */
+  itkSetMacro(UseImplicitSamples, bool);
+  itkGetConstReferenceMacro(UseImplicitSamples, bool);
+  itkBooleanMacro(UseImplicitSamples);
+
+  /** Select packing the moving image values and central difference gradients into a
+   * single float image, when the gradients are precomputed, i.e. when the interpolator
+   * does not provide derivatives itself. A sample then finds its gradient, and with a
+   * nearest neighbor interpolator also its value, in one look-up of a few contiguous
+   * floats, instead of in the interpolated image and a double precision gradient image.
+   * Takes effect at the next Initialize().
+   */
+  itkSetMacro(UseValueAndGradientImage, bool);
+  itkGetConstReferenceMacro(UseValueAndGradientImage, bool);
+  itkBooleanMacro(UseValueAndGradientImage);
+
+  /** Select the rejection of samples before they are transformed, when the transform is linear.
+   * InitializeSampleScheduler() then computes the affine map from the fixed image points to the
+   * continuous indices of the moving image, and GetNextSampleBatch() does not transform the
+   * samples that this map puts outside the moving image buffer, or outside the bounding box of
+   * the moving mask. Those samples would be rejected after the transformation anyway, so the
+   * value and the derivative do not change. Not used while the transform evaluation cache is
+   * active. The default is false.
+   */
+  itkSetMacro(UseLinearTransformSampleRejection, bool);
+  itkGetConstReferenceMacro(UseLinearTransformSampleRejection, bool);
+  itkBooleanMacro(UseLinearTransformSampleRejection);
+
+  /** Get the fraction of the samples that GetNextSampleBatch() rejected before transforming
+   * them, since the last InitializeSampleScheduler(), see SetUseLinearTransformSampleRejection().
+   */
+  double
+  GetRejectedSampleFraction(void) const;
+
+  /** The statistics of one thread in the threaded evaluations of the value (and derivative):
+   * the time that it spent in ThreadedGetValue() or ThreadedGetValueAndDerivative(), in seconds,
+   * the number of samples handed to it by GetNextSampleRange(), and the number of those samples
+   * that did not contribute, e.g. because they were mapped outside the moving image or mask.
+   */
+  struct ThreadStatisticsType
+  {
+    double        m_BusyTime{ 0.0 };
+    SizeValueType m_NumberOfSamples{ 0 };
+    SizeValueType m_NumberOfRejectedSamples{ 0 };
+  };
+  typedef std::vector<ThreadStatisticsType> ThreadStatisticsContainerType;
+
+  /** Select the collection of the statistics of the threads, see GetThreadStatistics() and
+   * GetThreadImbalanceRatios(). Only the evaluations that are launched through the threader
+   * callbacks of this class are included. The default is false.
+   */
+  itkSetMacro(UseThreadStatistics, bool);
+  itkGetConstReferenceMacro(UseThreadStatistics, bool);
+  itkBooleanMacro(UseThreadStatistics);
+
+  /** Set/Get the number of evaluations that are combined into one load imbalance ratio,
+   * see GetThreadImbalanceRatios(). The default is 50.
+   */
+  itkSetClampMacro(ThreadStatisticsBlockSize, SizeValueType, 1, NumericTraits<SizeValueType>::max());
+  itkGetConstMacro(ThreadStatisticsBlockSize, SizeValueType);
+
+  /** Get the statistics of each thread, summed over the evaluations since the last
+   * ResetThreadStatistics().
+   */
+  const ThreadStatisticsContainerType &
+  GetThreadStatistics(void) const
+  {
+    return this->m_ThreadStatistics;
+  }
+
+  /** Get the load imbalance ratio of each block of evaluations since the last
+   * ResetThreadStatistics(): the busy time of the slowest thread, summed over the
+   * evaluations of the block, divided by the summed mean busy time of the threads.
+   * A ratio of 1 means a perfect balance. The last block may be incomplete.
+   */
+  std::vector<double>
+  GetThreadImbalanceRatios(void) const;
+
+  /** Clear the statistics of the threads. */
+  void
+  ResetThreadStatistics(void) const;
+
+  /** Set/Get the cache of the mapped points and transform Jacobians of the samples.
+   * Metrics that use the same transform and the same image sampler can be given
+   * one cache, so that the transform is evaluated only once per sample and iteration.
+   * The cache is only used while it holds the current samples and transform
+   * parameters, and not with implicit samples. Default: no cache.
+   */
+  itkSetObjectMacro(TransformEvaluationCache, TransformEvaluationCacheType);
+  itkGetModifiableObjectMacro(TransformEvaluationCache, TransformEvaluationCacheType);
+
+  /** Set/Get the cache of the image extrema, which are used for the limiters, and by
+   * some inheriting classes. Metrics that use the same images can be given one cache,
+   * so that the extrema of an image are computed only once. Default: a cache of this metric.
+   */
+  itkSetObjectMacro(ImageExtremaCache, ImageExtremaCacheType);
+  itkGetModifiableObjectMacro(ImageExtremaCache, ImageExtremaCacheType);
+
   /** Contains calls from GetValueAndDerivative that are thread-unsafe,
    * together with preparation for multi-threading.
    * Note that the only reason why this function is not protected, is
@@ -292,6 +490,28 @@ public:
   virtual void
   BeforeThreadedGetValueAndDerivative(const TransformParametersType & parameters) const;
 
+  /** Get whether the metric implements AsynchronousGradientDescent(). Default: false. */
+  virtual bool
+  GetSupportsAsynchronousGradientDescent(void) const
+  {
+    return false;
+  }
+
+  /** Experimental: perform one pass of asynchronous stochastic gradient descent
+   * over the samples, in the style of Hogwild. The threads do not accumulate a
+   * derivative, but subtract the contribution of every batch of samples, times
+   * stepSize divided by the number of samples counted, from the shared parameters
+   * right away, without locking. A transform that reads its parameters in place,
+   * such as the B-spline transform, then sees the updates of all threads during
+   * the pass, and races with them. Returns the value of the metric, averaged over
+   * the pass.
+   * The default implementation throws an exception.
+   */
+  virtual void
+  AsynchronousGradientDescent(TransformParametersType & parameters,
+                              const double              stepSize,
+                              MeasureType &             value) const;
+
 protected:
   /** Constructor. */
   AdvancedImageToImageMetric();
@@ -320,15 +540,28 @@ protected:
   typedef BSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, float>
                                                          BSplineInterpolatorFloatType;
   typedef typename BSplineInterpolatorFloatType::Pointer BSplineInterpolatorFloatPointer;
+  typedef AdvancedBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, float>
+                                                                 AdvancedBSplineInterpolatorFloatType;
+  typedef typename AdvancedBSplineInterpolatorFloatType::Pointer AdvancedBSplineInterpolatorFloatPointer;
   typedef ReducedDimensionBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, double>
                                                            ReducedBSplineInterpolatorType;
   typedef typename ReducedBSplineInterpolatorType::Pointer ReducedBSplineInterpolatorPointer;
+  typedef ReducedDimensionBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, float>
+                                                                ReducedBSplineInterpolatorFloatType;
+  typedef typename ReducedBSplineInterpolatorFloatType::Pointer ReducedBSplineInterpolatorFloatPointer;
   typedef AdvancedLinearInterpolateImageFunction<MovingImageType, CoordinateRepresentationType> LinearInterpolatorType;
   typedef typename LinearInterpolatorType::Pointer                 LinearInterpolatorPointer;
   typedef typename BSplineInterpolatorType::CovariantVectorType    MovingImageDerivativeType;
   typedef GradientImageFilter<MovingImageType, RealType, RealType> CentralDifferenceGradientFilterType;
   typedef typename CentralDifferenceGradientFilterType::Pointer    CentralDifferenceGradientFilterPointer;
 
+  /** Typedefs for the packed moving image values and gradients. */
+  typedef NearestNeighborInterpolateImageFunction<MovingImageType, CoordinateRepresentationType>
+                                                                          NearestNeighborInterpolatorType;
+  typedef Vector<float, itkGetStaticConstMacro(MovingImageDimension) + 1> ValueAndGradientPixelType;
+  typedef Image<ValueAndGradientPixelType, itkGetStaticConstMacro(MovingImageDimension)>
+    ValueAndGradientImageType;
+
   /** Typedefs for support of sparse Jacobians and compact support of transformations. */
   typedef typename AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
@@ -340,17 +573,26 @@ protected:
   mutable ImageSamplerPointer m_ImageSampler;
 
   /** Variables for image derivative computation. */
-  bool                              m_InterpolatorIsLinear;
-  bool                              m_InterpolatorIsBSpline;
-  bool                              m_InterpolatorIsBSplineFloat;
-  bool                              m_InterpolatorIsReducedBSpline;
-  LinearInterpolatorPointer         m_LinearInterpolator;
-  BSplineInterpolatorPointer        m_BSplineInterpolator;
-  BSplineInterpolatorFloatPointer   m_BSplineInterpolatorFloat;
-  ReducedBSplineInterpolatorPointer m_ReducedBSplineInterpolator;
+  bool                                    m_InterpolatorIsLinear;
+  bool                                    m_InterpolatorIsBSpline;
+  bool                                    m_InterpolatorIsBSplineFloat;
+  bool                                    m_InterpolatorIsReducedBSpline;
+  LinearInterpolatorPointer               m_LinearInterpolator;
+  BSplineInterpolatorPointer              m_BSplineInterpolator;
+  BSplineInterpolatorFloatPointer         m_BSplineInterpolatorFloat;
+  AdvancedBSplineInterpolatorFloatPointer m_AdvancedBSplineInterpolatorFloat;
+  ReducedBSplineInterpolatorPointer       m_ReducedBSplineInterpolator;
+  ReducedBSplineInterpolatorFloatPointer  m_ReducedBSplineInterpolatorFloat;
 
   CentralDifferenceGradientFilterPointer m_CentralDifferenceGradientFilter;
 
+  /** The moving image value followed by its gradient, for every voxel. Only set while it is used.
+   * The values are only read when they equal those of the nearest neighbor interpolator.
+   */
+  bool                                        m_UseValueAndGradientImage;
+  bool                                        m_UseValuesOfValueAndGradientImage;
+  typename ValueAndGradientImageType::Pointer m_ValueAndGradientImage;
+
   /** Variables to store the AdvancedTransform. */
   bool                                    m_TransformIsAdvanced;
   typename AdvancedTransformType::Pointer m_AdvancedTransform;
@@ -410,10 +652,228 @@ protected:
   static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
   AccumulateDerivativesThreaderCallback(void * arg);
 
+  /** Threader callback function that zeroes the derivative of each thread
+   * within that thread, see InitializeThreadingParameters(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  InitializePerThreadDerivativesThreaderCallback(void * arg);
+
+  /** Execute a threader callback for all work units, using either the
+   * platform threader or ParallelTasks, see SetUseThreadPool().
+   * All derived metrics should launch their callbacks through this function.
+   */
+  void
+  LaunchThreaderCallback(ThreadFunctionType callback, void * userData) const;
+
+  /** Prepare the distribution of numberOfSamples samples over the threads,
+   * and the structure-of-arrays copy of the samples, if requested. Should be
+   * called single-threaded, before the threads are launched. When distributeOverProcesses
+   * is true and the samples are distributed (see IsSampleEvaluationDistributed()),
+   * only the part of the samples of the current process is handed out.
+   */
+  void
+  InitializeSampleScheduler(const SizeValueType numberOfSamples, const bool distributeOverProcesses = false) const;
+
+  /** Restrict the samples handed out by GetNextSampleRange() to [begin, end), after
+   * InitializeSampleScheduler(), e.g. to process them in blocks. Should be called
+   * single-threaded, before the threads are launched.
+   */
+  void
+  RestrictSampleScheduler(const SizeValueType begin, const SizeValueType end) const
+  {
+    this->m_SampleSchedulerFirstSample = begin;
+    this->m_SampleSchedulerNumberOfSamples = end;
+    this->m_SampleSchedulerNextSample = begin;
+    std::fill(this->m_SampleSchedulerStaticRangeTaken.begin(), this->m_SampleSchedulerStaticRangeTaken.end(), 0);
+  }
+
+
+  /** Returns true when the samples are distributed over more than one process. The
+   * partial sums of the threaded GetValue() and GetValueAndDerivative() must then be
+   * added by SumOverProcesses(), in AfterThreadedGetValue() and AfterThreadedGetValueAndDerivative().
+   */
+  bool
+  IsSampleEvaluationDistributed(void) const
+  {
+    return this->m_UseDistributedSampleEvaluation && this->m_DistributedSampleEvaluationSupported &&
+           ProcessGroup::GetNumberOfProcesses() > 1;
+  }
+
+  /** Get the next range [begin, end) of samples to be processed by the thread
+   * threadId. Returns false when all samples have been handed out. Threaded
+   * loops over the sample container should process ranges until it returns
+   * false. Thread-safe.
+   */
+  bool
+  GetNextSampleRange(const ThreadIdType threadId, SizeValueType & begin, SizeValueType & end) const;
+
+  /** Read the coordinates and the value of fixed image sample i. They are
+   * computed from the implicit samples, or taken from the structure-of-arrays
+   * copy when it is used, otherwise from the sample container.
+   */
+  void
+  ReadFixedImageSample(const ImageSampleContainerType & sampleContainer,
+                       const SizeValueType              i,
+                       FixedImagePointType &            fixedPoint,
+                       RealType &                       fixedImageValue) const
+  {
+    if (this->m_ImplicitSamples != nullptr)
+    {
+      this->m_ImplicitSamples->GetSample(i, fixedPoint, fixedImageValue);
+    }
+    else if (this->m_SampleArrays != nullptr)
+    {
+      this->m_SampleArrays->GetPoint(i, fixedPoint);
+      fixedImageValue = static_cast<RealType>(this->m_SampleArrays->GetValues()[i]);
+    }
+    else
+    {
+      const typename ImageSampleContainerType::Element & sample = sampleContainer.ElementAt(i);
+      fixedPoint = sample.m_ImageCoordinates;
+      fixedImageValue = static_cast<RealType>(sample.m_ImageValue);
+    }
+  }
+
+
+  /** Get the number of fixed image samples generated by the image sampler,
+   * taking into account that they may be implicit.
+   */
+  SizeValueType
+  GetNumberOfImageSamples(void) const;
+
+  /** Should be called single-threaded, after the threads are joined. Updates
+   * the estimated cost per sample, from which the chunk size is derived.
+   */
+  void
+  FinalizeSampleScheduler(void) const;
+
+  /** Add the time since startTime, and the samples that were not counted, to the statistics
+   * of thread threadId in the current evaluation; called by the threader callbacks, after
+   * the threaded evaluation, when the statistics of the threads are collected.
+   */
+  void
+  UpdateThreadStatistics(const ThreadIdType                            threadId,
+                         const std::chrono::steady_clock::time_point & startTime,
+                         const SizeValueType                           numberOfPixelsCounted) const;
+
+  /** Update the cache of the fixed image contributions of the samples; called
+   * single-threaded by InitializeSampleScheduler(). The cache is filled once, when
+   * the sampler output (container, update time or size) has changed, or after it has
+   * been invalidated, at every Initialize(). All later passes over the same samples,
+   * like the two passes of the low-memory Parzen window derivative, reuse it.
+   */
+  void
+  UpdateFixedImageSampleCache(void) const;
+
+  /** Fill the cache of the fixed image contributions of the samples. The default
+   * implementation stores the limited fixed image values, when the fixed image
+   * limiter is used. Inheriting classes may store their own contributions as well.
+   */
+  virtual void
+  FillFixedImageSampleCache(const ImageSampleContainerType & sampleContainer) const;
+
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded;
   bool m_UseMultiThread;
-  bool m_UseOpenMP;
+  bool m_UseThreadPool;
+
+  /** Variables for the scheduling of the samples over the threads. */
+  bool                                          m_UseDynamicSampleScheduling;
+  mutable SizeValueType                         m_SampleSchedulerFirstSample;
+  mutable SizeValueType                         m_SampleSchedulerNumberOfSamples;
+  mutable SizeValueType                         m_SampleSchedulerChunkSize;
+  mutable std::atomic<SizeValueType>            m_SampleSchedulerNextSample;
+  mutable std::vector<unsigned char>            m_SampleSchedulerStaticRangeTaken;
+  mutable double                                m_SampleSchedulerCostPerSample;
+  mutable std::chrono::steady_clock::time_point m_SampleSchedulerStartTime;
+
+  /** Variables for the statistics of the threads. */
+  bool                                  m_UseThreadStatistics;
+  SizeValueType                         m_ThreadStatisticsBlockSize;
+  mutable ThreadStatisticsContainerType m_CurrentThreadStatistics;
+  mutable ThreadStatisticsContainerType m_ThreadStatistics;
+  mutable std::vector<double>           m_ThreadImbalanceRatios;
+  mutable double                        m_ThreadStatisticsBlockMaximumBusyTime;
+  mutable double                        m_ThreadStatisticsBlockMeanBusyTime;
+  mutable SizeValueType                 m_ThreadStatisticsBlockNumberOfEvaluations;
+
+  /** Variables for limiting the number of threads to the number of samples. */
+  SizeValueType m_MinimumNumberOfSamplesPerThread;
+  ThreadIdType  m_MaximumNumberOfWorkUnits;
+
+  /** Variables for the sparse accumulation of the per thread derivatives. */
+  bool         m_UseSparseDerivativeAccumulation;
+  mutable bool m_SparseDerivativeAccumulationActive;
+
+  /** The cache of the fixed image contributions of the samples, see UpdateFixedImageSampleCache(). */
+  mutable bool                             m_FixedImageSampleCacheValid;
+  mutable const ImageSampleContainerType * m_FixedImageSampleCacheContainer;
+  mutable ModifiedTimeType                 m_FixedImageSampleCacheUpdateMTime;
+  mutable SizeValueType                    m_FixedImageSampleCacheSize;
+  mutable std::vector<RealType>            m_FixedImageSampleCacheValues;
+
+  /** The structure-of-arrays copy of the samples, only set while it is used. */
+  bool                                  m_UseSampleArrays;
+  mutable const ImageSampleArraysType * m_SampleArrays;
+
+  /** The implicit samples, only set while they are used. Inheriting classes set
+   * m_ImplicitSamplesSupported when their multi-threaded code reads the samples
+   * through GetNextSampleBatch() or ReadFixedImageSample() only.
+   */
+  bool                                   m_UseImplicitSamples;
+  bool                                   m_ImplicitSamplesSupported;
+  mutable const ImageSampleLatticeType * m_ImplicitSamples;
+
+  /** Inheriting classes set m_ConcurrentEvaluationSupported when every code path of their
+   * GetValueAndDerivative() sets the transform parameters and updates the sampler through
+   * BeforeThreadedGetValueAndDerivative() only, and otherwise only touches own members.
+   */
+  bool m_ConcurrentEvaluationSupported;
+
+  /** Inheriting classes set m_DistributedSampleEvaluationSupported when their multi-threaded
+   * GetValue() and GetValueAndDerivative() read the samples through the sample scheduler, and
+   * add their partial sums over the processes when IsSampleEvaluationDistributed() is true.
+   */
+  bool m_UseDistributedSampleEvaluation;
+  bool m_DistributedSampleEvaluationSupported;
+
+  /** Inheriting classes set m_DeterministicReductionSupported when their multi-threaded
+   * GetValue() and GetValueAndDerivative() add the sample contributions in sample order,
+   * when m_UseDeterministicReduction is true.
+   */
+  bool m_UseDeterministicReduction;
+  bool m_DeterministicReductionSupported;
+
+  /** The shared cache of the transform evaluations, see SetTransformEvaluationCache().
+   * It is active while it holds the current samples and parameters.
+   */
+  TransformEvaluationCachePointer m_TransformEvaluationCache;
+  mutable bool                    m_TransformEvaluationCacheActive;
+
+  /** The (possibly shared) cache of the image extrema, see SetImageExtremaCache(). */
+  ImageExtremaCachePointer m_ImageExtremaCache{ ImageExtremaCacheType::New() };
+
+  /** The bit-packed copy of the moving image mask, built by Initialize(). */
+  MovingImageBitPackedMaskType m_MovingImageBitPackedMask;
+
+  /** Compute the affine map and the bounds used by the linear transform sample rejection;
+   * called single-threaded by InitializeSampleScheduler().
+   */
+  void
+  InitializeLinearSampleRejection(void) const;
+
+  /** Variables for the linear transform sample rejection. The continuous index of the
+   * mapped point of x is m_SampleRejectionOffset + m_SampleRejectionMatrix (x - m_SampleRejectionOrigin),
+   * and a sample is rejected when it lies outside [m_SampleRejectionLowerBound, m_SampleRejectionUpperBound].
+   */
+  bool                               m_UseLinearTransformSampleRejection;
+  mutable bool                       m_LinearSampleRejectionActive;
+  mutable FixedImagePointType        m_SampleRejectionOrigin;
+  mutable double                     m_SampleRejectionOffset[MovingImageDimension];
+  mutable double                     m_SampleRejectionMatrix[MovingImageDimension][FixedImageDimension];
+  mutable double                     m_SampleRejectionLowerBound[MovingImageDimension];
+  mutable double                     m_SampleRejectionUpperBound[MovingImageDimension];
+  mutable std::atomic<SizeValueType> m_NumberOfTestedSamples;
+  mutable std::atomic<SizeValueType> m_NumberOfRejectedSamples;
 
   /** Helper structs that multi-threads the computation of
    * the metric derivative using ITK threads.
@@ -428,6 +888,15 @@ protected:
   };
   mutable MultiThreaderParameterType m_ThreaderMetricParameters;
 
+  /** Accumulates the touched blocks of the sub-derivatives for a part of the
+   * parameters; called by AccumulateDerivativesThreaderCallback() for the
+   * sparse derivative accumulation.
+   */
+  static void
+  AccumulateTouchedDerivativeBlocks(MultiThreaderParameterType * temp,
+                                    const ThreadIdType           threadID,
+                                    const ThreadIdType           nrOfThreads);
+
   /** Most metrics will perform multi-threading by letting
    * each thread compute a part of the value and derivative.
    *
@@ -451,9 +920,10 @@ protected:
   // test per thread struct with padding and alignment
   struct GetValueAndDerivativePerThreadStruct
   {
-    SizeValueType  st_NumberOfPixelsCounted;
-    MeasureType    st_Value;
-    DerivativeType st_Derivative;
+    SizeValueType              st_NumberOfPixelsCounted;
+    MeasureType                st_Value;
+    DerivativeType             st_Derivative;
+    std::vector<unsigned char> st_TouchedDerivativeBlocks;
   };
   itkPadStruct(ITK_CACHE_LINE_ALIGNMENT,
                GetValueAndDerivativePerThreadStruct,
@@ -468,6 +938,35 @@ protected:
   virtual void
   InitializeThreadingParameters(void) const;
 
+  /** The number of parameters per block of the sparse derivative accumulation. */
+  static constexpr unsigned int DerivativeBlockSize = 256;
+
+  /** Inheriting classes that update st_Derivative through MarkTouchedDerivativeBlocks()
+   * can specify that the accumulation of the derivatives only visits the touched
+   * blocks of the parameters. It is only used for transforms with a sparse Jacobian
+   * and a large number of parameters, such as fine B-spline grids. Make sure to set
+   * it before calling Initialize; default: false.
+   */
+  itkSetMacro(UseSparseDerivativeAccumulation, bool);
+
+  /** Mark the blocks of the derivative of thread threadId that are updated
+   * for the nonzero Jacobian indices nzji. Does nothing for the dense accumulation.
+   */
+  void
+  MarkTouchedDerivativeBlocks(const ThreadIdType threadId, const NonZeroJacobianIndicesType & nzji) const
+  {
+    if (this->m_SparseDerivativeAccumulationActive)
+    {
+      const unsigned int           blockSize = DerivativeBlockSize;
+      std::vector<unsigned char> & touched =
+        this->m_GetValueAndDerivativePerThreadVariables[threadId].st_TouchedDerivativeBlocks;
+      for (const auto index : nzji)
+      {
+        touched[index / blockSize] = 1;
+      }
+    }
+  }
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -485,13 +984,32 @@ protected:
   virtual void
   CheckNumberOfSamples(unsigned long wanted, unsigned long found) const;
 
+  /** Crop a region of the fixed image to the bounding box of the fixed mask,
+   * if a mask is set. Metrics that resample the moving image on the full fixed
+   * grid use it to limit the resampling to the pixels that contribute.
+   * Throws an exception if the bounding box lies outside the region.
+   */
+  FixedImageRegionType
+  CropFixedImageRegionToMask(const FixedImageRegionType & region) const;
+
   /** Methods for image derivative evaluation support **********/
 
+  /** Limit the number of threads, following SetMinimumNumberOfSamplesPerThread();
+   * this method is called by Initialize. */
+  void
+  LimitNumberOfWorkUnitsToNumberOfSamples(void);
+
   /** Initialize variables for image derivative computation; this
    * method is called by Initialize. */
   virtual void
   CheckForBSplineInterpolator(void);
 
+  /** Pack the moving image and the central difference gradient image into
+   * m_ValueAndGradientImage; this method is called by CheckForBSplineInterpolator.
+   */
+  void
+  ComputeValueAndGradientImage(void);
+
   /** Compute the image value (and possibly derivative) at a transformed point.
    * Checks if the point lies within the moving image buffer (bool return).
    * If no gradient is wanted, set the gradient argument to 0.
@@ -534,6 +1052,68 @@ protected:
   virtual bool
   TransformPoint(const FixedImagePointType & fixedImagePoint, MovingImagePointType & mappedPoint) const;
 
+  /** Batch version of TransformPoint(): map numberOfPoints fixed image points
+   * at once, with a single (virtual) call to the transform.
+   */
+  void
+  TransformPoints(const FixedImagePointType * fixedImagePoints,
+                  MovingImagePointType *      mappedPoints,
+                  const SizeValueType         numberOfPoints) const;
+
+  /** The maximum number of samples in a SampleBatchType. */
+  static constexpr unsigned int SampleBatchSize = 64;
+
+  /** A batch of fixed image samples and their mapped points, see GetNextSampleBatch().
+   * The batch holds the samples [ st_Begin, st_Begin + st_Size [ of the sample container.
+   */
+  struct SampleBatchType
+  {
+    unsigned int         st_Size{ 0 };
+    SizeValueType        st_Begin{ 0 };
+    SizeValueType        st_Next{ 0 };
+    SizeValueType        st_RangeEnd{ 0 };
+    FixedImagePointType  st_FixedPoints[SampleBatchSize];
+    RealType             st_FixedImageValues[SampleBatchSize];
+    MovingImagePointType st_MappedPoints[SampleBatchSize];
+    bool                 st_Rejected[SampleBatchSize]{};
+  };
+
+  /** Get the next batch of samples for the thread threadId, taken from the
+   * ranges handed out by GetNextSampleRange(). The fixed image points and
+   * values are read, and all points of the batch are mapped by a single
+   * TransformPoints() call. When the fixed image limiter is used, the fixed
+   * image values of the batch are limited already. Returns false when all samples have been handed
+   * out. Threaded loops over the sample container can process batches until
+   * it returns false, instead of calling TransformPoint() for every sample.
+   * The samples flagged in st_Rejected are outside the moving image or mask,
+   * see SetUseLinearTransformSampleRejection(); their mapped points are not computed.
+   */
+  bool
+  GetNextSampleBatch(const ThreadIdType               threadId,
+                     const ImageSampleContainerType & sampleContainer,
+                     SampleBatchType &                batch) const;
+
+  /** Map the fixed image point of the sample with the given index, like
+   * TransformPoint(). The mapped point is read from, or stored in, the
+   * transform evaluation cache, when it is active.
+   */
+  bool
+  TransformSamplePoint(const SizeValueType         sampleIndex,
+                       const FixedImagePointType & fixedImagePoint,
+                       MovingImagePointType &      mappedPoint) const;
+
+  /** Compute the inner product of the transform Jacobian at the sample with the given
+   * index and the moving image gradient. When the transform evaluation cache is active,
+   * the Jacobian is read from, or stored in, the cache; otherwise the transform computes
+   * the inner product directly, by EvaluateJacobianWithImageGradientProduct().
+   */
+  void
+  EvaluateSampleJacobianWithImageGradientProduct(const SizeValueType               sampleIndex,
+                                                 const FixedImagePointType &       fixedImagePoint,
+                                                 const MovingImageDerivativeType & movingImageDerivative,
+                                                 DerivativeType &                  imageJacobian,
+                                                 NonZeroJacobianIndicesType &      nzji) const;
+
   /** This function returns a reference to the transform Jacobians.
    * This is either a reference to the full TransformJacobian or
    * a reference to a sparse Jacobians.
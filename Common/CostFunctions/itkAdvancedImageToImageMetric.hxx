@@ -21,13 +21,15 @@
 #include "itkAdvancedImageToImageMetric.h"
 
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
-#include "itkComputeImageExtremaFilter.h"
-
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
 
 #include "itkTimeProbe.h"
+#include "itkHardwareCounters.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace itk
 {
@@ -54,7 +56,9 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AdvancedImageToImageMetri
   this->m_LinearInterpolator = nullptr;
   this->m_BSplineInterpolator = nullptr;
   this->m_BSplineInterpolatorFloat = nullptr;
+  this->m_AdvancedBSplineInterpolatorFloat = nullptr;
   this->m_ReducedBSplineInterpolator = nullptr;
+  this->m_ReducedBSplineInterpolatorFloat = nullptr;
   this->m_InterpolatorIsLinear = false;
   this->m_InterpolatorIsBSpline = false;
   this->m_InterpolatorIsBSplineFloat = false;
@@ -86,16 +90,44 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AdvancedImageToImageMetri
   /** Threading related variables. */
   this->m_UseMetricSingleThreaded = true;
   this->m_UseMultiThread = false;
-
-  /** OpenMP related. Switch to on when available */
-#ifdef ELASTIX_USE_OPENMP
-  this->m_UseOpenMP = true;
-
-  const int nthreads = static_cast<int>(Self::GetNumberOfWorkUnits());
-  omp_set_num_threads(nthreads);
-#else
-  this->m_UseOpenMP = false;
-#endif
+  this->m_UseThreadPool = true;
+
+  this->m_UseDynamicSampleScheduling = false;
+  this->m_SampleSchedulerFirstSample = 0;
+  this->m_SampleSchedulerNumberOfSamples = 0;
+  this->m_SampleSchedulerChunkSize = 0;
+  this->m_SampleSchedulerNextSample = 0;
+  this->m_SampleSchedulerCostPerSample = 0.0;
+  this->m_UseThreadStatistics = false;
+  this->m_ThreadStatisticsBlockSize = 50;
+  this->m_ThreadStatisticsBlockMaximumBusyTime = 0.0;
+  this->m_ThreadStatisticsBlockMeanBusyTime = 0.0;
+  this->m_ThreadStatisticsBlockNumberOfEvaluations = 0;
+  this->m_MinimumNumberOfSamplesPerThread = 0;
+  this->m_MaximumNumberOfWorkUnits = 0;
+  this->m_UseSampleArrays = false;
+  this->m_SampleArrays = nullptr;
+  this->m_UseImplicitSamples = false;
+  this->m_ImplicitSamplesSupported = false;
+  this->m_UseValueAndGradientImage = false;
+  this->m_UseValuesOfValueAndGradientImage = false;
+  this->m_ConcurrentEvaluationSupported = false;
+  this->m_UseDistributedSampleEvaluation = false;
+  this->m_DistributedSampleEvaluationSupported = false;
+  this->m_UseDeterministicReduction = false;
+  this->m_DeterministicReductionSupported = false;
+  this->m_TransformEvaluationCacheActive = false;
+  this->m_UseLinearTransformSampleRejection = false;
+  this->m_LinearSampleRejectionActive = false;
+  this->m_NumberOfTestedSamples = 0;
+  this->m_NumberOfRejectedSamples = 0;
+  this->m_ImplicitSamples = nullptr;
+  this->m_UseSparseDerivativeAccumulation = false;
+  this->m_SparseDerivativeAccumulationActive = false;
+  this->m_FixedImageSampleCacheValid = false;
+  this->m_FixedImageSampleCacheContainer = nullptr;
+  this->m_FixedImageSampleCacheUpdateMTime = 0;
+  this->m_FixedImageSampleCacheSize = 0;
 
   /** Initialize the m_ThreaderMetricParameters. */
   this->m_ThreaderMetricParameters.st_Metric = this;
@@ -132,11 +164,7 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::SetNumberOfWorkUnits(Thre
   // Note: This is a workaround for ITK5, which renamed NumberOfThreads
   // to NumberOfWorkUnits
   Superclass::SetNumberOfWorkUnits(numberOfThreads);
-
-#ifdef ELASTIX_USE_OPENMP
-  const int nthreads = static_cast<int>(Self::GetNumberOfWorkUnits());
-  omp_set_num_threads(nthreads);
-#endif
+  this->m_MaximumNumberOfWorkUnits = Self::GetNumberOfWorkUnits();
 } // end SetNumberOfWorkUnits()
 
 
@@ -154,6 +182,13 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
   /** Setup the parameters for the gray value limiters. */
   this->InitializeLimiters();
 
+  /** The fixed image contributions may depend on the limiters, so invalidate their cache. */
+  this->m_FixedImageSampleCacheValid = false;
+  this->m_FixedImageSampleCacheContainer = nullptr;
+
+  /** Make a bit-packed copy of the moving mask, for fast tests in IsInsideMovingMask(). */
+  this->m_MovingImageBitPackedMask.Update(this->m_MovingImageMask);
+
   /** Connect the image sampler */
   this->InitializeImageSampler();
 
@@ -169,12 +204,49 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
   /** Initialize some threading related parameters. */
   if (this->m_UseMultiThread)
   {
+    this->LimitNumberOfWorkUnitsToNumberOfSamples();
     this->InitializeThreadingParameters();
   }
 
 } // end Initialize()
 
 
+/**
+ * ********************* LimitNumberOfWorkUnitsToNumberOfSamples ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LimitNumberOfWorkUnitsToNumberOfSamples(void)
+{
+  /** Without a call to SetNumberOfWorkUnits(), the initial number of threads is the maximum. */
+  if (this->m_MaximumNumberOfWorkUnits == 0)
+  {
+    this->m_MaximumNumberOfWorkUnits = Self::GetNumberOfWorkUnits();
+  }
+
+  /** Restore the maximum, which a previous resolution may have limited. Bypass
+   * Self::SetNumberOfWorkUnits(), which would reset the maximum.
+   */
+  Superclass::SetNumberOfWorkUnits(this->m_MaximumNumberOfWorkUnits);
+  if (this->m_MinimumNumberOfSamplesPerThread == 0 || !this->m_UseImageSampler)
+  {
+    return;
+  }
+
+  /** The sampler has not yet been updated in this resolution. Updating it now is
+   * not extra work: the first call to GetValue() would otherwise do it.
+   */
+  this->GetImageSampler()->Update();
+  SizeValueType numberOfWorkUnits = this->GetNumberOfImageSamples() / this->m_MinimumNumberOfSamplesPerThread;
+  numberOfWorkUnits = std::min<SizeValueType>(numberOfWorkUnits, this->m_MaximumNumberOfWorkUnits);
+  numberOfWorkUnits = std::max<SizeValueType>(numberOfWorkUnits, 1);
+
+  Superclass::SetNumberOfWorkUnits(static_cast<ThreadIdType>(numberOfWorkUnits));
+
+} // end LimitNumberOfWorkUnitsToNumberOfSamples()
+
+
 /**
  * ********************* InitializeThreadingParameters ****************************
  */
@@ -211,6 +283,19 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeThreadingParame
     this->m_GetValueAndDerivativePerThreadVariablesSize = numberOfThreads;
   }
 
+  /** Only accumulate the touched blocks of the derivatives when the transform
+   * has a sparse Jacobian, and the number of parameters is large enough to
+   * make it worthwhile. Otherwise the dense accumulation is used.
+   */
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const unsigned int           blockSize = DerivativeBlockSize;
+  this->m_SparseDerivativeAccumulationActive =
+    this->m_UseSparseDerivativeAccumulation && this->m_TransformIsAdvanced &&
+    this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() < numberOfParameters &&
+    numberOfParameters >= 16 * blockSize;
+  const std::size_t numberOfBlocks =
+    this->m_SparseDerivativeAccumulationActive ? (numberOfParameters + blockSize - 1) / blockSize : 0;
+
   /** Some initialization. */
   for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
@@ -220,10 +305,18 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeThreadingParame
     this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = NumericTraits<SizeValueType>::Zero;
     this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
     this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.SetSize(this->GetNumberOfParameters());
-    this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(
-      NumericTraits<DerivativeValueType>::ZeroValue());
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_TouchedDerivativeBlocks.assign(numberOfBlocks, 0);
   }
 
+  /** Zero the derivative of each thread by that thread itself. The memory of a
+   * newly allocated derivative is then first touched by the thread that writes
+   * it during the metric evaluations, so that on NUMA systems the operating
+   * system places it on the memory node of that thread, instead of the node
+   * of the main thread.
+   */
+  this->LaunchThreaderCallback(this->InitializePerThreadDerivativesThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
 } // end InitializeThreadingParameters()
 
 
@@ -246,35 +339,15 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeLimiters(void)
     itk::TimeProbe timer;
     timer.Start();
 
-    typedef typename itk::ComputeImageExtremaFilter<FixedImageType> ComputeFixedImageExtremaFilterType;
-    typename ComputeFixedImageExtremaFilterType::Pointer            computeFixedImageExtrema =
-      ComputeFixedImageExtremaFilterType::New();
-    computeFixedImageExtrema->SetInput(this->GetFixedImage());
-    computeFixedImageExtrema->SetImageRegion(this->GetFixedImageRegion());
-    if (this->m_FixedImageMask.IsNotNull())
-    {
-      computeFixedImageExtrema->SetUseMask(true);
-
-      const FixedImageMaskSpatialObject2Type * fMask =
-        dynamic_cast<const FixedImageMaskSpatialObject2Type *>(this->m_FixedImageMask.GetPointer());
-      if (fMask)
-      {
-        computeFixedImageExtrema->SetImageSpatialMask(fMask);
-      }
-      else
-      {
-        computeFixedImageExtrema->SetImageMask(this->GetFixedImageMask());
-      }
-    }
-
-    computeFixedImageExtrema->Update();
+    this->m_ImageExtremaCache->GetExtrema(this->GetFixedImage(),
+                                          this->GetFixedImageRegion(),
+                                          this->GetFixedImageMask(),
+                                          this->m_FixedImageTrueMin,
+                                          this->m_FixedImageTrueMax);
     timer.Stop();
     elxout << "  Computing the fixed image extrema took " << static_cast<long>(timer.GetMean() * 1000) << " ms."
            << std::endl;
 
-    this->m_FixedImageTrueMax = computeFixedImageExtrema->GetMaximum();
-    this->m_FixedImageTrueMin = computeFixedImageExtrema->GetMinimum();
-
     this->m_FixedImageMinLimit = static_cast<FixedImageLimiterOutputType>(
       this->m_FixedImageTrueMin -
       this->m_FixedLimitRangeRatio * (this->m_FixedImageTrueMax - this->m_FixedImageTrueMin));
@@ -301,34 +374,16 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeLimiters(void)
     itk::TimeProbe timer;
     timer.Start();
 
-    typedef typename itk::ComputeImageExtremaFilter<MovingImageType> ComputeMovingImageExtremaFilterType;
-    typename ComputeMovingImageExtremaFilterType::Pointer            computeMovingImageExtrema =
-      ComputeMovingImageExtremaFilterType::New();
-    computeMovingImageExtrema->SetInput(this->GetMovingImage());
-    computeMovingImageExtrema->SetImageRegion(this->GetMovingImage()->GetBufferedRegion());
-    if (this->m_MovingImageMask.IsNotNull())
-    {
-      computeMovingImageExtrema->SetUseMask(true);
-      const MovingImageMaskSpatialObject2Type * mMask =
-        dynamic_cast<const MovingImageMaskSpatialObject2Type *>(this->m_MovingImageMask.GetPointer());
-      if (mMask)
-      {
-        computeMovingImageExtrema->SetImageSpatialMask(mMask);
-      }
-      else
-      {
-        computeMovingImageExtrema->SetImageMask(this->GetMovingImageMask());
-      }
-    }
-    computeMovingImageExtrema->Update();
+    this->m_ImageExtremaCache->GetExtrema(this->GetMovingImage(),
+                                          this->GetMovingImage()->GetBufferedRegion(),
+                                          this->GetMovingImageMask(),
+                                          this->m_MovingImageTrueMin,
+                                          this->m_MovingImageTrueMax);
 
     timer.Stop();
     elxout << "  Computing the moving image extrema took " << static_cast<long>(timer.GetMean() * 1000) << " ms."
            << std::endl;
 
-    this->m_MovingImageTrueMax = computeMovingImageExtrema->GetMaximum();
-    this->m_MovingImageTrueMin = computeMovingImageExtrema->GetMinimum();
-
     this->m_MovingImageMinLimit = static_cast<MovingImageLimiterOutputType>(
       this->m_MovingImageTrueMin -
       this->m_MovingLimitRangeRatio * (this->m_MovingImageTrueMax - this->m_MovingImageTrueMin));
@@ -367,6 +422,10 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeImageSampler(vo
     this->m_ImageSampler->SetInput(this->m_FixedImage);
     this->m_ImageSampler->SetMask(this->m_FixedImageMask);
     this->m_ImageSampler->SetInputImageRegion(this->GetFixedImageRegion());
+
+    /** Only request implicit samples when they are read by the multi-threaded code. */
+    this->m_ImageSampler->SetUseImplicitSamples(this->m_UseImplicitSamples && this->m_ImplicitSamplesSupported &&
+                                                this->m_UseMultiThread);
   }
 
 } // end InitializeImageSampler()
@@ -415,10 +474,16 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckForBSplineInterpolat
     itkDebugMacro("Interpolator is not BSplineFloat");
   }
 
+  /** The advanced version has a fused kernel, which is used when it is available. */
+  this->m_AdvancedBSplineInterpolatorFloat =
+    dynamic_cast<AdvancedBSplineInterpolatorFloatType *>(this->m_Interpolator.GetPointer());
+
   this->m_InterpolatorIsReducedBSpline = false;
   ReducedBSplineInterpolatorType * testPtr3 =
     dynamic_cast<ReducedBSplineInterpolatorType *>(this->m_Interpolator.GetPointer());
-  if (testPtr3)
+  this->m_ReducedBSplineInterpolatorFloat =
+    dynamic_cast<ReducedBSplineInterpolatorFloatType *>(this->m_Interpolator.GetPointer());
+  if (testPtr3 || this->m_ReducedBSplineInterpolatorFloat)
   {
     this->m_InterpolatorIsReducedBSpline = true;
     this->m_ReducedBSplineInterpolator = testPtr3;
@@ -442,6 +507,10 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckForBSplineInterpolat
     this->m_LinearInterpolator = nullptr;
   }
 
+  /** The packed values and gradients are only computed below, when requested. */
+  this->m_ValueAndGradientImage = nullptr;
+  this->m_UseValuesOfValueAndGradientImage = false;
+
   /** Don't overwrite the gradient image if GetComputeGradient() == true.
    * Otherwise we can use a forward difference derivative, or the derivative
    * provided by the B-spline interpolator.
@@ -475,6 +544,14 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckForBSplineInterpolat
       this->m_CentralDifferenceGradientFilter->SetInput(this->m_MovingImage);
       this->m_CentralDifferenceGradientFilter->Update();
       this->m_GradientImage = this->m_CentralDifferenceGradientFilter->GetOutput();
+
+      /** Replace the gradient image by the packed values and gradients, when requested. */
+      if (this->m_UseValueAndGradientImage)
+      {
+        this->ComputeValueAndGradientImage();
+        this->m_CentralDifferenceGradientFilter = nullptr;
+        this->m_GradientImage = nullptr;
+      }
     }
     else
     {
@@ -486,6 +563,48 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckForBSplineInterpolat
 } // end CheckForBSplineInterpolator()
 
 
+/**
+ * ****************** ComputeValueAndGradientImage **********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::ComputeValueAndGradientImage(void)
+{
+  /** The packed image covers the region of the gradient image. */
+  const typename MovingImageType::RegionType region = this->m_GradientImage->GetBufferedRegion();
+
+  this->m_ValueAndGradientImage = ValueAndGradientImageType::New();
+  this->m_ValueAndGradientImage->CopyInformation(this->m_GradientImage);
+  this->m_ValueAndGradientImage->SetRegions(region);
+  this->m_ValueAndGradientImage->Allocate();
+
+  ImageRegionConstIterator<MovingImageType>     valueIt(this->m_MovingImage, region);
+  ImageRegionConstIterator<GradientImageType>   gradientIt(this->m_GradientImage, region);
+  ImageRegionIterator<ValueAndGradientImageType> packedIt(this->m_ValueAndGradientImage, region);
+  for (; !packedIt.IsAtEnd(); ++valueIt, ++gradientIt, ++packedIt)
+  {
+    ValueAndGradientPixelType & packed = packedIt.Value();
+    packed[0] = static_cast<float>(valueIt.Get());
+    for (unsigned int j = 0; j < MovingImageDimension; ++j)
+    {
+      packed[j + 1] = static_cast<float>(gradientIt.Get()[j]);
+    }
+  }
+
+  /** With a nearest neighbor interpolator the value at the rounded index is the interpolated
+   * value, provided that float represents the moving image pixels exactly.
+   */
+  typedef typename MovingImageType::PixelType MovingImagePixelType;
+  const bool interpolatorIsNearestNeighbor =
+    dynamic_cast<NearestNeighborInterpolatorType *>(this->m_Interpolator.GetPointer()) != nullptr;
+  this->m_UseValuesOfValueAndGradientImage =
+    interpolatorIsNearestNeighbor && std::numeric_limits<MovingImagePixelType>::is_specialized &&
+    std::numeric_limits<MovingImagePixelType>::digits <= std::numeric_limits<float>::digits;
+
+} // end ComputeValueAndGradientImage()
+
+
 /**
  * ****************** CheckForAdvancedTransform **********************
  */
@@ -587,14 +706,29 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::EvaluateMovingImageValueA
       else if (this->m_InterpolatorIsBSplineFloat && !this->GetComputeGradient())
       {
         /** Compute moving image value and gradient using the B-spline kernel. */
-        this->m_BSplineInterpolatorFloat->EvaluateValueAndDerivativeAtContinuousIndex(
-          cindex, movingImageValue, *gradient);
+        if (this->m_AdvancedBSplineInterpolatorFloat)
+        {
+          this->m_AdvancedBSplineInterpolatorFloat->EvaluateValueAndDerivativeAtContinuousIndex(
+            cindex, movingImageValue, *gradient);
+        }
+        else
+        {
+          this->m_BSplineInterpolatorFloat->EvaluateValueAndDerivativeAtContinuousIndex(
+            cindex, movingImageValue, *gradient);
+        }
       }
       else if (this->m_InterpolatorIsReducedBSpline && !this->GetComputeGradient())
       {
         /** Compute moving image value and gradient using the B-spline kernel. */
         movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex(cindex);
-        (*gradient) = this->m_ReducedBSplineInterpolator->EvaluateDerivativeAtContinuousIndex(cindex);
+        if (this->m_ReducedBSplineInterpolatorFloat)
+        {
+          (*gradient) = this->m_ReducedBSplineInterpolatorFloat->EvaluateDerivativeAtContinuousIndex(cindex);
+        }
+        else
+        {
+          (*gradient) = this->m_ReducedBSplineInterpolator->EvaluateDerivativeAtContinuousIndex(cindex);
+        }
         // this->m_ReducedBSplineInterpolator->EvaluateValueAndDerivativeAtContinuousIndex(
         //  cindex, movingImageValue, *gradient );
       }
@@ -603,6 +737,28 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::EvaluateMovingImageValueA
         /** Compute moving image value and gradient using the linear interpolator. */
         this->m_LinearInterpolator->EvaluateValueAndDerivativeAtContinuousIndex(cindex, movingImageValue, *gradient);
       }
+      else if (this->m_ValueAndGradientImage)
+      {
+        /** Get the gradient, and possibly the value, from the packed image by a single look-up. */
+        MovingImageIndexType index;
+        for (unsigned int j = 0; j < MovingImageDimension; ++j)
+        {
+          index[j] = static_cast<long>(Math::Round<double>(cindex[j]));
+        }
+        const ValueAndGradientPixelType & packed = this->m_ValueAndGradientImage->GetPixel(index);
+        if (this->m_UseValuesOfValueAndGradientImage)
+        {
+          movingImageValue = packed[0];
+        }
+        else
+        {
+          movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex(cindex);
+        }
+        for (unsigned int j = 0; j < MovingImageDimension; ++j)
+        {
+          (*gradient)[j] = packed[j + 1];
+        }
+      }
       else
       {
         /** Get the gradient by NearestNeighboorInterpolation of the gradient image.
@@ -748,132 +904,540 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::TransformPoint(const Fixe
 
 
 /**
- * *************** EvaluateTransformJacobian ****************
+ * ************************** TransformPoints *************************
  */
 
 template <class TFixedImage, class TMovingImage>
-bool
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::EvaluateTransformJacobian(
-  const FixedImagePointType &  fixedImagePoint,
-  TransformJacobianType &      jacobian,
-  NonZeroJacobianIndicesType & nzji) const
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::TransformPoints(
+  const FixedImagePointType * fixedImagePoints,
+  MovingImagePointType *      mappedPoints,
+  const SizeValueType         numberOfPoints) const
 {
-  /** Advanced transform: generic sparse Jacobian support */
-  this->m_AdvancedTransform->GetJacobian(fixedImagePoint, jacobian, nzji);
-
-  /** For future use: return whether the sample is valid */
-  const bool valid = true;
-  return valid;
+  /** Like TransformPoint(), map with m_Transform, which need not be an advanced transform. */
+  const AdvancedTransformType * advancedTransform =
+    dynamic_cast<const AdvancedTransformType *>(this->m_Transform.GetPointer());
+  if (advancedTransform != nullptr)
+  {
+    advancedTransform->TransformPoints(fixedImagePoints, mappedPoints, numberOfPoints);
+    return;
+  }
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    mappedPoints[i] = this->m_Transform->TransformPoint(fixedImagePoints[i]);
+  }
 
-} // end EvaluateTransformJacobian()
+} // end TransformPoints()
 
 
 /**
- * ************************** IsInsideMovingMask *************************
+ * ************************** GetNextSampleBatch *************************
  */
 
 template <class TFixedImage, class TMovingImage>
 bool
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::IsInsideMovingMask(const MovingImagePointType & point) const
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetNextSampleBatch(
+  const ThreadIdType               threadId,
+  const ImageSampleContainerType & sampleContainer,
+  SampleBatchType &                batch) const
 {
-  /** If a mask has been set: */
-  if (this->m_MovingImageMask.IsNotNull())
+  /** Claim a new range of samples when the current one is exhausted. */
+  if (batch.st_Next >= batch.st_RangeEnd)
   {
-    return this->m_MovingImageMask->IsInsideInWorldSpace(point);
+    if (!this->GetNextSampleRange(threadId, batch.st_Next, batch.st_RangeEnd))
+    {
+      batch.st_Size = 0;
+      return false;
+    }
   }
 
-  /** If no mask has been set, just return true. */
+  const SizeValueType remaining = batch.st_RangeEnd - batch.st_Next;
+  batch.st_Size = remaining < SampleBatchSize ? static_cast<unsigned int>(remaining) : SampleBatchSize;
+
+  /** Read the samples and map all points at once. */
+  batch.st_Begin = batch.st_Next;
+  for (unsigned int b = 0; b < batch.st_Size; ++b)
+  {
+    this->ReadFixedImageSample(
+      sampleContainer, batch.st_Begin + b, batch.st_FixedPoints[b], batch.st_FixedImageValues[b]);
+  }
+  /** Flag the samples that the linear transform maps outside the moving image or mask.
+   * The test is done in the continuous index space of the moving image, with the affine
+   * map computed by InitializeLinearSampleRejection(). It is never active together with
+   * the transform evaluation cache.
+   */
+  unsigned int numberOfAcceptedSamples = batch.st_Size;
+  if (this->m_LinearSampleRejectionActive)
+  {
+    numberOfAcceptedSamples = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      const FixedImagePointType & fixedPoint = batch.st_FixedPoints[b];
+      bool                        rejected = false;
+      for (unsigned int k = 0; k < MovingImageDimension && !rejected; ++k)
+      {
+        double cindex = this->m_SampleRejectionOffset[k];
+        for (unsigned int d = 0; d < FixedImageDimension; ++d)
+        {
+          cindex += this->m_SampleRejectionMatrix[k][d] * (fixedPoint[d] - this->m_SampleRejectionOrigin[d]);
+        }
+        rejected = cindex < this->m_SampleRejectionLowerBound[k] || cindex > this->m_SampleRejectionUpperBound[k];
+      }
+      batch.st_Rejected[b] = rejected;
+      numberOfAcceptedSamples += rejected ? 0 : 1;
+    }
+    this->m_NumberOfTestedSamples += batch.st_Size;
+    this->m_NumberOfRejectedSamples += batch.st_Size - numberOfAcceptedSamples;
+  }
+  else
+  {
+    std::fill_n(batch.st_Rejected, batch.st_Size, false);
+  }
+
+  /** Read the mapped points from the transform evaluation cache, if all of them
+   * are there. Otherwise, map them and store them for the other metrics.
+   */
+  bool mappedPointsCached = this->m_TransformEvaluationCacheActive;
+  for (unsigned int b = 0; mappedPointsCached && b < batch.st_Size; ++b)
+  {
+    mappedPointsCached = this->m_TransformEvaluationCache->GetMappedPoint(batch.st_Begin + b, batch.st_MappedPoints[b]);
+  }
+  if (numberOfAcceptedSamples < batch.st_Size)
+  {
+    /** Map only the accepted samples, and give the rejected ones a defined mapped point. */
+    FixedImagePointType  acceptedPoints[SampleBatchSize];
+    MovingImagePointType mappedPoints[SampleBatchSize];
+    unsigned int         a = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      if (!batch.st_Rejected[b])
+      {
+        acceptedPoints[a++] = batch.st_FixedPoints[b];
+      }
+    }
+    if (numberOfAcceptedSamples > 0)
+    {
+      this->TransformPoints(acceptedPoints, mappedPoints, numberOfAcceptedSamples);
+    }
+    a = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      if (batch.st_Rejected[b])
+      {
+        batch.st_MappedPoints[b].Fill(0.0);
+      }
+      else
+      {
+        batch.st_MappedPoints[b] = mappedPoints[a++];
+      }
+    }
+  }
+  else if (!mappedPointsCached)
+  {
+    this->TransformPoints(batch.st_FixedPoints, batch.st_MappedPoints, batch.st_Size);
+    if (this->m_TransformEvaluationCacheActive)
+    {
+      for (unsigned int b = 0; b < batch.st_Size; ++b)
+      {
+        this->m_TransformEvaluationCache->SetMappedPoint(batch.st_Begin + b, batch.st_MappedPoints[b]);
+      }
+    }
+  }
+
+  /** Limit the fixed image values, preferably by reading the cached ones. */
+  if (this->m_UseFixedImageLimiter)
+  {
+    if (this->m_FixedImageSampleCacheValid)
+    {
+      std::copy_n(
+        this->m_FixedImageSampleCacheValues.begin() + batch.st_Begin, batch.st_Size, batch.st_FixedImageValues);
+    }
+    else
+    {
+      for (unsigned int b = 0; b < batch.st_Size; ++b)
+      {
+        batch.st_FixedImageValues[b] = this->m_FixedImageLimiter->Evaluate(batch.st_FixedImageValues[b]);
+      }
+    }
+  }
+
+  batch.st_Next += batch.st_Size;
   return true;
 
-} // end IsInsideMovingMask()
+} // end GetNextSampleBatch()
 
 
 /**
- * *********************** GetSelfHessian ***********************
+ * ******************* InitializeLinearSampleRejection *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetSelfHessian(
-  const TransformParametersType & itkNotUsed(parameters),
-  HessianType &                   H) const
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeLinearSampleRejection(void) const
 {
-  itkDebugMacro("GetSelfHessian()");
+  this->m_LinearSampleRejectionActive = false;
+  this->m_NumberOfTestedSamples = 0;
+  this->m_NumberOfRejectedSamples = 0;
+  if (!this->m_UseLinearTransformSampleRejection || this->m_TransformEvaluationCacheActive ||
+      this->m_AdvancedTransform.IsNull() || this->m_Interpolator.IsNull() || !this->m_AdvancedTransform->IsLinear())
+  {
+    return;
+  }
 
-  /** Set identity matrix as default implementation. */
-  H.set_size(this->GetNumberOfParameters(), this->GetNumberOfParameters());
-  // H.Fill(0.0);
-  // H.fill_diagonal(1.0);
-  for (unsigned int i = 0; i < this->GetNumberOfParameters(); ++i)
+  /** The bounds of the continuous indices that are inside the interpolator buffer. An
+   * interpolator that accepts points outside its buffer, like the ray cast interpolator,
+   * gives no bounds.
+   */
+  const MovingImageContinuousIndexType & startIndex = this->m_Interpolator->GetStartContinuousIndex();
+  const MovingImageContinuousIndexType & endIndex = this->m_Interpolator->GetEndContinuousIndex();
+  MovingImageContinuousIndexType         probeIndex = endIndex;
+  probeIndex[0] += 1.0;
+  const bool useBufferBounds = !this->m_Interpolator->IsInsideBuffer(probeIndex);
+  for (unsigned int k = 0; k < MovingImageDimension; ++k)
   {
-    H(i, i) = 1.0;
+    this->m_SampleRejectionLowerBound[k] = useBufferBounds ? startIndex[k] : -NumericTraits<double>::max();
+    this->m_SampleRejectionUpperBound[k] = useBufferBounds ? endIndex[k] : NumericTraits<double>::max();
   }
 
-} // end GetSelfHessian()
+  /** Intersect them with the bounding box of the moving mask, in continuous indices of
+   * the moving image. The box is widened by half a voxel of an image mask, as a point
+   * near the border of the box may still be inside a mask voxel.
+   */
+  if (this->m_MovingImageMask.IsNotNull())
+  {
+    typedef typename MovingImageMaskType::BoundingBoxType BoundingBoxType;
+    typedef typename BoundingBoxType::PointsContainer     PointsContainerType;
+    const PointsContainerType * corners = this->m_MovingImageMask->GetMyBoundingBoxInWorldSpace()->GetPoints();
+
+    double                                    margin = 0.0;
+    const MovingImageMaskSpatialObject2Type * imageMask =
+      dynamic_cast<const MovingImageMaskSpatialObject2Type *>(this->m_MovingImageMask.GetPointer());
+    if (imageMask != nullptr && imageMask->GetImage() != nullptr)
+    {
+      const double maskVoxelRadius = 0.5 * imageMask->GetImage()->GetSpacing().GetNorm();
+      double       minimumSpacing = NumericTraits<double>::max();
+      for (unsigned int k = 0; k < MovingImageDimension; ++k)
+      {
+        minimumSpacing = std::min(minimumSpacing, static_cast<double>(this->m_MovingImage->GetSpacing()[k]));
+      }
+      margin = maskVoxelRadius / minimumSpacing;
+    }
+
+    double lowerBound[MovingImageDimension];
+    double upperBound[MovingImageDimension];
+    std::fill_n(lowerBound, MovingImageDimension, NumericTraits<double>::max());
+    std::fill_n(upperBound, MovingImageDimension, -NumericTraits<double>::max());
+    MovingImageContinuousIndexType cindex;
+    for (typename PointsContainerType::ConstIterator it = corners->Begin(); it != corners->End(); ++it)
+    {
+      this->m_MovingImage->TransformPhysicalPointToContinuousIndex(it.Value(), cindex);
+      for (unsigned int k = 0; k < MovingImageDimension; ++k)
+      {
+        lowerBound[k] = std::min(lowerBound[k], static_cast<double>(cindex[k]) - margin);
+        upperBound[k] = std::max(upperBound[k], static_cast<double>(cindex[k]) + margin);
+      }
+    }
+    for (unsigned int k = 0; k < MovingImageDimension; ++k)
+    {
+      this->m_SampleRejectionLowerBound[k] = std::max(this->m_SampleRejectionLowerBound[k], lowerBound[k]);
+      this->m_SampleRejectionUpperBound[k] = std::min(this->m_SampleRejectionUpperBound[k], upperBound[k]);
+    }
+  }
+  else if (!useBufferBounds)
+  {
+    return;
+  }
+
+  /** The affine map from the fixed image points to the continuous indices of their mapped
+   * points, from the transform of the fixed image origin and of one step along each axis.
+   */
+  const typename FixedImageType::PointType &   fixedOrigin = this->m_FixedImage->GetOrigin();
+  const typename FixedImageType::SpacingType & fixedSpacing = this->m_FixedImage->GetSpacing();
+  for (unsigned int d = 0; d < FixedImageDimension; ++d)
+  {
+    this->m_SampleRejectionOrigin[d] = fixedOrigin[d];
+  }
+  MovingImageContinuousIndexType originIndex;
+  this->m_Interpolator->ConvertPointToContinuousIndex(
+    this->m_AdvancedTransform->TransformPoint(this->m_SampleRejectionOrigin), originIndex);
+  for (unsigned int k = 0; k < MovingImageDimension; ++k)
+  {
+    this->m_SampleRejectionOffset[k] = originIndex[k];
+  }
+  for (unsigned int d = 0; d < FixedImageDimension; ++d)
+  {
+    FixedImagePointType stepPoint = this->m_SampleRejectionOrigin;
+    stepPoint[d] += fixedSpacing[d];
+    MovingImageContinuousIndexType stepIndex;
+    this->m_Interpolator->ConvertPointToContinuousIndex(this->m_AdvancedTransform->TransformPoint(stepPoint),
+                                                        stepIndex);
+    for (unsigned int k = 0; k < MovingImageDimension; ++k)
+    {
+      this->m_SampleRejectionMatrix[k][d] = (stepIndex[k] - originIndex[k]) / fixedSpacing[d];
+    }
+  }
+
+  /** Widen the bounds a little, so that rounding errors never reject a valid sample. */
+  for (unsigned int k = 0; k < MovingImageDimension; ++k)
+  {
+    this->m_SampleRejectionLowerBound[k] -= 1e-3;
+    this->m_SampleRejectionUpperBound[k] += 1e-3;
+  }
+  this->m_LinearSampleRejectionActive = true;
+
+} // end InitializeLinearSampleRejection()
 
 
 /**
- * *********************** BeforeThreadedGetValueAndDerivative ***********************
+ * ******************* GetRejectedSampleFraction *******************
  */
 
 template <class TFixedImage, class TMovingImage>
-void
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::BeforeThreadedGetValueAndDerivative(
-  const TransformParametersType & parameters) const
+double
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetRejectedSampleFraction(void) const
 {
-  /** In this function do all stuff that cannot be multi-threaded. */
-  if (this->m_UseMetricSingleThreaded)
+  const SizeValueType numberOfTestedSamples = this->m_NumberOfTestedSamples;
+  if (numberOfTestedSamples == 0)
   {
-    this->SetTransformParameters(parameters);
-    if (this->m_UseImageSampler)
-    {
-      this->GetImageSampler()->Update();
-    }
+    return 0.0;
   }
+  return static_cast<double>(this->m_NumberOfRejectedSamples) / static_cast<double>(numberOfTestedSamples);
 
-} // end BeforeThreadedGetValueAndDerivative()
+} // end GetRejectedSampleFraction()
 
 
 /**
- * **************** GetValueThreaderCallback *******
+ * ************************** TransformSamplePoint *************************
  */
 
 template <class TFixedImage, class TMovingImage>
-ITK_THREAD_RETURN_TYPE
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueThreaderCallback(void * arg)
+bool
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::TransformSamplePoint(
+  const SizeValueType         sampleIndex,
+  const FixedImagePointType & fixedImagePoint,
+  MovingImagePointType &      mappedPoint) const
 {
-  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
-  ThreadIdType     threadID = infoStruct->WorkUnitID;
-
-  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
-
-  temp->st_Metric->ThreadedGetValue(threadID);
+  if (!this->m_TransformEvaluationCacheActive)
+  {
+    return this->TransformPoint(fixedImagePoint, mappedPoint);
+  }
 
-  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  if (!this->m_TransformEvaluationCache->GetMappedPoint(sampleIndex, mappedPoint))
+  {
+    this->TransformPoint(fixedImagePoint, mappedPoint);
+    this->m_TransformEvaluationCache->SetMappedPoint(sampleIndex, mappedPoint);
+  }
+  return true;
 
-} // end GetValueThreaderCallback()
+} // end TransformSamplePoint()
 
 
 /**
- * *********************** LaunchGetValueThreaderCallback***************
+ * ************** EvaluateSampleJacobianWithImageGradientProduct *************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchGetValueThreaderCallback(void) const
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::EvaluateSampleJacobianWithImageGradientProduct(
+  const SizeValueType               sampleIndex,
+  const FixedImagePointType &       fixedImagePoint,
+  const MovingImageDerivativeType & movingImageDerivative,
+  DerivativeType &                  imageJacobian,
+  NonZeroJacobianIndicesType &      nzji) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(this->GetValueThreaderCallback,
-                                    const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+  if (!this->m_TransformEvaluationCacheActive)
+  {
+    this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      fixedImagePoint, movingImageDerivative, imageJacobian, nzji);
+    return;
+  }
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  /** Always take the unfused route here, so that the result does not depend
+   * on which metric happened to evaluate the Jacobian first.
+   */
+  TransformJacobianType jacobian;
+  if (!this->m_TransformEvaluationCache->GetJacobian(sampleIndex, jacobian, nzji))
+  {
+    this->EvaluateTransformJacobian(fixedImagePoint, jacobian, nzji);
+    this->m_TransformEvaluationCache->SetJacobian(sampleIndex, jacobian, nzji);
+  }
+  this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
 
-} // end LaunchGetValueThreaderCallback()
+} // end EvaluateSampleJacobianWithImageGradientProduct()
 
 
 /**
- * **************** GetValueAndDerivativeThreaderCallback *******
+ * *************** EvaluateTransformJacobian ****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::EvaluateTransformJacobian(
+  const FixedImagePointType &  fixedImagePoint,
+  TransformJacobianType &      jacobian,
+  NonZeroJacobianIndicesType & nzji) const
+{
+  /** Advanced transform: generic sparse Jacobian support */
+  this->m_AdvancedTransform->GetJacobian(fixedImagePoint, jacobian, nzji);
+
+  /** For future use: return whether the sample is valid */
+  const bool valid = true;
+  return valid;
+
+} // end EvaluateTransformJacobian()
+
+
+/**
+ * ************************** IsInsideMovingMask *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::IsInsideMovingMask(const MovingImagePointType & point) const
+{
+  /** If a mask has been set: */
+  if (this->m_MovingImageMask.IsNotNull())
+  {
+    if (this->m_MovingImageBitPackedMask.IsValidFor(this->m_MovingImageMask))
+    {
+      return this->m_MovingImageBitPackedMask.IsInside(point);
+    }
+    return this->m_MovingImageMask->IsInsideInWorldSpace(point);
+  }
+
+  /** If no mask has been set, just return true. */
+  return true;
+
+} // end IsInsideMovingMask()
+
+
+/**
+ * *********************** GetSelfHessian ***********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetSelfHessian(
+  const TransformParametersType & itkNotUsed(parameters),
+  HessianType &                   H) const
+{
+  itkDebugMacro("GetSelfHessian()");
+
+  /** Set identity matrix as default implementation. */
+  H.set_size(this->GetNumberOfParameters(), this->GetNumberOfParameters());
+  // H.Fill(0.0);
+  // H.fill_diagonal(1.0);
+  for (unsigned int i = 0; i < this->GetNumberOfParameters(); ++i)
+  {
+    H(i, i) = 1.0;
+  }
+
+} // end GetSelfHessian()
+
+
+/**
+ * *********************** AsynchronousGradientDescent ***********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AsynchronousGradientDescent(
+  TransformParametersType & itkNotUsed(parameters),
+  const double              itkNotUsed(stepSize),
+  MeasureType &             itkNotUsed(value)) const
+{
+  itkExceptionMacro(<< "ERROR: " << this->GetNameOfClass() << " does not support asynchronous gradient descent.");
+
+} // end AsynchronousGradientDescent()
+
+
+/**
+ * *********************** BeforeThreadedGetValueAndDerivative ***********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::BeforeThreadedGetValueAndDerivative(
+  const TransformParametersType & parameters) const
+{
+  /** In this function do all stuff that cannot be multi-threaded. */
+  if (this->m_UseMetricSingleThreaded)
+  {
+    this->SetTransformParameters(parameters);
+    if (this->m_UseImageSampler)
+    {
+      {
+        HardwareCounters::ScopedPhase phase("ImageSampler");
+        this->GetImageSampler()->Update();
+        phase.SetNumberOfSamples(this->GetImageSampler()->GetOutput()->Size());
+      }
+
+      /** Point the shared transform evaluation cache at the current samples. */
+      if (this->m_TransformEvaluationCache.IsNotNull())
+      {
+        const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
+        this->m_TransformEvaluationCache->Initialize(sampleContainer,
+                                                     sampleContainer->GetMTime(),
+                                                     sampleContainer->Size(),
+                                                     this->m_Transform->GetParameters(),
+                                                     this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
+      }
+    }
+  }
+
+} // end BeforeThreadedGetValueAndDerivative()
+
+
+/**
+ * **************** GetValueThreaderCallback *******
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  const auto startTime = std::chrono::steady_clock::now();
+
+  temp->st_Metric->ThreadedGetValue(threadID);
+
+  if (temp->st_Metric->m_UseThreadStatistics)
+  {
+    temp->st_Metric->UpdateThreadStatistics(
+      threadID, startTime, temp->st_Metric->m_GetValuePerThreadVariables[threadID].st_NumberOfPixelsCounted);
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetValueThreaderCallback()
+
+
+/**
+ * *********************** LaunchGetValueThreaderCallback***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchGetValueThreaderCallback(void) const
+{
+  /** Distribute the samples over the threads, and over the processes. */
+  this->InitializeSampleScheduler(this->GetNumberOfImageSamples(), true);
+
+  /** Setup threader and launch. */
+  this->LaunchThreaderCallback(this->GetValueThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+  this->FinalizeSampleScheduler();
+
+} // end LaunchGetValueThreaderCallback()
+
+
+/**
+ * **************** GetValueAndDerivativeThreaderCallback *******
  */
 
 template <class TFixedImage, class TMovingImage>
@@ -885,8 +1449,17 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeThre
 
   MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
 
+  const auto startTime = std::chrono::steady_clock::now();
+
   temp->st_Metric->ThreadedGetValueAndDerivative(threadID);
 
+  if (temp->st_Metric->m_UseThreadStatistics)
+  {
+    const SizeValueType numberOfPixelsCounted =
+      temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[threadID].st_NumberOfPixelsCounted;
+    temp->st_Metric->UpdateThreadStatistics(threadID, startTime, numberOfPixelsCounted);
+  }
+
   return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
 
 } // end GetValueAndDerivativeThreaderCallback()
@@ -900,16 +1473,439 @@ template <class TFixedImage, class TMovingImage>
 void
 AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchGetValueAndDerivativeThreaderCallback(void) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(this->GetValueAndDerivativeThreaderCallback,
-                                    const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+  /** The evaluation of the samples, including the transform Jacobians, by all threads. */
+  HardwareCounters::ScopedPhase phase("Metric", this->GetNumberOfImageSamples());
+
+  /** Distribute the samples over the threads, and over the processes. */
+  this->InitializeSampleScheduler(this->GetNumberOfImageSamples(), true);
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  /** Setup threader and launch. */
+  this->LaunchThreaderCallback(this->GetValueAndDerivativeThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+  this->FinalizeSampleScheduler();
 
 } // end LaunchGetValueAndDerivativeThreaderCallback()
 
 
+/**
+ * *********************** LaunchThreaderCallback ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::LaunchThreaderCallback(ThreadFunctionType callback,
+                                                                              void *             userData) const
+{
+  /** Count the accumulation of the derivatives of the threads as a phase of its own. */
+  const HardwareCounters::ScopedPhase phase(
+    (callback == Self::AccumulateDerivativesThreaderCallback) ? "AccumulateDerivatives" : nullptr);
+
+  if (!this->m_UseThreadPool)
+  {
+    /** Spawn and join threads for this call only. */
+    this->m_Threader->SetSingleMethod(callback, userData);
+    this->m_Threader->SingleMethodExecute();
+    return;
+  }
+
+  /** The callbacks divide their work by Self::GetNumberOfWorkUnits(), so the
+   * tasks must use exactly the same number of work units.
+   */
+  ParallelTasks::Execute(Self::GetNumberOfWorkUnits(), callback, userData);
+
+} // end LaunchThreaderCallback()
+
+
+/**
+ * *********************** InitializeSampleScheduler ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializeSampleScheduler(
+  const SizeValueType numberOfSamples,
+  const bool          distributeOverProcesses) const
+{
+  const SizeValueType numberOfWorkUnits = Self::GetNumberOfWorkUnits();
+
+  /** The samples [first, end) of the current process. The samples keep their
+   * index in the sample container, so that the caches can still be used.
+   */
+  SizeValueType firstSample = 0;
+  SizeValueType endSample = numberOfSamples;
+  if (distributeOverProcesses && this->IsSampleEvaluationDistributed())
+  {
+    const SizeValueType numberOfProcesses = ProcessGroup::GetNumberOfProcesses();
+    const SizeValueType rank = ProcessGroup::GetRank();
+    firstSample = numberOfSamples * rank / numberOfProcesses;
+    endSample = numberOfSamples * (rank + 1) / numberOfProcesses;
+  }
+  const SizeValueType numberOfOwnSamples = endSample - firstSample;
+
+  this->m_SampleSchedulerFirstSample = firstSample;
+  this->m_SampleSchedulerNumberOfSamples = endSample;
+  this->m_SampleSchedulerNextSample = firstSample;
+  this->m_SampleSchedulerStaticRangeTaken.assign(numberOfWorkUnits, 0);
+  if (this->m_UseThreadStatistics)
+  {
+    this->m_CurrentThreadStatistics.assign(numberOfWorkUnits, ThreadStatisticsType());
+  }
+
+  if (this->m_UseDynamicSampleScheduling)
+  {
+    /** Aim at chunks that take about 50 microseconds each: long enough to make
+     * the atomic increment negligible, short enough to balance the load. Every
+     * thread should get at least a few chunks, otherwise nothing can be stolen.
+     */
+    constexpr double        targetChunkDuration = 50.0e-6;
+    constexpr SizeValueType minimumChunkSize = 16;
+    const SizeValueType     maximumChunkSize =
+      std::max(minimumChunkSize, numberOfOwnSamples / (4 * std::max<SizeValueType>(numberOfWorkUnits, 1)));
+
+    SizeValueType chunkSize = maximumChunkSize;
+    if (this->m_SampleSchedulerCostPerSample > 0.0)
+    {
+      chunkSize = static_cast<SizeValueType>(targetChunkDuration / this->m_SampleSchedulerCostPerSample);
+    }
+    this->m_SampleSchedulerChunkSize = std::min(std::max(chunkSize, minimumChunkSize), maximumChunkSize);
+  }
+
+  /** Use the implicit samples, if the sampler generated them. */
+  this->m_ImplicitSamples = nullptr;
+  if (this->m_UseImageSampler && this->GetImageSampler() != nullptr)
+  {
+    this->m_ImplicitSamples = this->GetImageSampler()->GetImplicitSamples();
+  }
+
+  /** Fill the structure-of-arrays copy of the samples, now that we are still single-threaded. */
+  this->m_SampleArrays = nullptr;
+  if (this->m_UseSampleArrays && numberOfSamples > 0 && this->m_ImplicitSamples == nullptr)
+  {
+    this->m_SampleArrays = &this->GetImageSampler()->GetOutputArrays();
+  }
+
+  /** Likewise, update the cache of the fixed image contributions. */
+  this->UpdateFixedImageSampleCache();
+
+  /** Use the shared transform evaluation cache, if it holds the current samples and parameters. */
+  this->m_TransformEvaluationCacheActive = false;
+  if (this->m_TransformEvaluationCache.IsNotNull() && this->m_UseImageSampler && numberOfSamples > 0 &&
+      this->m_ImplicitSamples == nullptr)
+  {
+    const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
+    this->m_TransformEvaluationCacheActive = this->m_TransformEvaluationCache->IsValidFor(
+      sampleContainer, sampleContainer->GetMTime(), sampleContainer->Size(), this->m_Transform->GetParameters());
+  }
+
+  /** Prepare the rejection of samples before they are transformed, see GetNextSampleBatch(). */
+  this->InitializeLinearSampleRejection();
+
+  this->m_SampleSchedulerStartTime = std::chrono::steady_clock::now();
+
+} // end InitializeSampleScheduler()
+
+
+/**
+ * *********************** GetNextSampleRange ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetNextSampleRange(const ThreadIdType threadId,
+                                                                          SizeValueType &    begin,
+                                                                          SizeValueType &    end) const
+{
+  const SizeValueType firstSample = this->m_SampleSchedulerFirstSample;
+  const SizeValueType numberOfSamples = this->m_SampleSchedulerNumberOfSamples;
+
+  if (!this->m_UseDynamicSampleScheduling)
+  {
+    /** Static scheduling: hand out the block of this thread only once. */
+    if (this->m_SampleSchedulerStaticRangeTaken[threadId])
+    {
+      return false;
+    }
+    this->m_SampleSchedulerStaticRangeTaken[threadId] = 1;
+
+    const SizeValueType nrOfSamplesPerThreads = static_cast<SizeValueType>(std::ceil(
+      static_cast<double>(numberOfSamples - firstSample) / static_cast<double>(Self::GetNumberOfWorkUnits())));
+
+    begin = std::min(firstSample + nrOfSamplesPerThreads * threadId, numberOfSamples);
+    end = std::min(firstSample + nrOfSamplesPerThreads * (threadId + 1), numberOfSamples);
+    if (this->m_UseThreadStatistics && threadId < this->m_CurrentThreadStatistics.size())
+    {
+      this->m_CurrentThreadStatistics[threadId].m_NumberOfSamples += end - begin;
+    }
+    return begin < end;
+  }
+
+  /** Dynamic scheduling: claim the next chunk from the shared counter. */
+  const SizeValueType chunkSize = this->m_SampleSchedulerChunkSize;
+  begin = this->m_SampleSchedulerNextSample.fetch_add(chunkSize, std::memory_order_relaxed);
+  if (begin >= numberOfSamples)
+  {
+    return false;
+  }
+  end = std::min(begin + chunkSize, numberOfSamples);
+  if (this->m_UseThreadStatistics && threadId < this->m_CurrentThreadStatistics.size())
+  {
+    this->m_CurrentThreadStatistics[threadId].m_NumberOfSamples += end - begin;
+  }
+  return true;
+
+} // end GetNextSampleRange()
+
+
+/**
+ * *********************** FinalizeSampleScheduler ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::FinalizeSampleScheduler(void) const
+{
+  this->m_TransformEvaluationCacheActive = false;
+
+  /** Add the statistics of the threads in this evaluation to the totals, and to the current block. */
+  if (this->m_UseThreadStatistics && !this->m_CurrentThreadStatistics.empty())
+  {
+    const std::size_t numberOfThreads = this->m_CurrentThreadStatistics.size();
+    if (this->m_ThreadStatistics.size() < numberOfThreads)
+    {
+      this->m_ThreadStatistics.resize(numberOfThreads);
+    }
+
+    double maximumBusyTime = 0.0;
+    double totalBusyTime = 0.0;
+    for (std::size_t i = 0; i < numberOfThreads; ++i)
+    {
+      const ThreadStatisticsType & current = this->m_CurrentThreadStatistics[i];
+      ThreadStatisticsType &       total = this->m_ThreadStatistics[i];
+      total.m_BusyTime += current.m_BusyTime;
+      total.m_NumberOfSamples += current.m_NumberOfSamples;
+      total.m_NumberOfRejectedSamples += current.m_NumberOfRejectedSamples;
+      maximumBusyTime = std::max(maximumBusyTime, current.m_BusyTime);
+      totalBusyTime += current.m_BusyTime;
+    }
+    this->m_CurrentThreadStatistics.clear();
+
+    /** Evaluations that were not timed, e.g. by callbacks of inheriting classes, do not count. */
+    if (totalBusyTime > 0.0)
+    {
+      this->m_ThreadStatisticsBlockMaximumBusyTime += maximumBusyTime;
+      this->m_ThreadStatisticsBlockMeanBusyTime += totalBusyTime / static_cast<double>(numberOfThreads);
+      ++this->m_ThreadStatisticsBlockNumberOfEvaluations;
+      if (this->m_ThreadStatisticsBlockNumberOfEvaluations >= this->m_ThreadStatisticsBlockSize)
+      {
+        this->m_ThreadImbalanceRatios.push_back(this->m_ThreadStatisticsBlockMaximumBusyTime /
+                                                this->m_ThreadStatisticsBlockMeanBusyTime);
+        this->m_ThreadStatisticsBlockMaximumBusyTime = 0.0;
+        this->m_ThreadStatisticsBlockMeanBusyTime = 0.0;
+        this->m_ThreadStatisticsBlockNumberOfEvaluations = 0;
+      }
+    }
+  }
+
+  const SizeValueType numberOfOwnSamples =
+    this->m_SampleSchedulerNumberOfSamples - this->m_SampleSchedulerFirstSample;
+  if (numberOfOwnSamples == 0)
+  {
+    return;
+  }
+
+  /** Estimate the processing time per sample of a single thread. */
+  const double elapsed =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - this->m_SampleSchedulerStartTime).count();
+  const double costPerSample =
+    elapsed * static_cast<double>(Self::GetNumberOfWorkUnits()) / static_cast<double>(numberOfOwnSamples);
+
+  /** Smooth the estimate over the iterations, to avoid erratic chunk sizes. */
+  if (this->m_SampleSchedulerCostPerSample > 0.0)
+  {
+    this->m_SampleSchedulerCostPerSample = 0.75 * this->m_SampleSchedulerCostPerSample + 0.25 * costPerSample;
+  }
+  else
+  {
+    this->m_SampleSchedulerCostPerSample = costPerSample;
+  }
+
+} // end FinalizeSampleScheduler()
+
+
+/**
+ * *********************** UpdateThreadStatistics ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::UpdateThreadStatistics(
+  const ThreadIdType                            threadId,
+  const std::chrono::steady_clock::time_point & startTime,
+  const SizeValueType                           numberOfPixelsCounted) const
+{
+  if (threadId >= this->m_CurrentThreadStatistics.size())
+  {
+    return;
+  }
+
+  ThreadStatisticsType & statistics = this->m_CurrentThreadStatistics[threadId];
+  statistics.m_BusyTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  if (numberOfPixelsCounted <= statistics.m_NumberOfSamples)
+  {
+    statistics.m_NumberOfRejectedSamples = statistics.m_NumberOfSamples - numberOfPixelsCounted;
+  }
+
+} // end UpdateThreadStatistics()
+
+
+/**
+ * *********************** GetThreadImbalanceRatios ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+std::vector<double>
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetThreadImbalanceRatios(void) const
+{
+  std::vector<double> ratios = this->m_ThreadImbalanceRatios;
+  if (this->m_ThreadStatisticsBlockNumberOfEvaluations > 0)
+  {
+    ratios.push_back(this->m_ThreadStatisticsBlockMaximumBusyTime / this->m_ThreadStatisticsBlockMeanBusyTime);
+  }
+  return ratios;
+
+} // end GetThreadImbalanceRatios()
+
+
+/**
+ * *********************** ResetThreadStatistics ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::ResetThreadStatistics(void) const
+{
+  this->m_CurrentThreadStatistics.clear();
+  this->m_ThreadStatistics.clear();
+  this->m_ThreadImbalanceRatios.clear();
+  this->m_ThreadStatisticsBlockMaximumBusyTime = 0.0;
+  this->m_ThreadStatisticsBlockMeanBusyTime = 0.0;
+  this->m_ThreadStatisticsBlockNumberOfEvaluations = 0;
+
+} // end ResetThreadStatistics()
+
+
+/**
+ * ********************* GetNumberOfImageSamples ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+SizeValueType
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::GetNumberOfImageSamples(void) const
+{
+  if (!this->m_UseImageSampler || this->GetImageSampler() == nullptr)
+  {
+    return 0;
+  }
+
+  const ImageSampleLatticeType * implicitSamples = this->GetImageSampler()->GetImplicitSamples();
+  if (implicitSamples != nullptr)
+  {
+    return implicitSamples->Size();
+  }
+  return this->GetImageSampler()->GetOutput()->Size();
+
+} // end GetNumberOfImageSamples()
+
+
+/**
+ * ********************* UpdateFixedImageSampleCache ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::UpdateFixedImageSampleCache(void) const
+{
+  /** Implicit samples are not cached: they are meant to avoid storing anything per sample. */
+  if (!this->m_UseImageSampler || this->GetImageSampler() == nullptr ||
+      this->GetImageSampler()->GetImplicitSamples() != nullptr)
+  {
+    this->m_FixedImageSampleCacheValid = false;
+    this->m_FixedImageSampleCacheContainer = nullptr;
+    return;
+  }
+
+  /** Check if the samples are the same as during the previous call. */
+  const ImageSampleContainerType * sampleContainer = this->GetImageSampler()->GetOutput();
+
+  const bool sameSamples = sampleContainer == this->m_FixedImageSampleCacheContainer &&
+                           sampleContainer->GetUpdateMTime() == this->m_FixedImageSampleCacheUpdateMTime &&
+                           sampleContainer->Size() == this->m_FixedImageSampleCacheSize;
+
+  /** Fill the cache once for every new sampler output; all passes over the same samples reuse it. */
+  if (!sameSamples || !this->m_FixedImageSampleCacheValid)
+  {
+    this->FillFixedImageSampleCache(*sampleContainer);
+    this->m_FixedImageSampleCacheValid = true;
+    this->m_FixedImageSampleCacheContainer = sampleContainer;
+    this->m_FixedImageSampleCacheUpdateMTime = sampleContainer->GetUpdateMTime();
+    this->m_FixedImageSampleCacheSize = sampleContainer->Size();
+  }
+
+} // end UpdateFixedImageSampleCache()
+
+
+/**
+ * ********************* FillFixedImageSampleCache ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::FillFixedImageSampleCache(
+  const ImageSampleContainerType & sampleContainer) const
+{
+  this->m_FixedImageSampleCacheValues.clear();
+  if (this->m_UseFixedImageLimiter)
+  {
+    const SizeValueType numberOfSamples = sampleContainer.Size();
+    this->m_FixedImageSampleCacheValues.resize(numberOfSamples);
+    for (SizeValueType i = 0; i < numberOfSamples; ++i)
+    {
+      this->m_FixedImageSampleCacheValues[i] =
+        this->m_FixedImageLimiter->Evaluate(static_cast<RealType>(sampleContainer.ElementAt(i).m_ImageValue));
+    }
+  }
+
+} // end FillFixedImageSampleCache()
+
+
+/**
+ *********** InitializePerThreadDerivativesThreaderCallback *************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::InitializePerThreadDerivativesThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  /** Normally there is one work unit per derivative, but be robust against a threader with fewer. */
+  const Self & metric = *(temp->st_Metric);
+  for (ThreadIdType i = threadID; i < metric.m_GetValueAndDerivativePerThreadVariablesSize; i += nrOfThreads)
+  {
+    metric.m_GetValueAndDerivativePerThreadVariables[i].st_Derivative.Fill(
+      NumericTraits<DerivativeValueType>::ZeroValue());
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end InitializePerThreadDerivativesThreaderCallback()
+
+
 /**
  *********** AccumulateDerivativesThreaderCallback *************
  */
@@ -924,6 +1920,12 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateDerivativesThre
 
   MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
 
+  if (temp->st_Metric->m_SparseDerivativeAccumulationActive)
+  {
+    Self::AccumulateTouchedDerivativeBlocks(temp, threadID, nrOfThreads);
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  }
+
   const unsigned int numPar = temp->st_Metric->GetNumberOfParameters();
   const unsigned int subSize =
     static_cast<unsigned int>(std::ceil(static_cast<double>(numPar) / static_cast<double>(nrOfThreads)));
@@ -954,6 +1956,62 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateDerivativesThre
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ *********** AccumulateTouchedDerivativeBlocks *************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::AccumulateTouchedDerivativeBlocks(
+  MultiThreaderParameterType * temp,
+  const ThreadIdType           threadID,
+  const ThreadIdType           nrOfThreads)
+{
+  const Self *       metric = temp->st_Metric;
+  const unsigned int numPar = metric->GetNumberOfParameters();
+  const unsigned int blockSize = DerivativeBlockSize;
+  const std::size_t  numberOfBlocks = (numPar + blockSize - 1) / blockSize;
+  const std::size_t  blocksPerThread = (numberOfBlocks + nrOfThreads - 1) / nrOfThreads;
+  const std::size_t  blockBegin = std::min<std::size_t>(threadID * blocksPerThread, numberOfBlocks);
+  const std::size_t  blockEnd = std::min<std::size_t>(blockBegin + blocksPerThread, numberOfBlocks);
+
+  /** This thread accumulates the blocks [ blockBegin, blockEnd [ of the
+   * sub-derivatives. Only the blocks that were touched by a thread are read
+   * and reset; the other blocks of the sub-derivatives are still zero.
+   */
+  const DerivativeValueType zero = NumericTraits<DerivativeValueType>::Zero;
+  const DerivativeValueType normalization = 1.0 / temp->st_NormalizationFactor;
+  for (std::size_t block = blockBegin; block < blockEnd; ++block)
+  {
+    const unsigned int jmin = static_cast<unsigned int>(block * blockSize);
+    const unsigned int jmax = std::min(jmin + blockSize, numPar);
+    std::fill(temp->st_DerivativePointer + jmin, temp->st_DerivativePointer + jmax, zero);
+
+    for (ThreadIdType i = 0; i < nrOfThreads; ++i)
+    {
+      auto & perThreadVariables = metric->m_GetValueAndDerivativePerThreadVariables[i];
+      if (perThreadVariables.st_TouchedDerivativeBlocks[block])
+      {
+        for (unsigned int j = jmin; j < jmax; ++j)
+        {
+          temp->st_DerivativePointer[j] += perThreadVariables.st_Derivative[j];
+
+          /** Reset this variable for the next iteration. */
+          perThreadVariables.st_Derivative[j] = zero;
+        }
+        perThreadVariables.st_TouchedDerivativeBlocks[block] = 0;
+      }
+    }
+
+    for (unsigned int j = jmin; j < jmax; ++j)
+    {
+      temp->st_DerivativePointer[j] *= normalization;
+    }
+  }
+
+} // end AccumulateTouchedDerivativeBlocks()
+
+
 /**
  * *********************** CheckNumberOfSamples ***********************
  */
@@ -972,6 +2030,58 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CheckNumberOfSamples(unsi
 } // end CheckNumberOfSamples()
 
 
+/**
+ * *********************** CropFixedImageRegionToMask ***********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename AdvancedImageToImageMetric<TFixedImage, TMovingImage>::FixedImageRegionType
+AdvancedImageToImageMetric<TFixedImage, TMovingImage>::CropFixedImageRegionToMask(
+  const FixedImageRegionType & region) const
+{
+  FixedImageRegionType croppedRegion = region;
+  if (this->m_FixedImageMask.IsNull())
+  {
+    return croppedRegion;
+  }
+
+  /** Transform the corners of the bounding box of the mask to the fixed image
+   * indices, and take the smallest region of indices that contains them.
+   */
+  typedef typename FixedImageMaskType::BoundingBoxType BoundingBoxType;
+  typedef typename BoundingBoxType::PointsContainer    PointsContainerType;
+  typedef ContinuousIndex<double, FixedImageDimension> ContinuousIndexType;
+  const PointsContainerType * corners = this->m_FixedImageMask->GetMyBoundingBoxInWorldSpace()->GetPoints();
+
+  FixedImageIndexType minIndex, maxIndex;
+  minIndex.Fill(NumericTraits<FixedImageIndexValueType>::max());
+  maxIndex.Fill(NumericTraits<FixedImageIndexValueType>::NonpositiveMin());
+  ContinuousIndexType cindex;
+  for (typename PointsContainerType::ConstIterator it = corners->Begin(); it != corners->End(); ++it)
+  {
+    this->m_FixedImage->TransformPhysicalPointToContinuousIndex(it.Value(), cindex);
+    for (unsigned int i = 0; i < FixedImageDimension; ++i)
+    {
+      minIndex[i] = std::min(minIndex[i], static_cast<FixedImageIndexValueType>(std::floor(cindex[i])));
+      maxIndex[i] = std::max(maxIndex[i], static_cast<FixedImageIndexValueType>(std::ceil(cindex[i])));
+    }
+  }
+
+  typename FixedImageRegionType::SizeType size;
+  for (unsigned int i = 0; i < FixedImageDimension; ++i)
+  {
+    size[i] = static_cast<typename FixedImageRegionType::SizeValueType>(maxIndex[i] - minIndex[i] + 1);
+  }
+
+  if (!croppedRegion.Crop(FixedImageRegionType(minIndex, size)))
+  {
+    itkExceptionMacro(<< "ERROR: the bounding box of the fixed mask lies entirely outside the fixed image region!");
+  }
+  return croppedRegion;
+
+} // end CropFixedImageRegionToMask()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -986,6 +2096,8 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::ostream &
   os << indent << "Variables related to the Sampler: " << std::endl;
   os << indent.GetNextIndent() << "ImageSampler: " << this->m_ImageSampler.GetPointer() << std::endl;
   os << indent.GetNextIndent() << "UseImageSampler: " << this->m_UseImageSampler << std::endl;
+  os << indent.GetNextIndent() << "UseLinearTransformSampleRejection: " << this->m_UseLinearTransformSampleRejection
+     << std::endl;
 
   /** Variables for the Limiters. */
   os << indent << "Variables related to the Limiters: " << std::endl;
@@ -1019,6 +2131,24 @@ AdvancedImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::ostream &
   os << indent.GetNextIndent() << "TransformIsAdvanced: " << this->m_TransformIsAdvanced << std::endl;
   os << indent.GetNextIndent() << "AdvancedTransform: " << this->m_AdvancedTransform.GetPointer() << std::endl;
 
+  /** Variables related to multi-threading. */
+  os << indent << "Variables related to multi-threading: " << std::endl;
+  os << indent.GetNextIndent() << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+  os << indent.GetNextIndent() << "UseSparseDerivativeAccumulation: " << this->m_UseSparseDerivativeAccumulation
+     << std::endl;
+  os << indent.GetNextIndent() << "UseThreadPool: " << this->m_UseThreadPool << std::endl;
+  os << indent.GetNextIndent() << "UseDynamicSampleScheduling: " << this->m_UseDynamicSampleScheduling << std::endl;
+  os << indent.GetNextIndent() << "UseDistributedSampleEvaluation: " << this->m_UseDistributedSampleEvaluation
+     << std::endl;
+  os << indent.GetNextIndent() << "UseDeterministicReduction: " << this->m_UseDeterministicReduction << std::endl;
+  os << indent.GetNextIndent() << "UseThreadStatistics: " << this->m_UseThreadStatistics << std::endl;
+  os << indent.GetNextIndent() << "ThreadStatisticsBlockSize: " << this->m_ThreadStatisticsBlockSize << std::endl;
+  os << indent.GetNextIndent() << "MinimumNumberOfSamplesPerThread: " << this->m_MinimumNumberOfSamplesPerThread
+     << std::endl;
+  os << indent.GetNextIndent() << "UseSampleArrays: " << this->m_UseSampleArrays << std::endl;
+  os << indent.GetNextIndent() << "UseImplicitSamples: " << this->m_UseImplicitSamples << std::endl;
+  os << indent.GetNextIndent() << "UseValueAndGradientImage: " << this->m_UseValueAndGradientImage << std::endl;
+
   /** Other variables. */
   os << indent << "Other variables of the AdvancedImageToImageMetric: " << std::endl;
   os << indent.GetNextIndent() << "RequiredRatioOfValidSamples: " << this->m_RequiredRatioOfValidSamples << std::endl;
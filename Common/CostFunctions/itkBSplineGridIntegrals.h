@@ -0,0 +1,415 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBSplineGridIntegrals_h
+#define itkBSplineGridIntegrals_h
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkCyclicBSplineDeformableTransform.h"
+#include "itkContinuousIndex.h"
+#include "itkImageBase.h"
+
+#include <algorithm> // For min and max.
+#include <cmath>     // For pow and floor.
+#include <vector>
+
+namespace itk
+{
+
+/** \class BSplineGridIntegrals
+ *
+ * \brief The integrals of the products of the B-splines of a control point grid,
+ * for quadratic penalty terms that are computed from the grid.
+ *
+ * For a B-spline transform of order 1, 2 or 3, whose grid axes are parallel to the
+ * axes of the fixed image, the integral over the fixed image domain of the product of
+ * two derivatives of the displacement is a quadratic form in the coefficients. Its
+ * matrix is the Kronecker product of banded matrices, one for each dimension, of which
+ * the entries are the integrals of the products of two shifted 1D B-spline derivatives,
+ * clipped to the fixed image extent and to the valid region of the grid. Initialize()
+ * computes their bands, for the derivative orders up to a given maximum, with an exact
+ * Gauss rule. ApplyBandedMatrix() multiplies the coefficients with one of them, along one
+ * dimension, so that a quadratic form takes a few banded products over the grid.
+ *
+ * \ingroup Metrics
+ */
+
+template <class TScalarType, unsigned int VDimension>
+class ITK_TEMPLATE_EXPORT BSplineGridIntegrals
+{
+public:
+  /** Typedef's. */
+  typedef BSplineGridIntegrals                                            Self;
+  typedef Transform<TScalarType, VDimension, VDimension>                  TransformType;
+  typedef AdvancedBSplineDeformableTransformBase<TScalarType, VDimension> BSplineBaseType;
+  typedef ImageBase<VDimension>                                           ImageBaseType;
+  typedef ImageRegion<VDimension>                                         RegionType;
+  typedef typename BSplineBaseType::SpacingType                           SpacingType;
+  typedef FixedArray<SizeValueType, VDimension>                           GridSizeType;
+
+  itkStaticConstMacro(Dimension, unsigned int, VDimension);
+
+  /** The highest derivative order of which the bands can be computed. */
+  static constexpr unsigned int MaximumDerivativeOrder = 2;
+
+  BSplineGridIntegrals() = default;
+  ~BSplineGridIntegrals() = default;
+
+  /** Compute the bands of the derivative orders up to maximumDerivativeOrder, for the
+   * B-spline transform and the region of the fixed image. Returns false, after which
+   * IsValid() is false, when transform is not a non-cyclic B-spline transform with
+   * minimumSplineOrder <= order <= 3, or when its grid is rotated with respect to the
+   * fixed image, or when the fixed image region does not overlap with the valid region
+   * of the grid.
+   */
+  bool
+  Initialize(const TransformType * transform,
+             const ImageBaseType * fixedImage,
+             const RegionType &    fixedRegion,
+             const unsigned int    minimumSplineOrder,
+             const unsigned int    maximumDerivativeOrder)
+  {
+    this->m_Valid = false;
+
+    /** The cyclic B-spline wraps around in the last dimension, which is not supported. */
+    unsigned int splineOrder = 0;
+    if (dynamic_cast<const AdvancedBSplineDeformableTransform<TScalarType, VDimension, 1> *>(transform) !=
+          nullptr &&
+        dynamic_cast<const CyclicBSplineDeformableTransform<TScalarType, VDimension, 1> *>(transform) == nullptr)
+    {
+      splineOrder = 1;
+    }
+    else if (dynamic_cast<const AdvancedBSplineDeformableTransform<TScalarType, VDimension, 2> *>(transform) !=
+               nullptr &&
+             dynamic_cast<const CyclicBSplineDeformableTransform<TScalarType, VDimension, 2> *>(transform) == nullptr)
+    {
+      splineOrder = 2;
+    }
+    else if (dynamic_cast<const AdvancedBSplineDeformableTransform<TScalarType, VDimension, 3> *>(transform) !=
+               nullptr &&
+             dynamic_cast<const CyclicBSplineDeformableTransform<TScalarType, VDimension, 3> *>(transform) == nullptr)
+    {
+      splineOrder = 3;
+    }
+    if (splineOrder < std::max(minimumSplineOrder, 1u) || maximumDerivativeOrder > MaximumDerivativeOrder ||
+        maximumDerivativeOrder > splineOrder)
+    {
+      return false;
+    }
+
+    const BSplineBaseType *                       bspline = dynamic_cast<const BSplineBaseType *>(transform);
+    const typename BSplineBaseType::RegionType    gridRegion = bspline->GetGridRegion();
+    const typename BSplineBaseType::OriginType    gridOrigin = bspline->GetGridOrigin();
+    const typename BSplineBaseType::DirectionType gridDirection = bspline->GetGridDirection();
+    this->m_GridSpacing = bspline->GetGridSpacing();
+
+    /** The fixed image domain must map to a box of the grid: every grid axis
+     * must be parallel to an axis of the fixed image.
+     */
+    const typename ImageBaseType::DirectionType fixedDirection = fixedImage->GetDirection();
+    for (unsigned int j = 0; j < Dimension; ++j)
+    {
+      unsigned int numberOfParallelAxes = 0;
+      for (unsigned int e = 0; e < Dimension; ++e)
+      {
+        double cosine = 0.0;
+        for (unsigned int m = 0; m < Dimension; ++m)
+        {
+          cosine += gridDirection[m][j] * fixedDirection[m][e];
+        }
+        if (std::abs(cosine) > 1e-6)
+        {
+          ++numberOfParallelAxes;
+        }
+      }
+      if (numberOfParallelAxes != 1)
+      {
+        return false;
+      }
+    }
+
+    /** Compute the box of continuous grid indices that is covered by the voxels
+     * of the fixed image region, and where the transform is valid.
+     */
+    FixedArray<double, VDimension> lower;
+    FixedArray<double, VDimension> upper;
+    lower.Fill(NumericTraits<double>::max());
+    upper.Fill(NumericTraits<double>::NonpositiveMin());
+    for (unsigned int corner = 0; corner < (1u << Dimension); ++corner)
+    {
+      ContinuousIndex<double, VDimension> cindex;
+      for (unsigned int e = 0; e < Dimension; ++e)
+      {
+        cindex[e] = static_cast<double>(fixedRegion.GetIndex()[e]) - 0.5;
+        if (corner & (1u << e))
+        {
+          cindex[e] += static_cast<double>(fixedRegion.GetSize()[e]);
+        }
+      }
+      typename ImageBaseType::PointType point;
+      fixedImage->TransformContinuousIndexToPhysicalPoint(cindex, point);
+
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        double gridIndex = 0.0;
+        for (unsigned int m = 0; m < Dimension; ++m)
+        {
+          gridIndex += gridDirection[m][j] * (point[m] - gridOrigin[m]);
+        }
+        gridIndex /= this->m_GridSpacing[j];
+        lower[j] = std::min(lower[j], gridIndex);
+        upper[j] = std::max(upper[j], gridIndex);
+      }
+    }
+
+    const double halfSupport = (static_cast<double>(splineOrder) - 1.0) / 2.0;
+    this->m_Volume = 1.0;
+    this->m_NumberOfGridPoints = 1;
+    for (unsigned int j = 0; j < Dimension; ++j)
+    {
+      const double first = static_cast<double>(gridRegion.GetIndex()[j]);
+      const double last = first + static_cast<double>(gridRegion.GetSize()[j]) - 1.0;
+      lower[j] = std::max(lower[j], first + halfSupport);
+      upper[j] = std::min(upper[j], last - halfSupport);
+      this->m_Volume *= upper[j] - lower[j];
+      if (!(upper[j] > lower[j]))
+      {
+        return false;
+      }
+
+      this->m_GridSize[j] = gridRegion.GetSize()[j];
+      this->m_NumberOfGridPoints *= this->m_GridSize[j];
+    }
+
+    /** Compute the bands of the matrices of the derivatives of the requested orders. */
+    const unsigned int bandSize = 2 * splineOrder + 1;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const SizeValueType size = this->m_GridSize[d];
+      const double        first = static_cast<double>(gridRegion.GetIndex()[d]);
+      for (unsigned int a = 0; a <= MaximumDerivativeOrder; ++a)
+      {
+        std::vector<double> & band = this->m_Bands[a][d];
+        if (a > maximumDerivativeOrder)
+        {
+          band.clear();
+          continue;
+        }
+        band.assign(size * bandSize, 0.0);
+        for (SizeValueType r = 0; r < size; ++r)
+        {
+          for (unsigned int o = 0; o < bandSize; ++o)
+          {
+            const SizeValueType q = r + o;
+            if (q < splineOrder || q - splineOrder >= size)
+            {
+              continue;
+            }
+            band[r * bandSize + o] = IntegrateBSplineProduct(splineOrder,
+                                                             a,
+                                                             first + static_cast<double>(r),
+                                                             first + static_cast<double>(q - splineOrder),
+                                                             lower[d],
+                                                             upper[d]);
+          }
+        }
+      }
+    }
+
+    this->m_SplineOrder = splineOrder;
+    this->m_Valid = true;
+    return true;
+  }
+
+
+  /** Returns whether the last Initialize() succeeded. */
+  bool
+  IsValid(void) const
+  {
+    return this->m_Valid;
+  }
+
+
+  /** The order of the B-splines. */
+  unsigned int
+  GetSplineOrder(void) const
+  {
+    return this->m_SplineOrder;
+  }
+
+
+  /** The number of control points of the grid, which is the number of parameters per dimension. */
+  SizeValueType
+  GetNumberOfGridPoints(void) const
+  {
+    return this->m_NumberOfGridPoints;
+  }
+
+
+  /** The spacing of the grid. */
+  const SpacingType &
+  GetGridSpacing(void) const
+  {
+    return this->m_GridSpacing;
+  }
+
+
+  /** The volume of the integration domain, in continuous grid indices. Divide the
+   * quadratic forms by it to obtain the mean over the domain.
+   */
+  double
+  GetVolume(void) const
+  {
+    return this->m_Volume;
+  }
+
+
+  /** Multiply the coefficients along dimension d with the banded matrix of the
+   * derivatives of order a. The input and output have one value per control point.
+   */
+  void
+  ApplyBandedMatrix(const unsigned int a, const unsigned int d, const double * input, double * output) const
+  {
+    const std::vector<double> & band = this->m_Bands[a][d];
+    const SizeValueType         radius = this->m_SplineOrder;
+    const SizeValueType         bandSize = 2 * radius + 1;
+    const SizeValueType         size = this->m_GridSize[d];
+    SizeValueType               stride = 1;
+    for (unsigned int e = 0; e < d; ++e)
+    {
+      stride *= this->m_GridSize[e];
+    }
+
+    /** Loop over all lines of control points along dimension d. */
+    for (SizeValueType outer = 0; outer < this->m_NumberOfGridPoints; outer += size * stride)
+    {
+      for (SizeValueType inner = 0; inner < stride; ++inner)
+      {
+        const double * lineInput = input + outer + inner;
+        double *       lineOutput = output + outer + inner;
+        for (SizeValueType r = 0; r < size; ++r)
+        {
+          /** The row of the matrix, such that row[q] is the entry of column q. */
+          const double *      row = band.data() + r * bandSize + radius - r;
+          const SizeValueType qBegin = r > radius ? r - radius : 0;
+          const SizeValueType qEnd = std::min(r + radius + 1, size);
+
+          double sum = 0.0;
+          for (SizeValueType q = qBegin; q < qEnd; ++q)
+          {
+            sum += row[q] * lineInput[q * stride];
+          }
+          lineOutput[r * stride] = sum;
+        }
+      }
+    }
+  }
+
+
+  /** The derivative of order a of the centred B-spline of order n at u. */
+  static double
+  EvaluateBSplineDerivative(const unsigned int n, const unsigned int a, const double u)
+  {
+    /** Use the truncated power representation:
+     * beta_n^(a)(u) = sum_k (-1)^k binom(n+1, k) (u + (n+1)/2 - k)_+^(n-a) / (n-a)!
+     */
+    double       sum = 0.0;
+    double       coefficient = 1.0;
+    double       factorial = 1.0;
+    const double shift = 0.5 * static_cast<double>(n + 1);
+    for (unsigned int m = 2; m <= n - a; ++m)
+    {
+      factorial *= static_cast<double>(m);
+    }
+    for (unsigned int k = 0; k <= n + 1; ++k)
+    {
+      const double x = u + shift - static_cast<double>(k);
+      if (x > 0.0)
+      {
+        sum += coefficient * std::pow(x, static_cast<double>(n - a));
+      }
+      coefficient *= -static_cast<double>(n + 1 - k) / static_cast<double>(k + 1);
+    }
+    return sum / factorial;
+  }
+
+
+  /** The integral of the product of the derivatives of order a of two
+   * shifted B-splines of order n, centred at p and q, over [t0, t1].
+   */
+  static double
+  IntegrateBSplineProduct(const unsigned int n,
+                          const unsigned int a,
+                          const double       p,
+                          const double       q,
+                          const double       t0,
+                          const double       t1)
+  {
+    /** The four point Gauss-Legendre rule is exact for the polynomial pieces
+     * of the product, up to order n = 3.
+     */
+    const double nodes[4] = { -0.8611363115940526, -0.3399810435848563, 0.3399810435848563, 0.8611363115940526 };
+    const double weights[4] = { 0.3478548451374538, 0.6521451548625461, 0.6521451548625461, 0.3478548451374538 };
+
+    /** Restrict the interval to the common support of the two B-splines. */
+    const double halfSupport = 0.5 * static_cast<double>(n + 1);
+    const double begin = std::max(t0, std::max(p, q) - halfSupport);
+    const double end = std::min(t1, std::min(p, q) + halfSupport);
+
+    /** Integrate over the pieces between the knots, which lie at the integers
+     * for odd n, and halfway for even n.
+     */
+    const double phase = halfSupport - std::floor(halfSupport);
+    double       integral = 0.0;
+    for (double knot = std::floor(begin - phase) + phase; knot < end; knot += 1.0)
+    {
+      const double pieceBegin = std::max(knot, begin);
+      const double pieceEnd = std::min(knot + 1.0, end);
+      if (pieceEnd <= pieceBegin)
+      {
+        continue;
+      }
+
+      const double halfLength = 0.5 * (pieceEnd - pieceBegin);
+      const double centre = 0.5 * (pieceEnd + pieceBegin);
+      for (unsigned int g = 0; g < 4; ++g)
+      {
+        const double t = centre + halfLength * nodes[g];
+        integral +=
+          halfLength * weights[g] * EvaluateBSplineDerivative(n, a, t - p) * EvaluateBSplineDerivative(n, a, t - q);
+      }
+    }
+    return integral;
+  }
+
+
+private:
+  bool          m_Valid{ false };
+  unsigned int  m_SplineOrder{ 0 };
+  GridSizeType  m_GridSize;
+  SizeValueType m_NumberOfGridPoints{ 0 };
+  SpacingType   m_GridSpacing;
+  double        m_Volume{ 0.0 };
+
+  /** The band of the matrix of the derivatives of order a in dimension d is stored
+   * row by row in m_Bands[a][d], with 2n+1 entries per control point. */
+  std::vector<double> m_Bands[MaximumDerivativeOrder + 1][VDimension];
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkBSplineGridIntegrals_h
@@ -0,0 +1,179 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageExtremaCache_h
+#define itkImageExtremaCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkComputeImageExtremaFilter.h"
+
+#include <mutex>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageExtremaCache
+ *
+ * \brief Stores the minimum and maximum of images, so that they are computed only once
+ * for all metrics that use them.
+ *
+ * Several metrics compute the extrema of the fixed and the moving image, inside their masks,
+ * by a ComputeImageExtremaFilter: for the limiters, for the normalization of the mean squares,
+ * and so on. Every computation is a pass over the image. When these metrics are given one
+ * ImageExtremaCache, the extrema of an image, region and mask are computed by the first metric
+ * that asks for them, and the other metrics read them from the cache.
+ *
+ * The extrema are keyed on the image, the region and the mask, and on the modification times of
+ * the image and the mask, so the image of a new resolution level, or an image that has been
+ * updated, is computed again. GetExtrema() is thread-safe.
+ *
+ * \ingroup Metrics
+ */
+
+class ImageExtremaCache : public Object
+{
+public:
+  /** Standard ITK typedefs. */
+  typedef ImageExtremaCache        Self;
+  typedef Object                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageExtremaCache, Object);
+
+  /** Get the minimum and maximum of the image inside the region and, if it is not null,
+   * the mask. They are computed by a ComputeImageExtremaFilter, if they are not cached yet.
+   */
+  template <class TImage>
+  void
+  GetExtrema(const TImage *                                image,
+             const typename TImage::RegionType &           region,
+             const SpatialObject<TImage::ImageDimension> * mask,
+             typename TImage::PixelType &                  minimum,
+             typename TImage::PixelType &                  maximum)
+  {
+    typedef ComputeImageExtremaFilter<TImage>                 ComputeImageExtremaFilterType;
+    typedef typename ComputeImageExtremaFilterType::PixelType PixelType;
+
+    Entry key;
+    key.Image = image;
+    key.ImageMTime = image->GetMTime();
+    key.Mask = mask;
+    key.MaskMTime = (mask != nullptr) ? mask->GetMTime() : 0;
+    for (unsigned int i = 0; i < TImage::ImageDimension; ++i)
+    {
+      key.Region.push_back(region.GetIndex(i));
+      key.Region.push_back(static_cast<OffsetValueType>(region.GetSize(i)));
+    }
+
+    const std::lock_guard<std::mutex> lock(this->m_Mutex);
+    for (const auto & entry : this->m_Entries)
+    {
+      if (entry.HasKeyOf(key))
+      {
+        minimum = static_cast<PixelType>(entry.Minimum);
+        maximum = static_cast<PixelType>(entry.Maximum);
+        return;
+      }
+    }
+
+    const auto computeImageExtrema = ComputeImageExtremaFilterType::New();
+    computeImageExtrema->SetInput(image);
+    computeImageExtrema->SetImageRegion(region);
+    if (mask != nullptr)
+    {
+      computeImageExtrema->SetUseMask(true);
+
+      typedef typename ComputeImageExtremaFilterType::ImageSpatialMaskType ImageSpatialMaskType;
+      const auto * spatialMask = dynamic_cast<const ImageSpatialMaskType *>(mask);
+      if (spatialMask)
+      {
+        computeImageExtrema->SetImageSpatialMask(spatialMask);
+      }
+      else
+      {
+        computeImageExtrema->SetImageMask(mask);
+      }
+    }
+    computeImageExtrema->Update();
+
+    minimum = computeImageExtrema->GetMinimum();
+    maximum = computeImageExtrema->GetMaximum();
+
+    /** Replace the extrema of an older version of the image, which are not needed anymore. */
+    key.Minimum = static_cast<double>(minimum);
+    key.Maximum = static_cast<double>(maximum);
+    for (auto & entry : this->m_Entries)
+    {
+      if (entry.Image == key.Image && entry.ImageMTime != key.ImageMTime)
+      {
+        entry = key;
+        return;
+      }
+    }
+    this->m_Entries.push_back(key);
+  }
+
+  /** Remove all cached extrema. */
+  void
+  Clear(void)
+  {
+    const std::lock_guard<std::mutex> lock(this->m_Mutex);
+    this->m_Entries.clear();
+  }
+
+protected:
+  ImageExtremaCache() = default;
+  ~ImageExtremaCache() override = default;
+
+private:
+  ImageExtremaCache(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** The extrema of an image, region and mask. */
+  struct Entry
+  {
+    const void *                 Image{ nullptr };
+    ModifiedTimeType             ImageMTime{ 0 };
+    const void *                 Mask{ nullptr };
+    ModifiedTimeType             MaskMTime{ 0 };
+    std::vector<OffsetValueType> Region;
+    double                       Minimum{ 0.0 };
+    double                       Maximum{ 0.0 };
+
+    bool
+    HasKeyOf(const Entry & other) const
+    {
+      return Image == other.Image && ImageMTime == other.ImageMTime && Mask == other.Mask &&
+             MaskMTime == other.MaskMTime && Region == other.Region;
+    }
+  };
+
+  std::vector<Entry> m_Entries;
+  std::mutex         m_Mutex;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkImageExtremaCache_h
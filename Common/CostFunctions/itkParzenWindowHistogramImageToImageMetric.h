@@ -178,6 +178,14 @@ public:
   itkSetClampMacro(NumberOfMovingHistogramBins, unsigned long, 4, NumericTraits<unsigned long>::max());
   itkGetMacro(NumberOfMovingHistogramBins, unsigned long);
 
+  /** Change the numbers of histogram bins after Initialize(), between two evaluations of
+   * the metric, for example to increase them as the optimization proceeds. Recomputes the
+   * bin sizes and reallocates the histograms, and refills the fixed image sample cache
+   * at the next evaluation. The kernels are not changed.
+   */
+  virtual void
+  UpdateNumberOfHistogramBins(unsigned long numberOfFixedHistogramBins, unsigned long numberOfMovingHistogramBins);
+
   /** The B-spline order of the fixed Parzen window; default: 0 */
   itkSetClampMacro(FixedKernelBSplineOrder, unsigned int, 0, 3);
   itkGetConstMacro(FixedKernelBSplineOrder, unsigned int);
@@ -193,6 +201,20 @@ public:
   itkGetConstReferenceMacro(UseExplicitPDFDerivatives, bool);
   itkBooleanMacro(UseExplicitPDFDerivatives);
 
+  /** The maximum amount of memory, in bytes, for the explicit PDF derivatives,
+   * which take NumberOfParameters * NumberOfMovingHistogramBins *
+   * NumberOfFixedHistogramBins floats. When UseExplicitPDFDerivatives is on, but
+   * they would take more, subclasses that have a low memory variant of the
+   * derivative use that instead. 0 means no limit. Default: 0.
+   */
+  itkSetMacro(MaximumJointPDFDerivativesMemory, SizeValueType);
+  itkGetConstMacro(MaximumJointPDFDerivativesMemory, SizeValueType);
+
+  /** Whether the explicit PDF derivatives are actually computed, as decided by the
+   * last Initialize() from UseExplicitPDFDerivatives and MaximumJointPDFDerivativesMemory.
+   */
+  itkGetConstMacro(ComputeExplicitPDFDerivatives, bool);
+
   /** Whether you plan to call the GetDerivative/GetValueAndDerivative method or not.
    * This option should be set before calling Initialize(); Default: false.
    */
@@ -212,6 +234,20 @@ public:
   itkSetMacro(FiniteDifferencePerturbation, double);
   itkGetConstMacro(FiniteDifferencePerturbation, double);
 
+  /** Setting whether the moving image Parzen values and their derivatives are
+   * interpolated linearly from tabulated kernels, instead of evaluating the kernel
+   * functions for every sample. The tables hold ParzenWindowLookUpTableSize + 1
+   * positions within a bin, so the relative error is in the order of 1e-7.
+   * Only used for a MovingKernelBSplineOrder of 2 or 3, which are smooth within
+   * a bin. Takes effect at the next Initialize(). Default: false.
+   */
+  itkSetMacro(UseParzenWindowLookUpTables, bool);
+  itkGetConstMacro(UseParzenWindowLookUpTables, bool);
+  itkBooleanMacro(UseParzenWindowLookUpTables);
+
+  /** The number of intervals within a bin of the tabulated kernels. */
+  static constexpr unsigned int ParzenWindowLookUpTableSize = 1024;
+
 protected:
   /** The constructor. */
   ParzenWindowHistogramImageToImageMetric();
@@ -294,6 +330,26 @@ protected:
   KernelFunctionPointer m_MovingKernel;
   KernelFunctionPointer m_DerivativeMovingKernel;
 
+  /** The tabulated moving kernels, see SetUseParzenWindowLookUpTables(). Row k holds
+   * the Parzen values at a fraction k / ParzenWindowLookUpTableSize within a bin.
+   * Empty when the kernels are evaluated directly.
+   */
+  std::vector<PDFValueType> m_MovingKernelLookUpTable;
+  std::vector<PDFValueType> m_DerivativeMovingKernelLookUpTable;
+
+  /** Whether the subclass can compute the derivative without the explicit PDF
+   * derivatives, see SetMaximumJointPDFDerivativesMemory(). Default: false.
+   */
+  bool m_LowMemoryDerivativeSupported;
+
+  /** The cached fixed Parzen window contributions of the samples, only valid when
+   * m_FixedImageSampleCacheValid is true. For sample i, the lowest affected fixed
+   * histogram bin is m_FixedParzenWindowIndexCache[i], and its Parzen values start
+   * at m_FixedParzenValuesCache[i * m_JointPDFWindow.GetSize()[1]].
+   */
+  mutable std::vector<OffsetValueType> m_FixedParzenWindowIndexCache;
+  mutable std::vector<PDFValueType>    m_FixedParzenValuesCache;
+
   /** Threading related parameters. */
   mutable std::vector<JointPDFPointer> m_ThreaderJointPDFs;
 
@@ -353,6 +409,22 @@ protected:
                        const KernelFunctionType * kernel,
                        ParzenValueContainerType & parzenValues) const;
 
+  /** The largest Parzen window, for a third order B-spline kernel. */
+  static constexpr unsigned int MaximumParzenWindowSize = 4;
+
+  /** Compute the moving image Parzen values, or their derivatives, like EvaluateParzenValues(),
+   * into an array of at least MaximumParzenWindowSize values. They are interpolated from the
+   * tabulated kernel when UseParzenWindowLookUpTables is on, and evaluated otherwise.
+   */
+  void
+  EvaluateMovingParzenValues(double          parzenWindowTerm,
+                             OffsetValueType parzenWindowIndex,
+                             PDFValueType *  parzenValues) const;
+  void
+  EvaluateDerivativeMovingParzenValues(double          parzenWindowTerm,
+                                       OffsetValueType parzenWindowIndex,
+                                       PDFValueType *  parzenValues) const;
+
   /** Update the joint PDF with a pixel pair; on demand also updates the
    * pdf derivatives (if the Jacobian pointers are nonzero).
    */
@@ -363,6 +435,23 @@ protected:
                                const NonZeroJacobianIndicesType * nzji,
                                JointPDFType *                     jointPDF) const;
 
+  /** Version of UpdateJointPDFAndDerivatives() that gets the lowest affected fixed
+   * histogram bin and the fixed Parzen values, instead of the fixed image value.
+   */
+  void
+  UpdateJointPDFAndDerivativesWithFixedParzenValues(const OffsetValueType              fixedImageParzenWindowIndex,
+                                                    const PDFValueType *               fixedParzenValues,
+                                                    const RealType &                   movingImageValue,
+                                                    const DerivativeType *             imageJacobian,
+                                                    const NonZeroJacobianIndicesType * nzji,
+                                                    JointPDFType *                     jointPDF) const;
+
+  /** Fill the cache of the fixed image contributions of the samples: the limited
+   * fixed image values, and the fixed Parzen window indices and values.
+   */
+  void
+  FillFixedImageSampleCache(const ImageSampleContainerType & sampleContainer) const override;
+
   /** Update the joint PDF and the incremental pdfs.
    * The input is a pixel pair (fixed, moving, moving mask) and
    * a set of moving image/mask values when using mu+delta*e_k, for
@@ -514,6 +603,24 @@ private:
   bool          m_UseExplicitPDFDerivatives;
   bool          m_UseFiniteDifferenceDerivative;
   double        m_FiniteDifferencePerturbation;
+  bool          m_UseParzenWindowLookUpTables;
+  SizeValueType m_MaximumJointPDFDerivativesMemory;
+  bool          m_ComputeExplicitPDFDerivatives;
+
+  /** Interpolate Parzen values from a tabulated kernel. */
+  void
+  InterpolateParzenValues(double                            parzenWindowTerm,
+                          OffsetValueType                   parzenWindowIndex,
+                          double                            parzenTermToIndexOffset,
+                          const std::vector<PDFValueType> & lookUpTable,
+                          PDFValueType *                    parzenValues) const;
+
+  /** Fill a table of Parzen values of kernel, for parzenWindowSize bins. */
+  static void
+  FillParzenWindowLookUpTable(const KernelFunctionType *  kernel,
+                              double                      parzenTermToIndexOffset,
+                              unsigned int                parzenWindowSize,
+                              std::vector<PDFValueType> & lookUpTable);
 };
 
 } // end namespace itk
@@ -26,6 +26,8 @@
 #include "itkImageScanlineIterator.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -61,12 +63,19 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ParzenWindow
   this->m_UseDerivative = false;
   this->m_UseFiniteDifferenceDerivative = false;
   this->m_FiniteDifferencePerturbation = 1.0;
+  this->m_UseParzenWindowLookUpTables = false;
 
   this->SetUseImageSampler(true);
   this->SetUseFixedImageLimiter(true);
   this->SetUseMovingImageLimiter(true);
 
   this->m_UseExplicitPDFDerivatives = true;
+  this->m_MaximumJointPDFDerivativesMemory = 0;
+  this->m_ComputeExplicitPDFDerivatives = true;
+  this->m_LowMemoryDerivativeSupported = false;
+
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters */
   this->m_ParzenWindowHistogramThreaderParameters.m_Metric = this;
@@ -232,7 +241,10 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeHi
    * than the fixed B-spline kernel order and it is faster to iterate along
    * the first dimension.
    */
-  this->m_JointPDF = JointPDFType::New();
+  if (this->m_JointPDF.IsNull())
+  {
+    this->m_JointPDF = JointPDFType::New();
+  }
   JointPDFRegionType jointPDFRegion;
   JointPDFIndexType  jointPDFIndex;
   JointPDFSizeType   jointPDFSize;
@@ -244,6 +256,19 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeHi
   this->m_JointPDF->SetRegions(jointPDFRegion);
   this->m_JointPDF->Allocate();
 
+  /** Decide whether the explicit PDF derivatives fit in the memory budget. */
+  const double jointPDFDerivativesMemory = static_cast<double>(this->GetNumberOfParameters()) *
+                                           static_cast<double>(this->m_NumberOfMovingHistogramBins) *
+                                           static_cast<double>(this->m_NumberOfFixedHistogramBins) *
+                                           static_cast<double>(sizeof(PDFDerivativeValueType));
+  this->m_ComputeExplicitPDFDerivatives = this->m_UseExplicitPDFDerivatives;
+  if (this->m_ComputeExplicitPDFDerivatives && this->m_LowMemoryDerivativeSupported &&
+      this->m_MaximumJointPDFDerivativesMemory > 0 &&
+      jointPDFDerivativesMemory > static_cast<double>(this->m_MaximumJointPDFDerivativesMemory))
+  {
+    this->m_ComputeExplicitPDFDerivatives = false;
+  }
+
   if (this->GetUseDerivative())
   {
     /** For the derivatives of the joint PDF define a region starting from {0,0,0}
@@ -314,7 +339,7 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeHi
     } // end if this->GetUseFiniteDifferenceDerivative()
     else
     {
-      if (this->m_UseExplicitPDFDerivatives)
+      if (this->m_ComputeExplicitPDFDerivatives)
       {
         this->m_IncrementalJointPDFRight = nullptr;
         this->m_IncrementalJointPDFLeft = nullptr;
@@ -348,6 +373,35 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeHi
 } // end InitializeHistograms()
 
 
+/**
+ * ****************** UpdateNumberOfHistogramBins *****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateNumberOfHistogramBins(
+  unsigned long numberOfFixedHistogramBins,
+  unsigned long numberOfMovingHistogramBins)
+{
+  const unsigned long previousNumberOfFixedHistogramBins = this->m_NumberOfFixedHistogramBins;
+  const unsigned long previousNumberOfMovingHistogramBins = this->m_NumberOfMovingHistogramBins;
+  this->SetNumberOfFixedHistogramBins(numberOfFixedHistogramBins);
+  this->SetNumberOfMovingHistogramBins(numberOfMovingHistogramBins);
+  if (this->m_NumberOfFixedHistogramBins == previousNumberOfFixedHistogramBins &&
+      this->m_NumberOfMovingHistogramBins == previousNumberOfMovingHistogramBins)
+  {
+    return;
+  }
+
+  /** The bin sizes and the histograms depend on the numbers of bins, and so
+   * do the cached fixed Parzen window indices.
+   */
+  this->InitializeHistograms();
+  this->m_FixedImageSampleCacheValid = false;
+
+} // end UpdateNumberOfHistogramBins()
+
+
 /**
  * ****************** InitializeKernels *****************************
  */
@@ -424,9 +478,55 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InitializeKe
   this->m_FixedParzenTermToIndexOffset = 0.5 - static_cast<double>(this->m_FixedKernelBSplineOrder) / 2.0;
   this->m_MovingParzenTermToIndexOffset = 0.5 - static_cast<double>(this->m_MovingKernelBSplineOrder) / 2.0;
 
+  /** Tabulate the moving kernels. The zero and first order kernels are not smooth
+   * within a bin, so interpolating them would be wrong.
+   */
+  if (this->m_UseParzenWindowLookUpTables && this->m_MovingKernelBSplineOrder >= 2)
+  {
+    FillParzenWindowLookUpTable(this->m_MovingKernel,
+                                this->m_MovingParzenTermToIndexOffset,
+                                parzenWindowSize[0],
+                                this->m_MovingKernelLookUpTable);
+    FillParzenWindowLookUpTable(this->m_DerivativeMovingKernel,
+                                this->m_MovingParzenTermToIndexOffset,
+                                parzenWindowSize[0],
+                                this->m_DerivativeMovingKernelLookUpTable);
+  }
+  else
+  {
+    this->m_MovingKernelLookUpTable.clear();
+    this->m_DerivativeMovingKernelLookUpTable.clear();
+  }
+
 } // end InitializeKernels()
 
 
+/**
+ * ****************** FillParzenWindowLookUpTable *****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::FillParzenWindowLookUpTable(
+  const KernelFunctionType *  kernel,
+  double                      parzenTermToIndexOffset,
+  unsigned int                parzenWindowSize,
+  std::vector<PDFValueType> & lookUpTable)
+{
+  /** Row k holds the Parzen values of a term at a fraction k / R above the lowest
+   * affected bin, so that kernel->Evaluate( index - term ) = Evaluate( offset - k / R ).
+   */
+  const unsigned int tableSize = ParzenWindowLookUpTableSize;
+  lookUpTable.resize((tableSize + 1) * parzenWindowSize);
+  for (unsigned int k = 0; k <= tableSize; ++k)
+  {
+    const double fraction = static_cast<double>(k) / static_cast<double>(tableSize);
+    kernel->Evaluate(parzenTermToIndexOffset - fraction, lookUpTable.data() + k * parzenWindowSize);
+  }
+
+} // end FillParzenWindowLookUpTable()
+
+
 /**
  * ********************* InitializeThreadingParameters ****************************
  */
@@ -544,6 +644,146 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::EvaluateParz
 } // end EvaluateParzenValues()
 
 
+/**
+ * ********************** EvaluateMovingParzenValues ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::EvaluateMovingParzenValues(
+  double          parzenWindowTerm,
+  OffsetValueType parzenWindowIndex,
+  PDFValueType *  parzenValues) const
+{
+  if (this->m_MovingKernelLookUpTable.empty())
+  {
+    this->m_MovingKernel->Evaluate(static_cast<double>(parzenWindowIndex) - parzenWindowTerm, parzenValues);
+  }
+  else
+  {
+    this->InterpolateParzenValues(parzenWindowTerm,
+                                  parzenWindowIndex,
+                                  this->m_MovingParzenTermToIndexOffset,
+                                  this->m_MovingKernelLookUpTable,
+                                  parzenValues);
+  }
+} // end EvaluateMovingParzenValues()
+
+
+/**
+ * ********************** EvaluateDerivativeMovingParzenValues ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::EvaluateDerivativeMovingParzenValues(
+  double          parzenWindowTerm,
+  OffsetValueType parzenWindowIndex,
+  PDFValueType *  parzenValues) const
+{
+  if (this->m_DerivativeMovingKernelLookUpTable.empty())
+  {
+    this->m_DerivativeMovingKernel->Evaluate(static_cast<double>(parzenWindowIndex) - parzenWindowTerm,
+                                             parzenValues);
+  }
+  else
+  {
+    this->InterpolateParzenValues(parzenWindowTerm,
+                                  parzenWindowIndex,
+                                  this->m_MovingParzenTermToIndexOffset,
+                                  this->m_DerivativeMovingKernelLookUpTable,
+                                  parzenValues);
+  }
+} // end EvaluateDerivativeMovingParzenValues()
+
+
+/**
+ * ********************** InterpolateParzenValues ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::InterpolateParzenValues(
+  double                            parzenWindowTerm,
+  OffsetValueType                   parzenWindowIndex,
+  double                            parzenTermToIndexOffset,
+  const std::vector<PDFValueType> & lookUpTable,
+  PDFValueType *                    parzenValues) const
+{
+  const unsigned int tableSize = ParzenWindowLookUpTableSize;
+  const unsigned int parzenWindowSize = lookUpTable.size() / (tableSize + 1);
+
+  /** The fraction within the lowest affected bin, in [0,1). Clamp it, to be robust
+   * against rounding errors of the floor() that determined the index.
+   */
+  const double position =
+    (parzenWindowTerm + parzenTermToIndexOffset - static_cast<double>(parzenWindowIndex)) * tableSize;
+  unsigned int row = 0;
+  if (position > 0.0)
+  {
+    row = static_cast<unsigned int>(position);
+    if (row > tableSize - 1)
+    {
+      row = tableSize - 1;
+    }
+  }
+  const double weight = position - static_cast<double>(row);
+
+  /** Linearly interpolate between two consecutive rows. */
+  const PDFValueType * lower = lookUpTable.data() + row * parzenWindowSize;
+  const PDFValueType * upper = lower + parzenWindowSize;
+  for (unsigned int i = 0; i < parzenWindowSize; ++i)
+  {
+    parzenValues[i] = lower[i] + weight * (upper[i] - lower[i]);
+  }
+
+} // end InterpolateParzenValues()
+
+
+/**
+ * ********************** FillFixedImageSampleCache ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::FillFixedImageSampleCache(
+  const ImageSampleContainerType & sampleContainer) const
+{
+  /** Store the limited fixed image values. */
+  Superclass::FillFixedImageSampleCache(sampleContainer);
+
+  /** Store the fixed Parzen window index and values of each sample. */
+  const SizeValueType      numberOfSamples = sampleContainer.Size();
+  const unsigned int       numberOfFixedParzenValues = this->m_JointPDFWindow.GetSize()[1];
+  ParzenValueContainerType fixedParzenValues(numberOfFixedParzenValues);
+  this->m_FixedParzenWindowIndexCache.resize(numberOfSamples);
+  this->m_FixedParzenValuesCache.resize(numberOfSamples * numberOfFixedParzenValues);
+  for (SizeValueType i = 0; i < numberOfSamples; ++i)
+  {
+    const RealType fixedImageValue = this->m_UseFixedImageLimiter
+                                       ? this->m_FixedImageSampleCacheValues[i]
+                                       : static_cast<RealType>(sampleContainer.ElementAt(i).m_ImageValue);
+
+    /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]). */
+    const double fixedImageParzenWindowTerm =
+      fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+
+    /** The lowest bin number affected by this pixel: */
+    const OffsetValueType fixedImageParzenWindowIndex =
+      static_cast<OffsetValueType>(std::floor(fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset));
+
+    this->EvaluateParzenValues(
+      fixedImageParzenWindowTerm, fixedImageParzenWindowIndex, this->m_FixedKernel, fixedParzenValues);
+
+    this->m_FixedParzenWindowIndexCache[i] = fixedImageParzenWindowIndex;
+    std::copy_n(fixedParzenValues.data_block(),
+                numberOfFixedParzenValues,
+                this->m_FixedParzenValuesCache.begin() + i * numberOfFixedParzenValues);
+  }
+
+} // end FillFixedImageSampleCache()
+
+
 /**
  * ********************** UpdateJointPDFAndDerivatives ***************
  */
@@ -557,83 +797,103 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointP
   const NonZeroJacobianIndicesType * nzji,
   JointPDFType *                     jointPDF) const
 {
-  typedef ImageScanlineIterator<JointPDFType> PDFIteratorType;
-
-  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]). */
   const double fixedImageParzenWindowTerm =
     fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
-  const double movingImageParzenWindowTerm =
-    movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
-  /** The lowest bin numbers affected by this pixel: */
+  /** The lowest bin number affected by this pixel: */
   const OffsetValueType fixedImageParzenWindowIndex =
     static_cast<OffsetValueType>(std::floor(fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset));
+
+  /** The fixed Parzen values, on the stack to avoid an allocation per sample. */
+  PDFValueType fixedParzenValues[MaximumParzenWindowSize];
+  this->m_FixedKernel->Evaluate(static_cast<double>(fixedImageParzenWindowIndex) - fixedImageParzenWindowTerm,
+                                fixedParzenValues);
+
+  this->UpdateJointPDFAndDerivativesWithFixedParzenValues(
+    fixedImageParzenWindowIndex, fixedParzenValues, movingImageValue, imageJacobian, nzji, jointPDF);
+
+} // end UpdateJointPDFAndDerivatives()
+
+
+/**
+ * ************** UpdateJointPDFAndDerivativesWithFixedParzenValues ***************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::UpdateJointPDFAndDerivativesWithFixedParzenValues(
+  const OffsetValueType              fixedImageParzenWindowIndex,
+  const PDFValueType *               fixedParzenValues,
+  const RealType &                   movingImageValue,
+  const DerivativeType *             imageJacobian,
+  const NonZeroJacobianIndicesType * nzji,
+  JointPDFType *                     jointPDF) const
+{
+  /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]). */
+  const double movingImageParzenWindowTerm =
+    movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin number affected by this pixel: */
   const OffsetValueType movingImageParzenWindowIndex =
     static_cast<OffsetValueType>(std::floor(movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset));
 
-  /** The Parzen values. */
-  ParzenValueContainerType fixedParzenValues(this->m_JointPDFWindow.GetSize()[1]);
-  ParzenValueContainerType movingParzenValues(this->m_JointPDFWindow.GetSize()[0]);
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedImageParzenWindowIndex, this->m_FixedKernel, fixedParzenValues);
-  this->EvaluateParzenValues(
-    movingImageParzenWindowTerm, movingImageParzenWindowIndex, this->m_MovingKernel, movingParzenValues);
-
-  /** Position the JointPDFWindow. */
-  JointPDFIndexType pdfWindowIndex;
-  pdfWindowIndex[0] = movingImageParzenWindowIndex;
-  pdfWindowIndex[1] = fixedImageParzenWindowIndex;
+  /** The moving Parzen values, on the stack to avoid an allocation per sample. */
+  const unsigned int numberOfFixedParzenValues = this->m_JointPDFWindow.GetSize()[1];
+  const unsigned int numberOfMovingParzenValues = this->m_JointPDFWindow.GetSize()[0];
+  PDFValueType       movingParzenValues[MaximumParzenWindowSize];
+  this->EvaluateMovingParzenValues(movingImageParzenWindowTerm, movingImageParzenWindowIndex, movingParzenValues);
 
-  /** For thread-safety, make a local copy of the support region,
-   * and use that one. Because each thread will modify it.
+  /** The joint PDF is indexed as [moving, fixed], so each fixed bin of the Parzen
+   * window is a contiguous row of moving bins. Directly address these rows, instead
+   * of using an image iterator, so the inner loops can be vectorized.
    */
-  JointPDFRegionType jointPDFWindow = this->m_JointPDFWindow;
-  jointPDFWindow.SetIndex(pdfWindowIndex);
-  PDFIteratorType it(jointPDF, jointPDFWindow);
+  const OffsetValueType rowStride = jointPDF->GetOffsetTable()[1];
+  PDFValueType *        windowBegin =
+    jointPDF->GetBufferPointer() + movingImageParzenWindowIndex + fixedImageParzenWindowIndex * rowStride;
 
   if (!imageJacobian)
   {
     /** Loop over the Parzen window region and increment the values. */
-    for (unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f)
+    for (unsigned int f = 0; f < numberOfFixedParzenValues; ++f)
     {
-      const double fv = fixedParzenValues[f];
-      for (unsigned int m = 0; m < movingParzenValues.GetSize(); ++m)
+      const double   fv = fixedParzenValues[f];
+      PDFValueType * row = windowBegin + f * rowStride;
+      for (unsigned int m = 0; m < numberOfMovingParzenValues; ++m)
       {
-        it.Value() += static_cast<PDFValueType>(fv * movingParzenValues[m]);
-        ++it;
+        row[m] += static_cast<PDFValueType>(fv * movingParzenValues[m]);
       }
-      it.NextLine();
     }
   }
   else
   {
     /** Compute the derivatives of the moving Parzen window. */
-    ParzenValueContainerType derivativeMovingParzenValues(this->m_JointPDFWindow.GetSize()[0]);
-    this->EvaluateParzenValues(movingImageParzenWindowTerm,
-                               movingImageParzenWindowIndex,
-                               this->m_DerivativeMovingKernel,
-                               derivativeMovingParzenValues);
+    PDFValueType derivativeMovingParzenValues[MaximumParzenWindowSize];
+    this->EvaluateDerivativeMovingParzenValues(
+      movingImageParzenWindowTerm, movingImageParzenWindowIndex, derivativeMovingParzenValues);
 
     const double et = static_cast<double>(this->m_MovingImageBinSize);
 
     /** Loop over the Parzen window region and increment the values
      * Also update the pdf derivatives.
      */
-    for (unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f)
+    JointPDFIndexType pdfIndex;
+    for (unsigned int f = 0; f < numberOfFixedParzenValues; ++f)
     {
-      const double fv = fixedParzenValues[f];
-      const double fv_et = fv / et;
-      for (unsigned int m = 0; m < movingParzenValues.GetSize(); ++m)
+      const double   fv = fixedParzenValues[f];
+      const double   fv_et = fv / et;
+      PDFValueType * row = windowBegin + f * rowStride;
+      pdfIndex[1] = fixedImageParzenWindowIndex + f;
+      for (unsigned int m = 0; m < numberOfMovingParzenValues; ++m)
       {
-        it.Value() += static_cast<PDFValueType>(fv * movingParzenValues[m]);
-        this->UpdateJointPDFDerivatives(it.GetIndex(), fv_et * derivativeMovingParzenValues[m], *imageJacobian, *nzji);
-        ++it;
+        row[m] += static_cast<PDFValueType>(fv * movingParzenValues[m]);
+        pdfIndex[0] = movingImageParzenWindowIndex + m;
+        this->UpdateJointPDFDerivatives(pdfIndex, fv_et * derivativeMovingParzenValues[m], *imageJacobian, *nzji);
       }
-      it.NextLine();
     }
   }
 
-} // end UpdateJointPDFAndDerivatives()
+} // end UpdateJointPDFAndDerivativesWithFixedParzenValues()
 
 
 /**
@@ -1134,67 +1394,63 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ThreadedComp
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
-  fbegin += (int)pos_begin;
-  fend += (int)pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
 
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for (fiter = fbegin; fiter != fend; ++fiter)
+  /** Process the batches of samples that are assigned to this thread. The
+   * points of each batch are mapped by a single call to the transform.
+   */
+  typename Superclass::SampleBatchType batch;
+  while (this->GetNextSampleBatch(threadId, *sampleContainer, batch))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
-
-    /** Check if point is inside mask. */
-    if (sampleOk)
+    /** Loop over the batch and compute contribution of each sample to pdfs. */
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
     {
-      sampleOk = this->IsInsideMovingMask(mappedPoint);
-    }
+      /** Read the mapped point and initialize some variables. */
+      const MovingImagePointType & mappedPoint = batch.st_MappedPoints[b];
+      RealType                     movingImageValue;
 
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
-    }
+      /** Check if point is inside mask. */
+      bool sampleOk = !batch.st_Rejected[b] && this->IsInsideMovingMask(mappedPoint);
 
-    if (sampleOk)
-    {
-      numberOfPixelsCounted++;
+      /** Compute the moving image value and check if the point is
+       * inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
+      }
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+      if (sampleOk)
+      {
+        numberOfPixelsCounted++;
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue);
+        /** Make sure the values fall within the histogram range.
+         * The fixed image values of the batch are limited already.
+         */
+        movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue);
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(fixedImageValue, movingImageValue, nullptr, nullptr, jointPDF.GetPointer());
-    }
-  } // end iterating over fixed image spatial sample container for loop
+        /** Compute this sample's contribution to the joint distributions. */
+        if (this->m_FixedImageSampleCacheValid)
+        {
+          const SizeValueType sampleIndex = batch.st_Begin + b;
+          this->UpdateJointPDFAndDerivativesWithFixedParzenValues(
+            this->m_FixedParzenWindowIndexCache[sampleIndex],
+            &this->m_FixedParzenValuesCache[sampleIndex * this->m_JointPDFWindow.GetSize()[1]],
+            movingImageValue,
+            nullptr,
+            nullptr,
+            jointPDF.GetPointer());
+        }
+        else
+        {
+          this->UpdateJointPDFAndDerivatives(
+            batch.st_FixedImageValues[b], movingImageValue, nullptr, nullptr, jointPDF.GetPointer());
+        }
+      }
+    } // end for loop over the batch
+  } // end while over the sample batches
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted =
@@ -1296,13 +1552,15 @@ template <class TFixedImage, class TMovingImage>
 void
 ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::LaunchComputePDFsThreaderCallback(void) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(
+  /** Distribute the samples over the threads. */
+  this->InitializeSampleScheduler(this->GetImageSampler()->GetOutput()->Size());
+
+  /** Setup threader and launch. */
+  this->LaunchThreaderCallback(
     this->ComputePDFsThreaderCallback,
     const_cast<void *>(static_cast<const void *>(&this->m_ParzenWindowHistogramThreaderParameters)));
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  this->FinalizeSampleScheduler();
 
 } // end LaunchComputePDFsThreaderCallback()
 
@@ -1325,7 +1583,6 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsA
   /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
   NonZeroJacobianIndicesType nzji(this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
   DerivativeType             imageJacobian(nzji.size());
-  TransformJacobianType      jacobian;
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -1387,11 +1644,10 @@ ParzenWindowHistogramImageToImageMetric<TFixedImage, TMovingImage>::ComputePDFsA
       fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
       movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
-
-      /** Compute the inner product (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
+      /** Compute the inner product (dM/dx)^T (dT/dmu). The transform computes it
+       * without constructing the Jacobian, by its specialised kernel, if any. */
+      this->EvaluateSampleJacobianWithImageGradientProduct(
+        fiter.Index(), fixedPoint, movingImageDerivative, imageJacobian, nzji);
 
       /** Update the joint pdf and the joint pdf derivatives. */
       this->UpdateJointPDFAndDerivatives(
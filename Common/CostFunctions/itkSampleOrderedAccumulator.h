@@ -0,0 +1,162 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkSampleOrderedAccumulator_h
+#define itkSampleOrderedAccumulator_h
+
+#include "itkIntTypes.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SampleOrderedAccumulator
+ *
+ * \brief Stores the contributions of a block of samples, to add them in sample order.
+ *
+ * The threads of a metric can store the measure and the derivative contributions of
+ * their samples in any order, by SetSample(). Afterwards, SumMeasures() and
+ * AccumulateDerivative() add them in the order of the samples, which does not depend
+ * on the number of threads, or on how the samples were divided over them. The derivative
+ * can be accumulated by several threads, each for its own range of parameters.
+ *
+ * Room is reserved for the given number of samples, each with at most the given number
+ * of nonzero derivatives, so metrics should process the samples in blocks of limited size.
+ *
+ * \ingroup Metrics
+ */
+
+template <class TValue, class TIndex>
+class SampleOrderedAccumulator
+{
+public:
+  typedef TValue ValueType;
+  typedef TIndex IndexType;
+
+  /** Reserve room for numberOfSamples samples, with at most numberOfIndices nonzero
+   * derivatives each, and clear all samples. Should be called single-threaded.
+   */
+  void
+  Initialize(const SizeValueType numberOfSamples, const SizeValueType numberOfIndices)
+  {
+    this->m_NumberOfSamples = numberOfSamples;
+    this->m_NumberOfIndices = numberOfIndices;
+    this->m_Measures.assign(numberOfSamples, ValueType{});
+    this->m_Sizes.assign(numberOfSamples, 0);
+    this->m_Sorted.resize(numberOfSamples);
+    this->m_Contributions.resize(numberOfSamples * numberOfIndices);
+    this->m_Indices.resize(numberOfSamples * numberOfIndices);
+  }
+
+
+  /** Store the measure of the sample, and the derivative contributions
+   * factor * values[k] of the parameters indices[k]. Thread-safe for different samples.
+   */
+  template <class TValueContainer, class TIndexContainer>
+  void
+  SetSample(const SizeValueType     sample,
+            const ValueType         measure,
+            const ValueType         factor,
+            const TValueContainer & values,
+            const TIndexContainer & indices,
+            const SizeValueType     numberOfValues)
+  {
+    ValueType * contributions = &this->m_Contributions[sample * this->m_NumberOfIndices];
+    IndexType * sampleIndices = &this->m_Indices[sample * this->m_NumberOfIndices];
+    for (SizeValueType k = 0; k < numberOfValues; ++k)
+    {
+      contributions[k] = factor * values[k];
+      sampleIndices[k] = static_cast<IndexType>(indices[k]);
+    }
+    this->m_Measures[sample] = measure;
+    this->m_Sizes[sample] = numberOfValues;
+    this->m_Sorted[sample] = std::is_sorted(sampleIndices, sampleIndices + numberOfValues);
+  }
+
+
+  /** Store only the measure of the sample. Thread-safe for different samples. */
+  void
+  SetSampleMeasure(const SizeValueType sample, const ValueType measure)
+  {
+    this->m_Measures[sample] = measure;
+  }
+
+
+  /** Returns the sum of the measures, in sample order. */
+  ValueType
+  SumMeasures(void) const
+  {
+    ValueType sum{};
+    for (const ValueType measure : this->m_Measures)
+    {
+      sum += measure;
+    }
+    return sum;
+  }
+
+
+  /** Add the derivative contributions to the parameters [begin, end) of the
+   * derivative, in sample order. Thread-safe for disjoint parameter ranges.
+   */
+  void
+  AccumulateDerivative(ValueType * derivative, const IndexType begin, const IndexType end) const
+  {
+    for (SizeValueType sample = 0; sample < this->m_NumberOfSamples; ++sample)
+    {
+      const SizeValueType size = this->m_Sizes[sample];
+      const ValueType *   contributions = &this->m_Contributions[sample * this->m_NumberOfIndices];
+      const IndexType *   indices = &this->m_Indices[sample * this->m_NumberOfIndices];
+
+      /** Sorted indices, e.g. those of a B-spline transform, allow to skip to the range. */
+      SizeValueType k = 0;
+      if (this->m_Sorted[sample])
+      {
+        k = static_cast<SizeValueType>(std::lower_bound(indices, indices + size, begin) - indices);
+        for (; k < size && indices[k] < end; ++k)
+        {
+          derivative[indices[k]] += contributions[k];
+        }
+      }
+      else
+      {
+        for (; k < size; ++k)
+        {
+          if (indices[k] >= begin && indices[k] < end)
+          {
+            derivative[indices[k]] += contributions[k];
+          }
+        }
+      }
+    }
+  }
+
+
+private:
+  SizeValueType              m_NumberOfSamples{ 0 };
+  SizeValueType              m_NumberOfIndices{ 0 };
+  std::vector<ValueType>     m_Measures;
+  std::vector<SizeValueType> m_Sizes;
+  std::vector<unsigned char> m_Sorted;
+  std::vector<ValueType>     m_Contributions;
+  std::vector<IndexType>     m_Indices;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkSampleOrderedAccumulator_h
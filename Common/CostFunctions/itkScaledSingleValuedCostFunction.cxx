@@ -55,9 +55,7 @@ ScaledSingleValuedCostFunction::GetValue(const ParametersType & parameters) cons
 
   if (this->m_UseScales)
   {
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters(scaledParameters);
-    returnvalue = this->m_UnscaledCostFunction->GetValue(scaledParameters);
+    returnvalue = this->m_UnscaledCostFunction->GetValue(this->ComputeUnscaledParameters(parameters));
   }
   else
   {
@@ -91,25 +89,14 @@ ScaledSingleValuedCostFunction::GetDerivative(const ParametersType & parameters,
 
   if (this->m_UseScales)
   {
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters(scaledParameters);
-    this->m_UnscaledCostFunction->GetDerivative(scaledParameters, derivative);
-
-    const ScalesType & scales = this->GetScales();
-    for (unsigned int i = 0; i < numberOfParameters; ++i)
-    {
-      derivative[i] /= scales[i];
-    }
+    this->m_UnscaledCostFunction->GetDerivative(this->ComputeUnscaledParameters(parameters), derivative);
   }
   else
   {
-    m_UnscaledCostFunction->GetDerivative(parameters, derivative);
+    this->m_UnscaledCostFunction->GetDerivative(parameters, derivative);
   }
 
-  if (this->GetNegateCostFunction())
-  {
-    derivative = -derivative;
-  }
+  this->ConvertUnscaledToScaledDerivative(derivative);
 
 } // end GetDerivative()
 
@@ -135,16 +122,7 @@ ScaledSingleValuedCostFunction::GetValueAndDerivative(const ParametersType & par
 
   if (this->m_UseScales)
   {
-
-    ParametersType scaledParameters = parameters;
-    this->ConvertScaledToUnscaledParameters(scaledParameters);
-    this->m_UnscaledCostFunction->GetValueAndDerivative(scaledParameters, value, derivative);
-
-    const ScalesType & scales = this->GetScales();
-    for (unsigned int i = 0; i < numberOfParameters; ++i)
-    {
-      derivative[i] /= scales[i];
-    }
+    this->m_UnscaledCostFunction->GetValueAndDerivative(this->ComputeUnscaledParameters(parameters), value, derivative);
   }
   else
   {
@@ -154,8 +132,8 @@ ScaledSingleValuedCostFunction::GetValueAndDerivative(const ParametersType & par
   if (this->GetNegateCostFunction())
   {
     value = -value;
-    derivative = -derivative;
   }
+  this->ConvertUnscaledToScaledDerivative(derivative);
 
 } // end GetValueAndDerivative()
 
@@ -266,6 +244,75 @@ ScaledSingleValuedCostFunction::ConvertUnscaledToScaledParameters(ParametersType
 } // end ConvertUnscaledToScaledParameters()
 
 
+/**
+ * *************** ComputeUnscaledParameters ********************
+ */
+
+const ScaledSingleValuedCostFunction::ParametersType &
+ScaledSingleValuedCostFunction::ComputeUnscaledParameters(const ParametersType & parameters) const
+{
+  const unsigned int numberOfParameters = parameters.GetSize();
+  const ScalesType & scales = this->GetScales();
+  if (scales.GetSize() != numberOfParameters)
+  {
+    itkExceptionMacro(<< "Number of scales is not correct.");
+  }
+
+  /** The buffer is only reallocated when the number of parameters changes. */
+  ParametersType & unscaledParameters = this->m_UnscaledParameters;
+  if (unscaledParameters.GetSize() != numberOfParameters)
+  {
+    unscaledParameters.SetSize(numberOfParameters);
+  }
+
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    unscaledParameters[i] = parameters[i] / scales[i];
+  }
+
+  return unscaledParameters;
+
+} // end ComputeUnscaledParameters()
+
+
+/**
+ * *************** ConvertUnscaledToScaledDerivative ********************
+ */
+
+void
+ScaledSingleValuedCostFunction::ConvertUnscaledToScaledDerivative(DerivativeType & derivative) const
+{
+  const unsigned int numberOfParameters = derivative.GetSize();
+  const bool         negate = this->GetNegateCostFunction();
+
+  if (this->m_UseScales && negate)
+  {
+    /** Divide by the scales and negate in a single pass. */
+    const ScalesType & scales = this->GetScales();
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      derivative[i] = -derivative[i] / scales[i];
+    }
+  }
+  else if (this->m_UseScales)
+  {
+    const ScalesType & scales = this->GetScales();
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      derivative[i] /= scales[i];
+    }
+  }
+  else if (negate)
+  {
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      derivative[i] = -derivative[i];
+    }
+  }
+
+} // end ConvertUnscaledToScaledDerivative()
+
+
 /**
  * *************** PrintSelf ********************
  */
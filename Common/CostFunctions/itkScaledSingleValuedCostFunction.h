@@ -147,12 +147,27 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Divide the scaled parameters by the scales, into m_UnscaledParameters.
+   * This avoids allocating a new parameters array each time the cost function is evaluated.
+   */
+  const ParametersType &
+  ComputeUnscaledParameters(const ParametersType & parameters) const;
+
+  /** Divide the derivative of the unscaled cost function by the scales, and negate it
+   * when requested, in place.
+   */
+  void
+  ConvertUnscaledToScaledDerivative(DerivativeType & derivative) const;
+
   /** Member variables. */
   ScalesType                      m_Scales;
   ScalesType                      m_SquaredScales;
   SingleValuedCostFunctionPointer m_UnscaledCostFunction;
   bool                            m_UseScales;
   bool                            m_NegateCostFunction;
+
+  /** The unscaled parameters that are passed to the unscaled cost function. */
+  mutable ParametersType m_UnscaledParameters;
 };
 
 } // end namespace itk
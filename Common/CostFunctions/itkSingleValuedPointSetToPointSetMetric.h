@@ -40,6 +40,8 @@
 #include "itkMacro.h"
 #include "itkSpatialObject.h"
 #include "itkPointSet.h"
+#include "itkPlatformMultiThreader.h"
+#include "itkThreadBudget.h"
 
 namespace itk
 {
@@ -54,6 +56,11 @@ namespace itk
  * This class computes a value that measures the similarity between the fixed point-set
  * and the transformed moving point-set.
  *
+ * Inheriting classes may divide their loops over the points among threads. For this
+ * purpose this class offers a threader, the point range of each work unit, a threaded
+ * batch transformation of the points, and the accumulation of the sparse Jacobian of
+ * a point into a (per-thread) derivative.
+ *
  * \ingroup RegistrationMetrics
  *
  */
@@ -115,6 +122,10 @@ public:
   /** Typedefs for support of sparse Jacobians and compact support of transformations. */
   typedef typename TransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for multi-threading. */
+  typedef PlatformMultiThreader               ThreaderType;
+  typedef typename ThreaderType::WorkUnitInfo ThreadInfoType;
+
   /** Connect the fixed pointset.  */
   itkSetConstObjectMacro(FixedPointSet, FixedPointSetType);
 
@@ -172,6 +183,27 @@ public:
   itkGetConstReferenceMacro(UseMetricSingleThreaded, bool);
   itkBooleanMacro(UseMetricSingleThreaded);
 
+  /** Get whether GetValueAndDerivative() may run concurrently with that of other
+   * metrics sharing the same transform, once BeforeThreadedGetValueAndDerivative()
+   * has been called with UseMetricSingleThreaded on. See CombinationImageToImageMetric.
+   */
+  itkGetConstMacro(ConcurrentEvaluationSupported, bool);
+
+  /** Select the use of multi-threading in the loops over the points. */
+  itkSetMacro(UseMultiThread, bool);
+  itkGetConstReferenceMacro(UseMultiThread, bool);
+  itkBooleanMacro(UseMultiThread);
+
+  /** Set the maximum number of work units. A value of zero means the global default. */
+  itkSetMacro(NumberOfWorkUnits, ThreadIdType);
+  itkGetConstMacro(NumberOfWorkUnits, ThreadIdType);
+
+  /** Set the minimum number of points per work unit. Smaller point sets are
+   * handled by fewer work units, or by the calling thread only.
+   */
+  itkSetMacro(MinimumNumberOfPointsPerWorkUnit, SizeValueType);
+  itkGetConstMacro(MinimumNumberOfPointsPerWorkUnit, SizeValueType);
+
 protected:
   SingleValuedPointSetToPointSetMetric();
   ~SingleValuedPointSetToPointSetMetric() override = default;
@@ -180,6 +212,41 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Return the number of work units over which a loop over numberOfPoints points
+   * is divided. This is one when multi-threading is switched off.
+   */
+  ThreadIdType
+  GetNumberOfWorkUnitsForPoints(const SizeValueType numberOfPoints) const;
+
+  /** Compute the range [begin, end) of the points handled by a work unit. */
+  static void
+  GetWorkUnitPointRange(const SizeValueType numberOfPoints,
+                        const ThreadIdType  workUnitID,
+                        const ThreadIdType  numberOfWorkUnits,
+                        SizeValueType &     begin,
+                        SizeValueType &     end);
+
+  /** Launch the threader callback on the given number of work units. */
+  void
+  LaunchThreaderCallback(ThreadFunctionType callback, void * userData, const ThreadIdType numberOfWorkUnits) const;
+
+  /** Transform the points with the batch transform API: outputPoints[i] = T( inputPoints[i] ).
+   * Large batches are divided among the threads.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const;
+
+  /** Add weight^T * jacobian to the derivative, where the columns of the
+   * Jacobian correspond to the nonzero Jacobian indices.
+   */
+  void
+  AccumulateJacobianProduct(const vnl_vector<DerivativeValueType> & weight,
+                            const TransformJacobianType &           jacobian,
+                            const NonZeroJacobianIndicesType &      nzji,
+                            DerivativeType &                        derivative) const;
+
   /** Member variables. */
   FixedPointSetConstPointer   m_FixedPointSet;
   MovingPointSetConstPointer  m_MovingPointSet;
@@ -192,10 +259,35 @@ protected:
   /** Variables for multi-threading. */
   bool m_UseMetricSingleThreaded;
 
+  /** Inheriting classes set m_ConcurrentEvaluationSupported when their GetValueAndDerivative()
+   * sets the transform parameters through BeforeThreadedGetValueAndDerivative() only.
+   */
+  bool m_ConcurrentEvaluationSupported;
+
+  /** Variables for multi-threading of the loops over the points. */
+  bool                          m_UseMultiThread;
+  ThreadIdType                  m_NumberOfWorkUnits;
+  SizeValueType                 m_MinimumNumberOfPointsPerWorkUnit;
+  mutable ThreaderType::Pointer m_Threader;
+
 private:
   SingleValuedPointSetToPointSetMetric(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  /** The struct that is passed to the threads of TransformPoints(). */
+  struct TransformPointsThreaderParameterType
+  {
+    const Self *           st_Metric;
+    const InputPointType * st_InputPoints;
+    OutputPointType *      st_OutputPoints;
+    SizeValueType          st_NumberOfPoints;
+    ThreadIdType           st_NumberOfWorkUnits;
+  };
+
+  /** The threader callback of TransformPoints(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  TransformPointsThreaderCallback(void * arg);
 };
 
 } // end namespace itk
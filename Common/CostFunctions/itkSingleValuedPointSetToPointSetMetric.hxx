@@ -36,6 +36,8 @@
 
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
+#include <algorithm> // For min and max.
+
 namespace itk
 {
 
@@ -55,6 +57,12 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::SingleVal
   this->m_NumberOfPointsCounted = 0;
 
   this->m_UseMetricSingleThreaded = true;
+  this->m_ConcurrentEvaluationSupported = false;
+
+  this->m_UseMultiThread = true;
+  this->m_NumberOfWorkUnits = 0;
+  this->m_MinimumNumberOfPointsPerWorkUnit = 1024;
+  this->m_Threader = ThreaderType::New();
 
 } // end Constructor
 
@@ -133,6 +141,168 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::BeforeThr
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* GetNumberOfWorkUnitsForPoints ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+ThreadIdType
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::GetNumberOfWorkUnitsForPoints(
+  const SizeValueType numberOfPoints) const
+{
+  if (!this->m_UseMultiThread)
+  {
+    return 1;
+  }
+
+  /** Give every work unit at least the minimum number of points. */
+  ThreadIdType numberOfWorkUnits = this->m_NumberOfWorkUnits;
+  if (numberOfWorkUnits == 0)
+  {
+    numberOfWorkUnits = ThreadBudget::GetNumberOfThreads();
+  }
+  const SizeValueType minimumPerWorkUnit = std::max<SizeValueType>(this->m_MinimumNumberOfPointsPerWorkUnit, 1);
+  numberOfWorkUnits =
+    static_cast<ThreadIdType>(std::min<SizeValueType>(numberOfWorkUnits, numberOfPoints / minimumPerWorkUnit));
+
+  return std::max<ThreadIdType>(numberOfWorkUnits, 1);
+
+} // end GetNumberOfWorkUnitsForPoints()
+
+
+/**
+ * ******************* GetWorkUnitPointRange ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::GetWorkUnitPointRange(
+  const SizeValueType numberOfPoints,
+  const ThreadIdType  workUnitID,
+  const ThreadIdType  numberOfWorkUnits,
+  SizeValueType &     begin,
+  SizeValueType &     end)
+{
+  /** Divide the points in contiguous chunks of (nearly) equal size. */
+  const SizeValueType chunkSize = (numberOfPoints + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  begin = std::min<SizeValueType>(workUnitID * chunkSize, numberOfPoints);
+  end = std::min<SizeValueType>(begin + chunkSize, numberOfPoints);
+
+} // end GetWorkUnitPointRange()
+
+
+/**
+ * ******************* LaunchThreaderCallback ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::LaunchThreaderCallback(
+  ThreadFunctionType callback,
+  void *             userData,
+  const ThreadIdType numberOfWorkUnits) const
+{
+  this->m_Threader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  this->m_Threader->SetSingleMethod(callback, userData);
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchThreaderCallback()
+
+
+/**
+ * ******************* TransformPoints ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  const ThreadIdType numberOfWorkUnits = this->GetNumberOfWorkUnitsForPoints(numberOfPoints);
+
+  /** Transform small batches in the calling thread. */
+  if (numberOfWorkUnits < 2)
+  {
+    this->m_Transform->TransformPoints(inputPoints, outputPoints, numberOfPoints);
+    return;
+  }
+
+  TransformPointsThreaderParameterType userData;
+  userData.st_Metric = this;
+  userData.st_InputPoints = inputPoints;
+  userData.st_OutputPoints = outputPoints;
+  userData.st_NumberOfPoints = numberOfPoints;
+  userData.st_NumberOfWorkUnits = numberOfWorkUnits;
+
+  this->LaunchThreaderCallback(Self::TransformPointsThreaderCallback, &userData, numberOfWorkUnits);
+
+} // end TransformPoints()
+
+
+/**
+ * ******************* TransformPointsThreaderCallback ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::TransformPointsThreaderCallback(void * arg)
+{
+  ThreadInfoType *                       infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType                     threadID = infoStruct->WorkUnitID;
+  TransformPointsThreaderParameterType * temp =
+    static_cast<TransformPointsThreaderParameterType *>(infoStruct->UserData);
+
+  SizeValueType begin = 0;
+  SizeValueType end = 0;
+  Self::GetWorkUnitPointRange(temp->st_NumberOfPoints, threadID, temp->st_NumberOfWorkUnits, begin, end);
+
+  if (begin < end)
+  {
+    temp->st_Metric->m_Transform->TransformPoints(
+      temp->st_InputPoints + begin, temp->st_OutputPoints + begin, end - begin);
+  }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end TransformPointsThreaderCallback()
+
+
+/**
+ * ******************* AccumulateJacobianProduct ***********************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::AccumulateJacobianProduct(
+  const vnl_vector<DerivativeValueType> & weight,
+  const TransformJacobianType &           jacobian,
+  const NonZeroJacobianIndicesType &      nzji,
+  DerivativeType &                        derivative) const
+{
+  if (nzji.size() == this->GetNumberOfParameters())
+  {
+    /** Loop over all Jacobians. */
+    derivative += weight * jacobian;
+  }
+  else
+  {
+    /** Only pick the nonzero Jacobians. */
+    for (unsigned int i = 0; i < nzji.size(); ++i)
+    {
+      DerivativeValueType sum = NumericTraits<DerivativeValueType>::ZeroValue();
+      for (unsigned int d = 0; d < jacobian.rows(); ++d)
+      {
+        sum += weight[d] * jacobian(d, i);
+      }
+      derivative[nzji[i]] += sum;
+    }
+  }
+
+} // end AccumulateJacobianProduct()
+
+
 /**
  * ******************* PrintSelf ***********************
  */
@@ -148,6 +318,9 @@ SingleValuedPointSetToPointSetMetric<TFixedPointSet, TMovingPointSet>::PrintSelf
   os << "Fixed mask: " << this->m_FixedImageMask.GetPointer() << std::endl;
   os << "Moving mask: " << this->m_MovingImageMask.GetPointer() << std::endl;
   os << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+  os << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+  os << "MinimumNumberOfPointsPerWorkUnit: " << this->m_MinimumNumberOfPointsPerWorkUnit << std::endl;
 
 } // end PrintSelf()
 
@@ -0,0 +1,238 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkTransformEvaluationCache_h
+#define itkTransformEvaluationCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+
+#include <algorithm> // For copy_n and equal.
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace itk
+{
+
+/** \class TransformEvaluationCache
+ *
+ * \brief Stores the mapped points and the transform Jacobians of a sample set,
+ * so that they can be shared by several metrics.
+ *
+ * Metrics that use the same transform and the same image sampler map the same
+ * fixed image points, and evaluate the same transform Jacobians, in every
+ * iteration. When these metrics are given one TransformEvaluationCache, only the
+ * first metric that visits a sample evaluates the transform; the others read the
+ * result from the cache.
+ *
+ * The cache is keyed on the sample container, its modification time, the number
+ * of samples and the transform parameters. Initialize() must be called
+ * single-threaded, before the metric computations, and clears the cache whenever
+ * the key changes. The Get and Set functions are thread-safe: every sample has a
+ * state flag, and a sample that is being filled by one thread is simply evaluated
+ * again by the others.
+ *
+ * \ingroup Metrics
+ */
+
+template <class TTransform>
+class ITK_TEMPLATE_EXPORT TransformEvaluationCache : public Object
+{
+public:
+  /** Standard ITK typedefs. */
+  typedef TransformEvaluationCache Self;
+  typedef Object                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TransformEvaluationCache, Object);
+
+  /** Typedefs from the transform. */
+  typedef TTransform                                         TransformType;
+  typedef typename TransformType::ParametersType             ParametersType;
+  typedef typename TransformType::OutputPointType            OutputPointType;
+  typedef typename TransformType::JacobianType               JacobianType;
+  typedef typename TransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename JacobianType::ValueType                   JacobianValueType;
+  typedef typename NonZeroJacobianIndicesType::value_type    NonZeroJacobianIndexType;
+
+  itkStaticConstMacro(OutputSpaceDimension, unsigned int, TransformType::OutputSpaceDimension);
+
+  /** Prepare the cache for the given sample set and transform parameters. The
+   * cached values are kept when the key is unchanged, and discarded otherwise.
+   * Not thread-safe.
+   */
+  void
+  Initialize(const void *           sampleContainer,
+             const ModifiedTimeType sampleContainerMTime,
+             const SizeValueType    numberOfSamples,
+             const ParametersType & parameters,
+             const unsigned int     numberOfNonZeroJacobianIndices)
+  {
+    if (this->IsValidFor(sampleContainer, sampleContainerMTime, numberOfSamples, parameters) &&
+        numberOfNonZeroJacobianIndices == this->m_NumberOfNonZeroJacobianIndices)
+    {
+      return;
+    }
+
+    this->m_SampleContainer = sampleContainer;
+    this->m_SampleContainerMTime = sampleContainerMTime;
+    this->m_Parameters = parameters;
+    this->m_NumberOfNonZeroJacobianIndices = numberOfNonZeroJacobianIndices;
+
+    /** (Re)allocate the buffers only when the number of samples changes. */
+    if (numberOfSamples != this->m_NumberOfSamples)
+    {
+      this->m_NumberOfSamples = numberOfSamples;
+      this->m_MappedPoints.resize(numberOfSamples);
+      this->m_MappedPointStates.reset(new std::atomic<unsigned char>[numberOfSamples]);
+      this->m_JacobianStates.reset(new std::atomic<unsigned char>[numberOfSamples]);
+    }
+    const SizeValueType jacobianSize = OutputSpaceDimension * numberOfNonZeroJacobianIndices;
+    this->m_Jacobians.resize(numberOfSamples * jacobianSize);
+    this->m_NonZeroJacobianIndices.resize(numberOfSamples * numberOfNonZeroJacobianIndices);
+
+    for (SizeValueType i = 0; i < numberOfSamples; ++i)
+    {
+      this->m_MappedPointStates[i].store(Empty, std::memory_order_relaxed);
+      this->m_JacobianStates[i].store(Empty, std::memory_order_relaxed);
+    }
+
+  } // end Initialize()
+
+  /** Check whether the cache holds the values of the given sample set and parameters. */
+  bool
+  IsValidFor(const void *           sampleContainer,
+             const ModifiedTimeType sampleContainerMTime,
+             const SizeValueType    numberOfSamples,
+             const ParametersType & parameters) const
+  {
+    return sampleContainer != nullptr && sampleContainer == this->m_SampleContainer &&
+           sampleContainerMTime == this->m_SampleContainerMTime && numberOfSamples == this->m_NumberOfSamples &&
+           parameters.GetSize() == this->m_Parameters.GetSize() &&
+           std::equal(parameters.begin(), parameters.end(), this->m_Parameters.begin());
+  }
+
+  /** Get the mapped point of sample i. Returns false when it is not cached yet. */
+  bool
+  GetMappedPoint(const SizeValueType i, OutputPointType & mappedPoint) const
+  {
+    if (this->m_MappedPointStates[i].load(std::memory_order_acquire) != Filled)
+    {
+      return false;
+    }
+    mappedPoint = this->m_MappedPoints[i];
+    return true;
+  }
+
+  /** Store the mapped point of sample i, unless another thread already does so. */
+  void
+  SetMappedPoint(const SizeValueType i, const OutputPointType & mappedPoint)
+  {
+    unsigned char expected = Empty;
+    if (this->m_MappedPointStates[i].compare_exchange_strong(expected, Filling, std::memory_order_acquire))
+    {
+      this->m_MappedPoints[i] = mappedPoint;
+      this->m_MappedPointStates[i].store(Filled, std::memory_order_release);
+    }
+  }
+
+  /** Get the sparse Jacobian of sample i. Returns false when it is not cached yet. */
+  bool
+  GetJacobian(const SizeValueType i, JacobianType & jacobian, NonZeroJacobianIndicesType & nzji) const
+  {
+    if (this->m_JacobianStates[i].load(std::memory_order_acquire) != Filled)
+    {
+      return false;
+    }
+
+    const unsigned int nnzji = this->m_NumberOfNonZeroJacobianIndices;
+    if (jacobian.rows() != OutputSpaceDimension || jacobian.cols() != nnzji)
+    {
+      jacobian.SetSize(OutputSpaceDimension, nnzji);
+    }
+    nzji.resize(nnzji);
+    std::copy_n(this->m_Jacobians.begin() + i * OutputSpaceDimension * nnzji,
+                OutputSpaceDimension * nnzji,
+                jacobian.data_block());
+    std::copy_n(this->m_NonZeroJacobianIndices.begin() + i * nnzji, nnzji, nzji.begin());
+    return true;
+  }
+
+  /** Store the sparse Jacobian of sample i, unless another thread already does so,
+   * or its size differs from the number of nonzero Jacobian indices of the transform.
+   */
+  void
+  SetJacobian(const SizeValueType i, const JacobianType & jacobian, const NonZeroJacobianIndicesType & nzji)
+  {
+    const unsigned int nnzji = this->m_NumberOfNonZeroJacobianIndices;
+    if (nzji.size() != nnzji || jacobian.rows() != OutputSpaceDimension || jacobian.cols() != nnzji)
+    {
+      return;
+    }
+
+    unsigned char expected = Empty;
+    if (this->m_JacobianStates[i].compare_exchange_strong(expected, Filling, std::memory_order_acquire))
+    {
+      std::copy_n(jacobian.data_block(),
+                  OutputSpaceDimension * nnzji,
+                  this->m_Jacobians.begin() + i * OutputSpaceDimension * nnzji);
+      std::copy_n(nzji.begin(), nnzji, this->m_NonZeroJacobianIndices.begin() + i * nnzji);
+      this->m_JacobianStates[i].store(Filled, std::memory_order_release);
+    }
+  }
+
+protected:
+  TransformEvaluationCache() = default;
+  ~TransformEvaluationCache() override = default;
+
+private:
+  TransformEvaluationCache(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** The states of the cached values of a sample. */
+  enum : unsigned char
+  {
+    Empty = 0,
+    Filling = 1,
+    Filled = 2
+  };
+
+  /** The key of the cached values. */
+  const void *     m_SampleContainer{ nullptr };
+  ModifiedTimeType m_SampleContainerMTime{ 0 };
+  SizeValueType    m_NumberOfSamples{ 0 };
+  ParametersType   m_Parameters;
+  unsigned int     m_NumberOfNonZeroJacobianIndices{ 0 };
+
+  /** The cached values and their states, per sample. */
+  std::vector<OutputPointType>                  m_MappedPoints;
+  std::unique_ptr<std::atomic<unsigned char>[]> m_MappedPointStates;
+  std::vector<JacobianValueType>                m_Jacobians;
+  std::vector<NonZeroJacobianIndexType>         m_NonZeroJacobianIndices;
+  std::unique_ptr<std::atomic<unsigned char>[]> m_JacobianStates;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkTransformEvaluationCache_h
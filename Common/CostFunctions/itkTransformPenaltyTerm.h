@@ -106,12 +106,14 @@ public:
   typedef TScalarType ScalarType; // \todo: not really meaningful name.
 
   /** Typedefs from the AdvancedTransform. */
-  typedef typename Superclass::AdvancedTransformType            TransformType;
-  typedef typename TransformType::SpatialJacobianType           SpatialJacobianType;
-  typedef typename TransformType::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename TransformType::SpatialHessianType            SpatialHessianType;
-  typedef typename TransformType::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename TransformType::InternalMatrixType            InternalMatrixType;
+  typedef typename Superclass::AdvancedTransformType                     TransformType;
+  typedef typename TransformType::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename TransformType::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename TransformType::SpatialHessianType                     SpatialHessianType;
+  typedef typename TransformType::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename TransformType::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename TransformType::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename TransformType::InternalMatrixType                     InternalMatrixType;
 
   /** Define the dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
@@ -0,0 +1,117 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkWorkUnitCostFunction_h
+#define itkWorkUnitCostFunction_h
+
+#include "itkSingleValuedCostFunction.h"
+#include "itkObjectFactory.h"
+
+namespace itk
+{
+
+/** \class WorkUnitCostFunction
+ *
+ * \brief Evaluates an independent copy of an image to image metric, for one work
+ * unit of a concurrent evaluation.
+ *
+ * The metric should be a copy with its own transform, that does not set the transform
+ * parameters itself (UseMetricSingleThreaded off), see ParallelEvaluationOptimizer.
+ * Every evaluation first sets the parameters of that transform. Copies may share
+ * their image sampler, which must then be updated single-threaded, before the work
+ * units start.
+ *
+ * \ingroup Metrics
+ */
+
+template <class TMetric>
+class ITK_TEMPLATE_EXPORT WorkUnitCostFunction : public SingleValuedCostFunction
+{
+public:
+  /** Standard ITK typedefs. */
+  typedef WorkUnitCostFunction     Self;
+  typedef SingleValuedCostFunction Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(WorkUnitCostFunction, SingleValuedCostFunction);
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType    MeasureType;
+  typedef Superclass::DerivativeType DerivativeType;
+  typedef Superclass::ParametersType ParametersType;
+
+  /** The metric that is evaluated. */
+  typedef TMetric                      MetricType;
+  typedef typename MetricType::Pointer MetricPointer;
+
+  /** Set/Get the copy of the metric that is evaluated. */
+  itkSetObjectMacro(Metric, MetricType);
+  itkGetModifiableObjectMacro(Metric, MetricType);
+
+  MeasureType
+  GetValue(const ParametersType & parameters) const override
+  {
+    this->m_Metric->SetTransformParameters(parameters);
+    return this->m_Metric->GetValue(parameters);
+  }
+
+
+  void
+  GetDerivative(const ParametersType & parameters, DerivativeType & derivative) const override
+  {
+    this->m_Metric->SetTransformParameters(parameters);
+    this->m_Metric->GetDerivative(parameters, derivative);
+  }
+
+
+  void
+  GetValueAndDerivative(const ParametersType & parameters,
+                        MeasureType &          value,
+                        DerivativeType &       derivative) const override
+  {
+    this->m_Metric->SetTransformParameters(parameters);
+    this->m_Metric->GetValueAndDerivative(parameters, value, derivative);
+  }
+
+
+  unsigned int
+  GetNumberOfParameters(void) const override
+  {
+    return this->m_Metric->GetNumberOfParameters();
+  }
+
+
+protected:
+  WorkUnitCostFunction() = default;
+  ~WorkUnitCostFunction() override = default;
+
+private:
+  WorkUnitCostFunction(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  MetricPointer m_Metric;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkWorkUnitCostFunction_h
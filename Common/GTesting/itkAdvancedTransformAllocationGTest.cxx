@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header files to be tested:
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedSimilarity2DTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdlib> // For malloc and free.
+#include <new>
+#include <vector>
+
+
+namespace
+{
+// Counts the calls to the global operator new, replaced below.
+std::atomic<std::size_t> numberOfAllocations(0);
+} // namespace
+
+
+void *
+operator new(std::size_t size)
+{
+  ++numberOfAllocations;
+  if (void * const ptr = std::malloc(size == 0 ? 1 : size))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+
+void
+operator delete(void * ptr) noexcept
+{
+  std::free(ptr);
+}
+
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+constexpr unsigned int SplineOrder = 3;
+
+
+template <class TTransform>
+void
+InitializeBSplineTransform(TTransform & transform)
+{
+  typename TTransform::SizeType size;
+  size.Fill(10);
+  typename TTransform::SpacingType spacing;
+  spacing.Fill(4.0);
+  typename TTransform::OriginType origin;
+  origin.Fill(-8.0);
+
+  transform.SetGridRegion(typename TTransform::RegionType(size));
+  transform.SetGridSpacing(spacing);
+  transform.SetGridOrigin(origin);
+
+  typename TTransform::ParametersType parameters(transform.GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.25 * static_cast<double>((i * 7) % 11) - 1.0;
+  }
+  transform.SetParametersByValue(parameters);
+}
+
+
+template <class TTransform>
+std::vector<typename TTransform::InputPointType>
+MakePoints()
+{
+  std::vector<typename TTransform::InputPointType> points;
+  for (int i = 0; i < 10; ++i)
+  {
+    typename TTransform::InputPointType point;
+    point[0] = 1.25 * static_cast<double>(i) + 2.0;
+    point[1] = 13.0 - 0.75 * static_cast<double>(i);
+    points.push_back(point);
+  }
+  return points;
+}
+
+
+// Expects that, once the caller owned output objects have their final size, repeatedly evaluating the Jacobian
+// related functions of the transform, as done in the sample loop of a metric, does not allocate any memory.
+template <class TTransform>
+void
+Expect_Jacobian_evaluation_does_not_allocate_after_warm_up(const TTransform & transform)
+{
+  const auto points = MakePoints<TTransform>();
+
+  typename TTransform::JacobianType                  jacobian;
+  typename TTransform::SpatialJacobianType           spatialJacobian;
+  typename TTransform::SpatialHessianType            spatialHessian;
+  typename TTransform::JacobianOfSpatialJacobianType jacobianOfSpatialJacobian;
+  typename TTransform::JacobianOfSpatialHessianType  jacobianOfSpatialHessian;
+  typename TTransform::NonZeroJacobianIndicesType    nonZeroJacobianIndices;
+
+  const auto evaluate = [&](const typename TTransform::InputPointType & point) {
+    transform.TransformPoint(point);
+    transform.GetJacobian(point, jacobian, nonZeroJacobianIndices);
+    transform.GetSpatialJacobian(point, spatialJacobian);
+    transform.GetSpatialHessian(point, spatialHessian);
+    transform.GetJacobianOfSpatialJacobian(point, jacobianOfSpatialJacobian, nonZeroJacobianIndices);
+    transform.GetJacobianOfSpatialJacobian(point, spatialJacobian, jacobianOfSpatialJacobian, nonZeroJacobianIndices);
+    transform.GetJacobianOfSpatialHessian(point, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+    transform.GetJacobianOfSpatialHessian(point, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+  };
+
+  // Warm up: let the output objects get their final size.
+  evaluate(points.front());
+
+  const std::size_t numberOfAllocationsBefore = numberOfAllocations;
+  for (const auto & point : points)
+  {
+    evaluate(point);
+  }
+  const std::size_t numberOfAllocationsAfter = numberOfAllocations;
+
+  EXPECT_EQ(numberOfAllocationsAfter, numberOfAllocationsBefore);
+}
+
+} // namespace
+
+
+GTEST_TEST(AdvancedBSplineDeformableTransform, JacobianEvaluationDoesNotAllocate)
+{
+  const auto transform = itk::AdvancedBSplineDeformableTransform<double, Dimension, SplineOrder>::New();
+  InitializeBSplineTransform(*transform);
+  Expect_Jacobian_evaluation_does_not_allocate_after_warm_up(*transform);
+}
+
+
+GTEST_TEST(RecursiveBSplineTransform, JacobianEvaluationDoesNotAllocate)
+{
+  const auto transform = itk::RecursiveBSplineTransform<double, Dimension, SplineOrder>::New();
+  InitializeBSplineTransform(*transform);
+  Expect_Jacobian_evaluation_does_not_allocate_after_warm_up(*transform);
+}
+
+
+GTEST_TEST(AdvancedCombinationTransform, JacobianEvaluationUseCompositionDoesNotAllocate)
+{
+  const auto similarityTransform = itk::AdvancedSimilarity2DTransform<double>::New();
+  similarityTransform->SetScale(1.25);
+  similarityTransform->SetAngle(0.1);
+
+  const auto bsplineTransform = itk::AdvancedBSplineDeformableTransform<double, Dimension, SplineOrder>::New();
+  InitializeBSplineTransform(*bsplineTransform);
+
+  const auto transform = itk::AdvancedCombinationTransform<double, Dimension>::New();
+  transform->SetInitialTransform(similarityTransform);
+  transform->SetCurrentTransform(bsplineTransform);
+  transform->SetUseComposition(true);
+  Expect_Jacobian_evaluation_does_not_allocate_after_warm_up(*transform);
+}
@@ -0,0 +1,157 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header files to be tested:
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedSimilarity2DTransform.h"
+#include "itkAdvancedTranslationTransform.h"
+
+#include "elxGTestUtilities.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+namespace
+{
+using elx::GTestUtilities::MakeVector;
+using CombinationTransformType = itk::AdvancedCombinationTransform<double, 2>;
+using PointType = CombinationTransformType::InputPointType;
+
+
+std::vector<PointType>
+MakePoints()
+{
+  std::vector<PointType> points;
+  for (int i = 0; i < 10; ++i)
+  {
+    PointType point;
+    point[0] = 1.5 * i - 3.0;
+    point[1] = 4.0 - 0.25 * i * i;
+    points.push_back(point);
+  }
+  return points;
+}
+
+
+// Expects that the batch TransformPoints() yields exactly the same points as TransformPoint().
+void
+Expect_TransformPoints_equals_TransformPoint(const CombinationTransformType & transform)
+{
+  const std::vector<PointType> inputPoints = MakePoints();
+  std::vector<PointType>       outputPoints(inputPoints.size());
+
+  transform.TransformPoints(inputPoints.data(), outputPoints.data(), inputPoints.size());
+
+  for (std::size_t i = 0; i < inputPoints.size(); ++i)
+  {
+    EXPECT_EQ(outputPoints[i], transform.TransformPoint(inputPoints[i]));
+  }
+
+  // Transforming in place should give the same result.
+  std::vector<PointType> points = inputPoints;
+  transform.TransformPoints(points.data(), points.data(), points.size());
+  EXPECT_EQ(points, outputPoints);
+}
+
+} // namespace
+
+
+GTEST_TEST(AdvancedCombinationTransform, TransformPointsEqualsTransformPoint)
+{
+  const auto similarityTransform = itk::AdvancedSimilarity2DTransform<double>::New();
+  similarityTransform->SetScale(1.25);
+  similarityTransform->SetAngle(0.3);
+  similarityTransform->SetTranslation(MakeVector(2.0, -1.0));
+
+  const auto translationTransform = itk::AdvancedTranslationTransform<double, 2>::New();
+  translationTransform->SetOffset(MakeVector(0.5, 3.0));
+
+  const auto combinationTransform = CombinationTransformType::New();
+  combinationTransform->SetCurrentTransform(similarityTransform);
+  Expect_TransformPoints_equals_TransformPoint(*combinationTransform);
+
+  combinationTransform->SetInitialTransform(translationTransform);
+  combinationTransform->SetUseComposition(true);
+  Expect_TransformPoints_equals_TransformPoint(*combinationTransform);
+
+  combinationTransform->SetUseAddition(true);
+  Expect_TransformPoints_equals_TransformPoint(*combinationTransform);
+}
+
+
+GTEST_TEST(AdvancedCombinationTransform, FlattenInitialTransformPreservesTransformation)
+{
+  const auto translationTransform = itk::AdvancedTranslationTransform<double, 2>::New();
+  translationTransform->SetOffset(MakeVector(0.5, 3.0));
+
+  const auto similarityTransform = itk::AdvancedSimilarity2DTransform<double>::New();
+  similarityTransform->SetScale(1.25);
+  similarityTransform->SetAngle(0.3);
+  similarityTransform->SetTranslation(MakeVector(2.0, -1.0));
+
+  // A linear chain of two transforms, as obtained from two earlier parameter files.
+  const auto initialTransform = CombinationTransformType::New();
+  initialTransform->SetCurrentTransform(similarityTransform);
+  initialTransform->SetInitialTransform(translationTransform);
+
+  const auto currentTransform = itk::AdvancedTranslationTransform<double, 2>::New();
+  currentTransform->SetOffset(MakeVector(-1.0, 0.25));
+
+  const auto combinationTransform = CombinationTransformType::New();
+  combinationTransform->SetCurrentTransform(currentTransform);
+  combinationTransform->SetInitialTransform(initialTransform);
+
+  using SpatialJacobianType = CombinationTransformType::SpatialJacobianType;
+  const std::vector<PointType>     inputPoints = MakePoints();
+  std::vector<PointType>           expectedPoints;
+  std::vector<SpatialJacobianType> expectedSpatialJacobians;
+  for (const auto & point : inputPoints)
+  {
+    expectedPoints.push_back(combinationTransform->TransformPoint(point));
+    SpatialJacobianType spatialJacobian;
+    combinationTransform->GetSpatialJacobian(point, spatialJacobian);
+    expectedSpatialJacobians.push_back(spatialJacobian);
+  }
+
+  EXPECT_TRUE(combinationTransform->FlattenInitialTransform());
+  EXPECT_TRUE(combinationTransform->GetInitialTransformIsFlattened());
+  EXPECT_EQ(combinationTransform->GetInitialTransform(), initialTransform.GetPointer());
+  EXPECT_EQ(combinationTransform->GetNumberOfTransforms(), 3u);
+
+  for (std::size_t i = 0; i < inputPoints.size(); ++i)
+  {
+    const PointType     actualPoint = combinationTransform->TransformPoint(inputPoints[i]);
+    SpatialJacobianType actualSpatialJacobian;
+    combinationTransform->GetSpatialJacobian(inputPoints[i], actualSpatialJacobian);
+    for (unsigned int d = 0; d < 2; ++d)
+    {
+      EXPECT_NEAR(actualPoint[d], expectedPoints[i][d], 1e-12);
+      for (unsigned int e = 0; e < 2; ++e)
+      {
+        EXPECT_NEAR(actualSpatialJacobian(d, e), expectedSpatialJacobians[i](d, e), 1e-12);
+      }
+    }
+  }
+
+  // Setting the initial transform again undoes the flattening.
+  combinationTransform->SetInitialTransform(initialTransform);
+  EXPECT_FALSE(combinationTransform->GetInitialTransformIsFlattened());
+}
@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header files to be tested:
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+constexpr unsigned int SplineOrder = 3;
+
+
+// Sets up a B-spline grid with a spacing of 4, and non-trivial coefficients.
+template <class TTransform>
+void
+InitializeTransform(TTransform & transform, typename TTransform::ParametersType & parameters)
+{
+  typename TTransform::SizeType size;
+  size.Fill(10);
+  typename TTransform::SpacingType spacing;
+  spacing.Fill(4.0);
+  typename TTransform::OriginType origin;
+  origin.Fill(-8.0);
+
+  transform.SetGridRegion(typename TTransform::RegionType(size));
+  transform.SetGridSpacing(spacing);
+  transform.SetGridOrigin(origin);
+
+  parameters.SetSize(transform.GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.25 * static_cast<double>((i * 7) % 11) - 1.0;
+  }
+  transform.SetParameters(parameters);
+}
+
+
+// The voxels of an image with spacing 1 are grid aligned; the others are not.
+template <class TTransform>
+std::vector<typename TTransform::InputPointType>
+MakePoints()
+{
+  std::vector<typename TTransform::InputPointType> points;
+  for (int i = 0; i < 12; ++i)
+  {
+    typename TTransform::InputPointType point;
+    point[0] = static_cast<double>(i) + 2.0;
+    point[1] = 13.0 - static_cast<double>(i);
+    points.push_back(point);
+    point[0] += 0.37;
+    points.push_back(point);
+  }
+  return points;
+}
+
+
+// Expects that a transform with grid aligned weights tables yields the same results as one without.
+template <class TTransform>
+void
+Expect_GridAlignedWeightsTable_does_not_change_results()
+{
+  const auto                          transform = TTransform::New();
+  const auto                          tabulatedTransform = TTransform::New();
+  typename TTransform::ParametersType parameters;
+  typename TTransform::ParametersType tabulatedParameters;
+  InitializeTransform(*transform, parameters);
+  InitializeTransform(*tabulatedTransform, tabulatedParameters);
+  tabulatedTransform->SetGridAlignedWeightsTableSize(12);
+  EXPECT_EQ(tabulatedTransform->GetGridAlignedWeightsTableSize(), 12u);
+
+  for (const auto & point : MakePoints<TTransform>())
+  {
+    const auto expectedPoint = transform->TransformPoint(point);
+    const auto actualPoint = tabulatedTransform->TransformPoint(point);
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      EXPECT_NEAR(actualPoint[d], expectedPoint[d], 1e-12);
+    }
+
+    typename TTransform::JacobianType               expectedJacobian;
+    typename TTransform::JacobianType               actualJacobian;
+    typename TTransform::NonZeroJacobianIndicesType expectedIndices;
+    typename TTransform::NonZeroJacobianIndicesType actualIndices;
+    transform->GetJacobian(point, expectedJacobian, expectedIndices);
+    tabulatedTransform->GetJacobian(point, actualJacobian, actualIndices);
+    EXPECT_EQ(actualIndices, expectedIndices);
+    ASSERT_EQ(actualJacobian.cols(), expectedJacobian.cols());
+    for (unsigned int i = 0; i < expectedJacobian.rows(); ++i)
+    {
+      for (unsigned int j = 0; j < expectedJacobian.cols(); ++j)
+      {
+        EXPECT_NEAR(actualJacobian(i, j), expectedJacobian(i, j), 1e-12);
+      }
+    }
+
+    typename TTransform::SpatialJacobianType expectedSpatialJacobian;
+    typename TTransform::SpatialJacobianType actualSpatialJacobian;
+    transform->GetSpatialJacobian(point, expectedSpatialJacobian);
+    tabulatedTransform->GetSpatialJacobian(point, actualSpatialJacobian);
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        EXPECT_NEAR(actualSpatialJacobian(i, j), expectedSpatialJacobian(i, j), 1e-12);
+      }
+    }
+  }
+}
+
+} // namespace
+
+
+GTEST_TEST(AdvancedBSplineDeformableTransform, GridAlignedWeightsTableDoesNotChangeResults)
+{
+  Expect_GridAlignedWeightsTable_does_not_change_results<
+    itk::AdvancedBSplineDeformableTransform<double, Dimension, SplineOrder>>();
+}
+
+
+GTEST_TEST(RecursiveBSplineTransform, GridAlignedWeightsTableDoesNotChangeResults)
+{
+  Expect_GridAlignedWeightsTable_does_not_change_results<
+    itk::RecursiveBSplineTransform<double, Dimension, SplineOrder>>();
+}
@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkBitPackedImageMask.h"
+
+#include <itkImage.h>
+#include <itkImageMaskSpatialObject.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+
+GTEST_TEST(BitPackedImageMask, IsInsideEqualsIsInsideInWorldSpace)
+{
+  using MaskImageType = itk::Image<unsigned char, 3>;
+  using MaskSpatialObjectType = itk::ImageMaskSpatialObject<3>;
+  using BitPackedMaskType = itk::BitPackedImageMask<3>;
+  using PointType = BitPackedMaskType::PointType;
+
+  // A mask image with an anisotropic spacing, a rotated direction and a non-zero start index.
+  const MaskImageType::IndexType  start{ { -2, 3, 1 } };
+  const MaskImageType::SizeType   size{ { 20, 15, 10 } };
+  const MaskImageType::RegionType region(start, size);
+  MaskImageType::DirectionType    direction;
+  direction.SetIdentity();
+  direction[0][0] = direction[1][1] = std::cos(0.3);
+  direction[0][1] = -std::sin(0.3);
+  direction[1][0] = std::sin(0.3);
+
+  const auto maskImage = MaskImageType::New();
+  maskImage->SetRegions(region);
+  MaskImageType::SpacingType spacing;
+  spacing.Fill(0.5);
+  MaskImageType::PointType origin;
+  origin.Fill(1.25);
+  maskImage->SetSpacing(spacing);
+  maskImage->SetOrigin(origin);
+  maskImage->SetDirection(direction);
+  maskImage->Allocate(true);
+
+  // A sphere, and a voxel in an otherwise empty slice.
+  for (itk::ImageRegionIteratorWithIndex<MaskImageType> it(maskImage, region); !it.IsAtEnd(); ++it)
+  {
+    const auto & index = it.GetIndex();
+    const auto   x = index[0] - 6;
+    const auto   y = index[1] - 9;
+    const auto   z = index[2] - 5;
+    it.Set((x * x + y * y + z * z) <= 9 ? 1 : 0);
+  }
+  maskImage->SetPixel({ { 0, 4, 10 } }, 1);
+
+  const auto mask = MaskSpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+
+  BitPackedMaskType bitPackedMask;
+  ASSERT_TRUE(bitPackedMask.Update(mask));
+  ASSERT_TRUE(bitPackedMask.IsValidFor(mask));
+
+  // Compare at the voxel centers, and at random points in and around the image.
+  for (itk::ImageRegionIteratorWithIndex<MaskImageType> it(maskImage, region); !it.IsAtEnd(); ++it)
+  {
+    PointType point;
+    maskImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+    EXPECT_EQ(bitPackedMask.IsInside(point), mask->IsInsideInWorldSpace(point));
+  }
+
+  const auto randomGenerator = itk::Statistics::MersenneTwisterRandomVariateGenerator::New();
+  randomGenerator->SetSeed(2021);
+  for (unsigned int i = 0; i < 100000; ++i)
+  {
+    PointType point;
+    for (unsigned int d = 0; d < 3; ++d)
+    {
+      point[d] = randomGenerator->GetUniformVariate(-10.0, 15.0);
+    }
+    EXPECT_EQ(bitPackedMask.IsInside(point), mask->IsInsideInWorldSpace(point));
+  }
+
+  // Without a mask, the bit-packed mask is cleared.
+  EXPECT_FALSE(bitPackedMask.Update(nullptr));
+  EXPECT_FALSE(bitPackedMask.IsValidFor(mask));
+}
@@ -0,0 +1,75 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header file to be tested:
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <gtest/gtest.h>
+
+
+GTEST_TEST(GenericMultiResolutionPyramidImageFilter, NextLevelInBackgroundEqualsCurrentLevelOnly)
+{
+  typedef itk::Image<float, 2>                                                ImageType;
+  typedef itk::GenericMultiResolutionPyramidImageFilter<ImageType, ImageType> PyramidType;
+
+  ImageType::SizeType size;
+  size.Fill(32);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    it.Set(static_cast<float>((it.GetIndex()[0] * 7 + it.GetIndex()[1] * 3) % 11));
+  }
+
+  const auto createPyramid = [image](const bool computeNextLevelInBackground) {
+    const auto pyramid = PyramidType::New();
+    pyramid->SetInput(image);
+    pyramid->SetNumberOfLevels(3);
+    pyramid->SetComputeOnlyForCurrentLevel(true);
+    pyramid->SetComputeNextLevelInBackground(computeNextLevelInBackground);
+    return pyramid;
+  };
+  const auto expectedPyramid = createPyramid(false);
+  const auto actualPyramid = createPyramid(true);
+
+  for (unsigned int level = 0; level < 3; ++level)
+  {
+    expectedPyramid->SetCurrentLevel(level);
+    actualPyramid->SetCurrentLevel(level);
+    expectedPyramid->Update();
+    actualPyramid->Update();
+
+    const ImageType & expectedImage = *(expectedPyramid->GetOutput(level));
+    const ImageType & actualImage = *(actualPyramid->GetOutput(level));
+    ASSERT_EQ(actualImage.GetBufferedRegion(), expectedImage.GetBufferedRegion());
+    EXPECT_EQ(actualImage.GetSpacing(), expectedImage.GetSpacing());
+    EXPECT_EQ(actualImage.GetOrigin(), expectedImage.GetOrigin());
+
+    itk::ImageRegionConstIterator<ImageType> actualIt(&actualImage, actualImage.GetBufferedRegion());
+    itk::ImageRegionConstIterator<ImageType> expectedIt(&expectedImage, expectedImage.GetBufferedRegion());
+    for (; !expectedIt.IsAtEnd(); ++actualIt, ++expectedIt)
+    {
+      EXPECT_EQ(actualIt.Get(), expectedIt.Get());
+    }
+  }
+}
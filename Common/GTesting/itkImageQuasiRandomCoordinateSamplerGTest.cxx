@@ -0,0 +1,81 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkImageQuasiRandomCoordinateSampler.h"
+
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+GTEST_TEST(ImageQuasiRandomCoordinateSampler, HaltonNumbers)
+{
+  using SamplerType = itk::ImageQuasiRandomCoordinateSampler<itk::Image<float, 3>>;
+
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(0, 0), 0.0);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(1, 0), 0.5);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(2, 0), 0.25);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(3, 0), 0.75);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(1, 1), 1.0 / 3.0);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(2, 1), 2.0 / 3.0);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(3, 1), 1.0 / 9.0);
+  EXPECT_DOUBLE_EQ(SamplerType::GetHaltonNumber(1, 2), 0.2);
+}
+
+
+GTEST_TEST(ImageQuasiRandomCoordinateSampler, SamplesAreInsideImageAndChangeEachUpdate)
+{
+  using ImageType = itk::Image<float, 2>;
+  using SamplerType = itk::ImageQuasiRandomCoordinateSampler<ImageType>;
+
+  const auto image = ImageType::New();
+  image->SetRegions(ImageType::SizeType{ { 16, 12 } });
+  image->Allocate(true);
+
+  const auto sampler = SamplerType::New();
+  sampler->SetInput(image);
+  sampler->SetNumberOfSamples(200);
+
+  std::vector<ImageType::PointType> previousPoints;
+  for (unsigned int update = 0; update < 2; ++update)
+  {
+    sampler->Modified();
+    sampler->Update();
+    const auto samples = sampler->GetOutput();
+    ASSERT_EQ(samples->Size(), 200u);
+
+    std::vector<ImageType::PointType> points;
+    for (const auto & sample : *samples)
+    {
+      for (unsigned int d = 0; d < 2; ++d)
+      {
+        EXPECT_GE(sample.m_ImageCoordinates[d], 0.0);
+        EXPECT_LE(sample.m_ImageCoordinates[d], image->GetLargestPossibleRegion().GetSize(d) - 1.0);
+      }
+      points.push_back(sample.m_ImageCoordinates);
+    }
+
+    // Each update shifts the sequence randomly, giving other samples.
+    EXPECT_NE(points, previousPoints);
+    previousPoints = points;
+  }
+}
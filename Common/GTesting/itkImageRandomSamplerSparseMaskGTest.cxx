@@ -0,0 +1,94 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkImageRandomSamplerSparseMask.h"
+
+#include <itkImage.h>
+#include <itkImageMaskSpatialObject.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <set>
+
+
+GTEST_TEST(ImageRandomSamplerSparseMask, SamplesAreInsideMask)
+{
+  using ImageType = itk::Image<float, 2>;
+  using MaskImageType = itk::Image<unsigned char, 2>;
+  using MaskSpatialObjectType = itk::ImageMaskSpatialObject<2>;
+  using SamplerType = itk::ImageRandomSamplerSparseMask<ImageType>;
+  using IndexType = ImageType::IndexType;
+
+  const ImageType::SizeType imageSize{ { 30, 20 } };
+
+  const auto image = ImageType::New();
+  image->SetRegions(imageSize);
+  image->Allocate();
+  float * const buffer = image->GetBufferPointer();
+  for (std::size_t i = 0; i < image->GetPixelContainer()->Size(); ++i)
+  {
+    buffer[i] = static_cast<float>(i);
+  }
+
+  // The mask consists of a few isolated voxels and a short run.
+  const auto maskImage = MaskImageType::New();
+  maskImage->SetRegions(imageSize);
+  maskImage->Allocate(true);
+  const IndexType maskIndices[] = { { { 3, 2 } }, { { 29, 5 } }, { { 10, 11 } }, { { 11, 11 } },
+                                    { { 12, 11 } }, { { 0, 19 } }, { { 20, 19 } } };
+  std::set<ImageType::OffsetValueType> maskOffsets;
+  for (const auto & index : maskIndices)
+  {
+    maskImage->SetPixel(index, 1);
+    maskOffsets.insert(image->ComputeOffset(index));
+  }
+
+  const auto mask = MaskSpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+
+  for (const bool useMultiThread : { false, true })
+  {
+    const auto sampler = SamplerType::New();
+    sampler->SetInput(image);
+    sampler->SetMask(mask);
+    sampler->SetNumberOfSamples(500);
+    sampler->SetUseMultiThread(useMultiThread);
+    sampler->Update();
+
+    const auto samples = sampler->GetOutput();
+    ASSERT_EQ(samples->Size(), 500u);
+
+    std::set<ImageType::OffsetValueType> sampledOffsets;
+    for (const auto & sample : *samples)
+    {
+      IndexType index;
+      ASSERT_TRUE(image->TransformPhysicalPointToIndex(sample.m_ImageCoordinates, index));
+      const auto offset = image->ComputeOffset(index);
+      EXPECT_EQ(maskOffsets.count(offset), 1u);
+      EXPECT_EQ(sample.m_ImageValue, image->GetPixel(index));
+      sampledOffsets.insert(offset);
+    }
+
+    // With this many samples, each of the mask voxels is practically certain to be selected.
+    EXPECT_EQ(sampledOffsets, maskOffsets);
+  }
+}
@@ -0,0 +1,74 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkImageSampleArrays.h"
+
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+
+GTEST_TEST(ImageSampleArrays, FillCopiesCoordinatesAndValues)
+{
+  using ImageType = itk::Image<float, 3>;
+  using SampleArraysType = itk::ImageSampleArrays<ImageType>;
+  using SampleContainerType = SampleArraysType::ImageSampleContainerType;
+
+  const auto container = SampleContainerType::New();
+
+  // Use an odd number of samples, so that the arrays need padding.
+  for (unsigned int i = 0; i < 37; ++i)
+  {
+    SampleArraysType::ImageSampleType sample;
+    sample.m_ImageCoordinates[0] = i;
+    sample.m_ImageCoordinates[1] = 2.0 * i;
+    sample.m_ImageCoordinates[2] = -0.5 * i;
+    sample.m_ImageValue = 10.0 + i;
+    container->push_back(sample);
+  }
+
+  SampleArraysType arrays;
+  arrays.Fill(*container);
+
+  ASSERT_EQ(arrays.Size(), container->Size());
+
+  for (unsigned int d = 0; d < ImageType::ImageDimension; ++d)
+  {
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(arrays.GetCoordinates(d)) % 64, 0);
+  }
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(arrays.GetValues()) % 64, 0);
+
+  for (unsigned int i = 0; i < container->Size(); ++i)
+  {
+    const auto & sample = container->ElementAt(i);
+
+    SampleArraysType::PointType point;
+    arrays.GetPoint(i, point);
+    EXPECT_EQ(point, sample.m_ImageCoordinates);
+    EXPECT_EQ(arrays.GetValues()[i], sample.m_ImageValue);
+  }
+
+  // Refilling with fewer samples should shrink the arrays.
+  container->resize(5);
+  arrays.Fill(*container);
+  EXPECT_EQ(arrays.Size(), std::size_t{ 5 });
+}
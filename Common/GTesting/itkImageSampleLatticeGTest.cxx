@@ -0,0 +1,112 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkImageSampleLattice.h"
+
+#include "elxGTestUtilities.h"
+#include "itkImageFullSampler.h"
+#include "itkImageGridSampler.h"
+
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <vector>
+
+
+namespace
+{
+template <typename TSampler>
+void
+ExpectImplicitSamplesEqualToStoredSamples(TSampler & sampler)
+{
+  sampler.SetUseImplicitSamples(false);
+  sampler.Update();
+  ASSERT_EQ(sampler.GetImplicitSamples(), nullptr);
+
+  // Copy the stored samples, as the output container is reused.
+  const std::vector<typename TSampler::ImageSampleType> storedSamples(sampler.GetOutput()->CastToSTLConstContainer());
+  ASSERT_FALSE(storedSamples.empty());
+
+  sampler.SetUseImplicitSamples(true);
+  sampler.Update();
+  const auto implicitSamples = sampler.GetImplicitSamples();
+  ASSERT_NE(implicitSamples, nullptr);
+  EXPECT_EQ(sampler.GetOutput()->Size(), 0u);
+  ASSERT_EQ(implicitSamples->Size(), storedSamples.size());
+
+  for (std::size_t i = 0; i < storedSamples.size(); ++i)
+  {
+    typename TSampler::ImageSampleType sample;
+    implicitSamples->GetSample(i, sample.m_ImageCoordinates, sample.m_ImageValue);
+    EXPECT_EQ(sample.m_ImageCoordinates, storedSamples[i].m_ImageCoordinates);
+    EXPECT_EQ(sample.m_ImageValue, storedSamples[i].m_ImageValue);
+  }
+}
+
+
+itk::Image<float, 3>::Pointer
+CreateImage()
+{
+  using ImageType = itk::Image<float, 3>;
+
+  const auto image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(ImageType::IndexType{ { 1, -2, 3 } }, ImageType::SizeType{ { 9, 7, 5 } }));
+  image->SetSpacing(elx::GTestUtilities::MakeVector(0.5, 1.0, 2.0));
+  image->Allocate();
+  float * const buffer = image->GetBufferPointer();
+  for (std::size_t i = 0; i < image->GetPixelContainer()->Size(); ++i)
+  {
+    buffer[i] = static_cast<float>(i);
+  }
+  return image;
+}
+} // namespace
+
+
+GTEST_TEST(ImageSampleLattice, GridSamplerImplicitSamplesEqualStoredSamples)
+{
+  using SamplerType = itk::ImageGridSampler<itk::Image<float, 3>>;
+
+  const auto image = CreateImage();
+  const auto sampler = SamplerType::New();
+  sampler->SetInput(image);
+
+  SamplerType::SampleGridSpacingType gridSpacing;
+  gridSpacing[0] = 2;
+  gridSpacing[1] = 3;
+  gridSpacing[2] = 1;
+  sampler->SetSampleGridSpacing(gridSpacing);
+
+  ExpectImplicitSamplesEqualToStoredSamples(*sampler);
+}
+
+
+GTEST_TEST(ImageSampleLattice, FullSamplerImplicitSamplesEqualStoredSamples)
+{
+  using SamplerType = itk::ImageFullSampler<itk::Image<float, 3>>;
+
+  const auto image = CreateImage();
+  const auto sampler = SamplerType::New();
+  sampler->SetInput(image);
+
+  ExpectImplicitSamplesEqualToStoredSamples(*sampler);
+}
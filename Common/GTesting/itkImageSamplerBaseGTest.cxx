@@ -0,0 +1,86 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkImageSamplerBase.h"
+
+#include "itkImageRandomSampler.h"
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <vector>
+
+
+GTEST_TEST(ImageSamplerBase, SampleRefreshFractionReplacesOldestSamples)
+{
+  using ImageType = itk::Image<float, 2>;
+  using SamplerType = itk::ImageRandomSampler<ImageType>;
+  using ImageSampleType = SamplerType::ImageSampleType;
+
+  const auto image = ImageType::New();
+  image->SetRegions(ImageType::SizeType{ { 100, 100 } });
+  image->Allocate();
+  float * const buffer = image->GetBufferPointer();
+  for (std::size_t i = 0; i < image->GetPixelContainer()->Size(); ++i)
+  {
+    buffer[i] = static_cast<float>(i);
+  }
+
+  const auto sampler = SamplerType::New();
+  sampler->SetInput(image);
+  sampler->SetNumberOfSamples(100);
+  sampler->SetSampleRefreshFraction(0.25);
+  sampler->Update();
+
+  const auto equalSamples = [](const ImageSampleType & sample1, const ImageSampleType & sample2) {
+    return sample1.m_ImageCoordinates == sample2.m_ImageCoordinates && sample1.m_ImageValue == sample2.m_ImageValue;
+  };
+
+  for (std::size_t refresh = 0; refresh < 5; ++refresh)
+  {
+    const std::vector<ImageSampleType> previousSamples(sampler->GetOutput()->begin(), sampler->GetOutput()->end());
+
+    ASSERT_TRUE(sampler->SelectNewSamplesOnUpdate());
+    sampler->Update();
+
+    const auto samples = sampler->GetOutput();
+    ASSERT_EQ(samples->Size(), 100u);
+
+    // A quarter of the samples is replaced, cyclically; the others must be kept.
+    const std::size_t firstReplaced = (25 * refresh) % 100;
+    std::size_t       numberOfEqualReplacedSamples = 0;
+    for (std::size_t i = 0; i < 100; ++i)
+    {
+      const bool equal = equalSamples(samples->ElementAt(i), previousSamples[i]);
+      if (i >= firstReplaced && i < firstReplaced + 25)
+      {
+        numberOfEqualReplacedSamples += equal ? 1 : 0;
+      }
+      else
+      {
+        EXPECT_TRUE(equal);
+      }
+    }
+
+    // A new random sample coincides with the old one only by chance.
+    EXPECT_LT(numberOfEqualReplacedSamples, 5u);
+  }
+}
@@ -0,0 +1,118 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkMultiInputImageRandomCoordinateSampler.h"
+
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+
+
+namespace
+{
+using ImageType = itk::Image<float, 2>;
+using SamplerType = itk::MultiInputImageRandomCoordinateSampler<ImageType>;
+using ImageSampleContainerType = SamplerType::ImageSampleContainerType;
+
+
+ImageType::Pointer
+CreateImage(const double origin)
+{
+  const auto image = ImageType::New();
+  image->SetRegions(ImageType::SizeType{ { 21, 17 } });
+  image->SetOrigin(itk::Point<double, 2>(origin));
+  image->Allocate();
+  float * const buffer = image->GetBufferPointer();
+  for (std::size_t i = 0; i < image->GetPixelContainer()->Size(); ++i)
+  {
+    buffer[i] = static_cast<float>(i % 7);
+  }
+  return image;
+}
+
+
+ImageSampleContainerType::Pointer
+GenerateSamples(const bool         useMultiThread,
+                const bool         useCounterBasedRandomNumbers,
+                const unsigned int numberOfWorkUnits)
+{
+  const auto image0 = CreateImage(0.0);
+  const auto image1 = CreateImage(2.5);
+
+  SamplerType::RandomGeneratorType::GetInstance()->SetSeed(2021);
+
+  const auto sampler = SamplerType::New();
+  sampler->SetInput(0, image0);
+  sampler->SetInput(1, image1);
+  sampler->SetInputImageRegion(image0->GetLargestPossibleRegion(), 0);
+  sampler->SetInputImageRegion(image1->GetLargestPossibleRegion(), 1);
+  sampler->SetNumberOfSamples(103);
+  sampler->SetUseMultiThread(useMultiThread);
+  sampler->SetUseCounterBasedRandomNumbers(useCounterBasedRandomNumbers);
+  sampler->SetNumberOfWorkUnits(numberOfWorkUnits);
+  sampler->Update();
+  return sampler->GetOutput();
+}
+
+
+void
+ExpectEqualSamples(const ImageSampleContainerType & actual, const ImageSampleContainerType & expected)
+{
+  ASSERT_EQ(actual.Size(), expected.Size());
+  for (std::size_t i = 0; i < expected.Size(); ++i)
+  {
+    EXPECT_EQ(actual.ElementAt(i).m_ImageCoordinates, expected.ElementAt(i).m_ImageCoordinates);
+    EXPECT_EQ(actual.ElementAt(i).m_ImageValue, expected.ElementAt(i).m_ImageValue);
+  }
+}
+} // namespace
+
+
+GTEST_TEST(MultiInputImageRandomCoordinateSampler, MultiThreadedEqualsSingleThreaded)
+{
+  const auto expected = GenerateSamples(false, false, 1);
+  ASSERT_EQ(expected->Size(), 103u);
+
+  // The samples lie in the intersection of the regions of both images.
+  for (const auto & sample : *expected)
+  {
+    EXPECT_GE(sample.m_ImageCoordinates[0], 2.5);
+    EXPECT_LE(sample.m_ImageCoordinates[0], 20.0);
+  }
+
+  for (const unsigned int numberOfWorkUnits : { 1, 2, 5 })
+  {
+    ExpectEqualSamples(*GenerateSamples(true, false, numberOfWorkUnits), *expected);
+  }
+}
+
+
+GTEST_TEST(MultiInputImageRandomCoordinateSampler, CounterBasedIndependentOfNumberOfWorkUnits)
+{
+  const auto expected = GenerateSamples(false, true, 1);
+  ASSERT_EQ(expected->Size(), 103u);
+
+  for (const unsigned int numberOfWorkUnits : { 2, 3, 8 })
+  {
+    ExpectEqualSamples(*GenerateSamples(false, true, numberOfWorkUnits), *expected);
+  }
+}
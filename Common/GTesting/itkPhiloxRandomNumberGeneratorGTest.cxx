@@ -0,0 +1,149 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkPhiloxRandomNumberGenerator.h"
+
+#include "itkImageQuasiRandomCoordinateSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageRandomSampler.h"
+
+#include <itkImage.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace
+{
+template <typename TSampler>
+typename TSampler::ImageSampleContainerType::Pointer
+GenerateCounterBasedSamples(const typename TSampler::InputImageType & image,
+                            const unsigned int                       numberOfWorkUnits,
+                            const std::uint64_t                      iteration)
+{
+  const auto sampler = TSampler::New();
+  sampler->SetInput(&image);
+  sampler->SetNumberOfSamples(101);
+  sampler->SetNumberOfWorkUnits(numberOfWorkUnits);
+  sampler->UseCounterBasedRandomNumbersOn();
+  sampler->SetRandomIteration(iteration);
+  sampler->Update();
+  return sampler->GetOutput();
+}
+
+
+template <typename TSampler>
+void
+ExpectSamplesIndependentOfNumberOfWorkUnits()
+{
+  using ImageType = typename TSampler::InputImageType;
+
+  const auto image = ImageType::New();
+  image->SetRegions(typename ImageType::SizeType{ { 17, 23 } });
+  image->Allocate();
+  float * const buffer = image->GetBufferPointer();
+  for (std::size_t i = 0; i < image->GetPixelContainer()->Size(); ++i)
+  {
+    buffer[i] = static_cast<float>(i);
+  }
+
+  const auto expected = GenerateCounterBasedSamples<TSampler>(*image, 1, 7);
+  ASSERT_EQ(expected->Size(), 101u);
+
+  for (const unsigned int numberOfWorkUnits : { 2, 3, 8 })
+  {
+    const auto actual = GenerateCounterBasedSamples<TSampler>(*image, numberOfWorkUnits, 7);
+    ASSERT_EQ(actual->Size(), expected->Size());
+
+    for (unsigned int i = 0; i < expected->Size(); ++i)
+    {
+      EXPECT_EQ(actual->ElementAt(i).m_ImageCoordinates, expected->ElementAt(i).m_ImageCoordinates);
+      EXPECT_EQ(actual->ElementAt(i).m_ImageValue, expected->ElementAt(i).m_ImageValue);
+    }
+  }
+
+  // Another iteration should give other samples.
+  const auto other = GenerateCounterBasedSamples<TSampler>(*image, 1, 8);
+  ASSERT_EQ(other->Size(), expected->Size());
+  unsigned int numberOfEqualSamples = 0;
+  for (unsigned int i = 0; i < expected->Size(); ++i)
+  {
+    numberOfEqualSamples += other->ElementAt(i).m_ImageCoordinates == expected->ElementAt(i).m_ImageCoordinates;
+  }
+  EXPECT_LT(numberOfEqualSamples, expected->Size() / 2);
+}
+} // namespace
+
+
+GTEST_TEST(PhiloxRandomNumberGenerator, KnownAnswers)
+{
+  using GeneratorType = itk::PhiloxRandomNumberGenerator;
+
+  // Known answer tests from the Random123 distribution (kat_vectors, philox4x32 10).
+  const GeneratorType::CounterType zeroCounter = { { 0, 0, 0, 0 } };
+  const GeneratorType::KeyType     zeroKey = { { 0, 0 } };
+  const GeneratorType::CounterType zeroResult = GeneratorType::Evaluate(zeroCounter, zeroKey);
+  EXPECT_EQ(zeroResult.m_Words[0], 0x6627e8d5u);
+  EXPECT_EQ(zeroResult.m_Words[1], 0xe169c58du);
+  EXPECT_EQ(zeroResult.m_Words[2], 0xbc57ac4cu);
+  EXPECT_EQ(zeroResult.m_Words[3], 0x9b00dbd8u);
+
+  const GeneratorType::CounterType onesCounter = { { 0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu } };
+  const GeneratorType::KeyType     onesKey = { { 0xffffffffu, 0xffffffffu } };
+  const GeneratorType::CounterType onesResult = GeneratorType::Evaluate(onesCounter, onesKey);
+  EXPECT_EQ(onesResult.m_Words[0], 0x408f276du);
+  EXPECT_EQ(onesResult.m_Words[1], 0x41c83b0eu);
+  EXPECT_EQ(onesResult.m_Words[2], 0xa20bc7c6u);
+  EXPECT_EQ(onesResult.m_Words[3], 0x6d5451fdu);
+}
+
+
+GTEST_TEST(PhiloxRandomNumberGenerator, UniformVariateIsInUnitInterval)
+{
+  double sum = 0.0;
+  for (std::uint64_t sampleId = 0; sampleId < 10000; ++sampleId)
+  {
+    const double variate = itk::PhiloxRandomNumberGenerator::GetUniformVariate(121212, 3, sampleId, 1);
+    ASSERT_GE(variate, 0.0);
+    ASSERT_LT(variate, 1.0);
+    sum += variate;
+  }
+  EXPECT_NEAR(sum / 10000.0, 0.5, 0.02);
+}
+
+
+GTEST_TEST(PhiloxRandomNumberGenerator, RandomSamplerIndependentOfNumberOfWorkUnits)
+{
+  ExpectSamplesIndependentOfNumberOfWorkUnits<itk::ImageRandomSampler<itk::Image<float, 2>>>();
+}
+
+
+GTEST_TEST(PhiloxRandomNumberGenerator, RandomCoordinateSamplerIndependentOfNumberOfWorkUnits)
+{
+  ExpectSamplesIndependentOfNumberOfWorkUnits<itk::ImageRandomCoordinateSampler<itk::Image<float, 2>>>();
+}
+
+
+GTEST_TEST(PhiloxRandomNumberGenerator, QuasiRandomCoordinateSamplerIndependentOfNumberOfWorkUnits)
+{
+  ExpectSamplesIndependentOfNumberOfWorkUnits<itk::ImageQuasiRandomCoordinateSampler<itk::Image<float, 2>>>();
+}
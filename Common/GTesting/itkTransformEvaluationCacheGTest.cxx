@@ -0,0 +1,95 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "itkTransformEvaluationCache.h"
+
+#include "itkAdvancedTransform.h"
+
+#include <gtest/gtest.h>
+
+
+GTEST_TEST(TransformEvaluationCache, StoresValuesUntilTheKeyChanges)
+{
+  using TransformType = itk::AdvancedTransform<double, 2, 2>;
+  using CacheType = itk::TransformEvaluationCache<TransformType>;
+  using ParametersType = CacheType::ParametersType;
+  using OutputPointType = CacheType::OutputPointType;
+  using JacobianType = CacheType::JacobianType;
+  using NonZeroJacobianIndicesType = CacheType::NonZeroJacobianIndicesType;
+
+  constexpr unsigned int numberOfSamples = 10;
+  constexpr unsigned int nnzji = 4;
+  const int              sampleContainer = 0;
+
+  ParametersType parameters(nnzji);
+  parameters.Fill(1.0);
+
+  const auto cache = CacheType::New();
+  cache->Initialize(&sampleContainer, 1, numberOfSamples, parameters, nnzji);
+  EXPECT_TRUE(cache->IsValidFor(&sampleContainer, 1, numberOfSamples, parameters));
+
+  /** Nothing is cached yet. */
+  OutputPointType            mappedPoint;
+  JacobianType               jacobian;
+  NonZeroJacobianIndicesType nzji;
+  EXPECT_FALSE(cache->GetMappedPoint(3, mappedPoint));
+  EXPECT_FALSE(cache->GetJacobian(3, jacobian, nzji));
+
+  /** Store and read back the values of sample 3. */
+  OutputPointType expectedMappedPoint;
+  expectedMappedPoint[0] = 1.5;
+  expectedMappedPoint[1] = -2.5;
+  JacobianType expectedJacobian(2, nnzji);
+  for (unsigned int i = 0; i < expectedJacobian.size(); ++i)
+  {
+    expectedJacobian.data_block()[i] = 0.25 * i;
+  }
+  const NonZeroJacobianIndicesType expectedNzji{ 2, 3, 7, 8 };
+
+  cache->SetMappedPoint(3, expectedMappedPoint);
+  cache->SetJacobian(3, expectedJacobian, expectedNzji);
+  ASSERT_TRUE(cache->GetMappedPoint(3, mappedPoint));
+  ASSERT_TRUE(cache->GetJacobian(3, jacobian, nzji));
+  EXPECT_EQ(mappedPoint, expectedMappedPoint);
+  EXPECT_EQ(jacobian, expectedJacobian);
+  EXPECT_EQ(nzji, expectedNzji);
+  EXPECT_FALSE(cache->GetMappedPoint(4, mappedPoint));
+
+  /** A Jacobian of the wrong size is not stored. */
+  cache->SetJacobian(5, JacobianType(2, nnzji + 1), NonZeroJacobianIndicesType(nnzji + 1));
+  EXPECT_FALSE(cache->GetJacobian(5, jacobian, nzji));
+
+  /** The values are kept for the same key... */
+  cache->Initialize(&sampleContainer, 1, numberOfSamples, parameters, nnzji);
+  EXPECT_TRUE(cache->GetMappedPoint(3, mappedPoint));
+
+  /** ... but discarded when the parameters or the samples change. */
+  ParametersType newParameters = parameters;
+  newParameters[1] = 2.0;
+  EXPECT_FALSE(cache->IsValidFor(&sampleContainer, 1, numberOfSamples, newParameters));
+  cache->Initialize(&sampleContainer, 1, numberOfSamples, newParameters, nnzji);
+  EXPECT_FALSE(cache->GetMappedPoint(3, mappedPoint));
+  EXPECT_FALSE(cache->GetJacobian(3, jacobian, nzji));
+
+  cache->SetMappedPoint(3, expectedMappedPoint);
+  EXPECT_FALSE(cache->IsValidFor(&sampleContainer, 2, numberOfSamples, newParameters));
+  cache->Initialize(&sampleContainer, 2, numberOfSamples, newParameters, nnzji);
+  EXPECT_FALSE(cache->GetMappedPoint(3, mappedPoint));
+}
@@ -0,0 +1,117 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// First include the header files to be tested:
+#include "itkTransformToDeterminantOfSpatialJacobianSource.h"
+#include "itkTransformToSpatialJacobianSource.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+
+#include <itkImage.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkStreamingImageFilter.h>
+
+#include <gtest/gtest.h>
+
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+using BSplineTransformType = itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>;
+
+
+BSplineTransformType::Pointer
+CreateBSplineTransform(BSplineTransformType::ParametersType & parameters)
+{
+  const auto                        transform = BSplineTransformType::New();
+  BSplineTransformType::SizeType    gridSize;
+  BSplineTransformType::SpacingType gridSpacing;
+  BSplineTransformType::OriginType  gridOrigin;
+  gridSize.Fill(8);
+  gridSpacing.Fill(4.0);
+  gridOrigin.Fill(-6.0);
+  transform->SetGridRegion(BSplineTransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  parameters.SetSize(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.1 * static_cast<double>((i * 5) % 7) - 0.3;
+  }
+  transform->SetParameters(parameters);
+  return transform;
+}
+
+
+// Expects that generating the output of the source in pieces yields the same image as generating it at once.
+template <class TSource>
+void
+Expect_streamed_output_equals_output_as_a_whole(TSource & source)
+{
+  typedef typename TSource::OutputImageType ImageType;
+
+  typename TSource::SizeType size;
+  size.Fill(20);
+  source.SetOutputSize(size);
+  source.Update();
+  const typename ImageType::Pointer expectedImage = source.GetOutput();
+  expectedImage->DisconnectPipeline();
+
+  const auto streamer = itk::StreamingImageFilter<ImageType, ImageType>::New();
+  streamer->SetInput(source.GetOutput());
+  streamer->SetNumberOfStreamDivisions(4);
+  streamer->Update();
+  const ImageType & actualImage = *(streamer->GetOutput());
+
+  ASSERT_EQ(actualImage.GetBufferedRegion(), expectedImage->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> actualIt(&actualImage, actualImage.GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> expectedIt(expectedImage, expectedImage->GetBufferedRegion());
+  for (; !expectedIt.IsAtEnd(); ++actualIt, ++expectedIt)
+  {
+    EXPECT_EQ(actualIt.Get(), expectedIt.Get());
+  }
+}
+
+} // namespace
+
+
+GTEST_TEST(TransformToDeterminantOfSpatialJacobianSource, StreamedOutputEqualsOutputAsAWhole)
+{
+  typedef itk::Image<float, Dimension> ImageType;
+
+  BSplineTransformType::ParametersType parameters;
+  const auto                           transform = CreateBSplineTransform(parameters);
+
+  const auto source = itk::TransformToDeterminantOfSpatialJacobianSource<ImageType, double>::New();
+  source->SetTransform(transform);
+  Expect_streamed_output_equals_output_as_a_whole(*source);
+}
+
+
+GTEST_TEST(TransformToSpatialJacobianSource, StreamedOutputEqualsOutputAsAWhole)
+{
+  typedef itk::Image<itk::Matrix<float, Dimension, Dimension>, Dimension> ImageType;
+
+  BSplineTransformType::ParametersType parameters;
+  const auto                           transform = CreateBSplineTransform(parameters);
+
+  const auto source = itk::TransformToSpatialJacobianSource<ImageType, double>::New();
+  source->SetTransform(transform);
+  Expect_streamed_output_equals_output_as_a_whole(*source);
+}
@@ -0,0 +1,267 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBitPackedImageMask_h
+#define itkBitPackedImageMask_h
+
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMath.h"
+
+#include <algorithm> // For min and max.
+#include <cstdint>
+#include <vector>
+
+namespace itk
+{
+
+/** \class BitPackedImageMask
+ *
+ * \brief A compact copy of an image mask, for fast point-in-mask tests.
+ *
+ * The voxels of the mask image that lie inside the tight bounding box of the
+ * nonzero voxels are stored with one bit per voxel. In addition, for every
+ * slice of the bounding box (along the last dimension) it is stored whether
+ * the slice contains any nonzero voxel at all. A point is then tested by
+ * computing its nearest voxel index, followed by a bounding box check, a slice
+ * check and a single bit lookup.
+ *
+ * The result of IsInside() is identical to that of
+ * ImageMaskSpatialObject::IsInsideInWorldSpace(). Only image mask spatial
+ * objects with an identity object-to-world transform are supported; for any
+ * other spatial object Update() returns false, after which the caller should
+ * use the spatial object itself.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template <unsigned int VDimension>
+class ITK_TEMPLATE_EXPORT BitPackedImageMask
+{
+public:
+  /** Typedef's. */
+  typedef BitPackedImageMask                               Self;
+  typedef SpatialObject<VDimension>                        SpatialObjectType;
+  typedef ImageMaskSpatialObject<VDimension>               ImageMaskSpatialObjectType;
+  typedef typename ImageMaskSpatialObjectType::ImageType   MaskImageType;
+  typedef typename ImageMaskSpatialObjectType::PointType   PointType;
+  typedef typename MaskImageType::IndexType                IndexType;
+  typedef typename MaskImageType::SizeType                 SizeType;
+  typedef typename MaskImageType::RegionType               RegionType;
+  typedef typename MaskImageType::PixelType                PixelType;
+  typedef typename MaskImageType::SpacePrecisionType       SpacePrecisionType;
+  typedef ImageRegionConstIteratorWithIndex<MaskImageType> IteratorType;
+
+  itkStaticConstMacro(Dimension, unsigned int, VDimension);
+
+  BitPackedImageMask() = default;
+  ~BitPackedImageMask() = default;
+
+  /** Build the bit-packed copy of the mask, unless it is already up-to-date.
+   * Returns false when the mask cannot be represented, in which case IsValidFor()
+   * returns false for this mask as well.
+   */
+  bool
+  Update(const SpatialObjectType * mask)
+  {
+    const ImageMaskSpatialObjectType * imageMask = dynamic_cast<const ImageMaskSpatialObjectType *>(mask);
+    const MaskImageType *              image = imageMask != nullptr ? imageMask->GetImage() : nullptr;
+    if (image == nullptr || !Self::HasIdentityObjectToWorldTransform(*imageMask))
+    {
+      this->Clear();
+      return false;
+    }
+
+    /** Nothing to do when the mask did not change since the last call. */
+    if (this->m_Valid && mask == this->m_SourceMask && mask->GetMTime() == this->m_SourceMaskMTime &&
+        image->GetMTime() == this->m_SourceImageMTime)
+    {
+      return true;
+    }
+
+    /** Copy the geometry that is needed to compute the nearest voxel index. */
+    const typename MaskImageType::DirectionType & physicalPointToIndex = image->GetPhysicalPointToIndexMatrix();
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      this->m_Origin[i] = image->GetOrigin()[i];
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        this->m_PhysicalPointToIndex[i][j] = physicalPointToIndex[i][j];
+      }
+    }
+
+    /** Compute the tight bounding box of the nonzero voxels. */
+    const RegionType & bufferedRegion = image->GetBufferedRegion();
+    IndexType          minIndex = bufferedRegion.GetUpperIndex();
+    IndexType          maxIndex = bufferedRegion.GetIndex();
+    bool               empty = true;
+    for (IteratorType it(image, bufferedRegion); !it.IsAtEnd(); ++it)
+    {
+      if (Math::NotExactlyEquals(it.Get(), NumericTraits<PixelType>::ZeroValue()))
+      {
+        const IndexType & index = it.GetIndex();
+        for (unsigned int d = 0; d < Dimension; ++d)
+        {
+          minIndex[d] = std::min(minIndex[d], index[d]);
+          maxIndex[d] = std::max(maxIndex[d], index[d]);
+        }
+        empty = false;
+      }
+    }
+
+    /** Pack the voxels of the bounding box, with the first dimension running fastest. */
+    std::size_t numberOfVoxels = 1;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      this->m_BoxIndex[d] = minIndex[d];
+      this->m_BoxSize[d] = empty ? 0 : static_cast<std::size_t>(maxIndex[d] - minIndex[d] + 1);
+      this->m_BoxStrides[d] = numberOfVoxels;
+      numberOfVoxels *= this->m_BoxSize[d];
+    }
+    this->m_Bits.assign((numberOfVoxels + 63) / 64, 0);
+    this->m_SliceOccupancy.assign(this->m_BoxSize[Dimension - 1], 0);
+    std::size_t numberOfInsideVoxels = 0;
+
+    if (!empty)
+    {
+      RegionType box;
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        box.SetIndex(d, minIndex[d]);
+        box.SetSize(d, this->m_BoxSize[d]);
+      }
+      std::size_t bit = 0;
+      for (IteratorType it(image, box); !it.IsAtEnd(); ++it, ++bit)
+      {
+        if (Math::NotExactlyEquals(it.Get(), NumericTraits<PixelType>::ZeroValue()))
+        {
+          ++numberOfInsideVoxels;
+          this->m_Bits[bit / 64] |= std::uint64_t{ 1 } << (bit % 64);
+          this->m_SliceOccupancy[it.GetIndex()[Dimension - 1] - minIndex[Dimension - 1]] = 1;
+        }
+      }
+    }
+
+    this->m_FillRatio = empty ? 0.0 : static_cast<double>(numberOfInsideVoxels) / static_cast<double>(numberOfVoxels);
+    this->m_SourceMask = mask;
+    this->m_SourceMaskMTime = mask->GetMTime();
+    this->m_SourceImageMTime = image->GetMTime();
+    this->m_Valid = true;
+    return true;
+  }
+
+
+  /** Forget the mask. */
+  void
+  Clear(void)
+  {
+    this->m_Bits.clear();
+    this->m_SliceOccupancy.clear();
+    this->m_FillRatio = 0.0;
+    this->m_SourceMask = nullptr;
+    this->m_Valid = false;
+  }
+
+
+  /** Returns true if IsInside() may be used instead of mask->IsInsideInWorldSpace().
+   * Only compares pointers, so Update() should be called again after modifying the mask.
+   */
+  bool
+  IsValidFor(const SpatialObjectType * mask) const
+  {
+    return this->m_Valid && mask == this->m_SourceMask;
+  }
+
+
+  /** Returns the fraction of the voxels of the bounding box of the mask that are inside the mask. */
+  double
+  GetFillRatio(void) const
+  {
+    return this->m_FillRatio;
+  }
+
+
+  /** Test whether the nearest voxel of a physical point is inside the mask. Thread-safe. */
+  bool
+  IsInside(const PointType & point) const
+  {
+    std::size_t offset = 0;
+    for (unsigned int i = 0; i < Dimension; ++i)
+    {
+      /** Same computation as in ImageBase::TransformPhysicalPointToIndex(). */
+      SpacePrecisionType sum = NumericTraits<SpacePrecisionType>::ZeroValue();
+      for (unsigned int j = 0; j < Dimension; ++j)
+      {
+        sum += this->m_PhysicalPointToIndex[i][j] * (point[j] - this->m_Origin[j]);
+      }
+      const IndexValueType boxIndex = Math::RoundHalfIntegerUp<IndexValueType>(sum) - this->m_BoxIndex[i];
+      if (boxIndex < 0 || static_cast<std::size_t>(boxIndex) >= this->m_BoxSize[i])
+      {
+        return false;
+      }
+      offset += static_cast<std::size_t>(boxIndex) * this->m_BoxStrides[i];
+      if (i == Dimension - 1 && this->m_SliceOccupancy[boxIndex] == 0)
+      {
+        return false;
+      }
+    }
+    return (this->m_Bits[offset / 64] >> (offset % 64)) & 1;
+  }
+
+
+private:
+  static bool
+  HasIdentityObjectToWorldTransform(const ImageMaskSpatialObjectType & mask)
+  {
+    const typename ImageMaskSpatialObjectType::TransformType * transform = mask.GetObjectToWorldTransform();
+    if (transform == nullptr)
+    {
+      return true;
+    }
+    if (!transform->GetMatrix().GetVnlMatrix().is_identity())
+    {
+      return false;
+    }
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      if (Math::NotExactlyEquals(transform->GetOffset()[d], 0.0))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  SpacePrecisionType m_PhysicalPointToIndex[VDimension][VDimension]{};
+  SpacePrecisionType m_Origin[VDimension]{};
+  IndexValueType     m_BoxIndex[VDimension]{};
+  std::size_t        m_BoxSize[VDimension]{};
+  std::size_t        m_BoxStrides[VDimension]{};
+
+  std::vector<std::uint64_t> m_Bits;
+  std::vector<std::uint8_t>  m_SliceOccupancy;
+  double                     m_FillRatio{ 0.0 };
+
+  const SpatialObjectType * m_SourceMask{ nullptr };
+  ModifiedTimeType          m_SourceMaskMTime{ 0 };
+  ModifiedTimeType          m_SourceImageMTime{ 0 };
+  bool                      m_Valid{ false };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkBitPackedImageMask_h
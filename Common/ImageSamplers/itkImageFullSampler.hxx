@@ -33,6 +33,18 @@ template <class TInputImage>
 void
 ImageFullSampler<TInputImage>::GenerateData(void)
 {
+  /** Without a mask, the samples can be described implicitly by the voxel grid of the region. */
+  this->m_ImplicitSamplesActive = this->GetMask().IsNull() && this->m_UseImplicitSamples;
+  if (this->m_ImplicitSamplesActive)
+  {
+    typename InputImageType::OffsetType step;
+    step.Fill(1);
+    const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+    this->GetOutput()->Initialize();
+    this->m_ImplicitSamples.Initialize(this->GetInput(), region.GetIndex(), region.GetSize(), step);
+    return;
+  }
+
   /** If desired we exercise a multi-threaded version. */
   if (this->m_UseMultiThread)
   {
@@ -111,7 +123,7 @@ ImageFullSampler<TInputImage>::GenerateData(void)
       /** Translate index to point. */
       inputImage->TransformIndexToPhysicalPoint(index, tempSample.m_ImageCoordinates);
 
-      if (mask->IsInsideInWorldSpace(tempSample.m_ImageCoordinates))
+      if (this->IsInsideMask(tempSample.m_ImageCoordinates))
       {
         /** Get sampled image value. */
         tempSample.m_ImageValue = iter.Get();
@@ -206,7 +218,7 @@ ImageFullSampler<TInputImage>::ThreadedGenerateData(const InputImageRegionType &
       /** Translate index to point. */
       inputImage->TransformIndexToPhysicalPoint(index, tempSample.m_ImageCoordinates);
 
-      if (mask->IsInsideInWorldSpace(tempSample.m_ImageCoordinates))
+      if (this->IsInsideMask(tempSample.m_ImageCoordinates))
       {
         /** Get sampled image value. */
         tempSample.m_ImageValue = iter.Get();
@@ -99,6 +99,14 @@ ImageGridSampler<TInputImage>::GenerateData(void)
     numberOfSamplesOnGrid *= sampleGridSize[dim];
   }
 
+  /** Without a mask, the samples can be described implicitly by the grid. */
+  this->m_ImplicitSamplesActive = mask.IsNull() && this->m_UseImplicitSamples;
+  if (this->m_ImplicitSamplesActive)
+  {
+    this->m_ImplicitSamples.Initialize(inputImage, sampleGridIndex, sampleGridSize, this->m_SampleGridSpacing);
+    return;
+  }
+
   /** Prepare for looping over the grid. */
   unsigned int dim_z = 1;
   unsigned int dim_t = 1;
@@ -176,7 +184,7 @@ ImageGridSampler<TInputImage>::GenerateData(void)
             // Translate index to point.
             inputImage->TransformIndexToPhysicalPoint(index, tempsample.m_ImageCoordinates);
 
-            if (mask->IsInsideInWorldSpace(tempsample.m_ImageCoordinates))
+            if (this->IsInsideMask(tempsample.m_ImageCoordinates))
             {
               // Get sampled fixed image value.
               tempsample.m_ImageValue = inputImage->GetPixel(index);
@@ -0,0 +1,159 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageQuasiRandomCoordinateSampler_h
+#define itkImageQuasiRandomCoordinateSampler_h
+
+#include "itkImageRandomCoordinateSampler.h"
+
+namespace itk
+{
+
+/** \class ImageQuasiRandomCoordinateSampler
+ *
+ * \brief Samples an image at a set of quasi-random physical coordinates.
+ *
+ * This sampler is like the ImageRandomCoordinateSampler, but the coordinates
+ * are taken from a Halton sequence, instead of being drawn independently.
+ * Such a low-discrepancy sequence covers the sample region more evenly, so
+ * that fewer samples are needed for the same variance of the metric (derivative).
+ *
+ * The sequence is scrambled by a random shift (a Cranley-Patterson rotation),
+ * which is drawn again each time that the samples are generated. So, new
+ * samples are obtained in every iteration, when desired. If a mask is given,
+ * the points of the sequence that fall outside the mask are skipped; the
+ * accepted points then still cover the mask evenly.
+ *
+ * With UseCounterBasedRandomNumbers, the shift is taken from the counter-based
+ * generator, and the threads compute the points from their sample numbers, so
+ * that the samples do not depend on the number of threads.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template <class TInputImage>
+class ITK_TEMPLATE_EXPORT ImageQuasiRandomCoordinateSampler : public ImageRandomCoordinateSampler<TInputImage>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef ImageQuasiRandomCoordinateSampler         Self;
+  typedef ImageRandomCoordinateSampler<TInputImage> Superclass;
+  typedef SmartPointer<Self>                        Pointer;
+  typedef SmartPointer<const Self>                  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageQuasiRandomCoordinateSampler, ImageRandomCoordinateSampler);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass::DataObjectPointer            DataObjectPointer;
+  typedef typename Superclass::OutputVectorContainerType    OutputVectorContainerType;
+  typedef typename Superclass::OutputVectorContainerPointer OutputVectorContainerPointer;
+  typedef typename Superclass::InputImageType               InputImageType;
+  typedef typename Superclass::InputImagePointer            InputImagePointer;
+  typedef typename Superclass::InputImageConstPointer       InputImageConstPointer;
+  typedef typename Superclass::InputImageRegionType         InputImageRegionType;
+  typedef typename Superclass::InputImagePixelType          InputImagePixelType;
+  typedef typename Superclass::ImageSampleType              ImageSampleType;
+  typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
+  typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::InputImageSizeType           InputImageSizeType;
+  typedef typename Superclass::InputImageSpacingType        InputImageSpacingType;
+  typedef typename Superclass::InputImageIndexType          InputImageIndexType;
+  typedef typename Superclass::InputImagePointType          InputImagePointType;
+  typedef typename Superclass::InputImagePointValueType     InputImagePointValueType;
+  typedef typename Superclass::ImageSampleValueType         ImageSampleValueType;
+  typedef typename Superclass::CoordRepType                 CoordRepType;
+  typedef typename Superclass::InterpolatorType             InterpolatorType;
+  typedef typename Superclass::DefaultInterpolatorType      DefaultInterpolatorType;
+  typedef typename Superclass::RandomGeneratorType          RandomGeneratorType;
+
+  /** The input image dimension. */
+  itkStaticConstMacro(InputImageDimension, unsigned int, Superclass::InputImageDimension);
+
+  /** Returns element sampleNumber of the Halton sequence along dimension dim,
+   * i.e., the radical inverse of sampleNumber in the base of the dim-th prime.
+   */
+  static double
+  GetHaltonNumber(unsigned long sampleNumber, const unsigned int dim);
+
+protected:
+  typedef typename Superclass::InputImageContinuousIndexType InputImageContinuousIndexType;
+
+  /** The constructor. */
+  ImageQuasiRandomCoordinateSampler();
+  /** The destructor. */
+  ~ImageQuasiRandomCoordinateSampler() override = default;
+
+  /** PrintSelf. */
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Restarts the sequence with a new random shift, and generates the samples as the superclass. */
+  void
+  GenerateData(void) override;
+
+  /** With the counter-based random numbers, takes the random shift from the counter-based
+   * generator, after the superclass has selected the iteration of this generation.
+   */
+  void
+  BeforeThreadedGenerateData(void) override;
+
+  /** Generate the next point of the shifted Halton sequence in a bounding box. */
+  void
+  GenerateRandomCoordinate(const InputImageContinuousIndexType & smallestContIndex,
+                           const InputImageContinuousIndexType & largestContIndex,
+                           InputImageContinuousIndexType &       randomContIndex) override;
+
+  /** Generate the point of the shifted Halton sequence of the given sample in a bounding box.
+   * The same points as GenerateRandomCoordinate() gives serially, so thread-safe.
+   */
+  void
+  GenerateCounterBasedCoordinate(const unsigned long                   sampleNumber,
+                                 const InputImageContinuousIndexType & smallestContIndex,
+                                 const InputImageContinuousIndexType & largestContIndex,
+                                 InputImageContinuousIndexType &       randomContIndex) const override;
+
+private:
+  /** The deleted copy constructor. */
+  ImageQuasiRandomCoordinateSampler(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+
+  /** Compute the point with the given number of the shifted Halton sequence in a bounding box. */
+  void
+  ComputeSequenceCoordinate(const unsigned long                   sequenceNumber,
+                            const InputImageContinuousIndexType & smallestContIndex,
+                            const InputImageContinuousIndexType & largestContIndex,
+                            InputImageContinuousIndexType &       randomContIndex) const;
+
+  /** The number of the next point of the sequence, and the current random shift. */
+  unsigned long                                 m_SequenceNumber;
+  FixedArray<double, Self::InputImageDimension> m_SequenceShift;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkImageQuasiRandomCoordinateSampler.hxx"
+#endif
+
+#endif // end #ifndef itkImageQuasiRandomCoordinateSampler_h
@@ -0,0 +1,187 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageQuasiRandomCoordinateSampler_hxx
+#define itkImageQuasiRandomCoordinateSampler_hxx
+
+#include "itkImageQuasiRandomCoordinateSampler.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template <class TInputImage>
+ImageQuasiRandomCoordinateSampler<TInputImage>::ImageQuasiRandomCoordinateSampler()
+{
+  this->m_SequenceNumber = 1;
+  this->m_SequenceShift.Fill(0.0);
+
+} // end Constructor
+
+
+/**
+ * ******************* GetHaltonNumber *******************
+ */
+
+template <class TInputImage>
+double
+ImageQuasiRandomCoordinateSampler<TInputImage>::GetHaltonNumber(unsigned long sampleNumber, const unsigned int dim)
+{
+  static constexpr unsigned int primes[] = { 2, 3, 5, 7, 11, 13, 17, 19 };
+  static_assert(InputImageDimension <= sizeof(primes) / sizeof(primes[0]), "Too many dimensions for the primes.");
+
+  const unsigned long base = primes[dim];
+  const double        inverseBase = 1.0 / static_cast<double>(base);
+  double              factor = inverseBase;
+  double              result = 0.0;
+  while (sampleNumber > 0)
+  {
+    result += factor * static_cast<double>(sampleNumber % base);
+    sampleNumber /= base;
+    factor *= inverseBase;
+  }
+  return result;
+
+} // end GetHaltonNumber()
+
+
+/**
+ * ******************* GenerateData *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::GenerateData(void)
+{
+  /** Restart the sequence, with a new random shift. Point 0 is skipped, as it is 0 in all dimensions. */
+  this->m_SequenceNumber = 1;
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+  {
+    this->m_SequenceShift[i] = this->m_RandomGenerator->GetUniformVariate(0.0, 1.0);
+  }
+
+  Superclass::GenerateData();
+
+} // end GenerateData()
+
+
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::BeforeThreadedGenerateData(void)
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  /** The threads compute the points from their sample numbers, so only the shift is random. */
+  if (this->m_UseCounterBasedRandomNumbers)
+  {
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      this->m_SequenceShift[i] = this->GetCounterBasedRandomVariate(0, i);
+    }
+  }
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* GenerateRandomCoordinate *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::GenerateRandomCoordinate(
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType &       randomContIndex)
+{
+  this->ComputeSequenceCoordinate(this->m_SequenceNumber, smallestContIndex, largestContIndex, randomContIndex);
+  ++this->m_SequenceNumber;
+
+} // end GenerateRandomCoordinate()
+
+
+/**
+ * ******************* GenerateCounterBasedCoordinate *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::GenerateCounterBasedCoordinate(
+  const unsigned long                   sampleNumber,
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType &       randomContIndex) const
+{
+  /** Point 0 of the sequence is skipped, like in the serial generation. */
+  this->ComputeSequenceCoordinate(sampleNumber + 1, smallestContIndex, largestContIndex, randomContIndex);
+
+} // end GenerateCounterBasedCoordinate()
+
+
+/**
+ * ******************* ComputeSequenceCoordinate *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::ComputeSequenceCoordinate(
+  const unsigned long                   sequenceNumber,
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType &       randomContIndex) const
+{
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+  {
+    /** Shift the Halton number, modulo 1. */
+    double u = Self::GetHaltonNumber(sequenceNumber, i) + this->m_SequenceShift[i];
+    if (u >= 1.0)
+    {
+      u -= 1.0;
+    }
+    randomContIndex[i] = static_cast<InputImagePointValueType>(smallestContIndex[i] +
+                                                               u * (largestContIndex[i] - smallestContIndex[i]));
+  }
+
+} // end ComputeSequenceCoordinate()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template <class TInputImage>
+void
+ImageQuasiRandomCoordinateSampler<TInputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "SequenceNumber: " << this->m_SequenceNumber << std::endl;
+  os << indent << "SequenceShift: " << this->m_SequenceShift << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkImageQuasiRandomCoordinateSampler_hxx
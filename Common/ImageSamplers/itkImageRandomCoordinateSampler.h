@@ -19,6 +19,7 @@
 #define itkImageRandomCoordinateSampler_h
 
 #include "itkImageRandomSamplerBase.h"
+#include "itkImageTileCache.h"
 #include "itkInterpolateImageFunction.h"
 #include "itkBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
@@ -33,6 +34,12 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * Optionally, the sample values are read from an image file by an ImageTileCache,
+ * instead of being interpolated in the input image, whose pixel buffer is then
+ * not used. The samples are evaluated in the order of their tiles, so that only
+ * the tiles that contain samples are read, each of them once. The values are
+ * interpolated linearly, and samples outside the tiled image are rejected.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -86,6 +93,10 @@ public:
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
   typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
 
+  /** The cache of the image tiles, from which the sample values can be read. */
+  typedef ImageTileCache<InputImageType>   TileCacheType;
+  typedef typename TileCacheType::Pointer TileCachePointer;
+
   /** Set/Get the interpolator. A 3rd order B-spline interpolator is used by default. */
   itkSetObjectMacro(Interpolator, InterpolatorType);
   itkGetModifiableObjectMacro(Interpolator, InterpolatorType);
@@ -100,6 +111,13 @@ public:
   itkGetConstMacro(UseRandomSampleRegion, bool);
   itkSetMacro(UseRandomSampleRegion, bool);
 
+  /** Set/Get the tile cache, from which the sample values are read instead of from
+   * the input image. The counter-based random numbers and the multi-threading are
+   * then not used. Default: null, i.e. the input image is interpolated.
+   */
+  itkSetObjectMacro(TileCache, TileCacheType);
+  itkGetModifiableObjectMacro(TileCache, TileCacheType);
+
 protected:
   typedef typename InterpolatorType::ContinuousIndexType InputImageContinuousIndexType;
 
@@ -123,15 +141,33 @@ protected:
   void
   ThreadedGenerateData(const InputImageRegionType & inputRegionForThread, ThreadIdType threadId) override;
 
+  /** Generate the samples with their values from the tile cache. */
+  virtual void
+  GenerateDataFromTiles(void);
+
   /** Generate a point randomly in a bounding box. */
   virtual void
   GenerateRandomCoordinate(const InputImageContinuousIndexType & smallestContIndex,
                            const InputImageContinuousIndexType & largestContIndex,
                            InputImageContinuousIndexType &       randomContIndex);
 
+  /** Generate the point of the given sample in a bounding box, from the counter-based random
+   * numbers. Used by the threads of the multi-threaded version, so it must be thread-safe.
+   */
+  virtual void
+  GenerateCounterBasedCoordinate(const unsigned long                   sampleNumber,
+                                 const InputImageContinuousIndexType & smallestContIndex,
+                                 const InputImageContinuousIndexType & largestContIndex,
+                                 InputImageContinuousIndexType &       randomContIndex) const;
+
   InterpolatorPointer    m_Interpolator;
   RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
+  TileCachePointer       m_TileCache;
+
+  /** The sample region of the current generation, used by the counter-based random numbers. */
+  InputImageContinuousIndexType m_SmallestSampleRegionContIndex;
+  InputImageContinuousIndexType m_LargestSampleRegionContIndex;
 
   /** Generate the two corners of a sampling region, given the two corners
    * of an image. If UseRandomSampleRegion=false, the smallesPoint and largestPoint
@@ -21,6 +21,10 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm> // For sort.
+#include <utility>   // For pair.
+#include <vector>
+
 namespace itk
 {
 
@@ -53,9 +57,16 @@ template <class TInputImage>
 void
 ImageRandomCoordinateSampler<TInputImage>::GenerateData(void)
 {
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version.
+   * The counter-based random numbers are only generated by the multi-threaded version.
+   */
+  if (this->m_TileCache.IsNotNull())
+  {
+    return this->GenerateDataFromTiles();
+  }
+
   typename MaskType::ConstPointer mask = this->GetMask();
-  if (mask.IsNull() && this->m_UseMultiThread)
+  if (mask.IsNull() && (this->m_UseMultiThread || this->m_UseCounterBasedRandomNumbers))
   {
     /** Calls ThreadedGenerateData(). */
     return Superclass::GenerateData();
@@ -148,7 +159,7 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData(void)
         this->GenerateRandomCoordinate(smallestContIndex, largestContIndex, sampleContIndex);
         inputImage->TransformContinuousIndexToPhysicalPoint(sampleContIndex, samplePoint);
 
-      } while (!interpolator->IsInsideBuffer(sampleContIndex) || !mask->IsInsideInWorldSpace(samplePoint));
+      } while (!interpolator->IsInsideBuffer(sampleContIndex) || !this->IsInsideMask(samplePoint));
 
       /** Compute the value at the point. */
       sampleValue = static_cast<ImageSampleValueType>(this->m_Interpolator->EvaluateAtContinuousIndex(sampleContIndex));
@@ -156,9 +167,91 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateData(void)
     } // end for loop
   }   // end if mask
 
+  /** Sort the samples, if desired. */
+  this->SortOutputSamples();
+
 } // end GenerateData()
 
 
+/**
+ * ******************* GenerateDataFromTiles *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomCoordinateSampler<TInputImage>::GenerateDataFromTiles(void)
+{
+  /** Get handles to the input image, the output sample container, the mask and the tile cache. */
+  InputImageConstPointer                     inputImage = this->GetInput();
+  typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
+  typename MaskType::ConstPointer            mask = this->GetMask();
+  TileCacheType &                            tileCache = *this->m_TileCache;
+  if (mask.IsNotNull() && mask->GetSource())
+  {
+    mask->GetSource()->Update();
+  }
+
+  /** Convert inputImageRegion to bounding box in physical space. */
+  InputImageSizeType unitSize;
+  unitSize.Fill(1);
+  InputImageIndexType           smallestIndex = this->GetCroppedInputImageRegion().GetIndex();
+  InputImageIndexType           largestIndex = smallestIndex + this->GetCroppedInputImageRegion().GetSize() - unitSize;
+  InputImageContinuousIndexType smallestImageContIndex(smallestIndex);
+  InputImageContinuousIndexType largestImageContIndex(largestIndex);
+  InputImageContinuousIndexType smallestContIndex;
+  InputImageContinuousIndexType largestContIndex;
+  this->GenerateSampleRegion(smallestImageContIndex, largestImageContIndex, smallestContIndex, largestContIndex);
+
+  /** Reserve memory for the output, and for the tile numbers of the samples. */
+  const unsigned long numberOfSamples = this->GetNumberOfSamples();
+  sampleContainer->Reserve(numberOfSamples);
+  std::vector<std::pair<SizeValueType, unsigned long>> tileNumbers(numberOfSamples);
+
+  /** Draw the samples that are inside the tiled image and the mask. */
+  typedef typename TileCacheType::ContinuousIndexType TileContinuousIndexType;
+  unsigned long                                       numberOfSamplesTried = 0;
+  const unsigned long                                 maximumNumberOfSamplesToTry = 10 * numberOfSamples;
+  InputImageContinuousIndexType                       sampleContIndex;
+  TileContinuousIndexType                             tileContIndex;
+  for (unsigned long i = 0; i < numberOfSamples; ++i)
+  {
+    InputImagePointType & samplePoint = sampleContainer->ElementAt(i).m_ImageCoordinates;
+    do
+    {
+      /** Check if we are not trying eternally to find a valid point. */
+      ++numberOfSamplesTried;
+      if (numberOfSamplesTried > maximumNumberOfSamplesToTry)
+      {
+        /** Squeeze the sample container to the size that is still valid. */
+        sampleContainer->erase(sampleContainer->begin() + i, sampleContainer->end());
+        itkExceptionMacro(<< "Could not find enough image samples within reasonable time. "
+                          << "Probably the mask is too small, or the tiled image does not overlap the input image");
+      }
+
+      this->GenerateRandomCoordinate(smallestContIndex, largestContIndex, sampleContIndex);
+      inputImage->TransformContinuousIndexToPhysicalPoint(sampleContIndex, samplePoint);
+
+    } while (!tileCache.TransformPhysicalPointToContinuousIndex(samplePoint, tileContIndex) ||
+             (mask.IsNotNull() && !this->IsInsideMask(samplePoint)));
+
+    tileNumbers[i] = std::make_pair(tileCache.ComputeTileNumber(tileContIndex), i);
+  }
+
+  /** Evaluate the samples tile by tile, so that the tiles are read in order, and mostly only once. */
+  std::sort(tileNumbers.begin(), tileNumbers.end());
+  for (const auto & tileNumber : tileNumbers)
+  {
+    ImageSampleType & sample = sampleContainer->ElementAt(tileNumber.second);
+    tileCache.TransformPhysicalPointToContinuousIndex(sample.m_ImageCoordinates, tileContIndex);
+    sample.m_ImageValue = static_cast<ImageSampleValueType>(tileCache.EvaluateAtContinuousIndex(tileContIndex));
+  }
+
+  /** Sort the samples, if desired. */
+  this->SortOutputSamples();
+
+} // end GenerateDataFromTiles()
+
+
 /**
  * ******************* BeforeThreadedGenerateData *******************
  */
@@ -173,7 +266,12 @@ ImageRandomCoordinateSampler<TInputImage>::BeforeThreadedGenerateData(void)
 
   /** Clear the random number list. */
   this->m_RandomNumberList.resize(0);
-  this->m_RandomNumberList.reserve(this->m_NumberOfSamples * InputImageDimension);
+
+  /** Select the iteration of the counter-based random numbers, before the sample region is generated. */
+  if (this->m_UseCounterBasedRandomNumbers)
+  {
+    this->InitializeCounterBasedRandomNumbers();
+  }
 
   /** Convert inputImageRegion to bounding box in physical space. */
   InputImageSizeType unitSize;
@@ -184,24 +282,25 @@ ImageRandomCoordinateSampler<TInputImage>::BeforeThreadedGenerateData(void)
   InputImageContinuousIndexType largestImageCIndex(largestIndex);
   InputImageContinuousIndexType smallestCIndex, largestCIndex, randomCIndex;
   this->GenerateSampleRegion(smallestImageCIndex, largestImageCIndex, smallestCIndex, largestCIndex);
+  this->m_SmallestSampleRegionContIndex = smallestCIndex;
+  this->m_LargestSampleRegionContIndex = largestCIndex;
 
-  /** Fill the list with random numbers. */
-  for (unsigned long i = 0; i < this->m_NumberOfSamples; ++i)
+  /** Fill the list with random numbers. The counter-based random numbers are computed by the threads. */
+  if (!this->m_UseCounterBasedRandomNumbers)
   {
-    this->GenerateRandomCoordinate(smallestCIndex, largestCIndex, randomCIndex);
-    for (unsigned int j = 0; j < InputImageDimension; ++j)
+    this->m_RandomNumberList.reserve(this->m_NumberOfSamples * InputImageDimension);
+    for (unsigned long i = 0; i < this->m_NumberOfSamples; ++i)
     {
-      this->m_RandomNumberList.push_back(randomCIndex[j]);
+      this->GenerateRandomCoordinate(smallestCIndex, largestCIndex, randomCIndex);
+      for (unsigned int j = 0; j < InputImageDimension; ++j)
+      {
+        this->m_RandomNumberList.push_back(randomCIndex[j]);
+      }
     }
   }
 
   /** Initialize variables needed for threads. */
-  this->m_ThreaderSampleContainer.clear();
-  this->m_ThreaderSampleContainer.resize(this->GetNumberOfWorkUnits());
-  for (std::size_t i = 0; i < this->GetNumberOfWorkUnits(); ++i)
-  {
-    this->m_ThreaderSampleContainer[i] = ImageSampleContainerType::New();
-  }
+  this->ResetThreaderSampleContainers();
 
 } // end BeforeThreadedGenerateData()
 
@@ -242,14 +341,24 @@ ImageRandomCoordinateSampler<TInputImage>::ThreadedGenerateData(const InputImage
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
   /** Fill the local sample container. */
-  InputImageContinuousIndexType sampleCIndex;
-  unsigned long                 sampleId = sampleStart;
+  const InputImageContinuousIndexType & smallestCIndex = this->m_SmallestSampleRegionContIndex;
+  const InputImageContinuousIndexType & largestCIndex = this->m_LargestSampleRegionContIndex;
+  InputImageContinuousIndexType         sampleCIndex;
+  unsigned long                         sampleId = sampleStart;
   for (iter = sampleContainerThisThread->Begin(); iter != end; ++iter)
   {
     /** Create a random point out of InputImageDimension random numbers. */
-    for (unsigned int j = 0; j < InputImageDimension; ++j, sampleId++)
+    if (this->m_UseCounterBasedRandomNumbers)
     {
-      sampleCIndex[j] = this->m_RandomNumberList[sampleId];
+      this->GenerateCounterBasedCoordinate(sampleId / InputImageDimension, smallestCIndex, largestCIndex, sampleCIndex);
+      sampleId += InputImageDimension;
+    }
+    else
+    {
+      for (unsigned int j = 0; j < InputImageDimension; ++j, sampleId++)
+      {
+        sampleCIndex[j] = this->m_RandomNumberList[sampleId];
+      }
     }
 
     /** Make a reference to the current sample in the container. */
@@ -286,6 +395,27 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateRandomCoordinate(
 } // end GenerateRandomCoordinate()
 
 
+/**
+ * ******************* GenerateCounterBasedCoordinate *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomCoordinateSampler<TInputImage>::GenerateCounterBasedCoordinate(
+  const unsigned long                   sampleNumber,
+  const InputImageContinuousIndexType & smallestContIndex,
+  const InputImageContinuousIndexType & largestContIndex,
+  InputImageContinuousIndexType &       randomContIndex) const
+{
+  for (unsigned int i = 0; i < InputImageDimension; ++i)
+  {
+    const double randomVariate = this->GetCounterBasedRandomVariate(sampleNumber, i);
+    randomContIndex[i] = static_cast<InputImagePointValueType>(
+      smallestContIndex[i] + randomVariate * (largestContIndex[i] - smallestContIndex[i]));
+  }
+} // end GenerateCounterBasedCoordinate()
+
+
 /**
  * ******************* GenerateSampleRegion *******************
  */
@@ -321,7 +451,22 @@ ImageRandomCoordinateSampler<TInputImage>::GenerateSampleRegion(
     maxSmallestContIndex[i] = std::max(maxSmallestContIndex[i], smallestImageContIndex[i]);
   }
 
-  this->GenerateRandomCoordinate(smallestImageContIndex, maxSmallestContIndex, smallestContIndex);
+  /** In the multi-threaded version, the counter-based random numbers of the region are stored
+   * in the streams following those of the sample coordinates.
+   */
+  if (this->m_UseCounterBasedRandomNumbers && this->GetMask().IsNull())
+  {
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      const double randomVariate = this->GetCounterBasedRandomVariate(0, InputImageDimension + i);
+      smallestContIndex[i] = static_cast<InputImagePointValueType>(
+        smallestImageContIndex[i] + randomVariate * (maxSmallestContIndex[i] - smallestImageContIndex[i]));
+    }
+  }
+  else
+  {
+    this->GenerateRandomCoordinate(smallestImageContIndex, maxSmallestContIndex, smallestContIndex);
+  }
   largestContIndex = smallestContIndex;
   largestContIndex += sampleRegionSize;
 
@@ -340,6 +485,7 @@ ImageRandomCoordinateSampler<TInputImage>::PrintSelf(std::ostream & os, Indent i
 
   os << indent << "Interpolator: " << this->m_Interpolator.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
+  os << indent << "TileCache: " << this->m_TileCache.GetPointer() << std::endl;
 
 } // end PrintSelf()
 
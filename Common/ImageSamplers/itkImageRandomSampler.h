@@ -20,6 +20,9 @@
 
 #include "itkImageRandomSamplerBase.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace itk
 {
 /** \class ImageRandomSampler
@@ -32,6 +35,15 @@ namespace itk
  * mask. If the mask is very sparse, this may take some time. In this case,
  * consider using the ImageRandomSamplerSparseMask.
  *
+ * With the counter-based random numbers and a mask that has a bit-packed copy,
+ * see ImageSamplerBase::HasBitPackedMask(), the samples are drawn by multiple
+ * threads as well. When the fraction of the bounding box of the mask that is
+ * inside the mask is below the SparseMaskFillRatio, the samples are then drawn
+ * directly from the list of voxels inside the mask, like the
+ * ImageRandomSamplerSparseMask does. Otherwise, each sample is drawn until it is
+ * inside the mask, with the attempt as stream of the random numbers, so that the
+ * samples do not depend on the number of threads either way.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -74,6 +86,13 @@ public:
   typedef typename InputImageType::IndexType InputImageIndexType;
   typedef typename InputImageType::PointType InputImagePointType;
 
+  /** Set/Get the fill ratio of the mask below which the threads draw the samples from the
+   * list of voxels inside the mask, instead of drawing random voxels until they are inside
+   * the mask. Default 0.1.
+   */
+  itkSetMacro(SparseMaskFillRatio, double);
+  itkGetConstMacro(SparseMaskFillRatio, double);
+
 protected:
   /** The constructor. */
   ImageRandomSampler() = default;
@@ -87,12 +106,34 @@ protected:
   void
   ThreadedGenerateData(const InputImageRegionType & inputRegionForThread, ThreadIdType threadId) override;
 
+  /** Reports the samples for which no voxel inside the mask was found. */
+  void
+  AfterThreadedGenerateData(void) override;
+
+  /** Draws the samples of a thread inside the mask, with the counter-based random numbers of the
+   * samples starting at sampleStart. Returns false when no voxel inside the mask was found for a sample.
+   */
+  bool
+  ThreadedGenerateDataInsideMask(const unsigned long sampleStart, ImageSampleContainerType & sampleContainer) const;
+
+  /** Returns the index of the voxel at the given linear position in the cropped input image region. */
+  InputImageIndexType
+  GetIndexOfPosition(unsigned long position) const;
+
 private:
   /** The deleted copy constructor. */
   ImageRandomSampler(const Self &) = delete;
   /** The deleted assignment operator. */
   void
   operator=(const Self &) = delete;
+
+  double m_SparseMaskFillRatio{ 0.1 };
+
+  /** Whether the threads draw from the list of voxels inside the mask in this generation. */
+  bool m_UseMaskRuns{ false };
+
+  /** Per thread, whether a sample was found for which no voxel inside the mask was found. */
+  std::vector<std::uint8_t> m_ThreaderMaskFailure;
 };
 
 } // end namespace itk
@@ -23,6 +23,8 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkImageRandomConstIteratorWithIndex.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -34,14 +36,37 @@ template <class TInputImage>
 void
 ImageRandomSampler<TInputImage>::GenerateData(void)
 {
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version.
+   * The counter-based random numbers are only generated by the multi-threaded version.
+   */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if (mask.IsNull() && this->m_UseMultiThread)
+  this->m_ThreaderMaskFailure.clear();
+  if (mask.IsNull() && (this->m_UseMultiThread || this->m_UseCounterBasedRandomNumbers))
   {
     /** Calls ThreadedGenerateData(). */
     return Superclass::GenerateData();
   }
 
+  /** With a mask, the threads draw the counter-based random numbers, and check the bit-packed
+   * mask, which is thread-safe. A sparse mask is sampled from the list of voxels inside it.
+   */
+  if (mask.IsNotNull() && this->m_UseCounterBasedRandomNumbers && this->HasBitPackedMask())
+  {
+    this->m_UseMaskRuns = this->GetMaskFillRatio() < this->m_SparseMaskFillRatio;
+    if (this->m_UseMaskRuns)
+    {
+      this->UpdateMaskRuns();
+      if (this->GetNumberOfValidSamples() == 0)
+      {
+        itkExceptionMacro(<< "ERROR: there are no voxels inside the mask.");
+      }
+    }
+    this->m_ThreaderMaskFailure.assign(this->GetNumberOfWorkUnits(), 0);
+
+    /** Calls ThreadedGenerateData(). */
+    return Superclass::GenerateData();
+  }
+
   /** Get handles to the input image, output sample container. */
   InputImageConstPointer                     inputImage = this->GetInput();
   typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
@@ -112,7 +137,7 @@ ImageRandomSampler<TInputImage>::GenerateData(void)
         InputImageIndexType index = randIter.GetIndex();
         inputImage->TransformIndexToPhysicalPoint(index, inputPoint);
         /** Check if it's inside the mask. */
-        insideMask = mask->IsInsideInWorldSpace(inputPoint);
+        insideMask = this->IsInsideMask(inputPoint);
       } while (!insideMask);
 
       /** Put the coordinates and the value in the sample. */
@@ -127,6 +152,9 @@ ImageRandomSampler<TInputImage>::GenerateData(void)
     ++randIter;
   }
 
+  /** Sort the samples, if desired. */
+  this->SortOutputSamples();
+
 } // end GenerateData()
 
 
@@ -138,13 +166,6 @@ template <class TInputImage>
 void
 ImageRandomSampler<TInputImage>::ThreadedGenerateData(const InputImageRegionType &, ThreadIdType threadId)
 {
-  /** Sanity check. */
-  typename MaskType::ConstPointer mask = this->GetMask();
-  if (mask.IsNotNull())
-  {
-    itkExceptionMacro(<< "ERROR: do not call this function when a mask is supplied.");
-  }
-
   /** Get handle to the input image. */
   InputImageConstPointer inputImage = this->GetInput();
 
@@ -160,30 +181,40 @@ ImageRandomSampler<TInputImage>::ThreadedGenerateData(const InputImageRegionType
   ImageSampleContainerPointer & sampleContainerThisThread = this->m_ThreaderSampleContainer[threadId];
   sampleContainerThisThread->Reserve(chunkSize);
 
+  /** With a mask, see GenerateData(). */
+  if (this->GetMask().IsNotNull())
+  {
+    if (!this->ThreadedGenerateDataInsideMask(sampleStart, *sampleContainerThisThread))
+    {
+      this->m_ThreaderMaskFailure[threadId] = 1;
+    }
+    return;
+  }
+
   /** Setup an iterator over the sampleContainerThisThread. */
   typename ImageSampleContainerType::Iterator      iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
   /** Fill the local sample container. */
   unsigned long       sampleId = sampleStart;
-  InputImageSizeType  regionSize = this->GetCroppedInputImageRegion().GetSize();
-  InputImageIndexType regionIndex = this->GetCroppedInputImageRegion().GetIndex();
+  const unsigned long numberOfPixels = this->GetCroppedInputImageRegion().GetNumberOfPixels();
   for (iter = sampleContainerThisThread->Begin(); iter != end; ++iter, sampleId++)
   {
-    unsigned long randomPosition = static_cast<unsigned long>(this->m_RandomNumberList[sampleId]);
-
-    /** Translate randomPosition to an index, copied from ImageRandomConstIteratorWithIndex. */
-    unsigned long       residual;
-    InputImageIndexType positionIndex;
-    for (unsigned int dim = 0; dim < InputImageDimension; ++dim)
+    unsigned long randomPosition = 0;
+    if (this->m_UseCounterBasedRandomNumbers)
+    {
+      /** The min() guards against rounding up to numberOfPixels. */
+      randomPosition = std::min(
+        static_cast<unsigned long>(this->GetCounterBasedRandomVariate(sampleId, 0) * numberOfPixels),
+        numberOfPixels - 1);
+    }
+    else
     {
-      const unsigned long sizeInThisDimension = regionSize[dim];
-      residual = randomPosition % sizeInThisDimension;
-      positionIndex[dim] = residual + regionIndex[dim];
-      randomPosition -= residual;
-      randomPosition /= sizeInThisDimension;
+      randomPosition = static_cast<unsigned long>(this->m_RandomNumberList[sampleId]);
     }
 
+    const InputImageIndexType positionIndex = this->GetIndexOfPosition(randomPosition);
+
     /** Transform index to the physical coordinates and put it in the sample. */
     inputImage->TransformIndexToPhysicalPoint(positionIndex, (*iter).Value().m_ImageCoordinates);
 
@@ -195,6 +226,112 @@ ImageRandomSampler<TInputImage>::ThreadedGenerateData(const InputImageRegionType
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* ThreadedGenerateDataInsideMask *******************
+ */
+
+template <class TInputImage>
+bool
+ImageRandomSampler<TInputImage>::ThreadedGenerateDataInsideMask(const unsigned long        sampleStart,
+                                                                ImageSampleContainerType & sampleContainer) const
+{
+  /** A fill ratio of at least the SparseMaskFillRatio practically always gives a voxel inside the mask. */
+  const unsigned int maximumNumberOfAttempts = 1000;
+
+  InputImageConstPointer inputImage = this->GetInput();
+  const unsigned long    numberOfPixels = this->GetCroppedInputImageRegion().GetNumberOfPixels();
+  const std::uint64_t    numberOfValidSamples = this->GetNumberOfValidSamples();
+
+  typename ImageSampleContainerType::Iterator      iter;
+  typename ImageSampleContainerType::ConstIterator end = sampleContainer.End();
+  unsigned long                                    sampleId = sampleStart;
+  for (iter = sampleContainer.Begin(); iter != end; ++iter, sampleId++)
+  {
+    /** Take the sample from the voxels inside the mask, as the ImageRandomSamplerSparseMask does. */
+    if (this->m_UseMaskRuns)
+    {
+      const double randomVariate = this->GetCounterBasedRandomVariate(sampleId, 0);
+      this->GetValidSample(
+        std::min(static_cast<std::uint64_t>(randomVariate * numberOfValidSamples), numberOfValidSamples - 1),
+        (*iter).Value());
+      continue;
+    }
+
+    /** Draw voxels until one is inside the mask, each attempt with its own random stream. */
+    bool insideMask = false;
+    for (unsigned int attempt = 0; attempt < maximumNumberOfAttempts && !insideMask; ++attempt)
+    {
+      const unsigned long randomPosition = std::min(
+        static_cast<unsigned long>(this->GetCounterBasedRandomVariate(sampleId, attempt) * numberOfPixels),
+        numberOfPixels - 1);
+      const InputImageIndexType index = this->GetIndexOfPosition(randomPosition);
+      InputImagePointType &     point = (*iter).Value().m_ImageCoordinates;
+      inputImage->TransformIndexToPhysicalPoint(index, point);
+      insideMask = this->IsInsideMask(point);
+      if (insideMask)
+      {
+        (*iter).Value().m_ImageValue = static_cast<ImageSampleValueType>(inputImage->GetPixel(index));
+      }
+    }
+    if (!insideMask)
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end ThreadedGenerateDataInsideMask()
+
+
+/**
+ * ******************* AfterThreadedGenerateData *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomSampler<TInputImage>::AfterThreadedGenerateData(void)
+{
+  /** Checked first, because the superclass adapts the number of samples to the samples of the threads. */
+  for (const std::uint8_t failure : this->m_ThreaderMaskFailure)
+  {
+    if (failure != 0)
+    {
+      this->GetOutput()->clear();
+      itkExceptionMacro(<< "Could not find enough image samples within "
+                        << "reasonable time. Probably the mask is too small");
+    }
+  }
+
+  Superclass::AfterThreadedGenerateData();
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* GetIndexOfPosition *******************
+ */
+
+template <class TInputImage>
+typename ImageRandomSampler<TInputImage>::InputImageIndexType
+ImageRandomSampler<TInputImage>::GetIndexOfPosition(unsigned long position) const
+{
+  /** Translate the position to an index, copied from ImageRandomConstIteratorWithIndex. */
+  const InputImageSizeType &  regionSize = this->GetCroppedInputImageRegion().GetSize();
+  const InputImageIndexType & regionIndex = this->GetCroppedInputImageRegion().GetIndex();
+  InputImageIndexType         positionIndex;
+  for (unsigned int dim = 0; dim < InputImageDimension; ++dim)
+  {
+    const unsigned long sizeInThisDimension = regionSize[dim];
+    const unsigned long residual = position % sizeInThisDimension;
+    positionIndex[dim] = residual + regionIndex[dim];
+    position -= residual;
+    position /= sizeInThisDimension;
+  }
+  return positionIndex;
+
+} // end GetIndexOfPosition()
+
+
 } // end namespace itk
 
 #endif // end #ifndef itkImageRandomSampler_hxx
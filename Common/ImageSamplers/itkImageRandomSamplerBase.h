@@ -19,6 +19,10 @@
 #define itkImageRandomSamplerBase_h
 
 #include "itkImageSamplerBase.h"
+#include "itkPhiloxRandomNumberGenerator.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace itk
 {
@@ -29,6 +33,17 @@ namespace itk
  *
  * It adds the Set/GetNumberOfSamples function.
  *
+ * Optionally, the random numbers are taken from a counter-based generator
+ * (PhiloxRandomNumberGenerator) instead of the Mersenne Twister. Each random
+ * number then only depends on the seed, the iteration and the sample number,
+ * so that the samples are identical for any number of threads. The iteration
+ * is incremented each time that the samples are generated. This option only
+ * affects the multi-threaded code paths.
+ *
+ * For samplers that draw voxels inside a mask, the voxels inside the mask can be
+ * listed once as runs of consecutive voxels, see UpdateMaskRuns(), from which the
+ * samples are then drawn directly.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -61,10 +76,31 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::InputImageSizeType           InputImageSizeType;
 
   /** The input image dimension. */
   itkStaticConstMacro(InputImageDimension, unsigned int, Superclass::InputImageDimension);
 
+  /** Other typedefs. */
+  typedef typename InputImageType::IndexType InputImageIndexType;
+  typedef typename InputImageType::PointType InputImagePointType;
+  typedef typename ImageSampleType::RealType ImageSampleValueType;
+
+  /** Set/Get whether to use the counter-based random number generator. Default: false. */
+  itkSetMacro(UseCounterBasedRandomNumbers, bool);
+  itkGetConstMacro(UseCounterBasedRandomNumbers, bool);
+  itkBooleanMacro(UseCounterBasedRandomNumbers);
+
+  /** Set/Get the seed of the counter-based random number generator. Default: 121212. */
+  itkSetMacro(RandomSeed, std::uint32_t);
+  itkGetConstMacro(RandomSeed, std::uint32_t);
+
+  /** Set/Get the iteration that is used by the next generation of samples.
+   * Set it to regenerate the samples of an earlier iteration.
+   */
+  itkSetMacro(RandomIteration, std::uint64_t);
+  itkGetConstMacro(RandomIteration, std::uint64_t);
+
 protected:
   /** The constructor. */
   ImageRandomSamplerBase();
@@ -80,15 +116,67 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Selects the iteration for the counter-based random numbers of this generation of samples.
+   * Call once, before generating the samples.
+   */
+  void
+  InitializeCounterBasedRandomNumbers(void);
+
+  /** Returns a random number in [0, 1) for the given sample and stream, from the
+   * counter-based random number generator. Thread-safe.
+   */
+  double
+  GetCounterBasedRandomVariate(const unsigned long sampleId, const unsigned int stream) const
+  {
+    return PhiloxRandomNumberGenerator::GetUniformVariate(
+      this->m_RandomSeed, this->m_CurrentRandomIteration, sampleId, stream);
+  }
+
+  /** Computes the runs of voxels inside the mask, in the cropped input image region, unless
+   * they are still up-to-date. Used to draw samples directly from the voxels inside the mask.
+   */
+  void
+  UpdateMaskRuns(void);
+
+  /** Gets the sample of the in-mask voxel with the given number, in [0, GetNumberOfValidSamples()). */
+  void
+  GetValidSample(const std::uint64_t validSampleId, ImageSampleType & sample) const;
+
+  /** Returns the number of voxels inside the mask. */
+  std::uint64_t
+  GetNumberOfValidSamples(void) const
+  {
+    return this->m_MaskRunEnds.empty() ? 0 : this->m_MaskRunEnds.back();
+  }
+
   /** Member variable used when threading. */
   std::vector<double> m_RandomNumberList;
 
+  bool          m_UseCounterBasedRandomNumbers;
+  std::uint32_t m_RandomSeed;
+  std::uint64_t m_RandomIteration;
+  std::uint64_t m_CurrentRandomIteration;
+
 private:
   /** The deleted copy constructor. */
   ImageRandomSamplerBase(const Self &) = delete;
   /** The deleted assignment operator. */
   void
   operator=(const Self &) = delete;
+
+  /** The runs of voxels inside the mask. A run starts at the linear offset m_MaskRunOffsets[i]
+   * in the cropped input image region. The runs are numbered consecutively, so that run i
+   * contains the valid samples [m_MaskRunEnds[i-1], m_MaskRunEnds[i]).
+   */
+  std::vector<std::uint64_t> m_MaskRunOffsets;
+  std::vector<std::uint64_t> m_MaskRunEnds;
+
+  /** The inputs for which the runs were computed. */
+  const InputImageType * m_MaskRunsInputImage;
+  const MaskType *       m_MaskRunsMask;
+  ModifiedTimeType       m_MaskRunsInputImageMTime;
+  ModifiedTimeType       m_MaskRunsMaskMTime;
+  InputImageRegionType   m_MaskRunsRegion;
 };
 
 } // end namespace itk
@@ -22,6 +22,9 @@
 
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkImageRandomConstIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm> // For upper_bound.
 
 namespace itk
 {
@@ -34,6 +37,15 @@ template <class TInputImage>
 ImageRandomSamplerBase<TInputImage>::ImageRandomSamplerBase()
 {
   this->m_NumberOfSamples = 1000;
+  this->m_UseCounterBasedRandomNumbers = false;
+  this->m_RandomSeed = 121212;
+  this->m_RandomIteration = 0;
+  this->m_CurrentRandomIteration = 0;
+  this->m_MaskRunsInputImage = nullptr;
+  this->m_MaskRunsMask = nullptr;
+  this->m_MaskRunsInputImageMTime = 0;
+  this->m_MaskRunsMaskMTime = 0;
+  this->m_MortonOrderSortingSupported = true;
 
 } // end Constructor
 
@@ -46,6 +58,15 @@ template <class TInputImage>
 void
 ImageRandomSamplerBase<TInputImage>::BeforeThreadedGenerateData(void)
 {
+  /** The counter-based random numbers are computed on the fly by the threads. */
+  if (this->m_UseCounterBasedRandomNumbers)
+  {
+    this->InitializeCounterBasedRandomNumbers();
+    this->m_RandomNumberList.clear();
+    Superclass::BeforeThreadedGenerateData();
+    return;
+  }
+
   /** Create a random number generator. Also used in the ImageRandomConstIteratorWithIndex. */
   typedef typename Statistics::MersenneTwisterRandomVariateGenerator::Pointer GeneratorPointer;
   GeneratorPointer localGenerator = Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
@@ -71,6 +92,118 @@ ImageRandomSamplerBase<TInputImage>::BeforeThreadedGenerateData(void)
 } // end BeforeThreadedGenerateData()
 
 
+/**
+ * ******************* InitializeCounterBasedRandomNumbers *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomSamplerBase<TInputImage>::InitializeCounterBasedRandomNumbers(void)
+{
+  /** Not calling Modified(): the next iteration only takes effect when the samples are regenerated. */
+  this->m_CurrentRandomIteration = this->m_RandomIteration;
+  ++this->m_RandomIteration;
+
+} // end InitializeCounterBasedRandomNumbers()
+
+
+/**
+ * ******************* UpdateMaskRuns *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomSamplerBase<TInputImage>::UpdateMaskRuns(void)
+{
+  InputImageConstPointer          inputImage = this->GetInput();
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if (mask->GetSource())
+  {
+    mask->GetSource()->Update();
+  }
+
+  /** Check if the runs can be reused. */
+  const InputImageRegionType & region = this->GetCroppedInputImageRegion();
+  if (inputImage.GetPointer() == this->m_MaskRunsInputImage && mask.GetPointer() == this->m_MaskRunsMask &&
+      inputImage->GetMTime() == this->m_MaskRunsInputImageMTime && mask->GetMTime() == this->m_MaskRunsMaskMTime &&
+      region == this->m_MaskRunsRegion)
+  {
+    return;
+  }
+
+  this->m_MaskRunOffsets.clear();
+  this->m_MaskRunEnds.clear();
+
+  /** Loop over the region and store the runs of consecutive voxels that are inside the mask. */
+  typedef ImageRegionConstIteratorWithIndex<InputImageType> IteratorType;
+  IteratorType                                              iter(inputImage, region);
+  InputImagePointType                                       point;
+  std::uint64_t                                             numberOfValidSamples = 0;
+  bool                                                      previousInside = false;
+  std::uint64_t                                             offset = 0;
+  for (iter.GoToBegin(); !iter.IsAtEnd(); ++iter, ++offset)
+  {
+    inputImage->TransformIndexToPhysicalPoint(iter.GetIndex(), point);
+    const bool inside = this->IsInsideMask(point);
+    if (inside)
+    {
+      if (!previousInside)
+      {
+        this->m_MaskRunOffsets.push_back(offset);
+        this->m_MaskRunEnds.push_back(numberOfValidSamples);
+      }
+      ++numberOfValidSamples;
+      this->m_MaskRunEnds.back() = numberOfValidSamples;
+    }
+    previousInside = inside;
+  }
+
+  /** Release the memory that was reserved in excess. */
+  std::vector<std::uint64_t>(this->m_MaskRunOffsets).swap(this->m_MaskRunOffsets);
+  std::vector<std::uint64_t>(this->m_MaskRunEnds).swap(this->m_MaskRunEnds);
+
+  this->m_MaskRunsInputImage = inputImage.GetPointer();
+  this->m_MaskRunsMask = mask.GetPointer();
+  this->m_MaskRunsInputImageMTime = inputImage->GetMTime();
+  this->m_MaskRunsMaskMTime = mask->GetMTime();
+  this->m_MaskRunsRegion = region;
+
+} // end UpdateMaskRuns()
+
+
+/**
+ * ******************* GetValidSample *******************
+ */
+
+template <class TInputImage>
+void
+ImageRandomSamplerBase<TInputImage>::GetValidSample(const std::uint64_t validSampleId,
+                                                     ImageSampleType &   sample) const
+{
+  /** Find the run that contains the sample, and the offset of the sample in the region. */
+  const auto          runEnd = std::upper_bound(this->m_MaskRunEnds.begin(), this->m_MaskRunEnds.end(), validSampleId);
+  const std::size_t   run = runEnd - this->m_MaskRunEnds.begin();
+  const std::uint64_t runBegin = (run == 0) ? 0 : this->m_MaskRunEnds[run - 1];
+  std::uint64_t       offset = this->m_MaskRunOffsets[run] + (validSampleId - runBegin);
+
+  /** Translate the offset to an index, as in the ImageRandomSampler. */
+  const InputImageSizeType &  regionSize = this->m_MaskRunsRegion.GetSize();
+  const InputImageIndexType & regionIndex = this->m_MaskRunsRegion.GetIndex();
+  InputImageIndexType         index;
+  for (unsigned int dim = 0; dim < InputImageDimension; ++dim)
+  {
+    index[dim] = static_cast<IndexValueType>(offset % regionSize[dim]) + regionIndex[dim];
+    offset /= regionSize[dim];
+  }
+
+  /** Put the coordinates and the value in the sample. */
+  const InputImageType * inputImage = this->m_MaskRunsInputImage;
+  inputImage->TransformIndexToPhysicalPoint(index, sample.m_ImageCoordinates);
+  sample.m_ImageValue = static_cast<ImageSampleValueType>(inputImage->GetPixel(index));
+
+} // end GetValidSample()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -82,6 +215,11 @@ ImageRandomSamplerBase<TInputImage>::PrintSelf(std::ostream & os, Indent indent)
   Superclass::PrintSelf(os, indent);
 
   os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+  os << indent << "UseCounterBasedRandomNumbers: " << this->m_UseCounterBasedRandomNumbers << std::endl;
+  os << indent << "RandomSeed: " << this->m_RandomSeed << std::endl;
+  os << indent << "RandomIteration: " << this->m_RandomIteration << std::endl;
+  os << indent << "NumberOfMaskRuns: " << this->m_MaskRunOffsets.size() << std::endl;
+  os << indent << "NumberOfValidSamples: " << this->GetNumberOfValidSamples() << std::endl;
 
 } // end PrintSelf()
 
@@ -20,7 +20,9 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageFullSampler.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace itk
 {
@@ -30,7 +32,11 @@ namespace itk
  *
  * This version takes into account that the mask may be very small.
  * Also, it may be more efficient when very many different sample sets
- * of the same input image are required, because it does some precomputation.
+ * of the same input image are required, because it does some precomputation:
+ * the voxels inside the mask are stored once as a list of runs of consecutive
+ * voxels, see ImageRandomSamplerBase::UpdateMaskRuns(). This list is reused as long
+ * as the input image, the mask and the input image region do not change, so
+ * typically for all iterations of a resolution.
  * \ingroup ImageSamplers
  */
 
@@ -70,15 +76,14 @@ public:
   /** Other typdefs. */
   typedef typename InputImageType::IndexType InputImageIndexType;
   typedef typename InputImageType::PointType InputImagePointType;
+  typedef typename InputImageType::SizeType  InputImageSizeType;
+  typedef typename ImageSampleType::RealType ImageSampleValueType;
 
   /** The random number generator used to generate random indices. */
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
   typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
 
 protected:
-  typedef itk::ImageFullSampler<InputImageType>     InternalFullSamplerType;
-  typedef typename InternalFullSamplerType::Pointer InternalFullSamplerPointer;
-
   /** The constructor. */
   ImageRandomSamplerSparseMask();
   /** The destructor. */
@@ -99,8 +104,7 @@ protected:
   void
   ThreadedGenerateData(const InputImageRegionType & inputRegionForThread, ThreadIdType threadId) override;
 
-  RandomGeneratorPointer     m_RandomGenerator;
-  InternalFullSamplerPointer m_InternalFullSampler;
+  RandomGeneratorPointer m_RandomGenerator;
 
 private:
   /** The deleted copy constructor. */
@@ -20,6 +20,8 @@
 
 #include "itkImageRandomSamplerSparseMask.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -33,8 +35,6 @@ ImageRandomSamplerSparseMask<TInputImage>::ImageRandomSamplerSparseMask()
   /** Setup random generator. */
   this->m_RandomGenerator = RandomGeneratorType::GetInstance();
 
-  this->m_InternalFullSampler = InternalFullSamplerType::New();
-
 } // end Constructor
 
 
@@ -55,62 +55,38 @@ ImageRandomSamplerSparseMask<TInputImage>::GenerateData(void)
     itkExceptionMacro(<< "ERROR: do not call this function when no mask is supplied.");
   }
 
-  /** Get handles to the input image and output sample container. */
-  InputImageConstPointer      inputImage = this->GetInput();
+  /** Get handle to the output sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetOutput();
 
   /** Clear the container. */
   sampleContainer->Initialize();
 
-  /** Make sure the internal full sampler is up-to-date. */
-  this->m_InternalFullSampler->SetInput(inputImage);
-  this->m_InternalFullSampler->SetMask(mask);
-  this->m_InternalFullSampler->SetInputImageRegion(this->GetCroppedInputImageRegion());
-
-  /** Use try/catch, since the full sampler may crash, due to insufficient memory. */
-  try
+  /** Make sure the runs of voxels inside the mask are up-to-date. */
+  this->UpdateMaskRuns();
+  const std::uint64_t numberOfValidSamples = this->GetNumberOfValidSamples();
+  if (numberOfValidSamples == 0)
   {
-    this->m_InternalFullSampler->Update();
-  }
-  catch (ExceptionObject & err)
-  {
-    std::string message = "ERROR: This ImageSampler internally uses the "
-                          "ImageFullSampler. Updating of this internal sampler raised the "
-                          "exception:\n";
-    message += err.GetDescription();
-
-    std::string            fullSamplerMessage = err.GetDescription();
-    std::string::size_type loc =
-      fullSamplerMessage.find("ERROR: failed to allocate memory for the sample container", 0);
-    if (loc != std::string::npos && this->GetMask() == nullptr)
-    {
-      message += "\nYou are using the ImageRandomSamplerSparseMask sampler, "
-                 "but you did not set a mask. The internal ImageFullSampler therefore "
-                 "requires a lot of memory. Consider using the ImageRandomSampler "
-                 "instead.";
-    }
-    const char * message2 = message.c_str();
-    itkExceptionMacro(<< message2);
+    itkExceptionMacro(<< "ERROR: there are no voxels inside the mask.");
   }
 
   /** If desired we exercise a multi-threaded version. */
-  if (this->m_UseMultiThread)
+  if (this->m_UseMultiThread || this->m_UseCounterBasedRandomNumbers)
   {
     /** Calls ThreadedGenerateData(). */
     return Superclass::GenerateData();
   }
 
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples = this->m_InternalFullSampler->GetOutput();
-  unsigned long                              numberOfValidSamples = allValidSamples->Size();
-
-  /** Take random samples from the allValidSamples-container. */
+  /** Take random samples from the voxels inside the mask. */
+  sampleContainer->Reserve(this->GetNumberOfSamples());
   for (unsigned int i = 0; i < this->GetNumberOfSamples(); ++i)
   {
     unsigned long randomIndex = this->m_RandomGenerator->GetIntegerVariate(numberOfValidSamples - 1);
-    sampleContainer->push_back(allValidSamples->ElementAt(randomIndex));
+    this->GetValidSample(randomIndex, sampleContainer->ElementAt(i));
   }
 
+  /** Sort the samples, if desired. */
+  this->SortOutputSamples();
+
 } // end GenerateData()
 
 
@@ -124,26 +100,27 @@ ImageRandomSamplerSparseMask<TInputImage>::BeforeThreadedGenerateData(void)
 {
   /** Clear the random number list. */
   this->m_RandomNumberList.resize(0);
-  this->m_RandomNumberList.reserve(this->m_NumberOfSamples);
 
-  /** Get a handle to the full sampler output size. */
-  const unsigned long numberOfValidSamples = this->m_InternalFullSampler->GetOutput()->Size();
-
-  /** Fill the list with random numbers. */
-  for (unsigned int i = 0; i < this->GetNumberOfSamples(); ++i)
+  /** The counter-based random numbers are computed on the fly by the threads. */
+  if (this->m_UseCounterBasedRandomNumbers)
   {
-    unsigned long randomIndex = this->m_RandomGenerator->GetIntegerVariate(numberOfValidSamples - 1);
-    this->m_RandomNumberList.push_back(randomIndex);
+    this->InitializeCounterBasedRandomNumbers();
   }
-
-  /** Initialize variables needed for threads. */
-  this->m_ThreaderSampleContainer.clear();
-  this->m_ThreaderSampleContainer.resize(this->GetNumberOfWorkUnits());
-  for (std::size_t i = 0; i < this->GetNumberOfWorkUnits(); ++i)
+  else
   {
-    this->m_ThreaderSampleContainer[i] = ImageSampleContainerType::New();
+    /** Fill the list with random numbers. */
+    const unsigned long numberOfValidSamples = this->GetNumberOfValidSamples();
+    this->m_RandomNumberList.reserve(this->m_NumberOfSamples);
+    for (unsigned int i = 0; i < this->GetNumberOfSamples(); ++i)
+    {
+      unsigned long randomIndex = this->m_RandomGenerator->GetIntegerVariate(numberOfValidSamples - 1);
+      this->m_RandomNumberList.push_back(randomIndex);
+    }
   }
 
+  /** Initialize variables needed for threads. */
+  this->ResetThreaderSampleContainers();
+
 } // end BeforeThreadedGenerateData()
 
 
@@ -155,9 +132,6 @@ template <class TInputImage>
 void
 ImageRandomSamplerSparseMask<TInputImage>::ThreadedGenerateData(const InputImageRegionType &, ThreadIdType threadId)
 {
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples = this->m_InternalFullSampler->GetOutput();
-
   /** Figure out which samples to process. */
   unsigned long chunkSize = this->GetNumberOfSamples() / this->GetNumberOfWorkUnits();
   unsigned long sampleStart = threadId * chunkSize;
@@ -174,12 +148,23 @@ ImageRandomSamplerSparseMask<TInputImage>::ThreadedGenerateData(const InputImage
   typename ImageSampleContainerType::Iterator      iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
-  /** Take random samples from the allValidSamples-container. */
-  unsigned long sampleId = sampleStart;
+  /** Take random samples from the voxels inside the mask. */
+  const std::uint64_t numberOfValidSamples = this->GetNumberOfValidSamples();
+  unsigned long       sampleId = sampleStart;
   for (iter = sampleContainerThisThread->Begin(); iter != end; ++iter, sampleId++)
   {
-    unsigned long randomIndex = static_cast<unsigned long>(this->m_RandomNumberList[sampleId]);
-    (*iter).Value() = allValidSamples->ElementAt(randomIndex);
+    std::uint64_t randomIndex = 0;
+    if (this->m_UseCounterBasedRandomNumbers)
+    {
+      const double randomVariate = this->GetCounterBasedRandomVariate(sampleId, 0);
+      randomIndex =
+        std::min(static_cast<std::uint64_t>(randomVariate * numberOfValidSamples), numberOfValidSamples - 1);
+    }
+    else
+    {
+      randomIndex = static_cast<std::uint64_t>(this->m_RandomNumberList[sampleId]);
+    }
+    this->GetValidSample(randomIndex, (*iter).Value());
   }
 
 } // end ThreadedGenerateData()
@@ -195,7 +180,6 @@ ImageRandomSamplerSparseMask<TInputImage>::PrintSelf(std::ostream & os, Indent i
 {
   Superclass::PrintSelf(os, indent);
 
-  os << indent << "InternalFullSampler: " << this->m_InternalFullSampler.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
 
 } // end PrintSelf()
@@ -0,0 +1,170 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageSampleArrays_h
+#define itkImageSampleArrays_h
+
+#include "itkImageSample.h"
+#include "itkVectorDataContainer.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageSampleArrays
+ *
+ * \brief A structure-of-arrays copy of an image sample container.
+ *
+ * The coordinates of the samples are stored per dimension, in separate
+ * contiguous arrays, followed by a contiguous array of the sample values.
+ * Each array starts at a 64 byte boundary, so that loops over a range of
+ * samples read whole cache lines and can be vectorised by the compiler.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template <class TImage>
+class ITK_TEMPLATE_EXPORT ImageSampleArrays
+{
+public:
+  /** Typedef's. */
+  typedef ImageSampleArrays                                 Self;
+  typedef TImage                                            ImageType;
+  typedef ImageSample<ImageType>                            ImageSampleType;
+  typedef VectorDataContainer<std::size_t, ImageSampleType> ImageSampleContainerType;
+  typedef typename ImageSampleType::PointType               PointType;
+  typedef typename ImageSampleType::RealType                RealType;
+  typedef typename PointType::ValueType                     CoordinateType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, ImageType::ImageDimension);
+
+  ImageSampleArrays() = default;
+  ~ImageSampleArrays() = default;
+
+  /** The arrays point into the own buffers, so copying is not allowed. */
+  ImageSampleArrays(const Self &) = delete;
+  Self &
+  operator=(const Self &) = delete;
+
+  /** Copy the samples of an (array-of-structs) sample container. */
+  void
+  Fill(const ImageSampleContainerType & container)
+  {
+    const std::size_t numberOfSamples = container.Size();
+    const std::size_t stride = Self::PaddedSize<CoordinateType>(numberOfSamples);
+
+    this->m_NumberOfSamples = numberOfSamples;
+    this->m_CoordinateBuffer.resize(ImageDimension * stride + Self::Padding<CoordinateType>());
+    this->m_ValueBuffer.resize(Self::PaddedSize<RealType>(numberOfSamples) + Self::Padding<RealType>());
+
+    CoordinateType * coordinates = Self::Align(this->m_CoordinateBuffer.data());
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      this->m_Coordinates[d] = coordinates + d * stride;
+    }
+    this->m_Values = Self::Align(this->m_ValueBuffer.data());
+
+    const ImageSampleType * samples = container.CastToSTLConstContainer().data();
+    for (std::size_t i = 0; i < numberOfSamples; ++i)
+    {
+      for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+        this->m_Coordinates[d][i] = samples[i].m_ImageCoordinates[d];
+      }
+      this->m_Values[i] = samples[i].m_ImageValue;
+    }
+  }
+
+
+  /** The number of samples. */
+  std::size_t
+  Size(void) const
+  {
+    return this->m_NumberOfSamples;
+  }
+
+
+  /** The (aligned) array with coordinate d of all samples. */
+  const CoordinateType *
+  GetCoordinates(const unsigned int d) const
+  {
+    return this->m_Coordinates[d];
+  }
+
+
+  /** The (aligned) array with the values of all samples. */
+  const RealType *
+  GetValues(void) const
+  {
+    return this->m_Values;
+  }
+
+
+  /** Gather the coordinates of sample i into a point. */
+  void
+  GetPoint(const std::size_t i, PointType & point) const
+  {
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      point[d] = this->m_Coordinates[d][i];
+    }
+  }
+
+
+private:
+  /** The alignment of the arrays, in bytes. */
+  static constexpr std::size_t Alignment = 64;
+
+  template <class T>
+  static constexpr std::size_t
+  Padding(void)
+  {
+    return Alignment / sizeof(T);
+  }
+
+
+  /** Round up to a whole number of cache lines, so that the next array is aligned as well. */
+  template <class T>
+  static std::size_t
+  PaddedSize(const std::size_t n)
+  {
+    return ((n + Padding<T>() - 1) / Padding<T>()) * Padding<T>();
+  }
+
+
+  template <class T>
+  static T *
+  Align(T * p)
+  {
+    const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(p);
+    const std::uintptr_t aligned = (address + Alignment - 1) & ~static_cast<std::uintptr_t>(Alignment - 1);
+    return p + (aligned - address) / sizeof(T);
+  }
+
+
+  std::size_t                 m_NumberOfSamples{ 0 };
+  std::vector<CoordinateType> m_CoordinateBuffer;
+  std::vector<RealType>       m_ValueBuffer;
+  CoordinateType *            m_Coordinates[ImageDimension]{};
+  RealType *                  m_Values{ nullptr };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkImageSampleArrays_h
@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageSampleLattice_h
+#define itkImageSampleLattice_h
+
+#include "itkImageSample.h"
+
+#include <cstddef>
+
+namespace itk
+{
+
+/** \class ImageSampleLattice
+ *
+ * \brief An implicit description of the samples on a regular lattice of image voxels.
+ *
+ * Instead of storing a point and a value for every sample, like an image
+ * sample container does, only the first index, the number of samples along
+ * each dimension and the distance between the samples (in voxels) are stored.
+ * The point and value of a sample are computed from its (linear) sample number
+ * on the fly. The samples are numbered with the first dimension running fastest,
+ * so that each range of sample numbers covers whole rows of a sub-region.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template <class TImage>
+class ITK_TEMPLATE_EXPORT ImageSampleLattice
+{
+public:
+  /** Typedef's. */
+  typedef ImageSampleLattice                  Self;
+  typedef TImage                              ImageType;
+  typedef ImageSample<ImageType>              ImageSampleType;
+  typedef typename ImageSampleType::PointType PointType;
+  typedef typename ImageSampleType::RealType  RealType;
+  typedef typename ImageType::IndexType       IndexType;
+  typedef typename ImageType::SizeType        SizeType;
+  typedef typename ImageType::OffsetType      OffsetType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, ImageType::ImageDimension);
+
+  ImageSampleLattice() = default;
+  ~ImageSampleLattice() = default;
+
+  /** Describe the lattice of size[d] samples along dimension d, starting at
+   * firstIndex, at a distance of step[d] voxels.
+   */
+  void
+  Initialize(const ImageType * image, const IndexType & firstIndex, const SizeType & size, const OffsetType & step)
+  {
+    this->m_Image = image;
+    this->m_FirstIndex = firstIndex;
+    this->m_LatticeSize = size;
+    this->m_Step = step;
+    this->m_NumberOfSamples = 1;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      this->m_NumberOfSamples *= size[d];
+    }
+  }
+
+
+  /** The number of samples. */
+  std::size_t
+  Size(void) const
+  {
+    return this->m_NumberOfSamples;
+  }
+
+
+  /** The voxel index of sample i. */
+  void
+  GetIndex(std::size_t i, IndexType & index) const
+  {
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const std::size_t latticeIndex = i % this->m_LatticeSize[d];
+      index[d] = this->m_FirstIndex[d] + static_cast<IndexValueType>(latticeIndex) * this->m_Step[d];
+      i /= this->m_LatticeSize[d];
+    }
+  }
+
+
+  /** Compute the coordinates and the value of sample i. Thread-safe. */
+  void
+  GetSample(const std::size_t i, PointType & point, RealType & value) const
+  {
+    IndexType index;
+    this->GetIndex(i, index);
+    this->m_Image->TransformIndexToPhysicalPoint(index, point);
+    value = static_cast<RealType>(this->m_Image->GetPixel(index));
+  }
+
+
+private:
+  const ImageType * m_Image{ nullptr };
+  IndexType         m_FirstIndex{ {} };
+  SizeType          m_LatticeSize{ {} };
+  OffsetType        m_Step{ {} };
+  std::size_t       m_NumberOfSamples{ 0 };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkImageSampleLattice_h
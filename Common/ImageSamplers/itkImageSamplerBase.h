@@ -20,9 +20,16 @@
 
 #include "itkImageToVectorContainerFilter.h"
 #include "itkImageSample.h"
+#include "itkImageSampleArrays.h"
+#include "itkBitPackedImageMask.h"
+#include "itkImageSampleLattice.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
 
+#include <cstdint> // For uint64_t.
+#include <utility> // For pair.
+#include <vector>
+
 namespace itk
 {
 /** \class ImageSamplerBase
@@ -73,6 +80,8 @@ public:
   typedef ImageSample<InputImageType>                       ImageSampleType;
   typedef VectorDataContainer<std::size_t, ImageSampleType> ImageSampleContainerType;
   typedef typename ImageSampleContainerType::Pointer        ImageSampleContainerPointer;
+  typedef ImageSampleArrays<InputImageType>                 ImageSampleArraysType;
+  typedef ImageSampleLattice<InputImageType>                ImageSampleLatticeType;
   typedef typename InputImageType::SizeType                 InputImageSizeType;
   typedef typename InputImageType::IndexType                InputImageIndexType;
   typedef typename InputImageType::PointType                InputImagePointType;
@@ -82,6 +91,7 @@ public:
   typedef typename MaskType::Pointer                        MaskPointer;
   typedef typename MaskType::ConstPointer                   MaskConstPointer;
   typedef std::vector<MaskConstPointer>                     MaskVectorType;
+  typedef BitPackedImageMask<Self::InputImageDimension>     BitPackedMaskType;
   typedef std::vector<InputImageRegionType>                 InputImageRegionVectorType;
 
   /** ******************** Masks ******************** */
@@ -169,6 +179,19 @@ public:
   }
 
 
+  /** Set/Get the fraction of the samples that is replaced when new samples are
+   * selected by SelectNewSamplesOnUpdate(). With a fraction smaller than one, the
+   * sampler only generates that part of the samples anew, and keeps the others,
+   * including their image values. The replaced samples are those that were kept
+   * the longest, unless the samples are sorted in Morton order. Default: 1.0.
+   */
+  itkSetClampMacro(SampleRefreshFraction, double, 0.0, 1.0);
+  itkGetConstMacro(SampleRefreshFraction, double);
+
+  /** Generates the new samples, or the refreshed part of them. */
+  void
+  UpdateOutputData(DataObject * output) override;
+
   /** Get a handle to the cropped InputImageregion. */
   itkGetConstReferenceMacro(CroppedInputImageRegion, InputImageRegionType);
 
@@ -179,6 +202,44 @@ public:
   /** \todo: Temporary, should think about interface. */
   itkSetMacro(UseMultiThread, bool);
 
+  /** Set/Get whether the random samplers sort the generated samples along a
+   * Z-order (Morton) curve. Consecutive samples are then close in space, which
+   * improves the cache locality of the metric computations, and the ranges of
+   * samples that the metric threads process become spatially coherent. The grid
+   * and full samplers ignore it, because their samples are already in scan order.
+   * Default: false.
+   */
+  itkSetMacro(SortSamplesInMortonOrder, bool);
+  itkGetConstMacro(SortSamplesInMortonOrder, bool);
+  itkBooleanMacro(SortSamplesInMortonOrder);
+
+  /** Get the output samples as a structure of arrays, see ImageSampleArrays.
+   * The arrays are (re)filled from the output sample container whenever the
+   * sampler has generated new samples. Not thread-safe: call it before
+   * launching threads that read the arrays.
+   */
+  virtual const ImageSampleArraysType &
+  GetOutputArrays(void);
+
+  /** Set/Get whether the grid and full samplers describe their samples implicitly,
+   * by an ImageSampleLattice, instead of storing them in the output container.
+   * This only applies when no mask is used; the output container is then left
+   * empty. Only set it for users of the sampler that call GetImplicitSamples().
+   * Default: false.
+   */
+  itkSetMacro(UseImplicitSamples, bool);
+  itkGetConstMacro(UseImplicitSamples, bool);
+  itkBooleanMacro(UseImplicitSamples);
+
+  /** Get the implicit description of the generated samples, or nullptr when the
+   * samples are stored in the output container.
+   */
+  const ImageSampleLatticeType *
+  GetImplicitSamples(void) const
+  {
+    return this->m_ImplicitSamplesActive ? &this->m_ImplicitSamples : nullptr;
+  }
+
 protected:
   /** The constructor. */
   ImageSamplerBase();
@@ -202,6 +263,56 @@ protected:
   virtual void
   UpdateAllMasks(void);
 
+  /** What determines which points are inside a mask: the mask and its modification time,
+   * and for an image mask also the image, its buffer and its modification time.
+   */
+  struct MaskContentKeyType
+  {
+    const MaskType * m_Mask{ nullptr };
+    ModifiedTimeType m_MaskMTime{ 0 };
+    const void *     m_Image{ nullptr };
+    const void *     m_ImageBuffer{ nullptr };
+    ModifiedTimeType m_ImageMTime{ 0 };
+
+    bool
+    operator==(const MaskContentKeyType & other) const
+    {
+      return m_Mask == other.m_Mask && m_MaskMTime == other.m_MaskMTime && m_Image == other.m_Image &&
+             m_ImageBuffer == other.m_ImageBuffer && m_ImageMTime == other.m_ImageMTime;
+    }
+  };
+
+  /** Get the content key of all masks, to check whether samples inside the masks are still inside. */
+  void
+  GetMaskContentKey(std::vector<MaskContentKeyType> & key) const;
+
+  /** Test whether a point is inside the (first) mask. Uses the bit-packed copy
+   * of the mask, that is built by CropInputImageRegion(), when it is available.
+   */
+  bool
+  IsInsideMask(const InputImagePointType & point) const
+  {
+    if (this->m_BitPackedMask.IsValidFor(this->m_Mask))
+    {
+      return this->m_BitPackedMask.IsInside(point);
+    }
+    return this->m_Mask->IsInsideInWorldSpace(point);
+  }
+
+  /** Returns whether IsInsideMask() uses the bit-packed copy of the mask, and is therefore thread-safe. */
+  bool
+  HasBitPackedMask(void) const
+  {
+    return this->m_BitPackedMask.IsValidFor(this->m_Mask);
+  }
+
+  /** Returns the fraction of the bounding box of the mask that is inside the mask, if HasBitPackedMask(). */
+  double
+  GetMaskFillRatio(void) const
+  {
+    return this->m_BitPackedMask.GetFillRatio();
+  }
+
   /** Checks if the InputImageRegions are a subregion of the
    * LargestPossibleRegions.
    */
@@ -212,6 +323,20 @@ protected:
   void
   CropInputImageRegion(void);
 
+  /** Sort the samples of the output along a Z-order (Morton) curve through the
+   * bounding box of the samples, if SortSamplesInMortonOrder is true and the
+   * sampler supports it, see m_MortonOrderSortingSupported. To be called by the
+   * samplers at the end of the generation of the samples.
+   */
+  void
+  SortOutputSamples(void);
+
+  /** Make m_ThreaderSampleContainer hold an empty container for every work unit.
+   * The containers of a previous update are reused, together with their memory.
+   */
+  void
+  ResetThreaderSampleContainers(void);
+
   /** Multi-threaded function that does the work. */
   void
   BeforeThreadedGenerateData(void) override;
@@ -226,6 +351,18 @@ protected:
   // tmp?
   bool m_UseMultiThread;
 
+  bool m_SortSamplesInMortonOrder;
+
+  /** Whether SortOutputSamples() sorts the samples. Only the random samplers set it to
+   * true; the grid and full samplers keep their samples in their natural order.
+   */
+  bool m_MortonOrderSortingSupported;
+
+  /** The implicit description of the samples, only valid when m_ImplicitSamplesActive. */
+  bool                   m_UseImplicitSamples;
+  bool                   m_ImplicitSamplesActive;
+  ImageSampleLatticeType m_ImplicitSamples;
+
 private:
   /** The deleted copy constructor. */
   ImageSamplerBase(const Self &) = delete;
@@ -237,12 +374,32 @@ private:
   MaskConstPointer           m_Mask;
   MaskVectorType             m_MaskVector;
   unsigned int               m_NumberOfMasks;
+  BitPackedMaskType          m_BitPackedMask;
   InputImageRegionType       m_InputImageRegion;
   InputImageRegionVectorType m_InputImageRegionVector;
   unsigned int               m_NumberOfInputImageRegions;
 
   InputImageRegionType m_CroppedInputImageRegion;
   InputImageRegionType m_DummyInputImageRegion;
+
+  ImageSampleArraysType m_OutputArrays;
+  ModifiedTimeType      m_OutputArraysUpdateMTime;
+
+  /** Buffers of SortOutputSamples(), kept to reuse their memory. */
+  std::vector<std::pair<std::uint64_t, std::size_t>> m_MortonCodes;
+  std::vector<ImageSampleType>                       m_SortedSamples;
+
+  /** Used to refresh only part of the samples. */
+  double                       m_SampleRefreshFraction;
+  bool                         m_SampleRefreshRequested;
+  std::size_t                  m_SampleRefreshPosition;
+  const InputImageType *       m_SampleRefreshInput;
+  ModifiedTimeType             m_SampleRefreshInputMTime;
+  std::vector<ImageSampleType> m_SampleRefreshBuffer;
+
+  /** The key of the masks of the current samples, and a buffer for the key of the masks now. */
+  std::vector<MaskContentKeyType> m_SampleRefreshMaskContentKey;
+  std::vector<MaskContentKeyType> m_MaskContentKey;
 };
 
 } // end namespace itk
@@ -20,6 +20,12 @@
 
 #include "itkImageSamplerBase.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
 namespace itk
 {
 
@@ -34,9 +40,19 @@ ImageSamplerBase<TInputImage>::ImageSamplerBase()
   this->m_NumberOfMasks = 0;
   this->m_NumberOfInputImageRegions = 0;
   this->m_NumberOfSamples = 0;
+  this->m_OutputArraysUpdateMTime = 0;
 
   // tmp?
   this->m_UseMultiThread = false;
+  this->m_SortSamplesInMortonOrder = false;
+  this->m_MortonOrderSortingSupported = false;
+  this->m_UseImplicitSamples = false;
+  this->m_ImplicitSamplesActive = false;
+  this->m_SampleRefreshFraction = 1.0;
+  this->m_SampleRefreshRequested = false;
+  this->m_SampleRefreshPosition = 0;
+  this->m_SampleRefreshInput = nullptr;
+  this->m_SampleRefreshInputMTime = 0;
 
 } // end Constructor()
 
@@ -240,11 +256,112 @@ ImageSamplerBase<TInputImage>::SelectNewSamplesOnUpdate(void)
    * Inheriting subclasses may just return false and do nothing.
    */
   this->Modified();
+  this->m_SampleRefreshRequested = true;
   return true;
 
 } // end SelectNewSamplesOnUpdate()
 
 
+/**
+ * ******************* UpdateOutputData *******************
+ */
+
+template <class TInputImage>
+void
+ImageSamplerBase<TInputImage>::UpdateOutputData(DataObject * output)
+{
+  ImageSampleContainerType * sampleContainer = this->GetOutput();
+  const unsigned long        numberOfSamples = this->m_NumberOfSamples;
+
+  /** Only refresh part of the samples when new samples were requested for the
+   * same input and mask content, and the previous output is complete.
+   */
+  bool refresh = this->m_SampleRefreshRequested && this->m_SampleRefreshFraction < 1.0 &&
+                 this->GetInput() != nullptr && this->GetInput() == this->m_SampleRefreshInput &&
+                 this->GetInput()->GetMTime() == this->m_SampleRefreshInputMTime && numberOfSamples > 1 &&
+                 sampleContainer->Size() == numberOfSamples && !this->m_ImplicitSamplesActive;
+  if (refresh)
+  {
+    this->UpdateAllMasks();
+    this->GetMaskContentKey(this->m_MaskContentKey);
+    refresh = this->m_MaskContentKey == this->m_SampleRefreshMaskContentKey;
+  }
+  this->m_SampleRefreshRequested = false;
+
+  if (!refresh)
+  {
+    Superclass::UpdateOutputData(output);
+    this->m_SampleRefreshPosition = 0;
+    this->m_SampleRefreshInput = this->GetInput();
+    this->m_SampleRefreshInputMTime = this->GetInput() ? this->GetInput()->GetMTime() : 0;
+    this->GetMaskContentKey(this->m_SampleRefreshMaskContentKey);
+    return;
+  }
+
+  /** Keep the current samples, and let the sampler generate only the refreshed part. */
+  this->m_SampleRefreshBuffer.assign(sampleContainer->begin(), sampleContainer->end());
+  const double numberOfSamplesToRefresh = std::ceil(this->m_SampleRefreshFraction * numberOfSamples);
+  this->m_NumberOfSamples = std::max(static_cast<unsigned long>(numberOfSamplesToRefresh), 1UL);
+  try
+  {
+    Superclass::UpdateOutputData(output);
+  }
+  catch (...)
+  {
+    this->m_NumberOfSamples = numberOfSamples;
+    throw;
+  }
+  this->m_NumberOfSamples = numberOfSamples;
+
+  /** Replace the samples that were kept the longest by the new ones. */
+  const std::size_t numberOfNewSamples = std::min<std::size_t>(sampleContainer->Size(), numberOfSamples);
+  for (std::size_t i = 0; i < numberOfNewSamples; ++i)
+  {
+    this->m_SampleRefreshBuffer[(this->m_SampleRefreshPosition + i) % numberOfSamples] = sampleContainer->ElementAt(i);
+  }
+  this->m_SampleRefreshPosition = (this->m_SampleRefreshPosition + numberOfNewSamples) % numberOfSamples;
+  sampleContainer->CastToSTLContainer().swap(this->m_SampleRefreshBuffer);
+
+  this->SortOutputSamples();
+
+} // end UpdateOutputData()
+
+
+/**
+ * ******************* GetMaskContentKey *******************
+ */
+
+template <class TInputImage>
+void
+ImageSamplerBase<TInputImage>::GetMaskContentKey(std::vector<MaskContentKeyType> & key) const
+{
+  typedef typename BitPackedMaskType::ImageMaskSpatialObjectType ImageMaskSpatialObjectType;
+
+  key.resize(this->m_NumberOfMasks);
+  for (unsigned int i = 0; i < this->m_NumberOfMasks; ++i)
+  {
+    const MaskType *     mask = this->m_MaskVector[i].GetPointer();
+    MaskContentKeyType & maskKey = key[i];
+    maskKey = MaskContentKeyType();
+    maskKey.m_Mask = mask;
+    if (mask != nullptr)
+    {
+      maskKey.m_MaskMTime = mask->GetMTime();
+
+      /** Writing to the image of an image mask does not modify the mask itself. */
+      const ImageMaskSpatialObjectType * imageMask = dynamic_cast<const ImageMaskSpatialObjectType *>(mask);
+      if (imageMask != nullptr && imageMask->GetImage() != nullptr)
+      {
+        maskKey.m_Image = imageMask->GetImage();
+        maskKey.m_ImageBuffer = imageMask->GetImage()->GetBufferPointer();
+        maskKey.m_ImageMTime = imageMask->GetImage()->GetMTime();
+      }
+    }
+  }
+
+} // end GetMaskContentKey()
+
+
 /**
  * ******************* IsInsideAllMasks *******************
  */
@@ -329,6 +446,9 @@ ImageSamplerBase<TInputImage>::CropInputImageRegion(void)
 
     this->UpdateAllMasks();
 
+    /** Build the bit-packed copy of the mask, used by IsInsideMask(). */
+    this->m_BitPackedMask.Update(this->m_Mask);
+
     /** Get the indices of the bounding box extremes, based on the first mask.
      * Note that the bounding box is defined in terms of the mask
      * spacing and origin, and that we need a region in terms
@@ -398,14 +518,33 @@ void
 ImageSamplerBase<TInputImage>::BeforeThreadedGenerateData(void)
 {
   /** Initialize variables needed for threads. */
-  this->m_ThreaderSampleContainer.clear();
+  this->ResetThreaderSampleContainers();
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ResetThreaderSampleContainers *******************
+ */
+
+template <class TInputImage>
+void
+ImageSamplerBase<TInputImage>::ResetThreaderSampleContainers(void)
+{
+  /** The containers are kept from one update to the next, and only emptied,
+   * so that their memory is reused when new samples are drawn every iteration.
+   */
   this->m_ThreaderSampleContainer.resize(this->GetNumberOfWorkUnits());
-  for (std::size_t i = 0; i < this->GetNumberOfWorkUnits(); ++i)
+  for (auto & container : this->m_ThreaderSampleContainer)
   {
-    this->m_ThreaderSampleContainer[i] = ImageSampleContainerType::New();
+    if (container.IsNull())
+    {
+      container = ImageSampleContainerType::New();
+    }
+    container->clear();
   }
 
-} // end BeforeThreadedGenerateData()
+} // end ResetThreaderSampleContainers()
 
 
 /**
@@ -435,9 +574,106 @@ ImageSamplerBase<TInputImage>::AfterThreadedGenerateData(void)
       sampleContainer->end(), this->m_ThreaderSampleContainer[i]->begin(), this->m_ThreaderSampleContainer[i]->end());
   }
 
+  /** Sort the combined samples, if desired and supported. */
+  this->SortOutputSamples();
+
 } // end AfterThreadedGenerateData()
 
 
+/**
+ * ******************* SortOutputSamples *******************
+ */
+
+template <class TInputImage>
+void
+ImageSamplerBase<TInputImage>::SortOutputSamples(void)
+{
+  ImageSampleContainerType & sampleContainer = *this->GetOutput();
+  const std::size_t          numberOfSamples = sampleContainer.Size();
+  if (!this->m_SortSamplesInMortonOrder || !this->m_MortonOrderSortingSupported || numberOfSamples < 2)
+  {
+    return;
+  }
+
+  /** Compute the bounding box of the samples. */
+  InputImagePointType minimum = sampleContainer.ElementAt(0).m_ImageCoordinates;
+  InputImagePointType maximum = minimum;
+  for (std::size_t i = 1; i < numberOfSamples; ++i)
+  {
+    const InputImagePointType & point = sampleContainer.ElementAt(i).m_ImageCoordinates;
+    for (unsigned int d = 0; d < InputImageDimension; ++d)
+    {
+      minimum[d] = std::min(minimum[d], point[d]);
+      maximum[d] = std::max(maximum[d], point[d]);
+    }
+  }
+
+  /** Quantize the coordinates to a grid of 2^bitsPerDimension cells per dimension,
+   * and interleave the bits of the grid indices to get the Morton code.
+   */
+  const unsigned int bitsPerDimension = 63 / InputImageDimension;
+  const double       numberOfCells = static_cast<double>((std::uint64_t{ 1 } << bitsPerDimension) - 1);
+  double             scales[InputImageDimension];
+  for (unsigned int d = 0; d < InputImageDimension; ++d)
+  {
+    const double extent = maximum[d] - minimum[d];
+    scales[d] = extent > 0.0 ? numberOfCells / extent : 0.0;
+  }
+
+  std::vector<std::pair<std::uint64_t, std::size_t>> & codes = this->m_MortonCodes;
+  codes.resize(numberOfSamples);
+  for (std::size_t i = 0; i < numberOfSamples; ++i)
+  {
+    const InputImagePointType & point = sampleContainer.ElementAt(i).m_ImageCoordinates;
+    std::uint64_t               cells[InputImageDimension];
+    for (unsigned int d = 0; d < InputImageDimension; ++d)
+    {
+      cells[d] = static_cast<std::uint64_t>((point[d] - minimum[d]) * scales[d]);
+    }
+
+    std::uint64_t code = 0;
+    for (unsigned int bit = bitsPerDimension; bit-- > 0;)
+    {
+      for (unsigned int d = 0; d < InputImageDimension; ++d)
+      {
+        code = (code << 1) | ((cells[d] >> bit) & 1);
+      }
+    }
+    codes[i] = std::make_pair(code, i);
+  }
+  std::sort(codes.begin(), codes.end());
+
+  /** Reorder the samples. */
+  std::vector<ImageSampleType> & sortedSamples = this->m_SortedSamples;
+  sortedSamples.clear();
+  for (const auto & code : codes)
+  {
+    sortedSamples.push_back(sampleContainer.ElementAt(code.second));
+  }
+  std::copy(sortedSamples.begin(), sortedSamples.end(), sampleContainer.begin());
+
+} // end SortOutputSamples()
+
+
+/**
+ * ******************* GetOutputArrays *******************
+ */
+
+template <class TInputImage>
+const typename ImageSamplerBase<TInputImage>::ImageSampleArraysType &
+ImageSamplerBase<TInputImage>::GetOutputArrays(void)
+{
+  const OutputVectorContainerType * output = this->GetOutput();
+  if (output->GetUpdateMTime() != this->m_OutputArraysUpdateMTime || output->Size() != this->m_OutputArrays.Size())
+  {
+    this->m_OutputArrays.Fill(*output);
+    this->m_OutputArraysUpdateMTime = output->GetUpdateMTime();
+  }
+  return this->m_OutputArrays;
+
+} // end GetOutputArrays()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -448,6 +684,9 @@ ImageSamplerBase<TInputImage>::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
 
+  os << indent << "SortSamplesInMortonOrder: " << this->m_SortSamplesInMortonOrder << std::endl;
+  os << indent << "UseImplicitSamples: " << this->m_UseImplicitSamples << std::endl;
+  os << indent << "SampleRefreshFraction: " << this->m_SampleRefreshFraction << std::endl;
   os << indent << "NumberOfMasks" << this->m_NumberOfMasks << std::endl;
   os << indent << "Mask: " << this->m_Mask.GetPointer() << std::endl;
   os << indent << "MaskVector:" << std::endl;
@@ -0,0 +1,297 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImageTileCache_h
+#define itkImageTileCache_h
+
+#include "itkImageFileReader.h"
+#include "itkMath.h"
+
+#include <algorithm> // For min.
+#include <iterator>  // For prev.
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace itk
+{
+
+/** \class ImageTileCache
+ *
+ * \brief Reads the tiles of an image file on demand, and keeps the most recently used ones.
+ *
+ * The image is divided into tiles of TileSize voxels. A tile is only read from disk
+ * when a voxel inside it is requested, by streamed reading of the tile region. At most
+ * MaximumNumberOfTiles tiles are kept in memory; when another tile is needed, the least
+ * recently used one is released. This allows to evaluate an image that does not fit
+ * in memory, as long as the requested voxels are spatially coherent. Requests should
+ * therefore be sorted by ComputeTileNumber().
+ *
+ * The image IO of the file must support streamed reading, which Initialize() checks.
+ * This class is not thread safe.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template <class TImage>
+class ITK_TEMPLATE_EXPORT ImageTileCache : public Object
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef ImageTileCache           Self;
+  typedef Object                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageTileCache, Object);
+
+  /** Typedef's. */
+  typedef TImage                                          ImageType;
+  typedef typename ImageType::Pointer                     ImagePointer;
+  typedef typename ImageType::PixelType                   PixelType;
+  typedef typename ImageType::IndexType                   IndexType;
+  typedef typename ImageType::SizeType                    SizeType;
+  typedef typename ImageType::RegionType                  RegionType;
+  typedef typename ImageType::PointType                   PointType;
+  typedef ContinuousIndex<double, TImage::ImageDimension> ContinuousIndexType;
+  typedef ImageFileReader<ImageType>                      ReaderType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TImage::ImageDimension);
+
+  /** Set/Get the name of the image file. */
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Set/Get the size of the tiles, in voxels. Default: 128 along every dimension. */
+  itkSetMacro(TileSize, SizeType);
+  itkGetConstReferenceMacro(TileSize, SizeType);
+
+  /** Set/Get the maximum number of tiles kept in memory. Default: 256. */
+  itkSetClampMacro(MaximumNumberOfTiles, SizeValueType, 1, NumericTraits<SizeValueType>::max());
+  itkGetConstMacro(MaximumNumberOfTiles, SizeValueType);
+
+  /** Get the number of tiles read from disk since Initialize(). */
+  itkGetConstMacro(NumberOfTileReads, SizeValueType);
+
+  /** Get the geometry of the image, without a pixel buffer. Valid after Initialize(). */
+  const ImageType *
+  GetImageInformation(void) const
+  {
+    return this->m_ImageInformation.GetPointer();
+  }
+
+
+  /** Read the image information and release all tiles. */
+  void
+  Initialize(void)
+  {
+    this->m_Reader = ReaderType::New();
+    this->m_Reader->SetFileName(this->m_FileName);
+    this->m_Reader->UpdateOutputInformation();
+    if (!this->m_Reader->GetImageIO()->CanStreamRead())
+    {
+      itkExceptionMacro(<< "ERROR: the image IO of \"" << this->m_FileName << "\" does not support streamed reading.");
+    }
+
+    const ImageType * output = this->m_Reader->GetOutput();
+    this->m_ImageInformation = ImageType::New();
+    this->m_ImageInformation->CopyInformation(output);
+    this->m_ImageInformation->SetRegions(output->GetLargestPossibleRegion());
+    this->m_Region = output->GetLargestPossibleRegion();
+
+    SizeValueType numberOfTiles = 1;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      if (this->m_TileSize[d] == 0)
+      {
+        itkExceptionMacro(<< "ERROR: the tile size should be positive.");
+      }
+      this->m_TileOffsetTable[d] = numberOfTiles;
+      numberOfTiles *= (this->m_Region.GetSize()[d] + this->m_TileSize[d] - 1) / this->m_TileSize[d];
+    }
+
+    this->m_Tiles.clear();
+    this->m_LeastRecentlyUsed.clear();
+    this->m_NumberOfTileReads = 0;
+  }
+
+
+  /** Convert a physical point to a continuous index of the image. Returns false
+   * when the point is outside the outermost voxel centers.
+   */
+  bool
+  TransformPhysicalPointToContinuousIndex(const PointType & point, ContinuousIndexType & cindex) const
+  {
+    this->m_ImageInformation->TransformPhysicalPointToContinuousIndex(point, cindex);
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const double first = static_cast<double>(this->m_Region.GetIndex()[d]);
+      const double last = first + static_cast<double>(this->m_Region.GetSize()[d]) - 1.0;
+      if (!(cindex[d] >= first && cindex[d] <= last))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
+  /** The number of the tile that contains the voxel nearest to the continuous index,
+   * which should be inside the image. Tiles are numbered with the first dimension running fastest.
+   */
+  SizeValueType
+  ComputeTileNumber(const ContinuousIndexType & cindex) const
+  {
+    SizeValueType tileNumber = 0;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const IndexValueType nearest = Math::Round<IndexValueType>(cindex[d]);
+      const SizeValueType  i = static_cast<SizeValueType>(nearest - this->m_Region.GetIndex()[d]);
+      tileNumber += (i / this->m_TileSize[d]) * this->m_TileOffsetTable[d];
+    }
+    return tileNumber;
+  }
+
+
+  /** The value of a voxel inside the image. Reads its tile if needed. */
+  const PixelType &
+  GetPixel(const IndexType & index)
+  {
+    SizeValueType tileNumber = 0;
+    IndexType     tileIndex;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const SizeValueType i = static_cast<SizeValueType>(index[d] - this->m_Region.GetIndex()[d]);
+      tileNumber += (i / this->m_TileSize[d]) * this->m_TileOffsetTable[d];
+      tileIndex[d] =
+        this->m_Region.GetIndex()[d] + static_cast<IndexValueType>((i / this->m_TileSize[d]) * this->m_TileSize[d]);
+    }
+    return this->GetTile(tileNumber, tileIndex)->GetPixel(index);
+  }
+
+
+  /** Linear interpolation at a continuous index inside the image, see TransformPhysicalPointToContinuousIndex(). */
+  double
+  EvaluateAtContinuousIndex(const ContinuousIndexType & cindex)
+  {
+    IndexType baseIndex;
+    double    distance[ImageDimension];
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      baseIndex[d] = Math::Floor<IndexValueType>(cindex[d]);
+      distance[d] = cindex[d] - static_cast<double>(baseIndex[d]);
+    }
+
+    /** Sum over the 2^D corners; a corner beyond the last voxel has weight zero. */
+    const IndexType & regionIndex = this->m_Region.GetIndex();
+    double            value = 0.0;
+    for (unsigned int corner = 0; corner < (1u << ImageDimension); ++corner)
+    {
+      IndexType neighbor;
+      double    weight = 1.0;
+      for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+        const bool upper = (corner >> d) & 1u;
+        weight *= upper ? distance[d] : 1.0 - distance[d];
+        neighbor[d] = baseIndex[d] + (upper ? 1 : 0);
+        const IndexValueType last = regionIndex[d] + static_cast<IndexValueType>(this->m_Region.GetSize()[d]) - 1;
+        neighbor[d] = std::min(neighbor[d], last);
+      }
+      if (weight != 0.0)
+      {
+        value += weight * static_cast<double>(this->GetPixel(neighbor));
+      }
+    }
+    return value;
+  }
+
+
+protected:
+  ImageTileCache() { this->m_TileSize.Fill(128); }
+  ~ImageTileCache() override = default;
+
+private:
+  ImageTileCache(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  typedef std::list<SizeValueType> TileListType;
+
+  struct Tile
+  {
+    ImagePointer                    m_Image;
+    typename TileListType::iterator m_Position;
+  };
+
+  /** Returns the tile, after reading it, or marking it as most recently used. */
+  const ImageType *
+  GetTile(const SizeValueType tileNumber, const IndexType & tileIndex)
+  {
+    const auto found = this->m_Tiles.find(tileNumber);
+    if (found != this->m_Tiles.end())
+    {
+      this->m_LeastRecentlyUsed.splice(
+        this->m_LeastRecentlyUsed.end(), this->m_LeastRecentlyUsed, found->second.m_Position);
+      return found->second.m_Image.GetPointer();
+    }
+
+    /** Release the least recently used tile. */
+    if (this->m_Tiles.size() >= this->m_MaximumNumberOfTiles)
+    {
+      this->m_Tiles.erase(this->m_LeastRecentlyUsed.front());
+      this->m_LeastRecentlyUsed.pop_front();
+    }
+
+    /** Read the tile, cropped to the image. */
+    RegionType tileRegion(tileIndex, this->m_TileSize);
+    tileRegion.Crop(this->m_Region);
+    this->m_Reader->GetOutput()->SetRequestedRegion(tileRegion);
+    this->m_Reader->Modified();
+    this->m_Reader->Update();
+    ImagePointer image = this->m_Reader->GetOutput();
+    image->DisconnectPipeline();
+    ++this->m_NumberOfTileReads;
+
+    this->m_LeastRecentlyUsed.push_back(tileNumber);
+    Tile & tile = this->m_Tiles[tileNumber];
+    tile.m_Image = image;
+    tile.m_Position = std::prev(this->m_LeastRecentlyUsed.end());
+    return image.GetPointer();
+  }
+
+
+  std::string                  m_FileName;
+  SizeType                     m_TileSize;
+  SizeValueType                m_MaximumNumberOfTiles{ 256 };
+  SizeValueType                m_NumberOfTileReads{ 0 };
+  typename ReaderType::Pointer m_Reader;
+  ImagePointer                 m_ImageInformation;
+  RegionType                   m_Region;
+  SizeValueType                m_TileOffsetTable[ImageDimension]{};
+
+  /** The tiles in memory, and their numbers from least to most recently used. */
+  std::unordered_map<SizeValueType, Tile> m_Tiles;
+  TileListType                            m_LeastRecentlyUsed;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkImageTileCache_h
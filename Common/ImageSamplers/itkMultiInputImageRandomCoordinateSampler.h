@@ -33,6 +33,10 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * Without a mask, the samples are generated by multiple threads when
+ * UseMultiThread or UseCounterBasedRandomNumbers is true, like in the
+ * ImageRandomCoordinateSampler.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -63,6 +67,7 @@ public:
   typedef typename Superclass::InputImagePixelType          InputImagePixelType;
   typedef typename Superclass::ImageSampleType              ImageSampleType;
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
   typedef typename Superclass::InputImageSizeType           InputImageSizeType;
   typedef typename InputImageType::SpacingType              InputImageSpacingType;
@@ -118,6 +123,13 @@ protected:
   void
   GenerateData(void) override;
 
+  /** Multi-threaded functionality that does the work. */
+  void
+  BeforeThreadedGenerateData(void) override;
+
+  void
+  ThreadedGenerateData(const InputImageRegionType & inputRegionForThread, ThreadIdType threadId) override;
+
   /** Generate a point randomly in a bounding box.
    * This method can be overwritten in subclasses if a different distribution is desired. */
   virtual void
@@ -129,6 +141,10 @@ protected:
   RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
 
+  /** The sample region of the current generation, used by the threads. */
+  InputImageContinuousIndexType m_SmallestSampleRegionContIndex;
+  InputImageContinuousIndexType m_LargestSampleRegionContIndex;
+
   /** Generate the two corners of a sampling region. */
   virtual void
   GenerateSampleRegion(InputImageContinuousIndexType & smallestContIndex,
@@ -61,10 +61,19 @@ MultiInputImageRandomCoordinateSampler<TInputImage>::GenerateData(void)
                       << "is not a subregion of the LargestPossibleRegion");
   }
 
-  /** Get handles to the input image, output sample container, and mask. */
+  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version.
+   * The counter-based random numbers are only generated by the multi-threaded version.
+   */
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if (mask.IsNull() && (this->m_UseMultiThread || this->m_UseCounterBasedRandomNumbers))
+  {
+    /** Calls ThreadedGenerateData(). */
+    return Superclass::GenerateData();
+  }
+
+  /** Get handles to the input image, output sample container, and interpolator. */
   InputImageConstPointer                     inputImage = this->GetInput();
   typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
-  typename MaskType::ConstPointer            mask = this->GetMask();
   typename InterpolatorType::Pointer         interpolator = this->GetModifiableInterpolator();
 
   /** Set up the interpolator. */
@@ -149,9 +158,122 @@ MultiInputImageRandomCoordinateSampler<TInputImage>::GenerateData(void)
     } // end for loop
   }   // end if mask
 
+  /** Sort the samples, if desired. */
+  this->SortOutputSamples();
+
 } // end GenerateData()
 
 
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template <class TInputImage>
+void
+MultiInputImageRandomCoordinateSampler<TInputImage>::BeforeThreadedGenerateData(void)
+{
+  /** Set up the interpolator. */
+  this->GetModifiableInterpolator()->SetInputImage(this->GetInput());
+
+  /** Clear the random number list. */
+  this->m_RandomNumberList.resize(0);
+
+  /** Select the iteration of the counter-based random numbers, before the sample region is generated. */
+  if (this->m_UseCounterBasedRandomNumbers)
+  {
+    this->InitializeCounterBasedRandomNumbers();
+  }
+
+  /** Get the intersection of all sample regions. */
+  this->GenerateSampleRegion(this->m_SmallestSampleRegionContIndex, this->m_LargestSampleRegionContIndex);
+
+  /** Fill the list with random numbers. The counter-based random numbers are computed by the threads. */
+  if (!this->m_UseCounterBasedRandomNumbers)
+  {
+    InputImageContinuousIndexType randomCIndex;
+    this->m_RandomNumberList.reserve(this->m_NumberOfSamples * InputImageDimension);
+    for (unsigned long i = 0; i < this->m_NumberOfSamples; ++i)
+    {
+      this->GenerateRandomCoordinate(
+        this->m_SmallestSampleRegionContIndex, this->m_LargestSampleRegionContIndex, randomCIndex);
+      for (unsigned int j = 0; j < InputImageDimension; ++j)
+      {
+        this->m_RandomNumberList.push_back(randomCIndex[j]);
+      }
+    }
+  }
+
+  /** Initialize variables needed for threads. */
+  this->ResetThreaderSampleContainers();
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ******************* ThreadedGenerateData *******************
+ */
+
+template <class TInputImage>
+void
+MultiInputImageRandomCoordinateSampler<TInputImage>::ThreadedGenerateData(const InputImageRegionType &,
+                                                                          ThreadIdType threadId)
+{
+  /** Sanity check. */
+  if (this->GetMask() != nullptr)
+  {
+    itkExceptionMacro(<< "ERROR: do not call this function when a mask is supplied.");
+  }
+
+  /** Get handle to the input image. */
+  InputImageConstPointer inputImage = this->GetInput();
+
+  /** Figure out which samples to process. */
+  unsigned long       chunkSize = this->GetNumberOfSamples() / this->GetNumberOfWorkUnits();
+  const unsigned long sampleStart = threadId * chunkSize;
+  if (threadId == this->GetNumberOfWorkUnits() - 1)
+  {
+    chunkSize = this->GetNumberOfSamples() - ((this->GetNumberOfWorkUnits() - 1) * chunkSize);
+  }
+
+  /** Get a reference to the output and reserve memory for it. */
+  ImageSampleContainerPointer & sampleContainerThisThread = this->m_ThreaderSampleContainer[threadId];
+  sampleContainerThisThread->Reserve(chunkSize);
+
+  /** Fill the local sample container. */
+  const InputImageContinuousIndexType & smallestCIndex = this->m_SmallestSampleRegionContIndex;
+  const InputImageContinuousIndexType & largestCIndex = this->m_LargestSampleRegionContIndex;
+  InputImageContinuousIndexType         sampleCIndex;
+  for (unsigned long i = 0; i < chunkSize; ++i)
+  {
+    /** Create a random point out of InputImageDimension random numbers. */
+    const unsigned long sampleNumber = sampleStart + i;
+    for (unsigned int j = 0; j < InputImageDimension; ++j)
+    {
+      if (this->m_UseCounterBasedRandomNumbers)
+      {
+        const double randomVariate = this->GetCounterBasedRandomVariate(sampleNumber, j);
+        sampleCIndex[j] = static_cast<InputImagePointValueType>(
+          smallestCIndex[j] + randomVariate * (largestCIndex[j] - smallestCIndex[j]));
+      }
+      else
+      {
+        sampleCIndex[j] = this->m_RandomNumberList[sampleNumber * InputImageDimension + j];
+      }
+    }
+
+    /** Make a reference to the current sample in the container. */
+    ImageSampleType & sample = sampleContainerThisThread->ElementAt(i);
+
+    /** Convert to point, and compute the value at the continuous index. */
+    inputImage->TransformContinuousIndexToPhysicalPoint(sampleCIndex, sample.m_ImageCoordinates);
+    sample.m_ImageValue =
+      static_cast<ImageSampleValueType>(this->m_Interpolator->EvaluateAtContinuousIndex(sampleCIndex));
+
+  } // end for loop
+
+} // end ThreadedGenerateData()
+
+
 /**
  * ******************* GenerateSampleRegion *******************
  */
@@ -242,7 +364,23 @@ MultiInputImageRandomCoordinateSampler<TInputImage>::GenerateSampleRegion(
     }
     InputImageContinuousIndexType maxSmallestContIndex = largestContIndex;
     maxSmallestContIndex -= sampleRegionSize;
-    this->GenerateRandomCoordinate(smallestContIndex, maxSmallestContIndex, smallestContIndex);
+
+    /** In the multi-threaded version, the counter-based random numbers of the region are stored
+     * in the streams following those of the sample coordinates.
+     */
+    if (this->m_UseCounterBasedRandomNumbers && this->GetMask() == nullptr)
+    {
+      for (unsigned int i = 0; i < InputImageDimension; ++i)
+      {
+        const double randomVariate = this->GetCounterBasedRandomVariate(0, InputImageDimension + i);
+        smallestContIndex[i] = static_cast<InputImagePointValueType>(
+          smallestContIndex[i] + randomVariate * (maxSmallestContIndex[i] - smallestContIndex[i]));
+      }
+    }
+    else
+    {
+      this->GenerateRandomCoordinate(smallestContIndex, maxSmallestContIndex, smallestContIndex);
+    }
     largestContIndex = smallestContIndex;
     largestContIndex += sampleRegionSize;
   }
@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPhiloxRandomNumberGenerator_h
+#define itkPhiloxRandomNumberGenerator_h
+
+#include <cstdint>
+
+namespace itk
+{
+
+/** \class PhiloxRandomNumberGenerator
+ *
+ * \brief A counter-based random number generator, implementing Philox4x32-10.
+ *
+ * In contrast to a sequential generator like the Mersenne Twister, this
+ * generator has no state: a random number is a pure function of a key and a
+ * counter. Any thread can therefore compute the random numbers of any sample
+ * directly, and the result does not depend on the number of threads, or on
+ * the order in which the samples are generated.
+ *
+ * See: J.K. Salmon, M.A. Moraes, R.O. Dror, and D.E. Shaw,
+ * "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11, 2011.
+ *
+ * \ingroup ImageSamplers
+ */
+
+class PhiloxRandomNumberGenerator
+{
+public:
+  typedef std::uint32_t WordType;
+
+  /** The counter consists of four words, the key of two words. */
+  struct CounterType
+  {
+    WordType m_Words[4];
+  };
+  struct KeyType
+  {
+    WordType m_Words[2];
+  };
+
+  /** Returns the four random words belonging to the given counter and key. */
+  static CounterType
+  Evaluate(CounterType counter, KeyType key)
+  {
+    for (unsigned int round = 0; round < 10; ++round)
+    {
+      const std::uint64_t product0 = static_cast<std::uint64_t>(0xD2511F53u) * counter.m_Words[0];
+      const std::uint64_t product1 = static_cast<std::uint64_t>(0xCD9E8D57u) * counter.m_Words[2];
+
+      const CounterType next = { { static_cast<WordType>(product1 >> 32) ^ counter.m_Words[1] ^ key.m_Words[0],
+                                   static_cast<WordType>(product1),
+                                   static_cast<WordType>(product0 >> 32) ^ counter.m_Words[3] ^ key.m_Words[1],
+                                   static_cast<WordType>(product0) } };
+      counter = next;
+
+      /** Bump the key (Weyl sequence). */
+      key.m_Words[0] += 0x9E3779B9u;
+      key.m_Words[1] += 0xBB67AE85u;
+    }
+    return counter;
+  }
+
+
+  /** Returns a uniformly distributed random number in [0, 1), belonging to
+   * the given seed, iteration, sample number and stream. Different streams
+   * give independent numbers for the same sample, e.g., one per dimension.
+   */
+  static double
+  GetUniformVariate(const WordType      seed,
+                    const std::uint64_t iteration,
+                    const std::uint64_t sampleId,
+                    const WordType      stream)
+  {
+    const CounterType counter = { { static_cast<WordType>(sampleId),
+                                    static_cast<WordType>(sampleId >> 32),
+                                    stream,
+                                    static_cast<WordType>(iteration >> 32) } };
+    const KeyType     key = { { seed, static_cast<WordType>(iteration) } };
+    const CounterType result = Evaluate(counter, key);
+
+    /** Use the upper 53 bits of two words, to fill the mantissa of a double. */
+    const std::uint64_t bits = (static_cast<std::uint64_t>(result.m_Words[0]) << 32) | result.m_Words[1];
+    return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+  }
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkPhiloxRandomNumberGenerator_h
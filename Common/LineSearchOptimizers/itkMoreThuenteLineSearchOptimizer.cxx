@@ -17,7 +17,7 @@
  *=========================================================================*/
 
 #include "itkMoreThuenteLineSearchOptimizer.h"
-#include <cmath> // For abs.
+#include <cmath> // For abs and isnan.
 #include <limits>
 
 namespace itk
@@ -37,6 +37,10 @@ MoreThuenteLineSearchOptimizer::MoreThuenteLineSearchOptimizer()
   this->m_ValueTolerance = 1e-4;
   this->m_GradientTolerance = 0.9;
   this->m_IntervalTolerance = std::numeric_limits<double>::epsilon();
+  this->m_UseValueOnlyProbes = false;
+  this->m_CurrentDerivativeComputed = false;
+  this->m_BestValue = NumericTraits<MeasureType>::Zero;
+  this->m_BestDirectionalDerivative = 0.0;
   this->SetMinimumStepLength(1e-20);
   this->SetMaximumStepLength(1e20);
 
@@ -136,6 +140,9 @@ MoreThuenteLineSearchOptimizer::StartOptimization(void)
   this->m_dg = this->DirectionalDerivative(this->m_g);
 
   this->InitializeLineSearch();
+  this->m_BestValue = this->m_f;
+  this->m_BestDerivative = this->m_g;
+  this->m_BestDirectionalDerivative = this->m_dg;
 
   this->InvokeEvent(StartEvent());
 
@@ -152,9 +159,16 @@ MoreThuenteLineSearchOptimizer::StartOptimization(void)
     this->BoundStep(this->m_step);
     this->PrepareForUnusualTermination();
     this->SetCurrentStepLength(this->m_step);
-    this->ComputeCurrentValueAndDerivative();
-    this->m_dg = this->DirectionalDerivative(this->m_g);
+    this->EvaluateCurrentStep();
     this->TestConvergence(this->m_Stop);
+    if (this->m_Stop && !this->m_CurrentDerivativeComputed)
+    {
+      /** The caller expects the derivative at the final step. */
+      this->ComputeCurrentValueAndDerivative();
+      this->m_dg = this->DirectionalDerivative(this->m_g);
+      this->m_CurrentDerivativeComputed = true;
+      this->TestConvergence(this->m_Stop);
+    }
     this->InvokeEvent(IterationEvent());
     if (this->m_Stop)
     {
@@ -398,6 +412,71 @@ MoreThuenteLineSearchOptimizer::ComputeCurrentValueAndDerivative(void)
 } // end ComputeCurrentValueAndDerivative()
 
 
+/**
+ * ***************** ComputeCurrentValue ********************
+ *
+ * Ask the cost function to compute only m_f at the current position.
+ */
+
+void
+MoreThuenteLineSearchOptimizer::ComputeCurrentValue(void)
+{
+  try
+  {
+    this->m_f = this->GetCostFunction()->GetValue(this->GetCurrentPosition());
+  }
+  catch (ExceptionObject & err)
+  {
+    this->m_StopCondition = MetricError;
+    this->StopOptimization();
+    throw err;
+  }
+
+} // end ComputeCurrentValue()
+
+
+/**
+ * ***************** EvaluateCurrentStep ********************
+ *
+ * Compute m_f, m_g and m_dg at the current step.
+ */
+
+void
+MoreThuenteLineSearchOptimizer::EvaluateCurrentStep(void)
+{
+  /** Reuse the evaluation of the best step so far. */
+  if (this->m_step == this->m_stepx && this->m_BestDerivative.GetSize() == this->m_g.GetSize())
+  {
+    this->m_f = this->m_BestValue;
+    this->m_g = this->m_BestDerivative;
+    this->m_dg = this->m_BestDirectionalDerivative;
+    this->m_CurrentDerivativeComputed = true;
+    return;
+  }
+
+  /** A step that does not satisfy the sufficient decrease condition, and that
+   * has a higher value than the best step, does not need the derivative.
+   */
+  if (this->m_UseValueOnlyProbes)
+  {
+    this->ComputeCurrentValue();
+    const MeasureType ftest1 = this->m_finit + this->m_step * this->m_dgtest;
+    if (this->m_f > ftest1 && this->m_f > this->m_fx)
+    {
+      this->m_g.Fill(std::numeric_limits<double>::quiet_NaN());
+      this->m_dg = std::numeric_limits<double>::quiet_NaN();
+      this->m_CurrentDerivativeComputed = false;
+      return;
+    }
+  }
+
+  this->ComputeCurrentValueAndDerivative();
+  this->m_dg = this->DirectionalDerivative(this->m_g);
+  this->m_CurrentDerivativeComputed = true;
+
+} // end EvaluateCurrentStep()
+
+
 /**
  * ************************** TestConvergence ****************************
  *
@@ -465,7 +544,14 @@ MoreThuenteLineSearchOptimizer::TestConvergence(bool & stop)
 void
 MoreThuenteLineSearchOptimizer::ComputeNewStepAndInterval(void)
 {
-  int returncode = 0;
+  if (!this->m_CurrentDerivativeComputed)
+  {
+    this->ComputeNewStepWithoutDerivative();
+    return;
+  }
+
+  int          returncode = 0;
+  const double trialStep = this->m_step;
 
   /** In the first stage we seek a step for which the modified
    * function has a nonpositive value and nonnegative derivative. */
@@ -539,9 +625,64 @@ MoreThuenteLineSearchOptimizer::ComputeNewStepAndInterval(void)
     this->m_SafeGuardedStepFailed = true;
   }
 
+  /** Remember the evaluation when the trial step became the best step. */
+  if (this->m_stepx == trialStep)
+  {
+    this->m_BestValue = this->m_f;
+    this->m_BestDerivative = this->m_g;
+    this->m_BestDirectionalDerivative = this->m_dg;
+  }
+
 } // end ComputeNewStepAndInterval()
 
 
+/**
+ * ****************** ComputeNewStepWithoutDerivative ************************
+ *
+ * The trial step has a higher value than the best step m_stepx, so the
+ * minimum is bracketed, as in the first case of SafeGuardedStep. Without
+ * the derivative at the trial step, the new step is the minimizer of the
+ * quadratic that interpolates fx, dgx and f.
+ */
+
+void
+MoreThuenteLineSearchOptimizer::ComputeNewStepWithoutDerivative(void)
+{
+  const double stx = this->m_stepx;
+  const double stp = this->m_step;
+
+  /* CHECK THE INPUT PARAMETERS FOR ERRORS, as SafeGuardedStep does. */
+  if ((this->m_brackt && (stp <= std::min(stx, this->m_stepy) || stp >= std::max(stx, this->m_stepy))) ||
+      this->m_dgx * (stp - stx) >= 0. || this->m_stepmax < this->m_stepmin)
+  {
+    this->m_SafeGuardedStepFailed = true;
+    return;
+  }
+
+  const double stpq = stx + this->m_dgx / ((this->m_fx - this->m_f) / (stp - stx) + this->m_dgx) / 2 * (stp - stx);
+
+  /* UPDATE THE INTERVAL OF UNCERTAINTY. */
+  this->m_stepy = stp;
+  this->m_fy = this->m_f;
+  this->m_dgy = std::numeric_limits<double>::quiet_NaN();
+  this->m_brackt = true;
+
+  /* COMPUTE THE NEW STEP AND SAFEGUARD IT. */
+  double       step = std::max(this->m_stepmin, std::min(this->m_stepmax, stpq));
+  const double bound = stx + (this->m_stepy - stx) * .66f;
+  if (this->m_stepy > stx)
+  {
+    step = std::min(bound, step);
+  }
+  else
+  {
+    step = std::max(bound, step);
+  }
+  this->m_step = step;
+
+} // end ComputeNewStepWithoutDerivative()
+
+
 /**
  * ************** ForceSufficientDecreaseInIntervalWidth ******************
  *
@@ -818,7 +959,15 @@ MoreThuenteLineSearchOptimizer::SafeGuardedStep(double &       stx,
   {
     returncode = 4;
     bound = false;
-    if (brackt)
+    if (brackt && std::isnan(dy))
+    {
+      /* THE DERIVATIVE AT STY IS UNKNOWN WHEN ONLY THE VALUE WAS */
+      /* COMPUTED THERE. THE QUADRATIC STEP THROUGH FP, DP, AND FY */
+      /* IS TAKEN INSTEAD OF THE CUBIC STEP. */
+      stpq = stp + dp / ((fp - fy) / (sty - stp) + dp) / 2 * (sty - stp);
+      stpf = stpq;
+    }
+    else if (brackt)
     {
       theta = (fp - fy) * 3 / (sty - stp) + dy + dp;
       s = std::max(std::max(std::abs(theta), std::abs(dy)), std::abs(dp));
@@ -940,6 +1089,7 @@ MoreThuenteLineSearchOptimizer::PrintSelf(std::ostream & os, Indent indent) cons
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
   os << indent << "m_GradientTolerance: " << this->m_GradientTolerance << std::endl;
   os << indent << "m_IntervalTolerance: " << this->m_IntervalTolerance << std::endl;
+  os << indent << "m_UseValueOnlyProbes: " << (this->m_UseValueOnlyProbes ? "true" : "false") << std::endl;
 
 } // end PrintSelf()
 
@@ -64,6 +64,17 @@ namespace itk
  * when rounding errors prevent further progress. In this case stp only
  * satisfies the sufficient decrease condition.
  *
+ * When a trial step returns to the best step found so far, which happens
+ * at an unusual termination, the value and derivative computed earlier
+ * at that step are reused instead of evaluating the cost function again.
+ *
+ * Optionally, the derivative is not computed for trial steps that do not
+ * satisfy the sufficient decrease condition and that have a higher value
+ * than the best step so far. Such a step brackets the minimum, and cannot
+ * satisfy the Wolfe conditions anyway. The next step is then the minimizer
+ * of the quadratic that interpolates the values at both steps and the
+ * derivative at the best step. See SetUseValueOnlyProbes().
+ *
  *
  * \ingroup Numerics Optimizers
  */
@@ -172,6 +183,17 @@ public:
   itkSetClampMacro(IntervalTolerance, double, 0.0, NumericTraits<double>::max());
   itkGetConstMacro(IntervalTolerance, double);
 
+  /** Setting: first compute only the value at a trial step, and compute the
+   * derivative only when the Wolfe conditions or the step computation need it.
+   * This saves a derivative evaluation for every trial step that overshoots
+   * the minimum, but costs an extra value evaluation for the other trial steps,
+   * so it pays off when the value is much cheaper than the derivative. The
+   * trial steps differ from those of mcsrch_. False by default.
+   */
+  itkSetMacro(UseValueOnlyProbes, bool);
+  itkGetConstMacro(UseValueOnlyProbes, bool);
+  itkBooleanMacro(UseValueOnlyProbes);
+
 protected:
   MoreThuenteLineSearchOptimizer();
   ~MoreThuenteLineSearchOptimizer() override = default;
@@ -217,6 +239,16 @@ protected:
   virtual void
   ComputeCurrentValueAndDerivative(void);
 
+  /** Ask the cost function to compute only m_f at the current position. */
+  virtual void
+  ComputeCurrentValue(void);
+
+  /** Compute m_f, m_g and m_dg at the current step, reusing the evaluation
+   * of the best step, and skipping the derivative when possible.
+   */
+  virtual void
+  EvaluateCurrentStep(void);
+
   /** Check for convergence */
   virtual void
   TestConvergence(bool & stop);
@@ -225,6 +257,12 @@ protected:
   virtual void
   ComputeNewStepAndInterval(void);
 
+  /** Update the interval of uncertainty and compute the new step after a
+   * trial step of which only the value is known.
+   */
+  virtual void
+  ComputeNewStepWithoutDerivative(void);
+
   /** Force a sufficient decrease in the size of the interval of uncertainty */
   virtual void
   ForceSufficientDecreaseInIntervalWidth(void);
@@ -264,6 +302,15 @@ protected:
   double         m_dgy;
   double         m_dgtest;
 
+  /** The evaluation at m_stepx, as returned by the cost function. Note that
+   * m_dgy is NaN when only the value was computed at m_stepy. */
+  MeasureType    m_BestValue;
+  DerivativeType m_BestDerivative;
+  double         m_BestDirectionalDerivative;
+
+  /** Whether m_g and m_dg are valid for the current step. */
+  bool m_CurrentDerivativeComputed;
+
   double m_width;
   double m_width1;
 
@@ -280,6 +327,7 @@ private:
   double        m_ValueTolerance;
   double        m_GradientTolerance;
   double        m_IntervalTolerance;
+  bool          m_UseValueOnlyProbes;
 };
 
 } // end namespace itk
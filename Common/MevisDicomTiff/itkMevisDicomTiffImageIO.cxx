@@ -44,6 +44,7 @@
 #include "gdcmException.h"
 #include "gdcmFileMetaInformation.h"
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -846,6 +847,18 @@ MevisDicomTiffImageIO::Read(void * buffer)
       return;
     }
 
+    // streamed reading, only the requested region
+    bool isWholeImage = true;
+    for (unsigned int i = 0; i < this->GetNumberOfDimensions(); ++i)
+    {
+      isWholeImage &= m_IORegion.GetIndex(i) == 0 && m_IORegion.GetSize(i) == m_Dimensions[i];
+    }
+    if (!isWholeImage)
+    {
+      this->ReadRegion(buffer);
+      return;
+    }
+
     // buffer pointer is scanline based (one dimensional array)
     // tile is positioned on x,y,z; we read each tile, and fill
     // the corresponding positions in the onedimensional array
@@ -1188,6 +1201,72 @@ MevisDicomTiffImageIO::Read(void * buffer)
 }
 
 
+// read region
+void
+MevisDicomTiffImageIO::ReadRegion(void * buffer)
+{
+  // the buffer holds the io region in scanline order; every tile
+  // that overlaps with the region is read once per slice, and only
+  // the overlapping part of its rows is copied
+  const unsigned int numberOfDimensions = this->GetNumberOfDimensions();
+  const SizeValueType xbegin = m_IORegion.GetIndex(0);
+  const SizeValueType xend = xbegin + m_IORegion.GetSize(0);
+  const SizeValueType ybegin = m_IORegion.GetIndex(1);
+  const SizeValueType yend = ybegin + m_IORegion.GetSize(1);
+  const SizeValueType zbegin = numberOfDimensions > 2 ? m_IORegion.GetIndex(2) : 0;
+  const SizeValueType zend = numberOfDimensions > 2 ? zbegin + m_IORegion.GetSize(2) : 1;
+  const SizeValueType tbegin = numberOfDimensions > 3 ? m_IORegion.GetIndex(3) : 0;
+  const SizeValueType tend = numberOfDimensions > 3 ? tbegin + m_IORegion.GetSize(3) : 1;
+
+  const unsigned int  tilerowbytes = TIFFTileRowSize(m_TIFFImage);
+  const unsigned int  bytespersample = m_BitsPerSample / 8;
+  const SizeValueType slicebytes = (xend - xbegin) * (yend - ybegin) * bytespersample;
+
+  unsigned char * vol = reinterpret_cast<unsigned char *>(buffer);
+  unsigned char * tilebuf = static_cast<unsigned char *>(_TIFFmalloc(TIFFTileSize(m_TIFFImage)));
+
+  for (SizeValueType t = tbegin; t < tend; ++t)
+  {
+    for (SizeValueType z = zbegin; z < zend; ++z)
+    {
+      // in 4d, the tiff slices are the 3d volumes after each other
+      const unsigned int z0 = numberOfDimensions > 3 ? z + t * m_Dimensions[2] : z;
+
+      for (SizeValueType y0 = ybegin - ybegin % m_TileLength; y0 < yend; y0 += m_TileLength)
+      {
+        for (SizeValueType x0 = xbegin - xbegin % m_TileWidth; x0 < xend; x0 += m_TileWidth)
+        {
+          if (TIFFReadTile(m_TIFFImage, tilebuf, x0, y0, z0, 0) < 0)
+          {
+            _TIFFfree(tilebuf);
+            itkExceptionMacro(<< "mevisIO:read(): error reading tile (region)");
+            return;
+          }
+
+          // the part of the tile inside the region
+          const SizeValueType xfirst = std::max(x0, xbegin);
+          const SizeValueType xlast = std::min(x0 + m_TileWidth, xend);
+          const SizeValueType yfirst = std::max(y0, ybegin);
+          const SizeValueType ylast = std::min(y0 + m_TileLength, yend);
+          const SizeValueType rowbytes = (xlast - xfirst) * bytespersample;
+
+          for (SizeValueType y = yfirst; y < ylast; ++y)
+          {
+            unsigned char * pv = vol + ((y - ybegin) * (xend - xbegin) + (xfirst - xbegin)) * bytespersample;
+            unsigned char * pb = tilebuf + (y - y0) * tilerowbytes + (xfirst - x0) * bytespersample;
+            memcpy(pv, pb, rowbytes);
+          }
+        }
+      }
+      vol += slicebytes;
+    }
+  }
+
+  _TIFFfree(tilebuf);
+}
+
+
+
 // canwritefile
 bool
 MevisDicomTiffImageIO::CanWriteFile(const char * name)
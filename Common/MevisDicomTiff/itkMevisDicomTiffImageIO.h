@@ -63,6 +63,9 @@ namespace itk
  *  PROPERTIES:
  *  - 2D/3D/4D, scalar types supported
  *  - input/output tiff image expected to be tiled
+ *  - streamed reading: for a requested region, only the tiles that overlap
+ *    with it are read and decoded. Uncompressed files are memory mapped
+ *    by libtiff itself.
  *  - types supported uchar, char, ushort, short, uint, int, and float
  *    (double is not accepted by MevisLab)
  *  - writing defaults is tiled tiff, tilesize is 128, 128,
@@ -140,7 +143,7 @@ public:
   virtual bool
   CanStreamRead()
   {
-    return false;
+    return true;
   }
 
 
@@ -162,6 +165,10 @@ private:
   void
   operator=(const Self &);
 
+  // reads the tiles that overlap with the io region, when it is not the whole image
+  void
+  ReadRegion(void * buffer);
+
   bool
   FindElement(const gdcm::DataSet ds, const gdcm::Tag tag, gdcm::DataElement & de, const bool breadthfirstsearch);
 
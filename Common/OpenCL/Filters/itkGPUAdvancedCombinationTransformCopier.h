@@ -26,6 +26,10 @@ namespace itk
  * \brief A helper class which creates an GPU AdvancedCombinationTransform which
  * is perfect copy of the CPU AdvancedCombinationTransform.
  *
+ * Sub-transforms without a GPU implementation, and combinations that use
+ * addition instead of composition, are wrapped in a GPUHostTransform. The
+ * GPUResampleImageFilter evaluates those on the host.
+ *
  * This class is NOT a filter. Although it has an API similar to a filter, this class
  * is not intended to be used in a pipeline. Instead, the typical use will be like
  * it is illustrated in the following code:
@@ -151,6 +155,10 @@ protected:
   bool
   CopyToCurrentTransform(const CPUCurrentTransformConstPointer & fromTransform, GPUComboTransformPointer & toTransform);
 
+  /** Wrap a transform without GPU implementation in a GPUHostTransform. */
+  void
+  CopyToHostTransform(const TransformType * fromTransform, GPUComboTransformPointer & toTransform);
+
   /** Cast and copy the transform parameters. */
   void
   CastCopyTransformParameters(const CPUCurrentTransformConstPointer & fromTransform,
@@ -37,6 +37,7 @@
 #include "itkGPUAdvancedEuler3DTransform.h"
 #include "itkGPUAdvancedSimilarity2DTransform.h"
 #include "itkGPUAdvancedSimilarity3DTransform.h"
+#include "itkGPUHostTransform.h"
 
 // GPU factory include
 #include "itkGPUImageFactory.h"
@@ -92,23 +93,33 @@ GPUAdvancedCombinationTransformCopier<TTypeList,
   // Initialize the current transforms
   CPUCurrentTransformConstPointer currentTransformCPU;
   GPUComboTransformPointer        currentTransformGPU = comboTransformGPU;
+  const CPUComboTransformType *   comboTransformCPU = this->m_InputTransform.GetPointer();
 
   // Loop over all sub-transforms
   const SizeValueType numberOfTransforms = this->m_InputTransform->GetNumberOfTransforms();
   for (SizeValueType i = 0; i < numberOfTransforms; ++i)
   {
+    // The GPU resampler only composes the sub-transforms, so a combination
+    // that adds its current and initial transform is evaluated as a whole on the host.
+    if (comboTransformCPU && comboTransformCPU->GetUseAddition() && i < numberOfTransforms - 1)
+    {
+      this->CopyToHostTransform(comboTransformCPU, currentTransformGPU);
+      break;
+    }
+
     // Get the current CPU transform of type itk::Transform
     TransformTypePointer itkCurrentTransform = this->m_InputTransform->GetNthTransform(i);
 
-    // Cast to advanced transform type, no checking needed
+    // Cast to advanced transform type
     currentTransformCPU = dynamic_cast<const CPUCurrentTransformType *>(itkCurrentTransform.GetPointer());
 
-    // Copy the current CPU transform to the current GPU transform
-    const bool copySucceeded = this->CopyToCurrentTransform(currentTransformCPU, currentTransformGPU);
-    if (!copySucceeded)
+    // Copy the current CPU transform to the current GPU transform. Transforms
+    // that have no GPU implementation are evaluated on the host.
+    const bool copySucceeded =
+      currentTransformCPU.IsNotNull() && this->CopyToCurrentTransform(currentTransformCPU, currentTransformGPU);
+    if (!copySucceeded && itkCurrentTransform.IsNotNull())
     {
-      itkExceptionMacro(<< "ERROR: GPUAdvancedCombinationTransformCopier was unable to copy transform from: "
-                        << this->m_InputTransform);
+      this->CopyToHostTransform(itkCurrentTransform.GetPointer(), currentTransformGPU);
     }
 
     // skip next step when last transform
@@ -121,6 +132,13 @@ GPUAdvancedCombinationTransformCopier<TTypeList,
     GPUComboTransformPointer initialNext = GPUComboTransformType::New();
     currentTransformGPU->SetInitialTransform(initialNext);
     currentTransformGPU = initialNext;
+
+    // Move to the next level of the CPU combo transform
+    if (comboTransformCPU)
+    {
+      comboTransformCPU =
+        dynamic_cast<const CPUComboTransformType *>(comboTransformCPU->GetInitialTransform().GetPointer());
+    }
   }
 }
 
@@ -249,6 +267,26 @@ GPUAdvancedCombinationTransformCopier<
 }
 
 
+//------------------------------------------------------------------------------
+template <typename TTypeList,
+          typename NDimensions,
+          typename TAdvancedCombinationTransform,
+          typename TOutputTransformPrecisionType>
+void
+GPUAdvancedCombinationTransformCopier<
+  TTypeList,
+  NDimensions,
+  TAdvancedCombinationTransform,
+  TOutputTransformPrecisionType>::CopyToHostTransform(const TransformType *      fromTransform,
+                                                      GPUComboTransformPointer & toTransform)
+{
+  typedef GPUHostTransform<GPUScalarType, SpaceDimension, CPUScalarType> GPUHostTransformType;
+  typename GPUHostTransformType::Pointer hostTransform = GPUHostTransformType::New();
+  hostTransform->SetHostTransform(fromTransform);
+  toTransform->SetCurrentTransform(hostTransform);
+}
+
+
 //------------------------------------------------------------------------------
 template <typename TTypeList,
           typename NDimensions,
@@ -0,0 +1,37 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkGPUAdvancedMeanSquaresImageToImageMetric_h
+#define itkGPUAdvancedMeanSquaresImageToImageMetric_h
+
+#include "itkMacro.h"
+
+namespace itk
+{
+/** \class GPUAdvancedMeanSquaresImageToImageMetric
+ * \brief GPU version of the value and derivative of AdvancedMeanSquaresImageToImageMetric.
+ *
+ * The kernels are used by the elastix OpenCLAdvancedMeanSquares metric.
+ *
+ * \ingroup GPUCommon
+ */
+
+/** Create a helper GPU Kernel class for GPUAdvancedMeanSquaresImageToImageMetric */
+itkGPUKernelClassMacro(GPUAdvancedMeanSquaresImageToImageMetricKernel);
+} // end namespace itk
+
+#endif /* itkGPUAdvancedMeanSquaresImageToImageMetric_h */
@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkGPUBSplineTransformToImageSource_h
+#define itkGPUBSplineTransformToImageSource_h
+
+#include "itkImageSource.h"
+#include "itkTransform.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+
+#include "itkGPUImage.h"
+#include "itkGPUDataManager.h"
+#include "itkOpenCLKernelManager.h"
+
+namespace itk
+{
+/** Create a helper GPU Kernel class for GPUBSplineTransformToImageSource */
+itkGPUKernelClassMacro(GPUBSplineTransformToImageSourceKernel);
+
+/** \class GPUBSplineTransformToImageSource
+ * \brief Computes the displacement field, the spatial Jacobian, or the
+ * determinant of the spatial Jacobian of a transform with OpenCL.
+ *
+ * The quantity follows from the pixel type of the output image: a Vector of
+ * floats gives the displacement field T(x) - x, a Matrix of floats the spatial
+ * Jacobian dT/dx, and a float the determinant of the spatial Jacobian. So this
+ * source is a GPU version of TransformToDisplacementFieldFilter,
+ * TransformToSpatialJacobianSource and
+ * TransformToDeterminantOfSpatialJacobianSource.
+ *
+ * Only transforms of the form T(x) = A_post( B( A_pre( x ) ) ) are supported,
+ * with B an AdvancedBSplineDeformableTransform of order 1, 2 or 3, and A_pre
+ * and A_post linear transforms, possibly absent. Such a transform may be
+ * composed of AdvancedCombinationTransforms, which should use composition if
+ * both their initial and current transform are set. Use
+ * IsSupportedTransform() to check a transform before setting it.
+ *
+ * The output is computed in chunks along the slowest dimension, of at most
+ * MaximumNumberOfPixelsPerChunk pixels each. When this number is zero (the
+ * default), the chunk size follows from the memory of the OpenCL device.
+ *
+ * \ingroup GPUCommon
+ */
+template <typename TOutputImage, typename TTransformPrecisionType = double>
+class ITK_TEMPLATE_EXPORT GPUBSplineTransformToImageSource : public ImageSource<TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef GPUBSplineTransformToImageSource Self;
+  typedef ImageSource<TOutputImage>        Superclass;
+  typedef SmartPointer<Self>               Pointer;
+  typedef SmartPointer<const Self>         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(GPUBSplineTransformToImageSource, ImageSource);
+
+  /** ImageDimension constants */
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  /** Typedefs for the output image. */
+  typedef TOutputImage                            OutputImageType;
+  typedef typename OutputImageType::Pointer       OutputImagePointer;
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename OutputImageType::RegionType    OutputImageRegionType;
+  typedef typename OutputImageType::SizeType      SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for the transform. */
+  typedef TTransformPrecisionType                                                        TransformPrecisionType;
+  typedef Transform<TransformPrecisionType, ImageDimension, ImageDimension>              TransformType;
+  typedef typename TransformType::ConstPointer                                           TransformConstPointer;
+  typedef AdvancedBSplineDeformableTransformBase<TransformPrecisionType, ImageDimension> BSplineTransformType;
+  typedef Matrix<TransformPrecisionType, ImageDimension, ImageDimension>                 MatrixType;
+  typedef Vector<TransformPrecisionType, ImageDimension>                                 OffsetType;
+
+  /** Typedefs for the GPU buffers. */
+  typedef GPUImage<float, ImageDimension>           GPUCoefficientImageType;
+  typedef typename GPUCoefficientImageType::Pointer GPUCoefficientImagePointer;
+  typedef typename GPUDataManager::Pointer          GPUDataManagerPointer;
+  typedef typename OpenCLKernelManager::Pointer     GPUKernelManagerPointer;
+
+  /** Set/Get the transform. Set only transforms for which
+   * IsSupportedTransform() returns true. */
+  itkSetConstObjectMacro(Transform, TransformType);
+  itkGetConstObjectMacro(Transform, TransformType);
+
+  /** Returns whether the transform can be evaluated by this source. */
+  static bool
+  IsSupportedTransform(const TransformType * transform);
+
+  /** Set/Get the geometry of the output image. */
+  itkSetMacro(OutputSize, SizeType);
+  itkGetConstReferenceMacro(OutputSize, SizeType);
+  itkSetMacro(OutputIndex, IndexType);
+  itkGetConstReferenceMacro(OutputIndex, IndexType);
+  itkSetMacro(OutputSpacing, SpacingType);
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType);
+  itkSetMacro(OutputOrigin, OriginType);
+  itkGetConstReferenceMacro(OutputOrigin, OriginType);
+  itkSetMacro(OutputDirection, DirectionType);
+  itkGetConstReferenceMacro(OutputDirection, DirectionType);
+
+  /** Set/Get the maximum number of pixels that is computed at once. Zero means
+   * that it is derived from the memory of the OpenCL device. */
+  itkSetMacro(MaximumNumberOfPixelsPerChunk, SizeValueType);
+  itkGetConstMacro(MaximumNumberOfPixelsPerChunk, SizeValueType);
+
+  /** The object comprises the transform. */
+  ModifiedTimeType
+  GetMTime(void) const override;
+
+protected:
+  GPUBSplineTransformToImageSource();
+  ~GPUBSplineTransformToImageSource() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Set the geometry of the output image. */
+  void
+  GenerateOutputInformation(void) override;
+
+  /** Compute the requested region of the output, chunk by chunk. */
+  void
+  GenerateData(void) override;
+
+  /** The parts of a supported transform: x -> a_post( b( a_pre( x ) ) ). */
+  struct DecomposedTransform
+  {
+    MatrixType                   PreMatrix;
+    OffsetType                   PreOffset;
+    const BSplineTransformType * BSplineTransform;
+    unsigned int                 SplineOrder;
+    MatrixType                   PostMatrix;
+    OffsetType                   PostOffset;
+  };
+
+  /** Splits a transform in its parts. Returns false if it is not supported. */
+  static bool
+  DecomposeTransform(const TransformType * transform, DecomposedTransform & decomposed);
+
+  /** Adds a transform, which is applied after the transforms that are already
+   * in decomposed. Returns false if it is not supported. */
+  static bool
+  AppendTransform(const TransformType * transform, DecomposedTransform & decomposed);
+
+  /** Converts an image size to a work size of the kernel. */
+  static OpenCLSize
+  ToWorkSize(const SizeType & size);
+
+private:
+  GPUBSplineTransformToImageSource(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  TransformConstPointer m_Transform;
+  SizeType              m_OutputSize;
+  IndexType             m_OutputIndex;
+  SpacingType           m_OutputSpacing;
+  OriginType            m_OutputOrigin;
+  DirectionType         m_OutputDirection;
+  SizeValueType         m_MaximumNumberOfPixelsPerChunk{ 0 };
+
+  GPUKernelManagerPointer m_KernelManager;
+  std::size_t             m_KernelId{ 0 };
+  GPUDataManagerPointer   m_OutputBuffer;
+  GPUDataManagerPointer   m_CoefficientsImageBase;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkGPUBSplineTransformToImageSource.hxx"
+#endif
+
+#endif /* itkGPUBSplineTransformToImageSource_h */
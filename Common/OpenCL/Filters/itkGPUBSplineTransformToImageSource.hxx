@@ -0,0 +1,488 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkGPUBSplineTransformToImageSource_hxx
+#define itkGPUBSplineTransformToImageSource_hxx
+
+#include "itkGPUBSplineTransformToImageSource.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkDefaultConvertPixelTraits.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+
+#include "itkGPUImageBase.h"
+#include "itkGPUMath.h"
+#include "itkGPUMatrixOffsetTransformBase.h"
+#include "itkGPUBSplineBaseTransform.h"
+#include "itkGPUKernelManagerHelperFunctions.h"
+#include "itkOpenCLContext.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace itk
+{
+
+/**
+ * ***************** Constructor ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::GPUBSplineTransformToImageSource()
+{
+  typedef DefaultConvertPixelTraits<PixelType> PixelConvertTraits;
+  static_assert(std::is_same<typename PixelConvertTraits::ComponentType, float>::value,
+                "GPUBSplineTransformToImageSource only supports pixels of floats.");
+
+  this->m_OutputSize.Fill(0);
+  this->m_OutputIndex.Fill(0);
+  this->m_OutputSpacing.Fill(1.0);
+  this->m_OutputOrigin.Fill(0.0);
+  this->m_OutputDirection.SetIdentity();
+
+  this->m_KernelManager = OpenCLKernelManager::New();
+  this->m_OutputBuffer = GPUDataManager::New();
+  this->m_CoefficientsImageBase = GPUDataManager::New();
+
+  if (ImageDimension < 2 || ImageDimension > 3)
+  {
+    itkExceptionMacro("GPUBSplineTransformToImageSource supports 2/3D images.");
+  }
+
+  // The computed quantity follows from the number of components of the pixel.
+  std::ostringstream defines;
+  defines << "#define DIM_" << ImageDimension << "\n";
+  const unsigned int numberOfComponents = PixelConvertTraits::GetNumberOfComponents();
+  if (numberOfComponents == 1)
+  {
+    defines << "#define DETERMINANT_OF_SPATIAL_JACOBIAN\n";
+  }
+  else if (numberOfComponents == ImageDimension)
+  {
+    defines << "#define DISPLACEMENT_FIELD\n";
+  }
+  else if (numberOfComponents == ImageDimension * ImageDimension)
+  {
+    defines << "#define SPATIAL_JACOBIAN\n";
+  }
+  else
+  {
+    itkExceptionMacro("GPUBSplineTransformToImageSource does not support pixels of " << numberOfComponents
+                                                                                    << " components.");
+  }
+
+  // OpenCL kernel source
+  std::ostringstream source;
+  source << GPUMathKernel::GetOpenCLSource() << std::endl;
+  source << GPUImageBaseKernel::GetOpenCLSource() << std::endl;
+  source << GPUMatrixOffsetTransformBaseKernel::GetOpenCLSource() << std::endl;
+  source << GPUBSplineTransformKernel::GetOpenCLSource() << std::endl;
+  source << GPUBSplineTransformToImageSourceKernel::GetOpenCLSource() << std::endl;
+
+  // Build and create kernel
+  const OpenCLProgram program = this->m_KernelManager->BuildProgramFromSourceCode(source.str(), defines.str());
+  if (program.IsNull())
+  {
+    itkExceptionMacro(<< "Kernel has not been loaded from string:\n" << defines.str() << std::endl << source.str());
+  }
+  this->m_KernelId = this->m_KernelManager->CreateKernel(program, "BSplineTransformToImageSource");
+} // end Constructor
+
+
+/**
+ * ***************** IsSupportedTransform ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+bool
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::IsSupportedTransform(
+  const TransformType * transform)
+{
+  DecomposedTransform decomposed;
+  return (ImageDimension == 2 || ImageDimension == 3) && DecomposeTransform(transform, decomposed) &&
+         decomposed.BSplineTransform != nullptr;
+} // end IsSupportedTransform()
+
+
+/**
+ * ***************** DecomposeTransform ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+bool
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::DecomposeTransform(
+  const TransformType * transform,
+  DecomposedTransform & decomposed)
+{
+  decomposed.PreMatrix.SetIdentity();
+  decomposed.PreOffset.Fill(0.0);
+  decomposed.BSplineTransform = nullptr;
+  decomposed.SplineOrder = 0;
+  decomposed.PostMatrix.SetIdentity();
+  decomposed.PostOffset.Fill(0.0);
+
+  return transform != nullptr && AppendTransform(transform, decomposed);
+} // end DecomposeTransform()
+
+
+/**
+ * ***************** AppendTransform ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+bool
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::AppendTransform(
+  const TransformType * transform,
+  DecomposedTransform & decomposed)
+{
+  typedef AdvancedCombinationTransform<TransformPrecisionType, ImageDimension> CombinationTransformType;
+
+  if (transform == nullptr)
+  {
+    return true;
+  }
+
+  // A combination applies its initial transform first, and then its current transform.
+  const auto * combination = dynamic_cast<const CombinationTransformType *>(transform);
+  if (combination != nullptr)
+  {
+    const TransformType * initialTransform = combination->GetInitialTransform();
+    const TransformType * currentTransform = combination->GetCurrentTransform();
+    if (combination->GetUseAddition() && initialTransform != nullptr && currentTransform != nullptr)
+    {
+      return false;
+    }
+    return AppendTransform(initialTransform, decomposed) && AppendTransform(currentTransform, decomposed);
+  }
+
+  // A single B-spline transform of order 1, 2 or 3.
+  const auto * bspline = dynamic_cast<const BSplineTransformType *>(transform);
+  if (bspline != nullptr)
+  {
+    if (decomposed.BSplineTransform != nullptr)
+    {
+      return false;
+    }
+
+    if (dynamic_cast<const AdvancedBSplineDeformableTransform<TransformPrecisionType, ImageDimension, 1> *>(bspline))
+    {
+      decomposed.SplineOrder = 1;
+    }
+    else if (dynamic_cast<const AdvancedBSplineDeformableTransform<TransformPrecisionType, ImageDimension, 2> *>(
+               bspline))
+    {
+      decomposed.SplineOrder = 2;
+    }
+    else if (dynamic_cast<const AdvancedBSplineDeformableTransform<TransformPrecisionType, ImageDimension, 3> *>(
+               bspline))
+    {
+      decomposed.SplineOrder = 3;
+    }
+    else
+    {
+      return false;
+    }
+    decomposed.BSplineTransform = bspline;
+    return true;
+  }
+
+  if (!transform->IsLinear())
+  {
+    return false;
+  }
+
+  // The matrix and offset of a linear transform follow from the images of the origin and the unit vectors.
+  typename TransformType::InputPointType point;
+  point.Fill(0.0);
+  const typename TransformType::OutputPointType origin = transform->TransformPoint(point);
+
+  MatrixType matrix;
+  for (unsigned int j = 0; j < ImageDimension; ++j)
+  {
+    point.Fill(0.0);
+    point[j] = 1.0;
+    const typename TransformType::OutputPointType transformedPoint = transform->TransformPoint(point);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      matrix[i][j] = transformedPoint[i] - origin[i];
+    }
+  }
+  const OffsetType offset = origin.GetVectorFromOrigin();
+
+  // Compose it with the linear transform before or after the B-spline.
+  if (decomposed.BSplineTransform == nullptr)
+  {
+    decomposed.PreOffset = matrix * decomposed.PreOffset + offset;
+    decomposed.PreMatrix = matrix * decomposed.PreMatrix;
+  }
+  else
+  {
+    decomposed.PostOffset = matrix * decomposed.PostOffset + offset;
+    decomposed.PostMatrix = matrix * decomposed.PostMatrix;
+  }
+  return true;
+} // end AppendTransform()
+
+
+/**
+ * ***************** ToWorkSize ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+OpenCLSize
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::ToWorkSize(const SizeType & size)
+{
+  std::size_t workSize[3] = { 1, 1, 1 };
+  for (unsigned int i = 0; i < ImageDimension && i < 3; ++i)
+  {
+    workSize[i] = size[i];
+  }
+  return ImageDimension == 2 ? OpenCLSize(workSize[0], workSize[1]) : OpenCLSize(workSize[0], workSize[1], workSize[2]);
+} // end ToWorkSize()
+
+
+/**
+ * ***************** GetMTime ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+ModifiedTimeType
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::GetMTime(void) const
+{
+  ModifiedTimeType latestTime = Superclass::GetMTime();
+  if (this->m_Transform.IsNotNull() && latestTime < this->m_Transform->GetMTime())
+  {
+    latestTime = this->m_Transform->GetMTime();
+  }
+  return latestTime;
+} // end GetMTime()
+
+
+/**
+ * ***************** GenerateOutputInformation ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+void
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::GenerateOutputInformation(void)
+{
+  OutputImageType * output = this->GetOutput();
+  if (!output)
+  {
+    return;
+  }
+
+  const OutputImageRegionType largestRegion(this->m_OutputIndex, this->m_OutputSize);
+  output->SetLargestPossibleRegion(largestRegion);
+  output->SetSpacing(this->m_OutputSpacing);
+  output->SetOrigin(this->m_OutputOrigin);
+  output->SetDirection(this->m_OutputDirection);
+} // end GenerateOutputInformation()
+
+
+/**
+ * ***************** GenerateData ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+void
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::GenerateData(void)
+{
+  itkDebugMacro(<< "GPUBSplineTransformToImageSource::GenerateData() called");
+
+  this->AllocateOutputs();
+  OutputImageType *           output = this->GetOutput();
+  const OutputImageRegionType requestedRegion = output->GetRequestedRegion();
+  if (requestedRegion.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  DecomposedTransform decomposed;
+  if (!DecomposeTransform(this->m_Transform, decomposed) || decomposed.BSplineTransform == nullptr)
+  {
+    itkExceptionMacro(<< "The transform is not supported by GPUBSplineTransformToImageSource.");
+  }
+
+  // Copy the B-spline coefficients to the device, in single precision.
+  const typename BSplineTransformType::ImagePointer * coefficientImages =
+    decomposed.BSplineTransform->GetCoefficientImages();
+  GPUCoefficientImagePointer gpuCoefficientImages[ImageDimension];
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    const typename BSplineTransformType::ImageType * coefficientImage = coefficientImages[i];
+    GPUCoefficientImagePointer                       gpuCoefficientImage = GPUCoefficientImageType::New();
+    gpuCoefficientImage->CopyInformation(coefficientImage);
+    gpuCoefficientImage->SetRegions(coefficientImage->GetBufferedRegion());
+    gpuCoefficientImage->Allocate();
+
+    const SizeValueType numberOfCoefficients = coefficientImage->GetBufferedRegion().GetNumberOfPixels();
+    const auto *        coefficients = coefficientImage->GetBufferPointer();
+    float *             gpuCoefficients = gpuCoefficientImage->GetBufferPointer();
+    for (SizeValueType k = 0; k < numberOfCoefficients; ++k)
+    {
+      gpuCoefficients[k] = static_cast<float>(coefficients[k]);
+    }
+
+    gpuCoefficientImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+    gpuCoefficientImage->GetGPUDataManager()->UpdateGPUBuffer();
+    gpuCoefficientImages[i] = gpuCoefficientImage;
+  }
+
+  // The number of pixels that fit in the buffer of a chunk. By default a quarter
+  // of the device memory is used, within the maximum size of a single buffer.
+  OpenCLContext * context = this->m_KernelManager->GetContext();
+  SizeValueType   maximumNumberOfPixels = this->m_MaximumNumberOfPixelsPerChunk;
+  if (maximumNumberOfPixels == 0)
+  {
+    const OpenCLDevice  device = context->GetDefaultDevice();
+    const unsigned long maximumBufferSize =
+      std::min<unsigned long>({ device.GetMaximumAllocationSize(),
+                                device.GetGlobalMemorySize() / 4,
+                                static_cast<unsigned long>(NumericTraits<unsigned int>::max()) });
+    maximumNumberOfPixels = std::max<SizeValueType>(maximumBufferSize / sizeof(PixelType), 1);
+  }
+
+  // Split the requested region along the slowest dimension, so that every chunk
+  // is a contiguous part of the output buffer.
+  const SizeValueType numberOfPixels = requestedRegion.GetNumberOfPixels();
+  const unsigned int  requestedNumberOfChunks =
+    static_cast<unsigned int>((numberOfPixels + maximumNumberOfPixels - 1) / maximumNumberOfPixels);
+  const ImageRegionSplitterSlowDimension::Pointer splitter = ImageRegionSplitterSlowDimension::New();
+  const unsigned int numberOfChunks = splitter->GetNumberOfSplits(requestedRegion, requestedNumberOfChunks);
+
+  SizeValueType maximumChunkNumberOfPixels = 0;
+  for (unsigned int i = 0; i < numberOfChunks; ++i)
+  {
+    OutputImageRegionType chunkRegion = requestedRegion;
+    splitter->GetSplit(i, numberOfChunks, chunkRegion);
+    maximumChunkNumberOfPixels = std::max(maximumChunkNumberOfPixels, chunkRegion.GetNumberOfPixels());
+  }
+
+  this->m_OutputBuffer->Initialize();
+  this->m_OutputBuffer->SetBufferFlag(CL_MEM_WRITE_ONLY);
+  this->m_OutputBuffer->SetBufferSize(static_cast<unsigned int>(maximumChunkNumberOfPixels * sizeof(PixelType)));
+  this->m_OutputBuffer->Allocate();
+
+  // Set the arguments that are the same for all chunks. The index of a work item is
+  // relative to the start of the largest possible region, so that is the origin.
+  OpenCLKernel &              kernel = this->m_KernelManager->GetKernel(this->m_KernelId);
+  const OutputImageRegionType largestRegion = output->GetLargestPossibleRegion();
+  typename OutputImageType::PointType largestRegionOrigin;
+  output->TransformIndexToPhysicalPoint(largestRegion.GetIndex(), largestRegionOrigin);
+
+  cl_uint argidx = 0;
+  this->m_KernelManager->SetKernelArgWithImage(this->m_KernelId, argidx++, this->m_OutputBuffer);
+  const cl_uint chunkSizeArgumentIndex = argidx++;
+  kernel.SetArg(argidx++, output->GetIndexToPhysicalPoint());
+  kernel.SetArg(argidx++, largestRegionOrigin);
+  kernel.SetArg(argidx++, decomposed.PreMatrix);
+  kernel.SetArg(argidx++, decomposed.PreOffset);
+  kernel.SetArg(argidx++, decomposed.PostMatrix);
+  kernel.SetArg(argidx++, decomposed.PostOffset);
+
+  const cl_uint splineOrder = decomposed.SplineOrder;
+  this->m_KernelManager->SetKernelArg(this->m_KernelId, argidx++, sizeof(cl_uint), &splineOrder);
+
+  SetKernelWithITKImage<GPUCoefficientImageType>(this->m_KernelManager,
+                                                 this->m_KernelId,
+                                                 argidx,
+                                                 gpuCoefficientImages[0],
+                                                 this->m_CoefficientsImageBase,
+                                                 false,
+                                                 true);
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    SetKernelWithITKImage<GPUCoefficientImageType>(this->m_KernelManager,
+                                                   this->m_KernelId,
+                                                   argidx,
+                                                   gpuCoefficientImages[i],
+                                                   this->m_CoefficientsImageBase,
+                                                   true,
+                                                   false);
+  }
+
+  // Define the local work size
+  const OpenCLSize deviceLocalWorkSize = OpenCLSize::GetLocalWorkSize(context->GetDefaultDevice());
+  const OpenCLSize localWorkSize =
+    ImageDimension == 2 ? OpenCLSize(deviceLocalWorkSize[0], deviceLocalWorkSize[1]) : deviceLocalWorkSize;
+
+  for (unsigned int i = 0; i < numberOfChunks; ++i)
+  {
+    OutputImageRegionType chunkRegion = requestedRegion;
+    splitter->GetSplit(i, numberOfChunks, chunkRegion);
+
+    SizeType globalWorkOffset;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      globalWorkOffset[d] = static_cast<SizeValueType>(chunkRegion.GetIndex()[d] - largestRegion.GetIndex()[d]);
+    }
+
+    kernel.SetArg(chunkSizeArgumentIndex, chunkRegion.GetSize());
+    const OpenCLSize globalWorkSize = ToWorkSize(chunkRegion.GetSize()).RoundTo(localWorkSize);
+
+    OpenCLEvent event = this->m_KernelManager->LaunchKernel(
+      this->m_KernelId, globalWorkSize, localWorkSize, ToWorkSize(globalWorkOffset));
+    event.WaitForFinished();
+
+    // Copy the chunk to its part of the output buffer.
+    const std::size_t chunkBufferSize = chunkRegion.GetNumberOfPixels() * sizeof(PixelType);
+    PixelType *       chunkBuffer = output->GetBufferPointer() + output->ComputeOffset(chunkRegion.GetIndex());
+    const cl_int      error = clEnqueueReadBuffer(context->GetActiveQueue(),
+                                             *this->m_OutputBuffer->GetGPUBufferPointer(),
+                                             CL_TRUE,
+                                             0,
+                                             chunkBufferSize,
+                                             chunkBuffer,
+                                             0,
+                                             nullptr,
+                                             nullptr);
+    context->ReportError(error, __FILE__, __LINE__, ITK_LOCATION);
+    context->AddTransferProfiling(false, chunkBufferSize);
+
+    this->UpdateProgress(static_cast<float>(i + 1) / static_cast<float>(numberOfChunks));
+  }
+
+  itkDebugMacro(<< "GPUBSplineTransformToImageSource::GenerateData() finished");
+} // end GenerateData()
+
+
+/**
+ * ***************** PrintSelf ***********************
+ */
+
+template <typename TOutputImage, typename TTransformPrecisionType>
+void
+GPUBSplineTransformToImageSource<TOutputImage, TTransformPrecisionType>::PrintSelf(std::ostream & os,
+                                                                                  Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "OutputSize: " << this->m_OutputSize << std::endl;
+  os << indent << "OutputIndex: " << this->m_OutputIndex << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "MaximumNumberOfPixelsPerChunk: " << this->m_MaximumNumberOfPixelsPerChunk << std::endl;
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif /* itkGPUBSplineTransformToImageSource_hxx */
@@ -83,6 +83,11 @@ public:
   virtual bool
   HasBSplineTransform(void) const;
 
+  /** Returns true if the derived composite transform has a transform that is
+   * applied on the host, false otherwise. */
+  virtual bool
+  HasHostTransform(void) const;
+
   /** Returns true if the transform at \a index is identity transform,
    * false otherwise. */
   virtual bool
@@ -103,6 +108,11 @@ public:
   virtual bool
   IsBSplineTransform(const std::size_t index) const;
 
+  /** Returns true if the transform at \a index is applied on the host,
+   * false otherwise. */
+  virtual bool
+  IsHostTransform(const std::size_t index) const;
+
 protected:
   GPUCompositeTransformBase() = default;
   ~GPUCompositeTransformBase() override = default;
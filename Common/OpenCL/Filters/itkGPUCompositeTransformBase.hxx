@@ -174,6 +174,23 @@ GPUCompositeTransformBase<TScalarType, NDimensions>::HasBSplineTransform(void) c
 }
 
 
+//------------------------------------------------------------------------------
+template <typename TScalarType, unsigned int NDimensions>
+bool
+GPUCompositeTransformBase<TScalarType, NDimensions>::HasHostTransform(void) const
+{
+  for (std::size_t i = 0; i < this->GetNumberOfTransforms(); ++i)
+  {
+    if (this->IsHostTransform(i))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
 //------------------------------------------------------------------------------
 template <typename TScalarType, unsigned int NDimensions>
 bool
@@ -265,6 +282,18 @@ GPUCompositeTransformBase<TScalarType, NDimensions>::IsBSplineTransform(const st
 }
 
 
+//------------------------------------------------------------------------------
+template <typename TScalarType, unsigned int NDimensions>
+bool
+GPUCompositeTransformBase<TScalarType, NDimensions>::IsHostTransform(const std::size_t index) const
+{
+  const GPUTransformBase * transformBase =
+    dynamic_cast<const GPUTransformBase *>(this->GetNthTransform(index).GetPointer());
+
+  return transformBase != nullptr && transformBase->IsHostTransform();
+}
+
+
 //------------------------------------------------------------------------------
 template <typename TScalarType, unsigned int NDimensions>
 bool
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkGPUHostTransform_h
+#define itkGPUHostTransform_h
+
+#include "itkAdvancedTransform.h"
+#include "itkGPUTransformBase.h"
+
+namespace itk
+{
+/** \class GPUHostTransform
+ * \brief Wraps a transform without an OpenCL implementation, so that it can be
+ * part of a GPU combination transform.
+ *
+ * The GPUResampleImageFilter applies the wrapped transform to the points on
+ * the host, in between the OpenCL kernels of the other transforms. Only
+ * TransformPoint() is supported. The wrapped transform may have a different
+ * precision than this transform, typically double.
+ *
+ * \ingroup GPUCommon
+ */
+template <typename TScalarType = float, unsigned int NDimensions = 3, typename THostScalarType = double>
+class ITK_TEMPLATE_EXPORT GPUHostTransform
+  : public AdvancedTransform<TScalarType, NDimensions, NDimensions>
+  , public GPUTransformBase
+{
+public:
+  /** Standard class typedefs. */
+  typedef GPUHostTransform                                         Self;
+  typedef AdvancedTransform<TScalarType, NDimensions, NDimensions> CPUSuperclass;
+  typedef GPUTransformBase                                         GPUSuperclass;
+  typedef SmartPointer<Self>                                       Pointer;
+  typedef SmartPointer<const Self>                                 ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(GPUHostTransform, CPUSuperclass);
+
+  /** Typedefs from the superclass. */
+  typedef typename CPUSuperclass::ParametersType                ParametersType;
+  typedef typename CPUSuperclass::FixedParametersType           FixedParametersType;
+  typedef typename CPUSuperclass::JacobianType                  JacobianType;
+  typedef typename CPUSuperclass::InputPointType                InputPointType;
+  typedef typename CPUSuperclass::OutputPointType               OutputPointType;
+  typedef typename CPUSuperclass::TransformCategoryEnum         TransformCategoryEnum;
+  typedef typename CPUSuperclass::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
+  typedef typename CPUSuperclass::SpatialJacobianType           SpatialJacobianType;
+  typedef typename CPUSuperclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
+  typedef typename CPUSuperclass::SpatialHessianType            SpatialHessianType;
+  typedef typename CPUSuperclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
+
+  /** The type of the wrapped transform. */
+  typedef Transform<THostScalarType, NDimensions, NDimensions> HostTransformType;
+  typedef typename HostTransformType::ConstPointer             HostTransformConstPointer;
+
+  /** Set/Get the wrapped transform. */
+  itkSetConstObjectMacro(HostTransform, HostTransformType);
+  itkGetConstObjectMacro(HostTransform, HostTransformType);
+
+  /** Transform a point with the wrapped transform. */
+  OutputPointType
+  TransformPoint(const InputPointType & point) const override
+  {
+    typename HostTransformType::InputPointType hostPoint;
+    hostPoint.CastFrom(point);
+
+    OutputPointType outputPoint;
+    outputPoint.CastFrom(this->m_HostTransform->TransformPoint(hostPoint));
+    return outputPoint;
+  }
+
+  /** The wrapped transform is not assumed to be linear. */
+  bool
+  IsLinear() const override
+  {
+    return false;
+  }
+
+  /** The category is unknown, so that the transform is never mistaken for
+   * one of the transforms with an OpenCL implementation. */
+  TransformCategoryEnum
+  GetTransformCategory() const override
+  {
+    return TransformCategoryEnum::UnknownTransformCategory;
+  }
+
+  /** This transform is applied on the host. */
+  bool
+  IsHostTransform(void) const override
+  {
+    return true;
+  }
+
+  /** The parameters are those of the wrapped transform, and are not used. */
+  void
+  SetParameters(const ParametersType &) override
+  {}
+
+  void
+  SetFixedParameters(const FixedParametersType &) override
+  {}
+
+  const ParametersType &
+  GetParameters(void) const override
+  {
+    return this->m_Parameters;
+  }
+
+  const FixedParametersType &
+  GetFixedParameters(void) const override
+  {
+    return this->m_FixedParameters;
+  }
+
+  /** The derivatives are not supported. */
+  void
+  GetJacobian(const InputPointType &, JacobianType &, NonZeroJacobianIndicesType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetSpatialJacobian(const InputPointType &, SpatialJacobianType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetSpatialHessian(const InputPointType &, SpatialHessianType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetJacobianOfSpatialJacobian(const InputPointType &,
+                               JacobianOfSpatialJacobianType &,
+                               NonZeroJacobianIndicesType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetJacobianOfSpatialJacobian(const InputPointType &,
+                               SpatialJacobianType &,
+                               JacobianOfSpatialJacobianType &,
+                               NonZeroJacobianIndicesType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetJacobianOfSpatialHessian(const InputPointType &,
+                              JacobianOfSpatialHessianType &,
+                              NonZeroJacobianIndicesType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+  void
+  GetJacobianOfSpatialHessian(const InputPointType &,
+                              SpatialHessianType &,
+                              JacobianOfSpatialHessianType &,
+                              NonZeroJacobianIndicesType &) const override
+  {
+    itkExceptionMacro(<< "GPUHostTransform only supports TransformPoint().");
+  }
+
+protected:
+  GPUHostTransform()
+    : CPUSuperclass(0)
+  {
+    this->m_HasNonZeroSpatialHessian = false;
+    this->m_HasNonZeroJacobianOfSpatialHessian = false;
+  }
+
+
+  ~GPUHostTransform() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override
+  {
+    CPUSuperclass::PrintSelf(os, indent);
+    os << indent << "HostTransform: " << this->m_HostTransform.GetPointer() << std::endl;
+  }
+
+
+private:
+  GPUHostTransform(const Self & other) = delete;
+  const Self &
+  operator=(const Self &) = delete;
+
+  HostTransformConstPointer m_HostTransform;
+};
+
+} // end namespace itk
+
+#endif /* itkGPUHostTransform_h */
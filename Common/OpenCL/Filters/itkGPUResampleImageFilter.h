@@ -26,6 +26,7 @@
 #include "itkGPUBSplineBaseTransform.h"
 #include "itkGPUTransformBase.h"
 #include "itkGPUCompositeTransformBase.h"
+#include "itkOpenCLDeviceLoadBalancer.h"
 
 namespace itk
 {
@@ -35,6 +36,12 @@ itkGPUKernelClassMacro(GPUResampleImageFilterKernel);
 /** \class GPUResampleImageFilter
  * \brief GPU version of ResampleImageFilter.
  *
+ * When the OpenCL context contains multiple devices, the output chunks of a
+ * 3D image are distributed over all devices. Each device has its own command
+ * queue, deformation field and output buffer. The chunks are assigned based on
+ * the measured throughput of the devices, see OpenCLDeviceLoadBalancer, and
+ * are collected in the output image at the end.
+ *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
  *
@@ -132,6 +139,7 @@ protected:
     MatrixOffsetTransform,
     TranslationTransform,
     BSplineTransform,
+    HostTransform,
     Else
   } GPUTransformTypeEnum;
 
@@ -157,6 +165,19 @@ protected:
   void
   SetBSplineTransformCoefficientsToGPU(const std::size_t transformIndex);
 
+  /** Set the deformation field and output buffers of a device to the
+   * pre, loop and post kernels. */
+  void
+  SetDeviceBuffersForKernelManagers(const GPUDataManagerPointer & deformationField,
+                                    const GPUDataManagerPointer & output);
+
+  /** Apply the transform \a transformIndex, which has no OpenCL implementation,
+   * to the first \a numberOfPoints points of \a deformationField on the host. */
+  void
+  TransformPointsOnHost(const std::size_t             transformIndex,
+                        const GPUDataManagerPointer & deformationField,
+                        const std::size_t             numberOfPoints);
+
   /** Get transform type. */
   const GPUTransformTypeEnum
   GetTransformType(const int & transformIndex) const;
@@ -189,7 +210,11 @@ private:
   GPUDataManagerPointer m_OutputGPUImageBase;
   GPUDataManagerPointer m_FilterParameters;
   GPUDataManagerPointer m_DeformationFieldBuffer;
+  std::vector<float>    m_HostDeformationField;
   unsigned int          m_RequestedNumberOfSplits;
+  cl_uint               m_PostKernelOutputArgumentIndex;
+
+  OpenCLDeviceLoadBalancer m_DeviceLoadBalancer;
 
   typedef std::pair<int, bool>                            TransformHandle;
   typedef std::map<GPUTransformTypeEnum, TransformHandle> TransformsHandle;
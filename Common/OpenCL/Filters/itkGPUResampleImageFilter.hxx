@@ -80,6 +80,7 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
   this->m_TransformBase = nullptr;
 
   this->m_RequestedNumberOfSplits = 5;
+  this->m_PostKernelOutputArgumentIndex = 0;
 
   std::ostringstream defines;
   if (TInputImage::ImageDimension > 3 || TInputImage::ImageDimension < 1)
@@ -438,6 +439,23 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
     requestedNumberOfSplits = 1;
   }
 
+  // In a context with multiple devices the chunks are distributed over the
+  // devices, which requires a few chunks per device for the load balancing.
+  const OpenCLContext::Pointer    context = OpenCLContext::GetInstance();
+  std::vector<OpenCLCommandQueue> deviceQueues;
+  if (InputImageDimension >= 3 && context->GetDevices().size() > 1)
+  {
+    deviceQueues = context->GetDeviceCommandQueues();
+  }
+  const std::size_t numberOfDevices = std::max<std::size_t>(deviceQueues.size(), 1);
+  const bool        useMultipleDevices = numberOfDevices > 1;
+  if (useMultipleDevices)
+  {
+    const unsigned int chunksPerDevice = 4;
+    requestedNumberOfSplits =
+      std::max(requestedNumberOfSplits, static_cast<unsigned int>(chunksPerDevice * numberOfDevices));
+  }
+
   typedef ImageRegionSplitterSlowDimension RegionSplitterType;
   RegionSplitterType::Pointer              splitter = RegionSplitterType::New();
   const unsigned int numberOfChunks = splitter->GetNumberOfSplits(outputLargestRegion, requestedNumberOfSplits);
@@ -493,6 +511,25 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
   this->m_DeformationFieldBuffer->SetBufferSize(mem_size_DF);
   this->m_DeformationFieldBuffer->Allocate();
 
+  // The other devices get their own deformation field and output buffers,
+  // because a buffer may not be written by multiple devices at the same time.
+  std::vector<GPUDataManagerPointer> deformationFieldBuffers(1, this->m_DeformationFieldBuffer);
+  std::vector<GPUDataManagerPointer> outputBuffers(1, outPtr->GetGPUDataManager());
+  for (std::size_t device = 1; device < numberOfDevices; ++device)
+  {
+    GPUDataManagerPointer deformationFieldBuffer = GPUDataManager::New();
+    deformationFieldBuffer->SetBufferFlag(CL_MEM_READ_WRITE);
+    deformationFieldBuffer->SetBufferSize(mem_size_DF);
+    deformationFieldBuffer->Allocate();
+    deformationFieldBuffers.push_back(deformationFieldBuffer);
+
+    GPUDataManagerPointer outputBuffer = GPUDataManager::New();
+    outputBuffer->SetBufferFlag(CL_MEM_READ_WRITE);
+    outputBuffer->SetBufferSize(outputBuffers[0]->GetBufferSize());
+    outputBuffer->Allocate();
+    outputBuffers.push_back(outputBuffer);
+  }
+
   // Set arguments for pre kernel
   this->SetArgumentsForPreKernelManager(outPtr);
 
@@ -522,10 +559,18 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
   std::size_t offset3D[3], offset2D[2], offset1D;
 
   // Some temporaries
-  OpenCLEventList eventList;
-  unsigned int    piece;
-  OpenCLSize      global_work_size;
-  OpenCLSize      global_work_offset;
+  std::vector<OpenCLEventList> eventLists(numberOfDevices);
+  unsigned int                 piece;
+  OpenCLSize                   global_work_size;
+  OpenCLSize                   global_work_offset;
+
+  // The post kernel events of the chunks that are pending on each device,
+  // and the device that processed each chunk.
+  const std::size_t                    maximumNumberOfPendingChunks = 2;
+  std::vector<std::deque<OpenCLEvent>> pendingChunks(numberOfDevices);
+  std::vector<std::size_t>             chunkDevices(numberOfChunks, 0);
+  const OpenCLCommandQueue             activeQueue = context->GetCommandQueue();
+  this->m_DeviceLoadBalancer.SetNumberOfDevices(numberOfDevices);
 
   /** Loop over the chunks. */
   for (piece = 0; piece < numberOfChunks && !this->GetAbortGenerateData(); ++piece)
@@ -534,6 +579,35 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
     OutputImageRegionType currentChunkRegion = outputLargestRegion;
     splitter->GetSplit(piece, numberOfChunks, currentChunkRegion);
 
+    // Select the device that is expected to finish this chunk first
+    std::size_t device = 0;
+    if (useMultipleDevices)
+    {
+      for (std::size_t d = 0; d < numberOfDevices; ++d)
+      {
+        while (!pendingChunks[d].empty() && pendingChunks[d].front().IsComplete())
+        {
+          pendingChunks[d].pop_front();
+          this->m_DeviceLoadBalancer.FinishWork(d);
+        }
+      }
+
+      const double chunkSize = static_cast<double>(currentChunkRegion.GetNumberOfPixels());
+      device = this->m_DeviceLoadBalancer.SelectDevice(chunkSize);
+      while (pendingChunks[device].size() >= maximumNumberOfPendingChunks)
+      {
+        pendingChunks[device].front().WaitForFinished();
+        pendingChunks[device].pop_front();
+        this->m_DeviceLoadBalancer.FinishWork(device);
+      }
+      this->m_DeviceLoadBalancer.AddWork(device, chunkSize);
+      chunkDevices[piece] = device;
+
+      context->SetCommandQueue(deviceQueues[device]);
+      this->SetDeviceBuffersForKernelManagers(deformationFieldBuffers[device], outputBuffers[device]);
+    }
+    OpenCLEventList & eventList = eventLists[device];
+
     // define and set deformation field size, global_work_size and global_work_offset
     // The deformation field size is the second argument in the
     // pre/loop/post kernel, i.e. index is 1.
@@ -638,6 +712,14 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
 
       for (int i = compositeTransform->GetNumberOfTransforms() - 1; i >= 0; i--)
       {
+        /** Transforms without an OpenCL implementation are applied on the host. */
+        if (this->GetTransformType(i) == GPUResampleImageFilter::HostTransform)
+        {
+          eventList.WaitForFinished();
+          this->TransformPointsOnHost(i, deformationFieldBuffers[device], currentChunkRegion.GetNumberOfPixels());
+          continue;
+        }
+
         /** Set the transform parameters to the loop kernel. */
         this->SetTransformParametersForLoopKernelManager(i);
 
@@ -649,6 +731,11 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
 
       } // end loop over the list of transforms
     }   // end if is combo
+    else if (this->GetTransformType(0) == GPUResampleImageFilter::HostTransform)
+    {
+      eventList.WaitForFinished();
+      this->TransformPointsOnHost(0, deformationFieldBuffers[device], currentChunkRegion.GetNumberOfPixels());
+    }
     else
     {
       /** Get the kernel id for this transform and launch it. */
@@ -661,9 +748,54 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
     // Launch the post kernel
     OpenCLEvent postEvent = this->m_PostKernelManager->LaunchKernel(this->m_FilterPostGPUKernelHandle, eventList);
     eventList.Append(postEvent);
+    if (useMultipleDevices)
+    {
+      pendingChunks[device].push_back(postEvent);
+    }
+  }
+
+  for (std::size_t device = 0; device < numberOfDevices; ++device)
+  {
+    eventLists[device].WaitForFinished();
+    while (!pendingChunks[device].empty())
+    {
+      pendingChunks[device].pop_front();
+      this->m_DeviceLoadBalancer.FinishWork(device);
+    }
   }
 
-  eventList.WaitForFinished();
+  // Collect the chunks of the other devices in the output image
+  if (useMultipleDevices)
+  {
+    context->SetCommandQueue(activeQueue);
+    for (unsigned int i = 0; i < piece; ++i)
+    {
+      if (chunkDevices[i] == 0)
+      {
+        continue;
+      }
+
+      // The chunks are split along the slowest dimension, so they are contiguous
+      OutputImageRegionType currentChunkRegion = outputLargestRegion;
+      splitter->GetSplit(i, numberOfChunks, currentChunkRegion);
+      const std::size_t offset = outPtr->ComputeOffset(currentChunkRegion.GetIndex()) * sizeof(OutputImagePixelType);
+      const std::size_t size = currentChunkRegion.GetNumberOfPixels() * sizeof(OutputImagePixelType);
+
+      const cl_int error = clEnqueueCopyBuffer(context->GetActiveQueue(),
+                                               *outputBuffers[chunkDevices[i]]->GetGPUBufferPointer(),
+                                               *outputBuffers[0]->GetGPUBufferPointer(),
+                                               offset,
+                                               offset,
+                                               size,
+                                               0,
+                                               nullptr,
+                                               nullptr);
+      context->ReportError(error, __FILE__, __LINE__, ITK_LOCATION);
+    }
+    context->Finish();
+
+    itkDebugMacro(<< "GPUResampleImageFilter used " << numberOfDevices << " OpenCL devices");
+  }
 
   itkDebugMacro(<< "GPUResampleImageFilter::GPUGenerateData() finished");
 } // end GPUGenerateData()
@@ -916,6 +1048,7 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::S
   }
 
   // Set output image to the kernel
+  this->m_PostKernelOutputArgumentIndex = argidx;
   GPUDataManager::Pointer dummy;
   SetKernelWithITKImage<GPUOutputImage>(
     this->m_PostKernelManager, this->m_FilterPostGPUKernelHandle, argidx, output, dummy, true, false);
@@ -936,6 +1069,106 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::S
 } // end SetArgumentsForPostKernelManager()
 
 
+/**
+ * ***************** SetDeviceBuffersForKernelManagers ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::SetDeviceBuffersForKernelManagers(
+  const GPUDataManagerPointer & deformationField,
+  const GPUDataManagerPointer & output)
+{
+  // The deformation field is the first argument of the pre, loop and post kernels
+  const cl_uint deformationFieldKernelIndex = 0;
+  this->m_PreKernelManager->SetKernelArgWithImage(
+    this->m_FilterPreGPUKernelHandle, deformationFieldKernelIndex, deformationField);
+
+  typename TransformsHandle::const_iterator it = this->m_FilterLoopGPUKernelHandle.begin();
+  for (; it != this->m_FilterLoopGPUKernelHandle.end(); ++it)
+  {
+    if (it->second.second)
+    {
+      this->m_LoopKernelManager->SetKernelArgWithImage(it->second.first, deformationFieldKernelIndex, deformationField);
+    }
+  }
+
+  this->m_PostKernelManager->SetKernelArgWithImage(
+    this->m_FilterPostGPUKernelHandle, deformationFieldKernelIndex, deformationField);
+  this->m_PostKernelManager->SetKernelArgWithImage(
+    this->m_FilterPostGPUKernelHandle, this->m_PostKernelOutputArgumentIndex, output);
+} // end SetDeviceBuffersForKernelManagers()
+
+
+/**
+ * ***************** TransformPointsOnHost ***********************
+ */
+
+template <typename TInputImage, typename TOutputImage, typename TInterpolatorPrecisionType>
+void
+GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::TransformPointsOnHost(
+  const std::size_t             transformIndex,
+  const GPUDataManagerPointer & deformationField,
+  const std::size_t             numberOfPoints)
+{
+  itkDebugMacro(<< "GPUResampleImageFilter::TransformPointsOnHost(" << transformIndex << ") called");
+
+  typedef typename CompositeTransformBaseType::TransformType HostTransformType;
+
+  // Get the transform
+  const HostTransformType * transform = nullptr;
+  if (this->m_TransformIsCombo)
+  {
+    const CompositeTransformBaseType * compositeTransform =
+      dynamic_cast<const CompositeTransformBaseType *>(this->m_TransformBase);
+    transform = compositeTransform->GetNthTransform(transformIndex).GetPointer();
+  }
+  else
+  {
+    transform = dynamic_cast<const HostTransformType *>(this->GetTransform());
+  }
+
+  if (!transform)
+  {
+    itkExceptionMacro(<< "Could not get the transform to apply on the host.");
+  }
+
+  // Copy the points to the host. A cl_float3 point occupies four floats.
+  const std::size_t stride = (OutputImageDimension == 3) ? 4 : OutputImageDimension;
+  this->m_HostDeformationField.resize(deformationField->GetBufferSize() / sizeof(float));
+  deformationField->SetCPUBufferPointer(this->m_HostDeformationField.data());
+  deformationField->SetCPUDirtyFlag(true);
+  deformationField->UpdateCPUBuffer();
+
+  // Transform the points in parallel
+  float * points = this->m_HostDeformationField.data();
+  this->GetMultiThreader()->ParallelizeArray(
+    0,
+    numberOfPoints,
+    [transform, points, stride](SizeValueType pointIndex) {
+      float *                                    element = points + pointIndex * stride;
+      typename HostTransformType::InputPointType point;
+      for (unsigned int d = 0; d < OutputImageDimension; ++d)
+      {
+        point[d] = element[d];
+      }
+
+      const typename HostTransformType::OutputPointType transformedPoint = transform->TransformPoint(point);
+      for (unsigned int d = 0; d < OutputImageDimension; ++d)
+      {
+        element[d] = static_cast<float>(transformedPoint[d]);
+      }
+    },
+    nullptr);
+
+  // Copy the transformed points back to the GPU
+  deformationField->SetGPUDirtyFlag(true);
+  deformationField->UpdateGPUBuffer();
+
+  itkDebugMacro(<< "GPUResampleImageFilter::TransformPointsOnHost() finished");
+} // end TransformPointsOnHost()
+
+
 /**
  * ***************** GetTransformType ***********************
  */
@@ -966,6 +1199,10 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
     {
       return GPUResampleImageFilter::BSplineTransform;
     }
+    else if (compositeTransform->IsHostTransform(transformIndex))
+    {
+      return GPUResampleImageFilter::HostTransform;
+    }
   } // end if combo
   else
   {
@@ -985,6 +1222,10 @@ GPUResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::G
     {
       return GPUResampleImageFilter::BSplineTransform;
     }
+    else if (this->m_TransformBase->IsHostTransform())
+    {
+      return GPUResampleImageFilter::HostTransform;
+    }
   }
 
   return GPUResampleImageFilter::Else;
@@ -83,6 +83,14 @@ public:
     return false;
   }
 
+  /** Returns true if the derived transform has no OpenCL implementation,
+   * and is applied to the points on the host instead, false otherwise. */
+  virtual bool
+  IsHostTransform(void) const
+  {
+    return false;
+  }
+
   /** Returns data manager that stores all settings for the transform. */
   virtual GPUDataManager::Pointer
   GetParametersDataManager(void) const;
@@ -34,6 +34,8 @@
  *=========================================================================*/
 #include "itkGPUDataManager.h"
 
+#include <cstring> // For memcpy.
+
 namespace itk
 {
 // constructor
@@ -42,6 +44,8 @@ GPUDataManager::GPUDataManager()
   m_Context = OpenCLContext::GetInstance();
   m_GPUBuffer = nullptr;
   m_CPUBuffer = nullptr;
+  m_PinnedBuffer = nullptr;
+  m_PinnedBufferSize = 0;
 
   m_CPUBufferLock = false;
   m_GPUBufferLock = false;
@@ -53,6 +57,8 @@ GPUDataManager::GPUDataManager()
 //------------------------------------------------------------------------------
 GPUDataManager::~GPUDataManager()
 {
+  this->ReleasePinnedBuffer();
+
   if (m_GPUBuffer)
   {
 #if (defined(_WIN32) && defined(_DEBUG)) || !defined(NDEBUG)
@@ -165,29 +171,7 @@ GPUDataManager::UpdateCPUBuffer()
               << m_CPUBuffer << std::endl;
 #endif
 
-    cl_int errid;
-#ifdef OPENCL_PROFILING
-    cl_event clEvent = NULL;
-    errid = clEnqueueReadBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                m_GPUBuffer,
-                                CL_TRUE,
-                                0,
-                                m_BufferSize,
-                                m_CPUBuffer,
-                                0,
-                                nullptr,
-                                &clEvent);
-#else
-    errid = clEnqueueReadBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                m_GPUBuffer,
-                                CL_TRUE,
-                                0,
-                                m_BufferSize,
-                                m_CPUBuffer,
-                                0,
-                                nullptr,
-                                nullptr);
-#endif
+    const cl_int errid = this->CopyGPUBufferToCPUBuffer();
 
     m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
     // m_ContextManager->OpenCLProfile(clEvent, "clEnqueueReadBuffer GPU->CPU");
@@ -215,29 +199,7 @@ GPUDataManager::UpdateGPUBuffer()
               << m_GPUBuffer << std::endl;
 #endif
 
-    cl_int errid;
-#ifdef OPENCL_PROFILING
-    cl_event clEvent = NULL;
-    errid = clEnqueueWriteBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                 m_GPUBuffer,
-                                 CL_TRUE,
-                                 0,
-                                 m_BufferSize,
-                                 m_CPUBuffer,
-                                 0,
-                                 nullptr,
-                                 &clEvent);
-#else
-    errid = clEnqueueWriteBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                 m_GPUBuffer,
-                                 CL_TRUE,
-                                 0,
-                                 m_BufferSize,
-                                 m_CPUBuffer,
-                                 0,
-                                 nullptr,
-                                 nullptr);
-#endif
+    const cl_int errid = this->CopyCPUBufferToGPUBuffer();
     m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
     // m_ContextManager->OpenCLProfile(clEvent, "clEnqueueWriteBuffer CPU->GPU");
 
@@ -332,6 +294,7 @@ GPUDataManager::Initialize()
     cl_int errid = clReleaseMemObject(m_GPUBuffer);
     m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
   }
+  this->ReleasePinnedBuffer();
 
   m_BufferSize = 0;
   m_GPUBuffer = nullptr;
@@ -342,6 +305,114 @@ GPUDataManager::Initialize()
 
   m_CPUBufferLock = false;
   m_GPUBufferLock = false;
+  m_UsePinnedHostMemory = false;
+}
+
+
+//------------------------------------------------------------------------------
+cl_int
+GPUDataManager::CopyCPUBufferToGPUBuffer()
+{
+  const cl_command_queue queue = m_Context->GetCommandQueue().GetQueueId();
+  m_Context->AddTransferProfiling(true, m_BufferSize);
+
+  if (!m_UsePinnedHostMemory || !this->AllocatePinnedBuffer())
+  {
+    return clEnqueueWriteBuffer(queue, m_GPUBuffer, CL_TRUE, 0, m_BufferSize, m_CPUBuffer, 0, nullptr, nullptr);
+  }
+
+  // Mapping the pinned buffer waits for the previous copy from it to finish,
+  // because the commands on the queue are executed in order.
+  cl_int errid;
+  void * pinned =
+    clEnqueueMapBuffer(queue, m_PinnedBuffer, CL_TRUE, CL_MAP_WRITE, 0, m_BufferSize, 0, nullptr, nullptr, &errid);
+  if (errid != CL_SUCCESS)
+  {
+    return errid;
+  }
+  std::memcpy(pinned, m_CPUBuffer, m_BufferSize);
+  errid = clEnqueueUnmapMemObject(queue, m_PinnedBuffer, pinned, 0, nullptr, nullptr);
+  if (errid != CL_SUCCESS)
+  {
+    return errid;
+  }
+
+  // The CPU buffer may be modified from here on, so the copy to the GPU
+  // buffer does not have to be waited for.
+  cl_event clEvent = nullptr;
+  errid = clEnqueueCopyBuffer(queue, m_PinnedBuffer, m_GPUBuffer, 0, 0, m_BufferSize, 0, nullptr, &clEvent);
+  if (errid != CL_SUCCESS)
+  {
+    return errid;
+  }
+  m_TransferEvent = OpenCLEvent(clEvent);
+  return clFlush(queue);
+}
+
+
+//------------------------------------------------------------------------------
+cl_int
+GPUDataManager::CopyGPUBufferToCPUBuffer()
+{
+  const cl_command_queue queue = m_Context->GetCommandQueue().GetQueueId();
+  m_Context->AddTransferProfiling(false, m_BufferSize);
+
+  if (!m_UsePinnedHostMemory || !this->AllocatePinnedBuffer())
+  {
+    return clEnqueueReadBuffer(queue, m_GPUBuffer, CL_TRUE, 0, m_BufferSize, m_CPUBuffer, 0, nullptr, nullptr);
+  }
+
+  cl_int errid = clEnqueueCopyBuffer(queue, m_GPUBuffer, m_PinnedBuffer, 0, 0, m_BufferSize, 0, nullptr, nullptr);
+  if (errid != CL_SUCCESS)
+  {
+    return errid;
+  }
+  void * pinned =
+    clEnqueueMapBuffer(queue, m_PinnedBuffer, CL_TRUE, CL_MAP_READ, 0, m_BufferSize, 0, nullptr, nullptr, &errid);
+  if (errid != CL_SUCCESS)
+  {
+    return errid;
+  }
+  std::memcpy(m_CPUBuffer, pinned, m_BufferSize);
+  return clEnqueueUnmapMemObject(queue, m_PinnedBuffer, pinned, 0, nullptr, nullptr);
+}
+
+
+//------------------------------------------------------------------------------
+bool
+GPUDataManager::AllocatePinnedBuffer()
+{
+  if (m_PinnedBuffer != nullptr && m_PinnedBufferSize == m_BufferSize)
+  {
+    return true;
+  }
+  this->ReleasePinnedBuffer();
+
+  cl_int errid;
+  m_PinnedBuffer = clCreateBuffer(
+    m_Context->GetContextId(), CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, m_BufferSize, nullptr, &errid);
+  if (errid != CL_SUCCESS)
+  {
+    m_PinnedBuffer = nullptr;
+    return false;
+  }
+  m_PinnedBufferSize = m_BufferSize;
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+void
+GPUDataManager::ReleasePinnedBuffer()
+{
+  m_TransferEvent = OpenCLEvent();
+  if (m_PinnedBuffer)
+  {
+    cl_int errid = clReleaseMemObject(m_PinnedBuffer);
+    m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
+  }
+  m_PinnedBuffer = nullptr;
+  m_PinnedBufferSize = 0;
 }
 
 
@@ -357,6 +428,8 @@ GPUDataManager::PrintSelf(std::ostream & os, Indent indent) const
   os << indent << "m_CPUBuffer: " << m_CPUBuffer << std::endl;
   os << indent << "m_CPUBufferLock: " << m_CPUBufferLock << std::endl;
   os << indent << "m_GPUBufferLock: " << m_GPUBufferLock << std::endl;
+  os << indent << "m_UsePinnedHostMemory: " << m_UsePinnedHostMemory << std::endl;
+  os << indent << "m_PinnedBuffer: " << m_PinnedBuffer << std::endl;
 }
 
 
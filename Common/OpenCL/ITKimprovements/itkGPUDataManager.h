@@ -173,12 +173,51 @@ public:
   }
   itkGetConstReferenceMacro(GPUBufferLock, bool);
 
+  /** Stage the copies between the CPU and GPU buffers through a pinned host
+   * buffer. A CPU->GPU copy then returns as soon as the CPU buffer has been
+   * copied to the pinned buffer, while the copy to the GPU buffer continues
+   * asynchronously. The commands on the command queue are executed in order,
+   * so kernels that use the GPU buffer start after that copy has finished.
+   * The pinned buffer is allocated on the first copy. */
+  void
+  SetUsePinnedHostMemory(const bool v)
+  {
+    this->m_UsePinnedHostMemory = v;
+  }
+  itkGetConstReferenceMacro(UsePinnedHostMemory, bool);
+
+  /** Returns the event of the last asynchronous CPU->GPU copy, which is
+   * null when no such copy has been enqueued. */
+  const OpenCLEvent &
+  GetTransferEvent() const
+  {
+    return this->m_TransferEvent;
+  }
+
 protected:
   GPUDataManager();
   ~GPUDataManager() override;
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Enqueue the copy of the CPU buffer to the GPU buffer. The copy is
+   * asynchronous when pinned host memory is used, and blocking otherwise. */
+  cl_int
+  CopyCPUBufferToGPUBuffer();
+
+  /** Copy the GPU buffer to the CPU buffer, and wait for it. */
+  cl_int
+  CopyGPUBufferToCPUBuffer();
+
+  /** Allocate the pinned host buffer. Returns false if it can not be
+   * allocated, in which case the buffers are copied directly. */
+  bool
+  AllocatePinnedBuffer();
+
+  /** Release the pinned host buffer. */
+  void
+  ReleasePinnedBuffer();
+
 protected:
   unsigned int m_BufferSize; // # of bytes
 
@@ -199,6 +238,12 @@ protected:
   bool m_CPUBufferLock;
   bool m_GPUBufferLock;
 
+  /** pinned host buffer used for staging the copies */
+  bool         m_UsePinnedHostMemory;
+  cl_mem       m_PinnedBuffer;
+  unsigned int m_PinnedBufferSize;
+  OpenCLEvent  m_TransferEvent;
+
   /** Mutex lock to prevent r/w hazard for multithreaded code */
   std::mutex m_Mutex;
 };
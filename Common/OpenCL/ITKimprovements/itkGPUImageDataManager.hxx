@@ -75,27 +75,12 @@ GPUImageDataManager<ImageType>::UpdateCPUBuffer()
      */
     if ((m_IsCPUBufferDirty || (gpu_time > cpu_time)) && m_GPUBuffer != nullptr && m_CPUBuffer != nullptr)
     {
-      cl_int errid;
 #if (defined(_WIN32) && defined(_DEBUG)) || !defined(NDEBUG)
       std::cout << "clEnqueueReadBuffer GPU->CPU"
                 << "..." << std::endl;
 #endif
 
-#ifdef OPENCL_PROFILING
-      cl_event clEvent = NULL;
-      errid = clEnqueueReadBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                  m_GPUBuffer,
-                                  CL_TRUE,
-                                  0,
-                                  m_BufferSize,
-                                  m_CPUBuffer,
-                                  0,
-                                  nullptr,
-                                  &clEvent);
-#else
-      errid = clEnqueueReadBuffer(
-        m_Context->GetCommandQueue().GetQueueId(), m_GPUBuffer, CL_TRUE, 0, m_BufferSize, m_CPUBuffer, 0, 0, 0);
-#endif
+      const cl_int errid = this->CopyGPUBufferToCPUBuffer();
 
       m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
       // m_ContextManager->OpenCLProfile(clEvent, "clEnqueueReadBuffer GPU->CPU");
@@ -138,34 +123,12 @@ GPUImageDataManager<ImageType>::UpdateGPUBuffer()
      */
     if ((m_IsGPUBufferDirty || (gpu_time < cpu_time)) && m_CPUBuffer != nullptr && m_GPUBuffer != nullptr)
     {
-      cl_int errid;
 #if (defined(_WIN32) && defined(_DEBUG)) || !defined(NDEBUG)
       std::cout << "clEnqueueWriteBuffer CPU->GPU"
                 << "..." << std::endl;
 #endif
 
-#ifdef OPENCL_PROFILING
-      cl_event clEvent = NULL;
-      errid = clEnqueueWriteBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                   m_GPUBuffer,
-                                   CL_TRUE,
-                                   0,
-                                   m_BufferSize,
-                                   m_CPUBuffer,
-                                   0,
-                                   nullptr,
-                                   &clEvent);
-#else
-      errid = clEnqueueWriteBuffer(m_Context->GetCommandQueue().GetQueueId(),
-                                   m_GPUBuffer,
-                                   CL_TRUE,
-                                   0,
-                                   m_BufferSize,
-                                   m_CPUBuffer,
-                                   0,
-                                   nullptr,
-                                   nullptr);
-#endif
+      const cl_int errid = this->CopyCPUBufferToGPUBuffer();
       m_Context->ReportError(errid, __FILE__, __LINE__, ITK_LOCATION);
       // m_ContextManager->OpenCLProfile(clEvent, "clEnqueueWriteBuffer CPU->GPU");
 
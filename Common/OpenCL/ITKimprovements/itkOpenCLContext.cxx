@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <deque>
 
 #include "itksys/MD5.h"
 #include "itkOpenCLMacro.h"
@@ -82,6 +83,9 @@ public:
     : id(0)
     , is_created(false)
     , last_error(CL_SUCCESS)
+    , profiling_enabled(false)
+    , bytes_to_device(0)
+    , bytes_to_host(0)
   {}
 
   ~OpenCLContextPimpl()
@@ -89,6 +93,8 @@ public:
     // Release the command queues for the context.
     command_queue = OpenCLCommandQueue();
     default_command_queue = OpenCLCommandQueue();
+    device_command_queues.clear();
+    profiling_events.clear();
 
     // Release the context.
     if (is_created)
@@ -105,6 +111,51 @@ public:
   OpenCLCommandQueue default_command_queue;
   OpenCLDevice       default_device;
   cl_int             last_error;
+  std::string        program_cache_directory;
+
+  std::vector<OpenCLCommandQueue> device_command_queues;
+
+  bool                                             profiling_enabled;
+  std::deque<std::pair<std::string, OpenCLEvent>> profiling_events;
+  OpenCLContext::KernelProfileMapType              kernel_profiles;
+  std::size_t                                      bytes_to_device;
+  std::size_t                                      bytes_to_host;
+
+  /** Adds the timings of the profiling events to the kernel profiles. When
+   * \a wait is false, only the events of the kernels that have finished are added. */
+  void
+  AddProfilingEventsToKernelProfiles(const bool wait)
+  {
+    while (!profiling_events.empty())
+    {
+      OpenCLEvent & event = profiling_events.front().second;
+      if (!wait && !event.IsComplete())
+      {
+        return;
+      }
+      event.WaitForFinished();
+
+      OpenCLContext::KernelProfile & profile = kernel_profiles[profiling_events.front().first];
+      if (profile.m_NumberOfLaunches == 0)
+      {
+        profile.m_QueuedTime = profile.m_SubmittedTime = profile.m_RunTime = 0.0;
+      }
+      ++profile.m_NumberOfLaunches;
+
+      // The times are zero when the queue of the launch did not support profiling
+      const cl_ulong queued = event.GetQueueTime();
+      const cl_ulong submitted = event.GetSubmitTime();
+      const cl_ulong started = event.GetRunTime();
+      const cl_ulong finished = event.GetFinishTime();
+      if (queued != 0 && queued <= submitted && submitted <= started && started <= finished)
+      {
+        profile.m_QueuedTime += 1.0e-9 * static_cast<double>(submitted - queued);
+        profile.m_SubmittedTime += 1.0e-9 * static_cast<double>(started - submitted);
+        profile.m_RunTime += 1.0e-9 * static_cast<double>(finished - started);
+      }
+      profiling_events.pop_front();
+    }
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -549,6 +600,8 @@ OpenCLContext::Release()
   {
     d->command_queue = OpenCLCommandQueue();
     d->default_command_queue = OpenCLCommandQueue();
+    d->device_command_queues.clear();
+    d->profiling_events.clear();
     clReleaseContext(d->id);
     d->id = 0;
     d->default_device = OpenCLDevice();
@@ -653,6 +706,130 @@ OpenCLContext::SetLastError(const cl_int error)
 }
 
 
+//------------------------------------------------------------------------------
+void
+OpenCLContext::SetProgramCacheDirectory(const std::string & directory)
+{
+  ITK_OPENCL_D(OpenCLContext);
+  d->program_cache_directory = directory;
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLContext::GetProgramCacheDirectory() const
+{
+  ITK_OPENCL_D(const OpenCLContext);
+  return d->program_cache_directory;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::SetProfilingEnabled(const bool enabled)
+{
+  ITK_OPENCL_D(OpenCLContext);
+  if (enabled && !d->profiling_enabled)
+  {
+    // Recreate the queues with profiling, when they are used next
+    d->default_command_queue = OpenCLCommandQueue();
+    d->device_command_queues.clear();
+  }
+  d->profiling_enabled = enabled;
+}
+
+
+//------------------------------------------------------------------------------
+bool
+OpenCLContext::GetProfilingEnabled() const
+{
+  ITK_OPENCL_D(const OpenCLContext);
+  return d->profiling_enabled;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::AddKernelProfilingEvent(const std::string & kernelName, const OpenCLEvent & event)
+{
+  ITK_OPENCL_D(OpenCLContext);
+  if (!d->profiling_enabled || event.IsNull())
+  {
+    return;
+  }
+
+  d->profiling_events.push_back(std::make_pair(kernelName, event));
+
+  // Limit the number of events that are retained
+  const std::size_t maximumNumberOfEvents = 1024;
+  if (d->profiling_events.size() > maximumNumberOfEvents)
+  {
+    d->AddProfilingEventsToKernelProfiles(false);
+  }
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::AddTransferProfiling(const bool toDevice, const std::size_t numberOfBytes)
+{
+  ITK_OPENCL_D(OpenCLContext);
+  if (!d->profiling_enabled)
+  {
+    return;
+  }
+
+  if (toDevice)
+  {
+    d->bytes_to_device += numberOfBytes;
+  }
+  else
+  {
+    d->bytes_to_host += numberOfBytes;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+OpenCLContext::KernelProfileMapType
+OpenCLContext::GetKernelProfiles()
+{
+  ITK_OPENCL_D(OpenCLContext);
+  d->AddProfilingEventsToKernelProfiles(true);
+  return d->kernel_profiles;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLContext::GetNumberOfBytesTransferredToDevice() const
+{
+  ITK_OPENCL_D(const OpenCLContext);
+  return d->bytes_to_device;
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLContext::GetNumberOfBytesTransferredToHost() const
+{
+  ITK_OPENCL_D(const OpenCLContext);
+  return d->bytes_to_host;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLContext::ResetProfiling()
+{
+  ITK_OPENCL_D(OpenCLContext);
+  d->profiling_events.clear();
+  d->kernel_profiles.clear();
+  d->bytes_to_device = 0;
+  d->bytes_to_host = 0;
+}
+
+
 //------------------------------------------------------------------------------
 std::string
 OpenCLContext::GetErrorName(const cl_int code)
@@ -794,7 +971,8 @@ OpenCLContext::GetDefaultCommandQueue()
 #ifdef OPENCL_PROFILING
     queue = clCreateCommandQueue(d->id, dev.GetDeviceId(), CL_QUEUE_PROFILING_ENABLE, &(d->last_error));
 #else
-    queue = clCreateCommandQueue(d->id, dev.GetDeviceId(), 0, &(d->last_error));
+    const cl_command_queue_properties properties = d->profiling_enabled ? CL_QUEUE_PROFILING_ENABLE : 0;
+    queue = clCreateCommandQueue(d->id, dev.GetDeviceId(), properties, &(d->last_error));
 #endif
 
     if (!queue)
@@ -828,6 +1006,47 @@ OpenCLContext::GetActiveQueue()
 }
 
 
+//------------------------------------------------------------------------------
+std::vector<OpenCLCommandQueue>
+OpenCLContext::GetDeviceCommandQueues()
+{
+  ITK_OPENCL_D(OpenCLContext);
+  if (!d->is_created || !d->device_command_queues.empty())
+  {
+    return d->device_command_queues;
+  }
+
+  const OpenCLDevice            defaultDevice = this->GetDefaultDevice();
+  const std::list<OpenCLDevice> devices = this->GetDevices();
+  for (std::list<OpenCLDevice>::const_iterator device = devices.begin(); device != devices.end(); ++device)
+  {
+    OpenCLCommandQueue queue;
+    if (*device == defaultDevice)
+    {
+      queue = this->GetDefaultCommandQueue();
+    }
+    else
+    {
+#ifdef OPENCL_PROFILING
+      queue = this->CreateCommandQueue(CL_QUEUE_PROFILING_ENABLE, *device);
+#else
+      queue = this->CreateCommandQueue(d->profiling_enabled ? CL_QUEUE_PROFILING_ENABLE : 0, *device);
+#endif
+    }
+
+    if (queue.IsNull())
+    {
+      itkOpenCLWarningMacro(<< "OpenCLContext::GetDeviceCommandQueues:" << this->GetErrorName(d->last_error));
+      d->device_command_queues.clear();
+      return d->device_command_queues;
+    }
+    d->device_command_queues.push_back(queue);
+  }
+
+  return d->device_command_queues;
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLCommandQueue
 OpenCLContext::CreateCommandQueue(const cl_command_queue_properties properties, const OpenCLDevice & device)
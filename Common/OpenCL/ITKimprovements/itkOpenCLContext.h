@@ -30,6 +30,8 @@
 #include "itkOpenCLProgram.h"
 #include "itkOpenCLUserEvent.h"
 
+#include <map>
+
 namespace itk
 {
 /** \class OpenCLContext
@@ -222,6 +224,85 @@ public:
   void
   SetLastError(const cl_int error);
 
+  /** Sets the directory in which compiled program binaries are cached to
+   * \a directory. When set, OpenCLProgram::Build() stores the binary of a
+   * program that is built for a single device in this directory, and reuses
+   * it on later builds of the same source with the same build options on the
+   * same device and driver. An empty \a directory disables the cache, which
+   * is the default.
+   * \sa GetProgramCacheDirectory(), OpenCLProgram::Build() */
+  void
+  SetProgramCacheDirectory(const std::string & directory);
+
+  /** Returns the directory in which compiled program binaries are cached,
+   * or an empty string when the cache is disabled.
+   * \sa SetProgramCacheDirectory() */
+  std::string
+  GetProgramCacheDirectory() const;
+
+  /** \struct KernelProfile
+   * The accumulated profiling information of the launches of a kernel, in seconds.
+   * The queued time is the time between enqueueing a launch and submitting it
+   * to the device, the submitted time is the time between submitting it and
+   * the start of its execution, and the run time is its execution time. */
+  struct KernelProfile
+  {
+    std::size_t m_NumberOfLaunches;
+    double      m_QueuedTime;
+    double      m_SubmittedTime;
+    double      m_RunTime;
+  };
+  typedef std::map<std::string, KernelProfile> KernelProfileMapType;
+
+  /** Enables or disables the collection of profiling information, which is
+   * disabled by default. When enabled, the command queues of the context are
+   * created with \c{CL_QUEUE_PROFILING_ENABLE}, the launches of all kernels
+   * are timed and the number of bytes transferred between the host and the
+   * devices is counted. The kernels are not waited for, so enabling it does
+   * not change the order of execution.
+   * \sa GetKernelProfiles(), ResetProfiling() */
+  void
+  SetProfilingEnabled(const bool enabled);
+
+  /** Returns true if the collection of profiling information is enabled.
+   * \sa SetProfilingEnabled() */
+  bool
+  GetProfilingEnabled() const;
+
+  /** Records the launch \a event of the kernel \a kernelName, if profiling
+   * is enabled. This is called by OpenCLKernel.
+   * \sa GetKernelProfiles() */
+  void
+  AddKernelProfilingEvent(const std::string & kernelName, const OpenCLEvent & event);
+
+  /** Records a transfer of \a numberOfBytes to the device, or to the host
+   * if \a toDevice is false, if profiling is enabled. This is called by
+   * GPUDataManager.
+   * \sa GetNumberOfBytesTransferredToDevice() */
+  void
+  AddTransferProfiling(const bool toDevice, const std::size_t numberOfBytes);
+
+  /** Returns the profiles of the kernels that were launched since profiling
+   * was enabled or reset, by kernel name. Waits for the kernels that are still
+   * running. \sa ResetProfiling() */
+  KernelProfileMapType
+  GetKernelProfiles();
+
+  /** Returns the number of bytes transferred from the host to the devices
+   * since profiling was enabled or reset. */
+  std::size_t
+  GetNumberOfBytesTransferredToDevice() const;
+
+  /** Returns the number of bytes transferred from the devices to the host
+   * since profiling was enabled or reset. */
+  std::size_t
+  GetNumberOfBytesTransferredToHost() const;
+
+  /** Discards the profiling information collected so far.
+   * \sa GetKernelProfiles() */
+  void
+  ResetProfiling();
+
   /** Returns the name of the supplied OpenCL error \a code. For example,
    * \c{CL_SUCCESS}, \c{CL_INVALID_CONTEXT}, etc.
    * \sa GetLastError() */
@@ -267,6 +348,15 @@ public:
   OpenCLCommandQueue
   CreateCommandQueue(const cl_command_queue_properties properties, const OpenCLDevice & device = OpenCLDevice());
 
+  /** Returns one command queue for each of the GetDevices(), in the same order.
+   * The queue of the default device is GetDefaultCommandQueue(), the others
+   * are created on the first call with the same properties. Make a queue the
+   * active queue with SetCommandQueue() to run kernels on its device.
+   * Returns an empty vector if the context has not been created.
+   * \sa GetDevices(), GetDefaultCommandQueue(), SetCommandQueue() */
+  std::vector<OpenCLCommandQueue>
+  GetDeviceCommandQueues();
+
   /** Creates an OpenCL memory buffer of \a size bytes in length,
    * with the specified \a access mode.
    * The memory is created on the device and will not be accessible
@@ -0,0 +1,162 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkOpenCLDeviceLoadBalancer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace itk
+{
+OpenCLDeviceLoadBalancer::OpenCLDeviceLoadBalancer()
+{
+  this->SetNumberOfDevices(1);
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLDeviceLoadBalancer::SetNumberOfDevices(const std::size_t numberOfDevices)
+{
+  if (numberOfDevices != this->m_Throughputs.size())
+  {
+    this->m_Throughputs.assign(numberOfDevices, 0.0);
+  }
+  this->m_PendingWork.assign(numberOfDevices, std::deque<WorkItem>());
+  this->m_LastFinishTimes.assign(numberOfDevices, ClockType::time_point());
+}
+
+
+//------------------------------------------------------------------------------
+std::size_t
+OpenCLDeviceLoadBalancer::SelectDevice(const double workSize) const
+{
+  std::size_t selectedDevice = 0;
+  double      earliestFinishTime = 0.0;
+  for (std::size_t device = 0; device < this->m_Throughputs.size(); ++device)
+  {
+    double pendingWorkSize = workSize;
+    for (const WorkItem & item : this->m_PendingWork[device])
+    {
+      pendingWorkSize += item.m_Size;
+    }
+
+    const double finishTime = pendingWorkSize / this->GetEstimatedThroughput(device);
+    if (device == 0 || finishTime < earliestFinishTime)
+    {
+      selectedDevice = device;
+      earliestFinishTime = finishTime;
+    }
+  }
+
+  return selectedDevice;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLDeviceLoadBalancer::AddWork(const std::size_t device, const double workSize)
+{
+  const WorkItem item = { workSize, ClockType::now() };
+  this->m_PendingWork[device].push_back(item);
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLDeviceLoadBalancer::FinishWork(const std::size_t device)
+{
+  if (this->m_PendingWork[device].empty())
+  {
+    return;
+  }
+
+  // The work item started on the device after the previous one finished.
+  const WorkItem              item = this->m_PendingWork[device].front();
+  const ClockType::time_point finishTime = ClockType::now();
+  const ClockType::time_point startTime = std::max(item.m_StartTime, this->m_LastFinishTimes[device]);
+  this->m_PendingWork[device].pop_front();
+  this->m_LastFinishTimes[device] = finishTime;
+
+  const double seconds = std::chrono::duration<double>(finishTime - startTime).count();
+  if (seconds <= 0.0)
+  {
+    return;
+  }
+
+  // Smooth the measurements, to be robust against a single slow work item.
+  const double throughput = item.m_Size / seconds;
+  double &     currentThroughput = this->m_Throughputs[device];
+  currentThroughput = (currentThroughput > 0.0) ? 0.5 * (currentThroughput + throughput) : throughput;
+}
+
+
+//------------------------------------------------------------------------------
+std::vector<std::size_t>
+OpenCLDeviceLoadBalancer::SplitWork(const std::size_t totalWorkSize) const
+{
+  const std::size_t   numberOfDevices = this->m_Throughputs.size();
+  std::vector<double> throughputs(numberOfDevices);
+  for (std::size_t device = 0; device < numberOfDevices; ++device)
+  {
+    throughputs[device] = this->GetEstimatedThroughput(device);
+  }
+  const double totalThroughput = std::accumulate(throughputs.begin(), throughputs.end(), 0.0);
+
+  // The remainder of the rounding is given to the first device.
+  std::vector<std::size_t> workSizes(numberOfDevices, 0);
+  std::size_t              assignedWorkSize = 0;
+  for (std::size_t device = 1; device < numberOfDevices; ++device)
+  {
+    workSizes[device] =
+      static_cast<std::size_t>(static_cast<double>(totalWorkSize) * throughputs[device] / totalThroughput);
+    assignedWorkSize += workSizes[device];
+  }
+  if (numberOfDevices > 0)
+  {
+    workSizes[0] = totalWorkSize - assignedWorkSize;
+  }
+
+  return workSizes;
+}
+
+
+//------------------------------------------------------------------------------
+double
+OpenCLDeviceLoadBalancer::GetEstimatedThroughput(const std::size_t device) const
+{
+  if (this->m_Throughputs[device] > 0.0)
+  {
+    return this->m_Throughputs[device];
+  }
+
+  double      sum = 0.0;
+  std::size_t numberOfMeasuredDevices = 0;
+  for (const double throughput : this->m_Throughputs)
+  {
+    if (throughput > 0.0)
+    {
+      sum += throughput;
+      ++numberOfMeasuredDevices;
+    }
+  }
+
+  return (numberOfMeasuredDevices > 0) ? sum / numberOfMeasuredDevices : 1.0;
+}
+
+
+} // end namespace itk
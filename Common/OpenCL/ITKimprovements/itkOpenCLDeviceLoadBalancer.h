@@ -0,0 +1,128 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkOpenCLDeviceLoadBalancer_h
+#define itkOpenCLDeviceLoadBalancer_h
+
+#include "itkOpenCLExport.h"
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace itk
+{
+/** \class OpenCLDeviceLoadBalancer
+ * \brief Distributes work over the devices of an OpenCL context, based on
+ * their measured throughput.
+ *
+ * The work is described by a size, for example the number of pixels of an
+ * output slab or the number of samples of a metric. SelectDevice() returns
+ * the device that is expected to finish a new work item first, given the
+ * work that is still pending on each device. AddWork() records the work item
+ * as pending, and FinishWork() removes the oldest pending work item of a
+ * device and updates its throughput. Work items of a device are assumed to
+ * finish in order, as they do on an in-order command queue. The throughput of
+ * a device that has not been measured yet is estimated by the average of the
+ * measured devices, so the work is initially spread evenly.
+ *
+ * \code
+ * OpenCLDeviceLoadBalancer balancer;
+ * balancer.SetNumberOfDevices( queues.size() );
+ * const std::size_t device = balancer.SelectDevice( workSize );
+ * balancer.AddWork( device, workSize );
+ * // enqueue the work on queues[ device ], and when it has finished:
+ * balancer.FinishWork( device );
+ * \endcode
+ *
+ * SplitWork() divides a fixed amount of work over all devices at once.
+ *
+ * \ingroup OpenCL
+ * \sa OpenCLContext::GetDeviceCommandQueues()
+ */
+class ITKOpenCL_EXPORT OpenCLDeviceLoadBalancer
+{
+public:
+  /** Constructor, for a single device. */
+  OpenCLDeviceLoadBalancer();
+
+  /** Sets the number of devices. The pending work is discarded. The measured
+   * throughputs are kept when the number of devices does not change. */
+  void
+  SetNumberOfDevices(const std::size_t numberOfDevices);
+
+  /** Returns the number of devices. */
+  std::size_t
+  GetNumberOfDevices() const
+  {
+    return this->m_Throughputs.size();
+  }
+
+  /** Returns the device that is expected to finish a work item of
+   * \a workSize first. */
+  std::size_t
+  SelectDevice(const double workSize) const;
+
+  /** Records a work item of \a workSize as pending on \a device. */
+  void
+  AddWork(const std::size_t device, const double workSize);
+
+  /** Records that the oldest pending work item of \a device has finished,
+   * and updates the throughput of \a device. */
+  void
+  FinishWork(const std::size_t device);
+
+  /** Returns the number of work items that are pending on \a device. */
+  std::size_t
+  GetNumberOfPendingWorkItems(const std::size_t device) const
+  {
+    return this->m_PendingWork[device].size();
+  }
+
+  /** Returns the throughput of \a device, in work per second.
+   * Returns zero when it has not been measured yet. */
+  double
+  GetThroughput(const std::size_t device) const
+  {
+    return this->m_Throughputs[device];
+  }
+
+  /** Divides \a totalWorkSize over the devices, proportional to their throughput. */
+  std::vector<std::size_t>
+  SplitWork(const std::size_t totalWorkSize) const;
+
+private:
+  typedef std::chrono::steady_clock ClockType;
+
+  /** Returns the measured or estimated throughput of \a device. */
+  double
+  GetEstimatedThroughput(const std::size_t device) const;
+
+  struct WorkItem
+  {
+    double                m_Size;
+    ClockType::time_point m_StartTime;
+  };
+
+  std::vector<double>                m_Throughputs;
+  std::vector<std::deque<WorkItem>>  m_PendingWork;
+  std::vector<ClockType::time_point> m_LastFinishTimes;
+};
+
+} // end namespace itk
+
+#endif // itkOpenCLDeviceLoadBalancer_h
@@ -1395,7 +1395,12 @@ OpenCLKernel::LaunchKernel()
     const std::string profileStr = "clEnqueueNDRangeKernel: " + this->GetName();
     d->context->OpenCLProfile(event, profileStr);
 #endif
-    return OpenCLEvent(event);
+    const OpenCLEvent launchEvent(event);
+    if (d->context->GetProfilingEnabled())
+    {
+      d->context->AddKernelProfilingEvent(this->GetName(), launchEvent);
+    }
+    return launchEvent;
   }
 }
 
@@ -1488,7 +1493,12 @@ OpenCLKernel::LaunchKernel(const OpenCLEventList & event_list)
     const std::string profileStr = "clEnqueueNDRangeKernel: " + this->GetName();
     d->context->OpenCLProfile(event, profileStr);
 #endif
-    return OpenCLEvent(event);
+    const OpenCLEvent launchEvent(event);
+    if (d->context->GetProfilingEnabled())
+    {
+      d->context->AddKernelProfilingEvent(this->GetName(), launchEvent);
+    }
+    return launchEvent;
   }
 }
 
@@ -1550,7 +1560,12 @@ OpenCLKernel::LaunchTaskAsync(const OpenCLEventList & event_list)
   this->GetContext()->ReportError(error, __FILE__, __LINE__, ITK_LOCATION);
   if (error == CL_SUCCESS)
   {
-    return OpenCLEvent(event);
+    const OpenCLEvent launchEvent(event);
+    if (d->context->GetProfilingEnabled())
+    {
+      d->context->AddKernelProfilingEvent(this->GetName(), launchEvent);
+    }
+    return launchEvent;
   }
   else
   {
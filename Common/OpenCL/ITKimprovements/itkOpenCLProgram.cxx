@@ -20,6 +20,14 @@
 #include "itkOpenCLProfilingTimeProbe.h"
 #include "itkOpenCLMacro.h"
 
+#include "itksys/MD5.h"
+#include "itksys/SystemTools.hxx"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
 // begin of OpenCLProgramSupport namespace
 namespace OpenCLProgramSupport
 {
@@ -175,6 +183,132 @@ GetOpenCLMathAndOptimizationOptions(std::string & options)
 }
 
 
+//------------------------------------------------------------------------------
+// The tag at the start of every program cache file
+const std::string ProgramCacheFileTag("itkOpenCLProgramCache1");
+
+//------------------------------------------------------------------------------
+// Returns the key of a program binary in the program cache. It contains
+// everything the binary depends on, so that a change of the device, the driver,
+// the build options or the source results in a new binary.
+std::string
+GetProgramCacheKey(const itk::OpenCLDevice & device, const std::string & options, const std::string & source)
+{
+  std::ostringstream key;
+
+  key << "device: " << device.GetName() << '\n'
+      << "vendor: " << device.GetVendor() << '\n'
+      << "version: " << device.GetVersion() << '\n'
+      << "driver: " << device.GetDriverVersion() << '\n'
+      << "options: " << options << '\n'
+      << "source: " << source;
+  return key.str();
+}
+
+
+//------------------------------------------------------------------------------
+// Returns the name of the program cache file of \a key in \a directory
+std::string
+GetProgramCacheFileName(const std::string & directory, const std::string & key)
+{
+  itksysMD5 * md5 = itksysMD5_New();
+
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, (unsigned char *)key.c_str(), key.size());
+  const std::size_t DigestSize = 32u;
+  char              Digest[DigestSize];
+  itksysMD5_FinalizeHex(md5, Digest);
+  const std::string hex(Digest, DigestSize);
+  itksysMD5_Delete(md5);
+
+  return directory + "/ocl-" + hex + ".bin";
+}
+
+
+//------------------------------------------------------------------------------
+// Reads the binary that is stored with \a key from \a fileName. Returns false
+// when the file does not exist, or when it was stored with a different key.
+bool
+ReadProgramCacheFile(const std::string & fileName, const std::string & key, std::vector<unsigned char> & binary)
+{
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+
+  if (!file.is_open())
+  {
+    return false;
+  }
+
+  std::string   tag(ProgramCacheFileTag.size(), '\0');
+  std::uint64_t keySize = 0;
+  file.read(&tag[0], tag.size());
+  file.read(reinterpret_cast<char *>(&keySize), sizeof(keySize));
+  if (!file || tag != ProgramCacheFileTag || keySize != key.size())
+  {
+    return false;
+  }
+
+  std::string storedKey(key.size(), '\0');
+  file.read(&storedKey[0], storedKey.size());
+  if (!file || storedKey != key)
+  {
+    return false;
+  }
+
+  std::uint64_t binarySize = 0;
+  file.read(reinterpret_cast<char *>(&binarySize), sizeof(binarySize));
+  if (!file || binarySize == 0)
+  {
+    return false;
+  }
+
+  binary.resize(binarySize);
+  file.read(reinterpret_cast<char *>(&binary[0]), binary.size());
+  return static_cast<bool>(file);
+}
+
+
+//------------------------------------------------------------------------------
+// Stores \a binary with \a key in \a fileName. The file is written under a
+// temporary name first, so that concurrent processes never read a partially
+// written file.
+bool
+WriteProgramCacheFile(const std::string & fileName, const std::string & key, const std::vector<unsigned char> & binary)
+{
+  std::ostringstream temporaryName;
+
+  temporaryName << fileName << '.' << std::chrono::steady_clock::now().time_since_epoch().count() << ".tmp";
+
+  {
+    std::ofstream file(temporaryName.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+      return false;
+    }
+
+    const std::uint64_t keySize = key.size();
+    const std::uint64_t binarySize = binary.size();
+    file.write(ProgramCacheFileTag.c_str(), ProgramCacheFileTag.size());
+    file.write(reinterpret_cast<const char *>(&keySize), sizeof(keySize));
+    file.write(key.c_str(), key.size());
+    file.write(reinterpret_cast<const char *>(&binarySize), sizeof(binarySize));
+    file.write(reinterpret_cast<const char *>(&binary[0]), binary.size());
+    if (!file)
+    {
+      file.close();
+      itksys::SystemTools::RemoveFile(temporaryName.str());
+      return false;
+    }
+  }
+
+  if (!itksys::SystemTools::RenameFile(temporaryName.str(), fileName))
+  {
+    itksys::SystemTools::RemoveFile(temporaryName.str());
+    return false;
+  }
+  return true;
+}
+
+
 } // namespace OpenCLProgramSupport
 
 namespace itk
@@ -277,6 +411,31 @@ OpenCLProgram::Build(const std::list<OpenCLDevice> & devices, const std::string
   itk::OpenCLProfilingTimeProbe timer("Building OpenCL program using clBuildProgram");
 #endif
 
+  // Look up the program in the program cache of the context. The cache is
+  // used when a program that was created from source is built for one device.
+  OpenCLDevice cacheDevice;
+  std::string  cacheKey;
+  std::string  cacheFileName;
+
+#if !(defined(OPENCL_USE_INTEL_CPU) && defined(_DEBUG))
+  const std::string cacheDirectory = this->GetContext()->GetProgramCacheDirectory();
+  if (!cacheDirectory.empty())
+  {
+    const std::list<OpenCLDevice> buildDevices = devs.empty() ? this->GetDevices() : devices;
+    const std::string             source = this->GetSource();
+    if (buildDevices.size() == 1 && !source.empty())
+    {
+      cacheDevice = buildDevices.front();
+      cacheKey = OpenCLProgramSupport::GetProgramCacheKey(cacheDevice, oclOptions, source);
+      cacheFileName = OpenCLProgramSupport::GetProgramCacheFileName(cacheDirectory, cacheKey);
+      if (this->BuildFromProgramCache(cacheDevice, oclOptions, cacheKey, cacheFileName))
+      {
+        return true;
+      }
+    }
+  }
+#endif
+
   cl_int error;
 
 #if defined(OPENCL_USE_INTEL_CPU) && defined(_DEBUG)
@@ -310,6 +469,10 @@ OpenCLProgram::Build(const std::list<OpenCLDevice> & devices, const std::string
 
   if (error == CL_SUCCESS)
   {
+    if (!cacheFileName.empty())
+    {
+      this->AddToProgramCache(cacheDevice, cacheKey, cacheFileName);
+    }
     return true;
   }
 
@@ -389,6 +552,138 @@ OpenCLProgram::GetDevices() const
 }
 
 
+//------------------------------------------------------------------------------
+std::vector<std::vector<unsigned char>>
+OpenCLProgram::GetBinaries() const
+{
+  std::vector<std::vector<unsigned char>> binaries;
+  cl_uint                                 numDevices = 0;
+
+  if (clGetProgramInfo(this->m_Id, CL_PROGRAM_NUM_DEVICES, sizeof(numDevices), &numDevices, 0) != CL_SUCCESS ||
+      numDevices == 0)
+  {
+    return binaries;
+  }
+  std::vector<std::size_t> sizes(numDevices);
+  if (clGetProgramInfo(this->m_Id, CL_PROGRAM_BINARY_SIZES, numDevices * sizeof(std::size_t), &sizes[0], 0) !=
+      CL_SUCCESS)
+  {
+    return binaries;
+  }
+
+  binaries.resize(numDevices);
+  std::vector<unsigned char *> pointers(numDevices, 0);
+  for (cl_uint i = 0; i < numDevices; ++i)
+  {
+    binaries[i].resize(sizes[i]);
+    pointers[i] = sizes[i] != 0 ? &binaries[i][0] : 0;
+  }
+  if (clGetProgramInfo(this->m_Id, CL_PROGRAM_BINARIES, numDevices * sizeof(unsigned char *), &pointers[0], 0) !=
+      CL_SUCCESS)
+  {
+    return std::vector<std::vector<unsigned char>>();
+  }
+  return binaries;
+}
+
+
+//------------------------------------------------------------------------------
+std::string
+OpenCLProgram::GetSource() const
+{
+  std::size_t size = 0;
+
+  if (clGetProgramInfo(this->m_Id, CL_PROGRAM_SOURCE, 0, 0, &size) != CL_SUCCESS || size <= 1)
+  {
+    return std::string();
+  }
+  std::string source(size, '\0');
+  if (clGetProgramInfo(this->m_Id, CL_PROGRAM_SOURCE, size, &source[0], 0) != CL_SUCCESS)
+  {
+    return std::string();
+  }
+  // Remove the terminating null character
+  source.resize(size - 1);
+  return source;
+}
+
+
+//------------------------------------------------------------------------------
+bool
+OpenCLProgram::BuildFromProgramCache(const OpenCLDevice & device,
+                                     const std::string &  options,
+                                     const std::string &  cacheKey,
+                                     const std::string &  cacheFileName)
+{
+  std::vector<unsigned char> binary;
+
+  if (!OpenCLProgramSupport::ReadProgramCacheFile(cacheFileName, cacheKey, binary))
+  {
+    return false;
+  }
+
+  cl_device_id          deviceId = device.GetDeviceId();
+  const unsigned char * binaryData = &binary[0];
+  const std::size_t     binarySize = binary.size();
+  cl_int                binaryStatus = CL_SUCCESS;
+  cl_int                error = CL_SUCCESS;
+  cl_program            program = clCreateProgramWithBinary(
+    this->GetContext()->GetContextId(), 1, &deviceId, &binarySize, &binaryData, &binaryStatus, &error);
+
+  if (error != CL_SUCCESS || binaryStatus != CL_SUCCESS)
+  {
+    if (program)
+    {
+      clReleaseProgram(program);
+    }
+    return false;
+  }
+
+  // A binary that the driver does not accept anymore is rebuilt from source
+  error = clBuildProgram(program, 1, &deviceId, options.empty() ? 0 : options.c_str(), 0, 0);
+  if (error != CL_SUCCESS)
+  {
+    clReleaseProgram(program);
+    return false;
+  }
+
+  // Replace the program that was created from source by the cached one
+  clReleaseProgram(this->m_Id);
+  this->m_Id = program;
+  this->GetContext()->SetLastError(error);
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+void
+OpenCLProgram::AddToProgramCache(const OpenCLDevice & device,
+                                 const std::string &  cacheKey,
+                                 const std::string &  cacheFileName) const
+{
+  const std::list<OpenCLDevice>                 programDevices = this->GetDevices();
+  const std::vector<std::vector<unsigned char>> binaries = this->GetBinaries();
+
+  std::size_t index = 0;
+  for (std::list<OpenCLDevice>::const_iterator dev = programDevices.begin(); dev != programDevices.end();
+       ++dev, ++index)
+  {
+    if ((*dev).GetDeviceId() != device.GetDeviceId() || index >= binaries.size() || binaries[index].empty())
+    {
+      continue;
+    }
+
+    const std::string directory = this->GetContext()->GetProgramCacheDirectory();
+    if (!itksys::SystemTools::MakeDirectory(directory) ||
+        !OpenCLProgramSupport::WriteProgramCacheFile(cacheFileName, cacheKey, binaries[index]))
+    {
+      itkOpenCLWarningMacroGeneric(<< "OpenCLProgram::AddToProgramCache: could not write '" << cacheFileName << "'");
+    }
+    return;
+  }
+}
+
+
 //------------------------------------------------------------------------------
 OpenCLKernel
 OpenCLProgram::CreateKernel(const std::string & name) const
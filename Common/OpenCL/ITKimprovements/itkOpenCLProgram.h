@@ -22,6 +22,7 @@
 #include "itkOpenCLKernel.h"
 
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -104,8 +105,12 @@ public:
    * If \a devices is not empty, the program will only be built for devices
    * in the specified list. Otherwise the program will be built for all
    * devices on the program's context.
+   * When the context has a program cache directory and the program is
+   * built for a single device, a previously cached binary of the same
+   * source, options, device and driver is used instead, and a newly built
+   * binary is added to the cache.
    * Returns true if the program was built; false otherwise.
-   * \sa GetLog(), CreateKernel() */
+   * \sa GetLog(), CreateKernel(), OpenCLContext::SetProgramCacheDirectory() */
   bool
   Build(const std::list<OpenCLDevice> & devices, const std::string & extraBuildOptions = std::string());
 
@@ -119,6 +124,13 @@ public:
   std::list<OpenCLDevice>
   GetDevices() const;
 
+  /** Returns the binaries for the devices of this program, in the same
+   * order as GetDevices(). The binary of a device that has not been built
+   * is empty.
+   * \sa GetDevices(), Build() */
+  std::vector<std::vector<unsigned char>>
+  GetBinaries() const;
+
   /** Creates a kernel for the entry point associated with \a name
    * in this program.
    * \sa Build() */
@@ -130,6 +142,25 @@ public:
   CreateKernels() const;
 
 private:
+  /** Builds this program for \a device from the binary that is stored with
+   * \a cacheKey in \a cacheFileName, when available. Returns true on success;
+   * false when the program has to be built from source. */
+  bool
+  BuildFromProgramCache(const OpenCLDevice & device,
+                        const std::string &  options,
+                        const std::string &  cacheKey,
+                        const std::string &  cacheFileName);
+
+  /** Stores the binary of this program for \a device with \a cacheKey in
+   * \a cacheFileName. */
+  void
+  AddToProgramCache(const OpenCLDevice & device, const std::string & cacheKey, const std::string & cacheFileName) const;
+
+  /** Returns the source code of this program, or an empty string when the
+   * program was not created from source. */
+  std::string
+  GetSource() const;
+
   OpenCLContext * m_Context;
   cl_program      m_Id;
   std::string     m_FileName;
@@ -0,0 +1,601 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the value and low memory derivative of
+// itk::ParzenWindowMutualInformationImageToImageMetric, for 3D images, a
+// linearly interpolated moving image, a zero order fixed Parzen window, a
+// third order moving Parzen window, and an affine or B-spline transform.
+// The computation takes three passes: the joint histogram is accumulated
+// per work group in local memory, a single work item computes the value and
+// the ratios of the joint PDF and the moving marginal PDF, and, finally, the
+// derivative is computed per sample.
+//
+// This source should be preceded by GPUAdvancedMeanSquaresImageToImageMetric.cl,
+// which provides the atomic float add, the reduction and the linear interpolation.
+//
+// The histogram parameters are passed as a float4: the fixed bin size, the
+// fixed normalized minimum, the moving bin size and the moving normalized
+// minimum. The moving image limiter is passed as a float8: the upper threshold,
+// the upper bound, the lower threshold, the lower bound, and the
+// UTminUB, UTminUBinv, LTminLB and LTminLBinv of itk::ExponentialLimiterFunction.
+
+//------------------------------------------------------------------------------
+// Adds value to the float at address in local memory, see atomic_add_global_float().
+void atomic_add_local_float( volatile __local float * address, const float value )
+{
+  union
+  {
+    uint  u;
+    float f;
+  } old_value, new_value;
+
+  do
+  {
+    old_value.f = *address;
+    new_value.f = old_value.f + value;
+  }
+  while( atomic_cmpxchg( (volatile __local uint *)address, old_value.u, new_value.u ) != old_value.u );
+}
+
+//------------------------------------------------------------------------------
+// OpenCL implementation of itk::ExponentialLimiterFunction::Evaluate(),
+// which multiplies the derivative by the derivative of the limiter.
+float limit_moving_value( const float value, const float8 limiter, float3 * derivative )
+{
+  const float diff_upper = value - limiter.s0;
+  if( diff_upper > 1e-10f )
+  {
+    const float temp = limiter.s4 * exp( limiter.s5 * diff_upper );
+    *derivative *= limiter.s5 * temp;
+    return temp + limiter.s1;
+  }
+
+  const float diff_lower = value - limiter.s2;
+  if( diff_lower < -1e-10f )
+  {
+    const float temp = limiter.s6 * exp( limiter.s7 * diff_lower );
+    *derivative *= limiter.s7 * temp;
+    return temp + limiter.s3;
+  }
+
+  return value;
+}
+
+//------------------------------------------------------------------------------
+// The fixed Parzen window of order zero: returns the only affected fixed bin,
+// and its weight, see itk::BSplineKernelFunction2< 0 >::Evaluate().
+// The bin is clamped to the histogram, to be robust against rounding errors.
+uint fixed_parzen_window( const float fixed_value, const float4 histogram_parameters,
+  const uint number_of_fixed_bins, float * weight )
+{
+  const float term = fixed_value / histogram_parameters.s0 - histogram_parameters.s1;
+  const float index = floor( term + 0.5f );
+  const float u = fabs( index - term );
+  *weight = u < 0.5f ? 1.0f : ( u == 0.5f ? 0.5f : 0.0f );
+  return (uint)clamp( index, 0.0f, (float)( number_of_fixed_bins - 1 ) );
+}
+
+//------------------------------------------------------------------------------
+// The moving Parzen window of order three: returns the lowest affected moving
+// bin, and the four Parzen values, see itk::BSplineKernelFunction2< 3 >::Evaluate().
+// The bin is clamped to the histogram, to be robust against rounding errors.
+uint moving_parzen_window( const float moving_value, const float4 histogram_parameters,
+  const uint number_of_moving_bins, float * values )
+{
+  const float term = moving_value / histogram_parameters.s2 - histogram_parameters.s3;
+  const float index = floor( term - 1.0f );
+  const float a = term - index;
+  const float s = a * a;
+  const float c = s * a;
+
+  values[ 0 ] = ( 8.0f - 12.0f * a + 6.0f * s - c ) / 6.0f;
+  values[ 1 ] = ( -5.0f + 21.0f * a - 15.0f * s + 3.0f * c ) / 6.0f;
+  values[ 2 ] = ( 4.0f - 12.0f * a + 12.0f * s - 3.0f * c ) / 6.0f;
+  values[ 3 ] = ( -1.0f + 3.0f * a - 3.0f * s + c ) / 6.0f;
+
+  return (uint)clamp( index, 0.0f, (float)( number_of_moving_bins - 4 ) );
+}
+
+//------------------------------------------------------------------------------
+// The derivatives of the moving Parzen window of order three, see
+// itk::BSplineDerivativeKernelFunction2< 3 >::Evaluate().
+uint moving_parzen_window_derivative( const float moving_value, const float4 histogram_parameters,
+  const uint number_of_moving_bins, float * values )
+{
+  const float term = moving_value / histogram_parameters.s2 - histogram_parameters.s3;
+  const float index = floor( term - 1.0f );
+  const float a = term - index;
+  const float s = a * a;
+
+  values[ 0 ] = 0.5f * s - 2.0f * a + 2.0f;
+  values[ 1 ] = -1.5f * s + 5.0f * a - 3.5f;
+  values[ 2 ] = 1.5f * s - 4.0f * a + 2.0f;
+  values[ 3 ] = -0.5f * s + a - 0.5f;
+
+  return (uint)clamp( index, 0.0f, (float)( number_of_moving_bins - 4 ) );
+}
+
+//------------------------------------------------------------------------------
+#ifdef DIM_3
+// Maps the point with the B-spline transform. The support of the transform
+// at the point is returned in start_index and weights; number_of_weights is
+// zero outside the valid region of the transform, where the displacement and
+// the Jacobian are zero.
+float3 bspline_transform_point_3d(
+  const float3 point,
+  const uint spline_order,
+  __constant GPUImageBase3D * grid_base,
+  __global const float * coefficients,
+  long3 * start_index,
+  float * weights,
+  uint * number_of_weights )
+{
+  const uint3 grid_size = grid_base->size;
+  const uint number_of_coefficients = grid_size.x * grid_size.y * grid_size.z;
+  const uint support_size = spline_order + 1;
+
+  float3 cindex = transform_physical_point_to_continuous_index_3d( point,
+    grid_base->physical_point_to_index, grid_base->origin );
+
+  *number_of_weights = 0;
+  *start_index = (long3)( 0, 0, 0 );
+  float3 mapped_point = point;
+  if( inside_valid_region_3d( &cindex, spline_order, grid_size ) )
+  {
+    *number_of_weights = support_size * support_size * support_size;
+    *start_index = evaluate_3d( cindex, spline_order, support_size, *number_of_weights, weights );
+
+    for( uint k = 0; k < *number_of_weights; ++k )
+    {
+      const uint x = (*start_index).x + ( k % support_size );
+      const uint y = (*start_index).y + ( k / support_size ) % support_size;
+      const uint z = (*start_index).z + ( k / support_size / support_size ) % support_size;
+      const uint gidx = mad24( grid_size.x, mad24( z, grid_size.y, y ), x );
+      const float w = weights[ k ];
+
+      mapped_point.x = mad( coefficients[ gidx ], w, mapped_point.x );
+      mapped_point.y = mad( coefficients[ number_of_coefficients + gidx ], w, mapped_point.y );
+      mapped_point.z = mad( coefficients[ 2 * number_of_coefficients + gidx ], w, mapped_point.z );
+    }
+  }
+
+  return mapped_point;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Accumulates the contribution of one sample to the joint histogram in local
+// memory. The joint histogram is indexed as [fixed bin][moving bin].
+void accumulate_joint_histogram( const float fixed_value,
+  const float moving_value,
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  __local float * local_histogram )
+{
+  float fixed_weight;
+  float moving_values[ 4 ];
+  const uint fixed_index = fixed_parzen_window( fixed_value, histogram_parameters, number_of_bins.x, &fixed_weight );
+  const uint moving_index = moving_parzen_window( moving_value, histogram_parameters, number_of_bins.y, moving_values );
+
+  __local float * row = local_histogram + fixed_index * number_of_bins.y + moving_index;
+  for( uint m = 0; m < 4; ++m )
+  {
+    atomic_add_local_float( &row[ m ], fixed_weight * moving_values[ m ] );
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sets the local joint histogram and the local sample count to zero.
+void clear_local_joint_histogram( const uint number_of_histogram_bins,
+  __local float * local_histogram, __local uint * local_count )
+{
+  for( uint i = get_local_id( 0 ); i < number_of_histogram_bins; i += get_local_size( 0 ) )
+  {
+    local_histogram[ i ] = 0.0f;
+  }
+  if( get_local_id( 0 ) == 0 )
+  {
+    *local_count = 0;
+  }
+  barrier( CLK_LOCAL_MEM_FENCE );
+}
+
+//------------------------------------------------------------------------------
+// Adds the local joint histogram and the local sample count to the global ones.
+void merge_local_joint_histogram( const uint number_of_histogram_bins,
+  __local float * local_histogram, __local uint * local_count,
+  __global float * histogram, __global uint * count )
+{
+  barrier( CLK_LOCAL_MEM_FENCE );
+  for( uint i = get_local_id( 0 ); i < number_of_histogram_bins; i += get_local_size( 0 ) )
+  {
+    if( local_histogram[ i ] != 0.0f )
+    {
+      atomic_add_global_float( &histogram[ i ], local_histogram[ i ] );
+    }
+  }
+  if( get_local_id( 0 ) == 0 )
+  {
+    atomic_add( count, *local_count );
+  }
+}
+
+//------------------------------------------------------------------------------
+// Sets the joint histogram and the sample count to zero.
+__kernel void AdvancedMattesMutualInformationZeroHistogram(
+  __global float * histogram,
+  const uint number_of_histogram_bins,
+  __global uint * count )
+{
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_histogram_bins )
+  {
+    histogram[ global_id ] = 0.0f;
+  }
+  if( global_id == 0 )
+  {
+    *count = 0;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Accumulates the joint histogram for the affine transform T(x) = A x + o.
+#ifdef DIM_3
+__kernel void AdvancedMattesMutualInformationHistogramMatrixOffsetTransform(
+  /* Fixed image samples: the point in xyz and the limited fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* Transform matrix and offset */
+  const float16 matrix, // OpenCL does not have float9
+  const float3 offset,
+  /* Histogram and moving image limiter parameters */
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  const float8 limiter,
+  /* Scratch memory for the joint histogram of the work group and its count */
+  __local float * local_histogram,
+  __local uint * local_count,
+  /* Output: the joint histogram and the number of valid samples */
+  __global float * histogram,
+  __global uint * count )
+{
+  const uint number_of_histogram_bins = number_of_bins.x * number_of_bins.y;
+  clear_local_joint_histogram( number_of_histogram_bins, local_histogram, local_count );
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_samples )
+  {
+    const float4 sample = samples[ global_id ];
+    const float3 mapped_point = matrix_offset_transform_point_3d( sample.xyz, matrix, offset );
+
+    float  moving_value;
+    float3 moving_derivative;
+    if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+      &moving_value, &moving_derivative ) )
+    {
+      atomic_inc( local_count );
+      moving_value = limit_moving_value( moving_value, limiter, &moving_derivative );
+      accumulate_joint_histogram( sample.w, moving_value, histogram_parameters, number_of_bins, local_histogram );
+    }
+  }
+
+  merge_local_joint_histogram( number_of_histogram_bins, local_histogram, local_count, histogram, count );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Accumulates the joint histogram for the B-spline transform.
+#ifdef DIM_3
+__kernel void AdvancedMattesMutualInformationHistogramBSplineTransform(
+  /* Fixed image samples: the point in xyz and the limited fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* B-spline transform order, grid meta information and coefficients */
+  const uint spline_order,
+  __constant GPUImageBase3D * grid_base,
+  __global const float * coefficients,
+  /* Histogram and moving image limiter parameters */
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  const float8 limiter,
+  /* Scratch memory for the joint histogram of the work group and its count */
+  __local float * local_histogram,
+  __local uint * local_count,
+  /* Output: the joint histogram and the number of valid samples */
+  __global float * histogram,
+  __global uint * count )
+{
+  const uint number_of_histogram_bins = number_of_bins.x * number_of_bins.y;
+  clear_local_joint_histogram( number_of_histogram_bins, local_histogram, local_count );
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_samples )
+  {
+    const float4 sample = samples[ global_id ];
+
+    float weights[ 64 ];
+    uint  number_of_weights;
+    long3 start_index;
+    const float3 mapped_point = bspline_transform_point_3d( sample.xyz, spline_order, grid_base, coefficients,
+      &start_index, weights, &number_of_weights );
+
+    float  moving_value;
+    float3 moving_derivative;
+    if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+      &moving_value, &moving_derivative ) )
+    {
+      atomic_inc( local_count );
+      moving_value = limit_moving_value( moving_value, limiter, &moving_derivative );
+      accumulate_joint_histogram( sample.w, moving_value, histogram_parameters, number_of_bins, local_histogram );
+    }
+  }
+
+  merge_local_joint_histogram( number_of_histogram_bins, local_histogram, local_count, histogram, count );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Normalizes the joint histogram by alpha, computes the marginal PDFs, and
+// computes the mutual information and the ratios alpha log( p(f,m) / p(m) ),
+// see ParzenWindowMutualInformationImageToImageMetric::ComputeValueAndPRatioArray().
+// To be launched with a single work item.
+__kernel void AdvancedMattesMutualInformationValueAndPRatio(
+  __global const float * histogram,
+  const uint2 number_of_bins,
+  const float alpha,
+  /* Output: the ratios, indexed as the joint histogram */
+  __global float * pratio,
+  /* Scratch memory for the fixed and moving marginal PDFs */
+  __global float * marginal_pdfs,
+  /* Output: the mutual information */
+  __global float * mutual_information )
+{
+  if( get_global_id( 0 ) != 0 )
+  {
+    return;
+  }
+
+  const uint number_of_fixed_bins = number_of_bins.x;
+  const uint number_of_moving_bins = number_of_bins.y;
+  __global float * fixed_pdf = marginal_pdfs;
+  __global float * moving_pdf = marginal_pdfs + number_of_fixed_bins;
+
+  for( uint m = 0; m < number_of_moving_bins; ++m )
+  {
+    moving_pdf[ m ] = 0.0f;
+  }
+  for( uint f = 0; f < number_of_fixed_bins; ++f )
+  {
+    float sum = 0.0f;
+    for( uint m = 0; m < number_of_moving_bins; ++m )
+    {
+      const float joint_pdf = alpha * histogram[ f * number_of_moving_bins + m ];
+      sum += joint_pdf;
+      moving_pdf[ m ] += joint_pdf;
+    }
+    fixed_pdf[ f ] = sum;
+  }
+
+  float mi = 0.0f;
+  for( uint f = 0; f < number_of_fixed_bins; ++f )
+  {
+    const float fixed_pdf_value = fixed_pdf[ f ];
+    const float log_fixed_pdf_value = fixed_pdf_value > 1e-16f ? log( fixed_pdf_value ) : 0.0f;
+
+    for( uint m = 0; m < number_of_moving_bins; ++m )
+    {
+      const uint  index = f * number_of_moving_bins + m;
+      const float joint_pdf = alpha * histogram[ index ];
+      const float moving_pdf_value = moving_pdf[ m ];
+
+      float ratio = 0.0f;
+      if( joint_pdf > 1e-16f && moving_pdf_value > 1e-16f )
+      {
+        const float log_ratio = log( joint_pdf / moving_pdf_value );
+        ratio = alpha * log_ratio;
+        if( fixed_pdf_value > 1e-16f )
+        {
+          mi += joint_pdf * ( log_ratio - log_fixed_pdf_value );
+        }
+      }
+      pratio[ index ] = ratio;
+    }
+  }
+
+  *mutual_information = mi;
+}
+
+//------------------------------------------------------------------------------
+// Copies the ratios to local memory, where all work items of the group read them.
+void copy_pratio_to_local( const uint number_of_histogram_bins,
+  __global const float * pratio, __local float * local_pratio )
+{
+  for( uint i = get_local_id( 0 ); i < number_of_histogram_bins; i += get_local_size( 0 ) )
+  {
+    local_pratio[ i ] = pratio[ i ];
+  }
+  barrier( CLK_LOCAL_MEM_FENCE );
+}
+
+//------------------------------------------------------------------------------
+// Returns the factor of the moving image derivative of one sample: the sum
+// over the Parzen window of the ratios times the fixed Parzen value times the
+// moving Parzen derivatives, divided by the moving bin size, see
+// ParzenWindowMutualInformationImageToImageMetric::UpdateDerivativeLowMemoryWithFixedParzenValues().
+float derivative_factor( const float fixed_value,
+  const float moving_value,
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  __local const float * local_pratio )
+{
+  float fixed_weight;
+  float moving_derivatives[ 4 ];
+  const uint fixed_index = fixed_parzen_window( fixed_value, histogram_parameters, number_of_bins.x, &fixed_weight );
+  const uint moving_index = moving_parzen_window_derivative( moving_value, histogram_parameters,
+    number_of_bins.y, moving_derivatives );
+
+  __local const float * row = local_pratio + fixed_index * number_of_bins.y + moving_index;
+  float sum = 0.0f;
+  for( uint m = 0; m < 4; ++m )
+  {
+    sum += row[ m ] * moving_derivatives[ m ];
+  }
+  return sum * fixed_weight / histogram_parameters.s2;
+}
+
+//------------------------------------------------------------------------------
+// Computes the derivative for the affine transform T(x) = A ( x - c ) + t + c.
+// The 12 terms of each sample are the derivatives with respect to the nine
+// matrix elements (row by row) and the three translations. They are summed
+// per work group into group_sums.
+#ifdef DIM_3
+__kernel void AdvancedMattesMutualInformationDerivativeMatrixOffsetTransform(
+  /* Fixed image samples: the point in xyz and the limited fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* Transform matrix, offset and center of rotation */
+  const float16 matrix,
+  const float3 offset,
+  const float3 center,
+  /* Histogram and moving image limiter parameters */
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  const float8 limiter,
+  /* The ratios, and scratch memory for them */
+  __global const float * pratio,
+  __local float * local_pratio,
+  /* Scratch memory for the reduction, one float per work item */
+  __local float * local_sums,
+  /* Output: the 12 sums of each work group */
+  __global float * group_sums )
+{
+  copy_pratio_to_local( number_of_bins.x * number_of_bins.y, pratio, local_pratio );
+
+  float terms[ 12 ];
+  for( uint t = 0; t < 12; ++t )
+  {
+    terms[ t ] = 0.0f;
+  }
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_samples )
+  {
+    const float4 sample = samples[ global_id ];
+    const float3 fixed_point = sample.xyz;
+    const float3 mapped_point = matrix_offset_transform_point_3d( fixed_point, matrix, offset );
+
+    float  moving_value;
+    float3 moving_derivative;
+    if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+      &moving_value, &moving_derivative ) )
+    {
+      moving_value = limit_moving_value( moving_value, limiter, &moving_derivative );
+      const float3 g = moving_derivative
+        * derivative_factor( sample.w, moving_value, histogram_parameters, number_of_bins, local_pratio );
+      const float3 v = fixed_point - center;
+
+      // dT_i / dA_ij = v_j and dT_i / dt_i = 1
+      terms[ 0 ] = g.x * v.x; terms[ 1 ] = g.x * v.y; terms[ 2 ] = g.x * v.z;
+      terms[ 3 ] = g.y * v.x; terms[ 4 ] = g.y * v.y; terms[ 5 ] = g.y * v.z;
+      terms[ 6 ] = g.z * v.x; terms[ 7 ] = g.z * v.y; terms[ 8 ] = g.z * v.z;
+      terms[ 9 ] = g.x; terms[ 10 ] = g.y; terms[ 11 ] = g.z;
+    }
+  }
+
+  reduce_terms_in_work_group( terms, 12, local_sums, group_sums );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Computes the derivative for the B-spline transform. The derivative has the
+// layout of the transform parameters, and is accumulated directly on the device.
+#ifdef DIM_3
+__kernel void AdvancedMattesMutualInformationDerivativeBSplineTransform(
+  /* Fixed image samples: the point in xyz and the limited fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* B-spline transform order, grid meta information and coefficients */
+  const uint spline_order,
+  __constant GPUImageBase3D * grid_base,
+  __global const float * coefficients,
+  /* Histogram and moving image limiter parameters */
+  const float4 histogram_parameters,
+  const uint2 number_of_bins,
+  const float8 limiter,
+  /* The ratios, and scratch memory for them */
+  __global const float * pratio,
+  __local float * local_pratio,
+  /* Output: the derivative, set to zero beforehand */
+  __global float * derivative )
+{
+  copy_pratio_to_local( number_of_bins.x * number_of_bins.y, pratio, local_pratio );
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id >= number_of_samples )
+  {
+    return;
+  }
+
+  const float4 sample = samples[ global_id ];
+
+  float weights[ 64 ];
+  uint  number_of_weights;
+  long3 start_index;
+  const float3 mapped_point = bspline_transform_point_3d( sample.xyz, spline_order, grid_base, coefficients,
+    &start_index, weights, &number_of_weights );
+
+  float  moving_value;
+  float3 moving_derivative;
+  if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+    &moving_value, &moving_derivative ) )
+  {
+    moving_value = limit_moving_value( moving_value, limiter, &moving_derivative );
+    const float3 g = moving_derivative
+      * derivative_factor( sample.w, moving_value, histogram_parameters, number_of_bins, local_pratio );
+
+    // The Jacobian of the coefficient with weight w is w times the identity
+    const uint3 grid_size = grid_base->size;
+    const uint number_of_coefficients = grid_size.x * grid_size.y * grid_size.z;
+    const uint support_size = spline_order + 1;
+    for( uint k = 0; k < number_of_weights; ++k )
+    {
+      const uint x = start_index.x + ( k % support_size );
+      const uint y = start_index.y + ( k / support_size ) % support_size;
+      const uint z = start_index.z + ( k / support_size / support_size ) % support_size;
+      const uint gidx = mad24( grid_size.x, mad24( z, grid_size.y, y ), x );
+      const float w = weights[ k ];
+
+      atomic_add_global_float( &derivative[ gidx ], g.x * w );
+      atomic_add_global_float( &derivative[ number_of_coefficients + gidx ], g.y * w );
+      atomic_add_global_float( &derivative[ 2 * number_of_coefficients + gidx ], g.z * w );
+    }
+  }
+}
+#endif // DIM_3
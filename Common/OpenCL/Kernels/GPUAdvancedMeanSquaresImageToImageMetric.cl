@@ -0,0 +1,324 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the value and derivative of
+// itk::AdvancedMeanSquaresImageToImageMetric, for 3D images, a linearly
+// interpolated moving image, and an affine or B-spline transform.
+// Every work item processes one sample. The sums of the work items are
+// reduced in local memory, so that only one partial sum per work group
+// is copied back to the host.
+
+//------------------------------------------------------------------------------
+// Adds value to the float at address, using a compare-and-exchange loop,
+// since OpenCL 1.x has no atomic add for floats.
+void atomic_add_global_float( volatile __global float * address, const float value )
+{
+  union
+  {
+    uint  u;
+    float f;
+  } old_value, new_value;
+
+  do
+  {
+    old_value.f = *address;
+    new_value.f = old_value.f + value;
+  }
+  while( atomic_cmpxchg( (volatile __global uint *)address, old_value.u, new_value.u ) != old_value.u );
+}
+
+//------------------------------------------------------------------------------
+// Sums each of the number_of_terms terms over the work items of a work group,
+// and writes the sums to group_sums. The local work size must be a power of two.
+void reduce_terms_in_work_group( const float * terms,
+  const uint number_of_terms,
+  __local float * local_sums,
+  __global float * group_sums )
+{
+  const uint local_id = get_local_id( 0 );
+  const uint local_size = get_local_size( 0 );
+  const uint group_offset = get_group_id( 0 ) * number_of_terms;
+
+  for( uint t = 0; t < number_of_terms; ++t )
+  {
+    local_sums[ local_id ] = terms[ t ];
+    barrier( CLK_LOCAL_MEM_FENCE );
+
+    for( uint stride = local_size / 2; stride > 0; stride /= 2 )
+    {
+      if( local_id < stride )
+      {
+        local_sums[ local_id ] += local_sums[ local_id + stride ];
+      }
+      barrier( CLK_LOCAL_MEM_FENCE );
+    }
+
+    if( local_id == 0 )
+    {
+      group_sums[ group_offset + t ] = local_sums[ 0 ];
+    }
+    barrier( CLK_LOCAL_MEM_FENCE );
+  }
+}
+
+//------------------------------------------------------------------------------
+#ifdef DIM_3
+// OpenCL implementation of
+// itk::AdvancedLinearInterpolateImageFunction::EvaluateValueAndDerivativeAtContinuousIndex(),
+// preceded by the itk::ImageFunction::IsInsideBuffer() check. The derivative
+// is returned in physical space. The image should have at least two voxels
+// in each dimension.
+bool linear_evaluate_value_and_derivative_3d(
+  const float3 point,
+  __global const INPIXELTYPE * in,
+  __constant GPUImageBase3D * image,
+  float * value,
+  float3 * derivative )
+{
+  const float3 cindex = transform_physical_point_to_continuous_index_3d( point,
+    image->physical_point_to_index, image->origin );
+
+  // Check if the point is inside the buffer
+  const float3 end_index = convert_float3( image->size ) - 1.0f;
+  if( cindex.x < -0.5f || cindex.y < -0.5f || cindex.z < -0.5f
+    || cindex.x >= end_index.x + 0.5f || cindex.y >= end_index.y + 0.5f || cindex.z >= end_index.z + 0.5f )
+  {
+    return false;
+  }
+
+  // Mirror the continuous index at the image border
+  float3 xm = cindex;
+  float3 deriv_sign = 1.0f / image->spacing;
+  if( cindex.x < 0.0f ) { xm.x = -cindex.x; deriv_sign.x = -deriv_sign.x; }
+  if( cindex.y < 0.0f ) { xm.y = -cindex.y; deriv_sign.y = -deriv_sign.y; }
+  if( cindex.z < 0.0f ) { xm.z = -cindex.z; deriv_sign.z = -deriv_sign.z; }
+  if( cindex.x > end_index.x ) { xm.x = 2.0f * end_index.x - cindex.x; deriv_sign.x = -deriv_sign.x; }
+  if( cindex.y > end_index.y ) { xm.y = 2.0f * end_index.y - cindex.y; deriv_sign.y = -deriv_sign.y; }
+  if( cindex.z > end_index.z ) { xm.z = 2.0f * end_index.z - cindex.z; deriv_sign.z = -deriv_sign.z; }
+
+  // Compute the base index, such that its upper neighbour is still inside
+  // the image, and the distance from the point to the base index
+  const float3 base = clamp( floor( xm ), (float3)( 0.0f ), end_index - 1.0f );
+  const float3 dist = xm - base;
+  const float3 dinv = 1.0f - dist;
+
+  // Get the 8 corner values
+  const long3 i000 = convert_long3( base );
+  const float val000 = get_pixel_3d( i000, in, image->size );
+  const float val100 = get_pixel_3d( i000 + (long3)( 1, 0, 0 ), in, image->size );
+  const float val010 = get_pixel_3d( i000 + (long3)( 0, 1, 0 ), in, image->size );
+  const float val110 = get_pixel_3d( i000 + (long3)( 1, 1, 0 ), in, image->size );
+  const float val001 = get_pixel_3d( i000 + (long3)( 0, 0, 1 ), in, image->size );
+  const float val101 = get_pixel_3d( i000 + (long3)( 1, 0, 1 ), in, image->size );
+  const float val011 = get_pixel_3d( i000 + (long3)( 0, 1, 1 ), in, image->size );
+  const float val111 = get_pixel_3d( i000 + (long3)( 1, 1, 1 ), in, image->size );
+
+  // Interpolate to get the value
+  *value = val000 * dinv.x * dinv.y * dinv.z + val100 * dist.x * dinv.y * dinv.z
+    + val010 * dinv.x * dist.y * dinv.z + val001 * dinv.x * dinv.y * dist.z
+    + val110 * dist.x * dist.y * dinv.z + val011 * dinv.x * dist.y * dist.z
+    + val101 * dist.x * dinv.y * dist.z + val111 * dist.x * dist.y * dist.z;
+
+  // Interpolate to get the derivative with respect to the index
+  float3 local_derivative;
+  local_derivative.x = deriv_sign.x * ( dinv.y * dinv.z * ( val100 - val000 ) + dist.y * dinv.z * ( val110 - val010 )
+    + dinv.y * dist.z * ( val101 - val001 ) + dist.y * dist.z * ( val111 - val011 ) );
+  local_derivative.y = deriv_sign.y * ( dinv.x * dinv.z * ( val010 - val000 ) + dist.x * dinv.z * ( val110 - val100 )
+    + dinv.x * dist.z * ( val011 - val001 ) + dist.x * dist.z * ( val111 - val101 ) );
+  local_derivative.z = deriv_sign.z * ( dinv.x * dinv.y * ( val001 - val000 ) + dist.x * dinv.y * ( val101 - val100 )
+    + dinv.x * dist.y * ( val011 - val010 ) + dist.x * dist.y * ( val111 - val110 ) );
+
+  // Take the direction cosines into account
+  (*derivative).x = dot( image->direction.s012, local_derivative );
+  (*derivative).y = dot( image->direction.s345, local_derivative );
+  (*derivative).z = dot( image->direction.s678, local_derivative );
+
+  return true;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Sets the derivative buffer to zero, before the B-spline kernel accumulates into it.
+#ifdef DIM_3
+__kernel void AdvancedMeanSquaresZeroDerivative(
+  __global float * derivative,
+  const uint number_of_parameters )
+{
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_parameters )
+  {
+    derivative[ global_id ] = 0.0f;
+  }
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Computes the value and derivative for the affine transform
+// T(x) = A ( x - c ) + t + c. The 14 terms of each sample are: the squared
+// difference, the sample count, and the derivatives with respect to the
+// nine matrix elements (row by row) and the three translations. They are
+// summed per work group into group_sums.
+#ifdef DIM_3
+__kernel void AdvancedMeanSquaresMatrixOffsetTransform(
+  /* Fixed image samples: the point in xyz and the fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* Transform matrix, offset and center of rotation */
+  const float16 matrix, // OpenCL does not have float9
+  const float3 offset,
+  const float3 center,
+  /* Scratch memory for the reduction, one float per work item */
+  __local float * local_sums,
+  /* Output: the 14 sums of each work group */
+  __global float * group_sums )
+{
+  float terms[ 14 ];
+  for( uint t = 0; t < 14; ++t )
+  {
+    terms[ t ] = 0.0f;
+  }
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_samples )
+  {
+    const float4 sample = samples[ global_id ];
+    const float3 fixed_point = sample.xyz;
+    const float3 mapped_point = matrix_offset_transform_point_3d( fixed_point, matrix, offset );
+
+    float  moving_value;
+    float3 moving_derivative;
+    if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+      &moving_value, &moving_derivative ) )
+    {
+      const float diff = moving_value - sample.w;
+      const float3 g = 2.0f * diff * moving_derivative;
+      const float3 v = fixed_point - center;
+
+      terms[ 0 ] = diff * diff;
+      terms[ 1 ] = 1.0f;
+
+      // dT_i / dA_ij = v_j and dT_i / dt_i = 1
+      terms[ 2 ] = g.x * v.x; terms[ 3 ] = g.x * v.y; terms[ 4 ] = g.x * v.z;
+      terms[ 5 ] = g.y * v.x; terms[ 6 ] = g.y * v.y; terms[ 7 ] = g.y * v.z;
+      terms[ 8 ] = g.z * v.x; terms[ 9 ] = g.z * v.y; terms[ 10 ] = g.z * v.z;
+      terms[ 11 ] = g.x; terms[ 12 ] = g.y; terms[ 13 ] = g.z;
+    }
+  }
+
+  reduce_terms_in_work_group( terms, 14, local_sums, group_sums );
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Computes the value and derivative for the B-spline transform. The squared
+// difference and the sample count are summed per work group into group_sums.
+// The derivative has the layout of the transform parameters (all x
+// coefficients, then all y and all z coefficients), and is accumulated
+// directly on the device.
+#ifdef DIM_3
+__kernel void AdvancedMeanSquaresBSplineTransform(
+  /* Fixed image samples: the point in xyz and the fixed image value in w */
+  __global const float4 * samples,
+  const uint number_of_samples,
+  /* Moving image buffer and meta information */
+  __global const INPIXELTYPE * moving_image,
+  __constant GPUImageBase3D * moving_image_base,
+  /* B-spline transform order, grid meta information and coefficients */
+  const uint spline_order,
+  __constant GPUImageBase3D * grid_base,
+  __global const float * coefficients,
+  /* Output: the derivative, set to zero beforehand */
+  __global float * derivative,
+  /* Scratch memory for the reduction, one float per work item */
+  __local float * local_sums,
+  /* Output: the 2 sums of each work group */
+  __global float * group_sums )
+{
+  float terms[ 2 ] = { 0.0f, 0.0f };
+
+  const uint global_id = get_global_id( 0 );
+  if( global_id < number_of_samples )
+  {
+    const float4 sample = samples[ global_id ];
+    const float3 fixed_point = sample.xyz;
+
+    const uint3 grid_size = grid_base->size;
+    const uint number_of_coefficients = grid_size.x * grid_size.y * grid_size.z;
+    const uint support_size = spline_order + 1;
+
+    // Outside the valid region the displacement is zero, and so is the Jacobian
+    float3 cindex = transform_physical_point_to_continuous_index_3d( fixed_point,
+      grid_base->physical_point_to_index, grid_base->origin );
+    const bool inside = inside_valid_region_3d( &cindex, spline_order, grid_size );
+
+    float weights[ 64 ];
+    uint  number_of_weights = 0;
+    long3 start_index = (long3)( 0, 0, 0 );
+    float3 mapped_point = fixed_point;
+    if( inside )
+    {
+      number_of_weights = support_size * support_size * support_size;
+      start_index = evaluate_3d( cindex, spline_order, support_size, number_of_weights, weights );
+
+      for( uint k = 0; k < number_of_weights; ++k )
+      {
+        const uint x = start_index.x + ( k % support_size );
+        const uint y = start_index.y + ( k / support_size ) % support_size;
+        const uint z = start_index.z + ( k / support_size / support_size ) % support_size;
+        const uint gidx = mad24( grid_size.x, mad24( z, grid_size.y, y ), x );
+        const float w = weights[ k ];
+
+        mapped_point.x = mad( coefficients[ gidx ], w, mapped_point.x );
+        mapped_point.y = mad( coefficients[ number_of_coefficients + gidx ], w, mapped_point.y );
+        mapped_point.z = mad( coefficients[ 2 * number_of_coefficients + gidx ], w, mapped_point.z );
+      }
+    }
+
+    float  moving_value;
+    float3 moving_derivative;
+    if( linear_evaluate_value_and_derivative_3d( mapped_point, moving_image, moving_image_base,
+      &moving_value, &moving_derivative ) )
+    {
+      const float diff = moving_value - sample.w;
+      const float3 g = 2.0f * diff * moving_derivative;
+
+      terms[ 0 ] = diff * diff;
+      terms[ 1 ] = 1.0f;
+
+      // The Jacobian of the coefficient with weight w is w times the identity
+      for( uint k = 0; k < number_of_weights; ++k )
+      {
+        const uint x = start_index.x + ( k % support_size );
+        const uint y = start_index.y + ( k / support_size ) % support_size;
+        const uint z = start_index.z + ( k / support_size / support_size ) % support_size;
+        const uint gidx = mad24( grid_size.x, mad24( z, grid_size.y, y ), x );
+        const float w = weights[ k ];
+
+        atomic_add_global_float( &derivative[ gidx ], g.x * w );
+        atomic_add_global_float( &derivative[ number_of_coefficients + gidx ], g.y * w );
+        atomic_add_global_float( &derivative[ 2 * number_of_coefficients + gidx ], g.z * w );
+      }
+    }
+  }
+
+  reduce_terms_in_work_group( terms, 2, local_sums, group_sums );
+}
+#endif // DIM_3
@@ -58,7 +58,7 @@ void set_weights( const float cindex,
   else if( spline_order == 1 )
   {
     weights[offset    ] = 1.0f - u;
-    weights[offset + 1] = u - 1.0f;
+    weights[offset + 1] = u;
 
     return;
   }
@@ -74,6 +74,43 @@ void set_weights( const float cindex,
   }
 }
 
+//------------------------------------------------------------------------------
+// The derivatives of the weights of set_weights() to the continuous index,
+// for the spline orders 1, 2 and 3.
+void set_derivative_weights( const float cindex,
+  const uint spline_order, const long startindex,
+  const uint offset, float * derivatives )
+{
+  const float u = cindex - (float)( startindex );
+
+  if( spline_order == 3 )
+  {
+    const float uu = u * u;
+
+    derivatives[offset    ] = ( -4.0f +  4.0f * u -        uu ) / 2.0f;
+    derivatives[offset + 1] = (  7.0f - 10.0f * u + 3.0f * uu ) / 2.0f;
+    derivatives[offset + 2] = ( -4.0f +  8.0f * u - 3.0f * uu ) / 2.0f;
+    derivatives[offset + 3] = (  1.0f -  2.0f * u +        uu ) / 2.0f;
+
+    return;
+  }
+  else if( spline_order == 1 )
+  {
+    derivatives[offset    ] = -1.0f;
+    derivatives[offset + 1] =  1.0f;
+
+    return;
+  }
+  else if( spline_order == 2 )
+  {
+    derivatives[offset    ] = u - 1.5f;
+    derivatives[offset + 1] = 2.0f - 2.0f * u;
+    derivatives[offset + 2] = u - 0.5f;
+
+    return;
+  }
+}
+
 //------------------------------------------------------------------------------
 #ifdef DIM_1
 bool inside_valid_region_1d( float * cindex, const uint spline_order,
@@ -436,3 +473,168 @@ float3 bspline_transform_point_3d( const float3 point,
   return tpoint;
 }
 #endif // DIM_3
+
+//------------------------------------------------------------------------------
+// Idem bspline_transform_point_2d(), but also computes the spatial Jacobian
+// dT/dx of the B-spline transform, row by row in jacobian.s01 and jacobian.s23.
+#ifdef DIM_2
+float2 bspline_transform_point_and_spatial_jacobian_2d( const float2 point,
+  const uint spline_order,
+  __constant GPUImageBase2D *coefficients_image,
+  __global const float *coefficients0,
+  __global const float *coefficients1,
+  float4 *jacobian )
+{
+  // the spatial Jacobian is the identity outside the valid region
+  (*jacobian) = (float4)( 1.0f, 0.0f, 0.0f, 1.0f );
+
+  float2 cindex;
+  transform_physical_point_to_continuous_index_2d( point, &cindex, coefficients_image );
+
+  const bool inside = inside_valid_region_2d( &cindex, spline_order, coefficients_image->size );
+  if( !inside ) return point;
+
+  // support region and coefficient image size, equals B-spline order + 1
+  const uint support_size = spline_order + 1;
+  const uint number_of_weights = support_size * support_size;
+
+  // find the starting index of the support region
+  long2 start_index;
+  const float tmp = (float)( spline_order - 1 ) / 2.0f;
+  start_index.x = (long)( floor( cindex.x - tmp ) );
+  start_index.y = (long)( floor( cindex.y - tmp ) );
+
+  // the 1D weights and their derivatives,
+  // we allocate the maximum to avoid using if's for all spline orders.
+  float weights1D[8];
+  float derivatives1D[8];
+  set_weights( cindex.x, spline_order, start_index.x, 0,            weights1D );
+  set_weights( cindex.y, spline_order, start_index.y, support_size, weights1D );
+  set_derivative_weights( cindex.x, spline_order, start_index.x, 0,            derivatives1D );
+  set_derivative_weights( cindex.y, spline_order, start_index.y, support_size, derivatives1D );
+
+  // copy kernel parameter from const memory to local memory for speedup
+  const uint coefficients_image_size_x = coefficients_image->size.x;
+
+  // the displacement, and its derivatives to the continuous index
+  float2 displacement = (float2)( 0.0f, 0.0f );
+  float2 dx = (float2)( 0.0f, 0.0f );
+  float2 dy = (float2)( 0.0f, 0.0f );
+  uint x, y, gidx;
+  for( uint k = 0; k < number_of_weights; ++k )
+  {
+    x = k % support_size;
+    y = ( k / support_size ) % support_size;
+
+    gidx = mad24( coefficients_image_size_x, (uint)( start_index.y ) + y, (uint)( start_index.x ) + x );
+    const float2 c = (float2)( coefficients0[ gidx ], coefficients1[ gidx ] );
+
+    const float wx = weights1D[ x ];
+    const float wy = weights1D[ support_size + y ];
+
+    displacement = mad( (float2)( wx * wy ), c, displacement );
+    dx = mad( (float2)( derivatives1D[ x ] * wy ), c, dx );
+    dy = mad( (float2)( wx * derivatives1D[ support_size + y ] ), c, dy );
+  }
+
+  // chain rule with d(cindex)/dx, i.e. the physical point to index matrix
+  const float2 pp2i_x = coefficients_image->physical_point_to_index.s01;
+  const float2 pp2i_y = coefficients_image->physical_point_to_index.s23;
+  (*jacobian).s01 += dx.x * pp2i_x + dy.x * pp2i_y;
+  (*jacobian).s23 += dx.y * pp2i_x + dy.y * pp2i_y;
+
+  // transformation = deformation + input point
+  return point + displacement;
+}
+#endif // DIM_2
+
+//------------------------------------------------------------------------------
+// Idem bspline_transform_point_3d(), but also computes the spatial Jacobian
+// dT/dx of the B-spline transform, row by row in jacobian.s012, jacobian.s345
+// and jacobian.s678.
+#ifdef DIM_3
+float3 bspline_transform_point_and_spatial_jacobian_3d( const float3 point,
+  const uint spline_order,
+  __constant GPUImageBase3D *coefficients_image, // only partially needed
+  __global const float *coefficients0,
+  __global const float *coefficients1,
+  __global const float *coefficients2,
+  float16 *jacobian )
+{
+  // the spatial Jacobian is the identity outside the valid region
+  (*jacobian) = (float16)( 0.0f );
+  (*jacobian).s0 = 1.0f; (*jacobian).s4 = 1.0f; (*jacobian).s8 = 1.0f;
+
+  // convert point to continuous index
+  float3 cindex = transform_physical_point_to_continuous_index_3d( point,
+    coefficients_image->physical_point_to_index, coefficients_image->origin );
+
+  // check if inside
+  const bool inside = inside_valid_region_3d( &cindex, spline_order, coefficients_image->size );
+  if( !inside ) return point;
+
+  // support region and coefficient image size, equals B-spline order + 1
+  const uint support_size = spline_order + 1;
+  const uint number_of_weights = support_size * support_size * support_size;
+
+  // find the starting index of the support region
+  long3 start_index;
+  const float tmp = (float)( spline_order - 1 ) / 2.0f;
+  start_index.x = (long)( floor( cindex.x - tmp ) );
+  start_index.y = (long)( floor( cindex.y - tmp ) );
+  start_index.z = (long)( floor( cindex.z - tmp ) );
+
+  // the 1D weights and their derivatives,
+  // we allocate the maximum to avoid using if's for all spline orders.
+  float weights1D[12];
+  float derivatives1D[12];
+  set_weights( cindex.x, spline_order, start_index.x, 0,                weights1D );
+  set_weights( cindex.y, spline_order, start_index.y, support_size,     weights1D );
+  set_weights( cindex.z, spline_order, start_index.z, support_size * 2, weights1D );
+  set_derivative_weights( cindex.x, spline_order, start_index.x, 0,                derivatives1D );
+  set_derivative_weights( cindex.y, spline_order, start_index.y, support_size,     derivatives1D );
+  set_derivative_weights( cindex.z, spline_order, start_index.z, support_size * 2, derivatives1D );
+
+  // copy kernel parameter from const memory to local memory for speedup
+  const uint coefficients_image_size_x = coefficients_image->size.x;
+  const uint coefficients_image_size_y = coefficients_image->size.y;
+
+  // the displacement, and its derivatives to the continuous index
+  float3 displacement = (float3)( 0.0f, 0.0f, 0.0f );
+  float3 dx = (float3)( 0.0f, 0.0f, 0.0f );
+  float3 dy = (float3)( 0.0f, 0.0f, 0.0f );
+  float3 dz = (float3)( 0.0f, 0.0f, 0.0f );
+  uint x, y, z, gidx;
+  for( uint k = 0; k < number_of_weights; ++k )
+  {
+    x = k % support_size;
+    y = ( k / support_size ) % support_size;
+    z = ( k / support_size / support_size ) % support_size;
+
+    gidx = mad24( coefficients_image_size_x,
+      mad24( (uint)( start_index.z ) + z, coefficients_image_size_y, (uint)( start_index.y ) + y ),
+      (uint)( start_index.x ) + x );
+    const float3 c = (float3)( coefficients0[ gidx ], coefficients1[ gidx ], coefficients2[ gidx ] );
+
+    const float wx = weights1D[ x ];
+    const float wy = weights1D[ support_size + y ];
+    const float wz = weights1D[ 2 * support_size + z ];
+
+    displacement = mad( (float3)( wx * wy * wz ), c, displacement );
+    dx = mad( (float3)( derivatives1D[ x ] * wy * wz ), c, dx );
+    dy = mad( (float3)( wx * derivatives1D[ support_size + y ] * wz ), c, dy );
+    dz = mad( (float3)( wx * wy * derivatives1D[ 2 * support_size + z ] ), c, dz );
+  }
+
+  // chain rule with d(cindex)/dx, i.e. the physical point to index matrix
+  const float3 pp2i_x = coefficients_image->physical_point_to_index.s012;
+  const float3 pp2i_y = coefficients_image->physical_point_to_index.s345;
+  const float3 pp2i_z = coefficients_image->physical_point_to_index.s678;
+  (*jacobian).s012 += dx.x * pp2i_x + dy.x * pp2i_y + dz.x * pp2i_z;
+  (*jacobian).s345 += dx.y * pp2i_x + dy.y * pp2i_y + dz.y * pp2i_z;
+  (*jacobian).s678 += dx.z * pp2i_x + dy.z * pp2i_y + dz.z * pp2i_z;
+
+  // transformation = deformation + input point
+  return point + displacement;
+}
+#endif // DIM_3
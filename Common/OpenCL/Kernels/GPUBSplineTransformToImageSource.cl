@@ -0,0 +1,159 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+//
+// OpenCL implementation of the computation of the displacement field, the
+// spatial Jacobian, or the determinant of the spatial Jacobian of a
+// transform T(x) = A_post( B( A_pre( x ) ) ), with B a B-spline transform,
+// and A_pre and A_post matrix-offset transforms, on the grid of an image.
+// \sa GPUBSplineTransformToImageSource
+//
+// One of DISPLACEMENT_FIELD, SPATIAL_JACOBIAN, and
+// DETERMINANT_OF_SPATIAL_JACOBIAN should be defined.
+
+//------------------------------------------------------------------------------
+#ifdef DIM_2
+float4 multiply_matrices_2d( const float4 a, const float4 b )
+{
+  return (float4)(
+    a.s0 * b.s0 + a.s1 * b.s2, a.s0 * b.s1 + a.s1 * b.s3,
+    a.s2 * b.s0 + a.s3 * b.s2, a.s2 * b.s1 + a.s3 * b.s3 );
+}
+#endif // DIM_2
+
+//------------------------------------------------------------------------------
+#ifdef DIM_3
+float16 multiply_matrices_3d( const float16 a, const float16 b )
+{
+  // the columns of b
+  const float3 b0 = (float3)( b.s0, b.s3, b.s6 );
+  const float3 b1 = (float3)( b.s1, b.s4, b.s7 );
+  const float3 b2 = (float3)( b.s2, b.s5, b.s8 );
+
+  float16 c = (float16)( 0.0f );
+  c.s012 = (float3)( dot( a.s012, b0 ), dot( a.s012, b1 ), dot( a.s012, b2 ) );
+  c.s345 = (float3)( dot( a.s345, b0 ), dot( a.s345, b1 ), dot( a.s345, b2 ) );
+  c.s678 = (float3)( dot( a.s678, b0 ), dot( a.s678, b1 ), dot( a.s678, b2 ) );
+  return c;
+}
+#endif // DIM_3
+
+//------------------------------------------------------------------------------
+// The index is relative to the start of the image, the global offset of the
+// kernel is the start of the chunk that is computed.
+#if defined( DIM_2 )
+__kernel void BSplineTransformToImageSource(
+  /* Output buffer of the chunk */
+  __global float *out,
+  /* Chunk size */
+  uint2 chunk_size,
+  /* Output image information */
+  const float4 index_to_physical_point,
+  const float2 origin,
+  /* The matrix-offset transforms before and after the B-spline transform */
+  const float4 pre_matrix,
+  const float2 pre_offset,
+  const float4 post_matrix,
+  const float2 post_offset,
+  /* B-spline transform spline order */
+  uint spline_order,
+  /* B-spline transform coefficients image meta information. */
+  __constant GPUImageBase2D *coefficients_image,
+  /* B-spline transform coefficients images. */
+  __global const float *transform_coefficients0,
+  __global const float *transform_coefficients1 )
+{
+  const uint2 global_id = (uint2)( get_global_id( 0 ), get_global_id( 1 ) );
+  const uint2 index = global_id - (uint2)( get_global_offset( 0 ), get_global_offset( 1 ) );
+  if( index.x >= chunk_size.x || index.y >= chunk_size.y ) return;
+
+  const uint tidx = mad24( chunk_size.x, index.y, index.x );
+
+  const float2 point = transform_index_to_physical_point_2d_( global_id, index_to_physical_point, origin );
+  const float2 pre_point = matrix_offset_transform_point_2d( point, pre_matrix, pre_offset );
+
+  float4 jacobian;
+  const float2 bspline_point = bspline_transform_point_and_spatial_jacobian_2d( pre_point,
+    spline_order, coefficients_image, transform_coefficients0, transform_coefficients1, &jacobian );
+
+#if defined( DISPLACEMENT_FIELD )
+  const float2 transformed_point = matrix_offset_transform_point_2d( bspline_point, post_matrix, post_offset );
+  vstore2( transformed_point - point, tidx, out );
+#else
+  jacobian = multiply_matrices_2d( post_matrix, multiply_matrices_2d( jacobian, pre_matrix ) );
+#if defined( SPATIAL_JACOBIAN )
+  vstore4( jacobian, tidx, out );
+#elif defined( DETERMINANT_OF_SPATIAL_JACOBIAN )
+  out[tidx] = jacobian.s0 * jacobian.s3 - jacobian.s1 * jacobian.s2;
+#endif
+#endif
+}
+#endif // DIM_2
+
+//------------------------------------------------------------------------------
+#if defined( DIM_3 )
+__kernel void BSplineTransformToImageSource(
+  /* Output buffer of the chunk */
+  __global float *out,
+  /* Chunk size */
+  uint3 chunk_size,
+  /* Output image information */
+  const float16 index_to_physical_point, // OpenCL does not have float9
+  const float3 origin,
+  /* The matrix-offset transforms before and after the B-spline transform */
+  const float16 pre_matrix,
+  const float3 pre_offset,
+  const float16 post_matrix,
+  const float3 post_offset,
+  /* B-spline transform spline order */
+  uint spline_order,
+  /* B-spline transform coefficients image meta information. */
+  __constant GPUImageBase3D *coefficients_image, // only PhysicalPointToIndex, Origin, Size needed
+  /* B-spline transform coefficients images. */
+  __global const float *transform_coefficients0,
+  __global const float *transform_coefficients1,
+  __global const float *transform_coefficients2 )
+{
+  const uint3 global_id = (uint3)( get_global_id( 0 ), get_global_id( 1 ), get_global_id( 2 ) );
+  const uint3 index = global_id
+    - (uint3)( get_global_offset( 0 ), get_global_offset( 1 ), get_global_offset( 2 ) );
+  if( index.x >= chunk_size.x || index.y >= chunk_size.y || index.z >= chunk_size.z ) return;
+
+  const uint tidx = mad24( chunk_size.x, mad24( index.z, chunk_size.y, index.y ), index.x );
+
+  const float3 point = transform_index_to_physical_point_3d_( global_id, index_to_physical_point, origin );
+  const float3 pre_point = matrix_offset_transform_point_3d( point, pre_matrix, pre_offset );
+
+  float16 jacobian;
+  const float3 bspline_point = bspline_transform_point_and_spatial_jacobian_3d( pre_point,
+    spline_order, coefficients_image,
+    transform_coefficients0, transform_coefficients1, transform_coefficients2, &jacobian );
+
+#if defined( DISPLACEMENT_FIELD )
+  const float3 transformed_point = matrix_offset_transform_point_3d( bspline_point, post_matrix, post_offset );
+  vstore3( transformed_point - point, tidx, out );
+#else
+  jacobian = multiply_matrices_3d( post_matrix, multiply_matrices_3d( jacobian, pre_matrix ) );
+#if defined( SPATIAL_JACOBIAN )
+  vstore8( jacobian.s01234567, 0, out + 9 * tidx );
+  out[9 * tidx + 8] = jacobian.s8;
+#elif defined( DETERMINANT_OF_SPATIAL_JACOBIAN )
+  out[tidx] = dot( jacobian.s012, cross( jacobian.s345, jacobian.s678 ) );
+#endif
+#endif
+}
+#endif // DIM_3
@@ -25,7 +25,10 @@ namespace itk
 {
 //------------------------------------------------------------------------------
 bool
-CreateOpenCLContext(std::string & errorMessage, const std::string openCLDeviceType, const int openCLDeviceID)
+CreateOpenCLContext(std::string &     errorMessage,
+                    const std::string openCLDeviceType,
+                    const int         openCLDeviceID,
+                    const bool        useMultipleDevices)
 {
   /** Get a handle to an existing OpenCL context. */
   itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
@@ -42,8 +45,16 @@ CreateOpenCLContext(std::string & errorMessage, const std::string openCLDeviceTy
   if (openCLDeviceType == "GPU" && openCLDeviceID == -1)
   {
 #if defined(OPENCL_USE_INTEL_CPU) || defined(OPENCL_USE_AMD_CPU)
+    if (useMultipleDevices)
+    {
+      return context->Create(itk::OpenCLContext::DevelopmentMultipleMaximumFlopsDevices);
+    }
     return context->Create(itk::OpenCLContext::DevelopmentSingleMaximumFlopsDevice);
 #else
+    if (useMultipleDevices)
+    {
+      return context->Create(itk::OpenCLContext::MultipleMaximumFlopsDevices);
+    }
     return context->Create(itk::OpenCLContext::SingleMaximumFlopsDevice);
 #endif
   }
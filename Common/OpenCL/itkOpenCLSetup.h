@@ -25,9 +25,15 @@
  */
 namespace itk
 {
-/** Method that is used to create OpenCL context within elastix and transformix. */
+/** Method that is used to create OpenCL context within elastix and transformix.
+ * When \a useMultipleDevices is true and no device ID is supplied, the context
+ * contains all devices of the best performing type, instead of just the best device.
+ */
 bool
-CreateOpenCLContext(std::string & errorMessage, const std::string openCLDeviceType, const int openCLDeviceID);
+CreateOpenCLContext(std::string &     errorMessage,
+                    const std::string openCLDeviceType,
+                    const int         openCLDeviceID,
+                    const bool        useMultipleDevices = false);
 
 /** Method that is used to create OpenCL logger within elastix and transformix. */
 void
@@ -168,14 +168,16 @@ public:
   typedef typename Superclass::InputCovariantVectorType  InputCovariantVectorType;
   typedef typename Superclass::OutputCovariantVectorType OutputCovariantVectorType;
 
-  typedef typename Superclass::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
-  typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
-  typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename Superclass::SpatialHessianType            SpatialHessianType;
-  typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType            InternalMatrixType;
-  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
-  typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::NonZeroJacobianIndicesType             NonZeroJacobianIndicesType;
+  typedef typename Superclass::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename Superclass::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename Superclass::SpatialHessianType                     SpatialHessianType;
+  typedef typename Superclass::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename Superclass::InternalMatrixType                     InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType                MovingImageGradientType;
+  typedef typename Superclass::MovingImageGradientValueType           MovingImageGradientValueType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename Superclass::PixelType    PixelType;
@@ -196,10 +198,20 @@ public:
   void
   SetGridRegion(const RegionType & region) override;
 
+  /** Tabulate the weights of all weights functions, see the superclass. */
+  void
+  SetGridAlignedWeightsTableSize(unsigned int size) override;
+
   /** Transform points by a B-spline deformable transformation. */
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Transform a batch of points, without a virtual call per point. */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   /** Interpolation weights function type. */
   typedef BSplineInterpolationWeightFunction2<ScalarType,
                                               itkGetStaticConstMacro(SpaceDimension),
@@ -263,6 +275,14 @@ public:
                                            DerivativeType &                imageJacobian,
                                            NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
 
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(), without a virtual call per point. */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override;
@@ -301,6 +321,20 @@ public:
                               JacobianOfSpatialHessianType & jsh,
                               NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const override;
 
+  /** Compute the spatial Jacobian and the Jacobian of the spatial Jacobian in separable form. */
+  bool
+  GetSeparableJacobianOfSpatialJacobian(const InputPointType &                   ipp,
+                                        SpatialJacobianType &                    sj,
+                                        SeparableJacobianOfSpatialJacobianType & jsj,
+                                        NonZeroJacobianIndicesType &             nonZeroJacobianIndices) const override;
+
+  /** Compute the spatial Hessian and the Jacobian of the spatial Hessian in separable form. */
+  bool
+  GetSeparableJacobianOfSpatialHessian(const InputPointType &                  ipp,
+                                       SpatialHessianType &                    sh,
+                                       SeparableJacobianOfSpatialHessianType & jsh,
+                                       NonZeroJacobianIndicesType &            nonZeroJacobianIndices) const override;
+
 protected:
   /** Print contents of an AdvancedBSplineDeformableTransform. */
   void
@@ -210,6 +210,26 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::SetG
 }
 
 
+// Set the size of the grid aligned weights tables
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::SetGridAlignedWeightsTableSize(
+  unsigned int size)
+{
+  this->m_WeightsFunction->SetGridAlignedWeightsTableSize(size);
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    this->m_DerivativeWeightsFunctions[i]->SetGridAlignedWeightsTableSize(size);
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      this->m_SODerivativeWeightsFunctions[i][j]->SetGridAlignedWeightsTableSize(size);
+    }
+  }
+
+  this->Superclass::SetGridAlignedWeightsTableSize(size);
+}
+
+
 // Transform a point
 template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
 void
@@ -270,6 +290,11 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::Tran
     iterator[j] = IteratorType(this->m_CoefficientImages[j], supportRegion);
   }
 
+  /** The single precision copy of the coefficients, if any. */
+  const float * const singlePrecisionCoefficients =
+    this->m_SinglePrecisionCoefficients.empty() ? nullptr : this->m_SinglePrecisionCoefficients.data();
+  const SizeValueType numberOfCoefficients = this->m_SinglePrecisionCoefficients.size() / SpaceDimension;
+
   /** Loop over the support region. */
   while (!iterator[0].IsAtEnd())
   {
@@ -279,10 +304,22 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::Tran
       indices[counter] = &(iterator[0].Value()) - basePointer;
 
       // multiply weight with coefficient to compute displacement
-      for (unsigned int j = 0; j < SpaceDimension; ++j)
+      if (singlePrecisionCoefficients)
+      {
+        const float * coefficient = singlePrecisionCoefficients + indices[counter];
+        for (unsigned int j = 0; j < SpaceDimension; ++j)
+        {
+          outputPoint[j] += static_cast<ScalarType>(weights[counter] * coefficient[j * numberOfCoefficients]);
+          ++iterator[j];
+        }
+      }
+      else
       {
-        outputPoint[j] += static_cast<ScalarType>(weights[counter] * iterator[j].Value());
-        ++iterator[j];
+        for (unsigned int j = 0; j < SpaceDimension; ++j)
+        {
+          outputPoint[j] += static_cast<ScalarType>(weights[counter] * iterator[j].Value());
+          ++iterator[j];
+        }
       }
       ++counter;
     } // end of scanline
@@ -502,6 +539,49 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::Eval
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    outputPoints[i] = this->Self::TransformPoint(inputPoints[i]);
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    this->Self::EvaluateJacobianWithImageGradientProduct(
+      ipp[i], movingImageGradients[i], imageJacobians[i], nonZeroJacobianIndices[i]);
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -1048,9 +1128,9 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJ
    * Make use of the fact that the Hessian is symmetrical, so do not compute
    * both i,j and j,i for i != j.
    */
-  const unsigned int         d = SpaceDimension * (SpaceDimension + 1) / 2;
-  FixedArray<WeightsType, d> weightVector;
-  unsigned int               count = 0;
+  const unsigned int d = SpaceDimension * (SpaceDimension + 1) / 2;
+  double             weightVector[d * numberOfWeights];
+  unsigned int       count = 0;
   for (unsigned int i = 0; i < SpaceDimension; ++i)
   {
     for (unsigned int j = 0; j <= i; ++j)
@@ -1058,8 +1138,8 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJ
       /** Compute the derivative weights. */
       this->m_SODerivativeWeightsFunctions[i][j]->Evaluate(cindex, supportIndex, weights);
 
-      /** Remember the weights. */
-      weightVector[count] = weights;
+      /** Remember the weights, on the stack instead of in heap allocated arrays. */
+      std::copy(weights.data_block(), weights.data_block() + numberOfWeights, weightVector + count * numberOfWeights);
       ++count;
 
     } // end for j
@@ -1074,7 +1154,7 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJ
     {
       for (unsigned int j = 0; j <= i; ++j)
       {
-        double tmp = weightVector[count][mu];
+        double tmp = weightVector[count * numberOfWeights + mu];
         matrix[i][j] = tmp;
         if (i != j)
         {
@@ -1300,6 +1380,306 @@ AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJ
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ********************* GetSeparableJacobianOfSpatialJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+bool
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetSeparableJacobianOfSpatialJacobian(
+  const InputPointType &                   ipp,
+  SpatialJacobianType &                    sj,
+  SeparableJacobianOfSpatialJacobianType & jsj,
+  NonZeroJacobianIndicesType &             nonZeroJacobianIndices) const
+{
+  // Can only compute Jacobian if parameters are set via
+  // SetParameters or SetParametersByValue
+  if (this->m_InputParametersPointer == nullptr)
+  {
+    itkExceptionMacro(<< "Cannot compute Jacobian: parameters not set");
+  }
+
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  jsj.resize(numberOfWeights);
+
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(ipp, cindex);
+
+  // NOTE: if the support region does not lie totally within the grid
+  // we assume zero displacement and identity sj and zero jsj.
+  if (!this->InsideValidRegion(cindex))
+  {
+    sj.SetIdentity();
+    for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+    {
+      jsj[mu].Fill(0.0);
+    }
+    nonZeroJacobianIndices.resize(this->GetNumberOfNonZeroJacobianIndices());
+    for (NumberOfParametersType i = 0; i < this->GetNumberOfNonZeroJacobianIndices(); ++i)
+    {
+      nonZeroJacobianIndices[i] = i;
+    }
+    return true;
+  }
+
+  /** Helper variables. */
+  IndexType supportIndex;
+  this->m_DerivativeWeightsFunctions[0]->ComputeStartIndex(cindex, supportIndex);
+  RegionType supportRegion;
+  supportRegion.SetSize(this->m_SupportSize);
+  supportRegion.SetIndex(supportIndex);
+
+  /** Allocate weight on the stack. */
+  typedef typename WeightsType::ValueType WeightsValueType;
+  WeightsValueType                        weightsArray[numberOfWeights];
+  WeightsType                             weights(weightsArray, numberOfWeights, false);
+
+  /** Allocate coefficients on the stack. */
+  WeightsValueType coeffArray[numberOfWeights * SpaceDimension];
+  WeightsType      coeffs(coeffArray, numberOfWeights * SpaceDimension, false);
+
+  /** Copy values from coefficient image to linear coeffs array. */
+  typedef ImageScanlineConstIterator<ImageType> IteratorType;
+  typename WeightsType::iterator                itCoeffsLinear = coeffs.begin();
+  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+  {
+    IteratorType itCoef(this->m_CoefficientImages[dim], supportRegion);
+
+    while (!itCoef.IsAtEnd())
+    {
+      while (!itCoef.IsAtEndOfLine())
+      {
+        (*itCoeffsLinear) = itCoef.Value();
+        ++itCoeffsLinear;
+        ++itCoef;
+      }
+      itCoef.NextLine();
+    }
+  }
+
+  /** Initialize the spatial Jacobian sj and the grid index derivatives of the weights. */
+  sj.Fill(0.0);
+  for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+  {
+    jsj[mu].Fill(0.0);
+  }
+
+  /** For all derivative directions i, compute the spatial Jacobian and
+   * the derivative of the weights d/dmu of dT / dx_i, in grid index space.
+   */
+  typename WeightsType::const_iterator itWeights;
+  typename WeightsType::const_iterator itCoeffs = coeffs.begin();
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    /** Compute the derivative weights. */
+    this->m_DerivativeWeightsFunctions[i]->Evaluate(cindex, supportIndex, weights);
+
+    /** Take into account grid spacing and direction cosines:
+     *    jsj[mu] = weights_mu^T * M, with M the PointToIndexMatrix2.
+     */
+    for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+    {
+      for (unsigned int j = 0; j < SpaceDimension; ++j)
+      {
+        jsj[mu][j] += weights[mu] * this->m_PointToIndexMatrix2[i][j];
+      }
+    }
+
+    /** Compute the spatial Jacobian sj:
+     *    dT_{dim} / dx_i = delta_{dim,i} + \sum coefs_{dim} * weights.
+     */
+    itCoeffs = coeffs.begin();
+    for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+    {
+      itWeights = weights.begin();
+      for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+      {
+        sj(dim, i) += (*itCoeffs) * (*itWeights);
+        ++itWeights;
+        ++itCoeffs;
+      }
+    }
+  }
+
+  /** Take into account grid spacing and direction cosines. */
+  sj = sj * this->m_PointToIndexMatrix2;
+
+  /** Add contribution of spatial derivative of x. */
+  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+  {
+    sj(dim, dim) += 1.0;
+  }
+
+  /** Compute the nonzero Jacobian indices. */
+  this->ComputeNonZeroJacobianIndices(nonZeroJacobianIndices, supportRegion);
+
+  return true;
+
+} // end GetSeparableJacobianOfSpatialJacobian()
+
+
+/**
+ * ********************* GetSeparableJacobianOfSpatialHessian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+bool
+AdvancedBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetSeparableJacobianOfSpatialHessian(
+  const InputPointType &                  ipp,
+  SpatialHessianType &                    sh,
+  SeparableJacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType &            nonZeroJacobianIndices) const
+{
+  // Can only compute Jacobian if parameters are set via
+  // SetParameters or SetParametersByValue
+  if (this->m_InputParametersPointer == nullptr)
+  {
+    itkExceptionMacro(<< "Cannot compute Jacobian: parameters not set");
+  }
+
+  const unsigned long numberOfWeights = WeightsFunctionType::NumberOfWeights;
+  jsh.resize(numberOfWeights);
+
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(ipp, cindex);
+
+  // NOTE: if the support region does not lie totally within the grid
+  // we assume zero displacement and zero sh and jsh.
+  if (!this->InsideValidRegion(cindex))
+  {
+    for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+    {
+      jsh[mu].Fill(0.0);
+    }
+    for (unsigned int i = 0; i < sh.Size(); ++i)
+    {
+      sh[i].Fill(0.0);
+    }
+    nonZeroJacobianIndices.resize(this->GetNumberOfNonZeroJacobianIndices());
+    for (NumberOfParametersType i = 0; i < this->GetNumberOfNonZeroJacobianIndices(); ++i)
+    {
+      nonZeroJacobianIndices[i] = i;
+    }
+    return true;
+  }
+
+  /** Get the support region. */
+  IndexType supportIndex;
+  this->m_SODerivativeWeightsFunctions[0][0]->ComputeStartIndex(cindex, supportIndex);
+  RegionType supportRegion;
+  supportRegion.SetSize(this->m_SupportSize);
+  supportRegion.SetIndex(supportIndex);
+
+  /** Allocate weight on the stack. */
+  typedef typename WeightsType::ValueType WeightsValueType;
+  WeightsValueType                        weightsArray[numberOfWeights];
+  WeightsType                             weights(weightsArray, numberOfWeights, false);
+
+  /** Allocate coefficients on the stack. */
+  WeightsValueType coeffArray[numberOfWeights * SpaceDimension];
+  WeightsType      coeffs(coeffArray, numberOfWeights * SpaceDimension, false);
+
+  /** Copy values from coefficient image to linear coeffs array. */
+  typedef ImageScanlineConstIterator<ImageType> IteratorType;
+  typename WeightsType::iterator                itCoeffsLinear = coeffs.begin();
+  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+  {
+    IteratorType itCoef(this->m_CoefficientImages[dim], supportRegion);
+
+    while (!itCoef.IsAtEnd())
+    {
+      while (!itCoef.IsAtEndOfLine())
+      {
+        (*itCoeffsLinear) = itCoef.Value();
+        ++itCoeffsLinear;
+        ++itCoef;
+      }
+      itCoef.NextLine();
+    }
+  }
+
+  /** For all derivative directions, compute the spatial Hessian and the
+   * second order derivatives of the weights, d/dmu of d^2T / dx_i dx_j,
+   * in grid index space. The Hessian is symmetrical, so do not compute
+   * both i,j and j,i for i != j.
+   */
+  typename WeightsType::const_iterator itWeights;
+  typename WeightsType::const_iterator itCoeffs;
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    for (unsigned int j = 0; j <= i; ++j)
+    {
+      /** Compute the derivative weights. */
+      this->m_SODerivativeWeightsFunctions[i][j]->Evaluate(cindex, supportIndex, weights);
+
+      /** Store the weights directly in the matrices of jsh. */
+      for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+      {
+        jsh[mu][i][j] = weights[mu];
+        jsh[mu][j][i] = weights[mu];
+      }
+
+      /** Compute the spatial Hessian sh:
+       *    d^2T_{dim} / dx_i dx_j = \sum coefs_{dim} * weights.
+       */
+      itCoeffs = coeffs.begin();
+      for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+      {
+        itWeights = weights.begin();
+        double sum = 0.0;
+        for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+        {
+          sum += (*itCoeffs) * (*itWeights);
+          ++itWeights;
+          ++itCoeffs;
+        }
+
+        /** Update the spatial Hessian sh. The Hessian is symmetrical. */
+        sh[dim](i, j) = sum;
+        sh[dim](j, i) = sum;
+      }
+
+    } // end for j
+  }   // end for i
+
+  /** Take into account grid spacing and direction matrix. */
+  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+  {
+    sh[dim] = this->m_PointToIndexMatrixTransposed2 * (sh[dim] * this->m_PointToIndexMatrix2);
+  }
+
+  for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+  {
+    if (!this->m_PointToIndexMatrixIsDiagonal)
+    {
+      jsh[mu] = this->m_PointToIndexMatrixTransposed2 * (jsh[mu] * this->m_PointToIndexMatrix2);
+    }
+    else
+    {
+      for (unsigned int i = 0; i < SpaceDimension; ++i)
+      {
+        for (unsigned int j = 0; j < SpaceDimension; ++j)
+        {
+          jsh[mu][i][j] *= this->m_PointToIndexMatrixDiagonalProducts[i + SpaceDimension * j];
+        }
+      }
+    }
+  }
+
+  /** Compute the nonzero Jacobian indices. */
+  this->ComputeNonZeroJacobianIndices(nonZeroJacobianIndices, supportRegion);
+
+  return true;
+
+} // end GetSeparableJacobianOfSpatialHessian()
+
+
 /**
  * ********************* ComputeNonZeroJacobianIndices ****************************
  */
@@ -22,6 +22,8 @@
 #include "itkImage.h"
 #include "itkImageRegion.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -72,14 +74,16 @@ public:
   typedef typename Superclass::OutputCovariantVectorType OutputCovariantVectorType;
   typedef typename Superclass::TransformCategoryEnum     TransformCategoryEnum;
 
-  typedef typename Superclass::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
-  typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
-  typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename Superclass::SpatialHessianType            SpatialHessianType;
-  typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType            InternalMatrixType;
-  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
-  typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::NonZeroJacobianIndicesType             NonZeroJacobianIndicesType;
+  typedef typename Superclass::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename Superclass::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename Superclass::SpatialHessianType                     SpatialHessianType;
+  typedef typename Superclass::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename Superclass::InternalMatrixType                     InternalMatrixType;
+  typedef typename Superclass::MovingImageGradientType                MovingImageGradientType;
+  typedef typename Superclass::MovingImageGradientValueType           MovingImageGradientValueType;
 
   /** This method sets the parameters of the transform.
    * For a B-spline deformation transform, the parameters are the BSpline
@@ -222,6 +226,27 @@ public:
   // itkGetMacro( GridOrigin, OriginType );
   itkGetConstMacro(GridOrigin, OriginType);
 
+  /** Tabulate the B-spline weights at the fractions k / n, k = 0, ..., n - 1, of a grid cell.
+   * Points that lie on such a fraction in a dimension, such as the voxels of an image that is
+   * aligned with the grid and whose spacing is the grid spacing divided by a divisor of n, then
+   * use table look-ups instead of evaluating the B-spline kernels. The results are equal up to
+   * rounding. Building the tables is not thread-safe. Default: 0, which disables the tables.
+   */
+  virtual void
+  SetGridAlignedWeightsTableSize(unsigned int size);
+  itkGetConstMacro(GridAlignedWeightsTableSize, unsigned int);
+
+  /** Let TransformPoint() read the B-spline coefficients from a single precision
+   * copy, which halves the memory traffic of the coefficient look-ups. The weighted
+   * sums are still accumulated in double precision. The copy is refreshed by
+   * SetParameters(), SetParametersByValue(), SetCoefficientImages() and SetIdentity();
+   * changes made to the parameter array in place are not seen. Default: false.
+   */
+  virtual void
+  SetUseSinglePrecisionCoefficients(bool _arg);
+  itkGetConstMacro(UseSinglePrecisionCoefficients, bool);
+  itkBooleanMacro(UseSinglePrecisionCoefficients);
+
   /** Parameter index array type. */
   typedef Array<unsigned long> ParameterIndexArrayType;
 
@@ -317,6 +342,10 @@ protected:
   void
   UpdatePointIndexConversions(void);
 
+  /** Copy the coefficients to m_SinglePrecisionCoefficients, when requested. */
+  void
+  UpdateSinglePrecisionCoefficients(void);
+
   virtual void
   ComputeNonZeroJacobianIndices(NonZeroJacobianIndicesType & nonZeroJacobianIndices,
                                 const RegionType &           supportRegion) const = 0;
@@ -357,9 +386,18 @@ protected:
   /** Odd or even order B-spline. */
   bool m_SplineOrderOdd;
 
+  /** The size of the grid aligned weights tables, 0 when not used. */
+  unsigned int m_GridAlignedWeightsTableSize;
+
   /** Keep a pointer to the input parameters. */
   const ParametersType * m_InputParametersPointer;
 
+  /** The single precision copy of the coefficients of all dimensions, one
+   * image buffer after the other. Empty when it is not used.
+   */
+  bool               m_UseSinglePrecisionCoefficients;
+  std::vector<float> m_SinglePrecisionCoefficients;
+
   /** Jacobian as SpaceDimension number of images. */
   typedef typename JacobianType::ValueType                                 JacobianPixelType;
   typedef Image<JacobianPixelType, itkGetStaticConstMacro(SpaceDimension)> JacobianImageType;
@@ -43,6 +43,8 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::AdvancedBSplin
   this->m_GridSpacing.Fill(1.0);       // default spacing is all ones
   this->m_GridDirection.SetIdentity(); // default spacing is all ones
   this->m_GridOffsetTable.Fill(0);
+  this->m_GridAlignedWeightsTableSize = 0;
+  this->m_UseSinglePrecisionCoefficients = false;
 
   this->m_InternalParametersBuffer = ParametersType(0);
   // Make sure the parameters pointer is not NULL after construction.
@@ -246,6 +248,60 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::SetGridOrigin(
 }
 
 
+// Set the size of the grid aligned weights tables
+template <class TScalarType, unsigned int NDimensions>
+void
+AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::SetGridAlignedWeightsTableSize(unsigned int size)
+{
+  if (this->m_GridAlignedWeightsTableSize != size)
+  {
+    this->m_GridAlignedWeightsTableSize = size;
+    this->Modified();
+  }
+}
+
+
+// Set whether single precision coefficients are used
+template <class TScalarType, unsigned int NDimensions>
+void
+AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::SetUseSinglePrecisionCoefficients(bool _arg)
+{
+  if (this->m_UseSinglePrecisionCoefficients != _arg)
+  {
+    this->m_UseSinglePrecisionCoefficients = _arg;
+    this->UpdateSinglePrecisionCoefficients();
+    this->Modified();
+  }
+}
+
+
+// Copy the coefficients to single precision
+template <class TScalarType, unsigned int NDimensions>
+void
+AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::UpdateSinglePrecisionCoefficients(void)
+{
+  if (!this->m_UseSinglePrecisionCoefficients || !this->m_CoefficientImages[0])
+  {
+    std::vector<float>().swap(this->m_SinglePrecisionCoefficients);
+    return;
+  }
+
+  const SizeValueType numberOfPixels = this->m_CoefficientImages[0]->GetBufferedRegion().GetNumberOfPixels();
+  this->m_SinglePrecisionCoefficients.resize(SpaceDimension * numberOfPixels);
+
+  float * destination = this->m_SinglePrecisionCoefficients.data();
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    const PixelType * source = this->m_CoefficientImages[j]->GetBufferPointer();
+    for (SizeValueType i = 0; i < numberOfPixels; ++i)
+    {
+      destination[i] = static_cast<float>(source[i]);
+    }
+    destination += numberOfPixels;
+  }
+}
+
+
 // Set the parameters
 template <class TScalarType, unsigned int NDimensions>
 void
@@ -255,6 +311,7 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::SetIdentity()
   {
     ParametersType * parameters = const_cast<ParametersType *>(this->m_InputParametersPointer);
     parameters->Fill(0.0);
+    this->UpdateSinglePrecisionCoefficients();
     this->Modified();
   }
   else
@@ -400,6 +457,8 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::WrapAsImages(v
     dataPointer += numberOfPixels;
     this->m_CoefficientImages[j] = this->m_WrappedImage[j];
   }
+
+  this->UpdateSinglePrecisionCoefficients();
 }
 
 
@@ -498,6 +557,8 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::SetCoefficient
     // Clean up buffered parameters
     this->m_InternalParametersBuffer = ParametersType(0);
     this->m_InputParametersPointer = nullptr;
+
+    this->UpdateSinglePrecisionCoefficients();
   }
 }
 
@@ -535,6 +596,7 @@ AdvancedBSplineDeformableTransformBase<TScalarType, NDimensions>::PrintSelf(std:
   os << " ]" << std::endl;
 
   os << indent << "InputParametersPointer: " << this->m_InputParametersPointer << std::endl;
+  os << indent << "UseSinglePrecisionCoefficients: " << this->m_UseSinglePrecisionCoefficients << std::endl;
   os << indent << "ValidRegion: " << this->m_ValidRegion << std::endl;
   os << indent << "LastJacobianIndex: " << this->m_LastJacobianIndex << std::endl;
 }
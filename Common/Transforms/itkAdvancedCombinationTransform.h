@@ -19,6 +19,7 @@
 #define itkAdvancedCombinationTransform_h
 
 #include "itkAdvancedTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
 #include "itkMacro.h"
 
 namespace itk
@@ -49,6 +50,11 @@ namespace itk
  * Note: It is mandatory to set a current transform. An initial transform
  * is not mandatory.
  *
+ * A linear initial transform, which may itself be a chain of combination
+ * transforms, can be flattened into a single matrix-offset transform by
+ * FlattenInitialTransform(). This avoids evaluating the whole chain for
+ * every point and every Jacobian.
+ *
  * \ingroup Transforms
  */
 
@@ -72,32 +78,34 @@ public:
   itkStaticConstMacro(SpaceDimension, unsigned int, NDimensions);
 
   /** Typedefs inherited from Superclass.*/
-  typedef typename Superclass::ScalarType                    ScalarType;
-  typedef typename Superclass::ParametersType                ParametersType;
-  typedef typename Superclass::FixedParametersType           FixedParametersType;
-  typedef typename Superclass::ParametersValueType           ParametersValueType;
-  typedef typename Superclass::NumberOfParametersType        NumberOfParametersType;
-  typedef typename Superclass::DerivativeType                DerivativeType;
-  typedef typename Superclass::JacobianType                  JacobianType;
-  typedef typename Superclass::InputVectorType               InputVectorType;
-  typedef typename Superclass::OutputVectorType              OutputVectorType;
-  typedef typename Superclass::InputCovariantVectorType      InputCovariantVectorType;
-  typedef typename Superclass::OutputCovariantVectorType     OutputCovariantVectorType;
-  typedef typename Superclass::InputVnlVectorType            InputVnlVectorType;
-  typedef typename Superclass::OutputVnlVectorType           OutputVnlVectorType;
-  typedef typename Superclass::InputPointType                InputPointType;
-  typedef typename Superclass::OutputPointType               OutputPointType;
-  typedef typename Superclass::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
-  typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
-  typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename Superclass::SpatialHessianType            SpatialHessianType;
-  typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType            InternalMatrixType;
-  typedef typename Superclass::InverseTransformBaseType      InverseTransformBaseType;
-  typedef typename Superclass::InverseTransformBasePointer   InverseTransformBasePointer;
-  typedef typename Superclass::TransformCategoryEnum         TransformCategoryEnum;
-  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
-  typedef typename Superclass::MovingImageGradientValueType  MovingImageGradientValueType;
+  typedef typename Superclass::ScalarType                             ScalarType;
+  typedef typename Superclass::ParametersType                         ParametersType;
+  typedef typename Superclass::FixedParametersType                    FixedParametersType;
+  typedef typename Superclass::ParametersValueType                    ParametersValueType;
+  typedef typename Superclass::NumberOfParametersType                 NumberOfParametersType;
+  typedef typename Superclass::DerivativeType                         DerivativeType;
+  typedef typename Superclass::JacobianType                           JacobianType;
+  typedef typename Superclass::InputVectorType                        InputVectorType;
+  typedef typename Superclass::OutputVectorType                       OutputVectorType;
+  typedef typename Superclass::InputCovariantVectorType               InputCovariantVectorType;
+  typedef typename Superclass::OutputCovariantVectorType              OutputCovariantVectorType;
+  typedef typename Superclass::InputVnlVectorType                     InputVnlVectorType;
+  typedef typename Superclass::OutputVnlVectorType                    OutputVnlVectorType;
+  typedef typename Superclass::InputPointType                         InputPointType;
+  typedef typename Superclass::OutputPointType                        OutputPointType;
+  typedef typename Superclass::NonZeroJacobianIndicesType             NonZeroJacobianIndicesType;
+  typedef typename Superclass::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename Superclass::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename Superclass::SpatialHessianType                     SpatialHessianType;
+  typedef typename Superclass::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename Superclass::InternalMatrixType                     InternalMatrixType;
+  typedef typename Superclass::InverseTransformBaseType               InverseTransformBaseType;
+  typedef typename Superclass::InverseTransformBasePointer            InverseTransformBasePointer;
+  typedef typename Superclass::TransformCategoryEnum                  TransformCategoryEnum;
+  typedef typename Superclass::MovingImageGradientType                MovingImageGradientType;
+  typedef typename Superclass::MovingImageGradientValueType           MovingImageGradientValueType;
 
   /** Transform typedefs for the from Superclass. */
   typedef typename Superclass::TransformType   TransformType;
@@ -111,6 +119,9 @@ public:
   typedef typename InitialTransformType::InverseTransformBaseType    InitialTransformInverseTransformBaseType;
   typedef typename InitialTransformType::InverseTransformBasePointer InitialTransformInverseTransformBasePointer;
 
+  /** Typedef for the single transform that replaces a flattened linear initial transform. */
+  typedef AdvancedMatrixOffsetTransformBase<TScalarType, NDimensions, NDimensions> FlattenedInitialTransformType;
+
   /** Typedefs for the CurrentTransform. */
   typedef Superclass                                                 CurrentTransformType;
   typedef typename CurrentTransformType::Pointer                     CurrentTransformPointer;
@@ -118,11 +129,43 @@ public:
   typedef typename CurrentTransformType::InverseTransformBaseType    CurrentTransformInverseTransformBaseType;
   typedef typename CurrentTransformType::InverseTransformBasePointer CurrentTransformInverseTransformBasePointer;
 
-  /** Set/Get a pointer to the InitialTransform. */
+  /** Set/Get a pointer to the InitialTransform. The getters return the
+   * transform as it was set, also after FlattenInitialTransform().
+   */
   void
   SetInitialTransform(InitialTransformType * _arg);
 
-  itkGetModifiableObjectMacro(InitialTransform, InitialTransformType);
+  InitialTransformType *
+  GetModifiableInitialTransform(void)
+  {
+    return this->m_UnflattenedInitialTransform.IsNotNull() ? this->m_UnflattenedInitialTransform.GetPointer()
+                                                            : this->m_InitialTransform.GetPointer();
+  }
+
+  const InitialTransformType *
+  GetInitialTransform(void) const
+  {
+    return this->m_UnflattenedInitialTransform.IsNotNull() ? this->m_UnflattenedInitialTransform.GetPointer()
+                                                            : this->m_InitialTransform.GetPointer();
+  }
+
+  /** Replace the evaluation of a linear initial transform by that of a single
+   * matrix-offset transform with the same matrix and offset. Returns false,
+   * and leaves the transform as it is, when the initial transform is absent,
+   * nonlinear, or a matrix-offset transform already.
+   * The flattened transform is a snapshot, so call this method again when the
+   * parameters of the initial transform have changed. SetInitialTransform()
+   * undoes the flattening.
+   */
+  bool
+  FlattenInitialTransform(void);
+
+  /** Whether the initial transform is currently evaluated in flattened form. */
+  bool
+  GetInitialTransformIsFlattened(void) const
+  {
+    return this->m_UnflattenedInitialTransform.IsNotNull();
+  }
 
   /** Set/Get a pointer to the CurrentTransform.
    * Make sure to set the CurrentTransform before calling functions like
@@ -160,6 +203,14 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Method to transform a batch of points. The sub transforms are called
+   * once for the whole batch, instead of once per point.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   /** ITK4 change:
    * The following pure virtual functions must be overloaded.
    * For now just throw an exception, since these are not used in elastix.
@@ -263,6 +314,14 @@ public:
                                            DerivativeType &                imageJacobian,
                                            NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
 
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(). */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override;
@@ -301,6 +360,24 @@ public:
                               JacobianOfSpatialHessianType & jsh,
                               NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const override;
 
+  /** Compute the spatial Jacobian and the Jacobian of the spatial Jacobian in separable form.
+   * Only supported without an initial transform, and if the current transform supports it.
+   */
+  bool
+  GetSeparableJacobianOfSpatialJacobian(const InputPointType &                   ipp,
+                                        SpatialJacobianType &                    sj,
+                                        SeparableJacobianOfSpatialJacobianType & jsj,
+                                        NonZeroJacobianIndicesType &             nonZeroJacobianIndices) const override;
+
+  /** Compute the spatial Hessian and the Jacobian of the spatial Hessian in separable form.
+   * Only supported without an initial transform, and if the current transform supports it.
+   */
+  bool
+  GetSeparableJacobianOfSpatialHessian(const InputPointType &                  ipp,
+                                       SpatialHessianType &                    sh,
+                                       SeparableJacobianOfSpatialHessianType & jsh,
+                                       NonZeroJacobianIndicesType &            nonZeroJacobianIndices) const override;
+
   /** Typedefs for function pointers. */
   typedef OutputPointType (Self::*TransformPointFunctionPointer)(const InputPointType &) const;
   typedef void (Self::*GetSparseJacobianFunctionPointer)(const InputPointType &,
@@ -344,6 +421,11 @@ protected:
   void
   NoCurrentTransformSet(void) const;
 
+  /** The number of points that the batch methods process at once, with stack buffers
+   * for the intermediate points instead of an allocation per call.
+   */
+  static constexpr SizeValueType PointChunkSize = 64;
+
   /** ************************************************
    * Methods to transform a point.
    */
@@ -575,8 +657,12 @@ protected:
                                                 NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const;
 
 private:
-  /** Declaration of members. */
+  /** Declaration of members. The m_InitialTransform is the one that is
+   * evaluated. After FlattenInitialTransform(), it is the flattened transform,
+   * and m_UnflattenedInitialTransform holds the transform as it was set.
+   */
   InitialTransformPointer m_InitialTransform;
+  InitialTransformPointer m_UnflattenedInitialTransform;
   CurrentTransformPointer m_CurrentTransform;
 
   /**  A pointer to one of the following functions:
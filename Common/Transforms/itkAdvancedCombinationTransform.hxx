@@ -20,6 +20,8 @@
 
 #include "itkAdvancedCombinationTransform.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -33,6 +35,7 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::AdvancedCombinationTrans
 {
   /** Initialize. */
   this->m_InitialTransform = nullptr;
+  this->m_UnflattenedInitialTransform = nullptr;
   this->m_CurrentTransform = nullptr;
 
   /** Set composition by default. */
@@ -517,9 +520,10 @@ void
 AdvancedCombinationTransform<TScalarType, NDimensions>::SetInitialTransform(InitialTransformType * _arg)
 {
   /** Set the the initial transform and call the UpdateCombinationMethod. */
-  if (this->m_InitialTransform != _arg)
+  if (this->GetInitialTransform() != _arg || this->m_UnflattenedInitialTransform.IsNotNull())
   {
     this->m_InitialTransform = _arg;
+    this->m_UnflattenedInitialTransform = nullptr;
     this->Modified();
     this->UpdateCombinationMethod();
   }
@@ -527,6 +531,44 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::SetInitialTransform(Init
 } // end SetInitialTransform()
 
 
+/**
+ * ******************* FlattenInitialTransform **********************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+bool
+AdvancedCombinationTransform<TScalarType, NDimensions>::FlattenInitialTransform(void)
+{
+  /** Flatten the transform as it was set, not a previously flattened one. */
+  const InitialTransformPointer initialTransform = this->GetModifiableInitialTransform();
+  if (initialTransform.IsNull() || !initialTransform->IsLinear() ||
+      dynamic_cast<const FlattenedInitialTransformType *>(initialTransform.GetPointer()) != nullptr)
+  {
+    return false;
+  }
+
+  /** A linear transform is determined by its spatial Jacobian (the matrix)
+   * and the image of the origin (the offset).
+   */
+  InputPointType origin;
+  origin.Fill(0.0);
+  SpatialJacobianType matrix;
+  initialTransform->GetSpatialJacobian(origin, matrix);
+
+  const auto flattenedTransform = FlattenedInitialTransformType::New();
+  flattenedTransform->SetMatrix(matrix);
+  flattenedTransform->SetOffset(initialTransform->TransformPoint(origin) - origin);
+
+  this->m_InitialTransform = flattenedTransform.GetPointer();
+  this->m_UnflattenedInitialTransform = initialTransform;
+  this->Modified();
+  this->UpdateCombinationMethod();
+
+  return true;
+
+} // end FlattenInitialTransform()
+
+
 /**
  * ******************* SetCurrentTransform **********************
  */
@@ -1107,16 +1149,17 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialJaco
   JacobianOfSpatialJacobianType & jsj,
   NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
 {
-  SpatialJacobianType           sj0;
-  JacobianOfSpatialJacobianType jsj1;
+  /** Let the current transform fill jsj, and compose it in-place with the
+   * spatial Jacobian of the initial transform. This avoids a temporary
+   * container, which would otherwise be allocated for every sample. */
+  SpatialJacobianType sj0;
   this->m_InitialTransform->GetSpatialJacobian(ipp, sj0);
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint(ipp), jsj1, nonZeroJacobianIndices);
+    this->m_InitialTransform->TransformPoint(ipp), jsj, nonZeroJacobianIndices);
 
-  jsj.resize(nonZeroJacobianIndices.size());
   for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
   {
-    jsj[mu] = jsj1[mu] * sj0;
+    jsj[mu] = jsj[mu] * sj0;
   }
 
 } // end GetJacobianOfSpatialJacobianUseComposition()
@@ -1134,17 +1177,16 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialJaco
   JacobianOfSpatialJacobianType & jsj,
   NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
 {
-  SpatialJacobianType           sj0, sj1;
-  JacobianOfSpatialJacobianType jsj1;
+  /** Compose in-place, see above. */
+  SpatialJacobianType sj0, sj1;
   this->m_InitialTransform->GetSpatialJacobian(ipp, sj0);
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint(ipp), sj1, jsj1, nonZeroJacobianIndices);
+    this->m_InitialTransform->TransformPoint(ipp), sj1, jsj, nonZeroJacobianIndices);
 
   sj = sj1 * sj0;
-  jsj.resize(nonZeroJacobianIndices.size());
   for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
   {
-    jsj[mu] = jsj1[mu] * sj0;
+    jsj[mu] = jsj[mu] * sj0;
   }
 
 } // end GetJacobianOfSpatialJacobianUseComposition()
@@ -1263,10 +1305,8 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
   NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const
 {
   /** Create intermediary variables for the internal transforms. */
-  SpatialJacobianType           sj0;
-  SpatialHessianType            sh0;
-  JacobianOfSpatialJacobianType jsj1;
-  JacobianOfSpatialHessianType  jsh1;
+  SpatialJacobianType sj0;
+  SpatialHessianType  sh0;
 
   /** Transform the input point. */
   // \todo: this has already been computed and it is expensive.
@@ -1277,27 +1317,30 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
   this->m_InitialTransform->GetSpatialJacobian(ipp, sj0);
   this->m_InitialTransform->GetSpatialHessian(ipp, sh0);
 
-  /** Assume/demand that GetJacobianOfSpatialJacobian returns
-   * the same nonZeroJacobianIndices as the GetJacobianOfSpatialHessian. */
-  this->m_CurrentTransform->GetJacobianOfSpatialJacobian(transformedPoint, jsj1, nonZeroJacobianIndices);
-  this->m_CurrentTransform->GetJacobianOfSpatialHessian(transformedPoint, jsh1, nonZeroJacobianIndices);
+  /** The current transform fills jsh, which is then composed in-place. */
+  this->m_CurrentTransform->GetJacobianOfSpatialHessian(transformedPoint, jsh, nonZeroJacobianIndices);
 
   typename SpatialJacobianType::InternalMatrixType sj0tvnl = sj0.GetTranspose();
   SpatialJacobianType                              sj0t(sj0tvnl);
 
-  jsh.resize(nonZeroJacobianIndices.size());
-
   /** Combine them in one overall Jacobian of spatial Hessian. */
   for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
   {
     for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
     {
-      jsh[mu][dim] = sj0t * (jsh1[mu][dim] * sj0);
+      jsh[mu][dim] = sj0t * (jsh[mu][dim] * sj0);
     }
   }
 
+  /** The Jacobian of the spatial Jacobian of the current transform is only
+   * needed, and only computed, when the initial transform is nonlinear.
+   * Assume/demand that GetJacobianOfSpatialJacobian returns the same
+   * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian. */
   if (this->m_InitialTransform->GetHasNonZeroSpatialHessian())
   {
+    JacobianOfSpatialJacobianType jsj1;
+    this->m_CurrentTransform->GetJacobianOfSpatialJacobian(transformedPoint, jsj1, nonZeroJacobianIndices);
+
     for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
     {
       for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
@@ -1326,10 +1369,8 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
   NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const
 {
   /** Create intermediary variables for the internal transforms. */
-  SpatialJacobianType           sj0, sj1;
-  SpatialHessianType            sh0, sh1;
-  JacobianOfSpatialJacobianType jsj1;
-  JacobianOfSpatialHessianType  jsh1;
+  SpatialJacobianType sj0;
+  SpatialHessianType  sh0, sh1;
 
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
@@ -1341,27 +1382,38 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
   this->m_InitialTransform->GetSpatialJacobian(ipp, sj0);
   this->m_InitialTransform->GetSpatialHessian(ipp, sh0);
 
-  /** Assume/demand that GetJacobianOfSpatialJacobian returns the same
-   * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
-   */
-  this->m_CurrentTransform->GetJacobianOfSpatialJacobian(transformedPoint, sj1, jsj1, nonZeroJacobianIndices);
-  this->m_CurrentTransform->GetJacobianOfSpatialHessian(transformedPoint, sh1, jsh1, nonZeroJacobianIndices);
+  /** The current transform fills jsh, which is then composed in-place. */
+  this->m_CurrentTransform->GetJacobianOfSpatialHessian(transformedPoint, sh1, jsh, nonZeroJacobianIndices);
 
   typename SpatialJacobianType::InternalMatrixType sj0tvnl = sj0.GetTranspose();
   SpatialJacobianType                              sj0t(sj0tvnl);
-  jsh.resize(nonZeroJacobianIndices.size());
 
   /** Combine them in one overall Jacobian of spatial Hessian. */
   for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
   {
     for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
     {
-      jsh[mu][dim] = sj0t * (jsh1[mu][dim] * sj0);
+      jsh[mu][dim] = sj0t * (jsh[mu][dim] * sj0);
     }
   }
 
+  /** Combine them in one overall spatial Hessian. */
+  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+  {
+    sh[dim] = sj0t * (sh1[dim] * sj0);
+  }
+
+  /** The (Jacobian of the) spatial Jacobian of the current transform is only
+   * needed, and only computed, when the initial transform is nonlinear.
+   * Assume/demand that GetJacobianOfSpatialJacobian returns the same
+   * nonZeroJacobianIndices as the GetJacobianOfSpatialHessian.
+   */
   if (this->m_InitialTransform->GetHasNonZeroSpatialHessian())
   {
+    SpatialJacobianType           sj1;
+    JacobianOfSpatialJacobianType jsj1;
+    this->m_CurrentTransform->GetJacobianOfSpatialJacobian(transformedPoint, sj1, jsj1, nonZeroJacobianIndices);
+
     for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
     {
       for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
@@ -1372,16 +1424,7 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
         }
       }
     }
-  }
 
-  /** Combine them in one overall spatial Hessian. */
-  for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
-  {
-    sh[dim] = sj0t * (sh1[dim] * sj0);
-  }
-
-  if (this->m_InitialTransform->GetHasNonZeroSpatialHessian())
-  {
     for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
     {
       for (unsigned int p = 0; p < SpaceDimension; ++p)
@@ -1485,6 +1528,57 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::TransformPoint(const Inp
 } // end TransformPoint()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>::TransformPoints(const InputPointType * inputPoints,
+                                                                        OutputPointType *      outputPoints,
+                                                                        const SizeValueType    numberOfPoints) const
+{
+  if (this->m_CurrentTransform.IsNull())
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if (this->m_InitialTransform.IsNull())
+  {
+    this->m_CurrentTransform->TransformPoints(inputPoints, outputPoints, numberOfPoints);
+  }
+  else if (this->m_UseAddition)
+  {
+    /** Process the points in chunks that fit in stack buffers. The input points are
+     * copied, in case the output overwrites them.
+     */
+    OutputPointType initialPoints[PointChunkSize];
+    InputPointType  points[PointChunkSize];
+    for (SizeValueType begin = 0; begin < numberOfPoints; begin += PointChunkSize)
+    {
+      const SizeValueType remaining = numberOfPoints - begin;
+      const SizeValueType size = remaining < PointChunkSize ? remaining : PointChunkSize;
+      std::copy_n(inputPoints + begin, size, points);
+      this->m_InitialTransform->TransformPoints(points, initialPoints, size);
+      this->m_CurrentTransform->TransformPoints(points, outputPoints + begin, size);
+      for (SizeValueType p = 0; p < size; ++p)
+      {
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          outputPoints[begin + p][i] += (initialPoints[p][i] - points[p][i]);
+        }
+      }
+    }
+  }
+  else
+  {
+    /** Composition: the current transform works in place on the initially transformed points. */
+    this->m_InitialTransform->TransformPoints(inputPoints, outputPoints, numberOfPoints);
+    this->m_CurrentTransform->TransformPoints(outputPoints, outputPoints, numberOfPoints);
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ****************** GetJacobian ****************************
  */
@@ -1521,6 +1615,50 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::EvaluateJacobianWithImag
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ****************** EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+void
+AdvancedCombinationTransform<TScalarType, NDimensions>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  if (this->m_CurrentTransform.IsNull())
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if (this->m_InitialTransform.IsNull() || this->m_UseAddition)
+  {
+    this->m_CurrentTransform->EvaluateJacobianWithImageGradientProducts(
+      ipp, movingImageGradients, imageJacobians, nonZeroJacobianIndices, numberOfPoints);
+  }
+  else
+  {
+    /** Composition: evaluate the current transform at the initially transformed points,
+     * in chunks that fit in a stack buffer.
+     */
+    InputPointType initialPoints[PointChunkSize];
+    for (SizeValueType begin = 0; begin < numberOfPoints; begin += PointChunkSize)
+    {
+      const SizeValueType remaining = numberOfPoints - begin;
+      const SizeValueType size = remaining < PointChunkSize ? remaining : PointChunkSize;
+      this->m_InitialTransform->TransformPoints(ipp + begin, initialPoints, size);
+      this->m_CurrentTransform->EvaluateJacobianWithImageGradientProducts(initialPoints,
+                                                                          movingImageGradients + begin,
+                                                                          imageJacobians + begin,
+                                                                          nonZeroJacobianIndices + begin,
+                                                                          size);
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ****************** GetSpatialJacobian ****************************
  */
@@ -1621,6 +1759,52 @@ AdvancedCombinationTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHess
 } // end GetJacobianOfSpatialHessian()
 
 
+/**
+ * ****************** GetSeparableJacobianOfSpatialJacobian ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+bool
+AdvancedCombinationTransform<TScalarType, NDimensions>::GetSeparableJacobianOfSpatialJacobian(
+  const InputPointType &                   ipp,
+  SpatialJacobianType &                    sj,
+  SeparableJacobianOfSpatialJacobianType & jsj,
+  NonZeroJacobianIndicesType &             nonZeroJacobianIndices) const
+{
+  /** The separable form is only passed on when there is no initial transform,
+   * because composition with an initial transform mixes the output dimensions.
+   */
+  if (this->m_InitialTransform.IsNotNull() || this->m_CurrentTransform.IsNull())
+  {
+    return false;
+  }
+  return this->m_CurrentTransform->GetSeparableJacobianOfSpatialJacobian(ipp, sj, jsj, nonZeroJacobianIndices);
+
+} // end GetSeparableJacobianOfSpatialJacobian()
+
+
+/**
+ * ****************** GetSeparableJacobianOfSpatialHessian ****************************
+ */
+
+template <typename TScalarType, unsigned int NDimensions>
+bool
+AdvancedCombinationTransform<TScalarType, NDimensions>::GetSeparableJacobianOfSpatialHessian(
+  const InputPointType &                  ipp,
+  SpatialHessianType &                    sh,
+  SeparableJacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType &            nonZeroJacobianIndices) const
+{
+  /** See GetSeparableJacobianOfSpatialJacobian(). */
+  if (this->m_InitialTransform.IsNotNull() || this->m_CurrentTransform.IsNull())
+  {
+    return false;
+  }
+  return this->m_CurrentTransform->GetSeparableJacobianOfSpatialHessian(ipp, sh, jsh, nonZeroJacobianIndices);
+
+} // end GetSeparableJacobianOfSpatialHessian()
+
+
 } // end namespace itk
 
 #endif // end #ifndef itkAdvancedCombinationTransform_hxx
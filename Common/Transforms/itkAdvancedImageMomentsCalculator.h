@@ -30,7 +30,7 @@
 #include "vnl/vnl_matrix_fixed.h"
 #include "vnl/vnl_diag_matrix.h"
 
-#include "itkPlatformMultiThreader.h"
+#include "itkParallelTasks.h"
 
 namespace itk
 {
@@ -222,7 +222,7 @@ public:
   void
   SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
   {
-    this->m_Threader->SetNumberOfWorkUnits(numberOfThreads);
+    this->m_NumberOfWorkUnits = numberOfThreads;
   }
 
   virtual void
@@ -255,9 +255,8 @@ protected:
   PrintSelf(std::ostream & os, Indent indent) const override;
 
   /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader ThreaderType;
-  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
-  ThreaderType::Pointer              m_Threader;
+  typedef ParallelTasks::WorkUnitInfoType ThreadInfoType;
+  ThreadIdType                            m_NumberOfWorkUnits;
 
   /** Launch MultiThread Compute. */
   void
@@ -308,6 +307,20 @@ protected:
   ImageSampleContainerPointer m_SampleContainer;
 
 private:
+  /** The weight of a pixel value: the value itself, or 1 when it is not below
+   * the lower threshold and 0 otherwise, if CenterOfGravityUsesLowerThreshold.
+   * This equals the weights of a binary threshold filter, without computing its output image.
+   */
+  double
+  GetWeight(const double value) const
+  {
+    if (this->m_CenterOfGravityUsesLowerThreshold)
+    {
+      return value >= static_cast<double>(this->m_LowerThresholdForCenterGravity) ? 1.0 : 0.0;
+    }
+    return value;
+  }
+
   /** Internal helper function. Does post processing at the end of
    * ComputeSingleThreaded() and AfterThreadedCompute() */
   void
@@ -45,7 +45,7 @@ AdvancedImageMomentsCalculator<TImage>::AdvancedImageMomentsCalculator(void)
 
   /** Threading related variables. */
   this->m_UseMultiThread = true;
-  this->m_Threader = ThreaderType::New();
+  this->m_NumberOfWorkUnits = ParallelTasks::GetNumberOfWorkUnits();
 
   /** Initialize the m_ThreaderParameters. */
   this->m_ThreaderParameters.st_Self = this;
@@ -83,7 +83,7 @@ AdvancedImageMomentsCalculator<TImage>::InitializeThreadingParameters(void)
    * each iteration, in the accumulate functions, in a multi-threaded fashion.
    * This has performance benefits for larger vector sizes.
    */
-  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  const ThreadIdType numberOfThreads = this->m_NumberOfWorkUnits;
 
   /** Only resize the array of structs when needed. */
   if (this->m_ComputePerThreadVariablesSize != numberOfThreads)
@@ -112,17 +112,6 @@ template <typename TImage>
 void
 AdvancedImageMomentsCalculator<TImage>::ComputeSingleThreaded()
 {
-  if (this->m_CenterOfGravityUsesLowerThreshold)
-  {
-    typename BinaryThresholdImageFilterType::Pointer thresholdFilter = BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(this->m_Image);
-    thresholdFilter->SetLowerThreshold(this->m_LowerThresholdForCenterGravity);
-    thresholdFilter->SetInsideValue(1);
-    thresholdFilter->SetOutsideValue(0);
-    thresholdFilter->Update();
-    this->SetImage(thresholdFilter->GetOutput());
-  }
-
   m_M0 = NumericTraits<ScalarType>::ZeroValue();
   m_M1.Fill(NumericTraits<typename VectorType::ValueType>::ZeroValue());
   m_M2.Fill(NumericTraits<typename MatrixType::ValueType>::ZeroValue());
@@ -140,7 +129,7 @@ AdvancedImageMomentsCalculator<TImage>::ComputeSingleThreaded()
 
   while (!it.IsAtEnd())
   {
-    double value = it.Value();
+    const double value = this->GetWeight(it.Value());
 
     IndexType indexPosition = it.GetIndex();
 
@@ -221,17 +210,7 @@ AdvancedImageMomentsCalculator<TImage>::BeforeThreadedCompute()
     return;
   }
 
-  if (this->m_CenterOfGravityUsesLowerThreshold)
-  {
-    typename BinaryThresholdImageFilterType::Pointer thresholdFilter = BinaryThresholdImageFilterType::New();
-    thresholdFilter->SetInput(this->m_Image);
-    thresholdFilter->SetLowerThreshold(this->m_LowerThresholdForCenterGravity);
-    thresholdFilter->SetInsideValue(1);
-    thresholdFilter->SetOutsideValue(0);
-    thresholdFilter->Update();
-    this->SetImage(thresholdFilter->GetOutput());
-  }
-
+  /** The lower threshold is applied to the sample values by the threads. */
   this->SampleImage(this->m_SampleContainer);
 } // end BeforeThreadedCompute()
 
@@ -243,12 +222,9 @@ template <typename TImage>
 void
 AdvancedImageMomentsCalculator<TImage>::LaunchComputeThreaderCallback(void) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(this->ComputeThreaderCallback,
-                                    const_cast<void *>(static_cast<const void *>(&this->m_ThreaderParameters)));
-
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  ParallelTasks::Execute(this->m_NumberOfWorkUnits,
+                         this->ComputeThreaderCallback,
+                         const_cast<void *>(static_cast<const void *>(&this->m_ThreaderParameters)));
 
 } // end LaunchComputeThreaderCallback()
 
@@ -295,7 +271,7 @@ AdvancedImageMomentsCalculator<TImage>::ThreadedCompute(ThreadIdType threadId)
 
   /** Get sample container size, number of threads, and output space dimension. */
   const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
-  const ThreadIdType  numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  const ThreadIdType  numberOfThreads = this->m_NumberOfWorkUnits;
 
   /** Get the samples for this thread. */
   const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
@@ -314,28 +290,45 @@ AdvancedImageMomentsCalculator<TImage>::ThreadedCompute(ThreadIdType threadId)
   threader_fbegin += (int)pos_begin;
   threader_fend += (int)pos_end;
 
+  /** Only the upper triangles of the second order moments are accumulated. */
+  const ImageType * image = this->m_Image.GetPointer();
   for (threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
   {
-    double value = (*threader_fiter).Value().m_ImageValue;
-    // IndexType indexPosition = (*threader_fiter).GetIndex();
-    Point<double, ImageDimension> physicalPosition = (*threader_fiter).Value().m_ImageCoordinates;
+    const Point<double, ImageDimension> & physicalPosition = (*threader_fiter).Value().m_ImageCoordinates;
 
     if (m_SpatialObjectMask.IsNull() || m_SpatialObjectMask->IsInsideInWorldSpace(physicalPosition))
     {
-      M0 += value;
+      const double value = this->GetWeight((*threader_fiter).Value().m_ImageValue);
+      ContinuousIndex<double, ImageDimension> indexPosition;
+      image->TransformPhysicalPointToContinuousIndex(physicalPosition, indexPosition);
 
+      M0 += value;
       for (unsigned int i = 0; i < ImageDimension; ++i)
       {
-        Cg[i] += physicalPosition[i] * value;
-        for (unsigned int j = 0; j < ImageDimension; ++j)
+        const double weightedIndex = value * indexPosition[i];
+        const double weightedPosition = value * physicalPosition[i];
+        M1[i] += weightedIndex;
+        Cg[i] += weightedPosition;
+        for (unsigned int j = i; j < ImageDimension; ++j)
         {
-          double weight = value * physicalPosition[i] * physicalPosition[j];
-          Cm[i][j] += weight;
+          M2[i][j] += weightedIndex * indexPosition[j];
+          Cm[i][j] += weightedPosition * physicalPosition[j];
         }
       }
       numberOfPixelsCounted++;
     }
   }
+
+  /** Fill the lower triangles. */
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    for (unsigned int j = 0; j < i; ++j)
+    {
+      M2[i][j] = M2[j][i];
+      Cm[i][j] = Cm[j][i];
+    }
+  }
+
   /** Update the thread struct once. */
   this->m_ComputePerThreadVariables[threadId].st_M0 = M0;
   this->m_ComputePerThreadVariables[threadId].st_M1 = M1;
@@ -354,11 +347,13 @@ template <typename TImage>
 void
 AdvancedImageMomentsCalculator<TImage>::AfterThreadedCompute()
 {
-  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+  const ThreadIdType numberOfThreads = this->m_NumberOfWorkUnits;
   /** Accumulate thread results. */
+  this->m_NumberOfPixelsCounted = 0;
   for (ThreadIdType k = 0; k < numberOfThreads; ++k)
   {
     this->m_M0 += this->m_ComputePerThreadVariables[k].st_M0;
+    this->m_NumberOfPixelsCounted += this->m_ComputePerThreadVariables[k].st_NumberOfPixelsCounted;
     for (unsigned int i = 0; i < ImageDimension; ++i)
     {
       this->m_M1[i] += this->m_ComputePerThreadVariables[k].st_M1[i];
@@ -137,6 +137,8 @@ public:
   typedef typename Superclass::SpatialHessianType            SpatialHessianType;
   typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType            InternalMatrixType;
+  typedef typename Superclass::DerivativeType                DerivativeType;
+  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
 
   /** Standard matrix type for this class. */
   typedef Matrix<TScalarType, itkGetStaticConstMacro(OutputSpaceDimension), itkGetStaticConstMacro(InputSpaceDimension)>
@@ -347,6 +349,12 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Transform a batch of points, without a virtual call per point. */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   OutputVectorType
   TransformVector(const InputVectorType & vector) const override;
 
@@ -408,6 +416,19 @@ public:
   void
   GetJacobian(const InputPointType &, JacobianType &, NonZeroJacobianIndicesType &) const override;
 
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(). The Jacobian of any
+   * matrix-offset transform is affine in the input point, so GetJacobian() is only evaluated
+   * NInputDimensions + 1 times per batch, and the products are computed from those, without
+   * a Jacobian matrix per point. This also holds for the derived transforms, such as the
+   * Euler, similarity and versor transforms.
+   */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void
   GetSpatialJacobian(const InputPointType &, SpatialJacobianType &) const override;
@@ -39,6 +39,9 @@
 #include "itkAdvancedMatrixOffsetTransformBase.h"
 #include "vnl/algo/vnl_matrix_inverse.h"
 
+#include <algorithm> // For copy_n and fill_n.
+#include <vector>
+
 namespace itk
 {
 
@@ -252,6 +255,21 @@ AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensio
 }
 
 
+// Transform a batch of points
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    outputPoints[i] = m_Matrix * inputPoints[i] + m_Offset;
+  }
+}
+
+
 // Transform a vector
 template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
 typename AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>::OutputVectorType
@@ -556,6 +574,87 @@ AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensio
 } // end GetJacobian()
 
 
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+AdvancedMatrixOffsetTransformBase<TScalarType, NInputDimensions, NOutputDimensions>::
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const
+{
+  if (numberOfPoints == 0)
+  {
+    return;
+  }
+
+  /** With v = p - c, the Jacobian is J(p) = J(c) + sum_d v[d] ( J(c + e_d) - J(c) ).
+   * The (virtual) GetJacobian() of the actual transform type gives these terms. They are
+   * stored as rows of length numberOfParameters: row (d * NOutputDimensions + i) is row i
+   * of the d-th term, where the term d = NInputDimensions is J(c).
+   */
+  const InputPointType       center = this->GetCenter();
+  JacobianType               jacobian;
+  NonZeroJacobianIndicesType nzji;
+  this->GetJacobian(center, jacobian, nzji);
+  const unsigned int numberOfParameters = jacobian.cols();
+
+  std::vector<double> rows((NInputDimensions + 1) * NOutputDimensions * numberOfParameters);
+  double *            centerRows = rows.data() + NInputDimensions * NOutputDimensions * numberOfParameters;
+  for (unsigned int i = 0; i < NOutputDimensions; ++i)
+  {
+    std::copy_n(jacobian[i], numberOfParameters, centerRows + i * numberOfParameters);
+  }
+  for (unsigned int d = 0; d < NInputDimensions; ++d)
+  {
+    InputPointType point = center;
+    point[d] += 1.0;
+    this->GetJacobian(point, jacobian, nzji);
+    double * slopeRows = rows.data() + d * NOutputDimensions * numberOfParameters;
+    for (unsigned int i = 0; i < NOutputDimensions; ++i)
+    {
+      for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
+      {
+        slopeRows[i * numberOfParameters + mu] = jacobian[i][mu] - centerRows[i * numberOfParameters + mu];
+      }
+    }
+  }
+
+  /** The product of each point is a weighted sum of these rows, with the weights
+   * g[i] v[d] and g[i]. The inner loops are contiguous, so the compiler can vectorize them.
+   */
+  for (SizeValueType p = 0; p < numberOfPoints; ++p)
+  {
+    const InputVectorType           v = ipp[p] - center;
+    const MovingImageGradientType & g = movingImageGradients[p];
+    double *                        imageJacobian = imageJacobians[p].data_block();
+
+    std::fill_n(imageJacobian, numberOfParameters, 0.0);
+    for (unsigned int d = 0; d <= NInputDimensions; ++d)
+    {
+      const double   vd = (d < NInputDimensions) ? static_cast<double>(v[d]) : 1.0;
+      const double * termRows = rows.data() + d * NOutputDimensions * numberOfParameters;
+      for (unsigned int i = 0; i < NOutputDimensions; ++i)
+      {
+        const double   weight = vd * static_cast<double>(g[i]);
+        const double * row = termRows + i * numberOfParameters;
+        for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
+        {
+          imageJacobian[mu] += weight * row[mu];
+        }
+      }
+    }
+
+    nonZeroJacobianIndices[p] = nzji;
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
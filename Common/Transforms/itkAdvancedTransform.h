@@ -137,6 +137,12 @@ public:
   typedef std::vector<SpatialHessianType>                  JacobianOfSpatialHessianType;
   typedef typename SpatialJacobianType::InternalMatrixType InternalMatrixType;
 
+  /** Types for the separable form of the Jacobian of the spatial Jacobian/Hessian,
+   * see GetSeparableJacobianOfSpatialJacobian() and GetSeparableJacobianOfSpatialHessian().
+   */
+  typedef std::vector<InputVectorType>                         SeparableJacobianOfSpatialJacobianType;
+  typedef std::vector<typename SpatialHessianType::ValueType> SeparableJacobianOfSpatialHessianType;
+
   /** Typedef for the moving image gradient type.
    * This type is defined by the B-spline interpolator as
    * typedef CovariantVector< RealType, ImageDimension >
@@ -193,6 +199,29 @@ public:
                                            DerivativeType &                imageJacobian,
                                            NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const;
 
+  /** Transform a batch of points: outputPoints[i] = T( inputPoints[i] ), for
+   * i = 0 .. numberOfPoints - 1. The input and the output array may be the
+   * same array. The default implementation calls TransformPoint() for each
+   * point. Derived classes override it to pay the virtual dispatch only once
+   * per batch, instead of once per point.
+   */
+  virtual void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const;
+
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(): compute the
+   * inner product of the Jacobian at ipp[i] with movingImageGradients[i],
+   * for i = 0 .. numberOfPoints - 1. Each imageJacobians[i] should have the
+   * size GetNumberOfNonZeroJacobianIndices().
+   */
+  virtual void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const;
+
   /** Compute the spatial Jacobian of the transformation.
    *
    * The spatial Jacobian is expressed as a vector of partial derivatives of the
@@ -290,6 +319,45 @@ public:
                               JacobianOfSpatialHessianType & jsh,
                               NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const = 0;
 
+  /** Compute the spatial Jacobian and the Jacobian of the spatial Jacobian in separable form.
+   *
+   * For transforms like the B-spline transform, every parameter moves a single output
+   * dimension k, with a scalar weight. The n x OutputSpaceDimension matrices of the dense
+   * Jacobian of the spatial Jacobian are then zero, except for row k of matrix mu + k * n,
+   * which is the same for all k. This function returns only these n rows, as jsj[mu],
+   * with n the number of weights, and the same nonzero Jacobian indices as the dense form.
+   * This saves a factor OutputSpaceDimension squared of storage and memory traffic.
+   *
+   * Returns false, without computing anything, if the transform does not support the
+   * separable form, in which case GetJacobianOfSpatialJacobian() should be used.
+   */
+  virtual bool
+  GetSeparableJacobianOfSpatialJacobian(const InputPointType &,
+                                        SpatialJacobianType &,
+                                        SeparableJacobianOfSpatialJacobianType &,
+                                        NonZeroJacobianIndicesType &) const
+  {
+    return false;
+  }
+
+  /** Compute the spatial Hessian and the Jacobian of the spatial Hessian in separable form.
+   *
+   * Analogous to GetSeparableJacobianOfSpatialJacobian(): jsh[mu] equals component k
+   * of the dense jsh[mu + k * n], which is the same for all k, while the other
+   * components of the dense form are zero.
+   *
+   * Returns false, without computing anything, if the transform does not support the
+   * separable form, in which case GetJacobianOfSpatialHessian() should be used.
+   */
+  virtual bool
+  GetSeparableJacobianOfSpatialHessian(const InputPointType &,
+                                       SpatialHessianType &,
+                                       SeparableJacobianOfSpatialHessianType &,
+                                       NonZeroJacobianIndicesType &) const
+  {
+    return false;
+  }
+
 protected:
   AdvancedTransform();
   AdvancedTransform(NumberOfParametersType numberOfParameters);
@@ -55,6 +55,7 @@ BSplineInterpolationDerivativeWeightFunction<TCoordRep, VSpaceDimension, VSpline
     if (dir < SpaceDimension)
     {
       this->m_DerivativeDirection = dir;
+      this->BuildGridAlignedWeightsTable();
 
       this->Modified();
     }
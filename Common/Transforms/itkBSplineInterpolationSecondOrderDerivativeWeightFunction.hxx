@@ -67,6 +67,8 @@ BSplineInterpolationSecondOrderDerivativeWeightFunction<TCoordRep, VSpaceDimensi
         this->m_EqualDerivativeDirections = true;
       }
 
+      this->BuildGridAlignedWeightsTable();
+
       this->Modified();
     }
   }
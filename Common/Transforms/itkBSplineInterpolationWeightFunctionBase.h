@@ -26,6 +26,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include <vector>
 
 namespace itk
 {
@@ -122,6 +123,17 @@ public:
   /** Get number of weights. */
   itkGetConstMacro(NumberOfWeights, unsigned long);
 
+  /** Set the size n of a table of the 1D weights at the fractions k / n, k = 0, ..., n - 1,
+   * of a grid cell. In each dimension where a position lies on such a fraction, for example
+   * for the voxels of an image that is aligned with the B-spline grid and whose spacing is the
+   * grid spacing divided by a divisor of n, the weights are copied from the table instead of
+   * evaluating the kernels. A size of 0 disables the table. Building the table is not
+   * thread-safe, so set it before evaluating the weights concurrently. Default: 0.
+   */
+  void
+  SetGridAlignedWeightsTableSize(unsigned int size);
+  itkGetConstMacro(GridAlignedWeightsTableSize, unsigned int);
+
 protected:
   BSplineInterpolationWeightFunctionBase();
   ~BSplineInterpolationWeightFunctionBase() override = default;
@@ -151,6 +163,16 @@ protected:
                    const IndexType &           startIndex,
                    OneDWeightsType &           weights1D) const = 0;
 
+  /** Compute the 1D weights, using the grid aligned weights table when possible. */
+  void
+  Compute1DWeightsUsingTable(const ContinuousIndexType & index,
+                             const IndexType &           startIndex,
+                             OneDWeightsType &           weights1D) const;
+
+  /** (Re)build the grid aligned weights table, needed when Compute1DWeights() changes. */
+  void
+  BuildGridAlignedWeightsTable(void);
+
   /** Print the member variables. */
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
@@ -180,6 +202,12 @@ private:
    */
   void
   InitializeOffsetToIndexTable(void);
+
+  /** The grid aligned weights table: entry k holds the 1D weights of all dimensions
+   * at a fraction k / m_GridAlignedWeightsTableSize of a grid cell.
+   */
+  unsigned int                 m_GridAlignedWeightsTableSize;
+  std::vector<OneDWeightsType> m_GridAlignedWeightsTable;
 };
 
 } // end namespace itk
@@ -37,6 +37,7 @@ BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>
   /** Initialize members. */
   this->InitializeSupport();
   this->InitializeOffsetToIndexTable();
+  this->m_GridAlignedWeightsTableSize = 0;
 
 } // end Constructor
 
@@ -116,6 +117,7 @@ BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>
   os << indent << "Kernel: " << this->m_Kernel.GetPointer() << std::endl;
   os << indent << "DerivativeKernel: " << this->m_DerivativeKernel.GetPointer() << std::endl;
   os << indent << "SecondOrderDerivativeKernel: " << this->m_SecondOrderDerivativeKernel.GetPointer() << std::endl;
+  os << indent << "GridAlignedWeightsTableSize: " << this->m_GridAlignedWeightsTableSize << std::endl;
 
 } // end PrintSelf()
 
@@ -182,7 +184,7 @@ BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>
 
   /** Compute the 1D weights. */
   OneDWeightsType weights1D;
-  this->Compute1DWeights(cindex, startIndex, weights1D);
+  this->Compute1DWeightsUsingTable(cindex, startIndex, weights1D);
 
   /** Compute the vector of weights. */
   for (unsigned int k = 0; k < this->m_NumberOfWeights; ++k)
@@ -199,6 +201,100 @@ BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>
 } // end Evaluate()
 
 
+/**
+ * ******************* SetGridAlignedWeightsTableSize *******************
+ */
+
+template <class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>::SetGridAlignedWeightsTableSize(
+  unsigned int size)
+{
+  if (size != this->m_GridAlignedWeightsTableSize)
+  {
+    this->m_GridAlignedWeightsTableSize = size;
+    this->BuildGridAlignedWeightsTable();
+    this->Modified();
+  }
+
+} // end SetGridAlignedWeightsTableSize()
+
+
+/**
+ * ******************* BuildGridAlignedWeightsTable *******************
+ */
+
+template <class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>::BuildGridAlignedWeightsTable(void)
+{
+  /** The start index of a position p is floor( p - ( SplineOrder - 1 ) / 2 ),
+   * so with a zero start index, entry k is at p = ( SplineOrder - 1 ) / 2 + k / n.
+   */
+  const unsigned int tableSize = this->m_GridAlignedWeightsTableSize;
+  this->m_GridAlignedWeightsTable.resize(tableSize);
+
+  IndexType startIndex;
+  startIndex.Fill(0);
+  ContinuousIndexType cindex;
+  for (unsigned int k = 0; k < tableSize; ++k)
+  {
+    cindex.Fill((static_cast<double>(SplineOrder) - 1.0) / 2.0 + static_cast<double>(k) / tableSize);
+    this->Compute1DWeights(cindex, startIndex, this->m_GridAlignedWeightsTable[k]);
+  }
+
+} // end BuildGridAlignedWeightsTable()
+
+
+/**
+ * ******************* Compute1DWeightsUsingTable *******************
+ */
+
+template <class TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+BSplineInterpolationWeightFunctionBase<TCoordRep, VSpaceDimension, VSplineOrder>::Compute1DWeightsUsingTable(
+  const ContinuousIndexType & cindex,
+  const IndexType &           startIndex,
+  OneDWeightsType &           weights1D) const
+{
+  const unsigned int tableSize = this->m_GridAlignedWeightsTableSize;
+  if (tableSize == 0)
+  {
+    this->Compute1DWeights(cindex, startIndex, weights1D);
+    return;
+  }
+
+  /** Find the table entry of each dimension. They must all be present, since
+   * Compute1DWeights() computes all dimensions at once.
+   */
+  unsigned int entries[SpaceDimension];
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    const double fraction =
+      cindex[i] - static_cast<double>(startIndex[i]) - (static_cast<double>(SplineOrder) - 1.0) / 2.0;
+    const double position = fraction * tableSize;
+    const double entry = std::floor(position + 0.5);
+    if (std::abs(position - entry) > 1e-9 * tableSize || entry < 0.0 || entry >= tableSize)
+    {
+      this->Compute1DWeights(cindex, startIndex, weights1D);
+      return;
+    }
+    entries[i] = static_cast<unsigned int>(entry);
+  }
+
+  /** Copy the 1D weights of each dimension from the table. */
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    const OneDWeightsType & tabulated = this->m_GridAlignedWeightsTable[entries[i]];
+    for (unsigned int k = 0; k <= SplineOrder; ++k)
+    {
+      weights1D[i][k] = tabulated[i][k];
+    }
+  }
+
+} // end Compute1DWeightsUsingTable()
+
+
 } // end namespace itk
 
 #endif
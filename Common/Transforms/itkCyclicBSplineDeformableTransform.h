@@ -26,6 +26,9 @@
 #include "itkBSplineInterpolationSecondOrderDerivativeWeightFunction.h"
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkCyclicBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineInterpolationWeightFunction.h"
+
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +38,12 @@ namespace itk
  * \brief Deformable transform using a B-spline representation in which the
  *   B-spline grid is formulated in a cyclic way.
  *
+ * The last dimension of the grid wraps around. TransformPoint(), GetJacobian() and
+ * EvaluateJacobianWithImageGradientProduct() use the recursive implementation of the
+ * RecursiveBSplineTransform for the other dimensions, once per slice of the support region
+ * in the last dimension. The offsets of these slices are taken from a table that is
+ * periodically padded with SplineOrder slices, so that the inner loops need no wrapping.
+ *
  * \ingroup Transforms
  */
 template <class TScalarType = double,   // Data type for scalars
@@ -71,7 +80,10 @@ public:
   typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType            InternalMatrixType;
   typedef typename Superclass::ParametersType                ParametersType;
+  typedef typename Superclass::ParametersValueType           ParametersValueType;
   typedef typename Superclass::NumberOfParametersType        NumberOfParametersType;
+  typedef typename Superclass::DerivativeType                DerivativeType;
+  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
 
   /** Parameters as SpaceDimension number of images. */
   typedef typename ParametersType::ValueType                       PixelType;
@@ -85,6 +97,7 @@ public:
   typedef typename ImageType::DirectionType            DirectionType;
   typedef typename ImageType::PointType                OriginType;
   typedef typename RegionType::IndexType               GridOffsetType;
+  typedef typename GridOffsetType::OffsetValueType     OffsetValueType;
   typedef typename Superclass::InputPointType          InputPointType;
   typedef typename Superclass::OutputPointType         OutputPointType;
   typedef typename Superclass::WeightsType             WeightsType;
@@ -99,6 +112,10 @@ public:
                                               itkGetStaticConstMacro(SplineOrder)>
                                                                RedWeightsFunctionType;
   typedef typename RedWeightsFunctionType::ContinuousIndexType RedContinuousIndexType;
+  typedef RecursiveBSplineInterpolationWeightFunction<ScalarType,
+                                                      itkGetStaticConstMacro(SpaceDimension),
+                                                      itkGetStaticConstMacro(SplineOrder)>
+    RecursiveBSplineWeightFunctionType;
 
   /** This method specifies the region over which the grid resides. */
   void
@@ -118,10 +135,47 @@ public:
                  ParameterIndexArrayType & indices,
                  bool &                    inside) const override;
 
+  /** Transform a point, using the recursive implementation. */
+  OutputPointType
+  TransformPoint(const InputPointType & point) const override;
+
+  /** Transform a batch of points, without a virtual call per point. */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
+  /** Also tabulate the weights of the recursive weight function, see the superclass. */
+  void
+  SetGridAlignedWeightsTableSize(unsigned int size) override;
+
   /** Compute the Jacobian of the transformation. */
   virtual void
   GetJacobian(const InputPointType & ipp, WeightsType & weights, ParameterIndexArrayType & indices) const;
 
+  /** Compute the Jacobian of the transformation, using the recursive implementation. */
+  void
+  GetJacobian(const InputPointType &       ipp,
+              JacobianType &               j,
+              NonZeroJacobianIndicesType & nonZeroJacobianIndices) const override;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient.
+   * The Jacobian is (partially) constructed inside this function, but not returned.
+   */
+  void
+  EvaluateJacobianWithImageGradientProduct(const InputPointType &          ipp,
+                                           const MovingImageGradientType & movingImageGradient,
+                                           DerivativeType &                imageJacobian,
+                                           NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
+
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(), without a virtual call per point. */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override;
@@ -145,10 +199,35 @@ protected:
               RegionType &       outRegion1,
               RegionType &       outRegion2) const;
 
+  /** Returns the offset of the support region in the coefficient images, in all but the last
+   * dimension, and lets sliceOffsets point to the SplineOrder + 1 offsets of its slices in the
+   * last dimension, wrapped around.
+   */
+  OffsetValueType
+  GetCyclicSupportOffsets(const IndexType & supportIndex, const OffsetValueType *& sliceOffsets) const;
+
+  typename RecursiveBSplineWeightFunctionType::Pointer m_RecursiveBSplineWeightFunction;
+
 private:
   CyclicBSplineDeformableTransform(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  /** Computes the displacement in all but the last dimension, from the coefficients of
+   * each dimension, which are either the coefficient images or their single precision copy.
+   */
+  template <class TCoefficient>
+  void
+  ComputeDisplacement(TCoefficient * const * const coefficients,
+                      const OffsetValueType        supportOffset,
+                      const OffsetValueType *      sliceOffsets,
+                      const double *               weights1D,
+                      ScalarType *                 displacement) const;
+
+  /** The offsets of the slices of the grid in the last dimension, in the order of the grid
+   * followed by its first SplineOrder slices again.
+   */
+  std::vector<OffsetValueType> m_CyclicSliceOffsetTable;
 };
 
 } // namespace itk
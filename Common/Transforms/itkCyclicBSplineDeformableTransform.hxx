@@ -21,6 +21,7 @@
 #include "itkCyclicBSplineDeformableTransform.h"
 #include "itkContinuousIndex.h"
 #include "itkImageRegionIterator.h"
+#include "itkRecursiveBSplineTransformImplementation.h"
 
 namespace itk
 {
@@ -29,7 +30,9 @@ namespace itk
 template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
 CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::CyclicBSplineDeformableTransform()
   : Superclass()
-{}
+{
+  this->m_RecursiveBSplineWeightFunction = RecursiveBSplineWeightFunctionType::New();
+}
 
 /** Destructor. */
 template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
@@ -53,6 +56,51 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::SetGri
                                          << ") is larger than the "
                                          << "number of grid points in the last dimension (" << lastDimSize << ").");
   }
+
+  /** Tabulate the offsets of the slices in the last dimension, padded periodically,
+   * so that the slices of any support region are consecutive entries of the table.
+   */
+  const OffsetValueType sliceOffset = this->m_GridOffsetTable[lastDim];
+  this->m_CyclicSliceOffsetTable.resize(lastDimSize + SplineOrder);
+  for (int i = 0; i < lastDimSize + static_cast<int>(SplineOrder); ++i)
+  {
+    this->m_CyclicSliceOffsetTable[i] = (i % lastDimSize) * sliceOffset;
+  }
+}
+
+
+/** Set the size of the grid aligned weights tables. */
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::SetGridAlignedWeightsTableSize(
+  unsigned int size)
+{
+  this->m_RecursiveBSplineWeightFunction->SetGridAlignedWeightsTableSize(size);
+  this->Superclass::SetGridAlignedWeightsTableSize(size);
+}
+
+
+/** Compute the offsets of a support region that wraps around in the last dimension. */
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+typename CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::OffsetValueType
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetCyclicSupportOffsets(
+  const IndexType &         supportIndex,
+  const OffsetValueType *& sliceOffsets) const
+{
+  const OffsetValueType lastDimSize = this->m_GridRegion.GetSize(SpaceDimension - 1);
+  OffsetValueType       firstSlice = supportIndex[SpaceDimension - 1] % lastDimSize;
+  if (firstSlice < 0)
+  {
+    firstSlice += lastDimSize;
+  }
+  sliceOffsets = this->m_CyclicSliceOffsetTable.data() + firstSlice;
+
+  OffsetValueType supportOffset = 0;
+  for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+  {
+    supportOffset += supportIndex[j] * this->m_GridOffsetTable[j];
+  }
+  return supportOffset;
 }
 
 
@@ -290,6 +338,298 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJac
 }
 
 
+/**
+ * ********************* ComputeDisplacement ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+template <class TCoefficient>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::ComputeDisplacement(
+  TCoefficient * const * const coefficients,
+  const OffsetValueType        supportOffset,
+  const OffsetValueType *      sliceOffsets,
+  const double *               weights1D,
+  ScalarType *                 displacement) const
+{
+  typedef RecursiveBSplineTransformImplementation<SpaceDimension - 1, SpaceDimension - 1, SplineOrder, TScalarType>
+    ImplementationType;
+
+  const OffsetValueType * gridOffsetTable = this->m_CoefficientImages[0]->GetOffsetTable();
+  const double *          lastDimWeights1D = weights1D + (SpaceDimension - 1) * (SplineOrder + 1);
+
+  for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+  {
+    displacement[j] = 0.0;
+  }
+
+  /** Interpolate each slice of the support region recursively, and weigh the slices. */
+  for (unsigned int k = 0; k <= SplineOrder; ++k)
+  {
+    TCoefficient * mu[SpaceDimension - 1];
+    for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+    {
+      mu[j] = coefficients[j] + supportOffset + sliceOffsets[k];
+    }
+
+    ScalarType sliceDisplacement[SpaceDimension - 1];
+    ImplementationType::TransformPoint(sliceDisplacement, mu, gridOffsetTable, weights1D);
+
+    for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+    {
+      displacement[j] += sliceDisplacement[j] * lastDimWeights1D[k];
+    }
+  }
+
+} // end ComputeDisplacement()
+
+
+/**
+ * ********************* TransformPoint ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+typename CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::OutputPointType
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::TransformPoint(
+  const InputPointType & point) const
+{
+  /** Check if the coefficient image has been set. */
+  if (!this->m_CoefficientImages[0])
+  {
+    itkWarningMacro(<< "B-spline coefficients have not been set");
+    return point;
+  }
+
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(point, cindex);
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * (except for the last dimension, which wraps around) we assume
+   * zero displacement and return the input point.
+   */
+  if (!this->InsideValidRegion(cindex))
+  {
+    return point;
+  }
+
+  /** Compute the interpolation weights of each dimension. */
+  const unsigned int              numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[numberOfWeights];
+  WeightsType                     weights1D(weightsArray1D, numberOfWeights, false);
+  IndexType                       supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate(cindex, weights1D, supportIndex);
+
+  const OffsetValueType * sliceOffsets = nullptr;
+  const OffsetValueType   supportOffset = this->GetCyclicSupportOffsets(supportIndex, sliceOffsets);
+
+  /** Compute the displacement, from the single precision copy of the coefficients if there is one.
+   * The last dimension is not displaced.
+   */
+  ScalarType displacement[SpaceDimension - 1];
+  if (!this->m_SinglePrecisionCoefficients.empty())
+  {
+    const SizeValueType numberOfCoefficients = this->m_SinglePrecisionCoefficients.size() / SpaceDimension;
+    const float *       coefficients[SpaceDimension - 1];
+    for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+    {
+      coefficients[j] = this->m_SinglePrecisionCoefficients.data() + j * numberOfCoefficients;
+    }
+    this->ComputeDisplacement(coefficients, supportOffset, sliceOffsets, weightsArray1D, displacement);
+  }
+  else
+  {
+    const PixelType * coefficients[SpaceDimension - 1];
+    for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+    {
+      coefficients[j] = this->m_CoefficientImages[j]->GetBufferPointer();
+    }
+    this->ComputeDisplacement(coefficients, supportOffset, sliceOffsets, weightsArray1D, displacement);
+  }
+
+  /** The output point is the start point + displacement. */
+  OutputPointType outputPoint = point;
+  for (unsigned int j = 0; j < SpaceDimension - 1; ++j)
+  {
+    outputPoint[j] += displacement[j];
+  }
+  return outputPoint;
+
+} // end TransformPoint()
+
+
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    outputPoints[i] = this->Self::TransformPoint(inputPoints[i]);
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::GetJacobian(
+  const InputPointType &       ipp,
+  JacobianType &               jacobian,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices) const
+{
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(ipp, cindex);
+
+  /** Initialize. */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if ((jacobian.cols() != nnzji) || (jacobian.rows() != SpaceDimension))
+  {
+    jacobian.SetSize(SpaceDimension, nnzji);
+    jacobian.Fill(0.0);
+  }
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  if (!this->InsideValidRegion(cindex))
+  {
+    nonZeroJacobianIndices.resize(nnzji);
+    for (NumberOfParametersType i = 0; i < nnzji; ++i)
+    {
+      nonZeroJacobianIndices[i] = i;
+    }
+    return;
+  }
+
+  /** Compute the interpolation weights of each dimension. */
+  const unsigned int              numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[numberOfWeights];
+  WeightsType                     weights1D(weightsArray1D, numberOfWeights, false);
+  IndexType                       supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate(cindex, weights1D, supportIndex);
+
+  /** Recursively compute the Jacobian of each slice of the support region, in the order
+   * of the nonzero Jacobian indices. The pointer has changed after each call.
+   */
+  const double *        lastDimWeights1D = weightsArray1D + (SpaceDimension - 1) * (SplineOrder + 1);
+  ParametersValueType * jacobianPointer = jacobian.data_block();
+  for (unsigned int k = 0; k <= SplineOrder; ++k)
+  {
+    RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension - 1, SplineOrder, TScalarType>::
+      GetJacobian(jacobianPointer, weightsArray1D, lastDimWeights1D[k]);
+  }
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize(this->m_SupportSize);
+  supportRegion.SetIndex(supportIndex);
+  this->ComputeNonZeroJacobianIndices(nonZeroJacobianIndices, supportRegion);
+
+} // end GetJacobian()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType &          ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType &                imageJacobian,
+  NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
+{
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(ipp, cindex);
+
+  /** NOTE: if the support region does not lie totally within the grid
+   * we assume zero displacement and zero Jacobian.
+   */
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if (!this->InsideValidRegion(cindex))
+  {
+    nonZeroJacobianIndices.resize(nnzji);
+    for (NumberOfParametersType i = 0; i < nnzji; ++i)
+    {
+      nonZeroJacobianIndices[i] = i;
+    }
+    imageJacobian.Fill(0.0);
+    return;
+  }
+
+  /** Compute the interpolation weights of each dimension. */
+  const unsigned int              numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[numberOfWeights];
+  WeightsType                     weights1D(weightsArray1D, numberOfWeights, false);
+  IndexType                       supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate(cindex, weights1D, supportIndex);
+
+  /** Recursively compute the inner product of the Jacobian and the moving image gradient,
+   * for each slice of the support region. The pointer has changed after each call.
+   */
+  double migArray[SpaceDimension];
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    migArray[j] = movingImageGradient[j];
+  }
+  const double *        lastDimWeights1D = weightsArray1D + (SpaceDimension - 1) * (SplineOrder + 1);
+  ParametersValueType * imageJacobianPointer = imageJacobian.data_block();
+  for (unsigned int k = 0; k <= SplineOrder; ++k)
+  {
+    RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension - 1, SplineOrder, TScalarType>::
+      EvaluateJacobianWithImageGradientProduct(imageJacobianPointer, migArray, weightsArray1D, lastDimWeights1D[k]);
+  }
+
+  /** Compute the nonzero Jacobian indices. */
+  RegionType supportRegion;
+  supportRegion.SetSize(this->m_SupportSize);
+  supportRegion.SetIndex(supportIndex);
+  this->ComputeNonZeroJacobianIndices(nonZeroJacobianIndices, supportRegion);
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    this->Self::EvaluateJacobianWithImageGradientProduct(
+      ipp[i], movingImageGradients[i], imageJacobians[i], nonZeroJacobianIndices[i]);
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -402,41 +742,19 @@ CyclicBSplineDeformableTransform<TScalarType, NDimensions, VSplineOrder>::Comput
 {
   nonZeroJacobianIndices.resize(this->GetNumberOfNonZeroJacobianIndices());
 
-  /** Split support region into two parts. */
-  RegionType supportRegions[2];
-  this->SplitRegion(
-    this->m_CoefficientImages[0]->GetLargestPossibleRegion(), supportRegion, supportRegions[0], supportRegions[1]);
-
-  /** Initialize some helper variables. */
-  const SizeValueType numberOfWeights = WeightsFunctionType::NumberOfWeights;
-  const SizeValueType parametersPerDim = this->GetNumberOfParametersPerDimension();
-  unsigned long       mu = 0;
+  /** Compute the offsets of the support region, wrapped around in the last dimension. */
+  const OffsetValueType * sliceOffsets = nullptr;
+  const OffsetValueType   supportOffset = this->GetCyclicSupportOffsets(supportRegion.GetIndex(), sliceOffsets);
 
-  for (unsigned int r = 0; r < 2; ++r)
+  /** Call the recursive implementation for each slice of the support region. */
+  const unsigned long     parametersPerDim = this->GetNumberOfParametersPerDimension();
+  const OffsetValueType * gridOffsetTable = this->m_CoefficientImages[0]->GetOffsetTable();
+  unsigned long *         nzjiPointer = &nonZeroJacobianIndices[0];
+  for (unsigned int k = 0; k <= SplineOrder; ++k)
   {
-    /** Create iterator over the coefficient image (for current supportRegion). */
-    ImageRegionConstIteratorWithIndex<ImageType> iterator(this->m_CoefficientImages[0], supportRegions[r]);
-
-    /** For all control points in the support region, set which of the
-     * indices in the parameter array are non-zero.
-     */
-    const PixelType * basePointer = this->m_CoefficientImages[0]->GetBufferPointer();
-    while (!iterator.IsAtEnd())
-    {
-      /** Translate the index into a parameter number for the x-direction. */
-      const IdentifierType parameterNumber = &(iterator.Value()) - basePointer;
-
-      /** Update the nonZeroJacobianIndices for all directions. */
-      for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
-      {
-        nonZeroJacobianIndices[mu + dim * numberOfWeights] = parameterNumber + dim * parametersPerDim;
-      }
-
-      /** Increase the iterators. */
-      ++iterator;
-      ++mu;
-    } // end while
-  }   // end for (supportregions)
+    RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension - 1, SplineOrder, TScalarType>::
+      ComputeNonZeroJacobianIndices(nzjiPointer, parametersPerDim, supportOffset + sliceOffsets[k], gridOffsetTable);
+  }
 
 } // end ComputeNonZeroJacobianIndices()
 
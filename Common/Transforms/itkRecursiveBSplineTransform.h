@@ -131,6 +131,16 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Also tabulate the weights of the recursive weight function, see the superclass. */
+  void
+  SetGridAlignedWeightsTableSize(unsigned int size) override;
+
+  /** Transform a batch of points, without a virtual call per point. */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   /** Compute the Jacobian of the transformation. */
   void
   GetJacobian(const InputPointType &       ipp,
@@ -146,6 +156,14 @@ public:
                                            DerivativeType &                imageJacobian,
                                            NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
 
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(), without a virtual call per point. */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override;
@@ -169,6 +187,18 @@ public:
                                JacobianOfSpatialJacobianType & jsj,
                                NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
 
+  /** Compute the spatial Jacobian, its determinant, and the derivative of the logarithm of
+   * the determinant to the nonzero parameters, i.e. trace(sj^-1 d(sj)/dmu), in one pass over
+   * the support region, without computing the Jacobian of the spatial Jacobian. The derivative
+   * is in the order of the nonzero Jacobian indices of GetJacobian() at the same point.
+   * Returns false, with a zero derivative, when the spatial Jacobian is singular.
+   */
+  bool
+  GetSpatialJacobianAndJacobianOfLogDeterminant(const InputPointType & ipp,
+                                                SpatialJacobianType &  sj,
+                                                double &               determinant,
+                                                DerivativeType &       jacobianOfLogDeterminant) const;
+
   /** Compute the Jacobian of the spatial Hessian of the transformation. */
   void
   GetJacobianOfSpatialHessian(const InputPointType &         ipp,
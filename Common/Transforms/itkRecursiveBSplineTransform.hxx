@@ -21,6 +21,8 @@
 #include "itkRecursiveBSplineTransform.h"
 
 #include "itkRecursiveBSplineTransformImplementation.h"
+#include "vnl/vnl_det.h"
+#include "vnl/vnl_inverse.h"
 
 
 namespace itk
@@ -41,6 +43,19 @@ RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::RecursiveBSplineT
 } // end Constructor()
 
 
+/**
+ * ********************* SetGridAlignedWeightsTableSize ****************************
+ */
+
+template <typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::SetGridAlignedWeightsTableSize(unsigned int size)
+{
+  this->m_RecursiveBSplineWeightFunction->SetGridAlignedWeightsTableSize(size);
+  this->Superclass::SetGridAlignedWeightsTableSize(size);
+} // end SetGridAlignedWeightsTableSize()
+
+
 /**
  * ********************* TransformPoint ****************************
  */
@@ -92,16 +107,33 @@ RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::TransformPoint(co
     totalOffsetToSupportIndex += supportIndex[j] * bsplineOffsetTable[j];
   }
 
-  ScalarType * mu[SpaceDimension];
-  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  /** Call the recursive TransformPoint function, on the single precision copy
+   * of the coefficients if there is one.
+   */
+  ScalarType displacement[SpaceDimension];
+  if (!this->m_SinglePrecisionCoefficients.empty())
   {
-    mu[j] = this->m_CoefficientImages[j]->GetBufferPointer() + totalOffsetToSupportIndex;
+    const SizeValueType numberOfCoefficients = this->m_SinglePrecisionCoefficients.size() / SpaceDimension;
+    const float *       mu[SpaceDimension];
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      mu[j] = this->m_SinglePrecisionCoefficients.data() + j * numberOfCoefficients + totalOffsetToSupportIndex;
+    }
+
+    RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension, SplineOrder, TScalar>::TransformPoint(
+      displacement, mu, bsplineOffsetTable, weightsArray1D);
   }
+  else
+  {
+    ScalarType * mu[SpaceDimension];
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      mu[j] = this->m_CoefficientImages[j]->GetBufferPointer() + totalOffsetToSupportIndex;
+    }
 
-  /** Call the recursive TransformPoint function. */
-  ScalarType displacement[SpaceDimension];
-  RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension, SplineOrder, TScalar>::TransformPoint(
-    displacement, mu, bsplineOffsetTable, weightsArray1D);
+    RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension, SplineOrder, TScalar>::TransformPoint(
+      displacement, mu, bsplineOffsetTable, weightsArray1D);
+  }
 
   // The output point is the start point + displacement.
   for (unsigned int j = 0; j < SpaceDimension; ++j)
@@ -248,6 +280,49 @@ RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::EvaluateJacobianW
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    outputPoints[i] = this->Self::TransformPoint(inputPoints[i]);
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
+  {
+    this->Self::EvaluateJacobianWithImageGradientProduct(
+      ipp[i], movingImageGradients[i], imageJacobians[i], nonZeroJacobianIndices[i]);
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -536,6 +611,106 @@ RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::GetJacobianOfSpat
 } // end GetJacobianOfSpatialJacobian()
 
 
+/**
+ * ********************* GetSpatialJacobianAndJacobianOfLogDeterminant ****************************
+ */
+
+template <class TScalar, unsigned int NDimensions, unsigned int VSplineOrder>
+bool
+RecursiveBSplineTransform<TScalar, NDimensions, VSplineOrder>::GetSpatialJacobianAndJacobianOfLogDeterminant(
+  const InputPointType & ipp,
+  SpatialJacobianType &  sj,
+  double &               determinant,
+  DerivativeType &       jacobianOfLogDeterminant) const
+{
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  if (jacobianOfLogDeterminant.GetSize() != nnzji)
+  {
+    jacobianOfLogDeterminant.SetSize(nnzji);
+  }
+
+  /** Convert the physical point to a continuous index, which
+   * is needed for the 'Evaluate()' functions below.
+   */
+  ContinuousIndexType cindex;
+  this->TransformPointToContinuousGridIndex(ipp, cindex);
+
+  // NOTE: if the support region does not lie totally within the grid
+  // we assume identity spatial Jacobian and zero jsj.
+  if (!this->InsideValidRegion(cindex))
+  {
+    sj.SetIdentity();
+    determinant = 1.0;
+    jacobianOfLogDeterminant.Fill(0.0);
+    return true;
+  }
+
+  /** Compute the interpolation weights and their derivatives once, for both recursions. */
+  const unsigned int              numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[numberOfWeights];
+  WeightsType                     weights1D(weightsArray1D, numberOfWeights, false);
+  typename WeightsType::ValueType derivativeWeightsArray1D[numberOfWeights];
+  WeightsType                     derivativeWeights1D(derivativeWeightsArray1D, numberOfWeights, false);
+
+  IndexType supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate(cindex, weights1D, supportIndex);
+  this->m_RecursiveBSplineWeightFunction->EvaluateDerivative(cindex, derivativeWeights1D, supportIndex);
+
+  /** Compute the spatial Jacobian, as in GetSpatialJacobian(). */
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[0]->GetOffsetTable();
+  OffsetValueType         totalOffsetToSupportIndex = 0;
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    totalOffsetToSupportIndex += supportIndex[j] * bsplineOffsetTable[j];
+  }
+  ScalarType * mu[SpaceDimension];
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    mu[j] = this->m_CoefficientImages[j]->GetBufferPointer() + totalOffsetToSupportIndex;
+  }
+
+  double spatialJacobian[SpaceDimension * (SpaceDimension + 1)];
+  RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension, SplineOrder, TScalar>::GetSpatialJacobian(
+    spatialJacobian, mu, bsplineOffsetTable, weightsArray1D, derivativeWeightsArray1D);
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      sj(i, j) = spatialJacobian[i + (j + 1) * SpaceDimension];
+    }
+  }
+  sj = sj * this->m_PointToIndexMatrix2;
+  for (unsigned int j = 0; j < SpaceDimension; ++j)
+  {
+    sj(j, j) += 1.0;
+  }
+
+  determinant = vnl_det(sj.GetVnlMatrix());
+  if (determinant == 0.0)
+  {
+    jacobianOfLogDeterminant.Fill(0.0);
+    return false;
+  }
+
+  /** The derivative of d(sj)/dmu of the parameter of dimension k and control point i has
+   * only row k nonzero, which is the gradient of the weight of i. Therefore
+   * trace(sj^-1 d(sj)/dmu) = sum_m dB_i/dxi_m (P sj^-1)[m][k], with P the matrix
+   * from physical to grid index derivatives, so only P sj^-1 needs to be computed.
+   */
+  const vnl_matrix_fixed<double, SpaceDimension, SpaceDimension> inverse = vnl_inverse(sj.GetVnlMatrix());
+  const vnl_matrix_fixed<double, SpaceDimension, SpaceDimension> matrix =
+    this->m_PointToIndexMatrix2.GetVnlMatrix() * inverse;
+
+  const double dummy[1] = { 1.0 };
+  double *     jldPointer = jacobianOfLogDeterminant.data_block();
+  RecursiveBSplineTransformImplementation<SpaceDimension, SpaceDimension, SplineOrder, TScalar>::
+    GetJacobianOfLogDeterminant(jldPointer, weightsArray1D, derivativeWeightsArray1D, matrix.data_block(), dummy);
+
+  return true;
+
+} // end GetSpatialJacobianAndJacobianOfLogDeterminant()
+
+
 /**
  * ********************* GetJacobianOfSpatialHessian ****************************
  */
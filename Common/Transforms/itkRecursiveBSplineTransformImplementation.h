@@ -62,15 +62,36 @@ public:
   typedef ScalarType *  OutputPointType;
   typedef ScalarType ** CoefficientPointerVectorType;
 
-  /** TransformPoint recursive implementation. */
+  /** TransformPoint recursive implementation. The coefficients may be stored
+   * in another type than ScalarType, such as float; they are accumulated in ScalarType.
+   */
+  template <class TCoefficient>
   static inline void
-  TransformPoint(OutputPointType                    opp,
-                 const CoefficientPointerVectorType mu,
-                 const OffsetValueType *            gridOffsetTable,
-                 const double *                     weights1D)
+  TransformPoint(OutputPointType         opp,
+                 TCoefficient * const *  mu,
+                 const OffsetValueType * gridOffsetTable,
+                 const double *          weights1D)
   {
+    /** In the last dimension the coefficients are contiguous in memory,
+     * so compute the inner products directly, without recursing once per support point.
+     */
+    if (SpaceDimension == 1)
+    {
+      for (unsigned int j = 0; j < OutputDimension; ++j)
+      {
+        const TCoefficient * tmp_mu = mu[j];
+        ScalarType           accum = 0.0;
+        for (unsigned int k = 0; k <= SplineOrder; ++k)
+        {
+          accum += tmp_mu[k] * weights1D[k];
+        }
+        opp[j] = accum;
+      }
+      return;
+    }
+
     /** Make a copy of the pointers to mu. The pointer will move later. */
-    ScalarType * tmp_mu[OutputDimension];
+    TCoefficient * tmp_mu[OutputDimension];
     for (unsigned int j = 0; j < OutputDimension; ++j)
     {
       tmp_mu[j] = mu[j];
@@ -122,6 +143,21 @@ public:
                                            const double *            weights1D,
                                            double                    value)
   {
+    /** In the last dimension write each row of SplineOrder + 1 consecutive elements in one loop. */
+    if (SpaceDimension == 1)
+    {
+      for (unsigned int j = 0; j < OutputDimension; ++j)
+      {
+        ScalarType * row = imageJacobian + j * BSplineNumberOfIndices;
+        for (unsigned int k = 0; k <= SplineOrder; ++k)
+        {
+          row[k] = value * weights1D[k] * movingImageGradient[j];
+        }
+      }
+      imageJacobian += SplineOrder + 1;
+      return;
+    }
+
     for (unsigned int k = 0; k <= SplineOrder; ++k)
     {
       /** Recurse. */
@@ -162,6 +198,27 @@ public:
                      const double *                     weights1D, // normal B-spline weights
                      const double *                     derivativeWeights1D)           // 1st derivative of B-spline
   {
+    /** In the last dimension compute the weighted and derivative weighted sums
+     * of the contiguous coefficients directly.
+     */
+    if (SpaceDimension == 1)
+    {
+      for (unsigned int j = 0; j < OutputDimension; ++j)
+      {
+        const ScalarType * tmp_mu = mu[j];
+        InternalFloatType  accum = 0.0;
+        InternalFloatType  accumDerivative = 0.0;
+        for (unsigned int k = 0; k <= SplineOrder; ++k)
+        {
+          accum += tmp_mu[k] * weights1D[k];
+          accumDerivative += tmp_mu[k] * derivativeWeights1D[k];
+        }
+        sj[j] = accum;
+        sj[OutputDimension + j] = accumDerivative;
+      }
+      return;
+    }
+
     /** Make a copy of the pointers to mu. The pointer will move later. */
     ScalarType * tmp_mu[OutputDimension];
     for (unsigned int j = 0; j < OutputDimension; ++j)
@@ -316,6 +373,41 @@ public:
   } // end GetJacobianOfSpatialJacobian()
 
 
+  /** GetJacobianOfLogDeterminant recursive implementation, see
+   * RecursiveBSplineTransform::GetSpatialJacobianAndJacobianOfLogDeterminant().
+   * The weights and the grid index derivatives are expanded as in GetJacobianOfSpatialJacobian(),
+   * and contracted with the matrix in the end-case.
+   */
+  static inline void
+  GetJacobianOfLogDeterminant(InternalFloatType *&            jld_out,
+                              const double *                  weights1D,           // normal B-spline weights
+                              const double *                  derivativeWeights1D, // 1st derivative of B-spline
+                              const double *                  matrix,
+                              const InternalFloatType * const jsj)
+  {
+    const unsigned int helperDim = OutputDimension - SpaceDimension + 1;
+
+    /** Create a temporary jsj. Here, an additional element is needed for the Jacobian. */
+    InternalFloatType tmp_jsj[helperDim + 1];
+
+    for (unsigned int k = 0; k <= SplineOrder; ++k)
+    {
+      const double w = weights1D[k + HelperConstVariable];
+      const double dw = derivativeWeights1D[k + HelperConstVariable];
+
+      for (unsigned int n = 0; n < helperDim; ++n)
+      {
+        tmp_jsj[n] = jsj[n] * w;
+      }
+      tmp_jsj[helperDim] = jsj[0] * dw;
+
+      /** Recurse. */
+      RecursiveBSplineTransformImplementation<OutputDimension, SpaceDimension - 1, SplineOrder, TScalar>::
+        GetJacobianOfLogDeterminant(jld_out, weights1D, derivativeWeights1D, matrix, tmp_jsj);
+    }
+  } // end GetJacobianOfLogDeterminant()
+
+
   /** GetJacobianOfSpatialHessian recursive implementation.
    * Multiplication with the direction cosines is performed in the end - case.
    */
@@ -389,12 +481,15 @@ public:
   typedef ScalarType *  OutputPointType;
   typedef ScalarType ** CoefficientPointerVectorType;
 
-  /** TransformPoint recursive implementation. */
+  /** TransformPoint recursive implementation. The coefficients may be stored
+   * in another type than ScalarType, such as float; they are accumulated in ScalarType.
+   */
+  template <class TCoefficient>
   static inline void
-  TransformPoint(OutputPointType                    opp,
-                 const CoefficientPointerVectorType mu,
-                 const OffsetValueType *            gridOffsetTable,
-                 const double *                     weights1D)
+  TransformPoint(OutputPointType         opp,
+                 TCoefficient * const *  mu,
+                 const OffsetValueType * gridOffsetTable,
+                 const double *          weights1D)
   {
     for (unsigned int j = 0; j < OutputDimension; ++j)
     {
@@ -517,6 +612,30 @@ public:
   } // end GetJacobianOfSpatialJacobian()
 
 
+  /** GetJacobianOfLogDeterminant recursive implementation.
+   * The received grid index derivatives are in the order [dz, dy, dx]. The entry of
+   * output dimension j is sum_m dB/dxi_m matrix[m][j]; it is written in the block of j.
+   */
+  static inline void
+  GetJacobianOfLogDeterminant(InternalFloatType *&            jld_out,
+                              const double *                  weights1D,           // normal B-spline weights
+                              const double *                  derivativeWeights1D, // 1st derivative of B-spline
+                              const double *                  matrix,
+                              const InternalFloatType * const jsj)
+  {
+    for (unsigned int j = 0; j < OutputDimension; ++j)
+    {
+      double sum = 0.0;
+      for (unsigned int m = 0; m < OutputDimension; ++m)
+      {
+        sum += jsj[OutputDimension - m] * matrix[m * OutputDimension + j];
+      }
+      jld_out[j * BSplineNumberOfIndices] = sum;
+    }
+    ++jld_out;
+  } // end GetJacobianOfLogDeterminant()
+
+
   /** GetJacobianOfSpatialHessian recursive implementation. */
   static inline void
   GetJacobianOfSpatialHessian(InternalFloatType *&            jsh_out,
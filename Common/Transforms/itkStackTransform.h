@@ -21,6 +21,8 @@
 #include "itkAdvancedTransform.h"
 #include "itkIndex.h"
 
+#include <algorithm> // For min and max.
+
 namespace itk
 {
 
@@ -77,6 +79,8 @@ public:
   typedef typename Superclass::OutputPointType               OutputPointType;
   typedef typename Superclass::OutputVectorPixelType         OutputVectorPixelType;
   typedef typename Superclass::InputVectorPixelType          InputVectorPixelType;
+  typedef typename Superclass::DerivativeType                DerivativeType;
+  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
 
   /** Sub transform types, having a reduced dimension. */
   typedef AdvancedTransform<TScalarType,
@@ -87,9 +91,10 @@ public:
   typedef std::vector<SubTransformPointer>        SubTransformContainerType;
   typedef typename SubTransformType::JacobianType SubTransformJacobianType;
 
-  /** Dimension - 1 point types. */
-  typedef typename SubTransformType::InputPointType  SubTransformInputPointType;
-  typedef typename SubTransformType::OutputPointType SubTransformOutputPointType;
+  /** Dimension - 1 point and gradient types. */
+  typedef typename SubTransformType::InputPointType          SubTransformInputPointType;
+  typedef typename SubTransformType::OutputPointType         SubTransformOutputPointType;
+  typedef typename SubTransformType::MovingImageGradientType SubTransformMovingImageGradientType;
 
   /** Array type for parameter vector instantiation. */
   typedef typename ParametersType::ArrayType ParametersArrayType;
@@ -98,6 +103,15 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & ipp) const override;
 
+  /** Method to transform a batch of points. The points are partitioned by sub
+   * transform, and the points of each sub transform are passed to it as one batch,
+   * so that the coefficients of one sub transform are accessed at a time.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   /** These vector transforms are not implemented for this transform. */
   OutputVectorType
   TransformVector(const InputVectorType &) const override
@@ -131,6 +145,17 @@ public:
   void
   GetJacobian(const InputPointType & ipp, JacobianType & jac, NonZeroJacobianIndicesType & nzji) const override;
 
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(). Like TransformPoints(),
+   * the points are partitioned by sub transform. The nonzero Jacobian indices of the
+   * points of sub transform t are within the parameters of t only.
+   */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   /** Set the parameters. Checks if the number of parameters
    * is correct and sets parameters of sub transforms. */
   void
@@ -294,6 +319,28 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** The index of the sub transform that maps the point ipp. */
+  unsigned int
+  GetSubTransformIndex(const InputPointType & ipp) const
+  {
+    return std::min(
+      this->m_NumberOfSubTransforms - 1,
+      static_cast<unsigned int>(
+        std::max(0, vnl_math::rnd((ipp[ReducedInputSpaceDimension] - this->m_StackOrigin) / this->m_StackSpacing))));
+  }
+
+  /** The batch methods process the points in chunks of at most this size. */
+  static constexpr unsigned int SubTransformBatchSize = 64;
+
+  /** Compute the sub transform indices of a chunk of points, and the order in which the
+   * points are processed, such that the points of each sub transform are adjacent.
+   */
+  void
+  SortBySubTransform(const InputPointType * points,
+                     const unsigned int     numberOfPoints,
+                     unsigned int *         subTransformIndices,
+                     unsigned int *         order) const;
+
   // Number of transforms and transform container
   unsigned int              m_NumberOfSubTransforms{ 0 };
   SubTransformContainerType m_SubTransformContainer;
@@ -104,10 +104,7 @@ StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::TransformPoint
 
   /** Transform point using right subtransform. */
   SubTransformOutputPointType oppr;
-  const unsigned int          subt =
-    std::min(this->m_NumberOfSubTransforms - 1,
-             static_cast<unsigned int>(
-               std::max(0, vnl_math::rnd((ipp[ReducedInputSpaceDimension] - m_StackOrigin) / m_StackSpacing))));
+  const unsigned int          subt = this->GetSubTransformIndex(ipp);
   oppr = this->m_SubTransformContainer[subt]->TransformPoint(ippr);
 
   /** Increase dimension of input point. */
@@ -123,6 +120,96 @@ StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::TransformPoint
 } // end TransformPoint()
 
 
+/**
+ * ********************* SortBySubTransform ****************************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::SortBySubTransform(
+  const InputPointType * points,
+  const unsigned int     numberOfPoints,
+  unsigned int *         subTransformIndices,
+  unsigned int *         order) const
+{
+  for (unsigned int i = 0; i < numberOfPoints; ++i)
+  {
+    subTransformIndices[i] = this->GetSubTransformIndex(points[i]);
+    order[i] = i;
+  }
+
+  /** A stable sort keeps the original order of the points of each sub transform. */
+  std::stable_sort(order, order + numberOfPoints, [subTransformIndices](const unsigned int a, const unsigned int b) {
+    return subTransformIndices[a] < subTransformIndices[b];
+  });
+
+} // end SortBySubTransform()
+
+
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  SubTransformInputPointType  reducedInputPoints[SubTransformBatchSize];
+  SubTransformOutputPointType reducedOutputPoints[SubTransformBatchSize];
+  unsigned int                subTransformIndices[SubTransformBatchSize];
+  unsigned int                order[SubTransformBatchSize];
+
+  for (SizeValueType chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += SubTransformBatchSize)
+  {
+    /** Partition the points of the chunk by sub transform. */
+    const unsigned int chunkSize =
+      static_cast<unsigned int>(std::min<SizeValueType>(SubTransformBatchSize, numberOfPoints - chunkBegin));
+    const InputPointType * chunkInputPoints = inputPoints + chunkBegin;
+    OutputPointType *      chunkOutputPoints = outputPoints + chunkBegin;
+    this->SortBySubTransform(chunkInputPoints, chunkSize, subTransformIndices, order);
+
+    unsigned int begin = 0;
+    while (begin < chunkSize)
+    {
+      /** Reduce the dimension of the points of the next sub transform. */
+      const unsigned int subt = subTransformIndices[order[begin]];
+      unsigned int       n = 0;
+      while (begin + n < chunkSize && subTransformIndices[order[begin + n]] == subt)
+      {
+        for (unsigned int d = 0; d < ReducedInputSpaceDimension; ++d)
+        {
+          reducedInputPoints[n][d] = chunkInputPoints[order[begin + n]][d];
+        }
+        ++n;
+      }
+
+      /** Transform them using the right subtransform. */
+      this->m_SubTransformContainer[subt]->TransformPoints(reducedInputPoints, reducedOutputPoints, n);
+
+      /** Increase the dimension of the output points. The input and output
+       * array may be the same, so the last coordinate is read first.
+       */
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        const unsigned int p = order[begin + i];
+        const ScalarType   lastCoordinate = chunkInputPoints[p][ReducedInputSpaceDimension];
+        for (unsigned int d = 0; d < ReducedOutputSpaceDimension; ++d)
+        {
+          chunkOutputPoints[p][d] = reducedOutputPoints[i][d];
+        }
+        chunkOutputPoints[p][ReducedOutputSpaceDimension] = lastCoordinate;
+      }
+
+      begin += n;
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* GetJacobian ****************************
  */
@@ -141,10 +228,7 @@ StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::GetJacobian(co
   }
 
   /** Get Jacobian from right subtransform. */
-  const unsigned int subt =
-    std::min(this->m_NumberOfSubTransforms - 1,
-             static_cast<unsigned int>(
-               std::max(0, vnl_math::rnd((ipp[ReducedInputSpaceDimension] - m_StackOrigin) / m_StackSpacing))));
+  const unsigned int subt = this->GetSubTransformIndex(ipp);
   SubTransformJacobianType subjac;
   this->m_SubTransformContainer[subt]->GetJacobian(ippr, subjac, nzji);
 
@@ -168,6 +252,92 @@ StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::GetJacobian(co
 } // end GetJacobian()
 
 
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+StackTransform<TScalarType, NInputDimensions, NOutputDimensions>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  SubTransformInputPointType          reducedPoints[SubTransformBatchSize];
+  SubTransformMovingImageGradientType reducedGradients[SubTransformBatchSize];
+  unsigned int                        subTransformIndices[SubTransformBatchSize];
+  unsigned int                        order[SubTransformBatchSize];
+
+  const NumberOfParametersType numSubTransformParameters = this->m_SubTransformContainer[0]->GetNumberOfParameters();
+
+  for (SizeValueType chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += SubTransformBatchSize)
+  {
+    /** Partition the points of the chunk by sub transform. */
+    const unsigned int chunkSize =
+      static_cast<unsigned int>(std::min<SizeValueType>(SubTransformBatchSize, numberOfPoints - chunkBegin));
+    this->SortBySubTransform(ipp + chunkBegin, chunkSize, subTransformIndices, order);
+
+    unsigned int begin = 0;
+    while (begin < chunkSize)
+    {
+      /** Reduce the dimension of the points of the next sub transform. The last
+       * row of the Jacobian is zero, so the last gradient component is not needed.
+       */
+      const unsigned int subt = subTransformIndices[order[begin]];
+      unsigned int       n = 0;
+      bool               contiguous = true;
+      while (begin + n < chunkSize && subTransformIndices[order[begin + n]] == subt)
+      {
+        const SizeValueType p = chunkBegin + order[begin + n];
+        for (unsigned int d = 0; d < ReducedInputSpaceDimension; ++d)
+        {
+          reducedPoints[n][d] = ipp[p][d];
+          reducedGradients[n][d] = movingImageGradients[p][d];
+        }
+        contiguous = contiguous && order[begin + n] == order[begin] + n;
+        ++n;
+      }
+
+      /** Compute the products using the right subtransform: at once when the
+       * points are adjacent in the output, otherwise one by one.
+       */
+      const SubTransformType * subTransform = this->m_SubTransformContainer[subt].GetPointer();
+      const SizeValueType      first = chunkBegin + order[begin];
+      if (contiguous)
+      {
+        subTransform->EvaluateJacobianWithImageGradientProducts(
+          reducedPoints, reducedGradients, imageJacobians + first, nonZeroJacobianIndices + first, n);
+      }
+      else
+      {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+          const SizeValueType p = chunkBegin + order[begin + i];
+          subTransform->EvaluateJacobianWithImageGradientProduct(
+            reducedPoints[i], reducedGradients[i], imageJacobians[p], nonZeroJacobianIndices[p]);
+        }
+      }
+
+      /** Update non zero Jacobian indices, such that they refer to the
+       * parameters of this sub transform in the stack.
+       */
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        for (auto & index : nonZeroJacobianIndices[chunkBegin + order[begin + i]])
+        {
+          index += subt * numSubTransformParameters;
+        }
+      }
+
+      begin += n;
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetNumberOfNonZeroJacobianIndices ****************************
  */
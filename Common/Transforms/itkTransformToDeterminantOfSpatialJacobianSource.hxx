@@ -317,7 +317,9 @@ TransformToDeterminantOfSpatialJacobianSource<TOutputImage, TTransformPrecisionT
   outputPtr->SetSpacing(m_OutputSpacing);
   outputPtr->SetOrigin(m_OutputOrigin);
   outputPtr->SetDirection(m_OutputDirection);
-  outputPtr->Allocate();
+
+  // Do not allocate the output here: the pipeline allocates the requested
+  // region only, which allows the output to be generated piece by piece.
 
 } // end GenerateOutputInformation()
 
@@ -0,0 +1,228 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkTransformToInverseDisplacementFieldSource_h
+#define itkTransformToInverseDisplacementFieldSource_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageSource.h"
+
+#include <atomic>
+
+namespace itk
+{
+
+/** \class TransformToInverseDisplacementFieldSource
+ * \brief Generate the displacement field of the inverse of a coordinate transform.
+ *
+ * For every point y of the output grid, this source finds the point x for which
+ * T(x) = y, and stores the displacement x - y. The transform T maps the points of
+ * the fixed image to the moving image, so the output maps the moving image back to
+ * the fixed image, when the output grid is put on the moving image.
+ *
+ * The points are inverted independently, in parallel, by a damped Newton iteration
+ * with the spatial Jacobian of the transform:
+ *
+ *   \f[ x_{k+1} = x_k - \left( \frac{\partial T}{\partial x}(x_k) \right)^{-1} (T(x_k) - y), \f]
+ *
+ * which falls back to the fixed point iteration \f$ x_{k+1} = x_k - (T(x_k) - y) \f$
+ * where the spatial Jacobian is (nearly) singular, and halves the step as long as it
+ * does not decrease the residual. The iteration of each point is initialised from an
+ * inverse computed first on a grid that is CoarseGridFactor times coarser than the
+ * output grid, so that the fine iterations start close to the solution. The iteration
+ * stops when the residual \f$ \| T(x_k) - y \| \f$ is smaller than the tolerance, which
+ * is a fraction of the smallest output spacing. The points that did not converge keep
+ * their best estimate, and are counted, see GetNumberOfUnconvergedPoints().
+ *
+ * The output pixel type should be a vector of ImageDimension elements,
+ * e.g. itk::Vector<float, ImageDimension>.
+ *
+ * \ingroup GeometricTransforms
+ */
+template <class TOutputImage, class TTransformPrecisionType = double>
+class ITK_TEMPLATE_EXPORT TransformToInverseDisplacementFieldSource : public ImageSource<TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef TransformToInverseDisplacementFieldSource Self;
+  typedef ImageSource<TOutputImage>                 Superclass;
+  typedef SmartPointer<Self>                        Pointer;
+  typedef SmartPointer<const Self>                  ConstPointer;
+
+  typedef TOutputImage                           OutputImageType;
+  typedef typename OutputImageType::Pointer      OutputImagePointer;
+  typedef typename OutputImageType::ConstPointer OutputImageConstPointer;
+  typedef typename OutputImageType::RegionType   OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TransformToInverseDisplacementFieldSource, ImageSource);
+
+  /** Number of dimensions. */
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  /** Typedefs for transform. */
+  typedef AdvancedTransform<TTransformPrecisionType,
+                            itkGetStaticConstMacro(ImageDimension),
+                            itkGetStaticConstMacro(ImageDimension)>
+                                                      TransformType;
+  typedef typename TransformType::ConstPointer        TransformPointerType;
+  typedef typename TransformType::InputPointType      InputPointType;
+  typedef typename TransformType::OutputPointType     OutputPointType;
+  typedef typename TransformType::SpatialJacobianType SpatialJacobianType;
+
+  /** Typedefs for output image. */
+  typedef typename OutputImageType::PixelType     PixelType;
+  typedef typename PixelType::ValueType           PixelValueType;
+  typedef typename OutputImageType::RegionType    RegionType;
+  typedef typename RegionType::SizeType           SizeType;
+  typedef typename OutputImageType::IndexType     IndexType;
+  typedef typename OutputImageType::PointType     PointType;
+  typedef typename OutputImageType::SpacingType   SpacingType;
+  typedef typename OutputImageType::PointType     OriginType;
+  typedef typename OutputImageType::DirectionType DirectionType;
+
+  /** Typedefs for base image. */
+  typedef ImageBase<itkGetStaticConstMacro(ImageDimension)> ImageBaseType;
+
+  /** Set the coordinate transformation to be inverted. */
+  itkSetConstObjectMacro(Transform, TransformType);
+
+  /** Get a pointer to the coordinate transform. */
+  itkGetConstObjectMacro(Transform, TransformType);
+
+  /** Set/Get the region of the output image. */
+  itkSetMacro(OutputRegion, OutputImageRegionType);
+  itkGetConstReferenceMacro(OutputRegion, OutputImageRegionType);
+
+  /** Set the size and the start index of the output largest possible region. */
+  virtual void
+  SetOutputSize(const SizeType & size);
+  virtual void
+  SetOutputIndex(const IndexType & index);
+
+  /** Set/Get the output image spacing. */
+  itkSetMacro(OutputSpacing, SpacingType);
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType);
+
+  /** Set/Get the output image origin. */
+  itkSetMacro(OutputOrigin, OriginType);
+  itkGetConstReferenceMacro(OutputOrigin, OriginType);
+
+  /** Set/Get the output direction cosine matrix. */
+  itkSetMacro(OutputDirection, DirectionType);
+  itkGetConstReferenceMacro(OutputDirection, DirectionType);
+
+  /** Helper method to set the output parameters based on this image. */
+  void
+  SetOutputParametersFromImage(const ImageBaseType * image);
+
+  /** Set/Get the maximum number of iterations per point. The default is 20. */
+  itkSetMacro(MaximumNumberOfIterations, unsigned int);
+  itkGetConstMacro(MaximumNumberOfIterations, unsigned int);
+
+  /** Set/Get the tolerance of the residual, as a fraction of the smallest output spacing.
+   * The default is 0.01.
+   */
+  itkSetMacro(Tolerance, double);
+  itkGetConstMacro(Tolerance, double);
+
+  /** Set/Get the factor by which the grid of the initial estimate is coarser than the
+   * output grid. A factor of 1 starts every point from the identity. The default is 4.
+   */
+  itkSetClampMacro(CoarseGridFactor, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(CoarseGridFactor, unsigned int);
+
+  /** Get the number of output points of which the residual did not get below the
+   * tolerance, in the last update.
+   */
+  SizeValueType
+  GetNumberOfUnconvergedPoints(void) const
+  {
+    return this->m_NumberOfUnconvergedPoints;
+  }
+
+  /** Compute the Modified Time based on changes to the components. */
+  ModifiedTimeType
+  GetMTime(void) const override;
+
+protected:
+  TransformToInverseDisplacementFieldSource();
+  ~TransformToInverseDisplacementFieldSource() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Set the output information. */
+  void
+  GenerateOutputInformation(void) override;
+
+  /** Check the transform, and compute the inverse on the coarse grid. */
+  void
+  BeforeThreadedGenerateData(void) override;
+
+  /** Invert the points of the output region, starting from the coarse inverse. */
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  /** Release the coarse inverse. */
+  void
+  AfterThreadedGenerateData(void) override;
+
+private:
+  TransformToInverseDisplacementFieldSource(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** The inverse on the coarse grid, as double precision displacements. */
+  typedef Vector<double, ImageDimension>                CoarseDisplacementType;
+  typedef Image<CoarseDisplacementType, ImageDimension> CoarseDisplacementFieldType;
+
+  /** Find the point x with T(x) = y, starting at the given x. Returns whether the
+   * residual got below the tolerance.
+   */
+  bool
+  InvertPoint(const PointType & y, InputPointType & x, const double tolerance) const;
+
+  /** Get the initial estimate of the inverse at y, interpolated linearly on the coarse grid. */
+  InputPointType
+  GetInitialEstimate(const PointType & y) const;
+
+  /** Member variables. */
+  RegionType           m_OutputRegion;    // region of the output image
+  TransformPointerType m_Transform;       // Coordinate transform to invert
+  SpacingType          m_OutputSpacing;   // output image spacing
+  OriginType           m_OutputOrigin;    // output image origin
+  DirectionType        m_OutputDirection; // output image direction cosines
+
+  unsigned int m_MaximumNumberOfIterations;
+  double       m_Tolerance;
+  unsigned int m_CoarseGridFactor;
+
+  typename CoarseDisplacementFieldType::Pointer m_CoarseInverse;
+  std::atomic<SizeValueType>                    m_NumberOfUnconvergedPoints;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkTransformToInverseDisplacementFieldSource.hxx"
+#endif
+
+#endif // end #ifndef itkTransformToInverseDisplacementFieldSource_h
@@ -0,0 +1,460 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkTransformToInverseDisplacementFieldSource_hxx
+#define itkTransformToInverseDisplacementFieldSource_hxx
+
+#include "itkTransformToInverseDisplacementFieldSource.h"
+
+#include "itkAdvancedIdentityTransform.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkTotalProgressReporter.h"
+#include "itkContinuousIndex.h"
+#include "vnl/vnl_det.h"
+#include "vnl/vnl_inverse.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+TransformToInverseDisplacementFieldSource<TOutputImage,
+                                          TTransformPrecisionType>::TransformToInverseDisplacementFieldSource()
+{
+  this->m_OutputSpacing.Fill(1.0);
+  this->m_OutputOrigin.Fill(0.0);
+  this->m_OutputDirection.SetIdentity();
+
+  SizeType size;
+  size.Fill(0);
+  this->m_OutputRegion.SetSize(size);
+
+  IndexType index;
+  index.Fill(0);
+  this->m_OutputRegion.SetIndex(index);
+
+  this->m_Transform = AdvancedIdentityTransform<TTransformPrecisionType, ImageDimension>::New();
+
+  this->m_MaximumNumberOfIterations = 20;
+  this->m_Tolerance = 0.01;
+  this->m_CoarseGridFactor = 4;
+  this->m_NumberOfUnconvergedPoints = 0;
+
+} // end Constructor
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::PrintSelf(std::ostream & os,
+                                                                                            Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "OutputRegion: " << this->m_OutputRegion << std::endl;
+  os << indent << "OutputSpacing: " << this->m_OutputSpacing << std::endl;
+  os << indent << "OutputOrigin: " << this->m_OutputOrigin << std::endl;
+  os << indent << "OutputDirection: " << this->m_OutputDirection << std::endl;
+  os << indent << "Transform: " << this->m_Transform.GetPointer() << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+  os << indent << "CoarseGridFactor: " << this->m_CoarseGridFactor << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ********************* SetOutputSize ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::SetOutputSize(const SizeType & size)
+{
+  this->m_OutputRegion.SetSize(size);
+  this->Modified();
+
+} // end SetOutputSize()
+
+
+/**
+ * ********************* SetOutputIndex ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::SetOutputIndex(
+  const IndexType & index)
+{
+  this->m_OutputRegion.SetIndex(index);
+  this->Modified();
+
+} // end SetOutputIndex()
+
+
+/**
+ * ********************* SetOutputParametersFromImage ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::SetOutputParametersFromImage(
+  const ImageBaseType * image)
+{
+  if (!image)
+  {
+    itkExceptionMacro(<< "Cannot use a null image reference");
+  }
+
+  this->SetOutputOrigin(image->GetOrigin());
+  this->SetOutputSpacing(image->GetSpacing());
+  this->SetOutputDirection(image->GetDirection());
+  this->SetOutputRegion(image->GetLargestPossibleRegion());
+
+} // end SetOutputParametersFromImage()
+
+
+/**
+ * ********************* GenerateOutputInformation ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::GenerateOutputInformation(void)
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+
+  // get pointer to the output
+  OutputImagePointer outputPtr = this->GetOutput();
+  if (!outputPtr)
+  {
+    return;
+  }
+
+  outputPtr->SetLargestPossibleRegion(this->m_OutputRegion);
+  outputPtr->SetSpacing(this->m_OutputSpacing);
+  outputPtr->SetOrigin(this->m_OutputOrigin);
+  outputPtr->SetDirection(this->m_OutputDirection);
+
+} // end GenerateOutputInformation()
+
+
+/**
+ * ********************* BeforeThreadedGenerateData ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::BeforeThreadedGenerateData(void)
+{
+  if (!this->m_Transform)
+  {
+    itkExceptionMacro(<< "Transform not set");
+  }
+
+  this->m_NumberOfUnconvergedPoints = 0;
+  this->m_CoarseInverse = nullptr;
+  if (this->m_CoarseGridFactor <= 1)
+  {
+    return;
+  }
+
+  /** The coarse grid covers the requested region, from its first voxel up to and
+   * including its last voxel, with the same origin and direction.
+   */
+  const OutputImageType * outputPtr = this->GetOutput();
+  const RegionType &      requestedRegion = outputPtr->GetRequestedRegion();
+  const unsigned int      factor = this->m_CoarseGridFactor;
+
+  PointType coarseOrigin;
+  outputPtr->TransformIndexToPhysicalPoint(requestedRegion.GetIndex(), coarseOrigin);
+  SpacingType coarseSpacing = this->m_OutputSpacing;
+  SizeType    coarseSize;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    coarseSpacing[d] *= factor;
+    coarseSize[d] = (requestedRegion.GetSize()[d] + factor - 2) / factor + 1;
+  }
+
+  this->m_CoarseInverse = CoarseDisplacementFieldType::New();
+  this->m_CoarseInverse->SetRegions(coarseSize);
+  this->m_CoarseInverse->SetOrigin(coarseOrigin);
+  this->m_CoarseInverse->SetSpacing(coarseSpacing);
+  this->m_CoarseInverse->SetDirection(this->m_OutputDirection);
+  this->m_CoarseInverse->Allocate();
+
+  /** Invert the coarse points in parallel, starting from the identity. */
+  const double tolerance = this->m_Tolerance * *std::min_element(coarseSpacing.Begin(), coarseSpacing.End());
+  CoarseDisplacementFieldType * coarseInverse = this->m_CoarseInverse;
+  this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+    coarseInverse->GetBufferedRegion(),
+    [this, coarseInverse, tolerance](const RegionType & region) {
+      ImageRegionIteratorWithIndex<CoarseDisplacementFieldType> it(coarseInverse, region);
+      PointType                                                 y;
+      for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+        coarseInverse->TransformIndexToPhysicalPoint(it.GetIndex(), y);
+        InputPointType x;
+        x.CastFrom(y);
+        this->InvertPoint(y, x, tolerance);
+
+        CoarseDisplacementType displacement;
+        for (unsigned int d = 0; d < ImageDimension; ++d)
+        {
+          displacement[d] = static_cast<double>(x[d]) - y[d];
+        }
+        it.Set(displacement);
+      }
+    },
+    nullptr);
+
+} // end BeforeThreadedGenerateData()
+
+
+/**
+ * ********************* DynamicThreadedGenerateData ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  OutputImageType * outputPtr = this->GetOutput();
+  const double      tolerance =
+    this->m_Tolerance * *std::min_element(this->m_OutputSpacing.Begin(), this->m_OutputSpacing.End());
+
+  TotalProgressReporter progress(this, outputPtr->GetRequestedRegion().GetNumberOfPixels());
+
+  SizeValueType numberOfUnconvergedPoints = 0;
+  PointType     y;
+  PixelType     displacement;
+
+  ImageRegionIteratorWithIndex<OutputImageType> it(outputPtr, outputRegionForThread);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    outputPtr->TransformIndexToPhysicalPoint(it.GetIndex(), y);
+    InputPointType x = this->GetInitialEstimate(y);
+    if (!this->InvertPoint(y, x, tolerance))
+    {
+      ++numberOfUnconvergedPoints;
+    }
+
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      displacement[d] = static_cast<PixelValueType>(static_cast<double>(x[d]) - y[d]);
+    }
+    it.Set(displacement);
+    progress.CompletedPixel();
+  }
+
+  this->m_NumberOfUnconvergedPoints += numberOfUnconvergedPoints;
+
+} // end DynamicThreadedGenerateData()
+
+
+/**
+ * ********************* AfterThreadedGenerateData ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+void
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::AfterThreadedGenerateData(void)
+{
+  this->m_CoarseInverse = nullptr;
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ********************* GetInitialEstimate ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+typename TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::InputPointType
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::GetInitialEstimate(
+  const PointType & y) const
+{
+  InputPointType x;
+  x.CastFrom(y);
+  if (this->m_CoarseInverse.IsNull())
+  {
+    return x;
+  }
+
+  /** Interpolate the coarse displacements linearly, clamping at the border. */
+  typedef ContinuousIndex<double, ImageDimension> ContinuousIndexType;
+  ContinuousIndexType                             cindex;
+  this->m_CoarseInverse->TransformPhysicalPointToContinuousIndex(y, cindex);
+
+  const RegionType & region = this->m_CoarseInverse->GetBufferedRegion();
+  IndexType          baseIndex;
+  double             weights[ImageDimension];
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    const double lastIndex = static_cast<double>(region.GetIndex()[d] + region.GetSize()[d] - 1);
+    const double c = std::min(std::max(cindex[d], static_cast<double>(region.GetIndex()[d])), lastIndex);
+    baseIndex[d] = static_cast<IndexValueType>(std::floor(c));
+    if (baseIndex[d] >= static_cast<IndexValueType>(lastIndex) && region.GetSize()[d] > 1)
+    {
+      --baseIndex[d];
+    }
+    weights[d] = region.GetSize()[d] > 1 ? c - static_cast<double>(baseIndex[d]) : 0.0;
+  }
+
+  CoarseDisplacementType displacement;
+  displacement.Fill(0.0);
+  for (unsigned int corner = 0; corner < (1u << ImageDimension); ++corner)
+  {
+    IndexType index = baseIndex;
+    double    weight = 1.0;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      if (corner & (1u << d))
+      {
+        ++index[d];
+        weight *= weights[d];
+      }
+      else
+      {
+        weight *= 1.0 - weights[d];
+      }
+    }
+    if (weight > 0.0)
+    {
+      displacement += this->m_CoarseInverse->GetPixel(index) * weight;
+    }
+  }
+
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    x[d] += displacement[d];
+  }
+  return x;
+
+} // end GetInitialEstimate()
+
+
+/**
+ * ********************* InvertPoint ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+bool
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::InvertPoint(
+  const PointType & y,
+  InputPointType &  x,
+  const double      tolerance) const
+{
+  typedef typename SpatialJacobianType::InternalMatrixType          JacobianMatrixType;
+  typedef vnl_vector_fixed<TTransformPrecisionType, ImageDimension> StepType;
+  typedef typename NumericTraits<TTransformPrecisionType>::RealType RealType;
+  constexpr unsigned int                                            maximumNumberOfHalvings = 8;
+
+  InputPointType target;
+  target.CastFrom(y);
+
+  OutputPointType tx = this->m_Transform->TransformPoint(x);
+  double          residualSquared = tx.SquaredEuclideanDistanceTo(target);
+  const double    toleranceSquared = tolerance * tolerance;
+
+  SpatialJacobianType sj;
+  for (unsigned int iteration = 0; iteration < this->m_MaximumNumberOfIterations && residualSquared > toleranceSquared;
+       ++iteration)
+  {
+    StepType residual;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      residual[d] = tx[d] - target[d];
+    }
+
+    /** The Newton step, or the fixed point step where the spatial Jacobian is (nearly) singular. */
+    this->m_Transform->GetSpatialJacobian(x, sj);
+    const JacobianMatrixType & jacobian = sj.GetVnlMatrix();
+    StepType                   step = residual;
+    if (std::abs(static_cast<RealType>(vnl_det(jacobian))) > 1e-8)
+    {
+      step = vnl_inverse(jacobian) * residual;
+    }
+
+    /** Halve the step until the residual decreases. */
+    bool decreased = false;
+    for (unsigned int halving = 0; halving < maximumNumberOfHalvings && !decreased; ++halving)
+    {
+      InputPointType candidate = x;
+      for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+        candidate[d] -= step[d];
+      }
+      const OutputPointType tc = this->m_Transform->TransformPoint(candidate);
+      const double          candidateResidualSquared = tc.SquaredEuclideanDistanceTo(target);
+      if (candidateResidualSquared < residualSquared)
+      {
+        x = candidate;
+        tx = tc;
+        residualSquared = candidateResidualSquared;
+        decreased = true;
+      }
+      step *= static_cast<TTransformPrecisionType>(0.5);
+    }
+    if (!decreased)
+    {
+      break;
+    }
+  }
+
+  return residualSquared <= toleranceSquared;
+
+} // end InvertPoint()
+
+
+/**
+ * ********************* GetMTime ****************************
+ */
+
+template <class TOutputImage, class TTransformPrecisionType>
+ModifiedTimeType
+TransformToInverseDisplacementFieldSource<TOutputImage, TTransformPrecisionType>::GetMTime(void) const
+{
+  ModifiedTimeType latestTime = Object::GetMTime();
+
+  if (this->m_Transform)
+  {
+    if (latestTime < this->m_Transform->GetMTime())
+    {
+      latestTime = this->m_Transform->GetMTime();
+    }
+  }
+
+  return latestTime;
+
+} // end GetMTime()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkTransformToInverseDisplacementFieldSource_hxx
@@ -21,6 +21,8 @@
 #include "itkObject.h"
 #include "itkArray.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -33,6 +35,13 @@ namespace itk
  * on a denser grid. Therefore, the user needs to supply the old B-spline grid
  * (region, spacing, origin, direction), and the required B-spline grid.
  *
+ * The B-spline is sampled at the nodes of the required grid, after which the
+ * B-spline coefficients of these samples are computed. When both grids have the
+ * same direction, and the spline order is at most 3, this is done directly on the
+ * parameter arrays, one dimension at a time, with the lines of every dimension
+ * divided over the threads. Otherwise, ITK resample and decomposition filters
+ * are used. Both give the same result, apart from rounding.
+ *
  */
 
 template <class TArray, class TImage>
@@ -111,11 +120,30 @@ protected:
   virtual bool
   DoUpsampling(void);
 
+  /** Upsampling of grids with the same direction, one dimension at a time. */
+  void
+  UpsampleParametersSeparable(const ArrayType & param_in, ArrayType & param_out);
+
 private:
   UpsampleBSplineParametersFilter(const Self &) = delete;
   void
   operator=(const Self &) = delete;
 
+  /** Computes the current grid nodes that support the B-spline at the continuous index x,
+   * relative to startIndex and mirrored at the borders, and their weights.
+   */
+  static void
+  ComputeSupport(const double         x,
+                 const IndexValueType startIndex,
+                 const IndexValueType endIndex,
+                 const unsigned int   order,
+                 OffsetValueType *    indices,
+                 double *             weights);
+
+  /** Replaces the samples of a line by their B-spline coefficients. */
+  static void
+  DecomposeLine(std::vector<double> & c, const unsigned int order);
+
   /** Private member variables. */
   OriginType    m_CurrentGridOrigin;
   SpacingType   m_CurrentGridSpacing;
@@ -23,6 +23,10 @@
 #include "itkBSplineResampleImageFunction.h"
 #include "itkBSplineDecompositionImageFilter.h"
 #include "itkResampleImageFilter.h"
+#include "itkParallelTasks.h"
+
+#include <algorithm> // For fill_n, min and max.
+#include <cmath>
 
 namespace itk
 {
@@ -62,6 +66,13 @@ UpsampleBSplineParametersFilter<TArray, TImage>::UpsampleParameters(const ArrayT
     return;
   }
 
+  /** When the grids have the same direction, every dimension can be upsampled on its own. */
+  if (this->m_CurrentGridDirection == this->m_RequiredGridDirection && this->m_BSplineOrder <= 3)
+  {
+    this->UpsampleParametersSeparable(parameters_in, parameters_out);
+    return;
+  }
+
   /** Typedefs. */
   typedef itk::ResampleImageFilter<ImageType, ImageType>             UpsampleFilterType;
   typedef itk::BSplineResampleImageFunction<ImageType, ValueType>    CoefficientUpsampleFunctionType;
@@ -150,6 +161,283 @@ UpsampleBSplineParametersFilter<TArray, TImage>::UpsampleParameters(const ArrayT
 } // end UpsampleParameters()
 
 
+/**
+ * ******************* UpsampleParametersSeparable *******************
+ */
+
+template <class TArray, class TImage>
+void
+UpsampleBSplineParametersFilter<TArray, TImage>::UpsampleParametersSeparable(const ArrayType & parameters_in,
+                                                                             ArrayType &       parameters_out)
+{
+  typedef typename RegionType::SizeType SizeType;
+  const SizeType &                      currentSize = this->m_CurrentGridRegion.GetSize();
+  const SizeType &                      requiredSize = this->m_RequiredGridRegion.GetSize();
+  const SizeValueType                   currentNumberOfPixels = this->m_CurrentGridRegion.GetNumberOfPixels();
+  const SizeValueType                   requiredNumberOfPixels = this->m_RequiredGridRegion.GetNumberOfPixels();
+  parameters_out.SetSize(requiredNumberOfPixels * Dimension);
+
+  /** The required grid nodes, in continuous index coordinates of the current grid.
+   * The directions are equal, so every dimension is mapped on its own.
+   */
+  const DirectionType inverseDirection(this->m_CurrentGridDirection.GetInverse());
+  const auto          localOffset = inverseDirection * (this->m_RequiredGridOrigin - this->m_CurrentGridOrigin);
+
+  /** The (order + 1) current nodes and their weights, for every required node along every dimension. */
+  const unsigned int                        supportSize = this->m_BSplineOrder + 1;
+  std::vector<std::vector<OffsetValueType>> supportIndices(Dimension);
+  std::vector<std::vector<double>>          supportWeights(Dimension);
+  for (unsigned int d = 0; d < Dimension; ++d)
+  {
+    const double         ratio = this->m_RequiredGridSpacing[d] / this->m_CurrentGridSpacing[d];
+    const double         first = localOffset[d] / this->m_CurrentGridSpacing[d];
+    const IndexValueType startIndex = this->m_CurrentGridRegion.GetIndex()[d];
+    const IndexValueType endIndex = startIndex + static_cast<IndexValueType>(currentSize[d]) - 1;
+    supportIndices[d].resize(requiredSize[d] * supportSize);
+    supportWeights[d].resize(requiredSize[d] * supportSize);
+    for (SizeValueType j = 0; j < requiredSize[d]; ++j)
+    {
+      const double requiredIndex =
+        static_cast<double>(this->m_RequiredGridRegion.GetIndex()[d]) + static_cast<double>(j);
+      const double x = first + ratio * requiredIndex;
+      Self::ComputeSupport(x,
+                           startIndex,
+                           endIndex,
+                           this->m_BSplineOrder,
+                           &supportIndices[d][j * supportSize],
+                           &supportWeights[d][j * supportSize]);
+    }
+  }
+
+  /** Upsample one dimension at a time: sample the current B-spline at the required
+   * nodes along the lines of that dimension, and compute the B-spline coefficients
+   * of these samples. The dimensions before the current one are already upsampled.
+   * Intermediate results alternate between two buffers; the last dimension writes
+   * directly into the output parameters.
+   */
+  std::vector<double> buffers[2];
+  for (unsigned int j = 0; j < Dimension; ++j)
+  {
+    const ValueType * source = parameters_in.data_block() + j * currentNumberOfPixels;
+    ValueType *       output = parameters_out.data_block() + j * requiredNumberOfPixels;
+    const double *    intermediate = nullptr;
+
+    SizeType size = currentSize;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      /** A line along d starts at a + stride * length * b. */
+      SizeValueType stride = 1;
+      for (unsigned int e = 0; e < d; ++e)
+      {
+        stride *= size[e];
+      }
+      const SizeValueType currentLength = size[d];
+      const SizeValueType requiredLength = requiredSize[d];
+      size[d] = requiredLength;
+      SizeValueType numberOfLinesOut = 1;
+      for (unsigned int e = 0; e < Dimension; ++e)
+      {
+        numberOfLinesOut *= (e == d) ? 1 : size[e];
+      }
+
+      const bool            last = (d == Dimension - 1);
+      double *              target = nullptr;
+      std::vector<double> & buffer = buffers[d % 2];
+      if (!last)
+      {
+        buffer.resize(numberOfLinesOut * requiredLength);
+        target = buffer.data();
+      }
+
+      const OffsetValueType * indices = supportIndices[d].data();
+      const double *          weights = supportWeights[d].data();
+      const unsigned int      order = this->m_BSplineOrder;
+      ParallelTasks::ParallelizeArray(
+        0,
+        numberOfLinesOut,
+        [=](const SizeValueType line) {
+          const SizeValueType a = line % stride;
+          const SizeValueType b = line / stride;
+          const SizeValueType inputStart = a + stride * currentLength * b;
+          const SizeValueType outputStart = a + stride * requiredLength * b;
+
+          /** Sample the B-spline along the line. */
+          std::vector<double> scratch(requiredLength);
+          for (SizeValueType i = 0; i < requiredLength; ++i)
+          {
+            double sum = 0.0;
+            for (unsigned int k = 0; k < supportSize; ++k)
+            {
+              const SizeValueType offset =
+                inputStart + stride * static_cast<SizeValueType>(indices[i * supportSize + k]);
+              const double value = intermediate ? intermediate[offset] : static_cast<double>(source[offset]);
+              sum += weights[i * supportSize + k] * value;
+            }
+            scratch[i] = sum;
+          }
+
+          /** Compute the coefficients, and store them. */
+          Self::DecomposeLine(scratch, order);
+          for (SizeValueType i = 0; i < requiredLength; ++i)
+          {
+            if (last)
+            {
+              output[outputStart + stride * i] = static_cast<ValueType>(scratch[i]);
+            }
+            else
+            {
+              target[outputStart + stride * i] = scratch[i];
+            }
+          }
+        });
+
+      intermediate = target;
+    } // end for d
+  }   // end for j
+
+} // end UpsampleParametersSeparable()
+
+
+/**
+ * ******************* ComputeSupport *******************
+ */
+
+template <class TArray, class TImage>
+void
+UpsampleBSplineParametersFilter<TArray, TImage>::ComputeSupport(const double         x,
+                                                                const IndexValueType startIndex,
+                                                                const IndexValueType endIndex,
+                                                                const unsigned int   order,
+                                                                OffsetValueType *    indices,
+                                                                double *             weights)
+{
+  /** Outside the current grid, the resampler gives zero. */
+  if (!(x >= startIndex - 0.5 && x < endIndex + 0.5))
+  {
+    std::fill_n(indices, order + 1, 0);
+    std::fill_n(weights, order + 1, 0.0);
+    return;
+  }
+
+  /** The region of support and the weights, as in the BSplineInterpolateImageFunction. */
+  const float    halfOffset = (order & 1) ? 0.0f : 0.5f;
+  IndexValueType index = Math::Floor<IndexValueType>(static_cast<float>(x) + halfOffset) - order / 2;
+  double         w = 0.0;
+  switch (order)
+  {
+    case 3:
+      w = x - static_cast<double>(index + 1);
+      weights[3] = (1.0 / 6.0) * w * w * w;
+      weights[0] = (1.0 / 6.0) + 0.5 * w * (w - 1.0) - weights[3];
+      weights[2] = w + weights[0] - 2.0 * weights[3];
+      weights[1] = 1.0 - weights[0] - weights[2] - weights[3];
+      break;
+    case 2:
+      w = x - static_cast<double>(index + 1);
+      weights[1] = 0.75 - w * w;
+      weights[2] = 0.5 * (w - weights[1] + 1.0);
+      weights[0] = 1.0 - weights[1] - weights[2];
+      break;
+    case 1:
+      w = x - static_cast<double>(index);
+      weights[1] = w;
+      weights[0] = 1.0 - w;
+      break;
+    default:
+      weights[0] = 1.0;
+      break;
+  }
+
+  /** Mirror the indices at the borders of the current grid. */
+  for (unsigned int k = 0; k <= order; ++k, ++index)
+  {
+    IndexValueType mirrored = index;
+    if (endIndex == startIndex)
+    {
+      mirrored = startIndex;
+    }
+    else
+    {
+      mirrored = (mirrored < startIndex) ? startIndex + (startIndex - mirrored) : mirrored;
+      mirrored = (mirrored >= endIndex) ? endIndex - (mirrored - endIndex) : mirrored;
+      mirrored = std::min(std::max(mirrored, startIndex), endIndex);
+    }
+    indices[k] = mirrored - startIndex;
+  }
+
+} // end ComputeSupport()
+
+
+/**
+ * ******************* DecomposeLine *******************
+ */
+
+template <class TArray, class TImage>
+void
+UpsampleBSplineParametersFilter<TArray, TImage>::DecomposeLine(std::vector<double> & c, const unsigned int order)
+{
+  /** Identical to the BSplineDecompositionImageFilter, with mirror boundaries,
+   * see Unser, 1999, Box 2.
+   */
+  const SizeValueType length = c.size();
+  if (length < 2 || order < 2)
+  {
+    return;
+  }
+  const double z = (order == 3) ? std::sqrt(3.0) - 2.0 : std::sqrt(8.0) - 3.0;
+  const double tolerance = 1e-10;
+
+  /** Apply the gain. */
+  const double gain = (1.0 - z) * (1.0 - 1.0 / z);
+  for (SizeValueType n = 0; n < length; ++n)
+  {
+    c[n] *= gain;
+  }
+
+  /** Causal initialization. */
+  double              zn = z;
+  const SizeValueType horizon = static_cast<SizeValueType>(std::ceil(std::log(tolerance) / std::log(std::fabs(z))));
+  if (horizon < length)
+  {
+    double sum = c[0];
+    for (SizeValueType n = 1; n < horizon; ++n)
+    {
+      sum += zn * c[n];
+      zn *= z;
+    }
+    c[0] = sum;
+  }
+  else
+  {
+    const double iz = 1.0 / z;
+    double       z2n = std::pow(z, static_cast<double>(length - 1));
+    double       sum = c[0] + z2n * c[length - 1];
+    z2n *= z2n * iz;
+    for (SizeValueType n = 1; n <= length - 2; ++n)
+    {
+      sum += (zn + z2n) * c[n];
+      zn *= z;
+      z2n *= iz;
+    }
+    c[0] = sum / (1.0 - zn * zn);
+  }
+
+  /** Causal recursion. */
+  for (SizeValueType n = 1; n < length; ++n)
+  {
+    c[n] += z * c[n - 1];
+  }
+
+  /** Anticausal initialization and recursion. */
+  c[length - 1] = (z / (z * z - 1.0)) * (z * c[length - 2] + c[length - 1]);
+  for (SizeValueType n = length - 1; n > 0; --n)
+  {
+    c[n - 1] = z * (c[n] - c[n - 1]);
+  }
+
+} // end DecomposeLine()
+
+
 /**
  * ******************* DoUpsampling *******************
  */
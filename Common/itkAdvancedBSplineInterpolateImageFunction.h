@@ -0,0 +1,245 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAdvancedBSplineInterpolateImageFunction_h
+#define itkAdvancedBSplineInterpolateImageFunction_h
+
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImagesAreIdentical.h"
+#include "itkMultiOrderBSplineDecompositionImageFilter.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace itk
+{
+/** \class AdvancedBSplineInterpolateImageFunction
+ * \brief A B-spline interpolator with a fused kernel for cubic 3D interpolation.
+ *
+ * This class is a drop-in replacement of the BSplineInterpolateImageFunction.
+ * For cubic splines in 3D, the value, or the value and the derivative, are
+ * computed in a single pass over the 4 x 4 x 4 coefficients. The weights and
+ * the derivative weights are computed in closed form for every dimension,
+ * and the coefficients are read directly from the buffer, with fixed-length
+ * inner loops that can be vectorised by the compiler. In all other cases the
+ * superclass implementation is used.
+ *
+ * The derivative is always computed with respect to the physical space,
+ * i.e. the image direction is taken into account.
+ *
+ * The coefficients are computed by a MultiOrderBSplineDecompositionImageFilter,
+ * which divides the lines of every dimension over the threads. Alternatively,
+ * the coefficients of another interpolator can be offered by SetCachedCoefficients().
+ * They are then used, instead of computing them again, when the next input image
+ * has the same geometry and pixel values as the image they were computed for,
+ * see ImagesAreIdentical(), and when neither has been modified since.
+ *
+ * Optionally, the fused cubic 3D kernel reads a copy of the coefficients that is
+ * quantized to 16 bits, see SetUseQuantizedCoefficients(). That halves the memory
+ * traffic of the kernel, compared to float coefficients. Because the weights of
+ * every dimension sum to one, the kernel works on the integers, and the scale and
+ * the offset of the quantization are applied only once to the result.
+ *
+ * \ingroup ImageFunctions ImageInterpolators
+ */
+template <class TImageType, class TCoordRep = double, class TCoefficientType = double>
+class ITK_TEMPLATE_EXPORT AdvancedBSplineInterpolateImageFunction
+  : public BSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>
+{
+public:
+  /** Standard class typedefs. */
+  typedef AdvancedBSplineInterpolateImageFunction                                   Self;
+  typedef BSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType> Superclass;
+  typedef SmartPointer<Self>                                                        Pointer;
+  typedef SmartPointer<const Self>                                                  ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(AdvancedBSplineInterpolateImageFunction, BSplineInterpolateImageFunction);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Dimension underlying input image. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass::ImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass::OutputType           OutputType;
+  typedef typename Superclass::InputImageType       InputImageType;
+  typedef typename Superclass::IndexType            IndexType;
+  typedef typename Superclass::ContinuousIndexType  ContinuousIndexType;
+  typedef typename Superclass::CoefficientDataType  CoefficientDataType;
+  typedef typename Superclass::CoefficientImageType CoefficientImageType;
+  typedef typename Superclass::CovariantVectorType  CovariantVectorType;
+
+  /** Set the input image, and compute or reuse the coefficients. */
+  void
+  SetInputImage(const TImageType * inputData) override;
+
+  /** Get the coefficients of the current input image. */
+  const CoefficientImageType *
+  GetCoefficients(void) const
+  {
+    return this->m_Coefficients.GetPointer();
+  }
+
+
+  /** Offer the coefficients of the given order, computed for the given image,
+   * for reuse by the next call of SetInputImage().
+   */
+  void
+  SetCachedCoefficients(const TImageType *           image,
+                        const CoefficientImageType * coefficients,
+                        const unsigned int           splineOrder);
+
+  /** Offer the coefficients of another interpolator, computed for its current input image,
+   * for reuse by the next call of SetInputImage(). The coefficients are then shared.
+   */
+  void
+  SetCachedCoefficients(const Self * interpolator);
+
+  /** Select the use of coefficients that are quantized to 16 bits, in the fused
+   * cubic 3D kernel. The quantization step is the range of the coefficients divided
+   * by 65534, so this is only suitable for images with at most about 14 bits of
+   * information, such as most CT and MR images. The full precision coefficients are
+   * still kept, for the other code paths. Should be set before SetInputImage().
+   * The default is false.
+   */
+  itkSetMacro(UseQuantizedCoefficients, bool);
+  itkGetConstMacro(UseQuantizedCoefficients, bool);
+  itkBooleanMacro(UseQuantizedCoefficients);
+
+  /** Evaluate the function at a continuous index position. */
+  OutputType
+  EvaluateAtContinuousIndex(const ContinuousIndexType & x) const override
+  {
+    OutputType value;
+    this->EvaluateOptimized(Dispatch<ImageDimension>(), x, value, nullptr);
+    return value;
+  }
+
+
+  /** Method to compute both the value and the derivative.
+   * Note that this method hides, and does not override, the superclass method.
+   */
+  void
+  EvaluateValueAndDerivativeAtContinuousIndex(const ContinuousIndexType & x,
+                                              OutputType &                value,
+                                              CovariantVectorType &       deriv) const
+  {
+    this->EvaluateOptimized(Dispatch<ImageDimension>(), x, value, &deriv);
+  }
+
+
+protected:
+  AdvancedBSplineInterpolateImageFunction();
+  ~AdvancedBSplineInterpolateImageFunction() override = default;
+
+private:
+  AdvancedBSplineInterpolateImageFunction(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Typedef for the multi-threaded computation of the coefficients. */
+  typedef MultiOrderBSplineDecompositionImageFilter<TImageType, CoefficientImageType> CoefficientFilterType;
+
+  /** Returns true when the cached coefficients belong to this image and the current spline order. */
+  bool
+  CachedCoefficientsMatch(const TImageType * inputData) const;
+
+  /** Helper struct to select the correct dimension. */
+  struct DispatchBase
+  {};
+  template <unsigned int>
+  struct Dispatch : public DispatchBase
+  {};
+
+  /** Compute the value, and the derivative when deriv is not null. 3D specialization. */
+  void
+  EvaluateOptimized(const Dispatch<3> &,
+                    const ContinuousIndexType & x,
+                    OutputType &                value,
+                    CovariantVectorType *       deriv) const;
+
+  /** Compute the value, and the derivative when deriv is not null. Generic. */
+  void
+  EvaluateOptimized(const DispatchBase &,
+                    const ContinuousIndexType & x,
+                    OutputType &                value,
+                    CovariantVectorType *       deriv) const
+  {
+    this->EvaluateUnOptimized(x, value, deriv);
+  }
+
+
+  /** Compute the value, and the derivative when deriv is not null, by the superclass. */
+  void
+  EvaluateUnOptimized(const ContinuousIndexType & x, OutputType & value, CovariantVectorType * deriv) const
+  {
+    if (deriv)
+    {
+      this->Superclass::EvaluateValueAndDerivativeAtContinuousIndex(x, value, *deriv);
+    }
+    else
+    {
+      value = this->Superclass::EvaluateAtContinuousIndex(x);
+    }
+  }
+
+
+  /** The fused cubic kernel in 3D. */
+  template <bool VComputeDerivative>
+  void
+  EvaluateCubic3D(const ContinuousIndexType & x, OutputType & value, CovariantVectorType * deriv) const;
+
+  /** The weighted sums of the 64 coefficients of the cubic kernel in 3D: the value,
+   * and the derivatives along x, y and z, if requested.
+   */
+  template <bool VComputeDerivative, class TBufferValue>
+  static void
+  SumCubic3D(const TBufferValue *  buffer,
+             const double          weights[3][4],
+             const double          derivativeWeights[3][4],
+             const OffsetValueType offsets[3][4],
+             double                sums[4]);
+
+  /** Fill or clear the 16-bit copy of the coefficients. */
+  void
+  UpdateQuantizedCoefficients(void);
+
+  typename CoefficientFilterType::Pointer m_CoefficientFilter;
+
+  /** The cached coefficients; the modified times detect changes after caching. */
+  typename TImageType::ConstPointer           m_CachedImage;
+  typename CoefficientImageType::ConstPointer m_CachedCoefficients;
+  ModifiedTimeType                            m_CachedImageMTime{ 0 };
+  ModifiedTimeType                            m_CachedCoefficientsMTime{ 0 };
+  unsigned int                                m_CachedSplineOrder{ 0 };
+
+  /** The 16-bit copy of the coefficients, with the same layout; coefficient = offset + scale * q. */
+  bool                      m_UseQuantizedCoefficients{ false };
+  std::vector<std::int16_t> m_QuantizedCoefficients;
+  double                    m_QuantizationScale{ 1.0 };
+  double                    m_QuantizationOffset{ 0.0 };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkAdvancedBSplineInterpolateImageFunction.hxx"
+#endif
+
+#endif // end #ifndef itkAdvancedBSplineInterpolateImageFunction_h
@@ -0,0 +1,395 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAdvancedBSplineInterpolateImageFunction_hxx
+#define itkAdvancedBSplineInterpolateImageFunction_hxx
+
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ***************** Constructor ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::
+  AdvancedBSplineInterpolateImageFunction()
+{
+  this->m_CoefficientFilter = CoefficientFilterType::New();
+
+} // end Constructor
+
+
+/**
+ * ***************** SetInputImage ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SetInputImage(
+  const TImageType * inputData)
+{
+  if (inputData == nullptr)
+  {
+    this->Superclass::SetInputImage(inputData);
+  }
+  else
+  {
+    this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+    if (this->CachedCoefficientsMatch(inputData))
+    {
+      this->m_Coefficients = this->m_CachedCoefficients;
+    }
+    else
+    {
+      this->m_CoefficientFilter->SetSplineOrder(this->m_SplineOrder);
+      this->m_CoefficientFilter->SetInput(inputData);
+      this->m_CoefficientFilter->Update();
+      this->m_Coefficients = this->m_CoefficientFilter->GetOutput();
+    }
+
+    /** Skip the superclass, which would compute the coefficients again. */
+    this->InterpolateImageFunction<TImageType, TCoordRep>::SetInputImage(inputData);
+  }
+
+  this->UpdateQuantizedCoefficients();
+
+  /** The cache is only offered to the next input image. */
+  this->m_CachedImage = nullptr;
+  this->m_CachedCoefficients = nullptr;
+
+} // end SetInputImage()
+
+
+/**
+ * ***************** SetCachedCoefficients ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SetCachedCoefficients(
+  const TImageType *           image,
+  const CoefficientImageType * coefficients,
+  const unsigned int           splineOrder)
+{
+  this->m_CachedImage = image;
+  this->m_CachedCoefficients = coefficients;
+  this->m_CachedImageMTime = image ? image->GetMTime() : 0;
+  this->m_CachedCoefficientsMTime = coefficients ? coefficients->GetMTime() : 0;
+  this->m_CachedSplineOrder = splineOrder;
+
+} // end SetCachedCoefficients()
+
+
+/**
+ * ***************** SetCachedCoefficients ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SetCachedCoefficients(
+  const Self * interpolator)
+{
+  this->SetCachedCoefficients(
+    interpolator->GetInputImage(), interpolator->GetCoefficients(), interpolator->GetSplineOrder());
+
+} // end SetCachedCoefficients()
+
+
+/**
+ * ***************** UpdateQuantizedCoefficients ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::UpdateQuantizedCoefficients(void)
+{
+  const CoefficientImageType * coefficients = this->m_Coefficients.GetPointer();
+  if (!this->m_UseQuantizedCoefficients || ImageDimension != 3 || this->m_SplineOrder != 3 ||
+      this->GetInputImage() == nullptr || coefficients == nullptr)
+  {
+    std::vector<std::int16_t>().swap(this->m_QuantizedCoefficients);
+    return;
+  }
+
+  const CoefficientDataType * buffer = coefficients->GetBufferPointer();
+  const SizeValueType         numberOfCoefficients = coefficients->GetBufferedRegion().GetNumberOfPixels();
+  if (numberOfCoefficients == 0)
+  {
+    std::vector<std::int16_t>().swap(this->m_QuantizedCoefficients);
+    return;
+  }
+
+  /** Map the range of the coefficients symmetrically onto [-32767, 32767]. */
+  const auto   minmax = std::minmax_element(buffer, buffer + numberOfCoefficients);
+  const double minimum = static_cast<double>(*minmax.first);
+  const double maximum = static_cast<double>(*minmax.second);
+  this->m_QuantizationOffset = 0.5 * (maximum + minimum);
+  this->m_QuantizationScale = maximum > minimum ? (maximum - minimum) / 65534.0 : 1.0;
+
+  const double inverseScale = 1.0 / this->m_QuantizationScale;
+  this->m_QuantizedCoefficients.resize(numberOfCoefficients);
+  for (SizeValueType i = 0; i < numberOfCoefficients; ++i)
+  {
+    const double q = std::round((static_cast<double>(buffer[i]) - this->m_QuantizationOffset) * inverseScale);
+    this->m_QuantizedCoefficients[i] = static_cast<std::int16_t>(std::min(std::max(q, -32767.0), 32767.0));
+  }
+
+} // end UpdateQuantizedCoefficients()
+
+
+/**
+ * ***************** CachedCoefficientsMatch ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+bool
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::CachedCoefficientsMatch(
+  const TImageType * inputData) const
+{
+  const TImageType *           cachedImage = this->m_CachedImage.GetPointer();
+  const CoefficientImageType * cachedCoefficients = this->m_CachedCoefficients.GetPointer();
+  if (cachedImage == nullptr || cachedCoefficients == nullptr)
+  {
+    return false;
+  }
+
+  /** Neither may have been modified after caching, and the order must be the same. */
+  if (cachedImage->GetMTime() != this->m_CachedImageMTime ||
+      cachedCoefficients->GetMTime() != this->m_CachedCoefficientsMTime ||
+      this->m_CachedSplineOrder != this->m_SplineOrder)
+  {
+    return false;
+  }
+
+  /** The images must have the same geometry and pixels, e.g. a pyramid output that is a graft
+   * of the original image, or the outputs of the same level of two pyramids of the same image.
+   */
+  return cachedCoefficients->GetBufferedRegion() == inputData->GetBufferedRegion() &&
+         ImagesAreIdentical(cachedImage, inputData);
+
+} // end CachedCoefficientsMatch()
+
+
+/**
+ * ***************** EvaluateOptimized ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::EvaluateOptimized(
+  const Dispatch<3> &,
+  const ContinuousIndexType & x,
+  OutputType &                value,
+  CovariantVectorType *       deriv) const
+{
+  if (this->m_SplineOrder != 3)
+  {
+    this->EvaluateUnOptimized(x, value, deriv);
+  }
+  else if (deriv)
+  {
+    this->EvaluateCubic3D<true>(x, value, deriv);
+  }
+  else
+  {
+    this->EvaluateCubic3D<false>(x, value, nullptr);
+  }
+
+} // end EvaluateOptimized()
+
+
+/**
+ * ***************** EvaluateCubic3D ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+template <bool VComputeDerivative>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::EvaluateCubic3D(
+  const ContinuousIndexType & x,
+  OutputType &                value,
+  CovariantVectorType *       deriv) const
+{
+  const CoefficientImageType * coefficients = this->m_Coefficients.GetPointer();
+  const CoefficientDataType *  buffer = coefficients->GetBufferPointer();
+  const OffsetValueType *      offsetTable = coefficients->GetOffsetTable();
+  const IndexType &            bufferStart = coefficients->GetBufferedRegion().GetIndex();
+
+  /** Compute the weights, the derivative weights and the (mirrored) buffer
+   * offsets of the 4 coefficients along every dimension.
+   */
+  double          weights[3][4];
+  double          derivativeWeights[3][4];
+  OffsetValueType offsets[3][4];
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    const IndexValueType first = Math::Floor<IndexValueType>(x[d]) - 1;
+    const double         t = x[d] - static_cast<double>(first + 1);
+    const double         t2 = t * t;
+    const double         s = 1.0 - t;
+
+    weights[d][0] = s * s * s / 6.0;
+    weights[d][1] = (3.0 * t2 * t - 6.0 * t2 + 4.0) / 6.0;
+    weights[d][2] = (-3.0 * t2 * t + 3.0 * t2 + 3.0 * t + 1.0) / 6.0;
+    weights[d][3] = t2 * t / 6.0;
+
+    if (VComputeDerivative)
+    {
+      derivativeWeights[d][0] = -0.5 * s * s;
+      derivativeWeights[d][1] = 1.5 * t2 - 2.0 * t;
+      derivativeWeights[d][2] = -1.5 * t2 + t + 0.5;
+      derivativeWeights[d][3] = 0.5 * t2;
+    }
+
+    /** Mirror boundary conditions, like the superclass. */
+    const IndexValueType startIndex = this->m_StartIndex[d];
+    const IndexValueType endIndex = this->m_EndIndex[d];
+    for (unsigned int k = 0; k < 4; ++k)
+    {
+      IndexValueType index = first + k;
+      if (this->m_DataLength[d] == 1)
+      {
+        index = startIndex;
+      }
+      else
+      {
+        if (index < startIndex)
+        {
+          index = 2 * startIndex - index;
+        }
+        if (index >= endIndex)
+        {
+          index = 2 * endIndex - index;
+        }
+      }
+      offsets[d][k] = (index - bufferStart[d]) * offsetTable[d];
+    }
+  }
+
+  /** Single pass over the 64 coefficients, either the quantized or the full precision ones. */
+  double sums[4];
+  if (!this->m_QuantizedCoefficients.empty())
+  {
+    Self::SumCubic3D<VComputeDerivative>(
+      this->m_QuantizedCoefficients.data(), weights, derivativeWeights, offsets, sums);
+
+    /** The weights sum to one, and the derivative weights to zero. */
+    sums[0] = this->m_QuantizationOffset + this->m_QuantizationScale * sums[0];
+    for (unsigned int d = 1; d < 4; ++d)
+    {
+      sums[d] *= this->m_QuantizationScale;
+    }
+  }
+  else
+  {
+    Self::SumCubic3D<VComputeDerivative>(buffer, weights, derivativeWeights, offsets, sums);
+  }
+
+  value = static_cast<OutputType>(sums[0]);
+
+  /** Take the spacing and the direction into account. */
+  if (VComputeDerivative)
+  {
+    const InputImageType * inputImage = this->GetInputImage();
+    const auto &           spacing = inputImage->GetSpacing();
+
+    CovariantVectorType derivative;
+    derivative[0] = sums[1] / spacing[0];
+    derivative[1] = sums[2] / spacing[1];
+    derivative[2] = sums[3] / spacing[2];
+    inputImage->TransformLocalVectorToPhysicalVector(derivative, *deriv);
+  }
+
+} // end EvaluateCubic3D()
+
+
+/**
+ * ***************** SumCubic3D ***********************
+ */
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+template <bool VComputeDerivative, class TBufferValue>
+void
+AdvancedBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SumCubic3D(
+  const TBufferValue *  buffer,
+  const double          weights[3][4],
+  const double          derivativeWeights[3][4],
+  const OffsetValueType offsets[3][4],
+  double                sums[4])
+{
+  /** Every row along x is reduced with the x weights, the rows are then
+   * reduced along y and finally along z.
+   */
+  double interpolated = 0.0;
+  double derivativeX = 0.0;
+  double derivativeY = 0.0;
+  double derivativeZ = 0.0;
+  for (unsigned int k = 0; k < 4; ++k)
+  {
+    double sumY = 0.0;
+    double sumDerivativeX = 0.0;
+    double sumDerivativeY = 0.0;
+    for (unsigned int j = 0; j < 4; ++j)
+    {
+      const TBufferValue * row = buffer + offsets[2][k] + offsets[1][j];
+
+      double sumX = 0.0;
+      double sumXDerivative = 0.0;
+      for (unsigned int i = 0; i < 4; ++i)
+      {
+        const double c = static_cast<double>(row[offsets[0][i]]);
+        sumX += weights[0][i] * c;
+        if (VComputeDerivative)
+        {
+          sumXDerivative += derivativeWeights[0][i] * c;
+        }
+      }
+
+      sumY += weights[1][j] * sumX;
+      if (VComputeDerivative)
+      {
+        sumDerivativeX += weights[1][j] * sumXDerivative;
+        sumDerivativeY += derivativeWeights[1][j] * sumX;
+      }
+    }
+
+    interpolated += weights[2][k] * sumY;
+    if (VComputeDerivative)
+    {
+      derivativeX += weights[2][k] * sumDerivativeX;
+      derivativeY += weights[2][k] * sumDerivativeY;
+      derivativeZ += derivativeWeights[2][k] * sumY;
+    }
+  }
+
+  sums[0] = interpolated;
+  sums[1] = derivativeX;
+  sums[2] = derivativeY;
+  sums[3] = derivativeZ;
+
+} // end SumCubic3D()
+
+} // end namespace itk
+
+#endif // end #ifndef itkAdvancedBSplineInterpolateImageFunction_hxx
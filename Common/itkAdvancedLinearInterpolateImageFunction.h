@@ -19,6 +19,7 @@
 #define itkAdvancedLinearInterpolateImageFunction_h
 
 #include "itkLinearInterpolateImageFunction.h"
+#include "itkBrickedImageBuffer.h"
 
 namespace itk
 {
@@ -50,6 +51,12 @@ namespace itk
  * We opt to subtract a small number from x, which is computationally efficient,
  * gives cleaner code, and almost exactly the same interpolated value.
  *
+ * Optionally, the 2D and 3D value and derivative kernels read the corners
+ * from a bricked copy of the input image (see BrickedImageBuffer), which is
+ * made when the input image is set. This reduces the number of cache misses
+ * for images that do not fit in the cache, at the cost of a second copy of
+ * the image in memory.
+ *
  * \sa VectorAdvancedLinearInterpolateImageFunction
  *
  * \ingroup ImageFunctions ImageInterpolators
@@ -116,6 +123,16 @@ public:
   }
 
 
+  /** Set the input image. The bricked copy is made here, when it is asked for. */
+  void
+  SetInputImage(const InputImageType * ptr) override;
+
+  /** Read the corners of the linear interpolation from a bricked copy of the input image. */
+  virtual void
+  SetUseBrickedImage(const bool _arg);
+  itkGetConstMacro(UseBrickedImage, bool);
+  itkBooleanMacro(UseBrickedImage);
+
 protected:
   AdvancedLinearInterpolateImageFunction();
   ~AdvancedLinearInterpolateImageFunction() override = default;
@@ -125,6 +142,25 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Typedef for the bricked copy of the input image. */
+  typedef BrickedImageBuffer<InputPixelType, ImageDimension> BrickedImageType;
+
+  /** (Re)make or release the bricked copy of the input image. */
+  void
+  UpdateBrickedImage(void);
+
+  /** Get the value of a corner, from the bricked copy when there is one. */
+  RealType
+  GetCornerValue(const InputImageType * inputImage, const IndexType & index) const
+  {
+    if (this->m_BrickedImage.IsEmpty())
+    {
+      return inputImage->GetPixel(index);
+    }
+    return this->m_BrickedImage.GetPixel(index);
+  }
+
+
   /** Helper struct to select the correct dimension. */
   struct DispatchBase
   {};
@@ -166,6 +202,10 @@ private:
     itkExceptionMacro(<< "ERROR: EvaluateValueAndDerivativeAtContinuousIndex() "
                       << "is not implemented for this dimension (" << ImageDimension << ").");
   }
+
+
+  bool             m_UseBrickedImage{ false };
+  BrickedImageType m_BrickedImage;
 };
 
 } // end namespace itk
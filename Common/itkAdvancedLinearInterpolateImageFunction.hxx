@@ -32,6 +32,61 @@ namespace itk
 template <class TInputImage, class TCoordRep>
 AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::AdvancedLinearInterpolateImageFunction() = default;
 
+/**
+ * ***************** SetInputImage ***********************
+ */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::SetInputImage(const InputImageType * ptr)
+{
+  this->Superclass::SetInputImage(ptr);
+  this->UpdateBrickedImage();
+
+} // end SetInputImage()
+
+
+/**
+ * ***************** SetUseBrickedImage ***********************
+ */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::SetUseBrickedImage(const bool _arg)
+{
+  if (this->m_UseBrickedImage != _arg)
+  {
+    this->m_UseBrickedImage = _arg;
+    this->UpdateBrickedImage();
+    this->Modified();
+  }
+
+} // end SetUseBrickedImage()
+
+
+/**
+ * ***************** UpdateBrickedImage ***********************
+ */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::UpdateBrickedImage(void)
+{
+  const InputImageType * inputImage = this->GetInputImage();
+  if (!this->m_UseBrickedImage || inputImage == nullptr)
+  {
+    this->m_BrickedImage.Clear();
+    return;
+  }
+
+  /** Bricks of 8 voxels along each dimension. */
+  typename BrickedImageType::BrickSizeLog2Type brickSizeLog2;
+  brickSizeLog2.Fill(3);
+  this->m_BrickedImage.Initialize(inputImage, brickSizeLog2);
+
+} // end UpdateBrickedImage()
+
+
 /**
  * ***************** EvaluateDerivativeAtContinuousIndex ***********************
  */
@@ -126,14 +181,14 @@ AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::EvaluateValueAnd
   }
 
   /** Get the 4 corner values. */
-  const RealType val00 = inputImage->GetPixel(baseIndex);
+  const RealType val00 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[0];
-  const RealType val10 = inputImage->GetPixel(baseIndex);
+  const RealType val10 = this->GetCornerValue(inputImage, baseIndex);
   --baseIndex[0];
   ++baseIndex[1];
-  const RealType val01 = inputImage->GetPixel(baseIndex);
+  const RealType val01 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[0];
-  const RealType val11 = inputImage->GetPixel(baseIndex);
+  const RealType val11 = this->GetCornerValue(inputImage, baseIndex);
 
   /** Interpolate to get the value. */
   value = static_cast<OutputType>(val00 * dinv[0] * dinv[1] + val10 * dist[0] * dinv[1] + val01 * dinv[0] * dist[1] +
@@ -208,21 +263,21 @@ AdvancedLinearInterpolateImageFunction<TInputImage, TCoordRep>::EvaluateValueAnd
   }
 
   /** Get the 8 corner values. */
-  const RealType val000 = inputImage->GetPixel(baseIndex);
+  const RealType val000 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[0];
-  const RealType val100 = inputImage->GetPixel(baseIndex);
+  const RealType val100 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[1];
-  const RealType val110 = inputImage->GetPixel(baseIndex);
+  const RealType val110 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[2];
-  const RealType val111 = inputImage->GetPixel(baseIndex);
+  const RealType val111 = this->GetCornerValue(inputImage, baseIndex);
   --baseIndex[1];
-  const RealType val101 = inputImage->GetPixel(baseIndex);
+  const RealType val101 = this->GetCornerValue(inputImage, baseIndex);
   --baseIndex[0];
-  const RealType val001 = inputImage->GetPixel(baseIndex);
+  const RealType val001 = this->GetCornerValue(inputImage, baseIndex);
   ++baseIndex[1];
-  const RealType val011 = inputImage->GetPixel(baseIndex);
+  const RealType val011 = this->GetCornerValue(inputImage, baseIndex);
   --baseIndex[2];
-  const RealType val010 = inputImage->GetPixel(baseIndex);
+  const RealType val010 = this->GetCornerValue(inputImage, baseIndex);
 
   /** Interpolate to get the value. */
   value = static_cast<OutputType>(val000 * dinv[0] * dinv[1] * dinv[2] + val100 * dist[0] * dinv[1] * dinv[2] +
@@ -48,6 +48,13 @@ namespace itk
  * image and uses bilinear interpolation to integrate each plane of
  * voxels traversed.
  *
+ * Only voxels above the threshold contribute to the integral. The bounding
+ * box of these voxels is therefore computed once, when the input image or the
+ * threshold is set, and every ray is clipped to the planes of voxels that
+ * intersect this box. Rays that miss the box are not traversed at all. The
+ * interpolator is thread safe, so the rays of a projection image are cast in
+ * parallel by the threads of the (resample) filter that evaluates it.
+ *
  * \warning This interpolator works for 3-dimensional images only.
  *
  * \ingroup ImageFunctions
@@ -80,7 +87,8 @@ public:
 
   typedef typename Superclass::InputPixelType PixelType;
 
-  typedef typename TInputImage::SizeType SizeType;
+  typedef typename TInputImage::SizeType   SizeType;
+  typedef typename TInputImage::RegionType RegionType;
 
   typedef Vector<TCoordRep, InputImageDimension> DirectionType;
 
@@ -158,11 +166,19 @@ public:
   /** Get a pointer to the Interpolator.  */
   itkGetConstMacro(FocalPoint, InputPointType);
 
-  /** Connect the Transform. */
-  itkSetMacro(Threshold, double);
-  /** Get a pointer to the Transform.  */
+  /** Set the threshold above which voxels are integrated. This also updates
+   * the region of voxels above the threshold.
+   */
+  virtual void
+  SetThreshold(const double threshold);
+
+  /** Get the threshold above which voxels are integrated. */
   itkGetConstMacro(Threshold, double);
 
+  /** Set the input image. This also updates the region of voxels above the threshold. */
+  void
+  SetInputImage(const InputImageType * ptr) override;
+
   /** Check if a point is inside the image buffer.
    * \warning For efficiency, no validity checking of
    * the input image pointer is done. */
@@ -215,6 +231,22 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Compute the bounding box of the voxels above the threshold, in voxel
+   * coordinates relative to the start of the image. The box is only used when
+   * the input image is fully buffered; otherwise the rays are not clipped.
+   */
+  void
+  ComputeIntegrationRegion(void);
+
+  /// The bounding box of the voxels above the threshold
+  RegionType m_IntegrationRegion;
+
+  /// Flag indicating whether the rays are clipped to the integration region
+  bool m_UseIntegrationRegion;
+
+  /// The modification time of the input image when the integration region was computed
+  ModifiedTimeType m_IntegrationRegionMTime;
+
   SizeType
   GetRadius() const override
   {
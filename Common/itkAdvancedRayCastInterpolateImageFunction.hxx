@@ -36,8 +36,11 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm> // For min and max.
+
 // Put the helper class in an anonymous namespace so that it is not
 // exposed to the user
 namespace
@@ -83,6 +86,23 @@ public:
   }
 
 
+  /**
+   * Set the box of voxels, in voxel coordinates, outside of which the volume
+   * does not contribute to the integral. Rays are clipped to the planes of
+   * voxels that intersect this box. Call after ZeroState() and before SetRay().
+   */
+  void
+  SetClipRegion(const int lower[3], const int upper[3])
+  {
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      m_ClipLower[i] = lower[i];
+      m_ClipUpper[i] = upper[i];
+    }
+    m_UseClipRegion = true;
+  }
+
+
   /**
    *  Initialise the ray using the position and direction of a line.
    *
@@ -241,6 +261,13 @@ protected:
   bool
   CalcRayIntercepts(void);
 
+  /**
+   * Clip the ray to the planes of voxels whose four interpolation voxels
+   * intersect the clip region, and reset the iterator to the new start.
+   */
+  void
+  ClipRayToRegion(void);
+
   /**
    *   The ray is traversed by stepping in the axial direction
    *   that enables the greatest number of planes in the volume to be
@@ -314,6 +341,13 @@ protected:
    */
   int m_RayIntersectionVoxelIndex[3];
 
+  /// Flag indicating whether the ray is clipped to the clip region
+  bool m_UseClipRegion;
+
+  /// The first and last voxel of the clip region along each axis
+  int m_ClipLower[3];
+  int m_ClipUpper[3];
+
   /// The dimension in voxels of the 3D volume in along the x axis
   int m_NumberOfVoxelsInX;
   /// The dimension in voxels of the 3D volume in along the y axis
@@ -795,10 +829,87 @@ RayCastHelper<TInputImage, TCoordRep>::SetRay(OutputPointType RayPosn, Direction
 
   Reset();
 
+  // Skip the planes of voxels that do not contribute to the integral.
+
+  if (m_ValidRay && m_UseClipRegion)
+  {
+    this->ClipRayToRegion();
+  }
+
   return m_ValidRay;
 }
 
 
+/* -----------------------------------------------------------------------
+   ClipRayToRegion() - Clip the ray to the clip region
+   ----------------------------------------------------------------------- */
+
+template <class TInputImage, class TCoordRep>
+void
+RayCastHelper<TInputImage, TCoordRep>::ClipRayToRegion(void)
+{
+  /* In the planes being traversed the interpolation uses the voxels at
+     'int' and 'int + 1' of the position, along the traversal direction only
+     the voxel at 'int'. A plane of voxels can therefore only contribute if
+     the position lies in [lower - 1, upper + 1) for the in-plane components
+     and in [lower, upper + 1) for the traversal component. */
+
+  int traversalAxis = 0;
+  if (m_TraversalDirection == TRANSVERSE_IN_Y)
+  {
+    traversalAxis = 1;
+  }
+  else if (m_TraversalDirection == TRANSVERSE_IN_Z)
+  {
+    traversalAxis = 2;
+  }
+
+  double firstPlane = 0.;
+  double lastPlane = m_TotalRayVoxelPlanes - 1;
+
+  for (int i = 0; i < 3; ++i)
+  {
+    const double lower = (i == traversalAxis) ? m_ClipLower[i] : m_ClipLower[i] - 1.;
+    const double upper = m_ClipUpper[i] + 1.;
+
+    if (std::fabs(m_VoxelIncrement[i]) < 1e-12)
+    {
+      if ((m_RayVoxelStartPosition[i] < lower) || (m_RayVoxelStartPosition[i] >= upper))
+      {
+        lastPlane = -1.;
+      }
+      continue;
+    }
+
+    const double t1 = (lower - m_RayVoxelStartPosition[i]) / m_VoxelIncrement[i];
+    const double t2 = (upper - m_RayVoxelStartPosition[i]) / m_VoxelIncrement[i];
+
+    firstPlane = std::max(firstPlane, std::min(t1, t2));
+    lastPlane = std::min(lastPlane, std::max(t1, t2));
+  }
+
+  if (lastPlane < firstPlane)
+  {
+    m_TotalRayVoxelPlanes = 0;
+    return;
+  }
+
+  /* Keep a margin of one plane at both ends, since the position of the
+     iterator is accumulated plane by plane. */
+
+  const int first = std::max(0, static_cast<int>(std::floor(firstPlane)) - 1);
+  const int last = std::min(m_TotalRayVoxelPlanes - 1, static_cast<int>(std::ceil(lastPlane)) + 1);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    m_RayVoxelStartPosition[i] += first * m_VoxelIncrement[i];
+  }
+  m_TotalRayVoxelPlanes = last - first + 1;
+
+  Reset();
+}
+
+
 /* -----------------------------------------------------------------------
    EndPointsInVoxels() - Convert the endpoints to voxels
    ----------------------------------------------------------------------- */
@@ -1421,6 +1532,8 @@ RayCastHelper<TInputImage, TCoordRep>::ZeroState()
 
   m_ValidRay = false;
 
+  m_UseClipRegion = false;
+
   m_NumberOfVoxelsInX = 0;
   m_NumberOfVoxelsInY = 0;
   m_NumberOfVoxelsInZ = 0;
@@ -1491,6 +1604,102 @@ AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::AdvancedRayCast
   m_FocalPoint[0] = 0.;
   m_FocalPoint[1] = 0.;
   m_FocalPoint[2] = 0.;
+
+  m_UseIntegrationRegion = false;
+  m_IntegrationRegionMTime = 0;
+}
+
+
+/* -----------------------------------------------------------------------
+   SetThreshold
+   ----------------------------------------------------------------------- */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::SetThreshold(const double threshold)
+{
+  if (m_Threshold != threshold)
+  {
+    m_Threshold = threshold;
+    this->ComputeIntegrationRegion();
+    this->Modified();
+  }
+}
+
+
+/* -----------------------------------------------------------------------
+   SetInputImage
+   ----------------------------------------------------------------------- */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::SetInputImage(const InputImageType * ptr)
+{
+  this->Superclass::SetInputImage(ptr);
+  this->ComputeIntegrationRegion();
+}
+
+
+/* -----------------------------------------------------------------------
+   ComputeIntegrationRegion
+   ----------------------------------------------------------------------- */
+
+template <class TInputImage, class TCoordRep>
+void
+AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::ComputeIntegrationRegion(void)
+{
+  m_UseIntegrationRegion = false;
+
+  const InputImageType * const input = this->m_Image;
+  if (!input || !input->GetBufferPointer() || input->GetBufferedRegion() != input->GetLargestPossibleRegion())
+  {
+    return;
+  }
+
+  /** Find the bounding box of the voxels above the threshold. */
+  const RegionType & region = input->GetLargestPossibleRegion();
+  const IndexType    start = region.GetIndex();
+
+  IndexType lower;
+  IndexType upper;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    lower[i] = static_cast<IndexValueType>(region.GetSize()[i]);
+    upper[i] = -1;
+  }
+
+  bool found = false;
+
+  ImageRegionConstIteratorWithIndex<InputImageType> it(input, region);
+  for (; !it.IsAtEnd(); ++it)
+  {
+    if (static_cast<double>(it.Get()) > m_Threshold)
+    {
+      const IndexType index = it.GetIndex();
+      for (unsigned int i = 0; i < ImageDimension; ++i)
+      {
+        lower[i] = std::min(lower[i], index[i] - start[i]);
+        upper[i] = std::max(upper[i], index[i] - start[i]);
+      }
+      found = true;
+    }
+  }
+
+  /** Without voxels above the threshold every ray integrates to zero. */
+  typename RegionType::SizeType size;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    size[i] = found ? static_cast<SizeValueType>(upper[i] - lower[i] + 1) : 0;
+    if (!found)
+    {
+      lower[i] = 0;
+    }
+  }
+
+  m_IntegrationRegion.SetIndex(lower);
+  m_IntegrationRegion.SetSize(size);
+  m_IntegrationRegionMTime = input->GetMTime();
+  m_UseIntegrationRegion = true;
 }
 
 
@@ -1508,6 +1717,8 @@ AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::PrintSelf(std::
   os << indent << "FocalPoint: " << m_FocalPoint << std::endl;
   os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
+  os << indent << "UseIntegrationRegion: " << m_UseIntegrationRegion << std::endl;
+  os << indent << "IntegrationRegion: " << m_IntegrationRegion << std::endl;
 }
 
 
@@ -1530,6 +1741,25 @@ AdvancedRayCastInterpolateImageFunction<TInputImage, TCoordRep>::Evaluate(const
   ray.ZeroState();
   ray.Initialise();
 
+  /* Clip the ray to the voxels above the threshold, unless the image has
+     been modified since their bounding box was computed. */
+  if (m_UseIntegrationRegion && this->m_Image->GetMTime() == m_IntegrationRegionMTime)
+  {
+    if (m_IntegrationRegion.GetNumberOfPixels() == 0)
+    {
+      return static_cast<OutputType>(integral);
+    }
+
+    int lower[3];
+    int upper[3];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      lower[i] = static_cast<int>(m_IntegrationRegion.GetIndex()[i]);
+      upper[i] = lower[i] + static_cast<int>(m_IntegrationRegion.GetSize()[i]) - 1;
+    }
+    ray.SetClipRegion(lower, upper);
+  }
+
   ray.SetRay(point, direction);
   ray.IntegrateAboveThreshold(integral, m_Threshold);
 
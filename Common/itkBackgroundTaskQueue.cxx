@@ -0,0 +1,154 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkBackgroundTaskQueue.h"
+
+#include <algorithm> // For max.
+#include <exception>
+#include <utility> // For move.
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+BackgroundTaskQueue::BackgroundTaskQueue(const unsigned int maximumNumberOfPendingTasks)
+  : m_MaximumNumberOfPendingTasks(std::max(maximumNumberOfPendingTasks, 1u))
+{} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+BackgroundTaskQueue::~BackgroundTaskQueue()
+{
+  {
+    const std::lock_guard<std::mutex> lock(this->m_Mutex);
+    this->m_Stopping = true;
+  }
+  this->m_Condition.notify_all();
+  if (this->m_Thread.joinable())
+  {
+    this->m_Thread.join();
+  }
+
+} // end Destructor
+
+
+/**
+ * ********************* Push ****************************
+ */
+
+void
+BackgroundTaskQueue::Push(TaskType task)
+{
+  {
+    std::unique_lock<std::mutex> lock(this->m_Mutex);
+    this->m_Condition.wait(lock, [this] { return this->m_Tasks.size() < this->m_MaximumNumberOfPendingTasks; });
+    this->m_Tasks.push_back(std::move(task));
+
+    if (!this->m_Thread.joinable())
+    {
+      this->m_Thread = std::thread(&BackgroundTaskQueue::Run, this);
+    }
+  }
+  this->m_Condition.notify_all();
+
+} // end Push()
+
+
+/**
+ * ********************* Wait ****************************
+ */
+
+void
+BackgroundTaskQueue::Wait(void)
+{
+  std::unique_lock<std::mutex> lock(this->m_Mutex);
+  this->m_Condition.wait(lock, [this] { return this->m_Tasks.empty() && !this->m_TaskRunning; });
+
+} // end Wait()
+
+
+/**
+ * ********************* TakeErrorMessages ****************************
+ */
+
+std::vector<std::string>
+BackgroundTaskQueue::TakeErrorMessages(void)
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  std::vector<std::string>          errorMessages;
+  errorMessages.swap(this->m_ErrorMessages);
+  return errorMessages;
+
+} // end TakeErrorMessages()
+
+
+/**
+ * ********************* Run ****************************
+ */
+
+void
+BackgroundTaskQueue::Run(void)
+{
+  std::unique_lock<std::mutex> lock(this->m_Mutex);
+  while (true)
+  {
+    this->m_Condition.wait(lock, [this] { return this->m_Stopping || !this->m_Tasks.empty(); });
+    if (this->m_Tasks.empty())
+    {
+      /** Stopping, and all tasks are done. */
+      return;
+    }
+
+    TaskType task = std::move(this->m_Tasks.front());
+    this->m_Tasks.pop_front();
+    this->m_TaskRunning = true;
+    lock.unlock();
+    this->m_Condition.notify_all();
+
+    std::string errorMessage;
+    try
+    {
+      task();
+    }
+    catch (const std::exception & excp)
+    {
+      errorMessage = excp.what();
+    }
+    catch (...)
+    {
+      errorMessage = "Unknown exception.";
+    }
+
+    lock.lock();
+    this->m_TaskRunning = false;
+    if (!errorMessage.empty())
+    {
+      this->m_ErrorMessages.push_back(errorMessage);
+    }
+    this->m_Condition.notify_all();
+  }
+
+} // end Run()
+
+
+} // end namespace itk
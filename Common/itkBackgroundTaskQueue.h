@@ -0,0 +1,88 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBackgroundTaskQueue_h
+#define itkBackgroundTaskQueue_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+/** \class BackgroundTaskQueue
+ * \brief Runs tasks, one after the other, in a background thread.
+ *
+ * The tasks are run in the order in which they are pushed. At most MaximumNumberOfPendingTasks
+ * tasks wait to be run; Push() blocks while that many are waiting, which bounds the memory used
+ * by the data of the tasks. The thread is started by the first Push(), and stopped by the
+ * destructor, after the remaining tasks are done.
+ *
+ * An exception thrown by a task does not stop the queue. Its message is stored, and can be
+ * retrieved by TakeErrorMessages(), in the thread that pushes the tasks.
+ *
+ * \ingroup Common
+ */
+
+class BackgroundTaskQueue
+{
+public:
+  typedef std::function<void()> TaskType;
+
+  explicit BackgroundTaskQueue(const unsigned int maximumNumberOfPendingTasks);
+
+  /** Waits until all tasks are done, and stops the thread. */
+  ~BackgroundTaskQueue();
+
+  /** Adds a task to the queue. Blocks while the queue is full. */
+  void
+  Push(TaskType task);
+
+  /** Waits until all tasks that have been pushed are done. */
+  void
+  Wait(void);
+
+  /** Returns the messages of the exceptions thrown by the tasks since the previous call. */
+  std::vector<std::string>
+  TakeErrorMessages(void);
+
+private:
+  BackgroundTaskQueue(const BackgroundTaskQueue &) = delete;
+  void
+  operator=(const BackgroundTaskQueue &) = delete;
+
+  /** The function of the background thread. */
+  void
+  Run(void);
+
+  const unsigned int       m_MaximumNumberOfPendingTasks;
+  std::deque<TaskType>     m_Tasks;
+  bool                     m_TaskRunning{ false };
+  bool                     m_Stopping{ false };
+  std::vector<std::string> m_ErrorMessages;
+  std::mutex               m_Mutex;
+  std::condition_variable  m_Condition;
+  std::thread              m_Thread;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkBackgroundTaskQueue_h
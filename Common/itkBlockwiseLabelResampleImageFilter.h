@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBlockwiseLabelResampleImageFilter_h
+#define itkBlockwiseLabelResampleImageFilter_h
+
+#include "itkResampleImageFilter.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+
+namespace itk
+{
+/**
+ * \class BlockwiseLabelResampleImageFilter
+ * \brief Resamples a label image, evaluating the transform only at the corners of blocks of output voxels.
+ *
+ * Label images are piecewise constant, so with nearest neighbor interpolation most blocks of
+ * output voxels map to a single label. This filter divides the output region into blocks of
+ * BlockSize voxels along each dimension, and maps only the corners of each block. When the
+ * moving image voxels around the mapped corners (their bounding box, grown by one voxel) all
+ * have the same label, the block is filled with that label. Otherwise, near label boundaries
+ * and near the border of the moving image, every voxel of the block is resampled exactly, by
+ * the ResampleImageFilter.
+ *
+ * This is an approximation: the other voxels of the block, including those on its border, are
+ * not mapped to check the uniformity, as that would cost nearly as many transform evaluations as
+ * resampling the block itself. The result equals that of the ResampleImageFilter as long as, inside
+ * a block, the transform maps no voxel more than one voxel outside the bounding box of the mapped
+ * corners. This holds for smooth transforms and a small block size, but not necessarily for a
+ * transform that folds, or that varies faster than the block size, in which case a smaller
+ * BlockSize, or a BlockSize of 1, should be used. The filter behaves like the ResampleImageFilter
+ * when the interpolator is not a nearest neighbor interpolator, when the transform is linear
+ * (for which the ResampleImageFilter is already efficient), or when the block size is 1.
+ *
+ * \sa ResampleImageFilter
+ * \ingroup GeometricTransforms
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType = double>
+class ITK_TEMPLATE_EXPORT BlockwiseLabelResampleImageFilter
+  : public ResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>
+{
+public:
+  /** Standard ITK stuff. */
+  typedef BlockwiseLabelResampleImageFilter                                          Self;
+  typedef ResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType> Superclass;
+  typedef SmartPointer<Self>                                                         Pointer;
+  typedef SmartPointer<const Self>                                                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BlockwiseLabelResampleImageFilter, ResampleImageFilter);
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType        InputImageType;
+  typedef typename Superclass::OutputImageType       OutputImageType;
+  typedef typename Superclass::TransformType         TransformType;
+  typedef typename Superclass::InterpolatorType      InterpolatorType;
+  typedef typename Superclass::IndexType             IndexType;
+  typedef typename Superclass::PixelType             PixelType;
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
+  /** The image dimension. */
+  itkStaticConstMacro(ImageDimension, unsigned int, OutputImageType::ImageDimension);
+
+  /** The interpolator for which the blockwise resampling is done. */
+  typedef NearestNeighborInterpolateImageFunction<InputImageType, TInterpolatorPrecisionType>
+    NearestNeighborInterpolatorType;
+
+  /** Set/Get the number of output voxels of a block, along each dimension. Default: 4. */
+  itkSetClampMacro(BlockSize, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(BlockSize, unsigned int);
+
+protected:
+  BlockwiseLabelResampleImageFilter() = default;
+  ~BlockwiseLabelResampleImageFilter() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Resamples the blocks of the output region. */
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  /** Checks whether the moving image is the same label around all mapped corners
+   * of the block. If so, returns true, and sets the label. Only the corners are
+   * mapped, see the class description.
+   */
+  bool
+  IsUniformBlock(const OutputImageRegionType & block, PixelType & label) const;
+
+private:
+  BlockwiseLabelResampleImageFilter(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  unsigned int m_BlockSize{ 4 };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkBlockwiseLabelResampleImageFilter.hxx"
+#endif
+
+#endif // end #ifndef itkBlockwiseLabelResampleImageFilter_h
@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBlockwiseLabelResampleImageFilter_hxx
+#define itkBlockwiseLabelResampleImageFilter_hxx
+
+#include "itkBlockwiseLabelResampleImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkTotalProgressReporter.h"
+#include <algorithm> // For min.
+
+namespace itk
+{
+
+/**
+ * ******************* DynamicThreadedGenerateData *******************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+BlockwiseLabelResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  const TransformType * transform = this->GetTransform();
+  const bool            isNearestNeighbor =
+    dynamic_cast<const NearestNeighborInterpolatorType *>(this->GetInterpolator()) != nullptr;
+
+  if (!isNearestNeighbor || this->m_BlockSize <= 1 ||
+      transform->GetTransformCategory() == TransformType::TransformCategoryEnum::Linear)
+  {
+    this->Superclass::DynamicThreadedGenerateData(outputRegionForThread);
+    return;
+  }
+
+  OutputImageType *  output = this->GetOutput();
+  const unsigned int blockSize = this->m_BlockSize;
+  const IndexType &  regionIndex = outputRegionForThread.GetIndex();
+  const auto &       regionSize = outputRegionForThread.GetSize();
+
+  TotalProgressReporter progress(this, output->GetRequestedRegion().GetNumberOfPixels());
+
+  /** The number of blocks along each dimension; the last ones may be smaller. */
+  SizeValueType numberOfBlocks[ImageDimension];
+  SizeValueType totalNumberOfBlocks = 1;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    numberOfBlocks[i] = (regionSize[i] + blockSize - 1) / blockSize;
+    totalNumberOfBlocks *= numberOfBlocks[i];
+  }
+
+  for (SizeValueType b = 0; b < totalNumberOfBlocks; ++b)
+  {
+    OutputImageRegionType block;
+    SizeValueType         remainder = b;
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      const SizeValueType offset = (remainder % numberOfBlocks[i]) * blockSize;
+      remainder /= numberOfBlocks[i];
+      block.SetIndex(i, regionIndex[i] + static_cast<IndexValueType>(offset));
+      block.SetSize(i, std::min<SizeValueType>(blockSize, regionSize[i] - offset));
+    }
+
+    PixelType label;
+    if (this->IsUniformBlock(block, label))
+    {
+      for (ImageRegionIterator<OutputImageType> it(output, block); !it.IsAtEnd(); ++it)
+      {
+        it.Set(label);
+      }
+      progress.Completed(block.GetNumberOfPixels());
+    }
+    else
+    {
+      /** Resample every voxel of the block. */
+      this->Superclass::DynamicThreadedGenerateData(block);
+    }
+  }
+
+} // end DynamicThreadedGenerateData()
+
+
+/**
+ * ******************* IsUniformBlock *******************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+bool
+BlockwiseLabelResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::IsUniformBlock(
+  const OutputImageRegionType & block,
+  PixelType &                   label) const
+{
+  typedef ContinuousIndex<TInterpolatorPrecisionType, ImageDimension> ContinuousIndexType;
+  typedef typename InputImageType::RegionType                         InputImageRegionType;
+  typedef typename InputImageRegionType::SizeType                     InputImageSizeType;
+
+  const InputImageType *  input = this->GetInput();
+  const OutputImageType * output = this->GetOutput();
+  const TransformType *   transform = this->GetTransform();
+
+  /** Compute the bounding box of the corners of the block, mapped to the moving image. */
+  ContinuousIndexType minimum;
+  ContinuousIndexType maximum;
+  minimum.Fill(NumericTraits<TInterpolatorPrecisionType>::max());
+  maximum.Fill(NumericTraits<TInterpolatorPrecisionType>::NonpositiveMin());
+  for (unsigned int corner = 0; corner < (1u << ImageDimension); ++corner)
+  {
+    IndexType index = block.GetIndex();
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      if ((corner >> i) & 1u)
+      {
+        index[i] += static_cast<IndexValueType>(block.GetSize(i)) - 1;
+      }
+    }
+
+    typename TransformType::InputPointType point;
+    output->TransformIndexToPhysicalPoint(index, point);
+    ContinuousIndexType cindex;
+    input->TransformPhysicalPointToContinuousIndex(transform->TransformPoint(point), cindex);
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      minimum[i] = std::min(minimum[i], cindex[i]);
+      maximum[i] = std::max(maximum[i], cindex[i]);
+    }
+  }
+
+  /** The nearest voxels of the bounding box, grown by one voxel, should be inside the moving image. */
+  const InputImageRegionType & bufferedRegion = input->GetBufferedRegion();
+  IndexType                    movingIndex;
+  InputImageSizeType           movingSize;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    const IndexValueType start = bufferedRegion.GetIndex(i);
+    const IndexValueType end = start + static_cast<IndexValueType>(bufferedRegion.GetSize(i)) - 1;
+
+    /** Written such that NaN's are outside as well. */
+    if (!(minimum[i] >= start + 0.5) || !(maximum[i] < end - 0.5))
+    {
+      return false;
+    }
+    movingIndex[i] = Math::RoundHalfIntegerUp<IndexValueType>(minimum[i]) - 1;
+    const IndexValueType movingEnd = Math::RoundHalfIntegerUp<IndexValueType>(maximum[i]) + 1;
+    movingSize[i] = static_cast<SizeValueType>(movingEnd - movingIndex[i] + 1);
+  }
+
+  /** Check that all these voxels have the same label. */
+  ImageRegionConstIterator<InputImageType> it(input, InputImageRegionType(movingIndex, movingSize));
+  const auto                               first = it.Get();
+  for (; !it.IsAtEnd(); ++it)
+  {
+    if (it.Get() != first)
+    {
+      return false;
+    }
+  }
+  label = static_cast<PixelType>(first);
+  return true;
+
+} // end IsUniformBlock()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template <class TInputImage, class TOutputImage, class TInterpolatorPrecisionType>
+void
+BlockwiseLabelResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecisionType>::PrintSelf(
+  std::ostream & os,
+  Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "BlockSize: " << this->m_BlockSize << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkBlockwiseLabelResampleImageFilter_hxx
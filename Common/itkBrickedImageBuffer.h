@@ -0,0 +1,149 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkBrickedImageBuffer_h
+#define itkBrickedImageBuffer_h
+
+#include "itkFixedArray.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkIndex.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class BrickedImageBuffer
+ *
+ * \brief A copy of the buffered region of an image, stored in bricks.
+ *
+ * The voxels are stored brick after brick, where a brick covers
+ * 2^BrickSizeLog2[d] voxels along dimension d (by default 8 x 8 x 8 voxels in 3D).
+ * Inside a brick, and for the bricks themselves, the first dimension runs fastest.
+ * Neighbouring voxels along any dimension are then mostly found in the same brick,
+ * so that the 2^D corners of a linear interpolation, or the support of a B-spline
+ * kernel, touch only a few cache lines, instead of 2^(D-1) rows of the image that
+ * are far apart in memory.
+ *
+ * The bricks at the border of the region are padded with zeros. The copy is
+ * made once by Initialize(), and is not updated when the image changes.
+ *
+ * \ingroup ImageFunctions
+ */
+
+template <class TPixel, unsigned int VDimension>
+class ITK_TEMPLATE_EXPORT BrickedImageBuffer
+{
+public:
+  /** Typedef's. */
+  typedef BrickedImageBuffer                   Self;
+  typedef TPixel                               PixelType;
+  typedef Index<VDimension>                    IndexType;
+  typedef FixedArray<unsigned int, VDimension> BrickSizeLog2Type;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, VDimension);
+
+  BrickedImageBuffer() = default;
+  ~BrickedImageBuffer() = default;
+
+  /** Copy the buffered region of the image into bricks of 2^brickSizeLog2[d]
+   * voxels along dimension d.
+   */
+  template <class TImage>
+  void
+  Initialize(const TImage * image, const BrickSizeLog2Type & brickSizeLog2)
+  {
+    const typename TImage::RegionType region = image->GetBufferedRegion();
+    this->m_StartIndex = region.GetIndex();
+
+    SizeValueType numberOfVoxelsPerBrick = 1;
+    SizeValueType numberOfBricks[VDimension];
+    for (unsigned int d = 0; d < VDimension; ++d)
+    {
+      this->m_BrickSizeLog2[d] = brickSizeLog2[d];
+      this->m_BrickMask[d] = (SizeValueType(1) << brickSizeLog2[d]) - 1;
+      numberOfBricks[d] = (region.GetSize()[d] + this->m_BrickMask[d]) >> brickSizeLog2[d];
+      this->m_VoxelOffsetTable[d] = numberOfVoxelsPerBrick;
+      numberOfVoxelsPerBrick <<= brickSizeLog2[d];
+    }
+
+    SizeValueType bufferSize = numberOfVoxelsPerBrick;
+    for (unsigned int d = 0; d < VDimension; ++d)
+    {
+      this->m_BrickOffsetTable[d] = bufferSize;
+      bufferSize *= numberOfBricks[d];
+    }
+
+    this->m_Buffer.assign(bufferSize, PixelType{});
+    for (ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it)
+    {
+      this->m_Buffer[this->ComputeOffset(it.GetIndex())] = static_cast<PixelType>(it.Get());
+    }
+  }
+
+
+  /** Release the copy. */
+  void
+  Clear(void)
+  {
+    std::vector<PixelType>().swap(this->m_Buffer);
+  }
+
+
+  /** Returns true when there is no copy. */
+  bool
+  IsEmpty(void) const
+  {
+    return this->m_Buffer.empty();
+  }
+
+
+  /** The position of a voxel in the buffer. No bounds checking is done. */
+  SizeValueType
+  ComputeOffset(const IndexType & index) const
+  {
+    SizeValueType offset = 0;
+    for (unsigned int d = 0; d < VDimension; ++d)
+    {
+      const SizeValueType i = static_cast<SizeValueType>(index[d] - this->m_StartIndex[d]);
+      offset += (i >> this->m_BrickSizeLog2[d]) * this->m_BrickOffsetTable[d] +
+                (i & this->m_BrickMask[d]) * this->m_VoxelOffsetTable[d];
+    }
+    return offset;
+  }
+
+
+  /** The value of a voxel inside the buffered region of the image. */
+  const PixelType &
+  GetPixel(const IndexType & index) const
+  {
+    return this->m_Buffer[this->ComputeOffset(index)];
+  }
+
+
+private:
+  std::vector<PixelType> m_Buffer;
+  IndexType              m_StartIndex{ {} };
+  SizeValueType          m_BrickSizeLog2[VDimension]{};
+  SizeValueType          m_BrickMask[VDimension]{};
+  SizeValueType          m_BrickOffsetTable[VDimension]{};
+  SizeValueType          m_VoxelOffsetTable[VDimension]{};
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkBrickedImageBuffer_h
@@ -25,6 +25,8 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkImageFullSampler.h"
 #include "itkPlatformMultiThreader.h"
+#include "itkParallelTasks.h"
+#include <vector>
 
 namespace itk
 {
@@ -77,6 +79,11 @@ public:
   typedef typename FixedImageMaskType::ConstPointer                  FixedImageMaskConstPointer;
   typedef typename TransformType::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
 
+  /** Typedefs for the sample container. */
+  typedef typename ImageSamplerBase<FixedImageType>::ImageSampleContainerType ImageSampleContainerType;
+  typedef typename ImageSampleContainerType::Pointer                          ImageSampleContainerPointer;
+  typedef typename ImageSampleContainerType::ConstPointer                     ImageSampleContainerConstPointer;
+
   /** Set the fixed image. */
   itkSetConstObjectMacro(FixedImage, FixedImageType);
 
@@ -91,6 +98,22 @@ public:
   /** Set some parameters. */
   itkSetMacro(NumberOfJacobianMeasurements, SizeValueType);
 
+  /** Set/Get the samples at which the displacements are computed, for example
+   * the current samples of the metric. At most NumberOfJacobianMeasurements of
+   * them are used, taken at a regular stride. When no samples are set, or the
+   * container is empty, the fixed image is sampled on a regular grid.
+   */
+  itkSetConstObjectMacro(InputSampleContainer, ImageSampleContainerType);
+  itkGetConstObjectMacro(InputSampleContainer, ImageSampleContainerType);
+
+  /** Set/Get the subsampling factor of the Jacobian measurements. The number of
+   * measurements is divided by this factor, which for fine B-spline grids, where
+   * NumberOfJacobianMeasurements follows the number of control points, amounts to
+   * measuring at a subsampled set of control points. Default: 1.
+   */
+  itkSetClampMacro(SubsamplingFactor, SizeValueType, 1, NumericTraits<SizeValueType>::max());
+  itkGetConstMacro(SubsamplingFactor, SizeValueType);
+
   /** Set the region over which the metric will be computed. */
   void
   SetFixedImageRegion(const FixedImageRegionType & region)
@@ -113,9 +136,19 @@ public:
   virtual void
   ComputeSingleThreaded(const ParametersType & mu, double & jacg, double & maxJJ, std::string method);
 
+  /** The multi-threaded computation using mu as the search direction,
+   * instead of the exact gradient. maxJJ is not computed, and set to zero.
+   */
   virtual void
   ComputeUsingSearchDirection(const ParametersType & mu, double & jacg, double & maxJJ, std::string methods);
 
+  /** The single-threaded computation using mu as the search direction. */
+  virtual void
+  ComputeUsingSearchDirectionSingleThreaded(const ParametersType & mu,
+                                            double &               jacg,
+                                            double &               maxJJ,
+                                            std::string            methods);
+
   /** Set the number of threads. */
   void
   SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
@@ -124,6 +157,14 @@ public:
   }
 
 
+  /** Select the use of the persistent thread pool for the multi-threaded
+   * computations, as AdvancedImageToImageMetric::SetUseThreadPool() does for
+   * the metric. When true (the default), the work units are executed by
+   * ParallelTasks.
+   */
+  itkSetMacro(UseThreadPool, bool);
+  itkGetConstReferenceMacro(UseThreadPool, bool);
+
   virtual void
   BeforeThreadedCompute(const ParametersType & mu);
 
@@ -163,10 +204,8 @@ protected:
   typedef ImageRandomSamplerBase<FixedImageType>       ImageRandomSamplerBaseType;
   typedef typename ImageRandomSamplerBaseType::Pointer ImageRandomSamplerBasePointer;
 
-  typedef ImageGridSampler<FixedImageType>                         ImageGridSamplerType;
-  typedef typename ImageGridSamplerType::Pointer                   ImageGridSamplerPointer;
-  typedef typename ImageGridSamplerType ::ImageSampleContainerType ImageSampleContainerType;
-  typedef typename ImageSampleContainerType::Pointer               ImageSampleContainerPointer;
+  typedef ImageGridSampler<FixedImageType>       ImageGridSamplerType;
+  typedef typename ImageGridSamplerType::Pointer ImageGridSamplerPointer;
 
   /** Typedefs for support of sparse Jacobians and AdvancedTransforms. */
   typedef JacobianType                                   TransformJacobianType;
@@ -179,6 +218,18 @@ protected:
   virtual void
   SampleFixedImageForJacobianTerms(ImageSampleContainerPointer & sampleContainer);
 
+  /** Compute the displacements of the samples, with the gradient or search
+   * direction in m_ExactGradient, in m_SampleContainer on multiple threads.
+   */
+  virtual void
+  ThreadedComputeDisplacements(const std::string & methods, const bool computeMaxJJ, double & jacg, double & maxJJ);
+
+  /** Execute a threader callback for all work units, using either the
+   * platform threader or ParallelTasks, see SetUseThreadPool().
+   */
+  void
+  LaunchThreaderCallback(ThreadFunctionType callback, void * userData) const;
+
   /** Launch MultiThread Compute. */
   void
   LaunchComputeThreaderCallback(void) const;
@@ -215,9 +266,20 @@ protected:
   mutable AlignedComputePerThreadStruct * m_ComputePerThreadVariables;
   mutable ThreadIdType                    m_ComputePerThreadVariablesSize;
 
-  SizeValueType               m_NumberOfPixelsCounted;
-  bool                        m_UseMultiThread;
-  ImageSampleContainerPointer m_SampleContainer;
+  SizeValueType                    m_NumberOfPixelsCounted;
+  bool                             m_UseMultiThread;
+  bool                             m_UseThreadPool;
+  ImageSampleContainerPointer      m_SampleContainer;
+  ImageSampleContainerConstPointer m_InputSampleContainer;
+  ImageGridSamplerPointer          m_GridSampler;
+  SizeValueType                    m_SubsamplingFactor;
+
+  /** Settings of the threaded computation. The displacement magnitudes of
+   * the samples are only stored when a percentile is computed.
+   */
+  bool                m_ComputeMaxJJ;
+  bool                m_StoreDisplacements;
+  std::vector<double> m_Displacements;
 
 private:
   ComputeDisplacementDistribution(const Self &) = delete;
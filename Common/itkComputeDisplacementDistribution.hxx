@@ -21,6 +21,7 @@
 #include "itkComputeDisplacementDistribution.h"
 
 #include <string>
+#include <algorithm>
 #include "vnl/vnl_math.h"
 #include "vnl/vnl_fastops.h"
 #include "vnl/vnl_diag_matrix.h"
@@ -48,9 +49,15 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ComputeDisplacementDis
   this->m_FixedImageMask = nullptr;
   this->m_NumberOfJacobianMeasurements = 0;
   this->m_SampleContainer = nullptr;
+  this->m_InputSampleContainer = nullptr;
+  this->m_GridSampler = nullptr;
+  this->m_SubsamplingFactor = 1;
+  this->m_ComputeMaxJJ = true;
+  this->m_StoreDisplacements = false;
 
   /** Threading related variables. */
   this->m_UseMultiThread = true;
+  this->m_UseThreadPool = true;
   this->m_Threader = ThreaderType::New();
 
   /** Initialize the m_ThreaderParameters. */
@@ -264,19 +271,12 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::Compute(const Paramete
   {
     return this->ComputeSingleThreaded(mu, jacg, maxJJ, methods);
   }
-  // The multi-threaded route only supports methods == 2sigma for now
 
-  /** Initialize multi-threading. */
-  this->InitializeThreadingParameters();
-
-  /** Tackle stuff needed before multi-threading. */
+  /** Get the exact gradient and the samples. */
   this->BeforeThreadedCompute(mu);
 
-  /** Launch multi-threaded computation. */
-  this->LaunchComputeThreaderCallback();
-
-  /** Gather the jacg, maxJJ values from all threads. */
-  this->AfterThreadedCompute(jacg, maxJJ);
+  /** Compute the displacements and maxJJ on multiple threads. */
+  this->ThreadedComputeDisplacements(methods, true, jacg, maxJJ);
 
 } // end Compute()
 
@@ -308,6 +308,39 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::BeforeThreadedCompute(
 } // end BeforeThreadedCompute()
 
 
+/**
+ * *********************** ThreadedComputeDisplacements ***************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedComputeDisplacements(const std::string & methods,
+                                                                                       const bool          computeMaxJJ,
+                                                                                       double &            jacg,
+                                                                                       double &            maxJJ)
+{
+  /** The percentile needs all displacements, which every thread stores
+   * for its own range of samples.
+   */
+  this->m_ComputeMaxJJ = computeMaxJJ;
+  this->m_StoreDisplacements = (methods == "95percentile");
+  if (this->m_StoreDisplacements)
+  {
+    this->m_Displacements.resize(this->m_SampleContainer->Size());
+  }
+
+  /** Initialize multi-threading. */
+  this->InitializeThreadingParameters();
+
+  /** Launch multi-threaded computation. */
+  this->LaunchComputeThreaderCallback();
+
+  /** Gather the jacg, maxJJ values from all threads. */
+  this->AfterThreadedCompute(jacg, maxJJ);
+
+} // end ThreadedComputeDisplacements()
+
+
 /**
  * *********************** LaunchComputeThreaderCallback***************
  */
@@ -316,16 +349,37 @@ template <class TFixedImage, class TTransform>
 void
 ComputeDisplacementDistribution<TFixedImage, TTransform>::LaunchComputeThreaderCallback(void) const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(this->ComputeThreaderCallback,
-                                    const_cast<void *>(static_cast<const void *>(&this->m_ThreaderParameters)));
-
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  this->LaunchThreaderCallback(this->ComputeThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderParameters)));
 
 } // end LaunchComputeThreaderCallback()
 
 
+/**
+ * *********************** LaunchThreaderCallback ***************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeDisplacementDistribution<TFixedImage, TTransform>::LaunchThreaderCallback(ThreadFunctionType callback,
+                                                                                 void *             userData) const
+{
+  if (!this->m_UseThreadPool)
+  {
+    /** Spawn and join threads for this call only. */
+    this->m_Threader->SetSingleMethod(callback, userData);
+    this->m_Threader->SingleMethodExecute();
+    return;
+  }
+
+  /** The callbacks divide their work by the number of work units of
+   * m_Threader, so the tasks must use exactly the same number.
+   */
+  ParallelTasks::Execute(this->m_Threader->GetNumberOfWorkUnits(), callback, userData);
+
+} // end LaunchThreaderCallback()
+
+
 /**
  * ************ ComputeThreaderCallback ****************************
  */
@@ -384,7 +438,6 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedCompute(Thread
   }
 
   /** Temporaries. */
-  // std::vector< double > JGG_k; not here so only mean + 2 sigma is supported
   DerivativeType Jgg(outdim);
   Jgg.Fill(0.0);
   const double  sqrt2 = std::sqrt(static_cast<double>(2.0));
@@ -420,15 +473,18 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedCompute(Thread
       }
     }
 
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
+    if (this->m_ComputeMaxJJ)
+    {
+      /** Compute 1st part of JJ: ||J_j||_F^2. */
+      double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
 
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt(jacjjacj, jacj, jacj); // is this thread-safe?
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+      /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+      vnl_fastops::ABt(jacjjacj, jacj, jacj);
+      JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
 
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max(maxJJ, JJ_j);
+      /** Max_j [JJ_j]. */
+      maxJJ = std::max(maxJJ, JJ_j);
+    }
 
     /** Compute the displacement  jac * gradient. */
     for (unsigned int i = 0; i < outdim; ++i)
@@ -446,6 +502,10 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ThreadedCompute(Thread
     jggMagnitude = Jgg.magnitude();
     displacement += jggMagnitude;
     displacementSquared += vnl_math::sqr(jggMagnitude);
+    if (this->m_StoreDisplacements)
+    {
+      this->m_Displacements[pos_begin + numberOfPixelsCounted] = jggMagnitude;
+    }
     numberOfPixelsCounted++;
   }
 
@@ -489,11 +549,22 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::AfterThreadedCompute(d
     this->m_ComputePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
   }
 
+  if (this->m_StoreDisplacements)
+  {
+    /** Compute the 95% percentile of the distribution of the displacements. */
+    std::vector<double> & displacements = this->m_Displacements;
+    const std::size_t     last = displacements.size() - 1;
+    const std::size_t     d = std::min(static_cast<std::size_t>(displacements.size() * 0.95), last);
+    std::sort(displacements.begin(), displacements.end());
+    jacg = (displacements[d > 0 ? d - 1 : 0] + displacements[d] + displacements[std::min(d + 1, last)]) / 3.0;
+    return;
+  }
+
   /** Compute the sigma of the distribution of the displacements. */
   const double meanDisplacement = displacement / this->m_NumberOfPixelsCounted;
   const double sigma = displacementSquared / this->m_NumberOfPixelsCounted - vnl_math::sqr(meanDisplacement);
 
-  jacg = meanDisplacement + 2.0 * std::sqrt(sigma);
+  jacg = meanDisplacement + 2.0 * std::sqrt(std::max(sigma, 0.0));
 
 } // end AfterThreadedCompute()
 
@@ -508,6 +579,43 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ComputeUsingSearchDire
                                                                                       double &               jacg,
                                                                                       double &               maxJJ,
                                                                                       std::string            methods)
+{
+  /** Option to still use the single threaded code. */
+  if (!this->m_UseMultiThread)
+  {
+    return this->ComputeUsingSearchDirectionSingleThreaded(mu, jacg, maxJJ, methods);
+  }
+
+  /** Get the number of parameters. */
+  this->m_NumberOfParameters = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
+
+  /** Get scales vector */
+  const ScalesType & scales = this->GetScales();
+  this->m_ScaledCostFunction->SetScales(scales);
+
+  /** The search direction takes the place of the exact gradient. */
+  this->m_ExactGradient = mu;
+
+  /** Get samples. */
+  this->SampleFixedImageForJacobianTerms(this->m_SampleContainer);
+
+  /** Compute the displacements on multiple threads, without maxJJ. */
+  this->ThreadedComputeDisplacements(methods, false, jacg, maxJJ);
+
+} // end ComputeUsingSearchDirection()
+
+
+/**
+ * ************************* ComputeUsingSearchDirectionSingleThreaded ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeDisplacementDistribution<TFixedImage, TTransform>::ComputeUsingSearchDirectionSingleThreaded(
+  const ParametersType & mu,
+  double &               jacg,
+  double &               maxJJ,
+  std::string            methods)
 {
   /** This function computes four terms needed for the automatic parameter
    * estimation using voxel displacement distribution estimation method.
@@ -618,7 +726,7 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::ComputeUsingSearchDire
     sigma /= (nrofsamples - 1); // unbiased estimation
     jacg = mean_JGG + 2.0 * std::sqrt(sigma);
   }
-} // end ComputeUsingSearchDirection()
+} // end ComputeUsingSearchDirectionSingleThreaded()
 
 
 /**
@@ -630,9 +738,36 @@ void
 ComputeDisplacementDistribution<TFixedImage, TTransform>::SampleFixedImageForJacobianTerms(
   ImageSampleContainerPointer & sampleContainer)
 {
-  /** Set up grid sampler. */
-  ImageGridSamplerPointer sampler = ImageGridSamplerType::New();
-  //  ImageFullSamplerPointer sampler = ImageFullSamplerType::New();
+  /** The number of Jacobian measurements, reduced by the subsampling factor. */
+  const SizeValueType numberOfMeasurements =
+    std::max<SizeValueType>(this->m_NumberOfJacobianMeasurements / this->m_SubsamplingFactor, 1);
+
+  /** Use the given samples, when available, instead of sampling the fixed image
+   * again. Note that a sampler with implicit samples has an empty container.
+   */
+  if (this->m_InputSampleContainer.IsNotNull() && this->m_InputSampleContainer->Size() > 0)
+  {
+    const SizeValueType inputSize = this->m_InputSampleContainer->Size();
+    const SizeValueType stride = (inputSize + numberOfMeasurements - 1) / numberOfMeasurements;
+
+    sampleContainer = ImageSampleContainerType::New();
+    auto & samples = sampleContainer->CastToSTLContainer();
+    samples.reserve((inputSize + stride - 1) / stride);
+    for (SizeValueType i = 0; i < inputSize; i += stride)
+    {
+      samples.push_back(this->m_InputSampleContainer->ElementAt(i));
+    }
+    return;
+  }
+
+  /** Set up grid sampler. It is kept, so that its samples are only
+   * recomputed when its input or number of samples changes.
+   */
+  if (this->m_GridSampler.IsNull())
+  {
+    this->m_GridSampler = ImageGridSamplerType::New();
+  }
+  ImageGridSamplerType * sampler = this->m_GridSampler;
   sampler->SetInput(this->m_FixedImage);
   sampler->SetInputImageRegion(this->GetFixedImageRegion());
   sampler->SetMask(this->m_FixedImageMask);
@@ -642,17 +777,16 @@ ComputeDisplacementDistribution<TFixedImage, TTransform>::SampleFixedImageForJac
    * Note that the actually obtained number of samples may be lower, due to masks.
    * This is taken into account at the end of this function.
    */
-  SizeValueType nrofsamples = this->m_NumberOfJacobianMeasurements;
-  sampler->SetNumberOfSamples(nrofsamples);
+  sampler->SetNumberOfSamples(numberOfMeasurements);
 
   /** Get samples and check the actually obtained number of samples. */
   sampler->Update();
   sampleContainer = sampler->GetOutput();
-  nrofsamples = sampleContainer->Size();
+  const SizeValueType nrofsamples = sampleContainer->Size();
 
   if (nrofsamples == 0)
   {
-    itkExceptionMacro(<< "No valid voxels (0/" << this->m_NumberOfJacobianMeasurements
+    itkExceptionMacro(<< "No valid voxels (0/" << numberOfMeasurements
                       << ") found to estimate the AdaptiveStochasticGradientDescent parameters.");
   }
 } // end SampleFixedImageForJacobianTerms()
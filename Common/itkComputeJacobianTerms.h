@@ -23,6 +23,8 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 
+#include <vector>
+
 namespace itk
 {
 /**\class ComputeJacobianTerms
@@ -86,6 +88,15 @@ public:
   itkSetMacro(NumberOfBandStructureSamples, unsigned int);
   itkSetMacro(NumberOfJacobianMeasurements, SizeValueType);
 
+  /** Select the randomized estimator of the terms, which does not compute the covariance
+   * matrix, and of which the cost does not grow with the square of the number of parameters.
+   * TrCC and maxJCJ are then estimated from NumberOfProbeVectors random vectors. Default: false.
+   */
+  itkSetMacro(UseRandomizedTraceEstimator, bool);
+  itkGetConstMacro(UseRandomizedTraceEstimator, bool);
+  itkSetMacro(NumberOfProbeVectors, unsigned int);
+  itkGetConstMacro(NumberOfProbeVectors, unsigned int);
+
   /** Set the region over which the metric will be computed. */
   void
   SetFixedImageRegion(const FixedImageRegionType & region)
@@ -118,6 +129,8 @@ protected:
   unsigned int  m_MaxBandCovSize;
   unsigned int  m_NumberOfBandStructureSamples;
   SizeValueType m_NumberOfJacobianMeasurements;
+  bool          m_UseRandomizedTraceEstimator;
+  unsigned int  m_NumberOfProbeVectors;
 
   typedef typename FixedImageType::IndexType   FixedImageIndexType;
   typedef typename FixedImageType::PointType   FixedImagePointType;
@@ -140,12 +153,46 @@ protected:
   typedef typename TransformType::ScalarType             CoordinateRepresentationType;
   typedef typename TransformType::NumberOfParametersType NumberOfParametersType;
 
+  /** Typedefs for the covariance matrix. */
+  typedef double                            CovarianceValueType;
+  typedef itk::Array2D<CovarianceValueType> CovarianceMatrixType;
+
+  /** The Jacobians of a batch of samples, computed in parallel. */
+  struct JacobianBatchType
+  {
+    std::vector<JacobianType>               m_Jacobians;
+    std::vector<NonZeroJacobianIndicesType> m_NonZeroJacobianIndices;
+    std::vector<unsigned char>              m_Valid;
+  };
+
+  /** The number of samples of which the Jacobians are stored at the same time. */
+  static constexpr SizeValueType JacobianBatchSize = 4096;
+
   /** Sample the fixed image to compute the Jacobian terms. */
   // \todo: note that this is an exact copy of itk::ComputeDisplacementDistribution
   // in the future it would be better to refactoring this part of the code.
   virtual void
   SampleFixedImageForJacobianTerms(ImageSampleContainerPointer & sampleContainer);
 
+  /** Computes the terms with Hutchinson's randomized trace estimator. */
+  virtual void
+  ComputeRandomized(const ImageSampleContainerType & sampleContainer,
+                    double &                         TrC,
+                    double &                         TrCC,
+                    double &                         maxJJ,
+                    double &                         maxJCJ);
+
+  /** Computes the Jacobian of the transform at a point, divided by the scales, if used. */
+  void
+  GetScaledJacobian(const FixedImagePointType & point, JacobianType & jacj, NonZeroJacobianIndicesType & jacind) const;
+
+  /** Computes the scaled Jacobians of the samples [first, last) in parallel. */
+  void
+  ComputeJacobianBatch(const ImageSampleContainerType & sampleContainer,
+                       const SizeValueType              first,
+                       const SizeValueType              last,
+                       JacobianBatchType &              batch) const;
+
 private:
   ComputeJacobianTerms(const Self &) = delete;
   void
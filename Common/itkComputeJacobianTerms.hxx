@@ -24,6 +24,10 @@
 #include "vnl/vnl_fastops.h"
 #include "vnl/vnl_diag_matrix.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkParallelTasks.h"
+
+#include <algorithm>
 
 namespace itk
 {
@@ -43,6 +47,8 @@ ComputeJacobianTerms<TFixedImage, TTransform>::ComputeJacobianTerms()
   this->m_MaxBandCovSize = 0;
   this->m_NumberOfBandStructureSamples = 0;
   this->m_NumberOfJacobianMeasurements = 0;
+  this->m_UseRandomizedTraceEstimator = false;
+  this->m_NumberOfProbeVectors = 16;
 
 } // end Constructor
 
@@ -69,10 +75,11 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
    *    D: || J_j J_j^T ||_F     in (54)
    * Term 3: maxJJ, see (47)
    * Term 4: maxJCJ, see (54)
+   *
+   * The Jacobians are computed in parallel, in batches of samples. The covariance
+   * matrix is accumulated in parallel as well, each thread owning a block of rows.
    */
 
-  typedef double                                 CovarianceValueType;
-  typedef itk::Array2D<CovarianceValueType>      CovarianceMatrixType;
   typedef vnl_sparse_matrix<CovarianceValueType> SparseCovarianceMatrixType;
   typedef SparseCovarianceMatrixType::row        SparseRowType;
   typedef itk::Array<SizeValueType>              NonZeroJacobianIndicesExpandedType;
@@ -84,6 +91,14 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   /** Get samples. */
   ImageSampleContainerPointer sampleContainer; // default-constructed (null)
   SampleFixedImageForJacobianTerms(sampleContainer);
+
+  /** The randomized estimator does not need the covariance matrix. */
+  if (this->m_UseRandomizedTraceEstimator)
+  {
+    this->ComputeRandomized(*sampleContainer, TrC, TrCC, maxJJ, maxJCJ);
+    return;
+  }
+
   const SizeValueType nrofsamples = sampleContainer->Size();
   const double        n = static_cast<double>(nrofsamples);
 
@@ -91,17 +106,7 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   const unsigned int P = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
 
   /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int              outdim = this->m_Transform->GetOutputSpaceDimension();
-
-  /** Get scales vector */
-  const ScalesType & scales = this->m_Scales;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
-  unsigned int                                     samplenr = 0;
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
   /** Variables for nonzerojacobian indices and the Jacobian. */
   NumberOfParametersType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
@@ -113,17 +118,12 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   {
     jacind[1] = 0;
   }
-  NonZeroJacobianIndicesType prevjacind = jacind;
 
   /** Initialize covariance matrix. Sparse, diagonal, and band form. */
   SparseCovarianceMatrixType cov(P, P);
   DiagCovarianceMatrixType   diagcov(P, 0.0);
   CovarianceMatrixType       bandcov;
 
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac(sizejacind, sizejacind);
-  jactjac.Fill(0.0);
-
   typedef std::vector<unsigned int>             DifHistType;
   typedef std::pair<unsigned int, unsigned int> FreqPairType;
   typedef std::vector<FreqPairType>             DifHist2Type;
@@ -222,106 +222,87 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
    *    TERM 1
    *
    * Loop over image and compute Jacobian.
-   * Compute C = 1/n \sum_i J_i^T J_i
-   * Possibly apply scaling afterwards.
+   * Compute C = 1/n \sum_i J_i^T J_i, with the scaled Jacobians, if necessary.
+   * The threads add the elements of their own block of rows, so that
+   * no locking is needed, and no copies of the covariance matrix.
    */
-  jacind[0] = 0;
-  if (sizejacind > 1)
+  const SizeValueType numberOfRowBlocks = std::max<SizeValueType>(ParallelTasks::GetNumberOfWorkUnits(), 1);
+  JacobianBatchType   batch;
+  for (SizeValueType first = 0; first < nrofsamples; first += JacobianBatchSize)
   {
-    jacind[1] = 0;
-  }
-  for (iter = begin; iter != end; ++iter)
-  {
-    /** Print progress 0-50%.
-     *progressObserver->UpdateAndPrintProgress( samplenr );*/
-    ++samplenr;
-
-    /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian(point, jacj, jacind);
-
-    /** Skip invalid Jacobians in the beginning, if any. */
-    if (sizejacind > 1)
-    {
-      if (jacind[0] == jacind[1])
-      {
-        continue;
-      }
-    }
-
-    if (jacind == prevjacind)
-    {
-      /** Update sum of J_j^T J_j. */
-      vnl_fastops::inc_X_by_AtA(jactjac, jacj);
-    }
-    else
-    {
-      /** The following should only be done after the first sample. */
-      if (iter != begin)
-      {
-        /** Update covariance matrix. */
-        for (unsigned int pi = 0; pi < sizejacind; ++pi)
+    const SizeValueType last = std::min<SizeValueType>(first + JacobianBatchSize, nrofsamples);
+    this->ComputeJacobianBatch(*sampleContainer, first, last, batch);
+
+    ParallelTasks::ParallelizeArray(
+      0,
+      numberOfRowBlocks,
+      [&](SizeValueType block) {
+        const unsigned int firstRow = static_cast<unsigned int>(P * block / numberOfRowBlocks);
+        const unsigned int endRow = static_cast<unsigned int>(P * (block + 1) / numberOfRowBlocks);
+
+        /** Sum J_j^T J_j over runs of samples with the same nonzero Jacobian indices,
+         * as they often occur for B-spline transforms, before adding them to the matrix.
+         */
+        CovarianceMatrixType jactjac(sizejacind, sizejacind);
+        SizeValueType        runStart = 0;
+        while (runStart < last - first)
         {
-          const unsigned int p = prevjacind[pi];
-          for (unsigned int qi = 0; qi < sizejacind; ++qi)
+          if (!batch.m_Valid[runStart])
+          {
+            ++runStart;
+            continue;
+          }
+          const NonZeroJacobianIndicesType & runjacind = batch.m_NonZeroJacobianIndices[runStart];
+          SizeValueType                      runEnd = runStart + 1;
+          while (runEnd < last - first && batch.m_Valid[runEnd] && batch.m_NonZeroJacobianIndices[runEnd] == runjacind)
           {
-            const unsigned int q = prevjacind[qi];
-            if (q >= p)
+            ++runEnd;
+          }
+
+          bool firstOfBlock = true;
+          for (unsigned int pi = 0; pi < sizejacind; ++pi)
+          {
+            const unsigned int p = runjacind[pi];
+            if (p < firstRow || p >= endRow)
             {
-              const double tempval = jactjac(pi, qi) / n;
-              if (std::abs(tempval) > 1e-14)
+              continue;
+            }
+            if (firstOfBlock)
+            {
+              jactjac.Fill(0.0);
+              for (SizeValueType j = runStart; j < runEnd; ++j)
               {
-                const unsigned int bandindex = bandcovMap[q - p];
-                if (bandindex < bandcovsize)
-                {
-                  bandcov(p, bandindex) += tempval;
-                }
-                else
+                vnl_fastops::inc_X_by_AtA(jactjac, batch.m_Jacobians[j]);
+              }
+              firstOfBlock = false;
+            }
+            for (unsigned int qi = 0; qi < sizejacind; ++qi)
+            {
+              const unsigned int q = runjacind[qi];
+              if (q >= p)
+              {
+                const double tempval = jactjac(pi, qi) / n;
+                if (std::abs(tempval) > 1e-14)
                 {
-                  cov(p, q) += tempval;
+                  const unsigned int bandindex = bandcovMap[q - p];
+                  if (bandindex < bandcovsize)
+                  {
+                    bandcov(p, bandindex) += tempval;
+                  }
+                  else
+                  {
+                    cov(p, q) += tempval;
+                  }
                 }
               }
-            }
-          } // qi
-        }   // pi
-      }     // end if
-
-      /** Initialize jactjac by J_j^T J_j. */
-      vnl_fastops::AtA(jactjac, jacj);
+            } // qi
+          }   // pi
 
-      /** Remember nonzerojacobian indices. */
-      prevjacind = jacind;
-    } // end else
-
-  } // end iter loop: end computation of covariance matrix
-
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for (unsigned int pi = 0; pi < sizejacind; ++pi)
-  {
-    const unsigned int p = prevjacind[pi];
-    for (unsigned int qi = 0; qi < sizejacind; ++qi)
-    {
-      const unsigned int q = prevjacind[qi];
-      if (q >= p)
-      {
-        const double tempval = jactjac(pi, qi) / n;
-        if (std::abs(tempval) > 1e-14)
-        {
-          const unsigned int bandindex = bandcovMap[q - p];
-          if (bandindex < bandcovsize)
-          {
-            bandcov(p, bandindex) += tempval;
-          }
-          else
-          {
-            cov(p, q) += tempval;
-          }
+          runStart = runEnd;
         }
-      }
-    } // qi
-  }   // pi
+      });
+  } // end loop over batches: end computation of covariance matrix
+  batch = JacobianBatchType();
 
   /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
    * \todo: perhaps work further with this bandmatrix instead.
@@ -340,24 +321,6 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
   }
   bandcov.set_size(0, 0);
 
-  /** Apply scales. the use of m_Scales maybe something wrong. */
-  if (this->m_UseScales)
-  {
-    for (unsigned int p = 0; p < P; ++p)
-    {
-      cov.scale_row(p, 1.0 / this->m_Scales[p]);
-    }
-    /**  \todo: this might be faster with get_row instead of the iterator */
-    cov.reset();
-    bool notfinished = cov.next();
-    while (notfinished)
-    {
-      const int col = cov.getcolumn();
-      cov(cov.getrow(), col) /= scales[col];
-      notfinished = cov.next();
-    }
-  }
-
   /** Compute TrC = trace(C), and diagcov. */
   for (unsigned int p = 0; p < P; ++p)
   {
@@ -393,129 +356,384 @@ ComputeJacobianTerms<TFixedImage, TTransform>::Compute(double & TrC, double & Tr
    * Compute maxJJ and maxJCJ
    * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
    * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
+   * The samples are divided over the threads, which only read the covariance matrix.
    */
-  maxJJ = 0.0;
-  maxJCJ = 0.0;
-  const double sqrt2 = std::sqrt(static_cast<double>(2.0));
-
-  JacobianType                       jacjjacj(outdim, outdim);
-  JacobianType                       jacjcov(outdim, sizejacind);
-  DiagCovarianceMatrixType           diagcovsparse(sizejacind);
-  JacobianType                       jacjdiagcov(outdim, sizejacind);
-  JacobianType                       jacjdiagcovjacj(outdim, outdim);
-  JacobianType                       jacjcovjacj(outdim, outdim);
-  NonZeroJacobianIndicesExpandedType jacindExpanded(P);
-
-  samplenr = 0;
-  for (iter = begin; iter != end; ++iter)
-  {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian(point, jacj, jacind);
-
-    /** Apply scales, if necessary. */
-    if (this->m_UseScales)
-    {
-      for (unsigned int pi = 0; pi < sizejacind; ++pi)
+  const double        sqrt2 = std::sqrt(static_cast<double>(2.0));
+  std::vector<double> blockMaxJJ(numberOfRowBlocks, 0.0);
+  std::vector<double> blockMaxJCJ(numberOfRowBlocks, 0.0);
+
+  ParallelTasks::ParallelizeArray(
+    0,
+    numberOfRowBlocks,
+    [&](SizeValueType block) {
+      JacobianType                       jacj(outdim, sizejacind);
+      NonZeroJacobianIndicesType         jacind(sizejacind);
+      JacobianType                       jacjjacj(outdim, outdim);
+      JacobianType                       jacjcov(outdim, sizejacind);
+      DiagCovarianceMatrixType           diagcovsparse(sizejacind);
+      JacobianType                       jacjdiagcov(outdim, sizejacind);
+      JacobianType                       jacjdiagcovjacj(outdim, outdim);
+      JacobianType                       jacjcovjacj(outdim, outdim);
+      NonZeroJacobianIndicesExpandedType jacindExpanded(P);
+
+      const SizeValueType firstSample = nrofsamples * block / numberOfRowBlocks;
+      const SizeValueType endSample = nrofsamples * (block + 1) / numberOfRowBlocks;
+      for (SizeValueType samplenr = firstSample; samplenr < endSample; ++samplenr)
       {
-        const unsigned int p = jacind[pi];
-        jacj.scale_column(pi, 1.0 / scales[p]);
-      }
-    }
+        /** Read fixed coordinates and get Jacobian. */
+        const FixedImagePointType & point = sampleContainer->GetElement(samplenr).m_ImageCoordinates;
+        this->GetScaledJacobian(point, jacj, jacind);
 
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
+        /** Compute 1st part of JJ: ||J_j||_F^2. */
+        double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
 
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt(jacjjacj, jacj, jacj);
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+        /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+        vnl_fastops::ABt(jacjjacj, jacj, jacj);
+        JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
 
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max(maxJJ, JJ_j);
+        /** Max_j [JJ_j]. */
+        blockMaxJJ[block] = std::max(blockMaxJJ[block], JJ_j);
 
-    /** Compute JCJ_j. */
-    double JCJ_j = 0.0;
+        /** Compute JCJ_j. */
+        double JCJ_j = 0.0;
 
-    /** J_j C = jacjC. */
-    jacjcov.Fill(0.0);
+        /** J_j C = jacjC. */
+        jacjcov.Fill(0.0);
 
-    /** Store the nonzero Jacobian indices in a different format
-     * and create the sparse diagcov.
-     */
-    jacindExpanded.Fill(sizejacind);
-    for (unsigned int pi = 0; pi < sizejacind; ++pi)
-    {
-      const unsigned int p = jacind[pi];
-      jacindExpanded[p] = pi;
-      diagcovsparse[pi] = diagcov[p];
-    }
+        /** Store the nonzero Jacobian indices in a different format
+         * and create the sparse diagcov.
+         */
+        jacindExpanded.Fill(sizejacind);
+        for (unsigned int pi = 0; pi < sizejacind; ++pi)
+        {
+          const unsigned int p = jacind[pi];
+          jacindExpanded[p] = pi;
+          diagcovsparse[pi] = diagcov[p];
+        }
 
-    /** We below calculate jacjC = J_j cov^T, but later we will correct
-     * for this using:
-     * J C J' = J (cov + cov' - diag(cov')) J'.
-     * (NB: cov now still contains only the upper triangular part of C)
-     */
-    for (unsigned int pi = 0; pi < sizejacind; ++pi)
-    {
-      const unsigned int p = jacind[pi];
-      if (!cov.empty_row(p))
-      {
-        SparseRowType &                  covrowp = cov.get_row(p);
-        typename SparseRowType::iterator covrowpit;
+        /** We below calculate jacjC = J_j cov^T, but later we will correct
+         * for this using:
+         * J C J' = J (cov + cov' - diag(cov')) J'.
+         * (NB: cov now still contains only the upper triangular part of C)
+         */
+        for (unsigned int pi = 0; pi < sizejacind; ++pi)
+        {
+          const unsigned int p = jacind[pi];
+          if (!cov.empty_row(p))
+          {
+            const SparseRowType &                  covrowp = cov.get_row(p);
+            typename SparseRowType::const_iterator covrowpit;
+
+            /** Loop over row p of the sparse cov matrix. */
+            for (covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit)
+            {
+              const unsigned int q = (*covrowpit).first;
+              const unsigned int qi = jacindExpanded[q];
+
+              if (qi < sizejacind)
+              {
+                /** If found, update the jacjC matrix. */
+                const CovarianceValueType covElement = (*covrowpit).second;
+                for (unsigned int dx = 0; dx < outdim; ++dx)
+                {
+                  jacjcov[dx][pi] += jacj[dx][qi] * covElement;
+                } // dx
+              }   // if qi < sizejacind
+            }     // for covrow
+
+          } // if not empty row
+        }   // pi
+
+        /** J_j C J_j^T  = jacjCjacj.
+         * But note that we actually compute J_j cov' J_j^T
+         */
+        vnl_fastops::ABt(jacjcovjacj, jacjcov, jacj);
+
+        /** jacjCjacj = jacjCjacj+ jacjCjacj' - jacjdiagcovjacj */
+        jacjdiagcov = jacj * diagcovsparse;
+        vnl_fastops::ABt(jacjdiagcovjacj, jacjdiagcov, jacj);
+        jacjcovjacj += jacjcovjacj.transpose();
+        jacjcovjacj -= jacjdiagcovjacj;
 
-        /** Loop over row p of the sparse cov matrix. */
-        for (covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit)
+        /** Compute 1st part of JCJ: Tr( J_j C J_j^T ). */
+        for (unsigned int d = 0; d < outdim; ++d)
         {
-          const unsigned int q = (*covrowpit).first;
-          const unsigned int qi = jacindExpanded[q];
+          JCJ_j += jacjcovjacj[d][d];
+        }
+
+        /** Compute 2nd part of JCJ_j: 2 \sqrt{2} || J_j C J_j^T ||_F. */
+        JCJ_j += 2.0 * sqrt2 * jacjcovjacj.frobenius_norm();
+
+        /** Max_j [JCJ_j]. */
+        blockMaxJCJ[block] = std::max(blockMaxJCJ[block], JCJ_j);
+
+      } // end loop over the samples of the block
+    });
+
+  maxJJ = *std::max_element(blockMaxJJ.begin(), blockMaxJJ.end());
+  maxJCJ = *std::max_element(blockMaxJCJ.begin(), blockMaxJCJ.end());
+
+} // end Compute()
+
+
+/**
+ * ************************* ComputeRandomized ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ComputeRandomized(const ImageSampleContainerType & sampleContainer,
+                                                                 double &                         TrC,
+                                                                 double &                         TrCC,
+                                                                 double &                         maxJJ,
+                                                                 double &                         maxJCJ)
+{
+  /** The covariance matrix C = 1/n \sum_i J_i^T J_i is only used through its products
+   * with m random vectors z_k, of which the elements are +1 or -1 with equal probability:
+   *    C z_k = 1/n \sum_i J_i^T ( J_i z_k ),
+   * which costs O(n) Jacobian products, instead of the O(P^2) of the sparse matrix.
+   * Since E[ z z^T ] = I, Hutchinson's estimators give
+   *    TrCC = ||C||_F^2 = E[ ||C z||^2 ],
+   *    J_j C J_j^T = E[ ( J_j C z ) ( J_j z )^T ].
+   * TrC = 1/n \sum_i ||J_i||_F^2 and maxJJ are computed exactly.
+   */
+  const SizeValueType nrofsamples = sampleContainer.Size();
+  const double        n = static_cast<double>(nrofsamples);
+  const unsigned int  P = static_cast<unsigned int>(this->m_Transform->GetNumberOfParameters());
+  const unsigned int  outdim = this->m_Transform->GetOutputSpaceDimension();
+  const unsigned int  m = std::max(this->m_NumberOfProbeVectors, 1u);
+  const unsigned int  sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
 
-          if (qi < sizejacind)
+  /** The probe vectors, stored per parameter: z_k[p] = probes[p * m + k]. A fixed seed
+   * makes the estimate reproducible.
+   */
+  typedef Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  const auto                                                randomGenerator = RandomGeneratorType::New();
+  randomGenerator->SetSeed(121212);
+  std::vector<double> probes(static_cast<std::size_t>(P) * m);
+  for (double & z : probes)
+  {
+    z = randomGenerator->GetIntegerVariate(1) == 0 ? -1.0 : 1.0;
+  }
+
+  /** Compute C z_k, in batches of samples: first J_i z_k per sample, in parallel, and
+   * then J_i^T ( J_i z_k ), with each thread owning a block of parameters.
+   */
+  const SizeValueType numberOfBlocks = std::max<SizeValueType>(ParallelTasks::GetNumberOfWorkUnits(), 1);
+  std::vector<double> covProbes(static_cast<std::size_t>(P) * m, 0.0);
+  std::vector<double> jacProbes(JacobianBatchSize * m * outdim);
+  std::vector<double> frobeniusNorms(JacobianBatchSize);
+  JacobianBatchType   batch;
+  for (SizeValueType first = 0; first < nrofsamples; first += JacobianBatchSize)
+  {
+    const SizeValueType last = std::min<SizeValueType>(first + JacobianBatchSize, nrofsamples);
+    this->ComputeJacobianBatch(sampleContainer, first, last, batch);
+
+    ParallelTasks::ParallelizeArray(
+      0,
+      last - first,
+      [&](SizeValueType j) {
+        const JacobianType &               jacj = batch.m_Jacobians[j];
+        const NonZeroJacobianIndicesType & jacind = batch.m_NonZeroJacobianIndices[j];
+        double *                           jz = &jacProbes[j * m * outdim];
+        std::fill_n(jz, m * outdim, 0.0);
+        frobeniusNorms[j] = 0.0;
+        if (!batch.m_Valid[j])
+        {
+          return;
+        }
+        for (unsigned int pi = 0; pi < sizejacind; ++pi)
+        {
+          const double * z = &probes[jacind[pi] * m];
+          for (unsigned int d = 0; d < outdim; ++d)
           {
-            /** If found, update the jacjC matrix. */
-            const CovarianceValueType covElement = (*covrowpit).second;
-            for (unsigned int dx = 0; dx < outdim; ++dx)
+            const double jacElement = jacj[d][pi];
+            for (unsigned int k = 0; k < m; ++k)
             {
-              jacjcov[dx][pi] += jacj[dx][qi] * covElement;
-            } // dx
-          }   // if qi < sizejacind
-        }     // for covrow
-
-      } // if not empty row
-    }   // pi
-
-    /** J_j C J_j^T  = jacjCjacj.
-     * But note that we actually compute J_j cov' J_j^T
-     */
-    vnl_fastops::ABt(jacjcovjacj, jacjcov, jacj);
-
-    /** jacjCjacj = jacjCjacj+ jacjCjacj' - jacjdiagcovjacj */
-    jacjdiagcov = jacj * diagcovsparse;
-    vnl_fastops::ABt(jacjdiagcovjacj, jacjdiagcov, jacj);
-    jacjcovjacj += jacjcovjacj.transpose();
-    jacjcovjacj -= jacjdiagcovjacj;
-
-    /** Compute 1st part of JCJ: Tr( J_j C J_j^T ). */
-    for (unsigned int d = 0; d < outdim; ++d)
+              jz[k * outdim + d] += jacElement * z[k];
+            }
+          }
+        }
+        frobeniusNorms[j] = vnl_math::sqr(jacj.frobenius_norm());
+      });
+
+    ParallelTasks::ParallelizeArray(
+      0,
+      numberOfBlocks,
+      [&](SizeValueType block) {
+        const SizeValueType firstParameter = P * block / numberOfBlocks;
+        const SizeValueType endParameter = P * (block + 1) / numberOfBlocks;
+        for (SizeValueType j = 0; j < last - first; ++j)
+        {
+          if (!batch.m_Valid[j])
+          {
+            continue;
+          }
+          const JacobianType &               jacj = batch.m_Jacobians[j];
+          const NonZeroJacobianIndicesType & jacind = batch.m_NonZeroJacobianIndices[j];
+          const double *                     jz = &jacProbes[j * m * outdim];
+          for (unsigned int qi = 0; qi < sizejacind; ++qi)
+          {
+            const SizeValueType q = jacind[qi];
+            if (q < firstParameter || q >= endParameter)
+            {
+              continue;
+            }
+            double * cz = &covProbes[q * m];
+            for (unsigned int k = 0; k < m; ++k)
+            {
+              double sum = 0.0;
+              for (unsigned int d = 0; d < outdim; ++d)
+              {
+                sum += jacj[d][qi] * jz[k * outdim + d];
+              }
+              cz[k] += sum / n;
+            }
+          }
+        }
+      });
+
+    for (SizeValueType j = 0; j < last - first; ++j)
     {
-      JCJ_j += jacjcovjacj[d][d];
+      TrC += frobeniusNorms[j] / n;
     }
+  } // end loop over batches
+  batch = JacobianBatchType();
 
-    /** Compute 2nd part of JCJ_j: 2 \sqrt{2} || J_j C J_j^T ||_F. */
-    JCJ_j += 2.0 * sqrt2 * jacjcovjacj.frobenius_norm();
+  /** TrCC = 1/m \sum_k ||C z_k||^2. */
+  for (const double cz : covProbes)
+  {
+    TrCC += cz * cz;
+  }
+  TrCC /= static_cast<double>(m);
+
+  /** maxJJ and maxJCJ, with J_j C J_j^T estimated from the probes, and symmetrized. */
+  const double        sqrt2 = std::sqrt(static_cast<double>(2.0));
+  std::vector<double> blockMaxJJ(numberOfBlocks, 0.0);
+  std::vector<double> blockMaxJCJ(numberOfBlocks, 0.0);
+
+  ParallelTasks::ParallelizeArray(
+    0,
+    numberOfBlocks,
+    [&](SizeValueType block) {
+      JacobianType               jacj(outdim, sizejacind);
+      NonZeroJacobianIndicesType jacind(sizejacind);
+      JacobianType               jacjjacj(outdim, outdim);
+      JacobianType               jacjcovjacj(outdim, outdim);
+      std::vector<double>        jcz(outdim);
+      std::vector<double>        jz(outdim);
+
+      const SizeValueType firstSample = nrofsamples * block / numberOfBlocks;
+      const SizeValueType endSample = nrofsamples * (block + 1) / numberOfBlocks;
+      for (SizeValueType samplenr = firstSample; samplenr < endSample; ++samplenr)
+      {
+        const FixedImagePointType & point = sampleContainer.GetElement(samplenr).m_ImageCoordinates;
+        this->GetScaledJacobian(point, jacj, jacind);
 
-    /** Max_j [JCJ_j]. */
-    maxJCJ = std::max(maxJCJ, JCJ_j);
+        /** JJ_j = ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F. */
+        vnl_fastops::ABt(jacjjacj, jacj, jacj);
+        const double JJ_j = vnl_math::sqr(jacj.frobenius_norm()) + 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+        blockMaxJJ[block] = std::max(blockMaxJJ[block], JJ_j);
 
-    /** Show progress 50-100%. */
-    // progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
+        /** J_j C J_j^T = 1/m \sum_k ( J_j C z_k ) ( J_j z_k )^T. */
+        jacjcovjacj.Fill(0.0);
+        for (unsigned int k = 0; k < m; ++k)
+        {
+          std::fill(jcz.begin(), jcz.end(), 0.0);
+          std::fill(jz.begin(), jz.end(), 0.0);
+          for (unsigned int pi = 0; pi < sizejacind; ++pi)
+          {
+            const std::size_t index = static_cast<std::size_t>(jacind[pi]) * m + k;
+            for (unsigned int d = 0; d < outdim; ++d)
+            {
+              jcz[d] += jacj[d][pi] * covProbes[index];
+              jz[d] += jacj[d][pi] * probes[index];
+            }
+          }
+          for (unsigned int d1 = 0; d1 < outdim; ++d1)
+          {
+            for (unsigned int d2 = 0; d2 < outdim; ++d2)
+            {
+              jacjcovjacj[d1][d2] += 0.5 * (jcz[d1] * jz[d2] + jz[d1] * jcz[d2]) / static_cast<double>(m);
+            }
+          }
+        }
 
-  } // end loop over sample container
+        /** JCJ_j = Tr( J_j C J_j^T ) + 2 \sqrt{2} || J_j C J_j^T ||_F. */
+        double JCJ_j = 0.0;
+        for (unsigned int d = 0; d < outdim; ++d)
+        {
+          JCJ_j += jacjcovjacj[d][d];
+        }
+        JCJ_j += 2.0 * sqrt2 * jacjcovjacj.frobenius_norm();
+        blockMaxJCJ[block] = std::max(blockMaxJCJ[block], JCJ_j);
+      }
+    });
 
-  /** Finalize progress information. */
-  // progressObserver->PrintProgress( 1.0 );
+  maxJJ = *std::max_element(blockMaxJJ.begin(), blockMaxJJ.end());
+  maxJCJ = *std::max_element(blockMaxJCJ.begin(), blockMaxJCJ.end());
 
-} // end Compute()
+} // end ComputeRandomized()
+
+
+/**
+ * ************************* GetScaledJacobian ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::GetScaledJacobian(const FixedImagePointType &  point,
+                                                                 JacobianType &               jacj,
+                                                                 NonZeroJacobianIndicesType & jacind) const
+{
+  this->m_Transform->GetJacobian(point, jacj, jacind);
+
+  /** Apply scales, if necessary. */
+  if (this->m_UseScales)
+  {
+    const unsigned int sizejacind = static_cast<unsigned int>(jacind.size());
+    for (unsigned int pi = 0; pi < sizejacind; ++pi)
+    {
+      const unsigned int p = jacind[pi];
+      jacj.scale_column(pi, 1.0 / this->m_Scales[p]);
+    }
+  }
+
+} // end GetScaledJacobian()
+
+
+/**
+ * ************************* ComputeJacobianBatch ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputeJacobianTerms<TFixedImage, TTransform>::ComputeJacobianBatch(const ImageSampleContainerType & sampleContainer,
+                                                                    const SizeValueType              first,
+                                                                    const SizeValueType              last,
+                                                                    JacobianBatchType &              batch) const
+{
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+  const unsigned int sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+
+  /** The Jacobians of the previous batch are reused, to avoid reallocations. */
+  batch.m_Jacobians.resize(last - first, JacobianType(outdim, sizejacind));
+  batch.m_NonZeroJacobianIndices.resize(last - first, NonZeroJacobianIndicesType(sizejacind));
+  batch.m_Valid.assign(last - first, 0);
+
+  ParallelTasks::ParallelizeArray(
+    first,
+    last,
+    [this, &sampleContainer, &batch, first, sizejacind](SizeValueType i) {
+      JacobianType &               jacj = batch.m_Jacobians[i - first];
+      NonZeroJacobianIndicesType & jacind = batch.m_NonZeroJacobianIndices[i - first];
+      this->GetScaledJacobian(sampleContainer.GetElement(i).m_ImageCoordinates, jacj, jacind);
+
+      /** Skip invalid Jacobians, if any. */
+      batch.m_Valid[i - first] = !(sizejacind > 1 && jacind[0] == jacind[1]);
+    });
+
+} // end ComputeJacobianBatch()
 
 
 /**
@@ -20,6 +20,8 @@
 
 #include "itkComputeDisplacementDistribution.h"
 
+#include <vector>
+
 
 namespace itk
 {
@@ -106,10 +108,15 @@ public:
 
   /** The main function that performs the computation.
    * The aims to be a generic function, working for all transformations.
+   * The samples are processed on multiple threads, each accumulating its own
+   * terms, which are summed on multiple threads as well.
    */
   virtual void
   Compute(const ParametersType & mu, double & maxJJ, ParametersType & preconditioner);
 
+  /** Compute the Jacobi type preconditioner, which only depends on the Jacobian
+   * of the transform at the samples, multi-threaded as Compute().
+   */
   virtual void
   ComputeJacobiTypePreconditioner(const ParametersType & mu, double & maxJJ, ParametersType & preconditioner);
 
@@ -138,11 +145,56 @@ protected:
   typedef typename Superclass::TransformJacobianType         TransformJacobianType;
   typedef typename Superclass::CoordinateRepresentationType  CoordinateRepresentationType;
   typedef typename Superclass::NumberOfParametersType        NumberOfParametersType;
+  typedef typename Superclass::ThreadInfoType                ThreadInfoType;
 
   double m_MaximumStepLength;
   double m_RegularizationKappa;
   double m_ConditionNumber;
 
+  /** Accumulate the preconditioner terms of all samples in m_SampleContainer,
+   * on multiple threads, and sum them in the variables of the first thread.
+   */
+  void
+  AccumulatePreconditionerTerms(const bool jacobiType, const bool transformIsBSpline, double & maxJJ);
+
+  /** Accumulate the terms of the samples of one thread. */
+  void
+  ThreadedAccumulatePreconditionerTerms(ThreadIdType threadId);
+
+  /** Sum the terms of all threads for the parameters of one thread. */
+  void
+  ThreadedSumPreconditionerTerms(ThreadIdType threadId);
+
+  /** Accumulate the displacement terms of Compute() for a single sample. */
+  void
+  AccumulateDisplacementTerms(const JacobianType &               jacj,
+                              const NonZeroJacobianIndicesType & jacind,
+                              DerivativeType &                   jacj_g,
+                              const ThreadIdType                 threadId);
+
+  /** Threader callbacks of the accumulation and the summation. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  AccumulateThreaderCallback(void * arg);
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  SumThreaderCallback(void * arg);
+
+  /** The terms accumulated by each thread: the sum and the sum of squares of
+   * the contributions to each parameter, and the number of contributions.
+   */
+  struct PreconditionerPerThreadStruct
+  {
+    double              st_MaxJJ;
+    std::vector<double> st_Sum;
+    std::vector<double> st_SumSquared;
+    std::vector<double> st_Count;
+  };
+  std::vector<PreconditionerPerThreadStruct> m_PreconditionerPerThreadVariables;
+
+  /** Settings of the threaded accumulation. */
+  bool m_JacobiType;
+  bool m_TransformIsBSpline;
+
 private:
   ComputePreconditionerUsingDisplacementDistribution(const Self &) = delete;
   void
@@ -21,6 +21,7 @@
 #include "itkComputePreconditionerUsingDisplacementDistribution.h"
 
 #include "vnl/vnl_math.h"
+#include "vnl/vnl_fastops.h"
 
 #include "itkImageScanlineIterator.h"
 #include "itkImageSliceIteratorWithIndex.h"
@@ -29,6 +30,7 @@
 #include "itkZeroFluxNeumannPadImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
 
+#include <algorithm>
 #include <cmath> // For abs.
 
 
@@ -45,6 +47,8 @@ ComputePreconditionerUsingDisplacementDistribution<TFixedImage,
   this->m_RegularizationKappa = 0.8;
   this->m_MaximumStepLength = 1.0;
   this->m_ConditionNumber = 2.0;
+  this->m_JacobiType = false;
+  this->m_TransformIsBSpline = false;
 } // end Constructor
 
 
@@ -316,15 +320,6 @@ ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::Com
     {
       ++counter_tmp;
     }
-
-#if 0
-    elxout << std::scientific;
-    elxout << "The preconditioner before interpolation: [ ";
-    //elxout << sigma << " ";
-    elxout << preconditioner[i] << " ";
-    elxout << "]" << std::endl;
-    elxout << std::fixed;
-#endif
   } // end loop over localStepSize vector
 
   if (counter_tmp > 0)
@@ -359,174 +354,22 @@ ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::Com
   /** Get the exact gradient. Uses a random coordinate sampler with
    * NumberOfSamplesForPrecondition samples, which equals P.
    */
-  DerivativeType exactgradient(P);
-  this->GetScaledDerivative(mu, exactgradient);
+  this->m_NumberOfParameters = P;
+  this->m_ExactGradient = DerivativeType(P);
+  this->GetScaledDerivative(mu, this->m_ExactGradient);
 
   /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
-  ImageSampleContainerPointer sampleContainer;
-  this->SampleFixedImageForJacobianTerms(sampleContainer);
-  const SizeValueType nrofsamples = sampleContainer->Size();
+  this->SampleFixedImageForJacobianTerms(this->m_SampleContainer);
 
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int              outdim = this->m_Transform->GetOutputSpaceDimension();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
-
-  /** Variables for nonzerojacobian indices and the Jacobian. */
-  const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
-  JacobianType        jacj(outdim, sizejacind);
-  jacj.Fill(0.0);
-  NonZeroJacobianIndicesType jacind(sizejacind);
-
-  /** Declare temporary variables. Not needed for all methods. check later */
-  DerivativeType jacj_g(outdim);
-  jacj_g.Fill(0.0);
-  JacobianType        jacjjacj(outdim, outdim);
-  const double        sqrt2 = std::sqrt(static_cast<double>(2.0));
-  std::vector<double> localStepSizeSquared(P, 0.0);
-  ParametersType      binCount(P);
-  binCount.Fill(0.0);
-
-  /** Loop over all voxels in the sample container. */
-  for (iter = begin; iter != end; ++iter)
+  /** Accumulate the displacements due to each parameter on multiple threads. */
+  this->AccumulatePreconditionerTerms(false, transformIsBSpline, maxJJ);
+  const PreconditionerPerThreadStruct & terms = this->m_PreconditionerPerThreadVariables[0];
+  const std::vector<double> &           localStepSizeSquared = terms.st_SumSquared;
+  const std::vector<double> &           binCount = terms.st_Count;
+  for (unsigned int i = 0; i < P; ++i)
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian(point, jacj, jacind);
-
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr(jacj.frobenius_norm());
-
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt(jacjjacj, jacj, jacj);
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
-
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max(maxJJ, JJ_j);
-
-    double displacement2_j = 0.0;
-    if (transformIsBSpline)
-    {
-      for (unsigned int i = 0; i < outdim; ++i)
-      {
-        double temp = 0.0;
-        for (unsigned int j = 0; j < sizejacind; ++j)
-        {
-          int pj = jacind[j];
-          temp += jacj(i, j) * exactgradient(pj);
-        }
-
-        // Use the absolute value
-        jacj_g(i) = std::abs(temp);
-      }
-      displacement2_j = jacj_g.magnitude();
-    }
-
-    /** Update all entries of the pre-conditioner. */
-    for (unsigned int j = 0; j < sizejacind; ++j)
-    {
-      const unsigned int pj = jacind[j];
-      double             displacement_j = 0.0;
-      double             jacj_current = 0.0;
-      for (unsigned int i = 0; i < outdim; ++i)
-      {
-        jacj_current += std::abs(jacj(i, j));
-      }
-      displacement_j = std::abs(jacj_current * exactgradient(pj));
-
-      if (transformIsBSpline)
-      {
-        displacement_j =
-          displacement_j * this->m_RegularizationKappa + (1.0 - this->m_RegularizationKappa) * displacement2_j;
-      }
-      else
-      { // else for affine and rigid
-        double diff_jacobian = 0;
-        double weight = 0;
-        double sum_displacement = 0;
-        double sum_weight = 0;
-        double weight_sigma = 0.01;
-        double maxdiff = 0.0;
-        double mindiff = 0.0;
-        bool   mindiffCheck = true;
-
-        /** Obtain the maximum and minimum difference of absolute jacobian. */
-        for (unsigned int k = 0; k < sizejacind; ++k)
-        {
-          if (k != j)
-          {
-            double jacj_k = 0.0;
-            for (unsigned int i = 0; i < outdim; ++i)
-            {
-              jacj_k += std::abs(jacj(i, k));
-            }
-            diff_jacobian = std::abs(jacj_k - jacj_current);
-            if (diff_jacobian > 0 && mindiffCheck)
-            {
-              mindiff = diff_jacobian;
-              mindiffCheck = false;
-            }
-            if (diff_jacobian > 0 && !mindiffCheck)
-            {
-              mindiff = diff_jacobian < mindiff ? diff_jacobian : mindiff;
-            }
-            maxdiff = diff_jacobian > maxdiff ? diff_jacobian : maxdiff;
-          } // end if
-        }   // end for
-
-        if (maxdiff > 0)
-        {
-          weight_sigma = mindiff / maxdiff;
-        }
-        else
-        {
-          weight_sigma = 1e-9;
-        }
-
-        /** To regularize the other entries using the neighborhood information. */
-        for (unsigned int k = 0; k < sizejacind; ++k)
-        {
-          const unsigned int pk = jacind[k];
-          if (k != j)
-          {
-            double jacj_k = 0.0;
-            for (unsigned int i = 0; i < outdim; ++i)
-            {
-              jacj_k += std::abs(jacj(i, k));
-            }
-
-            diff_jacobian = std::abs(jacj_k - jacj_current);
-            weight = std::exp(-(vnl_math::sqr(diff_jacobian / weight_sigma) / 2.0));
-
-            sum_displacement += std::abs(jacj_k * exactgradient(pk)) * weight;
-            sum_weight += weight;
-          } // end if
-        }   // end for loop regularization
-
-        if (sum_weight > 0.0)
-        {
-          sum_displacement /= sum_weight;
-
-          /** regularize. */
-          displacement_j =
-            displacement_j * this->m_RegularizationKappa + (1.0 - this->m_RegularizationKappa) * sum_displacement;
-        }
-      } // end else for affine and rigid
-
-      /** Compute the displacement due to a change in this parameter. */
-      /** localStepSize keeps track of the mean displacement.
-       * localStepSizeSquared keeps track of the standard deviation.
-       */
-      preconditioner[pj] += displacement_j;
-      localStepSizeSquared[pj] += displacement_j * displacement_j;
-      binCount[pj] += 1.0;
-    }
-  } // end loop over sample container
-
+    preconditioner[i] += terms.st_Sum[i];
+  }
 
   /** Compute the mean local step sizes and apply the 2 sigma rule. */
   double maxEigenvalue = -1e+9;
@@ -610,33 +453,174 @@ ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::Com
     transformIsBSpline = true; // assume B-spline
 
   /** Get samples. Uses a grid sampler with m_NumberOfJacobianMeasurements samples. */
-  ImageSampleContainerPointer sampleContainer;
-  this->SampleFixedImageForJacobianTerms(sampleContainer);
-  const SizeValueType nrofsamples = sampleContainer->Size();
+  this->m_NumberOfParameters = P;
+  this->SampleFixedImageForJacobianTerms(this->m_SampleContainer);
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+
+  /** Accumulate the squared Jacobian entries on multiple threads. */
+  this->AccumulatePreconditionerTerms(true, transformIsBSpline, maxJJ);
+  const PreconditionerPerThreadStruct & terms = this->m_PreconditionerPerThreadVariables[0];
+  const std::vector<double> &           binCount = terms.st_Count;
+  for (unsigned int i = 0; i < P; ++i)
+  {
+    preconditioner[i] += terms.st_Sum[i];
+  }
 
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform = this->m_Transform;
-  const unsigned int              outdim = this->m_Transform->GetOutputSpaceDimension();
+  double maxEigenvalue = -1e+9;
+  double minEigenvalue = 1e+9;
+  for (unsigned int i = 0; i < P; ++i)
+  {
+    double nonZeroBin = binCount[i] / outdim;
+    if (nonZeroBin > 0 && preconditioner[i] > 1e-9)
+    {
+      double eigenvalue = std::sqrt(preconditioner[i] / (nonZeroBin)) + 1e-14;
+      maxEigenvalue = std::max(eigenvalue, maxEigenvalue);
+      minEigenvalue = std::min(eigenvalue, minEigenvalue);
+      preconditioner[i] = 1.0 / eigenvalue;
+    }
+  }
+
+  /** Condition number check. */
+  double conditionNumber = maxEigenvalue / minEigenvalue;
+
+  if (transformIsBSpline && conditionNumber > this->m_ConditionNumber)
+  {
+    minEigenvalue = maxEigenvalue / this->m_ConditionNumber;
+    for (unsigned int i = 0; i < P; ++i)
+    {
+      if (preconditioner[i] > 1.0 / minEigenvalue)
+      {
+        preconditioner[i] = 1.0 / minEigenvalue;
+      }
+    }
+  }
+
+} // end ComputeJacobiTypePreconditioner()
+
+
+/**
+ * ************************* AccumulatePreconditionerTerms ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::AccumulatePreconditionerTerms(
+  const bool jacobiType,
+  const bool transformIsBSpline,
+  double &   maxJJ)
+{
+  this->m_JacobiType = jacobiType;
+  this->m_TransformIsBSpline = transformIsBSpline;
+
+  /** The threads allocate and initialize their own variables. */
+  const ThreadIdType numberOfThreads = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  this->m_PreconditionerPerThreadVariables.resize(numberOfThreads);
+
+  if (numberOfThreads == 1)
+  {
+    this->ThreadedAccumulatePreconditionerTerms(0);
+  }
+  else
+  {
+    void * userData = const_cast<void *>(static_cast<const void *>(&this->m_ThreaderParameters));
+    this->LaunchThreaderCallback(Self::AccumulateThreaderCallback, userData);
+    this->LaunchThreaderCallback(Self::SumThreaderCallback, userData);
+  }
+
+  /** Max_j [JJ_j] over all threads. */
+  maxJJ = 0.0;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    maxJJ = std::max(maxJJ, this->m_PreconditionerPerThreadVariables[i].st_MaxJJ);
+  }
+
+} // end AccumulatePreconditionerTerms()
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end = sampleContainer->End();
+
+/**
+ * ************************* AccumulateThreaderCallback ************************
+ */
+
+template <class TFixedImage, class TTransform>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::AccumulateThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType threadId = infoStruct->WorkUnitID;
+  auto *             temp = static_cast<typename Superclass::MultiThreaderParameterType *>(infoStruct->UserData);
+
+  static_cast<Self *>(temp->st_Self)->ThreadedAccumulatePreconditionerTerms(threadId);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AccumulateThreaderCallback()
+
+
+/**
+ * ************************* SumThreaderCallback ************************
+ */
+
+template <class TFixedImage, class TTransform>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::SumThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType threadId = infoStruct->WorkUnitID;
+  auto *             temp = static_cast<typename Superclass::MultiThreaderParameterType *>(infoStruct->UserData);
+
+  static_cast<Self *>(temp->st_Self)->ThreadedSumPreconditionerTerms(threadId);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end SumThreaderCallback()
+
+
+/**
+ * ************************* ThreadedAccumulatePreconditionerTerms ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::ThreadedAccumulatePreconditionerTerms(
+  ThreadIdType threadId)
+{
+  /** Get sample container size, number of threads, and output space dimension. */
+  const SizeValueType sampleContainerSize = this->m_SampleContainer->Size();
+  const auto          numberOfThreads = static_cast<ThreadIdType>(this->m_PreconditionerPerThreadVariables.size());
+  const unsigned int  outdim = this->m_Transform->GetOutputSpaceDimension();
+  const SizeValueType P = this->m_NumberOfParameters;
+
+  /** Initialize the variables of this thread. */
+  PreconditionerPerThreadStruct & threadVariables = this->m_PreconditionerPerThreadVariables[threadId];
+  threadVariables.st_MaxJJ = 0.0;
+  threadVariables.st_Sum.assign(P, 0.0);
+  threadVariables.st_Count.assign(P, 0.0);
+  if (!this->m_JacobiType)
+  {
+    threadVariables.st_SumSquared.assign(P, 0.0);
+  }
+
+  /** Get the samples for this thread. */
+  const SizeValueType nrOfSamplesPerThreads = (sampleContainerSize + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType pos_begin = std::min(nrOfSamplesPerThreads * threadId, sampleContainerSize);
+  const SizeValueType pos_end = std::min(nrOfSamplesPerThreads * (threadId + 1), sampleContainerSize);
 
   /** Variables for nonzerojacobian indices and the Jacobian. */
   const SizeValueType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
   JacobianType        jacj(outdim, sizejacind);
   jacj.Fill(0.0);
-  JacobianType               jacjjacj(outdim, outdim);
-  const double               sqrt2 = std::sqrt(static_cast<double>(2.0));
   NonZeroJacobianIndicesType jacind(sizejacind);
-  ParametersType             binCount(P, 0.0);
+  JacobianType               jacjjacj(outdim, outdim);
+  DerivativeType             jacj_g(outdim);
+  jacj_g.Fill(0.0);
+  const double sqrt2 = std::sqrt(static_cast<double>(2.0));
+  double       maxJJ = 0.0;
 
-  /** Loop over all voxels in the sample container. */
-  for (iter = begin; iter != end; ++iter)
+  /** Loop over the voxels of this thread. */
+  for (SizeValueType s = pos_begin; s < pos_end; ++s)
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = (*iter).Value().m_ImageCoordinates;
+    const FixedImagePointType & point = this->m_SampleContainer->ElementAt(s).m_ImageCoordinates;
     this->m_Transform->GetJacobian(point, jacj, jacind);
 
     /** Compute 1st part of JJ: ||J_j||_F^2. */
@@ -649,64 +633,205 @@ ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::Com
     /** Max_j [JJ_j]. */
     maxJJ = std::max(maxJJ, JJ_j);
 
-    for (unsigned int i = 0; i < outdim; ++i)
+    if (this->m_JacobiType)
     {
-      for (unsigned int j = 0; j < sizejacind; ++j)
+      for (unsigned int i = 0; i < outdim; ++i)
       {
-        const unsigned int pj = jacind[j];
-        preconditioner[pj] += vnl_math::sqr(jacj(i, j));
-        binCount[pj] += 1;
+        for (unsigned int j = 0; j < sizejacind; ++j)
+        {
+          const unsigned int pj = jacind[j];
+          threadVariables.st_Sum[pj] += vnl_math::sqr(jacj(i, j));
+          threadVariables.st_Count[pj] += 1;
+        }
       }
     }
+    else
+    {
+      this->AccumulateDisplacementTerms(jacj, jacind, jacj_g, threadId);
+    }
   }
 
-  double maxEigenvalue = -1e+9;
-  double minEigenvalue = 1e+9;
-  for (unsigned int i = 0; i < P; ++i)
+  threadVariables.st_MaxJJ = maxJJ;
+
+} // end ThreadedAccumulatePreconditionerTerms()
+
+
+/**
+ * ************************* ThreadedSumPreconditionerTerms ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::ThreadedSumPreconditionerTerms(
+  ThreadIdType threadId)
+{
+  /** Every thread sums the terms of a contiguous range of parameters into
+   * the variables of the first thread.
+   */
+  const auto          numberOfThreads = static_cast<ThreadIdType>(this->m_PreconditionerPerThreadVariables.size());
+  const SizeValueType P = this->m_NumberOfParameters;
+  const SizeValueType nrOfParametersPerThread = (P + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType pos_begin = std::min(nrOfParametersPerThread * threadId, P);
+  const SizeValueType pos_end = std::min(nrOfParametersPerThread * (threadId + 1), P);
+
+  PreconditionerPerThreadStruct & sum = this->m_PreconditionerPerThreadVariables[0];
+  for (ThreadIdType t = 1; t < numberOfThreads; ++t)
   {
-    double nonZeroBin = binCount[i] / outdim;
-    if (nonZeroBin > 0 && preconditioner[i] > 1e-9)
+    const PreconditionerPerThreadStruct & threadVariables = this->m_PreconditionerPerThreadVariables[t];
+    for (SizeValueType p = pos_begin; p < pos_end; ++p)
     {
-      double eigenvalue = std::sqrt(preconditioner[i] / (nonZeroBin)) + 1e-14;
-      maxEigenvalue = std::max(eigenvalue, maxEigenvalue);
-      minEigenvalue = std::min(eigenvalue, minEigenvalue);
-      preconditioner[i] = 1.0 / eigenvalue;
+      sum.st_Sum[p] += threadVariables.st_Sum[p];
+      sum.st_Count[p] += threadVariables.st_Count[p];
+    }
+    if (!this->m_JacobiType)
+    {
+      for (SizeValueType p = pos_begin; p < pos_end; ++p)
+      {
+        sum.st_SumSquared[p] += threadVariables.st_SumSquared[p];
+      }
     }
   }
 
-#if 0
-  elxout << std::scientific;
-  elxout << "The max eigen value is: [ ";
-  elxout << maxEigenvalue << " ";
-  elxout << "]" << std::endl;
-  elxout << "The min eigen value is: [ ";
-  elxout << minEigenvalue << " ";
-  elxout << "]" << std::endl;
-#endif
+} // end ThreadedSumPreconditionerTerms()
 
-  /** Condition number check. */
-  double conditionNumber = maxEigenvalue / minEigenvalue;
 
-  if (transformIsBSpline && conditionNumber > this->m_ConditionNumber)
+/**
+ * ************************* AccumulateDisplacementTerms ************************
+ */
+
+template <class TFixedImage, class TTransform>
+void
+ComputePreconditionerUsingDisplacementDistribution<TFixedImage, TTransform>::AccumulateDisplacementTerms(
+  const JacobianType &               jacj,
+  const NonZeroJacobianIndicesType & jacind,
+  DerivativeType &                   jacj_g,
+  const ThreadIdType                 threadId)
+{
+  PreconditionerPerThreadStruct & threadVariables = this->m_PreconditionerPerThreadVariables[threadId];
+  const DerivativeType &          exactgradient = this->m_ExactGradient;
+  const bool                      transformIsBSpline = this->m_TransformIsBSpline;
+  const unsigned int              outdim = jacj.rows();
+  const unsigned int              sizejacind = jacj.cols();
+
+  double displacement2_j = 0.0;
+  if (transformIsBSpline)
   {
-    minEigenvalue = maxEigenvalue / this->m_ConditionNumber;
-    for (unsigned int i = 0; i < P; ++i)
+    for (unsigned int i = 0; i < outdim; ++i)
     {
-      if (preconditioner[i] > 1.0 / minEigenvalue)
+      double temp = 0.0;
+      for (unsigned int j = 0; j < sizejacind; ++j)
       {
-        preconditioner[i] = 1.0 / minEigenvalue;
+        int pj = jacind[j];
+        temp += jacj(i, j) * exactgradient(pj);
       }
+
+      // Use the absolute value
+      jacj_g(i) = std::abs(temp);
     }
+    displacement2_j = jacj_g.magnitude();
   }
 
-#if 0
-  elxout << std::scientific;
-  elxout << "The condition number after constraints is: [ ";
-  elxout << maxEigenvalue / minEigenvalue << " ";
-  elxout << "]" << std::endl;
-  elxout << std::fixed;
-#endif
-} // end ComputeJacobiTypePreconditioner()
+  /** Update all entries of the pre-conditioner. */
+  for (unsigned int j = 0; j < sizejacind; ++j)
+  {
+    const unsigned int pj = jacind[j];
+    double             displacement_j = 0.0;
+    double             jacj_current = 0.0;
+    for (unsigned int i = 0; i < outdim; ++i)
+    {
+      jacj_current += std::abs(jacj(i, j));
+    }
+    displacement_j = std::abs(jacj_current * exactgradient(pj));
+
+    if (transformIsBSpline)
+    {
+      displacement_j =
+        displacement_j * this->m_RegularizationKappa + (1.0 - this->m_RegularizationKappa) * displacement2_j;
+    }
+    else
+    { // else for affine and rigid
+      double diff_jacobian = 0;
+      double weight = 0;
+      double sum_displacement = 0;
+      double sum_weight = 0;
+      double weight_sigma = 0.01;
+      double maxdiff = 0.0;
+      double mindiff = 0.0;
+      bool   mindiffCheck = true;
+
+      /** Obtain the maximum and minimum difference of absolute jacobian. */
+      for (unsigned int k = 0; k < sizejacind; ++k)
+      {
+        if (k != j)
+        {
+          double jacj_k = 0.0;
+          for (unsigned int i = 0; i < outdim; ++i)
+          {
+            jacj_k += std::abs(jacj(i, k));
+          }
+          diff_jacobian = std::abs(jacj_k - jacj_current);
+          if (diff_jacobian > 0 && mindiffCheck)
+          {
+            mindiff = diff_jacobian;
+            mindiffCheck = false;
+          }
+          if (diff_jacobian > 0 && !mindiffCheck)
+          {
+            mindiff = diff_jacobian < mindiff ? diff_jacobian : mindiff;
+          }
+          maxdiff = diff_jacobian > maxdiff ? diff_jacobian : maxdiff;
+        } // end if
+      }   // end for
+
+      if (maxdiff > 0)
+      {
+        weight_sigma = mindiff / maxdiff;
+      }
+      else
+      {
+        weight_sigma = 1e-9;
+      }
+
+      /** To regularize the other entries using the neighborhood information. */
+      for (unsigned int k = 0; k < sizejacind; ++k)
+      {
+        const unsigned int pk = jacind[k];
+        if (k != j)
+        {
+          double jacj_k = 0.0;
+          for (unsigned int i = 0; i < outdim; ++i)
+          {
+            jacj_k += std::abs(jacj(i, k));
+          }
+
+          diff_jacobian = std::abs(jacj_k - jacj_current);
+          weight = std::exp(-(vnl_math::sqr(diff_jacobian / weight_sigma) / 2.0));
+
+          sum_displacement += std::abs(jacj_k * exactgradient(pk)) * weight;
+          sum_weight += weight;
+        } // end if
+      }   // end for loop regularization
+
+      if (sum_weight > 0.0)
+      {
+        sum_displacement /= sum_weight;
+
+        /** regularize. */
+        displacement_j =
+          displacement_j * this->m_RegularizationKappa + (1.0 - this->m_RegularizationKappa) * sum_displacement;
+      }
+    } // end else for affine and rigid
+
+    /** Compute the displacement due to a change in this parameter. */
+    /** localStepSize keeps track of the mean displacement.
+     * localStepSizeSquared keeps track of the standard deviation.
+     */
+    threadVariables.st_Sum[pj] += displacement_j;
+    threadVariables.st_SumSquared[pj] += displacement_j * displacement_j;
+    threadVariables.st_Count[pj] += 1.0;
+  }
+
+} // end AccumulateDisplacementTerms()
 
 
 /**
@@ -49,6 +49,12 @@ namespace itk
  *   --> <tt>radius = static_cast<unsigned long>( 2 * schedule + 1 );</tt>
  *
  *
+ * When the mask has an integer pixel type, the erosions of all resolution levels
+ * can be derived from a single squared distance image, see ComputeSquaredDistanceImage().
+ * For every level with an isotropic schedule, the output is then obtained by thresholding
+ * that image, instead of by another parabolic erosion. The result has the same
+ * nonzero voxels, which keep their input value; for masks of 0's and 1's it is identical.
+ *
  * \sa ParabolicErodeImageFilter
  *
  **/
@@ -86,6 +92,11 @@ public:
   typedef MultiResolutionPyramidImageFilter<InputImageType, OutputImageType> ImagePyramidFilterType;
   typedef typename ImagePyramidFilterType::ScheduleType                      ScheduleType;
 
+  /** The image of the squared distances (in voxels) to the nearest zero voxel. */
+  typedef Image<float, ImageDimension>                    SquaredDistanceImageType;
+  typedef typename SquaredDistanceImageType::Pointer      SquaredDistanceImagePointer;
+  typedef typename SquaredDistanceImageType::ConstPointer SquaredDistanceImageConstPointer;
+
   /** Set/Get the pyramid schedule used to downsample the image whose
    * mask is the input of the ErodeMaskImageFilter
    * Default: filled with ones, one resolution.
@@ -112,6 +123,20 @@ public:
   itkSetMacro(ResolutionLevel, unsigned int);
   itkGetConstMacro(ResolutionLevel, unsigned int);
 
+  /** Set/Get the squared distance image of the input mask, computed by
+   * ComputeSquaredDistanceImage(). Optional; when it is set, the erosion of a level
+   * with an isotropic schedule is obtained by thresholding it. Default: null.
+   */
+  itkSetConstObjectMacro(SquaredDistanceImage, SquaredDistanceImageType);
+  itkGetConstObjectMacro(SquaredDistanceImage, SquaredDistanceImageType);
+
+  /** Compute, for every voxel of the mask, the squared distance (in voxels, within the image)
+   * to the nearest zero voxel, by a single multi-threaded parabolic erosion. Returns null
+   * when the pixel type of the mask is not an integer type.
+   */
+  static SquaredDistanceImagePointer
+  ComputeSquaredDistanceImage(const InputImageType * mask);
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(SameDimensionCheck, (Concept::SameDimension<InputImageDimension, OutputImageDimension>));
@@ -137,9 +162,10 @@ private:
   void
   operator=(const Self &) = delete;
 
-  bool         m_IsMovingMask;
-  unsigned int m_ResolutionLevel;
-  ScheduleType m_Schedule;
+  bool                             m_IsMovingMask;
+  unsigned int                     m_ResolutionLevel;
+  ScheduleType                     m_Schedule;
+  SquaredDistanceImageConstPointer m_SquaredDistanceImage;
 };
 
 } // end namespace itk
@@ -20,6 +20,8 @@
 
 #include "itkErodeMaskImageFilter.h"
 #include "itkParabolicErodeImageFilter.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkImageRegionIterator.h"
 //#include "itkThresholdImageFilter.h"
 
 namespace itk
@@ -77,6 +79,43 @@ ErodeMaskImageFilter<TImage>::GenerateData(void)
     radiusarray.SetElement(i, radius);
   }
 
+  /** Threshold the squared distances, if they are available and the schedule of this level is isotropic.
+   * The parabolic erosion of a mask keeps a voxel if its squared distance to the nearest zero voxel
+   * is at least twice the (then equal) scales.
+   */
+  const SquaredDistanceImageType * squaredDistanceImage = this->m_SquaredDistanceImage.GetPointer();
+  OutputImageType *                output = this->GetOutput();
+  bool                             isotropic = true;
+  for (unsigned int i = 1; i < InputImageDimension; ++i)
+  {
+    isotropic &= radiusarray[i] == radiusarray[0];
+  }
+  if (squaredDistanceImage != nullptr && isotropic && NumericTraits<InputPixelType>::is_integer &&
+      squaredDistanceImage->GetBufferedRegion().IsInside(output->GetRequestedRegion()))
+  {
+    typedef typename OutputImageType::RegionType RegionType;
+    const InputImageType *                       input = this->GetInput();
+    const double                                 minimumSquaredDistance = 2.0 * radiusarray[0];
+    const OutputPixelType                        zero = NumericTraits<OutputPixelType>::ZeroValue();
+    output->SetBufferedRegion(output->GetRequestedRegion());
+    output->Allocate();
+
+    this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+      output->GetRequestedRegion(),
+      [input, squaredDistanceImage, output, minimumSquaredDistance, zero](const RegionType & region) {
+        ImageRegionConstIterator<InputImageType>           inputIt(input, region);
+        ImageRegionConstIterator<SquaredDistanceImageType> distanceIt(squaredDistanceImage, region);
+        ImageRegionIterator<OutputImageType>               outputIt(output, region);
+        for (; !outputIt.IsAtEnd(); ++inputIt, ++distanceIt, ++outputIt)
+        {
+          const bool inside = static_cast<double>(distanceIt.Get()) >= minimumSquaredDistance;
+          outputIt.Set(inside ? static_cast<OutputPixelType>(inputIt.Get()) : zero);
+        }
+      },
+      this);
+    return;
+  }
+
   /** Threshold the data first. Every voxel with intensity >= 1 is used.
   // Not needed since IsInside of a mask checks for != 0.
   typename ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
@@ -100,6 +139,43 @@ ErodeMaskImageFilter<TImage>::GenerateData(void)
 } // end GenerateData()
 
 
+/**
+ * ************* ComputeSquaredDistanceImage *******************
+ */
+
+template <class TImage>
+typename ErodeMaskImageFilter<TImage>::SquaredDistanceImagePointer
+ErodeMaskImageFilter<TImage>::ComputeSquaredDistanceImage(const InputImageType * mask)
+{
+  if (mask == nullptr || !NumericTraits<InputPixelType>::is_integer)
+  {
+    return nullptr;
+  }
+
+  /** The zero voxels get distance 0, all others the largest value. */
+  typedef BinaryThresholdImageFilter<InputImageType, SquaredDistanceImageType> IndicatorFilterType;
+  typename IndicatorFilterType::Pointer indicator = IndicatorFilterType::New();
+  indicator->SetInput(mask);
+  indicator->SetLowerThreshold(NumericTraits<InputPixelType>::ZeroValue());
+  indicator->SetUpperThreshold(NumericTraits<InputPixelType>::ZeroValue());
+  indicator->SetInsideValue(0.0f);
+  indicator->SetOutsideValue(NumericTraits<float>::max());
+
+  /** A parabolic erosion with scale 1/2 adds the squared distance, in voxels. */
+  typedef ParabolicErodeImageFilter<SquaredDistanceImageType, SquaredDistanceImageType> ErodeFilterType;
+  typename ErodeFilterType::Pointer erosion = ErodeFilterType::New();
+  erosion->SetUseImageSpacing(false);
+  erosion->SetScale(0.5);
+  erosion->SetInput(indicator->GetOutput());
+  erosion->Update();
+
+  SquaredDistanceImagePointer squaredDistanceImage = erosion->GetOutput();
+  squaredDistanceImage->DisconnectPipeline();
+  return squaredDistanceImage;
+
+} // end ComputeSquaredDistanceImage()
+
+
 } // end namespace itk
 
 #endif
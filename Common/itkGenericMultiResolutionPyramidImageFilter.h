@@ -21,6 +21,8 @@
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkSmoothingRecursiveGaussianImageFilter.h"
 
+#include <future>
+
 namespace itk
 {
 /** \class GenericMultiResolutionPyramidImageFilter
@@ -96,7 +98,8 @@ namespace itk
  *
  * The GenericMultiResolutionPyramidImageFilter provides direct control to
  * compute only single level of the pyramid via SetCurrentLevel() and
- * SetComputeOnlyForCurrentLevel() methods.
+ * SetComputeOnlyForCurrentLevel() methods. In that case, the next level can be
+ * computed by a background task, see SetComputeNextLevelInBackground().
  *
  * \author Denis P. Shamonin and Marius Staring. Division of Image Processing,
  * Department of Radiology, Leiden, The Netherlands
@@ -223,6 +226,31 @@ public:
   itkGetConstMacro(ComputeOnlyForCurrentLevel, bool);
   itkBooleanMacro(ComputeOnlyForCurrentLevel);
 
+  /** Set whether, when ComputeOnlyForCurrentLevel is on, the output of the next
+   * level is computed by a background task, as soon as the current level is
+   * done. The next SetCurrentLevel() then only has to wait for that task, if
+   * it is still running, so that the computation overlaps with the use of the
+   * current level, e.g. the optimization. At most two levels are in memory.
+   * The input and the schedules should not change in the meantime.
+   */
+  itkSetMacro(ComputeNextLevelInBackground, bool);
+  itkGetConstMacro(ComputeNextLevelInBackground, bool);
+  itkBooleanMacro(ComputeNextLevelInBackground);
+
+  /** Set whether, when all levels are computed, each level is computed from the
+   * next finer level, instead of from the input. The finest level is computed
+   * from the input, and each coarser level k is then smoothed from level k + 1
+   * with the incremental sigma sqrt( sigma_k^2 - sigma_{k+1}^2 ), and resampled
+   * onto its own grid. As the cost of the recursive Gaussian does not depend on
+   * sigma, this saves the smoothing of the full resolution input for every level.
+   * The result is an approximation, as level k + 1 is already resampled. A level
+   * is computed from the input anyway when its sigma is smaller than the sigma
+   * of the next level. Ignored when ComputeOnlyForCurrentLevel is on.
+   */
+  itkSetMacro(ComputeLevelsCascaded, bool);
+  itkGetConstMacro(ComputeLevelsCascaded, bool);
+  itkBooleanMacro(ComputeLevelsCascaded);
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro(SameDimensionCheck, (Concept::SameDimension<ImageDimension, OutputImageDimension>));
@@ -232,7 +260,7 @@ public:
 
 protected:
   GenericMultiResolutionPyramidImageFilter();
-  ~GenericMultiResolutionPyramidImageFilter() override = default;
+  ~GenericMultiResolutionPyramidImageFilter() override;
 
   /** PrintSelf. */
   void
@@ -272,6 +300,8 @@ protected:
   unsigned int          m_CurrentLevel;
   bool                  m_ComputeOnlyForCurrentLevel;
   bool                  m_SmoothingScheduleDefined;
+  bool                  m_ComputeNextLevelInBackground;
+  bool                  m_ComputeLevelsCascaded{ false };
 
 private:
   /** Typedef for smoother. Smooth always happens first, then only from
@@ -306,6 +336,37 @@ private:
                            typename ImageToImageFilterSameTypes::Pointer &      rescaleSameTypes,
                            typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes);
 
+  /** Computes the given level from the input into the allocated outputPtr.
+   * The filters are created once, and re-used for the next levels.
+   */
+  void
+  ComputeLevel(const unsigned int                                   level,
+               const InputImageConstPointer &                       input,
+               const OutputImagePointer &                           outputPtr,
+               typename SmootherType::Pointer &                     smoother,
+               typename ImageToImageFilterSameTypes::Pointer &      rescaleSameTypes,
+               typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes);
+
+  /** Returns true when the given level can be computed from the next finer level. */
+  bool
+  CanComputeFromNextLevel(const unsigned int level) const;
+
+  /** Computes the given level from the output of the next finer level into
+   * the allocated outputPtr.
+   */
+  void
+  ComputeLevelFromNextLevel(const unsigned int level, const OutputImagePointer & outputPtr);
+
+  /** Starts a background task that computes the given level. */
+  void
+  ComputeLevelInBackground(const unsigned int level);
+
+  /** Waits for the background task, if any. Grafts its result onto outputPtr
+   * and returns true, when it computed the given level from the current input.
+   */
+  bool
+  TakeLevelFromBackground(const unsigned int level, const OutputImagePointer & outputPtr);
+
   /** Defines Shrink or Resample filters. */
   void
   DefineShrinkerOrResampler(const bool                                           sameType,
@@ -339,6 +400,12 @@ private:
   void
   GetShrinkFactors(const unsigned int level, RescaleFactorArrayType & shrinkFactors) const;
 
+  /** The background task, and the level and input it computes. */
+  std::future<OutputImagePointer> m_BackgroundOutput;
+  unsigned int                    m_BackgroundLevel{ 0 };
+  InputImageConstPointer          m_BackgroundInput;
+  ModifiedTimeType                m_BackgroundInputMTime{ 0 };
+
   /** Returns true if all elements of sigmaArray are zeros,
    * otherwise return false.
    */
@@ -24,25 +24,27 @@
 #include "itkShrinkImageFilter.h"
 #include "itkImageAlgorithm.h"
 
+#include <cmath>
+
 namespace // anonymous namespace
 {
 /**
  * ******************* UpdateAndGraft ***********************
  */
 
-template <class GenericMultiResolutionPyramidImageFilterType, class ImageToImageFilterType, typename OutputImageType>
+template <class ImageToImageFilterType, typename OutputImageType>
 void
-UpdateAndGraft(typename GenericMultiResolutionPyramidImageFilterType::Pointer thisFilter,
-               typename ImageToImageFilterType::Pointer &                     filter,
-               OutputImageType *                                              outImage,
-               const unsigned int                                             ilevel)
+UpdateAndGraft(typename ImageToImageFilterType::Pointer & filter,
+               OutputImageType *                          outImage,
+               const itk::ThreadIdType                    numberOfWorkUnits)
 {
+  filter->SetNumberOfWorkUnits(numberOfWorkUnits);
   filter->GraftOutput(outImage);
 
   // force to always update in case shrink factors are the same
   filter->Modified();
   filter->UpdateLargestPossibleRegion();
-  thisFilter->GraftNthOutput(ilevel, filter->GetOutput());
+  outImage->Graft(filter->GetOutput());
 } // end UpdateAndGraft()
 
 
@@ -64,9 +66,26 @@ GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionTy
   temp.Fill(NumericTraits<ScalarRealType>::ZeroValue());
   this->m_SmoothingSchedule = temp;
   this->m_SmoothingScheduleDefined = false;
+  this->m_ComputeNextLevelInBackground = false;
 } // end Constructor
 
 
+/**
+ * ******************* Destructor ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::
+  ~GenericMultiResolutionPyramidImageFilter()
+{
+  /** The background task uses this filter, so it must finish first. */
+  if (this->m_BackgroundOutput.valid())
+  {
+    this->m_BackgroundOutput.wait();
+  }
+} // end Destructor
+
+
 /**
  * ******************* SetNumberOfLevels ***********************
  */
@@ -329,54 +348,280 @@ GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionTy
   typename ImageToImageFilterSameTypes::Pointer      rescaleSameTypes;
   typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
 
-  for (unsigned int level = 0; level < this->m_NumberOfLevels; ++level)
+  // Compute the levels from fine to coarse, each from the next finer level.
+  if (this->m_ComputeLevelsCascaded && !this->m_ComputeOnlyForCurrentLevel)
   {
-    if (!this->m_ComputeOnlyForCurrentLevel)
+    for (unsigned int i = 0; i < this->m_NumberOfLevels; ++i)
     {
-      this->UpdateProgress(static_cast<float>(level) / static_cast<float>(this->m_NumberOfLevels));
-    }
+      this->UpdateProgress(static_cast<float>(i) / static_cast<float>(this->m_NumberOfLevels));
 
-    if (this->ComputeForCurrentLevel(level))
-    {
-      // Allocate memory for each output
+      const unsigned int level = this->m_NumberOfLevels - 1 - i;
       OutputImagePointer outputPtr = this->GetOutput(level);
       outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
       outputPtr->Allocate();
-
-      // Setup the smoother
-      const bool smootherIsUsed = this->SetupSmoother(level, smoother, input);
-
-      // Setup the shrinker or resampler
-      const int shrinkerOrResamplerIsUsed = this->SetupShrinkerOrResampler(
-        level, smoother, smootherIsUsed, input, outputPtr, rescaleSameTypes, rescaleDifferentTypes);
-
-      // Update the pipeline and graft or copy results to this filters output
-      if (shrinkerOrResamplerIsUsed == 0 && smootherIsUsed)
+      if (this->CanComputeFromNextLevel(level))
       {
-        UpdateAndGraft<Self, SmootherType, OutputImageType>(this, smoother, outputPtr, level);
+        this->ComputeLevelFromNextLevel(level, outputPtr);
       }
-      else if (shrinkerOrResamplerIsUsed == 0)
+      else
       {
-        ImageAlgorithm::Copy(input.GetPointer(),
-                             outputPtr.GetPointer(),
-                             input->GetLargestPossibleRegion(),
-                             outputPtr->GetLargestPossibleRegion());
+        this->ComputeLevel(level, input, outputPtr, smoother, rescaleSameTypes, rescaleDifferentTypes);
       }
-      else if (shrinkerOrResamplerIsUsed == 1)
+    }
+    return;
+  }
+
+  for (unsigned int level = 0; level < this->m_NumberOfLevels; ++level)
+  {
+    if (!this->m_ComputeOnlyForCurrentLevel)
+    {
+      this->UpdateProgress(static_cast<float>(level) / static_cast<float>(this->m_NumberOfLevels));
+    }
+
+    if (this->ComputeForCurrentLevel(level))
+    {
+      // Take the output from the background task, if it computed this level,
+      // or otherwise allocate memory for the output, and compute it here.
+      OutputImagePointer outputPtr = this->GetOutput(level);
+      if (!this->TakeLevelFromBackground(level, outputPtr))
       {
-        UpdateAndGraft<Self, ImageToImageFilterSameTypes, OutputImageType>(this, rescaleSameTypes, outputPtr, level);
+        outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+        outputPtr->Allocate();
+        this->ComputeLevel(level, input, outputPtr, smoother, rescaleSameTypes, rescaleDifferentTypes);
       }
-      else if (shrinkerOrResamplerIsUsed == 2)
+
+      // Start with the next level already, while this one is being used.
+      if (this->m_ComputeOnlyForCurrentLevel && this->m_ComputeNextLevelInBackground &&
+          level + 1 < this->m_NumberOfLevels)
       {
-        UpdateAndGraft<Self, ImageToImageFilterDifferentTypes, OutputImageType>(
-          this, rescaleDifferentTypes, outputPtr, level);
+        this->ComputeLevelInBackground(level + 1);
       }
-      // no else needed
     }
   } // end for ilevel
 } // end GenerateData()
 
 
+/**
+ * ******************* ComputeLevel ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+void
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::ComputeLevel(
+  const unsigned int                                   level,
+  const InputImageConstPointer &                       input,
+  const OutputImagePointer &                           outputPtr,
+  typename SmootherType::Pointer &                     smoother,
+  typename ImageToImageFilterSameTypes::Pointer &      rescaleSameTypes,
+  typename ImageToImageFilterDifferentTypes::Pointer & rescaleDifferentTypes)
+{
+  // Setup the smoother, which runs upstream of the shrinker or resampler
+  const bool smootherIsUsed = this->SetupSmoother(level, smoother, input);
+  if (smootherIsUsed)
+  {
+    smoother->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+  }
+
+  // Setup the shrinker or resampler
+  const int shrinkerOrResamplerIsUsed = this->SetupShrinkerOrResampler(
+    level, smoother, smootherIsUsed, input, outputPtr, rescaleSameTypes, rescaleDifferentTypes);
+
+  // Update the pipeline and graft or copy results to the output
+  if (shrinkerOrResamplerIsUsed == 0 && smootherIsUsed)
+  {
+    UpdateAndGraft<SmootherType, OutputImageType>(smoother, outputPtr, this->GetNumberOfWorkUnits());
+  }
+  else if (shrinkerOrResamplerIsUsed == 0)
+  {
+    ImageAlgorithm::Copy(input.GetPointer(),
+                         outputPtr.GetPointer(),
+                         input->GetLargestPossibleRegion(),
+                         outputPtr->GetLargestPossibleRegion());
+  }
+  else if (shrinkerOrResamplerIsUsed == 1)
+  {
+    UpdateAndGraft<ImageToImageFilterSameTypes, OutputImageType>(
+      rescaleSameTypes, outputPtr, this->GetNumberOfWorkUnits());
+  }
+  else if (shrinkerOrResamplerIsUsed == 2)
+  {
+    UpdateAndGraft<ImageToImageFilterDifferentTypes, OutputImageType>(
+      rescaleDifferentTypes, outputPtr, this->GetNumberOfWorkUnits());
+  }
+  // no else needed
+} // end ComputeLevel()
+
+
+/**
+ * ******************* CanComputeFromNextLevel ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+bool
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::CanComputeFromNextLevel(
+  const unsigned int level) const
+{
+  if (level + 1 >= this->m_NumberOfLevels)
+  {
+    return false;
+  }
+
+  // The next level can not be made sharper again.
+  SigmaArrayType sigma, nextSigma;
+  this->GetSigma(level, sigma);
+  this->GetSigma(level + 1, nextSigma);
+  for (unsigned int dim = 0; dim < ImageDimension; ++dim)
+  {
+    if (sigma[dim] < nextSigma[dim])
+    {
+      return false;
+    }
+  }
+  return true;
+} // end CanComputeFromNextLevel()
+
+
+/**
+ * ******************* ComputeLevelFromNextLevel ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+void
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::ComputeLevelFromNextLevel(
+  const unsigned int         level,
+  const OutputImagePointer & outputPtr)
+{
+  // Typedefs
+  typedef SmoothingRecursiveGaussianImageFilter<OutputImageType, OutputImageType> SmootherSameType;
+  typedef IdentityTransform<TPrecisionType, OutputImageType::ImageDimension>      TransformType;
+  typedef ResampleImageFilter<OutputImageType, OutputImageType, TPrecisionType>   ResamplerSameType;
+  typedef LinearInterpolateImageFunction<OutputImageType, TPrecisionType>         InterpolatorForSameType;
+
+  // Work on a copy of the next level that shares its buffer, but is not
+  // connected to the pipeline of this filter.
+  const OutputImagePointer nextLevel = OutputImageType::New();
+  nextLevel->Graft(this->GetOutput(level + 1));
+
+  // The incremental sigma, that gives the sigma of this level on top of the
+  // sigma that the next level has already been smoothed with.
+  SigmaArrayType sigma, nextSigma;
+  this->GetSigma(level, sigma);
+  this->GetSigma(level + 1, nextSigma);
+  for (unsigned int dim = 0; dim < ImageDimension; ++dim)
+  {
+    sigma[dim] = std::sqrt(sigma[dim] * sigma[dim] - nextSigma[dim] * nextSigma[dim]);
+  }
+
+  typename ImageToImageFilterSameTypes::Pointer last;
+  if (!this->AreSigmasAllZeros(sigma))
+  {
+    typename SmootherSameType::Pointer smoother = SmootherSameType::New();
+    smoother->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    smoother->SetInput(nextLevel);
+    smoother->SetSigmaArray(sigma);
+    last = smoother.GetPointer();
+  }
+
+  const bool sameGrid = nextLevel->GetLargestPossibleRegion() == outputPtr->GetLargestPossibleRegion() &&
+                        nextLevel->GetSpacing() == outputPtr->GetSpacing() &&
+                        nextLevel->GetOrigin() == outputPtr->GetOrigin();
+  if (!sameGrid)
+  {
+    typename ResamplerSameType::Pointer resampler = ResamplerSameType::New();
+    resampler->SetOutputParametersFromImage(outputPtr);
+    resampler->SetDefaultPixelValue(0);
+    resampler->SetInterpolator(InterpolatorForSameType::New());
+    resampler->SetTransform(TransformType::New());
+    if (last.IsNull())
+    {
+      resampler->SetInput(nextLevel);
+    }
+    else
+    {
+      resampler->SetInput(last->GetOutput());
+    }
+    last = resampler.GetPointer();
+  }
+
+  if (last.IsNull())
+  {
+    ImageAlgorithm::Copy(nextLevel.GetPointer(),
+                         outputPtr.GetPointer(),
+                         nextLevel->GetLargestPossibleRegion(),
+                         outputPtr->GetLargestPossibleRegion());
+  }
+  else
+  {
+    UpdateAndGraft<ImageToImageFilterSameTypes, OutputImageType>(last, outputPtr, this->GetNumberOfWorkUnits());
+  }
+} // end ComputeLevelFromNextLevel()
+
+
+/**
+ * ******************* ComputeLevelInBackground ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+void
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::ComputeLevelInBackground(
+  const unsigned int level)
+{
+  // The background task works on a copy of the input that shares its buffer,
+  // but is not connected to the pipeline, and on an output of its own. The
+  // output information of all levels is already known.
+  const auto input = InputImageType::New();
+  input->Graft(this->GetInput());
+  const OutputImagePointer output = OutputImageType::New();
+  output->CopyInformation(this->GetOutput(level));
+  output->SetRegions(this->GetOutput(level)->GetLargestPossibleRegion());
+
+  this->m_BackgroundLevel = level;
+  this->m_BackgroundInput = this->GetInput();
+  this->m_BackgroundInputMTime = this->GetInput()->GetMTime();
+  this->m_BackgroundOutput = std::async(std::launch::async, [this, level, input, output]() {
+    typename SmootherType::Pointer                     smoother;
+    typename ImageToImageFilterSameTypes::Pointer      rescaleSameTypes;
+    typename ImageToImageFilterDifferentTypes::Pointer rescaleDifferentTypes;
+    output->Allocate();
+    this->ComputeLevel(level, input.GetPointer(), output, smoother, rescaleSameTypes, rescaleDifferentTypes);
+    return output;
+  });
+} // end ComputeLevelInBackground()
+
+
+/**
+ * ******************* TakeLevelFromBackground ***********************
+ */
+
+template <class TInputImage, class TOutputImage, class TPrecisionType>
+bool
+GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionType>::TakeLevelFromBackground(
+  const unsigned int         level,
+  const OutputImagePointer & outputPtr)
+{
+  if (!this->m_BackgroundOutput.valid())
+  {
+    return false;
+  }
+
+  // Wait for the task. Exceptions thrown by the task are rethrown here.
+  const OutputImagePointer backgroundOutput = this->m_BackgroundOutput.get();
+  const bool               useBackgroundOutput =
+    this->m_BackgroundLevel == level && this->m_BackgroundInput == this->GetInput() &&
+    this->m_BackgroundInputMTime == this->GetInput()->GetMTime() &&
+    backgroundOutput->GetLargestPossibleRegion() == outputPtr->GetLargestPossibleRegion() &&
+    backgroundOutput->GetSpacing() == outputPtr->GetSpacing() &&
+    backgroundOutput->GetOrigin() == outputPtr->GetOrigin();
+  this->m_BackgroundInput = nullptr;
+
+  if (useBackgroundOutput)
+  {
+    outputPtr->Graft(backgroundOutput);
+  }
+  return useBackgroundOutput;
+} // end TakeLevelFromBackground()
+
+
 /**
  * ******************* SetupSmoother ***********************
  */
@@ -910,6 +1155,9 @@ GenericMultiResolutionPyramidImageFilter<TInputImage, TOutputImage, TPrecisionTy
   os << indent << "CurrentLevel: " << this->m_CurrentLevel << std::endl;
   os << indent << "ComputeOnlyForCurrentLevel: " << (this->m_ComputeOnlyForCurrentLevel ? "true" : "false")
      << std::endl;
+  os << indent << "ComputeNextLevelInBackground: " << (this->m_ComputeNextLevelInBackground ? "true" : "false")
+     << std::endl;
+  os << indent << "ComputeLevelsCascaded: " << (this->m_ComputeLevelsCascaded ? "true" : "false") << std::endl;
   os << indent << "SmoothingScheduleDefined: " << (this->m_SmoothingScheduleDefined ? "true" : "false") << std::endl;
   os << indent << "Smoothing Schedule: ";
   if (this->m_SmoothingSchedule.empty())
@@ -0,0 +1,309 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkHardwareCounters.h"
+
+#include <algorithm> // For any_of and fill_n.
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#  include <cstdint>
+#  include <cstdlib>
+#  include <cstring>
+#  include <dirent.h>
+#  include <linux/perf_event.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace itk
+{
+
+namespace
+{
+/** The number of events in the group of counters of each thread: cycles, instructions and cache misses. */
+constexpr unsigned int NumberOfEvents = 3;
+
+struct CounterData
+{
+  std::mutex                      Mutex;
+  std::atomic<bool>               Enabled{ false };
+  HardwareCounters::CountsMapType Counts;
+  std::map<long, int>             GroupFileDescriptors; // The group leader per thread id, -1 if not available.
+  std::vector<int>                FileDescriptors;
+};
+
+CounterData &
+GetData(void)
+{
+  static CounterData data;
+  return data;
+}
+
+#if defined(__linux__)
+
+int
+OpenEvent(const long threadId, const std::uint64_t config, const int groupFileDescriptor)
+{
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.type = PERF_TYPE_HARDWARE;
+  attributes.size = sizeof(attributes);
+  attributes.config = config;
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attributes, threadId, -1, groupFileDescriptor, 0));
+}
+
+
+/** Opens the counters of a thread, as a group that is led by the cycles counter. The caller holds the mutex. */
+void
+OpenThreadCounters(CounterData & data, const long threadId)
+{
+  const std::uint64_t configs[NumberOfEvents] = { PERF_COUNT_HW_CPU_CYCLES,
+                                                  PERF_COUNT_HW_INSTRUCTIONS,
+                                                  PERF_COUNT_HW_CACHE_MISSES };
+
+  int & leader = data.GroupFileDescriptors[threadId];
+  leader = OpenEvent(threadId, configs[0], -1);
+  if (leader < 0)
+  {
+    leader = -1;
+    return;
+  }
+  data.FileDescriptors.push_back(leader);
+
+  for (unsigned int i = 1; i < NumberOfEvents; ++i)
+  {
+    const int fileDescriptor = OpenEvent(threadId, configs[i], leader);
+    if (fileDescriptor < 0)
+    {
+      /** An incomplete group is not read; its file descriptors are closed when the counting is disabled. */
+      leader = -1;
+      return;
+    }
+    data.FileDescriptors.push_back(fileDescriptor);
+  }
+
+} // end OpenThreadCounters()
+
+
+/** Opens the counters of the threads of the process that have none yet. The caller holds the mutex. */
+void
+OpenCountersOfNewThreads(CounterData & data)
+{
+  DIR * const directory = opendir("/proc/self/task");
+  if (directory == nullptr)
+  {
+    return;
+  }
+  while (const dirent * const entry = readdir(directory))
+  {
+    if (entry->d_name[0] != '.')
+    {
+      const long threadId = std::strtol(entry->d_name, nullptr, 10);
+      if (data.GroupFileDescriptors.count(threadId) == 0)
+      {
+        OpenThreadCounters(data, threadId);
+      }
+    }
+  }
+  closedir(directory);
+
+} // end OpenCountersOfNewThreads()
+
+
+/** Reads the counters, summed over all threads, and scaled for the time that they were multiplexed. */
+void
+ReadCounters(const CounterData & data, double values[NumberOfEvents])
+{
+  std::fill_n(values, NumberOfEvents, 0.0);
+  for (const auto & group : data.GroupFileDescriptors)
+  {
+    /** The layout of a group read: the number of events, the enabled and running times, and the values. */
+    std::uint64_t buffer[3 + NumberOfEvents];
+    if (group.second < 0 || read(group.second, buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) ||
+        buffer[0] != NumberOfEvents)
+    {
+      continue;
+    }
+    const double scale = (buffer[2] > 0) ? static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]) : 0.0;
+    for (unsigned int i = 0; i < NumberOfEvents; ++i)
+    {
+      values[i] += static_cast<double>(buffer[3 + i]) * scale;
+    }
+  }
+
+} // end ReadCounters()
+
+
+/** Closes all counters. The caller holds the mutex. */
+void
+CloseCounters(CounterData & data)
+{
+  for (const int fileDescriptor : data.FileDescriptors)
+  {
+    close(fileDescriptor);
+  }
+  data.FileDescriptors.clear();
+  data.GroupFileDescriptors.clear();
+
+} // end CloseCounters()
+
+#endif
+
+} // namespace
+
+/**
+ * ********************* SetEnabled ****************************
+ */
+
+bool
+HardwareCounters::SetEnabled(const bool enabled)
+{
+  CounterData &               data = GetData();
+  std::lock_guard<std::mutex> lock(data.Mutex);
+
+#if defined(__linux__)
+  if (enabled && !data.Enabled)
+  {
+    OpenCountersOfNewThreads(data);
+
+    const bool available = std::any_of(data.GroupFileDescriptors.cbegin(),
+                                       data.GroupFileDescriptors.cend(),
+                                       [](const std::pair<const long, int> & group) { return group.second >= 0; });
+    if (!available)
+    {
+      CloseCounters(data);
+      return false;
+    }
+    data.Enabled = true;
+  }
+  else if (!enabled && data.Enabled)
+  {
+    data.Enabled = false;
+    CloseCounters(data);
+  }
+  return data.Enabled;
+#else
+  (void)enabled;
+  return false;
+#endif
+
+} // end SetEnabled()
+
+
+/**
+ * ********************* GetEnabled ****************************
+ */
+
+bool
+HardwareCounters::GetEnabled(void)
+{
+  return GetData().Enabled;
+
+} // end GetEnabled()
+
+
+/**
+ * ********************* GetCounts ****************************
+ */
+
+HardwareCounters::CountsMapType
+HardwareCounters::GetCounts(void)
+{
+  CounterData &               data = GetData();
+  std::lock_guard<std::mutex> lock(data.Mutex);
+  return data.Counts;
+
+} // end GetCounts()
+
+
+/**
+ * ********************* Reset ****************************
+ */
+
+void
+HardwareCounters::Reset(void)
+{
+  CounterData &               data = GetData();
+  std::lock_guard<std::mutex> lock(data.Mutex);
+  data.Counts.clear();
+
+} // end Reset()
+
+
+/**
+ * ********************* ScopedPhase ****************************
+ */
+
+HardwareCounters::ScopedPhase::ScopedPhase(const char * name, const SizeValueType numberOfSamples)
+  : m_Name(name)
+  , m_NumberOfSamples(numberOfSamples)
+{
+#if defined(__linux__)
+  CounterData & data = GetData();
+  if (name == nullptr || !data.Enabled)
+  {
+    return;
+  }
+
+  /** Threads that were started since the previous phase, like those of a thread pool, get their counters here. */
+  std::lock_guard<std::mutex> lock(data.Mutex);
+  if (data.Enabled)
+  {
+    OpenCountersOfNewThreads(data);
+    ReadCounters(data, this->m_StartValues);
+    this->m_Active = true;
+  }
+#endif
+
+} // end ScopedPhase()
+
+
+HardwareCounters::ScopedPhase::~ScopedPhase()
+{
+#if defined(__linux__)
+  if (!this->m_Active)
+  {
+    return;
+  }
+
+  CounterData &               data = GetData();
+  std::lock_guard<std::mutex> lock(data.Mutex);
+  if (!data.Enabled)
+  {
+    return;
+  }
+
+  double endValues[NumberOfEvents];
+  ReadCounters(data, endValues);
+
+  Counts & counts = data.Counts[this->m_Name];
+  counts.m_Cycles += endValues[0] - this->m_StartValues[0];
+  counts.m_Instructions += endValues[1] - this->m_StartValues[1];
+  counts.m_LastLevelCacheMisses += endValues[2] - this->m_StartValues[2];
+  ++counts.m_NumberOfOccurrences;
+  counts.m_NumberOfSamples += this->m_NumberOfSamples;
+#endif
+
+} // end ~ScopedPhase()
+
+} // end namespace itk
@@ -0,0 +1,114 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkHardwareCounters_h
+#define itkHardwareCounters_h
+
+#include "itkIntTypes.h"
+
+#include <map>
+#include <string>
+
+namespace itk
+{
+/** \class HardwareCounters
+ * \brief Counts the CPU cycles, instructions and last level cache misses of phases of the registration.
+ *
+ * The counters are read at the start and at the end of a phase, which is marked by a
+ * ScopedPhase object, and the differences are summed per phase name. The counts are those
+ * of all threads of the process, so a phase that is measured in the thread that launches
+ * the worker threads of, for example, the metric, includes the work of the worker threads.
+ * Nested phases are each counted in full.
+ *
+ * The counters use the perf_event interface of Linux, and count user space events only.
+ * On other systems, or when the kernel does not allow the counters (see
+ * /proc/sys/kernel/perf_event_paranoid), SetEnabled(true) returns false, and the phases
+ * are not counted. When the counters are disabled, a ScopedPhase only checks a flag.
+ *
+ * The counters are shared by the whole process, so the counts of registrations that run
+ * concurrently in one process would be mixed. elastix therefore only counts a registration
+ * that runs alone, see elastix::ElastixBase::GetNumberOfRunningRegistrations().
+ *
+ * \ingroup Common
+ */
+
+class HardwareCounters
+{
+public:
+  /** The counts of a phase, summed over all its occurrences. The number of samples is
+   * the number of image samples processed by the phase, when known, or zero. */
+  struct Counts
+  {
+    double        m_Cycles{ 0.0 };
+    double        m_Instructions{ 0.0 };
+    double        m_LastLevelCacheMisses{ 0.0 };
+    SizeValueType m_NumberOfOccurrences{ 0 };
+    SizeValueType m_NumberOfSamples{ 0 };
+  };
+  typedef std::map<std::string, Counts> CountsMapType;
+
+  /** The size in bytes of a cache line, to estimate the memory traffic from the cache misses. */
+  static constexpr unsigned int CacheLineSize = 64;
+
+  /** Enables or disables the counting, which is disabled by default. Returns whether the
+   * counting is enabled, which is false when the counters are not available. */
+  static bool
+  SetEnabled(const bool enabled);
+
+  static bool
+  GetEnabled(void);
+
+  /** Returns the counts per phase name, since the counting was enabled or reset. */
+  static CountsMapType
+  GetCounts(void);
+
+  /** Discards the counts collected so far. */
+  static void
+  Reset(void);
+
+  /** \class ScopedPhase
+   * Counts the events from its construction until its destruction, as the phase \a name.
+   * The name should be a string literal, or outlive the object. A null name means that
+   * the object does not count. */
+  class ScopedPhase
+  {
+  public:
+    explicit ScopedPhase(const char * name, const SizeValueType numberOfSamples = 0);
+    ~ScopedPhase();
+
+    /** Sets the number of image samples processed by the phase, if only known after its start. */
+    void
+    SetNumberOfSamples(const SizeValueType numberOfSamples)
+    {
+      this->m_NumberOfSamples = numberOfSamples;
+    }
+
+  private:
+    ScopedPhase(const ScopedPhase &) = delete;
+    void
+    operator=(const ScopedPhase &) = delete;
+
+    const char *  m_Name;
+    SizeValueType m_NumberOfSamples;
+    bool          m_Active{ false };
+    double        m_StartValues[3];
+  };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkHardwareCounters_h
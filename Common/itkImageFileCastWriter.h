@@ -23,7 +23,7 @@
 #include "itkMacro.h"
 #include "itkSize.h"
 #include "itkImageIORegion.h"
-#include "itkCastImageFilter.h"
+#include "itkRoundAndClampImageFilter.h"
 
 namespace itk
 {
@@ -33,7 +33,9 @@ namespace itk
  *
  * This filter saves an image and casts the data on the fly,
  * if necessary. This is useful in some cases, to avoid the use of
- * a itk::CastImageFilter (to save memory for example).
+ * a itk::CastImageFilter (to save memory for example). The values
+ * are rounded and clamped to the output component type, see the
+ * itk::RoundAndClampImageFilter.
  *
  */
 template <class TInputImage>
@@ -82,15 +84,16 @@ private:
   /** Templated function that casts the input image and returns a
    * a pointer to the PixelBuffer. Assumes scalar singlecomponent images
    * The buffer data is valid until this->m_Caster is destroyed or assigned
-   * a new caster. The ImageIO's PixelType is also adapted by this function */
+   * a new caster. The ImageIO's PixelType is also adapted by this function.
+   * Only the given region is cast, which is just a piece of the image when streaming. */
   template <class OutputComponentType>
   void *
-  ConvertScalarImage(const DataObject * inputImage)
+  ConvertScalarImage(const DataObject * inputImage, const InputImageRegionType & region)
   {
-    typedef Image<OutputComponentType, InputImageDimension>      DiskImageType;
-    typedef typename PixelTraits<InputImagePixelType>::ValueType InputImageComponentType;
-    typedef Image<InputImageComponentType, InputImageDimension>  ScalarInputImageType;
-    typedef CastImageFilter<ScalarInputImageType, DiskImageType> CasterType;
+    typedef Image<OutputComponentType, InputImageDimension>               DiskImageType;
+    typedef typename PixelTraits<InputImagePixelType>::ValueType          InputImageComponentType;
+    typedef Image<InputImageComponentType, InputImageDimension>           ScalarInputImageType;
+    typedef RoundAndClampImageFilter<ScalarInputImageType, DiskImageType> CasterType;
 
     /** Reconfigure the imageIO */
     // this->GetImageIO()->SetPixelTypeInfo( typeid(OutputComponentType) );
@@ -104,6 +107,7 @@ private:
     localInputImage->Graft(static_cast<const ScalarInputImageType *>(inputImage));
 
     caster->SetInput(localInputImage);
+    caster->GetOutput()->SetRequestedRegion(region);
     caster->Update();
 
     /** return the pixel buffer of the casted image */
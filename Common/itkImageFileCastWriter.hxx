@@ -110,47 +110,52 @@ ImageFileCastWriter<TInputImage>::GenerateData(void)
     void *             convertedDataBuffer = nullptr;
     const DataObject * inputAsDataObject = dynamic_cast<const DataObject *>(input);
 
+    /** The region to be written, which may be smaller than the buffered region. */
+    InputImageRegionType ioRegion;
+    ImageIORegionAdaptor<InputImageDimension>::Convert(
+      this->GetImageIO()->GetIORegion(), ioRegion, input->GetLargestPossibleRegion().GetIndex());
+
     /** convert the scalar image to a scalar image with another componenttype
      * The imageIO's PixelType is also changed */
     if (this->m_OutputComponentType == "char")
     {
-      convertedDataBuffer = this->ConvertScalarImage<char>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<char>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "unsigned_char")
     {
-      convertedDataBuffer = this->ConvertScalarImage<unsigned char>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<unsigned char>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "short")
     {
-      convertedDataBuffer = this->ConvertScalarImage<short>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<short>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "unsigned_short")
     {
-      convertedDataBuffer = this->ConvertScalarImage<unsigned short>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<unsigned short>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "int")
     {
-      convertedDataBuffer = this->ConvertScalarImage<int>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<int>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "unsigned_int")
     {
-      convertedDataBuffer = this->ConvertScalarImage<unsigned int>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<unsigned int>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "long")
     {
-      convertedDataBuffer = this->ConvertScalarImage<long>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<long>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "unsigned_long")
     {
-      convertedDataBuffer = this->ConvertScalarImage<unsigned long>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<unsigned long>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "float")
     {
-      convertedDataBuffer = this->ConvertScalarImage<float>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<float>(inputAsDataObject, ioRegion);
     }
     else if (this->m_OutputComponentType == "double")
     {
-      convertedDataBuffer = this->ConvertScalarImage<double>(inputAsDataObject);
+      convertedDataBuffer = this->ConvertScalarImage<double>(inputAsDataObject, ioRegion);
     }
 
     /** Do the writing */
@@ -160,9 +165,9 @@ ImageFileCastWriter<TInputImage>::GenerateData(void)
   }
   else
   {
-    /** No casting needed or possible, just write */
-    const void * dataPtr = input->GetBufferPointer();
-    this->GetModifiableImageIO()->Write(dataPtr);
+    /** No casting needed or possible, just write. The superclass takes care
+     * of a buffered region that differs from the region to be written. */
+    this->Superclass::GenerateData();
   }
 }
 
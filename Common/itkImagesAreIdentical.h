@@ -0,0 +1,73 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkImagesAreIdentical_h
+#define itkImagesAreIdentical_h
+
+#include <algorithm> // For equal.
+
+namespace itk
+{
+
+/** Returns true when the two images have the same buffered region, origin, spacing and
+ * direction, and the same pixel values. The pixel values are only compared when the
+ * images do not share their pixel container, e.g. for the outputs of the same level of
+ * two pyramids of the same image. A pyramid output that is a graft of the original image
+ * shares the container, which is detected without comparing the pixels.
+ *
+ * Comparing the pixels takes one pass over both buffers, which is much cheaper than
+ * computing e.g. the B-spline coefficients of an image again.
+ *
+ * \ingroup ImageFunctions
+ */
+
+template <class TImage>
+bool
+ImagesAreIdentical(const TImage * image1, const TImage * image2)
+{
+  if (image1 == nullptr || image2 == nullptr)
+  {
+    return false;
+  }
+  if (image1 == image2)
+  {
+    return true;
+  }
+  if (image1->GetBufferedRegion() != image2->GetBufferedRegion() || image1->GetOrigin() != image2->GetOrigin() ||
+      image1->GetSpacing() != image2->GetSpacing() || image1->GetDirection() != image2->GetDirection())
+  {
+    return false;
+  }
+  if (image1->GetPixelContainer() == image2->GetPixelContainer())
+  {
+    return true;
+  }
+
+  const auto * buffer1 = image1->GetBufferPointer();
+  const auto * buffer2 = image2->GetBufferPointer();
+  if (buffer1 == nullptr || buffer2 == nullptr)
+  {
+    return false;
+  }
+  const auto numberOfPixels = image1->GetBufferedRegion().GetNumberOfPixels();
+  return std::equal(buffer1, buffer1 + numberOfPixels, buffer2);
+
+} // end ImagesAreIdentical()
+
+} // end namespace itk
+
+#endif // end #ifndef itkImagesAreIdentical_h
@@ -0,0 +1,628 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkLBFGSHistory.h"
+#include "itkThreadBudget.h"
+
+#include <algorithm> // For min and max.
+
+namespace itk
+{
+
+namespace
+{
+
+typedef LBFGSHistory::ValueType ValueType;
+
+/** Every work unit writes its partial sums to its own cache line. */
+const SizeValueType PartialSumStride = 8;
+
+/** The arguments of a pass that stores a pair. */
+template <class TStorage>
+struct StorePassType
+{
+  const ValueType * m_S{ nullptr };
+  const ValueType * m_Y{ nullptr };
+  TStorage *        m_StoredS{ nullptr };
+  TStorage *        m_StoredY{ nullptr };
+};
+
+/** The ways in which the search direction may be scaled by H0. */
+enum ScaleKindType
+{
+  NoScale,
+  ScalarScale,
+  DiagonalScale
+};
+
+/** The arguments of a pass of the two-loop recursion:
+ *
+ *   q = H0 (q + c a), followed by the inner product b'q,
+ *
+ * where q is the search direction. When the gradient is set, q starts from -g.
+ */
+template <class TStorage>
+struct RecursionPassType
+{
+  ValueType *       m_Direction{ nullptr };
+  const ValueType * m_Gradient{ nullptr };
+  ValueType         m_Coefficient{ 0.0 };
+  const TStorage *  m_Add{ nullptr };
+  ScaleKindType     m_ScaleKind{ NoScale };
+  ValueType         m_Scale{ 1.0 };
+  const ValueType * m_Diagonal{ nullptr };
+  const TStorage *  m_Dot{ nullptr };
+};
+
+/**
+ * ****************** StoreRange ************************
+ *
+ * Copy the pair to the storage, and compute s'y and y'y of the stored values.
+ */
+
+template <class TStorage>
+void
+StoreRange(const void * pass, const SizeValueType begin, const SizeValueType end, ValueType * sums)
+{
+  const StorePassType<TStorage> & arguments = *static_cast<const StorePassType<TStorage> *>(pass);
+
+  const ValueType * const s = arguments.m_S;
+  const ValueType * const y = arguments.m_Y;
+  TStorage * const        storedS = arguments.m_StoredS;
+  TStorage * const        storedY = arguments.m_StoredY;
+
+  ValueType sy = 0.0;
+  ValueType yy = 0.0;
+  for (SizeValueType j = begin; j < end; ++j)
+  {
+    const TStorage sj = static_cast<TStorage>(s[j]);
+    const TStorage yj = static_cast<TStorage>(y[j]);
+    storedS[j] = sj;
+    storedY[j] = yj;
+    sy += static_cast<ValueType>(sj) * static_cast<ValueType>(yj);
+    yy += static_cast<ValueType>(yj) * static_cast<ValueType>(yj);
+  }
+
+  sums[0] += sy;
+  sums[1] += yy;
+
+} // end StoreRange()
+
+
+/**
+ * ****************** RecursionLoop ************************
+ *
+ * The options are template arguments, so that every combination
+ * results in a loop without branches.
+ */
+
+template <class TStorage, bool VStartFromGradient, bool VAdd, ScaleKindType VScale, bool VDot>
+ValueType
+RecursionLoop(const RecursionPassType<TStorage> & pass, const SizeValueType begin, const SizeValueType end)
+{
+  ValueType * const       direction = pass.m_Direction;
+  const ValueType * const gradient = pass.m_Gradient;
+  const ValueType         coefficient = pass.m_Coefficient;
+  const TStorage * const  add = pass.m_Add;
+  const ValueType         scale = pass.m_Scale;
+  const ValueType * const diagonal = pass.m_Diagonal;
+  const TStorage * const  dot = pass.m_Dot;
+
+  ValueType sum = 0.0;
+  for (SizeValueType j = begin; j < end; ++j)
+  {
+    ValueType q = VStartFromGradient ? -gradient[j] : direction[j];
+    if (VAdd)
+    {
+      q += coefficient * static_cast<ValueType>(add[j]);
+    }
+    if (VScale == ScalarScale)
+    {
+      q *= scale;
+    }
+    else if (VScale == DiagonalScale)
+    {
+      q *= diagonal[j];
+    }
+    direction[j] = q;
+    if (VDot)
+    {
+      sum += static_cast<ValueType>(dot[j]) * q;
+    }
+  }
+
+  return sum;
+
+} // end RecursionLoop()
+
+
+/**
+ * ****************** RecursionLoopWithScale ************************
+ */
+
+template <class TStorage, bool VStartFromGradient, bool VAdd, ScaleKindType VScale>
+ValueType
+RecursionLoopWithScale(const RecursionPassType<TStorage> & pass, const SizeValueType begin, const SizeValueType end)
+{
+  if (pass.m_Dot != nullptr)
+  {
+    return RecursionLoop<TStorage, VStartFromGradient, VAdd, VScale, true>(pass, begin, end);
+  }
+  return RecursionLoop<TStorage, VStartFromGradient, VAdd, VScale, false>(pass, begin, end);
+
+} // end RecursionLoopWithScale()
+
+
+/**
+ * ****************** RecursionLoopWithAdd ************************
+ */
+
+template <class TStorage, bool VStartFromGradient, bool VAdd>
+ValueType
+RecursionLoopWithAdd(const RecursionPassType<TStorage> & pass, const SizeValueType begin, const SizeValueType end)
+{
+  if (pass.m_ScaleKind == DiagonalScale)
+  {
+    return RecursionLoopWithScale<TStorage, VStartFromGradient, VAdd, DiagonalScale>(pass, begin, end);
+  }
+  else if (pass.m_ScaleKind == ScalarScale)
+  {
+    return RecursionLoopWithScale<TStorage, VStartFromGradient, VAdd, ScalarScale>(pass, begin, end);
+  }
+  return RecursionLoopWithScale<TStorage, VStartFromGradient, VAdd, NoScale>(pass, begin, end);
+
+} // end RecursionLoopWithAdd()
+
+
+/**
+ * ****************** RecursionLoopWithStart ************************
+ */
+
+template <class TStorage, bool VStartFromGradient>
+ValueType
+RecursionLoopWithStart(const RecursionPassType<TStorage> & pass, const SizeValueType begin, const SizeValueType end)
+{
+  if (pass.m_Add != nullptr)
+  {
+    return RecursionLoopWithAdd<TStorage, VStartFromGradient, true>(pass, begin, end);
+  }
+  return RecursionLoopWithAdd<TStorage, VStartFromGradient, false>(pass, begin, end);
+
+} // end RecursionLoopWithStart()
+
+
+/**
+ * ****************** RecursionRange ************************
+ */
+
+template <class TStorage>
+void
+RecursionRange(const void * pass, const SizeValueType begin, const SizeValueType end, ValueType * sums)
+{
+  const RecursionPassType<TStorage> & arguments = *static_cast<const RecursionPassType<TStorage> *>(pass);
+
+  if (arguments.m_Gradient != nullptr)
+  {
+    sums[0] += RecursionLoopWithStart<TStorage, true>(arguments, begin, end);
+  }
+  else
+  {
+    sums[0] += RecursionLoopWithStart<TStorage, false>(arguments, begin, end);
+  }
+
+} // end RecursionRange()
+
+} // end namespace
+
+
+/**
+ * ****************** PrintSelf ************************
+ */
+
+void
+LBFGSHistory::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "UseFloatStorage: " << (this->m_UseFloatStorage ? "true" : "false") << std::endl;
+  os << indent << "Memory: " << this->m_Memory << std::endl;
+  os << indent << "NumberOfParameters: " << this->m_NumberOfParameters << std::endl;
+  os << indent << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+  os << indent << "MinimumNumberOfParametersPerWorkUnit: " << this->m_MinimumNumberOfParametersPerWorkUnit
+     << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** Initialize ************************
+ */
+
+void
+LBFGSHistory::Initialize(const unsigned int memory, const SizeValueType numberOfParameters)
+{
+  this->m_FloatStorage = this->m_UseFloatStorage;
+  this->m_Memory = memory;
+  this->m_NumberOfParameters = numberOfParameters;
+
+  /** Release the pairs of a previous run, also those of the other precision. */
+  this->m_S.clear();
+  this->m_Y.clear();
+  this->m_FloatS.clear();
+  this->m_FloatY.clear();
+  if (this->m_FloatStorage)
+  {
+    this->m_FloatS.resize(memory);
+    this->m_FloatY.resize(memory);
+  }
+  else
+  {
+    this->m_S.resize(memory);
+    this->m_Y.resize(memory);
+  }
+
+  this->m_InnerProductSY.assign(memory, 0.0);
+  this->m_SquaredMagnitudeY.assign(memory, 0.0);
+
+} // end Initialize()
+
+
+/**
+ * ****************** StorePair ************************
+ */
+
+template <class TStorage>
+void
+LBFGSHistory::StorePair(const unsigned int             index,
+                        const VectorType &             s,
+                        const VectorType &             y,
+                        std::vector<Array<TStorage>> & storedS,
+                        std::vector<Array<TStorage>> & storedY)
+{
+  const SizeValueType numberOfParameters = s.GetSize();
+
+  /** The pairs are only reallocated the first time an index is used. */
+  storedS[index].SetSize(numberOfParameters);
+  storedY[index].SetSize(numberOfParameters);
+
+  StorePassType<TStorage> pass;
+  pass.m_S = s.data_block();
+  pass.m_Y = y.data_block();
+  pass.m_StoredS = storedS[index].data_block();
+  pass.m_StoredY = storedY[index].data_block();
+
+  ValueType sums[2];
+  this->ExecutePass(StoreRange<TStorage>, &pass, numberOfParameters, sums);
+
+  this->m_InnerProductSY[index] = sums[0];
+  this->m_SquaredMagnitudeY[index] = sums[1];
+
+} // end StorePair()
+
+
+/**
+ * ****************** Store ************************
+ */
+
+void
+LBFGSHistory::Store(const unsigned int index, const VectorType & s, const VectorType & y)
+{
+  if (index >= this->m_Memory)
+  {
+    itkExceptionMacro(<< "The index " << index << " is not smaller than the memory " << this->m_Memory);
+  }
+  if (s.GetSize() != this->m_NumberOfParameters || y.GetSize() != this->m_NumberOfParameters)
+  {
+    itkExceptionMacro(<< "The size of s and y should be " << this->m_NumberOfParameters);
+  }
+
+  if (this->m_FloatStorage)
+  {
+    this->StorePair<float>(index, s, y, this->m_FloatS, this->m_FloatY);
+  }
+  else
+  {
+    this->StorePair<ValueType>(index, s, y, this->m_S, this->m_Y);
+  }
+
+} // end Store()
+
+
+/**
+ * ****************** GetInnerProductSY ************************
+ */
+
+LBFGSHistory::ValueType
+LBFGSHistory::GetInnerProductSY(const unsigned int index) const
+{
+  return this->m_InnerProductSY[index];
+
+} // end GetInnerProductSY()
+
+
+/**
+ * ****************** GetSquaredMagnitudeY ************************
+ */
+
+LBFGSHistory::ValueType
+LBFGSHistory::GetSquaredMagnitudeY(const unsigned int index) const
+{
+  return this->m_SquaredMagnitudeY[index];
+
+} // end GetSquaredMagnitudeY()
+
+
+/**
+ * ****************** TwoLoopRecursion ************************
+ *
+ * COMPUTE -H*G USING THE FORMULA GIVEN IN: Nocedal, J. 1980,
+ * "Updating quasi-Newton matrices with limited storage",
+ * Mathematics of Computation, Vol.24, No.151, pp. 773-782.
+ */
+
+template <class TStorage>
+void
+LBFGSHistory::TwoLoopRecursion(const std::vector<Array<TStorage>> & storedS,
+                               const std::vector<Array<TStorage>> & storedY,
+                               const VectorType &                   gradient,
+                               const RhoType &                      rho,
+                               const unsigned int                   point,
+                               const unsigned int                   bound,
+                               const ValueType *                    diagonal,
+                               const double                         h0,
+                               VectorType &                         searchDir) const
+{
+  typedef RecursionPassType<TStorage> PassType;
+
+  const SizeValueType numberOfParameters = gradient.GetSize();
+  searchDir.SetSize(numberOfParameters);
+
+  /** The scaling by H0, which is applied halfway the recursion. */
+  PassType scaling;
+  if (diagonal != nullptr)
+  {
+    scaling.m_ScaleKind = DiagonalScale;
+    scaling.m_Diagonal = diagonal;
+  }
+  else
+  {
+    scaling.m_ScaleKind = ScalarScale;
+    scaling.m_Scale = h0;
+  }
+
+  ValueType sums[2];
+
+  /** Without pairs the search direction is just -H0 g. */
+  if (bound == 0)
+  {
+    PassType pass = scaling;
+    pass.m_Direction = searchDir.data_block();
+    pass.m_Gradient = gradient.data_block();
+    this->ExecutePass(RecursionRange<TStorage>, &pass, numberOfParameters, sums);
+    return;
+  }
+
+  /** The indices of the pairs, from the newest to the oldest. */
+  std::vector<unsigned int> index(bound);
+  for (unsigned int i = 0; i < bound; ++i)
+  {
+    index[i] = (point + 2 * this->m_Memory - 1 - i) % this->m_Memory;
+  }
+  std::vector<ValueType> alpha(bound);
+
+  /** q = -g, and s'q of the newest pair. */
+  PassType pass;
+  pass.m_Direction = searchDir.data_block();
+  pass.m_Gradient = gradient.data_block();
+  pass.m_Dot = storedS[index[0]].data_block();
+  this->ExecutePass(RecursionRange<TStorage>, &pass, numberOfParameters, sums);
+
+  /** The first loop, from the newest to the oldest pair: alpha_i = rho_i s_i'q,
+   * and q = q - alpha_i y_i. The inner product of the next step is computed in
+   * the same pass. After the oldest pair, q is scaled by H0.
+   */
+  for (unsigned int i = 0; i < bound; ++i)
+  {
+    alpha[i] = rho[index[i]] * sums[0];
+
+    pass = (i + 1 < bound) ? PassType() : scaling;
+    pass.m_Direction = searchDir.data_block();
+    pass.m_Coefficient = -alpha[i];
+    pass.m_Add = storedY[index[i]].data_block();
+    pass.m_Dot = (i + 1 < bound) ? storedS[index[i + 1]].data_block() : storedY[index[i]].data_block();
+    this->ExecutePass(RecursionRange<TStorage>, &pass, numberOfParameters, sums);
+  }
+
+  /** The second loop, from the oldest to the newest pair: beta_i = rho_i y_i'q,
+   * and q = q + (alpha_i - beta_i) s_i.
+   */
+  for (unsigned int i = bound; i > 0; --i)
+  {
+    const unsigned int m = i - 1;
+    const ValueType    beta = rho[index[m]] * sums[0];
+
+    pass = PassType();
+    pass.m_Direction = searchDir.data_block();
+    pass.m_Coefficient = alpha[m] - beta;
+    pass.m_Add = storedS[index[m]].data_block();
+    pass.m_Dot = (m > 0) ? storedY[index[m - 1]].data_block() : nullptr;
+    this->ExecutePass(RecursionRange<TStorage>, &pass, numberOfParameters, sums);
+  }
+
+} // end TwoLoopRecursion()
+
+
+/**
+ * ****************** ComputeSearchDirection ************************
+ */
+
+void
+LBFGSHistory::ComputeSearchDirection(const VectorType &         gradient,
+                                     const RhoType &            rho,
+                                     const unsigned int         point,
+                                     const unsigned int         bound,
+                                     const DiagonalMatrixType & H0,
+                                     VectorType &               searchDir) const
+{
+  if (H0.GetSize() != gradient.GetSize())
+  {
+    itkExceptionMacro(<< "The size of H0 should be " << gradient.GetSize());
+  }
+
+  this->ComputeSearchDirection(gradient, rho, point, bound, H0.data_block(), 1.0, searchDir);
+
+} // end ComputeSearchDirection()
+
+
+/**
+ * ****************** ComputeSearchDirection ************************
+ */
+
+void
+LBFGSHistory::ComputeSearchDirection(const VectorType & gradient,
+                                     const RhoType &    rho,
+                                     const unsigned int point,
+                                     const unsigned int bound,
+                                     const double       h0,
+                                     VectorType &       searchDir) const
+{
+  this->ComputeSearchDirection(gradient, rho, point, bound, nullptr, h0, searchDir);
+
+} // end ComputeSearchDirection()
+
+
+/**
+ * ****************** ComputeSearchDirection ************************
+ */
+
+void
+LBFGSHistory::ComputeSearchDirection(const VectorType & gradient,
+                                     const RhoType &    rho,
+                                     const unsigned int point,
+                                     const unsigned int bound,
+                                     const ValueType *  diagonal,
+                                     const double       h0,
+                                     VectorType &       searchDir) const
+{
+  if (bound > this->m_Memory)
+  {
+    itkExceptionMacro(<< "The bound " << bound << " exceeds the memory " << this->m_Memory);
+  }
+  if (bound > 0 && gradient.GetSize() != this->m_NumberOfParameters)
+  {
+    itkExceptionMacro(<< "The size of the gradient should be " << this->m_NumberOfParameters);
+  }
+
+  if (this->m_FloatStorage)
+  {
+    this->TwoLoopRecursion<float>(this->m_FloatS, this->m_FloatY, gradient, rho, point, bound, diagonal, h0, searchDir);
+  }
+  else
+  {
+    this->TwoLoopRecursion<ValueType>(this->m_S, this->m_Y, gradient, rho, point, bound, diagonal, h0, searchDir);
+  }
+
+} // end ComputeSearchDirection()
+
+
+/**
+ * ****************** ExecutePass ************************
+ */
+
+void
+LBFGSHistory::ExecutePass(RangeFunctionType   function,
+                          const void *        pass,
+                          const SizeValueType numberOfParameters,
+                          ValueType           sums[2]) const
+{
+  sums[0] = 0.0;
+  sums[1] = 0.0;
+  if (numberOfParameters == 0)
+  {
+    return;
+  }
+
+  /** Determine the number of work units, such that every work unit
+   * handles at least the minimum number of parameters.
+   */
+  ThreadIdType numberOfWorkUnits = this->m_NumberOfWorkUnits;
+  if (numberOfWorkUnits == 0)
+  {
+    numberOfWorkUnits = ThreadBudget::GetNumberOfThreads();
+  }
+  const SizeValueType minimumPerWorkUnit = std::max<SizeValueType>(this->m_MinimumNumberOfParametersPerWorkUnit, 1);
+  numberOfWorkUnits =
+    static_cast<ThreadIdType>(std::min<SizeValueType>(numberOfWorkUnits, numberOfParameters / minimumPerWorkUnit));
+
+  /** Handle small problems in the calling thread. */
+  if (numberOfWorkUnits < 2)
+  {
+    function(pass, 0, numberOfParameters, sums);
+    return;
+  }
+
+  /** Divide the parameters in contiguous chunks; a multiple of eight keeps
+   * the chunks aligned with the vector registers.
+   */
+  SizeValueType chunkSize = (numberOfParameters + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  chunkSize = ((chunkSize + 7) / 8) * 8;
+
+  this->m_PartialSums.assign(numberOfWorkUnits * PartialSumStride, 0.0);
+
+  MultiThreaderParameterType userData;
+  userData.st_Function = function;
+  userData.st_Pass = pass;
+  userData.st_NumberOfParameters = numberOfParameters;
+  userData.st_ChunkSize = chunkSize;
+  userData.st_PartialSums = this->m_PartialSums.data();
+
+  ParallelTasks::Execute(numberOfWorkUnits, PassThreaderCallback, &userData);
+
+  /** Add the partial sums in a fixed order, which makes the result reproducible. */
+  for (ThreadIdType i = 0; i < numberOfWorkUnits; ++i)
+  {
+    sums[0] += this->m_PartialSums[i * PartialSumStride];
+    sums[1] += this->m_PartialSums[i * PartialSumStride + 1];
+  }
+
+} // end ExecutePass()
+
+
+/**
+ * ****************** PassThreaderCallback ************************
+ */
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+LBFGSHistory::PassThreaderCallback(void * arg)
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  /** Compute the range of this thread. */
+  const SizeValueType numberOfParameters = temp->st_NumberOfParameters;
+  const SizeValueType begin = std::min<SizeValueType>(threadID * temp->st_ChunkSize, numberOfParameters);
+  const SizeValueType end = std::min<SizeValueType>(begin + temp->st_ChunkSize, numberOfParameters);
+
+  temp->st_Function(temp->st_Pass, begin, end, temp->st_PartialSums + threadID * PartialSumStride);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end PassThreaderCallback()
+
+} // end namespace itk
@@ -0,0 +1,228 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkLBFGSHistory_h
+#define itkLBFGSHistory_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkArray.h"
+#include "itkParallelTasks.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class LBFGSHistory
+ * \brief Stores the correction pairs of an L-BFGS optimizer and computes its search direction.
+ *
+ * The history holds the last \f$M\f$ steps \f$s_i = x_{i+1} - x_i\f$ and gradient
+ * differences \f$y_i = g_{i+1} - g_i\f$ in a circular buffer. Optionally, the pairs
+ * are stored in single precision, which halves the memory of the history. The inner
+ * products are always accumulated in double precision.
+ *
+ * The search direction \f$-H g\f$ is computed with the two-loop recursion of
+ * Nocedal (1980). Every update of the search direction is fused with the inner
+ * product needed by the next step of the recursion, so that the recursion passes
+ * \f$2M+1\f$ times over the parameters, instead of \f$4M\f$ times. For large
+ * numbers of parameters every pass is divided over the work units of a
+ * ParallelTasks. The partial sums of the work units are added in a fixed
+ * order, so that the result does not depend on the scheduling of the threads.
+ * Small problems are handled by the calling thread.
+ *
+ * \ingroup Numerics Optimizers
+ */
+
+class LBFGSHistory : public Object
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef LBFGSHistory             Self;
+  typedef Object                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LBFGSHistory, Object);
+
+  /** Typedefs of the optimizer arrays. */
+  typedef double           ValueType;
+  typedef Array<ValueType> VectorType;
+  typedef Array<ValueType> RhoType;
+  typedef Array<ValueType> DiagonalMatrixType;
+
+  /** Discard the stored pairs, and prepare the history for the given memory
+   * and number of parameters. The UseFloatStorage setting takes effect here.
+   * The pairs themselves are allocated when they are stored.
+   */
+  void
+  Initialize(const unsigned int memory, const SizeValueType numberOfParameters);
+
+  /** Get the memory and the number of parameters, as passed to Initialize(). */
+  itkGetConstMacro(Memory, unsigned int);
+  itkGetConstMacro(NumberOfParameters, SizeValueType);
+
+  /** Store the pair (s, y) at the given index of the circular buffer. The
+   * inner products s'y and y'y are computed in the same pass.
+   */
+  void
+  Store(const unsigned int index, const VectorType & s, const VectorType & y);
+
+  /** Get the inner products of the pair at the given index. */
+  ValueType
+  GetInnerProductSY(const unsigned int index) const;
+  ValueType
+  GetSquaredMagnitudeY(const unsigned int index) const;
+
+  /** Compute the search direction -H g, where H is the L-BFGS approximation of
+   * the inverse Hessian built from the initial matrix H0 and the last \c bound
+   * pairs. The newest pair is stored at the index before \c point, and rho
+   * contains 1/(s'y) for every index.
+   */
+  void
+  ComputeSearchDirection(const VectorType &         gradient,
+                         const RhoType &            rho,
+                         const unsigned int         point,
+                         const unsigned int         bound,
+                         const DiagonalMatrixType & H0,
+                         VectorType &               searchDir) const;
+
+  /** The same, for the initial matrix H0 = h0 I. */
+  void
+  ComputeSearchDirection(const VectorType & gradient,
+                         const RhoType &    rho,
+                         const unsigned int point,
+                         const unsigned int bound,
+                         const double       h0,
+                         VectorType &       searchDir) const;
+
+  /** Setting: store the pairs in single precision. False by default. */
+  itkSetMacro(UseFloatStorage, bool);
+  itkGetConstMacro(UseFloatStorage, bool);
+  itkBooleanMacro(UseFloatStorage);
+
+  /** Set the number of work units. A value of zero means the global default. */
+  itkSetMacro(NumberOfWorkUnits, ThreadIdType);
+  itkGetConstMacro(NumberOfWorkUnits, ThreadIdType);
+
+  /** Set the minimum number of parameters per work unit. Passes over fewer
+   * parameters than twice this number are performed by the calling thread.
+   */
+  itkSetMacro(MinimumNumberOfParametersPerWorkUnit, SizeValueType);
+  itkGetConstMacro(MinimumNumberOfParametersPerWorkUnit, SizeValueType);
+
+protected:
+  LBFGSHistory() = default;
+  ~LBFGSHistory() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  LBFGSHistory(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Typedefs for multi-threading. */
+  typedef ParallelTasks::WorkUnitInfoType ThreadInfoType;
+
+  /** A function that performs a pass over the range [begin, end) of the
+   * parameters, and adds its two partial sums to sums.
+   */
+  typedef void (*RangeFunctionType)(const void *        pass,
+                                    const SizeValueType begin,
+                                    const SizeValueType end,
+                                    ValueType *         sums);
+
+  /** The struct that is passed to the threads. */
+  struct MultiThreaderParameterType
+  {
+    RangeFunctionType st_Function;
+    const void *      st_Pass;
+    SizeValueType     st_NumberOfParameters;
+    SizeValueType     st_ChunkSize;
+    ValueType *       st_PartialSums;
+  };
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  PassThreaderCallback(void * arg);
+
+  /** Perform a pass over all parameters, divided over the work units when
+   * there are enough parameters. Returns the two sums of the pass.
+   */
+  void
+  ExecutePass(RangeFunctionType   function,
+              const void *        pass,
+              const SizeValueType numberOfParameters,
+              ValueType           sums[2]) const;
+
+  /** Store a pair in the storage of the given precision. */
+  template <class TStorage>
+  void
+  StorePair(const unsigned int             index,
+            const VectorType &             s,
+            const VectorType &             y,
+            std::vector<Array<TStorage>> & storedS,
+            std::vector<Array<TStorage>> & storedY);
+
+  /** The two-loop recursion, for the storage of the given precision. */
+  template <class TStorage>
+  void
+  TwoLoopRecursion(const std::vector<Array<TStorage>> & storedS,
+                   const std::vector<Array<TStorage>> & storedY,
+                   const VectorType &                   gradient,
+                   const RhoType &                      rho,
+                   const unsigned int                   point,
+                   const unsigned int                   bound,
+                   const ValueType *                    diagonal,
+                   const double                         h0,
+                   VectorType &                         searchDir) const;
+
+  /** Dispatch to the two-loop recursion of the storage in use. */
+  void
+  ComputeSearchDirection(const VectorType & gradient,
+                         const RhoType &    rho,
+                         const unsigned int point,
+                         const unsigned int bound,
+                         const ValueType *  diagonal,
+                         const double       h0,
+                         VectorType &       searchDir) const;
+
+  bool          m_UseFloatStorage{ false };
+  bool          m_FloatStorage{ false };
+  unsigned int  m_Memory{ 0 };
+  SizeValueType m_NumberOfParameters{ 0 };
+
+  std::vector<Array<ValueType>> m_S;
+  std::vector<Array<ValueType>> m_Y;
+  std::vector<Array<float>>     m_FloatS;
+  std::vector<Array<float>>     m_FloatY;
+  std::vector<ValueType>        m_InnerProductSY;
+  std::vector<ValueType>        m_SquaredMagnitudeY;
+
+  ThreadIdType                   m_NumberOfWorkUnits{ 0 };
+  SizeValueType                  m_MinimumNumberOfParametersPerWorkUnit{ 32768 };
+  mutable std::vector<ValueType> m_PartialSums;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkLBFGSHistory_h
@@ -71,11 +71,14 @@ namespace itk
  *               Uses mirror boundary conditions.
  *               Can only process LargestPossibleRegion
  *
+ * The dimensions are processed one after the other. The lines along the
+ * current dimension are independent, and are divided over the threads.
+ *
  * \sa itkBSplineInterpolateImageFunction
  *
  *  ***TODO: Is this an ImageFilter?  or does it belong to another group?
  * \ingroup ImageFilters
- * \ingroup SingleThreaded
+ * \ingroup MultiThreaded
  * \ingroup CannotBeStreamed
  */
 template <class TInputImage, class TOutputImage>
@@ -100,6 +103,7 @@ public:
   typedef typename Superclass::InputImagePointer      InputImagePointer;
   typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
   typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename TOutputImage::RegionType           OutputImageRegionType;
 
   typedef typename itk::NumericTraits<typename TOutputImage::PixelType>::RealType CoeffType;
 
@@ -154,7 +158,6 @@ protected:
   EnlargeOutputRequestedRegion(DataObject * output) override;
 
   /** These are needed by the smoothing spline routine. */
-  std::vector<CoeffType>         m_Scratch;    // temp storage for processing of Coefficients
   typename TInputImage::SizeType m_DataLength; // Image size
 
   unsigned int m_SplineOrder[ImageDimension]; // User specified spline order per dimension (3rd or cubic is the default)
@@ -174,32 +177,37 @@ private:
 
   /** Converts a vector of data to a vector of Spline coefficients. */
   virtual bool
-  DataToCoefficients1D();
+  DataToCoefficients1D(std::vector<CoeffType> & scratch) const;
 
   /** Converts an N-dimension image of data to an equivalent sized image
    *    of spline coefficients. */
   void
   DataToCoefficientsND();
 
+  /** Converts the lines along m_IteratorDirection inside the region.
+   * Called by the threads; every thread has its own scratch vector. */
+  void
+  DataToCoefficientsLines(TOutputImage * output, const OutputImageRegionType & region) const;
+
   /** Determines the first coefficient for the causal filtering of the data. */
   virtual void
-  SetInitialCausalCoefficient(double z);
+  SetInitialCausalCoefficient(std::vector<CoeffType> & scratch, double z) const;
 
   /** Determines the first coefficient for the anti-causal filtering of the data. */
   virtual void
-  SetInitialAntiCausalCoefficient(double z);
+  SetInitialAntiCausalCoefficient(std::vector<CoeffType> & scratch, double z) const;
 
   /** Used to initialize the Coefficients image before calculation. */
   void
   CopyImageToImage();
 
-  /** Copies a vector of data from the Coefficients image to the m_Scratch vector. */
+  /** Copies a vector of data from the Coefficients image to the scratch vector. */
   void
-  CopyCoefficientsToScratch(OutputLinearIterator &);
+  CopyCoefficientsToScratch(OutputLinearIterator &, std::vector<CoeffType> & scratch) const;
 
-  /** Copies a vector of data from m_Scratch to the Coefficients image. */
+  /** Copies a vector of data from the scratch vector to the Coefficients image. */
   void
-  CopyScratchToCoefficients(OutputLinearIterator &);
+  CopyScratchToCoefficients(OutputLinearIterator &, const std::vector<CoeffType> & scratch) const;
 };
 
 } // namespace itk
@@ -40,7 +40,6 @@
 #include "itkMultiOrderBSplineDecompositionImageFilter.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkImageRegionIterator.h"
-#include "itkProgressReporter.h"
 #include "itkVector.h"
 
 namespace itk
@@ -82,7 +81,8 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::PrintSelf(
 
 template <class TInputImage, class TOutputImage>
 bool
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficients1D()
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficients1D(
+  std::vector<CoeffType> & scratch) const
 {
 
   // See Unser, 1993, Part II, Equation 2.5,
@@ -105,26 +105,26 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoef
   // apply the gain
   for (unsigned int n = 0; n < m_DataLength[m_IteratorDirection]; ++n)
   {
-    m_Scratch[n] *= c0;
+    scratch[n] *= c0;
   }
 
   // loop over all poles
   for (int k = 0; k < m_NumberOfPoles; ++k)
   {
     // causal initialization
-    this->SetInitialCausalCoefficient(m_SplinePoles[k]);
+    this->SetInitialCausalCoefficient(scratch, m_SplinePoles[k]);
     // causal recursion
     for (unsigned int n = 1; n < m_DataLength[m_IteratorDirection]; ++n)
     {
-      m_Scratch[n] += m_SplinePoles[k] * m_Scratch[n - 1];
+      scratch[n] += m_SplinePoles[k] * scratch[n - 1];
     }
 
     // anticausal initialization
-    this->SetInitialAntiCausalCoefficient(m_SplinePoles[k]);
+    this->SetInitialAntiCausalCoefficient(scratch, m_SplinePoles[k]);
     // anticausal recursion
     for (int n = m_DataLength[m_IteratorDirection] - 2; 0 <= n; n--)
     {
-      m_Scratch[n] = m_SplinePoles[k] * (m_Scratch[n + 1] - m_Scratch[n]);
+      scratch[n] = m_SplinePoles[k] * (scratch[n + 1] - scratch[n]);
     }
   }
   return true;
@@ -214,7 +214,9 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetPoles(u
 
 template <class TInputImage, class TOutputImage>
 void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialCausalCoefficient(double z)
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialCausalCoefficient(
+  std::vector<CoeffType> & scratch,
+  double                   z) const
 {
   /* begining InitialCausalCoefficient */
   /* See Unser, 1999, Box 2 for explaination */
@@ -232,42 +234,44 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitial
   if (horizon < m_DataLength[m_IteratorDirection])
   {
     /* accelerated loop */
-    sum = m_Scratch[0]; // verify this
+    sum = scratch[0]; // verify this
     for (unsigned int n = 1; n < horizon; ++n)
     {
-      sum += zn * m_Scratch[n];
+      sum += zn * scratch[n];
       zn *= z;
     }
-    m_Scratch[0] = sum;
+    scratch[0] = sum;
   }
   else
   {
     /* full loop */
     iz = 1.0 / z;
     z2n = std::pow(z, (double)(m_DataLength[m_IteratorDirection] - 1L));
-    sum = m_Scratch[0] + z2n * m_Scratch[m_DataLength[m_IteratorDirection] - 1L];
+    sum = scratch[0] + z2n * scratch[m_DataLength[m_IteratorDirection] - 1L];
     z2n *= z2n * iz;
     for (unsigned int n = 1; n <= (m_DataLength[m_IteratorDirection] - 2); ++n)
     {
-      sum += (zn + z2n) * m_Scratch[n];
+      sum += (zn + z2n) * scratch[n];
       zn *= z;
       z2n *= iz;
     }
-    m_Scratch[0] = sum / (1.0 - zn * zn);
+    scratch[0] = sum / (1.0 - zn * zn);
   }
 }
 
 
 template <class TInputImage, class TOutputImage>
 void
-MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialAntiCausalCoefficient(double z)
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::SetInitialAntiCausalCoefficient(
+  std::vector<CoeffType> & scratch,
+  double                   z) const
 {
   // this initialization corresponds to mirror boundaries
   /* See Unser, 1999, Box 2 for explaination */
   //  Also see erratum at http://bigwww.epfl.ch/publications/unser9902.html
-  m_Scratch[m_DataLength[m_IteratorDirection] - 1] =
+  scratch[m_DataLength[m_IteratorDirection] - 1] =
     (z / (z * z - 1.0)) *
-    (z * m_Scratch[m_DataLength[m_IteratorDirection] - 2] + m_Scratch[m_DataLength[m_IteratorDirection] - 1]);
+    (z * scratch[m_DataLength[m_IteratorDirection] - 2] + scratch[m_DataLength[m_IteratorDirection] - 1]);
 }
 
 
@@ -277,12 +281,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoef
 {
   OutputImagePointer output = this->GetOutput();
 
-  Size<ImageDimension> size = output->GetBufferedRegion().GetSize();
-
-  unsigned int count = output->GetBufferedRegion().GetNumberOfPixels() / size[0] * ImageDimension;
-
-  ProgressReporter progress(this, 0, count, 10);
-
   // Initialize coeffient array
   this->CopyImageToImage(); // Coefficients are initialized to the input data
 
@@ -294,25 +292,48 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoef
     // Compute poles for this dimension
     this->SetPoles(n);
 
-    // Initialize iterators
-    OutputLinearIterator CIterator(output, output->GetBufferedRegion());
-    CIterator.SetDirection(m_IteratorDirection);
-    // For each data vector
-    while (!CIterator.IsAtEnd())
-    {
-      // Copy coefficients to scratch
-      this->CopyCoefficientsToScratch(CIterator);
-
-      // Perform 1D BSpline calculations
-      this->DataToCoefficients1D();
-
-      // Copy scratch back to coefficients.
-      // Brings us back to the end of the line we were working on.
-      CIterator.GoToBeginOfLine();
-      this->CopyScratchToCoefficients(CIterator); // m_Scratch = m_Image;
-      CIterator.NextLine();
-      progress.CompletedPixel();
-    }
+    // The lines along this dimension are independent, so divide them over the threads.
+    // The threads only read the poles and the direction.
+    this->GetMultiThreader()->template ParallelizeImageRegionRestrictDirection<OutputImageDimension>(
+      m_IteratorDirection,
+      output->GetBufferedRegion(),
+      [this, &output](const OutputImageRegionType & region) { this->DataToCoefficientsLines(output, region); },
+      nullptr);
+
+    this->UpdateProgress(static_cast<float>(n + 1) / static_cast<float>(ImageDimension));
+  }
+}
+
+
+/**
+ * Convert the lines of a (thread) region
+ */
+template <class TInputImage, class TOutputImage>
+void
+MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::DataToCoefficientsLines(
+  TOutputImage *                output,
+  const OutputImageRegionType & region) const
+{
+  // Every thread has its own scratch memory
+  std::vector<CoeffType> scratch(m_DataLength[m_IteratorDirection]);
+
+  // Initialize iterators
+  OutputLinearIterator CIterator(output, region);
+  CIterator.SetDirection(m_IteratorDirection);
+  // For each data vector
+  while (!CIterator.IsAtEnd())
+  {
+    // Copy coefficients to scratch
+    this->CopyCoefficientsToScratch(CIterator, scratch);
+
+    // Perform 1D BSpline calculations
+    this->DataToCoefficients1D(scratch);
+
+    // Copy scratch back to coefficients.
+    // Brings us back to the end of the line we were working on.
+    CIterator.GoToBeginOfLine();
+    this->CopyScratchToCoefficients(CIterator, scratch);
+    CIterator.NextLine();
   }
 }
 
@@ -348,13 +369,14 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyImageT
 template <class TInputImage, class TOutputImage>
 void
 MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyScratchToCoefficients(
-  OutputLinearIterator & Iter)
+  OutputLinearIterator &         Iter,
+  const std::vector<CoeffType> & scratch) const
 {
   typedef typename TOutputImage::PixelType OutputPixelType;
   unsigned long                            j = 0;
   while (!Iter.IsAtEndOfLine())
   {
-    Iter.Set(static_cast<OutputPixelType>(m_Scratch[j]));
+    Iter.Set(static_cast<OutputPixelType>(scratch[j]));
     ++Iter;
     ++j;
   }
@@ -367,12 +389,13 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyScratc
 template <class TInputImage, class TOutputImage>
 void
 MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::CopyCoefficientsToScratch(
-  OutputLinearIterator & Iter)
+  OutputLinearIterator &   Iter,
+  std::vector<CoeffType> & scratch) const
 {
   unsigned long j = 0;
   while (!Iter.IsAtEndOfLine())
   {
-    m_Scratch[j] = static_cast<CoeffType>(Iter.Get());
+    scratch[j] = static_cast<CoeffType>(Iter.Get());
     ++Iter;
     ++j;
   }
@@ -423,20 +446,9 @@ void
 MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
 
-  // Allocate scratch memory
   InputImageConstPointer inputPtr = this->GetInput();
   m_DataLength = inputPtr->GetBufferedRegion().GetSize();
 
-  unsigned long maxLength = 0;
-  for (unsigned int n = 0; n < ImageDimension; ++n)
-  {
-    if (m_DataLength[n] > maxLength)
-    {
-      maxLength = m_DataLength[n];
-    }
-  }
-  m_Scratch.resize(maxLength);
-
   // Allocate memory for output image
   OutputImagePointer outputPtr = this->GetOutput();
   outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
@@ -444,9 +456,6 @@ MultiOrderBSplineDecompositionImageFilter<TInputImage, TOutputImage>::GenerateDa
 
   // Calculate actual output
   this->DataToCoefficientsND();
-
-  // Clean up
-  m_Scratch.clear();
 }
 
 
@@ -117,6 +117,7 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>::G
     smootherArray[i]->SetZeroOrder();
     smootherArray[i]->SetNormalizeAcrossScale(false);
     smootherArray[i]->ReleaseDataFlagOn();
+    smootherArray[i]->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
   }
 
   /** Create smoother pointer array which maintains pointers
@@ -128,6 +129,7 @@ MultiResolutionGaussianSmoothingPyramidImageFilter<TInputImage, TOutputImage>::G
 
   // First set the input of the first filter pointer to the input image.
   caster->SetInput(inputPtr);
+  caster->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
   smootherArray[0]->SetInput(caster->GetOutput());
 
   /** Set the standard deviation and do the smoothing */
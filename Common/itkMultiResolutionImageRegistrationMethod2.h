@@ -45,6 +45,8 @@
 #include "itkMultiResolutionPyramidImageFilter.h"
 #include "itkNumericTraits.h"
 #include "itkDataObjectDecorator.h"
+#include <algorithm> // For max.
+#include <vector>
 
 namespace itk
 {
@@ -119,6 +121,7 @@ public:
   /**  Type of the Moving image. */
   typedef TMovingImage                           MovingImageType;
   typedef typename MovingImageType::ConstPointer MovingImageConstPointer;
+  typedef typename MovingImageType::RegionType   MovingImageRegionType;
 
   /**  Type of the metric. */
   typedef AdvancedImageToImageMetric<FixedImageType, MovingImageType> MetricType;
@@ -158,6 +161,11 @@ public:
   /** Smart Pointer type to a DataObject. */
   typedef typename DataObject::Pointer DataObjectPointer;
 
+  /** Typedefs for a multi-start registration. */
+  typedef typename MetricType::MeasureType MeasureType;
+  typedef std::vector<ParametersType>      ParametersContainerType;
+  typedef std::vector<MeasureType>         MeasureContainerType;
+
   /** Method that initiates the registration. */
   virtual void
   StartRegistration(void);
@@ -186,6 +194,56 @@ public:
   itkSetMacro(FixedImageRegion, FixedImageRegionType);
   itkGetConstReferenceMacro(FixedImageRegion, FixedImageRegionType);
 
+  /** Set/Get the region of the fixed image from which the fixed image pyramid
+   * is computed, e.g. the bounding box of the fixed mask. The region is padded
+   * by PyramidInputRegionMargin voxels of the coarsest level, and cropped by the
+   * fixed image. The default, an empty region, means the whole image. The
+   * FixedImageRegion, and therefore the transform, is not affected.
+   */
+  itkSetMacro(FixedImagePyramidInputRegion, FixedImageRegionType);
+  itkGetConstReferenceMacro(FixedImagePyramidInputRegion, FixedImageRegionType);
+
+  /** Set/Get the region of the moving image from which the moving image pyramid
+   * is computed, like the FixedImagePyramidInputRegion.
+   */
+  itkSetMacro(MovingImagePyramidInputRegion, MovingImageRegionType);
+  itkGetConstReferenceMacro(MovingImagePyramidInputRegion, MovingImageRegionType);
+
+  /** Set/Get the margin around the pyramid input regions, in voxels of the
+   * coarsest level. It should cover the support of the smoothing and of the
+   * interpolator. Default 4.
+   */
+  itkSetMacro(PyramidInputRegionMargin, unsigned int);
+  itkGetConstMacro(PyramidInputRegionMargin, unsigned int);
+
+  /** Set/Get whether the moving image of each level is cropped to the region to which the
+   * transform, with the initial parameters of the level, maps the FixedImageRegion of the
+   * level, padded by MovingImageRegionMargin voxels of the level. The metric, and therefore
+   * the B-spline coefficients of the interpolator and any copy to a GPU, then only cover
+   * that region. A sample that the optimization moves beyond the margin maps outside the
+   * moving image. Default false.
+   */
+  itkSetMacro(CropMovingImageToTransform, bool);
+  itkGetConstMacro(CropMovingImageToTransform, bool);
+
+  /** Set/Get the margin of CropMovingImageToTransform, in voxels of the current level.
+   * It should cover the motion during the level, and the support of the interpolator. Default 8.
+   */
+  itkSetMacro(MovingImageRegionMargin, unsigned int);
+  itkGetConstMacro(MovingImageRegionMargin, unsigned int);
+
+  /** Get the region to which the moving image of the current level is cropped. It is
+   * empty when the moving image is not cropped.
+   */
+  itkGetConstReferenceMacro(MovingImageRegionOfCurrentLevel, MovingImageRegionType);
+
+  /** Returns whether the transform, with its current parameters, still maps the
+   * FixedImageRegion of the current level inside the MovingImageRegionOfCurrentLevel.
+   * Always true when the moving image is not cropped.
+   */
+  bool
+  IsTransformedFixedRegionInsideMovingImageRegion(void) const;
+
   /** Set/Get the Transform. */
   itkSetObjectMacro(Transform, TransformType);
   itkGetModifiableObjectMacro(Transform, TransformType);
@@ -225,6 +283,49 @@ public:
    */
   itkGetConstReferenceMacro(LastTransformParameters, ParametersType);
 
+  /** Set/Get the resolution level at which a registration is resumed, and the
+   * parameters at which the optimization of that level starts. The optimization
+   * of the previous levels is skipped. The default, empty ResumeParameters, means
+   * no resume.
+   */
+  itkSetMacro(ResumeLevel, unsigned long);
+  itkGetConstMacro(ResumeLevel, unsigned long);
+  itkSetMacro(ResumeParameters, ParametersType);
+  itkGetConstReferenceMacro(ResumeParameters, ParametersType);
+
+  /** Set/Get the offsets of the extra starts of a multi-start registration. Besides the
+   * initial parameters of the first level that is optimized, the optimization starts from
+   * these parameters plus each offset. The starts share the pyramids, the metric with its
+   * samplers, and the interpolator, and are optimized one after the other. After the first
+   * level, only the NumberOfSurvivingStarts with the lowest metric value, computed for all of
+   * them on one grid of samples, are optimized at the next levels, and the best one of them
+   * is the result. The default, no offsets, means a single start. When the number of
+   * parameters changes between levels, only the best start is continued.
+   */
+  virtual void
+  SetMultiStartParameterOffsets(const ParametersContainerType & offsets)
+  {
+    this->m_MultiStartParameterOffsets = offsets;
+    this->Modified();
+  }
+  itkGetConstReferenceMacro(MultiStartParameterOffsets, ParametersContainerType);
+
+  /** Set/Get the number of starts that are kept after the first level. Default: 1 */
+  itkSetClampMacro(NumberOfSurvivingStarts, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfSurvivingStarts, unsigned int);
+
+  /** Get the number of starts of the current level, and the one that is being optimized. */
+  SizeValueType
+  GetNumberOfStarts(void) const
+  {
+    return std::max<SizeValueType>(this->m_MultiStartParameters.size(), 1);
+  }
+  itkGetConstMacro(CurrentStart, SizeValueType);
+
+  /** Get the metric values of the starts, from low to high, after the last level that
+   * was optimized with multiple starts. */
+  itkGetConstReferenceMacro(MultiStartValues, MeasureContainerType);
+
   /** Returns the transform resulting from the registration process. */
   const TransformOutputType *
   GetOutput(void) const;
@@ -269,9 +370,52 @@ protected:
   virtual void
   PreparePyramids(void);
 
+  /** To be called at the start of each level, after the iteration event. For a level
+   * before the ResumeLevel, the parameters are passed on without optimization, and true
+   * is returned, meaning that the level should be skipped. At the ResumeLevel, the
+   * initial parameters of the level are replaced by the ResumeParameters.
+   */
+  bool
+  PrepareLevelForResume(void);
+
+  /** Optimize the starts of a multi-start registration at the current level, and sort
+   * them on their final metric values. These values are computed after all starts are
+   * optimized, on one grid of samples. After the first level, only the surviving starts
+   * are kept. */
+  virtual void
+  OptimizeMultiStart(const bool firstLevel);
+
   /** Set the current level to be processed. */
   itkSetMacro(CurrentLevel, unsigned long);
 
+  /** Returns the part of the image within the padded region, or the image
+   * itself when the region is empty or covers the whole image.
+   */
+  template <class TImage>
+  typename TImage::ConstPointer
+  GetPyramidInput(const TImage *                                       image,
+                  const typename TImage::RegionType &                  region,
+                  const typename FixedImagePyramidType::ScheduleType & schedule) const;
+
+  /** Returns a copy of the part of the image within the region, which keeps
+   * the physical position of the region.
+   */
+  template <class TImage>
+  static typename TImage::ConstPointer
+  ExtractImageRegion(const TImage * image, const typename TImage::RegionType & region);
+
+  /** Returns the bounding region, in the index space of the moving image, of a lattice of
+   * points in the FixedImageRegion of the current level, mapped by the transform with its
+   * current parameters. Between the lattice points, a nonlinear transform may map beyond
+   * the region; the margin of CropMovingImageToTransform should cover that too.
+   */
+  MovingImageRegionType
+  ComputeTransformedFixedRegion(const MovingImageType & movingImage) const;
+
+  /** Returns the moving image of the current level, cropped when CropMovingImageToTransform is true. */
+  MovingImageConstPointer
+  GetMovingImageOfCurrentLevel(void);
+
   /** The last transform parameters. Compared to the ITK class
    * itk::MultiResolutionImageRegistrationMethod these member variables
    * are made protected, so they can be accessed by children classes.
@@ -301,8 +445,25 @@ private:
   FixedImageRegionType        m_FixedImageRegion;
   FixedImageRegionPyramidType m_FixedImageRegionPyramid;
 
+  FixedImageRegionType  m_FixedImagePyramidInputRegion;
+  MovingImageRegionType m_MovingImagePyramidInputRegion;
+  unsigned int          m_PyramidInputRegionMargin{ 4 };
+
+  bool                  m_CropMovingImageToTransform{ false };
+  unsigned int          m_MovingImageRegionMargin{ 8 };
+  MovingImageRegionType m_MovingImageRegionOfCurrentLevel;
+
   unsigned long m_NumberOfLevels;
   unsigned long m_CurrentLevel;
+
+  unsigned long  m_ResumeLevel{ 0 };
+  ParametersType m_ResumeParameters;
+
+  ParametersContainerType m_MultiStartParameterOffsets;
+  unsigned int            m_NumberOfSurvivingStarts{ 1 };
+  ParametersContainerType m_MultiStartParameters;
+  MeasureContainerType    m_MultiStartValues;
+  SizeValueType           m_CurrentStart{ 0 };
 };
 
 } // end namespace itk
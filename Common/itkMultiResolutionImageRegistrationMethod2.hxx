@@ -42,8 +42,12 @@
 #include "itkMultiResolutionImageRegistrationMethod2.h"
 #include "itkRecursiveMultiResolutionPyramidImageFilter.h"
 #include "itkContinuousIndex.h"
+#include "itkExtractImageFilter.h"
+#include "itkImageGridSampler.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm> // For stable_sort.
+
 namespace itk
 {
 
@@ -117,7 +121,7 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::Initialize(v
   }
 
   // Setup the metric
-  this->m_Metric->SetMovingImage(this->m_MovingImagePyramid->GetOutput(this->m_CurrentLevel));
+  this->m_Metric->SetMovingImage(this->GetMovingImageOfCurrentLevel());
   this->m_Metric->SetFixedImage(this->m_FixedImagePyramid->GetOutput(this->m_CurrentLevel));
   this->m_Metric->SetTransform(this->m_Transform);
   this->m_Metric->SetInterpolator(this->m_Interpolator);
@@ -149,6 +153,47 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::StopRegistra
 }
 
 
+/*
+ * Skip the levels before the resume level
+ */
+template <typename TFixedImage, typename TMovingImage>
+bool
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::PrepareLevelForResume(void)
+{
+  if (this->m_ResumeParameters.Size() == 0 || this->m_CurrentLevel > this->m_ResumeLevel)
+  {
+    return false;
+  }
+
+  const unsigned int numberOfParameters = this->m_Transform->GetNumberOfParameters();
+  if (this->m_CurrentLevel == this->m_ResumeLevel)
+  {
+    if (this->m_ResumeParameters.Size() != numberOfParameters)
+    {
+      itkExceptionMacro(<< "Size mismatch between resume parameters (" << this->m_ResumeParameters.Size()
+                        << ") and transform (" << numberOfParameters << ")");
+    }
+    this->m_InitialTransformParametersOfNextLevel = this->m_ResumeParameters;
+    return false;
+  }
+
+  /** Only the size of the parameters of a skipped level matters, e.g. for
+   * upsampling a B-spline grid, as the ResumeParameters replace them.
+   */
+  ParametersType parameters = this->m_InitialTransformParametersOfNextLevel;
+  if (parameters.Size() != numberOfParameters)
+  {
+    parameters = ParametersType(numberOfParameters);
+    parameters.Fill(0.0);
+  }
+  this->m_LastTransformParameters = parameters;
+  this->m_Transform->SetParameters(this->m_LastTransformParameters);
+  this->m_InitialTransformParametersOfNextLevel = parameters;
+  return true;
+
+} // end PrepareLevelForResume()
+
+
 /*
  * Stop the Registration Process
  */
@@ -193,12 +238,15 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::PreparePyram
 
   // Setup the fixed image pyramid
   this->m_FixedImagePyramid->SetNumberOfLevels(this->m_NumberOfLevels);
-  this->m_FixedImagePyramid->SetInput(this->m_FixedImage);
+  this->m_FixedImagePyramid->SetInput(this->GetPyramidInput(
+    this->m_FixedImage.GetPointer(), this->m_FixedImagePyramidInputRegion, this->m_FixedImagePyramid->GetSchedule()));
   this->m_FixedImagePyramid->UpdateLargestPossibleRegion();
 
   // Setup the moving image pyramid
   this->m_MovingImagePyramid->SetNumberOfLevels(this->m_NumberOfLevels);
-  this->m_MovingImagePyramid->SetInput(this->m_MovingImage);
+  this->m_MovingImagePyramid->SetInput(this->GetPyramidInput(this->m_MovingImage.GetPointer(),
+                                                             this->m_MovingImagePyramidInputRegion,
+                                                             this->m_MovingImagePyramid->GetSchedule()));
   this->m_MovingImagePyramid->UpdateLargestPossibleRegion();
 
   typedef typename FixedImageRegionType::SizeType      SizeType;
@@ -260,11 +308,208 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::PreparePyram
 
     this->m_FixedImageRegionPyramid[level].SetSize(size);
     this->m_FixedImageRegionPyramid[level].SetIndex(start);
+
+    /** The pyramid image may only cover a part of the fixed image. */
+    this->m_FixedImageRegionPyramid[level].Crop(fixedImageAtLevel->GetLargestPossibleRegion());
   }
 
 } // end PreparePyramids()
 
 
+/*
+ * ****************** GetPyramidInput ******************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+template <class TImage>
+typename TImage::ConstPointer
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::GetPyramidInput(
+  const TImage *                                       image,
+  const typename TImage::RegionType &                  region,
+  const typename FixedImagePyramidType::ScheduleType & schedule) const
+{
+  if (region.GetNumberOfPixels() == 0)
+  {
+    return image;
+  }
+
+  /** Pad the region by the margin; the first row of the schedule is the coarsest level. */
+  typename TImage::RegionType           inputRegion = region;
+  typename TImage::RegionType::SizeType radius;
+  for (unsigned int dim = 0; dim < TImage::ImageDimension; ++dim)
+  {
+    radius[dim] = this->m_PyramidInputRegionMargin * std::max(schedule[0][dim], 1u);
+  }
+  inputRegion.PadByRadius(radius);
+  if (!inputRegion.Crop(image->GetLargestPossibleRegion()) || inputRegion == image->GetLargestPossibleRegion())
+  {
+    return image;
+  }
+
+  return ExtractImageRegion(image, inputRegion);
+
+} // end GetPyramidInput()
+
+
+/*
+ * ****************** ExtractImageRegion ******************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+template <class TImage>
+typename TImage::ConstPointer
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::ExtractImageRegion(
+  const TImage *                      image,
+  const typename TImage::RegionType & region)
+{
+  /** The extracted image keeps the index, and therefore the physical position, of the region. */
+  typedef ExtractImageFilter<TImage, TImage> ExtractorType;
+  typename ExtractorType::Pointer            extractor = ExtractorType::New();
+  extractor->SetInput(image);
+  extractor->SetExtractionRegion(region);
+  extractor->SetDirectionCollapseToSubmatrix();
+  extractor->Update();
+
+  typename TImage::Pointer output = extractor->GetOutput();
+  output->DisconnectPipeline();
+  return output.GetPointer();
+
+} // end ExtractImageRegion()
+
+
+/*
+ * ****************** ComputeTransformedFixedRegion ******************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+typename MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::MovingImageRegionType
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::ComputeTransformedFixedRegion(
+  const MovingImageType & movingImage) const
+{
+  typedef typename FixedImageRegionType::IndexType              FixedIndexType;
+  typedef typename MovingImageRegionType::IndexType             MovingIndexType;
+  typedef typename MovingImageRegionType::SizeType              MovingSizeType;
+  typedef typename MovingIndexType::IndexValueType              IndexValueType;
+  typedef typename FixedImageType::PointType                    FixedPointType;
+  typedef ContinuousIndex<double, TMovingImage::ImageDimension> MovingContinuousIndexType;
+
+  const FixedImageRegionType & fixedRegion = this->m_FixedImageRegionPyramid[this->m_CurrentLevel];
+  const FixedImageType *       fixedImage = this->m_FixedImagePyramid->GetOutput(this->m_CurrentLevel);
+  if (fixedRegion.GetNumberOfPixels() == 0)
+  {
+    return MovingImageRegionType();
+  }
+
+  /** A lattice of at most latticeSize points per dimension, including the boundaries of the region. */
+  const unsigned int latticeSize = 9;
+  unsigned int       numberOfPoints[TFixedImage::ImageDimension];
+  unsigned long      totalNumberOfPoints = 1;
+  for (unsigned int dim = 0; dim < TFixedImage::ImageDimension; ++dim)
+  {
+    numberOfPoints[dim] = static_cast<unsigned int>(std::min<SizeValueType>(fixedRegion.GetSize(dim), latticeSize));
+    totalNumberOfPoints *= numberOfPoints[dim];
+  }
+
+  double minIndex[TMovingImage::ImageDimension];
+  double maxIndex[TMovingImage::ImageDimension];
+  std::fill_n(minIndex, TMovingImage::ImageDimension, NumericTraits<double>::max());
+  std::fill_n(maxIndex, TMovingImage::ImageDimension, NumericTraits<double>::NonpositiveMin());
+  for (unsigned long point = 0; point < totalNumberOfPoints; ++point)
+  {
+    FixedIndexType fixedIndex = fixedRegion.GetIndex();
+    unsigned long  remainder = point;
+    for (unsigned int dim = 0; dim < TFixedImage::ImageDimension; ++dim)
+    {
+      const unsigned long i = remainder % numberOfPoints[dim];
+      remainder /= numberOfPoints[dim];
+      if (numberOfPoints[dim] > 1)
+      {
+        fixedIndex[dim] +=
+          static_cast<IndexValueType>((i * (fixedRegion.GetSize(dim) - 1)) / (numberOfPoints[dim] - 1));
+      }
+    }
+
+    FixedPointType fixedPoint;
+    fixedImage->TransformIndexToPhysicalPoint(fixedIndex, fixedPoint);
+    MovingContinuousIndexType movingIndex;
+    movingImage.TransformPhysicalPointToContinuousIndex(this->m_Transform->TransformPoint(fixedPoint), movingIndex);
+    for (unsigned int dim = 0; dim < TMovingImage::ImageDimension; ++dim)
+    {
+      minIndex[dim] = std::min(minIndex[dim], movingIndex[dim]);
+      maxIndex[dim] = std::max(maxIndex[dim], movingIndex[dim]);
+    }
+  }
+
+  MovingIndexType start;
+  MovingSizeType  size;
+  for (unsigned int dim = 0; dim < TMovingImage::ImageDimension; ++dim)
+  {
+    start[dim] = static_cast<IndexValueType>(std::floor(minIndex[dim]));
+    size[dim] = static_cast<SizeValueType>(static_cast<IndexValueType>(std::ceil(maxIndex[dim])) - start[dim] + 1);
+  }
+  return MovingImageRegionType(start, size);
+
+} // end ComputeTransformedFixedRegion()
+
+
+/*
+ * ****************** GetMovingImageOfCurrentLevel ******************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+typename MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::MovingImageConstPointer
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::GetMovingImageOfCurrentLevel(void)
+{
+  const MovingImageType * movingImage = this->m_MovingImagePyramid->GetOutput(this->m_CurrentLevel);
+  this->m_MovingImageRegionOfCurrentLevel = MovingImageRegionType();
+  if (!this->m_CropMovingImageToTransform ||
+      this->m_InitialTransformParametersOfNextLevel.Size() != this->m_Transform->GetNumberOfParameters())
+  {
+    return movingImage;
+  }
+
+  /** Map the fixed region with the parameters at which the optimization of this level starts. */
+  this->m_Transform->SetParametersByValue(this->m_InitialTransformParametersOfNextLevel);
+  MovingImageRegionType region = this->ComputeTransformedFixedRegion(*movingImage);
+  region.PadByRadius(this->m_MovingImageRegionMargin);
+  if (!region.Crop(movingImage->GetLargestPossibleRegion()) || region == movingImage->GetLargestPossibleRegion())
+  {
+    return movingImage;
+  }
+
+  this->m_MovingImageRegionOfCurrentLevel = region;
+  return ExtractImageRegion(movingImage, region);
+
+} // end GetMovingImageOfCurrentLevel()
+
+
+/*
+ * ****************** IsTransformedFixedRegionInsideMovingImageRegion ******************
+ */
+
+template <typename TFixedImage, typename TMovingImage>
+bool
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::IsTransformedFixedRegionInsideMovingImageRegion(
+  void) const
+{
+  if (this->m_MovingImageRegionOfCurrentLevel.GetNumberOfPixels() == 0)
+  {
+    return true;
+  }
+
+  /** The cropped region is compared to the region of the whole moving image of the level. */
+  const MovingImageType *     movingImage = this->m_MovingImagePyramid->GetOutput(this->m_CurrentLevel);
+  const MovingImageRegionType region = this->ComputeTransformedFixedRegion(*movingImage);
+  MovingImageRegionType       overlap = region;
+  if (!overlap.Crop(movingImage->GetLargestPossibleRegion()))
+  {
+    return true;
+  }
+  return this->m_MovingImageRegionOfCurrentLevel.IsInside(overlap);
+
+} // end IsTransformedFixedRegionInsideMovingImageRegion()
+
+
 /*
  * Starts the Registration Process
  */
@@ -291,6 +536,10 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::StartRegistr
   else
   {
     this->m_Stop = false;
+    this->m_MultiStartParameters.clear();
+    this->m_MultiStartValues.clear();
+    this->m_CurrentStart = 0;
+    bool firstOptimizedLevel = true;
 
     this->PreparePyramids();
 
@@ -308,6 +557,12 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::StartRegistr
         break;
       }
 
+      // Skip the levels that were finished before a resume
+      if (this->PrepareLevelForResume())
+      {
+        continue;
+      }
+
       try
       {
         // initialize the interconnects between components
@@ -322,24 +577,57 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::StartRegistr
         throw err;
       }
 
-      try
+      // The starts of a multi-start registration begin at the first optimized level. They
+      // are only continued as long as the number of parameters does not change.
+      if (firstOptimizedLevel && !this->m_MultiStartParameterOffsets.empty())
       {
-        // do the optimization
-        this->m_Optimizer->StartOptimization();
+        const ParametersType & initialParameters = this->m_InitialTransformParametersOfNextLevel;
+        this->m_MultiStartParameters.assign(1, initialParameters);
+        for (const ParametersType & offset : this->m_MultiStartParameterOffsets)
+        {
+          if (offset.Size() != initialParameters.Size())
+          {
+            itkExceptionMacro(<< "Size mismatch between a multi-start offset (" << offset.Size()
+                              << ") and the initial parameters (" << initialParameters.Size() << ")");
+          }
+          ParametersType parameters = initialParameters;
+          parameters += offset;
+          this->m_MultiStartParameters.push_back(parameters);
+        }
       }
-      catch (ExceptionObject & err)
+      else if (!this->m_MultiStartParameters.empty() &&
+               this->m_MultiStartParameters[0].Size() != this->m_InitialTransformParametersOfNextLevel.Size())
       {
-        // An error has occurred in the optimization.
-        // Update the parameters
-        this->m_LastTransformParameters = this->m_Optimizer->GetCurrentPosition();
-
-        // Pass exception to caller
-        throw err;
+        this->m_MultiStartParameters.clear();
       }
 
-      // get the results
-      this->m_LastTransformParameters = this->m_Optimizer->GetCurrentPosition();
+      if (this->m_MultiStartParameters.size() > 1)
+      {
+        this->OptimizeMultiStart(firstOptimizedLevel);
+      }
+      else
+      {
+        this->m_CurrentStart = 0;
+        try
+        {
+          // do the optimization
+          this->m_Optimizer->StartOptimization();
+        }
+        catch (ExceptionObject & err)
+        {
+          // An error has occurred in the optimization.
+          // Update the parameters
+          this->m_LastTransformParameters = this->m_Optimizer->GetCurrentPosition();
+
+          // Pass exception to caller
+          throw err;
+        }
+
+        // get the results
+        this->m_LastTransformParameters = this->m_Optimizer->GetCurrentPosition();
+      }
       this->m_Transform->SetParameters(this->m_LastTransformParameters);
+      firstOptimizedLevel = false;
 
       // setup the initial parameters for next level
       if (this->m_CurrentLevel < this->m_NumberOfLevels - 1)
@@ -352,6 +640,105 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::StartRegistr
 } // end StartRegistration()
 
 
+/*
+ * Optimize the starts of a multi-start registration
+ */
+template <typename TFixedImage, typename TMovingImage>
+void
+MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::OptimizeMultiStart(const bool firstLevel)
+{
+  const SizeValueType numberOfStarts = this->m_MultiStartParameters.size();
+  MeasureContainerType values(numberOfStarts, NumericTraits<MeasureType>::max());
+
+  for (this->m_CurrentStart = 0; this->m_CurrentStart < numberOfStarts && !this->m_Stop; ++this->m_CurrentStart)
+  {
+    ParametersType & parameters = this->m_MultiStartParameters[this->m_CurrentStart];
+    this->m_Optimizer->SetInitialPosition(parameters);
+    try
+    {
+      this->m_Optimizer->StartOptimization();
+    }
+    catch (ExceptionObject & err)
+    {
+      this->m_LastTransformParameters = this->m_Optimizer->GetCurrentPosition();
+      throw err;
+    }
+
+    parameters = this->m_Optimizer->GetCurrentPosition();
+  }
+  this->m_CurrentStart = numberOfStarts - 1;
+
+  /** Compare the starts by their metric values on one fixed set of samples, after all of
+   * them are optimized: the samples of the optimizer may differ per start and per iteration.
+   * A grid sampler with the input, mask and region of the image sampler of the metric is
+   * used, with about the same number of samples.
+   */
+  typedef typename MetricType::ImageSamplerType ImageSamplerType;
+  typedef ImageGridSampler<FixedImageType>      GridSamplerType;
+
+  const typename ImageSamplerType::Pointer optimizationSampler = this->m_Metric->GetImageSampler();
+  const bool useGridSampler = this->m_Metric->GetUseImageSampler() && optimizationSampler.IsNotNull();
+  if (useGridSampler)
+  {
+    typename GridSamplerType::Pointer gridSampler = GridSamplerType::New();
+    gridSampler->SetInput(optimizationSampler->GetInput());
+    gridSampler->SetMask(optimizationSampler->GetMask());
+    gridSampler->SetInputImageRegion(optimizationSampler->GetInputImageRegion());
+    gridSampler->SetNumberOfSamples(optimizationSampler->GetNumberOfSamples());
+    this->m_Metric->SetImageSampler(gridSampler);
+  }
+
+  try
+  {
+    for (SizeValueType i = 0; i < numberOfStarts && !this->m_Stop; ++i)
+    {
+      values[i] = this->m_Metric->GetValue(this->m_MultiStartParameters[i]);
+    }
+  }
+  catch (ExceptionObject & err)
+  {
+    if (useGridSampler)
+    {
+      this->m_Metric->SetImageSampler(optimizationSampler);
+    }
+    this->m_LastTransformParameters = this->m_MultiStartParameters[this->m_CurrentStart];
+    throw err;
+  }
+  if (useGridSampler)
+  {
+    this->m_Metric->SetImageSampler(optimizationSampler);
+  }
+
+  /** Sort the starts on their values, and keep the survivors after the first level. */
+  std::vector<SizeValueType> order(numberOfStarts);
+  for (SizeValueType i = 0; i < numberOfStarts; ++i)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&values](const SizeValueType a, const SizeValueType b) {
+    return values[a] < values[b];
+  });
+
+  const SizeValueType numberOfSurvivors =
+    firstLevel ? std::min<SizeValueType>(this->m_NumberOfSurvivingStarts, numberOfStarts) : numberOfStarts;
+  ParametersContainerType survivors(numberOfSurvivors);
+  this->m_MultiStartValues.resize(numberOfStarts);
+  for (SizeValueType i = 0; i < numberOfStarts; ++i)
+  {
+    this->m_MultiStartValues[i] = values[order[i]];
+    if (i < numberOfSurvivors)
+    {
+      survivors[i] = this->m_MultiStartParameters[order[i]];
+    }
+  }
+  this->m_MultiStartParameters.swap(survivors);
+
+  /** Continue with the best start. */
+  this->m_LastTransformParameters = this->m_MultiStartParameters[0];
+
+} // end OptimizeMultiStart()
+
+
 /*
  * PrintSelf
  */
@@ -376,7 +763,16 @@ MultiResolutionImageRegistrationMethod2<TFixedImage, TMovingImage>::PrintSelf(st
   os << indent << "InitialTransformParametersOfNextLevel: " << this->m_InitialTransformParametersOfNextLevel
      << std::endl;
   os << indent << "LastTransformParameters: " << this->m_LastTransformParameters << std::endl;
+  os << indent << "ResumeLevel: " << this->m_ResumeLevel << std::endl;
+  os << indent << "MultiStartParameterOffsets: " << this->m_MultiStartParameterOffsets.size() << std::endl;
+  os << indent << "NumberOfSurvivingStarts: " << this->m_NumberOfSurvivingStarts << std::endl;
   os << indent << "FixedImageRegion: " << this->m_FixedImageRegion << std::endl;
+  os << indent << "FixedImagePyramidInputRegion: " << this->m_FixedImagePyramidInputRegion << std::endl;
+  os << indent << "MovingImagePyramidInputRegion: " << this->m_MovingImagePyramidInputRegion << std::endl;
+  os << indent << "PyramidInputRegionMargin: " << this->m_PyramidInputRegionMargin << std::endl;
+  os << indent << "CropMovingImageToTransform: " << this->m_CropMovingImageToTransform << std::endl;
+  os << indent << "MovingImageRegionMargin: " << this->m_MovingImageRegionMargin << std::endl;
+  os << indent << "MovingImageRegionOfCurrentLevel: " << this->m_MovingImageRegionOfCurrentLevel << std::endl;
 
   for (unsigned int level = 0; level < this->m_FixedImageRegionPyramid.size(); ++level)
   {
@@ -31,7 +31,13 @@ namespace itk
  * No smoothing or any other operation is performed. This is useful for
  * example for registering binary images.
  *
- * \sa ShrinkImageFilter
+ * Optionally, each output voxel is the average of the input voxels that it
+ * covers, computed by a BinShrinkImageFilter. This box filter reduces the
+ * aliasing, at nearly the cost of the plain shrinking. The levels are then
+ * computed from fine to coarse, each from the next finer level, when its
+ * shrink factors divide those of the level.
+ *
+ * \sa ShrinkImageFilter, BinShrinkImageFilter
  *
  * \ingroup PyramidImageFilter Multithreaded Streamed
  */
@@ -64,6 +70,11 @@ public:
   typedef typename Superclass::OutputImagePointer     OutputImagePointer;
   typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
 
+  /** Set/Get whether the input voxels are averaged, instead of subsampled. Default false. */
+  itkSetMacro(UseBinAveraging, bool);
+  itkGetConstMacro(UseBinAveraging, bool);
+  itkBooleanMacro(UseBinAveraging);
+
   /** Overwrite the Superclass implementation: no padding required. */
   void
   GenerateInputRequestedRegion(void) override;
@@ -87,6 +98,12 @@ private:
   MultiResolutionShrinkPyramidImageFilter(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  /** Generate the output data by averaging. */
+  void
+  GenerateDataByBinAveraging(void);
+
+  bool m_UseBinAveraging{ false };
 };
 
 } // namespace itk
@@ -21,6 +21,7 @@
 #include "itkMultiResolutionShrinkPyramidImageFilter.h"
 
 #include "itkShrinkImageFilter.h"
+#include "itkBinShrinkImageFilter.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -33,6 +34,12 @@ template <class TInputImage, class TOutputImage>
 void
 MultiResolutionShrinkPyramidImageFilter<TInputImage, TOutputImage>::GenerateData(void)
 {
+  if (this->m_UseBinAveraging)
+  {
+    this->GenerateDataByBinAveraging();
+    return;
+  }
+
   /** Create the shrinking filter. */
   typedef ShrinkImageFilter<TInputImage, TOutputImage> ShrinkerType;
   typename ShrinkerType::Pointer                       shrinker = ShrinkerType::New();
@@ -65,6 +72,73 @@ MultiResolutionShrinkPyramidImageFilter<TInputImage, TOutputImage>::GenerateData
 } // end GenerateData()
 
 
+/*
+ * GenerateDataByBinAveraging
+ */
+template <class TInputImage, class TOutputImage>
+void
+MultiResolutionShrinkPyramidImageFilter<TInputImage, TOutputImage>::GenerateDataByBinAveraging(void)
+{
+  /** Create the averaging filters, from the input and from the next level. */
+  typedef BinShrinkImageFilter<TInputImage, TOutputImage>  InputShrinkerType;
+  typedef BinShrinkImageFilter<TOutputImage, TOutputImage> OutputShrinkerType;
+  typename InputShrinkerType::Pointer                      inputShrinker = InputShrinkerType::New();
+  typename OutputShrinkerType::Pointer                     outputShrinker = OutputShrinkerType::New();
+  inputShrinker->SetInput(this->GetInput());
+
+  /** Loop over all resolution levels, from fine to coarse. */
+  unsigned int factors[ImageDimension];
+  for (unsigned int i = 0; i < this->m_NumberOfLevels; ++i)
+  {
+    this->UpdateProgress(static_cast<float>(i) / static_cast<float>(this->m_NumberOfLevels));
+    const unsigned int ilevel = this->m_NumberOfLevels - 1 - i;
+
+    // Allocate memory for each output
+    OutputImagePointer outputPtr = this->GetOutput(ilevel);
+    outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+    outputPtr->Allocate();
+
+    // The average of the averages of the next level equals the average of
+    // the input, when the shrink factors of the next level divide these.
+    bool fromNextLevel = ilevel + 1 < this->m_NumberOfLevels;
+    for (unsigned int idim = 0; idim < ImageDimension; ++idim)
+    {
+      factors[idim] = this->m_Schedule[ilevel][idim];
+      if (fromNextLevel)
+      {
+        const unsigned int nextFactor = this->m_Schedule[ilevel + 1][idim];
+        fromNextLevel = nextFactor > 0 && factors[idim] % nextFactor == 0;
+      }
+    }
+
+    if (fromNextLevel)
+    {
+      // Average a copy of the next level, that is not connected to this filter.
+      const OutputImagePointer nextLevel = OutputImageType::New();
+      nextLevel->Graft(this->GetOutput(ilevel + 1));
+      for (unsigned int idim = 0; idim < ImageDimension; ++idim)
+      {
+        factors[idim] /= this->m_Schedule[ilevel + 1][idim];
+      }
+      outputShrinker->SetInput(nextLevel);
+      outputShrinker->SetShrinkFactors(factors);
+      outputShrinker->GraftOutput(outputPtr);
+      outputShrinker->Modified();
+      outputShrinker->UpdateLargestPossibleRegion();
+      this->GraftNthOutput(ilevel, outputShrinker->GetOutput());
+    }
+    else
+    {
+      inputShrinker->SetShrinkFactors(factors);
+      inputShrinker->GraftOutput(outputPtr);
+      inputShrinker->Modified();
+      inputShrinker->UpdateLargestPossibleRegion();
+      this->GraftNthOutput(ilevel, inputShrinker->GetOutput());
+    }
+  }
+} // end GenerateDataByBinAveraging()
+
+
 /**
  * GenerateInputRequestedRegion
  */
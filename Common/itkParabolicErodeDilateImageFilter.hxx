@@ -215,12 +215,12 @@ ParabolicErodeDilateImageFilter<TInputImage, doDilate, TOutputImage>::ThreadedGe
   }
   float progressPerDimension = 1.0 / ImageDimension;
 
-  ProgressReporter * progress = new ProgressReporter(this,
-                                                     threadId,
-                                                     NumberOfRows[m_CurrentDimension],
-                                                     30,
-                                                     m_CurrentDimension * progressPerDimension,
-                                                     progressPerDimension);
+  ProgressReporter progress(this,
+                            threadId,
+                            NumberOfRows[m_CurrentDimension],
+                            30,
+                            m_CurrentDimension * progressPerDimension,
+                            progressPerDimension);
 
   typedef ImageLinearConstIteratorWithIndex<TInputImage> InputConstIteratorType;
   typedef ImageLinearIteratorWithIndex<TOutputImage>     OutputIteratorType;
@@ -233,8 +233,7 @@ ParabolicErodeDilateImageFilter<TInputImage, doDilate, TOutputImage>::ThreadedGe
   typename TInputImage::ConstPointer inputImage(this->GetInput());
   typename TOutputImage::Pointer     outputImage(this->GetOutput());
 
-  outputImage->SetBufferedRegion(outputImage->GetRequestedRegion());
-  outputImage->Allocate();
+  /** The output is allocated once, by GenerateData(). */
   RegionType region = outputRegionForThread;
 
   InputConstIteratorType  inputIterator(inputImage, region);
@@ -264,7 +263,7 @@ ParabolicErodeDilateImageFilter<TInputImage, doDilate, TOutputImage>::ThreadedGe
       doOneDimension<InputConstIteratorType, OutputIteratorType, RealType, OutputPixelType, doDilate>(
         inputIterator,
         outputIterator,
-        *progress,
+        progress,
         LineLength,
         0,
         this->m_MagnitudeSign,
@@ -302,7 +301,7 @@ ParabolicErodeDilateImageFilter<TInputImage, doDilate, TOutputImage>::ThreadedGe
       doOneDimension<OutputConstIteratorType, OutputIteratorType, RealType, OutputPixelType, doDilate>(
         inputIteratorStage2,
         outputIterator,
-        *progress,
+        progress,
         LineLength,
         m_CurrentDimension,
         this->m_MagnitudeSign,
@@ -0,0 +1,254 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelEvaluationOptimizer.h"
+#include "itkThreadBudget.h"
+
+#include <algorithm> // For min and max.
+#include <limits>
+
+namespace itk
+{
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+void
+ParallelEvaluationOptimizer::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "UseMultiThread: " << this->m_UseMultiThread << std::endl;
+  os << indent << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+  os << indent << "WorkUnitCostFunctions: " << this->m_WorkUnitCostFunctions.size() << std::endl;
+  os << indent << "NumberOfCostFunctionEvaluations: " << this->m_NumberOfCostFunctionEvaluations << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** InitializeWorkUnitCostFunctions *********************
+ */
+
+void
+ParallelEvaluationOptimizer::InitializeWorkUnitCostFunctions(void)
+{
+  this->m_NumberOfCostFunctionEvaluations = 0;
+
+  /** Scale the cost functions of the work units like the cost function of the optimizer. */
+  this->m_WorkUnitScaledCostFunctions.clear();
+  for (const auto & costFunction : this->m_WorkUnitCostFunctions)
+  {
+    if (costFunction.IsNull())
+    {
+      itkExceptionMacro(<< "One of the WorkUnitCostFunctions is not set.");
+    }
+    ScaledCostFunctionPointer scaledCostFunction = ScaledCostFunctionType::New();
+    scaledCostFunction->SetUnscaledCostFunction(costFunction);
+    scaledCostFunction->SetSquaredScales(this->GetScales());
+    scaledCostFunction->SetUseScales(this->GetUseScales());
+    scaledCostFunction->SetNegateCostFunction(this->m_ScaledCostFunction->GetNegateCostFunction());
+    this->m_WorkUnitScaledCostFunctions.push_back(scaledCostFunction);
+  }
+
+} // end InitializeWorkUnitCostFunctions()
+
+
+/**
+ * ****************** GetNumberOfWorkUnits *********************
+ */
+
+ThreadIdType
+ParallelEvaluationOptimizer::GetNumberOfWorkUnits(const bool         useMultiThread,
+                                                  const ThreadIdType numberOfWorkUnits,
+                                                  const std::size_t  numberOfWorkUnitCostFunctions,
+                                                  const std::size_t  numberOfPositions)
+{
+  if (!useMultiThread)
+  {
+    return 1;
+  }
+
+  std::size_t result = numberOfWorkUnits > 0 ? numberOfWorkUnits : ThreadBudget::GetNumberOfThreads();
+  if (numberOfWorkUnitCostFunctions > 0)
+  {
+    result = std::min(result, numberOfWorkUnitCostFunctions);
+  }
+  result = std::min(result, numberOfPositions);
+  return static_cast<ThreadIdType>(std::max<std::size_t>(result, 1));
+
+} // end GetNumberOfWorkUnits()
+
+
+/**
+ * ****************** GetNumberOfConcurrentEvaluations *********************
+ */
+
+ThreadIdType
+ParallelEvaluationOptimizer::GetNumberOfConcurrentEvaluations(void) const
+{
+  return GetNumberOfWorkUnits(this->m_UseMultiThread,
+                              this->m_NumberOfWorkUnits,
+                              this->m_WorkUnitScaledCostFunctions.size(),
+                              std::numeric_limits<std::size_t>::max());
+
+} // end GetNumberOfConcurrentEvaluations()
+
+
+/**
+ * ****************** EvaluateScaledValues *********************
+ */
+
+void
+ParallelEvaluationOptimizer::EvaluateScaledValues(const std::vector<ParametersType> & positions,
+                                                  std::vector<MeasureType> &          values)
+{
+  const std::size_t numberOfPositions = positions.size();
+
+  /** Single-threadedly evaluate the positions, and stop at the first failure. */
+  if (this->GetNumberOfConcurrentEvaluations() < 2 || numberOfPositions < 2)
+  {
+    values.assign(numberOfPositions, 0.0);
+    this->m_NumberOfCostFunctionEvaluations += numberOfPositions;
+    for (std::size_t k = 0; k < numberOfPositions; ++k)
+    {
+      values[k] = this->GetScaledValue(positions[k]);
+    }
+    return;
+  }
+
+  /** Multi-threadedly evaluate the positions. */
+  std::vector<unsigned char>   failed;
+  std::vector<ExceptionObject> errors;
+  this->EvaluateScaledValues(positions, values, failed, errors);
+
+  for (std::size_t k = 0; k < numberOfPositions; ++k)
+  {
+    if (failed[k])
+    {
+      throw errors[k];
+    }
+  }
+
+} // end EvaluateScaledValues()
+
+
+/**
+ * ****************** EvaluateScaledValues *********************
+ */
+
+void
+ParallelEvaluationOptimizer::EvaluateScaledValues(const std::vector<ParametersType> & positions,
+                                                  std::vector<MeasureType> &          values,
+                                                  std::vector<unsigned char> &        failed,
+                                                  std::vector<ExceptionObject> &      errors)
+{
+  this->m_NumberOfCostFunctionEvaluations += positions.size();
+
+  /** Every work unit uses its own cost function, if there is one. */
+  const ThreadIdType numberOfWorkUnits = GetNumberOfWorkUnits(
+    this->m_UseMultiThread, this->m_NumberOfWorkUnits, this->m_WorkUnitScaledCostFunctions.size(), positions.size());
+  WorkUnitCostFunctionPointersType costFunctions(numberOfWorkUnits, this->m_ScaledCostFunction.GetPointer());
+  if (numberOfWorkUnits > 1 && !this->m_WorkUnitScaledCostFunctions.empty())
+  {
+    for (ThreadIdType t = 0; t < numberOfWorkUnits; ++t)
+    {
+      costFunctions[t] = this->m_WorkUnitScaledCostFunctions[t].GetPointer();
+    }
+    this->BeforeConcurrentEvaluation();
+  }
+
+  EvaluateValues(costFunctions, positions, values, failed, errors);
+
+} // end EvaluateScaledValues()
+
+
+/**
+ * ****************** EvaluateValues *********************
+ */
+
+void
+ParallelEvaluationOptimizer::EvaluateValues(const WorkUnitCostFunctionPointersType & costFunctions,
+                                            const std::vector<ParametersType> &      positions,
+                                            std::vector<MeasureType> &               values,
+                                            std::vector<unsigned char> &             failed,
+                                            std::vector<ExceptionObject> &           errors)
+{
+  const std::size_t numberOfPositions = positions.size();
+  values.assign(numberOfPositions, 0.0);
+  failed.assign(numberOfPositions, 0);
+  errors.assign(numberOfPositions, ExceptionObject());
+
+  MultiThreaderParameterType temp;
+  temp.st_CostFunctions = &costFunctions;
+  temp.st_Positions = &positions;
+  temp.st_Values = &values;
+  temp.st_Failed = &failed;
+  temp.st_Errors = &errors;
+
+  /** Single-threadedly evaluate the positions. */
+  if (costFunctions.size() < 2)
+  {
+    ThreadInfoType infoStruct;
+    infoStruct.WorkUnitID = 0;
+    infoStruct.NumberOfWorkUnits = 1;
+    infoStruct.UserData = &temp;
+    EvaluateThreaderCallback(&infoStruct);
+    return;
+  }
+
+  /** Multi-threadedly evaluate the positions. */
+  ParallelTasks::Execute(static_cast<ThreadIdType>(costFunctions.size()), EvaluateThreaderCallback, &temp);
+
+} // end EvaluateValues()
+
+
+/**
+ * ******************* EvaluateThreaderCallback ******************
+ */
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParallelEvaluationOptimizer::EvaluateThreaderCallback(void * arg)
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  const ThreadIdType           numberOfWorkUnits = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  /** Evaluate every numberOfWorkUnits'th position, with the cost function of this work unit. */
+  const CostFunctionType *            costFunction = (*temp->st_CostFunctions)[threadID];
+  const std::vector<ParametersType> & positions = *temp->st_Positions;
+  for (std::size_t k = threadID; k < positions.size(); k += numberOfWorkUnits)
+  {
+    try
+    {
+      (*temp->st_Values)[k] = costFunction->GetValue(positions[k]);
+    }
+    catch (ExceptionObject & err)
+    {
+      (*temp->st_Failed)[k] = 1;
+      (*temp->st_Errors)[k] = err;
+    }
+  }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluateThreaderCallback()
+
+} // end namespace itk
@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelEvaluationOptimizer_h
+#define itkParallelEvaluationOptimizer_h
+
+#include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkParallelTasks.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class ParallelEvaluationOptimizer
+ * \brief Base class of the optimizers that evaluate independent positions in batches.
+ *
+ * Derived optimizers collect positions that can be evaluated independently,
+ * such as the vertices of a simplex, or probes along a line, and pass them to
+ * EvaluateScaledValues(). With UseMultiThread, the positions of a batch are divided
+ * over the work units of ParallelTasks, which uses the global ITK thread pool.
+ *
+ * Every work unit evaluates its own cost function when the WorkUnitCostFunctions
+ * are set. These should be independent, re-entrant copies of the cost function of
+ * the optimizer; they are scaled like it. Without them, the work units share the
+ * cost function of the optimizer, which then must be safe to evaluate concurrently.
+ * Without UseMultiThread, the positions are evaluated one by one.
+ *
+ * The elastix components create the copies with elx::MetricBase::CreateWorkUnitCostFunction(),
+ * and only switch on UseMultiThread when the metric could be copied. The copies share
+ * the image sampler of the metric, which they update in BeforeConcurrentEvaluation().
+ *
+ * Optimizers that do not use the scaled cost function, like the FullSearchOptimizer,
+ * can use the static GetNumberOfWorkUnits() and EvaluateValues() directly.
+ *
+ * \ingroup Numerics Optimizers
+ */
+
+class ParallelEvaluationOptimizer : public ScaledSingleValuedNonLinearOptimizer
+{
+public:
+  /** Standard ITK.*/
+  typedef ParallelEvaluationOptimizer          Self;
+  typedef ScaledSingleValuedNonLinearOptimizer Superclass;
+  typedef SmartPointer<Self>                   Pointer;
+  typedef SmartPointer<const Self>             ConstPointer;
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelEvaluationOptimizer, ScaledSingleValuedNonLinearOptimizer);
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType               MeasureType;
+  typedef Superclass::ParametersType            ParametersType;
+  typedef Superclass::CostFunctionType          CostFunctionType;
+  typedef Superclass::ScaledCostFunctionType    ScaledCostFunctionType;
+  typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
+
+  /** Independent copies of the cost function, for the parallel evaluation. */
+  typedef std::vector<CostFunctionType::Pointer> CostFunctionContainerType;
+
+  /** The cost functions that are evaluated by the work units, one for each work unit. */
+  typedef std::vector<const CostFunctionType *> WorkUnitCostFunctionPointersType;
+
+  /** Setting: evaluate the positions of a batch in parallel. Default: false */
+  itkSetMacro(UseMultiThread, bool);
+  itkGetConstMacro(UseMultiThread, bool);
+
+  /** Setting: the number of work units of the parallel evaluation. If set to 0,
+   * the global default is used. Default: 0 */
+  itkSetMacro(NumberOfWorkUnits, ThreadIdType);
+  itkGetConstMacro(NumberOfWorkUnits, ThreadIdType);
+
+  /** Setting: independent copies of the cost function, one for each work unit
+   * of the parallel evaluation. Default: empty */
+  itkSetMacro(WorkUnitCostFunctions, CostFunctionContainerType);
+  itkGetConstReferenceMacro(WorkUnitCostFunctions, CostFunctionContainerType);
+
+  /** Get the number of cost function evaluations since the start of the optimization. */
+  itkGetConstMacro(NumberOfCostFunctionEvaluations, SizeValueType);
+
+  /** Get the number of work units that evaluate numberOfPositions positions. This is one
+   * without useMultiThread, and otherwise the numberOfWorkUnits, or the global default
+   * when it is 0, limited by the number of work unit cost functions, when there are any,
+   * and by the number of positions. */
+  static ThreadIdType
+  GetNumberOfWorkUnits(const bool         useMultiThread,
+                       const ThreadIdType numberOfWorkUnits,
+                       const std::size_t  numberOfWorkUnitCostFunctions,
+                       const std::size_t  numberOfPositions);
+
+  /** Evaluate the positions, with one work unit for each of the costFunctions; with only
+   * one cost function, the positions are evaluated one by one. All positions are evaluated.
+   * When the evaluation of position k fails, failed[k] is set, and errors[k] is its exception. */
+  static void
+  EvaluateValues(const WorkUnitCostFunctionPointersType & costFunctions,
+                 const std::vector<ParametersType> &      positions,
+                 std::vector<MeasureType> &               values,
+                 std::vector<unsigned char> &             failed,
+                 std::vector<ExceptionObject> &           errors);
+
+protected:
+  ParallelEvaluationOptimizer() = default;
+  ~ParallelEvaluationOptimizer() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Scale the cost functions of the work units like the cost function of the
+   * optimizer, and reset the number of evaluations. Call after InitializeScales(). */
+  virtual void
+  InitializeWorkUnitCostFunctions(void);
+
+  /** Called single-threaded before the work unit cost functions evaluate a batch
+   * concurrently, e.g. to update the resources that they share. Default: nothing. */
+  virtual void
+  BeforeConcurrentEvaluation(void)
+  {}
+
+  /** The number of positions that can be evaluated at the same time; one when
+   * the evaluation is not parallel. Derived classes use this to decide whether
+   * speculative evaluations are worthwhile. */
+  ThreadIdType
+  GetNumberOfConcurrentEvaluations(void) const;
+
+  /** Evaluate the scaled cost function at all positions. All positions are evaluated,
+   * also when some of them fail; the exception of the first failing position is then
+   * thrown. */
+  virtual void
+  EvaluateScaledValues(const std::vector<ParametersType> & positions, std::vector<MeasureType> & values);
+
+  /** Evaluate the scaled cost function at all positions, without throwing; see EvaluateValues(). */
+  virtual void
+  EvaluateScaledValues(const std::vector<ParametersType> & positions,
+                       std::vector<MeasureType> &          values,
+                       std::vector<unsigned char> &        failed,
+                       std::vector<ExceptionObject> &      errors);
+
+  SizeValueType m_NumberOfCostFunctionEvaluations{ 0 };
+
+private:
+  ParallelEvaluationOptimizer(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Typedefs for multi-threading. */
+  typedef ParallelTasks::WorkUnitInfoType ThreadInfoType;
+
+  /** The struct that is passed to the threads of the parallel evaluation. */
+  struct MultiThreaderParameterType
+  {
+    const WorkUnitCostFunctionPointersType * st_CostFunctions;
+    const std::vector<ParametersType> *      st_Positions;
+    std::vector<MeasureType> *               st_Values;
+    std::vector<unsigned char> *             st_Failed;
+    std::vector<ExceptionObject> *           st_Errors;
+  };
+
+  /** The callback function of the parallel evaluation. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  EvaluateThreaderCallback(void * arg);
+
+  bool                                   m_UseMultiThread{ false };
+  ThreadIdType                           m_NumberOfWorkUnits{ 0 };
+  CostFunctionContainerType              m_WorkUnitCostFunctions;
+  std::vector<ScaledCostFunctionPointer> m_WorkUnitScaledCostFunctions;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParallelEvaluationOptimizer_h
@@ -0,0 +1,186 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelJacobiEigenAnalysis.h"
+#include "itkParallelTasks.h"
+
+#include <algorithm> // For sort.
+#include <cmath>     // For abs and sqrt.
+#include <limits>
+#include <numeric> // For iota.
+#include <vector>
+
+namespace itk
+{
+
+constexpr unsigned int ParallelJacobiEigenAnalysis::MaximumNumberOfSweeps;
+
+/**
+ * ********************* ComputeEigenValuesAndVectors ****************************
+ */
+
+bool
+ParallelJacobiEigenAnalysis::ComputeEigenValuesAndVectors(const MatrixType & matrix,
+                                                          VectorType &       eigenValues,
+                                                          MatrixType &       eigenVectors,
+                                                          const ThreadIdType numberOfWorkUnits)
+{
+  const unsigned int n = matrix.rows();
+
+  /** Make the matrix symmetric from its upper triangle, and start with the identity. */
+  MatrixType a(n, n);
+  double     norm = 0.0;
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    for (unsigned int j = i; j < n; ++j)
+    {
+      a[i][j] = matrix[i][j];
+      a[j][i] = matrix[i][j];
+      norm += (i == j ? 1.0 : 2.0) * matrix[i][j] * matrix[i][j];
+    }
+  }
+  norm = std::sqrt(norm);
+  eigenVectors.set_size(n, n);
+  eigenVectors.set_identity();
+
+  /** The round-robin tournament: with an odd size, one index sits out each round. */
+  const unsigned int        numberOfPlayers = n + n % 2;
+  const unsigned int        numberOfPairs = numberOfPlayers / 2;
+  std::vector<unsigned int> players(numberOfPlayers);
+  std::vector<unsigned int> firsts(numberOfPairs);
+  std::vector<unsigned int> seconds(numberOfPairs);
+  std::vector<double>       cosines(numberOfPairs);
+  std::vector<double>       sines(numberOfPairs);
+
+  /** Rotate the rows of the pairs [begin, end). */
+  const ParallelTasks::RangeFunctionType rotateRows = [&](const SizeValueType begin, const SizeValueType end) {
+    for (SizeValueType k = begin; k < end; ++k)
+    {
+      if (sines[k] == 0.0)
+      {
+        continue;
+      }
+      const double   c = cosines[k];
+      const double   s = sines[k];
+      double * const rowP = a[firsts[k]];
+      double * const rowQ = a[seconds[k]];
+      for (unsigned int j = 0; j < n; ++j)
+      {
+        const double apj = rowP[j];
+        const double aqj = rowQ[j];
+        rowP[j] = c * apj - s * aqj;
+        rowQ[j] = s * apj + c * aqj;
+      }
+    }
+  };
+
+  /** Rotate the columns of the pairs [begin, end), of the matrix and of the eigenvectors. */
+  const ParallelTasks::RangeFunctionType rotateColumns = [&](const SizeValueType begin, const SizeValueType end) {
+    for (SizeValueType k = begin; k < end; ++k)
+    {
+      if (sines[k] == 0.0)
+      {
+        continue;
+      }
+      const double       c = cosines[k];
+      const double       s = sines[k];
+      const unsigned int p = firsts[k];
+      const unsigned int q = seconds[k];
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        const double aip = a[i][p];
+        const double aiq = a[i][q];
+        a[i][p] = c * aip - s * aiq;
+        a[i][q] = s * aip + c * aiq;
+
+        const double vip = eigenVectors[i][p];
+        const double viq = eigenVectors[i][q];
+        eigenVectors[i][p] = c * vip - s * viq;
+        eigenVectors[i][q] = s * vip + c * viq;
+      }
+      a[p][q] = 0.0;
+      a[q][p] = 0.0;
+    }
+  };
+
+  /** Sweep until no element is large enough to be rotated away. */
+  const double epsilon = std::numeric_limits<double>::epsilon();
+  bool         converged = (n < 2);
+  for (unsigned int sweep = 0; sweep < MaximumNumberOfSweeps && !converged; ++sweep)
+  {
+    converged = true;
+    for (unsigned int round = 0; round + 1 < numberOfPlayers; ++round)
+    {
+      /** Index 0 stays in place, the others rotate; pair k is the k-th from both ends. */
+      players[0] = 0;
+      for (unsigned int i = 1; i < numberOfPlayers; ++i)
+      {
+        players[i] = (round + i - 1) % (numberOfPlayers - 1) + 1;
+      }
+
+      /** Compute the rotations of the pairs, that annihilate their off-diagonal element. */
+      for (unsigned int k = 0; k < numberOfPairs; ++k)
+      {
+        const unsigned int p = std::min(players[k], players[numberOfPlayers - 1 - k]);
+        const unsigned int q = std::max(players[k], players[numberOfPlayers - 1 - k]);
+        firsts[k] = p;
+        seconds[k] = q;
+        cosines[k] = 1.0;
+        sines[k] = 0.0;
+        if (q >= n)
+        {
+          continue;
+        }
+
+        const double apq = a[p][q];
+        if (std::abs(apq) <= epsilon * std::sqrt(std::abs(a[p][p] * a[q][q])) ||
+            std::abs(apq) <= epsilon * epsilon * norm)
+        {
+          continue;
+        }
+        const double tau = (a[q][q] - a[p][p]) / (2.0 * apq);
+        const double sign = (tau >= 0.0) ? 1.0 : -1.0;
+        const double t = std::abs(tau) > 1e150 ? 0.5 / tau : sign / (std::abs(tau) + std::sqrt(1.0 + tau * tau));
+        cosines[k] = 1.0 / std::sqrt(1.0 + t * t);
+        sines[k] = t * cosines[k];
+        converged = false;
+      }
+
+      ParallelTasks::ParallelizeRange(0, numberOfPairs, rotateRows, numberOfWorkUnits);
+      ParallelTasks::ParallelizeRange(0, numberOfPairs, rotateColumns, numberOfWorkUnits);
+    }
+  }
+
+  /** Sort the eigenvalues in ascending order, with their eigenvectors. */
+  std::vector<unsigned int> order(n);
+  std::iota(order.begin(), order.end(), 0u);
+  std::sort(order.begin(), order.end(), [&a](const unsigned int i, const unsigned int j) {
+    return a[i][i] < a[j][j] || (a[i][i] == a[j][j] && i < j);
+  });
+  const MatrixType vectors = eigenVectors;
+  eigenValues.set_size(n);
+  for (unsigned int k = 0; k < n; ++k)
+  {
+    eigenValues[k] = a[order[k]][order[k]];
+    eigenVectors.set_column(k, vectors.get_column(order[k]));
+  }
+
+  return converged;
+
+} // end ComputeEigenValuesAndVectors()
+
+} // end namespace itk
@@ -0,0 +1,70 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelJacobiEigenAnalysis_h
+#define itkParallelJacobiEigenAnalysis_h
+
+#include "itkIntTypes.h"
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+
+namespace itk
+{
+/** \class ParallelJacobiEigenAnalysis
+ * \brief Computes the eigenvalues and eigenvectors of a symmetric matrix with the parallel
+ * cyclic Jacobi method.
+ *
+ * The Jacobi method annihilates the off-diagonal elements of the matrix by plane rotations,
+ * see Golub and Van Loan, "Matrix Computations", section 8.5. The rotations of disjoint
+ * pairs of rows and columns do not interact, so every sweep is ordered as a round-robin
+ * tournament of N-1 rounds, see section 8.5.4: each round rotates N/2 disjoint pairs at
+ * once. The rotations of a round are divided over the work units of ParallelTasks: first
+ * the rows of the pairs are rotated, then the columns. Every element is computed by the
+ * same operations, whatever the number of work units, so the result does not depend on it.
+ *
+ * The sweeps stop when the off-diagonal part of the matrix is negligible, relative to the
+ * whole matrix. The eigenvalues are sorted in ascending order, like by
+ * SymmetricEigenAnalysis, and the eigenvectors are the corresponding columns.
+ *
+ * \ingroup Numerics
+ */
+
+class ParallelJacobiEigenAnalysis
+{
+public:
+  typedef vnl_matrix<double> MatrixType;
+  typedef vnl_vector<double> VectorType;
+
+  /** Computes the eigenvalues and the eigenvectors, in the columns of eigenVectors, of
+   * the symmetric matrix. Only the upper triangle of the matrix is read. Zero work units
+   * means ParallelTasks::GetNumberOfWorkUnits(). Returns false when the method did not
+   * converge within MaximumNumberOfSweeps sweeps.
+   */
+  static bool
+  ComputeEigenValuesAndVectors(const MatrixType & matrix,
+                               VectorType &       eigenValues,
+                               MatrixType &       eigenVectors,
+                               const ThreadIdType numberOfWorkUnits = 0);
+
+  /** The maximum number of sweeps. The method converges quadratically, and usually
+   * needs less than ten sweeps. */
+  static constexpr unsigned int MaximumNumberOfSweeps = 50;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParallelJacobiEigenAnalysis_h
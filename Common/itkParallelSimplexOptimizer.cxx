@@ -0,0 +1,391 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelSimplexOptimizer.h"
+
+#include <algorithm> // For sort and max.
+#include <cmath>     // For abs.
+#include <numeric>   // For iota.
+
+namespace itk
+{
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+void
+ParallelSimplexOptimizer::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "CurrentIteration: " << this->m_CurrentIteration << std::endl;
+  os << indent << "CurrentValue: " << this->m_CurrentValue << std::endl;
+  os << indent << "StopCondition: " << this->m_StopCondition << std::endl;
+  os << indent << "CurrentStep: " << this->m_CurrentStep << std::endl;
+  os << indent << "CurrentSimplexSize: " << this->m_CurrentSimplexSize << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "PositionTolerance: " << this->m_PositionTolerance << std::endl;
+  os << indent << "InitialSimplexDelta: " << this->m_InitialSimplexDelta << std::endl;
+  os << indent << "AutomaticInitialSimplex: " << this->m_AutomaticInitialSimplex << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* StartOptimization *********************
+ */
+
+void
+ParallelSimplexOptimizer::StartOptimization(void)
+{
+  itkDebugMacro("StartOptimization");
+
+  /** Reset some variables. */
+  this->m_Stop = false;
+  this->m_StopCondition = Unknown;
+  this->m_CurrentIteration = 0;
+  this->m_CurrentStep = InitialSimplex;
+
+  /** Check the initial simplex. */
+  const unsigned int numberOfParameters = this->GetInitialPosition().GetSize();
+  if (!this->m_AutomaticInitialSimplex && this->m_InitialSimplexDelta.GetSize() != numberOfParameters)
+  {
+    itkExceptionMacro(<< "The size of the InitialSimplexDelta (" << this->m_InitialSimplexDelta.GetSize()
+                      << ") does not match the number of parameters (" << numberOfParameters << ").");
+  }
+
+  /** Initialize the scaledCostFunction with the currently set scales. */
+  this->InitializeScales();
+  this->InitializeWorkUnitCostFunctions();
+
+  /** Set the current position as the scaled initial position. */
+  this->SetCurrentPosition(this->GetInitialPosition());
+
+  this->InitializeSimplex();
+
+  if (!this->m_Stop)
+  {
+    this->ResumeOptimization();
+  }
+
+} // end StartOptimization()
+
+
+/**
+ * ******************* InitializeSimplex *********************
+ */
+
+void
+ParallelSimplexOptimizer::InitializeSimplex(void)
+{
+  const ParametersType & initialPosition = this->GetInitialPosition();
+  const unsigned int     numberOfParameters = initialPosition.GetSize();
+
+  /** The vertices are created in the unscaled parameter space, and then scaled. */
+  this->m_Vertices.assign(numberOfParameters + 1, initialPosition);
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    double delta = 0.0;
+    if (this->m_AutomaticInitialSimplex)
+    {
+      delta = initialPosition[i] != 0.0 ? 0.05 * initialPosition[i] : 0.00025;
+    }
+    else
+    {
+      delta = this->m_InitialSimplexDelta[i];
+    }
+    this->m_Vertices[i + 1][i] += delta;
+  }
+  for (ParametersType & vertex : this->m_Vertices)
+  {
+    this->m_ScaledCostFunction->ConvertUnscaledToScaledParameters(vertex);
+  }
+
+  /** The vertices are independent, so they are evaluated as one batch. */
+  this->EvaluatePositions(this->m_Vertices, this->m_VertexValues);
+  this->SortSimplex();
+
+} // end InitializeSimplex()
+
+
+/**
+ * ******************* ResumeOptimization *********************
+ */
+
+void
+ParallelSimplexOptimizer::ResumeOptimization(void)
+{
+  itkDebugMacro("ResumeOptimization");
+
+  this->m_Stop = false;
+  this->m_StopCondition = Unknown;
+
+  this->InvokeEvent(StartEvent());
+
+  while (!this->m_Stop)
+  {
+    /** Test for convergence: all vertices have almost the same value and position. */
+    double maximumValueDifference = 0.0;
+    for (const MeasureType value : this->m_VertexValues)
+    {
+      maximumValueDifference = std::max(maximumValueDifference, std::abs(value - this->m_VertexValues[0]));
+    }
+    if (maximumValueDifference <= this->m_ValueTolerance && this->m_CurrentSimplexSize <= this->m_PositionTolerance)
+    {
+      this->m_StopCondition = ValueAndPositionTolerance;
+      this->StopOptimization();
+      break;
+    }
+
+    this->AdvanceOneStep();
+    if (this->m_Stop)
+    {
+      break;
+    }
+
+    this->InvokeEvent(IterationEvent());
+    if (this->m_Stop)
+    {
+      break;
+    }
+
+    /** Next iteration. */
+    ++this->m_CurrentIteration;
+    if (this->m_CurrentIteration >= this->m_MaximumNumberOfIterations)
+    {
+      this->m_StopCondition = MaximumNumberOfIterations;
+      this->StopOptimization();
+      break;
+    }
+  }
+
+} // end ResumeOptimization()
+
+
+/**
+ * ******************* StopOptimization *********************
+ */
+
+void
+ParallelSimplexOptimizer::StopOptimization(void)
+{
+  itkDebugMacro("StopOptimization");
+
+  this->m_Stop = true;
+  this->InvokeEvent(EndEvent());
+
+} // end StopOptimization()
+
+
+/**
+ * ******************* AdvanceOneStep *********************
+ */
+
+void
+ParallelSimplexOptimizer::AdvanceOneStep(void)
+{
+  const unsigned int numberOfParameters = this->m_Vertices[0].GetSize();
+  const unsigned int worst = numberOfParameters;
+
+  /** The centroid of all vertices but the worst one. */
+  ParametersType centroid(numberOfParameters);
+  centroid.Fill(0.0);
+  for (unsigned int v = 0; v < worst; ++v)
+  {
+    centroid += this->m_Vertices[v];
+  }
+  centroid /= static_cast<double>(numberOfParameters);
+
+  /** The candidates (1 - t) c + t x_worst, for the reflection (t = -1), expansion (t = -2),
+   * outside contraction (t = -0.5) and inside contraction (t = 0.5), as in vnl_amoeba. */
+  const double coefficients[4] = { -1.0, -2.0, -0.5, 0.5 };
+  enum
+  {
+    R = 0,
+    E = 1,
+    OC = 2,
+    IC = 3
+  };
+  std::vector<ParametersType> candidates(4);
+  for (unsigned int k = 0; k < 4; ++k)
+  {
+    candidates[k].SetSize(numberOfParameters);
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      candidates[k][i] = (1.0 - coefficients[k]) * centroid[i] + coefficients[k] * this->m_Vertices[worst][i];
+    }
+  }
+
+  /** Evaluate all candidates at once, or one by one, when they are needed. */
+  const bool               speculative = this->GetNumberOfConcurrentEvaluations() > 1;
+  std::vector<MeasureType> candidateValues(4, NumericTraits<MeasureType>::max());
+  std::vector<MeasureType> values;
+  const auto               evaluateCandidate = [&](const unsigned int k) {
+    if (!speculative)
+    {
+      this->EvaluatePositions(std::vector<ParametersType>(1, candidates[k]), values);
+      candidateValues[k] = values[0];
+    }
+  };
+  if (speculative)
+  {
+    this->EvaluatePositions(candidates, candidateValues);
+  }
+  else
+  {
+    evaluateCandidate(R);
+  }
+  if (this->m_Stop)
+  {
+    return;
+  }
+
+  /** The Nelder-Mead decisions. */
+  const MeasureType fbest = this->m_VertexValues[0];
+  const MeasureType fsecondWorst = this->m_VertexValues[worst - 1];
+  const MeasureType fworst = this->m_VertexValues[worst];
+  const MeasureType fr = candidateValues[R];
+  int               accepted = -1;
+  if (fr < fbest)
+  {
+    evaluateCandidate(E);
+    accepted = candidateValues[E] < fr ? E : R;
+  }
+  else if (fr < fsecondWorst)
+  {
+    accepted = R;
+  }
+  else if (fr < fworst)
+  {
+    evaluateCandidate(OC);
+    accepted = candidateValues[OC] <= fr ? OC : -1;
+  }
+  else
+  {
+    evaluateCandidate(IC);
+    accepted = candidateValues[IC] < fworst ? IC : -1;
+  }
+  if (this->m_Stop)
+  {
+    return;
+  }
+
+  if (accepted >= 0)
+  {
+    const StepType steps[4] = { Reflection, Expansion, OutsideContraction, InsideContraction };
+    this->m_CurrentStep = steps[accepted];
+    this->m_Vertices[worst] = candidates[accepted];
+    this->m_VertexValues[worst] = candidateValues[accepted];
+  }
+  else
+  {
+    /** Shrink towards the best vertex; the new vertices are evaluated as one batch. */
+    this->m_CurrentStep = Shrink;
+    std::vector<ParametersType> shrunk(numberOfParameters);
+    for (unsigned int v = 1; v <= numberOfParameters; ++v)
+    {
+      shrunk[v - 1] = this->m_Vertices[v];
+      for (unsigned int i = 0; i < numberOfParameters; ++i)
+      {
+        shrunk[v - 1][i] = 0.5 * (this->m_Vertices[v][i] + this->m_Vertices[0][i]);
+      }
+    }
+    this->EvaluatePositions(shrunk, values);
+    if (this->m_Stop)
+    {
+      return;
+    }
+    for (unsigned int v = 1; v <= numberOfParameters; ++v)
+    {
+      this->m_Vertices[v] = shrunk[v - 1];
+      this->m_VertexValues[v] = values[v - 1];
+    }
+  }
+
+  this->SortSimplex();
+
+} // end AdvanceOneStep()
+
+
+/**
+ * ******************* SortSimplex *********************
+ */
+
+void
+ParallelSimplexOptimizer::SortSimplex(void)
+{
+  const std::size_t numberOfVertices = this->m_Vertices.size();
+
+  /** Sort stably, so that ties keep their order. */
+  std::vector<std::size_t> order(numberOfVertices);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](const std::size_t a, const std::size_t b) {
+    return this->m_VertexValues[a] < this->m_VertexValues[b];
+  });
+
+  std::vector<ParametersType> vertices(numberOfVertices);
+  std::vector<MeasureType>    values(numberOfVertices);
+  for (std::size_t v = 0; v < numberOfVertices; ++v)
+  {
+    vertices[v] = this->m_Vertices[order[v]];
+    values[v] = this->m_VertexValues[order[v]];
+  }
+  this->m_Vertices.swap(vertices);
+  this->m_VertexValues.swap(values);
+
+  /** The best vertex is the current position. */
+  this->SetScaledCurrentPosition(this->m_Vertices[0]);
+  this->m_CurrentValue = this->m_VertexValues[0];
+
+  /** The size of the simplex. */
+  this->m_CurrentSimplexSize = 0.0;
+  for (std::size_t v = 1; v < numberOfVertices; ++v)
+  {
+    for (unsigned int i = 0; i < this->m_Vertices[v].GetSize(); ++i)
+    {
+      this->m_CurrentSimplexSize =
+        std::max(this->m_CurrentSimplexSize, std::abs(this->m_Vertices[v][i] - this->m_Vertices[0][i]));
+    }
+  }
+
+} // end SortSimplex()
+
+
+/**
+ * ******************* EvaluatePositions *********************
+ */
+
+void
+ParallelSimplexOptimizer::EvaluatePositions(const std::vector<ParametersType> & positions,
+                                            std::vector<MeasureType> &          values)
+{
+  try
+  {
+    this->EvaluateScaledValues(positions, values);
+  }
+  catch (ExceptionObject & err)
+  {
+    this->m_StopCondition = MetricError;
+    this->StopOptimization();
+    throw err;
+  }
+
+} // end EvaluatePositions()
+
+} // end namespace itk
@@ -0,0 +1,188 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelSimplexOptimizer_h
+#define itkParallelSimplexOptimizer_h
+
+#include "itkParallelEvaluationOptimizer.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class ParallelSimplexOptimizer
+ * \brief A Nelder-Mead simplex optimizer that evaluates independent vertices in batches.
+ *
+ * The simplex of N+1 vertices is updated as in the well-known method of Nelder and
+ * Mead, see Lagarias et al., "Convergence properties of the Nelder-Mead simplex method
+ * in low dimensions", SIAM J. Optim. 9(1), 1998: the worst vertex is reflected through
+ * the centroid of the others, possibly followed by an expansion, an outside or an inside
+ * contraction, or the whole simplex is shrunk towards the best vertex.
+ *
+ * The new vertices are computed like in vnl_amoeba, so that with sequential evaluation
+ * this optimizer evaluates the same positions, in the same order, as vnl_amoeba.
+ *
+ * The N+1 vertices of the initial simplex, and the N new vertices of a shrink, are
+ * independent, and are evaluated as one batch, see ParallelEvaluationOptimizer. When at
+ * least two positions can be evaluated at the same time, the reflection, expansion and
+ * the two contractions of an iteration are evaluated speculatively in one batch, so that
+ * every iteration takes the time of a single evaluation. The decisions only depend on the
+ * values, so the speculative and the sequential evaluation give the same iterates.
+ *
+ * The optimization stops after MaximumNumberOfIterations iterations, or when both the
+ * values of all vertices differ less than ValueTolerance from the best value, and all
+ * vertices lie within PositionTolerance (in each parameter) from the best vertex.
+ *
+ * The initial simplex consists of the initial position and the N positions obtained by
+ * adding InitialSimplexDelta[i] to parameter i. With AutomaticInitialSimplex, 5% of the
+ * parameter is added instead, or 0.00025 when the parameter is zero.
+ *
+ * \ingroup Numerics Optimizers
+ * \sa ParallelSimplex
+ */
+
+class ParallelSimplexOptimizer : public ParallelEvaluationOptimizer
+{
+public:
+  /** Standard ITK.*/
+  typedef ParallelSimplexOptimizer    Self;
+  typedef ParallelEvaluationOptimizer Superclass;
+  typedef SmartPointer<Self>          Pointer;
+  typedef SmartPointer<const Self>    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelSimplexOptimizer, ParallelEvaluationOptimizer);
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType      MeasureType;
+  typedef Superclass::ParametersType   ParametersType;
+  typedef Superclass::CostFunctionType CostFunctionType;
+  typedef Superclass::ScalesType       ScalesType;
+
+  /** Codes of stopping conditions. */
+  typedef enum
+  {
+    MetricError,
+    MaximumNumberOfIterations,
+    ValueAndPositionTolerance,
+    Unknown
+  } StopConditionType;
+
+  /** The kind of update of the simplex in the last iteration. */
+  typedef enum
+  {
+    InitialSimplex,
+    Reflection,
+    Expansion,
+    OutsideContraction,
+    InsideContraction,
+    Shrink
+  } StepType;
+
+  void
+  StartOptimization(void) override;
+
+  virtual void
+  ResumeOptimization(void);
+
+  virtual void
+  StopOptimization(void);
+
+  /** Get information about the optimization process. */
+  itkGetConstMacro(CurrentIteration, unsigned long);
+  itkGetConstMacro(CurrentValue, MeasureType);
+  itkGetConstMacro(StopCondition, StopConditionType);
+  itkGetConstMacro(CurrentStep, StepType);
+
+  /** Get the largest distance, in any scaled parameter, of a vertex to the best vertex. */
+  itkGetConstMacro(CurrentSimplexSize, double);
+
+  /** Setting: the maximum number of iterations. Default: 500 */
+  itkSetClampMacro(MaximumNumberOfIterations, unsigned long, 1, NumericTraits<unsigned long>::max());
+  itkGetConstMacro(MaximumNumberOfIterations, unsigned long);
+
+  /** Setting: the value tolerance. Default: 1e-8 */
+  itkSetMacro(ValueTolerance, double);
+  itkGetConstMacro(ValueTolerance, double);
+
+  /** Setting: the position tolerance, in the scaled parameters. Default: 1e-8 */
+  itkSetMacro(PositionTolerance, double);
+  itkGetConstMacro(PositionTolerance, double);
+
+  /** Setting: the size of the initial simplex in each parameter. */
+  itkSetMacro(InitialSimplexDelta, ParametersType);
+  itkGetConstReferenceMacro(InitialSimplexDelta, ParametersType);
+
+  /** Setting: determine the initial simplex from the initial position. Default: false */
+  itkSetMacro(AutomaticInitialSimplex, bool);
+  itkGetConstMacro(AutomaticInitialSimplex, bool);
+  itkBooleanMacro(AutomaticInitialSimplex);
+
+protected:
+  ParallelSimplexOptimizer() = default;
+  ~ParallelSimplexOptimizer() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Create and evaluate the initial simplex. */
+  virtual void
+  InitializeSimplex(void);
+
+  /** Sort the vertices on their values, make the best one the current position,
+   * and compute the size of the simplex. */
+  void
+  SortSimplex(void);
+
+  /** Update the simplex once. */
+  virtual void
+  AdvanceOneStep(void);
+
+  /** Evaluate the positions, and stop the optimization in case of an error. */
+  void
+  EvaluatePositions(const std::vector<ParametersType> & positions, std::vector<MeasureType> & values);
+
+  /** The vertices, in the scaled parameter space, and their values. */
+  std::vector<ParametersType> m_Vertices;
+  std::vector<MeasureType>    m_VertexValues;
+
+  unsigned long     m_CurrentIteration{ 0 };
+  MeasureType       m_CurrentValue{ 0.0 };
+  StopConditionType m_StopCondition{ Unknown };
+  StepType          m_CurrentStep{ InitialSimplex };
+  double            m_CurrentSimplexSize{ 0.0 };
+  bool              m_Stop{ false };
+
+private:
+  ParallelSimplexOptimizer(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  unsigned long  m_MaximumNumberOfIterations{ 500 };
+  double         m_ValueTolerance{ 1e-8 };
+  double         m_PositionTolerance{ 1e-8 };
+  ParametersType m_InitialSimplexDelta;
+  bool           m_AutomaticInitialSimplex{ false };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParallelSimplexOptimizer_h
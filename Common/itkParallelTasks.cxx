@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelTasks.h"
+
+#include "itkPoolMultiThreader.h"
+#include "itkThreadBudget.h"
+
+#include <algorithm> // For min and max.
+
+namespace itk
+{
+
+namespace
+{
+/** Whether the current thread runs a work unit. */
+thread_local bool t_InsideWorkUnit = false;
+
+/** The callback and the user data of the work units, and the thread budget that they inherit. */
+struct TaskType
+{
+  ThreadFunctionType m_Callback;
+  void *             m_UserData;
+  ThreadIdType       m_NumberOfThreads;
+};
+
+/** Marks the current thread as running a work unit, for its lifetime. */
+class InsideWorkUnitGuard
+{
+public:
+  InsideWorkUnitGuard()
+    : m_WasInsideWorkUnit(t_InsideWorkUnit)
+  {
+    t_InsideWorkUnit = true;
+  }
+
+  ~InsideWorkUnitGuard() { t_InsideWorkUnit = this->m_WasInsideWorkUnit; }
+
+private:
+  const bool m_WasInsideWorkUnit;
+};
+
+/** Runs a work unit of a task, within the thread budget of the task. */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+WorkUnitCallback(void * arg)
+{
+  auto * const              info = static_cast<ParallelTasks::WorkUnitInfoType *>(arg);
+  const TaskType &          task = *static_cast<const TaskType *>(info->UserData);
+  const ThreadBudget        threadBudget(task.m_NumberOfThreads);
+  const InsideWorkUnitGuard insideWorkUnit;
+
+  info->UserData = task.m_UserData;
+  task.m_Callback(arg);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+/** The function and the range of ParallelizeRange(). */
+struct RangeTaskType
+{
+  const ParallelTasks::RangeFunctionType * m_Function;
+  SizeValueType                            m_Begin;
+  SizeValueType                            m_End;
+};
+
+/** Runs the function for the block of the range of a work unit. */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+RangeCallback(void * arg)
+{
+  const auto * const    info = static_cast<const ParallelTasks::WorkUnitInfoType *>(arg);
+  const RangeTaskType & task = *static_cast<const RangeTaskType *>(info->UserData);
+  const SizeValueType   size = task.m_End - task.m_Begin;
+  const SizeValueType   first = task.m_Begin + size * info->WorkUnitID / info->NumberOfWorkUnits;
+  const SizeValueType   last = task.m_Begin + size * (info->WorkUnitID + 1) / info->NumberOfWorkUnits;
+
+  if (first < last)
+  {
+    (*task.m_Function)(first, last);
+  }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+} // namespace
+
+
+/**
+ * ********************* GetNumberOfWorkUnits ****************************
+ */
+
+ThreadIdType
+ParallelTasks::GetNumberOfWorkUnits(void)
+{
+  return ThreadBudget::GetNumberOfThreads();
+
+} // end GetNumberOfWorkUnits()
+
+
+/**
+ * ********************* IsInsideWorkUnit ****************************
+ */
+
+bool
+ParallelTasks::IsInsideWorkUnit(void)
+{
+  return t_InsideWorkUnit;
+
+} // end IsInsideWorkUnit()
+
+
+/**
+ * ********************* Execute ****************************
+ */
+
+void
+ParallelTasks::Execute(const ThreadIdType numberOfWorkUnits, ThreadFunctionType callback, void * userData)
+{
+  /** Nested work units, and a single one, run in the calling thread. Waiting for the
+   * pool from within a work unit could also block the pool threads that it waits for.
+   */
+  if (numberOfWorkUnits < 2 || t_InsideWorkUnit)
+  {
+    WorkUnitInfoType info;
+    info.NumberOfWorkUnits = std::max<ThreadIdType>(numberOfWorkUnits, 1);
+    info.ThreadFunction = callback;
+    for (ThreadIdType workUnit = 0; workUnit < info.NumberOfWorkUnits; ++workUnit)
+    {
+      info.WorkUnitID = workUnit;
+      info.UserData = userData;
+      callback(&info);
+    }
+    return;
+  }
+
+  TaskType task;
+  task.m_Callback = callback;
+  task.m_UserData = userData;
+  task.m_NumberOfThreads = ThreadBudget::GetNumberOfThreads();
+
+  const PoolMultiThreader::Pointer threader = PoolMultiThreader::New();
+  threader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  threader->SetSingleMethod(WorkUnitCallback, &task);
+  threader->SingleMethodExecute();
+
+} // end Execute()
+
+
+/**
+ * ********************* ParallelizeRange ****************************
+ */
+
+void
+ParallelTasks::ParallelizeRange(const SizeValueType       begin,
+                                const SizeValueType       end,
+                                const RangeFunctionType & function,
+                                const ThreadIdType        numberOfWorkUnits)
+{
+  if (begin >= end)
+  {
+    return;
+  }
+
+  RangeTaskType task;
+  task.m_Function = &function;
+  task.m_Begin = begin;
+  task.m_End = end;
+
+  const ThreadIdType requestedNumberOfWorkUnits =
+    numberOfWorkUnits > 0 ? numberOfWorkUnits : ParallelTasks::GetNumberOfWorkUnits();
+  ParallelTasks::Execute(static_cast<ThreadIdType>(std::min<SizeValueType>(requestedNumberOfWorkUnits, end - begin)),
+                         RangeCallback,
+                         &task);
+
+} // end ParallelizeRange()
+
+
+/**
+ * ********************* ParallelizeArray ****************************
+ */
+
+void
+ParallelTasks::ParallelizeArray(const SizeValueType       begin,
+                                const SizeValueType       end,
+                                const ArrayFunctionType & function,
+                                const ThreadIdType        numberOfWorkUnits)
+{
+  ParallelTasks::ParallelizeRange(
+    begin,
+    end,
+    [&function](const SizeValueType first, const SizeValueType last) {
+      for (SizeValueType i = first; i < last; ++i)
+      {
+        function(i);
+      }
+    },
+    numberOfWorkUnits);
+
+} // end ParallelizeArray()
+
+} // end namespace itk
@@ -0,0 +1,88 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelTasks_h
+#define itkParallelTasks_h
+
+#include "itkMultiThreaderBase.h"
+
+#include <functional>
+
+namespace itk
+{
+/** \class ParallelTasks
+ * \brief The task-parallel runtime of elastix.
+ *
+ * The multi-threaded computations of elastix run their work units by this class, instead
+ * of by threaders of their own or by OpenMP. The work units are executed by the process-wide
+ * ITK thread pool, which the ITK filters share, so that several pools do not compete for
+ * the cores. By default, the number of work units is the thread budget of the calling
+ * thread, see ThreadBudget. The work units inherit this budget, so that the ITK filters that
+ * they run keep to the budget of the registration. A computation that is started from
+ * within a work unit runs its work units one after the other, in the same thread, as all
+ * threads of the budget are already busy.
+ *
+ * \ingroup Common
+ */
+
+class ParallelTasks
+{
+public:
+  /** The struct that is passed to the callback of each work unit, as by the ITK threaders. */
+  typedef MultiThreaderBase::WorkUnitInfo WorkUnitInfoType;
+
+  /** The function that processes the elements [first, last) of a range. */
+  typedef std::function<void(SizeValueType, SizeValueType)> RangeFunctionType;
+
+  /** The function that processes a single element of an array. */
+  typedef std::function<void(SizeValueType)> ArrayFunctionType;
+
+  /** Returns the default number of work units: the thread budget of the calling thread. */
+  static ThreadIdType
+  GetNumberOfWorkUnits(void);
+
+  /** Returns whether the calling thread runs a work unit. */
+  static bool
+  IsInsideWorkUnit(void);
+
+  /** Runs the callback for each of the work units, with a WorkUnitInfoType argument of
+   * which the UserData is userData, and waits for all of them. The calling thread runs
+   * work unit 0.
+   */
+  static void
+  Execute(const ThreadIdType numberOfWorkUnits, ThreadFunctionType callback, void * userData);
+
+  /** Divides [begin, end) into contiguous blocks, one per work unit, and runs the function
+   * for each block. Zero work units means GetNumberOfWorkUnits().
+   */
+  static void
+  ParallelizeRange(const SizeValueType       begin,
+                   const SizeValueType       end,
+                   const RangeFunctionType & function,
+                   const ThreadIdType        numberOfWorkUnits = 0);
+
+  /** Runs the function for each element of [begin, end), like MultiThreaderBase::ParallelizeArray(). */
+  static void
+  ParallelizeArray(const SizeValueType       begin,
+                   const SizeValueType       end,
+                   const ArrayFunctionType & function,
+                   const ThreadIdType        numberOfWorkUnits = 0);
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParallelTasks_h
@@ -0,0 +1,491 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParameterUpdateKernel.h"
+#include "itkThreadBudget.h"
+
+#include <algorithm> // For min and max.
+#include <cmath>     // For sqrt.
+#include <numeric>   // For accumulate.
+#include <vector>
+
+namespace itk
+{
+
+namespace
+{
+
+/** The preconditioners that are supported by the update loop. */
+enum PreconditionerKindType
+{
+  NoPreconditioner,
+  DiagonalPreconditioner,
+  AdaGradPreconditioner
+};
+
+/** The control variates that are supported by the update loop. */
+enum ControlVariateKindType
+{
+  NoControlVariate,
+  DoubleControlVariate,
+  FloatControlVariate
+};
+
+/**
+ * ****************** UpdateLoop ************************
+ *
+ * The options are template arguments, so that every combination
+ * results in a loop without branches.
+ */
+
+template <PreconditionerKindType VPreconditioner,
+          ControlVariateKindType VControlVariate,
+          bool                   VStoreSearchDirection,
+          bool                   VUseBounds>
+void
+UpdateLoop(const ParameterUpdateKernel::ArgumentsType & arguments, const SizeValueType begin, const SizeValueType end)
+{
+  typedef ParameterUpdateKernel::ValueType ValueType;
+
+  const ValueType         stepSize = arguments.m_StepSize;
+  const ValueType         epsilon = arguments.m_Epsilon;
+  const ValueType * const gradient = arguments.m_Gradient;
+  const ValueType * const preconditioner = arguments.m_Preconditioner;
+  const ValueType * const lowerBounds = arguments.m_LowerBounds;
+  const ValueType * const upperBounds = arguments.m_UpperBounds;
+  const ValueType * const snapshotStochasticGradient = arguments.m_SnapshotStochasticGradient;
+  const ValueType         controlVariateFactor = arguments.m_ControlVariateFactor;
+  const ValueType * const snapshotGradient = arguments.m_SnapshotGradient;
+  const float * const     floatSnapshotGradient = arguments.m_FloatSnapshotGradient;
+  ValueType * const       squaredGradientSum = arguments.m_SquaredGradientSum;
+  ValueType * const       searchDirection = arguments.m_SearchDirection;
+  ValueType * const       position = arguments.m_Position;
+
+  for (SizeValueType j = begin; j < end; ++j)
+  {
+    ValueType direction = gradient[j];
+    if (VControlVariate == DoubleControlVariate)
+    {
+      direction = controlVariateFactor * (direction - snapshotStochasticGradient[j]) + snapshotGradient[j];
+    }
+    else if (VControlVariate == FloatControlVariate)
+    {
+      direction = controlVariateFactor * (direction - snapshotStochasticGradient[j]) +
+                  static_cast<ValueType>(floatSnapshotGradient[j]);
+    }
+
+    if (VPreconditioner == DiagonalPreconditioner)
+    {
+      direction *= preconditioner[j];
+    }
+    else if (VPreconditioner == AdaGradPreconditioner)
+    {
+      const ValueType sum = squaredGradientSum[j] + direction * direction;
+      squaredGradientSum[j] = sum;
+      direction /= std::sqrt(sum + epsilon);
+    }
+
+    if (VStoreSearchDirection)
+    {
+      searchDirection[j] = direction;
+    }
+
+    ValueType newPosition = position[j] - stepSize * direction;
+    if (VUseBounds)
+    {
+      newPosition = std::min(std::max(newPosition, lowerBounds[j]), upperBounds[j]);
+    }
+    position[j] = newPosition;
+  }
+
+} // end UpdateLoop()
+
+
+/**
+ * ****************** UpdateLoopWithControlVariate ************************
+ */
+
+template <PreconditionerKindType VPreconditioner, ControlVariateKindType VControlVariate>
+void
+UpdateLoopWithControlVariate(const ParameterUpdateKernel::ArgumentsType & arguments,
+                             const SizeValueType                          begin,
+                             const SizeValueType                          end)
+{
+  const bool storeSearchDirection = arguments.m_SearchDirection != nullptr;
+  const bool useBounds = arguments.m_LowerBounds != nullptr && arguments.m_UpperBounds != nullptr;
+
+  if (storeSearchDirection)
+  {
+    if (useBounds)
+    {
+      UpdateLoop<VPreconditioner, VControlVariate, true, true>(arguments, begin, end);
+    }
+    else
+    {
+      UpdateLoop<VPreconditioner, VControlVariate, true, false>(arguments, begin, end);
+    }
+  }
+  else
+  {
+    if (useBounds)
+    {
+      UpdateLoop<VPreconditioner, VControlVariate, false, true>(arguments, begin, end);
+    }
+    else
+    {
+      UpdateLoop<VPreconditioner, VControlVariate, false, false>(arguments, begin, end);
+    }
+  }
+
+} // end UpdateLoopWithControlVariate()
+
+
+/**
+ * ****************** UpdateLoopWithPreconditioner ************************
+ */
+
+template <PreconditionerKindType VPreconditioner>
+void
+UpdateLoopWithPreconditioner(const ParameterUpdateKernel::ArgumentsType & arguments,
+                             const SizeValueType                          begin,
+                             const SizeValueType                          end)
+{
+  if (arguments.m_SnapshotStochasticGradient == nullptr)
+  {
+    UpdateLoopWithControlVariate<VPreconditioner, NoControlVariate>(arguments, begin, end);
+  }
+  else if (arguments.m_FloatSnapshotGradient != nullptr)
+  {
+    UpdateLoopWithControlVariate<VPreconditioner, FloatControlVariate>(arguments, begin, end);
+  }
+  else
+  {
+    UpdateLoopWithControlVariate<VPreconditioner, DoubleControlVariate>(arguments, begin, end);
+  }
+
+} // end UpdateLoopWithPreconditioner()
+
+} // end namespace
+
+
+/**
+ * ****************** PrintSelf ************************
+ */
+
+void
+ParameterUpdateKernel::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+  os << indent << "MinimumNumberOfParametersPerWorkUnit: " << this->m_MinimumNumberOfParametersPerWorkUnit
+     << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** Update ************************
+ */
+
+void
+ParameterUpdateKernel::Update(const ArgumentsType & arguments) const
+{
+  const SizeValueType numberOfParameters = arguments.m_NumberOfParameters;
+  if (numberOfParameters == 0)
+  {
+    return;
+  }
+
+  /** Update small problems in the calling thread. */
+  const ThreadIdType numberOfWorkUnits = this->ComputeNumberOfWorkUnits(numberOfParameters);
+  if (numberOfWorkUnits < 2)
+  {
+    UpdateRange(arguments, 0, numberOfParameters);
+    return;
+  }
+
+  const RangeFunctionType function = [&arguments](SizeValueType begin, SizeValueType end, ThreadIdType) {
+    UpdateRange(arguments, begin, end);
+  };
+  this->ParallelizeRange(numberOfParameters, numberOfWorkUnits, function);
+
+} // end Update()
+
+
+/**
+ * ****************** Update ************************
+ */
+
+void
+ParameterUpdateKernel::Update(const double stepSize, const DerivativeType & gradient, ParametersType & position) const
+{
+  ArgumentsType arguments;
+  arguments.m_NumberOfParameters = position.GetSize();
+  arguments.m_StepSize = stepSize;
+  arguments.m_Gradient = gradient.data_block();
+  arguments.m_Position = position.data_block();
+
+  this->Update(arguments);
+
+} // end Update()
+
+
+/**
+ * ****************** Update ************************
+ */
+
+void
+ParameterUpdateKernel::Update(const double           stepSize,
+                              const DerivativeType & gradient,
+                              const ParametersType & preconditioner,
+                              DerivativeType &       searchDirection,
+                              ParametersType &       position) const
+{
+  ArgumentsType arguments;
+  arguments.m_NumberOfParameters = position.GetSize();
+  arguments.m_StepSize = stepSize;
+  arguments.m_Gradient = gradient.data_block();
+  arguments.m_Position = position.data_block();
+  arguments.m_Preconditioner = preconditioner.data_block();
+  arguments.m_SearchDirection = searchDirection.data_block();
+
+  this->Update(arguments);
+
+} // end Update()
+
+
+/**
+ * ****************** InnerProduct ************************
+ */
+
+ParameterUpdateKernel::ValueType
+ParameterUpdateKernel::InnerProduct(const SizeValueType numberOfParameters,
+                                    const ValueType *   a,
+                                    const ValueType *   b) const
+{
+  const auto innerProductLoop = [a, b](const SizeValueType begin, const SizeValueType end) {
+    ValueType sum = 0.0;
+    for (SizeValueType j = begin; j < end; ++j)
+    {
+      sum += a[j] * b[j];
+    }
+    return sum;
+  };
+
+  const ThreadIdType numberOfWorkUnits = this->ComputeNumberOfWorkUnits(numberOfParameters);
+  if (numberOfWorkUnits < 2)
+  {
+    return innerProductLoop(0, numberOfParameters);
+  }
+
+  /** Add the partial sums in the order of the work units. */
+  std::vector<ValueType>  partialSums(numberOfWorkUnits, 0.0);
+  const RangeFunctionType function = [&](SizeValueType begin, SizeValueType end, ThreadIdType workUnit) {
+    partialSums[workUnit] = innerProductLoop(begin, end);
+  };
+  this->ParallelizeRange(numberOfParameters, numberOfWorkUnits, function);
+
+  return std::accumulate(partialSums.begin(), partialSums.end(), ValueType{ 0.0 });
+
+} // end InnerProduct()
+
+
+/**
+ * ****************** ComputeConjugateGradientInnerProducts ************************
+ */
+
+ParameterUpdateKernel::ConjugateGradientInnerProductsType
+ParameterUpdateKernel::ComputeConjugateGradientInnerProducts(const SizeValueType numberOfParameters,
+                                                             const ValueType *   gradient,
+                                                             const ValueType *   previousGradient,
+                                                             const ValueType *   previousSearchDirection) const
+{
+  const auto innerProductsLoop = [gradient, previousGradient, previousSearchDirection](const SizeValueType begin,
+                                                                                       const SizeValueType end) {
+    ConjugateGradientInnerProductsType products;
+    for (SizeValueType j = begin; j < end; ++j)
+    {
+      const ValueType g = gradient[j];
+      const ValueType h = previousGradient[j];
+      const ValueType change = g - h;
+      products.m_GradientGradient += g * g;
+      products.m_PreviousGradientPreviousGradient += h * h;
+      products.m_GradientGradientChange += g * change;
+      products.m_SearchDirectionGradientChange += previousSearchDirection[j] * change;
+    }
+    return products;
+  };
+
+  const ThreadIdType numberOfWorkUnits = this->ComputeNumberOfWorkUnits(numberOfParameters);
+  if (numberOfWorkUnits < 2)
+  {
+    return innerProductsLoop(0, numberOfParameters);
+  }
+
+  std::vector<ConjugateGradientInnerProductsType> partialProducts(numberOfWorkUnits);
+  const RangeFunctionType function = [&](SizeValueType begin, SizeValueType end, ThreadIdType workUnit) {
+    partialProducts[workUnit] = innerProductsLoop(begin, end);
+  };
+  this->ParallelizeRange(numberOfParameters, numberOfWorkUnits, function);
+
+  /** Add the partial sums in the order of the work units. */
+  ConjugateGradientInnerProductsType products;
+  for (const ConjugateGradientInnerProductsType & partial : partialProducts)
+  {
+    products.m_GradientGradient += partial.m_GradientGradient;
+    products.m_PreviousGradientPreviousGradient += partial.m_PreviousGradientPreviousGradient;
+    products.m_GradientGradientChange += partial.m_GradientGradientChange;
+    products.m_SearchDirectionGradientChange += partial.m_SearchDirectionGradientChange;
+  }
+  return products;
+
+} // end ComputeConjugateGradientInnerProducts()
+
+
+/**
+ * ****************** UpdateSearchDirection ************************
+ */
+
+void
+ParameterUpdateKernel::UpdateSearchDirection(const SizeValueType numberOfParameters,
+                                             const ValueType     beta,
+                                             const ValueType *   gradient,
+                                             ValueType *         searchDirection) const
+{
+  const RangeFunctionType function = [beta, gradient, searchDirection](
+                                       SizeValueType begin, SizeValueType end, ThreadIdType) {
+    if (beta == 0.0)
+    {
+      for (SizeValueType j = begin; j < end; ++j)
+      {
+        searchDirection[j] = -gradient[j];
+      }
+    }
+    else
+    {
+      for (SizeValueType j = begin; j < end; ++j)
+      {
+        searchDirection[j] = beta * searchDirection[j] - gradient[j];
+      }
+    }
+  };
+
+  const ThreadIdType numberOfWorkUnits = this->ComputeNumberOfWorkUnits(numberOfParameters);
+  if (numberOfWorkUnits < 2)
+  {
+    function(0, numberOfParameters, 0);
+    return;
+  }
+  this->ParallelizeRange(numberOfParameters, numberOfWorkUnits, function);
+
+} // end UpdateSearchDirection()
+
+
+/**
+ * ****************** ComputeNumberOfWorkUnits ************************
+ */
+
+ThreadIdType
+ParameterUpdateKernel::ComputeNumberOfWorkUnits(const SizeValueType numberOfParameters) const
+{
+  /** Determine the number of work units, such that every work unit
+   * updates at least the minimum number of parameters.
+   */
+  ThreadIdType numberOfWorkUnits = this->m_NumberOfWorkUnits;
+  if (numberOfWorkUnits == 0)
+  {
+    numberOfWorkUnits = ThreadBudget::GetNumberOfThreads();
+  }
+  const SizeValueType minimumPerWorkUnit = std::max<SizeValueType>(this->m_MinimumNumberOfParametersPerWorkUnit, 1);
+  return static_cast<ThreadIdType>(std::min<SizeValueType>(numberOfWorkUnits, numberOfParameters / minimumPerWorkUnit));
+
+} // end ComputeNumberOfWorkUnits()
+
+
+/**
+ * ****************** ParallelizeRange ************************
+ */
+
+void
+ParameterUpdateKernel::ParallelizeRange(const SizeValueType       numberOfParameters,
+                                        const ThreadIdType        numberOfWorkUnits,
+                                        const RangeFunctionType & function) const
+{
+  /** Divide the parameters in contiguous chunks; a multiple of eight keeps
+   * the chunks aligned with the vector registers.
+   */
+  SizeValueType chunkSize = (numberOfParameters + numberOfWorkUnits - 1) / numberOfWorkUnits;
+  chunkSize = ((chunkSize + 7) / 8) * 8;
+
+  MultiThreaderParameterType userData;
+  userData.st_Function = &function;
+  userData.st_NumberOfParameters = numberOfParameters;
+  userData.st_ChunkSize = chunkSize;
+
+  ParallelTasks::Execute(numberOfWorkUnits, UpdateThreaderCallback, &userData);
+
+} // end ParallelizeRange()
+
+
+/**
+ * ****************** UpdateThreaderCallback ************************
+ */
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParameterUpdateKernel::UpdateThreaderCallback(void * arg)
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  /** Compute the range of this thread. */
+  const SizeValueType numberOfParameters = temp->st_NumberOfParameters;
+  const SizeValueType begin = std::min<SizeValueType>(threadID * temp->st_ChunkSize, numberOfParameters);
+  const SizeValueType end = std::min<SizeValueType>(begin + temp->st_ChunkSize, numberOfParameters);
+
+  (*temp->st_Function)(begin, end, threadID);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end UpdateThreaderCallback()
+
+
+/**
+ * ****************** UpdateRange ************************
+ */
+
+void
+ParameterUpdateKernel::UpdateRange(const ArgumentsType & arguments, const SizeValueType begin, const SizeValueType end)
+{
+  if (arguments.m_SquaredGradientSum != nullptr)
+  {
+    UpdateLoopWithPreconditioner<AdaGradPreconditioner>(arguments, begin, end);
+  }
+  else if (arguments.m_Preconditioner != nullptr)
+  {
+    UpdateLoopWithPreconditioner<DiagonalPreconditioner>(arguments, begin, end);
+  }
+  else
+  {
+    UpdateLoopWithPreconditioner<NoPreconditioner>(arguments, begin, end);
+  }
+
+} // end UpdateRange()
+
+} // end namespace itk
@@ -0,0 +1,227 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParameterUpdateKernel_h
+#define itkParameterUpdateKernel_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkOptimizerParameters.h"
+#include "itkArray.h"
+#include "itkParallelTasks.h"
+
+#include <functional>
+
+namespace itk
+{
+/** \class ParameterUpdateKernel
+ * \brief Performs the parameter update of a gradient descent step in one pass.
+ *
+ * The kernel updates the (scaled) position in place:
+ *
+ *   \f[ d_j = p_j g_j, \qquad x_j \leftarrow \min(u_j, \max(l_j, x_j - a d_j)) \f]
+ *
+ * where \f$a\f$ is the step size, \f$g\f$ the gradient and \f$p\f$ an optional
+ * diagonal preconditioner. Instead of a fixed preconditioner, the AdaGrad
+ * preconditioner \f$p_j = 1 / \sqrt{s_j + \epsilon}\f$ may be used, where the
+ * sum of squared gradients \f$s_j\f$ is updated in the same pass. The search
+ * direction \f$d\f$ is only stored when asked for, and the bounds \f$l\f$ and
+ * \f$u\f$ are optional as well.
+ *
+ * For the variance reduced gradient methods, the gradient may be replaced by the
+ * control variate \f$ c (g_j - h_j) + m_j \f$ in the same pass, where \f$h\f$ is the
+ * stochastic gradient at the snapshot position and \f$m\f$ the snapshot gradient,
+ * which may be stored in single precision.
+ *
+ * Every combination of the options is handled by its own loop without branches,
+ * so that it can be vectorised by the compiler. For large numbers of parameters
+ * the update is divided over the work units of ParallelTasks, which in
+ * turn uses the global ITK thread pool. Small problems are updated by the calling
+ * thread, since the overhead of the threads would then dominate.
+ *
+ * The kernel also offers the vector operations of the conjugate gradient
+ * methods: the inner products that are needed by the definitions of \f$\beta\f$,
+ * computed in a single pass, and the update of the search direction
+ * \f$ d \leftarrow -g + \beta d \f$. The partial sums of the work units are added
+ * in a fixed order, so the result only depends on the number of work units.
+ *
+ * \ingroup Numerics Optimizers
+ */
+
+class ParameterUpdateKernel : public Object
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef ParameterUpdateKernel    Self;
+  typedef Object                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParameterUpdateKernel, Object);
+
+  /** Typedefs of the optimizer arrays. */
+  typedef double                         ValueType;
+  typedef OptimizerParameters<ValueType> ParametersType;
+  typedef Array<ValueType>               DerivativeType;
+
+  /** The arguments of a single update. Only the position and the gradient
+   * are required; the other arrays are skipped when they are null.
+   */
+  struct ArgumentsType
+  {
+    SizeValueType     m_NumberOfParameters{ 0 };
+    ValueType         m_StepSize{ 0.0 };
+    const ValueType * m_Gradient{ nullptr };
+    ValueType *       m_Position{ nullptr };
+
+    /** A fixed diagonal preconditioner. */
+    const ValueType * m_Preconditioner{ nullptr };
+
+    /** The AdaGrad sum of squared gradients, used instead of a fixed preconditioner. */
+    ValueType * m_SquaredGradientSum{ nullptr };
+    ValueType   m_Epsilon{ 0.0 };
+
+    /** Receives the (preconditioned) search direction. It may be the gradient itself. */
+    ValueType * m_SearchDirection{ nullptr };
+
+    /** The lower and upper bound of every parameter. */
+    const ValueType * m_LowerBounds{ nullptr };
+    const ValueType * m_UpperBounds{ nullptr };
+
+    /** The control variate: the stochastic gradient at the snapshot, the factor
+     * and the snapshot gradient, either in double or in float precision.
+     */
+    const ValueType * m_SnapshotStochasticGradient{ nullptr };
+    ValueType         m_ControlVariateFactor{ 1.0 };
+    const ValueType * m_SnapshotGradient{ nullptr };
+    const float *     m_FloatSnapshotGradient{ nullptr };
+  };
+
+  /** Perform the update described by the arguments. */
+  void
+  Update(const ArgumentsType & arguments) const;
+
+  /** Convenience method for a plain step: x = x - a g. */
+  void
+  Update(const double stepSize, const DerivativeType & gradient, ParametersType & position) const;
+
+  /** Convenience method for a preconditioned step: d = p g, x = x - a d. */
+  void
+  Update(const double           stepSize,
+         const DerivativeType & gradient,
+         const ParametersType & preconditioner,
+         DerivativeType &       searchDirection,
+         ParametersType &       position) const;
+
+  /** The inner products needed by the conjugate gradient definitions of beta,
+   * with g the gradient, h the previous gradient and d the previous search direction.
+   */
+  struct ConjugateGradientInnerProductsType
+  {
+    ValueType m_GradientGradient{ 0.0 };                 // g^T g
+    ValueType m_PreviousGradientPreviousGradient{ 0.0 }; // h^T h
+    ValueType m_GradientGradientChange{ 0.0 };           // g^T (g - h)
+    ValueType m_SearchDirectionGradientChange{ 0.0 };    // d^T (g - h)
+  };
+
+  /** Compute the inner product of a and b. */
+  ValueType
+  InnerProduct(const SizeValueType numberOfParameters, const ValueType * a, const ValueType * b) const;
+
+  /** Compute all conjugate gradient inner products in one pass. */
+  ConjugateGradientInnerProductsType
+  ComputeConjugateGradientInnerProducts(const SizeValueType numberOfParameters,
+                                        const ValueType *   gradient,
+                                        const ValueType *   previousGradient,
+                                        const ValueType *   previousSearchDirection) const;
+
+  /** Update the search direction in place: d = -g + beta d. When beta is zero,
+   * the previous search direction is not read, so it may be uninitialized.
+   */
+  void
+  UpdateSearchDirection(const SizeValueType numberOfParameters,
+                        const ValueType     beta,
+                        const ValueType *   gradient,
+                        ValueType *         searchDirection) const;
+
+  /** Set the number of work units. A value of zero means the global default. */
+  itkSetMacro(NumberOfWorkUnits, ThreadIdType);
+  itkGetConstMacro(NumberOfWorkUnits, ThreadIdType);
+
+  /** Set the minimum number of parameters per work unit. Updates of fewer
+   * parameters than twice this number are performed by the calling thread.
+   */
+  itkSetMacro(MinimumNumberOfParametersPerWorkUnit, SizeValueType);
+  itkGetConstMacro(MinimumNumberOfParametersPerWorkUnit, SizeValueType);
+
+protected:
+  ParameterUpdateKernel() = default;
+  ~ParameterUpdateKernel() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  ParameterUpdateKernel(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Typedefs for multi-threading. */
+  typedef ParallelTasks::WorkUnitInfoType ThreadInfoType;
+
+  /** The function that processes the parameters [begin, end) in the given work unit. */
+  typedef std::function<void(SizeValueType, SizeValueType, ThreadIdType)> RangeFunctionType;
+
+  /** The struct that is passed to the threads. */
+  struct MultiThreaderParameterType
+  {
+    const RangeFunctionType * st_Function;
+    SizeValueType             st_NumberOfParameters;
+    SizeValueType             st_ChunkSize;
+  };
+
+  /** The number of work units to use for the given number of parameters;
+   * a value below two means that the calling thread does all the work.
+   */
+  ThreadIdType
+  ComputeNumberOfWorkUnits(const SizeValueType numberOfParameters) const;
+
+  /** Divide [0, numberOfParameters) in contiguous chunks over the given number of work units. */
+  void
+  ParallelizeRange(const SizeValueType       numberOfParameters,
+                   const ThreadIdType        numberOfWorkUnits,
+                   const RangeFunctionType & function) const;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  UpdateThreaderCallback(void * arg);
+
+  /** Update the parameters in the range [begin, end). */
+  static void
+  UpdateRange(const ArgumentsType & arguments, const SizeValueType begin, const SizeValueType end);
+
+  ThreadIdType  m_NumberOfWorkUnits{ 0 };
+  SizeValueType m_MinimumNumberOfParametersPerWorkUnit{ 32768 };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParameterUpdateKernel_h
@@ -0,0 +1,161 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPhaseCorrelationTranslationEstimator_h
+#define itkPhaseCorrelationTranslationEstimator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkMatrix.h"
+
+#include <complex>
+
+namespace itk
+{
+
+/** \class PhaseCorrelationTranslationEstimator
+ * \brief Estimates the translation between two images by phase correlation.
+ *
+ * Both images are smoothed and sampled on a coarse grid, with GridSize points along the
+ * longest side of the bounding box of the fixed image. The samples are made zero-mean;
+ * samples outside the images or outside the masks are zero. The fixed image is zero padded,
+ * and the moving image is sampled on the padded grid, centered on the fixed image, so that
+ * shifts up to half the size of the fixed image are found without wrap-around. The peak of
+ * the inverse Fourier transform of the normalized cross-power spectrum is located with
+ * subvoxel accuracy, by a parabolic fit. This finds the global optimum of the translation
+ * at the resolution of the grid, in O(N log N) for N grid points.
+ *
+ * Optionally, the moving image is first mapped by a rotation (Matrix) around the Center,
+ * so that a set of rotations can be compared by their Score. The result is the Shift s for
+ * which the fixed image at x matches the moving image at R (x + s - c) + c. The search is
+ * centered on the shift that maps the center of the fixed image to the center of the moving
+ * image.
+ *
+ * \ingroup Transforms
+ */
+
+template <class TFixedImage, class TMovingImage>
+class ITK_TEMPLATE_EXPORT PhaseCorrelationTranslationEstimator : public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef PhaseCorrelationTranslationEstimator Self;
+  typedef Object                               Superclass;
+  typedef SmartPointer<Self>                   Pointer;
+  typedef SmartPointer<const Self>             ConstPointer;
+
+  /** New macro for creation of through a Smart Pointer. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PhaseCorrelationTranslationEstimator, Object);
+
+  /** Dimension of the images. */
+  itkStaticConstMacro(ImageDimension, unsigned int, TFixedImage::ImageDimension);
+
+  /** Image types to use in the estimation. */
+  typedef TFixedImage                                    FixedImageType;
+  typedef TMovingImage                                   MovingImageType;
+  typedef typename FixedImageType::ConstPointer          FixedImagePointer;
+  typedef typename MovingImageType::ConstPointer         MovingImagePointer;
+  typedef Image<unsigned char, ImageDimension>           MaskType;
+  typedef typename MaskType::ConstPointer                MaskPointer;
+  typedef Image<float, ImageDimension>                   RealImageType;
+  typedef typename RealImageType::Pointer                RealImagePointer;
+  typedef Image<std::complex<float>, ImageDimension>     ComplexImageType;
+  typedef typename RealImageType::SizeType               SizeType;
+  typedef Point<double, ImageDimension>                  PointType;
+  typedef Vector<double, ImageDimension>                 VectorType;
+  typedef Matrix<double, ImageDimension, ImageDimension> MatrixType;
+
+  /** Set the images and the optional masks. */
+  itkSetConstObjectMacro(FixedImage, FixedImageType);
+  itkSetConstObjectMacro(MovingImage, MovingImageType);
+  itkSetConstObjectMacro(FixedMask, MaskType);
+  itkSetConstObjectMacro(MovingMask, MaskType);
+
+  /** Set/Get the number of grid points along the longest side of the fixed image. Default: 64 */
+  itkSetClampMacro(GridSize, unsigned int, 4, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(GridSize, unsigned int);
+
+  /** Set/Get the rotation of the moving image, and its center. Default: identity */
+  itkSetMacro(Matrix, MatrixType);
+  itkGetConstReferenceMacro(Matrix, MatrixType);
+  itkSetMacro(Center, PointType);
+  itkGetConstReferenceMacro(Center, PointType);
+
+  /** Estimate the shift. */
+  virtual void
+  Compute(void);
+
+  /** Get the estimated shift, and the height of the correlation peak, between -1 and 1. */
+  itkGetConstReferenceMacro(Shift, VectorType);
+  itkGetConstMacro(Score, double);
+
+protected:
+  PhaseCorrelationTranslationEstimator();
+  ~PhaseCorrelationTranslationEstimator() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  PhaseCorrelationTranslationEstimator(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Compute the bounding box of an image, in world coordinates. */
+  template <class TImage>
+  static void
+  ComputeBoundingBox(const TImage * image, PointType & minimum, PointType & maximum);
+
+  /** Smooth an image, with a Gaussian of the given standard deviation, in physical units. */
+  template <class TImage>
+  static RealImagePointer
+  Smooth(const TImage * image, const double sigma);
+
+  /** Sample the image at the points R (firstPoint + spacing * j - c) + c, for all indices j of
+   * the grid, and make the samples zero-mean. Samples outside the image or the mask are zero. */
+  void
+  SampleOnGrid(const RealImageType * image,
+               const MaskType *      mask,
+               const PointType &     firstPoint,
+               const double          spacing,
+               const MatrixType &    matrix,
+               const PointType &     center,
+               const SizeType &      size,
+               RealImageType *       grid) const;
+
+  FixedImagePointer  m_FixedImage;
+  MovingImagePointer m_MovingImage;
+  MaskPointer        m_FixedMask;
+  MaskPointer        m_MovingMask;
+  unsigned int       m_GridSize{ 64 };
+  MatrixType         m_Matrix;
+  PointType          m_Center;
+  VectorType         m_Shift;
+  double             m_Score{ 0.0 };
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkPhaseCorrelationTranslationEstimator.hxx"
+#endif
+
+#endif // end #ifndef itkPhaseCorrelationTranslationEstimator_h
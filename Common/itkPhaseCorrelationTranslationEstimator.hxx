@@ -0,0 +1,368 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkPhaseCorrelationTranslationEstimator_hxx
+#define itkPhaseCorrelationTranslationEstimator_hxx
+
+#include "itkPhaseCorrelationTranslationEstimator.h"
+
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkParallelTasks.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkVnlForwardFFTImageFilter.h"
+#include "itkVnlInverseFFTImageFilter.h"
+
+#include <algorithm> // For max.
+#include <cmath>     // For ceil.
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * ************************* Constructor *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::PhaseCorrelationTranslationEstimator()
+{
+  this->m_Matrix.SetIdentity();
+  this->m_Center.Fill(0.0);
+  this->m_Shift.Fill(0.0);
+
+} // end Constructor
+
+
+/**
+ * ************************* Compute *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::Compute(void)
+{
+  if (!this->m_FixedImage || !this->m_MovingImage)
+  {
+    itkExceptionMacro(<< "The fixed and the moving image should be set.");
+  }
+
+  /** The grid covers the bounding box of the fixed image, with GridSize points along the longest side. */
+  PointType fixedMinimum, fixedMaximum, movingMinimum, movingMaximum;
+  ComputeBoundingBox(this->m_FixedImage.GetPointer(), fixedMinimum, fixedMaximum);
+  ComputeBoundingBox(this->m_MovingImage.GetPointer(), movingMinimum, movingMaximum);
+  double longestSide = 0.0;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    longestSide = std::max(longestSide, fixedMaximum[d] - fixedMinimum[d]);
+  }
+  const double spacing = longestSide / static_cast<double>(this->m_GridSize);
+
+  /** The fixed image is zero padded to a power of two of at least twice the size of the grid.
+   * The moving image is sampled on the padded grid, centered on the fixed image. */
+  SizeType   gridSize, fftSize, padding;
+  PointType  fixedFirstPoint, fixedCenter, movingCenter;
+  VectorType paddingShift;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    gridSize[d] = std::max<SizeValueType>(std::ceil((fixedMaximum[d] - fixedMinimum[d]) / spacing), 1);
+    fftSize[d] = 1;
+    while (fftSize[d] < 2 * gridSize[d])
+    {
+      fftSize[d] *= 2;
+    }
+    padding[d] = (fftSize[d] - gridSize[d]) / 2;
+    paddingShift[d] = spacing * static_cast<double>(padding[d]);
+    fixedFirstPoint[d] = fixedMinimum[d] + 0.5 * spacing;
+    fixedCenter[d] = 0.5 * (fixedMinimum[d] + fixedMaximum[d]);
+    movingCenter[d] = 0.5 * (movingMinimum[d] + movingMaximum[d]);
+  }
+
+  /** The search is centered on the shift that maps the center of the fixed image
+   * to the center of the moving image. */
+  const MatrixType inverseMatrix(this->m_Matrix.GetInverse());
+  const VectorType initialShift = inverseMatrix * (movingCenter - this->m_Center) + (this->m_Center - fixedCenter);
+
+  /** Sample the smoothed images. */
+  typename RealImageType::RegionType region;
+  region.SetSize(fftSize);
+  RealImagePointer fixedGrid = RealImageType::New();
+  fixedGrid->SetRegions(region);
+  fixedGrid->Allocate(true);
+  RealImagePointer movingGrid = RealImageType::New();
+  movingGrid->SetRegions(region);
+  movingGrid->Allocate(true);
+
+  MatrixType identity;
+  identity.SetIdentity();
+  this->SampleOnGrid(Smooth(this->m_FixedImage.GetPointer(), 0.5 * spacing),
+                     this->m_FixedMask.GetPointer(),
+                     fixedFirstPoint,
+                     spacing,
+                     identity,
+                     this->m_Center,
+                     gridSize,
+                     fixedGrid);
+  this->SampleOnGrid(Smooth(this->m_MovingImage.GetPointer(), 0.5 * spacing),
+                     this->m_MovingMask.GetPointer(),
+                     fixedFirstPoint - paddingShift + initialShift,
+                     spacing,
+                     this->m_Matrix,
+                     this->m_Center,
+                     fftSize,
+                     movingGrid);
+
+  /** The normalized cross-power spectrum. */
+  typedef VnlForwardFFTImageFilter<RealImageType, ComplexImageType> ForwardFFTType;
+  typedef VnlInverseFFTImageFilter<ComplexImageType, RealImageType> InverseFFTType;
+  typename ForwardFFTType::Pointer fixedFFT = ForwardFFTType::New();
+  fixedFFT->SetInput(fixedGrid);
+  fixedFFT->Update();
+  typename ForwardFFTType::Pointer movingFFT = ForwardFFTType::New();
+  movingFFT->SetInput(movingGrid);
+  movingFFT->Update();
+
+  const SizeValueType         numberOfPixels = region.GetNumberOfPixels();
+  const std::complex<float> * fixedSpectrum = fixedFFT->GetOutput()->GetBufferPointer();
+  std::complex<float> *       spectrum = movingFFT->GetOutput()->GetBufferPointer();
+  for (SizeValueType k = 0; k < numberOfPixels; ++k)
+  {
+    const std::complex<float> product = std::conj(fixedSpectrum[k]) * spectrum[k];
+    const float               magnitude = std::abs(product);
+    spectrum[k] = magnitude > 1e-20f ? product / magnitude : std::complex<float>(0.0f);
+  }
+
+  /** Locate the peak of the correlation. */
+  typename InverseFFTType::Pointer inverseFFT = InverseFFTType::New();
+  inverseFFT->SetInput(movingFFT->GetOutput());
+  inverseFFT->Update();
+  const RealImageType * correlation = inverseFFT->GetOutput();
+  const float *         correlationBuffer = correlation->GetBufferPointer();
+
+  SizeValueType peak = 0;
+  for (SizeValueType k = 1; k < numberOfPixels; ++k)
+  {
+    if (correlationBuffer[k] > correlationBuffer[peak])
+    {
+      peak = k;
+    }
+  }
+  const typename RealImageType::IndexType peakIndex = correlation->ComputeIndex(peak);
+  this->m_Score = correlationBuffer[peak];
+
+  /** Refine the peak by a parabolic fit along each dimension, and convert it to a shift. */
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    typename RealImageType::IndexType previous = peakIndex;
+    typename RealImageType::IndexType next = peakIndex;
+    const IndexValueType              size = static_cast<IndexValueType>(fftSize[d]);
+    previous[d] = (peakIndex[d] + size - 1) % size;
+    next[d] = (peakIndex[d] + 1) % size;
+    const double valuePrevious = correlation->GetPixel(previous);
+    const double valueNext = correlation->GetPixel(next);
+    const double curvature = valuePrevious - 2.0 * this->m_Score + valueNext;
+    double       subvoxel = 0.0;
+    if (curvature < 0.0)
+    {
+      subvoxel = std::max(-0.5, std::min(0.5, 0.5 * (valuePrevious - valueNext) / curvature));
+    }
+
+    double shift = static_cast<double>(peakIndex[d] - static_cast<IndexValueType>(padding[d])) + subvoxel;
+    if (shift > 0.5 * size)
+    {
+      shift -= size;
+    }
+    else if (shift < -0.5 * size)
+    {
+      shift += size;
+    }
+    this->m_Shift[d] = initialShift[d] + spacing * shift;
+  }
+
+} // end Compute()
+
+
+/**
+ * ************************* ComputeBoundingBox *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+template <class TImage>
+void
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::ComputeBoundingBox(const TImage * image,
+                                                                                    PointType &    minimum,
+                                                                                    PointType &    maximum)
+{
+  typedef ContinuousIndex<double, ImageDimension> ContinuousIndexType;
+  const typename TImage::RegionType               region = image->GetLargestPossibleRegion();
+
+  minimum.Fill(NumericTraits<double>::max());
+  maximum.Fill(NumericTraits<double>::NonpositiveMin());
+  for (unsigned int corner = 0; corner < (1u << ImageDimension); ++corner)
+  {
+    ContinuousIndexType cindex;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      cindex[d] = region.GetIndex()[d] - 0.5 + ((corner >> d) & 1u ? region.GetSize()[d] : 0.0);
+    }
+    PointType point;
+    image->TransformContinuousIndexToPhysicalPoint(cindex, point);
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      minimum[d] = std::min(minimum[d], point[d]);
+      maximum[d] = std::max(maximum[d], point[d]);
+    }
+  }
+
+} // end ComputeBoundingBox()
+
+
+/**
+ * ************************* Smooth *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+template <class TImage>
+auto
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::Smooth(const TImage * image, const double sigma)
+  -> RealImagePointer
+{
+  typedef SmoothingRecursiveGaussianImageFilter<TImage, RealImageType> SmootherType;
+  typename SmootherType::Pointer                                       smoother = SmootherType::New();
+  smoother->SetInput(image);
+  smoother->SetSigma(sigma);
+  smoother->Update();
+
+  RealImagePointer output = smoother->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+
+} // end Smooth()
+
+
+/**
+ * ************************* SampleOnGrid *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::SampleOnGrid(const RealImageType * image,
+                                                                              const MaskType *      mask,
+                                                                              const PointType &     firstPoint,
+                                                                              const double          spacing,
+                                                                              const MatrixType &    matrix,
+                                                                              const PointType &     center,
+                                                                              const SizeType &      size,
+                                                                              RealImageType *       grid) const
+{
+  typedef LinearInterpolateImageFunction<RealImageType, double> InterpolatorType;
+  typename InterpolatorType::Pointer                            interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(image);
+
+  SizeValueType numberOfPoints = 1;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    numberOfPoints *= size[d];
+  }
+
+  /** Sample the points in parallel; they are independent. */
+  std::vector<unsigned char> inside(numberOfPoints, 0);
+  std::vector<float>         values(numberOfPoints, 0.0f);
+  ParallelTasks::ParallelizeArray(
+    0,
+    numberOfPoints,
+    [&](const SizeValueType k) {
+      PointType     gridPoint;
+      SizeValueType remainder = k;
+      for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+        gridPoint[d] = firstPoint[d] + spacing * static_cast<double>(remainder % size[d]);
+        remainder /= size[d];
+      }
+      const PointType point = center + matrix * (gridPoint - center);
+
+      if (!interpolator->IsInsideBuffer(point))
+      {
+        return;
+      }
+      if (mask)
+      {
+        typename MaskType::IndexType maskIndex;
+        if (!mask->TransformPhysicalPointToIndex(point, maskIndex) || mask->GetPixel(maskIndex) == 0)
+        {
+          return;
+        }
+      }
+      inside[k] = 1;
+      values[k] = static_cast<float>(interpolator->Evaluate(point));
+    });
+
+  /** Make the samples zero-mean, and store them in the grid. */
+  double        sum = 0.0;
+  SizeValueType count = 0;
+  for (SizeValueType k = 0; k < numberOfPoints; ++k)
+  {
+    if (inside[k])
+    {
+      sum += values[k];
+      ++count;
+    }
+  }
+  const float mean = count > 0 ? static_cast<float>(sum / count) : 0.0f;
+
+  for (SizeValueType k = 0; k < numberOfPoints; ++k)
+  {
+    if (inside[k])
+    {
+      typename RealImageType::IndexType index;
+      SizeValueType                     remainder = k;
+      for (unsigned int d = 0; d < ImageDimension; ++d)
+      {
+        index[d] = static_cast<IndexValueType>(remainder % size[d]);
+        remainder /= size[d];
+      }
+      grid->SetPixel(index, values[k] - mean);
+    }
+  }
+
+} // end SampleOnGrid()
+
+
+/**
+ * ************************* PrintSelf *********************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PhaseCorrelationTranslationEstimator<TFixedImage, TMovingImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "FixedImage: " << this->m_FixedImage.GetPointer() << std::endl;
+  os << indent << "MovingImage: " << this->m_MovingImage.GetPointer() << std::endl;
+  os << indent << "FixedMask: " << this->m_FixedMask.GetPointer() << std::endl;
+  os << indent << "MovingMask: " << this->m_MovingMask.GetPointer() << std::endl;
+  os << indent << "GridSize: " << this->m_GridSize << std::endl;
+  os << indent << "Matrix: " << this->m_Matrix << std::endl;
+  os << indent << "Center: " << this->m_Center << std::endl;
+  os << indent << "Shift: " << this->m_Shift << std::endl;
+  os << indent << "Score: " << this->m_Score << std::endl;
+
+} // end PrintSelf()
+
+} // end namespace itk
+
+#endif // end #ifndef itkPhaseCorrelationTranslationEstimator_hxx
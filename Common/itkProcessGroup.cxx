@@ -0,0 +1,171 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkProcessGroup.h"
+
+#ifdef ELASTIX_USE_MPI
+#  include <mpi.h>
+
+#  include <algorithm>
+#  include <climits>
+#endif
+
+namespace itk
+{
+
+#ifdef ELASTIX_USE_MPI
+namespace
+{
+/** Returns true when MPI can be used, i.e. between MPI_Init() and MPI_Finalize(). */
+bool
+IsMPIActive(void)
+{
+  int initialized = 0;
+  int finalized = 0;
+  MPI_Initialized(&initialized);
+  MPI_Finalized(&finalized);
+  return initialized != 0 && finalized == 0;
+}
+} // namespace
+#endif
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+ProcessGroup::ProcessGroup(int & argc, char **& argv)
+{
+#ifdef ELASTIX_USE_MPI
+  int initialized = 0;
+  MPI_Initialized(&initialized);
+  if (initialized == 0)
+  {
+    /** Only the thread that runs the registration communicates. */
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    this->m_FinalizeOnDestruction = true;
+  }
+#else
+  (void)argc;
+  (void)argv;
+#endif
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+ProcessGroup::~ProcessGroup()
+{
+#ifdef ELASTIX_USE_MPI
+  if (this->m_FinalizeOnDestruction && IsMPIActive())
+  {
+    MPI_Finalize();
+  }
+#endif
+
+} // end Destructor
+
+
+/**
+ * ********************* GetRank ****************************
+ */
+
+unsigned int
+ProcessGroup::GetRank(void)
+{
+#ifdef ELASTIX_USE_MPI
+  if (IsMPIActive())
+  {
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return static_cast<unsigned int>(rank);
+  }
+#endif
+  return 0;
+
+} // end GetRank()
+
+
+/**
+ * ********************* GetNumberOfProcesses ****************************
+ */
+
+unsigned int
+ProcessGroup::GetNumberOfProcesses(void)
+{
+#ifdef ELASTIX_USE_MPI
+  if (IsMPIActive())
+  {
+    int size = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return static_cast<unsigned int>(size);
+  }
+#endif
+  return 1;
+
+} // end GetNumberOfProcesses()
+
+
+/**
+ * ********************* SumOverProcesses ****************************
+ */
+
+void
+ProcessGroup::SumOverProcesses(double * values, const SizeValueType numberOfValues)
+{
+#ifdef ELASTIX_USE_MPI
+  if (GetNumberOfProcesses() > 1)
+  {
+    /** The count of MPI is an int, so very long arrays are reduced in parts. */
+    for (SizeValueType first = 0; first < numberOfValues; first += INT_MAX)
+    {
+      const int count = static_cast<int>(std::min<SizeValueType>(numberOfValues - first, INT_MAX));
+      MPI_Allreduce(MPI_IN_PLACE, values + first, count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+  }
+#else
+  (void)values;
+  (void)numberOfValues;
+#endif
+
+} // end SumOverProcesses()
+
+
+/**
+ * ********************* SumOverProcesses ****************************
+ */
+
+void
+ProcessGroup::SumOverProcesses(SizeValueType & value)
+{
+#ifdef ELASTIX_USE_MPI
+  if (GetNumberOfProcesses() > 1)
+  {
+    unsigned long long sum = value;
+    MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    value = static_cast<SizeValueType>(sum);
+  }
+#else
+  (void)value;
+#endif
+
+} // end SumOverProcesses()
+
+} // end namespace itk
@@ -0,0 +1,79 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkProcessGroup_h
+#define itkProcessGroup_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+/** \class ProcessGroup
+ * \brief The group of processes that evaluate the metric of one registration together.
+ *
+ * When elastix is built with ELASTIX_USE_MPI, a registration may be started
+ * on several processes, e.g. by <tt>mpiexec -n 4 elastix ...</tt>. Every
+ * process then runs the complete registration with the same images and
+ * parameters, such that the optimizers stay identical. Metrics that support
+ * it only evaluate their share of the samples, and sum their partial results
+ * over the processes, see AdvancedImageToImageMetric::SetUseDistributedSampleEvaluation().
+ *
+ * A ProcessGroup object initializes MPI, if nobody did so yet, and finalizes
+ * it when it is destroyed. Without MPI, or when MPI is not initialized, there
+ * is a single process and all sums are left unchanged.
+ *
+ * \ingroup Common
+ */
+
+class ProcessGroup
+{
+public:
+  /** Initialize MPI with the command line arguments, if it is not initialized yet. */
+  ProcessGroup(int & argc, char **& argv);
+
+  /** Finalize MPI, if it was initialized by this object. */
+  ~ProcessGroup();
+
+  /** Returns the rank of the current process, zero for the first or only process. */
+  static unsigned int
+  GetRank(void);
+
+  /** Returns the number of processes, one when MPI is not used. */
+  static unsigned int
+  GetNumberOfProcesses(void);
+
+  /** Replace the values of every process by their sum over all processes.
+   * Must be called by all processes, in the same order, from the thread that
+   * initialized MPI.
+   */
+  static void
+  SumOverProcesses(double * values, const SizeValueType numberOfValues);
+
+  static void
+  SumOverProcesses(SizeValueType & value);
+
+private:
+  ProcessGroup(const ProcessGroup &) = delete;
+  void
+  operator=(const ProcessGroup &) = delete;
+
+  bool m_FinalizeOnDestruction{ false };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkProcessGroup_h
@@ -23,6 +23,7 @@
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
 #include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include <vector>
 
 namespace itk
 {
@@ -133,6 +134,16 @@ public:
                                 WeightsType &               weights,
                                 const IndexType &           startIndex) const;
 
+  /** Set the size n of a table of the 1D weights, derivative weights and second order derivative
+   * weights at the fractions k / n, k = 0, ..., n - 1, of a grid cell. In each dimension where a
+   * position lies on such a fraction, the weights are copied from the table instead of evaluating
+   * the kernels. See BSplineInterpolationWeightFunctionBase::SetGridAlignedWeightsTableSize().
+   * Default: 0, which disables the table.
+   */
+  void
+  SetGridAlignedWeightsTableSize(unsigned int size);
+  itkGetConstMacro(GridAlignedWeightsTableSize, unsigned int);
+
 protected:
   RecursiveBSplineInterpolationWeightFunction();
   ~RecursiveBSplineInterpolationWeightFunction() override = default;
@@ -159,6 +170,18 @@ private:
   typename KernelType::Pointer                      m_Kernel;
   typename DerivativeKernelType::Pointer            m_DerivativeKernel;
   typename SecondOrderDerivativeKernelType::Pointer m_SecondOrderDerivativeKernel;
+
+  /** The grid aligned weights tables, with SplineOrder + 1 weights per entry. */
+  unsigned int        m_GridAlignedWeightsTableSize;
+  std::vector<double> m_GridAlignedWeightsTable;
+  std::vector<double> m_GridAlignedDerivativeWeightsTable;
+  std::vector<double> m_GridAlignedSecondOrderDerivativeWeightsTable;
+
+  /** Return the table entry of the position x relative to the start index, or nullptr
+   * when x does not lie on one of the tabulated fractions.
+   */
+  const double *
+  LookUpGridAlignedWeights(double x, const std::vector<double> & table) const;
 };
 
 } // end namespace itk
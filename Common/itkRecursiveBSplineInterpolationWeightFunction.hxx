@@ -24,6 +24,7 @@
 #include "itkMatrix.h"
 #include "itkMath.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include <algorithm> // std::copy_n
 
 namespace itk
 {
@@ -50,6 +51,8 @@ RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineO
   this->m_DerivativeKernel = DerivativeKernelType::New();
   this->m_SecondOrderDerivativeKernel = SecondOrderDerivativeKernelType::New();
 
+  this->m_GridAlignedWeightsTableSize = 0;
+
 } // end Constructor
 
 
@@ -66,6 +69,7 @@ RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineO
 
   os << indent << "NumberOfWeights: " << m_NumberOfWeights << std::endl;
   os << indent << "SupportSize: " << m_SupportSize << std::endl;
+  os << indent << "GridAlignedWeightsTableSize: " << m_GridAlignedWeightsTableSize << std::endl;
 } // end PrintSelf()
 
 
@@ -102,8 +106,16 @@ RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineO
   for (unsigned int i = 0; i < SpaceDimension; ++i)
   {
     startIndex[i] = Math::Floor<IndexValueType>(cindex[i] + 0.5 - SplineOrder / 2.0);
-    double x = cindex[i] - static_cast<double>(startIndex[i]);
-    this->m_Kernel->Evaluate(x, weightsPtr);
+    double         x = cindex[i] - static_cast<double>(startIndex[i]);
+    const double * tabulated = this->LookUpGridAlignedWeights(x, this->m_GridAlignedWeightsTable);
+    if (tabulated)
+    {
+      std::copy_n(tabulated, SplineOrder + 1, weightsPtr);
+    }
+    else
+    {
+      this->m_Kernel->Evaluate(x, weightsPtr);
+    }
     weightsPtr += SplineOrder + 1;
   }
 
@@ -123,8 +135,16 @@ RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineO
 {
   for (unsigned int i = 0; i < SpaceDimension; ++i)
   {
-    double x = cindex[i] - static_cast<double>(startIndex[i]);
-    this->m_DerivativeKernel->Evaluate(x, &derivativeWeights[i * this->m_SupportSize[i]]);
+    double         x = cindex[i] - static_cast<double>(startIndex[i]);
+    const double * tabulated = this->LookUpGridAlignedWeights(x, this->m_GridAlignedDerivativeWeightsTable);
+    if (tabulated)
+    {
+      std::copy_n(tabulated, SplineOrder + 1, &derivativeWeights[i * this->m_SupportSize[i]]);
+    }
+    else
+    {
+      this->m_DerivativeKernel->Evaluate(x, &derivativeWeights[i * this->m_SupportSize[i]]);
+    }
   }
 } // end EvaluateDerivative()
 
@@ -142,12 +162,82 @@ RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineO
 {
   for (unsigned int i = 0; i < SpaceDimension; ++i)
   {
-    double x = cindex[i] - static_cast<double>(startIndex[i]);
-    this->m_SecondOrderDerivativeKernel->Evaluate(x, &hessianWeights[i * this->m_SupportSize[i]]);
+    double         x = cindex[i] - static_cast<double>(startIndex[i]);
+    const double * tabulated =
+      this->LookUpGridAlignedWeights(x, this->m_GridAlignedSecondOrderDerivativeWeightsTable);
+    if (tabulated)
+    {
+      std::copy_n(tabulated, SplineOrder + 1, &hessianWeights[i * this->m_SupportSize[i]]);
+    }
+    else
+    {
+      this->m_SecondOrderDerivativeKernel->Evaluate(x, &hessianWeights[i * this->m_SupportSize[i]]);
+    }
   }
 } // end EvaluateSecondOrderDerivative()
 
 
+/**
+ * ********************* SetGridAlignedWeightsTableSize ****************************
+ */
+
+template <typename TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+void
+RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineOrder>::SetGridAlignedWeightsTableSize(
+  unsigned int size)
+{
+  if (size == this->m_GridAlignedWeightsTableSize)
+  {
+    return;
+  }
+  this->m_GridAlignedWeightsTableSize = size;
+
+  /** Entry k is at x = ( SplineOrder - 1 ) / 2 + k / n relative to the start index. */
+  const unsigned int numberOfWeights1D = SplineOrder + 1;
+  this->m_GridAlignedWeightsTable.resize(size * numberOfWeights1D);
+  this->m_GridAlignedDerivativeWeightsTable.resize(size * numberOfWeights1D);
+  this->m_GridAlignedSecondOrderDerivativeWeightsTable.resize(size * numberOfWeights1D);
+  for (unsigned int k = 0; k < size; ++k)
+  {
+    const double x = (static_cast<double>(SplineOrder) - 1.0) / 2.0 + static_cast<double>(k) / size;
+    this->m_Kernel->Evaluate(x, this->m_GridAlignedWeightsTable.data() + k * numberOfWeights1D);
+    this->m_DerivativeKernel->Evaluate(x, this->m_GridAlignedDerivativeWeightsTable.data() + k * numberOfWeights1D);
+    this->m_SecondOrderDerivativeKernel->Evaluate(
+      x, this->m_GridAlignedSecondOrderDerivativeWeightsTable.data() + k * numberOfWeights1D);
+  }
+
+  this->Modified();
+
+} // end SetGridAlignedWeightsTableSize()
+
+
+/**
+ * ********************* LookUpGridAlignedWeights ****************************
+ */
+
+template <typename TCoordRep, unsigned int VSpaceDimension, unsigned int VSplineOrder>
+const double *
+RecursiveBSplineInterpolationWeightFunction<TCoordRep, VSpaceDimension, VSplineOrder>::LookUpGridAlignedWeights(
+  double                      x,
+  const std::vector<double> & table) const
+{
+  const unsigned int tableSize = this->m_GridAlignedWeightsTableSize;
+  if (tableSize == 0)
+  {
+    return nullptr;
+  }
+
+  const double position = (x - (static_cast<double>(SplineOrder) - 1.0) / 2.0) * tableSize;
+  const double entry = std::floor(position + 0.5);
+  if (std::abs(position - entry) > 1e-9 * tableSize || entry < 0.0 || entry >= tableSize)
+  {
+    return nullptr;
+  }
+  return table.data() + static_cast<unsigned int>(entry) * (SplineOrder + 1);
+
+} // end LookUpGridAlignedWeights()
+
+
 } // end namespace itk
 
 #endif
@@ -38,6 +38,8 @@
 #ifndef itkReducedDimensionBSplineInterpolateImageFunction_h
 #define itkReducedDimensionBSplineInterpolateImageFunction_h
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "itkImageLinearIteratorWithIndex.h"
@@ -45,6 +47,8 @@
 #include "vnl/vnl_matrix.h"
 
 #include "itkMultiOrderBSplineDecompositionImageFilter.h"
+#include "itkBrickedImageBuffer.h"
+#include "itkImagesAreIdentical.h"
 #include "itkConceptChecking.h"
 #include "itkCovariantVector.h"
 
@@ -73,6 +77,13 @@ namespace itk
  * MultiOrderBSplineDecompositionImageFilter to enable a zero-th order
  * for the last dimension.
  *
+ * Because the last dimension is not interpolated, the coefficients of every frame,
+ * i.e. every slice along the last dimension, only depend on that frame. With
+ * ComputeCoefficientsPerFrame, the coefficients of a frame are only computed when
+ * the frame is first evaluated, so the frames that are never evaluated take no memory.
+ * The coefficients of another interpolator of the same image can be reused, see
+ * SetCachedCoefficients().
+ *
  * Limitations:  Spline order must be between 0 and 5.
  *               Spline order must be set before setting the image.
  *               Requires same spline order for every dimension.
@@ -133,6 +144,9 @@ public:
 
   typedef typename CoefficientFilter::Pointer CoefficientFilterPointer;
 
+  /** Typedef for a bricked copy of the coefficients. */
+  typedef BrickedImageBuffer<CoefficientDataType, itkGetStaticConstMacro(ImageDimension)> BrickedCoefficientsType;
+
   /** Evaluate the function at a ContinuousIndex position.
    *
    * Returns the B-Spline interpolated image intensity at a
@@ -186,6 +200,30 @@ public:
   itkGetConstMacro(UseImageDirection, bool);
   itkBooleanMacro(UseImageDirection);
 
+  /** Read the coefficients from a bricked copy, with bricks of 8 coefficients
+   * along every dimension but the last one. Like the spline order, this must
+   * be set before setting the image. Ignored when the coefficients are computed
+   * per frame. Default OFF. */
+  itkSetMacro(UseBrickedCoefficients, bool);
+  itkGetConstMacro(UseBrickedCoefficients, bool);
+  itkBooleanMacro(UseBrickedCoefficients);
+
+  /** Compute the coefficients of a frame only when that frame is first evaluated,
+   * instead of computing the coefficients of the whole image in SetInputImage().
+   * Like the spline order, this must be set before setting the image. Default OFF. */
+  itkSetMacro(ComputeCoefficientsPerFrame, bool);
+  itkGetConstMacro(ComputeCoefficientsPerFrame, bool);
+  itkBooleanMacro(ComputeCoefficientsPerFrame);
+
+  /** Offer the coefficients of another interpolator, computed for its current input image,
+   * for reuse by the next call of SetInputImage(). They are reused when the next input image
+   * has the same geometry and pixels, see ImagesAreIdentical(), when neither has been modified
+   * since, and when the spline order and ComputeCoefficientsPerFrame are the same. Coefficients
+   * that are computed per frame are then shared, so a frame is only computed once for both.
+   */
+  void
+  SetCachedCoefficients(const Self * interpolator);
+
 protected:
   ReducedDimensionBSplineInterpolateImageFunction();
   ~ReducedDimensionBSplineInterpolateImageFunction() override = default;
@@ -197,7 +235,22 @@ protected:
   typename TImageType::SizeType    m_DataLength;  // Image size
   unsigned int                     m_SplineOrder; // User specified spline order (3rd or cubic is the default)
 
-  typename CoefficientImageType::ConstPointer m_Coefficients; // Spline coefficients
+  /** The coefficients of the frames, each computed on first use. */
+  struct FrameCoefficientsType
+  {
+    explicit FrameCoefficientsType(const SizeValueType numberOfFrames)
+      : m_Coefficients(numberOfFrames)
+      , m_Computed(new std::once_flag[numberOfFrames])
+    {}
+
+    std::vector<typename CoefficientImageType::ConstPointer> m_Coefficients;
+    std::unique_ptr<std::once_flag[]>                        m_Computed;
+  };
+
+  typename CoefficientImageType::ConstPointer m_Coefficients;        // Spline coefficients
+  BrickedCoefficientsType                     m_BrickedCoefficients; // Optional bricked copy of the coefficients
+  std::shared_ptr<FrameCoefficientsType>      m_FrameCoefficients;   // Coefficients per frame, if computed per frame
+  ModifiedTimeType                            m_FrameCoefficientsImageMTime{ 0 };
 
 private:
   ReducedDimensionBSplineInterpolateImageFunction(const Self &) = delete;
@@ -229,6 +282,30 @@ private:
   void
   GeneratePointsToIndex();
 
+  /** Get a coefficient, from the bricked copy when there is one. */
+  CoefficientDataType
+  GetCoefficient(const CoefficientImageType * coefficients, const IndexType & index) const
+  {
+    if (m_BrickedCoefficients.IsEmpty())
+    {
+      return coefficients->GetPixel(index);
+    }
+    return m_BrickedCoefficients.GetPixel(index);
+  }
+
+  /** Get the coefficients that contain the given frame, computing them if that is
+   * the first evaluation of the frame. */
+  const CoefficientImageType *
+  GetCoefficientsOfFrame(const IndexValueType frameIndex) const;
+
+  /** Compute the coefficients of a single frame. */
+  typename CoefficientImageType::ConstPointer
+  ComputeFrameCoefficients(const IndexValueType frameIndex) const;
+
+  /** Check whether the offered coefficients can be used for the given input image. */
+  bool
+  CachedCoefficientsMatch(const TImageType * inputData) const;
+
   /** Determines the indicies to use give the splines region of support */
   void
   DetermineRegionOfSupport(vnl_matrix<long> &          evaluateIndex,
@@ -249,6 +326,16 @@ private:
   // flag to take or not the image direction into account when computing the
   // derivatives.
   bool m_UseImageDirection;
+  bool m_UseBrickedCoefficients;
+  bool m_ComputeCoefficientsPerFrame;
+
+  /** The coefficients offered by SetCachedCoefficients(). */
+  typename TImageType::ConstPointer           m_CachedImage;
+  typename CoefficientImageType::ConstPointer m_CachedCoefficients;
+  std::shared_ptr<FrameCoefficientsType>      m_CachedFrameCoefficients;
+  ModifiedTimeType                            m_CachedImageMTime{ 0 };
+  ModifiedTimeType                            m_CachedCoefficientsMTime{ 0 };
+  unsigned int                                m_CachedSplineOrder{ 0 };
 };
 
 } // namespace itk
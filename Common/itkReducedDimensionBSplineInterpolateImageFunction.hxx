@@ -42,6 +42,7 @@
 #include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkImageRegionIterator.h"
+#include "itkImageAlgorithm.h"
 
 #include "itkVector.h"
 
@@ -65,6 +66,8 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   m_Coefficients = CoefficientImageType::New();
   this->SetSplineOrder(SplineOrder);
   this->m_UseImageDirection = true;
+  this->m_UseBrickedCoefficients = false;
+  this->m_ComputeCoefficientsPerFrame = false;
 }
 
 
@@ -79,6 +82,8 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   Superclass::PrintSelf(os, indent);
   os << indent << "Spline Order: " << m_SplineOrder << std::endl;
   os << indent << "UseImageDirection = " << (this->m_UseImageDirection ? "On" : "Off") << std::endl;
+  os << indent << "UseBrickedCoefficients = " << (this->m_UseBrickedCoefficients ? "On" : "Off") << std::endl;
+  os << indent << "ComputeCoefficientsPerFrame = " << (this->m_ComputeCoefficientsPerFrame ? "On" : "Off") << std::endl;
 }
 
 
@@ -89,26 +94,154 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
 {
   if (inputData)
   {
-    m_CoefficientFilter->SetInput(inputData);
+    m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+    if (this->CachedCoefficientsMatch(inputData))
+    {
+      m_Coefficients = m_CachedCoefficients;
+      m_FrameCoefficients = m_CachedFrameCoefficients;
+    }
+    else if (m_ComputeCoefficientsPerFrame)
+    {
+      // The frames are computed when they are first evaluated. The frames that are already
+      // computed are kept when the same image is set again, e.g. for every piece of a
+      // streamed resampling.
+      if (m_FrameCoefficients == nullptr || inputData != this->GetInputImage() ||
+          inputData->GetMTime() != m_FrameCoefficientsImageMTime)
+      {
+        m_FrameCoefficients = std::make_shared<FrameCoefficientsType>(m_DataLength[ImageDimension - 1]);
+      }
+      m_Coefficients = nullptr;
+    }
+    else
+    {
+      m_CoefficientFilter->SetInput(inputData);
 
-    // the Coefficient Filter requires that the spline order and the input data be set.
-    // TODO:  We need to ensure that this is only run once and only after both input and
-    //        spline order have been set. Should we force an update after the
-    //        splineOrder has been set also?
+      // the Coefficient Filter requires that the spline order and the input data be set.
+      // TODO:  We need to ensure that this is only run once and only after both input and
+      //        spline order have been set. Should we force an update after the
+      //        splineOrder has been set also?
 
-    m_CoefficientFilter->Update();
-    m_Coefficients = m_CoefficientFilter->GetOutput();
+      m_CoefficientFilter->Update();
+      m_Coefficients = m_CoefficientFilter->GetOutput();
+      m_FrameCoefficients = nullptr;
+    }
 
     // Call the Superclass implementation after, in case the filter
     // pulls in  more of the input image
     Superclass::SetInputImage(inputData);
+    m_FrameCoefficientsImageMTime = inputData->GetMTime();
 
-    m_DataLength = inputData->GetBufferedRegion().GetSize();
+    // The last dimension is interpolated with the nearest neighbour,
+    // so the bricks are only one coefficient thick along it.
+    m_BrickedCoefficients.Clear();
+    if (m_UseBrickedCoefficients && m_FrameCoefficients == nullptr)
+    {
+      typename BrickedCoefficientsType::BrickSizeLog2Type brickSizeLog2;
+      brickSizeLog2.Fill(3);
+      brickSizeLog2[ImageDimension - 1] = 0;
+      m_BrickedCoefficients.Initialize(m_Coefficients.GetPointer(), brickSizeLog2);
+    }
   }
   else
   {
     m_Coefficients = nullptr;
+    m_FrameCoefficients = nullptr;
+    m_BrickedCoefficients.Clear();
   }
+
+  // The cache is only offered to the next input image.
+  m_CachedImage = nullptr;
+  m_CachedCoefficients = nullptr;
+  m_CachedFrameCoefficients = nullptr;
+}
+
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+void
+ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::SetCachedCoefficients(
+  const Self * interpolator)
+{
+  m_CachedImage = interpolator->GetInputImage();
+  m_CachedCoefficients = interpolator->m_Coefficients;
+  m_CachedFrameCoefficients = interpolator->m_FrameCoefficients;
+  m_CachedImageMTime = m_CachedImage ? m_CachedImage->GetMTime() : 0;
+  m_CachedCoefficientsMTime = m_CachedCoefficients ? m_CachedCoefficients->GetMTime() : 0;
+  m_CachedSplineOrder = interpolator->m_SplineOrder;
+}
+
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+bool
+ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::CachedCoefficientsMatch(
+  const TImageType * inputData) const
+{
+  const TImageType * cachedImage = m_CachedImage.GetPointer();
+  if (cachedImage == nullptr || (m_CachedCoefficients.IsNull() && m_CachedFrameCoefficients == nullptr))
+  {
+    return false;
+  }
+
+  // Neither may have been modified after caching, and the coefficients must be of the same kind.
+  if (cachedImage->GetMTime() != m_CachedImageMTime || m_CachedSplineOrder != m_SplineOrder ||
+      (m_CachedFrameCoefficients != nullptr) != m_ComputeCoefficientsPerFrame ||
+      (m_CachedCoefficients.IsNotNull() && m_CachedCoefficients->GetMTime() != m_CachedCoefficientsMTime))
+  {
+    return false;
+  }
+
+  // The images must have the same geometry and pixels, e.g. a pyramid output that is a graft
+  // of the original image, or the outputs of the same level of two pyramids of the same image.
+  return ImagesAreIdentical(cachedImage, inputData);
+}
+
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+auto
+ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::GetCoefficientsOfFrame(
+  const IndexValueType frameIndex) const -> const CoefficientImageType *
+{
+  if (m_FrameCoefficients == nullptr)
+  {
+    return m_Coefficients.GetPointer();
+  }
+
+  // Every frame is computed once, by the first thread that evaluates it.
+  const IndexValueType    firstFrameIndex = this->GetInputImage()->GetBufferedRegion().GetIndex(ImageDimension - 1);
+  const auto              frame = static_cast<SizeValueType>(frameIndex - firstFrameIndex);
+  FrameCoefficientsType & frames = *m_FrameCoefficients;
+  std::call_once(frames.m_Computed[frame], [this, &frames, frame, frameIndex] {
+    frames.m_Coefficients[frame] = this->ComputeFrameCoefficients(frameIndex);
+  });
+  return frames.m_Coefficients[frame].GetPointer();
+}
+
+
+template <class TImageType, class TCoordRep, class TCoefficientType>
+auto
+ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoefficientType>::ComputeFrameCoefficients(
+  const IndexValueType frameIndex) const -> typename CoefficientImageType::ConstPointer
+{
+  // The frame is copied, instead of extracted by a filter, because this may be called
+  // by several threads at once, and the pipeline of the input image is not thread-safe.
+  const TImageType *                 inputImage = this->GetInputImage();
+  typename TImageType::RegionType    frameRegion = inputImage->GetBufferedRegion();
+  const typename TImageType::Pointer frameImage = TImageType::New();
+  frameRegion.SetIndex(ImageDimension - 1, frameIndex);
+  frameRegion.SetSize(ImageDimension - 1, 1);
+  frameImage->CopyInformation(inputImage);
+  frameImage->SetRegions(frameRegion);
+  frameImage->Allocate();
+  ImageAlgorithm::Copy(inputImage, frameImage.GetPointer(), frameRegion, frameRegion);
+
+  // The calling thread already is one of the threads, so the frame is computed single-threaded.
+  const CoefficientFilterPointer coefficientFilter = CoefficientFilter::New();
+  coefficientFilter->SetSplineOrder(m_SplineOrder);
+  coefficientFilter->SetSplineOrder(ImageDimension - 1, 0);
+  coefficientFilter->SetNumberOfWorkUnits(1);
+  coefficientFilter->SetInput(frameImage);
+  coefficientFilter->Update();
+  return coefficientFilter->GetOutput();
 }
 
 
@@ -123,6 +256,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   }
 
   m_SplineOrder = SplineOrder;
+  m_FrameCoefficients = nullptr;
   m_CoefficientFilter->SetSplineOrder(SplineOrder);
   // Set spline order of coefficient filter for last dimension to zero,
   // to use nearest neighbour interpolation in the last dimension.
@@ -166,6 +300,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   double    interpolated = 0.0;
   IndexType coefficientIndex;
   coefficientIndex[ImageDimension - 1] = vnl_math::rnd(x[ImageDimension - 1]);
+  const CoefficientImageType * coefficients = this->GetCoefficientsOfFrame(coefficientIndex[ImageDimension - 1]);
 
   // Step through eachpoint in the N-dimensional interpolation cube.
   for (unsigned int p = 0; p < m_MaxNumberInterpolationPoints; ++p)
@@ -181,7 +316,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
     }
     // Convert our step p to the appropriate point in ND space in the
     // m_Coefficients cube.
-    interpolated += w * m_Coefficients->GetPixel(coefficientIndex);
+    interpolated += w * this->GetCoefficient(coefficients, coefficientIndex);
   }
   return (interpolated);
 }
@@ -225,6 +360,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
   double    tempValue;
   IndexType coefficientIndex;
   coefficientIndex[ImageDimension - 1] = vnl_math::rnd(x[ImageDimension - 1]);
+  const CoefficientImageType * coefficients = this->GetCoefficientsOfFrame(coefficientIndex[ImageDimension - 1]);
   for (unsigned int n = 0; n < ImageDimension - 1; ++n)
   {
     derivativeValue[n] = 0.0;
@@ -245,7 +381,7 @@ ReducedDimensionBSplineInterpolateImageFunction<TImageType, TCoordRep, TCoeffici
           tempValue *= weights[n1][m_PointsToIndex[p][n1]];
         }
       }
-      derivativeValue[n] += m_Coefficients->GetPixel(coefficientIndex) * tempValue;
+      derivativeValue[n] += this->GetCoefficient(coefficients, coefficientIndex) * tempValue;
     }
     derivativeValue[n] /= spacing[n]; // take spacing into account
   }
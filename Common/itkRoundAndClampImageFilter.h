@@ -0,0 +1,125 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkRoundAndClampImageFilter_h
+#define itkRoundAndClampImageFilter_h
+
+#include "itkUnaryFunctorImageFilter.h"
+#include "itkNumericTraits.h"
+#include <cmath>
+
+namespace itk
+{
+namespace Functor
+{
+/**
+ * \class RoundAndClamp
+ * \brief Converts a pixel value to another pixel type, clamped to the range of that type,
+ * and rounded to the nearest integer when that type is an integer type.
+ */
+
+template <class TInput, class TOutput>
+class ITK_TEMPLATE_EXPORT RoundAndClamp
+{
+public:
+  bool
+  operator==(const RoundAndClamp &) const
+  {
+    return true;
+  }
+
+
+  bool
+  operator!=(const RoundAndClamp &) const
+  {
+    return false;
+  }
+
+
+  inline TOutput
+  operator()(const TInput & A) const
+  {
+    const double value = static_cast<double>(A);
+    if (value <= static_cast<double>(NumericTraits<TOutput>::NonpositiveMin()))
+    {
+      return NumericTraits<TOutput>::NonpositiveMin();
+    }
+    if (value >= static_cast<double>(NumericTraits<TOutput>::max()))
+    {
+      return NumericTraits<TOutput>::max();
+    }
+    if (NumericTraits<TOutput>::is_integer)
+    {
+      return static_cast<TOutput>(std::round(value));
+    }
+    return static_cast<TOutput>(value);
+  }
+};
+
+} // end namespace Functor
+
+/**
+ * \class RoundAndClampImageFilter
+ * \brief Casts an image to another pixel type, with rounding and clamping.
+ *
+ * Unlike the CastImageFilter, which truncates the values and lets the values outside
+ * the range of the output pixel type overflow, this filter rounds the values to the
+ * nearest integer, when the output pixel type is an integer type, and clamps them to
+ * the range of the output pixel type. Like the CastImageFilter it is multi-threaded,
+ * and it only converts the requested region, so it can be streamed.
+ *
+ * \sa CastImageFilter
+ * \ingroup IntensityImageFilters MultiThreaded
+ */
+
+template <class TInputImage, class TOutputImage>
+class ITK_TEMPLATE_EXPORT RoundAndClampImageFilter
+  : public UnaryFunctorImageFilter<
+      TInputImage,
+      TOutputImage,
+      Functor::RoundAndClamp<typename TInputImage::PixelType, typename TOutputImage::PixelType>>
+{
+public:
+  /** Standard ITK stuff. */
+  typedef RoundAndClampImageFilter Self;
+  typedef UnaryFunctorImageFilter<
+    TInputImage,
+    TOutputImage,
+    Functor::RoundAndClamp<typename TInputImage::PixelType, typename TOutputImage::PixelType>>
+                                   Superclass;
+  typedef SmartPointer<Self>       Pointer;
+  typedef SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(RoundAndClampImageFilter, UnaryFunctorImageFilter);
+
+protected:
+  RoundAndClampImageFilter() = default;
+  ~RoundAndClampImageFilter() override = default;
+
+private:
+  RoundAndClampImageFilter(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkRoundAndClampImageFilter_h
@@ -138,10 +138,22 @@ ScaledSingleValuedNonLinearOptimizer::GetCurrentPosition(void) const
 
   if (this->GetUseScales())
   {
-    /** Get the ScaledCurrentPosition and divide each
-     * element through its scale. */
-    this->m_UnscaledCurrentPosition = scaledCurrentPosition;
-    this->m_ScaledCostFunction->ConvertScaledToUnscaledParameters(this->m_UnscaledCurrentPosition);
+    /** Divide each element of the ScaledCurrentPosition through its scale,
+     * in a single pass. The member is only reallocated when its size changes. */
+    const unsigned int                         numberOfParameters = scaledCurrentPosition.GetSize();
+    const ScaledCostFunctionType::ScalesType & scales = this->m_ScaledCostFunction->GetScales();
+    if (scales.GetSize() != numberOfParameters)
+    {
+      itkExceptionMacro(<< "Number of scales is not correct.");
+    }
+    if (this->m_UnscaledCurrentPosition.GetSize() != numberOfParameters)
+    {
+      this->m_UnscaledCurrentPosition.SetSize(numberOfParameters);
+    }
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      this->m_UnscaledCurrentPosition[i] = scaledCurrentPosition[i] / scales[i];
+    }
 
     return this->m_UnscaledCurrentPosition;
   }
@@ -182,9 +194,23 @@ ScaledSingleValuedNonLinearOptimizer::SetCurrentPosition(const ParametersType &
    */
   if (this->GetUseScales())
   {
-    ParametersType scaledParameters = param;
-    this->m_ScaledCostFunction->ConvertUnscaledToScaledParameters(scaledParameters);
-    this->SetScaledCurrentPosition(scaledParameters);
+    /** Write the scaled parameters directly into the ScaledCurrentPosition,
+     * instead of copying them twice. */
+    const unsigned int                         numberOfParameters = param.GetSize();
+    const ScaledCostFunctionType::ScalesType & scales = this->m_ScaledCostFunction->GetScales();
+    if (scales.GetSize() != numberOfParameters)
+    {
+      itkExceptionMacro(<< "Number of scales is not correct.");
+    }
+    if (this->m_ScaledCurrentPosition.GetSize() != numberOfParameters)
+    {
+      this->m_ScaledCurrentPosition.SetSize(numberOfParameters);
+    }
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      this->m_ScaledCurrentPosition[i] = param[i] * scales[i];
+    }
+    this->Modified();
   }
   else
   {
@@ -0,0 +1,174 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkStochasticConvergenceMonitor.h"
+
+#include <cmath>     // For sqrt, erfc and abs.
+#include <algorithm> // For max.
+
+namespace itk
+{
+
+namespace
+{
+
+/**
+ * ****************** NormalQuantile ************************
+ *
+ * The quantile z of the standard normal distribution, such that P(Z < z) = p,
+ * for p in [0.5, 1). Computed by bisection, since it is only needed once per test.
+ */
+
+double
+NormalQuantile(const double p)
+{
+  double lower = 0.0;
+  double upper = 10.0;
+  for (unsigned int i = 0; i < 60; ++i)
+  {
+    const double z = 0.5 * (lower + upper);
+    if (0.5 * std::erfc(-z / std::sqrt(2.0)) < p)
+    {
+      lower = z;
+    }
+    else
+    {
+      upper = z;
+    }
+  }
+  return 0.5 * (lower + upper);
+
+} // end NormalQuantile()
+
+} // end namespace
+
+
+/**
+ * ****************** PrintSelf ************************
+ */
+
+void
+StochasticConvergenceMonitor::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "WindowSize: " << this->m_WindowSize << std::endl;
+  os << indent << "Confidence: " << this->m_Confidence << std::endl;
+  os << indent << "RelativeTolerance: " << this->m_RelativeTolerance << std::endl;
+  os << indent << "Converged: " << this->m_Converged << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** Initialize ************************
+ */
+
+void
+StochasticConvergenceMonitor::Initialize(void)
+{
+  this->m_Values.clear();
+  this->m_GradientMagnitudes.clear();
+  this->m_Values.reserve(this->m_WindowSize);
+  this->m_GradientMagnitudes.reserve(this->m_WindowSize);
+  this->m_NextIndex = 0;
+  this->m_Converged = false;
+  this->m_RelativeValueDecrease = 0.0;
+  this->m_RelativeGradientMagnitudeDecrease = 0.0;
+
+} // end Initialize()
+
+
+/**
+ * ****************** AddIteration ************************
+ */
+
+bool
+StochasticConvergenceMonitor::AddIteration(const double value, const double gradientMagnitude)
+{
+  /** Fill the window first, and then replace the oldest entry. */
+  if (this->m_Values.size() < this->m_WindowSize)
+  {
+    this->m_Values.push_back(value);
+    this->m_GradientMagnitudes.push_back(gradientMagnitude);
+    this->m_NextIndex = static_cast<unsigned int>(this->m_Values.size()) % this->m_WindowSize;
+    if (this->m_Values.size() < this->m_WindowSize)
+    {
+      return false;
+    }
+  }
+  else
+  {
+    this->m_Values[this->m_NextIndex] = value;
+    this->m_GradientMagnitudes[this->m_NextIndex] = gradientMagnitude;
+    this->m_NextIndex = (this->m_NextIndex + 1) % this->m_WindowSize;
+  }
+
+  const double z = NormalQuantile(this->m_Confidence);
+  this->m_RelativeValueDecrease = this->ComputeRelativeDecrease(this->m_Values, z);
+  this->m_RelativeGradientMagnitudeDecrease = this->ComputeRelativeDecrease(this->m_GradientMagnitudes, z);
+  this->m_Converged = this->m_RelativeValueDecrease < this->m_RelativeTolerance &&
+                      this->m_RelativeGradientMagnitudeDecrease < this->m_RelativeTolerance;
+
+  return this->m_Converged;
+
+} // end AddIteration()
+
+
+/**
+ * ****************** ComputeRelativeDecrease ************************
+ */
+
+double
+StochasticConvergenceMonitor::ComputeRelativeDecrease(const std::vector<double> & series, const double z) const
+{
+  /** The iterations are centred at x = 0, so that the slope and the mean are independent. */
+  const unsigned int n = static_cast<unsigned int>(series.size());
+  const double       centre = 0.5 * static_cast<double>(n - 1);
+  double             sumY = 0.0;
+  double             sumXY = 0.0;
+  double             sumAbsY = 0.0;
+  for (unsigned int k = 0; k < n; ++k)
+  {
+    const double x = static_cast<double>(k) - centre;
+    const double y = series[(this->m_NextIndex + k) % n];
+    sumY += y;
+    sumXY += x * y;
+    sumAbsY += std::abs(y);
+  }
+  const double sumXX = static_cast<double>(n) * (static_cast<double>(n) * n - 1.0) / 12.0;
+  const double mean = sumY / n;
+  const double slope = sumXY / sumXX;
+
+  /** The standard error of the slope, from the residuals of the fit. */
+  double sumSquaredResiduals = 0.0;
+  for (unsigned int k = 0; k < n; ++k)
+  {
+    const double x = static_cast<double>(k) - centre;
+    const double residual = series[(this->m_NextIndex + k) % n] - mean - slope * x;
+    sumSquaredResiduals += residual * residual;
+  }
+  const double standardError = std::sqrt(sumSquaredResiduals / (n - 2) / sumXX);
+
+  /** The bound on the decrease over the next window, relative to the mean absolute value. */
+  const double decrease = n * (-slope + z * standardError);
+  const double meanAbs = std::max(sumAbsY / n, NumericTraits<double>::min());
+  return decrease / meanAbs;
+
+} // end ComputeRelativeDecrease()
+
+} // end namespace itk
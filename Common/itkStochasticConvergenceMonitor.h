@@ -0,0 +1,131 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkStochasticConvergenceMonitor_h
+#define itkStochasticConvergenceMonitor_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class StochasticConvergenceMonitor
+ * \brief Detects the convergence of a stochastic optimizer from its metric values and gradients.
+ *
+ * The classic tolerances on the change of the value or the gradient do not apply to
+ * stochastic optimizers, since their values and gradients are computed on a new set
+ * of samples every iteration. Instead, this class fits a straight line through the
+ * values \f$f_k\f$ and the gradient magnitudes \f$\|g_k\|\f$ of the last \f$n\f$
+ * iterations, the window. With the slope \f$b\f$ and its standard error \f$\sigma_b\f$,
+ * the decrease over the next window is at most
+ *
+ *   \f[ n \, (-b + z \sigma_b) \f]
+ *
+ * with the given confidence, where \f$z\f$ is the corresponding quantile of the
+ * normal distribution. The optimizer is converged when this bound is below the
+ * relative tolerance times the mean absolute value of the window, both for the metric
+ * value and for the gradient magnitude, so when neither shows a relevant trend anymore.
+ * A higher confidence therefore requires stronger evidence of the plateau.
+ *
+ * \ingroup Numerics Optimizers
+ */
+
+class StochasticConvergenceMonitor : public Object
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef StochasticConvergenceMonitor Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer<Self>           Pointer;
+  typedef SmartPointer<const Self>     ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(StochasticConvergenceMonitor, Object);
+
+  /** Discard the iterations that were added, for example at the start of a resolution. */
+  void
+  Initialize(void);
+
+  /** Add the value and gradient magnitude of an iteration, and test for convergence
+   * once the window is filled. Returns whether the optimizer is converged.
+   */
+  bool
+  AddIteration(const double value, const double gradientMagnitude);
+
+  /** Set/Get the number of iterations in the window. At least 3; default 100. */
+  itkSetClampMacro(WindowSize, unsigned int, 3, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(WindowSize, unsigned int);
+
+  /** Set/Get the confidence of the bound on the decrease. Default 0.95. */
+  itkSetClampMacro(Confidence, double, 0.5, 0.9999);
+  itkGetConstMacro(Confidence, double);
+
+  /** Set/Get the tolerance on the decrease over the next window, relative
+   * to the mean absolute value in the window. Default 0.001.
+   */
+  itkSetMacro(RelativeTolerance, double);
+  itkGetConstMacro(RelativeTolerance, double);
+
+  /** Get the result of the last test. */
+  itkGetConstMacro(Converged, bool);
+
+  /** Get the bounds on the decrease of the metric value and the gradient magnitude
+   * over the next window, relative to their mean absolute values, as computed by the last test.
+   */
+  itkGetConstMacro(RelativeValueDecrease, double);
+  itkGetConstMacro(RelativeGradientMagnitudeDecrease, double);
+
+protected:
+  StochasticConvergenceMonitor() = default;
+  ~StochasticConvergenceMonitor() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  StochasticConvergenceMonitor(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Compute the bound on the decrease of the series in the circular buffer, relative
+   * to its mean absolute value. The oldest entry is at m_NextIndex.
+   */
+  double
+  ComputeRelativeDecrease(const std::vector<double> & series, const double z) const;
+
+  unsigned int m_WindowSize{ 100 };
+  double       m_Confidence{ 0.95 };
+  double       m_RelativeTolerance{ 0.001 };
+
+  std::vector<double> m_Values;
+  std::vector<double> m_GradientMagnitudes;
+  unsigned int        m_NextIndex{ 0 };
+
+  bool   m_Converged{ false };
+  double m_RelativeValueDecrease{ 0.0 };
+  double m_RelativeGradientMagnitudeDecrease{ 0.0 };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkStochasticConvergenceMonitor_h
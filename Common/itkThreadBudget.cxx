@@ -0,0 +1,65 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkThreadBudget.h"
+
+#include "itkMultiThreaderBase.h"
+
+namespace itk
+{
+
+namespace
+{
+/** The number of threads of the current thread, zero when none is set. */
+thread_local ThreadIdType t_NumberOfThreads = 0;
+} // namespace
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+ThreadBudget::ThreadBudget(const ThreadIdType numberOfThreads)
+  : m_PreviousNumberOfThreads(t_NumberOfThreads)
+{
+  t_NumberOfThreads = numberOfThreads;
+
+} // end Constructor
+
+
+/**
+ * ********************* Destructor ****************************
+ */
+
+ThreadBudget::~ThreadBudget()
+{
+  t_NumberOfThreads = this->m_PreviousNumberOfThreads;
+
+} // end Destructor
+
+
+/**
+ * ********************* GetNumberOfThreads ****************************
+ */
+
+ThreadIdType
+ThreadBudget::GetNumberOfThreads(void)
+{
+  return t_NumberOfThreads > 0 ? t_NumberOfThreads : MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+
+} // end GetNumberOfThreads()
+
+} // end namespace itk
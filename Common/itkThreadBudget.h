@@ -0,0 +1,65 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkThreadBudget_h
+#define itkThreadBudget_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+/** \class ThreadBudget
+ * \brief Limits the number of threads of the registration that runs in the current thread.
+ *
+ * The ITK global maximum number of threads applies to the whole process, so that
+ * registrations that run concurrently in one process cannot each have their own
+ * number of threads. Instead, a ThreadBudget object sets the number of threads for
+ * the thread that creates it, until it is destroyed. Parts of elastix that divide
+ * their work themselves ask GetNumberOfThreads() how many work units to use, and
+ * the components pass it to the ITK filters that they run.
+ *
+ * \ingroup Common
+ */
+
+class ThreadBudget
+{
+public:
+  /** Set the number of threads of the current thread. Zero means no limit of its
+   * own, i.e. the ITK global default number of threads is used.
+   */
+  explicit ThreadBudget(const ThreadIdType numberOfThreads);
+
+  /** Restore the number of threads of the current thread. */
+  ~ThreadBudget();
+
+  /** Returns the number of threads of the current thread, or the ITK global
+   * default number of threads, when none is set.
+   */
+  static ThreadIdType
+  GetNumberOfThreads(void);
+
+private:
+  ThreadBudget(const ThreadBudget &) = delete;
+  void
+  operator=(const ThreadBudget &) = delete;
+
+  const ThreadIdType m_PreviousNumberOfThreads;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkThreadBudget_h
@@ -0,0 +1,278 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTransformParametersLog.h"
+
+#include "itkByteSwapper.h"
+#include "itkMacro.h"
+#include "itkNumberToString.h"
+#include "itk_zlib.h"
+
+#include <cstring> // For memcpy and strlen.
+#include <sstream>
+
+namespace itk
+{
+
+namespace
+{
+const char * const MagicLine = "elastixtransformparameterslog 1";
+
+/** The entry of the parameter file text of a resolution, which is replaced by the parameters of an iteration. */
+const char * const EmptyTransformParametersLine = "(TransformParameters)\n";
+
+/** Decompresses a record of the log into data, which should have the size of the uncompressed data. */
+void
+Uncompress(const std::vector<char> & compressed, void * data, const std::size_t size, const std::string & fileName)
+{
+  uLongf uncompressedSize = static_cast<uLongf>(size);
+  if (uncompress(static_cast<Bytef *>(data),
+                 &uncompressedSize,
+                 reinterpret_cast<const Bytef *>(compressed.data()),
+                 static_cast<uLong>(compressed.size())) != Z_OK ||
+      uncompressedSize != size)
+  {
+    itkGenericExceptionMacro(<< "ERROR: The transform parameters log \"" << fileName << "\" is corrupt.");
+  }
+}
+} // namespace
+
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+TransformParametersLog::TransformParametersLog(const std::string & fileName)
+  : m_FileName(fileName)
+  , m_File(fileName, std::ios::binary | std::ios::trunc)
+{
+  this->m_File << MagicLine << '\n';
+  this->m_File.flush();
+  if (!this->m_File)
+  {
+    itkGenericExceptionMacro(<< "ERROR: File \"" << fileName << "\" could not be opened!");
+  }
+
+} // end Constructor
+
+
+/**
+ * ********************* WriteResolution ****************************
+ */
+
+void
+TransformParametersLog::WriteResolution(const unsigned long resolution, const std::string & parameterFileText)
+{
+  this->m_Resolution = resolution;
+  this->m_PreviousParameterBits.clear();
+  this->WriteRecord('R', 0, parameterFileText.data(), parameterFileText.size());
+
+} // end WriteResolution()
+
+
+/**
+ * ********************* WriteIteration ****************************
+ */
+
+void
+TransformParametersLog::WriteIteration(const unsigned long iteration, const ParametersType & parameters)
+{
+  /** The first iteration of a resolution is stored relative to zero bits, that is, in full. */
+  const std::size_t numberOfParameters = parameters.GetSize();
+  if (this->m_PreviousParameterBits.size() != numberOfParameters)
+  {
+    this->m_PreviousParameterBits.assign(numberOfParameters, 0);
+  }
+
+  std::vector<std::uint64_t> difference(numberOfParameters);
+  for (std::size_t i = 0; i < numberOfParameters; ++i)
+  {
+    std::uint64_t bits;
+    std::memcpy(&bits, &parameters[i], sizeof(bits));
+    difference[i] = bits ^ this->m_PreviousParameterBits[i];
+    this->m_PreviousParameterBits[i] = bits;
+  }
+
+  /** The log is always little endian, like the binary transform parameter files. */
+  ByteSwapper<std::uint64_t>::SwapRangeFromSystemToLittleEndian(difference.data(), difference.size());
+  this->WriteRecord('I', iteration, difference.data(), difference.size() * sizeof(std::uint64_t));
+
+} // end WriteIteration()
+
+
+/**
+ * ********************* WriteRecord ****************************
+ */
+
+void
+TransformParametersLog::WriteRecord(const char          type,
+                                    const unsigned long iteration,
+                                    const void *        data,
+                                    const std::size_t   size)
+{
+  /** The fastest compression level: the differences of most parameters are zero. */
+  uLongf            compressedSize = compressBound(static_cast<uLong>(size));
+  std::vector<char> compressed(compressedSize);
+  if (compress2(reinterpret_cast<Bytef *>(compressed.data()),
+                &compressedSize,
+                static_cast<const Bytef *>(data),
+                static_cast<uLong>(size),
+                Z_BEST_SPEED) != Z_OK)
+  {
+    itkGenericExceptionMacro(<< "ERROR: The transform parameters could not be compressed for \"" << this->m_FileName
+                             << "\"!");
+  }
+
+  this->m_File << type << ' ' << this->m_Resolution << ' ' << iteration << ' ' << size << ' ' << compressedSize
+               << '\n';
+  this->m_File.write(compressed.data(), static_cast<std::streamsize>(compressedSize));
+  this->m_File.flush();
+  if (!this->m_File)
+  {
+    itkGenericExceptionMacro(<< "ERROR: File \"" << this->m_FileName << "\" could not be written!");
+  }
+
+} // end WriteRecord()
+
+
+/**
+ * ********************* ReadTransformParameterFileText ****************************
+ */
+
+std::string
+TransformParametersLog::ReadTransformParameterFileText(const std::string & fileName,
+                                                       const unsigned long resolution,
+                                                       const unsigned long iteration)
+{
+  std::ifstream file(fileName, std::ios::binary);
+  std::string   line;
+  if (!std::getline(file, line) || line != MagicLine)
+  {
+    itkGenericExceptionMacro(<< "ERROR: The file \"" << fileName << "\" is not a transform parameters log.");
+  }
+
+  std::string                parameterFileText;
+  bool                       resolutionFound = false;
+  std::vector<std::uint64_t> parameterBits;
+  std::vector<std::uint64_t> difference;
+  std::vector<char>          compressed;
+  unsigned long              foundIteration = LastIteration;
+  std::vector<std::uint64_t> foundParameterBits;
+
+  while (std::getline(file, line))
+  {
+    std::istringstream header(line);
+    char               type = 0;
+    unsigned long      recordResolution = 0;
+    unsigned long      recordIteration = 0;
+    std::size_t        size = 0;
+    std::size_t        compressedSize = 0;
+    if (!(header >> type >> recordResolution >> recordIteration >> size >> compressedSize))
+    {
+      /** A truncated record of an interrupted registration. */
+      break;
+    }
+
+    /** Skip the records of the other resolutions without decompressing them. */
+    if (recordResolution != resolution)
+    {
+      if (resolutionFound)
+      {
+        break;
+      }
+      file.ignore(static_cast<std::streamsize>(compressedSize));
+      continue;
+    }
+
+    compressed.resize(compressedSize);
+    if (!file.read(compressed.data(), static_cast<std::streamsize>(compressedSize)))
+    {
+      break;
+    }
+
+    if (type == 'R')
+    {
+      parameterFileText.resize(size);
+      Uncompress(compressed, &parameterFileText[0], size, fileName);
+      resolutionFound = true;
+      parameterBits.clear();
+    }
+    else if (type == 'I' && resolutionFound)
+    {
+      const std::size_t numberOfParameters = size / sizeof(std::uint64_t);
+      difference.resize(numberOfParameters);
+      Uncompress(compressed, difference.data(), size, fileName);
+      ByteSwapper<std::uint64_t>::SwapRangeFromLittleEndianToSystem(difference.data(), difference.size());
+
+      if (parameterBits.size() != numberOfParameters)
+      {
+        parameterBits.assign(numberOfParameters, 0);
+      }
+      for (std::size_t i = 0; i < numberOfParameters; ++i)
+      {
+        parameterBits[i] ^= difference[i];
+      }
+
+      if (iteration == LastIteration || iteration == recordIteration)
+      {
+        foundIteration = recordIteration;
+        foundParameterBits = parameterBits;
+        if (iteration == recordIteration)
+        {
+          break;
+        }
+      }
+    }
+  }
+
+  if (foundIteration == LastIteration)
+  {
+    itkGenericExceptionMacro(<< "ERROR: The transform parameters log \"" << fileName << "\" does not contain "
+                             << (iteration == LastIteration ? std::string("any") : std::to_string(iteration))
+                             << " iteration of resolution " << resolution << ".");
+  }
+
+  /** Fill in the parameters in the same format as elastix writes them, so that the text equals
+   * the transform parameter file that elastix writes for the iteration.
+   */
+  std::string            transformParameters = "(TransformParameters";
+  NumberToString<double> numberToString;
+  for (const std::uint64_t bits : foundParameterBits)
+  {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    transformParameters += ' ';
+    transformParameters += numberToString(value);
+  }
+  transformParameters += ")\n";
+
+  std::string       result = parameterFileText;
+  const std::size_t position = result.find(EmptyTransformParametersLine);
+  if (position == std::string::npos)
+  {
+    result += transformParameters;
+  }
+  else
+  {
+    result.replace(position, std::strlen(EmptyTransformParametersLine), transformParameters);
+  }
+  return result;
+
+} // end ReadTransformParameterFileText()
+
+
+} // end namespace itk
@@ -0,0 +1,101 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkTransformParametersLog_h
+#define itkTransformParametersLog_h
+
+#include "itkOptimizerParameters.h"
+
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/** \class TransformParametersLog
+ * \brief Appends the transform parameters of every iteration to a single compressed binary file.
+ *
+ * Writing a text transform parameter file every iteration lets the disk I/O dominate the
+ * registration for transforms with many parameters. This log stores, per resolution, the
+ * text of the transform parameter file with empty TransformParameters, followed by one
+ * record per iteration. An iteration record holds the bitwise exclusive or of the parameters
+ * with those of the previous iteration, so that the parameters are reconstructed exactly,
+ * while the parameters that did not change compress to almost nothing.
+ *
+ * Each record is a text header line "<type> <resolution> <iteration> <size> <compressedSize>",
+ * followed by the zlib compressed data, and is flushed when written. A record that is
+ * truncated, because the registration was interrupted, is ignored by the reader.
+ *
+ * ReadTransformParameterFileText() materializes the transform parameter file of any logged
+ * iteration.
+ *
+ * \ingroup Common
+ */
+
+class TransformParametersLog
+{
+public:
+  typedef OptimizerParameters<double> ParametersType;
+
+  /** Value of the iteration argument of ReadTransformParameterFileText() that selects the
+   * last logged iteration of the resolution.
+   */
+  static constexpr unsigned long LastIteration = std::numeric_limits<unsigned long>::max();
+
+  /** Creates the log file, replacing an existing one. Throws an ExceptionObject on failure. */
+  explicit TransformParametersLog(const std::string & fileName);
+
+  /** Starts a resolution, storing the text of its transform parameter file, which should
+   * contain an empty "(TransformParameters)" entry, where the parameters of an iteration
+   * are filled in. Without that entry, they are appended.
+   */
+  void
+  WriteResolution(const unsigned long resolution, const std::string & parameterFileText);
+
+  /** Stores the parameters of an iteration of the current resolution. */
+  void
+  WriteIteration(const unsigned long iteration, const ParametersType & parameters);
+
+  /** Reads the log, and returns the text of the transform parameter file of the specified
+   * iteration of the specified resolution, including the TransformParameters.
+   * Throws an ExceptionObject if that iteration is not in the log.
+   */
+  static std::string
+  ReadTransformParameterFileText(const std::string & fileName,
+                                 const unsigned long resolution,
+                                 const unsigned long iteration = LastIteration);
+
+private:
+  TransformParametersLog(const TransformParametersLog &) = delete;
+  void
+  operator=(const TransformParametersLog &) = delete;
+
+  /** Compresses the data, and appends it as a record. */
+  void
+  WriteRecord(const char type, const unsigned long iteration, const void * data, const std::size_t size);
+
+  std::string                m_FileName;
+  std::ofstream              m_File;
+  unsigned long              m_Resolution{ 0 };
+  std::vector<std::uint64_t> m_PreviousParameterBits;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkTransformParametersLog_h
@@ -21,7 +21,7 @@
 
 #include "itkMeshFileReaderBase.h"
 
-#include <fstream>
+#include <string>
 
 namespace itk
 {
@@ -40,6 +40,16 @@ namespace itk
  *
  * The second word in the text file represents the number of points that
  * should be read.
+ *
+ * The points may also be stored in binary form, for large point sets. The file
+ * then starts with a text header "binarypoint" or "binaryindex", followed by the
+ * number of points and a single newline character. The coordinates follow directly
+ * after the newline, as consecutive doubles in native byte order, one point after
+ * the other. The outputpoints.raw file of transformix can be read back by prepending
+ * such a header, e.g. "binarypoint 1000\n".
+ *
+ * The file is read into memory as a whole, and the coordinates are parsed from
+ * that buffer with strtod, which is much faster than formatted stream input.
  **/
 
 template <class TOutputMesh>
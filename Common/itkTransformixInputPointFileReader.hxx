@@ -21,6 +21,12 @@
 
 #include "itkTransformixInputPointFileReader.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
 namespace itk
 {
 
@@ -41,13 +47,7 @@ TransformixInputPointFileReader<TOutputMesh>::TransformixInputPointFileReader()
  */
 
 template <class TOutputMesh>
-TransformixInputPointFileReader<TOutputMesh>::~TransformixInputPointFileReader()
-{
-  if (this->m_Reader.is_open())
-  {
-    this->m_Reader.close();
-  }
-} // end constructor
+TransformixInputPointFileReader<TOutputMesh>::~TransformixInputPointFileReader() = default;
 
 
 /**
@@ -60,30 +60,52 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateOutputInformation(void)
 {
   this->Superclass::GenerateOutputInformation();
 
-  /** The superclass tests already if it's a valid file; so just open it and
-   * assume it goes alright */
-  if (this->m_Reader.is_open())
+  /** The superclass tests already if it's a valid file; read it as a whole. */
+  std::ifstream reader(this->m_FileName.c_str(), std::ios::binary);
+  reader.seekg(0, std::ios::end);
+  const std::streamoff fileSize = reader.tellg();
+  reader.seekg(0, std::ios::beg);
+  this->m_Buffer.assign(fileSize > 0 ? static_cast<std::string::size_type>(fileSize) : 0, '\0');
+  if (fileSize > 0)
   {
-    this->m_Reader.close();
+    reader.read(&this->m_Buffer[0], fileSize);
+  }
+  if (!reader)
+  {
+    std::ostringstream msg;
+    msg << "The file could not be read. " << std::endl << "Filename: " << this->m_FileName << std::endl;
+    MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
+    throw e;
   }
-  this->m_Reader.open(this->m_FileName.c_str());
 
   /** Read the first entry */
-  std::string indexOrPoint;
-  this->m_Reader >> indexOrPoint;
+  const char * const begin = this->m_Buffer.c_str();
+  const char *       current = begin;
+  while (std::isspace(static_cast<unsigned char>(*current)))
+  {
+    ++current;
+  }
+  const char * const wordBegin = current;
+  while (*current != '\0' && !std::isspace(static_cast<unsigned char>(*current)))
+  {
+    ++current;
+  }
+  const std::string indexOrPoint(wordBegin, current);
 
   /** Set the IsIndex bool and the number of points.*/
-  if (indexOrPoint == "point")
+  char * end = const_cast<char *>(current);
+  this->m_PointsAreBinary = indexOrPoint == "binarypoint" || indexOrPoint == "binaryindex";
+  if (indexOrPoint == "point" || indexOrPoint == "binarypoint")
   {
     /** Input points are specified in world coordinates. */
     this->m_PointsAreIndices = false;
-    this->m_Reader >> this->m_NumberOfPoints;
+    this->m_NumberOfPoints = std::strtoul(current, &end, 10);
   }
-  else if (indexOrPoint == "index")
+  else if (indexOrPoint == "index" || indexOrPoint == "binaryindex")
   {
     /** Input points are specified as image indices. */
     this->m_PointsAreIndices = true;
-    this->m_Reader >> this->m_NumberOfPoints;
+    this->m_NumberOfPoints = std::strtoul(current, &end, 10);
   }
   else
   {
@@ -92,7 +114,23 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateOutputInformation(void)
     this->m_NumberOfPoints = atoi(indexOrPoint.c_str());
   }
 
-  /** Leave the file open for the generate data method */
+  current = end;
+
+  /** The binary coordinates start directly after the newline that ends the header. */
+  if (this->m_PointsAreBinary)
+  {
+    while (*current != '\0' && *current != '\n')
+    {
+      ++current;
+    }
+    if (*current == '\n')
+    {
+      ++current;
+    }
+  }
+  this->m_DataOffset = static_cast<std::string::size_type>(current - begin);
+
+  /** Leave the buffer for the generate data method */
 
 } // end GenerateOutputInformation()
 
@@ -113,46 +151,55 @@ TransformixInputPointFileReader<TOutputMesh>::GenerateData(void)
   OutputMeshPointer      output = this->GetOutput();
   PointsContainerPointer points = PointsContainerType::New();
 
-  /** Read the file */
-  if (this->m_Reader.is_open())
+  /** Check the size of the file before parsing anything. */
+  const std::string::size_type dataOffset = std::min(this->m_DataOffset, this->m_Buffer.size());
+  const std::string::size_type numberOfBytes = this->m_Buffer.size() - dataOffset;
+  if (this->m_PointsAreBinary && numberOfBytes < this->m_NumberOfPoints * dimension * sizeof(double))
+  {
+    std::ostringstream msg;
+    msg << "The file is not large enough. " << std::endl << "Filename: " << this->m_FileName << std::endl;
+    MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
+    throw e;
+  }
+
+  /** Parse the buffer */
+  points->Reserve(this->m_NumberOfPoints);
+  const char * current = this->m_Buffer.c_str() + dataOffset;
+  for (unsigned long i = 0; i < this->m_NumberOfPoints; ++i)
   {
-    for (unsigned int i = 0; i < this->m_NumberOfPoints; ++i)
+    PointType point;
+    for (unsigned int j = 0; j < dimension; ++j)
     {
-      // read point from textfile
-      PointType point;
-      for (unsigned int j = 0; j < dimension; ++j)
+      double value;
+      if (this->m_PointsAreBinary)
       {
-        if (!this->m_Reader.eof())
-        {
-          this->m_Reader >> point[j];
-        }
-        else
+        std::memcpy(&value, current, sizeof(double));
+        current += sizeof(double);
+      }
+      else
+      {
+        char * end = nullptr;
+        value = std::strtod(current, &end);
+        if (end == current)
         {
           std::ostringstream msg;
           msg << "The file is not large enough. " << std::endl << "Filename: " << this->m_FileName << std::endl;
           MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
           throw e;
-          return;
         }
+        current = end;
       }
-      points->push_back(point);
+      point[j] = static_cast<typename PointType::ValueType>(value);
     }
-  }
-  else
-  {
-    std::ostringstream msg;
-    msg << "The file has unexpectedly been closed. " << std::endl << "Filename: " << this->m_FileName << std::endl;
-    MeshFileReaderException e(__FILE__, __LINE__, msg.str().c_str(), ITK_LOCATION);
-    throw e;
-    return;
+    points->SetElement(i, point);
   }
 
   /** set in output */
   output->Initialize();
   output->SetPoints(points);
 
-  /** Close the reader */
-  this->m_Reader.close();
+  /** Release the buffer */
+  std::string().swap(this->m_Buffer);
 
   /** This indicates that the current BufferedRegion is equal to the
    * requested region. This action prevents useless re-executions of
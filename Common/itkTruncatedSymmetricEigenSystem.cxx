@@ -0,0 +1,197 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTruncatedSymmetricEigenSystem.h"
+
+#include "vnl/algo/vnl_symmetric_eigensystem.h"
+
+#include <algorithm> // For min.
+#include <cmath>     // For abs.
+
+namespace itk
+{
+
+/**
+ * ****************** PrintSelf ************************
+ */
+
+void
+TruncatedSymmetricEigenSystem::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "UseSubspaceIteration: " << this->m_UseSubspaceIteration << std::endl;
+  os << indent << "NumberOfExtraVectors: " << this->m_NumberOfExtraVectors << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+  os << indent << "NumberOfIterations: " << this->m_NumberOfIterations << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ****************** Initialize ************************
+ */
+
+void
+TruncatedSymmetricEigenSystem::Initialize(void)
+{
+  this->m_Basis.set_size(0, 0);
+  this->m_NumberOfIterations = 0;
+
+} // end Initialize()
+
+
+/**
+ * ****************** Compute ************************
+ */
+
+void
+TruncatedSymmetricEigenSystem::Compute(const MatrixType & matrix, const unsigned int numberOfEigenValues)
+{
+  const unsigned int n = matrix.rows();
+  const unsigned int k = std::min(numberOfEigenValues, n);
+  const unsigned int p = std::min(n, k + this->m_NumberOfExtraVectors);
+  this->m_NumberOfIterations = 0;
+
+  /** Use the full decomposition when there is no start from a previous call,
+   * or when the subspace would not be smaller than the matrix.
+   */
+  if (!this->m_UseSubspaceIteration || p >= n || this->m_Basis.rows() != n || this->m_Basis.cols() != p)
+  {
+    this->ComputeFullEigenSystem(matrix, k);
+    return;
+  }
+
+  MatrixType basis = this->m_Basis;
+  for (unsigned int iteration = 1; iteration <= this->m_MaximumNumberOfIterations; ++iteration)
+  {
+    this->m_NumberOfIterations = iteration;
+    MatrixType product = matrix * basis;
+
+    /** Rayleigh-Ritz: the eigenvectors of the projected matrix rotate the basis
+     * into the best approximations of the eigenvectors within the subspace.
+     */
+    MatrixType projected = basis.transpose() * product;
+    projected = 0.5 * (projected + projected.transpose());
+    const vnl_symmetric_eigensystem<double> eig(projected);
+
+    MatrixType rotation(p, p);
+    VectorType ritzValues(p);
+    for (unsigned int i = 0; i < p; ++i)
+    {
+      rotation.set_column(i, eig.V.get_column(p - 1 - i));
+      ritzValues[i] = eig.get_eigenvalue(p - 1 - i);
+    }
+    basis = basis * rotation;
+    product = product * rotation;
+
+    /** Check the residuals of the requested eigenpairs. */
+    const double tolerance = this->m_Tolerance * std::abs(ritzValues[0]);
+    bool         converged = true;
+    for (unsigned int i = 0; i < k && converged; ++i)
+    {
+      const VectorType residual = product.get_column(i) - ritzValues[i] * basis.get_column(i);
+      converged = residual.two_norm() <= tolerance;
+    }
+
+    if (converged)
+    {
+      this->m_EigenValues = ritzValues.extract(k);
+      this->m_EigenVectors = basis.extract(n, k);
+      this->m_Basis = basis;
+      return;
+    }
+
+    /** Continue with the next power of the matrix. */
+    basis = product;
+    if (!Orthonormalize(basis))
+    {
+      break;
+    }
+  }
+
+  /** Fall back on the full decomposition, which also restarts the subspace iteration. */
+  this->ComputeFullEigenSystem(matrix, k);
+
+} // end Compute()
+
+
+/**
+ * ****************** ComputeFullEigenSystem ************************
+ */
+
+void
+TruncatedSymmetricEigenSystem::ComputeFullEigenSystem(const MatrixType & matrix, const unsigned int numberOfEigenValues)
+{
+  const unsigned int n = matrix.rows();
+  const unsigned int p = std::min(n, numberOfEigenValues + this->m_NumberOfExtraVectors);
+
+  /** The eigenvalues of vnl_symmetric_eigensystem are in ascending order. */
+  const vnl_symmetric_eigensystem<double> eig(matrix);
+
+  this->m_EigenValues.set_size(numberOfEigenValues);
+  this->m_EigenVectors.set_size(n, numberOfEigenValues);
+  this->m_Basis.set_size(n, p);
+  for (unsigned int i = 0; i < p; ++i)
+  {
+    VectorType eigenVector = eig.get_eigenvector(n - 1 - i);
+    eigenVector.normalize();
+    this->m_Basis.set_column(i, eigenVector);
+    if (i < numberOfEigenValues)
+    {
+      this->m_EigenValues[i] = eig.get_eigenvalue(n - 1 - i);
+      this->m_EigenVectors.set_column(i, eigenVector);
+    }
+  }
+
+} // end ComputeFullEigenSystem()
+
+
+/**
+ * ****************** Orthonormalize ************************
+ */
+
+bool
+TruncatedSymmetricEigenSystem::Orthonormalize(MatrixType & basis)
+{
+  /** Gram-Schmidt, where every column is orthogonalized twice for accuracy. */
+  for (unsigned int j = 0; j < basis.cols(); ++j)
+  {
+    VectorType   column = basis.get_column(j);
+    const double originalNorm = column.two_norm();
+    for (unsigned int pass = 0; pass < 2; ++pass)
+    {
+      for (unsigned int i = 0; i < j; ++i)
+      {
+        const VectorType previous = basis.get_column(i);
+        column -= dot_product(previous, column) * previous;
+      }
+    }
+
+    const double norm = column.two_norm();
+    if (!(norm > 1e-12 * originalNorm))
+    {
+      return false;
+    }
+    basis.set_column(j, column / norm);
+  }
+  return true;
+
+} // end Orthonormalize()
+
+} // end namespace itk
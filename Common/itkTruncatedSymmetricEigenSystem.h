@@ -0,0 +1,150 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkTruncatedSymmetricEigenSystem_h
+#define itkTruncatedSymmetricEigenSystem_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+
+#include "vnl/vnl_matrix.h"
+#include "vnl/vnl_vector.h"
+
+namespace itk
+{
+/** \class TruncatedSymmetricEigenSystem
+ * \brief Computes the largest eigenvalues and eigenvectors of a symmetric matrix.
+ *
+ * By default, this class performs a full eigendecomposition with vnl_symmetric_eigensystem,
+ * and only keeps the requested number \f$k\f$ of largest eigenvalues and their
+ * eigenvectors. When UseSubspaceIteration is on, the eigenvectors of the previous
+ * call are used as the start of a subspace iteration with Rayleigh-Ritz projection,
+ * on \f$k + p\f$ vectors, where \f$p\f$ is the number of extra vectors. For the
+ * slowly changing matrices of an iterative optimization this converges in a few
+ * iterations, each of which costs a product of the \f$n \times n\f$ matrix with an
+ * \f$n \times (k + p)\f$ matrix, instead of the \f$O(n^3)\f$ full decomposition.
+ *
+ * The subspace iteration has converged when the residual \f$\| A v_i - \lambda_i v_i \|\f$
+ * of all \f$k\f$ eigenpairs is below the tolerance times the largest eigenvalue.
+ * The first call, a call after Initialize(), and a call that does not converge within
+ * the maximum number of iterations, use the full decomposition. The subspace iteration
+ * finds the eigenvalues of the largest magnitude, so it is meant for positive
+ * semi-definite matrices, such as covariance and correlation matrices.
+ *
+ * \ingroup Numerics
+ */
+
+class TruncatedSymmetricEigenSystem : public Object
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef TruncatedSymmetricEigenSystem Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer<Self>            Pointer;
+  typedef SmartPointer<const Self>      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TruncatedSymmetricEigenSystem, Object);
+
+  /** Typedefs. */
+  typedef vnl_matrix<double> MatrixType;
+  typedef vnl_vector<double> VectorType;
+
+  /** Discard the eigenvectors of the previous call, for example at the start of a resolution. */
+  void
+  Initialize(void);
+
+  /** Compute the given number of largest eigenvalues and their eigenvectors. */
+  void
+  Compute(const MatrixType & matrix, const unsigned int numberOfEigenValues);
+
+  /** Get the computed eigenvalues, in descending order. */
+  const VectorType &
+  GetEigenValues(void) const
+  {
+    return this->m_EigenValues;
+  }
+
+  /** Get the computed eigenvectors as the columns of a matrix, with unit length. */
+  const MatrixType &
+  GetEigenVectors(void) const
+  {
+    return this->m_EigenVectors;
+  }
+
+  /** Set/Get whether the subspace iteration is used. Default false. */
+  itkSetMacro(UseSubspaceIteration, bool);
+  itkGetConstMacro(UseSubspaceIteration, bool);
+  itkBooleanMacro(UseSubspaceIteration);
+
+  /** Set/Get the number of extra vectors of the subspace iteration. Default 8.
+   * More vectors make the iteration converge faster when the requested eigenvalues
+   * are close to the next ones. */
+  itkSetMacro(NumberOfExtraVectors, unsigned int);
+  itkGetConstMacro(NumberOfExtraVectors, unsigned int);
+
+  /** Set/Get the maximum number of subspace iterations. Default 20. */
+  itkSetClampMacro(MaximumNumberOfIterations, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(MaximumNumberOfIterations, unsigned int);
+
+  /** Set/Get the tolerance on the residuals, relative to the largest eigenvalue. Default 1e-6. */
+  itkSetMacro(Tolerance, double);
+  itkGetConstMacro(Tolerance, double);
+
+  /** Get the number of subspace iterations of the last call; zero when the full decomposition was used. */
+  itkGetConstMacro(NumberOfIterations, unsigned int);
+
+protected:
+  TruncatedSymmetricEigenSystem() = default;
+  ~TruncatedSymmetricEigenSystem() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  TruncatedSymmetricEigenSystem(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  /** Compute the full eigendecomposition, and keep the first columns as the next start. */
+  void
+  ComputeFullEigenSystem(const MatrixType & matrix, const unsigned int numberOfEigenValues);
+
+  /** Make the columns of the basis orthonormal. Returns false when they are linearly dependent. */
+  static bool
+  Orthonormalize(MatrixType & basis);
+
+  bool         m_UseSubspaceIteration{ false };
+  unsigned int m_NumberOfExtraVectors{ 8 };
+  unsigned int m_MaximumNumberOfIterations{ 20 };
+  double       m_Tolerance{ 1e-6 };
+  unsigned int m_NumberOfIterations{ 0 };
+
+  VectorType m_EigenValues;
+  MatrixType m_EigenVectors;
+
+  /** The orthonormal start of the next subspace iteration. */
+  MatrixType m_Basis;
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkTruncatedSymmetricEigenSystem_h
@@ -62,4 +62,18 @@ xoutcell::WriteBufferedData(void)
 } // end WriteBufferedData
 
 
+/**
+ * ******************** TakeBufferedData ************************
+ */
+
+std::string
+xoutcell::TakeBufferedData(void)
+{
+  std::string strbuf = this->m_InternalBuffer.str();
+  this->m_InternalBuffer.str(std::string(""));
+  return strbuf;
+
+} // end TakeBufferedData
+
+
 } // end namespace xoutlibrary
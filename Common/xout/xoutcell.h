@@ -51,6 +51,12 @@ public:
   void
   WriteBufferedData(void) override;
 
+  /** Return the buffered cell data and empty the buffer, without
+   * writing it to the outputs.
+   */
+  std::string
+  TakeBufferedData(void);
+
 private:
   typedef std::ostringstream InternalBufferType;
 
@@ -20,6 +20,11 @@
 
 namespace xoutlibrary
 {
+namespace
+{
+thread_local xoutmain * t_xout = nullptr;
+}
+
 xoutmain &
 get_xout(void)
 {
@@ -27,7 +32,16 @@ get_xout(void)
   // static variable like this is thread-safe.
   static xoutmain local_xout;
 
-  return local_xout;
+  return t_xout == nullptr ? local_xout : *t_xout;
+}
+
+
+xoutmain *
+set_thread_local_xout(xoutmain * threadLocalXout)
+{
+  xoutmain * const previousXout = t_xout;
+  t_xout = threadLocalXout;
+  return previousXout;
 }
 
 } // namespace xoutlibrary
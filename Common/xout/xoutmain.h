@@ -37,9 +37,18 @@ namespace xoutlibrary
 class xoutmain : public xoutbase
 {};
 
+/** Returns the xout of the calling thread: the one that is set by
+ * set_thread_local_xout(), or otherwise the global xout.
+ */
 xoutmain &
 get_xout(void);
 
+/** Lets xout refer to the given object in the calling thread, or to the
+ * global xout when it is null. Returns the object that xout referred to before.
+ */
+xoutmain *
+set_thread_local_xout(xoutmain * threadLocalXout);
+
 } // end namespace xoutlibrary
 
 #endif // end #ifndef xoutmain_h
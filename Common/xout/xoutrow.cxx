@@ -18,6 +18,8 @@
 
 #include "xoutrow.h"
 
+#include <algorithm>
+
 namespace xoutlibrary
 {
 
@@ -32,6 +34,37 @@ namespace xoutlibrary
 void
 xoutrow::WriteBufferedData(void)
 {
+  /** When all cells are xoutcells, which is the usual case, the row is first
+   * assembled, and then sent to each output at once, with a single flush.
+   * Flushing the outputs for each cell is expensive when the row is printed
+   * every iteration, to both the console and the log file. All cells are checked
+   * before any data is taken from them, so that no data is lost otherwise.
+   */
+  const bool allCellsAreXoutCells = std::all_of(
+    this->m_XTargetCells.cbegin(), this->m_XTargetCells.cend(), [](const XStreamMapEntryType & cell) {
+      return dynamic_cast<xoutcell *>(cell.second) != nullptr;
+    });
+  if (allCellsAreXoutCells && !this->m_XTargetCells.empty())
+  {
+    std::string row;
+    for (const auto & cell : this->m_XTargetCells)
+    {
+      row += static_cast<xoutcell *>(cell.second)->TakeBufferedData();
+      row += '\t';
+    }
+    row.back() = '\n';
+    for (const auto & output : this->m_COutputs)
+    {
+      *(output.second) << row << std::flush;
+    }
+    for (const auto & output : this->m_XOutputs)
+    {
+      *(output.second) << row;
+      output.second->WriteBufferedData();
+    }
+    return;
+  }
+
   /** Write the cell-data to the outputs, separated by tabs. */
   auto xit = this->m_XTargetCells.begin();
   auto tmpIt = xit;
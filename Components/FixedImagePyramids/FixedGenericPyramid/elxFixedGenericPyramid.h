@@ -56,6 +56,16 @@ namespace elastix
  *    at once, or per resolution. Latter saves memory.\n
  *    example: <tt>(ComputePyramidImagesPerResolution "true")</tt>\n
  *    Default false.
+ * \parameter ComputePyramidImagesInBackground: Flag to specify if, when the pyramid images are
+ *    computed per resolution, the image of the next resolution is computed by a background task,
+ *    while the current resolution is being registered.\n
+ *    example: <tt>(ComputePyramidImagesInBackground "true")</tt>\n
+ *    Default false.
+ * \parameter ComputePyramidImagesCascaded: Flag to specify if, when all resolution levels are
+ *    computed at once, each image is computed from the image of the next (finer) resolution,
+ *    with the incremental sigma, instead of from the input image. Faster, but approximate.\n
+ *    example: <tt>(ComputePyramidImagesCascaded "true")</tt>\n
+ *    Default false.
  * \parameter ImagePyramidUseShrinkImageFilter: Flag to specify if the ShrinkingImageFilter is used
  *    for rescaling the image, or the ResampleImageFilter. Skrinker is faster.\n
  *    example: <tt>(ImagePyramidUseShrinkImageFilter "true")</tt>\n
@@ -130,6 +140,14 @@ protected:
   /** The destructor. */
   ~FixedGenericPyramid() override = default;
 
+  /** Generate the pyramid images, or read them from the cache. */
+  void
+  GenerateData(void) override;
+
+  /** Adds the smoothing schedule to the settings that identify the cache files. */
+  void
+  WritePyramidCacheKey(std::ostream & os) const override;
+
 private:
   elxOverrideGetSelfMacro;
 
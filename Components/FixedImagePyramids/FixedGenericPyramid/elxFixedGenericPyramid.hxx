@@ -151,6 +151,20 @@ FixedGenericPyramid<TElastix>::SetFixedSchedule(void)
   this->m_Configuration->ReadParameter(computeThisResolution, "ComputePyramidImagesPerResolution", 0, false);
   this->SetComputeOnlyForCurrentLevel(computeThisResolution);
 
+  /** Decide whether or not to compute the pyramid images of the next resolution
+   * in the background, while the current resolution is being registered.
+   */
+  bool computeInBackground = false;
+  this->m_Configuration->ReadParameter(computeInBackground, "ComputePyramidImagesInBackground", 0, false);
+  this->SetComputeNextLevelInBackground(computeInBackground);
+
+  /** Decide whether or not to compute each pyramid image from the image of the
+   * next resolution, instead of from the input image.
+   */
+  bool computeCascaded = false;
+  this->m_Configuration->ReadParameter(computeCascaded, "ComputePyramidImagesCascaded", 0, false);
+  this->SetComputeLevelsCascaded(computeCascaded);
+
 } // end SetFixedSchedule()
 
 
@@ -174,6 +188,42 @@ FixedGenericPyramid<TElastix>::BeforeEachResolution(void)
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <class TElastix>
+void
+FixedGenericPyramid<TElastix>::GenerateData(void)
+{
+  /** The cache is only used when all levels are computed at once. */
+  if (this->GetComputeOnlyForCurrentLevel())
+  {
+    this->Superclass1::GenerateData();
+  }
+  else if (!this->ReadPyramidFromCache())
+  {
+    this->Superclass1::GenerateData();
+    this->WritePyramidToCache();
+  }
+} // end GenerateData()
+
+
+/**
+ * ******************* WritePyramidCacheKey ***********************
+ */
+
+template <class TElastix>
+void
+FixedGenericPyramid<TElastix>::WritePyramidCacheKey(std::ostream & os) const
+{
+  this->Superclass2::WritePyramidCacheKey(os);
+  os << "SmoothingSchedule:\n" << this->GetSmoothingSchedule() << "\n";
+  os << "ComputeLevelsCascaded: " << this->GetComputeLevelsCascaded() << "\n";
+
+} // end WritePyramidCacheKey()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFixedGenericPyramid_hxx
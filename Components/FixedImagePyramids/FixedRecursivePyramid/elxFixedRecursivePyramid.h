@@ -89,6 +89,10 @@ protected:
   /** The destructor. */
   ~FixedRecursivePyramid() override = default;
 
+  /** Generate the pyramid images, or read them from the cache. */
+  void
+  GenerateData(void) override;
+
 private:
   elxOverrideGetSelfMacro;
 
@@ -21,6 +21,25 @@
 
 #include "elxFixedRecursivePyramid.h"
 
-// nothing
+namespace elastix
+{
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <class TElastix>
+void
+FixedRecursivePyramid<TElastix>::GenerateData(void)
+{
+  if (!this->ReadPyramidFromCache())
+  {
+    this->Superclass1::GenerateData();
+    this->WritePyramidToCache();
+  }
+} // end GenerateData()
+
+
+} // end namespace elastix
 
 #endif //#ifndef elxFixedRecursivePyramid_hxx
@@ -91,6 +91,10 @@ protected:
   /** The destructor. */
   ~FixedSmoothingPyramid() override = default;
 
+  /** Generate the pyramid images, or read them from the cache. */
+  void
+  GenerateData(void) override;
+
 private:
   elxOverrideGetSelfMacro;
 
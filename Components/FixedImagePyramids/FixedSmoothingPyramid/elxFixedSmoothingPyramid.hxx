@@ -22,6 +22,24 @@
 #include "elxFixedSmoothingPyramid.h"
 
 namespace elastix
-{} // end namespace elastix
+{
+
+/**
+ * ******************* GenerateData ***********************
+ */
+
+template <class TElastix>
+void
+FixedSmoothingPyramid<TElastix>::GenerateData(void)
+{
+  if (!this->ReadPyramidFromCache())
+  {
+    this->Superclass1::GenerateData();
+    this->WritePyramidToCache();
+  }
+} // end GenerateData()
+
+
+} // end namespace elastix
 
 #endif //#ifndef elxFixedSmoothingPyramid_hxx
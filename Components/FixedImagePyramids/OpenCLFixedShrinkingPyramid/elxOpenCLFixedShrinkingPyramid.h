@@ -0,0 +1,175 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLFixedShrinkingPyramid_h
+#define elxOpenCLFixedShrinkingPyramid_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxFixedShrinkingPyramid.h"
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkGPUImage.h"
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLFixedShrinkingPyramid
+ * \brief A pyramid based on the itk::MultiResolutionShrinkPyramidImageFilter,
+ * that computes the pyramid with OpenCL.
+ *
+ * On the GPU, every level is downsampled with the GPUShrinkImageFilter,
+ * without smoothing, like in the CPU implementation.
+ *
+ * When the OpenCL context is not available, or the GPU computation fails,
+ * the pyramid is computed by the CPU implementation.
+ *
+ * The parameters used in this class are:
+ * \parameter FixedImagePyramid: Select this pyramid as follows:\n
+ *    <tt>(FixedImagePyramid "OpenCLFixedShrinkingImagePyramid")</tt>
+ * \parameter OpenCLFixedShrinkingImagePyramidUseOpenCL: Enable the OpenCL pyramid as follows:\n
+ *    <tt>(OpenCLFixedShrinkingImagePyramidUseOpenCL "true")</tt>\n
+ *    The default value is true.
+ *
+ * \sa FixedShrinkingPyramid, OpenCLFixedGenericPyramid
+ * \ingroup ImagePyramids
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT OpenCLFixedShrinkingPyramid : public FixedShrinkingPyramid<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef OpenCLFixedShrinkingPyramid                           Self;
+  typedef FixedShrinkingPyramid<TElastix>                       Superclass;
+  typedef typename FixedShrinkingPyramid<TElastix>::Superclass1 Superclass1;
+  typedef typename FixedShrinkingPyramid<TElastix>::Superclass2 Superclass2;
+  typedef itk::SmartPointer<Self>                               Pointer;
+  typedef itk::SmartPointer<const Self>                         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(OpenCLFixedShrinkingPyramid, FixedShrinkingPyramid);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific pyramid. \n
+   * example: <tt>(FixedImagePyramid "OpenCLFixedShrinkingImagePyramid")</tt>\n
+   */
+  elxClassNameMacro("OpenCLFixedShrinkingImagePyramid");
+
+  /** Get the ImageDimension. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass1::ImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass1::InputImageType             InputImageType;
+  typedef typename Superclass1::OutputImageType            OutputImageType;
+  typedef typename Superclass1::InputImageType::PixelType  InputImagePixelType;
+  typedef typename Superclass1::OutputImageType::PixelType OutputImagePixelType;
+  typedef typename Superclass1::ScheduleType               ScheduleType;
+
+  /** Typedefs for factory. */
+  typedef typename itk::ObjectFactoryBase::Pointer ObjectFactoryBasePointer;
+
+  /** GPU Typedefs for GPU image and GPU filter. */
+  typedef itk::GPUImage<InputImagePixelType, InputImageType::ImageDimension>   GPUInputImageType;
+  typedef typename GPUInputImageType::Pointer                                  GPUInputImagePointer;
+  typedef itk::GPUImage<OutputImagePixelType, OutputImageType::ImageDimension> GPUOutputImageType;
+
+  typedef itk::GenericMultiResolutionPyramidImageFilter<GPUInputImageType, GPUOutputImageType, float> GPUPyramidType;
+  typedef typename GPUPyramidType::Pointer                                                            GPUPyramidPointer;
+
+  typedef typename GPUPyramidType::RescaleScheduleType   RescaleScheduleType;
+  typedef typename GPUPyramidType::SmoothingScheduleType SmoothingScheduleType;
+
+  /** Do some things before registration. */
+  void
+  BeforeRegistration(void) override;
+
+  /** Function to read parameters from a file. */
+  virtual void
+  ReadFromFile(void);
+
+protected:
+  /** This method performs all configuration for GPU pyramid. */
+  void
+  BeforeGenerateData(void);
+
+  /** Executes GPU pyramid. */
+  void
+  GenerateData(void) override;
+
+  /** The constructor. */
+  OpenCLFixedShrinkingPyramid();
+  /** The destructor. */
+  ~OpenCLFixedShrinkingPyramid() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  OpenCLFixedShrinkingPyramid(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+
+  /** Translate the schedule of this pyramid to the rescale and smoothing
+   * schedules of the GPU pyramid.
+   */
+  void
+  SetGPUPyramidSchedules(void);
+
+  /** Register/Unregister factories. */
+  void
+  RegisterFactories(void);
+
+  void
+  UnregisterFactories(void);
+
+  /** Helper method to report switching to CPU mode. */
+  void
+  SwitchingToCPUAndReport(const bool configError);
+
+  /** Helper method to report to elastix log. */
+  void
+  ReportToLog(void);
+
+  /** Returns the GPU copy of the input image. The copy is kept on the GPU
+   * between the resolutions, and is only uploaded again when the input has
+   * changed.
+   */
+  GPUInputImagePointer
+  GetGPUInputImage(void);
+
+  GPUPyramidPointer                     m_GPUPyramid;
+  bool                                  m_GPUPyramidReady;
+  bool                                  m_GPUPyramidCreated;
+  bool                                  m_ContextCreated;
+  bool                                  m_UseOpenCL;
+  std::vector<ObjectFactoryBasePointer> m_Factories;
+  GPUInputImagePointer                  m_GPUInputImage;
+  const InputImageType *                m_GPUInputImageSource;
+  itk::ModifiedTimeType                 m_GPUInputImageMTime;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxOpenCLFixedShrinkingPyramid.hxx"
+#endif
+
+#endif // end #ifndef elxOpenCLFixedShrinkingPyramid_h
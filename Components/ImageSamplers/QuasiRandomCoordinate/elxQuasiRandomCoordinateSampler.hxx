@@ -0,0 +1,44 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxQuasiRandomCoordinateSampler_hxx
+#define elxQuasiRandomCoordinateSampler_hxx
+
+#include "elxQuasiRandomCoordinateSampler.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* BeforeEachResolution ******************
+ */
+
+template <class TElastix>
+void
+QuasiRandomCoordinateSampler<TElastix>::BeforeEachResolution(void)
+{
+  /** Set the NumberOfSpatialSamples and the counter-based random number options, the fixed image
+   * interpolator, the sample region and the fixed image tiles.
+   */
+  this->ReadRandomCoordinateSamplerParameters(*this);
+
+} // end BeforeEachResolution()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxQuasiRandomCoordinateSampler_hxx
@@ -44,6 +44,13 @@ namespace elastix
  *    metric value and its derivative in each iteration. Must be given for each resolution.\n
  *    example: <tt>(NumberOfSpatialSamples 2048 2048 4000)</tt> \n
  *    The default is 5000.
+ * \parameter UseCounterBasedRandomNumbers: Whether to take the random numbers from a counter-based
+ *    generator, which makes the samples independent of the number of threads. The generator is
+ *    seeded with the RandomSeed parameter. The samples are then drawn by multiple threads, also
+ *    inside a mask, unless the mask has an object-to-world transform; a sparse mask is sampled from
+ *    the list of voxels inside it.\n
+ *    example: <tt>(UseCounterBasedRandomNumbers "true")</tt>\n
+ *    Default: false.
  *
  * \ingroup ImageSamplers
  */
@@ -47,6 +47,11 @@ namespace elastix
  *    metric value and its derivative in each iteration. Must be given for each resolution.\n
  *    example: <tt>(NumberOfSpatialSamples 2048 2048 4000)</tt> \n
  *    The default is 5000.
+ * \parameter UseCounterBasedRandomNumbers: Whether to take the random numbers from a counter-based
+ *    generator, which makes the samples independent of the number of threads. The generator is
+ *    seeded with the RandomSeed parameter. Only used when no mask is given.\n
+ *    example: <tt>(UseCounterBasedRandomNumbers "true")</tt>\n
+ *    Default: false.
  * \parameter UseRandomSampleRegion: Defines whether to randomly select a subregion of the image
  *    in each iteration. When set to "true", also specify the SampleRegionSize.
  *    By setting this option to "true", in combination with the NewSamplesEveryIteration parameter,
@@ -70,6 +75,20 @@ namespace elastix
  *    With this option you can specify the order of interpolation.\n
  *    example: <tt>(FixedImageBSplineInterpolationOrder 0 0 1)</tt>\n
  *    Default value: 1. The parameter can be specified for each resolution.
+ * \parameter FixedImageTileFileName: an image file, with the same physical extent as the fixed
+ *    image, from which the sample values are read tile by tile, instead of being interpolated in
+ *    the fixed image pyramid. Only the tiles that contain samples are read, and the values are
+ *    interpolated linearly. The image IO of the file must support streamed reading, e.g. an
+ *    uncompressed MetaImage or a tiled TIFF. For example, per resolution:\n
+ *    example: <tt>(FixedImageTileFileName "level0.mha" "level1.mha" "")</tt>\n
+ *    Default: "", i.e. the fixed image pyramid is interpolated.
+ * \parameter FixedImageTileSize: the size of the tiles, in voxels, for each dimension.\n
+ *    example: <tt>(FixedImageTileSize 256 256)</tt>\n
+ *    You can also specify one number, which will be used for all dimensions. Default: 128.
+ * \parameter MaximumNumberOfFixedImageTiles: the maximum number of tiles kept in memory.
+ *    When more tiles are needed, the least recently used ones are released.\n
+ *    example: <tt>(MaximumNumberOfFixedImageTiles 1024)</tt>\n
+ *    Default: 256.
  *
  * \ingroup ImageSamplers
  */
@@ -123,6 +142,7 @@ public:
   typedef typename Superclass1::CoordRepType            CoordRepType;
   typedef typename Superclass1::InterpolatorType        InterpolatorType;
   typedef typename Superclass1::DefaultInterpolatorType DefaultInterpolatorType;
+  typedef typename Superclass1::TileCacheType           TileCacheType;
 
   /** The input image dimension. */
   itkStaticConstMacro(InputImageDimension, unsigned int, Superclass1::InputImageDimension);
@@ -140,6 +160,7 @@ public:
    * \li Set the number of samples.
    * \li Set the fixed image interpolation order
    * \li Set the UseRandomSampleRegion flag and the SampleRegionSize
+   * \li Set up the tile cache of the fixed image
    */
   void
   BeforeEachResolution(void) override;
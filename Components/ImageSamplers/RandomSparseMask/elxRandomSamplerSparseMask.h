@@ -46,6 +46,11 @@ namespace elastix
  *    metric value and its derivative in each iteration. Must be given for each resolution.\n
  *    example: <tt>(NumberOfSpatialSamples 2048 2048 4000)</tt> \n
  *    The default is 5000.
+ * \parameter UseCounterBasedRandomNumbers: Whether to take the random numbers from a counter-based
+ *    generator, which makes the samples independent of the number of threads. The generator is
+ *    seeded with the RandomSeed parameter.\n
+ *    example: <tt>(UseCounterBasedRandomNumbers "true")</tt>\n
+ *    Default: false.
  *
  * \ingroup ImageSamplers
  */
@@ -32,14 +32,8 @@ template <class TElastix>
 void
 RandomSamplerSparseMask<TElastix>::BeforeEachResolution(void)
 {
-  const unsigned int level = (this->m_Registration->GetAsITKBaseType())->GetCurrentLevel();
-
-  /** Set the NumberOfSpatialSamples. */
-  unsigned long numberOfSpatialSamples = 5000;
-  this->GetConfiguration()->ReadParameter(
-    numberOfSpatialSamples, "NumberOfSpatialSamples", this->GetComponentLabel(), level, 0);
-
-  this->SetNumberOfSamples(numberOfSpatialSamples);
+  /** Set the NumberOfSpatialSamples, and the counter-based random number options. */
+  this->ReadRandomSamplerParameters(*this);
 
 } // end BeforeEachResolution()
 
@@ -19,14 +19,14 @@
 #define elxBSplineInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
 
 /**
  * \class BSplineInterpolator
- * \brief An interpolator based on the itkBSplineInterpolateImageFunction.
+ * \brief An interpolator based on the itk::AdvancedBSplineInterpolateImageFunction.
  *
  * This interpolator interpolates images with an underlying B-spline
  * polynomial.
@@ -48,18 +48,18 @@ namespace elastix
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineInterpolator
-  : public itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                                typename InterpolatorBase<TElastix>::CoordRepType,
-                                                double>
+  : public itk::AdvancedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                        typename InterpolatorBase<TElastix>::CoordRepType,
+                                                        double>
   , // CoefficientType
     public InterpolatorBase<TElastix>
 {
 public:
   /** Standard ITK-stuff. */
   typedef BSplineInterpolator Self;
-  typedef itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                               typename InterpolatorBase<TElastix>::CoordRepType,
-                                               double>
+  typedef itk::AdvancedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                       typename InterpolatorBase<TElastix>::CoordRepType,
+                                                       double>
                                         Superclass1;
   typedef InterpolatorBase<TElastix>    Superclass2;
   typedef itk::SmartPointer<Self>       Pointer;
@@ -69,7 +69,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(BSplineInterpolator, itk::BSplineInterpolateImageFunction);
+  itkTypeMacro(BSplineInterpolator, itk::AdvancedBSplineInterpolateImageFunction);
 
   /** Name of this class.
    * Use this name in the parameter file to select this specific interpolator. \n
@@ -19,14 +19,14 @@
 #define elxBSplineInterpolatorFloat_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
 
 /**
  * \class BSplineInterpolatorFloat
- * \brief An interpolator based on the itk::BSplineInterpolateImageFunction.
+ * \brief An interpolator based on the itk::AdvancedBSplineInterpolateImageFunction.
  *
  * This interpolator interpolates images with an underlying B-spline
  * polynomial.
@@ -42,24 +42,30 @@ namespace elastix
  *    example: <tt>(BSplineInterpolationOrder 3 2 3)</tt> \n
  *    The default order is 1. The parameter can be specified for each resolution.\n
  *    If only given for one resolution, that value is used for the other resolutions as well.
+ * \parameter QuantizeBSplineCoefficients: whether the cubic 3D interpolation reads a copy of
+ *    the coefficients that is quantized to 16 bits, which halves its memory traffic. The
+ *    quantization step is the range of the coefficients divided by 65534, so the results
+ *    differ slightly. \n
+ *    example: <tt>(QuantizeBSplineCoefficients "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineInterpolatorFloat
-  : public itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                                typename InterpolatorBase<TElastix>::CoordRepType,
-                                                float>
+  : public itk::AdvancedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                        typename InterpolatorBase<TElastix>::CoordRepType,
+                                                        float>
   , // CoefficientType
     public InterpolatorBase<TElastix>
 {
 public:
   /** Standard ITK-stuff. */
   typedef BSplineInterpolatorFloat Self;
-  typedef itk::BSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
-                                               typename InterpolatorBase<TElastix>::CoordRepType,
-                                               float>
+  typedef itk::AdvancedBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                       typename InterpolatorBase<TElastix>::CoordRepType,
+                                                       float>
                                         Superclass1;
   typedef InterpolatorBase<TElastix>    Superclass2;
   typedef itk::SmartPointer<Self>       Pointer;
@@ -69,7 +75,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(BSplineInterpolatorFloat, BSplineInterpolateImageFunction);
+  itkTypeMacro(BSplineInterpolatorFloat, AdvancedBSplineInterpolateImageFunction);
 
   /** Name of this class.
    * Use this name in the parameter file to select this specific interpolator. \n
@@ -104,6 +110,7 @@ public:
 
   /** Execute stuff before each new pyramid resolution:
    * \li Set the spline order.
+   * \li Set the quantization of the coefficients.
    */
   void
   BeforeEachResolution(void) override;
@@ -51,6 +51,12 @@ BSplineInterpolatorFloat<TElastix>::BeforeEachResolution(void)
   /** Set the splineOrder. */
   this->SetSplineOrder(splineOrder);
 
+  /** Read whether the coefficients should be quantized to 16 bits. */
+  bool quantizeCoefficients = false;
+  this->GetConfiguration()->ReadParameter(
+    quantizeCoefficients, "QuantizeBSplineCoefficients", this->GetComponentLabel(), level, 0);
+  this->SetUseQuantizedCoefficients(quantizeCoefficients);
+
 } // end BeforeEachResolution()
 
 
@@ -36,6 +36,11 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "LinearInterpolator")</tt>
+ * \parameter UseBrickedImage: whether the image values are read from a copy of the image that is stored
+ *    in bricks of 8 voxels along each dimension, which reduces the number of cache misses for large images,
+ *    at the cost of a second copy of the image in memory. \n
+ *    example: <tt>(UseBrickedImage "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
@@ -87,6 +92,12 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** Execute stuff before each resolution:
+   * \li Read whether the image should be bricked.
+   */
+  void
+  BeforeEachResolution(void) override;
+
 protected:
   /** The constructor. */
   LinearInterpolator() = default;
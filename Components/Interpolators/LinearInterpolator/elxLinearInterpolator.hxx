@@ -24,7 +24,24 @@
 namespace elastix
 {
 
-/** Nothing */
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+LinearInterpolator<TElastix>::BeforeEachResolution(void)
+{
+  /** Get the current resolution level. */
+  unsigned int level = (this->m_Registration->GetAsITKBaseType())->GetCurrentLevel();
+
+  /** Read whether the image should be bricked. */
+  bool useBrickedImage = false;
+  this->GetConfiguration()->ReadParameter(useBrickedImage, "UseBrickedImage", this->GetComponentLabel(), level, 0);
+  this->SetUseBrickedImage(useBrickedImage);
+
+} // end BeforeEachResolution()
+
 
 } // end namespace elastix
 
@@ -0,0 +1,158 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLBSplineInterpolator_h
+#define elxOpenCLBSplineInterpolator_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxBSplineInterpolator.h"
+
+#include "itkGPUImage.h"
+#include "itkGPUBSplineDecompositionImageFilter.h"
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLBSplineInterpolator
+ * \brief A BSplineInterpolator that computes the B-spline coefficients of
+ * its input image with OpenCL.
+ *
+ * The coefficient image is computed by the itk::GPUBSplineDecompositionImageFilter
+ * every time the input image is set, which happens once per resolution. The
+ * coefficients are downloaded to the host for the interpolation by the metric,
+ * and stay available on the device for an OpenCL metric, see GetGPUCoefficients().
+ * The OpenCL filter computes the coefficients in single precision.
+ *
+ * The coefficients are computed on the CPU, as they are by the BSplineInterpolator,
+ * for a spline order of 0 or 1, for images of more than three dimensions, when
+ * the image is too large for the local memory of the device, and when the OpenCL
+ * context is not available.
+ *
+ * The parameters used in this class are:
+ * \parameter Interpolator: Select this interpolator as follows:\n
+ *    <tt>(Interpolator "OpenCLBSplineInterpolator")</tt>
+ * \parameter OpenCLBSplineInterpolatorUseOpenCL: Enable the OpenCL computation as follows:\n
+ *    <tt>(OpenCLBSplineInterpolatorUseOpenCL "true")</tt>\n
+ *    The default value is true.
+ *
+ * All parameters of the BSplineInterpolator are supported as well.
+ *
+ * \sa BSplineInterpolator
+ * \ingroup Interpolators
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT OpenCLBSplineInterpolator : public BSplineInterpolator<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef OpenCLBSplineInterpolator                           Self;
+  typedef BSplineInterpolator<TElastix>                       Superclass;
+  typedef typename BSplineInterpolator<TElastix>::Superclass1 Superclass1;
+  typedef typename BSplineInterpolator<TElastix>::Superclass2 Superclass2;
+  typedef itk::SmartPointer<Self>                             Pointer;
+  typedef itk::SmartPointer<const Self>                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(OpenCLBSplineInterpolator, BSplineInterpolator);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific interpolator. \n
+   * example: <tt>(Interpolator "OpenCLBSplineInterpolator")</tt>\n
+   */
+  elxClassNameMacro("OpenCLBSplineInterpolator");
+
+  /** Get the ImageDimension. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass::ImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass::InputImageType       InputImageType;
+  typedef typename InputImageType::PixelType        InputImagePixelType;
+  typedef typename Superclass::CoefficientImageType CoefficientImageType;
+
+  /** Typedefs for the GPU images and the GPU decomposition filter. */
+  typedef itk::GPUImage<InputImagePixelType, ImageDimension>                                  GPUInputImageType;
+  typedef itk::GPUImage<float, ImageDimension>                                                GPUCoefficientImageType;
+  typedef itk::GPUBSplineDecompositionImageFilter<GPUInputImageType, GPUCoefficientImageType> GPUDecompositionType;
+  typedef typename GPUDecompositionType::Pointer                                              GPUDecompositionPointer;
+
+  /** Do some things before registration:
+   * \li Read the OpenCLBSplineInterpolatorUseOpenCL setting
+   */
+  void
+  BeforeRegistration(void) override;
+
+  /** Set the input image and compute its B-spline coefficients, with OpenCL
+   * when possible.
+   */
+  void
+  SetInputImage(const InputImageType * inputData) override;
+
+  /** Get the coefficients of the current input image on the device, for an
+   * OpenCL metric. Returns null when they have been computed on the CPU.
+   */
+  const GPUCoefficientImageType *
+  GetGPUCoefficients(void) const
+  {
+    return this->m_GPUCoefficients.GetPointer();
+  }
+
+protected:
+  /** The constructor. */
+  OpenCLBSplineInterpolator();
+  /** The destructor. */
+  ~OpenCLBSplineInterpolator() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  OpenCLBSplineInterpolator(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+
+  /** The superclass of the ITK B-spline interpolator, of which the
+   * SetInputImage() does not compute the coefficients.
+   */
+  typedef typename Superclass1::Superclass InterpolateImageFunctionType;
+
+  /** Compute the coefficients of the input image with OpenCL. */
+  void
+  ComputeCoefficientsWithOpenCL(const InputImageType * inputData);
+
+  /** Helper method to report switching to CPU mode. */
+  void
+  SwitchingToCPUAndReport(const bool configError);
+
+  bool                                      m_ContextCreated;
+  bool                                      m_UseOpenCL;
+  GPUDecompositionPointer                   m_GPUDecomposition;
+  typename GPUCoefficientImageType::Pointer m_GPUCoefficients;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxOpenCLBSplineInterpolator.hxx"
+#endif
+
+#endif // end #ifndef elxOpenCLBSplineInterpolator_h
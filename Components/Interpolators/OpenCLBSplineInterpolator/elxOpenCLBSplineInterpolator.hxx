@@ -0,0 +1,189 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLBSplineInterpolator_hxx
+#define elxOpenCLBSplineInterpolator_hxx
+
+#include "elxOpenCLBSplineInterpolator.h"
+
+// GPU includes
+#include "itkOpenCLContext.h"
+#include "itkOpenCLLogger.h"
+
+#include "itkCastImageFilter.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <class TElastix>
+OpenCLBSplineInterpolator<TElastix>::OpenCLBSplineInterpolator()
+  : m_ContextCreated(false)
+  , m_UseOpenCL(true)
+{
+  // Check if the OpenCL context has been created.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  this->m_ContextCreated = context->IsCreated();
+
+} // end Constructor
+
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLBSplineInterpolator<TElastix>::BeforeRegistration(void)
+{
+  // Are we using a OpenCL enabled GPU for the coefficients?
+  this->m_UseOpenCL = true;
+  this->m_Configuration->ReadParameter(this->m_UseOpenCL, "OpenCLBSplineInterpolatorUseOpenCL", 0);
+
+  if (this->m_UseOpenCL && !this->m_ContextCreated)
+  {
+    this->SwitchingToCPUAndReport(false);
+  }
+
+} // end BeforeRegistration()
+
+
+/**
+ * ******************* SetInputImage ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLBSplineInterpolator<TElastix>::SetInputImage(const InputImageType * inputData)
+{
+  this->m_GPUCoefficients = nullptr;
+
+  /** The coefficients of a spline of order 0 or 1 are the image itself,
+   * and the OpenCL filter supports up to three dimensions.
+   */
+  if (inputData == nullptr || !this->m_ContextCreated || !this->m_UseOpenCL || ImageDimension > 3 ||
+      this->GetSplineOrder() < 2)
+  {
+    this->Superclass1::SetInputImage(inputData);
+    return;
+  }
+
+  try
+  {
+    this->ComputeCoefficientsWithOpenCL(inputData);
+  }
+  catch (itk::OpenCLCompileError & e)
+  {
+    // First log then report OpenCL compile error
+    itk::OpenCLLogger::Pointer logger = itk::OpenCLLogger::GetInstance();
+    logger->Write(itk::LoggerBase::PriorityLevelEnum::CRITICAL, e.GetDescription());
+
+    xl::xout["error"] << "ERROR: OpenCL program has not been compiled"
+                      << " during creating the GPU B-spline decomposition filter." << std::endl
+                      << "  Please check the '" << logger->GetLogFileName() << "' in output directory." << std::endl;
+    this->SwitchingToCPUAndReport(true);
+    this->Superclass1::SetInputImage(inputData);
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    xl::xout["error"] << "ERROR: Exception during computing the B-spline coefficients with OpenCL: " << e << std::endl;
+    this->SwitchingToCPUAndReport(true);
+    this->Superclass1::SetInputImage(inputData);
+  }
+
+} // end SetInputImage()
+
+
+/**
+ * ******************* ComputeCoefficientsWithOpenCL ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLBSplineInterpolator<TElastix>::ComputeCoefficientsWithOpenCL(const InputImageType * inputData)
+{
+  /** The program of the filter is built once, when it is created. */
+  if (this->m_GPUDecomposition.IsNull())
+  {
+    this->m_GPUDecomposition = GPUDecompositionType::New();
+  }
+
+  /** Upload the input image. */
+  const typename GPUInputImageType::Pointer gpuInputImage = GPUInputImageType::New();
+  gpuInputImage->GraftITKImage(inputData);
+  gpuInputImage->AllocateGPU();
+  gpuInputImage->GetGPUDataManager()->SetCPUBufferLock(true);
+  gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+  gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  this->m_GPUDecomposition->SetSplineOrder(this->GetSplineOrder());
+  this->m_GPUDecomposition->SetInput(gpuInputImage);
+  this->m_GPUDecomposition->Update();
+  this->m_GPUCoefficients = this->m_GPUDecomposition->GetOutput();
+
+  /** Download the coefficients once, before the threads of the cast access them,
+   * and convert them to the coefficient type of the CPU interpolator.
+   */
+  this->m_GPUCoefficients->GetGPUDataManager()->UpdateCPUBuffer();
+
+  typedef itk::CastImageFilter<GPUCoefficientImageType, CoefficientImageType> CastFilterType;
+  const typename CastFilterType::Pointer                                      caster = CastFilterType::New();
+  caster->SetInput(this->m_GPUCoefficients);
+  caster->Update();
+
+  /** Set the members, as the superclass' SetInputImage() does after computing the coefficients. */
+  this->m_Coefficients = caster->GetOutput();
+  this->InterpolateImageFunctionType::SetInputImage(inputData);
+  this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  itk::OpenCLDevice           device = context->GetDefaultDevice();
+  elxout << "  The B-spline coefficients are computed by " << device.GetName() << " from " << device.GetVendor()
+         << "." << std::endl;
+
+} // end ComputeCoefficientsWithOpenCL()
+
+
+/**
+ * ************************* SwitchingToCPUAndReport ************************
+ */
+
+template <class TElastix>
+void
+OpenCLBSplineInterpolator<TElastix>::SwitchingToCPUAndReport(const bool configError)
+{
+  if (!configError)
+  {
+    xl::xout["warning"] << "WARNING: The OpenCL context could not be created.\n";
+    xl::xout["warning"] << "  The OpenCLBSplineInterpolator is switching back to CPU mode." << std::endl;
+  }
+  else
+  {
+    xl::xout["warning"] << "WARNING: Unable to configure the GPU.\n";
+    xl::xout["warning"] << "  The OpenCLBSplineInterpolator is switching back to CPU mode." << std::endl;
+  }
+  this->m_GPUCoefficients = nullptr;
+
+} // end SwitchingToCPUAndReport()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxOpenCLBSplineInterpolator_hxx
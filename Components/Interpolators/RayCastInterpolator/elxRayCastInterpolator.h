@@ -104,6 +104,14 @@ public:
                                                      CombinationTransformType;
   typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
 
+  /** The ray caster uses the transform of the registration, so it cannot be copied
+   * for a concurrent evaluation. Returns null. */
+  typename ITKBaseType::Pointer
+  CreateWorkUnitInterpolator(const unsigned int) const override
+  {
+    return nullptr;
+  }
+
 protected:
   /** The constructor. */
   RayCastInterpolator() = default;
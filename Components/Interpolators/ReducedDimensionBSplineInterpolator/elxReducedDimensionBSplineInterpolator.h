@@ -40,6 +40,14 @@ namespace elastix
  *    The default order is 1. The parameter can be specified for each resolution.\n
  *    If only given for one resolution, that value is used for the other resolutions as well. \n
  *    Currently only first order B-spline interpolation is supported.
+ * \parameter UseBrickedImage: whether the coefficients are read from a copy that is stored in bricks
+ *    of 8 coefficients along each spatial dimension, which reduces the number of cache misses for large images. \n
+ *    example: <tt>(UseBrickedImage "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
+ * \parameter ComputeCoefficientsPerFrame: whether the coefficients of a frame, i.e. a slice along the last
+ *    dimension, are only computed when the frame is first needed, instead of those of the whole image at once. \n
+ *    example: <tt>(ComputeCoefficientsPerFrame "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
@@ -102,6 +110,8 @@ public:
 
   /** Execute stuff before each new pyramid resolution:
    * \li Set the spline order.
+   * \li Set whether the coefficients are bricked.
+   * \li Set whether the coefficients are computed per frame.
    */
   void
   BeforeEachResolution(void) override;
@@ -51,6 +51,17 @@ ReducedDimensionBSplineInterpolator<TElastix>::BeforeEachResolution(void)
   /** Set the splineOrder. */
   this->SetSplineOrder(splineOrder);
 
+  /** Read whether the coefficients should be bricked. */
+  bool useBrickedImage = false;
+  this->GetConfiguration()->ReadParameter(useBrickedImage, "UseBrickedImage", this->GetComponentLabel(), level, 0);
+  this->SetUseBrickedCoefficients(useBrickedImage);
+
+  /** Read whether the coefficients should be computed per frame. */
+  bool computeCoefficientsPerFrame = false;
+  this->GetConfiguration()->ReadParameter(
+    computeCoefficientsPerFrame, "ComputeCoefficientsPerFrame", this->GetComponentLabel(), level, 0);
+  this->SetComputeCoefficientsPerFrame(computeCoefficientsPerFrame);
+
 } // end BeforeEachResolution()
 
 
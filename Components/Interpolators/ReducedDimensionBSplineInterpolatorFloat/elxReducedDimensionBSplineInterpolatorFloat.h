@@ -0,0 +1,146 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxReducedDimensionBSplineInterpolatorFloat_h
+#define elxReducedDimensionBSplineInterpolatorFloat_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkReducedDimensionBSplineInterpolateImageFunction.h"
+
+namespace elastix
+{
+
+/**
+ * \class ReducedDimensionBSplineInterpolatorFloat
+ * \brief An interpolator based on the itkReducedDimensionBSplineInterpolateImageFunction.
+ *
+ * This interpolator interpolates images with an underlying B-spline
+ * polynomial. It only interpolates in the InputImageDimension - 1 dimensions
+ * of the image.
+ *
+ * Compared to the ReducedDimensionBSplineInterpolator this class uses
+ * a float CoefficientType, instead of double. You can select
+ * this interpolator if memory burden is an issue.
+ *
+ * The parameters used in this class are:
+ * \parameter Interpolator: Select this interpolator as follows:\n
+ *    <tt>(Interpolator "ReducedDimensionBSplineInterpolatorFloat")</tt>
+ * \parameter BSplineInterpolationOrder: the order of the B-spline polynomial. \n
+ *    example: <tt>(BSplineInterpolationOrder 1 1 1)</tt> \n
+ *    The default order is 1. The parameter can be specified for each resolution.\n
+ *    If only given for one resolution, that value is used for the other resolutions as well. \n
+ *    Currently only first order B-spline interpolation is supported.
+ * \parameter UseBrickedImage: whether the coefficients are read from a copy that is stored in bricks
+ *    of 8 coefficients along each spatial dimension, which reduces the number of cache misses for large images. \n
+ *    example: <tt>(UseBrickedImage "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
+ * \parameter ComputeCoefficientsPerFrame: whether the coefficients of a frame, i.e. a slice along the last
+ *    dimension, are only computed when the frame is first needed, instead of those of the whole image at once. \n
+ *    example: <tt>(ComputeCoefficientsPerFrame "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
+ *
+ * \ingroup Interpolators
+ * \sa ReducedDimensionBSplineInterpolator
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT ReducedDimensionBSplineInterpolatorFloat
+  : public itk::ReducedDimensionBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                                typename InterpolatorBase<TElastix>::CoordRepType,
+                                                                float>
+  , // CoefficientType
+    public InterpolatorBase<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef ReducedDimensionBSplineInterpolatorFloat Self;
+  typedef itk::ReducedDimensionBSplineInterpolateImageFunction<typename InterpolatorBase<TElastix>::InputImageType,
+                                                               typename InterpolatorBase<TElastix>::CoordRepType,
+                                                               float>
+                                        Superclass1;
+  typedef InterpolatorBase<TElastix>    Superclass2;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ReducedDimensionBSplineInterpolatorFloat, ReducedDimensionBSplineInterpolateImageFunction);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific interpolator. \n
+   * example: <tt>(Interpolator "ReducedDimensionBSplineInterpolatorFloat")</tt>\n
+   */
+  elxClassNameMacro("ReducedDimensionBSplineInterpolatorFloat");
+
+  /** Get the ImageDimension. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass1::ImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass1::OutputType               OutputType;
+  typedef typename Superclass1::InputImageType           InputImageType;
+  typedef typename Superclass1::IndexType                IndexType;
+  typedef typename Superclass1::ContinuousIndexType      ContinuousIndexType;
+  typedef typename Superclass1::PointType                PointType;
+  typedef typename Superclass1::Iterator                 Iterator;
+  typedef typename Superclass1::CoefficientDataType      CoefficientDataType;
+  typedef typename Superclass1::CoefficientImageType     CoefficientImageType;
+  typedef typename Superclass1::CoefficientFilter        CoefficientFilter;
+  typedef typename Superclass1::CoefficientFilterPointer CoefficientFilterPointer;
+  typedef typename Superclass1::CovariantVectorType      CovariantVectorType;
+
+  /** Typedefs inherited from Elastix. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** Execute stuff before each new pyramid resolution:
+   * \li Set the spline order.
+   * \li Set whether the coefficients are bricked.
+   * \li Set whether the coefficients are computed per frame.
+   */
+  void
+  BeforeEachResolution(void) override;
+
+protected:
+  /** The constructor. */
+  ReducedDimensionBSplineInterpolatorFloat() = default;
+  /** The destructor. */
+  ~ReducedDimensionBSplineInterpolatorFloat() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  ReducedDimensionBSplineInterpolatorFloat(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxReducedDimensionBSplineInterpolatorFloat.hxx"
+#endif
+
+#endif // end #ifndef elxReducedDimensionBSplineInterpolatorFloat_h
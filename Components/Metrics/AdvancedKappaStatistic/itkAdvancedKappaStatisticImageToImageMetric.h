@@ -47,6 +47,10 @@ namespace itk
  * (perfect foreground alignment).  When dealing with optimizers that can
  * only minimize a metric, use the ComplementOn() method.
  *
+ * The moving image gradient of a label image is zero away from the label
+ * boundaries, so that samples mapping there do not contribute to the derivative.
+ * For those samples only the areas are counted, and the transform Jacobian is
+ * not evaluated.
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -188,6 +192,16 @@ protected:
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
 
+  /** Compute a pixel's contribution to the foreground areas and their intersection.
+   * Returns whether the fixed image value is foreground.
+   */
+  bool
+  UpdateValueTerms(const RealType & fixedImageValue,
+                   const RealType & movingImageValue,
+                   std::size_t &    fixedForegroundArea,
+                   std::size_t &    movingForegroundArea,
+                   std::size_t &    intersection) const;
+
   /** Compute a pixel's contribution to the measure and derivatives;
    * Called by GetValueAndDerivative().
    */
@@ -226,6 +240,12 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Returns whether the moving image gradient is zero, in which case the
+   * sample does not contribute to the derivative.
+   */
+  static bool
+  IsZeroMovingImageDerivative(const MovingImageDerivativeType & movingImageDerivative);
+
   bool     m_UseForegroundValue;
   RealType m_ForegroundValue;
   RealType m_Epsilon;
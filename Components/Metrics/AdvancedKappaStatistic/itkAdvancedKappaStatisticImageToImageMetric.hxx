@@ -36,6 +36,9 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::AdvancedKap
   this->SetUseFixedImageLimiter(false);
   this->SetUseMovingImageLimiter(false);
 
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
+
   this->m_UseForegroundValue = true; // for backwards compatibility
   this->m_ForegroundValue = 1.0;
   this->m_Epsilon = 1e-3;
@@ -197,38 +200,8 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
       const RealType & fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
 
       /** Update the intermediate values. */
-      if (this->m_UseForegroundValue)
-      {
-        const RealType diffFixed = std::abs(fixedImageValue - this->m_ForegroundValue);
-        const RealType diffMoving = std::abs(movingImageValue - this->m_ForegroundValue);
-        if (diffFixed < this->m_Epsilon)
-        {
-          fixedForegroundArea++;
-        }
-        if (diffMoving < this->m_Epsilon)
-        {
-          movingForegroundArea++;
-        }
-        if (diffFixed < this->m_Epsilon && diffMoving < this->m_Epsilon)
-        {
-          intersection++;
-        }
-      }
-      else
-      {
-        if (fixedImageValue > this->m_Epsilon)
-        {
-          fixedForegroundArea++;
-        }
-        if (movingImageValue > this->m_Epsilon)
-        {
-          movingForegroundArea++;
-        }
-        if (fixedImageValue > this->m_Epsilon && movingImageValue > this->m_Epsilon)
-        {
-          intersection++;
-        }
-      }
+      this->UpdateValueTerms(
+        fixedImageValue, movingImageValue, fixedForegroundArea, movingForegroundArea, intersection);
 
     } // end if samplOk
 
@@ -369,6 +342,14 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::GetValueAnd
       /** Get the fixed image value. */
       const RealType & fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
 
+      /** Away from the label boundaries the sample only contributes to the areas. */
+      if (Self::IsZeroMovingImageDerivative(movingImageDerivative))
+      {
+        this->UpdateValueTerms(
+          fixedImageValue, movingImageValue, fixedForegroundArea, movingForegroundArea, intersection);
+        continue;
+      }
+
       /** Get the TransformJacobian dT/dmu. */
       this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
 
@@ -494,16 +475,6 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGet
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
 
   /** Some variables. */
   RealType             movingImageValue;
@@ -513,72 +484,86 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGet
   std::size_t          intersection = 0;
   unsigned long        numberOfPixelsCounted = 0;
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
-  fbegin += (int)pos_begin;
-  fend += (int)pos_end;
-
-  /** Loop over the fixed image to calculate the kappa statistic. */
-  for (fiter = fbegin; fiter != fend; ++fiter)
+  /** Process the ranges of samples that are assigned to this thread. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end = 0;
+  while (this->GetNextSampleRange(threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates. */
-    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator fiter;
+    typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+    fbegin += (int)pos_begin;
+    fend += (int)pos_end;
+
+    /** Loop over the fixed image to calculate the kappa statistic. */
+    for (fiter = fbegin; fiter != fend; ++fiter)
+    {
+      /** Read fixed coordinates. */
+      const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
 
-    /** Check if point is inside moving mask. */
-    if (sampleOk)
-    {
-      sampleOk = this->IsInsideMovingMask(mappedPoint);
-    }
+      /** Check if point is inside moving mask. */
+      if (sampleOk)
+      {
+        sampleOk = this->IsInsideMovingMask(mappedPoint);
+      }
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    MovingImageDerivativeType movingImageDerivative;
-    if (sampleOk)
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
-    }
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      MovingImageDerivativeType movingImageDerivative;
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      }
 
-    /** Do the actual calculation of the metric value. */
-    if (sampleOk)
-    {
-      numberOfPixelsCounted++;
+      /** Do the actual calculation of the metric value. */
+      if (sampleOk)
+      {
+        numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+
+        /** Away from the label boundaries the sample only contributes to the areas. */
+        if (Self::IsZeroMovingImageDerivative(movingImageDerivative))
+        {
+          this->UpdateValueTerms(
+            fixedImageValue, movingImageValue, fixedForegroundArea, movingForegroundArea, intersection);
+          continue;
+        }
 
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(fixedImageValue,
-                                          movingImageValue,
-                                          fixedForegroundArea,
-                                          movingForegroundArea,
-                                          intersection,
-                                          imageJacobian,
-                                          nzji,
-                                          vecSum1,
-                                          vecSum2);
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(fixedImageValue,
+                                            movingImageValue,
+                                            fixedForegroundArea,
+                                            movingForegroundArea,
+                                            intersection,
+                                            imageJacobian,
+                                            nzji,
+                                            vecSum1,
+                                            vecSum2);
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the image sample container
+  } // end while over the sample ranges
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_KappaGetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -672,8 +657,7 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::AfterThread
     temp->st_Coefficient2 = tmp2;
     temp->st_DerivativePointer = derivative.begin();
 
-    this->m_Threader->SetSingleMethod(AccumulateDerivativesThreaderCallback, temp);
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(AccumulateDerivativesThreaderCallback, temp);
 
     delete temp;
   }
@@ -725,6 +709,62 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::AccumulateD
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ * *************** UpdateValueTerms ***************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::UpdateValueTerms(
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  std::size_t &    fixedForegroundArea,
+  std::size_t &    movingForegroundArea,
+  std::size_t &    intersection) const
+{
+  /** Classify both values, and count without branches. */
+  bool fixedForeground, movingForeground;
+  if (this->m_UseForegroundValue)
+  {
+    fixedForeground = std::abs(fixedImageValue - this->m_ForegroundValue) < this->m_Epsilon;
+    movingForeground = std::abs(movingImageValue - this->m_ForegroundValue) < this->m_Epsilon;
+  }
+  else
+  {
+    fixedForeground = fixedImageValue > this->m_Epsilon;
+    movingForeground = movingImageValue > this->m_Epsilon;
+  }
+
+  fixedForegroundArea += static_cast<std::size_t>(fixedForeground);
+  movingForegroundArea += static_cast<std::size_t>(movingForeground);
+  intersection += static_cast<std::size_t>(fixedForeground & movingForeground);
+
+  return fixedForeground;
+
+} // end UpdateValueTerms()
+
+
+/**
+ * *************** IsZeroMovingImageDerivative ***************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::IsZeroMovingImageDerivative(
+  const MovingImageDerivativeType & movingImageDerivative)
+{
+  for (unsigned int i = 0; i < MovingImageDimension; ++i)
+  {
+    if (movingImageDerivative[i] != 0.0)
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end IsZeroMovingImageDerivative()
+
+
 /**
  * *************** UpdateValueAndDerivativeTerms ***************************
  */
@@ -743,41 +783,8 @@ AdvancedKappaStatisticImageToImageMetric<TFixedImage, TMovingImage>::UpdateValue
   DerivativeType &                   sum2) const
 {
   /** Update the intermediate values. */
-  bool usableFixedSample = false;
-  if (this->m_UseForegroundValue)
-  {
-    const RealType diffFixed = std::abs(fixedImageValue - this->m_ForegroundValue);
-    const RealType diffMoving = std::abs(movingImageValue - this->m_ForegroundValue);
-    if (diffFixed < this->m_Epsilon)
-    {
-      fixedForegroundArea++;
-      usableFixedSample = true;
-    }
-    if (diffMoving < this->m_Epsilon)
-    {
-      movingForegroundArea++;
-    }
-    if (diffFixed < this->m_Epsilon && diffMoving < this->m_Epsilon)
-    {
-      intersection++;
-    }
-  }
-  else
-  {
-    if (fixedImageValue > this->m_Epsilon)
-    {
-      fixedForegroundArea++;
-      usableFixedSample = true;
-    }
-    if (movingImageValue > this->m_Epsilon)
-    {
-      movingForegroundArea++;
-    }
-    if (fixedImageValue > this->m_Epsilon && movingImageValue > this->m_Epsilon)
-    {
-      intersection++;
-    }
-  }
+  const bool usableFixedSample =
+    this->UpdateValueTerms(fixedImageValue, movingImageValue, fixedForegroundArea, movingForegroundArea, intersection);
 
   /** Calculate the contributions to the derivatives with respect to each parameter. */
   if (nzji.size() == this->GetNumberOfParameters())
@@ -91,6 +91,43 @@ namespace elastix
  *    B-spline grids.
  *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
  *    The default is "true".
+ * \parameter MaximumJointPDFDerivativesMemory: The maximum amount of memory, in
+ *    megabytes, for the explicit joint histogram derivatives of
+ *    (UseFastAndLowMemoryVersion "false"). When the matrix would be larger, the
+ *    low memory version is used instead, which gives the same derivative.\n
+ *    example: <tt>(MaximumJointPDFDerivativesMemory 2048)</tt> \n
+ *    The default is 0, which means no limit. Can be given for each resolution,
+ *    or for all resolutions at once.
+ * \parameter UseParzenWindowLookUpTables: Whether the moving image Parzen window
+ *    values and their derivatives are interpolated from tabulated kernels, which
+ *    is cheaper than evaluating the B-spline kernels for every sample. Only used
+ *    for a MovingKernelBSplineOrder of 2 or 3. The results differ slightly
+ *    (relative error about 1e-7) from the directly evaluated kernels.\n
+ *    example: <tt>(UseParzenWindowLookUpTables "true")</tt> \n
+ *    The default is "false". Can be given for each resolution, or for all
+ *    resolutions at once.
+ * \parameter UseAdaptiveNumberOfHistogramBins: Whether each resolution starts with
+ *    InitialNumberOfHistogramBins bins, which are doubled each time the metric value
+ *    has settled, until the configured numbers of fixed and moving histogram bins are
+ *    reached. The metric value has settled when its mean over an interval of
+ *    AdaptiveHistogramBinsInterval iterations differs relatively less than
+ *    AdaptiveHistogramBinsTolerance from the mean over the previous interval.
+ *    The cost of the joint histogram derivatives is lower with fewer bins.\n
+ *    example: <tt>(UseAdaptiveNumberOfHistogramBins "true")</tt> \n
+ *    The default is "false". Can be given for each resolution, or for all
+ *    resolutions at once.
+ * \parameter InitialNumberOfHistogramBins: The number of fixed and moving histogram
+ *    bins at the start of a resolution, for (UseAdaptiveNumberOfHistogramBins "true").\n
+ *    example: <tt>(InitialNumberOfHistogramBins 8)</tt> \n
+ *    The default is 8. Can be given for each resolution, or for all resolutions at once.
+ * \parameter AdaptiveHistogramBinsInterval: The number of iterations over which the
+ *    metric value is averaged, for (UseAdaptiveNumberOfHistogramBins "true").\n
+ *    example: <tt>(AdaptiveHistogramBinsInterval 50)</tt> \n
+ *    The default is 25. Can be given for each resolution, or for all resolutions at once.
+ * \parameter AdaptiveHistogramBinsTolerance: The relative change of the mean metric value
+ *    below which the number of bins is increased, for (UseAdaptiveNumberOfHistogramBins "true").\n
+ *    example: <tt>(AdaptiveHistogramBinsTolerance 0.005)</tt> \n
+ *    The default is 0.01. Can be given for each resolution, or for all resolutions at once.
  *
  * \sa ParzenWindowMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -190,15 +227,39 @@ public:
 
   /** Update the CurrenIteration. This is only important
    * if a finite difference derivative estimation is used
-   * (selected by the experimental parameter FiniteDifferenceDerivative)  */
+   * (selected by the experimental parameter FiniteDifferenceDerivative).
+   * Increase the number of histogram bins when the metric value has settled,
+   * if UseAdaptiveNumberOfHistogramBins is true. */
   void
   AfterEachIteration(void) override;
 
+  /** Get the value, and record it for the adaptive number of histogram bins. */
+  MeasureType
+  GetValue(const ParametersType & parameters) const override;
+
+  /** Get the value and derivative, and record the value for the adaptive number of histogram bins. */
+  void
+  GetValueAndDerivative(const ParametersType & parameters,
+                        MeasureType &          value,
+                        DerivativeType &       derivative) const override;
+
   /** Set up a timer to measure the initialization time and
    * call the Superclass' implementation. */
   void
   Initialize(void) override;
 
+  /** Copies keep the number of histogram bins of the start of a resolution, so the metric
+   * is not copied when that number is adapted during the resolution. */
+  typename ITKBaseType::Pointer
+  CreateWorkUnitCostFunction(const unsigned int metricIndex) override
+  {
+    if (this->m_UseAdaptiveNumberOfHistogramBins)
+    {
+      return nullptr;
+    }
+    return this->Superclass2::CreateWorkUnitCostFunction(metricIndex);
+  }
+
   /** Set/Get c. For finite difference derivative estimation */
   itkSetMacro(Param_c, double);
   itkGetConstMacro(Param_c, double);
@@ -235,6 +296,24 @@ private:
 
   double m_Param_c;
   double m_Param_gamma;
+
+  /** The state of the adaptive number of histogram bins. The target numbers of bins
+   * are the configured ones; the metric values are summed over the current interval.
+   */
+  bool           m_UseAdaptiveNumberOfHistogramBins;
+  unsigned long  m_TargetNumberOfFixedHistogramBins;
+  unsigned long  m_TargetNumberOfMovingHistogramBins;
+  unsigned int   m_AdaptiveHistogramBinsInterval;
+  double         m_AdaptiveHistogramBinsTolerance;
+  unsigned int   m_NumberOfIterationsInInterval;
+  double         m_PreviousMeanValue;
+  bool           m_PreviousMeanValueValid;
+  mutable double m_SumOfValues;
+  mutable double m_NumberOfValues;
+
+  /** Adds a metric value to the current interval. */
+  void
+  RecordValue(const MeasureType value) const;
 };
 
 } // end namespace elastix
@@ -22,6 +22,8 @@
 
 #include "itkHardLimiterFunction.h"
 #include "itkExponentialLimiterFunction.h"
+#include <algorithm> // For max and min.
+#include <cmath>
 #include <string>
 #include "vnl/vnl_math.h"
 #include "itkTimeProbe.h"
@@ -41,6 +43,17 @@ AdvancedMattesMutualInformationMetric<TElastix>::AdvancedMattesMutualInformation
   this->m_Param_gamma = 0.101;
   this->SetUseDerivative(true);
 
+  this->m_UseAdaptiveNumberOfHistogramBins = false;
+  this->m_TargetNumberOfFixedHistogramBins = 32;
+  this->m_TargetNumberOfMovingHistogramBins = 32;
+  this->m_AdaptiveHistogramBinsInterval = 25;
+  this->m_AdaptiveHistogramBinsTolerance = 0.01;
+  this->m_NumberOfIterationsInInterval = 0;
+  this->m_PreviousMeanValue = 0.0;
+  this->m_PreviousMeanValueValid = false;
+  this->m_SumOfValues = 0.0;
+  this->m_NumberOfValues = 0.0;
+
 } // end Constructor()
 
 
@@ -59,6 +72,19 @@ AdvancedMattesMutualInformationMetric<TElastix>::Initialize(void)
   elxout << "Initialization of AdvancedMattesMutualInformation metric took: "
          << static_cast<long>(timer.GetMean() * 1000) << " ms." << std::endl;
 
+  if (this->GetUseDerivative() && this->GetUseExplicitPDFDerivatives() && !this->GetComputeExplicitPDFDerivatives())
+  {
+    elxout << "  The joint histogram derivatives exceed MaximumJointPDFDerivativesMemory, "
+           << "so the low memory version is used." << std::endl;
+  }
+  else if (this->m_JointPDFDerivatives.IsNotNull())
+  {
+    const auto * const pixelContainer = this->m_JointPDFDerivatives->GetPixelContainer();
+    elxout << "  The joint histogram derivatives take "
+           << pixelContainer->Size() * sizeof(*pixelContainer->GetBufferPointer()) / (1024 * 1024) << " MB."
+           << std::endl;
+  }
+
 } // end Initialize()
 
 
@@ -89,6 +115,38 @@ AdvancedMattesMutualInformationMetric<TElastix>::BeforeEachResolution(void)
   this->SetNumberOfFixedHistogramBins(numberOfFixedHistogramBins);
   this->SetNumberOfMovingHistogramBins(numberOfMovingHistogramBins);
 
+  /** Start with fewer bins, when they are increased as the metric value settles. */
+  this->m_UseAdaptiveNumberOfHistogramBins = false;
+  this->GetConfiguration()->ReadParameter(this->m_UseAdaptiveNumberOfHistogramBins,
+                                          "UseAdaptiveNumberOfHistogramBins",
+                                          this->GetComponentLabel(),
+                                          level,
+                                          0);
+  if (this->m_UseAdaptiveNumberOfHistogramBins)
+  {
+    unsigned int initialNumberOfHistogramBins = 8;
+    this->m_AdaptiveHistogramBinsInterval = 25;
+    this->m_AdaptiveHistogramBinsTolerance = 0.01;
+    this->GetConfiguration()->ReadParameter(
+      initialNumberOfHistogramBins, "InitialNumberOfHistogramBins", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(
+      this->m_AdaptiveHistogramBinsInterval, "AdaptiveHistogramBinsInterval", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(
+      this->m_AdaptiveHistogramBinsTolerance, "AdaptiveHistogramBinsTolerance", this->GetComponentLabel(), level, 0);
+    this->m_AdaptiveHistogramBinsInterval = std::max(this->m_AdaptiveHistogramBinsInterval, 1u);
+
+    this->m_TargetNumberOfFixedHistogramBins = this->GetNumberOfFixedHistogramBins();
+    this->m_TargetNumberOfMovingHistogramBins = this->GetNumberOfMovingHistogramBins();
+    this->SetNumberOfFixedHistogramBins(
+      std::min<unsigned long>(initialNumberOfHistogramBins, this->m_TargetNumberOfFixedHistogramBins));
+    this->SetNumberOfMovingHistogramBins(
+      std::min<unsigned long>(initialNumberOfHistogramBins, this->m_TargetNumberOfMovingHistogramBins));
+  }
+  this->m_NumberOfIterationsInInterval = 0;
+  this->m_PreviousMeanValueValid = false;
+  this->m_SumOfValues = 0.0;
+  this->m_NumberOfValues = 0.0;
+
   /** Set limiters. */
   typedef itk::HardLimiterFunction<RealType, FixedImageDimension>         FixedLimiterType;
   typedef itk::ExponentialLimiterFunction<RealType, MovingImageDimension> MovingLimiterType;
@@ -121,6 +179,19 @@ AdvancedMattesMutualInformationMetric<TElastix>::BeforeEachResolution(void)
     useFastAndLowMemoryVersion, "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0);
   this->SetUseExplicitPDFDerivatives(!useFastAndLowMemoryVersion);
 
+  /** Set the memory budget of the explicit joint histogram derivatives, in megabytes. */
+  unsigned long maximumJointPDFDerivativesMemory = 0;
+  this->GetConfiguration()->ReadParameter(
+    maximumJointPDFDerivativesMemory, "MaximumJointPDFDerivativesMemory", this->GetComponentLabel(), level, 0);
+  this->SetMaximumJointPDFDerivativesMemory(static_cast<itk::SizeValueType>(maximumJointPDFDerivativesMemory) *
+                                            1024 * 1024);
+
+  /** Set whether the moving Parzen window values are interpolated from tables. */
+  bool useParzenWindowLookUpTables = false;
+  this->GetConfiguration()->ReadParameter(
+    useParzenWindowLookUpTables, "UseParzenWindowLookUpTables", this->GetComponentLabel(), level, 0);
+  this->SetUseParzenWindowLookUpTables(useParzenWindowLookUpTables);
+
   /** Set whether to use Nick Tustison's preconditioning technique. */
   bool useJacobianPreconditioning = false;
   this->GetConfiguration()->ReadParameter(
@@ -162,9 +233,100 @@ AdvancedMattesMutualInformationMetric<TElastix>::AfterEachIteration(void)
     this->m_CurrentIteration++;
     this->SetFiniteDifferencePerturbation(this->Compute_c(this->m_CurrentIteration));
   }
+
+  /** Nothing to do when the configured numbers of bins are reached. */
+  if (!this->m_UseAdaptiveNumberOfHistogramBins ||
+      (this->GetNumberOfFixedHistogramBins() >= this->m_TargetNumberOfFixedHistogramBins &&
+       this->GetNumberOfMovingHistogramBins() >= this->m_TargetNumberOfMovingHistogramBins))
+  {
+    return;
+  }
+
+  /** Compare the mean metric value of this interval to that of the previous one. */
+  ++this->m_NumberOfIterationsInInterval;
+  if (this->m_NumberOfIterationsInInterval < this->m_AdaptiveHistogramBinsInterval || this->m_NumberOfValues == 0.0)
+  {
+    return;
+  }
+  const double meanValue = this->m_SumOfValues / this->m_NumberOfValues;
+  const bool   settled =
+    this->m_PreviousMeanValueValid && std::abs(meanValue - this->m_PreviousMeanValue) <=
+                                        this->m_AdaptiveHistogramBinsTolerance * std::abs(this->m_PreviousMeanValue);
+  this->m_PreviousMeanValue = meanValue;
+  this->m_PreviousMeanValueValid = true;
+  this->m_NumberOfIterationsInInterval = 0;
+  this->m_SumOfValues = 0.0;
+  this->m_NumberOfValues = 0.0;
+  if (!settled)
+  {
+    return;
+  }
+
+  /** Double the numbers of bins. The metric values with different numbers of bins
+   * are not comparable, so the next interval is not compared to this one.
+   */
+  const unsigned long numberOfFixedHistogramBins =
+    std::min(2 * this->GetNumberOfFixedHistogramBins(), this->m_TargetNumberOfFixedHistogramBins);
+  const unsigned long numberOfMovingHistogramBins =
+    std::min(2 * this->GetNumberOfMovingHistogramBins(), this->m_TargetNumberOfMovingHistogramBins);
+  this->UpdateNumberOfHistogramBins(numberOfFixedHistogramBins, numberOfMovingHistogramBins);
+  this->m_PreviousMeanValueValid = false;
+
+  elxout << "  The number of histogram bins of " << this->GetComponentLabel() << " is increased to "
+         << numberOfFixedHistogramBins << " (fixed) and " << numberOfMovingHistogramBins
+         << " (moving), after iteration " << this->m_Elastix->GetIterationCounter() << "." << std::endl;
+
 } // end AfterEachIteration()
 
 
+/**
+ * ************************** GetValue *************************
+ */
+
+template <class TElastix>
+typename AdvancedMattesMutualInformationMetric<TElastix>::MeasureType
+AdvancedMattesMutualInformationMetric<TElastix>::GetValue(const ParametersType & parameters) const
+{
+  const MeasureType value = this->Superclass1::GetValue(parameters);
+  this->RecordValue(value);
+  return value;
+
+} // end GetValue()
+
+
+/**
+ * ************************** GetValueAndDerivative *************************
+ */
+
+template <class TElastix>
+void
+AdvancedMattesMutualInformationMetric<TElastix>::GetValueAndDerivative(const ParametersType & parameters,
+                                                                       MeasureType &          value,
+                                                                       DerivativeType &       derivative) const
+{
+  this->Superclass1::GetValueAndDerivative(parameters, value, derivative);
+  this->RecordValue(value);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ************************** RecordValue *************************
+ */
+
+template <class TElastix>
+void
+AdvancedMattesMutualInformationMetric<TElastix>::RecordValue(const MeasureType value) const
+{
+  if (this->m_UseAdaptiveNumberOfHistogramBins)
+  {
+    this->m_SumOfValues += value;
+    this->m_NumberOfValues += 1.0;
+  }
+
+} // end RecordValue()
+
+
 /**
  * ************************** Compute_c *************************
  */
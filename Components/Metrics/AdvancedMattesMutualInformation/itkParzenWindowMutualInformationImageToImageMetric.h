@@ -181,6 +181,7 @@ protected:
   typedef typename Superclass::ParzenValueContainerType            ParzenValueContainerType;
   typedef typename Superclass::KernelFunctionType                  KernelFunctionType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::OffsetValueType                     OffsetValueType;
 
   /**  Get the value and analytic derivative.
    * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -282,6 +283,17 @@ private:
                             const NonZeroJacobianIndicesType & nzji,
                             DerivativeType &                   derivative) const;
 
+  /** Version of UpdateDerivativeLowMemory() that gets the lowest affected fixed
+   * histogram bin and the fixed Parzen values, instead of the fixed image value.
+   */
+  void
+  UpdateDerivativeLowMemoryWithFixedParzenValues(const OffsetValueType              fixedParzenWindowIndex,
+                                                 const PDFValueType *               fixedParzenValues,
+                                                 const RealType &                   movingImageValue,
+                                                 const DerivativeType &             imageJacobian,
+                                                 const NonZeroJacobianIndicesType & nzji,
+                                                 DerivativeType &                   derivative) const;
+
   /** Helper function to compute m_PRatioArray in case of low memory consumption. */
   void
   ComputeValueAndPRatioArray(double & MI) const;
@@ -27,10 +27,6 @@
 #include "vnl/vnl_inverse.h"
 #include "vnl/vnl_det.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 namespace itk
 {
 /**
@@ -43,6 +39,9 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage,
 {
   this->m_UseJacobianPreconditioning = false;
 
+  /** GetValueAndAnalyticDerivativeLowMemory() does not need the explicit PDF derivatives. */
+  this->m_LowMemoryDerivativeSupported = true;
+
   /** Initialize the m_ParzenWindowHistogramThreaderParameters. */
   this->m_ParzenWindowMutualInformationThreaderParameters.m_Metric = this;
 
@@ -61,7 +60,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Init
   this->Superclass::InitializeHistograms();
 
   /** Allocate small amount of memory for the m_PRatioArray. */
-  if (!this->GetUseExplicitPDFDerivatives())
+  if (!this->GetComputeExplicitPDFDerivatives())
   {
     this->m_PRatioArray.SetSize(this->GetNumberOfFixedHistogramBins(), this->GetNumberOfMovingHistogramBins());
   }
@@ -145,7 +144,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::GetV
   DerivativeType &       derivative) const
 {
   /** Low memory variant. */
-  if (!this->GetUseExplicitPDFDerivatives())
+  if (!this->GetComputeExplicitPDFDerivatives())
   {
     this->GetValueAndAnalyticDerivativeLowMemory(parameters, value, derivative);
     return;
@@ -343,15 +342,14 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Comp
       fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
       movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
 
-      /** Get the transform Jacobian dT/dmu. */
-      this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
-
-      /** Compute the inner product (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
+      /** Compute the inner product (dM/dx)^T (dT/dmu), like the multi-threaded version. */
+      this->EvaluateSampleJacobianWithImageGradientProduct(
+        fiter.Index(), fixedPoint, movingImageDerivative, imageJacobian, nzji);
 
       /** If desired, apply the technique introduced by Tustison. */
       if (this->GetUseJacobianPreconditioning())
       {
+        this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
         this->ComputeJacobianPreconditioner(jacobian, nzji, jacobianPreconditioner, preconditioningDivisor);
         DerivativeValueType * imjacit = imageJacobian.begin();
         DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
@@ -449,115 +447,125 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Thre
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
 
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
-  fbegin += (int)pos_begin;
-  fend += (int)pos_end;
-
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for (fiter = fbegin; fiter != fend; ++fiter)
+  /** Process the ranges of samples that are assigned to this thread. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end = 0;
+  while (this->GetNextSampleRange(threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and create some variables. */
-    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImageDerivativeType   movingImageDerivative;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
-
-    /** Check if the point is inside the moving mask. */
-    if (sampleOk)
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator fiter;
+    typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator fend = sampleContainer->Begin();
+    fbegin += (int)pos_begin;
+    fend += (int)pos_end;
+
+    /** Loop over sample container and compute contribution of each sample to pdfs. */
+    for (fiter = fbegin; fiter != fend; ++fiter)
     {
-      sampleOk = this->IsInsideMovingMask(mappedPoint);
-    }
+      /** Read fixed coordinates and create some variables. */
+      const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+      RealType                    movingImageValue;
+      MovingImageDerivativeType   movingImageDerivative;
+      MovingImagePointType        mappedPoint;
 
-    /** Compute the moving image value, its derivative, and check
-     * if the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
-    }
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformSamplePoint(fiter.Index(), fixedPoint, mappedPoint);
 
-    if (sampleOk)
-    {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+      /** Check if the point is inside the moving mask. */
+      if (sampleOk)
+      {
+        sampleOk = this->IsInsideMovingMask(mappedPoint);
+      }
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
+      /** Compute the moving image value, its derivative, and check
+       * if the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      }
+
+      if (sampleOk)
+      {
+        /** Make sure the moving image value falls within the histogram range.
+         * The fixed image value is limited below, unless its cached Parzen values are used.
+         */
+        movingImageValue = this->GetMovingImageLimiter()->Evaluate(movingImageValue, movingImageDerivative);
 
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        this->EvaluateSampleJacobianWithImageGradientProduct(
+          fiter.Index(), fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** If desired, apply the technique introduced by Tustison. */
-      TransformJacobianType jacobian;
-      if (this->GetUseJacobianPreconditioning())
-      {
-        this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
-
-        this->ComputeJacobianPreconditioner(jacobian, nzji, jacobianPreconditioner, preconditioningDivisor);
-        DerivativeValueType * imjacit = imageJacobian.begin();
-        DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
-        for (unsigned int i = 0; i < nzji.size(); ++i)
+        /** If desired, apply the technique introduced by Tustison. */
+        TransformJacobianType jacobian;
+        if (this->GetUseJacobianPreconditioning())
         {
-          while (imjacit != imageJacobian.end())
+          this->EvaluateTransformJacobian(fixedPoint, jacobian, nzji);
+
+          this->ComputeJacobianPreconditioner(jacobian, nzji, jacobianPreconditioner, preconditioningDivisor);
+          DerivativeValueType * imjacit = imageJacobian.begin();
+          DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
+          for (unsigned int i = 0; i < nzji.size(); ++i)
           {
-            (*imjacit) *= (*jacprecit);
-            ++imjacit;
-            ++jacprecit;
+            while (imjacit != imageJacobian.end())
+            {
+              (*imjacit) *= (*jacprecit);
+              ++imjacit;
+              ++jacprecit;
+            }
           }
         }
-      }
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(fixedImageValue, movingImageValue, imageJacobian, nzji, derivative);
+        /** Compute this sample's contribution to the joint distributions. */
+        if (this->m_FixedImageSampleCacheValid)
+        {
+          const SizeValueType sampleIndex = fiter.Index();
+          this->UpdateDerivativeLowMemoryWithFixedParzenValues(
+            this->m_FixedParzenWindowIndexCache[sampleIndex],
+            &this->m_FixedParzenValuesCache[sampleIndex * this->m_JointPDFWindow.GetSize()[1]],
+            movingImageValue,
+            imageJacobian,
+            nzji,
+            derivative);
+        }
+        else
+        {
+          const RealType fixedImageValue =
+            this->GetFixedImageLimiter()->Evaluate(static_cast<RealType>((*fiter).Value().m_ImageValue));
+          this->UpdateDerivativeLowMemory(fixedImageValue, movingImageValue, imageJacobian, nzji, derivative);
+        }
 
-    } // end sampleOk
-  }   // end loop over sample container
+      } // end sampleOk
+    }   // end loop over sample container
 
-  /** If desired, apply the technique introduced by Tustison. */
-  if (this->GetUseJacobianPreconditioning())
-  {
-    DerivativeValueType * derivit = derivative.begin();
-    DerivativeValueType * divisit = preconditioningDivisor.begin();
-
-    /** This normalization was not in the Tustison paper, but it helps,
-     * especially for localized mutual information.
-     */
-    const double normalizationFactor = preconditioningDivisor.mean();
-    while (derivit != derivative.end())
+    /** If desired, apply the technique introduced by Tustison. */
+    if (this->GetUseJacobianPreconditioning())
     {
-      (*derivit) *= normalizationFactor / ((*divisit) + 1e-14);
-      ++derivit;
-      ++divisit;
+      DerivativeValueType * derivit = derivative.begin();
+      DerivativeValueType * divisit = preconditioningDivisor.begin();
+
+      /** This normalization was not in the Tustison paper, but it helps,
+       * especially for localized mutual information.
+       */
+      const double normalizationFactor = preconditioningDivisor.mean();
+      while (derivit != derivative.end())
+      {
+        (*derivit) *= normalizationFactor / ((*divisit) + 1e-14);
+        ++derivit;
+        ++divisit;
+      }
     }
-  }
+  } // end while over the sample ranges
 
 } // end ThreadedComputeDerivativeLowMemory()
 
@@ -583,33 +591,14 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Afte
       derivative += this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative;
     }
   }
-#ifdef ELASTIX_USE_OPENMP
-  // compute multi-threadedly with openmp
-  else if (false) // this->m_UseOpenMP )
-  {
-    const int spaceDimension = static_cast<int>(this->GetNumberOfParameters());
-
-#  pragma omp parallel for
-    for (int j = 0; j < spaceDimension; ++j)
-    {
-      DerivativeValueType sum = this->m_GetValueAndDerivativePerThreadVariables[0].st_Derivative[j];
-      for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-      {
-        sum += this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
-      }
-      derivative[j] = sum;
-    }
-  }
-#endif
   // compute multi-threadedly with itk threads
   else
   {
     this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
   }
 
 } // end AfterThreadedComputeDerivativeLowMemory()
@@ -647,13 +636,15 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage,
                                                 TMovingImage>::LaunchComputeDerivativeLowMemoryThreaderCallback(void)
   const
 {
-  /** Setup threader. */
-  this->m_Threader->SetSingleMethod(
+  /** Distribute the samples over the threads. */
+  this->InitializeSampleScheduler(this->GetImageSampler()->GetOutput()->Size());
+
+  /** Setup threader and launch. */
+  this->LaunchThreaderCallback(
     this->ComputeDerivativeLowMemoryThreaderCallback,
     const_cast<void *>(static_cast<const void *>(&this->m_ParzenWindowMutualInformationThreaderParameters)));
 
-  /** Launch. */
-  this->m_Threader->SingleMethodExecute();
+  this->FinalizeSampleScheduler();
 
 } // end LaunchComputeDerivativeLowMemoryThreaderCallback()
 
@@ -760,37 +751,63 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Upda
 
   /** Determine the affected region. */
 
-  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]). */
   const double fixedImageParzenWindowTerm =
     fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
-  const double movingImageParzenWindowTerm =
-    movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
 
-  /** The lowest bin numbers affected by this pixel: */
+  /** The lowest bin number affected by this pixel: */
   const int fixedParzenWindowIndex =
     static_cast<int>(std::floor(fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset));
+
+  /** Compute the fixed Parzen values, on the stack to avoid an allocation per sample. */
+  PDFValueType fixedParzenValues[Superclass::MaximumParzenWindowSize];
+  this->m_FixedKernel->Evaluate(static_cast<double>(fixedParzenWindowIndex) - fixedImageParzenWindowTerm,
+                                fixedParzenValues);
+
+  this->UpdateDerivativeLowMemoryWithFixedParzenValues(
+    fixedParzenWindowIndex, fixedParzenValues, movingImageValue, imageJacobian, nzji, derivative);
+
+} // end UpdateDerivativeLowMemory()
+
+
+/**
+ * *************** UpdateDerivativeLowMemoryWithFixedParzenValues ***************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::
+  UpdateDerivativeLowMemoryWithFixedParzenValues(const OffsetValueType              fixedParzenWindowIndex,
+                                                 const PDFValueType *               fixedParzenValues,
+                                                 const RealType &                   movingImageValue,
+                                                 const DerivativeType &             imageJacobian,
+                                                 const NonZeroJacobianIndicesType & nzji,
+                                                 DerivativeType &                   derivative) const
+{
+  /** Determine the Parzen window argument (see eq. 6 of Mattes paper [2]). */
+  const double movingImageParzenWindowTerm =
+    movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin number affected by this pixel: */
   const int movingParzenWindowIndex =
     static_cast<int>(std::floor(movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset));
 
-  /** Compute the fixed Parzen values. */
-  ParzenValueContainerType fixedParzenValues(this->m_JointPDFWindow.GetSize()[1]);
-  this->EvaluateParzenValues(
-    fixedImageParzenWindowTerm, fixedParzenWindowIndex, this->m_FixedKernel, fixedParzenValues);
-
   /** Compute the derivatives of the moving Parzen window. */
-  ParzenValueContainerType derivativeMovingParzenValues(this->m_JointPDFWindow.GetSize()[0]);
-  this->EvaluateParzenValues(
-    movingImageParzenWindowTerm, movingParzenWindowIndex, this->m_DerivativeMovingKernel, derivativeMovingParzenValues);
+  const unsigned int numberOfMovingParzenValues = this->m_JointPDFWindow.GetSize()[0];
+  PDFValueType       derivativeMovingParzenValues[Superclass::MaximumParzenWindowSize];
+  this->EvaluateDerivativeMovingParzenValues(
+    movingImageParzenWindowTerm, movingParzenWindowIndex, derivativeMovingParzenValues);
 
   /** Get the moving image bin size. */
   const double et = static_cast<double>(this->m_MovingImageBinSize);
 
   /** Loop over the Parzen window region and increment sum. */
-  PDFValueType sum = 0.0;
-  for (unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f)
+  const unsigned int numberOfFixedParzenValues = this->m_JointPDFWindow.GetSize()[1];
+  PDFValueType       sum = 0.0;
+  for (unsigned int f = 0; f < numberOfFixedParzenValues; ++f)
   {
     const double fv_et = fixedParzenValues[f] / et;
-    for (unsigned int m = 0; m < derivativeMovingParzenValues.GetSize(); ++m)
+    for (unsigned int m = 0; m < numberOfMovingParzenValues; ++m)
     {
       sum += this->m_PRatioArray[f + fixedParzenWindowIndex][m + movingParzenWindowIndex] * fv_et *
              derivativeMovingParzenValues[m];
@@ -816,7 +833,7 @@ ParzenWindowMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Upda
     }
   }
 
-} // end UpdateDerivativeLowMemory()
+} // end UpdateDerivativeLowMemoryWithFixedParzenValues()
 
 
 /**
@@ -78,13 +78,6 @@ AdvancedMeanSquaresMetric<TElastix>::BeforeEachResolution(void)
     selfHessianNoiseRange, "SelfHessianNoiseRange", this->GetComponentLabel(), level, 0);
   this->SetSelfHessianNoiseRange(selfHessianNoiseRange);
 
-  /** Select the use of an OpenMP implementation for GetValueAndDerivative. */
-  std::string useOpenMP = this->m_Configuration->GetCommandLineArgument("-useOpenMP_SSD");
-  if (useOpenMP == "true")
-  {
-    this->SetUseOpenMP(true);
-  }
-
 } // end BeforeEachResolution()
 
 
@@ -19,11 +19,14 @@
 #define itkAdvancedMeanSquaresImageToImageMetric_h
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkSampleOrderedAccumulator.h"
 
 #include "itkSmoothingRecursiveGaussianImageFilter.h"   // needed for SelfHessian
 #include "itkImageGridSampler.h"                        // needed for SelfHessian
 #include "itkNearestNeighborInterpolateImageFunction.h" // needed for SelfHessian
 
+#include <atomic>
+
 namespace itk
 {
 
@@ -151,6 +154,21 @@ public:
   void
   GetSelfHessian(const TransformParametersType & parameters, HessianType & H) const override;
 
+  /** This metric supports asynchronous gradient descent, since its derivative
+   * is a plain sum over the samples. */
+  bool
+  GetSupportsAsynchronousGradientDescent(void) const override
+  {
+    return true;
+  }
+
+  /** Experimental: one pass of asynchronous stochastic gradient descent over the
+   * samples, see the superclass. */
+  void
+  AsynchronousGradientDescent(TransformParametersType & parameters,
+                              const double              stepSize,
+                              MeasureType &             value) const override;
+
   /** Default: 1.0 mm */
   itkSetMacro(SelfHessianSmoothingSigma, double);
   itkGetConstMacro(SelfHessianSmoothingSigma, double);
@@ -180,13 +198,6 @@ public:
   itkSetMacro(UseNormalization, bool);
   itkGetConstMacro(UseNormalization, bool);
 
-  /** If the compiler supports OpenMP, this flag specifies whether
-   * or not to use it. For this metric we have an OpenMP variant for
-   * GetValueAndDerivative(). It is also used at other places.
-   * Note that MS Visual Studio and gcc support OpenMP.
-   */
-  itkSetMacro(UseOpenMP, bool);
-
 protected:
   AdvancedMeanSquaresImageToImageMetric();
   ~AdvancedMeanSquaresImageToImageMetric() override = default;
@@ -242,6 +253,12 @@ protected:
   inline void
   AfterThreadedGetValue(MeasureType & value) const override;
 
+  /** Let the transform use the parameters and update the sampler, like the superclass,
+   * and size the per thread buffers of the batch Jacobians.
+   */
+  void
+  BeforeThreadedGetValueAndDerivative(const TransformParametersType & parameters) const override;
+
   /** Get value and derivatives for each thread. */
   inline void
   ThreadedGetValueAndDerivative(ThreadIdType threadID) override;
@@ -250,6 +267,46 @@ protected:
   inline void
   AfterThreadedGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
 
+  /** Update the shared parameters with the batches of samples of each thread. */
+  void
+  ThreadedAsynchronousGradientDescent(ThreadIdType threadID, double * parameters, const double sampleStepSize);
+
+  /** Subtracts the update from the parameter with a relaxed atomic read-modify-write,
+   * in the way of std::atomic_ref, which is not available in C++11. */
+  static void
+  AtomicSubtract(double & parameter, const double update);
+
+  /** The struct that is passed to the threads of AsynchronousGradientDescent(). */
+  struct AsynchronousGradientDescentParameterType
+  {
+    Self *   st_Metric;
+    double * st_Parameters;
+    double   st_SampleStepSize;
+  };
+
+  /** The callback of AsynchronousGradientDescent(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  AsynchronousGradientDescentThreaderCallback(void * arg);
+
+  /** Compute the value with the deterministic reduction; called by GetValue(). */
+  MeasureType
+  DeterministicGetValue(void) const;
+
+  /** Compute the value and derivative with the deterministic reduction; called by GetValueAndDerivative(). */
+  void
+  DeterministicGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const;
+
+  /** The struct that is passed to the threads that add the sample contributions to the derivative. */
+  struct DeterministicAccumulateParameterType
+  {
+    const Self *          st_Metric;
+    DerivativeValueType * st_DerivativePointer;
+  };
+
+  /** The callback that adds the sample contributions to a range of parameters of the derivative. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  DeterministicAccumulateThreaderCallback(void * arg);
+
 private:
   AdvancedMeanSquaresImageToImageMetric(const Self &) = delete;
   void
@@ -259,6 +316,23 @@ private:
   double       m_SelfHessianSmoothingSigma;
   double       m_SelfHessianNoiseRange;
   unsigned int m_NumberOfSamplesForSelfHessian;
+
+  /** The contributions of the current block of samples, while the deterministic reduction is active. */
+  typedef SampleOrderedAccumulator<DerivativeValueType, typename NonZeroJacobianIndicesType::value_type>
+                                       SampleOrderedAccumulatorType;
+  mutable SampleOrderedAccumulatorType m_SampleOrderedAccumulator;
+  mutable bool                         m_DeterministicReductionActive;
+
+  /** The image Jacobians and their nonzero Jacobian indices of the valid samples of a batch.
+   * There is one per thread, sized by BeforeThreadedGetValueAndDerivative(), so that the
+   * threads do not allocate them in every iteration.
+   */
+  struct BatchJacobiansType
+  {
+    DerivativeType             st_ImageJacobians[Superclass::SampleBatchSize];
+    NonZeroJacobianIndicesType st_NonZeroJacobianIndices[Superclass::SampleBatchSize];
+  };
+  mutable std::vector<BatchJacobiansType> m_BatchJacobians;
 };
 
 } // end namespace itk
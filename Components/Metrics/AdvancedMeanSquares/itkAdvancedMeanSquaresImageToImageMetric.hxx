@@ -21,11 +21,6 @@
 #include "itkAdvancedMeanSquaresImageToImageMetric.h"
 #include "vnl/algo/vnl_matrix_update.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkComputeImageExtremaFilter.h"
-
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
 
 namespace itk
 {
@@ -40,9 +35,23 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AdvancedMeanSq
   this->SetUseImageSampler(true);
   this->SetUseFixedImageLimiter(false);
   this->SetUseMovingImageLimiter(false);
+  this->SetUseSparseDerivativeAccumulation(true);
+
+  /** The multi-threaded code reads the samples through GetNextSampleBatch(). */
+  this->m_ImplicitSamplesSupported = true;
+
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
+
+  /** The threaded GetValue() and GetValueAndDerivative() add their sums over the processes. */
+  this->m_DistributedSampleEvaluationSupported = true;
+
+  /** The threaded GetValue() and GetValueAndDerivative() can add the samples in sample order. */
+  this->m_DeterministicReductionSupported = true;
 
   this->m_UseNormalization = false;
   this->m_NormalizationFactor = 1.0;
+  this->m_DeterministicReductionActive = false;
 
   /** SelfHessian related variables, experimental feature. */
   this->m_SelfHessianSmoothingSigma = 1.0;
@@ -67,31 +76,13 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::Initialize(voi
 
   if (this->GetUseNormalization())
   {
-    /** Try to guess a normalization factor. */
-    typedef typename itk::ComputeImageExtremaFilter<FixedImageType> ComputeFixedImageExtremaFilterType;
-    typename ComputeFixedImageExtremaFilterType::Pointer            computeFixedImageExtrema =
-      ComputeFixedImageExtremaFilterType::New();
-    computeFixedImageExtrema->SetInput(this->GetFixedImage());
-    computeFixedImageExtrema->SetImageRegion(this->GetFixedImageRegion());
-    if (this->m_FixedImageMask.IsNotNull())
-    {
-      computeFixedImageExtrema->SetUseMask(true);
-      const FixedImageMaskSpatialObject2Type * fmask =
-        dynamic_cast<const FixedImageMaskSpatialObject2Type *>(this->m_FixedImageMask.GetPointer());
-      if (fmask)
-      {
-        computeFixedImageExtrema->SetImageSpatialMask(fmask);
-      }
-      else
-      {
-        computeFixedImageExtrema->SetImageMask(this->GetFixedImageMask());
-      }
-    }
-
-    computeFixedImageExtrema->Update();
-
-    this->m_FixedImageTrueMax = computeFixedImageExtrema->GetMaximum();
-    this->m_FixedImageTrueMin = computeFixedImageExtrema->GetMinimum();
+    /** Try to guess a normalization factor. The image extrema are cached, so
+     * they are shared with InitializeLimiters() and with the other metrics. */
+    this->m_ImageExtremaCache->GetExtrema(this->GetFixedImage(),
+                                          this->GetFixedImageRegion(),
+                                          this->GetFixedImageMask(),
+                                          this->m_FixedImageTrueMin,
+                                          this->m_FixedImageTrueMax);
 
     this->m_FixedImageMinLimit = static_cast<FixedImageLimiterOutputType>(
       this->m_FixedImageTrueMin -
@@ -100,30 +91,11 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::Initialize(voi
       this->m_FixedImageTrueMax +
       this->m_FixedLimitRangeRatio * (this->m_FixedImageTrueMax - this->m_FixedImageTrueMin));
 
-    typedef typename itk::ComputeImageExtremaFilter<MovingImageType> ComputeMovingImageExtremaFilterType;
-    typename ComputeMovingImageExtremaFilterType::Pointer            computeMovingImageExtrema =
-      ComputeMovingImageExtremaFilterType::New();
-    computeMovingImageExtrema->SetInput(this->GetMovingImage());
-    computeMovingImageExtrema->SetImageRegion(this->GetMovingImage()->GetBufferedRegion());
-    if (this->m_MovingImageMask.IsNotNull())
-    {
-      computeMovingImageExtrema->SetUseMask(true);
-      const MovingImageMaskSpatialObject2Type * mMask =
-        dynamic_cast<const MovingImageMaskSpatialObject2Type *>(this->m_MovingImageMask.GetPointer());
-      if (mMask)
-      {
-        computeMovingImageExtrema->SetImageSpatialMask(mMask);
-      }
-      else
-      {
-        computeMovingImageExtrema->SetImageMask(this->GetMovingImageMask());
-      }
-    }
-
-    computeMovingImageExtrema->Update();
-
-    this->m_MovingImageTrueMax = computeMovingImageExtrema->GetMaximum();
-    this->m_MovingImageTrueMin = computeMovingImageExtrema->GetMinimum();
+    this->m_ImageExtremaCache->GetExtrema(this->GetMovingImage(),
+                                          this->GetMovingImage()->GetBufferedRegion(),
+                                          this->GetMovingImageMask(),
+                                          this->m_MovingImageTrueMin,
+                                          this->m_MovingImageTrueMax);
 
     this->m_MovingImageMinLimit = static_cast<MovingImageLimiterOutputType>(
       this->m_MovingImageTrueMin -
@@ -132,8 +104,6 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::Initialize(voi
       this->m_MovingImageTrueMax +
       this->m_MovingLimitRangeRatio * (this->m_MovingImageTrueMax - this->m_MovingImageTrueMin));
 
-    // TODO: we may actually reuse these values from AdvancedImageToImageMetric::InitializeLimiters
-    // without recomputing them here.
     const double diff1 = this->m_FixedImageTrueMax - this->m_MovingImageTrueMin;
     const double diff2 = this->m_MovingImageTrueMax - this->m_FixedImageTrueMin;
     const double maxdiff = std::max(diff1, diff2);
@@ -295,6 +265,12 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
+  /** Add the contributions of the samples in sample order, if requested. */
+  if (this->m_UseDeterministicReduction)
+  {
+    return this->DeterministicGetValue();
+  }
+
   /** Launch multi-threading metric */
   this->LaunchGetValueThreaderCallback();
 
@@ -317,68 +293,55 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetVal
 {
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend += (int)pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure = NumericTraits<MeasureType>::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Process the batches of samples that are assigned to this thread. The
+   * points of each batch are mapped by a single call to the transform.
+   */
+  typename Superclass::SampleBatchType batch;
+  while (this->GetNextSampleBatch(threadId, *sampleContainer, batch))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
-
-    /** Check if point is inside mask. */
-    if (sampleOk)
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
     {
-      sampleOk = this->IsInsideMovingMask(mappedPoint); // thread-safe?
-    }
+      /** Read the mapped point and initialize some variables. */
+      const MovingImagePointType & mappedPoint = batch.st_MappedPoints[b];
+      RealType                     movingImageValue;
 
-    /** Compute the moving image value M(T(x)) and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
-    }
+      /** Check if point is inside mask. */
+      bool sampleOk = !batch.st_Rejected[b] && this->IsInsideMovingMask(mappedPoint); // thread-safe?
 
-    if (sampleOk)
-    {
-      numberOfPixelsCounted++;
+      /** Compute the moving image value M(T(x)) and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr);
+      }
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>((*threader_fiter).Value().m_ImageValue);
+      if (sampleOk)
+      {
+        numberOfPixelsCounted++;
 
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
+        /** The difference squared. */
+        const RealType diff = movingImageValue - batch.st_FixedImageValues[b];
+        if (this->m_DeterministicReductionActive)
+        {
+          this->m_SampleOrderedAccumulator.SetSampleMeasure(batch.st_Begin + b - this->m_SampleSchedulerFirstSample,
+                                                            diff * diff);
+        }
+        else
+        {
+          measure += diff * diff;
+        }
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the batch
+  } // end while over the sample batches
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -407,9 +370,15 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
     this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
   }
 
-  /** Check if enough samples were valid. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
+  /** Add the number of pixels of the other processes, if any. */
+  const bool distributed = this->IsSampleEvaluationDistributed();
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(this->m_NumberOfPixelsCounted);
+  }
+
+  /** Check if enough samples were valid. The samples may be implicit. */
+  this->CheckNumberOfSamples(this->GetNumberOfImageSamples(), this->m_NumberOfPixelsCounted);
 
   /** The normalization factor. */
   DerivativeValueType normal_sum =
@@ -426,6 +395,11 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
   }
   value *= normal_sum;
 
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(&value, 1);
+  }
+
 } // end AfterThreadedGetValue()
 
 
@@ -600,6 +574,12 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDer
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
+  /** Add the contributions of the samples in sample order, if requested. */
+  if (this->m_UseDeterministicReduction)
+  {
+    return this->DeterministicGetValueAndDerivative(value, derivative);
+  }
+
   /** Launch multi-threading metric */
   this->LaunchGetValueAndDerivativeThreaderCallback();
 
@@ -610,18 +590,42 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDer
 
 
 /**
- * ******************* ThreadedGetValueAndDerivative *******************
+ * ******************* BeforeThreadedGetValueAndDerivative *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(ThreadIdType threadId)
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::BeforeThreadedGetValueAndDerivative(
+  const TransformParametersType & parameters) const
 {
-  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
+  Superclass::BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** The buffers keep their memory, unless the number of nonzero Jacobian indices changes. */
   const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
-  NonZeroJacobianIndicesType   nzji = NonZeroJacobianIndicesType(nnzji);
-  DerivativeType               imageJacobian(nnzji);
+  this->m_BatchJacobians.resize(Self::GetNumberOfWorkUnits());
+  for (BatchJacobiansType & batchJacobians : this->m_BatchJacobians)
+  {
+    for (unsigned int b = 0; b < Superclass::SampleBatchSize; ++b)
+    {
+      if (batchJacobians.st_ImageJacobians[b].GetSize() != nnzji)
+      {
+        batchJacobians.st_ImageJacobians[b].SetSize(nnzji);
+        batchJacobians.st_NonZeroJacobianIndices[b].resize(nnzji);
+      }
+    }
+  }
+
+} // end BeforeThreadedGetValueAndDerivative()
 
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(ThreadIdType threadId)
+{
   /** Get a handle to the pre-allocated derivative for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
@@ -631,81 +635,103 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetVal
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend += (int)pos_end;
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure = NumericTraits<MeasureType>::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Buffers for the valid samples of a batch. */
+  typedef typename Superclass::AdvancedTransformType::MovingImageGradientType MovingImageGradientType;
+
+  const unsigned int                 batchSize = Superclass::SampleBatchSize;
+  SizeValueType                      validSampleIndices[batchSize];
+  FixedImagePointType                validFixedPoints[batchSize];
+  RealType                           validFixedImageValues[batchSize];
+  RealType                           validMovingImageValues[batchSize];
+  MovingImageGradientType            validMovingImageDerivatives[batchSize];
+  DerivativeType * const             imageJacobians = this->m_BatchJacobians[threadId].st_ImageJacobians;
+  NonZeroJacobianIndicesType * const nzjis = this->m_BatchJacobians[threadId].st_NonZeroJacobianIndices;
+
+  /** Process the batches of samples that are assigned to this thread. The
+   * points of each batch are mapped by a single call to the transform, and
+   * the Jacobian products of its valid samples are computed by another one.
+   */
+  typename Superclass::SampleBatchType batch;
+  while (this->GetNextSampleBatch(threadId, *sampleContainer, batch))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
+    /** Loop over the batch to evaluate the moving image, and collect the valid samples. */
+    unsigned int numberOfValidSamples = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      /** Read the mapped point and initialize some variables. */
+      const MovingImagePointType & mappedPoint = batch.st_MappedPoints[b];
+      RealType                     movingImageValue;
+      MovingImageDerivativeType    movingImageDerivative;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
+      /** Check if point is inside mask. */
+      bool sampleOk = !batch.st_Rejected[b] && this->IsInsideMovingMask(mappedPoint); // thread-safe?
 
-    /** Check if point is inside mask. */
-    if (sampleOk)
-    {
-      sampleOk = this->IsInsideMovingMask(mappedPoint); // thread-safe?
-    }
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      }
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
+      if (sampleOk)
+      {
+        validSampleIndices[numberOfValidSamples] = batch.st_Begin + b;
+        validFixedPoints[numberOfValidSamples] = batch.st_FixedPoints[b];
+        validFixedImageValues[numberOfValidSamples] = batch.st_FixedImageValues[b];
+        validMovingImageValues[numberOfValidSamples] = movingImageValue;
+        validMovingImageDerivatives[numberOfValidSamples] = movingImageDerivative;
+        ++numberOfValidSamples;
+      }
+    } // end for loop over the batch
+
+    numberOfPixelsCounted += numberOfValidSamples;
+
+    /** Compute the inner products of the transform Jacobian dT/dmu and the moving image gradient dM/dx,
+     * per sample when the Jacobians are shared with other metrics through the cache.
      */
-    if (sampleOk)
+    if (this->m_TransformEvaluationCacheActive)
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      for (unsigned int v = 0; v < numberOfValidSamples; ++v)
+      {
+        this->EvaluateSampleJacobianWithImageGradientProduct(
+          validSampleIndices[v], validFixedPoints[v], validMovingImageDerivatives[v], imageJacobians[v], nzjis[v]);
+      }
     }
-
-    if (sampleOk)
+    else
     {
-      numberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>((*threader_fiter).Value().m_ImageValue);
-
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
-#endif
-
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(fixedImageValue, movingImageValue, imageJacobian, nzji, measure, derivative);
-
-    } // end if sampleOk
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProducts(
+        validFixedPoints, validMovingImageDerivatives, imageJacobians, nzjis, numberOfValidSamples);
+    }
 
-  } // end for loop over the image sample container
+    /** Compute the contributions of the valid samples to the measure and derivatives,
+     * or store them per sample for the deterministic reduction.
+     */
+    for (unsigned int v = 0; v < numberOfValidSamples; ++v)
+    {
+      if (this->m_DeterministicReductionActive)
+      {
+        const RealType diff = validMovingImageValues[v] - validFixedImageValues[v];
+        this->m_SampleOrderedAccumulator.SetSample(validSampleIndices[v] - this->m_SampleSchedulerFirstSample,
+                                                   diff * diff,
+                                                   diff * 2.0,
+                                                   imageJacobians[v],
+                                                   nzjis[v],
+                                                   imageJacobians[v].GetSize());
+      }
+      else
+      {
+        this->UpdateValueAndDerivativeTerms(
+          validFixedImageValues[v], validMovingImageValues[v], imageJacobians[v], nzjis[v], measure, derivative);
+        this->MarkTouchedDerivativeBlocks(threadId, nzjis[v]);
+      }
+    }
+  } // end while over the sample batches
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -736,9 +762,15 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
     this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
   }
 
-  /** Check if enough samples were valid. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
+  /** Add the number of pixels of the other processes, if any. */
+  const bool distributed = this->IsSampleEvaluationDistributed();
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(this->m_NumberOfPixelsCounted);
+  }
+
+  /** Check if enough samples were valid. The samples may be implicit. */
+  this->CheckNumberOfSamples(this->GetNumberOfImageSamples(), this->m_NumberOfPixelsCounted);
 
   /** The normalization factor. */
   DerivativeValueType normal_sum =
@@ -766,35 +798,403 @@ AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedG
     }
   }
   // compute multi-threadedly with itk threads
-  else if (true) // force ITK threads !this->m_UseOpenMP )
+  else
   {
     this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0 / normal_sum;
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
   }
-#ifdef ELASTIX_USE_OPENMP
-  // compute multi-threadedly with openmp
-  else
+
+  /** Add the value and the derivative of the other processes, if any. */
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(&value, 1);
+    ProcessGroup::SumOverProcesses(derivative.data_block(), derivative.GetSize());
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* DeterministicGetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::MeasureType
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::DeterministicGetValue(void) const
+{
+  /** Distribute the samples over the threads, and over the processes. */
+  this->InitializeSampleScheduler(this->GetNumberOfImageSamples(), true);
+
+  /** The threads store the measure of every sample of this process. */
+  this->m_SampleOrderedAccumulator.Initialize(
+    this->m_SampleSchedulerNumberOfSamples - this->m_SampleSchedulerFirstSample, 0);
+  this->m_DeterministicReductionActive = true;
+  this->LaunchThreaderCallback(this->GetValueThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+  this->m_DeterministicReductionActive = false;
+  this->FinalizeSampleScheduler();
+
+  /** Gather the number of pixels from all threads; adding integers is exact. */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  this->m_NumberOfPixelsCounted = 0;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
-    const int spaceDimension = static_cast<int>(this->GetNumberOfParameters());
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
+  }
+
+  /** Add the measures in sample order. */
+  MeasureType value = static_cast<MeasureType>(this->m_SampleOrderedAccumulator.SumMeasures());
+
+  const bool distributed = this->IsSampleEvaluationDistributed();
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(this->m_NumberOfPixelsCounted);
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(this->GetNumberOfImageSamples(), this->m_NumberOfPixelsCounted);
+
+  value *= this->m_NormalizationFactor / static_cast<MeasureType>(this->m_NumberOfPixelsCounted);
 
-#  pragma omp parallel for
-    for (int j = 0; j < spaceDimension; ++j)
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(&value, 1);
+  }
+  return value;
+
+} // end DeterministicGetValue()
+
+
+/**
+ * ******************* DeterministicGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::DeterministicGetValueAndDerivative(
+  MeasureType &    value,
+  DerivativeType & derivative) const
+{
+  /** The samples are processed in blocks of a fixed size, which limits the memory
+   * that is needed to store their contributions. The blocks do not depend on the
+   * number of threads, so neither does the order in which the contributions are added.
+   */
+  const SizeValueType          blockSize = 8192;
+  const ThreadIdType           numberOfThreads = Self::GetNumberOfWorkUnits();
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+
+  /** Distribute the samples over the threads, and over the processes. */
+  this->InitializeSampleScheduler(this->GetNumberOfImageSamples(), true);
+  const SizeValueType firstSample = this->m_SampleSchedulerFirstSample;
+  const SizeValueType endSample = this->m_SampleSchedulerNumberOfSamples;
+
+  if (derivative.GetSize() != numberOfParameters)
+  {
+    derivative.SetSize(numberOfParameters);
+  }
+  derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+  value = NumericTraits<MeasureType>::Zero;
+  this->m_NumberOfPixelsCounted = 0;
+
+  DeterministicAccumulateParameterType userData;
+  userData.st_Metric = this;
+  userData.st_DerivativePointer = derivative.data_block();
+
+  this->m_DeterministicReductionActive = true;
+  for (SizeValueType blockBegin = firstSample; blockBegin < endSample; blockBegin += blockSize)
+  {
+    const SizeValueType blockEnd = std::min(blockBegin + blockSize, endSample);
+    this->RestrictSampleScheduler(blockBegin, blockEnd);
+    this->m_SampleOrderedAccumulator.Initialize(blockEnd - blockBegin, nnzji);
+
+    /** The threads store the contributions of the samples of the block, in any order. */
+    this->LaunchThreaderCallback(this->GetValueAndDerivativeThreaderCallback,
+                                 const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+    /** Add them in sample order. The threads divide the parameters. */
+    value += static_cast<MeasureType>(this->m_SampleOrderedAccumulator.SumMeasures());
+    this->LaunchThreaderCallback(this->DeterministicAccumulateThreaderCallback, &userData);
+
+    /** Gather the number of pixels from all threads; adding integers is exact. */
+    for (ThreadIdType i = 0; i < numberOfThreads; ++i)
     {
-      DerivativeValueType tmp = NumericTraits<DerivativeValueType>::Zero;
-      for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+      this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+      this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
+      this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
+    }
+  }
+  this->m_DeterministicReductionActive = false;
+  this->RestrictSampleScheduler(firstSample, endSample);
+  this->FinalizeSampleScheduler();
+
+  const bool distributed = this->IsSampleEvaluationDistributed();
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(this->m_NumberOfPixelsCounted);
+  }
+
+  /** Check if enough samples were valid. The samples may be implicit. */
+  this->CheckNumberOfSamples(this->GetNumberOfImageSamples(), this->m_NumberOfPixelsCounted);
+
+  /** Normalize the value and the derivative. */
+  const DerivativeValueType normal_sum =
+    this->m_NormalizationFactor / static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
+  value *= normal_sum;
+  for (NumberOfParametersType j = 0; j < numberOfParameters; ++j)
+  {
+    derivative[j] *= normal_sum;
+  }
+
+  /** Add the value and the derivative of the other processes, if any. */
+  if (distributed)
+  {
+    ProcessGroup::SumOverProcesses(&value, 1);
+    ProcessGroup::SumOverProcesses(derivative.data_block(), derivative.GetSize());
+  }
+
+} // end DeterministicGetValueAndDerivative()
+
+
+/**
+ * ******************* DeterministicAccumulateThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::DeterministicAccumulateThreaderCallback(void * arg)
+{
+  ThreadInfoType *   infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType threadId = infoStruct->WorkUnitID;
+  const ThreadIdType numberOfThreads = infoStruct->NumberOfWorkUnits;
+
+  const DeterministicAccumulateParameterType * temp =
+    static_cast<const DeterministicAccumulateParameterType *>(infoStruct->UserData);
+
+  /** Every thread adds the contributions to its own range of parameters [begin, end). */
+  typedef typename NonZeroJacobianIndicesType::value_type ParameterIndexType;
+  const ParameterIndexType numberOfParameters = temp->st_Metric->GetNumberOfParameters();
+  const ParameterIndexType begin = numberOfParameters * threadId / numberOfThreads;
+  const ParameterIndexType end = numberOfParameters * (threadId + 1) / numberOfThreads;
+  temp->st_Metric->m_SampleOrderedAccumulator.AccumulateDerivative(temp->st_DerivativePointer, begin, end);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end DeterministicAccumulateThreaderCallback()
+
+
+/**
+ * ******************* AsynchronousGradientDescent *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AsynchronousGradientDescent(
+  TransformParametersType & parameters,
+  const double              stepSize,
+  MeasureType &             value) const
+{
+  /** Let the transform use the parameters, and draw the samples of this pass. */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Distribute the samples over the threads. The mapped points and Jacobians
+   * change during the pass, so the transform evaluation cache cannot be used.
+   */
+  const SizeValueType numberOfSamples = this->GetNumberOfImageSamples();
+  this->InitializeSampleScheduler(numberOfSamples);
+  this->m_TransformEvaluationCacheActive = false;
+
+  /** Every sample gets its share of the step. The number of valid samples is only known
+   * after the pass, so the step is first divided over all samples, and the update is
+   * rescaled to the number of samples counted afterwards. A pass at constant parameters
+   * would then equal a single step along the derivative of GetValueAndDerivative(). The
+   * rescale is approximate, however: the later batches of the pass were mapped with the
+   * parameters that include the unscaled updates of the earlier ones.
+   */
+  const TransformParametersType initialParameters = parameters;
+  AsynchronousGradientDescentParameterType userData;
+  userData.st_Metric = const_cast<Self *>(this);
+  userData.st_Parameters = parameters.data_block();
+  userData.st_SampleStepSize =
+    stepSize * this->m_NormalizationFactor / static_cast<double>(std::max<SizeValueType>(numberOfSamples, 1));
+
+  this->LaunchThreaderCallback(this->AsynchronousGradientDescentThreaderCallback, &userData);
+
+  this->FinalizeSampleScheduler();
+
+  /** Gather the values from all threads. */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  this->m_NumberOfPixelsCounted = 0;
+  value = NumericTraits<MeasureType>::Zero;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+    value += this->m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+
+    /** Reset these variables for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
+
+  value *= this->m_NormalizationFactor / static_cast<MeasureType>(this->m_NumberOfPixelsCounted);
+
+  /** Normalize the update by the number of samples counted, instead of by the number of samples.
+   * The threads are done, so the parameters can be read and written without atomics here.
+   */
+  const double updateScale = static_cast<double>(std::max<SizeValueType>(numberOfSamples, 1)) /
+                             static_cast<double>(this->m_NumberOfPixelsCounted);
+  for (unsigned int j = 0; j < parameters.GetSize(); ++j)
+  {
+    parameters[j] = initialParameters[j] + updateScale * (parameters[j] - initialParameters[j]);
+  }
+
+} // end AsynchronousGradientDescent()
+
+
+/**
+ * ******************* AsynchronousGradientDescentThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_TYPE
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AsynchronousGradientDescentThreaderCallback(
+  void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+
+  AsynchronousGradientDescentParameterType * temp =
+    static_cast<AsynchronousGradientDescentParameterType *>(infoStruct->UserData);
+
+  temp->st_Metric->ThreadedAsynchronousGradientDescent(threadID, temp->st_Parameters, temp->st_SampleStepSize);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AsynchronousGradientDescentThreaderCallback()
+
+
+/**
+ * ******************* ThreadedAsynchronousGradientDescent *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedAsynchronousGradientDescent(
+  ThreadIdType threadId,
+  double *     parameters,
+  const double sampleStepSize)
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure = NumericTraits<MeasureType>::Zero;
+
+  /** Buffers for the valid samples of a batch. */
+  typedef typename Superclass::AdvancedTransformType::MovingImageGradientType MovingImageGradientType;
+
+  const unsigned int                 batchSize = Superclass::SampleBatchSize;
+  FixedImagePointType                validFixedPoints[batchSize];
+  RealType                           validFixedImageValues[batchSize];
+  RealType                           validMovingImageValues[batchSize];
+  MovingImageGradientType            validMovingImageDerivatives[batchSize];
+  DerivativeType * const             imageJacobians = this->m_BatchJacobians[threadId].st_ImageJacobians;
+  NonZeroJacobianIndicesType * const nzjis = this->m_BatchJacobians[threadId].st_NonZeroJacobianIndices;
+
+  /** Every batch is mapped with the parameters as they are when it is drawn,
+   * and its contributions are subtracted from the parameters right away. The
+   * threads do not lock: every element is updated with a relaxed atomic
+   * read-modify-write, so that no update gets lost on the overlapping supports
+   * of the samples. The transform, however, reads the parameters in place with
+   * plain loads, while the other threads update them. This race is deliberate,
+   * as in Hogwild: a batch may be mapped with a mix of old and new coefficients,
+   * and even, in theory, with a torn value of one of them, which asynchronous
+   * stochastic gradient descent tolerates as noise in the update.
+   */
+  typename Superclass::SampleBatchType batch;
+  while (this->GetNextSampleBatch(threadId, *sampleContainer, batch))
+  {
+    /** Loop over the batch to evaluate the moving image, and collect the valid samples. */
+    unsigned int numberOfValidSamples = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      const MovingImagePointType & mappedPoint = batch.st_MappedPoints[b];
+      RealType                     movingImageValue;
+      MovingImageDerivativeType    movingImageDerivative;
+
+      bool sampleOk = !batch.st_Rejected[b] && this->IsInsideMovingMask(mappedPoint);
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      }
+
+      if (sampleOk)
+      {
+        validFixedPoints[numberOfValidSamples] = batch.st_FixedPoints[b];
+        validFixedImageValues[numberOfValidSamples] = batch.st_FixedImageValues[b];
+        validMovingImageValues[numberOfValidSamples] = movingImageValue;
+        validMovingImageDerivatives[numberOfValidSamples] = movingImageDerivative;
+        ++numberOfValidSamples;
+      }
+    } // end for loop over the batch
+
+    numberOfPixelsCounted += numberOfValidSamples;
+
+    /** Compute the inner products of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+    this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProducts(
+      validFixedPoints, validMovingImageDerivatives, imageJacobians, nzjis, numberOfValidSamples);
+
+    /** Subtract the contributions of the valid samples from the parameters. */
+    for (unsigned int v = 0; v < numberOfValidSamples; ++v)
+    {
+      const RealType diff = validMovingImageValues[v] - validFixedImageValues[v];
+      measure += diff * diff;
+
+      const double                       factor = sampleStepSize * 2.0 * diff;
+      const DerivativeType &             sampleImageJacobian = imageJacobians[v];
+      const NonZeroJacobianIndicesType & sampleNzji = nzjis[v];
+      for (unsigned int i = 0; i < sampleImageJacobian.GetSize(); ++i)
       {
-        tmp += this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
+        Self::AtomicSubtract(parameters[sampleNzji[i]], factor * sampleImageJacobian[i]);
       }
-      derivative[j] = tmp * normal_sum;
     }
+  } // end while over the sample batches
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Value = measure;
+
+} // end ThreadedAsynchronousGradientDescent()
+
+
+/**
+ * ******************* AtomicSubtract *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AtomicSubtract(double &     parameter,
+                                                                                 const double update)
+{
+  static_assert(sizeof(std::atomic<double>) == sizeof(double) && alignof(std::atomic<double>) == alignof(double),
+                "std::atomic<double> must have the layout of double, to update the parameters in place.");
+
+  std::atomic<double> & atomicParameter = reinterpret_cast<std::atomic<double> &>(parameter);
+  double                expected = atomicParameter.load(std::memory_order_relaxed);
+  while (!atomicParameter.compare_exchange_weak(expected, expected - update, std::memory_order_relaxed))
+  {
   }
-#endif
 
-} // end AfterThreadedGetValueAndDerivative()
+} // end AtomicSubtract()
 
 
 /**
@@ -19,6 +19,7 @@
 #define itkAdvancedNormalizedCorrelationImageToImageMetric_h
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkCompensatedSummation.h"
 
 namespace itk
 {
@@ -215,6 +216,17 @@ protected:
                         DerivativeType &                   derivativeM,
                         DerivativeType &                   differential) const;
 
+  /** Compute a pixel's contribution to the derivative terms, which are
+   * interleaved per parameter as (derivativeF, derivativeM, differential).
+   * Called by ThreadedGetValueAndDerivative().
+   */
+  void
+  UpdateInterleavedDerivativeTerms(const RealType &                   fixedImageValue,
+                                   const RealType &                   movingImageValue,
+                                   const DerivativeType &             imageJacobian,
+                                   const NonZeroJacobianIndicesType & nzji,
+                                   DerivativeValueType *              derivativeTerms) const;
+
   /** Initialize some multi-threading related parameters.
    * Overrides function in AdvancedImageToImageMetric, because
    * here we use other parameters.
@@ -265,9 +277,10 @@ private:
     AccumulateType st_Sfm;
     AccumulateType st_Sf;
     AccumulateType st_Sm;
-    DerivativeType st_DerivativeF;
-    DerivativeType st_DerivativeM;
-    DerivativeType st_Differential;
+    /** The derivativeF, derivativeM and differential of every parameter are
+     * stored next to each other, so that a sample updates them in one place.
+     */
+    DerivativeType st_DerivativeTerms;
   };
   itkPadStruct(ITK_CACHE_LINE_ALIGNMENT,
                CorrelationGetValueAndDerivativePerThreadStruct,
@@ -20,10 +20,6 @@
 
 #include "itkAdvancedNormalizedCorrelationImageToImageMetric.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 namespace itk
 {
 
@@ -41,6 +37,9 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage,
   this->SetUseFixedImageLimiter(false);
   this->SetUseMovingImageLimiter(false);
 
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
+
   // Multi-threading structs
   this->m_CorrelationGetValueAndDerivativePerThreadVariables = nullptr;
   this->m_CorrelationGetValueAndDerivativePerThreadVariablesSize = 0;
@@ -98,13 +97,9 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Sfm = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Sf = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Sm = zero1;
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF.SetSize(this->GetNumberOfParameters());
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM.SetSize(this->GetNumberOfParameters());
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential.SetSize(
-      this->GetNumberOfParameters());
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF.Fill(zero2);
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM.Fill(zero2);
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential.Fill(zero2);
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeTerms.SetSize(
+      3 * this->GetNumberOfParameters());
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeTerms.Fill(zero2);
   }
 
 } // end InitializeThreadingParameters()
@@ -176,6 +171,50 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Upda
 } // end UpdateValueAndDerivativeTerms()
 
 
+/**
+ * *************** UpdateInterleavedDerivativeTerms ***************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::UpdateInterleavedDerivativeTerms(
+  const RealType &                   fixedImageValue,
+  const RealType &                   movingImageValue,
+  const DerivativeType &             imageJacobian,
+  const NonZeroJacobianIndicesType & nzji,
+  DerivativeValueType *              derivativeTerms) const
+{
+  /** Calculate the contributions to the derivatives with respect to each parameter. */
+  if (nzji.size() == this->GetNumberOfParameters())
+  {
+    /** Loop over all Jacobians. */
+    const DerivativeValueType * imjacit = imageJacobian.data_block();
+    const unsigned int          numberOfParameters = this->GetNumberOfParameters();
+    for (unsigned int mu = 0; mu < numberOfParameters; ++mu)
+    {
+      const RealType differentialtmp = imjacit[mu];
+      derivativeTerms[0] += fixedImageValue * differentialtmp;
+      derivativeTerms[1] += movingImageValue * differentialtmp;
+      derivativeTerms[2] += differentialtmp;
+      derivativeTerms += 3;
+    }
+  }
+  else
+  {
+    /** Only pick the nonzero Jacobians. */
+    for (unsigned int i = 0; i < imageJacobian.GetSize(); ++i)
+    {
+      DerivativeValueType * terms = derivativeTerms + 3 * nzji[i];
+      const RealType        differentialtmp = imageJacobian[i];
+      terms[0] += fixedImageValue * differentialtmp;
+      terms[1] += movingImageValue * differentialtmp;
+      terms[2] += differentialtmp;
+    }
+  }
+
+} // end UpdateInterleavedDerivativeTerms()
+
+
 /**
  * ******************* GetValue *******************
  */
@@ -529,112 +568,109 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Thre
   NonZeroJacobianIndicesType   nzji = NonZeroJacobianIndicesType(nnzji);
   DerivativeType               imageJacobian(nzji.size());
 
-  /** Get handles to the pre-allocated derivatives for the current thread.
+  /** Get a handle to the pre-allocated derivative terms for the current thread.
    * The initialization is performed at the beginning of each resolution in
    * InitializeThreadingParameters(), and at the end of each iteration in
-   * AfterThreadedGetValueAndDerivative() and the accumulate functions.
+   * the accumulate functions.
    */
-  DerivativeType & derivativeF = this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_DerivativeF;
-  DerivativeType & derivativeM = this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_DerivativeM;
-  DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Differential;
+  DerivativeValueType * derivativeTerms =
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_DerivativeTerms.data_block();
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads = static_cast<unsigned long>(
-    std::ceil(static_cast<double>(sampleContainerSize) / static_cast<double>(Self::GetNumberOfWorkUnits())));
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end = nrOfSamplesPerThreads * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend += (int)pos_end;
-
-  /** Create variables to store intermediate results. */
-  AccumulateType sff = NumericTraits<AccumulateType>::Zero;
-  AccumulateType smm = NumericTraits<AccumulateType>::Zero;
-  AccumulateType sfm = NumericTraits<AccumulateType>::Zero;
-  AccumulateType sf = NumericTraits<AccumulateType>::Zero;
-  AccumulateType sm = NumericTraits<AccumulateType>::Zero;
-  unsigned long  numberOfPixelsCounted = 0;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for (threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
+  /** Create variables to store intermediate results. The sums are compensated,
+   * since with many samples the squared image values differ a lot in magnitude
+   * from the running sums.
+   */
+  CompensatedSummation<AccumulateType> sff;
+  CompensatedSummation<AccumulateType> smm;
+  CompensatedSummation<AccumulateType> sfm;
+  CompensatedSummation<AccumulateType> sf;
+  CompensatedSummation<AccumulateType> sm;
+  unsigned long                        numberOfPixelsCounted = 0;
+
+  /** Process the ranges of samples that are assigned to this thread. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end = 0;
+  while (this->GetNextSampleRange(threadId, pos_begin, pos_end))
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator threader_fiter;
+    typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
+    threader_fbegin += (int)pos_begin;
+    threader_fend += (int)pos_end;
 
-    /** Check if point is inside mask. */
-    if (sampleOk)
+    /** Loop over the fixed image to calculate the mean squares. */
+    for (threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter)
     {
-      sampleOk = this->IsInsideMovingMask(mappedPoint);
-    }
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
+      RealType                    movingImageValue;
+      MovingImagePointType        mappedPoint;
+      MovingImageDerivativeType   movingImageDerivative;
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if (sampleOk)
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
-    }
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformSamplePoint(threader_fiter.Index(), fixedPoint, mappedPoint);
 
-    if (sampleOk)
-    {
-      numberOfPixelsCounted++;
+      /** Check if point is inside mask. */
+      if (sampleOk)
+      {
+        sampleOk = this->IsInsideMovingMask(mappedPoint);
+      }
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>((*threader_fiter).Value().m_ImageValue);
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+       * the point is inside the moving image buffer.
+       */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, &movingImageDerivative);
+      }
+
+      if (sampleOk)
+      {
+        numberOfPixelsCounted++;
+
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue = static_cast<RealType>((*threader_fiter).Value().m_ImageValue);
 
 #if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct(
+          jacobian, movingImageDerivative, imageJacobian );
 #else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji);
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        this->EvaluateSampleJacobianWithImageGradientProduct(
+          threader_fiter.Index(), fixedPoint, movingImageDerivative, imageJacobian, nzji);
 #endif
 
-      /** Update some sums needed to calculate the value of NC. */
-      sff += fixedImageValue * fixedImageValue;
-      smm += movingImageValue * movingImageValue;
-      sfm += fixedImageValue * movingImageValue;
-      sf += fixedImageValue;  // Only needed when m_SubtractMean == true
-      sm += movingImageValue; // Only needed when m_SubtractMean == true
+        /** Update some sums needed to calculate the value of NC. */
+        sff += fixedImageValue * fixedImageValue;
+        smm += movingImageValue * movingImageValue;
+        sfm += fixedImageValue * movingImageValue;
+        sf += fixedImageValue;  // Only needed when m_SubtractMean == true
+        sm += movingImageValue; // Only needed when m_SubtractMean == true
 
-      /** Compute this voxel's contribution to the derivative terms. */
-      this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji, derivativeF, derivativeM, differential);
+        /** Compute this voxel's contribution to the derivative terms. */
+        this->UpdateInterleavedDerivativeTerms(fixedImageValue, movingImageValue, imageJacobian, nzji, derivativeTerms);
 
-    } // end if sampleOk
+      } // end if sampleOk
 
-  } // end for loop over the image sample container
+    } // end for loop over the image sample container
+  } // end while over the sample ranges
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sff = sff;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Smm = smm;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sfm = sfm;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sf = sf;
-  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sm = sm;
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sff = sff.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Smm = smm.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sfm = sfm.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sf = sf.GetSum();
+  this->m_CorrelationGetValueAndDerivativePerThreadVariables[threadId].st_Sm = sm.GetSum();
 
 } // end ThreadedGetValueAndDerivative()
 
@@ -717,38 +753,27 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Afte
   // single-threaded
   if (!this->m_UseMultiThread && false) // force multi-threaded
   {
-    DerivativeType & derivativeF = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeF;
-    DerivativeType & derivativeM = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeM;
-    DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_Differential;
-
+    DerivativeType & derivativeTerms = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeTerms;
     for (ThreadIdType i = 1; i < numberOfThreads; ++i)
     {
-      derivativeF += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF;
-      derivativeM += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM;
-      differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential;
+      derivativeTerms += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeTerms;
     }
 
     /** If SubtractMean, then subtract things from  derivativeF and derivativeM. */
-    if (this->m_SubtractMean)
-    {
-      double diff, derF, derM;
-      for (unsigned int i = 0; i < this->GetNumberOfParameters(); ++i)
-      {
-        diff = differential[i];
-        derF = derivativeF[i] - (sf / N) * diff;
-        derM = derivativeM[i] - (sm / N) * diff;
-        derivative[i] = (derF - (sfm / smm) * derM) / denom;
-      }
-    }
-    else
+    for (unsigned int i = 0; i < this->GetNumberOfParameters(); ++i)
     {
-      for (unsigned int i = 0; i < this->GetNumberOfParameters(); ++i)
+      double derF = derivativeTerms[3 * i];
+      double derM = derivativeTerms[3 * i + 1];
+      if (this->m_SubtractMean)
       {
-        derivative[i] = (derivativeF[i] - (sfm / smm) * derivativeM[i]) / denom;
+        const double diff = derivativeTerms[3 * i + 2];
+        derF -= (sf / N) * diff;
+        derM -= (sm / N) * diff;
       }
+      derivative[i] = (derF - (sfm / smm) * derM) / denom;
     }
   }
-  else if (true) // force !this->m_UseOpenMP ) // multi-threaded using ITK threads
+  else // multi-threaded using ITK threads
   {
     MultiThreaderAccumulateDerivativeType * temp = new MultiThreaderAccumulateDerivativeType;
 
@@ -759,45 +784,10 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Afte
     temp->st_InvertedDenominator = 1.0 / denom;
     temp->st_DerivativePointer = derivative.begin();
 
-    this->m_Threader->SetSingleMethod(AccumulateDerivativesThreaderCallback, temp);
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(AccumulateDerivativesThreaderCallback, temp);
 
     delete temp;
   }
-#ifdef ELASTIX_USE_OPENMP
-  // compute multi-threadedly with openmp
-  else
-  {
-    const int            spaceDimension = static_cast<int>(this->GetNumberOfParameters());
-    const AccumulateType sf_N = sf / N;
-    const AccumulateType sm_N = sm / N;
-    const AccumulateType sfm_smm = sfm / smm;
-
-#  pragma omp parallel for
-    for (int j = 0; j < spaceDimension; ++j)
-    {
-      DerivativeValueType derivativeF = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeF[j];
-      DerivativeValueType derivativeM = this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeM[j];
-      DerivativeValueType differential =
-        this->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_Differential[j];
-
-      for (ThreadIdType i = 1; i < numberOfThreads; ++i)
-      {
-        derivativeF += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF[j];
-        derivativeM += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM[j];
-        differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential[j];
-      }
-
-      if (this->m_SubtractMean)
-      {
-        derivativeF -= sf_N * differential;
-        derivativeM -= sm_N * differential;
-      }
-
-      derivative[j] = (derivativeF - sfm_smm * derivativeM) / denom;
-    }
-  } // end OpenMP
-#endif
 
 } // end AfterThreadedGetValueAndDerivative()
 
@@ -831,30 +821,44 @@ AdvancedNormalizedCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Accu
   unsigned int jmax = (threadId + 1) * subSize;
   jmax = (jmax > numPar) ? numPar : jmax;
 
+  /** The derivative terms of this range of parameters form a contiguous block
+   * in the buffer of every thread. First add the blocks of the other threads
+   * to the block of the first thread, in a single pass over each buffer.
+   */
   const DerivativeValueType zero = NumericTraits<DerivativeValueType>::Zero;
-  DerivativeValueType       derivativeF, derivativeM, differential;
-  for (unsigned int j = jmin; j < jmax; ++j)
+  const unsigned int        kmin = 3 * jmin;
+  const unsigned int        kmax = 3 * jmax;
+  DerivativeValueType *     sumTerms =
+    temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[0].st_DerivativeTerms.data_block();
+  for (ThreadIdType i = 1; i < nrOfThreads; ++i)
   {
-    derivativeF = derivativeM = differential = zero;
-    for (ThreadIdType i = 0; i < nrOfThreads; ++i)
+    DerivativeValueType * threadTerms =
+      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeTerms.data_block();
+    for (unsigned int k = kmin; k < kmax; ++k)
     {
-      derivativeF += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF[j];
-      derivativeM += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM[j];
-      differential += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential[j];
+      sumTerms[k] += threadTerms[k];
 
       /** Reset these variables for the next iteration. */
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeF[j] = zero;
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_DerivativeM[j] = zero;
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[i].st_Differential[j] = zero;
+      threadTerms[k] = zero;
     }
+  }
 
+  /** Compute the derivative from the summed terms. */
+  for (unsigned int j = jmin; j < jmax; ++j)
+  {
+    DerivativeValueType * terms = sumTerms + 3 * j;
+    DerivativeValueType   derivativeF = terms[0];
+    DerivativeValueType   derivativeM = terms[1];
     if (subtractMean)
     {
-      derivativeF -= sf_N * differential;
-      derivativeM -= sm_N * differential;
+      derivativeF -= sf_N * terms[2];
+      derivativeM -= sm_N * terms[2];
     }
 
     temp->st_DerivativePointer[j] = (derivativeF - sfm_smm * derivativeM) * invertedDenominator;
+
+    /** Reset these variables for the next iteration. */
+    terms[0] = terms[1] = terms[2] = zero;
   }
 
   return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -39,6 +39,12 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "TransformBendingEnergyPenalty")</tt>
+ * \parameter UseGridBasedBendingEnergy: Whether the bending energy of a B-spline transform
+ *    of order 2 or 3 is computed exactly from its control point grid, instead of from the
+ *    samples. Only used without masks and without a composed initial transform, see
+ *    itk::TransformBendingEnergyPenaltyTerm. Can be given for each resolution.\n
+ *    example: <tt>(UseGridBasedBendingEnergy "false")</tt>\n
+ *    Default: true.
  *
  * \ingroup Metrics
  *
@@ -133,6 +139,7 @@ public:
   /**
    * Do some things before each resolution:
    * \li Set options for SelfHessian
+   * \li Set the UseGridBasedBendingEnergy option
    */
   void
   BeforeEachResolution(void) override;
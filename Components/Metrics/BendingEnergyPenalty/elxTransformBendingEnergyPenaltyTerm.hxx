@@ -38,6 +38,10 @@ TransformBendingEnergyPenalty<TElastix>::Initialize(void)
   timer.Stop();
   elxout << "Initialization of TransformBendingEnergy metric took: " << static_cast<long>(timer.GetMean() * 1000)
          << " ms." << std::endl;
+  if (this->GetGridBasedBendingEnergyActive())
+  {
+    elxout << "  The bending energy is computed from the B-spline grid." << std::endl;
+  }
 
 } // end Initialize()
 
@@ -59,6 +63,12 @@ TransformBendingEnergyPenalty<TElastix>::BeforeEachResolution(void)
     numberOfSamplesForSelfHessian, "NumberOfSamplesForSelfHessian", this->GetComponentLabel(), level, 0);
   this->SetNumberOfSamplesForSelfHessian(numberOfSamplesForSelfHessian);
 
+  /** Set whether the bending energy of a B-spline transform is computed from its grid. */
+  bool useGridBasedBendingEnergy = true;
+  this->GetConfiguration()->ReadParameter(
+    useGridBasedBendingEnergy, "UseGridBasedBendingEnergy", this->GetComponentLabel(), level, 0);
+  this->SetUseGridBasedBendingEnergy(useGridBasedBendingEnergy);
+
 } // end BeforeEachResolution()
 
 
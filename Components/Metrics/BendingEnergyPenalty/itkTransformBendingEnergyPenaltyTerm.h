@@ -20,6 +20,7 @@
 
 #include "itkTransformPenaltyTerm.h"
 #include "itkImageGridSampler.h"
+#include "itkBSplineGridIntegrals.h"
 
 namespace itk
 {
@@ -34,6 +35,18 @@ namespace itk
  * [1]. For rigid and affine transformation this energy is always
  * zero.
  *
+ * For an AdvancedBSplineDeformableTransform or RecursiveBSplineTransform of
+ * order 2 or 3, the bending energy is a quadratic form in the B-spline
+ * coefficients. On request, it is then computed exactly from the control point
+ * grid, as the mean over the fixed image domain: the integrals of the products
+ * of the shifted 1D B-splines and their derivatives form banded matrices, which
+ * are applied to the coefficients dimension by dimension. This takes in the
+ * order of the number of parameters, and no samples. This is the default; the
+ * samples are used for other transforms, when a fixed or moving image mask is given,
+ * when the B-spline transform is composed with an initial transform, or when
+ * the grid is rotated with respect to the fixed image.
+ * See SetUseGridBasedBendingEnergy().
+ *
  *
  * [1]: D. Rueckert, L. I. Sonoda, C. Hayes, D. L. G. Hill,
  *      M. O. Leach, and D. J. Hawkes, "Nonrigid registration
@@ -112,17 +125,24 @@ public:
   typedef typename Superclass::BSplineOrder3TransformPointer BSplineOrder3TransformPointer;
 
   /** Typedefs from the AdvancedTransform. */
-  typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
-  typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename Superclass::SpatialHessianType            SpatialHessianType;
-  typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename Superclass::InternalMatrixType            InternalMatrixType;
-  typedef typename Superclass::HessianValueType              HessianValueType;
-  typedef typename Superclass::HessianType                   HessianType;
+  typedef typename Superclass::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename Superclass::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename Superclass::SpatialHessianType                     SpatialHessianType;
+  typedef typename Superclass::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename Superclass::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename Superclass::InternalMatrixType                     InternalMatrixType;
+  typedef typename Superclass::HessianValueType                       HessianValueType;
+  typedef typename Superclass::HessianType                            HessianType;
 
   /** Define the dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
 
+  /** Initialize the penalty term, and set up the grid-based computation
+   * of the bending energy when the transform supports it. */
+  void
+  Initialize(void) override;
+
   /** Get the penalty term value. */
   MeasureType
   GetValue(const ParametersType & parameters) const override;
@@ -158,6 +178,16 @@ public:
   itkSetMacro(NumberOfSamplesForSelfHessian, unsigned int);
   itkGetConstMacro(NumberOfSamplesForSelfHessian, unsigned int);
 
+  /** Select the exact, grid-based computation for B-spline transforms, when
+   * possible. Takes effect at the next Initialize(). Default: true. */
+  itkSetMacro(UseGridBasedBendingEnergy, bool);
+  itkGetConstMacro(UseGridBasedBendingEnergy, bool);
+  itkBooleanMacro(UseGridBasedBendingEnergy);
+
+  /** Get whether the bending energy is computed from the control point grid
+   * in the current resolution. */
+  itkGetConstMacro(GridBasedBendingEnergyActive, bool);
+
 protected:
   /** Typedefs for indices and points. */
   typedef typename Superclass::FixedImageIndexType            FixedImageIndexType;
@@ -184,7 +214,23 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Compute the bending energy and, if asked for, its derivative from the
+   * control point grid. Returns false when the grid-based computation is not
+   * active, in which case the samples should be used. */
+  bool
+  GetValueAndDerivativeOnGrid(const ParametersType & parameters,
+                              MeasureType &          value,
+                              DerivativeType *       derivative) const;
+
   unsigned int m_NumberOfSamplesForSelfHessian;
+  bool         m_UseGridBasedBendingEnergy;
+
+  /** The grid-based computation of the current resolution. The weights
+   * include the mixed derivative factor, the grid spacing and the volume.
+   */
+  bool                                                                     m_GridBasedBendingEnergyActive;
+  BSplineGridIntegrals<ScalarType, FixedImageDimension>                    m_GridIntegrals;
+  FixedArray<FixedArray<double, FixedImageDimension>, FixedImageDimension> m_GridWeights;
 };
 
 } // end namespace itk
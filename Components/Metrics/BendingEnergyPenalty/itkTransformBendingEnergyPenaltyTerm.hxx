@@ -20,9 +20,8 @@
 
 #include "itkTransformBendingEnergyPenaltyTerm.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
+#include <algorithm> // For min and max.
+#include <vector>
 
 namespace itk
 {
@@ -38,12 +37,83 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::TransformBendingEne
 
   /** Turn on the sampler functionality. */
   this->SetUseImageSampler(true);
+  this->SetUseSparseDerivativeAccumulation(true);
+
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
 
   this->m_NumberOfSamplesForSelfHessian = 100000;
+  this->m_UseGridBasedBendingEnergy = true;
+  this->m_GridBasedBendingEnergyActive = false;
 
 } // end Constructor
 
 
+/**
+ * ****************** Initialize *******************************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::Initialize(void)
+{
+  /** Call the superclass' implementation. */
+  this->Superclass::Initialize();
+
+  this->m_GridBasedBendingEnergyActive = false;
+  if (!this->m_UseGridBasedBendingEnergy || this->GetFixedImageMask() != nullptr ||
+      this->GetMovingImageMask() != nullptr)
+  {
+    return;
+  }
+
+  /** Get the B-spline transform. An initial transform may only be added to
+   * it, and must not contribute to the bending energy.
+   */
+  const TransformType *            transform = this->m_AdvancedTransform.GetPointer();
+  const CombinationTransformType * combination = dynamic_cast<const CombinationTransformType *>(transform);
+  if (combination != nullptr)
+  {
+    const TransformType * initialTransform = combination->GetInitialTransform();
+    if (initialTransform != nullptr &&
+        (!combination->GetUseAddition() || initialTransform->GetHasNonZeroSpatialHessian()))
+    {
+      return;
+    }
+    transform = combination->GetCurrentTransform();
+  }
+
+  /** Only the B-splines of order 2 and 3 have a bending energy. */
+  if (!this->m_GridIntegrals.Initialize(transform, this->GetFixedImage(), this->GetFixedImageRegion(), 2, 2))
+  {
+    return;
+  }
+  if (FixedImageDimension * this->m_GridIntegrals.GetNumberOfGridPoints() !=
+      this->m_AdvancedTransform->GetNumberOfParameters())
+  {
+    return;
+  }
+
+  /** The weights of the terms of the Hessian, in the physical space, of
+   * which the mixed derivatives appear twice.
+   */
+  const typename BSplineGridIntegrals<ScalarType, FixedImageDimension>::SpacingType & gridSpacing =
+    this->m_GridIntegrals.GetGridSpacing();
+  const double volume = this->m_GridIntegrals.GetVolume();
+  for (unsigned int j = 0; j < FixedImageDimension; ++j)
+  {
+    for (unsigned int k = 0; k < FixedImageDimension; ++k)
+    {
+      const double multiplicity = j == k ? 1.0 : 2.0;
+      this->m_GridWeights[j][k] = multiplicity / (vnl_math::sqr(gridSpacing[j] * gridSpacing[k]) * volume);
+    }
+  }
+
+  this->m_GridBasedBendingEnergyActive = true;
+
+} // end Initialize()
+
+
 /**
  * ****************** GetValue *******************************
  */
@@ -63,6 +133,13 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValue(const Para
     return static_cast<MeasureType>(measure);
   }
 
+  /** Compute the bending energy from the grid, when possible. */
+  MeasureType gridValue = NumericTraits<MeasureType>::Zero;
+  if (this->GetValueAndDerivativeOnGrid(parameters, gridValue, nullptr))
+  {
+    return gridValue;
+  }
+
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
@@ -166,9 +243,10 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
   derivative = DerivativeType(this->GetNumberOfParameters());
   derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
 
-  SpatialHessianType           spatialHessian;
-  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
-  NonZeroJacobianIndicesType   nonZeroJacobianIndices;
+  SpatialHessianType                    spatialHessian;
+  JacobianOfSpatialHessianType          jacobianOfSpatialHessian;
+  SeparableJacobianOfSpatialHessianType separableJacobianOfSpatialHessian;
+  NonZeroJacobianIndicesType            nonZeroJacobianIndices;
   const NumberOfParametersType numberOfNonZeroJacobianIndices =
     this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
   jacobianOfSpatialHessian.resize(numberOfNonZeroJacobianIndices);
@@ -183,6 +261,12 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
   }
   // TODO: This is only required once! and not every iteration.
 
+  /** Compute the bending energy from the grid, when possible. */
+  if (this->GetValueAndDerivativeOnGrid(parameters, value, &derivative))
+  {
+    return;
+  }
+
   /** Check if this transform is a B-spline transform. */
   typename BSplineOrder3TransformType::Pointer dummy; // default-constructed (null)
   bool                                         transformIsBSpline = this->CheckForBSplineTransform2(dummy);
@@ -236,14 +320,17 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
       this->m_NumberOfPixelsCounted++;
 
       /** Get the spatial Hessian of the transformation at the current point.
-       * This is needed to compute the bending energy.
+       * This is needed to compute the bending energy. Prefer the separable form
+       * of its Jacobian, provided by B-spline transforms, which is a factor
+       * FixedImageDimension squared smaller than the dense form.
        */
-      //       this->m_AdvancedTransform->GetSpatialHessian( fixedPoint,
-      //         spatialHessian );
-      //       this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-      //         jacobianOfSpatialHessian, nonZeroJacobianIndices );
-      this->m_AdvancedTransform->GetJacobianOfSpatialHessian(
-        fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+      const bool isSeparable = this->m_AdvancedTransform->GetSeparableJacobianOfSpatialHessian(
+        fixedPoint, spatialHessian, separableJacobianOfSpatialHessian, nonZeroJacobianIndices);
+      if (!isSeparable)
+      {
+        this->m_AdvancedTransform->GetJacobianOfSpatialHessian(
+          fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+      }
 
       /** Prepare some stuff for the computation of the metric (derivative). */
       FixedArray<InternalMatrixType, FixedImageDimension> A;
@@ -259,7 +346,7 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
       }
 
       /** Make a distinction between a B-spline transform and other transforms. */
-      if (!transformIsBSpline)
+      if (!transformIsBSpline && !isSeparable)
       {
         /** Compute the contribution to the metric derivative of this point. */
         for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
@@ -309,7 +396,9 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
             const RealType matrixMean = element_product( A[ k ], B ).mean();
             *( basepointer3 + (*( basepointer2 + mu + numParPerDim * k )) )
               += 2.0 * matrixMean * Bsize;*/
-            const InternalMatrixType & B = jacobianOfSpatialHessian[mu + numParPerDim * k][k].GetVnlMatrix();
+            const InternalMatrixType & B = isSeparable
+                                             ? separableJacobianOfSpatialHessian[mu].GetVnlMatrix()
+                                             : jacobianOfSpatialHessian[mu + numParPerDim * k][k].GetVnlMatrix();
 
             RealType                                    matrixElementProduct = 0.0;
             typename InternalMatrixType::const_iterator itA = A[k].begin();
@@ -354,6 +443,12 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivati
                                                                                    MeasureType &          value,
                                                                                    DerivativeType & derivative) const
 {
+  /** Compute the bending energy from the grid, when possible. */
+  if (this->GetValueAndDerivativeOnGrid(parameters, value, &derivative))
+  {
+    return;
+  }
+
   /** Option for now to still use the single threaded code. */
   if (!this->m_UseMultiThread)
   {
@@ -393,9 +488,10 @@ void
 TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAndDerivative(ThreadIdType threadId)
 {
   /** Create and initialize some variables. */
-  SpatialHessianType           spatialHessian;
-  JacobianOfSpatialHessianType jacobianOfSpatialHessian;
-  NonZeroJacobianIndicesType   nonZeroJacobianIndices;
+  SpatialHessianType                    spatialHessian;
+  JacobianOfSpatialHessianType          jacobianOfSpatialHessian;
+  SeparableJacobianOfSpatialHessianType separableJacobianOfSpatialHessian;
+  NonZeroJacobianIndicesType            nonZeroJacobianIndices;
   const NumberOfParametersType numberOfNonZeroJacobianIndices =
     this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
   jacobianOfSpatialHessian.resize(numberOfNonZeroJacobianIndices);
@@ -470,10 +566,17 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAnd
       numberOfPixelsCounted++;
 
       /** Get the spatial Hessian of the transformation at the current point.
-       * This is needed to compute the bending energy.
+       * This is needed to compute the bending energy. Prefer the separable form
+       * of its Jacobian, provided by B-spline transforms, which is a factor
+       * FixedImageDimension squared smaller than the dense form.
        */
-      this->m_AdvancedTransform->GetJacobianOfSpatialHessian(
-        fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+      const bool isSeparable = this->m_AdvancedTransform->GetSeparableJacobianOfSpatialHessian(
+        fixedPoint, spatialHessian, separableJacobianOfSpatialHessian, nonZeroJacobianIndices);
+      if (!isSeparable)
+      {
+        this->m_AdvancedTransform->GetJacobianOfSpatialHessian(
+          fixedPoint, spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices);
+      }
 
       /** Prepare some stuff for the computation of the metric (derivative). */
       FixedArray<InternalMatrixType, FixedImageDimension> A;
@@ -489,7 +592,7 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAnd
       }
 
       /** Make a distinction between a B-spline transform and other transforms. */
-      if (!transformIsBSpline)
+      if (!transformIsBSpline && !isSeparable)
       {
         /** Compute the contribution to the metric derivative of this point. */
         for (unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu)
@@ -528,7 +631,9 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAnd
         const unsigned int numParPerDim = nonZeroJacobianIndices.size() / FixedImageDimension;
         for (unsigned int mu = 0; mu < numParPerDim; ++mu)
         {
-          const InternalMatrixType & B = jacobianOfSpatialHessian[mu + numParPerDim * 0][0].GetVnlMatrix();
+          const InternalMatrixType & B = isSeparable
+                                           ? separableJacobianOfSpatialHessian[mu].GetVnlMatrix()
+                                           : jacobianOfSpatialHessian[mu + numParPerDim * 0][0].GetVnlMatrix();
 
           for (unsigned int k = 0; k < FixedImageDimension; ++k)
           {
@@ -550,8 +655,10 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::ThreadedGetValueAnd
           }
         }
       } // end if B-spline
-    }   // end if sampleOk
-  }     // end for loop over the image sample container
+
+      this->MarkTouchedDerivativeBlocks(threadId, nonZeroJacobianIndices);
+    } // end if sampleOk
+  }   // end for loop over the image sample container
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -599,7 +706,6 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::AfterThreadedGetVal
 
   /** Accumulate derivatives. */
   // it seems that multi-threaded adding is faster than single-threaded
-  // it seems that openmp is faster than itk threads
   // compute single-threadedly
   if (!this->m_UseMultiThread)
   {
@@ -611,36 +717,15 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::AfterThreadedGetVal
     derivative /= static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
   }
   // compute multi-threadedly with itk threads
-  else if (!this->m_UseOpenMP || true) // force
+  else
   {
     this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor =
       static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
-    this->m_Threader->SingleMethodExecute();
-  }
-#ifdef ELASTIX_USE_OPENMP
-  // compute multi-threadedly with openmp
-  else
-  {
-    const DerivativeValueType numPix = static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
-    const int                 nthreads = static_cast<int>(numberOfThreads);
-    omp_set_num_threads(nthreads);
-    const int spaceDimension = static_cast<int>(this->GetNumberOfParameters());
-#  pragma omp parallel for
-    for (int j = 0; j < spaceDimension; ++j)
-    {
-      DerivativeValueType tmp = NumericTraits<DerivativeValueType>::Zero;
-      for (ThreadIdType i = 0; i < numberOfThreads; ++i)
-      {
-        tmp += this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
-      }
-      derivative[j] = tmp / numPix;
-    }
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
   }
-#endif
 
 } // end AfterThreadedGetValueAndDerivative()
 
@@ -815,6 +900,80 @@ TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetSelfHessian(cons
 } // end GetSelfHessian()
 
 
+/**
+ * ******************* GetValueAndDerivativeOnGrid *******************
+ */
+
+template <class TFixedImage, class TScalarType>
+bool
+TransformBendingEnergyPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivativeOnGrid(
+  const ParametersType & parameters,
+  MeasureType &          value,
+  DerivativeType *       derivative) const
+{
+  const SizeValueType numberOfGridPoints = this->m_GridIntegrals.GetNumberOfGridPoints();
+  if (!this->m_GridBasedBendingEnergyActive || parameters.GetSize() != FixedImageDimension * numberOfGridPoints)
+  {
+    return false;
+  }
+
+  if (derivative != nullptr)
+  {
+    derivative->SetSize(parameters.GetSize());
+    derivative->Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+  }
+
+  /** The bending energy is the sum over the components i and the derivatives
+   * j <= k of c_i^T K_jk c_i, where K_jk is the Kronecker product of the banded
+   * matrices of the derivative orders of the dimensions. The derivative is 2 K_jk c_i.
+   */
+  std::vector<double> buffer1(numberOfGridPoints);
+  std::vector<double> buffer2(numberOfGridPoints);
+  RealType            measure = NumericTraits<RealType>::Zero;
+  for (unsigned int i = 0; i < FixedImageDimension; ++i)
+  {
+    const double * coefficients = parameters.data_block() + i * numberOfGridPoints;
+    for (unsigned int j = 0; j < FixedImageDimension; ++j)
+    {
+      for (unsigned int k = j; k < FixedImageDimension; ++k)
+      {
+        /** Multiply with the matrices of all dimensions, alternating the buffers. */
+        const double * product = coefficients;
+        for (unsigned int d = 0; d < FixedImageDimension; ++d)
+        {
+          const unsigned int a = (d == j ? 1 : 0) + (d == k ? 1 : 0);
+          double *           output = d % 2 == 0 ? buffer1.data() : buffer2.data();
+          this->m_GridIntegrals.ApplyBandedMatrix(a, d, product, output);
+          product = output;
+        }
+
+        const double weight = this->m_GridWeights[j][k];
+        double       quadraticForm = 0.0;
+        for (SizeValueType p = 0; p < numberOfGridPoints; ++p)
+        {
+          quadraticForm += coefficients[p] * product[p];
+        }
+        measure += weight * quadraticForm;
+
+        if (derivative != nullptr)
+        {
+          DerivativeValueType * derivativeComponent = derivative->data_block() + i * numberOfGridPoints;
+          for (SizeValueType p = 0; p < numberOfGridPoints; ++p)
+          {
+            derivativeComponent[p] += 2.0 * weight * product[p];
+          }
+        }
+      }
+    }
+  }
+
+  value = static_cast<MeasureType>(measure);
+  return true;
+
+} // end GetValueAndDerivativeOnGrid()
+
+
+
 } // end namespace itk
 
 #endif // #ifndef itkTransformBendingEnergyPenaltyTerm_hxx
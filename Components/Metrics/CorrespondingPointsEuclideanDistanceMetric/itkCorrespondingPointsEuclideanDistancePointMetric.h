@@ -23,6 +23,8 @@
 #include "itkPointSet.h"
 #include "itkImage.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -31,6 +33,9 @@ namespace itk
  *  and a fixed point-set.
  *  Correspondence is needed.
  *
+ * The fixed points are transformed in one batch, after which the distances
+ * and their derivatives are computed by the threads. Every thread accumulates
+ * the sparse Jacobians of its points in its own derivative.
  *
  * \ingroup RegistrationMetrics
  */
@@ -75,6 +80,7 @@ public:
   typedef vnl_vector<CoordRepType>               VnlVectorType;
 
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
 
   /**  Get the value for single valued optimizers. */
   MeasureType
@@ -98,6 +104,44 @@ private:
   CorrespondingPointsEuclideanDistancePointMetric(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  /** The results of a single thread. */
+  struct PerThreadVariablesType
+  {
+    MeasureType    st_Value;
+    SizeValueType  st_NumberOfPointsCounted;
+    DerivativeType st_Derivative;
+  };
+
+  /** The struct that is passed to the threads. */
+  struct MultiThreaderParameterType
+  {
+    const Self *             st_Metric;
+    const InputPointType *   st_FixedPoints;
+    const InputPointType *   st_MovingPoints;
+    const OutputPointType *  st_MappedPoints;
+    SizeValueType            st_NumberOfPoints;
+    ThreadIdType             st_NumberOfWorkUnits;
+    bool                     st_ComputeDerivative;
+    PerThreadVariablesType * st_PerThreadVariables;
+  };
+
+  /** Compute the sum of the distances of all points and, optionally, its derivative.
+   * The transform parameters should already be set.
+   */
+  void
+  ComputeValueAndDerivative(MeasureType & value, DerivativeType & derivative, const bool computeDerivative) const;
+
+  /** Compute the contribution of the points in the range [begin, end). */
+  void
+  ComputeValueAndDerivativeRange(const MultiThreaderParameterType & parameters,
+                                 const SizeValueType                begin,
+                                 const SizeValueType                end,
+                                 PerThreadVariablesType &           variables) const;
+
+  /** The threader callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  ComputeValueAndDerivativeThreaderCallback(void * arg);
 };
 
 } // end namespace itk
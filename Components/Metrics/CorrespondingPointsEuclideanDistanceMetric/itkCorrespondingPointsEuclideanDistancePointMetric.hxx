@@ -29,8 +29,13 @@ namespace itk
 
 template <class TFixedPointSet, class TMovingPointSet>
 CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet,
-                                                TMovingPointSet>::CorrespondingPointsEuclideanDistancePointMetric() =
-  default; // end Constructor
+                                                TMovingPointSet>::CorrespondingPointsEuclideanDistancePointMetric()
+{
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
+
+} // end Constructor
+
 
 /**
  * ******************* GetValue *******************
@@ -54,57 +59,14 @@ CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>
     itkExceptionMacro(<< "Moving point set has not been assigned");
   }
 
-  /** Initialize some variables. */
-  this->m_NumberOfPointsCounted = 0;
-  MeasureType     measure = NumericTraits<MeasureType>::Zero;
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters(parameters);
 
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd = fixedPointSet->GetPoints()->End();
+  MeasureType    value = NumericTraits<MeasureType>::Zero;
+  DerivativeType dummyDerivative;
+  this->ComputeValueAndDerivative(value, dummyDerivative, false);
 
-  /** Loop over the corresponding points. */
-  while (pointItFixed != pointEnd)
-  {
-    /** Get the current corresponding points. */
-    fixedPoint = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    // bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint(fixedPoint);
-
-    /** Check if point is inside mask. */
-    bool sampleOk = true;
-    if (sampleOk)
-    {
-      // sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if (this->m_MovingImageMask.IsNotNull())
-      {
-        sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace(mappedPoint);
-      }
-    }
-
-    if (sampleOk)
-    {
-      this->m_NumberOfPointsCounted++;
-
-      VnlVectorType diffPoint = (movingPoint - mappedPoint).GetVnlVector();
-      measure += diffPoint.magnitude();
-
-    } // end if sampleOk
-
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
-
-  return measure / this->m_NumberOfPointsCounted;
+  return value;
 
 } // end GetValue()
 
@@ -154,17 +116,6 @@ CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>
     itkExceptionMacro(<< "Moving point set has not been assigned");
   }
 
-  /** Initialize some variables */
-  this->m_NumberOfPointsCounted = 0;
-  MeasureType measure = NumericTraits<MeasureType>::Zero;
-  derivative = DerivativeType(this->GetNumberOfParameters());
-  derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
-  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
-  TransformJacobianType      jacobian;
-
-  InputPointType  movingPoint;
-  OutputPointType fixedPoint, mappedPoint;
-
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
    *   this->GetImageSampler()->Update();
@@ -180,86 +131,177 @@ CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>
    */
   this->BeforeThreadedGetValueAndDerivative(parameters);
 
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointItMoving = movingPointSet->GetPoints()->Begin();
-  PointIterator pointEnd = fixedPointSet->GetPoints()->End();
+  this->ComputeValueAndDerivative(value, derivative, true);
 
-  /** Loop over the corresponding points. */
-  while (pointItFixed != pointEnd)
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ComputeValueAndDerivative *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>::ComputeValueAndDerivative(
+  MeasureType &    value,
+  DerivativeType & derivative,
+  const bool       computeDerivative) const
+{
+  /** Copy the corresponding points to contiguous arrays. */
+  const SizeValueType numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+
+  std::vector<InputPointType> fixedPoints(numberOfPoints);
+  std::vector<InputPointType> movingPoints(numberOfPoints);
+
+  PointIterator pointItFixed = this->GetFixedPointSet()->GetPoints()->Begin();
+  PointIterator pointItMoving = this->GetMovingPointSet()->GetPoints()->Begin();
+  for (SizeValueType i = 0; i < numberOfPoints; ++i, ++pointItFixed, ++pointItMoving)
   {
-    /** Get the current corresponding points. */
-    fixedPoint = pointItFixed.Value();
-    movingPoint = pointItMoving.Value();
+    fixedPoints[i] = pointItFixed.Value();
+    movingPoints[i] = pointItMoving.Value();
+  }
+
+  /** Transform all fixed points in one batch. */
+  std::vector<OutputPointType> mappedPoints(numberOfPoints);
+  if (numberOfPoints > 0)
+  {
+    this->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPoints);
+  }
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    // bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-    mappedPoint = this->m_Transform->TransformPoint(fixedPoint);
+  /** Compute the contributions of the points, possibly in threads. */
+  const ThreadIdType numberOfWorkUnits = this->GetNumberOfWorkUnitsForPoints(numberOfPoints);
 
-    /** Check if point is inside mask. */
-    bool sampleOk = true;
-    if (sampleOk)
+  std::vector<PerThreadVariablesType> perThreadVariables(numberOfWorkUnits);
+  for (PerThreadVariablesType & variables : perThreadVariables)
+  {
+    variables.st_Value = NumericTraits<MeasureType>::Zero;
+    variables.st_NumberOfPointsCounted = 0;
+    if (computeDerivative)
     {
-      // sampleOk = this->IsInsideMovingMask( mappedPoint );
-      if (this->m_MovingImageMask.IsNotNull())
-      {
-        sampleOk = this->m_MovingImageMask->IsInsideInWorldSpace(mappedPoint);
-      }
+      variables.st_Derivative.SetSize(this->GetNumberOfParameters());
+      variables.st_Derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
     }
+  }
 
-    if (sampleOk)
-    {
-      this->m_NumberOfPointsCounted++;
+  MultiThreaderParameterType userData;
+  userData.st_Metric = this;
+  userData.st_FixedPoints = fixedPoints.data();
+  userData.st_MovingPoints = movingPoints.data();
+  userData.st_MappedPoints = mappedPoints.data();
+  userData.st_NumberOfPoints = numberOfPoints;
+  userData.st_NumberOfWorkUnits = numberOfWorkUnits;
+  userData.st_ComputeDerivative = computeDerivative;
+  userData.st_PerThreadVariables = perThreadVariables.data();
+
+  if (numberOfWorkUnits < 2)
+  {
+    this->ComputeValueAndDerivativeRange(userData, 0, numberOfPoints, perThreadVariables[0]);
+  }
+  else
+  {
+    this->LaunchThreaderCallback(Self::ComputeValueAndDerivativeThreaderCallback, &userData, numberOfWorkUnits);
+  }
 
-      /** Get the TransformJacobian dT/dmu. */
-      // this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-      this->m_Transform->GetJacobian(fixedPoint, jacobian, nzji);
-
-      VnlVectorType diffPoint = (movingPoint - mappedPoint).GetVnlVector();
-      MeasureType   distance = diffPoint.magnitude();
-      measure += distance;
-
-      /** Calculate the contributions to the derivatives with respect to each parameter. */
-      if (distance > std::numeric_limits<MeasureType>::epsilon())
-      {
-        VnlVectorType diff_2 = diffPoint / distance;
-        if (nzji.size() == this->GetNumberOfParameters())
-        {
-          /** Loop over all Jacobians. */
-          derivative -= diff_2 * jacobian;
-        }
-        else
-        {
-          /** Only pick the nonzero Jacobians. */
-          for (unsigned int i = 0; i < nzji.size(); ++i)
-          {
-            const unsigned int index = nzji[i];
-            VnlVectorType      column = jacobian.get_column(i);
-            derivative[index] -= dot_product(diff_2, column);
-          }
-        }
-      } // end if distance != 0
-
-    } // end if sampleOk
-
-    ++pointItFixed;
-    ++pointItMoving;
-
-  } // end loop over all corresponding points
-
-  /** Check if enough samples were valid. */
-  //   this->CheckNumberOfSamples(
-  //     fixedPointSet->GetNumberOfPoints(), this->m_NumberOfPointsCounted );
+  /** Accumulate the results of the threads. */
+  MeasureType measure = NumericTraits<MeasureType>::Zero;
+  this->m_NumberOfPointsCounted = 0;
+  if (computeDerivative)
+  {
+    derivative = perThreadVariables[0].st_Derivative;
+  }
+  for (ThreadIdType i = 0; i < numberOfWorkUnits; ++i)
+  {
+    measure += perThreadVariables[i].st_Value;
+    this->m_NumberOfPointsCounted += perThreadVariables[i].st_NumberOfPointsCounted;
+    if (computeDerivative && i > 0)
+    {
+      derivative += perThreadVariables[i].st_Derivative;
+    }
+  }
 
   /** Copy the measure to value. */
   value = measure;
   if (this->m_NumberOfPointsCounted > 0)
   {
-    derivative /= this->m_NumberOfPointsCounted;
+    if (computeDerivative)
+    {
+      derivative /= this->m_NumberOfPointsCounted;
+    }
     value = measure / this->m_NumberOfPointsCounted;
   }
 
-} // end GetValueAndDerivative()
+} // end ComputeValueAndDerivative()
+
+
+/**
+ * ******************* ComputeValueAndDerivativeThreaderCallback *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>::
+  ComputeValueAndDerivativeThreaderCallback(void * arg)
+{
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  SizeValueType begin = 0;
+  SizeValueType end = 0;
+  Self::GetWorkUnitPointRange(temp->st_NumberOfPoints, threadID, temp->st_NumberOfWorkUnits, begin, end);
+
+  temp->st_Metric->ComputeValueAndDerivativeRange(*temp, begin, end, temp->st_PerThreadVariables[threadID]);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeValueAndDerivativeThreaderCallback()
+
+
+/**
+ * ******************* ComputeValueAndDerivativeRange *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+CorrespondingPointsEuclideanDistancePointMetric<TFixedPointSet, TMovingPointSet>::ComputeValueAndDerivativeRange(
+  const MultiThreaderParameterType & parameters,
+  const SizeValueType                begin,
+  const SizeValueType                end,
+  PerThreadVariablesType &           variables) const
+{
+  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
+  TransformJacobianType      jacobian;
+
+  /** Loop over the corresponding points. */
+  for (SizeValueType i = begin; i < end; ++i)
+  {
+    const OutputPointType & mappedPoint = parameters.st_MappedPoints[i];
+
+    /** Check if point is inside mask. */
+    if (this->m_MovingImageMask.IsNotNull() && !this->m_MovingImageMask->IsInsideInWorldSpace(mappedPoint))
+    {
+      continue;
+    }
+
+    ++variables.st_NumberOfPointsCounted;
+
+    const VnlVectorType diffPoint = (parameters.st_MovingPoints[i] - mappedPoint).GetVnlVector();
+    const MeasureType   distance = diffPoint.magnitude();
+    variables.st_Value += distance;
+
+    /** Calculate the contributions to the derivatives with respect to each parameter. */
+    if (parameters.st_ComputeDerivative && distance > std::numeric_limits<MeasureType>::epsilon())
+    {
+      /** Get the TransformJacobian dT/dmu. */
+      this->m_Transform->GetJacobian(parameters.st_FixedPoints[i], jacobian, nzji);
+
+      const VnlVectorType diff_2 = diffPoint / (-distance);
+      this->AccumulateJacobianProduct(diff_2, jacobian, nzji, variables.st_Derivative);
+    }
+
+  } // end loop over the corresponding points
+
+} // end ComputeValueAndDerivativeRange()
 
 
 } // end namespace itk
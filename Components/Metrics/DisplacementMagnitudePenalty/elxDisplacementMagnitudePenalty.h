@@ -36,6 +36,12 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "DisplacementMagnitudePenalty")</tt>
+ * \parameter UseGridBasedDisplacementMagnitude: Whether the displacement magnitude of a B-spline
+ *    transform is computed exactly from its control point grid, instead of from the samples.
+ *    Only used without masks and without an initial transform, see
+ *    itk::DisplacementMagnitudePenaltyTerm. Can be given for each resolution.\n
+ *    example: <tt>(UseGridBasedDisplacementMagnitude "false")</tt>\n
+ *    Default: true.
  *
  * \ingroup Metrics
  * \sa DisplacementEnergyPenaltyTerm
@@ -127,6 +133,13 @@ public:
   void
   Initialize(void) override;
 
+  /**
+   * Do some things before each resolution:
+   * \li Set the UseGridBasedDisplacementMagnitude option
+   */
+  void
+  BeforeEachResolution(void) override;
+
 protected:
   /** The constructor. */
   DisplacementMagnitudePenalty() = default;
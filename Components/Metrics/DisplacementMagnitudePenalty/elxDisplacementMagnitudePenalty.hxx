@@ -38,10 +38,34 @@ DisplacementMagnitudePenalty<TElastix>::Initialize(void)
   timer.Stop();
   elxout << "Initialization of DisplacementMagnitude metric took: " << static_cast<long>(timer.GetMean() * 1000)
          << " ms." << std::endl;
+  if (this->GetGridBasedDisplacementMagnitudeActive())
+  {
+    elxout << "  The displacement magnitude is computed from the B-spline grid." << std::endl;
+  }
 
 } // end Initialize()
 
 
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+DisplacementMagnitudePenalty<TElastix>::BeforeEachResolution(void)
+{
+  /** Get the current resolution level. */
+  unsigned int level = (this->m_Registration->GetAsITKBaseType())->GetCurrentLevel();
+
+  /** Set whether the displacement magnitude of a B-spline transform is computed from its grid. */
+  bool useGridBasedDisplacementMagnitude = true;
+  this->GetConfiguration()->ReadParameter(
+    useGridBasedDisplacementMagnitude, "UseGridBasedDisplacementMagnitude", this->GetComponentLabel(), level, 0);
+  this->SetUseGridBasedDisplacementMagnitude(useGridBasedDisplacementMagnitude);
+
+} // end BeforeEachResolution()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxDisplacementMagnitudePenalty_hxx
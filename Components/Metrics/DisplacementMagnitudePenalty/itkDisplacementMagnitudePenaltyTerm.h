@@ -19,6 +19,7 @@
 #define itkDisplacementMagnitudePenaltyTerm_h
 
 #include "itkTransformPenaltyTerm.h"
+#include "itkBSplineGridIntegrals.h"
 
 namespace itk
 {
@@ -27,6 +28,15 @@ namespace itk
  * \class DisplacementMagnitudePenaltyTerm
  * \brief A cost function that calculates \f$||T(x)-x||^2\f$.
  *
+ * For an AdvancedBSplineDeformableTransform or RecursiveBSplineTransform, the
+ * displacement magnitude is a quadratic form in the B-spline coefficients. It is
+ * then, by default, computed exactly from the control point grid, as the mean over
+ * the fixed image domain, in the same way as the bending energy of
+ * TransformBendingEnergyPenaltyTerm, see BSplineGridIntegrals. The samples are used
+ * for other transforms, when a fixed or moving image mask is given, when an
+ * initial transform is set, or when the grid is rotated with respect to the fixed image.
+ * See SetUseGridBasedDisplacementMagnitude().
+ *
  * \ingroup Metrics
  */
 
@@ -93,6 +103,11 @@ public:
   /** Define the dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
 
+  /** Initialize the penalty term, and set up the grid-based computation
+   * of the displacement magnitude when the transform supports it. */
+  void
+  Initialize(void) override;
+
   /** Get the penalty term value.
    * \f[ Value = 1/N sum_x ||T(x) - x||^2 \f]
    */
@@ -113,6 +128,16 @@ public:
                         MeasureType &          value,
                         DerivativeType &       derivative) const override;
 
+  /** Select the exact, grid-based computation for B-spline transforms, when
+   * possible. Takes effect at the next Initialize(). Default: true. */
+  itkSetMacro(UseGridBasedDisplacementMagnitude, bool);
+  itkGetConstMacro(UseGridBasedDisplacementMagnitude, bool);
+  itkBooleanMacro(UseGridBasedDisplacementMagnitude);
+
+  /** Get whether the displacement magnitude is computed from the control point
+   * grid in the current resolution. */
+  itkGetConstMacro(GridBasedDisplacementMagnitudeActive, bool);
+
 protected:
   /** Typedefs for indices and points. */
   typedef typename Superclass::FixedImageIndexType            FixedImageIndexType;
@@ -138,6 +163,18 @@ private:
   /** The deleted assignment operator. */
   void
   operator=(const Self &) = delete;
+
+  /** Compute the displacement magnitude and, if asked for, its derivative from
+   * the control point grid. Returns false when the grid-based computation is
+   * not active, in which case the samples should be used. */
+  bool
+  GetValueAndDerivativeOnGrid(const ParametersType & parameters,
+                              MeasureType &          value,
+                              DerivativeType *       derivative) const;
+
+  bool                                                  m_UseGridBasedDisplacementMagnitude;
+  bool                                                  m_GridBasedDisplacementMagnitudeActive;
+  BSplineGridIntegrals<ScalarType, FixedImageDimension> m_GridIntegrals;
 };
 
 } // end namespace itk
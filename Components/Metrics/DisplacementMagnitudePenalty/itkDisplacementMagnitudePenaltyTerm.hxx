@@ -21,6 +21,8 @@
 #include "itkDisplacementMagnitudePenaltyTerm.h"
 #include "itkVector.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -36,9 +38,64 @@ DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::DisplacementMagnitud
   /** Turn on the sampler functionality */
   this->SetUseImageSampler(true);
 
+  /** GetValueAndDerivative() follows the BeforeThreadedGetValueAndDerivative() protocol. */
+  this->m_ConcurrentEvaluationSupported = true;
+
+  this->m_UseGridBasedDisplacementMagnitude = true;
+  this->m_GridBasedDisplacementMagnitudeActive = false;
+
 } // end constructor
 
 
+/**
+ * ****************** Initialize *******************************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::Initialize(void)
+{
+  /** Call the superclass' implementation. */
+  this->Superclass::Initialize();
+
+  this->m_GridBasedDisplacementMagnitudeActive = false;
+  if (!this->m_UseGridBasedDisplacementMagnitude || this->GetFixedImageMask() != nullptr ||
+      this->GetMovingImageMask() != nullptr)
+  {
+    return;
+  }
+
+  /** Get the B-spline transform. An initial transform would add to the
+   * displacement, which is then no longer a quadratic form.
+   */
+  typedef typename Superclass::CombinationTransformType CombinationTransformType;
+  const TransformType *            transform = this->m_AdvancedTransform.GetPointer();
+  const CombinationTransformType * combination = dynamic_cast<const CombinationTransformType *>(transform);
+  if (combination != nullptr)
+  {
+    if (combination->GetInitialTransform() != nullptr)
+    {
+      return;
+    }
+    transform = combination->GetCurrentTransform();
+  }
+
+  /** Only the B-splines themselves are needed, so all orders are supported. */
+  if (!this->m_GridIntegrals.Initialize(transform, this->GetFixedImage(), this->GetFixedImageRegion(), 1, 0))
+  {
+    return;
+  }
+  if (FixedImageDimension * this->m_GridIntegrals.GetNumberOfGridPoints() !=
+      this->m_AdvancedTransform->GetNumberOfParameters())
+  {
+    return;
+  }
+
+  this->m_GridBasedDisplacementMagnitudeActive = true;
+
+} // end Initialize()
+
+
 /**
  * ****************** PrintSelf *******************************
  *
@@ -64,6 +121,13 @@ template <class TFixedImage, class TScalarType>
 typename DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::MeasureType
 DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::GetValue(const ParametersType & parameters) const
 {
+  /** Compute the displacement magnitude from the grid, when possible. */
+  MeasureType gridValue = NumericTraits<MeasureType>::Zero;
+  if (this->GetValueAndDerivativeOnGrid(parameters, gridValue, nullptr))
+  {
+    return gridValue;
+  }
+
   /** Initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
   RealType measure = NumericTraits<RealType>::Zero;
@@ -151,6 +215,12 @@ DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivativ
 {
   typedef typename MovingImagePointType::VectorType VectorType;
 
+  /** Compute the displacement magnitude from the grid, when possible. */
+  if (this->GetValueAndDerivativeOnGrid(parameters, value, &derivative))
+  {
+    return;
+  }
+
   /** Create and initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
   RealType measure = NumericTraits<RealType>::Zero;
@@ -246,6 +316,73 @@ DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivativ
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* GetValueAndDerivativeOnGrid *******************
+ */
+
+template <class TFixedImage, class TScalarType>
+bool
+DisplacementMagnitudePenaltyTerm<TFixedImage, TScalarType>::GetValueAndDerivativeOnGrid(
+  const ParametersType & parameters,
+  MeasureType &          value,
+  DerivativeType *       derivative) const
+{
+  const SizeValueType numberOfGridPoints = this->m_GridIntegrals.GetNumberOfGridPoints();
+  if (!this->m_GridBasedDisplacementMagnitudeActive ||
+      parameters.GetSize() != FixedImageDimension * numberOfGridPoints)
+  {
+    return false;
+  }
+
+  if (derivative != nullptr)
+  {
+    derivative->SetSize(parameters.GetSize());
+    derivative->Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+  }
+
+  /** The mean of ||T(x)-x||^2 is the sum over the components i of c_i^T K c_i / V,
+   * where K is the Kronecker product of the banded matrices of the B-splines of the
+   * dimensions, and V the volume. The derivative is 2 K c_i / V.
+   */
+  std::vector<double> buffer1(numberOfGridPoints);
+  std::vector<double> buffer2(numberOfGridPoints);
+  const double        weight = 1.0 / this->m_GridIntegrals.GetVolume();
+  RealType            measure = NumericTraits<RealType>::Zero;
+  for (unsigned int i = 0; i < FixedImageDimension; ++i)
+  {
+    /** Multiply with the matrices of all dimensions, alternating the buffers. */
+    const double * coefficients = parameters.data_block() + i * numberOfGridPoints;
+    const double * product = coefficients;
+    for (unsigned int d = 0; d < FixedImageDimension; ++d)
+    {
+      double * output = d % 2 == 0 ? buffer1.data() : buffer2.data();
+      this->m_GridIntegrals.ApplyBandedMatrix(0, d, product, output);
+      product = output;
+    }
+
+    double quadraticForm = 0.0;
+    for (SizeValueType p = 0; p < numberOfGridPoints; ++p)
+    {
+      quadraticForm += coefficients[p] * product[p];
+    }
+    measure += weight * quadraticForm;
+
+    if (derivative != nullptr)
+    {
+      DerivativeValueType * derivativeComponent = derivative->data_block() + i * numberOfGridPoints;
+      for (SizeValueType p = 0; p < numberOfGridPoints; ++p)
+      {
+        derivativeComponent[p] = 2.0 * weight * product[p];
+      }
+    }
+  }
+
+  value = static_cast<MeasureType>(measure);
+  return true;
+
+} // end GetValueAndDerivativeOnGrid()
+
+
 } // end namespace itk
 
 #endif // #ifndef itkDisplacementMagnitudePenaltyTerm_hxx
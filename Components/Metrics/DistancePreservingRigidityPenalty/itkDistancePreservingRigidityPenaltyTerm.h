@@ -33,6 +33,8 @@
 #include "itkImageRegionIterator.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <vector>
+
 namespace itk
 {
 /**
@@ -63,6 +65,13 @@ namespace itk
  *  resolutions.
  *  - In the publication above, the grid spacing was set as [4, 4, 1].
  *
+ * The pairs of neighbouring penalty grid points within the same rigid region are
+ * determined once per resolution, and stored in a compressed sparse row layout,
+ * together with the B-spline weights of every grid point. Every evaluation then
+ * transforms each rigid grid point once, and computes the penalty and its
+ * derivative in parallel over the grid points, where every thread accumulates
+ * the derivative of its own range of control points.
+ *
  * \author Jihun Kim, University of Michigan, Ann Arbor
  * \author Martha M. Matuszak, University of Michigan, Ann Arbor
  * \author Kazuhiro Saitou, University of Michigan, Ann Arbor
@@ -217,6 +226,55 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** Typedefs for multi-threading. */
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** Determine the pairs of neighbouring rigid penalty grid points, and the
+   * B-spline support of every rigid penalty grid point.
+   */
+  void
+  InitializeNeighborPairs(void);
+
+  /** Compute the value and, when the derivative is not null, the derivative. */
+  void
+  ComputeValueAndDerivative(const ParametersType & parameters, MeasureType & value, DerivativeType * derivative) const;
+
+  /** Transform the rigid penalty grid points of a thread. */
+  void
+  ThreadedTransformPoints(const ThreadIdType threadID, const ThreadIdType numberOfThreads) const;
+
+  /** Compute the value and derivative contributions of the rigid penalty grid points of a thread. */
+  void
+  ThreadedComputeValueAndDerivative(const ThreadIdType threadID,
+                                    const ThreadIdType numberOfThreads,
+                                    const bool         computeDerivative) const;
+
+  /** The struct that is passed to the threads. */
+  struct DistancePreservingThreaderParameterType
+  {
+    const Self * st_Metric;
+    bool         st_ComputeDerivative;
+  };
+
+  /** The callback functions. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  TransformPointsThreaderCallback(void * arg);
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  ComputeValueAndDerivativeThreaderCallback(void * arg);
+
+  /** The variables of every thread. The derivative of a thread is only
+   * nonzero in the range [st_DerivativeBegin, st_DerivativeEnd) of
+   * control points, in every dimension.
+   */
+  struct DistancePreservingPerThreadStruct
+  {
+    MeasureType                      st_Value;
+    std::vector<DerivativeValueType> st_Derivative;
+    SizeValueType                    st_DerivativeBegin;
+    SizeValueType                    st_DerivativeEnd;
+  };
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
 
@@ -228,6 +286,29 @@ private:
   SegmentedImagePointer   m_SampledSegmentedImage;
 
   unsigned int m_NumberOfRigidGrids;
+
+  /** The rigid penalty grid points that have a neighbour in the same rigid
+   * region, and their weights in the penalty term.
+   */
+  std::vector<InputPointType> m_RigidPoints;
+  std::vector<MeasureType>    m_RigidPointWeights;
+
+  /** The neighbours of rigid point i are stored in the range
+   * [m_NeighborOffsets[i], m_NeighborOffsets[i + 1]) of m_NeighborIndices,
+   * with their squared distance to point i in m_NeighborSquaredDistances.
+   */
+  std::vector<SizeValueType> m_NeighborOffsets;
+  std::vector<unsigned int>  m_NeighborIndices;
+  std::vector<MeasureType>   m_NeighborSquaredDistances;
+
+  /** The first control point of the support of every rigid point, and its
+   * 1D B-spline weights, four per dimension.
+   */
+  std::vector<SizeValueType> m_SupportStarts;
+  std::vector<double>        m_SupportWeights;
+
+  mutable std::vector<OutputPointType>                   m_TransformedRigidPoints;
+  mutable std::vector<DistancePreservingPerThreadStruct> m_PerThreadVariables;
 };
 
 // end class DistancePreservingRigidityPenaltyTerm
@@ -23,6 +23,9 @@
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 #include "itkImageRegionIterator.h"
 
+#include <algorithm> // For min and max.
+#include <cmath>     // For floor.
+
 namespace itk
 {
 
@@ -153,45 +156,35 @@ DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::Initialize(void
     }
     ++ki;
   }
+
+  /** Determine the neighbouring rigid grid points once for this resolution. */
+  this->InitializeNeighborPairs();
+
 } // end Initialize()
 
 
 /**
- * *********************** GetValue *****************************
+ * *********************** InitializeNeighborPairs *****************************
  */
 
 template <class TFixedImage, class TScalarType>
-typename DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::MeasureType
-DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValue(const ParametersType & parameters) const
+void
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::InitializeNeighborPairs(void)
 {
-  /** Set output values to zero. */
-  this->m_RigidityPenaltyTermValue = NumericTraits<MeasureType>::Zero;
-
-  // this->SetTransformParameters( parameters );
-  this->m_BSplineTransform->SetParameters(parameters);
-
-  /** distance-preserving penalty computation */
-  MeasureType penaltyTerm = 0.0;
-  MeasureType penaltyTermBuffer = 0.0;
-
-  MeasureType dx = 0.0;
-  MeasureType dX = 0.0;
-
-  typedef itk::ImageRegionConstIteratorWithIndex<PenaltyGridImageType> PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
-
-  PenaltyGridIteratorType pgi(this->m_PenaltyGridImage, penaltyGridImageRegion);
-
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
-
-  typedef itk::ConstNeighborhoodIterator<PenaltyGridImageType> NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType                radius;
-  radius.Fill(1);
-  NeighborhoodIteratorType ni(radius, this->m_PenaltyGridImage, penaltyGridImageRegion);
-  unsigned int             numberOfNeighborhood = ni.Size();
-
-  unsigned int numberOfRigidGridsNeighbor;
+  /** Clear the results of the previous resolution. */
+  this->m_RigidPoints.clear();
+  this->m_RigidPointWeights.clear();
+  this->m_NeighborOffsets.assign(1, 0);
+  this->m_NeighborIndices.clear();
+  this->m_NeighborSquaredDistances.clear();
+  this->m_SupportStarts.clear();
+  this->m_SupportWeights.clear();
+
+  /** The penalty term is only implemented for 3D images. */
+  if (MovingImageDimension != 3)
+  {
+    return;
+  }
 
   // interpolation of segmented image
   typedef itk::NearestNeighborInterpolateImageFunction<SegmentedImageType, double> SegmentedImageInterpolatorType;
@@ -199,75 +192,147 @@ DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValue(const
 
   segmentedImageInterpolator->SetInputImage(this->m_SampledSegmentedImage);
 
-  unsigned int pixelValue, pixelValueNeighbor;
+  /** Get the label of every penalty grid point, in the order of the buffer. */
+  typedef itk::ImageRegionConstIteratorWithIndex<PenaltyGridImageType> PenaltyGridIteratorType;
+  const PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
+  const SizeValueType              numberOfGridPoints = penaltyGridImageRegion.GetNumberOfPixels();
+  PenaltyGridIteratorType          pgi(this->m_PenaltyGridImage, penaltyGridImageRegion);
+
+  std::vector<unsigned int>                             labels(numberOfGridPoints);
+  std::vector<typename PenaltyGridImageType::PointType> gridPoints(numberOfGridPoints);
+  SizeValueType                                         gridPointNumber = 0;
+  for (pgi.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++gridPointNumber)
+  {
+    this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(pgi.GetIndex(), gridPoints[gridPointNumber]);
+    labels[gridPointNumber] =
+      static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(gridPoints[gridPointNumber]));
+  }
 
-  /** Penalty term computation */
-  if (MovingImageDimension == 3)
+  /** Create the offsets of the 3x3x3 neighbourhood, without the centre,
+   * which does not contribute to the penalty term.
+   */
+  typedef typename PenaltyGridImageType::OffsetType OffsetType;
+  std::vector<OffsetType>                           neighborOffsets;
+  for (unsigned int kk = 0; kk < 27; ++kk)
   {
-    for (pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni)
+    OffsetType offset;
+    offset[0] = static_cast<OffsetValueType>(kk % 3) - 1;
+    offset[1] = static_cast<OffsetValueType>((kk / 3) % 3) - 1;
+    offset[2] = static_cast<OffsetValueType>(kk / 9) - 1;
+    if (kk != 13)
     {
-      penaltyGridIndex = pgi.GetIndex();
-
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(penaltyGridIndex, penaltyGridPoint);
-
-      ni.SetLocation(penaltyGridIndex);
+      neighborOffsets.push_back(offset);
+    }
+  }
 
-      pixelValue = static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(penaltyGridPoint));
+  /** Number the grid points in rigid regions that have at least one neighbour
+   * in the same region. The neighbour count includes the grid point itself.
+   */
+  const unsigned int         noRigidPoint = NumericTraits<unsigned int>::max();
+  std::vector<unsigned int>  rigidPointNumbers(numberOfGridPoints, noRigidPoint);
+  std::vector<SizeValueType> rigidGridPointNumbers;
+  for (pgi.GoToBegin(), gridPointNumber = 0; !pgi.IsAtEnd(); ++pgi, ++gridPointNumber)
+  {
+    const unsigned int pixelValue = labels[gridPointNumber];
+    if (pixelValue == 0 || pixelValue >= 6)
+    {
+      continue;
+    }
 
-      if (pixelValue > 0 && pixelValue < 6)
+    unsigned int numberOfRigidGridsNeighbor = 1;
+    for (const auto & offset : neighborOffsets)
+    {
+      const typename PenaltyGridImageType::IndexType neighborIndex = pgi.GetIndex() + offset;
+      if (penaltyGridImageRegion.IsInside(neighborIndex) &&
+          labels[this->m_PenaltyGridImage->ComputeOffset(neighborIndex)] == pixelValue)
       {
-        numberOfRigidGridsNeighbor = 0;
-
-        for (unsigned int kk = 0; kk < numberOfNeighborhood; ++kk)
-        {
-          neighborPenaltyGridIndex = ni.GetIndex(kk);
+        ++numberOfRigidGridsNeighbor;
+      }
+    }
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(neighborPenaltyGridIndex, neighborPenaltyGridPoint);
+    if (numberOfRigidGridsNeighbor > 1)
+    {
+      rigidPointNumbers[gridPointNumber] = static_cast<unsigned int>(rigidGridPointNumbers.size());
+      rigidGridPointNumbers.push_back(gridPointNumber);
+      this->m_RigidPoints.push_back(gridPoints[gridPointNumber]);
+      this->m_RigidPointWeights.push_back(1.0 / numberOfRigidGridsNeighbor / this->m_NumberOfRigidGrids);
+    }
+  }
 
-          pixelValueNeighbor =
-            static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(neighborPenaltyGridPoint));
+  /** Store the neighbours of every rigid grid point. A neighbour in the same
+   * rigid region has a neighbour itself, so it is a rigid grid point as well.
+   */
+  const SizeValueType numberOfRigidPoints = this->m_RigidPoints.size();
+  this->m_NeighborOffsets.reserve(numberOfRigidPoints + 1);
+  for (SizeValueType i = 0; i < numberOfRigidPoints; ++i)
+  {
+    const SizeValueType                            number = rigidGridPointNumbers[i];
+    const typename PenaltyGridImageType::IndexType index = this->m_PenaltyGridImage->ComputeIndex(number);
+    for (const auto & offset : neighborOffsets)
+    {
+      const typename PenaltyGridImageType::IndexType neighborIndex = index + offset;
+      if (!penaltyGridImageRegion.IsInside(neighborIndex))
+      {
+        continue;
+      }
+      const SizeValueType neighborNumber = this->m_PenaltyGridImage->ComputeOffset(neighborIndex);
+      if (labels[neighborNumber] == labels[number])
+      {
+        this->m_NeighborIndices.push_back(rigidPointNumbers[neighborNumber]);
+        this->m_NeighborSquaredDistances.push_back(
+          gridPoints[number].SquaredEuclideanDistanceTo(gridPoints[neighborNumber]));
+      }
+    }
+    this->m_NeighborOffsets.push_back(this->m_NeighborIndices.size());
+  }
 
-          if (pixelValue == pixelValueNeighbor)
-          {
-            numberOfRigidGridsNeighbor++;
-          }
-        }
+  /** Compute the B-spline support of every rigid grid point. */
+  typedef itk::BSplineKernelFunction<3> BSplineKernelFunctionType;
+  BSplineKernelFunctionType::Pointer    bSplineKernel = BSplineKernelFunctionType::New();
 
-        if (numberOfRigidGridsNeighbor > 1)
-        {
-          for (unsigned int kk = 0; kk < numberOfNeighborhood; ++kk)
-          {
-            neighborPenaltyGridIndex = ni.GetIndex(kk);
+  const typename BSplineKnotImageType::SizeType bSplineKnotImageSize =
+    this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
 
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(neighborPenaltyGridIndex, neighborPenaltyGridPoint);
+  this->m_SupportStarts.resize(numberOfRigidPoints);
+  this->m_SupportWeights.resize(4 * ImageDimension * numberOfRigidPoints);
+  ContinuousIndex<double, ImageDimension> tindex;
+  for (SizeValueType i = 0; i < numberOfRigidPoints; ++i)
+  {
+    this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex(this->m_RigidPoints[i], tindex);
 
-            pixelValueNeighbor =
-              static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(neighborPenaltyGridPoint));
+    SizeValueType supportStart = 0;
+    SizeValueType stride = 1;
+    for (unsigned int dd = 0; dd < ImageDimension; ++dd)
+    {
+      const double start = std::floor(tindex[dd]) - 1.0;
+      for (unsigned int ii = 0; ii < 4; ++ii)
+      {
+        this->m_SupportWeights[(4 * ImageDimension) * i + 4 * dd + ii] =
+          bSplineKernel->Evaluate(tindex[dd] - (start + ii));
+      }
+      supportStart += stride * static_cast<unsigned int>(start);
+      stride *= bSplineKnotImageSize[dd];
+    }
+    this->m_SupportStarts[i] = supportStart;
+  }
 
-            if (pixelValue == pixelValueNeighbor)
-            {
-              xn = this->m_Transform->TransformPoint(neighborPenaltyGridPoint);
-              xf = this->m_Transform->TransformPoint(penaltyGridPoint);
+} // end InitializeNeighborPairs()
 
-              dX = (neighborPenaltyGridPoint[0] - penaltyGridPoint[0]) *
-                     (neighborPenaltyGridPoint[0] - penaltyGridPoint[0]) +
-                   (neighborPenaltyGridPoint[1] - penaltyGridPoint[1]) *
-                     (neighborPenaltyGridPoint[1] - penaltyGridPoint[1]) +
-                   (neighborPenaltyGridPoint[2] - penaltyGridPoint[2]) *
-                     (neighborPenaltyGridPoint[2] - penaltyGridPoint[2]);
 
-              dx = (xn[0] - xf[0]) * (xn[0] - xf[0]) + (xn[1] - xf[1]) * (xn[1] - xf[1]) +
-                   (xn[2] - xf[2]) * (xn[2] - xf[2]);
+/**
+ * *********************** GetValue *****************************
+ */
 
-              penaltyTermBuffer = (dx - dX) * (dx - dX);
+template <class TFixedImage, class TScalarType>
+typename DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::MeasureType
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValue(const ParametersType & parameters) const
+{
+  /** Set output values to zero. */
+  this->m_RigidityPenaltyTermValue = NumericTraits<MeasureType>::Zero;
 
-              penaltyTerm += penaltyTermBuffer / numberOfRigidGridsNeighbor / (this->m_NumberOfRigidGrids);
-            }
-          } // end for
-        }   // end if
-      }     // end if
-    }       // end for
-  }         // end if ( dimension = 3 )
+  /** Distance-preserving penalty computation. */
+  MeasureType penaltyTerm = NumericTraits<MeasureType>::Zero;
+  this->ComputeValueAndDerivative(parameters, penaltyTerm, nullptr);
 
   /** Return the rigidity penalty term value. */
   return penaltyTerm;
@@ -308,201 +373,254 @@ DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::GetValueAndDeri
   derivative = DerivativeType(this->GetNumberOfParameters());
   derivative.Fill(NumericTraits<MeasureType>::ZeroValue());
 
+  /** Distance-preserving penalty computation. */
+  this->ComputeValueAndDerivative(parameters, value, &derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * *********************** ComputeValueAndDerivative ****************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::ComputeValueAndDerivative(
+  const ParametersType & parameters,
+  MeasureType &          value,
+  DerivativeType *       derivative) const
+{
   this->m_BSplineTransform->SetParameters(parameters);
 
-  /** Distance-preserving penalty */
-  MeasureType penaltyTermBuffer = 0.0;
-  MeasureType derivativeTermTemp1 = 0.0, derivativeTermTemp2 = 0.0, derivativeTermTemp3 = 0.0;
+  const SizeValueType numberOfRigidPoints = this->m_RigidPoints.size();
+  if (numberOfRigidPoints == 0)
+  {
+    return;
+  }
 
-  unsigned int par1, par2;
+  /** Prepare the variables of the threads. The derivatives of the threads
+   * are kept at zero in between calls, see the accumulation below.
+   */
+  const ThreadIdType numberOfThreads = this->m_UseMultiThread ? Self::GetNumberOfWorkUnits() : 1;
+  this->m_TransformedRigidPoints.resize(numberOfRigidPoints);
+  this->m_PerThreadVariables.resize(numberOfThreads);
+  if (derivative != nullptr)
+  {
+    for (auto & perThreadVariables : this->m_PerThreadVariables)
+    {
+      if (perThreadVariables.st_Derivative.size() != derivative->GetSize())
+      {
+        perThreadVariables.st_Derivative.assign(derivative->GetSize(), NumericTraits<DerivativeValueType>::ZeroValue());
+      }
+    }
+  }
 
-  MeasureType dX = 0.0;
-  MeasureType dx = 0.0;
+  /** First transform all rigid grid points, then compute the penalty term
+   * over the pairs of neighbours.
+   */
+  if (numberOfThreads > 1)
+  {
+    DistancePreservingThreaderParameterType userData;
+    userData.st_Metric = this;
+    userData.st_ComputeDerivative = derivative != nullptr;
+    this->LaunchThreaderCallback(TransformPointsThreaderCallback, &userData);
+    this->LaunchThreaderCallback(ComputeValueAndDerivativeThreaderCallback, &userData);
+  }
+  else
+  {
+    this->ThreadedTransformPoints(0, 1);
+    this->ThreadedComputeValueAndDerivative(0, 1, derivative != nullptr);
+  }
 
-  typename PenaltyGridImageType::IndexType penaltyGridIndex, neighborPenaltyGridIndex;
-  typename PenaltyGridImageType::PointType penaltyGridPoint, neighborPenaltyGridPoint, xn, xf;
+  /** Accumulate the values and the touched parts of the derivatives,
+   * and reset the latter to zero for the next call.
+   */
+  const SizeValueType numberOfParametersPerDimension = this->GetNumberOfParameters() / ImageDimension;
+  for (auto & perThreadVariables : this->m_PerThreadVariables)
+  {
+    value += perThreadVariables.st_Value;
+    if (derivative == nullptr)
+    {
+      continue;
+    }
 
-  typedef itk::BSplineKernelFunction<3> BSplineKernelFunctionType;
-  BSplineKernelFunctionType::Pointer    bSplineKernel = BSplineKernelFunctionType::New();
+    for (unsigned int dd = 0; dd < ImageDimension; ++dd)
+    {
+      const SizeValueType   offset = dd * numberOfParametersPerDimension;
+      DerivativeValueType * threadDerivative = perThreadVariables.st_Derivative.data() + offset;
+      for (SizeValueType par = perThreadVariables.st_DerivativeBegin; par < perThreadVariables.st_DerivativeEnd; ++par)
+      {
+        (*derivative)[offset + par] += threadDerivative[par];
+        threadDerivative[par] = NumericTraits<DerivativeValueType>::ZeroValue();
+      }
+    }
+  }
 
-  typedef itk::BSplineInterpolationWeightFunction<double, ImageDimension, 3> WeightsFunctionType;
-  typedef typename WeightsFunctionType::ContinuousIndexType                  ContinuousIndexType;
-  typedef double                                                             ContinuousIndexValueType;
+} // end ComputeValueAndDerivative()
 
-  ContinuousIndexType      tindex;
-  ContinuousIndexValueType tx, ty, tz;
 
-  ContinuousIndexValueType m, n, p, neighbor_m, neighbor_n, neighbor_p;
+/**
+ * *********************** TransformPointsThreaderCallback ****************
+ */
 
-  typedef itk::ImageRegionConstIteratorWithIndex<PenaltyGridImageType> PenaltyGridIteratorType;
-  PenaltyGridImageRegionType penaltyGridImageRegion = this->m_PenaltyGridImage->GetBufferedRegion();
-  PenaltyGridIteratorType    pgi(this->m_PenaltyGridImage, penaltyGridImageRegion);
+template <class TFixedImage, class TScalarType>
+ITK_THREAD_RETURN_TYPE
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::TransformPointsThreaderCallback(void * arg)
+{
+  ThreadInfoType *                          infoStruct = static_cast<ThreadInfoType *>(arg);
+  DistancePreservingThreaderParameterType * temp =
+    static_cast<DistancePreservingThreaderParameterType *>(infoStruct->UserData);
 
-  // neighborhood iterator
-  typedef itk::ConstNeighborhoodIterator<PenaltyGridImageType> NeighborhoodIteratorType;
-  typename NeighborhoodIteratorType::RadiusType                radius;
-  radius.Fill(1);
-  NeighborhoodIteratorType ni(radius, this->m_PenaltyGridImage, penaltyGridImageRegion);
-  unsigned int             numberOfNeighborhood = ni.Size();
+  temp->st_Metric->ThreadedTransformPoints(infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits);
 
-  ContinuousIndexType      tindex_neighbor, ntindex_start, ntindex_neighbor_start;
-  ContinuousIndexValueType tx_neighbor, ty_neighbor, tz_neighbor;
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
 
-  typename BSplineKnotImageType::SizeType bSplineKnotImageSize =
-    this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
+} // end TransformPointsThreaderCallback()
 
-  MeasureType du_dC, du_dC_neighbor;
 
-  unsigned int numberOfRigidGridsNeighbor;
+/**
+ * *********************** ComputeValueAndDerivativeThreaderCallback ****************
+ */
 
-  const unsigned int parametersDimension = this->GetNumberOfParameters();
-  unsigned int       numberOfParametersPerDimension = parametersDimension / ImageDimension;
+template <class TFixedImage, class TScalarType>
+ITK_THREAD_RETURN_TYPE
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::ComputeValueAndDerivativeThreaderCallback(void * arg)
+{
+  ThreadInfoType *                          infoStruct = static_cast<ThreadInfoType *>(arg);
+  DistancePreservingThreaderParameterType * temp =
+    static_cast<DistancePreservingThreaderParameterType *>(infoStruct->UserData);
 
-  // interpolation of segmented image
-  typedef itk::NearestNeighborInterpolateImageFunction<SegmentedImageType, double> SegmentedImageInterpolatorType;
-  typename SegmentedImageInterpolatorType::Pointer segmentedImageInterpolator = SegmentedImageInterpolatorType::New();
+  temp->st_Metric->ThreadedComputeValueAndDerivative(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits, temp->st_ComputeDerivative);
 
-  segmentedImageInterpolator->SetInputImage(this->m_SampledSegmentedImage);
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
 
-  unsigned int pixelValue, pixelValueNeighbor;
+} // end ComputeValueAndDerivativeThreaderCallback()
 
-  if (MovingImageDimension == 3)
+
+/**
+ * *********************** ThreadedTransformPoints ****************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::ThreadedTransformPoints(
+  const ThreadIdType threadID,
+  const ThreadIdType numberOfThreads) const
+{
+  /** Get the range of rigid grid points of this thread. */
+  const SizeValueType numberOfRigidPoints = this->m_RigidPoints.size();
+  const SizeValueType chunkSize = (numberOfRigidPoints + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType begin = std::min<SizeValueType>(threadID * chunkSize, numberOfRigidPoints);
+  const SizeValueType end = std::min<SizeValueType>(begin + chunkSize, numberOfRigidPoints);
+
+  for (SizeValueType i = begin; i < end; ++i)
   {
-    for (pgi.GoToBegin(), ni.GoToBegin(); !pgi.IsAtEnd(); ++pgi, ++ni)
-    {
-      penaltyGridIndex = pgi.GetIndex();
+    this->m_TransformedRigidPoints[i] = this->m_Transform->TransformPoint(this->m_RigidPoints[i]);
+  }
 
-      this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(penaltyGridIndex, penaltyGridPoint);
+} // end ThreadedTransformPoints()
 
-      pixelValue = static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(penaltyGridPoint));
 
-      ni.SetLocation(penaltyGridIndex);
+/**
+ * *********************** ThreadedComputeValueAndDerivative ****************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+DistancePreservingRigidityPenaltyTerm<TFixedImage, TScalarType>::ThreadedComputeValueAndDerivative(
+  const ThreadIdType threadID,
+  const ThreadIdType numberOfThreads,
+  const bool         computeDerivative) const
+{
+  /** Get the range of rigid grid points of this thread. */
+  const SizeValueType numberOfRigidPoints = this->m_RigidPoints.size();
+  const SizeValueType chunkSize = (numberOfRigidPoints + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType begin = std::min<SizeValueType>(threadID * chunkSize, numberOfRigidPoints);
+  const SizeValueType end = std::min<SizeValueType>(begin + chunkSize, numberOfRigidPoints);
+
+  DistancePreservingPerThreadStruct & perThreadVariables = this->m_PerThreadVariables[threadID];
 
-      /** Penalty term calculation */
-      if (pixelValue > 0 && pixelValue < 6)
+  /** The strides of the control point grid. */
+  const typename BSplineKnotImageType::SizeType bSplineKnotImageSize =
+    this->m_BSplineKnotImage->GetBufferedRegion().GetSize();
+  const SizeValueType strideY = bSplineKnotImageSize[0];
+  const SizeValueType strideZ = bSplineKnotImageSize[0] * bSplineKnotImageSize[1];
+  const SizeValueType numberOfParametersPerDimension = this->GetNumberOfParameters() / ImageDimension;
+
+  MeasureType   value = NumericTraits<MeasureType>::Zero;
+  SizeValueType derivativeBegin = NumericTraits<SizeValueType>::max();
+  SizeValueType derivativeEnd = 0;
+  for (SizeValueType i = begin; i < end; ++i)
+  {
+    const OutputPointType & xf = this->m_TransformedRigidPoints[i];
+    const MeasureType       weight = this->m_RigidPointWeights[i];
+
+    /** Every pair (i, j) contributes to the penalty term with the weight of i,
+     * and (j, i) with the weight of j. Both terms have the same derivative
+     * with respect to the position of point i, up to their weights, so the
+     * derivative with respect to point i is gathered without writing to the
+     * other points.
+     */
+    MeasureType force[ImageDimension] = {};
+    for (SizeValueType k = this->m_NeighborOffsets[i]; k < this->m_NeighborOffsets[i + 1]; ++k)
+    {
+      const unsigned int      j = this->m_NeighborIndices[k];
+      const OutputPointType & xn = this->m_TransformedRigidPoints[j];
+
+      MeasureType diff[ImageDimension];
+      MeasureType dx = 0.0;
+      for (unsigned int dd = 0; dd < ImageDimension; ++dd)
       {
-        numberOfRigidGridsNeighbor = 0;
+        diff[dd] = xn[dd] - xf[dd];
+        dx += diff[dd] * diff[dd];
+      }
+      const MeasureType dX = this->m_NeighborSquaredDistances[k];
 
-        for (unsigned int kk = 0; kk < numberOfNeighborhood; ++kk)
-        {
-          neighborPenaltyGridIndex = ni.GetIndex(kk);
+      value += weight * (dx - dX) * (dx - dX);
 
-          this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(neighborPenaltyGridIndex, neighborPenaltyGridPoint);
+      const MeasureType factor = 4.0 * (dx - dX) * (weight + this->m_RigidPointWeights[j]);
+      for (unsigned int dd = 0; dd < ImageDimension; ++dd)
+      {
+        force[dd] -= factor * diff[dd];
+      }
+    }
 
-          pixelValueNeighbor =
-            static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(neighborPenaltyGridPoint));
+    if (!computeDerivative)
+    {
+      continue;
+    }
 
-          if (pixelValue == pixelValueNeighbor)
+    /** Distribute the derivative over the B-spline support of point i. */
+    const SizeValueType  supportStart = this->m_SupportStarts[i];
+    const double * const w = &this->m_SupportWeights[(4 * ImageDimension) * i];
+    for (unsigned int kk = 0; kk < 4; ++kk)
+    {
+      for (unsigned int jj = 0; jj < 4; ++jj)
+      {
+        const double        wyz = w[4 + jj] * w[8 + kk];
+        const SizeValueType rowStart = supportStart + jj * strideY + kk * strideZ;
+        for (unsigned int ii = 0; ii < 4; ++ii)
+        {
+          const double du_dC = w[ii] * wyz;
+          for (unsigned int dd = 0; dd < ImageDimension; ++dd)
           {
-            numberOfRigidGridsNeighbor++;
+            perThreadVariables.st_Derivative[rowStart + ii + dd * numberOfParametersPerDimension] +=
+              force[dd] * du_dC;
           }
         }
-
-        if (numberOfRigidGridsNeighbor > 1)
-        {
-          for (unsigned int kk = 0; kk < numberOfNeighborhood; ++kk)
-          {
-            neighborPenaltyGridIndex = ni.GetIndex(kk);
-
-            this->m_PenaltyGridImage->TransformIndexToPhysicalPoint(neighborPenaltyGridIndex, neighborPenaltyGridPoint);
-
-            pixelValueNeighbor =
-              static_cast<unsigned int>(segmentedImageInterpolator->Evaluate(neighborPenaltyGridPoint));
-
-            if (pixelValue == pixelValueNeighbor)
-            {
-              xn = this->m_Transform->TransformPoint(neighborPenaltyGridPoint);
-              xf = this->m_Transform->TransformPoint(penaltyGridPoint);
-
-              dX = (neighborPenaltyGridPoint[0] - penaltyGridPoint[0]) *
-                     (neighborPenaltyGridPoint[0] - penaltyGridPoint[0]) +
-                   (neighborPenaltyGridPoint[1] - penaltyGridPoint[1]) *
-                     (neighborPenaltyGridPoint[1] - penaltyGridPoint[1]) +
-                   (neighborPenaltyGridPoint[2] - penaltyGridPoint[2]) *
-                     (neighborPenaltyGridPoint[2] - penaltyGridPoint[2]);
-
-              dx = (xn[0] - xf[0]) * (xn[0] - xf[0]) + (xn[1] - xf[1]) * (xn[1] - xf[1]) +
-                   (xn[2] - xf[2]) * (xn[2] - xf[2]);
-
-              penaltyTermBuffer = (dx - dX) * (dx - dX);
-
-              value += penaltyTermBuffer / numberOfRigidGridsNeighbor / (this->m_NumberOfRigidGrids);
-
-              // find neighboring B-Spline control points
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex(penaltyGridPoint, tindex);
-              this->m_BSplineKnotImage->TransformPhysicalPointToContinuousIndex(neighborPenaltyGridPoint,
-                                                                                tindex_neighbor);
-
-              tx = tindex[0];
-              ty = tindex[1];
-              tz = tindex[2];
-
-              tx_neighbor = tindex_neighbor[0];
-              ty_neighbor = tindex_neighbor[1];
-              tz_neighbor = tindex_neighbor[2];
-
-              for (unsigned dd = 0; dd < ImageDimension; ++dd)
-              {
-                ntindex_start[dd] = static_cast<ContinuousIndexValueType>(floor(tindex[dd])) - 1.0;
-                ntindex_neighbor_start[dd] = static_cast<ContinuousIndexValueType>(floor(tindex_neighbor[dd])) - 1.0;
-              }
-
-              derivativeTermTemp1 =
-                4 * (dx - dX) * (xn[0] - xf[0]) / numberOfRigidGridsNeighbor / (this->m_NumberOfRigidGrids);
-              derivativeTermTemp2 =
-                4 * (dx - dX) * (xn[1] - xf[1]) / numberOfRigidGridsNeighbor / (this->m_NumberOfRigidGrids);
-              derivativeTermTemp3 =
-                4 * (dx - dX) * (xn[2] - xf[2]) / numberOfRigidGridsNeighbor / (this->m_NumberOfRigidGrids);
-
-              for (unsigned int kk = 0; kk < 4; ++kk)
-              {
-                p = ntindex_start[2] + kk;
-                neighbor_p = ntindex_neighbor_start[2] + kk;
-
-                for (unsigned int jj = 0; jj < 4; ++jj)
-                {
-                  n = ntindex_start[1] + jj;
-                  neighbor_n = ntindex_neighbor_start[1] + jj;
-
-                  for (unsigned int ii = 0; ii < 4; ++ii)
-                  {
-                    m = ntindex_start[0] + ii;
-                    neighbor_m = ntindex_neighbor_start[0] + ii;
-
-                    // neighborhood of (i',j',k')
-                    du_dC_neighbor = (bSplineKernel->Evaluate(tx_neighbor - neighbor_m)) *
-                                     (bSplineKernel->Evaluate(ty_neighbor - neighbor_n)) *
-                                     (bSplineKernel->Evaluate(tz_neighbor - neighbor_p));
-
-                    par1 = static_cast<unsigned int>(neighbor_m) +
-                           bSplineKnotImageSize[0] * static_cast<unsigned int>(neighbor_n) +
-                           bSplineKnotImageSize[0] * bSplineKnotImageSize[1] * static_cast<unsigned int>(neighbor_p);
-
-                    derivative[par1] += derivativeTermTemp1 * du_dC_neighbor;
-                    derivative[par1 + numberOfParametersPerDimension] += derivativeTermTemp2 * du_dC_neighbor;
-                    derivative[par1 + 2 * numberOfParametersPerDimension] += derivativeTermTemp3 * du_dC_neighbor;
-
-                    // neighborhood of (i,j,k)
-                    du_dC = (bSplineKernel->Evaluate(tx - m)) * (bSplineKernel->Evaluate(ty - n)) *
-                            (bSplineKernel->Evaluate(tz - p));
-
-                    par2 = static_cast<unsigned int>(m) + bSplineKnotImageSize[0] * static_cast<unsigned int>(n) +
-                           bSplineKnotImageSize[0] * bSplineKnotImageSize[1] * static_cast<unsigned int>(p);
-
-                    derivative[par2] -= derivativeTermTemp1 * du_dC;
-                    derivative[par2 + numberOfParametersPerDimension] -= derivativeTermTemp2 * du_dC;
-                    derivative[par2 + 2 * numberOfParametersPerDimension] -= derivativeTermTemp3 * du_dC;
-                  }
-                }
-              }
-            }
-          } // end for
-        }   // end if
       }
-    } // end for
-  }   // end if ( dimension = 3 )
+    }
 
-} // end GetValueAndDerivative()
+    derivativeBegin = std::min(derivativeBegin, supportStart);
+    derivativeEnd = std::max(derivativeEnd, supportStart + 3 * strideZ + 3 * strideY + 4);
+  }
+
+  perThreadVariables.st_Value = value;
+  perThreadVariables.st_DerivativeBegin = derivativeBegin;
+  perThreadVariables.st_DerivativeEnd = derivativeEnd;
+
+} // end ThreadedComputeValueAndDerivative()
 
 
 /**
@@ -110,6 +110,7 @@ public:
   typedef typename Superclass::MovingImageType         MovingImageType;
   typedef typename Superclass::FixedImageConstPointer  FixedImageConstPointer;
   typedef typename Superclass::MovingImageConstPointer MovingImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType    FixedImageRegionType;
   typedef typename TFixedImage::PixelType              FixedImagePixelType;
   typedef typename TMovingImage::PixelType             MovedImagePixelType;
   typedef typename MovingImageType::RegionType         MovingImageRegionType;
@@ -178,9 +179,17 @@ protected:
   void
   ComputeVariance(void) const;
 
-  /** Compute the similarity measure using a specified subtraction factor. */
+  /** Compute the similarity measure using a specified subtraction factor.
+   * The moving image gradients should be up to date.
+   */
   MeasureType
-  ComputeMeasure(const TransformParametersType & parameters, const double * subtractionFactor) const;
+  ComputeMeasure(const double * subtractionFactor) const;
+
+  /** Resample the moving image and compute its gradients, but only in the
+   * region of the fixed image where the measure is computed.
+   */
+  void
+  UpdateMovedGradients(void) const;
 
   typedef NeighborhoodOperatorImageFilter<FixedGradientImageType, FixedGradientImageType> FixedSobelFilter;
 
@@ -228,6 +237,11 @@ private:
   double                      m_DerivativeDelta;
   double                      m_Rescalingfactor;
   CombinationTransformPointer m_CombinationTransform;
+
+  /** The fixed image region cropped to the fixed mask, the only region
+   * where the measure is computed.
+   */
+  FixedImageRegionType m_MetricRegion;
 };
 
 } // end namespace itk
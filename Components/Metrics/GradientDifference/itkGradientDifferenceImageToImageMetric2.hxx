@@ -93,6 +93,9 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void
 
   unsigned int iFilter;
 
+  /** Pixels outside the fixed mask do not contribute to the measure. */
+  this->m_MetricRegion = this->CropFixedImageRegionToMask(this->GetFixedImageRegion());
+
   /** Compute the gradient of the fixed images */
   this->m_CastFixedImageFilter->SetInput(this->m_FixedImage);
   this->m_CastFixedImageFilter->Update();
@@ -127,7 +130,6 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformMovingImageFilter->SetOutputSpacing(this->m_FixedImage->GetSpacing());
   this->m_TransformMovingImageFilter->SetOutputDirection(this->m_FixedImage->GetDirection());
-  this->m_TransformMovingImageFilter->Update();
 
   this->m_CastMovedImageFilter->SetInput(this->m_TransformMovingImageFilter->GetOutput());
 
@@ -139,8 +141,8 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void
     this->m_MovedSobelFilters[iFilter]->OverrideBoundaryCondition(&this->m_MovedBoundCond);
     this->m_MovedSobelFilters[iFilter]->SetOperator(this->m_MovedSobelOperators[iFilter]);
     this->m_MovedSobelFilters[iFilter]->SetInput(this->m_CastMovedImageFilter->GetOutput());
-    this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
   }
+  this->UpdateMovedGradients();
 
   /** Compute the variance */
   ComputeVariance();
@@ -169,6 +171,26 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::
 }
 
 
+/**
+ * ******************** UpdateMovedGradients ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::UpdateMovedGradients(void) const
+{
+  /** The Sobel filters request the region plus their radius from the
+   * resampler, so that only these pixels are resampled.
+   */
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    this->m_MovedSobelFilters[iFilter]->GetOutput()->SetRequestedRegion(this->m_MetricRegion);
+    this->m_MovedSobelFilters[iFilter]->Update();
+  }
+
+} // end UpdateMovedGradients()
+
+
 /**
  * ******************** ComputeMovedGradientRange ******************************
  */
@@ -184,7 +206,7 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMovedGra
   {
     typedef itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType> IteratorType;
 
-    IteratorType iterate(m_MovedSobelFilters[iDimension]->GetOutput(), this->GetFixedImageRegion());
+    IteratorType iterate(m_MovedSobelFilters[iDimension]->GetOutput(), this->m_MetricRegion);
 
     gradient = iterate.Get();
 
@@ -227,7 +249,7 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeVariance
   {
     typedef itk::ImageRegionConstIteratorWithIndex<FixedGradientImageType> IteratorType;
 
-    IteratorType iterate(this->m_FixedSobelFilters[iDimension]->GetOutput(), this->GetFixedImageRegion());
+    IteratorType iterate(this->m_FixedSobelFilters[iDimension]->GetOutput(), this->m_MetricRegion);
 
     /** Calculate the mean gradients */
     nPixels = 0;
@@ -338,29 +360,10 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeVariance
 template <class TFixedImage, class TMovingImage>
 typename GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::MeasureType
 GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
-  const TransformParametersType & parameters,
-  const double *                  subtractionFactor) const
+  const double * subtractionFactor) const
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
-   */
-  this->BeforeThreadedGetValueAndDerivative(parameters);
-  // this->SetTransformParameters( parameters );
-
   unsigned int iDimension;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-  MeasureType measure = NumericTraits<MeasureType>::Zero;
+  MeasureType  measure = NumericTraits<MeasureType>::Zero;
 
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
@@ -383,14 +386,11 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
 
     typedef itk::ImageRegionConstIteratorWithIndex<FixedGradientImageType> FixedIteratorType;
 
-    FixedIteratorType fixedIterator(this->m_FixedSobelFilters[iDimension]->GetOutput(), this->GetFixedImageRegion());
+    FixedIteratorType fixedIterator(this->m_FixedSobelFilters[iDimension]->GetOutput(), this->m_MetricRegion);
 
     typedef itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType> MovedIteratorType;
 
-    MovedIteratorType movedIterator(this->m_MovedSobelFilters[iDimension]->GetOutput(), this->GetFixedImageRegion());
-
-    this->m_FixedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
+    MovedIteratorType movedIterator(this->m_MovedSobelFilters[iDimension]->GetOutput(), this->m_MetricRegion);
 
     bool sampleOK = false;
 
@@ -448,17 +448,25 @@ typename GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Measur
 GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   const TransformParametersType & parameters) const
 {
-  unsigned int iFilter;
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   * Because of these calls GetValueAndDerivative itself is not thread-safe,
+   * so cannot be called multiple times simultaneously.
+   * This is however needed in the CombinationImageToImageMetric.
+   * In that case, you need to:
+   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
+   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
+   *   calling GetValueAndDerivative
+   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
+   * - Now you can call GetValueAndDerivative multi-threaded.
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Update the gradient images; the moving image is resampled only once. */
   unsigned int iDimension;
-  this->SetTransformParameters(parameters);
   this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-
-  /** Update the gradient images */
-  for (iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
-  {
-    this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
-  }
+  this->UpdateMovedGradients();
 
   /** Compute the range of the moved image gradients */
   this->ComputeMovedGradientRange();
@@ -471,7 +479,7 @@ GradientDifferenceImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
     subtractionFactor[iDimension] = this->m_MaxFixedGradient[iDimension] / this->m_MaxMovedGradient[iDimension];
   }
 
-  currentMeasure = this->ComputeMeasure(parameters, subtractionFactor);
+  currentMeasure = this->ComputeMeasure(subtractionFactor);
 
   return currentMeasure;
 
@@ -68,7 +68,7 @@ enum ANNerr
 //----------------------------------------------------------------------
 
 extern int ANNmaxPtsVisited; // maximum number of pts visited
-extern int ANNptsVisited;    // number of pts visited in search
+extern thread_local int ANNptsVisited;    // number of pts visited in search
 
 //----------------------------------------------------------------------
 //	Global function declarations
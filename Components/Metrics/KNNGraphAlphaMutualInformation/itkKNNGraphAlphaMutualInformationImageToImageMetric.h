@@ -40,6 +40,9 @@
 /** Include for the spatial derivatives. */
 #include "itkArray2D.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace itk
 {
 /**
@@ -290,6 +293,20 @@ private:
   typedef std::vector<NonZeroJacobianIndicesType> TransformJacobianIndicesContainerType;
   typedef Array2D<double>                         SpatialDerivativeType;
   typedef std::vector<SpatialDerivativeType>      SpatialDerivativeContainerType;
+  typedef typename Superclass::ThreadInfoType     ThreadInfoType;
+
+  /** The variables that are passed to the threads that search the neighbours. */
+  struct KNNThreaderParameterType
+  {
+    const Self *                                  st_Metric;
+    const ListSampleType *                        st_ListSampleFixed;
+    const ListSampleType *                        st_ListSampleMoving;
+    const ListSampleType *                        st_ListSampleJoint;
+    const TransformJacobianContainerType *        st_Jacobians;
+    const TransformJacobianIndicesContainerType * st_JacobiansIndices;
+    const SpatialDerivativeContainerType *        st_SpatialDerivatives;
+    bool                                          st_DoDerivative;
+  };
 
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
@@ -339,6 +356,42 @@ private:
                            const MeasureType &                distance_J,
                            DerivativeType &                   dGamma_M,
                            DerivativeType &                   dGamma_J) const;
+
+  /** Generate the tree of the fixed samples, unless it was already generated
+   * for the same samples. The fixed samples only change when the sampler
+   * selects new samples, or when other samples are valid.
+   */
+  void
+  UpdateFixedTree(const ListSamplePointer & listSampleFixed) const;
+
+  /** Search the neighbours of the query points [begin, end), and add their
+   * contributions to sumG and, if desired, the unnormalised derivative.
+   */
+  void
+  ComputeContributions(const KNNThreaderParameterType & parameters,
+                       const unsigned long              begin,
+                       const unsigned long              end,
+                       MeasureType &                    sumG,
+                       DerivativeType *                 contribution) const;
+
+  /** Search the neighbours with the threads. The searches of ANN are thread-safe,
+   * and the contributions are summed in the per thread variables.
+   */
+  void
+  LaunchComputeContributions(const KNNThreaderParameterType & parameters,
+                             MeasureType &                    sumG,
+                             DerivativeType *                 contribution) const;
+
+  /** The threader callback of LaunchComputeContributions(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  ComputeContributionsThreaderCallback(void * arg);
+
+  /** The fixed samples of the fixed tree, and the sums of the distances to
+   * the fixed neighbours, which do not change either.
+   */
+  mutable std::vector<double>      m_FixedTreeSamples;
+  mutable std::vector<MeasureType> m_FixedGammas;
+  mutable bool                     m_FixedGammasComputed{ false };
 };
 
 } // end namespace itk
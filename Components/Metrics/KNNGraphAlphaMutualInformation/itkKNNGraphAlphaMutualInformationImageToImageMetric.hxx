@@ -88,6 +88,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeFixed = tmpPtrF;
   this->m_BinaryKNNTreeMoving = tmpPtrM;
   this->m_BinaryKNNTreeJoint = tmpPtrJ;
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNkDTree()
 
@@ -142,6 +143,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeFixed = tmpPtrF;
   this->m_BinaryKNNTreeMoving = tmpPtrM;
   this->m_BinaryKNNTreeJoint = tmpPtrJ;
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNbdTree()
 
@@ -157,6 +159,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeFixed = ANNBruteForceTreeType::New();
   this->m_BinaryKNNTreeMoving = ANNBruteForceTreeType::New();
   this->m_BinaryKNNTreeJoint = ANNBruteForceTreeType::New();
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNBruteForceTree()
 
@@ -186,6 +189,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeSearcherFixed = tmpPtrF;
   this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
   this->m_BinaryKNNTreeSearcherJoint = tmpPtrJ;
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNStandardTreeSearch()
 
@@ -220,6 +224,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeSearcherFixed = tmpPtrF;
   this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
   this->m_BinaryKNNTreeSearcherJoint = tmpPtrJ;
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNFixedRadiusTreeSearch()
 
@@ -249,6 +254,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Set
   this->m_BinaryKNNTreeSearcherFixed = tmpPtrF;
   this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
   this->m_BinaryKNNTreeSearcherJoint = tmpPtrJ;
+  this->m_FixedTreeSamples.clear();
 
 } // end SetANNPriorityTreeSearch()
 
@@ -276,6 +282,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Ini
     itkExceptionMacro(<< "ERROR: The kNN tree searcher is not set. ");
   }
 
+  /** The fixed tree is generated again at the first evaluation. */
+  this->m_FixedTreeSamples.clear();
+
 } // end Initialize()
 
 
@@ -325,9 +334,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample(listSampleFixed);
-  this->m_BinaryKNNTreeFixed->GenerateTree();
+  /** Generate the tree for the fixed image samples, if they changed. */
+  this->UpdateFixedTree(listSampleFixed);
 
   /** Generate the tree for the moving image samples. */
   this->m_BinaryKNNTreeMoving->SetSample(listSampleMoving);
@@ -338,7 +346,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
   this->m_BinaryKNNTreeJoint->GenerateTree();
 
   /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
   this->m_BinaryKNNTreeSearcherMoving->SetBinaryTree(this->m_BinaryKNNTreeMoving);
   this->m_BinaryKNNTreeSearcherJoint->SetBinaryTree(this->m_BinaryKNNTreeJoint);
 
@@ -375,77 +382,27 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits<MeasureType>::AccumulateType AccumulateType;
-  MeasurementVectorType                                       z_F, z_M, z_J;
-  IndexArrayType                                              indices_F, indices_M, indices_J;
-  DistanceArrayType                                           distances_F, distances_M, distances_J;
-
-  MeasureType    H, G;
-  AccumulateType sumG = NumericTraits<AccumulateType>::Zero;
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * (1.0 - this->m_Alpha);
-
-  /** Loop over all query points, i.e. all samples. */
-  for (unsigned long i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+  /** Search the neighbours of all query points, i.e. all samples. */
+  KNNThreaderParameterType knnParameters;
+  knnParameters.st_Metric = this;
+  knnParameters.st_ListSampleFixed = listSampleFixed.GetPointer();
+  knnParameters.st_ListSampleMoving = listSampleMoving.GetPointer();
+  knnParameters.st_ListSampleJoint = listSampleJoint.GetPointer();
+  knnParameters.st_Jacobians = nullptr;
+  knnParameters.st_JacobiansIndices = nullptr;
+  knnParameters.st_SpatialDerivatives = nullptr;
+  knnParameters.st_DoDerivative = false;
+
+  MeasureType sumG = NumericTraits<MeasureType>::Zero;
+  if (!this->m_UseMultiThread)
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(i, z_F);
-    listSampleMoving->GetMeasurementVector(i, z_M);
-    listSampleJoint->GetMeasurementVector(i, z_J);
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(z_F, indices_F, distances_F);
-    this->m_BinaryKNNTreeSearcherMoving->Search(z_M, indices_M, distances_M);
-    this->m_BinaryKNNTreeSearcherJoint->Search(z_J, indices_J, distances_J);
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = std::sqrt( distsJ[ j ] );
-    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += std::pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-     * for the three graphs:
-     * sum M / sqrt( sum F * sum M)
-     */
-
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F = NumericTraits<AccumulateType>::Zero;
-    AccumulateType Gamma_M = NumericTraits<AccumulateType>::Zero;
-    AccumulateType Gamma_J = NumericTraits<AccumulateType>::Zero;
-
-    /** Loop over the neighbours. */
-    for (unsigned int p = 0; p < k; ++p)
-    {
-      Gamma_F += std::sqrt(distances_F[p]);
-      Gamma_M += std::sqrt(distances_M[p]);
-      Gamma_J += std::sqrt(distances_J[p]);
-    } // end loop over the k neighbours
-
-    /** Calculate the contribution of this query point. */
-    H = std::sqrt(Gamma_F * Gamma_M);
-    if (H > this->m_AvoidDivisionBy)
-    {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += std::pow(G, twoGamma);
-    }
-  } // end looping over all query points
+    this->ComputeContributions(knnParameters, 0, this->m_NumberOfPixelsCounted, sumG, nullptr);
+  }
+  else
+  {
+    this->LaunchComputeContributions(knnParameters, sumG, nullptr);
+  }
+  this->m_FixedGammasComputed = true;
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -549,9 +506,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample(listSampleFixed);
-  this->m_BinaryKNNTreeFixed->GenerateTree();
+  /** Generate the tree for the fixed image samples, if they changed. */
+  this->UpdateFixedTree(listSampleFixed);
 
   /** Generate the tree for the moving image samples. */
   this->m_BinaryKNNTreeMoving->SetSample(listSampleMoving);
@@ -562,7 +518,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
   this->m_BinaryKNNTreeJoint->GenerateTree();
 
   /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
   this->m_BinaryKNNTreeSearcherMoving->SetBinaryTree(this->m_BinaryKNNTreeMoving);
   this->m_BinaryKNNTreeSearcherJoint->SetBinaryTree(this->m_BinaryKNNTreeJoint);
 
@@ -599,109 +554,38 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits<MeasureType>::AccumulateType AccumulateType;
-  MeasurementVectorType                                       z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
-  IndexArrayType                                              indices_F, indices_M, indices_J;
-  DistanceArrayType                                           distances_F, distances_M, distances_J;
-  MeasureType                                                 distance_F, distance_M, distance_J;
-
-  MeasureType    H, G, Gpow;
-  AccumulateType sumG = NumericTraits<AccumulateType>::Zero;
-
-  DerivativeType contribution(this->GetNumberOfParameters());
-  contribution.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
-  DerivativeType dGamma_M(this->GetNumberOfParameters());
-  DerivativeType dGamma_J(this->GetNumberOfParameters());
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * (1.0 - this->m_Alpha);
-
-  /** Loop over all query points, i.e. all samples. */
-  for (unsigned long i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+  /** Search the neighbours of all query points, i.e. all samples. */
+  KNNThreaderParameterType knnParameters;
+  knnParameters.st_Metric = this;
+  knnParameters.st_ListSampleFixed = listSampleFixed.GetPointer();
+  knnParameters.st_ListSampleMoving = listSampleMoving.GetPointer();
+  knnParameters.st_ListSampleJoint = listSampleJoint.GetPointer();
+  knnParameters.st_Jacobians = &jacobianContainer;
+  knnParameters.st_JacobiansIndices = &jacobianIndicesContainer;
+  knnParameters.st_SpatialDerivatives = &spatialDerivativesContainer;
+  knnParameters.st_DoDerivative = true;
+
+  /** Get the size of the joint feature vectors. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+
+  MeasureType sumG = NumericTraits<MeasureType>::Zero;
+  if (!this->m_UseMultiThread)
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(i, z_F);
-    listSampleMoving->GetMeasurementVector(i, z_M);
-    listSampleJoint->GetMeasurementVector(i, z_J);
+    DerivativeType contribution(this->GetNumberOfParameters());
+    contribution.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+    this->ComputeContributions(knnParameters, 0, this->m_NumberOfPixelsCounted, sumG, &contribution);
 
-    /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(z_F, indices_F, distances_F);
-    this->m_BinaryKNNTreeSearcherMoving->Search(z_M, indices_M, distances_M);
-    this->m_BinaryKNNTreeSearcherJoint->Search(z_J, indices_J, distances_J);
-
-    /** Variables to compute the measure and its derivative. */
-    AccumulateType Gamma_F = NumericTraits<AccumulateType>::Zero;
-    AccumulateType Gamma_M = NumericTraits<AccumulateType>::Zero;
-    AccumulateType Gamma_J = NumericTraits<AccumulateType>::Zero;
-
-    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[i] * jacobianContainer[i];
-
-    dGamma_M.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
-    dGamma_J.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
-
-    /** Loop over the neighbours. */
-    for (unsigned int p = 0; p < k; ++p)
-    {
-      /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector(indices_M[p], z_M_ip);
-      listSampleMoving->GetMeasurementVector(indices_J[p], z_J_ip);
-
-      /** Get the distances. */
-      distance_F = std::sqrt(distances_F[p]);
-      distance_M = std::sqrt(distances_M[p]);
-      distance_J = std::sqrt(distances_J[p]);
-
-      /** Compute Gamma's. */
-      Gamma_F += distance_F;
-      Gamma_M += distance_M;
-      Gamma_J += distance_J;
-
-      /** Get the difference of z_ip^M with z_i^M. */
-      diff_M = z_M - z_M_ip;
-      diff_J = z_M - z_J_ip;
-
-      /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[indices_M[p]] * jacobianContainer[indices_M[p]];
-      D2sparse_J = spatialDerivativesContainer[indices_J[p]] * jacobianContainer[indices_J[p]];
-
-      /** Update the dGamma's. */
-      this->UpdateDerivativeOfGammas(D1sparse,
-                                     D2sparse_M,
-                                     D2sparse_J,
-                                     jacobianIndicesContainer[i],
-                                     jacobianIndicesContainer[indices_M[p]],
-                                     jacobianIndicesContainer[indices_J[p]],
-                                     diff_M,
-                                     diff_J,
-                                     distance_M,
-                                     distance_J,
-                                     dGamma_M,
-                                     dGamma_J);
-
-    } // end loop over the k neighbours
-
-    /** Compute contributions. */
-    H = std::sqrt(Gamma_F * Gamma_M);
-    if (H > this->m_AvoidDivisionBy)
+    /** Compute the derivative (-2.0 * d = -jointSize). */
+    if (sumG > this->m_AvoidDivisionBy)
     {
-      /** Compute some sums. */
-      G = Gamma_J / H;
-      sumG += std::pow(G, twoGamma);
-
-      /** Compute the contribution to the derivative. */
-      Gpow = std::pow(G, twoGamma - 1.0);
-      contribution += (Gpow / H) * (dGamma_J - (0.5 * Gamma_J / Gamma_M) * dGamma_M);
+      derivative = (static_cast<MeasureType>(jointSize) / sumG) * contribution;
     }
-
-  } // end looping over all query points
+  }
+  else
+  {
+    this->LaunchComputeContributions(knnParameters, sumG, &derivative);
+  }
+  this->m_FixedGammasComputed = true;
 
   /**
    * *************** Finally, calculate the metric value and derivative ******************
@@ -715,9 +599,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Get
     n = static_cast<double>(this->m_NumberOfPixelsCounted);
     number = std::pow(n, this->m_Alpha);
     measure = std::log(sumG / number) / (this->m_Alpha - 1.0);
-
-    /** Compute the derivative (-2.0 * d = -jointSize). */
-    derivative = (static_cast<AccumulateType>(jointSize) / sumG) * contribution;
   }
   value = -measure;
 
@@ -1038,6 +919,303 @@ KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::Upd
 } // end UpdateDerivativeOfGammas()
 
 
+/**
+ * ************************ UpdateFixedTree *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::UpdateFixedTree(
+  const ListSamplePointer & listSampleFixed) const
+{
+  /** Compare the fixed samples with the samples of the current fixed tree. */
+  typedef typename ListSampleType::InternalDataContainerType InternalDataContainerType;
+  const unsigned long                                       numberOfSamples = listSampleFixed->GetActualSize();
+  const unsigned int                                        dim = listSampleFixed->GetMeasurementVectorSize();
+  const InternalDataContainerType                           data = listSampleFixed->GetInternalContainer();
+
+  bool changed = this->m_FixedTreeSamples.size() != numberOfSamples * dim;
+  for (unsigned long i = 0; i < numberOfSamples && !changed; ++i)
+  {
+    changed = !std::equal(data[i], data[i] + dim, this->m_FixedTreeSamples.begin() + i * dim);
+  }
+  if (!changed)
+  {
+    return;
+  }
+
+  /** Store the new fixed samples, and generate the tree for them. */
+  this->m_FixedTreeSamples.resize(numberOfSamples * dim);
+  for (unsigned long i = 0; i < numberOfSamples; ++i)
+  {
+    std::copy(data[i], data[i] + dim, this->m_FixedTreeSamples.begin() + i * dim);
+  }
+
+  this->m_BinaryKNNTreeFixed->SetSample(listSampleFixed);
+  this->m_BinaryKNNTreeFixed->GenerateTree();
+  this->m_BinaryKNNTreeSearcherFixed->SetBinaryTree(this->m_BinaryKNNTreeFixed);
+
+  /** The distances to the fixed neighbours have to be searched again. */
+  this->m_FixedGammas.assign(numberOfSamples, NumericTraits<MeasureType>::Zero);
+  this->m_FixedGammasComputed = false;
+
+} // end UpdateFixedTree()
+
+
+/**
+ * ************************ ComputeContributions *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::ComputeContributions(
+  const KNNThreaderParameterType & parameters,
+  const unsigned long              begin,
+  const unsigned long              end,
+  MeasureType &                    sumG,
+  DerivativeType *                 contribution) const
+{
+  /** Temporary variables. */
+  typedef typename NumericTraits<MeasureType>::AccumulateType AccumulateType;
+  MeasurementVectorType                                       z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
+  IndexArrayType                                              indices_F, indices_M, indices_J;
+  DistanceArrayType                                           distances_F, distances_M, distances_J;
+  MeasureType                                                 distance_M, distance_J;
+
+  MeasureType    H, G, Gpow;
+  AccumulateType sumGLocal = NumericTraits<AccumulateType>::Zero;
+
+  const ListSampleType * listSampleFixed = parameters.st_ListSampleFixed;
+  const ListSampleType * listSampleMoving = parameters.st_ListSampleMoving;
+  const ListSampleType * listSampleJoint = parameters.st_ListSampleJoint;
+  const bool             doDerivative = parameters.st_DoDerivative;
+
+  DerivativeType dGamma_M, dGamma_J;
+  if (doDerivative)
+  {
+    dGamma_M.SetSize(this->GetNumberOfParameters());
+    dGamma_J.SetSize(this->GetNumberOfParameters());
+  }
+
+  /** Get the size of the feature vectors. */
+  unsigned int fixedSize = this->GetNumberOfFixedImages();
+  unsigned int movingSize = this->GetNumberOfMovingImages();
+  unsigned int jointSize = fixedSize + movingSize;
+
+  /** Get the number of neighbours and \gamma. */
+  unsigned int k = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  double       twoGamma = jointSize * (1.0 - this->m_Alpha);
+
+  /** Loop over the query points [begin, end). */
+  for (unsigned long i = begin; i < end; ++i)
+  {
+    /** Get the i-th query point. */
+    listSampleMoving->GetMeasurementVector(i, z_M);
+    listSampleJoint->GetMeasurementVector(i, z_J);
+
+    /** Search for the k nearest neighbours of the current query point.
+     * The fixed samples are the same as for the previous evaluation when
+     * the fixed tree was not generated again, and so are the fixed distances.
+     */
+    AccumulateType Gamma_F = NumericTraits<AccumulateType>::Zero;
+    if (this->m_FixedGammasComputed)
+    {
+      Gamma_F = this->m_FixedGammas[i];
+    }
+    else
+    {
+      listSampleFixed->GetMeasurementVector(i, z_F);
+      this->m_BinaryKNNTreeSearcherFixed->Search(z_F, indices_F, distances_F);
+      for (unsigned int p = 0; p < k; ++p)
+      {
+        Gamma_F += std::sqrt(distances_F[p]);
+      }
+      this->m_FixedGammas[i] = Gamma_F;
+    }
+    this->m_BinaryKNNTreeSearcherMoving->Search(z_M, indices_M, distances_M);
+    this->m_BinaryKNNTreeSearcherJoint->Search(z_J, indices_J, distances_J);
+
+    /** Variables to compute the measure and its derivative. */
+    AccumulateType Gamma_M = NumericTraits<AccumulateType>::Zero;
+    AccumulateType Gamma_J = NumericTraits<AccumulateType>::Zero;
+
+    if (!doDerivative)
+    {
+      /** Add the distances of all neighbours of the query point,
+       * for the three graphs:
+       * sum M / sqrt( sum F * sum M)
+       */
+      for (unsigned int p = 0; p < k; ++p)
+      {
+        Gamma_M += std::sqrt(distances_M[p]);
+        Gamma_J += std::sqrt(distances_J[p]);
+      }
+
+      /** Calculate the contribution of this query point. */
+      H = std::sqrt(Gamma_F * Gamma_M);
+      if (H > this->m_AvoidDivisionBy)
+      {
+        G = Gamma_J / H;
+        sumGLocal += std::pow(G, twoGamma);
+      }
+      continue;
+    }
+
+    const TransformJacobianContainerType &        jacobianContainer = *parameters.st_Jacobians;
+    const TransformJacobianIndicesContainerType & jacobianIndicesContainer = *parameters.st_JacobiansIndices;
+    const SpatialDerivativeContainerType &        spatialDerivativesContainer = *parameters.st_SpatialDerivatives;
+
+    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
+    D1sparse = spatialDerivativesContainer[i] * jacobianContainer[i];
+
+    dGamma_M.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+    dGamma_J.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+
+    /** Loop over the neighbours. */
+    for (unsigned int p = 0; p < k; ++p)
+    {
+      /** Get the neighbour point z_ip^M. */
+      listSampleMoving->GetMeasurementVector(indices_M[p], z_M_ip);
+      listSampleMoving->GetMeasurementVector(indices_J[p], z_J_ip);
+
+      /** Get the distances. */
+      distance_M = std::sqrt(distances_M[p]);
+      distance_J = std::sqrt(distances_J[p]);
+
+      /** Compute Gamma's. */
+      Gamma_M += distance_M;
+      Gamma_J += distance_J;
+
+      /** Get the difference of z_ip^M with z_i^M. */
+      diff_M = z_M - z_M_ip;
+      diff_J = z_M - z_J_ip;
+
+      /** Compute derivatives. */
+      D2sparse_M = spatialDerivativesContainer[indices_M[p]] * jacobianContainer[indices_M[p]];
+      D2sparse_J = spatialDerivativesContainer[indices_J[p]] * jacobianContainer[indices_J[p]];
+
+      /** Update the dGamma's. */
+      this->UpdateDerivativeOfGammas(D1sparse,
+                                     D2sparse_M,
+                                     D2sparse_J,
+                                     jacobianIndicesContainer[i],
+                                     jacobianIndicesContainer[indices_M[p]],
+                                     jacobianIndicesContainer[indices_J[p]],
+                                     diff_M,
+                                     diff_J,
+                                     distance_M,
+                                     distance_J,
+                                     dGamma_M,
+                                     dGamma_J);
+
+    } // end loop over the k neighbours
+
+    /** Compute contributions. */
+    H = std::sqrt(Gamma_F * Gamma_M);
+    if (H > this->m_AvoidDivisionBy)
+    {
+      /** Compute some sums. */
+      G = Gamma_J / H;
+      sumGLocal += std::pow(G, twoGamma);
+
+      /** Compute the contribution to the derivative. */
+      Gpow = std::pow(G, twoGamma - 1.0);
+      *contribution += (Gpow / H) * (dGamma_J - (0.5 * Gamma_J / Gamma_M) * dGamma_M);
+    }
+
+  } // end looping over the query points
+
+  sumG += sumGLocal;
+
+} // end ComputeContributions()
+
+
+/**
+ * ************************ LaunchComputeContributions *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::LaunchComputeContributions(
+  const KNNThreaderParameterType & parameters,
+  MeasureType &                    sumG,
+  DerivativeType *                 derivative) const
+{
+  /** Search the neighbours with the threads. */
+  this->LaunchThreaderCallback(this->ComputeContributionsThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&parameters)));
+
+  /** Accumulate the values. */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  sumG = NumericTraits<MeasureType>::Zero;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    sumG += this->m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+
+    /** Reset this variable for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
+  }
+
+  if (!parameters.st_DoDerivative)
+  {
+    return;
+  }
+
+  /** Accumulate the derivatives: derivative = ( jointSize / sumG ) * contribution.
+   * The accumulation also resets the derivatives of the threads.
+   */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+  const bool         validSum = sumG > this->m_AvoidDivisionBy;
+  this->m_ThreaderMetricParameters.st_DerivativePointer = derivative->begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor =
+    validSum ? sumG / static_cast<MeasureType>(jointSize) : NumericTraits<MeasureType>::One;
+
+  this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+  if (!validSum)
+  {
+    derivative->Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+  }
+
+} // end LaunchComputeContributions()
+
+
+/**
+ * ************************ ComputeContributionsThreaderCallback *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+KNNGraphAlphaMutualInformationImageToImageMetric<TFixedImage, TMovingImage>::ComputeContributionsThreaderCallback(
+  void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  const KNNThreaderParameterType * parameters = static_cast<const KNNThreaderParameterType *>(infoStruct->UserData);
+  const Self *                     metric = parameters->st_Metric;
+
+  /** Divide the query points in contiguous chunks. */
+  const unsigned long numberOfSamples = metric->m_NumberOfPixelsCounted;
+  const unsigned long chunkSize = (numberOfSamples + nrOfThreads - 1) / nrOfThreads;
+  const unsigned long begin = std::min<unsigned long>(threadID * chunkSize, numberOfSamples);
+  const unsigned long end = std::min<unsigned long>(begin + chunkSize, numberOfSamples);
+
+  /** Compute the contributions of this chunk. */
+  MeasureType      sumG = NumericTraits<MeasureType>::Zero;
+  DerivativeType * contribution =
+    parameters->st_DoDerivative ? &metric->m_GetValueAndDerivativePerThreadVariables[threadID].st_Derivative : nullptr;
+  metric->ComputeContributions(*parameters, begin, end, sumG, contribution);
+
+  metric->m_GetValueAndDerivativePerThreadVariables[threadID].st_Value = sumG;
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeContributionsThreaderCallback()
+
+
 /**
  * ************************ PrintSelf *************************
  */
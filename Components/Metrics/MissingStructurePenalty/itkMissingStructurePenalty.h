@@ -26,6 +26,8 @@
 #include "itkVectorContainer.h"
 #include "vnl_adjugate_fixed.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -38,6 +40,11 @@ namespace itk
  * M.A. Viergever and J.P.W. Pluim "Registration of structurally dissimilar \n
  * images in MRI-based brachytherapy ", Phys. Med. Biol. 59 (2014) 4033-4045.\n
  * http://stacks.iop.org/0031-9155/59/4033
+ *
+ * The points of every mesh are transformed in one batch. The derivatives of the volume with
+ * respect to the points are multiplied by the sparse Jacobians of the points in threads, each
+ * accumulating in its own derivative.
+ *
  * \ingroup RegistrationMetrics
  */
 template <class TFixedPointSet, class TMovingPointSet>
@@ -75,6 +82,7 @@ public:
   typedef vnl_vector<CoordRepType>               VnlVectorType;
 
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
 
   /** Constants for the pointset dimensions. */
   itkStaticConstMacro(FixedPointSetDimension, unsigned int, Superclass::FixedPointSetDimension);
@@ -171,6 +179,34 @@ private:
   void
   SubVector(const VectorType & fullVector, SubVectorType & subVector, const unsigned int leaveOutIndex) const;
 
+  /** The struct that is passed to the threads of AccumulateDerivative(). */
+  struct MultiThreaderParameterType
+  {
+    const Self *           st_Metric;
+    const InputPointType * st_FixedPoints;
+    const MeshPointType *  st_PointDerivatives;
+    SizeValueType          st_NumberOfPoints;
+    ThreadIdType           st_NumberOfWorkUnits;
+    DerivativeType *       st_PerThreadDerivatives;
+  };
+
+  /** Add the products of the point derivatives with the Jacobians of the points to the derivative. */
+  void
+  AccumulateDerivative(const std::vector<InputPointType> & fixedPoints,
+                       const MeshPointType *               pointDerivatives,
+                       DerivativeType &                    derivative) const;
+
+  /** Add the contributions of the points in the range [begin, end) to the derivative. */
+  void
+  AccumulateDerivativeRange(const MultiThreaderParameterType & parameters,
+                            const SizeValueType                begin,
+                            const SizeValueType                end,
+                            DerivativeType &                   derivative) const;
+
+  /** The threader callback function of AccumulateDerivative(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  AccumulateDerivativeThreaderCallback(void * arg);
+
   MissingVolumeMeshPenalty(const Self &) = delete;
   void
   operator=(const Self &) = delete;
@@ -171,9 +171,6 @@ MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDerivative
   derivative = DerivativeType(this->GetNumberOfParameters());
   derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
 
-  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
-  TransformJacobianType      jacobian;
-
   const FixedMeshContainerElementIdentifier numberOfMeshes = this->m_FixedMeshContainer->Size();
 
   typename MeshPointsContainerType::Pointer pointCentroids = FixedMeshType::PointsContainer::New();
@@ -195,13 +192,25 @@ MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDerivative
 
     derivPoints->resize(numberOfPoints);
 
+    /** Transform the points of the mesh in one batch. */
+    std::vector<InputPointType>  fixedPointArray(numberOfPoints);
+    std::vector<OutputPointType> mappedPointArray(numberOfPoints);
+
     MeshPointsContainerConstIteratorType fixedPointIt = fixedPoints->Begin();
-    MeshPointsContainerIteratorType      mappedPointIt = mappedPoints->Begin();
     MeshPointsContainerConstIteratorType fixedPointEnd = fixedPoints->End();
+    for (unsigned int pointIndex = 0; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++pointIndex)
+    {
+      fixedPointArray[pointIndex] = fixedPointIt->Value();
+    }
+    if (numberOfPoints > 0)
+    {
+      this->TransformPoints(fixedPointArray.data(), mappedPointArray.data(), numberOfPoints);
+    }
 
-    for (; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++mappedPointIt)
+    MeshPointsContainerIteratorType mappedPointIt = mappedPoints->Begin();
+    for (unsigned int pointIndex = 0; pointIndex < numberOfPoints; ++mappedPointIt, ++pointIndex)
     {
-      const OutputPointType mappedPoint = this->m_Transform->TransformPoint(fixedPointIt->Value());
+      const OutputPointType & mappedPoint = mappedPointArray[pointIndex];
       mappedPointIt.Value() = mappedPoint;
       pointCentroid.GetVnlVector() += mappedPoint.GetVnlVector();
     }
@@ -295,31 +304,11 @@ MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDerivative
       sumAbsVolume += std::abs(signedVolume);
     }
 
-    /** Create iterators. */
-    fixedPointIt = fixedPoints->Begin();
-    unsigned int pointIndex;
-    /** Loop over points. */
-    for (pointIndex = 0; fixedPointIt != fixedPointEnd; ++fixedPointIt, ++pointIndex)
+    /** Multiply the derivatives with respect to the points with the Jacobians of the points. */
+    if (numberOfPoints > 0)
     {
-      /** Get the TransformJacobian dT/dmu. */
-      this->m_Transform->GetJacobian(fixedPointIt.Value(), jacobian, nzji);
-      if (nzji.size() == this->GetNumberOfParameters())
-      {
-        /** Loop over all Jacobians. */
-        derivative += derivPoints->at(pointIndex).GetVnlVector() * jacobian; //* sumAbsVolumeEps;
-      }
-      else
-      {
-        /** Only pick the nonzero Jacobians. */
-        for (unsigned int i = 0; i < nzji.size(); ++i)
-        {
-          const unsigned int index = nzji[i];
-          VnlVectorType      column = jacobian.get_column(i);
-          derivative[index] += dot_product(derivPoints->at(pointIndex).GetVnlVector(), column); // *sumAbsVolumeEps;
-        }
-      }
-
-    } // end loop over all corresponding points
+      this->AccumulateDerivative(fixedPointArray, &derivPoints->ElementAt(0), derivative);
+    }
 
     /** Check if enough samples were valid. */
 
@@ -330,6 +319,103 @@ MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDerivative
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* AccumulateDerivative *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::AccumulateDerivative(
+  const std::vector<InputPointType> & fixedPoints,
+  const MeshPointType *               pointDerivatives,
+  DerivativeType &                    derivative) const
+{
+  const SizeValueType numberOfPoints = fixedPoints.size();
+  const ThreadIdType  numberOfWorkUnits = this->GetNumberOfWorkUnitsForPoints(numberOfPoints);
+
+  MultiThreaderParameterType userData;
+  userData.st_Metric = this;
+  userData.st_FixedPoints = fixedPoints.data();
+  userData.st_PointDerivatives = pointDerivatives;
+  userData.st_NumberOfPoints = numberOfPoints;
+  userData.st_NumberOfWorkUnits = numberOfWorkUnits;
+  userData.st_PerThreadDerivatives = nullptr;
+
+  if (numberOfWorkUnits < 2)
+  {
+    this->AccumulateDerivativeRange(userData, 0, numberOfPoints, derivative);
+    return;
+  }
+
+  std::vector<DerivativeType> perThreadDerivatives(numberOfWorkUnits);
+  for (DerivativeType & threadDerivative : perThreadDerivatives)
+  {
+    threadDerivative.SetSize(this->GetNumberOfParameters());
+    threadDerivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+  }
+  userData.st_PerThreadDerivatives = perThreadDerivatives.data();
+
+  this->LaunchThreaderCallback(Self::AccumulateDerivativeThreaderCallback, &userData, numberOfWorkUnits);
+
+  /** Accumulate the derivatives of the threads. */
+  for (const DerivativeType & threadDerivative : perThreadDerivatives)
+  {
+    derivative += threadDerivative;
+  }
+
+} // end AccumulateDerivative()
+
+
+/**
+ * ******************* AccumulateDerivativeThreaderCallback *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::AccumulateDerivativeThreaderCallback(void * arg)
+{
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  SizeValueType begin = 0;
+  SizeValueType end = 0;
+  Self::GetWorkUnitPointRange(temp->st_NumberOfPoints, threadID, temp->st_NumberOfWorkUnits, begin, end);
+
+  temp->st_Metric->AccumulateDerivativeRange(*temp, begin, end, temp->st_PerThreadDerivatives[threadID]);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end AccumulateDerivativeThreaderCallback()
+
+
+/**
+ * ******************* AccumulateDerivativeRange *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+MissingVolumeMeshPenalty<TFixedPointSet, TMovingPointSet>::AccumulateDerivativeRange(
+  const MultiThreaderParameterType & parameters,
+  const SizeValueType                begin,
+  const SizeValueType                end,
+  DerivativeType &                   derivative) const
+{
+  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
+  TransformJacobianType      jacobian;
+
+  /** Loop over points. */
+  for (SizeValueType pointIndex = begin; pointIndex < end; ++pointIndex)
+  {
+    /** Get the TransformJacobian dT/dmu. */
+    this->m_Transform->GetJacobian(parameters.st_FixedPoints[pointIndex], jacobian, nzji);
+    this->AccumulateJacobianProduct(
+      parameters.st_PointDerivatives[pointIndex].GetVnlVector(), jacobian, nzji, derivative);
+  }
+
+} // end AccumulateDerivativeRange()
+
+
 /**
  * ******************* SubVector *******************
  */
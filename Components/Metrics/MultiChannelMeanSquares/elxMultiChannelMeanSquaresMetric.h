@@ -0,0 +1,158 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxMultiChannelMeanSquaresMetric_h
+#define elxMultiChannelMeanSquaresMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkMultiChannelMeanSquaresImageToImageMetric.h"
+
+namespace elastix
+{
+
+/**
+ * \class MultiChannelMeanSquaresMetric
+ * \brief A metric based on the itk::MultiChannelMeanSquaresImageToImageMetric.
+ *
+ * This metric compares the channels of a multichannel image pair, given as multiple fixed
+ * and moving images, with one evaluation of the transform per sample for all channels.
+ * Use it with the MultiResolutionRegistrationWithFeatures, a multi-input image sampler,
+ * and a BSplineInterpolator for every moving image. Like this for example:\n
+ * <tt>(Registration "MultiResolutionRegistrationWithFeatures")</tt>\n
+ * <tt>(ImageSampler "MultiInputRandomCoordinate")</tt>\n
+ * <tt>(Interpolator "BSplineInterpolator" "BSplineInterpolator" "BSplineInterpolator")</tt>
+ *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "MultiChannelMeanSquares")</tt>
+ * \parameter ChannelWeights: The weight of the squared differences of each channel.\n
+ *    <tt>(ChannelWeights 1.0 0.5 0.5)</tt>\n
+ *    The default value is 1.0 for every channel.
+ *
+ * \ingroup Metrics
+ *
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT MultiChannelMeanSquaresMetric
+  : public itk::MultiChannelMeanSquaresImageToImageMetric<typename MetricBase<TElastix>::FixedImageType,
+                                                          typename MetricBase<TElastix>::MovingImageType>
+  , public MetricBase<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef MultiChannelMeanSquaresMetric Self;
+  typedef itk::MultiChannelMeanSquaresImageToImageMetric<typename MetricBase<TElastix>::FixedImageType,
+                                                         typename MetricBase<TElastix>::MovingImageType>
+                                        Superclass1;
+  typedef MetricBase<TElastix>          Superclass2;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(MultiChannelMeanSquaresMetric, itk::MultiChannelMeanSquaresImageToImageMetric);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "MultiChannelMeanSquares")</tt>\n
+   */
+  elxClassNameMacro("MultiChannelMeanSquares");
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass1::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass1::MovingImageType              MovingImageType;
+  typedef typename Superclass1::MovingImagePixelType         MovingImagePixelType;
+  typedef typename Superclass1::MovingImageConstPointer      MovingImageConstPointer;
+  typedef typename Superclass1::FixedImageType               FixedImageType;
+  typedef typename Superclass1::FixedImageConstPointer       FixedImageConstPointer;
+  typedef typename Superclass1::FixedImageRegionType         FixedImageRegionType;
+  typedef typename Superclass1::TransformType                TransformType;
+  typedef typename Superclass1::TransformPointer             TransformPointer;
+  typedef typename Superclass1::InputPointType               InputPointType;
+  typedef typename Superclass1::OutputPointType              OutputPointType;
+  typedef typename Superclass1::TransformParametersType      TransformParametersType;
+  typedef typename Superclass1::TransformJacobianType        TransformJacobianType;
+  typedef typename Superclass1::InterpolatorType             InterpolatorType;
+  typedef typename Superclass1::InterpolatorPointer          InterpolatorPointer;
+  typedef typename Superclass1::RealType                     RealType;
+  typedef typename Superclass1::FixedImageMaskType           FixedImageMaskType;
+  typedef typename Superclass1::FixedImageMaskPointer        FixedImageMaskPointer;
+  typedef typename Superclass1::MovingImageMaskType          MovingImageMaskType;
+  typedef typename Superclass1::MovingImageMaskPointer       MovingImageMaskPointer;
+  typedef typename Superclass1::MeasureType                  MeasureType;
+  typedef typename Superclass1::DerivativeType               DerivativeType;
+  typedef typename Superclass1::ParametersType               ParametersType;
+  typedef typename Superclass1::ImageSamplerType             ImageSamplerType;
+  typedef typename Superclass1::ImageSamplerPointer          ImageSamplerPointer;
+  typedef typename Superclass1::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass1::ImageSampleContainerPointer  ImageSampleContainerPointer;
+  typedef typename Superclass1::ChannelWeightsType           ChannelWeightsType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
+
+  /** The moving image dimension. */
+  itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
+
+  /** Typedef's inherited from Elastix. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** Sets up a timer to measure the initialization time and
+   * calls the Superclass' implementation.
+   */
+  void
+  Initialize(void) override;
+
+  /**
+   * Do some things before registration:
+   * \li Set the ChannelWeights setting
+   */
+  void
+  BeforeRegistration(void) override;
+
+protected:
+  /** The constructor. */
+  MultiChannelMeanSquaresMetric() = default;
+  /** The destructor. */
+  ~MultiChannelMeanSquaresMetric() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  MultiChannelMeanSquaresMetric(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxMultiChannelMeanSquaresMetric.hxx"
+#endif
+
+#endif // end #ifndef elxMultiChannelMeanSquaresMetric_h
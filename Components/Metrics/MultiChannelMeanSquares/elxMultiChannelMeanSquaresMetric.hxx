@@ -0,0 +1,67 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxMultiChannelMeanSquaresMetric_hxx
+#define elxMultiChannelMeanSquaresMetric_hxx
+
+#include "elxMultiChannelMeanSquaresMetric.h"
+#include "itkTimeProbe.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template <class TElastix>
+void
+MultiChannelMeanSquaresMetric<TElastix>::Initialize(void)
+{
+  itk::TimeProbe timer;
+  timer.Start();
+  this->Superclass1::Initialize();
+  timer.Stop();
+  elxout << "Initialization of MultiChannelMeanSquares metric took: " << static_cast<long>(timer.GetMean() * 1000)
+         << " ms." << std::endl;
+
+} // end Initialize()
+
+
+/**
+ * ***************** BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+MultiChannelMeanSquaresMetric<TElastix>::BeforeRegistration(void)
+{
+  /** Get and set the channel weights, one per channel. */
+  const std::size_t  count = this->m_Configuration->CountNumberOfParameterEntries("ChannelWeights");
+  ChannelWeightsType weights(count, 1.0);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    this->m_Configuration->ReadParameter(weights[i], "ChannelWeights", i, false);
+  }
+  this->SetChannelWeights(weights);
+
+} // end BeforeRegistration()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxMultiChannelMeanSquaresMetric_hxx
@@ -0,0 +1,207 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkMultiChannelMeanSquaresImageToImageMetric_h
+#define itkMultiChannelMeanSquaresImageToImageMetric_h
+
+#include "itkMultiInputImageToImageMetricBase.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class MultiChannelMeanSquaresImageToImageMetric
+ * \brief Computes the weighted sum of the mean squared differences of several image channels.
+ *
+ * This metric takes the channels of a multichannel image pair as multiple fixed and moving
+ * images, see MultiInputImageToImageMetricBase. Fixed image i is compared to moving image i,
+ * and the metric value is
+ *
+ *   \f[ \frac{1}{N} \sum_{x} \sum_{i} w_i \left( M_i(T(x)) - F_i(x) \right)^2, \f]
+ *
+ * with \f$ w_i \f$ the channel weights. Compared to a mean squares metric per channel, in a
+ * multi-metric registration, the transform is evaluated only once per sample, for all channels:
+ * the mapped point, the continuous index in the moving images and the transform Jacobian are
+ * shared. The channel-wise moving image gradients are summed, weighted by their differences,
+ * before the single product with the transform Jacobian.
+ *
+ * All moving images should have the same geometry, and should be interpolated by a B-spline
+ * interpolator. The fixed images other than the first one are evaluated by the fixed image
+ * interpolators.
+ *
+ * \ingroup RegistrationMetrics
+ * \ingroup Metrics
+ */
+
+template <class TFixedImage, class TMovingImage>
+class ITK_TEMPLATE_EXPORT MultiChannelMeanSquaresImageToImageMetric
+  : public MultiInputImageToImageMetricBase<TFixedImage, TMovingImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef MultiChannelMeanSquaresImageToImageMetric                   Self;
+  typedef MultiInputImageToImageMetricBase<TFixedImage, TMovingImage> Superclass;
+  typedef SmartPointer<Self>                                          Pointer;
+  typedef SmartPointer<const Self>                                    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(MultiChannelMeanSquaresImageToImageMetric, MultiInputImageToImageMetricBase);
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::CoordinateRepresentationType CoordinateRepresentationType;
+  typedef typename Superclass::MovingImageType              MovingImageType;
+  typedef typename Superclass::MovingImagePixelType         MovingImagePixelType;
+  typedef typename Superclass::MovingImageConstPointer      MovingImageConstPointer;
+  typedef typename Superclass::FixedImageType               FixedImageType;
+  typedef typename Superclass::FixedImageConstPointer       FixedImageConstPointer;
+  typedef typename Superclass::FixedImageRegionType         FixedImageRegionType;
+  typedef typename Superclass::TransformType                TransformType;
+  typedef typename Superclass::TransformPointer             TransformPointer;
+  typedef typename Superclass::InputPointType               InputPointType;
+  typedef typename Superclass::OutputPointType              OutputPointType;
+  typedef typename Superclass::TransformParametersType      TransformParametersType;
+  typedef typename Superclass::TransformJacobianType        TransformJacobianType;
+  typedef typename Superclass::InterpolatorType             InterpolatorType;
+  typedef typename Superclass::InterpolatorPointer          InterpolatorPointer;
+  typedef typename Superclass::RealType                     RealType;
+  typedef typename Superclass::FixedImageMaskType           FixedImageMaskType;
+  typedef typename Superclass::FixedImageMaskPointer        FixedImageMaskPointer;
+  typedef typename Superclass::MovingImageMaskType          MovingImageMaskType;
+  typedef typename Superclass::MovingImageMaskPointer       MovingImageMaskPointer;
+  typedef typename Superclass::MeasureType                  MeasureType;
+  typedef typename Superclass::DerivativeType               DerivativeType;
+  typedef typename Superclass::DerivativeValueType          DerivativeValueType;
+  typedef typename Superclass::ParametersType               ParametersType;
+  typedef typename Superclass::ImageSamplerType             ImageSamplerType;
+  typedef typename Superclass::ImageSamplerPointer          ImageSamplerPointer;
+  typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
+  typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
+  typedef typename Superclass::NumberOfParametersType       NumberOfParametersType;
+  typedef typename Superclass::ThreaderType                 ThreaderType;
+  typedef typename Superclass::ThreadInfoType               ThreadInfoType;
+
+  /** The fixed image dimension. */
+  itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
+
+  /** The moving image dimension. */
+  itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
+
+  /** Typedef for the channel weights. */
+  typedef std::vector<double> ChannelWeightsType;
+
+  /** Initialize the Metric: checks that every fixed image has a moving image
+   * of the same geometry as the first one, and sets the channel weights.
+   */
+  void
+  Initialize(void) override;
+
+  /** Get the value for single valued optimizers. */
+  MeasureType
+  GetValue(const TransformParametersType & parameters) const override;
+
+  /** Get the derivatives of the match measure. */
+  void
+  GetDerivative(const TransformParametersType & parameters, DerivativeType & derivative) const override;
+
+  /** Get value and derivatives single-threaded. */
+  virtual void
+  GetValueAndDerivativeSingleThreaded(const TransformParametersType & parameters,
+                                      MeasureType &                   value,
+                                      DerivativeType &                derivative) const;
+
+  /** Get value and derivatives for multiple valued optimizers. */
+  void
+  GetValueAndDerivative(const TransformParametersType & parameters,
+                        MeasureType &                   value,
+                        DerivativeType &                derivative) const override;
+
+  /** Set/Get the weights of the channels. Channels without a weight get weight 1.0. */
+  virtual void
+  SetChannelWeights(const ChannelWeightsType & weights)
+  {
+    if (this->m_ChannelWeights != weights)
+    {
+      this->m_ChannelWeights = weights;
+      this->Modified();
+    }
+  }
+  itkGetConstReferenceMacro(ChannelWeights, ChannelWeightsType);
+
+protected:
+  MultiChannelMeanSquaresImageToImageMetric();
+  ~MultiChannelMeanSquaresImageToImageMetric() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Protected Typedefs ******************/
+
+  /** Typedefs inherited from superclass */
+  typedef typename Superclass::FixedImagePointType            FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType           MovingImagePointType;
+  typedef typename Superclass::MovingImageContinuousIndexType MovingImageContinuousIndexType;
+  typedef typename Superclass::MovingImageDerivativeType      MovingImageDerivativeType;
+  typedef typename Superclass::NonZeroJacobianIndicesType     NonZeroJacobianIndicesType;
+
+  /** Evaluates all channels at the sample with fixed point fixedPoint, of which the first
+   * channel has the fixed image value fixedImageValue, mapped to mappedPoint. Computes the
+   * sum of the weighted squared differences, and, if requested, the gradients of the moving
+   * channels summed with the weighted differences as weights. Returns false when the mapped
+   * point is outside the moving images.
+   */
+  bool
+  EvaluateChannels(const FixedImagePointType &  fixedPoint,
+                   const RealType               fixedImageValue,
+                   const MovingImagePointType & mappedPoint,
+                   MeasureType &                value,
+                   MovingImageDerivativeType *  channelGradient) const;
+
+  /** Adds the product of the transform Jacobian and the combined channel gradient to the derivative. */
+  void
+  UpdateDerivativeTerms(const DerivativeType &             imageJacobian,
+                        const NonZeroJacobianIndicesType & nzji,
+                        DerivativeType &                   derivative) const;
+
+  /** Get value and derivatives for each thread. */
+  inline void
+  ThreadedGetValueAndDerivative(ThreadIdType threadID) override;
+
+  /** Gather the values and derivatives from all threads */
+  inline void
+  AfterThreadedGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
+
+private:
+  MultiChannelMeanSquaresImageToImageMetric(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  ChannelWeightsType m_ChannelWeights;
+
+  /** The channel weights, one per channel, set by Initialize(). */
+  std::vector<RealType> m_Weights;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkMultiChannelMeanSquaresImageToImageMetric.hxx"
+#endif
+
+#endif // end #ifndef itkMultiChannelMeanSquaresImageToImageMetric_h
@@ -0,0 +1,551 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef _itkMultiChannelMeanSquaresImageToImageMetric_hxx
+#define _itkMultiChannelMeanSquaresImageToImageMetric_hxx
+
+#include "itkMultiChannelMeanSquaresImageToImageMetric.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::MultiChannelMeanSquaresImageToImageMetric()
+{
+  this->SetUseImageSampler(true);
+  this->SetUseFixedImageLimiter(false);
+  this->SetUseMovingImageLimiter(false);
+
+  /** The moving image gradients are computed by the B-spline interpolators. */
+  this->SetComputeGradient(false);
+
+} // end Constructor
+
+
+/**
+ * ********************* Initialize ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
+{
+  /** Initialize the superclass, which checks for the B-spline interpolators. */
+  this->Superclass::Initialize();
+
+  const unsigned int numberOfChannels = this->GetNumberOfMovingImages();
+  if (this->GetNumberOfFixedImages() != numberOfChannels)
+  {
+    itkExceptionMacro(<< "The number of fixed images (" << this->GetNumberOfFixedImages()
+                      << ") differs from the number of moving images (" << numberOfChannels << ").");
+  }
+  if (this->GetNumberOfInterpolators() != numberOfChannels)
+  {
+    itkExceptionMacro(<< "Every moving image should have an interpolator.");
+  }
+  if (numberOfChannels > 1 && this->GetNumberOfFixedImageInterpolators() < numberOfChannels)
+  {
+    itkExceptionMacro(<< "Every fixed image should have a fixed image interpolator.");
+  }
+
+  /** The continuous index of the mapped point is computed once, for all channels. */
+  const MovingImageType * first = this->GetMovingImage(0);
+  for (unsigned int i = 1; i < numberOfChannels; ++i)
+  {
+    const MovingImageType * channel = this->GetMovingImage(i);
+    if (channel->GetOrigin() != first->GetOrigin() || channel->GetSpacing() != first->GetSpacing() ||
+        channel->GetDirection() != first->GetDirection() ||
+        channel->GetBufferedRegion() != first->GetBufferedRegion())
+    {
+      itkExceptionMacro(<< "Moving image " << i << " does not have the same geometry as moving image 0.");
+    }
+  }
+
+  /** Set the channel weights. */
+  this->m_Weights.assign(numberOfChannels, 1.0);
+  for (unsigned int i = 0; i < numberOfChannels && i < this->m_ChannelWeights.size(); ++i)
+  {
+    this->m_Weights[i] = this->m_ChannelWeights[i];
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::ostream & os,
+                                                                                Indent         indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "ChannelWeights: [ ";
+  for (const double weight : this->m_ChannelWeights)
+  {
+    os << weight << " ";
+  }
+  os << "]" << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* EvaluateChannels *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::EvaluateChannels(
+  const FixedImagePointType &  fixedPoint,
+  const RealType               fixedImageValue,
+  const MovingImagePointType & mappedPoint,
+  MeasureType &                value,
+  MovingImageDerivativeType *  channelGradient) const
+{
+  /** All moving images have the same geometry, so one index check suffices. */
+  MovingImageContinuousIndexType cindex;
+  this->m_Interpolator->ConvertPointToContinuousIndex(mappedPoint, cindex);
+  if (!this->m_Interpolator->IsInsideBuffer(cindex))
+  {
+    return false;
+  }
+
+  value = NumericTraits<MeasureType>::Zero;
+  if (channelGradient)
+  {
+    channelGradient->Fill(0.0);
+  }
+
+  /** Evaluate the channels one after the other, at the same continuous index. */
+  const unsigned int numberOfChannels = this->m_Weights.size();
+  for (unsigned int i = 0; i < numberOfChannels; ++i)
+  {
+    const RealType fixedValue =
+      i == 0 ? fixedImageValue
+             : static_cast<RealType>(this->m_FixedImageInterpolatorVector[i]->Evaluate(fixedPoint));
+
+    RealType diff;
+    if (channelGradient)
+    {
+      double                    movingValue;
+      MovingImageDerivativeType movingGradient;
+      this->m_BSplineInterpolatorVector[i]->EvaluateValueAndDerivativeAtContinuousIndex(
+        cindex, movingValue, movingGradient);
+      diff = static_cast<RealType>(movingValue) - fixedValue;
+      const RealType weightedDiff = this->m_Weights[i] * diff;
+      for (unsigned int d = 0; d < MovingImageDimension; ++d)
+      {
+        (*channelGradient)[d] += weightedDiff * movingGradient[d];
+      }
+    }
+    else
+    {
+      diff = static_cast<RealType>(this->m_BSplineInterpolatorVector[i]->EvaluateAtContinuousIndex(cindex)) -
+             fixedValue;
+    }
+    value += this->m_Weights[i] * diff * diff;
+  }
+
+  return true;
+
+} // end EvaluateChannels()
+
+
+/**
+ * ******************* GetValue *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+typename MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::MeasureType
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
+  const TransformParametersType & parameters) const
+{
+  itkDebugMacro("GetValue( " << parameters << " ) ");
+
+  /** Initialize some variables. */
+  this->m_NumberOfPixelsCounted = 0;
+  MeasureType measure = NumericTraits<MeasureType>::Zero;
+
+  /** Make sure the transform parameters are up to date. */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->End();
+
+  /** Loop over the fixed image samples to calculate the mean squares. */
+  for (fiter = fbegin; fiter != fend; ++fiter)
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+    MovingImagePointType        mappedPoint;
+    MeasureType                 sampleValue;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
+
+    /** Check if point is inside the moving masks. */
+    if (sampleOk)
+    {
+      sampleOk = this->IsInsideMovingMask(mappedPoint);
+    }
+
+    /** Compute the squared differences of all channels. */
+    if (sampleOk)
+    {
+      const RealType fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+      sampleOk = this->EvaluateChannels(fixedPoint, fixedImageValue, mappedPoint, sampleValue, nullptr);
+    }
+
+    if (sampleOk)
+    {
+      this->m_NumberOfPixelsCounted++;
+      measure += sampleValue;
+    }
+
+  } // end for loop over the image sample container
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
+
+  /** Return the mean of the weighted squared differences. */
+  if (this->m_NumberOfPixelsCounted > 0)
+  {
+    measure /= static_cast<MeasureType>(this->m_NumberOfPixelsCounted);
+  }
+  return measure;
+
+} // end GetValue()
+
+
+/**
+ * ******************* GetDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetDerivative(
+  const TransformParametersType & parameters,
+  DerivativeType &                derivative) const
+{
+  /** When the derivative is calculated, all information for calculating
+   * the metric value is available. It does not cost anything to calculate
+   * the metric value now. Therefore, we have chosen to only implement the
+   * GetValueAndDerivative(), supplying it with a dummy value variable.
+   */
+  MeasureType dummyvalue = NumericTraits<MeasureType>::Zero;
+  this->GetValueAndDerivative(parameters, dummyvalue, derivative);
+
+} // end GetDerivative()
+
+
+/**
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  itkDebugMacro("GetValueAndDerivative( " << parameters << " ) ");
+
+  /** Initialize some variables. */
+  this->m_NumberOfPixelsCounted = 0;
+  MeasureType measure = NumericTraits<MeasureType>::Zero;
+  derivative = DerivativeType(this->GetNumberOfParameters());
+  derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+
+  /** Array that stores dM(x)/dmu, and the sparse Jacobian indices. */
+  NonZeroJacobianIndicesType nzji(this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices());
+  DerivativeType             imageJacobian(nzji.size());
+
+  /** Make sure the transform parameters are up to date. */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend = sampleContainer->End();
+
+  /** Loop over the fixed image samples to calculate the mean squares. */
+  for (fiter = fbegin; fiter != fend; ++fiter)
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = (*fiter).Value().m_ImageCoordinates;
+    MovingImagePointType        mappedPoint;
+    MeasureType                 sampleValue;
+    MovingImageDerivativeType   channelGradient;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = this->TransformPoint(fixedPoint, mappedPoint);
+
+    /** Check if point is inside the moving masks. */
+    if (sampleOk)
+    {
+      sampleOk = this->IsInsideMovingMask(mappedPoint);
+    }
+
+    /** Compute the squared differences and the combined gradient of all channels. */
+    if (sampleOk)
+    {
+      const RealType fixedImageValue = static_cast<RealType>((*fiter).Value().m_ImageValue);
+      sampleOk = this->EvaluateChannels(fixedPoint, fixedImageValue, mappedPoint, sampleValue, &channelGradient);
+    }
+
+    if (sampleOk)
+    {
+      this->m_NumberOfPixelsCounted++;
+      measure += sampleValue;
+
+      /** Compute the inner product of the transform Jacobian and the combined gradient. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedPoint, channelGradient, imageJacobian, nzji);
+
+      /** Compute this pixel's contribution to the derivative. */
+      this->UpdateDerivativeTerms(imageJacobian, nzji, derivative);
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(sampleContainer->Size(), this->m_NumberOfPixelsCounted);
+
+  /** Compute the measure value and derivative. */
+  if (this->m_NumberOfPixelsCounted > 0)
+  {
+    const double normal_sum = 1.0 / static_cast<double>(this->m_NumberOfPixelsCounted);
+    measure *= normal_sum;
+    derivative *= 2.0 * normal_sum;
+  }
+
+  /** The return value. */
+  value = measure;
+
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  /** Option for now to still use the single threaded code. */
+  if (!this->m_UseMultiThread)
+  {
+    return this->GetValueAndDerivativeSingleThreaded(parameters, value, derivative);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Gather the metric values and derivatives from all threads. */
+  this->AfterThreadedGetValueAndDerivative(value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(
+  ThreadIdType threadId)
+{
+  /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian indices. */
+  const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  NonZeroJacobianIndicesType   nzji = NonZeroJacobianIndicesType(nnzji);
+  DerivativeType               imageJacobian(nnzji);
+
+  /** Get a handle to the pre-allocated derivative for the current thread. */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure = NumericTraits<MeasureType>::Zero;
+
+  /** Buffers for the valid samples of a batch. */
+  typedef typename Superclass::AdvancedTransformType::MovingImageGradientType MovingImageGradientType;
+
+  const unsigned int                      batchSize = Superclass::SampleBatchSize;
+  FixedImagePointType                     validFixedPoints[batchSize];
+  MovingImageGradientType                 validChannelGradients[batchSize];
+  std::vector<DerivativeType>             imageJacobians(batchSize, imageJacobian);
+  std::vector<NonZeroJacobianIndicesType> nzjis(batchSize, nzji);
+
+  /** Process the batches of samples that are assigned to this thread. The points of each
+   * batch are mapped by a single call to the transform, for all channels together.
+   */
+  typename Superclass::SampleBatchType batch;
+  while (this->GetNextSampleBatch(threadId, *sampleContainer, batch))
+  {
+    /** Loop over the batch to evaluate the channels, and collect the valid samples. */
+    unsigned int numberOfValidSamples = 0;
+    for (unsigned int b = 0; b < batch.st_Size; ++b)
+    {
+      const MovingImagePointType & mappedPoint = batch.st_MappedPoints[b];
+      MeasureType                  sampleValue;
+      MovingImageDerivativeType    channelGradient;
+
+      /** Check if point is inside the moving masks. */
+      bool sampleOk = !batch.st_Rejected[b] && this->IsInsideMovingMask(mappedPoint);
+
+      /** Compute the squared differences and the combined gradient of all channels. */
+      if (sampleOk)
+      {
+        sampleOk = this->EvaluateChannels(
+          batch.st_FixedPoints[b], batch.st_FixedImageValues[b], mappedPoint, sampleValue, &channelGradient);
+      }
+
+      if (sampleOk)
+      {
+        measure += sampleValue;
+        validFixedPoints[numberOfValidSamples] = batch.st_FixedPoints[b];
+        validChannelGradients[numberOfValidSamples] = channelGradient;
+        ++numberOfValidSamples;
+      }
+    } // end for loop over the batch
+
+    numberOfPixelsCounted += numberOfValidSamples;
+
+    /** Compute the inner products of the transform Jacobian dT/dmu and the combined gradients. */
+    this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProducts(
+      validFixedPoints, validChannelGradients, imageJacobians.data(), nzjis.data(), numberOfValidSamples);
+
+    /** Compute the contributions of the valid samples to the derivative. */
+    for (unsigned int v = 0; v < numberOfValidSamples; ++v)
+    {
+      this->UpdateDerivativeTerms(imageJacobians[v], nzjis[v], derivative);
+      this->MarkTouchedDerivativeBlocks(threadId, nzjis[v]);
+    }
+  } // end while over the sample batches
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Value = measure;
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::AfterThreadedGetValueAndDerivative(
+  MeasureType &    value,
+  DerivativeType & derivative) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels and the values. */
+  this->m_NumberOfPixelsCounted = 0;
+  value = NumericTraits<MeasureType>::Zero;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+    value += this->m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+
+    /** Reset these variables for the next iteration. */
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
+  }
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(this->GetNumberOfImageSamples(), this->m_NumberOfPixelsCounted);
+
+  /** The normalization factor. */
+  const DerivativeValueType normal_sum = 1.0 / static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
+  value *= normal_sum;
+
+  /** Accumulate the derivatives multi-threadedly, including the factor 2 of the squares. */
+  this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0 / (2.0 * normal_sum);
+
+  this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * *************** UpdateDerivativeTerms ***************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+MultiChannelMeanSquaresImageToImageMetric<TFixedImage, TMovingImage>::UpdateDerivativeTerms(
+  const DerivativeType &             imageJacobian,
+  const NonZeroJacobianIndicesType & nzji,
+  DerivativeType &                   derivative) const
+{
+  /** Calculate the contributions to the derivatives with respect to each parameter. */
+  if (nzji.size() == this->GetNumberOfParameters())
+  {
+    /** Loop over all Jacobians. */
+    derivative += imageJacobian;
+  }
+  else
+  {
+    /** Only pick the nonzero Jacobians. */
+    for (unsigned int i = 0; i < imageJacobian.GetSize(); ++i)
+    {
+      derivative[nzji[i]] += imageJacobian[i];
+    }
+  }
+
+} // end UpdateDerivativeTerms()
+
+
+} // end namespace itk
+
+#endif // end #ifndef _itkMultiChannelMeanSquaresImageToImageMetric_hxx
@@ -164,9 +164,15 @@ protected:
   void
   ComputeMeanFixedGradient(void) const;
 
-  /** Compute the similarity measure  */
+  /** Compute the similarity measure. The moving image gradients should be up to date. */
   MeasureType
-  ComputeMeasure(const TransformParametersType & parameters) const;
+  ComputeMeasure(void) const;
+
+  /** Resample the moving image and compute its gradients, but only in the
+   * region of the fixed image where the measure is computed.
+   */
+  void
+  UpdateMovedGradients(void) const;
 
   typedef NeighborhoodOperatorImageFilter<FixedGradientImageType, FixedGradientImageType> FixedSobelFilter;
   typedef NeighborhoodOperatorImageFilter<MovedGradientImageType, MovedGradientImageType> MovedSobelFilter;
@@ -206,6 +212,11 @@ private:
     m_MovedSobelOperators[MovedImageDimension];
 
   typename MovedSobelFilter::Pointer m_MovedSobelFilters[itkGetStaticConstMacro(MovedImageDimension)];
+
+  /** The fixed image region cropped to the fixed mask, the only region
+   * where the measure is computed.
+   */
+  FixedImageRegionType m_MetricRegion;
 };
 
 } // end namespace itk
@@ -66,6 +66,9 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
 
   unsigned int iFilter;
 
+  /** Pixels outside the fixed mask do not contribute to the measure. */
+  this->m_MetricRegion = this->CropFixedImageRegionToMask(this->GetFixedImageRegion());
+
   /** Compute the gradient of the fixed images */
   this->m_CastFixedImageFilter->SetInput(this->m_FixedImage);
   this->m_CastFixedImageFilter->Update();
@@ -102,7 +105,6 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformMovingImageFilter->SetOutputSpacing(this->m_FixedImage->GetSpacing());
   this->m_TransformMovingImageFilter->SetOutputDirection(this->m_FixedImage->GetDirection());
-  this->m_TransformMovingImageFilter->Update();
 
   this->m_CastMovedImageFilter->SetInput(this->m_TransformMovingImageFilter->GetOutput());
 
@@ -114,8 +116,8 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Init
     this->m_MovedSobelFilters[iFilter]->OverrideBoundaryCondition(&this->m_MovedBoundCond);
     this->m_MovedSobelFilters[iFilter]->SetOperator(this->m_MovedSobelOperators[iFilter]);
     this->m_MovedSobelFilters[iFilter]->SetInput(this->m_CastMovedImageFilter->GetOutput());
-    this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
   }
+  this->UpdateMovedGradients();
 
 } // end Initialize()
 
@@ -134,6 +136,26 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Prin
 } // end PrintSelf()
 
 
+/**
+ * ***************** UpdateMovedGradients *****************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::UpdateMovedGradients(void) const
+{
+  /** The Sobel filters request the region plus their radius from the
+   * resampler, so that only these pixels are resampled.
+   */
+  for (unsigned int iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
+  {
+    this->m_MovedSobelFilters[iFilter]->GetOutput()->SetRequestedRegion(this->m_MetricRegion);
+    this->m_MovedSobelFilters[iFilter]->Update();
+  }
+
+} // end UpdateMovedGradients()
+
+
 /**
  * ***************** ComputeMeanFixedGradient *****************
  */
@@ -151,8 +173,8 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
   }
 
   typedef itk::ImageRegionConstIteratorWithIndex<FixedGradientImageType> FixedIteratorType;
-  FixedIteratorType fixedIteratorx(this->m_FixedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  FixedIteratorType fixedIteratory(this->m_FixedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  FixedIteratorType fixedIteratorx(this->m_FixedSobelFilters[0]->GetOutput(), this->m_MetricRegion);
+  FixedIteratorType fixedIteratory(this->m_FixedSobelFilters[1]->GetOutput(), this->m_MetricRegion);
 
   fixedIteratorx.GoToBegin();
   fixedIteratory.GoToBegin();
@@ -218,15 +240,10 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
   typename MovedGradientImageType::IndexType currentIndex;
   typename MovedGradientImageType::PointType point;
 
-  for (int iDimension = 0; iDimension < MovedImageDimension; ++iDimension)
-  {
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-  }
-
   typedef itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType> MovedIteratorType;
 
-  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->m_MetricRegion);
+  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->m_MetricRegion);
 
   movedIteratorx.GoToBegin();
   movedIteratory.GoToBegin();
@@ -289,13 +306,8 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
 
 template <class TFixedImage, class TMovingImage>
 typename NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::MeasureType
-NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(
-  const TransformParametersType & parameters) const
+NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMeasure(void) const
 {
-  this->SetTransformParameters(parameters);
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
 
@@ -308,25 +320,18 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::Comp
   MeasureType NGautocorrelationfixed = NumericTraits<MeasureType>::Zero;
   MeasureType NGautocorrelationmoving = NumericTraits<MeasureType>::Zero;
 
-  /** Make sure all is updated */
-  for (int iDimension = 0; iDimension < FixedImageDimension; ++iDimension)
-  {
-    this->m_FixedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[iDimension]->UpdateLargestPossibleRegion();
-  }
-
   typedef itk::ImageRegionConstIteratorWithIndex<FixedGradientImageType> FixedIteratorType;
 
-  FixedIteratorType fixedIteratorx(this->m_FixedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  FixedIteratorType fixedIteratory(this->m_FixedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  FixedIteratorType fixedIteratorx(this->m_FixedSobelFilters[0]->GetOutput(), this->m_MetricRegion);
+  FixedIteratorType fixedIteratory(this->m_FixedSobelFilters[1]->GetOutput(), this->m_MetricRegion);
 
   fixedIteratorx.GoToBegin();
   fixedIteratory.GoToBegin();
 
   typedef itk::ImageRegionConstIteratorWithIndex<MovedGradientImageType> MovedIteratorType;
 
-  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->GetFixedImageRegion());
-  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->GetFixedImageRegion());
+  MovedIteratorType movedIteratorx(this->m_MovedSobelFilters[0]->GetOutput(), this->m_MetricRegion);
+  MovedIteratorType movedIteratory(this->m_MovedSobelFilters[1]->GetOutput(), this->m_MetricRegion);
 
   movedIteratorx.GoToBegin();
   movedIteratory.GoToBegin();
@@ -407,17 +412,12 @@ NormalizedGradientCorrelationImageToImageMetric<TFixedImage, TMovingImage>::GetV
   this->BeforeThreadedGetValueAndDerivative(parameters);
   // this->SetTransformParameters( parameters );
 
-  unsigned int iFilter;
+  /** Update the gradient images; the moving image is resampled only once. */
   this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-
-  for (iFilter = 0; iFilter < MovedImageDimension; ++iFilter)
-  {
-    this->m_MovedSobelFilters[iFilter]->UpdateLargestPossibleRegion();
-  }
+  this->UpdateMovedGradients();
 
   this->ComputeMeanMovedGradient();
-  MeasureType currentMeasure = this->ComputeMeasure(parameters);
+  MeasureType currentMeasure = this->ComputeMeasure();
 
   return currentMeasure;
 
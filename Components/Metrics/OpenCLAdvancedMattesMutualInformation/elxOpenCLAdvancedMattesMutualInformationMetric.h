@@ -0,0 +1,259 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLAdvancedMattesMutualInformationMetric_h
+#define elxOpenCLAdvancedMattesMutualInformationMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdvancedMattesMutualInformationMetric.h"
+
+#include "itkGPUImage.h"
+#include "itkGPUDataManager.h"
+#include "itkOpenCLKernelManager.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+
+#include <vector>
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLAdvancedMattesMutualInformationMetric
+ * \brief A metric based on the itk::ParzenWindowMutualInformationImageToImageMetric,
+ * that computes its value and derivative with OpenCL.
+ *
+ * The joint histogram is accumulated per work group in local memory, and
+ * added to the global histogram on the device. The marginal PDFs, the value,
+ * and the ratios that are needed for the derivative are computed on the device
+ * as well, after which the derivative is computed per sample, as in the low
+ * memory variant of the CPU implementation. The host only reads the number
+ * of valid samples, the value, and the derivative.
+ *
+ * The OpenCL computation is used for 3D images with a linear interpolator
+ * (without ComputeGradient), without a moving mask and moving image derivative
+ * scales, for an AdvancedAffineTransform or a B-spline transform without
+ * initial transform, for a FixedKernelBSplineOrder of 0 and a
+ * MovingKernelBSplineOrder of 3, and for the analytic derivative without
+ * Jacobian preconditioning. With UseExplicitPDFDerivatives the derivative is
+ * computed with the equivalent low memory formula, and the Parzen windows are
+ * always evaluated exactly. In all other cases the metric is computed by the
+ * CPU implementation of the AdvancedMattesMutualInformation metric, as it is
+ * when the OpenCL context is not available. This is decided at the start of
+ * every resolution.
+ *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "OpenCLAdvancedMattesMutualInformation")</tt>
+ * \parameter OpenCLAdvancedMattesMutualInformationUseOpenCL: Enable the OpenCL metric as follows:\n
+ *    <tt>(OpenCLAdvancedMattesMutualInformationUseOpenCL "true")</tt>\n
+ *    The default value is true.
+ *
+ * All parameters of the AdvancedMattesMutualInformation metric are supported as well.
+ *
+ * \sa AdvancedMattesMutualInformationMetric
+ * \ingroup Metrics
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT OpenCLAdvancedMattesMutualInformationMetric
+  : public AdvancedMattesMutualInformationMetric<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef OpenCLAdvancedMattesMutualInformationMetric                           Self;
+  typedef AdvancedMattesMutualInformationMetric<TElastix>                       Superclass;
+  typedef typename AdvancedMattesMutualInformationMetric<TElastix>::Superclass1 Superclass1;
+  typedef typename AdvancedMattesMutualInformationMetric<TElastix>::Superclass2 Superclass2;
+  typedef itk::SmartPointer<Self>                                               Pointer;
+  typedef itk::SmartPointer<const Self>                                         ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(OpenCLAdvancedMattesMutualInformationMetric, AdvancedMattesMutualInformationMetric);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "OpenCLAdvancedMattesMutualInformation")</tt>\n
+   */
+  elxClassNameMacro("OpenCLAdvancedMattesMutualInformation");
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass1::MovingImageType             MovingImageType;
+  typedef typename Superclass1::MovingImagePixelType        MovingImagePixelType;
+  typedef typename Superclass1::FixedImageType              FixedImageType;
+  typedef typename Superclass1::MeasureType                 MeasureType;
+  typedef typename Superclass1::DerivativeType              DerivativeType;
+  typedef typename Superclass1::ParametersType              ParametersType;
+  typedef typename Superclass1::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename Superclass1::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass1::RealType                    RealType;
+  typedef typename Superclass1::MovingImageLimiterType      MovingImageLimiterType;
+
+  /** The moving image dimension. */
+  itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
+
+  /** Typedefs for the GPU images. */
+  typedef itk::GPUImage<MovingImagePixelType, MovingImageDimension> GPUMovingImageType;
+  typedef typename GPUMovingImageType::Pointer                      GPUMovingImagePointer;
+  typedef itk::GPUImage<float, MovingImageDimension>                GPUGridImageType;
+  typedef typename GPUGridImageType::Pointer                        GPUGridImagePointer;
+
+  /** Typedefs for the transforms that are supported on the GPU. */
+  typedef typename Superclass1::ScalarType               ScalarType;
+  typedef typename Superclass1::CombinationTransformType CombinationTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<ScalarType, MovingImageDimension, MovingImageDimension>
+                                                                                        MatrixOffsetTransformType;
+  typedef itk::AdvancedBSplineDeformableTransformBase<ScalarType, MovingImageDimension> BSplineBaseTransformType;
+
+  /** Sets up the OpenCL computation for the current resolution, after
+   * calling the Superclass' implementation.
+   */
+  void
+  Initialize(void) override;
+
+  /** Do some things before registration:
+   * \li Read the OpenCLAdvancedMattesMutualInformationUseOpenCL setting
+   */
+  void
+  BeforeRegistration(void) override;
+
+  /** Get the value and derivative, computed with OpenCL when possible. */
+  void
+  GetValueAndDerivative(const ParametersType & parameters,
+                        MeasureType &          value,
+                        DerivativeType &       derivative) const override;
+
+protected:
+  /** The constructor. */
+  OpenCLAdvancedMattesMutualInformationMetric();
+  /** The destructor. */
+  ~OpenCLAdvancedMattesMutualInformationMetric() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  OpenCLAdvancedMattesMutualInformationMetric(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+
+  /** The kinds of transform that are supported on the GPU. */
+  enum GPUTransformKindType
+  {
+    NoGPUTransform,
+    MatrixOffsetGPUTransform,
+    BSplineGPUTransform
+  };
+
+  /** Build the OpenCL program and create its kernels. */
+  void
+  BuildGPUProgram(void);
+
+  /** Check the configuration of the current resolution, and copy the
+   * moving image to the GPU when it is supported. Returns false when the
+   * CPU implementation should be used.
+   */
+  bool
+  InitializeGPUMetric(void);
+
+  /** Copy the moving image limiter settings in the layout of the kernels.
+   * Returns false when the limiter is not supported.
+   */
+  bool
+  InitializeGPUMovingImageLimiter(void);
+
+  /** Copy the fixed image samples, with limited fixed image values, to the GPU. */
+  void
+  CopySamplesToGPU(void) const;
+
+  /** Compute the value and derivative on the GPU. */
+  void
+  GetValueAndDerivativeOnGPU(const ParametersType & parameters, MeasureType & value, DerivativeType & derivative) const;
+
+  /** Allocate a buffer, when its size changed. */
+  static void
+  AllocateGPUBuffer(itk::GPUDataManager * buffer, const std::size_t size, const cl_mem_flags flags);
+
+  /** Helper method to report switching to CPU mode. */
+  void
+  SwitchingToCPUAndReport(const bool configError);
+
+  /** Helper method to report to elastix log. */
+  void
+  ReportToLog(void);
+
+  itk::OpenCLKernelManager::Pointer m_KernelManager;
+  std::size_t                       m_ZeroHistogramKernelId;
+  std::size_t                       m_ZeroDerivativeKernelId;
+  std::size_t                       m_HistogramMatrixOffsetKernelId;
+  std::size_t                       m_HistogramBSplineKernelId;
+  std::size_t                       m_ValueAndPRatioKernelId;
+  std::size_t                       m_DerivativeMatrixOffsetKernelId;
+  std::size_t                       m_DerivativeBSplineKernelId;
+  std::size_t                       m_LocalWorkSize;
+  unsigned long                     m_LocalMemorySize;
+
+  bool                 m_GPUMetricReady;
+  bool                 m_GPUMetricCreated;
+  bool                 m_ContextCreated;
+  bool                 m_UseOpenCL;
+  GPUTransformKindType m_GPUTransformKind;
+  unsigned int         m_GPUSplineOrder;
+
+  /** The histogram parameters, numbers of bins and moving image limiter settings, see the kernels. */
+  cl_float4 m_HistogramParameters;
+  cl_uint2  m_NumberOfHistogramBins;
+  cl_float8 m_MovingImageLimiterSettings;
+
+  GPUMovingImagePointer        m_GPUMovingImage;
+  itk::GPUDataManager::Pointer m_GPUMovingImageBase;
+  GPUGridImagePointer          m_GPUGridImage;
+  itk::GPUDataManager::Pointer m_GPUGridImageBase;
+
+  /** The buffers of the samples, coefficients, joint histogram, number of valid
+   * samples, ratios, marginal PDFs, value, derivative and per work group sums.
+   */
+  itk::GPUDataManager::Pointer m_GPUSamples;
+  itk::GPUDataManager::Pointer m_GPUCoefficients;
+  itk::GPUDataManager::Pointer m_GPUJointHistogram;
+  itk::GPUDataManager::Pointer m_GPUNumberOfPixelsCounted;
+  itk::GPUDataManager::Pointer m_GPUPRatio;
+  itk::GPUDataManager::Pointer m_GPUMarginalPDFs;
+  itk::GPUDataManager::Pointer m_GPUValue;
+  itk::GPUDataManager::Pointer m_GPUDerivative;
+  itk::GPUDataManager::Pointer m_GPUGroupSums;
+
+  /** Their host copies. */
+  mutable std::vector<cl_float4> m_Samples;
+  mutable std::vector<float>     m_Coefficients;
+  mutable std::vector<float>     m_Derivative;
+  mutable std::vector<float>     m_GroupSums;
+  mutable cl_uint                m_NumberOfPixelsCountedOnGPU;
+  mutable float                  m_MutualInformationOnGPU;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxOpenCLAdvancedMattesMutualInformationMetric.hxx"
+#endif
+
+#endif // end #ifndef elxOpenCLAdvancedMattesMutualInformationMetric_h
@@ -0,0 +1,846 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLAdvancedMattesMutualInformationMetric_hxx
+#define elxOpenCLAdvancedMattesMutualInformationMetric_hxx
+
+#include "elxOpenCLAdvancedMattesMutualInformationMetric.h"
+
+#include "itkExponentialLimiterFunction.h"
+#include "itkHardLimiterFunction.h"
+
+// GPU includes
+#include "itkOpenCLContext.h"
+#include "itkOpenCLLogger.h"
+#include "itkOpenCLUtil.h"
+#include "itkGPUKernelManagerHelperFunctions.h"
+
+// GPU kernel includes
+#include "itkGPUMath.h"
+#include "itkGPUImageBase.h"
+#include "itkGPUMatrixOffsetTransformBase.h"
+#include "itkGPUBSplineBaseTransform.h"
+#include "itkGPUAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkGPUAdvancedMattesMutualInformationImageToImageMetric.h"
+
+#include <algorithm>
+#include <sstream>
+#include <typeinfo>
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <class TElastix>
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::OpenCLAdvancedMattesMutualInformationMetric()
+  : m_ZeroHistogramKernelId(0)
+  , m_ZeroDerivativeKernelId(0)
+  , m_HistogramMatrixOffsetKernelId(0)
+  , m_HistogramBSplineKernelId(0)
+  , m_ValueAndPRatioKernelId(0)
+  , m_DerivativeMatrixOffsetKernelId(0)
+  , m_DerivativeBSplineKernelId(0)
+  , m_LocalWorkSize(1)
+  , m_LocalMemorySize(0)
+  , m_GPUMetricReady(false)
+  , m_GPUMetricCreated(false)
+  , m_ContextCreated(false)
+  , m_UseOpenCL(true)
+  , m_GPUTransformKind(NoGPUTransform)
+  , m_GPUSplineOrder(3)
+  , m_NumberOfPixelsCountedOnGPU(0)
+  , m_MutualInformationOnGPU(0.0f)
+{
+  // The OpenCL kernels are only implemented for 3D images.
+  if (MovingImageDimension != 3)
+  {
+    return;
+  }
+
+  // Check if the OpenCL context has been created.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  this->m_ContextCreated = context->IsCreated();
+  if (this->m_ContextCreated)
+  {
+    try
+    {
+      this->BuildGPUProgram();
+      this->m_GPUMetricCreated = true;
+    }
+    catch (itk::OpenCLCompileError & e)
+    {
+      // First log then report OpenCL compile error
+      itk::OpenCLLogger::Pointer logger = itk::OpenCLLogger::GetInstance();
+      logger->Write(itk::LoggerBase::PriorityLevelEnum::CRITICAL, e.GetDescription());
+
+      xl::xout["error"] << "ERROR: OpenCL program has not been compiled"
+                        << " during creating the GPU AdvancedMattesMutualInformation metric." << std::endl
+                        << "  Please check the '" << logger->GetLogFileName() << "' in output directory." << std::endl;
+      this->SwitchingToCPUAndReport(true);
+    }
+    catch (itk::ExceptionObject & e)
+    {
+      xl::xout["error"] << "ERROR: Exception during GPU AdvancedMattesMutualInformation metric creation: " << e
+                        << std::endl;
+      this->SwitchingToCPUAndReport(true);
+    }
+  }
+  else
+  {
+    this->SwitchingToCPUAndReport(false);
+  }
+} // end Constructor
+
+
+/**
+ * ******************* BuildGPUProgram ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::BuildGPUProgram(void)
+{
+  std::ostringstream defines;
+  defines << "#define DIM_" << int(MovingImageDimension) << "\n";
+  defines << "#define INPIXELTYPE ";
+  itk::GetTypenameInString(typeid(MovingImagePixelType), defines);
+
+  // Concatenate the sources of GPUMath, GPUImageBase, the transforms and the metrics.
+  // The mean squares source provides the helper functions of the mutual information kernels.
+  std::ostringstream source;
+  source << itk::GPUMathKernel::GetOpenCLSource();
+  source << itk::GPUImageBaseKernel::GetOpenCLSource();
+  source << itk::GPUMatrixOffsetTransformBaseKernel::GetOpenCLSource();
+  source << itk::GPUBSplineTransformKernel::GetOpenCLSource();
+  source << itk::GPUAdvancedMeanSquaresImageToImageMetricKernel::GetOpenCLSource();
+  source << itk::GPUAdvancedMattesMutualInformationImageToImageMetricKernel::GetOpenCLSource();
+
+  // Build and create kernels
+  this->m_KernelManager = itk::OpenCLKernelManager::New();
+  const itk::OpenCLProgram program = this->m_KernelManager->BuildProgramFromSourceCode(source.str(), defines.str());
+  if (program.IsNull())
+  {
+    itkExceptionMacro(<< "Kernel has not been loaded from string:\n" << defines.str() << std::endl << source.str());
+  }
+  this->m_ZeroHistogramKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationZeroHistogram");
+  this->m_ZeroDerivativeKernelId = this->m_KernelManager->CreateKernel(program, "AdvancedMeanSquaresZeroDerivative");
+  this->m_HistogramMatrixOffsetKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationHistogramMatrixOffsetTransform");
+  this->m_HistogramBSplineKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationHistogramBSplineTransform");
+  this->m_ValueAndPRatioKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationValueAndPRatio");
+  this->m_DerivativeMatrixOffsetKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationDerivativeMatrixOffsetTransform");
+  this->m_DerivativeBSplineKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMattesMutualInformationDerivativeBSplineTransform");
+
+  // The reduction in the kernels needs a power of two as local work size.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  const std::size_t           maximumLocalWorkSize =
+    std::min<std::size_t>(256, context->GetDefaultDevice().GetMaximumWorkItemsPerGroup());
+  this->m_LocalWorkSize = 1;
+  while (2 * this->m_LocalWorkSize <= maximumLocalWorkSize)
+  {
+    this->m_LocalWorkSize *= 2;
+  }
+  this->m_LocalMemorySize = context->GetDefaultDevice().GetLocalMemorySize();
+
+  // Create the buffers
+  this->m_GPUMovingImageBase = itk::GPUDataManager::New();
+  this->m_GPUGridImageBase = itk::GPUDataManager::New();
+  this->m_GPUSamples = itk::GPUDataManager::New();
+  this->m_GPUCoefficients = itk::GPUDataManager::New();
+  this->m_GPUJointHistogram = itk::GPUDataManager::New();
+  this->m_GPUNumberOfPixelsCounted = itk::GPUDataManager::New();
+  this->m_GPUPRatio = itk::GPUDataManager::New();
+  this->m_GPUMarginalPDFs = itk::GPUDataManager::New();
+  this->m_GPUValue = itk::GPUDataManager::New();
+  this->m_GPUDerivative = itk::GPUDataManager::New();
+  this->m_GPUGroupSums = itk::GPUDataManager::New();
+
+} // end BuildGPUProgram()
+
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::BeforeRegistration(void)
+{
+  // Are we using a OpenCL enabled GPU for the metric?
+  this->m_UseOpenCL = true;
+  this->m_Configuration->ReadParameter(this->m_UseOpenCL, "OpenCLAdvancedMattesMutualInformationUseOpenCL", 0);
+
+} // end BeforeRegistration()
+
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::Initialize(void)
+{
+  this->Superclass::Initialize();
+
+  this->m_GPUMetricReady = false;
+  if (!this->m_ContextCreated || !this->m_GPUMetricCreated || !this->m_UseOpenCL)
+  {
+    return;
+  }
+
+  try
+  {
+    this->m_GPUMetricReady = this->InitializeGPUMetric();
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    xl::xout["error"] << "ERROR: Exception during initializing the GPU AdvancedMattesMutualInformation metric: " << e
+                      << std::endl;
+    this->SwitchingToCPUAndReport(true);
+  }
+
+  if (this->m_GPUMetricReady)
+  {
+    this->ReportToLog();
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* InitializeGPUMetric ***********************
+ */
+
+template <class TElastix>
+bool
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::InitializeGPUMetric(void)
+{
+  /** Check the interpolator, the moving mask and the derivative scales. */
+  std::string reason;
+  if (!this->m_InterpolatorIsLinear || this->GetComputeGradient())
+  {
+    reason = "the interpolator is not a LinearInterpolator";
+  }
+  else if (this->GetMovingImageMask() != nullptr)
+  {
+    reason = "a moving mask is used";
+  }
+  else if (this->m_UseMovingImageDerivativeScales)
+  {
+    reason = "MovingImageDerivativeScales are used";
+  }
+
+  /** Check the histogram settings: the kernels implement the default Parzen windows and the analytic derivative. */
+  const unsigned int numberOfFixedHistogramBins = this->GetNumberOfFixedHistogramBins();
+  const unsigned int numberOfMovingHistogramBins = this->GetNumberOfMovingHistogramBins();
+  const std::size_t  numberOfHistogramBins = numberOfFixedHistogramBins * numberOfMovingHistogramBins;
+  if (reason.empty())
+  {
+    if (this->GetFixedKernelBSplineOrder() != 0 || this->GetMovingKernelBSplineOrder() != 3)
+    {
+      reason = "the FixedKernelBSplineOrder is not 0 or the MovingKernelBSplineOrder is not 3";
+    }
+    else if (this->GetUseFiniteDifferenceDerivative())
+    {
+      reason = "FiniteDifferenceDerivative is used";
+    }
+    else if (this->GetUseJacobianPreconditioning())
+    {
+      reason = "UseJacobianPreconditioning is used";
+    }
+    else if ((numberOfHistogramBins + this->m_LocalWorkSize + 1) * sizeof(float) > this->m_LocalMemorySize)
+    {
+      reason = "the joint histogram does not fit in the local memory of the device";
+    }
+    else if (!this->InitializeGPUMovingImageLimiter())
+    {
+      reason = "the moving image limiter is not supported";
+    }
+  }
+
+  /** Check the moving image: the kernels index its buffer from zero and interpolate linearly. */
+  const MovingImageType * movingImage = this->GetMovingImage();
+  if (reason.empty())
+  {
+    const typename MovingImageType::RegionType & region = movingImage->GetLargestPossibleRegion();
+    for (unsigned int i = 0; i < MovingImageDimension; ++i)
+    {
+      if (region.GetIndex()[i] != 0 || region.GetSize()[i] < 2)
+      {
+        reason = "the moving image region is not supported";
+      }
+    }
+    if (movingImage->GetBufferedRegion() != region)
+    {
+      reason = "the moving image region is not supported";
+    }
+  }
+
+  /** Check the transform: a matrix-offset or a B-spline transform, without initial transform. */
+  this->m_GPUTransformKind = NoGPUTransform;
+  const BSplineBaseTransformType * bsplineTransform = nullptr;
+  if (reason.empty())
+  {
+    const CombinationTransformType * combinationTransform =
+      dynamic_cast<const CombinationTransformType *>(this->m_AdvancedTransform.GetPointer());
+    if (combinationTransform != nullptr && combinationTransform->GetInitialTransform() == nullptr &&
+        combinationTransform->GetCurrentTransform() != nullptr)
+    {
+      const typename CombinationTransformType::CurrentTransformType * currentTransform =
+        combinationTransform->GetCurrentTransform();
+
+      /** Derived transforms, like the Euler transform, have other parameters. */
+      if (typeid(*currentTransform) == typeid(MatrixOffsetTransformType))
+      {
+        this->m_GPUTransformKind = MatrixOffsetGPUTransform;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder1TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 1;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder2TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 2;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder3TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 3;
+      }
+
+      if (this->m_GPUTransformKind == BSplineGPUTransform)
+      {
+        bsplineTransform = dynamic_cast<const BSplineBaseTransformType *>(currentTransform);
+        const typename BSplineBaseTransformType::RegionType & gridRegion = bsplineTransform->GetGridRegion();
+        for (unsigned int i = 0; i < MovingImageDimension; ++i)
+        {
+          if (gridRegion.GetIndex()[i] != 0)
+          {
+            this->m_GPUTransformKind = NoGPUTransform;
+          }
+        }
+      }
+    }
+    if (this->m_GPUTransformKind == NoGPUTransform)
+    {
+      reason = "the transform is not supported";
+    }
+  }
+
+  if (!reason.empty())
+  {
+    elxout << "  The OpenCLAdvancedMattesMutualInformation metric uses the CPU in this resolution, because " << reason
+           << "." << std::endl;
+    return false;
+  }
+
+  /** Copy the moving image to the GPU. */
+  this->m_GPUMovingImage = GPUMovingImageType::New();
+  this->m_GPUMovingImage->GraftITKImage(movingImage);
+  this->m_GPUMovingImage->AllocateGPU();
+  this->m_GPUMovingImage->GetGPUDataManager()->SetCPUBufferLock(true);
+  this->m_GPUMovingImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+  this->m_GPUMovingImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  /** Set the moving image and its meta information, arguments 2 and 3 of the histogram and derivative kernels. */
+  const bool        matrixOffset = this->m_GPUTransformKind == MatrixOffsetGPUTransform;
+  const std::size_t histogramKernelId =
+    matrixOffset ? this->m_HistogramMatrixOffsetKernelId : this->m_HistogramBSplineKernelId;
+  const std::size_t derivativeKernelId =
+    matrixOffset ? this->m_DerivativeMatrixOffsetKernelId : this->m_DerivativeBSplineKernelId;
+  cl_uint argId = 2;
+  itk::SetKernelWithITKImage<GPUMovingImageType>(
+    this->m_KernelManager, histogramKernelId, argId, this->m_GPUMovingImage, this->m_GPUMovingImageBase, true, true);
+  this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 2, this->m_GPUMovingImage->GetGPUDataManager());
+  this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 3, this->m_GPUMovingImageBase);
+
+  /** Set the B-spline order and the meta information of the B-spline grid,
+   * using an image without buffer that has the geometry of the grid.
+   */
+  if (!matrixOffset)
+  {
+    this->m_GPUGridImage = GPUGridImageType::New();
+    this->m_GPUGridImage->SetRegions(bsplineTransform->GetGridRegion());
+    this->m_GPUGridImage->SetOrigin(bsplineTransform->GetGridOrigin());
+    this->m_GPUGridImage->SetSpacing(bsplineTransform->GetGridSpacing());
+    this->m_GPUGridImage->SetDirection(bsplineTransform->GetGridDirection());
+
+    const cl_uint splineOrder = this->m_GPUSplineOrder;
+    this->m_KernelManager->SetKernelArg(histogramKernelId, 4, sizeof(cl_uint), &splineOrder);
+    this->m_KernelManager->SetKernelArg(derivativeKernelId, 4, sizeof(cl_uint), &splineOrder);
+    argId = 5;
+    itk::SetKernelWithITKImage<GPUGridImageType>(this->m_KernelManager,
+                                                 histogramKernelId,
+                                                 argId,
+                                                 this->m_GPUGridImage,
+                                                 this->m_GPUGridImageBase,
+                                                 false,
+                                                 true);
+    this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 5, this->m_GPUGridImageBase);
+  }
+
+  /** The histogram parameters, see InitializeHistograms(). */
+  this->m_HistogramParameters.s[0] = static_cast<float>(this->m_FixedImageBinSize);
+  this->m_HistogramParameters.s[1] = static_cast<float>(this->m_FixedImageNormalizedMin);
+  this->m_HistogramParameters.s[2] = static_cast<float>(this->m_MovingImageBinSize);
+  this->m_HistogramParameters.s[3] = static_cast<float>(this->m_MovingImageNormalizedMin);
+  this->m_NumberOfHistogramBins.s[0] = numberOfFixedHistogramBins;
+  this->m_NumberOfHistogramBins.s[1] = numberOfMovingHistogramBins;
+
+  /** Allocate the buffers that live on the device only, and the value and count. */
+  AllocateGPUBuffer(this->m_GPUJointHistogram, numberOfHistogramBins * sizeof(float), CL_MEM_READ_WRITE);
+  AllocateGPUBuffer(this->m_GPUNumberOfPixelsCounted, sizeof(cl_uint), CL_MEM_READ_WRITE);
+  AllocateGPUBuffer(this->m_GPUPRatio, numberOfHistogramBins * sizeof(float), CL_MEM_READ_WRITE);
+  AllocateGPUBuffer(this->m_GPUMarginalPDFs,
+                    (numberOfFixedHistogramBins + numberOfMovingHistogramBins) * sizeof(float),
+                    CL_MEM_READ_WRITE);
+  AllocateGPUBuffer(this->m_GPUValue, sizeof(float), CL_MEM_READ_WRITE);
+
+  /** Set the arguments that are constant during the resolution. */
+  const cl_uint numberOfHistogramBinsArg = static_cast<cl_uint>(numberOfHistogramBins);
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ZeroHistogramKernelId, 0, this->m_GPUJointHistogram);
+  this->m_KernelManager->SetKernelArg(this->m_ZeroHistogramKernelId, 1, sizeof(cl_uint), &numberOfHistogramBinsArg);
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ZeroHistogramKernelId, 2, this->m_GPUNumberOfPixelsCounted);
+
+  /** The histogram kernels: arguments 6 to 12 (matrix-offset) or 7 to 13 (B-spline). */
+  argId = matrixOffset ? 6 : 7;
+  this->m_KernelManager->SetKernelArg(histogramKernelId, argId++, sizeof(cl_float4), &this->m_HistogramParameters);
+  this->m_KernelManager->SetKernelArg(histogramKernelId, argId++, sizeof(cl_uint2), &this->m_NumberOfHistogramBins);
+  this->m_KernelManager->SetKernelArg(
+    histogramKernelId, argId++, sizeof(cl_float8), &this->m_MovingImageLimiterSettings);
+  this->m_KernelManager->SetKernelArg(histogramKernelId, argId++, numberOfHistogramBins * sizeof(float), nullptr);
+  this->m_KernelManager->SetKernelArg(histogramKernelId, argId++, sizeof(cl_uint), nullptr);
+  this->m_KernelManager->SetKernelArgWithImage(histogramKernelId, argId++, this->m_GPUJointHistogram);
+  this->m_KernelManager->SetKernelArgWithImage(histogramKernelId, argId++, this->m_GPUNumberOfPixelsCounted);
+
+  /** The value kernel, except for alpha. */
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ValueAndPRatioKernelId, 0, this->m_GPUJointHistogram);
+  this->m_KernelManager->SetKernelArg(
+    this->m_ValueAndPRatioKernelId, 1, sizeof(cl_uint2), &this->m_NumberOfHistogramBins);
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ValueAndPRatioKernelId, 3, this->m_GPUPRatio);
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ValueAndPRatioKernelId, 4, this->m_GPUMarginalPDFs);
+  this->m_KernelManager->SetKernelArgWithImage(this->m_ValueAndPRatioKernelId, 5, this->m_GPUValue);
+
+  /** The derivative kernels: arguments 7 to 11. */
+  this->m_KernelManager->SetKernelArg(derivativeKernelId, 7, sizeof(cl_float4), &this->m_HistogramParameters);
+  this->m_KernelManager->SetKernelArg(derivativeKernelId, 8, sizeof(cl_uint2), &this->m_NumberOfHistogramBins);
+  this->m_KernelManager->SetKernelArg(derivativeKernelId, 9, sizeof(cl_float8), &this->m_MovingImageLimiterSettings);
+  this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 10, this->m_GPUPRatio);
+  this->m_KernelManager->SetKernelArg(derivativeKernelId, 11, numberOfHistogramBins * sizeof(float), nullptr);
+
+  return true;
+
+} // end InitializeGPUMetric()
+
+
+/**
+ * ******************* InitializeGPUMovingImageLimiter ***********************
+ */
+
+template <class TElastix>
+bool
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::InitializeGPUMovingImageLimiter(void)
+{
+  typedef itk::ExponentialLimiterFunction<RealType, MovingImageDimension> ExponentialLimiterType;
+  typedef itk::HardLimiterFunction<RealType, MovingImageDimension>        HardLimiterType;
+
+  const MovingImageLimiterType * limiter = this->GetMovingImageLimiter();
+  if (limiter == nullptr)
+  {
+    return false;
+  }
+
+  /** The settings of ExponentialLimiterFunction::ComputeLimiterSettings(). A hard
+   * limiter is an exponential limiter with zero coefficients and the bounds as thresholds.
+   */
+  double upperThreshold = limiter->GetUpperThreshold();
+  double lowerThreshold = limiter->GetLowerThreshold();
+  double UTminUB = 0.0;
+  double UTminUBinv = 0.0;
+  double LTminLB = 0.0;
+  double LTminLBinv = 0.0;
+  if (typeid(*limiter) == typeid(ExponentialLimiterType))
+  {
+    UTminUB = upperThreshold - limiter->GetUpperBound();
+    LTminLB = lowerThreshold - limiter->GetLowerBound();
+    if (UTminUB < -1e-10)
+    {
+      UTminUBinv = 1.0 / UTminUB;
+    }
+    else
+    {
+      UTminUB = 0.0;
+    }
+    if (LTminLB > 1e-10)
+    {
+      LTminLBinv = 1.0 / LTminLB;
+    }
+    else
+    {
+      LTminLB = 0.0;
+    }
+  }
+  else if (typeid(*limiter) == typeid(HardLimiterType))
+  {
+    upperThreshold = limiter->GetUpperBound();
+    lowerThreshold = limiter->GetLowerBound();
+  }
+  else
+  {
+    return false;
+  }
+
+  cl_float8 & settings = this->m_MovingImageLimiterSettings;
+  settings.s[0] = static_cast<float>(upperThreshold);
+  settings.s[1] = static_cast<float>(limiter->GetUpperBound());
+  settings.s[2] = static_cast<float>(lowerThreshold);
+  settings.s[3] = static_cast<float>(limiter->GetLowerBound());
+  settings.s[4] = static_cast<float>(UTminUB);
+  settings.s[5] = static_cast<float>(UTminUBinv);
+  settings.s[6] = static_cast<float>(LTminLB);
+  settings.s[7] = static_cast<float>(LTminLBinv);
+  return true;
+
+} // end InitializeGPUMovingImageLimiter()
+
+
+/**
+ * ******************* GetValueAndDerivative ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::GetValueAndDerivative(const ParametersType & parameters,
+                                                                             MeasureType &          value,
+                                                                             DerivativeType &       derivative) const
+{
+  /** Use the CPU implementation when the GPU is not configured for this resolution. */
+  if (!this->m_GPUMetricReady)
+  {
+    this->Superclass1::GetValueAndDerivative(parameters, value, derivative);
+    return;
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  this->GetValueAndDerivativeOnGPU(parameters, value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* CopySamplesToGPU ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::CopySamplesToGPU(void) const
+{
+  typedef typename Superclass1::ImageSampleLatticeType ImageSampleLatticeType;
+  typedef typename ImageSampleLatticeType::PointType   FixedImagePointType;
+
+  /** Store the point of each sample in xyz and its limited fixed image value in w. */
+  const std::size_t              numberOfSamples = this->GetNumberOfImageSamples();
+  const ImageSampleLatticeType * implicitSamples = this->GetImageSampler()->GetImplicitSamples();
+  ImageSampleContainerPointer    sampleContainer = this->GetImageSampler()->GetOutput();
+
+  this->m_Samples.resize(numberOfSamples);
+  for (std::size_t i = 0; i < numberOfSamples; ++i)
+  {
+    FixedImagePointType fixedPoint;
+    RealType            fixedImageValue;
+    if (implicitSamples != nullptr)
+    {
+      implicitSamples->GetSample(i, fixedPoint, fixedImageValue);
+    }
+    else
+    {
+      const typename ImageSampleContainerType::Element & sample = sampleContainer->ElementAt(i);
+      fixedPoint = sample.m_ImageCoordinates;
+      fixedImageValue = static_cast<RealType>(sample.m_ImageValue);
+    }
+    if (this->GetUseFixedImageLimiter())
+    {
+      fixedImageValue = this->GetFixedImageLimiter()->Evaluate(fixedImageValue);
+    }
+
+    cl_float4 & gpuSample = this->m_Samples[i];
+    gpuSample.s[0] = static_cast<float>(fixedPoint[0]);
+    gpuSample.s[1] = static_cast<float>(fixedPoint[1]);
+    gpuSample.s[2] = static_cast<float>(fixedPoint[2]);
+    gpuSample.s[3] = static_cast<float>(fixedImageValue);
+  }
+
+  /** Copy them to the GPU, reallocating the buffer when the number of samples changed. */
+  AllocateGPUBuffer(
+    this->m_GPUSamples, std::max<std::size_t>(numberOfSamples, 1) * sizeof(cl_float4), CL_MEM_READ_ONLY);
+  if (numberOfSamples > 0)
+  {
+    this->m_GPUSamples->SetCPUBufferPointer(this->m_Samples.data());
+    this->m_GPUSamples->SetGPUDirtyFlag(true);
+    this->m_GPUSamples->UpdateGPUBuffer();
+  }
+
+} // end CopySamplesToGPU()
+
+
+/**
+ * ******************* GetValueAndDerivativeOnGPU ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::GetValueAndDerivativeOnGPU(const ParametersType & parameters,
+                                                                                  MeasureType &          value,
+                                                                                  DerivativeType & derivative) const
+{
+  /** Initialize some variables. */
+  const std::size_t numberOfParameters = this->GetNumberOfParameters();
+  value = itk::NumericTraits<MeasureType>::Zero;
+  derivative = DerivativeType(numberOfParameters);
+  derivative.Fill(itk::NumericTraits<typename DerivativeType::ValueType>::ZeroValue());
+
+  /** Copy the samples and determine the work sizes, one work item per sample. */
+  this->CopySamplesToGPU();
+  const cl_uint     numberOfSamples = static_cast<cl_uint>(this->m_Samples.size());
+  const std::size_t localWorkSize = this->m_LocalWorkSize;
+  const std::size_t numberOfGroups = std::max<std::size_t>((numberOfSamples + localWorkSize - 1) / localWorkSize, 1);
+  const std::size_t globalWorkSize = numberOfGroups * localWorkSize;
+  const std::size_t numberOfHistogramBins = this->m_NumberOfHistogramBins.s[0] * this->m_NumberOfHistogramBins.s[1];
+
+  const bool        matrixOffset = this->m_GPUTransformKind == MatrixOffsetGPUTransform;
+  const std::size_t histogramKernelId =
+    matrixOffset ? this->m_HistogramMatrixOffsetKernelId : this->m_HistogramBSplineKernelId;
+  const std::size_t derivativeKernelId =
+    matrixOffset ? this->m_DerivativeMatrixOffsetKernelId : this->m_DerivativeBSplineKernelId;
+
+  /** Set the arguments that change between calls. */
+  this->m_KernelManager->SetKernelArgWithImage(histogramKernelId, 0, this->m_GPUSamples);
+  this->m_KernelManager->SetKernelArg(histogramKernelId, 1, sizeof(cl_uint), &numberOfSamples);
+  this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 0, this->m_GPUSamples);
+  this->m_KernelManager->SetKernelArg(derivativeKernelId, 1, sizeof(cl_uint), &numberOfSamples);
+
+  if (matrixOffset)
+  {
+    const CombinationTransformType * combinationTransform =
+      static_cast<const CombinationTransformType *>(this->m_AdvancedTransform.GetPointer());
+    const MatrixOffsetTransformType * transform =
+      static_cast<const MatrixOffsetTransformType *>(combinationTransform->GetCurrentTransform());
+
+    cl_float16 matrix;
+    cl_float3  offset;
+    cl_float3  center;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+      matrix.s[i] = 0.0f;
+    }
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      for (unsigned int j = 0; j < 3; ++j)
+      {
+        matrix.s[i * 3 + j] = static_cast<float>(transform->GetMatrix()[i][j]);
+      }
+      offset.s[i] = static_cast<float>(transform->GetOffset()[i]);
+      center.s[i] = static_cast<float>(transform->GetCenter()[i]);
+    }
+    offset.s[3] = 0.0f;
+    center.s[3] = 0.0f;
+
+    this->m_KernelManager->SetKernelArg(histogramKernelId, 4, sizeof(cl_float16), &matrix);
+    this->m_KernelManager->SetKernelArg(histogramKernelId, 5, sizeof(cl_float3), &offset);
+    this->m_KernelManager->SetKernelArg(derivativeKernelId, 4, sizeof(cl_float16), &matrix);
+    this->m_KernelManager->SetKernelArg(derivativeKernelId, 5, sizeof(cl_float3), &offset);
+    this->m_KernelManager->SetKernelArg(derivativeKernelId, 6, sizeof(cl_float3), &center);
+
+    /** Allocate the per work group sums. */
+    this->m_GroupSums.resize(numberOfGroups * 12);
+    AllocateGPUBuffer(this->m_GPUGroupSums, this->m_GroupSums.size() * sizeof(float), CL_MEM_READ_WRITE);
+    this->m_KernelManager->SetKernelArg(derivativeKernelId, 12, localWorkSize * sizeof(float), nullptr);
+    this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 13, this->m_GPUGroupSums);
+  }
+  else
+  {
+    /** Copy the B-spline coefficients to the GPU. */
+    this->m_Coefficients.resize(numberOfParameters);
+    for (std::size_t p = 0; p < numberOfParameters; ++p)
+    {
+      this->m_Coefficients[p] = static_cast<float>(parameters[p]);
+    }
+    this->m_Derivative.resize(numberOfParameters);
+    AllocateGPUBuffer(this->m_GPUCoefficients, numberOfParameters * sizeof(float), CL_MEM_READ_ONLY);
+    AllocateGPUBuffer(this->m_GPUDerivative, numberOfParameters * sizeof(float), CL_MEM_READ_WRITE);
+    this->m_GPUCoefficients->SetCPUBufferPointer(this->m_Coefficients.data());
+    this->m_GPUCoefficients->SetGPUDirtyFlag(true);
+    this->m_GPUCoefficients->UpdateGPUBuffer();
+
+    /** Set the derivative to zero on the device. */
+    const cl_uint numberOfParametersArg = static_cast<cl_uint>(numberOfParameters);
+    this->m_KernelManager->SetKernelArgWithImage(this->m_ZeroDerivativeKernelId, 0, this->m_GPUDerivative);
+    this->m_KernelManager->SetKernelArg(this->m_ZeroDerivativeKernelId, 1, sizeof(cl_uint), &numberOfParametersArg);
+    const std::size_t zeroGlobalWorkSize = ((numberOfParameters + localWorkSize - 1) / localWorkSize) * localWorkSize;
+    this->m_KernelManager
+      ->LaunchKernel(
+        this->m_ZeroDerivativeKernelId, itk::OpenCLSize(zeroGlobalWorkSize), itk::OpenCLSize(localWorkSize))
+      .WaitForFinished();
+
+    this->m_KernelManager->SetKernelArgWithImage(histogramKernelId, 6, this->m_GPUCoefficients);
+    this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 6, this->m_GPUCoefficients);
+    this->m_KernelManager->SetKernelArgWithImage(derivativeKernelId, 12, this->m_GPUDerivative);
+  }
+
+  /** Compute the joint histogram, after setting it to zero. */
+  const std::size_t zeroHistogramGlobalWorkSize =
+    ((numberOfHistogramBins + localWorkSize - 1) / localWorkSize) * localWorkSize;
+  this->m_KernelManager
+    ->LaunchKernel(
+      this->m_ZeroHistogramKernelId, itk::OpenCLSize(zeroHistogramGlobalWorkSize), itk::OpenCLSize(localWorkSize))
+    .WaitForFinished();
+  this->m_KernelManager
+    ->LaunchKernel(histogramKernelId, itk::OpenCLSize(globalWorkSize), itk::OpenCLSize(localWorkSize))
+    .WaitForFinished();
+
+  /** Check if enough samples were valid, and compute alpha. */
+  this->m_GPUNumberOfPixelsCounted->SetCPUBufferPointer(&this->m_NumberOfPixelsCountedOnGPU);
+  this->m_GPUNumberOfPixelsCounted->SetCPUDirtyFlag(true);
+  this->m_GPUNumberOfPixelsCounted->UpdateCPUBuffer();
+  this->m_NumberOfPixelsCounted = this->m_NumberOfPixelsCountedOnGPU;
+  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
+  this->m_Alpha = 1.0 / static_cast<double>(this->m_NumberOfPixelsCounted);
+
+  /** Compute the value and the ratios for the derivative. */
+  const float alpha = static_cast<float>(this->m_Alpha);
+  this->m_KernelManager->SetKernelArg(this->m_ValueAndPRatioKernelId, 2, sizeof(float), &alpha);
+  this->m_KernelManager->LaunchKernel(this->m_ValueAndPRatioKernelId, itk::OpenCLSize(1), itk::OpenCLSize(1))
+    .WaitForFinished();
+
+  this->m_GPUValue->SetCPUBufferPointer(&this->m_MutualInformationOnGPU);
+  this->m_GPUValue->SetCPUDirtyFlag(true);
+  this->m_GPUValue->UpdateCPUBuffer();
+  value = static_cast<MeasureType>(-1.0 * this->m_MutualInformationOnGPU);
+
+  /** Compute the derivative. */
+  this->m_KernelManager
+    ->LaunchKernel(derivativeKernelId, itk::OpenCLSize(globalWorkSize), itk::OpenCLSize(localWorkSize))
+    .WaitForFinished();
+
+  if (matrixOffset)
+  {
+    /** Copy the per work group sums back, and add them in double precision.
+     * The parameters are the matrix elements row by row, followed by the translation.
+     */
+    this->m_GPUGroupSums->SetCPUBufferPointer(this->m_GroupSums.data());
+    this->m_GPUGroupSums->SetCPUDirtyFlag(true);
+    this->m_GPUGroupSums->UpdateCPUBuffer();
+    for (std::size_t g = 0; g < numberOfGroups; ++g)
+    {
+      for (unsigned int p = 0; p < 12; ++p)
+      {
+        derivative[p] += this->m_GroupSums[g * 12 + p];
+      }
+    }
+  }
+  else
+  {
+    this->m_GPUDerivative->SetCPUBufferPointer(this->m_Derivative.data());
+    this->m_GPUDerivative->SetCPUDirtyFlag(true);
+    this->m_GPUDerivative->UpdateCPUBuffer();
+    for (std::size_t p = 0; p < numberOfParameters; ++p)
+    {
+      derivative[p] = this->m_Derivative[p];
+    }
+  }
+
+} // end GetValueAndDerivativeOnGPU()
+
+
+/**
+ * ******************* AllocateGPUBuffer ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::AllocateGPUBuffer(itk::GPUDataManager * buffer,
+                                                                         const std::size_t     size,
+                                                                         const cl_mem_flags    flags)
+{
+  if (buffer->GetBufferSize() != size)
+  {
+    buffer->Initialize();
+    buffer->SetBufferFlag(flags);
+    buffer->SetBufferSize(size);
+    buffer->Allocate();
+  }
+} // end AllocateGPUBuffer()
+
+
+/**
+ * ************************* SwitchingToCPUAndReport ************************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::SwitchingToCPUAndReport(const bool configError)
+{
+  if (!configError)
+  {
+    xl::xout["warning"] << "WARNING: The OpenCL context could not be created.\n";
+    xl::xout["warning"] << "  The OpenCLAdvancedMattesMutualInformation metric is switching back to CPU mode."
+                        << std::endl;
+  }
+  else
+  {
+    xl::xout["warning"] << "WARNING: Unable to configure the GPU.\n";
+    xl::xout["warning"] << "  The OpenCLAdvancedMattesMutualInformation metric is switching back to CPU mode."
+                        << std::endl;
+  }
+  this->m_GPUMetricReady = false;
+
+} // end SwitchingToCPUAndReport()
+
+
+/**
+ * ************************* ReportToLog ************************************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMattesMutualInformationMetric<TElastix>::ReportToLog(void)
+{
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  itk::OpenCLDevice           device = context->GetDefaultDevice();
+  elxout << "  The metric is computed by " << device.GetName() << " from " << device.GetVendor() << "." << std::endl;
+} // end ReportToLog()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxOpenCLAdvancedMattesMutualInformationMetric_hxx
@@ -0,0 +1,221 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLAdvancedMeanSquaresMetric_h
+#define elxOpenCLAdvancedMeanSquaresMetric_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "elxAdvancedMeanSquaresMetric.h"
+
+#include "itkGPUImage.h"
+#include "itkGPUDataManager.h"
+#include "itkOpenCLKernelManager.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+
+#include <vector>
+
+namespace elastix
+{
+
+/**
+ * \class OpenCLAdvancedMeanSquaresMetric
+ * \brief A metric based on the itk::AdvancedMeanSquaresImageToImageMetric,
+ * that computes its value and derivative with OpenCL.
+ *
+ * Every sample is processed by its own work item. The squared differences
+ * and, for an affine transform, the derivative terms are summed per work
+ * group on the device. For a B-spline transform, the derivative is
+ * accumulated on the device as well.
+ *
+ * The OpenCL computation is used for 3D images with a linear interpolator
+ * (without ComputeGradient), without a moving mask and moving image derivative
+ * scales, and for an AdvancedAffineTransform or a B-spline transform without
+ * initial transform. In all other cases the metric is computed by the CPU
+ * implementation of the AdvancedMeanSquares metric, as it is when the OpenCL
+ * context is not available. This is decided at the start of every resolution.
+ *
+ * The parameters used in this class are:
+ * \parameter Metric: Select this metric as follows:\n
+ *    <tt>(Metric "OpenCLAdvancedMeanSquares")</tt>
+ * \parameter OpenCLAdvancedMeanSquaresUseOpenCL: Enable the OpenCL metric as follows:\n
+ *    <tt>(OpenCLAdvancedMeanSquaresUseOpenCL "true")</tt>\n
+ *    The default value is true.
+ *
+ * All parameters of the AdvancedMeanSquares metric are supported as well.
+ *
+ * \sa AdvancedMeanSquaresMetric
+ * \ingroup Metrics
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT OpenCLAdvancedMeanSquaresMetric : public AdvancedMeanSquaresMetric<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef OpenCLAdvancedMeanSquaresMetric                           Self;
+  typedef AdvancedMeanSquaresMetric<TElastix>                       Superclass;
+  typedef typename AdvancedMeanSquaresMetric<TElastix>::Superclass1 Superclass1;
+  typedef typename AdvancedMeanSquaresMetric<TElastix>::Superclass2 Superclass2;
+  typedef itk::SmartPointer<Self>                                   Pointer;
+  typedef itk::SmartPointer<const Self>                             ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(OpenCLAdvancedMeanSquaresMetric, AdvancedMeanSquaresMetric);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific metric. \n
+   * example: <tt>(Metric "OpenCLAdvancedMeanSquares")</tt>\n
+   */
+  elxClassNameMacro("OpenCLAdvancedMeanSquares");
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass1::MovingImageType             MovingImageType;
+  typedef typename Superclass1::MovingImagePixelType        MovingImagePixelType;
+  typedef typename Superclass1::FixedImageType              FixedImageType;
+  typedef typename Superclass1::MeasureType                 MeasureType;
+  typedef typename Superclass1::DerivativeType              DerivativeType;
+  typedef typename Superclass1::ParametersType              ParametersType;
+  typedef typename Superclass1::ImageSampleContainerType    ImageSampleContainerType;
+  typedef typename Superclass1::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename Superclass1::RealType                    RealType;
+
+  /** The moving image dimension. */
+  itkStaticConstMacro(MovingImageDimension, unsigned int, MovingImageType::ImageDimension);
+
+  /** Typedefs for the GPU images. */
+  typedef itk::GPUImage<MovingImagePixelType, MovingImageDimension> GPUMovingImageType;
+  typedef typename GPUMovingImageType::Pointer                      GPUMovingImagePointer;
+  typedef itk::GPUImage<float, MovingImageDimension>                GPUGridImageType;
+  typedef typename GPUGridImageType::Pointer                        GPUGridImagePointer;
+
+  /** Typedefs for the transforms that are supported on the GPU. */
+  typedef typename Superclass1::ScalarType               ScalarType;
+  typedef typename Superclass1::CombinationTransformType CombinationTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase<ScalarType, MovingImageDimension, MovingImageDimension>
+                                                                                        MatrixOffsetTransformType;
+  typedef itk::AdvancedBSplineDeformableTransformBase<ScalarType, MovingImageDimension> BSplineBaseTransformType;
+
+  /** Sets up the OpenCL computation for the current resolution, after
+   * calling the Superclass' implementation.
+   */
+  void
+  Initialize(void) override;
+
+  /** Do some things before registration:
+   * \li Read the OpenCLAdvancedMeanSquaresUseOpenCL setting
+   */
+  void
+  BeforeRegistration(void) override;
+
+  /** Get the value and derivative, computed with OpenCL when possible. */
+  void
+  GetValueAndDerivative(const ParametersType & parameters,
+                        MeasureType &          value,
+                        DerivativeType &       derivative) const override;
+
+protected:
+  /** The constructor. */
+  OpenCLAdvancedMeanSquaresMetric();
+  /** The destructor. */
+  ~OpenCLAdvancedMeanSquaresMetric() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** The deleted copy constructor. */
+  OpenCLAdvancedMeanSquaresMetric(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+
+  /** The kinds of transform that are supported on the GPU. */
+  enum GPUTransformKindType
+  {
+    NoGPUTransform,
+    MatrixOffsetGPUTransform,
+    BSplineGPUTransform
+  };
+
+  /** Build the OpenCL program and create its kernels. */
+  void
+  BuildGPUProgram(void);
+
+  /** Check the configuration of the current resolution, and copy the
+   * moving image to the GPU when it is supported. Returns false when the
+   * CPU implementation should be used.
+   */
+  bool
+  InitializeGPUMetric(void);
+
+  /** Copy the fixed image samples to the GPU. */
+  void
+  CopySamplesToGPU(void) const;
+
+  /** Compute the value and derivative on the GPU. */
+  void
+  GetValueAndDerivativeOnGPU(const ParametersType & parameters, MeasureType & value, DerivativeType & derivative) const;
+
+  /** Helper method to report switching to CPU mode. */
+  void
+  SwitchingToCPUAndReport(const bool configError);
+
+  /** Helper method to report to elastix log. */
+  void
+  ReportToLog(void);
+
+  itk::OpenCLKernelManager::Pointer m_KernelManager;
+  std::size_t                       m_ZeroDerivativeKernelId;
+  std::size_t                       m_MatrixOffsetKernelId;
+  std::size_t                       m_BSplineKernelId;
+  std::size_t                       m_LocalWorkSize;
+
+  bool                 m_GPUMetricReady;
+  bool                 m_GPUMetricCreated;
+  bool                 m_ContextCreated;
+  bool                 m_UseOpenCL;
+  GPUTransformKindType m_GPUTransformKind;
+  unsigned int         m_GPUSplineOrder;
+
+  GPUMovingImagePointer        m_GPUMovingImage;
+  itk::GPUDataManager::Pointer m_GPUMovingImageBase;
+  GPUGridImagePointer          m_GPUGridImage;
+  itk::GPUDataManager::Pointer m_GPUGridImageBase;
+
+  /** The buffers of the samples, coefficients, derivative and per work group sums. */
+  itk::GPUDataManager::Pointer m_GPUSamples;
+  itk::GPUDataManager::Pointer m_GPUCoefficients;
+  itk::GPUDataManager::Pointer m_GPUDerivative;
+  itk::GPUDataManager::Pointer m_GPUGroupSums;
+
+  /** Their host copies. */
+  mutable std::vector<cl_float4> m_Samples;
+  mutable std::vector<float>     m_Coefficients;
+  mutable std::vector<float>     m_Derivative;
+  mutable std::vector<float>     m_GroupSums;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxOpenCLAdvancedMeanSquaresMetric.hxx"
+#endif
+
+#endif // end #ifndef elxOpenCLAdvancedMeanSquaresMetric_h
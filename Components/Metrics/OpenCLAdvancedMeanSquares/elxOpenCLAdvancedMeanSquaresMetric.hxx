@@ -0,0 +1,642 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxOpenCLAdvancedMeanSquaresMetric_hxx
+#define elxOpenCLAdvancedMeanSquaresMetric_hxx
+
+#include "elxOpenCLAdvancedMeanSquaresMetric.h"
+
+// GPU includes
+#include "itkOpenCLContext.h"
+#include "itkOpenCLLogger.h"
+#include "itkOpenCLUtil.h"
+#include "itkGPUKernelManagerHelperFunctions.h"
+
+// GPU kernel includes
+#include "itkGPUMath.h"
+#include "itkGPUImageBase.h"
+#include "itkGPUMatrixOffsetTransformBase.h"
+#include "itkGPUBSplineBaseTransform.h"
+#include "itkGPUAdvancedMeanSquaresImageToImageMetric.h"
+
+#include <algorithm>
+#include <sstream>
+#include <typeinfo>
+
+namespace elastix
+{
+
+/**
+ * ******************* Constructor ***********************
+ */
+
+template <class TElastix>
+OpenCLAdvancedMeanSquaresMetric<TElastix>::OpenCLAdvancedMeanSquaresMetric()
+  : m_ZeroDerivativeKernelId(0)
+  , m_MatrixOffsetKernelId(0)
+  , m_BSplineKernelId(0)
+  , m_LocalWorkSize(1)
+  , m_GPUMetricReady(false)
+  , m_GPUMetricCreated(false)
+  , m_ContextCreated(false)
+  , m_UseOpenCL(true)
+  , m_GPUTransformKind(NoGPUTransform)
+  , m_GPUSplineOrder(3)
+{
+  // The OpenCL kernels are only implemented for 3D images.
+  if (MovingImageDimension != 3)
+  {
+    return;
+  }
+
+  // Check if the OpenCL context has been created.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  this->m_ContextCreated = context->IsCreated();
+  if (this->m_ContextCreated)
+  {
+    try
+    {
+      this->BuildGPUProgram();
+      this->m_GPUMetricCreated = true;
+    }
+    catch (itk::OpenCLCompileError & e)
+    {
+      // First log then report OpenCL compile error
+      itk::OpenCLLogger::Pointer logger = itk::OpenCLLogger::GetInstance();
+      logger->Write(itk::LoggerBase::PriorityLevelEnum::CRITICAL, e.GetDescription());
+
+      xl::xout["error"] << "ERROR: OpenCL program has not been compiled"
+                        << " during creating the GPU AdvancedMeanSquares metric." << std::endl
+                        << "  Please check the '" << logger->GetLogFileName() << "' in output directory." << std::endl;
+      this->SwitchingToCPUAndReport(true);
+    }
+    catch (itk::ExceptionObject & e)
+    {
+      xl::xout["error"] << "ERROR: Exception during GPU AdvancedMeanSquares metric creation: " << e << std::endl;
+      this->SwitchingToCPUAndReport(true);
+    }
+  }
+  else
+  {
+    this->SwitchingToCPUAndReport(false);
+  }
+} // end Constructor
+
+
+/**
+ * ******************* BuildGPUProgram ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::BuildGPUProgram(void)
+{
+  std::ostringstream defines;
+  defines << "#define DIM_" << int(MovingImageDimension) << "\n";
+  defines << "#define INPIXELTYPE ";
+  itk::GetTypenameInString(typeid(MovingImagePixelType), defines);
+
+  // Concatenate the sources of GPUMath, GPUImageBase, the transforms and the metric
+  std::ostringstream source;
+  source << itk::GPUMathKernel::GetOpenCLSource();
+  source << itk::GPUImageBaseKernel::GetOpenCLSource();
+  source << itk::GPUMatrixOffsetTransformBaseKernel::GetOpenCLSource();
+  source << itk::GPUBSplineTransformKernel::GetOpenCLSource();
+  source << itk::GPUAdvancedMeanSquaresImageToImageMetricKernel::GetOpenCLSource();
+
+  // Build and create kernels
+  this->m_KernelManager = itk::OpenCLKernelManager::New();
+  const itk::OpenCLProgram program = this->m_KernelManager->BuildProgramFromSourceCode(source.str(), defines.str());
+  if (program.IsNull())
+  {
+    itkExceptionMacro(<< "Kernel has not been loaded from string:\n" << defines.str() << std::endl << source.str());
+  }
+  this->m_ZeroDerivativeKernelId = this->m_KernelManager->CreateKernel(program, "AdvancedMeanSquaresZeroDerivative");
+  this->m_MatrixOffsetKernelId =
+    this->m_KernelManager->CreateKernel(program, "AdvancedMeanSquaresMatrixOffsetTransform");
+  this->m_BSplineKernelId = this->m_KernelManager->CreateKernel(program, "AdvancedMeanSquaresBSplineTransform");
+
+  // The reduction in the kernels needs a power of two as local work size.
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  const std::size_t maximumLocalWorkSize =
+    std::min<std::size_t>(256, context->GetDefaultDevice().GetMaximumWorkItemsPerGroup());
+  this->m_LocalWorkSize = 1;
+  while (2 * this->m_LocalWorkSize <= maximumLocalWorkSize)
+  {
+    this->m_LocalWorkSize *= 2;
+  }
+
+  // Create the buffers
+  this->m_GPUMovingImageBase = itk::GPUDataManager::New();
+  this->m_GPUGridImageBase = itk::GPUDataManager::New();
+  this->m_GPUSamples = itk::GPUDataManager::New();
+  this->m_GPUCoefficients = itk::GPUDataManager::New();
+  this->m_GPUDerivative = itk::GPUDataManager::New();
+  this->m_GPUGroupSums = itk::GPUDataManager::New();
+
+} // end BuildGPUProgram()
+
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::BeforeRegistration(void)
+{
+  // Are we using a OpenCL enabled GPU for the metric?
+  this->m_UseOpenCL = true;
+  this->m_Configuration->ReadParameter(this->m_UseOpenCL, "OpenCLAdvancedMeanSquaresUseOpenCL", 0);
+
+} // end BeforeRegistration()
+
+
+/**
+ * ******************* Initialize ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::Initialize(void)
+{
+  this->Superclass::Initialize();
+
+  this->m_GPUMetricReady = false;
+  if (!this->m_ContextCreated || !this->m_GPUMetricCreated || !this->m_UseOpenCL)
+  {
+    return;
+  }
+
+  try
+  {
+    this->m_GPUMetricReady = this->InitializeGPUMetric();
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    xl::xout["error"] << "ERROR: Exception during initializing the GPU AdvancedMeanSquares metric: " << e << std::endl;
+    this->SwitchingToCPUAndReport(true);
+  }
+
+  if (this->m_GPUMetricReady)
+  {
+    this->ReportToLog();
+  }
+
+} // end Initialize()
+
+
+/**
+ * ******************* InitializeGPUMetric ***********************
+ */
+
+template <class TElastix>
+bool
+OpenCLAdvancedMeanSquaresMetric<TElastix>::InitializeGPUMetric(void)
+{
+  /** Check the interpolator, the moving mask and the derivative scales. */
+  std::string reason;
+  if (!this->m_InterpolatorIsLinear || this->GetComputeGradient())
+  {
+    reason = "the interpolator is not a LinearInterpolator";
+  }
+  else if (this->GetMovingImageMask() != nullptr)
+  {
+    reason = "a moving mask is used";
+  }
+  else if (this->m_UseMovingImageDerivativeScales)
+  {
+    reason = "MovingImageDerivativeScales are used";
+  }
+
+  /** Check the moving image: the kernels index its buffer from zero and interpolate linearly. */
+  const MovingImageType * movingImage = this->GetMovingImage();
+  if (reason.empty())
+  {
+    const typename MovingImageType::RegionType & region = movingImage->GetLargestPossibleRegion();
+    for (unsigned int i = 0; i < MovingImageDimension; ++i)
+    {
+      if (region.GetIndex()[i] != 0 || region.GetSize()[i] < 2)
+      {
+        reason = "the moving image region is not supported";
+      }
+    }
+    if (movingImage->GetBufferedRegion() != region)
+    {
+      reason = "the moving image region is not supported";
+    }
+  }
+
+  /** Check the transform: a matrix-offset or a B-spline transform, without initial transform. */
+  this->m_GPUTransformKind = NoGPUTransform;
+  const BSplineBaseTransformType * bsplineTransform = nullptr;
+  if (reason.empty())
+  {
+    const CombinationTransformType * combinationTransform =
+      dynamic_cast<const CombinationTransformType *>(this->m_AdvancedTransform.GetPointer());
+    if (combinationTransform != nullptr && combinationTransform->GetInitialTransform() == nullptr &&
+        combinationTransform->GetCurrentTransform() != nullptr)
+    {
+      const typename CombinationTransformType::CurrentTransformType * currentTransform =
+        combinationTransform->GetCurrentTransform();
+
+      /** Derived transforms, like the Euler transform, have other parameters. */
+      if (typeid(*currentTransform) == typeid(MatrixOffsetTransformType))
+      {
+        this->m_GPUTransformKind = MatrixOffsetGPUTransform;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder1TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 1;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder2TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 2;
+      }
+      else if (dynamic_cast<const typename Superclass1::BSplineOrder3TransformType *>(currentTransform) != nullptr)
+      {
+        this->m_GPUTransformKind = BSplineGPUTransform;
+        this->m_GPUSplineOrder = 3;
+      }
+
+      if (this->m_GPUTransformKind == BSplineGPUTransform)
+      {
+        bsplineTransform = dynamic_cast<const BSplineBaseTransformType *>(currentTransform);
+        const typename BSplineBaseTransformType::RegionType & gridRegion = bsplineTransform->GetGridRegion();
+        for (unsigned int i = 0; i < MovingImageDimension; ++i)
+        {
+          if (gridRegion.GetIndex()[i] != 0)
+          {
+            this->m_GPUTransformKind = NoGPUTransform;
+          }
+        }
+      }
+    }
+    if (this->m_GPUTransformKind == NoGPUTransform)
+    {
+      reason = "the transform is not supported";
+    }
+  }
+
+  if (!reason.empty())
+  {
+    elxout << "  The OpenCLAdvancedMeanSquares metric uses the CPU in this resolution, because " << reason << "."
+           << std::endl;
+    return false;
+  }
+
+  /** Copy the moving image to the GPU. */
+  this->m_GPUMovingImage = GPUMovingImageType::New();
+  this->m_GPUMovingImage->GraftITKImage(movingImage);
+  this->m_GPUMovingImage->AllocateGPU();
+  this->m_GPUMovingImage->GetGPUDataManager()->SetCPUBufferLock(true);
+  this->m_GPUMovingImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+  this->m_GPUMovingImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  /** Set the moving image and its meta information, arguments 2 and 3 of both transform kernels. */
+  const std::size_t kernelId =
+    this->m_GPUTransformKind == MatrixOffsetGPUTransform ? this->m_MatrixOffsetKernelId : this->m_BSplineKernelId;
+  cl_uint argId = 2;
+  itk::SetKernelWithITKImage<GPUMovingImageType>(
+    this->m_KernelManager, kernelId, argId, this->m_GPUMovingImage, this->m_GPUMovingImageBase, true, true);
+
+  /** Set the B-spline order and the meta information of the B-spline grid,
+   * using an image without buffer that has the geometry of the grid.
+   */
+  if (this->m_GPUTransformKind == BSplineGPUTransform)
+  {
+    this->m_GPUGridImage = GPUGridImageType::New();
+    this->m_GPUGridImage->SetRegions(bsplineTransform->GetGridRegion());
+    this->m_GPUGridImage->SetOrigin(bsplineTransform->GetGridOrigin());
+    this->m_GPUGridImage->SetSpacing(bsplineTransform->GetGridSpacing());
+    this->m_GPUGridImage->SetDirection(bsplineTransform->GetGridDirection());
+
+    const cl_uint splineOrder = this->m_GPUSplineOrder;
+    this->m_KernelManager->SetKernelArg(this->m_BSplineKernelId, 4, sizeof(cl_uint), &splineOrder);
+    argId = 5;
+    itk::SetKernelWithITKImage<GPUGridImageType>(this->m_KernelManager,
+                                                 this->m_BSplineKernelId,
+                                                 argId,
+                                                 this->m_GPUGridImage,
+                                                 this->m_GPUGridImageBase,
+                                                 false,
+                                                 true);
+  }
+
+  return true;
+
+} // end InitializeGPUMetric()
+
+
+/**
+ * ******************* GetValueAndDerivative ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::GetValueAndDerivative(const ParametersType & parameters,
+                                                                 MeasureType &          value,
+                                                                 DerivativeType &       derivative) const
+{
+  /** Use the CPU implementation when the GPU is not configured for this resolution. */
+  if (!this->m_GPUMetricReady)
+  {
+    this->Superclass1::GetValueAndDerivative(parameters, value, derivative);
+    return;
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  this->GetValueAndDerivativeOnGPU(parameters, value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* CopySamplesToGPU ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::CopySamplesToGPU(void) const
+{
+  typedef typename Superclass1::ImageSampleLatticeType ImageSampleLatticeType;
+  typedef typename ImageSampleLatticeType::PointType   FixedImagePointType;
+
+  /** Store the point of each sample in xyz and its fixed image value in w. */
+  const std::size_t              numberOfSamples = this->GetNumberOfImageSamples();
+  const ImageSampleLatticeType * implicitSamples = this->GetImageSampler()->GetImplicitSamples();
+  ImageSampleContainerPointer    sampleContainer = this->GetImageSampler()->GetOutput();
+
+  this->m_Samples.resize(numberOfSamples);
+  for (std::size_t i = 0; i < numberOfSamples; ++i)
+  {
+    FixedImagePointType fixedPoint;
+    RealType            fixedImageValue;
+    if (implicitSamples != nullptr)
+    {
+      implicitSamples->GetSample(i, fixedPoint, fixedImageValue);
+    }
+    else
+    {
+      const typename ImageSampleContainerType::Element & sample = sampleContainer->ElementAt(i);
+      fixedPoint = sample.m_ImageCoordinates;
+      fixedImageValue = static_cast<RealType>(sample.m_ImageValue);
+    }
+
+    cl_float4 & gpuSample = this->m_Samples[i];
+    gpuSample.s[0] = static_cast<float>(fixedPoint[0]);
+    gpuSample.s[1] = static_cast<float>(fixedPoint[1]);
+    gpuSample.s[2] = static_cast<float>(fixedPoint[2]);
+    gpuSample.s[3] = static_cast<float>(fixedImageValue);
+  }
+
+  /** Copy them to the GPU, reallocating the buffer when the number of samples changed. */
+  const std::size_t bufferSize = std::max<std::size_t>(numberOfSamples, 1) * sizeof(cl_float4);
+  if (this->m_GPUSamples->GetBufferSize() != bufferSize)
+  {
+    this->m_GPUSamples->Initialize();
+    this->m_GPUSamples->SetBufferFlag(CL_MEM_READ_ONLY);
+    this->m_GPUSamples->SetBufferSize(bufferSize);
+    this->m_GPUSamples->Allocate();
+  }
+  if (numberOfSamples > 0)
+  {
+    this->m_GPUSamples->SetCPUBufferPointer(this->m_Samples.data());
+    this->m_GPUSamples->SetGPUDirtyFlag(true);
+    this->m_GPUSamples->UpdateGPUBuffer();
+  }
+
+} // end CopySamplesToGPU()
+
+
+/**
+ * ******************* GetValueAndDerivativeOnGPU ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::GetValueAndDerivativeOnGPU(const ParametersType & parameters,
+                                                                      MeasureType &          value,
+                                                                      DerivativeType &       derivative) const
+{
+  /** Initialize some variables. */
+  const std::size_t numberOfParameters = this->GetNumberOfParameters();
+  value = itk::NumericTraits<MeasureType>::Zero;
+  derivative = DerivativeType(numberOfParameters);
+  derivative.Fill(itk::NumericTraits<typename DerivativeType::ValueType>::ZeroValue());
+
+  /** Copy the samples and determine the work sizes, one work item per sample. */
+  this->CopySamplesToGPU();
+  const cl_uint     numberOfSamples = static_cast<cl_uint>(this->m_Samples.size());
+  const std::size_t localWorkSize = this->m_LocalWorkSize;
+  const std::size_t numberOfGroups = std::max<std::size_t>((numberOfSamples + localWorkSize - 1) / localWorkSize, 1);
+  const std::size_t globalWorkSize = numberOfGroups * localWorkSize;
+
+  /** The terms that are summed per work group: see the kernels. */
+  const bool        matrixOffset = this->m_GPUTransformKind == MatrixOffsetGPUTransform;
+  const std::size_t numberOfTerms = matrixOffset ? 14 : 2;
+  const std::size_t kernelId = matrixOffset ? this->m_MatrixOffsetKernelId : this->m_BSplineKernelId;
+
+  /** Allocate the per work group sums. */
+  this->m_GroupSums.resize(numberOfGroups * numberOfTerms);
+  const std::size_t groupSumsSize = this->m_GroupSums.size() * sizeof(float);
+  if (this->m_GPUGroupSums->GetBufferSize() != groupSumsSize)
+  {
+    this->m_GPUGroupSums->Initialize();
+    this->m_GPUGroupSums->SetBufferFlag(CL_MEM_READ_WRITE);
+    this->m_GPUGroupSums->SetBufferSize(groupSumsSize);
+    this->m_GPUGroupSums->Allocate();
+  }
+
+  /** Set the arguments that change between calls. */
+  this->m_KernelManager->SetKernelArgWithImage(kernelId, 0, this->m_GPUSamples);
+  this->m_KernelManager->SetKernelArg(kernelId, 1, sizeof(cl_uint), &numberOfSamples);
+
+  if (matrixOffset)
+  {
+    const CombinationTransformType * combinationTransform =
+      static_cast<const CombinationTransformType *>(this->m_AdvancedTransform.GetPointer());
+    const MatrixOffsetTransformType * transform =
+      static_cast<const MatrixOffsetTransformType *>(combinationTransform->GetCurrentTransform());
+
+    cl_float16 matrix;
+    cl_float3  offset;
+    cl_float3  center;
+    for (unsigned int i = 0; i < 16; ++i)
+    {
+      matrix.s[i] = 0.0f;
+    }
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      for (unsigned int j = 0; j < 3; ++j)
+      {
+        matrix.s[i * 3 + j] = static_cast<float>(transform->GetMatrix()[i][j]);
+      }
+      offset.s[i] = static_cast<float>(transform->GetOffset()[i]);
+      center.s[i] = static_cast<float>(transform->GetCenter()[i]);
+    }
+    offset.s[3] = 0.0f;
+    center.s[3] = 0.0f;
+
+    this->m_KernelManager->SetKernelArg(kernelId, 4, sizeof(cl_float16), &matrix);
+    this->m_KernelManager->SetKernelArg(kernelId, 5, sizeof(cl_float3), &offset);
+    this->m_KernelManager->SetKernelArg(kernelId, 6, sizeof(cl_float3), &center);
+    this->m_KernelManager->SetKernelArg(kernelId, 7, localWorkSize * sizeof(float), nullptr);
+    this->m_KernelManager->SetKernelArgWithImage(kernelId, 8, this->m_GPUGroupSums);
+  }
+  else
+  {
+    /** Copy the B-spline coefficients to the GPU. */
+    this->m_Coefficients.resize(numberOfParameters);
+    for (std::size_t p = 0; p < numberOfParameters; ++p)
+    {
+      this->m_Coefficients[p] = static_cast<float>(parameters[p]);
+    }
+    this->m_Derivative.resize(numberOfParameters);
+    const std::size_t parametersSize = numberOfParameters * sizeof(float);
+    if (this->m_GPUCoefficients->GetBufferSize() != parametersSize)
+    {
+      this->m_GPUCoefficients->Initialize();
+      this->m_GPUCoefficients->SetBufferFlag(CL_MEM_READ_ONLY);
+      this->m_GPUCoefficients->SetBufferSize(parametersSize);
+      this->m_GPUCoefficients->Allocate();
+
+      this->m_GPUDerivative->Initialize();
+      this->m_GPUDerivative->SetBufferFlag(CL_MEM_READ_WRITE);
+      this->m_GPUDerivative->SetBufferSize(parametersSize);
+      this->m_GPUDerivative->Allocate();
+    }
+    this->m_GPUCoefficients->SetCPUBufferPointer(this->m_Coefficients.data());
+    this->m_GPUCoefficients->SetGPUDirtyFlag(true);
+    this->m_GPUCoefficients->UpdateGPUBuffer();
+
+    /** Set the derivative to zero on the device. */
+    const cl_uint numberOfParametersArg = static_cast<cl_uint>(numberOfParameters);
+    this->m_KernelManager->SetKernelArgWithImage(this->m_ZeroDerivativeKernelId, 0, this->m_GPUDerivative);
+    this->m_KernelManager->SetKernelArg(this->m_ZeroDerivativeKernelId, 1, sizeof(cl_uint), &numberOfParametersArg);
+    const std::size_t zeroGlobalWorkSize = ((numberOfParameters + localWorkSize - 1) / localWorkSize) * localWorkSize;
+    this->m_KernelManager
+      ->LaunchKernel(
+        this->m_ZeroDerivativeKernelId, itk::OpenCLSize(zeroGlobalWorkSize), itk::OpenCLSize(localWorkSize))
+      .WaitForFinished();
+
+    this->m_KernelManager->SetKernelArgWithImage(kernelId, 6, this->m_GPUCoefficients);
+    this->m_KernelManager->SetKernelArgWithImage(kernelId, 7, this->m_GPUDerivative);
+    this->m_KernelManager->SetKernelArg(kernelId, 8, localWorkSize * sizeof(float), nullptr);
+    this->m_KernelManager->SetKernelArgWithImage(kernelId, 9, this->m_GPUGroupSums);
+  }
+
+  /** Launch the kernel and wait for it. */
+  this->m_KernelManager->LaunchKernel(kernelId, itk::OpenCLSize(globalWorkSize), itk::OpenCLSize(localWorkSize))
+    .WaitForFinished();
+
+  /** Copy the per work group sums back, and add them in double precision. */
+  this->m_GPUGroupSums->SetCPUBufferPointer(this->m_GroupSums.data());
+  this->m_GPUGroupSums->SetCPUDirtyFlag(true);
+  this->m_GPUGroupSums->UpdateCPUBuffer();
+
+  std::vector<double> sums(numberOfTerms, 0.0);
+  for (std::size_t g = 0; g < numberOfGroups; ++g)
+  {
+    for (std::size_t t = 0; t < numberOfTerms; ++t)
+    {
+      sums[t] += this->m_GroupSums[g * numberOfTerms + t];
+    }
+  }
+
+  /** Check if enough samples were valid. */
+  this->m_NumberOfPixelsCounted = static_cast<unsigned long>(sums[1] + 0.5);
+  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
+
+  /** The normalization factor. */
+  double normal_sum = 0.0;
+  if (this->m_NumberOfPixelsCounted > 0)
+  {
+    normal_sum = this->m_NormalizationFactor / static_cast<double>(this->m_NumberOfPixelsCounted);
+  }
+
+  /** Compute the measure value and derivative. */
+  value = static_cast<MeasureType>(normal_sum * sums[0]);
+  if (matrixOffset)
+  {
+    /** The parameters are the matrix elements row by row, followed by the translation. */
+    for (unsigned int p = 0; p < 12; ++p)
+    {
+      derivative[p] = normal_sum * sums[2 + p];
+    }
+  }
+  else
+  {
+    this->m_GPUDerivative->SetCPUBufferPointer(this->m_Derivative.data());
+    this->m_GPUDerivative->SetCPUDirtyFlag(true);
+    this->m_GPUDerivative->UpdateCPUBuffer();
+    for (std::size_t p = 0; p < numberOfParameters; ++p)
+    {
+      derivative[p] = normal_sum * this->m_Derivative[p];
+    }
+  }
+
+} // end GetValueAndDerivativeOnGPU()
+
+
+/**
+ * ************************* SwitchingToCPUAndReport ************************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::SwitchingToCPUAndReport(const bool configError)
+{
+  if (!configError)
+  {
+    xl::xout["warning"] << "WARNING: The OpenCL context could not be created.\n";
+    xl::xout["warning"] << "  The OpenCLAdvancedMeanSquares metric is switching back to CPU mode." << std::endl;
+  }
+  else
+  {
+    xl::xout["warning"] << "WARNING: Unable to configure the GPU.\n";
+    xl::xout["warning"] << "  The OpenCLAdvancedMeanSquares metric is switching back to CPU mode." << std::endl;
+  }
+  this->m_GPUMetricReady = false;
+
+} // end SwitchingToCPUAndReport()
+
+
+/**
+ * ************************* ReportToLog ************************************
+ */
+
+template <class TElastix>
+void
+OpenCLAdvancedMeanSquaresMetric<TElastix>::ReportToLog(void)
+{
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  itk::OpenCLDevice           device = context->GetDefaultDevice();
+  elxout << "  The metric is computed by " << device.GetName() << " from " << device.GetVendor() << "." << std::endl;
+} // end ReportToLog()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxOpenCLAdvancedMeanSquaresMetric_hxx
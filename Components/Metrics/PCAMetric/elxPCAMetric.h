@@ -54,6 +54,11 @@ namespace elastix
  *    image, without using a fixed image. Possible values are "true" or "false".
  * \parameter NumEigenValues: number of eigenvalues used in the metric: sum(e) - e, where sum(e)
  *  is the sum of all eigenvalues and e is the sum of the first highest NumEigenValues eigenvalues.
+ * \parameter UseSubspaceIteration: compute the highest NumEigenValues eigenvalues with a subspace
+ *  iteration, which starts from the eigenvectors of the previous iteration, instead of with a full
+ *  eigendecomposition. This is faster for large numbers of images. Can be given for each resolution.\n
+ *  example: <tt>(UseSubspaceIteration "true")</tt>\n
+ *  The default value is false.
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
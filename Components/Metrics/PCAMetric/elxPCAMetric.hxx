@@ -57,6 +57,12 @@ PCAMetric<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(NumEigenValues, "NumEigenValues", this->GetComponentLabel(), level, 0);
   this->SetNumEigenValues(NumEigenValues);
 
+  /** Get and set if the eigenvalues are computed with a subspace iteration. */
+  bool useSubspaceIteration = false;
+  this->GetConfiguration()->ReadParameter(
+    useSubspaceIteration, "UseSubspaceIteration", this->GetComponentLabel(), level, 0);
+  this->SetUseSubspaceIteration(useSubspaceIteration);
+
   /** Get and set if we want to subtract the mean from the derivative. */
   bool subtractMean = false;
   this->GetConfiguration()->ReadParameter(subtractMean, "SubtractMean", this->GetComponentLabel(), 0, 0);
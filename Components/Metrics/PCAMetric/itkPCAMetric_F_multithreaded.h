@@ -24,6 +24,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkExtractImageFilter.h"
+#include "itkTruncatedSymmetricEigenSystem.h"
 
 namespace itk
 {
@@ -52,6 +53,12 @@ public:
   itkSetMacro(TransformIsStackTransform, bool);
   itkSetMacro(NumEigenValues, unsigned int);
 
+  /** Set whether the largest eigenvalues are computed by a subspace iteration,
+   * which starts from the eigenvectors of the previous iteration, instead of by
+   * a full eigendecomposition. See TruncatedSymmetricEigenSystem.
+   */
+  itkSetMacro(UseSubspaceIteration, bool);
+
   /** Typedefs from the superclass. */
   typedef typename Superclass::CoordinateRepresentationType    CoordinateRepresentationType;
   typedef typename Superclass::MovingImageType                 MovingImageType;
@@ -174,6 +181,8 @@ protected:
   {
     SizeValueType                    st_NumberOfPixelsCounted;
     MatrixType                       st_DataBlock;
+    vnl_vector<RealType>             st_Mean;
+    MatrixType                       st_Scatter;
     std::vector<FixedImagePointType> st_ApprovedSamples;
     DerivativeType                   st_Derivative;
   };
@@ -239,6 +248,10 @@ private:
   /** Integer to indicate how many eigenvalues you want to use in the metric */
   unsigned int m_NumEigenValues{ 6 };
 
+  /** The solver of the eigenvalue problem, which keeps the eigenvectors for the next iteration. */
+  bool                                   m_UseSubspaceIteration{ false };
+  TruncatedSymmetricEigenSystem::Pointer m_EigenSystem;
+
   /** Matrices, needed for derivative calculation */
   mutable std::vector<unsigned int> m_PixelStartIndex;
   mutable MatrixType                m_Atmm;
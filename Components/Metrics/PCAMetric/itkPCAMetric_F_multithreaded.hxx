@@ -29,10 +29,6 @@
 #include <numeric>
 #include <fstream>
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 namespace itk
 {
 /**
@@ -52,6 +48,9 @@ PCAMetric<TFixedImage, TMovingImage>::PCAMetric()
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters. */
   this->m_PCAMetricThreaderParameters.m_Metric = this;
+
+  /** The solver of the eigenvalue problem. */
+  this->m_EigenSystem = TruncatedSymmetricEigenSystem::New();
 } // end constructor
 
 
@@ -86,6 +85,10 @@ PCAMetric<TFixedImage, TMovingImage>::Initialize(void)
     std::cerr << "ERROR: Number of eigenvalues is larger than number of images. Maximum number of eigenvalues equals: "
               << this->m_G << std::endl;
   }
+
+  /** The eigenvectors of the previous resolution are no start for this one. */
+  this->m_EigenSystem->SetUseSubspaceIteration(this->m_UseSubspaceIteration);
+  this->m_EigenSystem->Initialize();
 } // end Initializes
 
 
@@ -312,13 +315,13 @@ PCAMetric<TFixedImage, TMovingImage>::GetValue(const TransformParametersType & p
   /** Compute correlation matrix K */
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
+  /** Compute the largest eigenvalues of K */
+  this->m_EigenSystem->Compute(K, this->m_NumEigenValues);
 
   RealType sumEigenValuesUsed = itk::NumericTraits<RealType>::Zero;
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
+  for (unsigned int i = 0; i < this->m_NumEigenValues; ++i)
   {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
+    sumEigenValuesUsed += this->m_EigenSystem->GetEigenValues()[i];
   }
 
   measure = this->m_G - sumEigenValuesUsed;
@@ -497,20 +500,16 @@ PCAMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(const
 
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
+  /** Compute the largest eigenvalues and their eigenvectors of K */
+  this->m_EigenSystem->Compute(K, this->m_NumEigenValues);
 
   RealType sumEigenValuesUsed = itk::NumericTraits<RealType>::Zero;
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
+  for (unsigned int i = 0; i < this->m_NumEigenValues; ++i)
   {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
+    sumEigenValuesUsed += this->m_EigenSystem->GetEigenValues()[i];
   }
 
-  MatrixType eigenVectorMatrix(this->m_G, this->m_NumEigenValues);
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
-  {
-    eigenVectorMatrix.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
-  }
+  const MatrixType & eigenVectorMatrix = this->m_EigenSystem->GetEigenVectors();
 
   MatrixType eigenVectorMatrixTranspose(eigenVectorMatrix.transpose());
 
@@ -797,9 +796,33 @@ PCAMetric<TFixedImage, TMovingImage>::ThreadedGetSamples(ThreadIdType threadId)
 
   } /** end first loop over image sample container */
 
+  /** Compute the mean and the centred scatter matrix of the samples of this
+   * thread, so that the covariance matrix is mostly computed in parallel.
+   */
+  MatrixType           threadBlock = datablock.extract(pixelIndex, this->m_G);
+  vnl_vector<RealType> threadMean(this->m_G, NumericTraits<RealType>::Zero);
+  MatrixType           threadScatter(this->m_G, this->m_G, NumericTraits<RealType>::Zero);
+  if (pixelIndex > 0)
+  {
+    for (unsigned int i = 0; i < pixelIndex; ++i)
+    {
+      threadMean += threadBlock.get_row(i);
+    }
+    threadMean /= RealType(pixelIndex);
+
+    MatrixType centredBlock(threadBlock);
+    for (unsigned int i = 0; i < pixelIndex; ++i)
+    {
+      centredBlock.set_row(i, threadBlock.get_row(i) - threadMean);
+    }
+    threadScatter = centredBlock.transpose() * centredBlock;
+  }
+
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_NumberOfPixelsCounted = pixelIndex;
-  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_DataBlock = datablock.extract(pixelIndex, this->m_G);
+  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_DataBlock = threadBlock;
+  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_Mean = threadMean;
+  this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_Scatter = threadScatter;
   this->m_PCAMetricGetSamplesPerThreadVariables[threadId].st_ApprovedSamples = SamplesOK;
 
 } // end ThreadedGetSamples()
@@ -835,15 +858,13 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
     row_start += this->m_PCAMetricGetSamplesPerThreadVariables[i].st_DataBlock.rows();
   }
 
-  /** Calculate mean of from columns */
+  /** Calculate mean of from columns, from the means of the threads */
   vnl_vector<RealType> mean(this->m_G);
   mean.fill(NumericTraits<RealType>::Zero);
-  for (unsigned int i = 0; i < this->m_NumberOfPixelsCounted; ++i)
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
   {
-    for (unsigned int j = 0; j < this->m_G; ++j)
-    {
-      mean(j) += A(i, j);
-    }
+    const PCAMetricGetSamplesPerThreadStruct & threadVariables = this->m_PCAMetricGetSamplesPerThreadVariables[i];
+    mean += RealType(threadVariables.st_NumberOfPixelsCounted) * threadVariables.st_Mean;
   }
   mean /= RealType(this->m_NumberOfPixelsCounted);
 
@@ -857,10 +878,25 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
       Amm(i, j) = A(i, j) - mean(j);
     }
   }
-
-  /** Compute covariancematrix C */
   this->m_Atmm = Amm.transpose();
-  MatrixType C(this->m_Atmm * Amm);
+
+  /** Compute covariancematrix C, by combining the scatter matrices of the threads,
+   * which are centred around their own means:
+   *   (N - 1) C = sum_t [ M_t + N_t (mean_t - mean) (mean_t - mean)^T ]
+   */
+  MatrixType C(this->m_G, this->m_G);
+  C.fill(NumericTraits<RealType>::Zero);
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    const PCAMetricGetSamplesPerThreadStruct & threadVariables = this->m_PCAMetricGetSamplesPerThreadVariables[i];
+    if (threadVariables.st_NumberOfPixelsCounted == 0)
+    {
+      continue;
+    }
+    const vnl_vector<RealType> meanDifference = threadVariables.st_Mean - mean;
+    C += threadVariables.st_Scatter;
+    C += RealType(threadVariables.st_NumberOfPixelsCounted) * outer_product(meanDifference, meanDifference);
+  }
   C /= static_cast<RealType>(RealType(this->m_NumberOfPixelsCounted) - 1.0);
 
   vnl_diag_matrix<RealType> S(this->m_G);
@@ -872,17 +908,17 @@ PCAMetric<TFixedImage, TMovingImage>::AfterThreadedGetSamples(MeasureType & valu
 
   MatrixType K(S * C * S);
 
-  /** Compute first eigenvalue and eigenvector of K */
-  vnl_symmetric_eigensystem<RealType> eig(K);
+  /** Compute the largest eigenvalues and their eigenvectors of K */
+  this->m_EigenSystem->Compute(K, this->m_NumEigenValues);
 
-  RealType   sumEigenValuesUsed = itk::NumericTraits<RealType>::Zero;
-  MatrixType eigenVectorMatrix(this->m_G, this->m_NumEigenValues);
-  for (unsigned int i = 1; i < this->m_NumEigenValues + 1; ++i)
+  RealType sumEigenValuesUsed = itk::NumericTraits<RealType>::Zero;
+  for (unsigned int i = 0; i < this->m_NumEigenValues; ++i)
   {
-    sumEigenValuesUsed += eig.get_eigenvalue(this->m_G - i);
-    eigenVectorMatrix.set_column(i - 1, (eig.get_eigenvector(this->m_G - i)).normalize());
+    sumEigenValuesUsed += this->m_EigenSystem->GetEigenValues()[i];
   }
 
+  const MatrixType & eigenVectorMatrix = this->m_EigenSystem->GetEigenVectors();
+
   value = this->m_G - sumEigenValuesUsed;
 
   MatrixType eigenVectorMatrixTranspose(eigenVectorMatrix.transpose());
@@ -171,9 +171,17 @@ protected:
   MeasureType
   ComputePIFixed(void) const;
 
-  /** Compute the pattern intensity difference image. */
+  /** Compute the pattern intensity difference image. The moving image should
+   * have been resampled for the current parameters already.
+   */
   MeasureType
-  ComputePIDiff(const TransformParametersType & parameters, float scalingfactor) const;
+  ComputePIDiff(float scalingfactor) const;
+
+  /** Compute the region of which the pattern intensity is computed, and the
+   * region of the resampled moving image that is needed for it.
+   */
+  void
+  ComputeIterationRegions(void);
 
 private:
   PatternIntensityImageToImageMetric(const Self &) = delete;
@@ -193,6 +201,13 @@ private:
   ScalesType                         m_Scales;
   MeasureType                        m_FixedMeasure;
   CombinationTransformPointer        m_CombinationTransform;
+
+  /** The pixels of which the pattern intensity is computed: the fixed image
+   * without a border of the neighborhood radius, cropped to the fixed mask.
+   * Only these pixels and their neighborhoods are resampled.
+   */
+  FixedImageRegionType m_IterationRegion;
+  FixedImageRegionType m_ResampleRegion;
 };
 
 } // end namespace itk
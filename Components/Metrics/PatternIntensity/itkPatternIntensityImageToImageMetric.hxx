@@ -84,7 +84,6 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
   this->m_TransformMovingImageFilter->SetOutputOrigin(this->m_FixedImage->GetOrigin());
   this->m_TransformMovingImageFilter->SetOutputSpacing(this->m_FixedImage->GetSpacing());
   this->m_TransformMovingImageFilter->SetOutputDirection(this->m_FixedImage->GetDirection());
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
 
   // this->InitializeLimiters();
 
@@ -93,7 +92,9 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
   this->m_MultiplyImageFilter->SetConstant(this->m_NormalizationFactor);
   this->m_DifferenceImageFilter->SetInput1(this->m_FixedImage);
   this->m_DifferenceImageFilter->SetInput2(this->m_MultiplyImageFilter->GetOutput());
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  this->ComputeIterationRegions();
+  this->m_DifferenceImageFilter->GetOutput()->SetRequestedRegion(this->m_ResampleRegion);
+  this->m_DifferenceImageFilter->Update();
   this->m_FixedMeasure = this->ComputePIFixed();
 
   /* to rescale the similarity measure between 0-1;*/
@@ -121,6 +122,40 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::os
 } // end PrintSelf()
 
 
+/**
+ * ********************* ComputeIterationRegions ******************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputeIterationRegions(void)
+{
+  /** Skip a border of the neighborhood radius, so that the neighborhoods
+   * of all pixels are inside the image.
+   */
+  const FixedImageRegionType largestRegion = this->m_FixedImage->GetLargestPossibleRegion();
+  FixedImageRegionType       iterationRegion = largestRegion;
+  for (unsigned int i = 0; i < 2; ++i) // Only 2D
+  {
+    iterationRegion.SetIndex(i, largestRegion.GetIndex(i) + static_cast<int>(this->m_NeighborhoodRadius));
+    iterationRegion.SetSize(i, largestRegion.GetSize(i) - 2 * this->m_NeighborhoodRadius);
+  }
+
+  /** Pixels outside the fixed mask do not contribute, so they are skipped too. */
+  this->m_IterationRegion = this->CropFixedImageRegionToMask(iterationRegion);
+
+  /** The neighborhoods of the remaining pixels have to be resampled. */
+  this->m_ResampleRegion = this->m_IterationRegion;
+  for (unsigned int i = 0; i < 2; ++i) // Only 2D
+  {
+    this->m_ResampleRegion.SetIndex(i,
+                                    this->m_IterationRegion.GetIndex(i) - static_cast<int>(this->m_NeighborhoodRadius));
+    this->m_ResampleRegion.SetSize(i, this->m_IterationRegion.GetSize(i) + 2 * this->m_NeighborhoodRadius);
+  }
+
+} // end ComputeIterationRegions()
+
+
 /**
  * ********************* ComputePIFixed ******************************
  */
@@ -132,28 +167,21 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIFixed()
   MeasureType measure = NumericTraits<MeasureType>::Zero;
   MeasureType diff = NumericTraits<MeasureType>::Zero;
 
-  typename FixedImageType::SizeType  iterationSize = this->m_FixedImage->GetLargestPossibleRegion().GetSize();
-  typename FixedImageType::IndexType iterationStartIndex, currentIndex, neighborIndex;
+  typename FixedImageType::IndexType currentIndex, neighborIndex;
   typename FixedImageType::SizeType  neighborIterationSize;
   typename FixedImageType::PointType point;
 
-  iterationSize.Fill(1);
   neighborIterationSize.Fill(1);
-  iterationStartIndex.Fill(0);
   for (unsigned int i = 0; i < 2; ++i) // Only 2D
   {
-    iterationSize[i] -= static_cast<int>(2 * this->m_NeighborhoodRadius);
-    iterationStartIndex[i] = static_cast<int>(this->m_NeighborhoodRadius);
     neighborIterationSize[i] = static_cast<int>(2 * this->m_NeighborhoodRadius) + 1;
   }
 
-  typename FixedImageType::RegionType iterationRegion, neighboriterationRegion;
-  iterationRegion.SetIndex(iterationStartIndex);
-  iterationRegion.SetSize(iterationSize);
+  typename FixedImageType::RegionType neighboriterationRegion;
 
   typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedImageTypeIteratorType;
 
-  FixedImageTypeIteratorType fixedImageIt(this->m_FixedImage, iterationRegion);
+  FixedImageTypeIteratorType fixedImageIt(this->m_FixedImage, this->m_IterationRegion);
   fixedImageIt.GoToBegin();
 
   neighboriterationRegion.SetSize(neighborIterationSize);
@@ -220,52 +248,31 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIFixed()
 
 template <class TFixedImage, class TMovingImage>
 typename PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::MeasureType
-PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(const TransformParametersType & parameters,
-                                                                             float scalingfactor) const
+PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::ComputePIDiff(float scalingfactor) const
 {
-  /** Call non-thread-safe stuff, such as:
-   *   this->SetTransformParameters( parameters );
-   *   this->GetImageSampler()->Update();
-   * Because of these calls GetValueAndDerivative itself is not thread-safe,
-   * so cannot be called multiple times simultaneously.
-   * This is however needed in the CombinationImageToImageMetric.
-   * In that case, you need to:
-   * - switch the use of this function to on, using m_UseMetricSingleThreaded = true
-   * - call BeforeThreadedGetValueAndDerivative once (single-threaded) before
-   *   calling GetValueAndDerivative
-   * - switch the use of this function to off, using m_UseMetricSingleThreaded = false
-   * - Now you can call GetValueAndDerivative multi-threaded.
+  /** Only the scaling of the resampled moving image changes, so the
+   * resampling itself is not repeated.
    */
-  this->BeforeThreadedGetValueAndDerivative(parameters);
-  // this->SetTransformParameters( parameters );
-
-  this->m_TransformMovingImageFilter->Modified();
   this->m_MultiplyImageFilter->SetConstant(scalingfactor);
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  this->m_DifferenceImageFilter->GetOutput()->SetRequestedRegion(this->m_ResampleRegion);
+  this->m_DifferenceImageFilter->Update();
   MeasureType measure = NumericTraits<MeasureType>::Zero;
   MeasureType diff = NumericTraits<MeasureType>::Zero;
 
-  typename FixedImageType::SizeType  iterationSize = this->m_FixedImage->GetLargestPossibleRegion().GetSize();
-  typename FixedImageType::IndexType iterationStartIndex, currentIndex, neighborIndex;
+  typename FixedImageType::IndexType currentIndex, neighborIndex;
   typename FixedImageType::SizeType  neighborIterationSize;
   typename FixedImageType::PointType point;
 
-  iterationSize.Fill(1);
   neighborIterationSize.Fill(1);
-  iterationStartIndex.Fill(0);
   for (unsigned int i = 0; i < 2; ++i) // Only 2D
   {
-    iterationSize[i] -= static_cast<int>(2 * this->m_NeighborhoodRadius);
-    iterationStartIndex[i] = static_cast<int>(this->m_NeighborhoodRadius);
     neighborIterationSize[i] = static_cast<int>(2 * this->m_NeighborhoodRadius + 1);
   }
 
-  typename FixedImageType::RegionType iterationRegion, neighboriterationRegion;
-  iterationRegion.SetIndex(iterationStartIndex);
-  iterationRegion.SetSize(iterationSize);
+  typename FixedImageType::RegionType neighboriterationRegion;
 
   typedef itk::ImageRegionConstIteratorWithIndex<TransformedMovingImageType> DifferenceImageIteratorType;
-  DifferenceImageIteratorType differenceImageIt(this->m_DifferenceImageFilter->GetOutput(), iterationRegion);
+  DifferenceImageIteratorType differenceImageIt(this->m_DifferenceImageFilter->GetOutput(), this->m_IterationRegion);
   differenceImageIt.GoToBegin();
 
   neighboriterationRegion.SetSize(neighborIterationSize);
@@ -351,7 +358,6 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   // this->SetTransformParameters( parameters );
 
   this->m_TransformMovingImageFilter->Modified();
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
   MeasureType measure = 1e10;
   MeasureType currentMeasure = 1e10;
 
@@ -364,7 +370,7 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
 
     while (tmpfactor <= this->m_NormalizationFactor * 1.0)
     {
-      measure = this->ComputePIDiff(parameters, tmpfactor);
+      measure = this->ComputePIDiff(tmpfactor);
       tmpMeasure = (measure - this->m_FixedMeasure) / -this->m_Rescalingfactor;
 
       if (tmpMeasure < currentMeasure)
@@ -378,7 +384,7 @@ PatternIntensityImageToImageMetric<TFixedImage, TMovingImage>::GetValue(
   }
   else
   {
-    measure = this->ComputePIDiff(parameters, this->m_NormalizationFactor);
+    measure = this->ComputePIDiff(this->m_NormalizationFactor);
     currentMeasure = -(measure - this->m_FixedMeasure) / this->m_Rescalingfactor;
   }
 
@@ -319,10 +319,41 @@ private:
   void
   CreateNDOperator(NeighborhoodType & F, const std::string & whichF, const CoefficientImageSpacingType & spacing) const;
 
-  /** Private function used for the filtering. It performs 1D separable filtering. */
+  /** Private function used for the filtering. It performs 1D separable filtering.
+   * Since all 1D operators have three taps, the filtering is done directly on the
+   * image buffers, using zero flux Neumann boundary conditions. The lines of every
+   * pass are divided over the threads.
+   */
   CoefficientImagePointer
   FilterSeparable(const CoefficientImageType *, const std::vector<NeighborhoodType> & Operators) const;
 
+  /** Typedefs for multi-threading. */
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** The struct that is passed to the threads for a single 1D filtering pass.
+   * The buffer is seen as a set of rows of st_Stride contiguous pixels, of which
+   * every st_LineLength consecutive rows form the lines along the filter direction.
+   */
+  struct FilterSeparableThreaderParameterType
+  {
+    const ScalarType * st_Input;
+    ScalarType *       st_Output;
+    ScalarType         st_Weights[3];
+    SizeValueType      st_NumberOfRows;
+    SizeValueType      st_LineLength;
+    SizeValueType      st_Stride;
+  };
+
+  /** The callback function of a 1D filtering pass. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  FilterSeparableThreaderCallback(void * arg);
+
+  /** Filter the rows [begin, end) of a 1D filtering pass. */
+  static void
+  FilterSeparableRows(const FilterSeparableThreaderParameterType & pass,
+                      const SizeValueType                          begin,
+                      const SizeValueType                          end);
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
   ScalarType              m_LinearityConditionWeight;
@@ -348,6 +379,8 @@ private:
   CoordinateRepresentationType     m_DilationRadiusMultiplier;
   bool                             m_DilateRigidityImages;
   mutable bool                     m_RigidityCoefficientImageIsFilled;
+  mutable ParametersType           m_RigidityCoefficientImageParameters;
+  std::vector<RigidityPixelType>   m_FixedRigidityCoefficients;
   RigidityImagePointer             m_FixedRigidityImage;
   RigidityImagePointer             m_MovingRigidityImage;
   RigidityImagePointer             m_RigidityCoefficientImage;
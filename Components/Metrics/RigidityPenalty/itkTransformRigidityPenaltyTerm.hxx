@@ -22,6 +22,8 @@
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -161,8 +163,57 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::Initialize(void)
     this->DilateRigidityImages();
   }
 
-  /** Reset the filling bool. */
+  /** The fixed rigidity image does not depend on the transform parameters,
+   * so its values at the B-spline grid points are looked up only once.
+   */
+  this->m_FixedRigidityCoefficients.clear();
+  if (this->m_UseFixedRigidityImage)
+  {
+    this->m_FixedRigidityCoefficients.reserve(region.GetNumberOfPixels());
+    RigidityImageIteratorType it(this->m_RigidityCoefficientImage, region);
+    RigidityImagePointType    point;
+    RigidityImageIndexType    index;
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      /** Get the corresponding index in the fixed RigidityImage.
+       * NOTE: Floating point index results are truncated to integers.
+       */
+      this->m_RigidityCoefficientImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      const bool isInFixedImage = this->m_FixedRigidityImageDilated->TransformPhysicalPointToIndex(point, index);
+      // \todo: Note that we should actually use the inverted initial transform
+      // here, a little bit like:
+      // isInFixedImage = this->m_FixedRigidityImageDilated
+      //   ->TransformPhysicalPointToIndex( this->Transform->GetInitialTransform()
+      //   ->GetInverse()->TransformPoint( point ), index );
+      // This is needed to compensate for the B-spline grid shift that has been
+      // performed earlier, which causes the B-spline grid region and thus the
+      // m_RigidityCoefficientImage region to be different from the fixed (coefffient)
+      // image region.
+      //
+      // Since in general the inverse does not exist, alternative strategies may be:
+      // 1) Approximate the inverse of the initial transform using inverse deformation
+      //    field approximation filters available in the ITK
+      // 2) Instead op looping over m_RigidityCoefficientImage, we can loop over
+      //    m_FixedRigidityImageDilated, employ the normal forward initial transform,
+      //    and fill m_RigidityCoefficientImage this way. A downside is that holes may
+      //    be created in the m_RigidityCoefficientImage, although this has low
+      //    likelihood, since the resolution of m_RigidityCoefficientImage is much
+      //    lower than the fixed (rigidity) image. And we could check for these holes
+      //    afterwards.
+      // WARNING: So, currently the rigidity penalty term does not correctly support
+      // initial transforms, in case a fixed coefficient image is provided. It works
+      // correctly if only a moving coefficient image is provided.
+      // Perhaps we should remove the option to supply the fixed coefficient image,
+      // since the moving one should really be used.
+
+      this->m_FixedRigidityCoefficients.push_back(
+        isInFixedImage ? this->m_FixedRigidityImageDilated->GetPixel(index) : NumericTraits<RigidityPixelType>::Zero);
+    }
+  }
+
+  /** Reset the filling bool and the parameters of the last filling. */
   this->m_RigidityCoefficientImageIsFilled = false;
+  this->m_RigidityCoefficientImageParameters.SetSize(0);
 
 } // end Initialize()
 
@@ -329,10 +380,20 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FillRigidityCoefficientI
     return;
   }
 
-  /** The rigidity image only changes when it depends on the moving image. */
-  if (!this->m_UseMovingRigidityImage && this->m_RigidityCoefficientImageIsFilled)
+  /** The rigidity image only changes when it depends on the moving image,
+   * and then only when the transform parameters have changed since the last fill.
+   */
+  if (this->m_RigidityCoefficientImageIsFilled)
   {
-    return;
+    if (!this->m_UseMovingRigidityImage)
+    {
+      return;
+    }
+    if (this->m_RigidityCoefficientImageParameters.GetSize() == parameters.GetSize() &&
+        this->m_RigidityCoefficientImageParameters == parameters)
+    {
+      return;
+    }
   }
 
   /** Make sure that the transform is up to date. */
@@ -343,78 +404,40 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FillRigidityCoefficientI
                                this->m_RigidityCoefficientImage->GetLargestPossibleRegion());
   it.GoToBegin();
 
-  /** Fill m_RigidityCoefficientImage. */
+  /** Fill m_RigidityCoefficientImage. The values from the fixed rigidity image
+   * do not depend on the transform, and are computed in Initialize().
+   */
   RigidityPixelType      fixedValue, movingValue, in;
   RigidityImagePointType point;
   point.Fill(0.0f);
-  RigidityImageIndexType index1, index2;
-  index1.Fill(0);
+  RigidityImageIndexType index2;
   index2.Fill(0);
   fixedValue = NumericTraits<RigidityPixelType>::Zero;
   movingValue = NumericTraits<RigidityPixelType>::Zero;
   in = NumericTraits<RigidityPixelType>::Zero;
-  bool isInFixedImage = false;
-  bool isInMovingImage = false;
+  bool          isInMovingImage = false;
+  SizeValueType pixelNumber = 0;
   while (!it.IsAtEnd())
   {
-    /** Get current pixel in world coordinates. */
-    this->m_RigidityCoefficientImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
-
-    /** Get the corresponding indices in the fixed and moving RigidityImage's.
-     * NOTE: Floating point index results are truncated to integers.
-     */
+    /** Get the value of the fixed rigidity image. */
     if (this->m_UseFixedRigidityImage)
     {
-      isInFixedImage = this->m_FixedRigidityImageDilated->TransformPhysicalPointToIndex(point, index1);
-      // \todo: Note that we should actually use the inverted initial transform
-      // here, a little bit like:
-      // isInFixedImage = this->m_FixedRigidityImageDilated
-      //   ->TransformPhysicalPointToIndex( this->Transform->GetInitialTransform()
-      //   ->GetInverse()->TransformPoint( point ), index1 );
-      // This is needed to compensate for the B-spline grid shift that has been
-      // performed earlier, which causes the B-spline grid region and thus the
-      // m_RigidityCoefficientImage region to be different from the fixed (coefffient)
-      // image region.
-      //
-      // Since in general the inverse does not exist, alternative strategies may be:
-      // 1) Approximate the inverse of the initial transform using inverse deformation
-      //    field approximation filters available in the ITK
-      // 2) Instead op looping over m_RigidityCoefficientImage, we can loop over
-      //    m_FixedRigidityImageDilated, employ the normal forward initial transform,
-      //    and fill m_RigidityCoefficientImage this way. A downside is that holes may
-      //    be created in the m_RigidityCoefficientImage, although this has low
-      //    likelihood, since the resolution of m_RigidityCoefficientImage is much
-      //    lower than the fixed (rigidity) image. And we could check for these holes
-      //    afterwards.
-      // WARNING: So, currently the rigidity penalty term does not correctly support
-      // initial transforms, in case a fixed coefficient image is provided. It works
-      // correctly if only a moving coefficient image is provided.
-      // Perhaps we should remove the option to supply the fixed coefficient image,
-      // since the moving one should really be used.
+      fixedValue = this->m_FixedRigidityCoefficients[pixelNumber];
     }
+
+    /** Get the value of the moving rigidity image at the transformed position.
+     * NOTE: Floating point index results are truncated to integers.
+     */
     if (this->m_UseMovingRigidityImage)
     {
+      /** Get current pixel in world coordinates. */
+      this->m_RigidityCoefficientImage->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+
       isInMovingImage = this->m_MovingRigidityImageDilated->TransformPhysicalPointToIndex(
         // this->m_Transform->TransformPoint( point ), index2 );
         this->m_BSplineTransform->TransformPoint(point),
         index2);
-    }
-
-    /** Get the values at those positions. */
-    if (this->m_UseFixedRigidityImage)
-    {
-      if (isInFixedImage)
-      {
-        fixedValue = this->m_FixedRigidityImageDilated->GetPixel(index1);
-      }
-      else
-      {
-        fixedValue = 0.0;
-      }
-    }
 
-    if (this->m_UseMovingRigidityImage)
-    {
       if (isInMovingImage)
       {
         movingValue = this->m_MovingRigidityImageDilated->GetPixel(index2);
@@ -447,10 +470,15 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FillRigidityCoefficientI
 
     /** Increase iterator. */
     ++it;
+    ++pixelNumber;
   } // end while loop over rigidity coefficient image
 
-  /** Remember that the rigidity coefficient image is filled. */
+  /** Remember that the rigidity coefficient image is filled, and for which parameters. */
   this->m_RigidityCoefficientImageIsFilled = true;
+  if (this->m_UseMovingRigidityImage)
+  {
+    this->m_RigidityCoefficientImageParameters = parameters;
+  }
 
 } // end FillRigidityCoefficientImage()
 
@@ -2167,30 +2195,159 @@ TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FilterSeparable(
   const CoefficientImageType *          image,
   const std::vector<NeighborhoodType> & Operators) const
 {
-  /** Create filters, supply them with boundary conditions and operators. */
-  std::vector<typename NOIFType::Pointer> filters(ImageDimension);
-  for (unsigned int i = 0; i < ImageDimension; ++i)
+  /** Create two images to ping-pong the 1D filtering passes between. */
+  const typename CoefficientImageType::RegionType region = image->GetBufferedRegion();
+  CoefficientImagePointer                         outputs[2];
+  for (unsigned int k = 0; k < 2; ++k)
   {
-    filters[i] = NOIFType::New();
-    filters[i]->SetOperator(Operators[i]);
+    outputs[k] = CoefficientImageType::New();
+    outputs[k]->CopyInformation(image);
+    outputs[k]->SetRegions(region);
+    outputs[k]->Allocate();
   }
 
-  /** Set up the mini-pipline. */
-  filters[0]->SetInput(image);
-  for (unsigned int i = 1; i < ImageDimension; ++i)
+  /** Small images are filtered by the calling thread, since the overhead
+   * of the threads would then dominate.
+   */
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
+  const SizeValueType minimumNumberOfPixelsPerWorkUnit = 4096;
+  const bool          useMultiThread =
+    this->m_UseMultiThread && numberOfPixels >= 2 * minimumNumberOfPixelsPerWorkUnit;
+
+  /** Apply the 1D operators one after the other. */
+  FilterSeparableThreaderParameterType pass;
+  pass.st_Input = image->GetBufferPointer();
+  SizeValueType stride = 1;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
   {
-    filters[i]->SetInput(filters[i - 1]->GetOutput());
-  }
+    /** The operators only have a radius of one in dimension i, so that
+     * their three taps are stored consecutively.
+     */
+    for (unsigned int k = 0; k < 3; ++k)
+    {
+      pass.st_Weights[k] = Operators[i][k];
+    }
+    pass.st_Output = outputs[i % 2]->GetBufferPointer();
+    pass.st_LineLength = region.GetSize(i);
 
-  /** Execute the mini-pipeline. */
-  filters[ImageDimension - 1]->Update();
+    /** Along the first dimension the lines are contiguous. Along the other
+     * dimensions every row of stride pixels is filtered in one go.
+     */
+    pass.st_Stride = stride;
+    pass.st_NumberOfRows = (i == 0) ? numberOfPixels / pass.st_LineLength : numberOfPixels / stride;
+
+    if (useMultiThread)
+    {
+      this->LaunchThreaderCallback(FilterSeparableThreaderCallback, &pass);
+    }
+    else
+    {
+      FilterSeparableRows(pass, 0, pass.st_NumberOfRows);
+    }
+
+    pass.st_Input = pass.st_Output;
+    stride *= pass.st_LineLength;
+  }
 
   /** Return the filtered image. */
-  return filters[ImageDimension - 1]->GetOutput();
+  return outputs[(ImageDimension - 1) % 2];
 
 } // end FilterSeparable()
 
 
+/**
+ * ******************* FilterSeparableThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TScalarType>
+ITK_THREAD_RETURN_TYPE
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FilterSeparableThreaderCallback(void * arg)
+{
+  ThreadInfoType *                       infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType                     threadID = infoStruct->WorkUnitID;
+  const ThreadIdType                     numberOfThreads = infoStruct->NumberOfWorkUnits;
+  FilterSeparableThreaderParameterType * pass =
+    static_cast<FilterSeparableThreaderParameterType *>(infoStruct->UserData);
+
+  /** Divide the rows over the threads. */
+  const SizeValueType numberOfRows = pass->st_NumberOfRows;
+  const SizeValueType chunkSize = (numberOfRows + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType begin = std::min<SizeValueType>(threadID * chunkSize, numberOfRows);
+  const SizeValueType end = std::min<SizeValueType>(begin + chunkSize, numberOfRows);
+
+  FilterSeparableRows(*pass, begin, end);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end FilterSeparableThreaderCallback()
+
+
+/**
+ * ************************ FilterSeparableRows *********************
+ */
+
+template <class TFixedImage, class TScalarType>
+void
+TransformRigidityPenaltyTerm<TFixedImage, TScalarType>::FilterSeparableRows(
+  const FilterSeparableThreaderParameterType & pass,
+  const SizeValueType                          begin,
+  const SizeValueType                          end)
+{
+  const ScalarType    w0 = pass.st_Weights[0];
+  const ScalarType    w1 = pass.st_Weights[1];
+  const ScalarType    w2 = pass.st_Weights[2];
+  const SizeValueType n = pass.st_LineLength;
+  const SizeValueType stride = pass.st_Stride;
+
+  if (stride == 1)
+  {
+    /** Every row is a contiguous line. The borders are handled separately,
+     * so that the inner loop is free of branches and can be vectorised.
+     */
+    for (SizeValueType row = begin; row < end; ++row)
+    {
+      const ScalarType * in = pass.st_Input + row * n;
+      ScalarType *       out = pass.st_Output + row * n;
+      if (n == 1)
+      {
+        out[0] = (w0 + w1 + w2) * in[0];
+        continue;
+      }
+
+      out[0] = (w0 + w1) * in[0] + w2 * in[1];
+      for (SizeValueType x = 1; x + 1 < n; ++x)
+      {
+        out[x] = w0 * in[x - 1] + w1 * in[x] + w2 * in[x + 1];
+      }
+      out[n - 1] = w0 * in[n - 2] + (w1 + w2) * in[n - 1];
+    }
+  }
+  else
+  {
+    /** Every row is combined with its neighbouring rows along the filter
+     * direction, where the first and last row are repeated at the borders.
+     */
+    for (SizeValueType row = begin; row < end; ++row)
+    {
+      const SizeValueType p = row % n;
+      const SizeValueType lineStart = row - p;
+      const SizeValueType previous = lineStart + (p > 0 ? p - 1 : 0);
+      const SizeValueType next = lineStart + (p + 1 < n ? p + 1 : p);
+
+      const ScalarType * inPrevious = pass.st_Input + previous * stride;
+      const ScalarType * inCurrent = pass.st_Input + row * stride;
+      const ScalarType * inNext = pass.st_Input + next * stride;
+      ScalarType *       out = pass.st_Output + row * stride;
+      for (SizeValueType x = 0; x < stride; ++x)
+      {
+        out[x] = w0 * inPrevious[x] + w1 * inCurrent[x] + w2 * inNext[x];
+      }
+    }
+  }
+
+} // end FilterSeparableRows()
+
+
 /**
  * ************************ CreateNDOperator *********************
  */
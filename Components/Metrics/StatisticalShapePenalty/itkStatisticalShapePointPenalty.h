@@ -35,6 +35,7 @@
 #include <vnl/algo/vnl_svd_economy.h>
 
 #include <string>
+#include <vector>
 
 namespace itk
 {
@@ -49,6 +50,11 @@ namespace itk
  * application to organ segmentation in cervical MR, Comput. Vis. Image Understand. (2013),
  * http://dx.doi.org/10.1016/j.cviu.2012.12.006
  *
+ * The points of the shape are transformed in one batch. The derivative is computed by first
+ * determining the gradient of the value with respect to the transformed point coordinates,
+ * which is then multiplied by the sparse Jacobian of every point. The threads each handle a
+ * range of points and accumulate their contributions in their own derivative.
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -75,6 +81,7 @@ public:
   typedef typename Superclass::TransformParametersType    TransformParametersType;
   typedef typename Superclass::TransformJacobianType      TransformJacobianType;
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
 
   typedef typename Superclass::MeasureType                MeasureType;
   typedef typename Superclass::DerivativeType             DerivativeType;
@@ -93,9 +100,6 @@ public:
   typedef typename OutputPointType::CoordRepType CoordRepType;
   typedef vnl_vector<CoordRepType>               VnlVectorType;
   typedef vnl_matrix<CoordRepType>               VnlMatrixType;
-  // typedef itk::Array<VnlVectorType *> ProposalDerivativeType;
-  typedef typename std::vector<VnlVectorType *> ProposalDerivativeType;
-  // typedef typename vnl_vector<VnlVectorType *> ProposalDerivativeType; //Cannot be linked
   typedef vnl_svd_economy<CoordRepType> PCACovarianceType;
 
   /** Initialization. */
@@ -180,40 +184,68 @@ private:
   void
   operator=(const Self &) = delete;
 
+  /** The struct that is passed to the threads of CalculateDerivative(). */
+  struct MultiThreaderParameterType
+  {
+    const Self *           st_Metric;
+    const InputPointType * st_FixedPoints;
+    const VnlVectorType *  st_ShapeGradient;
+    SizeValueType          st_NumberOfPoints;
+    ThreadIdType           st_NumberOfWorkUnits;
+    DerivativeType *       st_PerThreadDerivatives;
+  };
+
+  /** Copy the fixed points to an array, and their transformed positions to the proposal vector. */
   void
-  FillProposalVector(const OutputPointType & fixedPoint, const unsigned int vertexindex) const;
-
-  void
-  FillProposalDerivative(const OutputPointType & fixedPoint, const unsigned int vertexindex) const;
+  FillProposalVector(std::vector<InputPointType> & fixedPoints) const;
 
   void
   UpdateCentroidAndAlignProposalVector(const unsigned int shapeLength) const;
 
-  void
-  UpdateCentroidAndAlignProposalDerivative(const unsigned int shapeLength) const;
-
   void
   UpdateL2(const unsigned int shapeLength) const;
 
   void
   NormalizeProposalVector(const unsigned int shapeLength) const;
 
-  void
-  UpdateL2AndNormalizeProposalDerivative(const unsigned int shapeLength) const;
-
   void
   CalculateValue(MeasureType &   value,
                  VnlVectorType & differenceVector,
                  VnlVectorType & centerrotated,
                  VnlVectorType & eigrot) const;
 
+  /** Compute the gradient of the value with respect to the transformed point coordinates. */
+  void
+  CalculateShapeGradient(VnlVectorType &       shapeGradient,
+                         const MeasureType &   value,
+                         const VnlVectorType & differenceVector,
+                         const VnlVectorType & centerrotated,
+                         const VnlVectorType & eigrot,
+                         const unsigned int    shapeLength) const;
+
   void
-  CalculateDerivative(DerivativeType &      derivative,
-                      const MeasureType &   value,
-                      const VnlVectorType & differenceVector,
-                      const VnlVectorType & centerrotated,
-                      const VnlVectorType & eigrot,
-                      const unsigned int    shapeLength) const;
+  CalculateDerivative(DerivativeType &                    derivative,
+                      const MeasureType &                 value,
+                      const VnlVectorType &               differenceVector,
+                      const VnlVectorType &               centerrotated,
+                      const VnlVectorType &               eigrot,
+                      const std::vector<InputPointType> & fixedPoints,
+                      const unsigned int                  shapeLength) const;
+
+  /** Add the contributions of the points in the range [begin, end) to the derivative. */
+  void
+  AccumulateDerivativeRange(const MultiThreaderParameterType & parameters,
+                            const SizeValueType                begin,
+                            const SizeValueType                end,
+                            DerivativeType &                   derivative) const;
+
+  /** The threader callback function of CalculateDerivative(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  CalculateDerivativeThreaderCallback(void * arg);
+
+  /** Compute the row vector result = vector^T * matrix in a single pass over the matrix. */
+  static void
+  MultiplyVectorMatrix(const VnlVectorType & vector, const VnlMatrixType & matrix, VnlVectorType & result);
 
   void
   CalculateCutOffValue(MeasureType & value) const;
@@ -243,15 +275,14 @@ private:
 
   VnlVectorType * m_EigenValuesRegularized;
 
-  mutable ProposalDerivativeType * m_ProposalDerivative;
-  unsigned int                     m_ProposalLength;
-  bool                             m_NormalizedShapeModel;
-  int                              m_ShapeModelCalculation;
-  double                           m_ShrinkageIntensity;
-  double                           m_BaseVariance;
-  double                           m_BaseStd;
-  mutable VnlVectorType            m_ProposalVector;
-  mutable VnlVectorType            m_MeanValues;
+  unsigned int          m_ProposalLength;
+  bool                  m_NormalizedShapeModel;
+  int                   m_ShapeModelCalculation;
+  double                m_ShrinkageIntensity;
+  double                m_BaseVariance;
+  double                m_BaseStd;
+  mutable VnlVectorType m_ProposalVector;
+  mutable VnlVectorType m_MeanValues;
 
   double m_CutOffValue;
   double m_CutOffSharpness;
@@ -34,7 +34,6 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::StatisticalShapeP
   this->m_EigenVectors = nullptr;
   this->m_EigenValues = nullptr;
   this->m_EigenValuesRegularized = nullptr;
-  this->m_ProposalDerivative = nullptr;
   this->m_InverseCovarianceMatrix = nullptr;
 
   this->m_ShrinkageIntensityNeedsUpdate = true;
@@ -76,11 +75,6 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::~StatisticalShape
     delete this->m_EigenValuesRegularized;
     this->m_EigenValuesRegularized = nullptr;
   }
-  if (this->m_ProposalDerivative != nullptr)
-  {
-    delete this->m_ProposalDerivative;
-    this->m_ProposalDerivative = nullptr;
-  }
   if (this->m_InverseCovarianceMatrix != nullptr)
   {
     delete this->m_InverseCovarianceMatrix;
@@ -357,9 +351,6 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValue(
   // this->m_NumberOfPointsCounted = 0;
   MeasureType value = NumericTraits<MeasureType>::Zero;
 
-  // InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters(parameters);
 
@@ -369,22 +360,8 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValue(
   /** Part 1:
    * - Copy point positions in proposal vector
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while (pointItFixed != pointEnd)
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector(fixedPoint, vertexindex);
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  std::vector<InputPointType> fixedPoints;
+  this->FillProposalVector(fixedPoints);
 
   if (this->m_NormalizedShapeModel)
   {
@@ -459,38 +436,18 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDeriva
   derivative = DerivativeType(this->GetNumberOfParameters());
   derivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
 
-  // InputPointType movingPoint;
-  OutputPointType fixedPoint;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters(parameters);
 
   const unsigned int shapeLength = Self::FixedPointSetDimension * fixedPointSet->GetNumberOfPoints();
 
   this->m_ProposalVector.set_size(this->m_ProposalLength);
-  this->m_ProposalDerivative = new ProposalDerivativeType(this->GetNumberOfParameters(), nullptr);
 
   /** Part 1:
    * - Copy point positions in proposal vector
-   * - Copy point derivatives in proposal derivative vector
    */
-
-  /** Create iterators. */
-  PointIterator pointItFixed = fixedPointSet->GetPoints()->Begin();
-  PointIterator pointEnd = fixedPointSet->GetPoints()->End();
-
-  unsigned int vertexindex = 0;
-  /** Loop over the corresponding points. */
-  while (pointItFixed != pointEnd)
-  {
-    fixedPoint = pointItFixed.Value();
-    this->FillProposalVector(fixedPoint, vertexindex);
-    this->FillProposalDerivative(fixedPoint, vertexindex);
-
-    this->m_NumberOfPointsCounted++;
-    ++pointItFixed;
-    vertexindex += Self::FixedPointSetDimension;
-  } // end loop over all corresponding points
+  std::vector<InputPointType> fixedPoints;
+  this->FillProposalVector(fixedPoints);
 
   if (this->m_NormalizedShapeModel)
   {
@@ -498,23 +455,15 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDeriva
      * - Calculate shape centroid
      * - put centroid values in proposal
      * - update proposal vector with aligned shape
-     * - Calculate centroid derivatives and update proposal derivative vectors
-     * - put centroid derivatives values in proposal derivatives
-     * - update proposal derivatives
      */
     this->UpdateCentroidAndAlignProposalVector(shapeLength);
-    this->UpdateCentroidAndAlignProposalDerivative(shapeLength);
 
     /** Part 3:
      * - Calculate l2-norm from aligned shapes
      * - put l2-norm value in proposal vector
      * - update proposal vector with size normalized shape
-     * - Calculate l2-norm derivatice from updated proposal vector
-     * - put l2-norm derivative value in proposal derivative vectors
-     * - update proposal derivatives
      */
     this->UpdateL2(shapeLength);
-    this->UpdateL2AndNormalizeProposalDerivative(shapeLength);
     this->NormalizeProposalVector(shapeLength);
 
   } // end if(m_NormalizedShapeModel)
@@ -526,24 +475,14 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDeriva
 
   this->CalculateValue(value, differenceVector, centerrotated, eigrot);
 
+  /** Part 4:
+   * - Calculate the gradient with respect to the transformed points
+   * - multiply it with the Jacobians of the points
+   */
   if (value != 0.0)
   {
-    this->CalculateDerivative(derivative, value, differenceVector, centerrotated, eigrot, shapeLength);
-  }
-  else
-  {
-    typename ProposalDerivativeType::iterator proposalDerivativeIt = this->m_ProposalDerivative->begin();
-    typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-    for (; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt)
-    {
-      if (*proposalDerivativeIt != nullptr)
-      {
-        delete (*proposalDerivativeIt);
-      }
-    }
+    this->CalculateDerivative(derivative, value, differenceVector, centerrotated, eigrot, fixedPoints, shapeLength);
   }
-  delete this->m_ProposalDerivative;
-  this->m_ProposalDerivative = nullptr;
 
   this->CalculateCutOffValue(value);
 
@@ -556,66 +495,36 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::GetValueAndDeriva
 
 template <class TFixedPointSet, class TMovingPointSet>
 void
-StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::FillProposalVector(const OutputPointType & fixedPoint,
-                                                                                  const unsigned int vertexindex) const
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::FillProposalVector(
+  std::vector<InputPointType> & fixedPoints) const
 {
-  OutputPointType mappedPoint;
-  /** Get the current corresponding points. */
-  mappedPoint = this->m_Transform->TransformPoint(fixedPoint);
+  /** Copy the fixed points to a contiguous array. */
+  const SizeValueType numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+  fixedPoints.resize(numberOfPoints);
 
-  /** Copy n-D coordinates into big Shape vector. Aligning the centroids is done later. */
-  for (unsigned int d = 0; d < Self::FixedPointSetDimension; ++d)
+  PointIterator pointItFixed = this->GetFixedPointSet()->GetPoints()->Begin();
+  for (SizeValueType i = 0; i < numberOfPoints; ++i, ++pointItFixed)
   {
-    this->m_ProposalVector[vertexindex + d] = mappedPoint[d];
+    fixedPoints[i] = pointItFixed.Value();
   }
-} // end FillProposalVector()
-
-
-/**
- * ******************* FillProposalDerivative *******************
- */
-
-template <class TFixedPointSet, class TMovingPointSet>
-void
-StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::FillProposalDerivative(
-  const OutputPointType & fixedPoint,
-  const unsigned int      vertexindex) const
-{
-  /**
-   * A (column) vector is constructed for each mu, only if that mu affects the shape penalty.
-   * I.e. if there is at least one point of the mesh with non-zero derivatives,
-   * a full column vector is instantiated (which can contain zeros for many other points)
-   *
-   * m_ProposalDerivative is a container with either full shape-vector-sized derivative vectors or NULL-s. Example:
-   *
-   * mu1: [ [ dx1/dmu1 , dy1/dmu1 , dz1/dmu1 ] , [ 0 , 0 , 0 ] , [ dx3/dmu1 , dy3/dmu1 , dz3/dmu1 ] , [...] ]^T
-   * mu2: Null
-   * mu3: [ [ 0 , 0 , 0 ] , [ dx2/dmu3 , dy2/dmu3 , dz2/dmu3 ] , [ dx3/dmu3 , dy3/dmu3 , dz3/dmu3 ] , [...] ]^T
-   *
-   */
-
-  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
-
-  /** Get the TransformJacobian dT/dmu. */
-  TransformJacobianType jacobian;
-  this->m_Transform->GetJacobian(fixedPoint, jacobian, nzji);
 
-  for (unsigned int i = 0; i < nzji.size(); ++i)
+  /** Transform all points in one batch. */
+  std::vector<OutputPointType> mappedPoints(numberOfPoints);
+  if (numberOfPoints > 0)
   {
-    const unsigned int mu = nzji[i];
-    if ((*this->m_ProposalDerivative)[mu] == nullptr)
-    {
-      /** Create the big column vector if it does not yet exist for this mu*/
-      (*this->m_ProposalDerivative)[mu] = new VnlVectorType(this->m_ProposalLength, 0.0);
-      // memory will be freed in CalculateDerivative()
-    }
+    this->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPoints);
+  }
 
-    /** The column vector exists for this mu, so copy the jacobians for this point into the big vector. */
+  /** Copy n-D coordinates into big Shape vector. Aligning the centroids is done later. */
+  unsigned int vertexindex = 0;
+  for (SizeValueType i = 0; i < numberOfPoints; ++i, vertexindex += Self::FixedPointSetDimension)
+  {
     for (unsigned int d = 0; d < Self::FixedPointSetDimension; ++d)
     {
-      (*(*this->m_ProposalDerivative)[mu])[vertexindex + d] = jacobian.get_column(i)[d];
+      this->m_ProposalVector[vertexindex + d] = mappedPoints[i][d];
     }
   }
+  this->m_NumberOfPointsCounted += numberOfPoints;
 
 } // end FillProposalVector()
 
@@ -656,44 +565,6 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::UpdateCentroidAnd
 } // end UpdateCentroidAndAlignProposalVector()
 
 
-/**
- * ******************* UpdateCentroidAndAlignProposalDerivative *******************
- */
-
-template <class TFixedPointSet, class TMovingPointSet>
-void
-StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::UpdateCentroidAndAlignProposalDerivative(
-  const unsigned int shapeLength) const
-{
-  typename ProposalDerivativeType::iterator proposalDerivativeIt = m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = m_ProposalDerivative->end();
-  while (proposalDerivativeIt != proposalDerivativeEnd)
-  {
-    if (*proposalDerivativeIt != nullptr)
-    {
-      for (unsigned int d = 0; d < Self::FixedPointSetDimension; ++d)
-      {
-        double & centroid_dDerivative = (**proposalDerivativeIt)[shapeLength + d];
-        centroid_dDerivative = 0; // initialize accumulators to zero
-
-        for (unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension)
-        {
-          centroid_dDerivative += (**proposalDerivativeIt)[index + d]; // sum all x derivatives
-        }
-
-        centroid_dDerivative /= this->GetFixedPointSet()->GetNumberOfPoints(); // divide sum to get average
-
-        for (unsigned int index = 0; index < shapeLength; index += Self::FixedPointSetDimension)
-        {
-          (**proposalDerivativeIt)[index + d] -= centroid_dDerivative; // subtract average
-        }
-      }
-    }
-    ++proposalDerivativeIt;
-  }
-} // end UpdateCentroidAndAlignProposalDerivative()
-
-
 /**
  * ******************* UpdateL2 *******************
  */
@@ -737,47 +608,6 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::NormalizeProposal
 } // end NormalizeProposalVector()
 
 
-/**
- * ******************* UpdateL2AndNormalizeProposalDerivative *******************
- */
-
-template <class TFixedPointSet, class TMovingPointSet>
-void
-StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::UpdateL2AndNormalizeProposalDerivative(
-  const unsigned int shapeLength) const
-{
-  double & l2norm = this->m_ProposalVector[shapeLength + Self::FixedPointSetDimension];
-
-  typename ProposalDerivativeType::iterator proposalDerivativeIt = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-
-  while (proposalDerivativeIt != proposalDerivativeEnd)
-  {
-    if (*proposalDerivativeIt != nullptr)
-    {
-      double & l2normDerivative = (**proposalDerivativeIt)[shapeLength + Self::FixedPointSetDimension];
-      l2normDerivative = 0; // initialize to zero
-      // loop over all shape coordinates of the aligned shape
-      for (unsigned int index = 0; index < shapeLength; ++index)
-      {
-        l2normDerivative += this->m_ProposalVector[index] * (**proposalDerivativeIt)[index];
-      }
-      l2normDerivative /= (l2norm * sqrt((double)(this->GetFixedPointSet()->GetNumberOfPoints())));
-
-      // loop over all shape coordinates of the aligned shape
-      for (unsigned int index = 0; index < shapeLength; ++index)
-      {
-        // update normalized shape derivatives
-        (**proposalDerivativeIt)[index] = (**proposalDerivativeIt)[index] / l2norm -
-                                          this->m_ProposalVector[index] * l2normDerivative / (l2norm * l2norm);
-      }
-    }
-    ++proposalDerivativeIt;
-  }
-
-} // end UpdateL2AndNormalizeProposalDerivative()
-
-
 /**
  * ******************* CalculateValue *******************
  */
@@ -795,12 +625,14 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateValue(Me
   {
     case 0: // full covariance
     {
-      value = sqrt(bracket(differenceVector, *this->m_InverseCovarianceMatrix, differenceVector));
+      /** diff^T * Sigma^-1 is kept, since it is also the gradient of the squared value. */
+      Self::MultiplyVectorMatrix(differenceVector, *this->m_InverseCovarianceMatrix, centerrotated);
+      value = sqrt(dot_product(centerrotated, differenceVector));
       break;
     }
     case 1: // decomposed covariance (uniform regularization)
     {
-      centerrotated = differenceVector * (*m_EigenVectors);                /** diff^T * V */
+      Self::MultiplyVectorMatrix(differenceVector, *this->m_EigenVectors, centerrotated); /** diff^T * V */
       eigrot = element_quotient(centerrotated, *m_EigenValuesRegularized); /** diff^T * V * Lambda^-1 */
       if (this->m_ShrinkageIntensity != 0)
       {
@@ -828,7 +660,7 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateValue(Me
       differenceVector[shapeLength + 2] /= this->m_CentroidZStd;
       differenceVector[shapeLength + 3] /= this->m_SizeStd;
 
-      centerrotated = differenceVector * (*this->m_EigenVectors);                /** diff^T * V */
+      Self::MultiplyVectorMatrix(differenceVector, *this->m_EigenVectors, centerrotated); /** diff^T * V */
       eigrot = element_quotient(centerrotated, *this->m_EigenValuesRegularized); /** diff^T * V * Lambda^-1 */
       if (this->m_ShrinkageIntensity != 0)
       {
@@ -852,103 +684,266 @@ StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateValue(Me
 
 
 /**
- * ******************* CalculateDerivative *******************
+ * ******************* CalculateShapeGradient *******************
  */
 
 template <class TFixedPointSet, class TMovingPointSet>
 void
-StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateDerivative(
-  DerivativeType &      derivative,
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateShapeGradient(
+  VnlVectorType &       shapeGradient,
   const MeasureType &   value,
   const VnlVectorType & differenceVector,
   const VnlVectorType & centerrotated,
   const VnlVectorType & eigrot,
   const unsigned int    shapeLength) const
 {
-  typename ProposalDerivativeType::iterator proposalDerivativeIt = this->m_ProposalDerivative->begin();
-  typename ProposalDerivativeType::iterator proposalDerivativeEnd = this->m_ProposalDerivative->end();
-
-  typename DerivativeType::iterator derivativeIt = derivative.begin();
+  /** The gradient of the value with respect to the proposal vector. Since
+   * d/dmu(diff) is the derivative of the proposal vector, the inner products
+   * of the different models are written as gradient^T * d/dmu(diff).
+   */
+  VnlVectorType proposalGradient(this->m_ProposalLength, 0.0);
 
-  for (; proposalDerivativeIt != proposalDerivativeEnd; ++proposalDerivativeIt, ++derivativeIt)
+  switch (this->m_ShapeModelCalculation)
   {
-    if (*proposalDerivativeIt != nullptr)
+    case 0: // full covariance
+    {
+      /** diff^T * Sigma^-1, computed by CalculateValue() */
+      proposalGradient = centerrotated;
+      break;
+    }
+    case 1: // decomposed covariance (uniform regularization)
     {
-      switch (this->m_ShapeModelCalculation)
+      /** diff^T * V * Lambda^-1 * V^T + 1/(Beta*sigma_0^2)*diff^T */
+      proposalGradient = (*this->m_EigenVectors) * eigrot;
+      if (this->m_ShrinkageIntensity != 0)
       {
-        case 0: // full covariance
-        {
-          /**innerproduct diff^T * Sigma^-1 * d/dmu (diff), where iterated over mu-s*/
-          *derivativeIt = bracket(differenceVector, *m_InverseCovarianceMatrix, (**proposalDerivativeIt)) / value;
-          this->CalculateCutOffDerivative(*derivativeIt, value);
-          break;
-        }
-        case 1: // decomposed covariance (uniform regularization)
-        {
-          if (this->m_ShrinkageIntensity != 0)
-          {
-            /** Innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = (dot_product(eigrot, this->m_EigenVectors->transpose() * (**proposalDerivativeIt)) +
-                             dot_product(differenceVector, **proposalDerivativeIt) /
-                               (this->m_ShrinkageIntensity * this->m_BaseVariance)) /
-                            value;
-            this->CalculateCutOffDerivative(*derivativeIt, value);
-          }
-          else // m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = (dot_product(eigrot, this->m_EigenVectors->transpose() * (**proposalDerivativeIt))) / value;
-            this->CalculateCutOffDerivative(*derivativeIt, value);
-          }
-          break;
-        }
-        case 2: // decomposed scaled covariance (element specific regularization)
-        {
-          // first scale proposalDerivatives with their sigma's in order to evaluate
-          // with the EigenValues and EigenVectors of the scaled CovarianceMatrix
-          typename VnlVectorType::iterator propDerivElementIt = (*proposalDerivativeIt)->begin();
-          for (unsigned int propDerivElementIndex = 0; propDerivElementIndex < shapeLength;
-               ++propDerivElementIndex, ++propDerivElementIt)
-          {
-            (*propDerivElementIt) /= this->m_BaseStd;
-          }
-          (**proposalDerivativeIt)[shapeLength] /= this->m_CentroidXStd;
-          (**proposalDerivativeIt)[shapeLength + 1] /= this->m_CentroidYStd;
-          (**proposalDerivativeIt)[shapeLength + 2] /= this->m_CentroidZStd;
-          (**proposalDerivativeIt)[shapeLength + 3] /= this->m_SizeStd;
-          if (this->m_ShrinkageIntensity != 0)
-          {
-            /** innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu(diff)
-             * + 1/(Beta*sigma_0^2)*diff^T* d/dmu(diff), where iterated over mu-s
-             */
-            *derivativeIt = (dot_product(eigrot, this->m_EigenVectors->transpose() * (**proposalDerivativeIt)) +
-                             dot_product(differenceVector, **proposalDerivativeIt) / this->m_ShrinkageIntensity) /
-                            value;
-            this->CalculateCutOffDerivative(*derivativeIt, value);
-          }
-          else // m_ShrinkageIntensity==0
-          {
-            /**innerproduct diff^T * V * Lambda^-1 * V^T * d/dmu (diff), where iterated over mu-s*/
-            *derivativeIt = (dot_product(eigrot, this->m_EigenVectors->transpose() * (**proposalDerivativeIt))) / value;
-            this->CalculateCutOffDerivative(*derivativeIt, value);
-          }
-          break;
-        }
-        default:
-        {
-        }
-
-          delete (*proposalDerivativeIt);
-          // nzjacs++;
+        proposalGradient += differenceVector / (this->m_ShrinkageIntensity * this->m_BaseVariance);
+      }
+      break;
+    }
+    case 2: // decomposed scaled covariance (element specific regularization)
+    {
+      /** diff^T * V * Lambda^-1 * V^T + 1/(Beta)*diff^T, scaled with the sigma's
+       * of the elements in order to evaluate with the EigenValues and EigenVectors
+       * of the scaled CovarianceMatrix
+       */
+      proposalGradient = (*this->m_EigenVectors) * eigrot;
+      if (this->m_ShrinkageIntensity != 0)
+      {
+        proposalGradient += differenceVector / this->m_ShrinkageIntensity;
+      }
+      for (unsigned int index = 0; index < shapeLength; ++index)
+      {
+        proposalGradient[index] /= this->m_BaseStd;
       }
+      proposalGradient[shapeLength] /= this->m_CentroidXStd;
+      proposalGradient[shapeLength + 1] /= this->m_CentroidYStd;
+      proposalGradient[shapeLength + 2] /= this->m_CentroidZStd;
+      proposalGradient[shapeLength + 3] /= this->m_SizeStd;
+      break;
+    }
+    default:
+      break;
+  }
+  proposalGradient /= value;
+
+  if (!this->m_NormalizedShapeModel)
+  {
+    shapeGradient = proposalGradient;
+    return;
+  }
+
+  /** Propagate the gradient back through the size normalization and the
+   * centroid alignment, which are linear in the derivative of the points.
+   */
+  const double numberOfPoints = this->GetFixedPointSet()->GetNumberOfPoints();
+  const double l2norm = this->m_ProposalVector[shapeLength + Self::FixedPointSetDimension];
+  const double sqrtNumberOfPoints = std::sqrt(numberOfPoints);
+
+  double gradientDotShape = 0.0;
+  for (unsigned int index = 0; index < shapeLength; ++index)
+  {
+    gradientDotShape += proposalGradient[index] * this->m_ProposalVector[index];
+  }
+  const double l2normFactor =
+    proposalGradient[shapeLength + Self::FixedPointSetDimension] - gradientDotShape / l2norm;
+
+  shapeGradient.set_size(shapeLength);
+  for (unsigned int index = 0; index < shapeLength; ++index)
+  {
+    shapeGradient[index] =
+      proposalGradient[index] / l2norm + l2normFactor * this->m_ProposalVector[index] / sqrtNumberOfPoints;
+  }
+
+  for (unsigned int d = 0; d < Self::FixedPointSetDimension; ++d)
+  {
+    double sum = 0.0;
+    for (unsigned int index = d; index < shapeLength; index += Self::FixedPointSetDimension)
+    {
+      sum += shapeGradient[index];
+    }
+    const double centroidTerm = (proposalGradient[shapeLength + d] - sum) / numberOfPoints;
+    for (unsigned int index = d; index < shapeLength; index += Self::FixedPointSetDimension)
+    {
+      shapeGradient[index] += centroidTerm;
     }
   }
 
+} // end CalculateShapeGradient()
+
+
+/**
+ * ******************* CalculateDerivative *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateDerivative(
+  DerivativeType &                    derivative,
+  const MeasureType &                 value,
+  const VnlVectorType &               differenceVector,
+  const VnlVectorType &               centerrotated,
+  const VnlVectorType &               eigrot,
+  const std::vector<InputPointType> & fixedPoints,
+  const unsigned int                  shapeLength) const
+{
+  /** The gradient with respect to the transformed point coordinates. */
+  VnlVectorType shapeGradient;
+  this->CalculateShapeGradient(shapeGradient, value, differenceVector, centerrotated, eigrot, shapeLength);
+
+  /** Multiply the gradient with the sparse Jacobians of the points, possibly in threads. */
+  const SizeValueType numberOfPoints = fixedPoints.size();
+  const ThreadIdType  numberOfWorkUnits = this->GetNumberOfWorkUnitsForPoints(numberOfPoints);
+
+  MultiThreaderParameterType userData;
+  userData.st_Metric = this;
+  userData.st_FixedPoints = fixedPoints.data();
+  userData.st_ShapeGradient = &shapeGradient;
+  userData.st_NumberOfPoints = numberOfPoints;
+  userData.st_NumberOfWorkUnits = numberOfWorkUnits;
+  userData.st_PerThreadDerivatives = nullptr;
+
+  if (numberOfWorkUnits < 2)
+  {
+    this->AccumulateDerivativeRange(userData, 0, numberOfPoints, derivative);
+  }
+  else
+  {
+    std::vector<DerivativeType> perThreadDerivatives(numberOfWorkUnits);
+    for (DerivativeType & threadDerivative : perThreadDerivatives)
+    {
+      threadDerivative.SetSize(this->GetNumberOfParameters());
+      threadDerivative.Fill(NumericTraits<DerivativeValueType>::ZeroValue());
+    }
+    userData.st_PerThreadDerivatives = perThreadDerivatives.data();
+
+    this->LaunchThreaderCallback(Self::CalculateDerivativeThreaderCallback, &userData, numberOfWorkUnits);
+
+    /** Accumulate the derivatives of the threads. */
+    for (const DerivativeType & threadDerivative : perThreadDerivatives)
+    {
+      derivative += threadDerivative;
+    }
+  }
+
+  for (unsigned int mu = 0; mu < derivative.GetSize(); ++mu)
+  {
+    this->CalculateCutOffDerivative(derivative[mu], value);
+  }
+
 } // end CalculateDerivative()
 
 
+/**
+ * ******************* CalculateDerivativeThreaderCallback *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::CalculateDerivativeThreaderCallback(void * arg)
+{
+  ThreadInfoType *             infoStruct = static_cast<ThreadInfoType *>(arg);
+  const ThreadIdType           threadID = infoStruct->WorkUnitID;
+  MultiThreaderParameterType * temp = static_cast<MultiThreaderParameterType *>(infoStruct->UserData);
+
+  SizeValueType begin = 0;
+  SizeValueType end = 0;
+  Self::GetWorkUnitPointRange(temp->st_NumberOfPoints, threadID, temp->st_NumberOfWorkUnits, begin, end);
+
+  temp->st_Metric->AccumulateDerivativeRange(*temp, begin, end, temp->st_PerThreadDerivatives[threadID]);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end CalculateDerivativeThreaderCallback()
+
+
+/**
+ * ******************* AccumulateDerivativeRange *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::AccumulateDerivativeRange(
+  const MultiThreaderParameterType & parameters,
+  const SizeValueType                begin,
+  const SizeValueType                end,
+  DerivativeType &                   derivative) const
+{
+  NonZeroJacobianIndicesType nzji(this->m_Transform->GetNumberOfNonZeroJacobianIndices());
+  TransformJacobianType      jacobian;
+  VnlVectorType              pointGradient(Self::FixedPointSetDimension);
+
+  for (SizeValueType i = begin; i < end; ++i)
+  {
+    /** The part of the gradient that belongs to this point. */
+    const unsigned int vertexindex = i * Self::FixedPointSetDimension;
+    for (unsigned int d = 0; d < Self::FixedPointSetDimension; ++d)
+    {
+      pointGradient[d] = (*parameters.st_ShapeGradient)[vertexindex + d];
+    }
+
+    /** Get the TransformJacobian dT/dmu. */
+    this->m_Transform->GetJacobian(parameters.st_FixedPoints[i], jacobian, nzji);
+    this->AccumulateJacobianProduct(pointGradient, jacobian, nzji, derivative);
+  }
+
+} // end AccumulateDerivativeRange()
+
+
+/**
+ * ******************* MultiplyVectorMatrix *******************
+ */
+
+template <class TFixedPointSet, class TMovingPointSet>
+void
+StatisticalShapePointPenalty<TFixedPointSet, TMovingPointSet>::MultiplyVectorMatrix(const VnlVectorType & vector,
+                                                                                    const VnlMatrixType & matrix,
+                                                                                    VnlVectorType &       result)
+{
+  /** The matrix is stored row by row. Instead of computing every element of
+   * the result by a strided pass over a column, the rows are added to the
+   * result in a single contiguous pass over the matrix.
+   */
+  const unsigned int numberOfRows = matrix.rows();
+  const unsigned int numberOfColumns = matrix.cols();
+
+  result.set_size(numberOfColumns);
+  result.fill(0.0);
+  CoordRepType * const resultData = result.data_block();
+
+  for (unsigned int i = 0; i < numberOfRows; ++i)
+  {
+    const CoordRepType         factor = vector[i];
+    const CoordRepType * const row = matrix[i];
+    for (unsigned int j = 0; j < numberOfColumns; ++j)
+    {
+      resultData[j] += factor * row[j];
+    }
+  }
+
+} // end MultiplyVectorMatrix()
+
+
 /**
  * ******************* CalculateCutOffValue *******************
  */
@@ -24,6 +24,7 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkExtractImageFilter.h"
+#include "vnl/vnl_matrix.h"
 
 namespace itk
 {
@@ -108,12 +109,25 @@ public:
   void
   GetDerivative(const TransformParametersType & parameters, DerivativeType & derivative) const override;
 
-  /** Get value and derivatives for multiple valued optimizers. */
+  /** Get value and derivatives for multiple valued optimizers.
+   * When multi-threading is switched on, the intensities of the samples at all
+   * last dimension positions are gathered by the threads first. The points of
+   * a block of samples are then mapped by a single call to the transform, ordered
+   * by position, so that a stack transform evaluates each of its sub transforms for
+   * the whole block at once. After the correlation matrix has been computed, the
+   * derivative terms of the samples are computed by the threads in the same way.
+   */
   void
   GetValueAndDerivative(const TransformParametersType & parameters,
                         MeasureType &                   Value,
                         DerivativeType &                Derivative) const override;
 
+  /** Get value and derivatives, single-threaded. */
+  void
+  GetValueAndDerivativeSingleThreaded(const TransformParametersType & parameters,
+                                      MeasureType &                   value,
+                                      DerivativeType &                derivative) const;
+
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    * \li Call the superclass' implementation.   */
@@ -142,6 +156,7 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::ThreadInfoType                      ThreadInfoType;
 
   /** Computes the innerproduct of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -151,6 +166,10 @@ protected:
                                         const MovingImageDerivativeType & movingImageDerivative,
                                         DerivativeType &                  imageJacobian) const override;
 
+  /** Get the derivative terms of the valid samples for each thread. */
+  inline void
+  ThreadedGetValueAndDerivative(ThreadIdType threadID) override;
+
 private:
   SumOfPairwiseCorrelationCoefficientsMetric(const Self &) = delete;
   void
@@ -160,6 +179,24 @@ private:
   void
   SampleRandom(const int n, const int m, std::vector<int> & numbers) const;
 
+  /** Subtract the mean over the last dimension from the derivative, see SetSubtractMean(). */
+  void
+  SubtractMeanFromDerivative(DerivativeType & derivative) const;
+
+  /** The threader callback that gathers the intensities of the samples. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  GatherSamplesThreaderCallback(void * arg);
+
+  /** Gather the intensities of the samples of a thread at all last dimension positions. */
+  void
+  ThreadedGatherSamples(const ThreadIdType threadId, const ThreadIdType numberOfThreads) const;
+
+  /** The points and intensities of the samples at all last dimension positions are
+   * computed in blocks of samples. Returns the number of samples per block.
+   */
+  unsigned int
+  GetNumberOfSamplesPerBlock(void) const;
+
   /** Variables to control random sampling in last dimension. */
   unsigned int m_NumAdditionalSamplesFixed;
   unsigned int m_ReducedDimensionIndex;
@@ -172,6 +209,15 @@ private:
 
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform{ true };
+
+  /** The intensities of all samples at all last dimension positions, whether all of
+   * them are valid, the indices of the valid samples, and the coefficients of their
+   * derivative terms, used by the multi-threaded GetValueAndDerivative().
+   */
+  mutable vnl_matrix<RealType>       m_DataBlock;
+  mutable std::vector<unsigned char> m_SampleIsValid;
+  mutable std::vector<SizeValueType> m_ValidSampleIndices;
+  mutable vnl_matrix<RealType>       m_DerivativeCoefficients;
 };
 
 } // end namespace itk
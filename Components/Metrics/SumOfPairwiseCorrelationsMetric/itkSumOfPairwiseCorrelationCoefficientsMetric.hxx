@@ -23,6 +23,7 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "vnl/algo/vnl_matrix_update.h"
 #include "itkImage.h"
+#include <algorithm>
 #include <numeric>
 
 namespace itk
@@ -303,12 +304,12 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetDeriva
 
 
 /**
- * ******************* GetValueAndDerivative *******************
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(
   const TransformParametersType & parameters,
   MeasureType &                   value,
   DerivativeType &                derivative) const
@@ -534,77 +535,441 @@ SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueA
   /** Subtract mean from derivative elements. */
   if (this->m_SubtractMean)
   {
-    if (!this->m_TransformIsStackTransform)
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+  /** Return the measure value. */
+  value = measure;
+
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  /** Option for now to still use the single threaded code. */
+  if (!this->m_UseMultiThread)
+  {
+    return this->GetValueAndDerivativeSingleThreaded(parameters, value, derivative);
+  }
+
+  itkDebugMacro("GetValueAndDerivative( " << parameters << " ) ");
+
+  /** Define derivative and Jacobian types. */
+  typedef typename DerivativeType::ValueType DerivativeValueType;
+  typedef vnl_matrix<RealType>               MatrixType;
+  typedef vnl_matrix<DerivativeValueType>    DerivativeMatrixType;
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Gather the intensities of all samples with the threads. */
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  this->m_DataBlock.set_size(numberOfSamples, G);
+  this->m_SampleIsValid.assign(numberOfSamples, 0);
+  this->LaunchThreaderCallback(this->GatherSamplesThreaderCallback, const_cast<Self *>(this));
+
+  /** Collect the samples that are valid at all last dimension positions. */
+  this->m_ValidSampleIndices.clear();
+  for (SizeValueType i = 0; i < numberOfSamples; ++i)
+  {
+    if (this->m_SampleIsValid[i])
+    {
+      this->m_ValidSampleIndices.push_back(i);
+    }
+  }
+  this->m_NumberOfPixelsCounted = this->m_ValidSampleIndices.size();
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(numberOfSamples, this->m_NumberOfPixelsCounted);
+  const unsigned int N = this->m_NumberOfPixelsCounted;
+
+  MatrixType A(N, G);
+  for (unsigned int i = 0; i < N; ++i)
+  {
+    A.set_row(i, this->m_DataBlock.get_row(this->m_ValidSampleIndices[i]));
+  }
+
+  /** Calculate mean of from columns */
+  vnl_vector<RealType> mean(G);
+  mean.fill(NumericTraits<RealType>::Zero);
+  for (unsigned int i = 0; i < N; ++i)
+  {
+    for (unsigned int j = 0; j < G; ++j)
+    {
+      mean(j) += A(i, j);
+    }
+  }
+  mean /= RealType(N);
+
+  MatrixType Amm(N, G);
+  for (unsigned int i = 0; i < N; ++i)
+  {
+    for (unsigned int j = 0; j < G; ++j)
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-       * per dimension xyz.
-       */
-      const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
-      const unsigned int numParametersPerDimension =
-        this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean(numControlPointsPerDimension);
-      for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+      Amm(i, j) = A(i, j) - mean(j);
+    }
+  }
+
+  MatrixType Atmm = Amm.transpose();
+
+  MatrixType C(Atmm * Amm);
+  C /= static_cast<RealType>(RealType(N) - 1.0);
+
+  vnl_diag_matrix<RealType> S(G);
+  S.fill(NumericTraits<RealType>::Zero);
+  for (unsigned int j = 0; j < G; ++j)
+  {
+    S(j, j) = 1.0 / sqrt(C(j, j));
+  }
+
+  DerivativeMatrixType K(S * C * S);
+
+  /** Sub components of metric derivative */
+  vnl_diag_matrix<DerivativeValueType> dSdmu_part1(G);
+  for (unsigned int d = 0; d < G; ++d)
+  {
+    double S_sqr = S(d, d) * S(d, d);
+    double S_qub = S_sqr * S(d, d);
+    dSdmu_part1(d, d) = -S_qub / (DerivativeValueType(N) - 1.0);
+  }
+
+  DerivativeMatrixType KAtZscore(K * (Amm * S).transpose());
+  DerivativeMatrixType KAtZscoreAmm(KAtZscore * Amm);
+
+  /** The derivative is the sum over the valid samples i and positions d of
+   * the coefficient (d,i) times dM(T(x_i,d))/dmu.
+   */
+  this->m_DerivativeCoefficients.set_size(G, N);
+  for (unsigned int d = 0; d < G; ++d)
+  {
+    for (unsigned int i = 0; i < N; ++i)
+    {
+      this->m_DerivativeCoefficients(d, i) =
+        KAtZscore(d, i) * S(d, d) + dSdmu_part1(d, d) * Atmm(d, i) * KAtZscoreAmm(d, d);
+    }
+  }
+
+  /** Compute the derivative terms of the valid samples with the threads. */
+  this->InitializeSampleScheduler(N);
+  this->LaunchThreaderCallback(this->GetValueAndDerivativeThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+  this->FinalizeSampleScheduler();
+
+  /** Accumulate and normalize the derivatives of the threads. */
+  const DerivativeValueType normalization =
+    -(static_cast<DerivativeValueType>(N) - 1.0) * K.fro_norm() * RealType(G) / 2.0;
+  derivative.SetSize(this->GetNumberOfParameters());
+  this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = normalization;
+  this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+  /** Subtract mean from derivative elements. */
+  if (this->m_SubtractMean)
+  {
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+  /** Return the measure value. */
+  value = RealType(1.0 - (K.fro_norm() / RealType(G)));
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* GetNumberOfSamplesPerBlock *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+unsigned int
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GetNumberOfSamplesPerBlock(void) const
+{
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+  const unsigned int batchSize = Superclass::SampleBatchSize;
+  return std::max(1u, batchSize / std::max(1u, G));
+
+} // end GetNumberOfSamplesPerBlock()
+
+
+/**
+ * ******************* GatherSamplesThreaderCallback *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::GatherSamplesThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  const Self * metric = static_cast<const Self *>(infoStruct->UserData);
+  metric->ThreadedGatherSamples(threadID, nrOfThreads);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GatherSamplesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedGatherSamples *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::ThreadedGatherSamples(
+  const ThreadIdType threadId,
+  const ThreadIdType numberOfThreads) const
+{
+  /** Get a handle to the sample container, and the range of samples of this thread. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  const SizeValueType         numberOfSamples = sampleContainer->Size();
+  const SizeValueType         samplesPerThread = (numberOfSamples + numberOfThreads - 1) / numberOfThreads;
+  const SizeValueType         begin = std::min<SizeValueType>(threadId * samplesPerThread, numberOfSamples);
+  const SizeValueType         end = std::min<SizeValueType>(begin + samplesPerThread, numberOfSamples);
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Buffers for the points of a block. The points of sample b at position d are
+   * stored at d * blockSize + b, such that points at the same position are adjacent.
+   */
+  const unsigned int                samplesPerBlock = this->GetNumberOfSamplesPerBlock();
+  std::vector<FixedImagePointType>  fixedPoints(samplesPerBlock * G);
+  std::vector<MovingImagePointType> mappedPoints(samplesPerBlock * G);
+
+  for (SizeValueType blockBegin = begin; blockBegin < end; blockBegin += samplesPerBlock)
+  {
+    const unsigned int blockSize =
+      static_cast<unsigned int>(std::min<SizeValueType>(samplesPerBlock, end - blockBegin));
+
+    /** Compute the fixed points at all last dimension positions, and map them at once. */
+    for (unsigned int b = 0; b < blockSize; ++b)
+    {
+      FixedImagePointType           fixedPoint = sampleContainer->ElementAt(blockBegin + b).m_ImageCoordinates;
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex(fixedPoint, voxelCoord);
+      for (unsigned int d = 0; d < G; ++d)
       {
-        /** Compute mean per dimension. */
-        mean.Fill(0.0);
-        const unsigned int starti = numParametersPerDimension * d;
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[index] += derivative[i];
-        }
-        mean /= static_cast<double>(lastDimGridSize);
+        voxelCoord[lastDim] = d;
+        this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoints[d * blockSize + b]);
+      }
+    }
+    this->TransformPoints(fixedPoints.data(), mappedPoints.data(), blockSize * G);
 
-        /** Update derivative for every control point per dimension. */
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+    /** Store the intensities; a sample is only used when all of them are valid. */
+    for (unsigned int b = 0; b < blockSize; ++b)
+    {
+      RealType *   row = this->m_DataBlock[blockBegin + b];
+      unsigned int numSamplesOk = 0;
+      for (unsigned int d = 0; d < G; ++d)
+      {
+        const MovingImagePointType & mappedPoint = mappedPoints[d * blockSize + b];
+        RealType                     movingImageValue;
+        if (this->IsInsideMovingMask(mappedPoint) &&
+            this->EvaluateMovingImageValueAndDerivative(mappedPoint, movingImageValue, nullptr))
         {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[i] -= mean[index];
+          row[d] = movingImageValue;
+          ++numSamplesOk;
         }
       }
+      this->m_SampleIsValid[blockBegin + b] = (numSamplesOk == G);
     }
-    else
+  }
+
+} // end ThreadedGatherSamples()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(
+  ThreadIdType threadId)
+{
+  typedef typename Superclass::AdvancedTransformType::MovingImageGradientType MovingImageGradientType;
+
+  /** Get a handle to the pre-allocated derivative for the current thread. */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int G = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Buffers for the points of a block, see ThreadedGatherSamples(). */
+  const unsigned int                      samplesPerBlock = this->GetNumberOfSamplesPerBlock();
+  const unsigned int                      pointsPerBlock = samplesPerBlock * G;
+  const unsigned int                      nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  std::vector<FixedImagePointType>        fixedPoints(pointsPerBlock);
+  std::vector<MovingImagePointType>       mappedPoints(pointsPerBlock);
+  std::vector<MovingImageGradientType>    movingImageDerivatives(pointsPerBlock);
+  std::vector<DerivativeType>             imageJacobians(pointsPerBlock, DerivativeType(nnzji));
+  std::vector<NonZeroJacobianIndicesType> nzjis(pointsPerBlock, NonZeroJacobianIndicesType(nnzji));
+
+  /** Process the ranges of valid samples that are assigned to this thread. */
+  SizeValueType rangeBegin = 0;
+  SizeValueType rangeEnd = 0;
+  while (this->GetNextSampleRange(threadId, rangeBegin, rangeEnd))
+  {
+    for (SizeValueType blockBegin = rangeBegin; blockBegin < rangeEnd; blockBegin += samplesPerBlock)
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-       * the number the time point index.
-       */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / G;
-      DerivativeType     mean(numParametersPerLastDimension);
-      mean.Fill(0.0);
+      const unsigned int blockSize =
+        static_cast<unsigned int>(std::min<SizeValueType>(samplesPerBlock, rangeEnd - blockBegin));
+      const unsigned int numberOfPoints = blockSize * G;
 
-      /** Compute mean per control point. */
-      for (unsigned int t = 0; t < G; ++t)
+      /** Compute the fixed points at all last dimension positions, and map them at once. */
+      for (unsigned int b = 0; b < blockSize; ++b)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        const SizeValueType           sampleIndex = this->m_ValidSampleIndices[blockBegin + b];
+        FixedImagePointType           fixedPoint = sampleContainer->ElementAt(sampleIndex).m_ImageCoordinates;
+        FixedImageContinuousIndexType voxelCoord;
+        this->GetFixedImage()->TransformPhysicalPointToContinuousIndex(fixedPoint, voxelCoord);
+        for (unsigned int d = 0; d < G; ++d)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[index] += derivative[c];
+          voxelCoord[lastDim] = d;
+          this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoints[d * blockSize + b]);
         }
       }
-      mean /= static_cast<double>(G);
+      this->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPoints);
 
-      /** Update derivative per control point. */
-      for (unsigned int t = 0; t < G; ++t)
+      /** Evaluate the moving image derivatives; all points are valid. */
+      for (unsigned int p = 0; p < numberOfPoints; ++p)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        RealType                  movingImageValue;
+        MovingImageDerivativeType movingImageDerivative;
+        this->EvaluateMovingImageValueAndDerivative(mappedPoints[p], movingImageValue, &movingImageDerivative);
+        movingImageDerivatives[p] = movingImageDerivative;
+      }
+
+      /** Compute the inner products of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProducts(
+        fixedPoints.data(), movingImageDerivatives.data(), imageJacobians.data(), nzjis.data(), numberOfPoints);
+
+      /** Add the derivative terms. */
+      for (unsigned int d = 0; d < G; ++d)
+      {
+        for (unsigned int b = 0; b < blockSize; ++b)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[c] -= mean[index];
+          const unsigned int                 p = d * blockSize + b;
+          const RealType                     coefficient = this->m_DerivativeCoefficients(d, blockBegin + b);
+          const DerivativeType &             imageJacobian = imageJacobians[p];
+          const NonZeroJacobianIndicesType & nzji = nzjis[p];
+          for (unsigned int j = 0; j < nzji.size(); ++j)
+          {
+            derivative[nzji[j]] += coefficient * imageJacobian[j];
+          }
+          this->MarkTouchedDerivativeBlocks(threadId, nzji);
         }
       }
+    } // end for loop over the blocks
+  }   // end while over the sample ranges
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumOfPairwiseCorrelationCoefficientsMetric<TFixedImage, TMovingImage>::SubtractMeanFromDerivative(
+  DerivativeType & derivative) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  if (!this->m_TransformIsStackTransform)
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
+    const unsigned int numParametersPerDimension =
+      this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean(numControlPointsPerDimension);
+    for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+    {
+      /** Compute mean per dimension. */
+      mean.Fill(0.0);
+      const unsigned int starti = numParametersPerDimension * d;
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[index] += derivative[i];
+      }
+      mean /= static_cast<double>(lastDimGridSize);
+
+      /** Update derivative for every control point per dimension. */
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[i] -= mean[index];
+      }
     }
   }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
+    DerivativeType     mean(numParametersPerLastDimension);
+    mean.Fill(0.0);
+
+    /** Compute mean per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[index] += derivative[c];
+      }
+    }
+    mean /= static_cast<double>(lastDimSize);
 
-  /** Return the measure value. */
-  value = measure;
-
-} // end GetValueAndDerivative()
+    /** Update derivative per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[c] -= mean[index];
+      }
+    }
+  }
 
+} // end SubtractMeanFromDerivative()
 
 } // end namespace itk
 
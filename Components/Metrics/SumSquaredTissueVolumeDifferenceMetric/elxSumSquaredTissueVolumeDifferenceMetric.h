@@ -41,6 +41,11 @@ namespace elastix
  * \parameter TissueValue: Intensity value of tissue. \n
  *    example: <tt>(TissueValue 55.0)</tt> \n
  *    Default is 55.0.
+ * \parameter UseFusedDeterminantDerivative: Whether a cubic RecursiveBSplineTransform computes
+ *    the determinant of the spatial Jacobian and its derivative in one pass over the B-spline
+ *    weights. Only used without a composed initial transform. Can be given for each resolution.\n
+ *    example: <tt>(UseFusedDeterminantDerivative "false")</tt>\n
+ *    Default: true.
  *
  * \sa SumSquaredTissueVolumeDifferenceImageToImageMetric
  * \ingroup Metrics
@@ -141,6 +146,7 @@ public:
    * Do some things before each resolution:
    * \li Set AirValue setting
    * \li Set TissueValue setting
+   * \li Set UseFusedDeterminantDerivative setting
    */
   void
   BeforeEachResolution(void) override;
@@ -63,6 +63,12 @@ SumSquaredTissueVolumeDifferenceMetric<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(TissueValue, "TissueValue", this->GetComponentLabel(), level, 0);
   this->SetTissueValue(TissueValue);
 
+  /** Set whether the recursive B-spline transform computes the determinant derivative. */
+  bool useFusedDeterminantDerivative = true;
+  this->GetConfiguration()->ReadParameter(
+    useFusedDeterminantDerivative, "UseFusedDeterminantDerivative", this->GetComponentLabel(), level, 0);
+  this->SetUseFusedDeterminantDerivative(useFusedDeterminantDerivative);
+
 } // end BeforeEachResolution()
 
 
@@ -19,6 +19,7 @@
 #define itkSumSquaredTissueVolumeDifferenceImageToImageMetric_h
 
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkRecursiveBSplineTransform.h"
 
 namespace itk
 {
@@ -44,6 +45,10 @@ namespace itk
  * \li Image derivatives are computed using either the B-spline interpolator's implementation
  * or by nearest neighbor interpolation of a precomputed central difference image.
  * \li A minimum number of samples that should map within the moving image (mask) can be specified.
+ * \li By default, for a cubic RecursiveBSplineTransform without initial transform, the determinant
+ * of the spatial Jacobian and its derivative to the parameters are computed in one pass over the
+ * B-spline weights, see RecursiveBSplineTransform::GetSpatialJacobianAndJacobianOfLogDeterminant()
+ * and SetUseFusedDeterminantDerivative().
  *
  * References:\n
  * [1] Yin, Y., Hoffman, E. A., & Lin, C. L. (2009).
@@ -115,12 +120,14 @@ public:
   typedef typename Superclass::MovingImageDerivativeScalesType MovingImageDerivativeScalesType;
 
   /** Typedefs from the AdvancedTransform. */
-  typedef typename Superclass::AdvancedTransformType            TransformType;
-  typedef typename TransformType::SpatialJacobianType           SpatialJacobianType;
-  typedef typename TransformType::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
-  typedef typename TransformType::SpatialHessianType            SpatialHessianType;
-  typedef typename TransformType::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
-  typedef typename TransformType::InternalMatrixType            InternalMatrixType;
+  typedef typename Superclass::AdvancedTransformType                     TransformType;
+  typedef typename TransformType::SpatialJacobianType                    SpatialJacobianType;
+  typedef typename TransformType::JacobianOfSpatialJacobianType          JacobianOfSpatialJacobianType;
+  typedef typename TransformType::SpatialHessianType                     SpatialHessianType;
+  typedef typename TransformType::JacobianOfSpatialHessianType           JacobianOfSpatialHessianType;
+  typedef typename TransformType::SeparableJacobianOfSpatialJacobianType SeparableJacobianOfSpatialJacobianType;
+  typedef typename TransformType::SeparableJacobianOfSpatialHessianType  SeparableJacobianOfSpatialHessianType;
+  typedef typename TransformType::InternalMatrixType                     InternalMatrixType;
 
   /** The fixed image dimension. */
   itkStaticConstMacro(FixedImageDimension, unsigned int, FixedImageType::ImageDimension);
@@ -151,6 +158,12 @@ public:
                                       MeasureType &                   measure,
                                       DerivativeType &                derivative) const;
 
+  /** Initialize the Metric, and check whether the determinant derivative
+   * can be computed by the recursive B-spline transform.
+   */
+  void
+  Initialize(void) override;
+
   /** Set/get the air intensity value */
   itkSetMacro(AirValue, RealType);
   itkGetMacro(AirValue, RealType);
@@ -159,6 +172,13 @@ public:
   itkSetMacro(TissueValue, RealType);
   itkGetMacro(TissueValue, RealType);
 
+  /** Select the fused computation of the determinant derivative by a cubic
+   * RecursiveBSplineTransform, when possible. Takes effect at the next Initialize().
+   * Default: true. */
+  itkSetMacro(UseFusedDeterminantDerivative, bool);
+  itkGetConstMacro(UseFusedDeterminantDerivative, bool);
+  itkBooleanMacro(UseFusedDeterminantDerivative);
+
 protected:
   SumSquaredTissueVolumeDifferenceImageToImageMetric();
   ~SumSquaredTissueVolumeDifferenceImageToImageMetric() override = default;
@@ -179,6 +199,11 @@ protected:
   typedef typename Superclass::CentralDifferenceGradientFilterType CentralDifferenceGradientFilterType;
   typedef typename Superclass::MovingImageDerivativeType           MovingImageDerivativeType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::CombinationTransformType            CombinationTransformType;
+
+  /** Typedef for the transform that supports the fused determinant derivative. */
+  typedef typename Superclass::ScalarType                                     ScalarType;
+  typedef RecursiveBSplineTransform<ScalarType, Self::FixedImageDimension, 3> RecursiveBSplineTransformType;
 
   /** Computes the inner product of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
@@ -222,6 +247,15 @@ protected:
     const SpatialJacobianType &           inverseSpatialJacobian,
     DerivativeType &                      jacobianOfSpatialJacobianDeterminant) const;
 
+  /** Compute the same dot products as above, from the separable form of the
+   * Jacobian of SpatialJacobian, see AdvancedTransform::GetSeparableJacobianOfSpatialJacobian().
+   */
+  void
+  EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+    const SeparableJacobianOfSpatialJacobianType & separableJacobianOfSpatialJacobian,
+    const SpatialJacobianType &                    inverseSpatialJacobian,
+    DerivativeType &                               jacobianOfSpatialJacobianDeterminant) const;
+
   /** Get value for each thread. */
   inline void
   ThreadedGetValue(ThreadIdType threadID) override;
@@ -249,6 +283,12 @@ private:
   /** Intensity value to use for tissue.  Default is 55 */
   RealType m_TissueValue;
 
+  /** Whether the recursive B-spline transform may compute the determinant derivative. Default is false */
+  bool m_UseFusedDeterminantDerivative{ true };
+
+  /** The recursive B-spline transform that computes the determinant derivative, if any. */
+  const RecursiveBSplineTransformType * m_RecursiveBSplineTransform{ nullptr };
+
 }; // end class SumSquaredTissueVolumeDifferenceImageToImageMetric
 
 } // end namespace itk
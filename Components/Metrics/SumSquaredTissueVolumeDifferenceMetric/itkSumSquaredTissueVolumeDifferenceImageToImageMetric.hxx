@@ -20,10 +20,7 @@
 
 #include "itkSumSquaredTissueVolumeDifferenceImageToImageMetric.h"
 #include "vnl/algo/vnl_matrix_update.h"
-
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
+#include "vnl/vnl_inverse.h"
 
 namespace itk
 {
@@ -57,10 +54,45 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::P
 
   os << indent << "AirValue: " << this->m_AirValue << std::endl;
   os << indent << "TissueValue: " << this->m_TissueValue << std::endl;
+  os << indent << "UseFusedDeterminantDerivative: " << this->m_UseFusedDeterminantDerivative << std::endl;
 
 } // end PrintSelf()
 
 
+/**
+ * ******************* Initialize *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
+{
+  /** Initialize the superclass. */
+  this->Superclass::Initialize();
+
+  /** The fused determinant derivative needs the spatial Jacobian of the
+   * recursive B-spline transform itself, so no initial transform is allowed.
+   */
+  this->m_RecursiveBSplineTransform = nullptr;
+  if (!this->m_UseFusedDeterminantDerivative)
+  {
+    return;
+  }
+  const TransformType *            transform = this->m_AdvancedTransform.GetPointer();
+  const CombinationTransformType * combination = dynamic_cast<const CombinationTransformType *>(transform);
+  if (combination != nullptr)
+  {
+    if (combination->GetInitialTransform() != nullptr)
+    {
+      return;
+    }
+    transform = combination->GetCurrentTransform();
+  }
+  this->m_RecursiveBSplineTransform = dynamic_cast<const RecursiveBSplineTransformType *>(transform);
+
+} // end Initialize()
+
+
 /**
  * ******************* GetValueSingleThreaded *******************
  */
@@ -374,8 +406,9 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::G
   /** Matrix to store the scaled inverse spatial Jacobian, det(dT/dx) * (dT/dx)^-1 */
   SpatialJacobianType inverseSpatialJacobian;
 
-  /** Array that stores JacobianOfSpatialJacobian, d(dT/dx)/dmu */
-  JacobianOfSpatialJacobianType jacobianOfSpatialJacobian;
+  /** Array that stores JacobianOfSpatialJacobian, d(dT/dx)/dmu, in dense or in separable form. */
+  JacobianOfSpatialJacobianType          jacobianOfSpatialJacobian;
+  SeparableJacobianOfSpatialJacobianType separableJacobianOfSpatialJacobian;
 
   DerivativeType jacobianOfSpatialJacobianDeterminant(nzji.size());
 
@@ -430,22 +463,59 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::G
       /** Compute the inner products (dM/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
 
-      /** Get the SpatialJacobian dT/dx. */
-      this->m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
-
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
-
-      /** Compute the inverse spatialJacobian. */
-      inverseSpatialJacobian = spatialJac.GetInverse();
-
-      /** Compute the JacobianOfSpatialJacobian. */
-      this->m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
-
-      /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
-       * to support calculation of the JacobianOfSpatialJacobianDeterminant. */
-      this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
-        jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+      /** Get the SpatialJacobian dT/dx, its determinant |dT/dx|, and the derivative
+       * of the determinant, divided by the determinant. The recursive B-spline
+       * transform computes all of them from one evaluation of the B-spline weights.
+       */
+      RealType detjac;
+      if (this->m_RecursiveBSplineTransform != nullptr)
+      {
+        double det = 1.0;
+        if (!this->m_RecursiveBSplineTransform->GetSpatialJacobianAndJacobianOfLogDeterminant(
+              fixedPoint, spatialJac, det, jacobianOfSpatialJacobianDeterminant))
+        {
+          itkExceptionMacro(<< "Singular spatial Jacobian. Determinant is 0.");
+        }
+        detjac = static_cast<RealType>(det);
+      }
+      else
+      {
+        /** Get the spatial Jacobian and, when the transform provides it, the separable
+         * form of the JacobianOfSpatialJacobian, which a B-spline transform computes
+         * from the same derivative weights.
+         */
+        const bool isSeparable = this->m_AdvancedTransform->GetSeparableJacobianOfSpatialJacobian(
+          fixedPoint, spatialJac, separableJacobianOfSpatialJacobian, nzji);
+        if (!isSeparable)
+        {
+          this->m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
+        }
+
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
+
+        /** Compute the inverse spatialJacobian. */
+        if (!this->EvaluateInverseSpatialJacobian(spatialJac, detjac, inverseSpatialJacobian))
+        {
+          itkExceptionMacro(<< "Singular spatial Jacobian. Determinant is 0.");
+        }
+
+        if (isSeparable)
+        {
+          this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+            separableJacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+        }
+        else
+        {
+          /** Compute the JacobianOfSpatialJacobian. */
+          this->m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
+
+          /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
+           * to support calculation of the JacobianOfSpatialJacobianDeterminant. */
+          this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+            jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+        }
+      }
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(fixedImageValue,
@@ -533,8 +603,9 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::T
   /** Matrix to store the scaled inverse spatial Jacobian, det(dT/dx) * (dT/dx)^-1 */
   SpatialJacobianType inverseSpatialJacobian;
 
-  /** Array that stores JacobianOfSpatialJacobian, d(dT/dx)/dmu */
-  JacobianOfSpatialJacobianType jacobianOfSpatialJacobian;
+  /** Array that stores JacobianOfSpatialJacobian, d(dT/dx)/dmu, in dense or in separable form. */
+  JacobianOfSpatialJacobianType          jacobianOfSpatialJacobian;
+  SeparableJacobianOfSpatialJacobianType separableJacobianOfSpatialJacobian;
 
   DerivativeType jacobianOfSpatialJacobianDeterminant(nzji.size());
 
@@ -597,23 +668,60 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::T
       /** Compute the inner products (dM/dx)^T (dT/dmu). */
       this->EvaluateTransformJacobianInnerProduct(jacobian, movingImageDerivative, imageJacobian);
 
-      /** Get the SpatialJacobian dT/dx. */
-      this->m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
-
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
-
-      /** Compute the inverse spatialJacobian. */
-      inverseSpatialJacobian = spatialJac.GetInverse();
-
-      /** Compute the JacobianOfSpatialJacobian. */
-      this->m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
-
-      /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
-       * to support calculation of the JacobianOfSpatialJacobianDeterminant.
+      /** Get the SpatialJacobian dT/dx, its determinant |dT/dx|, and the derivative
+       * of the determinant, divided by the determinant. The recursive B-spline
+       * transform computes all of them from one evaluation of the B-spline weights.
        */
-      this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
-        jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+      RealType detjac;
+      if (this->m_RecursiveBSplineTransform != nullptr)
+      {
+        double det = 1.0;
+        if (!this->m_RecursiveBSplineTransform->GetSpatialJacobianAndJacobianOfLogDeterminant(
+              fixedPoint, spatialJac, det, jacobianOfSpatialJacobianDeterminant))
+        {
+          itkExceptionMacro(<< "Singular spatial Jacobian. Determinant is 0.");
+        }
+        detjac = static_cast<RealType>(det);
+      }
+      else
+      {
+        /** Get the spatial Jacobian and, when the transform provides it, the separable
+         * form of the JacobianOfSpatialJacobian, which a B-spline transform computes
+         * from the same derivative weights.
+         */
+        const bool isSeparable = this->m_AdvancedTransform->GetSeparableJacobianOfSpatialJacobian(
+          fixedPoint, spatialJac, separableJacobianOfSpatialJacobian, nzji);
+        if (!isSeparable)
+        {
+          this->m_AdvancedTransform->GetSpatialJacobian(fixedPoint, spatialJac);
+        }
+
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        detjac = static_cast<RealType>(vnl_det(spatialJac.GetVnlMatrix()));
+
+        /** Compute the inverse spatialJacobian. */
+        if (!this->EvaluateInverseSpatialJacobian(spatialJac, detjac, inverseSpatialJacobian))
+        {
+          itkExceptionMacro(<< "Singular spatial Jacobian. Determinant is 0.");
+        }
+
+        if (isSeparable)
+        {
+          this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+            separableJacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+        }
+        else
+        {
+          /** Compute the JacobianOfSpatialJacobian. */
+          this->m_AdvancedTransform->GetJacobianOfSpatialJacobian(fixedPoint, jacobianOfSpatialJacobian, nzji);
+
+          /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
+           * to support calculation of the JacobianOfSpatialJacobianDeterminant.
+           */
+          this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+            jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant);
+        }
+      }
 
       /** Compute this pixel's contribution to the measure and derivatives. */
       this->UpdateValueAndDerivativeTerms(fixedImageValue,
@@ -685,36 +793,16 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::A
     derivative /= static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
   }
   // compute multi-threadedly with itk threads
-  else if (true) // force ITK threads !this->m_UseOpenMP )
+  else
   {
     this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
     this->m_ThreaderMetricParameters.st_NormalizationFactor =
       static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
 
-    this->m_Threader->SetSingleMethod(this->AccumulateDerivativesThreaderCallback,
-                                      const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
-    this->m_Threader->SingleMethodExecute();
+    this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                                 const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
   }
 
-#ifdef ELASTIX_USE_OPENMP
-  /** compute multi-threadedly with openmp.  Never used? */
-  else
-  {
-    const int spaceDimension = static_cast<int>(this->GetNumberOfParameters());
-
-#  pragma omp parallel for
-    for (int j = 0; j < spaceDimension; ++j)
-    {
-      DerivativeValueType tmp = NumericTraits<DerivativeValueType>::Zero;
-      for (ThreadIdType i = 0; i < numberOfThreads; ++i)
-      {
-        tmp += this->m_GetValueAndDerivativePerThreadVariables[i].st_Derivative[j];
-      }
-      derivative[j] = tmp / static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted);
-    }
-  }
-#endif
-
 } // end AfterThreadedGetValueAndDerivative()
 
 
@@ -817,8 +905,15 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::E
   const RealType              spatialJacobianDeterminant,
   SpatialJacobianType &       inverseSpatialJacobian) const
 {
-  inverseSpatialJacobian.Fill(0.0);
-  inverseSpatialJacobian = spatialJacobian.GetInverse();
+  if (spatialJacobianDeterminant == 0.0)
+  {
+    inverseSpatialJacobian.Fill(0.0);
+    return false;
+  }
+
+  /** Use the closed-form inverse of the fixed-size matrix, which, unlike
+   * Matrix::GetInverse(), does not allocate on the heap for every sample. */
+  inverseSpatialJacobian = vnl_inverse(spatialJacobian.GetVnlMatrix());
 
   return true;
 
@@ -864,6 +959,40 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::
 } // end EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct()
 
 
+/**
+ * ********** EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct ******
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>::
+  EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+    const SeparableJacobianOfSpatialJacobianType & separableJacobianOfSpatialJacobian,
+    const SpatialJacobianType &                    inverseSpatialJacobian,
+    DerivativeType &                               jacobianOfSpatialJacobianDeterminant) const
+{
+  /** Only row k of the dense jsj[ mu + k * n ] is nonzero, and equal to jsj[ mu ],
+   * so the trace of inverseSpatialJacobian * jsj[ mu + k * n ] reduces to the
+   * inner product of column k of inverseSpatialJacobian with jsj[ mu ].
+   */
+  const unsigned int numberOfWeights = separableJacobianOfSpatialJacobian.size();
+  for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+  {
+    const typename SeparableJacobianOfSpatialJacobianType::value_type & jsj = separableJacobianOfSpatialJacobian[mu];
+    for (unsigned int k = 0; k < FixedImageDimension; ++k)
+    {
+      double sum = 0.0;
+      for (unsigned int diag = 0; diag < FixedImageDimension; ++diag)
+      {
+        sum += inverseSpatialJacobian(diag, k) * jsj[diag];
+      }
+      jacobianOfSpatialJacobianDeterminant[mu + k * numberOfWeights] = sum;
+    }
+  }
+
+} // end EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct()
+
+
 } // end namespace itk
 
 #endif // end #ifndef _itkSumSquaredTissueVolumeDifferenceImageToImageMetric_hxx
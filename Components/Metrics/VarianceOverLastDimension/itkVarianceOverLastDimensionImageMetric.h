@@ -44,6 +44,12 @@ namespace itk
  * or by nearest neighbor interpolation of a precomputed central difference image.
  * \li A minimum number of samples that should map within the moving image (mask) can be specified.
  *
+ * When multi-threading is switched on, the value and derivative are computed in blocks
+ * of samples. The points of all last dimension positions of a block are mapped by a single
+ * call to the transform, ordered by position, so that a stack transform evaluates each of
+ * its sub transforms for the whole block at once. The intensities of each sample are then
+ * gathered in a contiguous buffer, from which the variance and its derivative are computed.
+ *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
  */
@@ -141,6 +147,12 @@ public:
                         MeasureType &                   Value,
                         DerivativeType &                Derivative) const override;
 
+  /** Get value and derivatives, single-threaded. */
+  void
+  GetValueAndDerivativeSingleThreaded(const TransformParametersType & parameters,
+                                      MeasureType &                   value,
+                                      DerivativeType &                derivative) const;
+
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    * \li Call the superclass' implementation.   */
@@ -177,6 +189,14 @@ protected:
                                         const MovingImageDerivativeType & movingImageDerivative,
                                         DerivativeType &                  imageJacobian) const override;
 
+  /** Get value and derivatives for each thread. */
+  inline void
+  ThreadedGetValueAndDerivative(ThreadIdType threadID) override;
+
+  /** Gather the values and derivatives from all threads. */
+  inline void
+  AfterThreadedGetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override;
+
 private:
   VarianceOverLastDimensionImageMetric(const Self &) = delete;
   void
@@ -186,6 +206,10 @@ private:
   void
   SampleRandom(const int n, const int m, std::vector<int> & numbers) const;
 
+  /** Subtract the mean over the last dimension from the derivative, see SetSubtractMean(). */
+  void
+  SubtractMeanFromDerivative(DerivativeType & derivative) const;
+
   /** Variables to control random sampling in last dimension. */
   bool         m_SampleLastDimensionRandomly{ false };
   unsigned int m_NumSamplesLastDimension{ 10 };
@@ -203,6 +227,12 @@ private:
 
   /** Bool to indicate if the transform used is a stacktransform. Set by elx files. */
   bool m_TransformIsStackTransform{ false };
+
+  /** The last dimension positions of all samples, drawn before the threads are
+   * launched, and the number of positions per sample.
+   */
+  mutable std::vector<int> m_LastDimPositions;
+  mutable unsigned int     m_NumberOfLastDimPositions{ 0 };
 };
 
 } // end namespace itk
@@ -21,6 +21,7 @@
 #include "itkVarianceOverLastDimensionImageMetric.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "vnl/algo/vnl_matrix_update.h"
+#include <algorithm>
 #include <numeric>
 
 namespace itk
@@ -345,12 +346,12 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetDerivative(
 
 
 /**
- * ******************* GetValueAndDerivative *******************
+ * ******************* GetValueAndDerivativeSingleThreaded *******************
  */
 
 template <class TFixedImage, class TMovingImage>
 void
-VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivativeSingleThreaded(
   const TransformParametersType & parameters,
   MeasureType &                   value,
   DerivativeType &                derivative) const
@@ -528,77 +529,367 @@ VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDeri
   /** Subtract mean from derivative elements. */
   if (this->m_SubtractMean)
   {
-    if (!this->m_TransformIsStackTransform)
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+  /** Return the measure value. */
+  value = measure;
+
+} // end GetValueAndDerivativeSingleThreaded()
+
+
+
+/**
+ * ******************* GetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
+  const TransformParametersType & parameters,
+  MeasureType &                   value,
+  DerivativeType &                derivative) const
+{
+  /** Option for now to still use the single threaded code. */
+  if (!this->m_UseMultiThread)
+  {
+    return this->GetValueAndDerivativeSingleThreaded(parameters, value, derivative);
+  }
+
+  /** Call non-thread-safe stuff, such as:
+   *   this->SetTransformParameters( parameters );
+   *   this->GetImageSampler()->Update();
+   */
+  this->BeforeThreadedGetValueAndDerivative(parameters);
+
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  /** Determine the last dimension positions of all samples. The random positions
+   * are drawn here, in the order of the samples, since the random generator is
+   * not thread-safe.
+   */
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  std::vector<int>    lastDimPositions;
+  if (!this->m_SampleLastDimensionRandomly)
+  {
+    this->m_NumberOfLastDimPositions = lastDimSize;
+    this->m_LastDimPositions.resize(numberOfSamples * lastDimSize);
+    for (SizeValueType i = 0; i < numberOfSamples; ++i)
     {
-      /** Update derivative per dimension.
-       * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
-       * per dimension xyz.
-       */
-      const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
-      const unsigned int numParametersPerDimension =
-        this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
-      const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
-      DerivativeType     mean(numControlPointsPerDimension);
-      for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+      std::iota(this->m_LastDimPositions.begin() + i * lastDimSize,
+                this->m_LastDimPositions.begin() + (i + 1) * lastDimSize,
+                0);
+    }
+  }
+  else
+  {
+    this->m_NumberOfLastDimPositions = this->m_NumSamplesLastDimension + this->m_NumAdditionalSamplesFixed;
+    this->m_LastDimPositions.resize(numberOfSamples * this->m_NumberOfLastDimPositions);
+    for (SizeValueType i = 0; i < numberOfSamples; ++i)
+    {
+      this->SampleRandom(this->m_NumSamplesLastDimension, lastDimSize, lastDimPositions);
+      std::copy(lastDimPositions.begin(),
+                lastDimPositions.end(),
+                this->m_LastDimPositions.begin() + i * this->m_NumberOfLastDimPositions);
+    }
+  }
+
+  /** Launch multi-threading metric */
+  this->LaunchGetValueAndDerivativeThreaderCallback();
+
+  /** Gather the metric values and derivatives from all threads. */
+  this->AfterThreadedGetValueAndDerivative(value, derivative);
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::ThreadedGetValueAndDerivative(ThreadIdType threadId)
+{
+  typedef typename Superclass::AdvancedTransformType::MovingImageGradientType MovingImageGradientType;
+
+  /** Get a handle to the pre-allocated derivative for the current thread. */
+  DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Derivative;
+
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Retrieve slowest varying dimension. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+
+  /** The samples are processed in blocks of about SampleBatchSize points. */
+  const unsigned int batchSize = Superclass::SampleBatchSize;
+  const unsigned int numberOfPositions = this->m_NumberOfLastDimPositions;
+  const unsigned int samplesPerBlock = std::max(1u, batchSize / std::max(1u, numberOfPositions));
+  const unsigned int pointsPerBlock = samplesPerBlock * numberOfPositions;
+
+  /** Buffers for the points of a block. The points of sample b at position d are
+   * stored at d * blockSize + b, such that points at the same position are adjacent.
+   */
+  const unsigned int                      nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  std::vector<FixedImagePointType>        fixedPoints(pointsPerBlock);
+  std::vector<MovingImagePointType>       mappedPoints(pointsPerBlock);
+  std::vector<RealType>                   movingImageValues(pointsPerBlock);
+  std::vector<int>                        validPointIndices(pointsPerBlock);
+  std::vector<FixedImagePointType>        validFixedPoints(pointsPerBlock);
+  std::vector<MovingImageGradientType>    validMovingImageDerivatives(pointsPerBlock);
+  std::vector<DerivativeType>             imageJacobians(pointsPerBlock, DerivativeType(nnzji));
+  std::vector<NonZeroJacobianIndicesType> nzjis(pointsPerBlock, NonZeroJacobianIndicesType(nnzji));
+
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+  MeasureType   measure = NumericTraits<MeasureType>::Zero;
+
+  SizeValueType rangeBegin = 0;
+  SizeValueType rangeEnd = 0;
+  while (this->GetNextSampleRange(threadId, rangeBegin, rangeEnd))
+  {
+    for (SizeValueType blockBegin = rangeBegin; blockBegin < rangeEnd; blockBegin += samplesPerBlock)
+    {
+      const unsigned int blockSize =
+        static_cast<unsigned int>(std::min<SizeValueType>(samplesPerBlock, rangeEnd - blockBegin));
+      const unsigned int numberOfPoints = blockSize * numberOfPositions;
+
+      /** Compute the fixed points at all last dimension positions of the samples. */
+      for (unsigned int b = 0; b < blockSize; ++b)
       {
-        /** Compute mean per dimension. */
-        mean.Fill(0.0);
-        const unsigned int starti = numParametersPerDimension * d;
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
-        {
-          const unsigned int index = i % numControlPointsPerDimension;
-          mean[index] += derivative[i];
-        }
-        mean /= static_cast<double>(lastDimGridSize);
+        FixedImagePointType fixedPoint;
+        RealType            fixedImageValue;
+        this->ReadFixedImageSample(*sampleContainer, blockBegin + b, fixedPoint, fixedImageValue);
+
+        FixedImageContinuousIndexType voxelCoord;
+        this->GetFixedImage()->TransformPhysicalPointToContinuousIndex(fixedPoint, voxelCoord);
 
-        /** Update derivative for every control point per dimension. */
-        for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+        const int * positions = &this->m_LastDimPositions[(blockBegin + b) * numberOfPositions];
+        for (unsigned int d = 0; d < numberOfPositions; ++d)
         {
-          const unsigned int index = i % numControlPointsPerDimension;
-          derivative[i] -= mean[index];
+          voxelCoord[lastDim] = positions[d];
+          this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint(voxelCoord, fixedPoints[d * blockSize + b]);
         }
       }
-    }
-    else
-    {
-      /** Update derivative per dimension.
-       * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
-       * the number the time point index.
-       */
-      const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
-      DerivativeType     mean(numParametersPerLastDimension);
-      mean.Fill(0.0);
 
-      /** Compute mean per control point. */
-      for (unsigned int t = 0; t < lastDimSize; ++t)
+      /** Map all points of the block at once. */
+      this->TransformPoints(fixedPoints.data(), mappedPoints.data(), numberOfPoints);
+
+      /** Evaluate the moving image, and collect the valid points. */
+      unsigned int numberOfValidPoints = 0;
+      for (unsigned int p = 0; p < numberOfPoints; ++p)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        MovingImageDerivativeType movingImageDerivative;
+        bool                      sampleOk = this->IsInsideMovingMask(mappedPoints[p]);
+        if (sampleOk)
+        {
+          sampleOk =
+            this->EvaluateMovingImageValueAndDerivative(mappedPoints[p], movingImageValues[p], &movingImageDerivative);
+        }
+
+        if (sampleOk)
+        {
+          validPointIndices[p] = numberOfValidPoints;
+          validFixedPoints[numberOfValidPoints] = fixedPoints[p];
+          validMovingImageDerivatives[numberOfValidPoints] = movingImageDerivative;
+          ++numberOfValidPoints;
+        }
+        else
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          mean[index] += derivative[c];
+          validPointIndices[p] = -1;
         }
       }
-      mean /= static_cast<double>(lastDimSize);
 
-      /** Update derivative per control point. */
-      for (unsigned int t = 0; t < lastDimSize; ++t)
+      /** Compute the inner products of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProducts(validFixedPoints.data(),
+                                                                           validMovingImageDerivatives.data(),
+                                                                           imageJacobians.data(),
+                                                                           nzjis.data(),
+                                                                           numberOfValidPoints);
+
+      /** Compute the variance of each sample, and its derivative. */
+      for (unsigned int b = 0; b < blockSize; ++b)
       {
-        const unsigned int startc = numParametersPerLastDimension * t;
-        for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+        unsigned int numSamplesOk = 0;
+        RealType     sumValues = 0.0;
+        RealType     sumValuesSquared = 0.0;
+        for (unsigned int d = 0; d < numberOfPositions; ++d)
+        {
+          const unsigned int p = d * blockSize + b;
+          if (validPointIndices[p] >= 0)
+          {
+            ++numSamplesOk;
+            sumValues += movingImageValues[p];
+            sumValuesSquared += movingImageValues[p] * movingImageValues[p];
+          }
+        }
+
+        if (numSamplesOk == 0)
         {
-          const unsigned int index = c % numParametersPerLastDimension;
-          derivative[c] -= mean[index];
+          continue;
+        }
+        ++numberOfPixelsCounted;
+
+        const RealType expectedValue = sumValues / static_cast<RealType>(numSamplesOk);
+        measure += sumValuesSquared / static_cast<RealType>(numSamplesOk) - expectedValue * expectedValue;
+
+        for (unsigned int d = 0; d < numberOfPositions; ++d)
+        {
+          const unsigned int p = d * blockSize + b;
+          if (validPointIndices[p] >= 0)
+          {
+            const DerivativeType &             imageJacobian = imageJacobians[validPointIndices[p]];
+            const NonZeroJacobianIndicesType & nzji = nzjis[validPointIndices[p]];
+            const RealType weight = 2.0 * (movingImageValues[p] - expectedValue) / static_cast<RealType>(numSamplesOk);
+            for (unsigned int j = 0; j < nzji.size(); ++j)
+            {
+              derivative[nzji[j]] += weight * imageJacobian[j];
+            }
+            this->MarkTouchedDerivativeBlocks(threadId, nzji);
+          }
         }
       }
-    }
+    } // end for loop over the blocks
+  }   // end while over the sample ranges
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+  this->m_GetValueAndDerivativePerThreadVariables[threadId].st_Value = measure;
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* AfterThreadedGetValueAndDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::AfterThreadedGetValueAndDerivative(
+  MeasureType &    value,
+  DerivativeType & derivative) const
+{
+  typedef typename DerivativeType::ValueType DerivativeValueType;
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Accumulate the number of pixels and the values, and reset them for the next iteration. */
+  this->m_NumberOfPixelsCounted = 0;
+  value = NumericTraits<MeasureType>::Zero;
+  for (ThreadIdType i = 0; i < numberOfThreads; ++i)
+  {
+    this->m_NumberOfPixelsCounted += this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted;
+    value += this->m_GetValueAndDerivativePerThreadVariables[i].st_Value;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_NumberOfPixelsCounted = 0;
+    this->m_GetValueAndDerivativePerThreadVariables[i].st_Value = NumericTraits<MeasureType>::Zero;
   }
 
-  /** Return the measure value. */
-  value = measure;
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples(this->GetImageSampler()->GetOutput()->Size(), this->m_NumberOfPixelsCounted);
 
-} // end GetValueAndDerivative()
+  /** Compute average over variances and normalize with initial variance. */
+  const DerivativeValueType normalization =
+    static_cast<DerivativeValueType>(this->m_NumberOfPixelsCounted) * this->m_InitialVariance;
+  value /= normalization;
+
+  /** Accumulate the derivatives of the threads. */
+  derivative.SetSize(this->GetNumberOfParameters());
+  this->m_ThreaderMetricParameters.st_DerivativePointer = derivative.begin();
+  this->m_ThreaderMetricParameters.st_NormalizationFactor = normalization;
+  this->LaunchThreaderCallback(this->AccumulateDerivativesThreaderCallback,
+                               const_cast<void *>(static_cast<const void *>(&this->m_ThreaderMetricParameters)));
+
+  /** Subtract mean from derivative elements. */
+  if (this->m_SubtractMean)
+  {
+    this->SubtractMeanFromDerivative(derivative);
+  }
+
+} // end AfterThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* SubtractMeanFromDerivative *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+VarianceOverLastDimensionImageMetric<TFixedImage, TMovingImage>::SubtractMeanFromDerivative(
+  DerivativeType & derivative) const
+{
+  /** Retrieve slowest varying dimension and its size. */
+  const unsigned int lastDim = this->GetFixedImage()->GetImageDimension() - 1;
+  const unsigned int lastDimSize = this->GetFixedImage()->GetLargestPossibleRegion().GetSize(lastDim);
+
+  if (!this->m_TransformIsStackTransform)
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered xxxxxxx yyyyyyy zzzzzzz ttttttt and
+     * per dimension xyz.
+     */
+    const unsigned int lastDimGridSize = this->m_GridSize[lastDim];
+    const unsigned int numParametersPerDimension =
+      this->GetNumberOfParameters() / this->GetMovingImage()->GetImageDimension();
+    const unsigned int numControlPointsPerDimension = numParametersPerDimension / lastDimGridSize;
+    DerivativeType     mean(numControlPointsPerDimension);
+    for (unsigned int d = 0; d < this->GetMovingImage()->GetImageDimension(); ++d)
+    {
+      /** Compute mean per dimension. */
+      mean.Fill(0.0);
+      const unsigned int starti = numParametersPerDimension * d;
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        mean[index] += derivative[i];
+      }
+      mean /= static_cast<double>(lastDimGridSize);
+
+      /** Update derivative for every control point per dimension. */
+      for (unsigned int i = starti; i < starti + numParametersPerDimension; ++i)
+      {
+        const unsigned int index = i % numControlPointsPerDimension;
+        derivative[i] -= mean[index];
+      }
+    }
+  }
+  else
+  {
+    /** Update derivative per dimension.
+     * Parameters are ordered x0x0x0y0y0y0z0z0z0x1x1x1y1y1y1z1z1z1 with
+     * the number the time point index.
+     */
+    const unsigned int numParametersPerLastDimension = this->GetNumberOfParameters() / lastDimSize;
+    DerivativeType     mean(numParametersPerLastDimension);
+    mean.Fill(0.0);
+
+    /** Compute mean per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        mean[index] += derivative[c];
+      }
+    }
+    mean /= static_cast<double>(lastDimSize);
+
+    /** Update derivative per control point. */
+    for (unsigned int t = 0; t < lastDimSize; ++t)
+    {
+      const unsigned int startc = numParametersPerLastDimension * t;
+      for (unsigned int c = startc; c < startc + numParametersPerLastDimension; ++c)
+      {
+        const unsigned int index = c % numParametersPerLastDimension;
+        derivative[c] -= mean[index];
+      }
+    }
+  }
 
+} // end SubtractMeanFromDerivative()
 
 } // end namespace itk
 
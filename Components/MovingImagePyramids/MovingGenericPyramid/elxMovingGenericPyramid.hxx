@@ -151,6 +151,20 @@ MovingGenericPyramid<TElastix>::SetMovingSchedule(void)
   this->m_Configuration->ReadParameter(computeThisResolution, "ComputePyramidImagesPerResolution", 0, false);
   this->SetComputeOnlyForCurrentLevel(computeThisResolution);
 
+  /** Decide whether or not to compute the pyramid images of the next resolution
+   * in the background, while the current resolution is being registered.
+   */
+  bool computeInBackground = false;
+  this->m_Configuration->ReadParameter(computeInBackground, "ComputePyramidImagesInBackground", 0, false);
+  this->SetComputeNextLevelInBackground(computeInBackground);
+
+  /** Decide whether or not to compute each pyramid image from the image of the
+   * next resolution, instead of from the input image.
+   */
+  bool computeCascaded = false;
+  this->m_Configuration->ReadParameter(computeCascaded, "ComputePyramidImagesCascaded", 0, false);
+  this->SetComputeLevelsCascaded(computeCascaded);
+
 } // end SetMovingSchedule()
 
 
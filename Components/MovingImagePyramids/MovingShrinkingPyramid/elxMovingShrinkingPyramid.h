@@ -31,6 +31,10 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter FixedImagePyramid: Select this pyramid as follows:\n
  *    <tt>(MovingImagePyramid "MovingShrinkingImagePyramid")</tt>
+ * \parameter ImagePyramidUseBinAveraging: Flag to specify if each voxel of a pyramid image is the
+ *    average of the voxels it covers, instead of a single voxel. This reduces the aliasing.\n
+ *    example: <tt>(ImagePyramidUseBinAveraging "true")</tt>\n
+ *    Default false.
  *
  * \ingroup ImagePyramids
  */
@@ -83,6 +87,10 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** Read the averaging option. */
+  void
+  BeforeRegistration(void) override;
+
 protected:
   /** The constructor. */
   MovingShrinkingPyramid() = default;
@@ -22,6 +22,24 @@
 #include "elxMovingShrinkingPyramid.h"
 
 namespace elastix
-{} // end namespace elastix
+{
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+MovingShrinkingPyramid<TElastix>::BeforeRegistration(void)
+{
+  /** Decide whether or not to average the voxels, instead of subsampling them. */
+  bool useBinAveraging = false;
+  this->m_Configuration->ReadParameter(useBinAveraging, "ImagePyramidUseBinAveraging", 0, false);
+  this->SetUseBinAveraging(useBinAveraging);
+
+} // end BeforeRegistration()
+
+
+} // end namespace elastix
 
 #endif //#ifndef elxMovingShrinkingPyramid_hxx
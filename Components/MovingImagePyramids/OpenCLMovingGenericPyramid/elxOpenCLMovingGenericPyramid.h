@@ -134,12 +134,22 @@ private:
   void
   ReportToLog(void);
 
+  /** Returns the GPU copy of the input image. The copy is kept on the GPU
+   * between the resolutions, and is only uploaded again when the input has
+   * changed.
+   */
+  GPUInputImagePointer
+  GetGPUInputImage(void);
+
   GPUPyramidPointer                     m_GPUPyramid;
   bool                                  m_GPUPyramidReady;
   bool                                  m_GPUPyramidCreated;
   bool                                  m_ContextCreated;
   bool                                  m_UseOpenCL;
   std::vector<ObjectFactoryBasePointer> m_Factories;
+  GPUInputImagePointer                  m_GPUInputImage;
+  const InputImageType *                m_GPUInputImageSource;
+  itk::ModifiedTimeType                 m_GPUInputImageMTime;
 };
 
 } // end namespace elastix
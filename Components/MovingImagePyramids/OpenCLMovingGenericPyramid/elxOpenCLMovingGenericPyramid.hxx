@@ -46,6 +46,8 @@ OpenCLMovingGenericPyramid<TElastix>::OpenCLMovingGenericPyramid()
   , m_GPUPyramidCreated(true)
   , m_ContextCreated(false)
   , m_UseOpenCL(true)
+  , m_GPUInputImageSource(nullptr)
+  , m_GPUInputImageMTime(0)
 {
   // Based on the Insight Journal paper:
   // http://insight-journal.org/browse/publication/884
@@ -98,12 +100,7 @@ OpenCLMovingGenericPyramid<TElastix>::BeforeGenerateData(void)
     // Create GPU input image
     try
     {
-      gpuInputImage = GPUInputImageType::New();
-      gpuInputImage->GraftITKImage(this->GetInput());
-      gpuInputImage->AllocateGPU();
-      gpuInputImage->GetGPUDataManager()->SetCPUBufferLock(true);
-      gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
-      gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+      gpuInputImage = this->GetGPUInputImage();
     }
     catch (itk::ExceptionObject & e)
     {
@@ -138,6 +135,42 @@ OpenCLMovingGenericPyramid<TElastix>::BeforeGenerateData(void)
 } // end BeforeGenerateData()
 
 
+/**
+ * ******************* GetGPUInputImage ***********************
+ */
+
+template <class TElastix>
+auto
+OpenCLMovingGenericPyramid<TElastix>::GetGPUInputImage(void) -> GPUInputImagePointer
+{
+  const InputImageType * input = this->GetInput();
+
+  // Reuse the GPU copy of the previous resolution.
+  if (this->m_GPUInputImage.IsNotNull() && input == this->m_GPUInputImageSource &&
+      input->GetMTime() == this->m_GPUInputImageMTime)
+  {
+    return this->m_GPUInputImage;
+  }
+
+  // Upload the input through pinned memory, so that the copy to the GPU
+  // proceeds while the GPU pyramid is configured.
+  this->m_GPUInputImage = nullptr;
+  GPUInputImagePointer gpuInputImage = GPUInputImageType::New();
+  gpuInputImage->GraftITKImage(input);
+  gpuInputImage->AllocateGPU();
+  gpuInputImage->GetGPUDataManager()->SetCPUBufferLock(true);
+  gpuInputImage->GetGPUDataManager()->SetUsePinnedHostMemory(true);
+  gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+  gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+
+  this->m_GPUInputImage = gpuInputImage;
+  this->m_GPUInputImageSource = input;
+  this->m_GPUInputImageMTime = input->GetMTime();
+  return gpuInputImage;
+
+} // end GetGPUInputImage()
+
+
 /**
  * ******************* GenerateData ***********************
  */
@@ -30,10 +30,6 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkTimeProbe.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 namespace elastix
 {
 
@@ -309,6 +305,13 @@ AdaGrad<TElastix>::AfterEachIteration(void)
     this->SelectNewSamples();
   }
 
+  /** Stop when the metric value and the gradient magnitude do not decrease anymore. */
+  if (this->TestForConvergence(this->GetValue(), this->GetGradient().magnitude()))
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
 } // end AfterEachIteration()
 
 
@@ -327,7 +330,8 @@ AdaGrad<TElastix>::AfterEachResolution(void)
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -345,6 +349,10 @@ AdaGrad<TElastix>::AfterEachResolution(void)
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "The metric value and the gradient magnitude have converged";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -415,31 +423,22 @@ template <class TElastix>
 void
 AdaGrad<TElastix>::AdvanceOneStep(void)
 {
-  /** Get space dimension. */
-  const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
-
   /** Compute and set the learning rate. */
   double lamda = this->GetParam_a() / (1.0 + this->Superclass1::GetCurrentTime() / this->GetParam_A());
   this->SetLearningRate(lamda);
 
-  DerivativeType & searchDirection = this->m_SearchDirection;
-
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  const double eta = 1e-14;
-  const double lamda2 = lamda * this->m_NoiseFactor;
-  //  const double lamda2 = 0.01;
-  for (unsigned int j = 0; j < spaceDimension; ++j)
-  {
-    this->m_PreconditionVector[j] += this->m_Gradient[j] * this->m_Gradient[j];
-    searchDirection[j] = this->m_Gradient[j] / (std::sqrt(this->m_PreconditionVector[j] + eta));
-    newPosition[j] = currentPosition[j] - lamda2 * searchDirection[j];
-  }
+  /** Accumulate the squared gradient in the preconditioner, compute the
+   * search direction and update the position, all in one pass.
+   */
+  itk::ParameterUpdateKernel::ArgumentsType arguments;
+  arguments.m_NumberOfParameters = this->GetScaledCostFunction()->GetNumberOfParameters();
+  arguments.m_StepSize = lamda * this->m_NoiseFactor;
+  arguments.m_Gradient = this->m_Gradient.data_block();
+  arguments.m_Position = this->m_ScaledCurrentPosition.data_block();
+  arguments.m_SquaredGradientSum = this->m_PreconditionVector.data_block();
+  arguments.m_Epsilon = 1e-14;
+  arguments.m_SearchDirection = this->m_SearchDirection.data_block();
+  this->m_ParameterUpdateKernel->Update(arguments);
 
   this->Superclass1::UpdateCurrentTime();
   this->InvokeEvent(itk::IterationEvent());
@@ -159,6 +159,19 @@ namespace elastix
  *   number of transform parameters. This is a rather crude rule of thumb,
  *   which seems to work in practice. In principle, the more the better, but the slower.
  *   The parameter has only influence when AutomaticParameterEstimation is used.
+ * \parameter UseRandomizedJacobianTerms: When set to "true", the terms of the Jacobian are
+ *   estimated with random probe vectors, without computing the covariance matrix. Its cost then
+ *   grows linearly with the number of transform parameters, instead of quadratically, which helps
+ *   for fine B-spline grids, but the estimate is slightly less accurate.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseRandomizedJacobianTerms "false" "true")</tt>\n
+ *   Default value: "false".
+ *   The parameter has only influence when AutomaticParameterEstimation is used.
+ * \parameter NumberOfJacobianTermsProbes: The number of random probe vectors used when
+ *   UseRandomizedJacobianTerms is "true". The more the better, but the slower.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(NumberOfJacobianTermsProbes 32)</tt>\n
+ *   Default value: 16.
  * \parameter NumberOfSamplesForExactGradient: The number of image samples used to compute
  *   the 'exact' gradient. The samples are chosen on a uniform grid.
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
@@ -178,10 +191,51 @@ namespace elastix
  *   example: <tt>(MaximumDisplacementEstimationMethod "2sigma")</tt>\n
  *         or <tt>(MaximumDisplacementEstimationMethod "95percentile")</tt>\n
  *   Default: 2sigma.
+ * \parameter DisplacementDistributionUseMetricSamples: Selects whether the displacement
+ *   distribution is computed at the current samples of the metric, instead of at a new set of
+ *   samples on a regular grid. At most NumberOfJacobianMeasurements metric samples are used.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(DisplacementDistributionUseMetricSamples "true")</tt>\n
+ *   Default: true. The parameter only has influence on the DisplacementDistribution method.
+ * \parameter DisplacementDistributionSubsamplingFactor: The factor by which the number of
+ *   Jacobian measurements of the displacement distribution is reduced. For fine B-spline grids
+ *   the default NumberOfJacobianMeasurements equals the number of parameters, and a factor k
+ *   then measures the displacements at about one in k control points.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(DisplacementDistributionSubsamplingFactor 1 1 4)</tt>\n
+ *   Default: 1. The parameter only has influence on the DisplacementDistribution method.
  * \parameter NoiseCompensation: Selects whether or not to use noise compensation.
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(NoiseCompensation "true")</tt>\n
  *   Default/recommended: true.
+ * \parameter ReuseAutomaticParameterEstimation: When set to "true", the Original estimation
+ *   method reuses the estimate of the previous resolution, or of the previous registration
+ *   in a chain of parameter files. The Jacobian terms are reused when neither the number
+ *   of transform parameters nor the scales changed within the registration, and are computed
+ *   otherwise. The square magnitudes of the gradient and the approximation error are averaged
+ *   with a few correction measurements, see NumberOfCorrectionGradientMeasurements.
+ *   The estimated and the actual cost are printed to the log.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ReuseAutomaticParameterEstimation "false" "true" "true")</tt>\n
+ *   Default: false. The parameter has no influence on the DisplacementDistribution method.
+ * \parameter NumberOfCorrectionGradientMeasurements: The number of gradients measured to
+ *   correct a reused estimate. The previous estimate weighs at most as much as these.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(NumberOfCorrectionGradientMeasurements 2)</tt>\n
+ *   Default: 2. The parameter only has influence when ReuseAutomaticParameterEstimation is used.
+ * \parameter AsynchronousGradientDescent: Experimental. When set to "true", an iteration is
+ *   a single pass of asynchronous (Hogwild-style) stochastic gradient descent over the samples:
+ *   the threads of the metric subtract the contribution of every batch of samples, with the
+ *   gain \f$a(k)\f$ divided over the valid samples, from the parameters right away, without locking.
+ *   The number of valid samples is only known after the pass, so that division is approximate.
+ *   The reported gradient is the mean search direction of the pass, which drives the adaptive
+ *   step sizes. Only for a single metric that supports it (AdvancedMeanSquares), without scales
+ *   and without maximization; otherwise a warning is given and the usual iteration is performed.
+ *   The transform only sees the updates during the pass when it reads its parameters in place,
+ *   as the B-spline transforms do.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(AsynchronousGradientDescent "true")</tt>\n
+ *   Default: false.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -308,6 +362,27 @@ protected:
   };
   typedef typename std::vector<SettingsType> SettingsVectorType;
 
+  /** The outcome of an automatic parameter estimation by the Original method,
+   * which may be reused by the next resolution or registration.
+   */
+  struct ParameterEstimateType
+  {
+    bool         m_Valid{ false };
+    unsigned int m_ElastixLevel{ 0 };
+    unsigned int m_Resolution{ 0 };
+    unsigned int m_NumberOfParameters{ 0 };
+    ScalesType   m_Scales;
+    double       m_TrC{ 0.0 };
+    double       m_TrCC{ 0.0 };
+    double       m_MaxJJ{ 0.0 };
+    double       m_MaxJCJ{ 0.0 };
+    double       m_JacobianTermsTime{ 0.0 };
+    double       m_Sigma1Squared{ 0.0 };
+    double       m_Sigma3Squared{ 0.0 };
+    double       m_NumberOfGradientMeasurements{ 0.0 };
+    double       m_TimePerGradientMeasurement{ 0.0 };
+  };
+
   typedef itk::ComputeDisplacementDistribution<FixedImageType, TransformType> ComputeDisplacementDistributionType;
 
   /** Samplers: */
@@ -340,6 +415,9 @@ protected:
   typedef typename AdvancedTransformType::Pointer                    AdvancedTransformPointer;
   typedef typename AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** The metric type that supports asynchronous gradient descent. */
+  typedef typename ElastixType::MetricBaseType::AdvancedMetricType AdvancedMetricType;
+
   AdaptiveStochasticGradientDescent();
   ~AdaptiveStochasticGradientDescent() override = default;
 
@@ -351,6 +429,10 @@ protected:
   SizeValueType m_NumberOfJacobianMeasurements;
   SizeValueType m_NumberOfSamplesForExactGradient;
 
+  /** Options for the displacement distribution method. */
+  bool          m_DisplacementDistributionUseMetricSamples;
+  SizeValueType m_DisplacementDistributionSubsamplingFactor;
+
   /** The transform stored as AdvancedTransform */
   AdvancedTransformPointer m_AdvancedTransform;
 
@@ -370,6 +452,11 @@ protected:
   virtual void
   AutomaticParameterEstimation(void);
 
+  /** Perform a pass of asynchronous gradient descent when selected, and the
+   * Superclass' implementation otherwise. */
+  void
+  ComputeValueAndAdvanceOneStep(void) override;
+
   /** Original estimation method to get the reasonable values for the parameters
    * SP_a, SP_alpha (=1), SigmoidMin, SigmoidMax (=1), and
    * SigmoidScale.
@@ -405,6 +492,13 @@ protected:
   virtual void
   AddRandomPerturbation(ParametersType & parameters, double sigma);
 
+  /** Store the estimate of this registration for the next registration in a
+   * chain of parameter files when \a store is true, or retrieve the estimate
+   * of the previous registration otherwise.
+   */
+  void
+  ShareParameterEstimate(const bool store);
+
 private:
   elxOverrideGetSelfMacro;
 
@@ -426,9 +520,22 @@ private:
   SizeValueType m_MaxBandCovSize;
   SizeValueType m_NumberOfBandStructureSamples;
 
+  /** Private variables for the randomized estimation of the Jacobian terms. */
+  bool         m_UseRandomizedJacobianTerms;
+  unsigned int m_NumberOfJacobianTermsProbes;
+
   /** The flag of using noise compensation. */
   bool m_UseNoiseCompensation;
   bool m_OriginalButSigmoidToDefault;
+
+  /** Private variables for the reuse of the previous parameter estimate. */
+  bool                  m_ReuseParameterEstimate;
+  SizeValueType         m_NumberOfCorrectionGradientMeasurements;
+  ParameterEstimateType m_PreviousParameterEstimate;
+
+  /** The metric that performs the asynchronous gradient descent, if selected and supported. */
+  bool                 m_UseAsynchronousGradientDescent;
+  AdvancedMetricType * m_AsynchronousMetric;
 };
 
 } // end namespace elastix
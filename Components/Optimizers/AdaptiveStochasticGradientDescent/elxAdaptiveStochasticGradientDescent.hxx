@@ -28,6 +28,7 @@
 #include <utility>
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkTimeProbe.h"
+#include "itkMetaDataObject.h"
 
 namespace elastix
 {
@@ -50,6 +51,8 @@ AdaptiveStochasticGradientDescent<TElastix>::AdaptiveStochasticGradientDescent()
 
   this->m_NumberOfGradientMeasurements = 0;
   this->m_NumberOfJacobianMeasurements = 0;
+  this->m_UseRandomizedJacobianTerms = false;
+  this->m_NumberOfJacobianTermsProbes = 16;
   this->m_NumberOfSamplesForExactGradient = 100000;
   this->m_SigmoidScaleFactor = 0.1;
 
@@ -59,6 +62,15 @@ AdaptiveStochasticGradientDescent<TElastix>::AdaptiveStochasticGradientDescent()
   this->m_UseNoiseCompensation = true;
   this->m_OriginalButSigmoidToDefault = false;
 
+  this->m_ReuseParameterEstimate = false;
+  this->m_NumberOfCorrectionGradientMeasurements = 2;
+
+  this->m_DisplacementDistributionUseMetricSamples = true;
+  this->m_DisplacementDistributionSubsamplingFactor = 1;
+
+  this->m_UseAsynchronousGradientDescent = false;
+  this->m_AsynchronousMetric = nullptr;
+
 } // Constructor
 
 
@@ -84,6 +96,12 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeRegistration(void)
 
   this->m_SettingsVector.clear();
 
+  /** Start from the parameter estimate of the previous registration in a chain
+   * of parameter files. The first registration discards the stored estimate.
+   */
+  this->m_PreviousParameterEstimate = ParameterEstimateType();
+  this->ShareParameterEstimate(this->GetConfiguration()->GetElastixLevel() == 0);
+
 } // end BeforeRegistration()
 
 
@@ -141,6 +159,14 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(
     this->m_NumberOfBandStructureSamples, "NumberOfBandStructureSamples", this->GetComponentLabel(), level, 0);
 
+  /** Set whether the Jacobian terms are estimated with random probe vectors, and how many. */
+  this->m_UseRandomizedJacobianTerms = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_UseRandomizedJacobianTerms, "UseRandomizedJacobianTerms", this->GetComponentLabel(), level, 0);
+  this->m_NumberOfJacobianTermsProbes = 16;
+  this->GetConfiguration()->ReadParameter(
+    this->m_NumberOfJacobianTermsProbes, "NumberOfJacobianTermsProbes", this->GetComponentLabel(), level, 0);
+
   /** Set/Get whether the adaptive step size mechanism is desired. Default: true
    * NB: the setting is turned of in case of UseRandomSampleRegion=true.
    * Deprecated alias UseCruzAcceleration is also still supported.
@@ -162,6 +188,11 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(
     this->m_UseConstantStep, "UseConstantStep", this->GetComponentLabel(), level, 0);
 
+  /** Set whether asynchronous gradient descent is selected; default: false. */
+  this->m_UseAsynchronousGradientDescent = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_UseAsynchronousGradientDescent, "AsynchronousGradientDescent", this->GetComponentLabel(), level, 0);
+
   if (this->m_AutomaticParameterEstimation)
   {
     /** Read user setting. */
@@ -222,6 +253,33 @@ AdaptiveStochasticGradientDescent<TElastix>::BeforeEachResolution(void)
       sigmoidScaleFactor, "SigmoidScaleFactor", this->GetComponentLabel(), level, 0);
     this->m_SigmoidScaleFactor = sigmoidScaleFactor;
 
+    /** Set whether the estimate of the previous resolution or registration is
+     * reused, and the number of gradients that are measured to correct it.
+     */
+    this->m_ReuseParameterEstimate = false;
+    this->GetConfiguration()->ReadParameter(
+      this->m_ReuseParameterEstimate, "ReuseAutomaticParameterEstimation", this->GetComponentLabel(), level, 0);
+    this->m_NumberOfCorrectionGradientMeasurements = 2;
+    this->GetConfiguration()->ReadParameter(this->m_NumberOfCorrectionGradientMeasurements,
+                                            "NumberOfCorrectionGradientMeasurements",
+                                            this->GetComponentLabel(),
+                                            level,
+                                            0);
+
+    /** Set the samples of the displacement distribution method. */
+    this->m_DisplacementDistributionUseMetricSamples = true;
+    this->GetConfiguration()->ReadParameter(this->m_DisplacementDistributionUseMetricSamples,
+                                            "DisplacementDistributionUseMetricSamples",
+                                            this->GetComponentLabel(),
+                                            level,
+                                            0);
+    this->m_DisplacementDistributionSubsamplingFactor = 1;
+    this->GetConfiguration()->ReadParameter(this->m_DisplacementDistributionSubsamplingFactor,
+                                            "DisplacementDistributionSubsamplingFactor",
+                                            this->GetComponentLabel(),
+                                            level,
+                                            0);
+
   } // end if automatic parameter estimation
   else
   {
@@ -279,12 +337,26 @@ AdaptiveStochasticGradientDescent<TElastix>::AfterEachIteration(void)
     this->GetIterationInfoAt("4:||Gradient||") << this->GetGradient().magnitude();
   }
 
-  /** Select new spatial samples for the computation of the metric. */
+  /** Select new spatial samples for the computation of the metric. Adapt the number
+   * of samples to the gradient noise first: random gradients reverse half of the time.
+   */
   if (this->GetNewSamplesEveryIteration())
   {
+    const double noiseLevel = std::min(1.0, 2.0 * this->GetGradientReversalFraction());
+    for (unsigned int i = 0; i < this->GetElastix()->GetNumberOfImageSamplers(); ++i)
+    {
+      this->GetElastix()->GetElxImageSamplerBase(i)->AdaptNumberOfSpatialSamples(noiseLevel);
+    }
     this->SelectNewSamples();
   }
 
+  /** Stop when the metric value and the gradient magnitude do not decrease anymore. */
+  if (this->TestForConvergence(this->GetValue(), this->GetGradient().magnitude()))
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
 } // end AfterEachIteration()
 
 
@@ -303,7 +375,8 @@ AdaptiveStochasticGradientDescent<TElastix>::AfterEachResolution(void)
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -321,6 +394,10 @@ AdaptiveStochasticGradientDescent<TElastix>::AfterEachResolution(void)
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "The metric value and the gradient magnitude have converged";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -363,6 +440,9 @@ AdaptiveStochasticGradientDescent<TElastix>::AfterRegistration(void)
   elxout << "Settings of " << this->elxGetClassName() << " for all resolutions:" << std::endl;
   this->PrintSettingsVector(this->m_SettingsVector);
 
+  /** Pass the last parameter estimate on to the next registration. */
+  this->ShareParameterEstimate(true);
+
 } // end AfterRegistration()
 
 
@@ -415,11 +495,80 @@ AdaptiveStochasticGradientDescent<TElastix>::ResumeOptimization(void)
     this->m_AutomaticParameterEstimationDone = true;
   }
 
+  /** Check whether the asynchronous gradient descent can be used. The metric
+   * must update the parameters of the optimizer itself, so there may be no
+   * scales, no maximization, and no combination of metrics in between.
+   */
+  this->m_AsynchronousMetric = nullptr;
+  if (this->m_UseAsynchronousGradientDescent)
+  {
+    AdvancedMetricType * metric =
+      dynamic_cast<AdvancedMetricType *>(this->m_ScaledCostFunction->GetUnscaledCostFunction());
+    if (metric != nullptr && metric->GetSupportsAsynchronousGradientDescent() && !this->GetUseScales() &&
+        !this->m_ScaledCostFunction->GetNegateCostFunction())
+    {
+      this->m_AsynchronousMetric = metric;
+    }
+    else
+    {
+      elxout["warning"] << "WARNING: AsynchronousGradientDescent requires a single metric that supports it, "
+                        << "without scales and maximization.\n"
+                        << "  The usual iterations are performed instead." << std::endl;
+    }
+  }
+
   this->Superclass1::ResumeOptimization();
 
 } // end ResumeOptimization()
 
 
+/**
+ * ****************** ComputeValueAndAdvanceOneStep *************************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>::ComputeValueAndAdvanceOneStep(void)
+{
+  if (this->m_AsynchronousMetric == nullptr)
+  {
+    this->Superclass1::ComputeValueAndAdvanceOneStep();
+    return;
+  }
+
+  /** Compute the gain, as StandardGradientDescentOptimizer::AdvanceOneStep() does. */
+  const double learningRate = this->Compute_a(this->m_UseConstantStep ? 0.0 : this->m_CurrentTime);
+  this->SetLearningRate(learningRate);
+
+  /** Let the threads of the metric update the position in place. */
+  const ParametersType previousPosition = this->GetScaledCurrentPosition();
+  try
+  {
+    this->m_AsynchronousMetric->AsynchronousGradientDescent(this->m_ScaledCurrentPosition, learningRate, this->m_Value);
+  }
+  catch (itk::ExceptionObject & err)
+  {
+    this->MetricErrorResponse(err);
+    return;
+  }
+
+  /** Store the mean search direction of the pass as the gradient. */
+  if (learningRate > 0.0)
+  {
+    const ParametersType & position = this->GetScaledCurrentPosition();
+    for (unsigned int j = 0; j < position.GetSize(); ++j)
+    {
+      this->m_Gradient[j] = (previousPosition[j] - position[j]) / learningRate;
+    }
+  }
+
+  this->InvokeEvent(itk::IterationEvent());
+
+  this->UpdateCurrentTime();
+
+} // end ComputeValueAndAdvanceOneStep()
+
+
 /**
  * ****************** MetricErrorResponse *************************
  */
@@ -536,6 +685,8 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationOrigina
   computeJacobianTerms->SetMaxBandCovSize(this->m_MaxBandCovSize);
   computeJacobianTerms->SetNumberOfBandStructureSamples(this->m_NumberOfBandStructureSamples);
   computeJacobianTerms->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
+  computeJacobianTerms->SetUseRandomizedTraceEstimator(this->m_UseRandomizedJacobianTerms);
+  computeJacobianTerms->SetNumberOfProbeVectors(this->m_NumberOfJacobianTermsProbes);
 
   /** Check if use scales. */
   bool useScales = this->GetUseScales();
@@ -549,12 +700,42 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationOrigina
     computeJacobianTerms->SetUseScales(false);
   }
 
+  /** Check whether the estimate of the previous resolution or registration is reused.
+   * The Jacobian terms only depend on the transform and the fixed image region, so
+   * they are only reused within a registration, when the number of parameters and
+   * the scales did not change.
+   */
+  const ParameterEstimateType previous = this->m_PreviousParameterEstimate;
+  const unsigned int          elastixLevel = this->GetConfiguration()->GetElastixLevel();
+  const unsigned int          level =
+    static_cast<unsigned int>(this->m_Registration->GetAsITKBaseType()->GetCurrentLevel());
+  const unsigned int P = this->GetElastix()->GetElxTransformBase()->GetAsITKBaseType()->GetNumberOfParameters();
+  const ScalesType   scales = useScales ? this->m_ScaledCostFunction->GetScales() : ScalesType();
+  const bool         reuse = this->m_ReuseParameterEstimate && previous.m_Valid;
+  const bool         reuseJacobianTerms = reuse && previous.m_ElastixLevel == elastixLevel &&
+                                previous.m_NumberOfParameters == P && previous.m_Scales == scales;
+
   /** Compute the Jacobian terms. */
-  elxout << "  Computing JacobianTerms ..." << std::endl;
-  timer2.Start();
-  computeJacobianTerms->Compute(TrC, TrCC, maxJJ, maxJCJ);
-  timer2.Stop();
-  elxout << "  Computing the Jacobian terms took " << Conversion::SecondsToDHMS(timer2.GetMean(), 6) << std::endl;
+  double jacobianTermsTime = 0.0;
+  if (reuseJacobianTerms)
+  {
+    TrC = previous.m_TrC;
+    TrCC = previous.m_TrCC;
+    maxJJ = previous.m_MaxJJ;
+    maxJCJ = previous.m_MaxJCJ;
+    jacobianTermsTime = previous.m_JacobianTermsTime;
+    elxout << "  Reusing the JacobianTerms of resolution " << previous.m_Resolution << ", which took "
+           << Conversion::SecondsToDHMS(jacobianTermsTime, 6) << " to compute." << std::endl;
+  }
+  else
+  {
+    elxout << "  Computing JacobianTerms ..." << std::endl;
+    timer2.Start();
+    computeJacobianTerms->Compute(TrC, TrCC, maxJJ, maxJCJ);
+    timer2.Stop();
+    jacobianTermsTime = timer2.GetMean();
+    elxout << "  Computing the Jacobian terms took " << Conversion::SecondsToDHMS(jacobianTermsTime, 6) << std::endl;
+  }
 
   /** Determine number of gradient measurements such that
    * E + 2\sqrt(Var) < K E
@@ -579,7 +760,33 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationOrigina
     }
     this->m_NumberOfGradientMeasurements =
       std::max(static_cast<SizeValueType>(2), this->m_NumberOfGradientMeasurements);
-    elxout << "  NumberOfGradientMeasurements to estimate sigma_i: " << this->m_NumberOfGradientMeasurements
+    if (!reuse)
+    {
+      elxout << "  NumberOfGradientMeasurements to estimate sigma_i: " << this->m_NumberOfGradientMeasurements
+             << std::endl;
+    }
+  }
+
+  /** A reused estimate is corrected with a few gradient measurements, instead of
+   * the number that a full estimation needs. The cost of a gradient measurement
+   * hardly depends on the resolution, because the exact gradient is computed
+   * with a fixed number of samples.
+   */
+  if (reuse)
+  {
+    const SizeValueType numberOfFullGradientMeasurements = this->m_NumberOfGradientMeasurements;
+    this->m_NumberOfGradientMeasurements = std::max(
+      static_cast<SizeValueType>(1),
+      std::min(this->m_NumberOfCorrectionGradientMeasurements, numberOfFullGradientMeasurements));
+    const bool sameRegistration = previous.m_ElastixLevel == elastixLevel;
+    elxout << "  Reusing the estimate of " << (sameRegistration ? "resolution " : "registration ")
+           << (sameRegistration ? previous.m_Resolution : previous.m_ElastixLevel) << ", with "
+           << this->m_NumberOfGradientMeasurements << " instead of " << numberOfFullGradientMeasurements
+           << " gradient measurements.\n"
+           << "  The estimated cost of the gradient measurements is "
+           << Conversion::SecondsToDHMS(this->m_NumberOfGradientMeasurements * previous.m_TimePerGradientMeasurement, 6)
+           << " instead of "
+           << Conversion::SecondsToDHMS(numberOfFullGradientMeasurements * previous.m_TimePerGradientMeasurement, 6)
            << std::endl;
   }
 
@@ -597,21 +804,57 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationOrigina
   elxout << "  Sampling the gradients took " << Conversion::SecondsToDHMS(timer3.GetMean(), 6) << std::endl;
 
   /** Determine parameter settings. */
-  double sigma1 = 0.0;
-  double sigma3 = 0.0;
+  double sigma1Squared = 0.0;
+  double sigma3Squared = 0.0;
   /** Estimate of sigma such that empirical norm^2 equals theoretical:
    * gg = 1/N sum_n g_n' g_n
    * sigma = gg / TrC
    */
   if (gg > 1e-14 && TrC > 1e-14)
   {
-    sigma1 = std::sqrt(gg / TrC);
+    sigma1Squared = gg / TrC;
   }
   if (ee > 1e-14 && TrC > 1e-14)
   {
-    sigma3 = std::sqrt(ee / TrC);
+    sigma3Squared = ee / TrC;
+  }
+
+  /** Average a reused estimate with the correction measurements, weighted by
+   * their number of measurements. The previous estimate weighs at most as much
+   * as the correction, so that the estimate follows the changes of the images.
+   */
+  const double numberOfCorrectionMeasurements = static_cast<double>(this->m_NumberOfGradientMeasurements);
+  double       numberOfGradientMeasurements = numberOfCorrectionMeasurements;
+  if (reuse)
+  {
+    const double previousWeight = std::min(previous.m_NumberOfGradientMeasurements, numberOfCorrectionMeasurements);
+    numberOfGradientMeasurements = previousWeight + numberOfCorrectionMeasurements;
+    sigma1Squared = (previousWeight * previous.m_Sigma1Squared + numberOfCorrectionMeasurements * sigma1Squared) /
+                    numberOfGradientMeasurements;
+    sigma3Squared = (previousWeight * previous.m_Sigma3Squared + numberOfCorrectionMeasurements * sigma3Squared) /
+                    numberOfGradientMeasurements;
   }
 
+  /** Store the estimate for the next resolution or registration. */
+  ParameterEstimateType & estimate = this->m_PreviousParameterEstimate;
+  estimate.m_Valid = true;
+  estimate.m_ElastixLevel = elastixLevel;
+  estimate.m_Resolution = level;
+  estimate.m_NumberOfParameters = P;
+  estimate.m_Scales = scales;
+  estimate.m_TrC = TrC;
+  estimate.m_TrCC = TrCC;
+  estimate.m_MaxJJ = maxJJ;
+  estimate.m_MaxJCJ = maxJCJ;
+  estimate.m_JacobianTermsTime = jacobianTermsTime;
+  estimate.m_Sigma1Squared = sigma1Squared;
+  estimate.m_Sigma3Squared = sigma3Squared;
+  estimate.m_NumberOfGradientMeasurements = numberOfGradientMeasurements;
+  estimate.m_TimePerGradientMeasurement = timer3.GetMean() / numberOfCorrectionMeasurements;
+
+  const double sigma1 = std::sqrt(sigma1Squared);
+  const double sigma3 = std::sqrt(sigma3Squared);
+
   const double alpha = 1.0;
   const double A = this->GetParam_A();
   double       a_max = 0.0;
@@ -675,6 +918,16 @@ AdaptiveStochasticGradientDescent<TElastix>::AutomaticParameterEstimationUsingDi
   computeDisplacementDistribution->SetTransform(this->GetRegistration()->GetAsITKBaseType()->GetModifiableTransform());
   computeDisplacementDistribution->SetCostFunction(this->m_CostFunction);
   computeDisplacementDistribution->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
+  computeDisplacementDistribution->SetSubsamplingFactor(this->m_DisplacementDistributionSubsamplingFactor);
+  computeDisplacementDistribution->SetUseThreadPool(testPtr->GetUseThreadPool());
+
+  /** Reuse the samples of the metric. Its sample container is filled in place
+   * when the exact gradient is computed, before the displacements are.
+   */
+  if (this->m_DisplacementDistributionUseMetricSamples && testPtr->GetImageSampler() != nullptr)
+  {
+    computeDisplacementDistribution->SetInputSampleContainer(testPtr->GetImageSampler()->GetOutput());
+  }
 
   /** Check if use scales. */
   if (this->GetUseScales())
@@ -1044,6 +1297,37 @@ AdaptiveStochasticGradientDescent<TElastix>::AddRandomPerturbation(ParametersTyp
 } // end AddRandomPerturbation()
 
 
+/**
+ * ******************** ShareParameterEstimate ***************************
+ */
+
+template <class TElastix>
+void
+AdaptiveStochasticGradientDescent<TElastix>::ShareParameterEstimate(const bool store)
+{
+  /** The registrations of a chain of parameter files are run one after the
+   * other, each with its own optimizer, so the estimate is kept in the
+   * dictionary of the chain, which concurrent registrations do not share.
+   */
+  const auto & chainDictionary = this->GetElastix()->GetChainDictionary();
+  if (chainDictionary == nullptr)
+  {
+    return;
+  }
+
+  const std::string key = "AdaptiveStochasticGradientDescent.ParameterEstimate";
+  if (store)
+  {
+    itk::EncapsulateMetaData<ParameterEstimateType>(*chainDictionary, key, this->m_PreviousParameterEstimate);
+  }
+  else
+  {
+    itk::ExposeMetaData<ParameterEstimateType>(*chainDictionary, key, this->m_PreviousParameterEstimate);
+  }
+
+} // end ShareParameterEstimate()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxAdaptiveStochasticGradientDescent_hxx
@@ -58,6 +58,15 @@ AdaptiveStochasticGradientDescentOptimizer::UpdateCurrentTime(void)
       const double inprod = inner_product(this->m_PreviousGradient, this->GetGradient());
       this->m_CurrentTime += sigmoid(-inprod);
       this->m_CurrentTime = std::max(0.0, this->m_CurrentTime);
+
+      /** Keep track of how often the gradient reverses, a measure for the gradient noise. */
+      const double reversalWeight = 0.1;
+      const double reversal = inprod < 0.0 ? 1.0 : 0.0;
+      this->m_GradientReversalFraction += reversalWeight * (reversal - this->m_GradientReversalFraction);
+    }
+    else
+    {
+      this->m_GradientReversalFraction = 0.0;
     }
 
     /** Save for next iteration */
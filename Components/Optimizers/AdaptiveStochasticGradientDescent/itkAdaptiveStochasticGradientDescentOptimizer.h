@@ -114,6 +114,13 @@ public:
   itkSetMacro(SigmoidScale, double);
   itkGetConstMacro(SigmoidScale, double);
 
+  /** Get the exponential moving average of the fraction of iterations in which
+   * the gradient reversed direction, i.e. had a negative inner product with the
+   * previous gradient. About 0.5 when the gradients are dominated by noise.
+   * Only computed when UseAdaptiveStepSizes is true.
+   */
+  itkGetConstMacro(GradientReversalFraction, double);
+
 protected:
   AdaptiveStochasticGradientDescentOptimizer();
   ~AdaptiveStochasticGradientDescentOptimizer() override = default;
@@ -141,6 +148,7 @@ private:
   double m_SigmoidMax{ 1.0 };
   double m_SigmoidMin{ -0.8 };
   double m_SigmoidScale{ 1e-8 };
+  double m_GradientReversalFraction{ 0.0 };
 };
 
 } // end namespace itk
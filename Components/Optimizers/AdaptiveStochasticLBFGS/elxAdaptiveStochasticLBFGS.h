@@ -26,10 +26,10 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeJacobianTerms.h"
 #include "itkComputeDisplacementDistribution.h"
-#include "itkPlatformMultiThreader.h"
 #include "itkImageRandomSampler.h"
 #include "itkLineSearchOptimizer.h"
 #include "itkMoreThuenteLineSearchOptimizer.h"
+#include "itkLBFGSHistory.h"
 
 
 namespace elastix
@@ -92,6 +92,11 @@ namespace elastix
  *   example: <tt>(MaximumStepLength 1.0)</tt>\n
  *   Default: mean voxel spacing of fixed and moving image. This seems to work well in general.
  *   This parameter only has influence when AutomaticParameterEstimation is used.
+ * \parameter UseFloatHistory: Whether to store the curvature pairs of the last LBFGSMemory
+ *   updates in single precision, which halves the memory of the history.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseFloatHistory "true")</tt>\n
+ *   Default value: "false".
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -229,7 +234,8 @@ public:
   void
   SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
   {
-    this->m_Threader->SetNumberOfWorkUnits(numberOfThreads);
+    this->Superclass1::SetNumberOfWorkUnits(numberOfThreads);
+    this->m_History->SetNumberOfWorkUnits(numberOfThreads);
   }
 
 protected:
@@ -291,10 +297,8 @@ protected:
   typedef typename AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
   /** For L-BFGS usage. */
-  typedef itk::Array<double>          RhoType;
-  typedef std::vector<ParametersType> SType;
-  typedef std::vector<DerivativeType> YType;
-  typedef itk::Array<double>          DiagonalMatrixType;
+  typedef itk::Array<double> RhoType;
+  typedef itk::Array<double> DiagonalMatrixType;
 
   AdaptiveStochasticLBFGS();
   ~AdaptiveStochasticLBFGS() override = default;
@@ -364,7 +368,7 @@ protected:
   virtual void
   AddRandomPerturbation(ParametersType & parameters, double sigma);
 
-  /** Store s = x_k - x_k-1 and y = g_k - g_k-1 in m_S and m_Y,
+  /** Store s = x_k - x_k-1 and y = g_k - g_k-1 in m_History,
    * and store 1/(ys) in m_Rho. */
   virtual void
   StoreCurrentPoint(const ParametersType & step, const DerivativeType & grad_dif);
@@ -397,11 +401,12 @@ protected:
   unsigned int m_PreviousT;
   unsigned int m_Bound;
 
-  RhoType m_Rho;
-  SType   m_S;
-  YType   m_Y;
-  RhoType m_HessianFillValue;
-  double  m_WindowScale;
+  /** The history of the curvature pairs s and y, and 1/(ys). */
+  itk::LBFGSHistory::Pointer m_History;
+  bool                       m_UseFloatHistory;
+  RhoType                    m_Rho;
+  RhoType                    m_HessianFillValue;
+  double                     m_WindowScale;
 
 private:
   elxOverrideGetSelfMacro;
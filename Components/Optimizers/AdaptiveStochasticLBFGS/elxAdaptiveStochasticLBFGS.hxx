@@ -32,10 +32,6 @@
 #include "itkEventObject.h"
 #include "itkMacro.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 #ifdef ELASTIX_USE_EIGEN
 #  include <Eigen/Dense>
 #  include <Eigen/Core>
@@ -76,6 +72,8 @@ AdaptiveStochasticLBFGS<TElastix>::AdaptiveStochasticLBFGS()
   this->m_PreviousT = 0;
   this->m_Bound = 0;
   this->m_WindowScale = 5;
+  this->m_History = itk::LBFGSHistory::New();
+  this->m_UseFloatHistory = false;
 
   this->m_RandomGenerator = RandomGeneratorType::GetInstance();
   this->m_AdvancedTransform = nullptr;
@@ -134,6 +132,11 @@ AdaptiveStochasticLBFGS<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(memory, "LBFGSMemory", this->GetComponentLabel(), level, 0);
   this->m_LBFGSMemory = memory;
 
+  /** Set whether the curvature pairs are stored in single precision. */
+  bool useFloatHistory = false;
+  this->GetConfiguration()->ReadParameter(useFloatHistory, "UseFloatHistory", this->GetComponentLabel(), level, 0);
+  this->m_UseFloatHistory = useFloatHistory;
+
   /** Set the updateFrequenceL. */
   SizeValueType updateFrequenceL = 5;
   this->GetConfiguration()->ReadParameter(updateFrequenceL, "UpdateFrequenceL", this->GetComponentLabel(), level, 0);
@@ -362,6 +365,13 @@ AdaptiveStochasticLBFGS<TElastix>::AfterEachIteration(void)
     this->SelectNewSamples();
   }
 
+  /** Stop when the metric value and the gradient magnitude do not decrease anymore. */
+  if (this->TestForConvergence(this->GetValue(), this->GetGradient().magnitude()))
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
 } // end AfterEachIteration()
 
 
@@ -380,7 +390,8 @@ AdaptiveStochasticLBFGS<TElastix>::AfterEachResolution(void)
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -406,6 +417,10 @@ AdaptiveStochasticLBFGS<TElastix>::AfterEachResolution(void)
       stopcondition = "The last step size was (nearly) zero";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "The metric value and the gradient magnitude have converged";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -489,14 +504,14 @@ AdaptiveStochasticLBFGS<TElastix>::StartOptimization(void)
   /** Get the number of parameters; checks also if a cost function has been set at all.
    * if not: an exception is thrown.
    */
-  this->GetScaledCostFunction()->GetNumberOfParameters();
+  const unsigned int numberOfParameters = this->GetScaledCostFunction()->GetNumberOfParameters();
 
-  /** Resize Rho, S and Y. */
+  /** Resize Rho, and prepare the history of S and Y. */
   this->m_Rho.SetSize(this->m_LBFGSMemory);
   this->m_HessianFillValue.SetSize(this->m_LBFGSMemory);
   this->m_HessianFillValue.fill(0.0);
-  this->m_S.resize(this->m_LBFGSMemory);
-  this->m_Y.resize(this->m_LBFGSMemory);
+  this->m_History->SetUseFloatStorage(this->m_UseFloatHistory);
+  this->m_History->Initialize(this->m_LBFGSMemory, numberOfParameters);
 
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
@@ -552,21 +567,8 @@ AdaptiveStochasticLBFGS<TElastix>::AdvanceOneStep(void)
 {
   itkDebugMacro("AdvanceOneStep");
 
-  /** Get space dimension. */
-  const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
-
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  const double learningRate = this->GetLearningRate();
-  for (unsigned int j = 0; j < spaceDimension; ++j)
-  {
-    newPosition[j] = currentPosition[j] - learningRate * this->m_Gradient[j];
-  }
+  /** Update the position in place. */
+  this->m_ParameterUpdateKernel->Update(this->GetLearningRate(), this->m_Gradient, this->m_ScaledCurrentPosition);
 
   this->InvokeEvent(itk::IterationEvent());
 
@@ -1530,11 +1532,11 @@ AdaptiveStochasticLBFGS<TElastix>::StoreCurrentPoint(const ParametersType & step
 {
   itkDebugMacro("StoreCurrentPoint");
 
-  //   const double rho = 1.0 / inner_product( step, grad_dif ) ; // 1/ys
-  //   const double  ys = 1.0 / rho;
-  const double ys = inner_product(step, grad_dif); // 1/ys;
+  /** Store s and y; ys and yy are computed in the same pass. */
+  this->m_History->Store(this->m_CurrentT, step, grad_dif);
+  const double ys = this->m_History->GetInnerProductSY(this->m_CurrentT);
   const double rho = 1.0 / ys;
-  const double yy = grad_dif.squared_magnitude();
+  const double yy = this->m_History->GetSquaredMagnitudeY(this->m_CurrentT);
 
   double fill_value = ys / yy;
   if (fill_value < 0.0)
@@ -1544,8 +1546,6 @@ AdaptiveStochasticLBFGS<TElastix>::StoreCurrentPoint(const ParametersType & step
     this->StopOptimization();
   }
 
-  this->m_S[this->m_CurrentT] = step;     // expensive copy
-  this->m_Y[this->m_CurrentT] = grad_dif; // expensive copy
   this->m_Rho[this->m_CurrentT] = rho;
   this->m_HessianFillValue[this->m_CurrentT] = fill_value;
 
@@ -1596,80 +1596,16 @@ AdaptiveStochasticLBFGS<TElastix>::ComputeSearchDirection(const DerivativeType &
 {
   itkDebugMacro("ComputeSearchDirection");
 
-  /** Assumes m_Rho, m_S, and m_Y are up-to-date at m_PreviousPoint */
-  typedef itk::Array<double> AlphaType;
-  AlphaType                  alpha(this->m_LBFGSMemory);
-
-  const unsigned int numberOfParameters = gradient.GetSize();
-
-#if 0
-  /** this step can be emitted when s y did not change. */
-  /** refine it later. */
-  // omitting probably won't save a lot of time, only a fill over the diagonal
-  DiagonalMatrixType H0;
-  this->ComputeDiagonalMatrix( H0 );
-#else
+  /** Assumes m_Rho and m_History are up-to-date at m_PreviousT */
   // We can simply only return the fill_value and completely skip the diagonal matrix construction
   double fill_value = 1.0;
   if (this->m_Bound > 0)
   {
     fill_value = this->m_HessianFillValue[this->m_PreviousT];
   }
-#endif
-
-  // The following line constructs a new negated vector which is then
-  // copied to searchDir. The construction and copying can be avoided
-  // as searchDir is already allocated.
-  // searchDir = -gradient;
-  for (unsigned int j = 0; j < numberOfParameters; ++j)
-  {
-    searchDir[j] = -gradient[j];
-  }
-
-  int cp = static_cast<int>(this->m_CurrentT);
 
-  for (unsigned int i = 0; i < this->m_Bound; ++i)
-  {
-    --cp;
-    if (cp == -1)
-    {
-      cp = this->m_LBFGSMemory - 1;
-    }
-    const double sq = inner_product(this->m_S[cp], searchDir);
-    alpha[cp] = this->m_Rho[cp] * sq;
-    const double &         alpha_cp = alpha[cp];
-    const DerivativeType & y = this->m_Y[cp];
-    for (unsigned int j = 0; j < numberOfParameters; ++j)
-    {
-      searchDir[j] -= alpha_cp * y[j];
-    }
-  }
-
-  for (unsigned int j = 0; j < numberOfParameters; ++j)
-  {
-#if 0
-    searchDir[ j ] *= H0[ j ];
-#else
-    searchDir[j] *= fill_value;
-#endif
-  }
-
-  for (unsigned int i = 0; i < this->m_Bound; ++i)
-  {
-    const double           yr = inner_product(this->m_Y[cp], searchDir);
-    const double           beta = this->m_Rho[cp] * yr;
-    const double           alpha_min_beta = alpha[cp] - beta;
-    const ParametersType & s = this->m_S[cp];
-    for (unsigned int j = 0; j < numberOfParameters; ++j)
-    {
-      searchDir[j] += alpha_min_beta * s[j];
-    }
-    ++cp;
-    if (static_cast<unsigned int>(cp) == this->m_LBFGSMemory)
-    {
-      cp = 0;
-    }
-  }
+  this->m_History->ComputeSearchDirection(
+    gradient, this->m_Rho, this->m_CurrentT, this->m_Bound, fill_value, searchDir);
 
   /** Normalize if no information about previous steps is available yet */
   if (this->m_Bound == 0)
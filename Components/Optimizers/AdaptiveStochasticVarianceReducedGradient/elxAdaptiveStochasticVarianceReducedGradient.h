@@ -26,8 +26,9 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeJacobianTerms.h"
 #include "itkComputeDisplacementDistribution.h"
-#include "itkPlatformMultiThreader.h"
 #include "itkImageRandomSampler.h"
+#include "itkImageFullSampler.h"
+#include "itkThreadBudget.h"
 namespace elastix
 {
 /**
@@ -182,6 +183,18 @@ namespace elastix
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(NoiseCompensation "true")</tt>\n
  *   Default/recommended: true.
+ * \parameter UseFullSnapshotGradient: Whether the snapshot gradient of every outer iteration is
+ *   computed with a full sampler, instead of with NumberOfSpatialSamples random samples. The full
+ *   sampler passes its samples implicitly to the metric when the metric asks for it, see the
+ *   UseImplicitSamples parameter of the metric. The metric uses all threads for this gradient.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseFullSnapshotGradient "true")</tt>\n
+ *   Default: false.
+ * \parameter UseFloatSnapshotGradient: Whether the snapshot gradient is stored in single
+ *   precision, which saves a parameter-length vector of doubles for fine B-spline grids.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(UseFloatSnapshotGradient "true")</tt>\n
+ *   Default: false.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -294,7 +307,7 @@ public:
   /** Get the MaximumNumberOfSamplingAttempts. */
   itkGetConstReferenceMacro(MaximumNumberOfSamplingAttempts, SizeValueType);
 
-  /** Get the Previous gradient. */
+  /** Get the snapshot gradient. It is empty when the snapshot gradient is stored in single precision. */
   itkGetConstReferenceMacro(MeanGradient, DerivativeType);
 
   /** Type to count and reference number of threads */
@@ -304,7 +317,7 @@ public:
   void
   SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
   {
-    this->m_Threader->SetNumberOfWorkUnits(numberOfThreads);
+    this->Superclass1::SetNumberOfWorkUnits(numberOfThreads);
   }
 
 protected:
@@ -343,6 +356,10 @@ protected:
   typedef typename ImageRandomSamplerType::ImageSampleContainerType ImageRadomSampleContainerType;
   typedef typename ImageRadomSampleContainerType::Pointer           ImageRadomSampleContainerPointer;
 
+  /** Image full sampler, used for the snapshot gradient. */
+  typedef itk::ImageFullSampler<FixedImageType>  ImageFullSamplerType;
+  typedef typename ImageFullSamplerType::Pointer ImageFullSamplerPointer;
+
   /** Image grid sampler. */
   typedef itk::ImageGridSampler<FixedImageType>                   ImageGridSamplerType;
   typedef typename ImageGridSamplerType::Pointer                  ImageGridSamplerPointer;
@@ -433,6 +450,12 @@ protected:
   DerivativeType m_ExactGradient;
   DerivativeType m_MeanGradient;
 
+  /** The snapshot gradient in single precision, and the stochastic gradient
+   * at the snapshot position, that make up the control variate.
+   */
+  itk::Array<float> m_FloatMeanGradient;
+  DerivativeType    m_SnapshotStochasticGradient;
+
   double m_NoiseFactor;
 
 private:
@@ -479,6 +502,10 @@ private:
   bool m_OriginalButSigmoidToDefault;
   bool m_UseNoiseFactor;
 
+  /** The settings of the snapshot gradient. */
+  bool m_UseFullSnapshotGradient;
+  bool m_UseFloatSnapshotGradient;
+
 }; // end class AdaptiveStochasticVarianceReducedGradient
 
 
@@ -32,10 +32,6 @@
 #include "itkEventObject.h"
 #include "itkMacro.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 #ifdef ELASTIX_USE_EIGEN
 #  include <Eigen/Dense>
 #  include <Eigen/Core>
@@ -78,6 +74,8 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AdaptiveStochasticVarianceR
 
   this->m_UseNoiseCompensation = true;
   this->m_OriginalButSigmoidToDefault = false;
+  this->m_UseFullSnapshotGradient = false;
+  this->m_UseFloatSnapshotGradient = false;
 
   // this->m_LearningRate = 1.0;
 } // Constructor
@@ -146,6 +144,16 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::BeforeEachResolution(void)
     numberOfSpatialSamples, "NumberOfSpatialSamples", this->GetComponentLabel(), level, 0);
   this->m_NumberOfSpatialSamples = numberOfSpatialSamples;
 
+  /** Set whether the snapshot gradient is computed on all samples. */
+  this->m_UseFullSnapshotGradient = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_UseFullSnapshotGradient, "UseFullSnapshotGradient", this->GetComponentLabel(), level, 0);
+
+  /** Set whether the snapshot gradient is stored in single precision. */
+  this->m_UseFloatSnapshotGradient = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_UseFloatSnapshotGradient, "UseFloatSnapshotGradient", this->GetComponentLabel(), level, 0);
+
   /** Set the gain parameter A. */
   double A = 20.0;
   this->GetConfiguration()->ReadParameter(A, "SP_A", this->GetComponentLabel(), level, 0);
@@ -314,6 +322,13 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AfterEachIteration(void)
     this->SelectNewSamples();
   }
 
+  /** Stop when the metric value and the gradient magnitude do not decrease anymore. */
+  if (this->TestForConvergence(this->GetValue(), this->GetGradient().magnitude()))
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
 } // end AfterEachIteration()
 
 
@@ -332,7 +347,8 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AfterEachResolution(void)
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -346,6 +362,10 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AfterEachResolution(void)
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "The metric value and the gradient magnitude have converged";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -445,22 +465,33 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::AdvanceOneStep(void)
 {
   itkDebugMacro("AdvancedOneStep");
 
-  /** Get space dimension. */
-  const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
-
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  const double learningRate = this->GetLearningRate();
-  for (unsigned int j = 0; j < spaceDimension; ++j)
+  /** Update the position in place. In the inner loop, the variance reduced gradient
+   * is combined from the current stochastic gradient in m_Gradient, the stochastic
+   * gradient at the snapshot and the snapshot gradient in the same pass, and
+   * stored in m_Gradient again.
+   */
+  itk::ParameterUpdateKernel::ArgumentsType arguments;
+  arguments.m_NumberOfParameters = this->m_ScaledCurrentPosition.GetSize();
+  arguments.m_StepSize = this->GetLearningRate();
+  arguments.m_Gradient = this->m_Gradient.data_block();
+  arguments.m_Position = this->m_ScaledCurrentPosition.data_block();
+  if (this->m_SnapshotStochasticGradient.GetSize() == this->m_Gradient.GetSize())
   {
-    newPosition[j] = currentPosition[j] - learningRate * this->m_Gradient[j];
+    arguments.m_SearchDirection = this->m_Gradient.data_block();
+    arguments.m_SnapshotStochasticGradient = this->m_SnapshotStochasticGradient.data_block();
+    arguments.m_ControlVariateFactor = this->m_UseNoiseFactor ? this->m_NoiseFactor : 1.0;
+    if (this->m_UseFloatSnapshotGradient)
+    {
+      arguments.m_FloatSnapshotGradient = this->m_FloatMeanGradient.data_block();
+    }
+    else
+    {
+      arguments.m_SnapshotGradient = this->m_MeanGradient.data_block();
+    }
   }
 
+  this->m_ParameterUpdateKernel->Update(arguments);
+
   this->InvokeEvent(itk::IterationEvent());
 }
 
@@ -502,15 +533,32 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
 
   SizeValueType spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
+  /** The variance reduced gradient is combined in place in m_Gradient, during the
+   * update of the position. A single precision snapshot gradient is computed in
+   * m_Gradient first, so that no double precision copy of it is kept.
+   */
   this->m_Gradient = DerivativeType(spaceDimension); // check this
-  this->m_MeanGradient = DerivativeType(spaceDimension);
-  DerivativeType localCurrentGradient(spaceDimension);
-  DerivativeType localPreviousGradient(spaceDimension);
+  this->m_SnapshotStochasticGradient = DerivativeType(spaceDimension);
+  if (this->m_UseFloatSnapshotGradient)
+  {
+    this->m_MeanGradient = DerivativeType();
+    this->m_FloatMeanGradient = itk::Array<float>(spaceDimension);
+  }
+  else
+  {
+    this->m_MeanGradient = DerivativeType(spaceDimension);
+    this->m_FloatMeanGradient = itk::Array<float>();
+  }
+
+  /** Whether the noise factor is used in the control variate. */
+  this->m_UseNoiseFactor = true;
+  this->GetConfiguration()->ReadParameter(this->m_UseNoiseFactor, "UseNoiseFactor", this->GetComponentLabel(), 0, 0);
 
   const unsigned int M = this->GetElastix()->GetNumberOfMetrics();
 
   std::vector<ImageRandomSamplerBasePointer>    samplerVec(M);
   std::vector<ImageRandomSamplerPointer>        randomSamplerVec(M);
+  std::vector<ImageFullSamplerPointer>          fullSamplerVec(M);
   std::vector<ImageRandomSamplerPointer>        subRandomSamplerVec(M);
   std::vector<ImageRadomSampleContainerPointer> randomSampleContainer(M);
   /** set the number of samples. */
@@ -548,6 +596,21 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
       ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
       samplerVec[m] = dynamic_cast<ImageRandomSamplerBaseType *>(sampler.GetPointer());
 
+      if (this->m_UseFullSnapshotGradient)
+      {
+        /** The full sampler inherits the request of the metric for implicit samples,
+         * which is therefore passed on to the random samplers of the inner loop.
+         */
+        fullSamplerVec[m] = ImageFullSamplerType::New();
+        fullSamplerVec[m]->SetInput(samplerVec[m]->GetInput());
+        fullSamplerVec[m]->SetInputImageRegion(samplerVec[m]->GetInputImageRegion());
+        fullSamplerVec[m]->SetMask(samplerVec[m]->GetMask());
+        fullSamplerVec[m]->SetUseImplicitSamples(samplerVec[m]->GetUseImplicitSamples());
+        fullSamplerVec[m]->Update();
+        this->GetElastix()->GetElxMetricBase(m)->SetAdvancedMetricImageSampler(fullSamplerVec[m]);
+        continue;
+      }
+
       randomSamplerVec[m] = ImageRandomSamplerType::New();
       randomSamplerVec[m]->SetInput(samplerVec[m]->GetInput());
       randomSamplerVec[m]->SetInputImageRegion(samplerVec[m]->GetInputImageRegion());
@@ -566,8 +629,16 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
 
     timeCollector.Start("g1");
     this->GetRegistration()->GetAsITKBaseType()->GetModifiableMetric()->SetNumberOfWorkUnits(
-      this->GetRegistration()->GetAsITKBaseType()->GetMetric()->GetThreader()->GetGlobalDefaultNumberOfThreads());
-    this->GetScaledDerivativeWithExceptionHandling(previousPosition, this->m_MeanGradient);
+      itk::ThreadBudget::GetNumberOfThreads());
+    if (this->m_UseFloatSnapshotGradient)
+    {
+      this->GetScaledDerivativeWithExceptionHandling(previousPosition, this->m_Gradient);
+      std::copy(this->m_Gradient.begin(), this->m_Gradient.end(), this->m_FloatMeanGradient.begin());
+    }
+    else
+    {
+      this->GetScaledDerivativeWithExceptionHandling(previousPosition, this->m_MeanGradient);
+    }
     // this->GetScaledValueAndDerivative( this->GetScaledCurrentPosition() ,this->m_Value, this->m_PreviousGradient );
     timeCollector.Stop("g1");
 
@@ -582,8 +653,14 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
     //
     for (unsigned int m = 0; m < M; ++m)
     {
-      ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
-      samplerVec[m] = dynamic_cast<ImageRandomSamplerBaseType *>(sampler.GetPointer());
+      /** The full sampler is no random sampler, so then the sampler that was
+       * replaced by it is used to set up the new one.
+       */
+      if (!this->m_UseFullSnapshotGradient)
+      {
+        ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
+        samplerVec[m] = dynamic_cast<ImageRandomSamplerBaseType *>(sampler.GetPointer());
+      }
 
       subRandomSamplerVec[m] = ImageRandomSamplerType::New();
       //       subRandomSamplerVec[ m ]->SetInput( randomSamplerVec[ m ] ->GetInput());
@@ -593,6 +670,7 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
       subRandomSamplerVec[m]->SetInput(samplerVec[m]->GetInput());
       subRandomSamplerVec[m]->SetInputImageRegion(samplerVec[m]->GetInputImageRegion());
       subRandomSamplerVec[m]->SetMask(samplerVec[m]->GetMask());
+      subRandomSamplerVec[m]->SetUseImplicitSamples(samplerVec[m]->GetUseImplicitSamples());
 
       subRandomSamplerVec[m]->SetNumberOfSamples(this->m_NumberOfInnerLoopSamples);
       //      subRandomSamplerVec[ m ]-> SetRandomSampleContainer( randomSampleContainer[m], itp );
@@ -616,40 +694,11 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
 
       this->SelectNewSamples();
       timeCollector.Start("g23");
-      this->GetScaledDerivativeWithExceptionHandling(previousPosition, localPreviousGradient);
-      this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), this->m_Value, localCurrentGradient);
+      this->GetScaledDerivativeWithExceptionHandling(previousPosition, this->m_SnapshotStochasticGradient);
+      this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), this->m_Value, this->m_Gradient);
       timeCollector.Stop("g23");
 
-      timeCollector.Start("gvr");
-      // this->m_Gradient = localCurrentGradient - localPreviousGradient + this->m_PreviousGradient;
-      this->m_UseNoiseFactor = true;
-      this->GetConfiguration()->ReadParameter(
-        this->m_UseNoiseFactor, "UseNoiseFactor", this->GetComponentLabel(), 0, 0);
-
-      if (this->m_UseNoiseFactor)
-      {
-        //         for( unsigned int j = 0; j < spaceDimension; ++j )
-        //         {
-        //           this->m_Gradient[j] = this->m_NoiseFactor * (localCurrentGradient[j] - localPreviousGradient[j]) +
-        //           this->m_PreviousGradient[j];
-        //         }
-        for (unsigned int j = 0; j < spaceDimension; ++j)
-        {
-          this->m_Gradient[j] =
-            this->m_NoiseFactor * (localCurrentGradient[j] - localPreviousGradient[j]) + this->m_MeanGradient[j];
-        }
-      }
-      else
-      {
-        for (unsigned int j = 0; j < spaceDimension; ++j)
-        {
-          this->m_Gradient[j] = (localCurrentGradient[j] - localPreviousGradient[j]) + this->m_MeanGradient[j];
-          // this->m_Gradient[j] = this->m_PreviousGradient[j];
-        }
-      }
-
-      timeCollector.Stop("gvr");
-
+      /** The variance reduced gradient is combined by AdvanceOneStep. */
       timeCollector.Start("step");
       this->SetLearningRate(this->Superclass1::Compute_a(this->Superclass1::GetCurrentTime()));
       this->AdvanceOneStep();
@@ -658,6 +707,12 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>::ResumeOptimization(void)
       this->Superclass1::UpdateCurrentTime();
 
       this->m_CurrentInnerIteration++;
+
+      /** StopOptimization may have been called. */
+      if (this->m_Stop)
+      {
+        break;
+      }
       /** Preserve the previous position. */
     } // end inner forloop
 
@@ -19,7 +19,7 @@
 #define itkStochasticVarianceReducedGradientDescentOptimizer_h
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
-#include "itkPlatformMultiThreader.h"
+#include "itkParameterUpdateKernel.h"
 
 namespace itk
 {
@@ -74,8 +74,8 @@ public:
   typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
 
   /** Codes of stopping conditions
-   * The MinimumStepSize stop condition never occurs, but may
-   * be implemented in inheriting classes */
+   * The MinimumStepSize and ConvergenceDetected stop conditions never occur,
+   * but may be implemented in inheriting classes */
   typedef enum
   {
     MaximumNumberOfIterations,
@@ -83,7 +83,8 @@ public:
     MinimumStepSize,
     InvalidDiagonalMatrix,
     GradientMagnitudeTolerance,
-    LineSearchError
+    LineSearchError,
+    ConvergenceDetected
   } StopConditionType;
 
   /** Advance one step following the gradient direction. */
@@ -160,13 +161,8 @@ public:
   void
   SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
   {
-    this->m_Threader->SetNumberOfWorkUnits(numberOfThreads);
+    this->m_ParameterUpdateKernel->SetNumberOfWorkUnits(numberOfThreads);
   }
-  // itkGetConstReferenceMacro( NumberOfThreads, ThreadIdType );
-  itkSetMacro(UseMultiThread, bool);
-
-  itkSetMacro(UseOpenMP, bool);
-  itkSetMacro(UseEigen, bool);
 
 protected:
   StochasticVarianceReducedGradientDescentOptimizer();
@@ -174,10 +170,6 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
-  /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader ThreaderType;
-  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
-
   // made protected so subclass can access
   double         m_Value{ 0.0 };
   DerivativeType m_Gradient;
@@ -189,8 +181,10 @@ protected:
   StopConditionType m_StopCondition{ MaximumNumberOfIterations };
   DerivativeType    m_PreviousGradient;
   // DerivativeType                m_PrePreviousGradient;
-  ParametersType        m_PreviousPosition;
-  ThreaderType::Pointer m_Threader{ ThreaderType::New() };
+  ParametersType m_PreviousPosition;
+
+  /** The kernel that performs the update of the position. */
+  ParameterUpdateKernel::Pointer m_ParameterUpdateKernel{ ParameterUpdateKernel::New() };
 
   bool          m_Stop{ false };
   unsigned long m_NumberOfIterations{ 100 };
@@ -203,25 +197,6 @@ private:
   StochasticVarianceReducedGradientDescentOptimizer(const Self &) = delete;
   void
   operator=(const Self &) = delete;
-
-  // multi-threaded AdvanceOneStep:
-  bool m_UseMultiThread{ false };
-  struct MultiThreaderParameterType
-  {
-    ParametersType * t_NewPosition;
-    Self *           t_Optimizer;
-  };
-
-  bool m_UseOpenMP{ false };
-  bool m_UseEigen{ false };
-
-  /** The callback function. */
-  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
-  AdvanceOneStepThreaderCallback(void * arg);
-
-  /** The threaded implementation of AdvanceOneStep(). */
-  inline void
-  ThreadedAdvanceOneStep(ThreadIdType threadId, ParametersType & newPosition);
 };
 
 } // end namespace itk
@@ -106,7 +106,18 @@ namespace elastix
  *    covariance matrix is updated. If 0, the optimizer estimates a value. The actual value used is
  *    reported back in the elastix.log file. This parameter can be specified for each resolution. \n
  *    example: <tt>(UpdateBDPeriod 0 0 50)</tt> \n
- *    Default: 0 (so, automatically determined).
+ *    Default: 0 (so, automatically determined).\n
+ * \parameter ParallelEigenAnalysisThreshold: the number of parameters from which the
+ *    eigendecomposition of the covariance matrix is computed by the parallel Jacobi method.
+ *    If 0, it is always computed single-threaded. The result does not depend on the number
+ *    of threads. This parameter can be specified for each resolution. \n
+ *    example: <tt>(ParallelEigenAnalysisThreshold 32)</tt> \n
+ *    Default: 64.
+ *
+ * The offspring of an iteration are evaluated concurrently, each thread with its own copy
+ * of the metric, the transform and the interpolator, see the UseMultiThreadingForOptimizer
+ * parameter of the OptimizerBase. The random numbers are drawn before the evaluation, so the
+ * iterates do not depend on the number of threads.
  *
  * \ingroup Optimizers
  */
@@ -153,6 +164,9 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** The copies of the metric for the threads. */
+  typedef typename Superclass2::WorkUnitCostFunctionContainerType WorkUnitCostFunctionContainerType;
+
   /** Check if any scales are set, and set the UseScales flag on or off;
    * after that call the superclass' implementation */
   void
@@ -183,6 +197,14 @@ protected:
   void
   InitializeProgressVariables(void) override;
 
+  /** Create a copy of the metric for each thread, to evaluate the offspring concurrently. */
+  void
+  InitializeWorkUnitCostFunctions(void) override;
+
+  /** Update the image sampler that the copies of the metric share. */
+  void
+  BeforeConcurrentEvaluation(void) override;
+
 private:
   elxOverrideGetSelfMacro;
 
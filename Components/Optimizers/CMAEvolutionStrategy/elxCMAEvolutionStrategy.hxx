@@ -71,6 +71,7 @@ CMAEvolutionStrategy<TElastix>::InitializeProgressVariables(void)
          << "NumberOfParents = " << this->GetNumberOfParents() << "\n"
          << "UseCovarianceMatrixAdaptation = " << this->GetUseCovarianceMatrixAdaptation() << "\n"
          << "UpdateBDPeriod = " << this->GetUpdateBDPeriod() << "\n"
+         << "ParallelEigenAnalysisThreshold = " << this->GetParallelEigenAnalysisThreshold() << "\n"
          << std::endl;
 
 } // end InitializeProgressVariables
@@ -172,6 +173,12 @@ CMAEvolutionStrategy<TElastix>::BeforeEachResolution(void)
   this->m_Configuration->ReadParameter(updateBDPeriod, "UpdateBDPeriod", this->GetComponentLabel(), level, 0);
   this->SetUpdateBDPeriod(updateBDPeriod);
 
+  /** Set ParallelEigenAnalysisThreshold */
+  unsigned int parallelEigenAnalysisThreshold = 64;
+  this->m_Configuration->ReadParameter(
+    parallelEigenAnalysisThreshold, "ParallelEigenAnalysisThreshold", this->GetComponentLabel(), level, 0);
+  this->SetParallelEigenAnalysisThreshold(parallelEigenAnalysisThreshold);
+
   /** Set PositionToleranceMin */
   double positionToleranceMin = 1e-8;
   this->m_Configuration->ReadParameter(
@@ -296,6 +303,40 @@ CMAEvolutionStrategy<TElastix>::AfterRegistration(void)
 } // end AfterRegistration
 
 
+/**
+ * ******************* InitializeWorkUnitCostFunctions ***********************
+ */
+
+template <class TElastix>
+void
+CMAEvolutionStrategy<TElastix>::InitializeWorkUnitCostFunctions(void)
+{
+  /** Evaluate the offspring concurrently, when the metric can be copied for each thread. */
+  const WorkUnitCostFunctionContainerType copies = this->CreateWorkUnitCostFunctions(this->GetCostFunction());
+  this->SetWorkUnitCostFunctions(copies);
+  this->SetUseMultiThread(!copies.empty());
+  this->SetNumberOfWorkUnits(static_cast<itk::ThreadIdType>(copies.size()));
+
+  /** Call the superclass' implementation. */
+  this->Superclass1::InitializeWorkUnitCostFunctions();
+
+} // end InitializeWorkUnitCostFunctions
+
+
+/**
+ * ******************* BeforeConcurrentEvaluation ***********************
+ */
+
+template <class TElastix>
+void
+CMAEvolutionStrategy<TElastix>::BeforeConcurrentEvaluation(void)
+{
+  this->UpdateWorkUnitCostFunctions();
+
+} // end BeforeConcurrentEvaluation
+
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxCMAEvolutionStrategy_hxx
@@ -18,6 +18,7 @@
 
 #include "itkCMAEvolutionStrategyOptimizer.h"
 #include "itkSymmetricEigenAnalysis.h"
+#include "itkParallelJacobiEigenAnalysis.h"
 #include "vnl/vnl_math.h"
 #include <algorithm>
 #include <cmath>
@@ -84,6 +85,7 @@ CMAEvolutionStrategyOptimizer::PrintSelf(std::ostream & os, Indent indent) const
   os << indent << "m_PositionToleranceMin: " << this->m_PositionToleranceMin << std::endl;
   os << indent << "m_PositionToleranceMax: " << this->m_PositionToleranceMax << std::endl;
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "m_ParallelEigenAnalysisThreshold: " << this->m_ParallelEigenAnalysisThreshold << std::endl;
 
   os << indent << "m_RecombinationWeights: " << this->m_RecombinationWeights << std::endl;
   os << indent << "m_C: " << this->m_C << std::endl;
@@ -117,6 +119,7 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
 
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
+  this->InitializeWorkUnitCostFunctions();
 
   /** Set the current position as the scaled initial position */
   this->SetCurrentPosition(this->GetInitialPosition());
@@ -461,65 +464,117 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring(void)
   /** Clear the old values */
   this->m_CostFunctionValues.clear();
 
-  /** Fill the m_NormalizedSearchDirs and SearchDirs */
-  unsigned int lam = 0;
-  unsigned int nrOfFails = 0;
-  while (lam < lambda)
+  /** All offspring members have to be generated */
+  std::vector<unsigned int> offspring(lambda);
+  for (unsigned int lam = 0; lam < lambda; ++lam)
   {
-    /** draw from distribution N(0,I) */
-    for (unsigned int par = 0; par < N; ++par)
-    {
-      this->m_NormalizedSearchDirs[lam][par] = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if (this->GetUseCovarianceMatrixAdaptation())
-    {
-      this->m_SearchDirs[lam] = this->m_B * (this->m_D * this->m_NormalizedSearchDirs[lam]);
-    }
-    else
-    {
-      this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
-    }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[lam] *= this->m_CurrentSigma;
-
-    /** Compute the cost function */
-    MeasureType costFunctionValue = 0.0;
-    /** x_lam = m + d_lam */
-    ParametersType x_lam = this->GetScaledCurrentPosition();
-    x_lam += this->m_SearchDirs[lam];
-    try
+    offspring[lam] = lam;
+  }
+
+  std::vector<MeasureType>   values;
+  std::vector<unsigned char> succeeded;
+  std::vector<unsigned int>  failed;
+  ExceptionObject            lastError;
+  unsigned int               nrOfFails = 0;
+  while (!offspring.empty())
+  {
+    /** Fill the m_NormalizedSearchDirs and SearchDirs. The random numbers
+     * are drawn sequentially, so that the offspring does not depend on
+     * the parallel evaluation. */
+    for (const unsigned int lam : offspring)
     {
-      costFunctionValue = this->GetScaledValue(x_lam);
+      /** draw from distribution N(0,I) */
+      for (unsigned int par = 0; par < N; ++par)
+      {
+        this->m_NormalizedSearchDirs[lam][par] = this->m_RandomGenerator->GetNormalVariate();
+      }
+      /** Make like it was drawn from N(0,C) */
+      if (this->GetUseCovarianceMatrixAdaptation())
+      {
+        this->m_SearchDirs[lam] = this->m_B * (this->m_D * this->m_NormalizedSearchDirs[lam]);
+      }
+      else
+      {
+        this->m_SearchDirs[lam] = this->m_NormalizedSearchDirs[lam];
+      }
+      /** Make like it was drawn from N( 0, sigma^2 C ) */
+      this->m_SearchDirs[lam] *= this->m_CurrentSigma;
     }
-    catch (ExceptionObject & err)
+
+    /** Compute the cost function values */
+    this->EvaluateOffspring(offspring, values, succeeded, lastError);
+
+    /** Store the successful cost function evaluations */
+    failed.clear();
+    for (std::size_t k = 0; k < offspring.size(); ++k)
     {
-      ++nrOfFails;
-      /** try another parameter vector if we haven't tried that for 10 times already */
-      if (nrOfFails <= 10)
+      if (succeeded[k])
       {
-        continue;
+        this->m_CostFunctionValues.push_back(MeasureIndexPairType(values[k], offspring[k]));
       }
       else
       {
-        this->m_StopCondition = MetricError;
-        this->StopOptimization();
-        throw err;
+        failed.push_back(offspring[k]);
       }
     }
-    /** Successfull cost function evaluation */
-    this->m_CostFunctionValues.push_back(MeasureIndexPairType(costFunctionValue, lam));
 
-    /** Reset the number of failed cost function evaluations */
-    nrOfFails = 0;
-
-    /** next offspring member */
-    ++lam;
+    /** Try other parameter vectors for the failed offspring members,
+     * if we haven't tried that for 10 times in a row already */
+    if (failed.empty())
+    {
+      nrOfFails = 0;
+    }
+    else if (++nrOfFails > 10)
+    {
+      this->m_StopCondition = MetricError;
+      this->StopOptimization();
+      throw lastError;
+    }
+    offspring.swap(failed);
   }
 
 } // end GenerateOffspring
 
 
+/**
+ * ****************** EvaluateOffspring *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::EvaluateOffspring(const std::vector<unsigned int> & offspring,
+                                                 std::vector<MeasureType> &         values,
+                                                 std::vector<unsigned char> &       succeeded,
+                                                 ExceptionObject &                  lastError)
+{
+  itkDebugMacro("EvaluateOffspring");
+
+  const std::size_t numberOfOffspring = offspring.size();
+  values.assign(numberOfOffspring, 0.0);
+  succeeded.assign(numberOfOffspring, 0);
+
+  /** x_lam = m + d_lam */
+  std::vector<ParametersType> positions(numberOfOffspring, this->GetScaledCurrentPosition());
+  for (std::size_t k = 0; k < numberOfOffspring; ++k)
+  {
+    positions[k] += this->m_SearchDirs[offspring[k]];
+  }
+
+  std::vector<unsigned char>   failed;
+  std::vector<ExceptionObject> errors;
+  this->EvaluateScaledValues(positions, values, failed, errors);
+
+  for (std::size_t k = 0; k < numberOfOffspring; ++k)
+  {
+    succeeded[k] = !failed[k];
+    if (failed[k])
+    {
+      lastError = errors[k];
+    }
+  }
+
+} // end EvaluateOffspring
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
@@ -569,9 +624,8 @@ CMAEvolutionStrategyOptimizer::AdvanceOneStep(void)
   }
 
   /** Set the new current position */
-  ParametersType newPos = this->GetScaledCurrentPosition();
-  newPos += this->GetCurrentScaledStep();
-  this->SetScaledCurrentPosition(newPos);
+  this->m_ScaledCurrentPosition += this->GetCurrentScaledStep();
+  this->Modified();
 
   /** Compute the cost function at the new position */
   try
@@ -790,22 +844,40 @@ CMAEvolutionStrategyOptimizer::UpdateBD(void)
     return;
   }
 
-  typedef itk::SymmetricEigenAnalysis<CovarianceMatrixType, EigenValueMatrixType, CovarianceMatrixType>
-    EigenAnalysisType;
-
-  /** In the itkEigenAnalysis only the upper triangle of the matrix will be accessed, so
-   * we do not need to make sure the matrix is symmetric, like in the
-   * matlab code. Just run the eigenAnalysis! */
-  EigenAnalysisType eigenAnalysis(N);
-  unsigned int      returncode = 0;
-  returncode = eigenAnalysis.ComputeEigenValuesAndVectors(this->m_C, this->m_D, this->m_B);
-  if (returncode != 0)
+  if (this->m_ParallelEigenAnalysisThreshold > 0 && N >= this->m_ParallelEigenAnalysisThreshold)
   {
-    itkExceptionMacro(<< "EigenAnalysis failed while computing eigenvalue nr: " << returncode);
+    /** The parallel Jacobi method returns the eigen vectors in columns, and reads only the upper triangle. */
+    ParallelJacobiEigenAnalysis::VectorType eigenValues;
+    ParallelJacobiEigenAnalysis::MatrixType eigenVectors;
+    if (!ParallelJacobiEigenAnalysis::ComputeEigenValuesAndVectors(this->m_C, eigenValues, eigenVectors))
+    {
+      itkExceptionMacro(<< "The parallel Jacobi eigen analysis did not converge.");
+    }
+    for (unsigned int i = 0; i < N; ++i)
+    {
+      this->m_D[i] = eigenValues[i];
+    }
+    this->m_B = eigenVectors;
   }
+  else
+  {
+    typedef itk::SymmetricEigenAnalysis<CovarianceMatrixType, EigenValueMatrixType, CovarianceMatrixType>
+      EigenAnalysisType;
+
+    /** In the itkEigenAnalysis only the upper triangle of the matrix will be accessed, so
+     * we do not need to make sure the matrix is symmetric, like in the
+     * matlab code. Just run the eigenAnalysis! */
+    EigenAnalysisType eigenAnalysis(N);
+    unsigned int      returncode = 0;
+    returncode = eigenAnalysis.ComputeEigenValuesAndVectors(this->m_C, this->m_D, this->m_B);
+    if (returncode != 0)
+    {
+      itkExceptionMacro(<< "EigenAnalysis failed while computing eigenvalue nr: " << returncode);
+    }
 
-  /** itk eigen analysis returns eigen vectors in rows... */
-  this->m_B.inplace_transpose();
+    /** itk eigen analysis returns eigen vectors in rows... */
+    this->m_B.inplace_transpose();
+  }
 
   /**  limit condition of C to 1e10 + 1, and avoid negative eigenvalues */
   const double largeNumber = 1e10;
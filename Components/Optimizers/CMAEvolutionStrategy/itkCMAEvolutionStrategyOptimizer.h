@@ -19,7 +19,7 @@
 #ifndef itkCMAEvolutionStrategyOptimizer_h
 #define itkCMAEvolutionStrategyOptimizer_h
 
-#include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkParallelEvaluationOptimizer.h"
 #include <vector>
 #include <utility>
 #include <deque>
@@ -43,19 +43,24 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * The cost function values of the offspring are independent, and are evaluated
+ * as one batch, see ParallelEvaluationOptimizer.
+ * The eigendecomposition of the covariance matrix of many parameters is computed in
+ * parallel, see ParallelEigenAnalysisThreshold.
+ *
  * \ingroup Numerics Optimizers
  */
 
-class CMAEvolutionStrategyOptimizer : public ScaledSingleValuedNonLinearOptimizer
+class CMAEvolutionStrategyOptimizer : public ParallelEvaluationOptimizer
 {
 public:
-  typedef CMAEvolutionStrategyOptimizer        Self;
-  typedef ScaledSingleValuedNonLinearOptimizer Superclass;
-  typedef SmartPointer<Self>                   Pointer;
-  typedef SmartPointer<const Self>             ConstPointer;
+  typedef CMAEvolutionStrategyOptimizer Self;
+  typedef ParallelEvaluationOptimizer   Superclass;
+  typedef SmartPointer<Self>            Pointer;
+  typedef SmartPointer<const Self>      ConstPointer;
 
   itkNewMacro(Self);
-  itkTypeMacro(CMAEvolutionStrategyOptimizer, ScaledSingleValuedNonLinearOptimizer);
+  itkTypeMacro(CMAEvolutionStrategyOptimizer, ParallelEvaluationOptimizer);
 
   typedef Superclass::ParametersType         ParametersType;
   typedef Superclass::DerivativeType         DerivativeType;
@@ -64,6 +69,9 @@ public:
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
 
+  typedef CostFunctionType::Pointer               CostFunctionPointer;
+  typedef Superclass::CostFunctionContainerType CostFunctionContainerType;
+
   typedef enum
   {
     MetricError,
@@ -198,6 +206,15 @@ public:
   itkSetMacro(UpdateBDPeriod, unsigned int);
   itkGetConstMacro(UpdateBDPeriod, unsigned int);
 
+  /** Setting: the number of parameters from which the eigendecomposition of the covariance
+   * matrix is computed by the parallel Jacobi method, see ParallelJacobiEigenAnalysis, which
+   * divides the work over the threads. Smaller matrices are decomposed single-threaded by the
+   * SymmetricEigenAnalysis. The result does not depend on the number of threads. If 0, the
+   * parallel Jacobi method is never used.
+   * Default: 64 */
+  itkSetMacro(ParallelEigenAnalysisThreshold, unsigned int);
+  itkGetConstMacro(ParallelEigenAnalysisThreshold, unsigned int);
+
   /** Setting: convergence condition: the minimum step size.
    * convergence is declared if:
    * if ( sigma * max( abs(p_c[i]), sqrt(C[i,i]) ) < PositionToleranceMin*sigma0  for all i )
@@ -364,6 +381,15 @@ protected:
   virtual void
   GenerateOffspring(void);
 
+  /** Compute the cost function values of the given offspring members, at
+   * \f$x_i = m + d_i\f$. Evaluations that throw an exception are flagged
+   * as failed, and the last exception is returned in lastError. */
+  virtual void
+  EvaluateOffspring(const std::vector<unsigned int> & offspring,
+                    std::vector<MeasureType> &         values,
+                    std::vector<unsigned char> &       succeeded,
+                    ExceptionObject &                  lastError);
+
   /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
   virtual void
   SortCostFunctionValues(void);
@@ -438,6 +464,7 @@ private:
   double        m_PositionToleranceMax{ 1e8 };
   double        m_PositionToleranceMin{ 1e-12 };
   double        m_ValueTolerance{ 1e-12 };
+  unsigned int  m_ParallelEigenAnalysisThreshold{ 64 };
 };
 
 } // end namespace itk
@@ -63,6 +63,12 @@ namespace elastix
  *    itk::MoreThuenteLineSearchOptimizer tries to satisfy.\n
  *    example: <tt>(LineSearchGradientTolerance 0.9 0.9 0.9)</tt> \n
  *    Default value: 0.9.\n
+ * \parameter LineSearchUseValueOnlyProbes: Whether the itk::MoreThuenteLineSearchOptimizer
+ *    first computes only the metric value at a trial step, and skips the derivative
+ *    when the step overshoots the minimum. This pays off when the value is much
+ *    cheaper than the derivative.\n
+ *    example: <tt>(LineSearchUseValueOnlyProbes "true" "true" "false")</tt> \n
+ *    Default value: "false".\n
  * \parameter ValueTolerance: Stopping criterion. See the documentation of the
  *    itk::GenericConjugateGradientOptimizer for more information.\n
  *    example: <tt>(ValueTolerance 0.001 0.0001 0.000001)</tt> \n
@@ -185,7 +191,7 @@ protected:
    * is printed, but ignored further. The optimizer stops, but elastix
    * just goes on to the next resolution. */
   void
-  LineSearch(const ParametersType searchDir, double & step, ParametersType & x, MeasureType & f, DerivativeType & g)
+  LineSearch(const ParametersType & searchDir, double & step, ParametersType & x, MeasureType & f, DerivativeType & g)
     override;
 
 private:
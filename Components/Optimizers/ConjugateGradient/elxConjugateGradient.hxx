@@ -112,11 +112,11 @@ ConjugateGradient<TElastix>::StartOptimization(void)
 
 template <class TElastix>
 void
-ConjugateGradient<TElastix>::LineSearch(const ParametersType searchDir,
-                                        double &             step,
-                                        ParametersType &     x,
-                                        MeasureType &        f,
-                                        DerivativeType &     g)
+ConjugateGradient<TElastix>::LineSearch(const ParametersType & searchDir,
+                                        double &               step,
+                                        ParametersType &       x,
+                                        MeasureType &          f,
+                                        DerivativeType &       g)
 {
   /** Call the superclass's implementation and ignore a
    * LineSearchError. Just report the error and assume convergence. */
@@ -250,6 +250,12 @@ ConjugateGradient<TElastix>::BeforeEachResolution(void)
     lineSearchGradientTolerance, "LineSearchGradientTolerance", this->GetComponentLabel(), level, 0);
   this->m_LineOptimizer->SetGradientTolerance(lineSearchGradientTolerance);
 
+  /** Set whether the line search uses value-only probes */
+  bool lineSearchUseValueOnlyProbes = false;
+  this->m_Configuration->ReadParameter(
+    lineSearchUseValueOnlyProbes, "LineSearchUseValueOnlyProbes", this->GetComponentLabel(), level, 0);
+  this->m_LineOptimizer->SetUseValueOnlyProbes(lineSearchUseValueOnlyProbes);
+
   /** Set the GradientMagnitudeTolerance */
   double gradientMagnitudeTolerance = 0.000001;
   this->m_Configuration->ReadParameter(
@@ -100,8 +100,8 @@ GenericConjugateGradientOptimizer::ResumeOptimization()
   const double TINY_NUMBER = 1e-20;
   unsigned int limitCount = 0;
 
+  /** The vectors are allocated once, and reused in every iteration. */
   ParametersType searchDir;
-  ParametersType previousSearchDir;
   DerivativeType previousGradient;
   MeasureType    previousValue;
 
@@ -128,9 +128,6 @@ GenericConjugateGradientOptimizer::ResumeOptimization()
   /** Start iterating */
   while (!this->m_Stop)
   {
-    /** Store the current search direction */
-    previousSearchDir = searchDir;
-
     /** Compute the new search direction */
     this->ComputeSearchDirection(previousGradient, this->GetCurrentGradient(), searchDir);
 
@@ -235,7 +232,9 @@ GenericConjugateGradientOptimizer::ComputeSearchDirection(const DerivativeType &
    * available, return the negative gradient as search direction */
   if (!this->m_PreviousGradientAndSearchDirValid)
   {
-    searchDir = -gradient;
+    searchDir.SetSize(numberOfParameters);
+    this->m_ParameterUpdateKernel->UpdateSearchDirection(
+      numberOfParameters, 0.0, gradient.data_block(), searchDir.data_block());
     return;
   }
 
@@ -249,10 +248,8 @@ GenericConjugateGradientOptimizer::ComputeSearchDirection(const DerivativeType &
   }
 
   /** Compute the new search direction */
-  for (unsigned int i = 0; i < numberOfParameters; ++i)
-  {
-    searchDir[i] = -gradient[i] + beta * searchDir[i];
-  }
+  this->m_ParameterUpdateKernel->UpdateSearchDirection(
+    numberOfParameters, beta, gradient.data_block(), searchDir.data_block());
 
 } // end ComputeSearchDirection
 
@@ -266,11 +263,11 @@ GenericConjugateGradientOptimizer::ComputeSearchDirection(const DerivativeType &
  */
 
 void
-GenericConjugateGradientOptimizer::LineSearch(const ParametersType searchDir,
-                                              double &             step,
-                                              ParametersType &     x,
-                                              MeasureType &        f,
-                                              DerivativeType &     g)
+GenericConjugateGradientOptimizer::LineSearch(const ParametersType & searchDir,
+                                              double &               step,
+                                              ParametersType &       x,
+                                              MeasureType &          f,
+                                              DerivativeType &       g)
 {
 
   itkDebugMacro("LineSearch");
@@ -362,27 +359,10 @@ GenericConjugateGradientOptimizer::ComputeBetaSD(const DerivativeType & itkNotUs
 double
 GenericConjugateGradientOptimizer::ComputeBetaFR(const DerivativeType & previousGradient,
                                                  const DerivativeType & gradient,
-                                                 const ParametersType & itkNotUsed(previousSearchDir))
+                                                 const ParametersType & previousSearchDir)
 {
-  const unsigned int numberOfParameters = gradient.GetSize();
-  double             num = 0.0;
-  double             den = 0.0;
-
-  for (unsigned int i = 0; i < numberOfParameters; ++i)
-  {
-    const double & grad = gradient[i];
-    const double & prevgrad = previousGradient[i];
-    num += grad * grad;
-    den += prevgrad * prevgrad;
-  }
-
-  if (den <= NumericTraits<double>::epsilon())
-  {
-    this->m_StopCondition = InfiniteBeta;
-    this->StopOptimization();
-    return 0.0;
-  }
-  return num / den;
+  const InnerProductsType products = this->ComputeInnerProducts(previousGradient, gradient, previousSearchDir);
+  return this->DivideBeta(products.m_GradientGradient, products.m_PreviousGradientPreviousGradient);
 
 } // end ComputeBetaFR
 
@@ -394,27 +374,10 @@ GenericConjugateGradientOptimizer::ComputeBetaFR(const DerivativeType & previous
 double
 GenericConjugateGradientOptimizer::ComputeBetaPR(const DerivativeType & previousGradient,
                                                  const DerivativeType & gradient,
-                                                 const ParametersType & itkNotUsed(previousSearchDir))
+                                                 const ParametersType & previousSearchDir)
 {
-  const unsigned int numberOfParameters = gradient.GetSize();
-  double             num = 0.0;
-  double             den = 0.0;
-
-  for (unsigned int i = 0; i < numberOfParameters; ++i)
-  {
-    const double & grad = gradient[i];
-    const double & prevgrad = previousGradient[i];
-    num += grad * (grad - prevgrad);
-    den += prevgrad * prevgrad;
-  }
-
-  if (den <= NumericTraits<double>::epsilon())
-  {
-    this->m_StopCondition = InfiniteBeta;
-    this->StopOptimization();
-    return 0.0;
-  }
-  return num / den;
+  const InnerProductsType products = this->ComputeInnerProducts(previousGradient, gradient, previousSearchDir);
+  return this->DivideBeta(products.m_GradientGradientChange, products.m_PreviousGradientPreviousGradient);
 
 } // end ComputeBetaPR
 
@@ -428,24 +391,8 @@ GenericConjugateGradientOptimizer::ComputeBetaDY(const DerivativeType & previous
                                                  const DerivativeType & gradient,
                                                  const ParametersType & previousSearchDir)
 {
-  const unsigned int numberOfParameters = gradient.GetSize();
-  double             num = 0.0;
-  double             den = 0.0;
-
-  for (unsigned int i = 0; i < numberOfParameters; ++i)
-  {
-    const double & grad = gradient[i];
-    num += grad * grad;
-    den += previousSearchDir[i] * (grad - previousGradient[i]);
-  }
-
-  if (den <= NumericTraits<double>::epsilon())
-  {
-    this->m_StopCondition = InfiniteBeta;
-    this->StopOptimization();
-    return 0.0;
-  }
-  return num / den;
+  const InnerProductsType products = this->ComputeInnerProducts(previousGradient, gradient, previousSearchDir);
+  return this->DivideBeta(products.m_GradientGradient, products.m_SearchDirectionGradientChange);
 } // end ComputeBetaDY
 
 
@@ -458,25 +405,8 @@ GenericConjugateGradientOptimizer::ComputeBetaHS(const DerivativeType & previous
                                                  const DerivativeType & gradient,
                                                  const ParametersType & previousSearchDir)
 {
-  const unsigned int numberOfParameters = gradient.GetSize();
-  double             num = 0.0;
-  double             den = 0.0;
-
-  for (unsigned int i = 0; i < numberOfParameters; ++i)
-  {
-    const double & diff = gradient[i] - previousGradient[i];
-    num += gradient[i] * diff;
-    den += previousSearchDir[i] * diff;
-  }
-
-  if (den <= NumericTraits<double>::epsilon())
-  {
-    this->m_StopCondition = InfiniteBeta;
-    this->StopOptimization();
-    return 0.0;
-  }
-
-  return num / den;
+  const InnerProductsType products = this->ComputeInnerProducts(previousGradient, gradient, previousSearchDir);
+  return this->DivideBeta(products.m_GradientGradientChange, products.m_SearchDirectionGradientChange);
 } // end ComputeBetaHS
 
 
@@ -489,15 +419,52 @@ GenericConjugateGradientOptimizer::ComputeBetaDYHS(const DerivativeType & previo
                                                    const DerivativeType & gradient,
                                                    const ParametersType & previousSearchDir)
 {
-  const double beta_DY = this->ComputeBetaDY(previousGradient, gradient, previousSearchDir);
+  /** Both definitions follow from the same inner products, computed in one pass. */
+  const InnerProductsType products = this->ComputeInnerProducts(previousGradient, gradient, previousSearchDir);
+
+  const double beta_DY = this->DivideBeta(products.m_GradientGradient, products.m_SearchDirectionGradientChange);
 
-  const double beta_HS = this->ComputeBetaHS(previousGradient, gradient, previousSearchDir);
+  const double beta_HS =
+    this->DivideBeta(products.m_GradientGradientChange, products.m_SearchDirectionGradientChange);
 
   return std::max(0.0, std::min(beta_DY, beta_HS));
 
 } // end ComputeBetaDYHS
 
 
+/**
+ * ********************** ComputeInnerProducts ***************************
+ */
+
+GenericConjugateGradientOptimizer::InnerProductsType
+GenericConjugateGradientOptimizer::ComputeInnerProducts(const DerivativeType & previousGradient,
+                                                        const DerivativeType & gradient,
+                                                        const ParametersType & previousSearchDir) const
+{
+  return this->m_ParameterUpdateKernel->ComputeConjugateGradientInnerProducts(
+    gradient.GetSize(), gradient.data_block(), previousGradient.data_block(), previousSearchDir.data_block());
+
+} // end ComputeInnerProducts
+
+
+/**
+ * ********************** DivideBeta ***************************
+ */
+
+double
+GenericConjugateGradientOptimizer::DivideBeta(const double num, const double den)
+{
+  if (den <= NumericTraits<double>::epsilon())
+  {
+    this->m_StopCondition = InfiniteBeta;
+    this->StopOptimization();
+    return 0.0;
+  }
+  return num / den;
+
+} // end DivideBeta
+
+
 /**
  * *********************** SetBetaDefinition **************************
  */
@@ -563,8 +530,12 @@ GenericConjugateGradientOptimizer::TestConvergence(bool itkNotUsed(firstLineSear
   }
 
   /** Check for convergence of gradient magnitude */
-  const double gnorm = this->GetCurrentGradient().magnitude();
-  const double xnorm = this->GetScaledCurrentPosition().magnitude();
+  const DerivativeType & gradient = this->GetCurrentGradient();
+  const ParametersType & position = this->GetScaledCurrentPosition();
+  const double           gnorm = std::sqrt(
+    this->m_ParameterUpdateKernel->InnerProduct(gradient.GetSize(), gradient.data_block(), gradient.data_block()));
+  const double xnorm = std::sqrt(
+    this->m_ParameterUpdateKernel->InnerProduct(position.GetSize(), position.data_block(), position.data_block()));
   if (gnorm / std::max(1.0, xnorm) <= this->GetGradientMagnitudeTolerance())
   {
     this->m_StopCondition = GradientMagnitudeTolerance;
@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkLineSearchOptimizer.h"
+#include "itkParameterUpdateKernel.h"
 #include <vector>
 #include <map>
 
@@ -33,6 +34,9 @@ namespace itk
  * The steplength is determined at each iteration by means of a
  * line search routine. The itk::MoreThuenteLineSearchOptimizer works well.
  *
+ * The inner products and the update of the search direction are performed
+ * by an itk::ParameterUpdateKernel, which uses multiple threads for large
+ * numbers of parameters.
  *
  * \ingroup Numerics Optimizers
  */
@@ -198,7 +202,7 @@ protected:
    * the derivative. On return the step, \f$x\f$ (new position), \f$f\f$ (value at \f$x\f$), and \f$g\f$
    * (derivative at \f$x\f$) are updated. */
   virtual void
-  LineSearch(const ParametersType searchDir, double & step, ParametersType & x, MeasureType & f, DerivativeType & g);
+  LineSearch(const ParametersType & searchDir, double & step, ParametersType & x, MeasureType & f, DerivativeType & g);
 
   /** Check if convergence has occured;
    * The firstLineSearchDone bool allows the implementation of TestConvergence to
@@ -213,6 +217,23 @@ protected:
               const DerivativeType & gradient,
               const ParametersType & previousSearchDir);
 
+  /** The inner products needed by the definitions of \f$\beta\f$. */
+  typedef ParameterUpdateKernel::ConjugateGradientInnerProductsType InnerProductsType;
+
+  /** Compute all inner products needed by the definitions of \f$\beta\f$ in one pass. */
+  InnerProductsType
+  ComputeInnerProducts(const DerivativeType & previousGradient,
+                       const DerivativeType & gradient,
+                       const ParametersType & previousSearchDir) const;
+
+  /** Return num / den, or stop the optimization with an InfiniteBeta stop condition
+   * if den is too small. */
+  double
+  DivideBeta(const double num, const double den);
+
+  /** The kernel that performs the operations on the parameter vectors. */
+  ParameterUpdateKernel::Pointer m_ParameterUpdateKernel{ ParameterUpdateKernel::New() };
+
   /** Different definitions of \f$\beta\f$ */
 
   /** "SteepestDescent: beta=0 */
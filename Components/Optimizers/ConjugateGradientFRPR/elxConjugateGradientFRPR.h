@@ -20,6 +20,7 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkFRPROptimizer.h"
+#include "itkParameterUpdateKernel.h"
 
 namespace elastix
 {
@@ -157,6 +158,9 @@ protected:
   /** the current gain */
   double m_CurrentStepLength;
 
+  /** Computes the magnitudes of the derivative and the search direction, threaded. */
+  itk::ParameterUpdateKernel::Pointer m_ParameterUpdateKernel{ itk::ParameterUpdateKernel::New() };
+
   /** Set if the optimizer is currently bracketing the minimum, or is
    * optimizing along a line */
   itkSetMacro(LineOptimizing, bool);
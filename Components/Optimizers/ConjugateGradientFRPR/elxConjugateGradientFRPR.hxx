@@ -296,7 +296,8 @@ ConjugateGradientFRPR<TElastix>::GetValueAndDerivative(ParametersType p, double
   }
 
   this->Superclass1::GetValueAndDerivative(p, val, xi);
-  this->m_CurrentDerivativeMagnitude = (*xi).magnitude();
+  this->m_CurrentDerivativeMagnitude =
+    std::sqrt(this->m_ParameterUpdateKernel->InnerProduct(xi->GetSize(), xi->data_block(), xi->data_block()));
 
 } // end GetValueAndDerivative
 
@@ -363,7 +364,8 @@ template <class TElastix>
 void
 ConjugateGradientFRPR<TElastix>::LineOptimize(ParametersType * p, ParametersType xi, double * val)
 {
-  this->m_CurrentSearchDirectionMagnitude = xi.magnitude();
+  this->m_CurrentSearchDirectionMagnitude =
+    std::sqrt(this->m_ParameterUpdateKernel->InnerProduct(xi.GetSize(), xi.data_block(), xi.data_block()));
   this->Superclass1::LineOptimize(p, xi, val);
 } // end LineOptimize
 
@@ -70,7 +70,10 @@ namespace elastix
  *   This flag can NOT be defined for each resolution. \n
  *   example: <tt>(ShowMetricValues "true" )</tt> \n
  *   Default value: "false". Note that turning this flag on increases computation time.
-
+ *
+ * The \f$2N\f$ perturbed positions of an iteration are evaluated concurrently, each thread
+ * with its own copy of the metric, the transform and the interpolator, see the
+ * UseMultiThreadingForOptimizer parameter of the OptimizerBase.
  *
  * \ingroup Optimizers
  * \sa FiniteDifferenceGradientDescentOptimizer
@@ -115,6 +118,9 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** The copies of the metric for the threads. */
+  typedef typename Superclass2::WorkUnitCostFunctionContainerType WorkUnitCostFunctionContainerType;
+
   /** Typedef for the ParametersType. */
   typedef typename Superclass1::ParametersType ParametersType;
 
@@ -143,6 +149,15 @@ protected:
   FiniteDifferenceGradientDescent();
   ~FiniteDifferenceGradientDescent() override = default;
 
+  /** Create a copy of the metric for each thread, to evaluate the perturbed positions
+   * concurrently. */
+  void
+  InitializeWorkUnitCostFunctions(void) override;
+
+  /** Update the image sampler that the copies of the metric share. */
+  void
+  BeforeConcurrentEvaluation(void) override;
+
   bool m_ShowMetricValues;
 
 private:
@@ -233,6 +233,39 @@ FiniteDifferenceGradientDescent<TElastix>::StartOptimization(void)
 } // end StartOptimization
 
 
+/**
+ * ************ InitializeWorkUnitCostFunctions *****************
+ */
+
+template <class TElastix>
+void
+FiniteDifferenceGradientDescent<TElastix>::InitializeWorkUnitCostFunctions(void)
+{
+  /** Evaluate the perturbed positions concurrently, when the metric can be copied for each thread. */
+  const WorkUnitCostFunctionContainerType copies = this->CreateWorkUnitCostFunctions(this->GetCostFunction());
+  this->SetWorkUnitCostFunctions(copies);
+  this->SetUseMultiThread(!copies.empty());
+  this->SetNumberOfWorkUnits(static_cast<itk::ThreadIdType>(copies.size()));
+
+  /** Call the superclass' implementation. */
+  this->Superclass1::InitializeWorkUnitCostFunctions();
+
+} // end InitializeWorkUnitCostFunctions()
+
+
+/**
+ * ************ BeforeConcurrentEvaluation *****************
+ */
+
+template <class TElastix>
+void
+FiniteDifferenceGradientDescent<TElastix>::BeforeConcurrentEvaluation(void)
+{
+  this->UpdateWorkUnitCostFunctions();
+
+} // end BeforeConcurrentEvaluation()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFiniteDifferenceGradientDescent_hxx
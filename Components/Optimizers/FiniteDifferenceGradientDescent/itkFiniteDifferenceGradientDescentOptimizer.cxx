@@ -74,6 +74,7 @@ FiniteDifferenceGradientDescentOptimizer::StartOptimization(void)
 
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
+  this->InitializeWorkUnitCostFunctions();
 
   /** Set the current position as the scaled initial position */
   this->SetCurrentPosition(this->GetInitialPosition());
@@ -99,9 +100,9 @@ FiniteDifferenceGradientDescentOptimizer::ResumeOptimization(void)
   double       ck = 1.0;
   unsigned int spaceDimension = 1;
 
-  ParametersType param;
-  double         valueplus;
-  double         valuemin;
+  ParametersType              param;
+  std::vector<ParametersType> positions;
+  std::vector<MeasureType>    values;
 
   InvokeEvent(StartEvent());
   while (!this->m_Stop)
@@ -146,35 +147,26 @@ FiniteDifferenceGradientDescentOptimizer::ResumeOptimization(void)
       }
     } // if m_ComputeCurrentValue
 
-    double sumOfSquaredGradients = 0.0;
-    /** Calculate the derivative; this may take a while... */
-    try
+    /** The positions x_j + c_k and x_j - c_k, for all parameters j. */
+    positions.assign(2 * spaceDimension, param);
+    for (unsigned int j = 0; j < spaceDimension; ++j)
     {
-      for (unsigned int j = 0; j < spaceDimension; ++j)
-      {
-        param[j] += ck;
-        valueplus = this->GetScaledValue(param);
-        param[j] -= 2.0 * ck;
-        valuemin = this->GetScaledValue(param);
-        param[j] += ck;
-
-        const double gradient = (valueplus - valuemin) / (2.0 * ck);
-        this->m_Gradient[j] = gradient;
+      positions[2 * j][j] += ck;
+      positions[2 * j + 1][j] -= ck;
+    }
 
-        sumOfSquaredGradients += (gradient * gradient);
+    /** Calculate the derivative; this may take a while... */
+    this->EvaluatePositions(positions, values);
 
-      } // for j = 0 .. spaceDimension
-    }
-    catch (ExceptionObject & err)
+    double sumOfSquaredGradients = 0.0;
+    for (unsigned int j = 0; j < spaceDimension; ++j)
     {
-      // An exception has occurred.
-      // Terminate immediately.
-      this->m_StopCondition = MetricError;
-      StopOptimization();
+      const double gradient = (values[2 * j] - values[2 * j + 1]) / (2.0 * ck);
+      this->m_Gradient[j] = gradient;
 
-      // Pass exception to caller
-      throw err;
-    }
+      sumOfSquaredGradients += (gradient * gradient);
+
+    } // for j = 0 .. spaceDimension
 
     if (m_Stop)
     {
@@ -226,21 +218,45 @@ FiniteDifferenceGradientDescentOptimizer::AdvanceOneStep(void)
   /** Save it for users that are interested */
   this->m_LearningRate = ak;
 
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  ParametersType newPosition(spaceDimension);
+  /** Update the position in place, without allocating a new parameters array. */
+  ParametersType & currentPosition = this->m_ScaledCurrentPosition;
   for (unsigned int j = 0; j < spaceDimension; ++j)
   {
-    newPosition[j] = currentPosition[j] - ak * this->m_Gradient[j];
+    currentPosition[j] -= ak * this->m_Gradient[j];
   }
-
-  this->SetScaledCurrentPosition(newPosition);
+  this->Modified();
 
   this->InvokeEvent(IterationEvent());
 
 } // end AdvanceOneStep
 
 
+/**
+ * ************************ EvaluatePositions *******************
+ */
+
+void
+FiniteDifferenceGradientDescentOptimizer::EvaluatePositions(const std::vector<ParametersType> & positions,
+                                                            std::vector<MeasureType> &          values)
+{
+  try
+  {
+    this->EvaluateScaledValues(positions, values);
+  }
+  catch (ExceptionObject & err)
+  {
+    // An exception has occurred.
+    // Terminate immediately.
+    this->m_StopCondition = MetricError;
+    StopOptimization();
+
+    // Pass exception to caller
+    throw err;
+  }
+
+} // end EvaluatePositions
+
+
 /**
  * ************************** Compute_a *************************
  *
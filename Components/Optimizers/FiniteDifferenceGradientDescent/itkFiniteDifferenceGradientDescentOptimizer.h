@@ -19,7 +19,8 @@
 #ifndef itkFiniteDifferenceGradientDescentOptimizer_h
 #define itkFiniteDifferenceGradientDescentOptimizer_h
 
-#include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkParallelEvaluationOptimizer.h"
+#include <vector>
 
 namespace itk
 {
@@ -48,16 +49,19 @@ namespace itk
  * Note the similarities to the SimultaneousPerturbation optimizer and
  * the StandardGradientDescent optimizer.
  *
+ * The \f$2N\f$ cost function values of an iteration are independent, and are
+ * evaluated as one batch, see ParallelEvaluationOptimizer.
+ *
  * \ingroup Optimizers
  * \sa FiniteDifferenceGradientDescent
  */
 
-class FiniteDifferenceGradientDescentOptimizer : public ScaledSingleValuedNonLinearOptimizer
+class FiniteDifferenceGradientDescentOptimizer : public ParallelEvaluationOptimizer
 {
 public:
   /** Standard class typedefs. */
   typedef FiniteDifferenceGradientDescentOptimizer Self;
-  typedef ScaledSingleValuedNonLinearOptimizer     Superclass;
+  typedef ParallelEvaluationOptimizer              Superclass;
   typedef SmartPointer<Self>                       Pointer;
   typedef SmartPointer<const Self>                 ConstPointer;
 
@@ -65,7 +69,11 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(FiniteDifferenceGradientDescentOptimizer, ScaledSingleValuedNonLinearOptimizer);
+  itkTypeMacro(FiniteDifferenceGradientDescentOptimizer, ParallelEvaluationOptimizer);
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::CostFunctionType       CostFunctionType;
+  typedef Superclass::ScaledCostFunctionType ScaledCostFunctionType;
 
   /** Codes of stopping conditions */
   typedef enum
@@ -162,6 +170,10 @@ protected:
   virtual double
   Compute_c(unsigned long k) const;
 
+  /** Compute the scaled cost function values at the given positions. */
+  virtual void
+  EvaluatePositions(const std::vector<ParametersType> & positions, std::vector<MeasureType> & values);
+
 private:
   FiniteDifferenceGradientDescentOptimizer(const Self &) = delete;
   void
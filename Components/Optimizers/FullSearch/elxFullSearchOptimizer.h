@@ -48,6 +48,24 @@ namespace elastix
  *   This varies the second transform parameter in the range [-4.0 3.0] with steps of 1.0
  *   and the third parameter in the range [-1.0 1.0] with steps of 0.5. The names are used
  *   as column headers in the screen output.
+ * \parameter FullSearchCoarseToFine: Whether to search the space coarse-to-fine. First every
+ *   FullSearchCoarseGridSpacing'th grid point is evaluated; then the grid is refined by a factor
+ *   two at a time around the best points, until the steps of the FullSearchSpace are reached.
+ *   The points that are not evaluated are NaN in the optimization surface image.\n
+ *   example: <tt>(FullSearchCoarseToFine "true")</tt> \n
+ *   Can be given for each resolution. The default is "false".
+ * \parameter FullSearchCoarseGridSpacing: The spacing of the coarsest grid, in grid points.\n
+ *   example: <tt>(FullSearchCoarseGridSpacing 8)</tt> \n
+ *   Can be given for each resolution. The default is 4.
+ * \parameter FullSearchNumberOfCandidates: The number of best points around which the grid is
+ *   refined in the coarse-to-fine search.\n
+ *   example: <tt>(FullSearchNumberOfCandidates 3)</tt> \n
+ *   Can be given for each resolution. The default is 1.
+ *
+ * The grid points are evaluated concurrently, each thread with its own copy of the metric,
+ * the transform and the interpolator, see the UseMultiThreadingForOptimizer parameter of the
+ * OptimizerBase. The points are still reported one by one, in the same order, so the
+ * optimization surface image does not depend on the number of threads.
  *
  * \ingroup Optimizers
  * \sa FullSearchOptimizer
@@ -102,6 +120,9 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** The copies of the metric for the threads. */
+  typedef typename Superclass2::WorkUnitCostFunctionContainerType WorkUnitCostFunctionContainerType;
+
   /** To store the results of the full search */
   typedef itk::NDImageBase<float>       NDImageType;
   typedef typename NDImageType::Pointer NDImagePointer;
@@ -150,6 +171,14 @@ protected:
                                   const bool          found,
                                   const unsigned int  entry_nr) const;
 
+  /** Create a copy of the metric for each thread, to evaluate the grid points concurrently. */
+  void
+  InitializeWorkUnitCostFunctions(void) override;
+
+  /** Update the image sampler that the copies of the metric share. */
+  void
+  BeforeConcurrentEvaluation(void) override;
+
 private:
   elxOverrideGetSelfMacro;
 
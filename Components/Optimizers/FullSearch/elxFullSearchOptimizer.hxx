@@ -20,6 +20,7 @@
 
 #include "elxFullSearchOptimizer.h"
 #include <iomanip>
+#include <limits>
 #include <sstream>
 #include <string>
 #include "vnl/vnl_math.h"
@@ -152,11 +153,31 @@ FullSearch<TElastix>::BeforeEachResolution(void)
     this->m_OptimizationSurface->CreateNewImage();
     /** \todo don't do this if more than max allowable dimensions. */
 
+    /** Read the settings of the coarse-to-fine search. */
+    bool               coarseToFine = false;
+    itk::SizeValueType coarseGridSpacing = 4;
+    unsigned int       numberOfCandidates = 1;
+    this->GetConfiguration()->ReadParameter(
+      coarseToFine, "FullSearchCoarseToFine", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(
+      coarseGridSpacing, "FullSearchCoarseGridSpacing", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(
+      numberOfCandidates, "FullSearchNumberOfCandidates", this->GetComponentLabel(), level, 0);
+    this->SetCoarseToFine(coarseToFine);
+    this->SetCoarseGridSpacing(coarseGridSpacing);
+    this->SetNumberOfCandidates(numberOfCandidates);
+
     /** Set the correct size and allocate memory. */
     this->m_OptimizationSurface->SetRegions(this->GetSearchSpaceSize());
     this->m_OptimizationSurface->Allocate();
     /** \todo try/catch block around Allocate? */
 
+    /** Mark the points that the coarse-to-fine search does not evaluate. */
+    if (coarseToFine)
+    {
+      this->m_OptimizationSurface->FillBuffer(std::numeric_limits<float>::quiet_NaN());
+    }
+
     /** Set the name of this image on disk. */
     std::string resultImageFormat = "mhd";
     this->m_Configuration->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
@@ -165,8 +186,16 @@ FullSearch<TElastix>::BeforeEachResolution(void)
                << this->GetConfiguration()->GetElastixLevel() << ".R" << level << "." << resultImageFormat;
     this->m_OptimizationSurface->SetOutputFileName(makeString.str().c_str());
 
-    elxout << "Total number of iterations needed in this resolution: " << this->GetNumberOfIterations() << "."
-           << std::endl;
+    if (coarseToFine)
+    {
+      elxout << "Maximum number of iterations needed in this resolution: " << this->GetNumberOfIterations() << "."
+             << std::endl;
+    }
+    else
+    {
+      elxout << "Total number of iterations needed in this resolution: " << this->GetNumberOfIterations() << "."
+             << std::endl;
+    }
   }
   else
   {
@@ -334,6 +363,36 @@ FullSearch<TElastix>::CheckSearchSpaceRangeDefinition(const std::string & fullFi
 } // end CheckSearchSpaceRangeDefinition()
 
 
+/**
+ * ************ InitializeWorkUnitCostFunctions *****************
+ */
+
+template <class TElastix>
+void
+FullSearch<TElastix>::InitializeWorkUnitCostFunctions(void)
+{
+  /** Evaluate the grid points concurrently, when the metric can be copied for each thread. */
+  const WorkUnitCostFunctionContainerType copies = this->CreateWorkUnitCostFunctions(this->GetCostFunction());
+  this->SetWorkUnitCostFunctions(copies);
+  this->SetUseMultiThread(!copies.empty());
+  this->SetNumberOfWorkUnits(static_cast<itk::ThreadIdType>(copies.size()));
+
+} // end InitializeWorkUnitCostFunctions()
+
+
+/**
+ * ************ BeforeConcurrentEvaluation *****************
+ */
+
+template <class TElastix>
+void
+FullSearch<TElastix>::BeforeConcurrentEvaluation(void)
+{
+  this->UpdateWorkUnitCostFunctions();
+
+} // end BeforeConcurrentEvaluation()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFullSearchOptimizer_hxx
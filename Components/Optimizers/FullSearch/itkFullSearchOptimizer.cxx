@@ -21,6 +21,8 @@
 #include "itkEventObject.h"
 #include "itkMacro.h"
 #include "itkNumericTraits.h"
+#include "itkParallelEvaluationOptimizer.h"
+#include <algorithm> // For min and partial_sort.
 
 namespace itk
 {
@@ -47,6 +49,7 @@ FullSearchOptimizer::StartOptimization(void)
   m_CurrentIteration = 0;
 
   this->ProcessSearchSpaceChanges();
+  this->InitializeWorkUnitCostFunctions();
 
   m_CurrentIndexInSearchSpace.Fill(0);
   m_BestIndexInSearchSpace.Fill(0);
@@ -81,55 +84,356 @@ FullSearchOptimizer::ResumeOptimization(void)
   m_Stop = false;
 
   InvokeEvent(StartEvent());
-  while (!m_Stop)
+
+  if (this->m_CoarseToFine)
   {
+    this->CoarseToFineGridSearch();
+  }
+  else
+  {
+    this->FullGridSearch();
+  }
+
+  if (!m_Stop)
+  {
+    m_StopCondition = FullRangeSearched;
+    StopOptimization();
+  }
+
+} // end function ResumeOptimization
+
 
-    try
+/**
+ * ************************ FullGridSearch ***********************
+ */
+void
+FullSearchOptimizer::FullGridSearch(void)
+{
+  const SizeValueType numberOfGridPoints = this->GetNumberOfIterations();
+
+  /** Evaluate the grid points one by one, or in batches when they are evaluated in parallel. */
+  const ThreadIdType  numberOfWorkUnits = this->GetNumberOfWorkUnitsToUse(numberOfGridPoints);
+  const SizeValueType batchSize = numberOfWorkUnits > 1 ? 64 * numberOfWorkUnits : 1;
+
+  std::vector<SearchSpaceIndexType> indices;
+  for (SizeValueType first = m_CurrentIteration; first < numberOfGridPoints; first += batchSize)
+  {
+    const SizeValueType last = std::min(first + batchSize, numberOfGridPoints);
+    indices.clear();
+    for (SizeValueType linearIndex = first; linearIndex < last; ++linearIndex)
     {
-      m_Value = m_CostFunction->GetValue(this->GetCurrentPosition());
+      indices.push_back(this->LinearIndexToIndex(linearIndex));
     }
-    catch (ExceptionObject & err)
+    if (!this->EvaluateGridPoints(indices))
     {
-      // An exception has occurred.
-      // Terminate immediately.
-      m_StopCondition = MetricError;
-      StopOptimization();
+      return;
+    }
+  }
+
+} // end FullGridSearch()
+
+
+/**
+ * ******************** CoarseToFineGridSearch *******************
+ */
+void
+FullSearchOptimizer::CoarseToFineGridSearch(void)
+{
+  const unsigned int          searchSpaceDimension = this->GetNumberOfSearchSpaceDimensions();
+  const SearchSpaceSizeType & searchSpaceSize = this->GetSearchSpaceSize();
+
+  this->m_EvaluatedGridPoints.clear();
+  this->m_EvaluatedLinearIndices.clear();
+
+  /** The coarse grid: every spacing'th point in each dimension, and the last one. */
+  SizeValueType                            spacing = this->m_CoarseGridSpacing;
+  std::vector<std::vector<IndexValueType>> indicesPerDimension(searchSpaceDimension);
+  for (unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim)
+  {
+    const IndexValueType lastIndex = static_cast<IndexValueType>(searchSpaceSize[ssdim]) - 1;
+    for (IndexValueType i = 0; i <= lastIndex; i += static_cast<IndexValueType>(spacing))
+    {
+      indicesPerDimension[ssdim].push_back(i);
+    }
+    if (indicesPerDimension[ssdim].back() != lastIndex)
+    {
+      indicesPerDimension[ssdim].push_back(lastIndex);
+    }
+  }
+  if (!this->EvaluateUnvisitedGridPoints(indicesPerDimension))
+  {
+    return;
+  }
 
-      // Pass exception to caller
-      throw err;
+  /** Compare the values such that the best one comes first. */
+  const bool maximize = m_Maximize;
+  const auto isBetter = [maximize](const std::pair<MeasureType, SizeValueType> & lhs,
+                                   const std::pair<MeasureType, SizeValueType> & rhs) {
+    if (lhs.first != rhs.first)
+    {
+      return maximize ? (lhs.first > rhs.first) : (lhs.first < rhs.first);
     }
+    return lhs.second < rhs.second;
+  };
 
-    if (m_Stop)
+  /** Refine the grid around the best candidates, until the full resolution is reached. */
+  std::vector<SizeValueType> candidates;
+  while (spacing > 1)
+  {
+    const SizeValueType  finerSpacing = spacing / 2;
+    const IndexValueType reach = static_cast<IndexValueType>(spacing / finerSpacing);
+
+    const std::size_t numberOfCandidates =
+      std::min<std::size_t>(this->m_NumberOfCandidates, this->m_EvaluatedGridPoints.size());
+    std::partial_sort(this->m_EvaluatedGridPoints.begin(),
+                      this->m_EvaluatedGridPoints.begin() + numberOfCandidates,
+                      this->m_EvaluatedGridPoints.end(),
+                      isBetter);
+    candidates.clear();
+    for (std::size_t c = 0; c < numberOfCandidates; ++c)
     {
-      break;
+      candidates.push_back(this->m_EvaluatedGridPoints[c].second);
     }
 
-    /** Check if the value is a minimum or maximum */
-    if ((m_Value < m_BestValue) ^ m_Maximize) // ^ = xor, yields true if only one of the expressions is true
+    for (const SizeValueType candidate : candidates)
     {
-      m_BestValue = m_Value;
-      m_BestPointInSearchSpace = m_CurrentPointInSearchSpace;
-      m_BestIndexInSearchSpace = m_CurrentIndexInSearchSpace;
+      const SearchSpaceIndexType center = this->LinearIndexToIndex(candidate);
+      for (unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim)
+      {
+        const IndexValueType lastIndex = static_cast<IndexValueType>(searchSpaceSize[ssdim]) - 1;
+        indicesPerDimension[ssdim].clear();
+        for (IndexValueType k = -reach; k <= reach; ++k)
+        {
+          const IndexValueType i = center[ssdim] + k * static_cast<IndexValueType>(finerSpacing);
+          if (i >= 0 && i <= lastIndex)
+          {
+            indicesPerDimension[ssdim].push_back(i);
+          }
+        }
+      }
+      if (!this->EvaluateUnvisitedGridPoints(indicesPerDimension))
+      {
+        return;
+      }
     }
 
-    this->InvokeEvent(IterationEvent());
+    spacing = finerSpacing;
+  } // end while
+
+} // end CoarseToFineGridSearch()
+
+
+/**
+ * ******************* EvaluateUnvisitedGridPoints ****************
+ */
+bool
+FullSearchOptimizer::EvaluateUnvisitedGridPoints(const std::vector<std::vector<IndexValueType>> & indicesPerDimension)
+{
+  const std::size_t searchSpaceDimension = indicesPerDimension.size();
+  for (const auto & indices : indicesPerDimension)
+  {
+    if (indices.empty())
+    {
+      return true;
+    }
+  }
 
-    /** Prepare for next step */
-    m_CurrentIteration++;
+  /** Visit all combinations of the indices, with the first dimension running fastest. */
+  std::vector<SearchSpaceIndexType> unvisited;
+  std::vector<std::size_t>          counter(searchSpaceDimension, 0);
+  SearchSpaceIndexType              index(static_cast<unsigned int>(searchSpaceDimension));
+  bool                              done = false;
+  while (!done)
+  {
+    for (std::size_t ssdim = 0; ssdim < searchSpaceDimension; ++ssdim)
+    {
+      index[ssdim] = indicesPerDimension[ssdim][counter[ssdim]];
+    }
+    if (this->m_EvaluatedLinearIndices.insert(this->IndexToLinearIndex(index)).second)
+    {
+      unvisited.push_back(index);
+    }
 
-    if (m_CurrentIteration >= this->GetNumberOfIterations())
+    done = true;
+    for (std::size_t ssdim = 0; ssdim < searchSpaceDimension; ++ssdim)
     {
-      m_StopCondition = FullRangeSearched;
+      if (++counter[ssdim] < indicesPerDimension[ssdim].size())
+      {
+        done = false;
+        break;
+      }
+      counter[ssdim] = 0;
+    }
+  }
+
+  return this->EvaluateGridPoints(unvisited);
+
+} // end EvaluateUnvisitedGridPoints()
+
+
+/**
+ * ************************ EvaluateGridPoints *******************
+ */
+bool
+FullSearchOptimizer::EvaluateGridPoints(const std::vector<SearchSpaceIndexType> & indices)
+{
+  const std::size_t numberOfPoints = indices.size();
+
+  std::vector<ParametersType> positions(numberOfPoints);
+  for (std::size_t k = 0; k < numberOfPoints; ++k)
+  {
+    positions[k] = this->IndexToPosition(indices[k]);
+  }
+
+  /** Single-threadedly evaluate and report the points one by one. */
+  const ThreadIdType numberOfWorkUnits = this->GetNumberOfWorkUnitsToUse(numberOfPoints);
+  if (numberOfWorkUnits < 2)
+  {
+    for (std::size_t k = 0; k < numberOfPoints; ++k)
+    {
+      MeasureType value = 0.0;
+      try
+      {
+        value = m_CostFunction->GetValue(positions[k]);
+      }
+      catch (ExceptionObject & err)
+      {
+        // An exception has occurred.
+        // Terminate immediately.
+        m_StopCondition = MetricError;
+        StopOptimization();
+
+        // Pass exception to caller
+        throw err;
+      }
+
+      if (!this->ReportGridPoint(indices[k], positions[k], value))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Multi-threadedly evaluate the points; every work unit uses its own cost function, if there is one. */
+  ParallelEvaluationOptimizer::WorkUnitCostFunctionPointersType costFunctions(numberOfWorkUnits,
+                                                                              m_CostFunction.GetPointer());
+  if (!m_WorkUnitCostFunctions.empty())
+  {
+    for (ThreadIdType t = 0; t < numberOfWorkUnits; ++t)
+    {
+      costFunctions[t] = m_WorkUnitCostFunctions[t].GetPointer();
+    }
+    this->BeforeConcurrentEvaluation();
+  }
+
+  std::vector<MeasureType>     values;
+  std::vector<unsigned char>   failed;
+  std::vector<ExceptionObject> errors;
+  ParallelEvaluationOptimizer::EvaluateValues(costFunctions, positions, values, failed, errors);
+
+  /** Report them in order. */
+  for (std::size_t k = 0; k < numberOfPoints; ++k)
+  {
+    if (failed[k])
+    {
+      m_StopCondition = MetricError;
       StopOptimization();
-      break;
+      throw errors[k];
     }
 
-    /** Set the next position in search space. */
-    this->UpdateCurrentPosition();
+    if (!this->ReportGridPoint(indices[k], positions[k], values[k]))
+    {
+      return false;
+    }
+  }
+  return true;
 
-  } // end while
+} // end EvaluateGridPoints()
 
-} // end function ResumeOptimization
+
+/**
+ * ******************* GetNumberOfWorkUnitsToUse *****************
+ */
+ThreadIdType
+FullSearchOptimizer::GetNumberOfWorkUnitsToUse(const std::size_t numberOfPoints) const
+{
+  return ParallelEvaluationOptimizer::GetNumberOfWorkUnits(
+    m_UseMultiThread, m_NumberOfWorkUnits, m_WorkUnitCostFunctions.size(), numberOfPoints);
+
+} // end GetNumberOfWorkUnitsToUse()
+
+
+/**
+ * *********************** ReportGridPoint ***********************
+ */
+bool
+FullSearchOptimizer::ReportGridPoint(const SearchSpaceIndexType & index,
+                                     const ParametersType &       position,
+                                     const MeasureType            value)
+{
+  m_CurrentIndexInSearchSpace = index;
+  m_CurrentPointInSearchSpace = this->IndexToPoint(index);
+  this->SetCurrentPosition(position);
+  m_Value = value;
+
+  if (m_CoarseToFine)
+  {
+    m_EvaluatedGridPoints.push_back(std::make_pair(value, this->IndexToLinearIndex(index)));
+  }
+
+  /** Check if the value is a minimum or maximum */
+  if ((m_Value < m_BestValue) ^ m_Maximize) // ^ = xor, yields true if only one of the expressions is true
+  {
+    m_BestValue = m_Value;
+    m_BestPointInSearchSpace = m_CurrentPointInSearchSpace;
+    m_BestIndexInSearchSpace = m_CurrentIndexInSearchSpace;
+  }
+
+  this->InvokeEvent(IterationEvent());
+
+  /** Prepare for next step */
+  m_CurrentIteration++;
+
+  return !m_Stop;
+
+} // end ReportGridPoint()
+
+
+/**
+ * *********************** LinearIndexToIndex ********************
+ */
+FullSearchOptimizer::SearchSpaceIndexType
+FullSearchOptimizer::LinearIndexToIndex(SizeValueType linearIndex) const
+{
+  const unsigned int   searchSpaceDimension = m_NumberOfSearchSpaceDimensions;
+  SearchSpaceIndexType index(searchSpaceDimension);
+  for (unsigned int ssdim = 0; ssdim < searchSpaceDimension; ++ssdim)
+  {
+    index[ssdim] = static_cast<IndexValueType>(linearIndex % m_SearchSpaceSize[ssdim]);
+    linearIndex /= m_SearchSpaceSize[ssdim];
+  }
+  return index;
+
+} // end LinearIndexToIndex()
+
+
+/**
+ * *********************** IndexToLinearIndex ********************
+ */
+SizeValueType
+FullSearchOptimizer::IndexToLinearIndex(const SearchSpaceIndexType & index) const
+{
+  SizeValueType linearIndex = 0;
+  SizeValueType stride = 1;
+  for (unsigned int ssdim = 0; ssdim < m_NumberOfSearchSpaceDimensions; ++ssdim)
+  {
+    linearIndex += static_cast<SizeValueType>(index[ssdim]) * stride;
+    stride *= m_SearchSpaceSize[ssdim];
+  }
+  return linearIndex;
+
+} // end IndexToLinearIndex()
 
 
 /**
@@ -24,6 +24,9 @@
 #include "itkImage.h"
 #include "itkArray.h"
 #include "itkFixedArray.h"
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +38,17 @@ namespace itk
  * Optimizer that scans a subspace of the parameter space
  * and searches for the best parameters.
  *
+ * The grid points can be evaluated in parallel (see SetUseMultiThread), by the
+ * static helpers of the ParallelEvaluationOptimizer. Every point is still
+ * reported by its own IterationEvent, in the order of evaluation. The elastix
+ * component gives each work unit its own copy of the metric.
+ *
+ * In the coarse-to-fine mode, only every CoarseGridSpacing'th grid point is
+ * evaluated first. Then the grid is refined by a factor two at a time, around
+ * the NumberOfCandidates best points found so far, until the full resolution
+ * of the search space is reached. Only the neighbourhood of the candidates is
+ * densified, so most of the grid points are never evaluated.
+ *
  * \todo This optimizer has similar functionality as the recently added
  * itkExhaustiveOptimizer. See if we can replace it by that optimizer,
  * or inherit from it.
@@ -89,6 +103,9 @@ public:
   /** The size of each dimension to be searched ((max-min)/step)) */
   typedef Array<SizeValueType> SearchSpaceSizeType;
 
+  /** Independent copies of the cost function, for the parallel evaluation. */
+  typedef std::vector<CostFunctionPointer> CostFunctionContainerType;
+
   /** NB: The methods SetScales has no influence! */
 
   /** Methods to configure the cost function. */
@@ -214,6 +231,38 @@ public:
   /** Get Stop condition. */
   itkGetConstMacro(StopCondition, StopConditionType);
 
+  /** Setting: evaluate the grid points in parallel. Every work unit uses its own
+   * cost function when the WorkUnitCostFunctions are set, and otherwise the cost
+   * function of the optimizer, which then must be safe to evaluate concurrently.
+   * Default: false */
+  itkSetMacro(UseMultiThread, bool);
+  itkGetConstMacro(UseMultiThread, bool);
+
+  /** Setting: the number of work units of the parallel evaluation. If set to 0,
+   * the global default is used. Default: 0 */
+  itkSetMacro(NumberOfWorkUnits, ThreadIdType);
+  itkGetConstMacro(NumberOfWorkUnits, ThreadIdType);
+
+  /** Setting: independent copies of the cost function, one for each work unit
+   * of the parallel evaluation. Default: empty */
+  itkSetMacro(WorkUnitCostFunctions, CostFunctionContainerType);
+  itkGetConstReferenceMacro(WorkUnitCostFunctions, CostFunctionContainerType);
+
+  /** Setting: search coarse-to-fine instead of evaluating every grid point. Default: false */
+  itkSetMacro(CoarseToFine, bool);
+  itkGetConstMacro(CoarseToFine, bool);
+  itkBooleanMacro(CoarseToFine);
+
+  /** Setting: the spacing, in grid points, of the coarsest grid of the
+   * coarse-to-fine search. Default: 4 */
+  itkSetClampMacro(CoarseGridSpacing, SizeValueType, 1, NumericTraits<SizeValueType>::max());
+  itkGetConstMacro(CoarseGridSpacing, SizeValueType);
+
+  /** Setting: the number of best points around which the grid is refined in
+   * the coarse-to-fine search. Default: 1 */
+  itkSetClampMacro(NumberOfCandidates, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfCandidates, unsigned int);
+
 protected:
   FullSearchOptimizer();
   ~FullSearchOptimizer() override = default;
@@ -238,12 +287,73 @@ protected:
   virtual void
   ProcessSearchSpaceChanges(void);
 
+  /** Called when the optimization starts, e.g. to set the cost functions of the work
+   * units. Default: nothing. */
+  virtual void
+  InitializeWorkUnitCostFunctions(void)
+  {}
+
+  /** Called single-threaded before the work unit cost functions evaluate a batch of grid
+   * points concurrently, e.g. to update the resources that they share. Default: nothing. */
+  virtual void
+  BeforeConcurrentEvaluation(void)
+  {}
+
+  /** Evaluate the cost function at the given grid points, and report them one by
+   * one as the current position, followed by an IterationEvent. Returns false when
+   * the optimization has been stopped. */
+  virtual bool
+  EvaluateGridPoints(const std::vector<SearchSpaceIndexType> & indices);
+
+  /** Search the full grid. */
+  virtual void
+  FullGridSearch(void);
+
+  /** Search the grid coarse-to-fine. */
+  virtual void
+  CoarseToFineGridSearch(void);
+
+  /** Evaluate the grid points that are spanned by the given indices in each
+   * dimension, and that have not been evaluated before. Returns false when the
+   * optimization has been stopped. */
+  bool
+  EvaluateUnvisitedGridPoints(const std::vector<std::vector<IndexValueType>> & indicesPerDimension);
+
+  /** Convert a linear index, with the first dimension running fastest, to an index. */
+  SearchSpaceIndexType
+  LinearIndexToIndex(SizeValueType linearIndex) const;
+
+  /** Convert an index to a linear index. */
+  SizeValueType
+  IndexToLinearIndex(const SearchSpaceIndexType & index) const;
+
 private:
   FullSearchOptimizer(const Self &) = delete;
   void
   operator=(const Self &) = delete;
 
+  /** Get the number of work units used to evaluate the given number of points. */
+  ThreadIdType
+  GetNumberOfWorkUnitsToUse(const std::size_t numberOfPoints) const;
+
+  /** Make the given grid point and its value the current one, and invoke an
+   * IterationEvent. Returns false when the optimization has been stopped. */
+  bool
+  ReportGridPoint(const SearchSpaceIndexType & index, const ParametersType & position, const MeasureType value);
+
   unsigned long m_CurrentIteration{ 0 };
+
+  bool                      m_UseMultiThread{ false };
+  ThreadIdType              m_NumberOfWorkUnits{ 0 };
+  CostFunctionContainerType m_WorkUnitCostFunctions;
+
+  bool          m_CoarseToFine{ false };
+  SizeValueType m_CoarseGridSpacing{ 4 };
+  unsigned int  m_NumberOfCandidates{ 1 };
+
+  /** The value and linear index of every grid point evaluated in the coarse-to-fine search. */
+  std::vector<std::pair<MeasureType, SizeValueType>> m_EvaluatedGridPoints;
+  std::unordered_set<SizeValueType>                  m_EvaluatedLinearIndices;
 };
 
 } // end namespace itk
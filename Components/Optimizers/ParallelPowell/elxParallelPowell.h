@@ -0,0 +1,167 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxParallelPowell_h
+#define elxParallelPowell_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkParallelPowellOptimizer.h"
+
+namespace elastix
+{
+
+/**
+ * \class ParallelPowell
+ * \brief An optimizer based on the itk::ParallelPowellOptimizer.
+ *
+ * A Powell optimizer, of which the line searches evaluate several probes at once.
+ * See the documentation of the itk::ParallelPowellOptimizer for more information.
+ *
+ * The probes of a batch are evaluated concurrently, each thread with its own copy of the
+ * metric, the transform and the interpolator, see the UseMultiThreadingForOptimizer
+ * parameter of the OptimizerBase. When the metric cannot be copied, the probes are
+ * evaluated one after the other. With a fixed NumberOfLineProbes, the iterates are the
+ * same in both cases.
+ *
+ * The parameters used in this class are:
+ * \parameter Optimizer: Select this optimizer as follows:\n
+ *    <tt>(Optimizer "ParallelPowell")</tt>
+ * \parameter MaximumNumberOfIterations: The maximum number of iterations in each resolution. \n
+ *    example: <tt>(MaximumNumberOfIterations 100 100 50)</tt> \n
+ *    Default value: 500.\n
+ * \parameter MaximumNumberOfLineIterations: The maximum number of batches of probes of a line search. \n
+ *    example: <tt>(MaximumNumberOfLineIterations 20 20 10)</tt> \n
+ *    Default value: 100.\n
+ * \parameter ValueTolerance: Stop when the relative decrease of the metric value in an
+ *    iteration is less than this.\n
+ *    example: <tt>(ValueTolerance 0.001 0.0001 0.000001)</tt> \n
+ *    Default value: 1e-8. Can be specified for each resolution.\n
+ * \parameter MaximumStepLength: The spacing of the first probes of a line search.\n
+ *    example: <tt>(MaximumStepLength 16.0 8.0 4.0)</tt> \n
+ *    Default value: 16 / 2^level. Can be specified for each resolution.\n
+ * \parameter StepTolerance: The accuracy of the line searches.\n
+ *    example: <tt>(StepTolerance 0.5 0.25 0.125)</tt> \n
+ *    Default value: 0.5 / 2^level. Can be specified for each resolution.\n
+ * \parameter NumberOfLineProbes: The number of probes in a batch of a line search. If 0,
+ *    the number of positions that can be evaluated at the same time is used, and at
+ *    least two probes are used.\n
+ *    example: <tt>(NumberOfLineProbes 4)</tt> \n
+ *    Default value: 0. Can be specified for each resolution.\n
+ *
+ * \ingroup Optimizers
+ * \sa ParallelPowellOptimizer
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT ParallelPowell
+  : public itk::ParallelPowellOptimizer
+  , public OptimizerBase<TElastix>
+{
+public:
+  /** Standard ITK.*/
+  typedef ParallelPowell                Self;
+  typedef ParallelPowellOptimizer       Superclass1;
+  typedef OptimizerBase<TElastix>       Superclass2;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelPowell, ParallelPowellOptimizer);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific optimizer. \n
+   * example: <tt>(Optimizer "ParallelPowell")</tt>\n
+   */
+  elxClassNameMacro("ParallelPowell");
+
+  /** Typedef's inherited from Superclass1.*/
+  typedef Superclass1::CostFunctionType  CostFunctionType;
+  typedef Superclass1::ScalesType        ScalesType;
+  typedef Superclass1::ParametersType    ParametersType;
+  typedef Superclass1::StopConditionType StopConditionType;
+
+  /** Typedef's inherited from Elastix.*/
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** The copies of the metric for the threads. */
+  typedef typename Superclass2::WorkUnitCostFunctionContainerType WorkUnitCostFunctionContainerType;
+
+  /** Check if any scales are set, and set the UseScales flag on or off;
+   * after that call the superclass' implementation */
+  void
+  StartOptimization(void) override;
+
+  /** Methods invoked by elastix, in which parameters can be set and
+   * progress information can be printed. */
+  void
+  BeforeRegistration(void) override;
+
+  void
+  BeforeEachResolution(void) override;
+
+  void
+  AfterEachResolution(void) override;
+
+  void
+  AfterEachIteration(void) override;
+
+  void
+  AfterRegistration(void) override;
+
+  /** Override the SetInitialPosition.
+   * Override the implementation in itkOptimizer.h, to
+   * ensure that the scales array and the parameters
+   * array have the same size. */
+  void
+  SetInitialPosition(const ParametersType & param) override;
+
+protected:
+  ParallelPowell() = default;
+  ~ParallelPowell() override = default;
+
+  /** Create a copy of the metric for each thread, to evaluate the probes concurrently. */
+  void
+  InitializeWorkUnitCostFunctions(void) override;
+
+  /** Update the image sampler that the copies of the metric share. */
+  void
+  BeforeConcurrentEvaluation(void) override;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  ParallelPowell(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxParallelPowell.hxx"
+#endif
+
+#endif // end #ifndef elxParallelPowell_h
@@ -0,0 +1,262 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef elxParallelPowell_hxx
+#define elxParallelPowell_hxx
+
+#include "elxParallelPowell.h"
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+namespace elastix
+{
+
+/**
+ * ***************** StartOptimization ************************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::StartOptimization(void)
+{
+  /** Check if the entered scales are correct and != [ 1 1 1 ...] */
+  this->SetUseScales(false);
+  const ScalesType & scales = this->GetScales();
+  if (scales.GetSize() == this->GetInitialPosition().GetSize())
+  {
+    ScalesType unit_scales(scales.GetSize());
+    unit_scales.Fill(1.0);
+    if (scales != unit_scales)
+    {
+      /** only then: */
+      this->SetUseScales(true);
+    }
+  }
+
+  /** Call the superclass */
+  this->Superclass1::StartOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ***************** BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::BeforeRegistration(void)
+{
+  /** Add target cells to IterationInfo.*/
+  this->AddTargetCellToIterationInfo("2:Metric");
+  this->AddTargetCellToIterationInfo("3:StepSize");
+  this->AddTargetCellToIterationInfo("4:LineIterations");
+
+  /** Format the metric and stepsize as floats */
+  this->GetIterationInfoAt("2:Metric") << std::showpoint << std::fixed;
+  this->GetIterationInfoAt("3:StepSize") << std::showpoint << std::fixed;
+
+} // end BeforeRegistration()
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::BeforeEachResolution(void)
+{
+  /** Get the current resolution level.*/
+  unsigned int level = static_cast<unsigned int>(this->m_Registration->GetAsITKBaseType()->GetCurrentLevel());
+
+  /** Set the value tolerance.*/
+  double valueTolerance = 1e-8;
+  this->m_Configuration->ReadParameter(valueTolerance, "ValueTolerance", this->GetComponentLabel(), level, 0);
+  this->SetValueTolerance(valueTolerance);
+
+  /** Set the MaximumStepLength.*/
+  double maxStepLength = 16.0 / std::pow(2.0, static_cast<int>(level));
+  this->m_Configuration->ReadParameter(maxStepLength, "MaximumStepLength", this->GetComponentLabel(), level, 0);
+  this->SetStepLength(maxStepLength);
+
+  /** Set the StepTolerance.*/
+  double stepTolerance = 0.5 / std::pow(2.0, static_cast<int>(level));
+  this->m_Configuration->ReadParameter(stepTolerance, "StepTolerance", this->GetComponentLabel(), level, 0);
+  this->SetStepTolerance(stepTolerance);
+
+  /** Set the maximumNumberOfIterations.*/
+  unsigned int maximumNumberOfIterations = 500;
+  this->m_Configuration->ReadParameter(
+    maximumNumberOfIterations, "MaximumNumberOfIterations", this->GetComponentLabel(), level, 0);
+  this->SetMaximumIteration(maximumNumberOfIterations);
+
+  /** Set the maximumNumberOfLineIterations.*/
+  unsigned int maximumNumberOfLineIterations = 100;
+  this->m_Configuration->ReadParameter(
+    maximumNumberOfLineIterations, "MaximumNumberOfLineIterations", this->GetComponentLabel(), level, 0);
+  this->SetMaximumLineIteration(maximumNumberOfLineIterations);
+
+  /** Set the numberOfLineProbes.*/
+  unsigned int numberOfLineProbes = 0;
+  this->m_Configuration->ReadParameter(numberOfLineProbes, "NumberOfLineProbes", this->GetComponentLabel(), level, 0);
+  this->SetNumberOfLineProbes(numberOfLineProbes);
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ***************** AfterEachIteration *************************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::AfterEachIteration(void)
+{
+  /** Print some information */
+  this->GetIterationInfoAt("2:Metric") << this->GetCurrentValue();
+  this->GetIterationInfoAt("3:StepSize") << this->GetCurrentStepLength();
+  this->GetIterationInfoAt("4:LineIterations") << this->GetCurrentLineIteration();
+
+} // end AfterEachIteration()
+
+
+/**
+ * ***************** AfterEachResolution *************************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::AfterEachResolution(void)
+{
+  /**
+  typedef enum {
+    MetricError,
+    MaximumNumberOfIterations,
+    ValueTolerance,
+    Unknown }    StopConditionType;  */
+
+  std::string stopcondition;
+
+  switch (this->GetStopCondition())
+  {
+    case MetricError:
+      stopcondition = "Error in metric";
+      break;
+
+    case MaximumNumberOfIterations:
+      stopcondition = "Maximum number of iterations has been reached";
+      break;
+
+    case ValueTolerance:
+      stopcondition = "Almost no decrease in function value anymore";
+      break;
+
+    default:
+      stopcondition = "Unknown";
+      break;
+  }
+
+  /** Print the stopping condition */
+  elxout << "Stopping condition: " << stopcondition << "." << std::endl;
+  elxout << "Number of metric evaluations: " << this->GetNumberOfCostFunctionEvaluations() << std::endl;
+
+} // end AfterEachResolution()
+
+
+/**
+ * ******************* AfterRegistration ************************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::AfterRegistration(void)
+{
+  /** Print the best metric value */
+  double bestValue = this->GetCurrentValue();
+  elxout << std::endl << "Final metric value  = " << bestValue << std::endl;
+
+} // end AfterRegistration()
+
+
+/**
+ * ******************* SetInitialPosition ***********************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::SetInitialPosition(const ParametersType & param)
+{
+  /** Override the implementation in itkOptimizer.h, to
+   * ensure that the scales array and the parameters
+   * array have the same size.
+   */
+
+  /** Call the Superclass' implementation. */
+  this->Superclass1::SetInitialPosition(param);
+
+  /** Set the scales array to the same size if the size has been changed */
+  ScalesType   scales = this->GetScales();
+  unsigned int paramsize = param.Size();
+
+  if ((scales.Size()) != paramsize)
+  {
+    ScalesType newscales(paramsize);
+    newscales.Fill(1.0);
+    this->SetScales(newscales);
+  }
+
+} // end SetInitialPosition()
+
+
+/**
+ * ******************* InitializeWorkUnitCostFunctions ***********************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::InitializeWorkUnitCostFunctions(void)
+{
+  /** Evaluate the probes concurrently, when the metric can be copied for each thread. */
+  const WorkUnitCostFunctionContainerType copies = this->CreateWorkUnitCostFunctions(this->GetCostFunction());
+  this->SetWorkUnitCostFunctions(copies);
+  this->SetUseMultiThread(!copies.empty());
+  this->SetNumberOfWorkUnits(static_cast<itk::ThreadIdType>(copies.size()));
+
+  /** Call the superclass' implementation. */
+  this->Superclass1::InitializeWorkUnitCostFunctions();
+
+} // end InitializeWorkUnitCostFunctions()
+
+
+/**
+ * ******************* BeforeConcurrentEvaluation ***********************
+ */
+
+template <class TElastix>
+void
+ParallelPowell<TElastix>::BeforeConcurrentEvaluation(void)
+{
+  this->UpdateWorkUnitCostFunctions();
+
+} // end BeforeConcurrentEvaluation()
+
+} // end namespace elastix
+
+#endif // end #ifndef elxParallelPowell_hxx
@@ -0,0 +1,332 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelPowellOptimizer.h"
+
+#include <algorithm> // For sort and max.
+#include <cmath>     // For abs and sqrt.
+#include <utility>   // For pair.
+
+namespace itk
+{
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+void
+ParallelPowellOptimizer::PrintSelf(std::ostream & os, Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  os << indent << "CurrentIteration: " << this->m_CurrentIteration << std::endl;
+  os << indent << "CurrentLineIteration: " << this->m_CurrentLineIteration << std::endl;
+  os << indent << "CurrentValue: " << this->m_CurrentValue << std::endl;
+  os << indent << "CurrentStepLength: " << this->m_CurrentStepLength << std::endl;
+  os << indent << "StopCondition: " << this->m_StopCondition << std::endl;
+  os << indent << "StepLength: " << this->m_StepLength << std::endl;
+  os << indent << "StepTolerance: " << this->m_StepTolerance << std::endl;
+  os << indent << "ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "MaximumIteration: " << this->m_MaximumIteration << std::endl;
+  os << indent << "MaximumLineIteration: " << this->m_MaximumLineIteration << std::endl;
+  os << indent << "NumberOfLineProbes: " << this->m_NumberOfLineProbes << std::endl;
+
+} // end PrintSelf()
+
+
+/**
+ * ******************* StartOptimization *********************
+ */
+
+void
+ParallelPowellOptimizer::StartOptimization(void)
+{
+  itkDebugMacro("StartOptimization");
+
+  /** Reset some variables. */
+  this->m_Stop = false;
+  this->m_StopCondition = Unknown;
+  this->m_CurrentIteration = 0;
+  this->m_CurrentLineIteration = 0;
+  this->m_CurrentStepLength = 0.0;
+
+  /** Initialize the scaledCostFunction with the currently set scales. */
+  this->InitializeScales();
+  this->InitializeWorkUnitCostFunctions();
+
+  /** Set the current position as the scaled initial position. */
+  this->SetCurrentPosition(this->GetInitialPosition());
+
+  /** The initial directions are the axes of the scaled parameter space. */
+  const unsigned int numberOfParameters = this->GetScaledCurrentPosition().GetSize();
+  this->m_Directions.assign(numberOfParameters, ParametersType(numberOfParameters));
+  for (unsigned int i = 0; i < numberOfParameters; ++i)
+  {
+    this->m_Directions[i].Fill(0.0);
+    this->m_Directions[i][i] = 1.0;
+  }
+
+  /** Evaluate the initial position. */
+  std::vector<MeasureType> values;
+  this->EvaluatePositions(std::vector<ParametersType>(1, this->GetScaledCurrentPosition()), values);
+  this->m_CurrentValue = values[0];
+
+  this->ResumeOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ******************* ResumeOptimization *********************
+ */
+
+void
+ParallelPowellOptimizer::ResumeOptimization(void)
+{
+  itkDebugMacro("ResumeOptimization");
+
+  this->m_Stop = false;
+  this->m_StopCondition = Unknown;
+
+  this->InvokeEvent(StartEvent());
+
+  const unsigned int numberOfParameters = static_cast<unsigned int>(this->m_Directions.size());
+  while (!this->m_Stop)
+  {
+    const ParametersType startPosition = this->GetScaledCurrentPosition();
+    const MeasureType    startValue = this->m_CurrentValue;
+
+    /** Minimize along all directions, and remember the one with the largest decrease. */
+    double       largestDecrease = 0.0;
+    unsigned int largestDirection = 0;
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      const MeasureType previousValue = this->m_CurrentValue;
+      this->LineOptimize(this->m_Directions[i]);
+      if (previousValue - this->m_CurrentValue > largestDecrease)
+      {
+        largestDecrease = previousValue - this->m_CurrentValue;
+        largestDirection = i;
+      }
+    }
+
+    const bool converged = 2.0 * (startValue - this->m_CurrentValue) <=
+                           this->m_ValueTolerance * (std::abs(startValue) + std::abs(this->m_CurrentValue)) + 1e-20;
+
+    /** Replace the direction of the largest decrease by the displacement of this
+     * iteration, if the extrapolation along it is promising, see Numerical Recipes. */
+    ParametersType displacement = this->GetScaledCurrentPosition();
+    double         displacementNorm = 0.0;
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      displacement[i] -= startPosition[i];
+      displacementNorm += displacement[i] * displacement[i];
+    }
+    displacementNorm = std::sqrt(displacementNorm);
+    if (!converged && displacementNorm > 0.0)
+    {
+      ParametersType extrapolated = this->GetScaledCurrentPosition();
+      for (unsigned int i = 0; i < numberOfParameters; ++i)
+      {
+        extrapolated[i] += displacement[i];
+      }
+      std::vector<MeasureType> values;
+      this->EvaluatePositions(std::vector<ParametersType>(1, extrapolated), values);
+      const MeasureType extrapolatedValue = values[0];
+
+      if (extrapolatedValue < startValue)
+      {
+        const double gain = startValue - this->m_CurrentValue - largestDecrease;
+        const double loss = startValue - extrapolatedValue;
+        const double test = 2.0 * (startValue - 2.0 * this->m_CurrentValue + extrapolatedValue) * gain * gain -
+                            largestDecrease * loss * loss;
+        if (test < 0.0)
+        {
+          displacement /= displacementNorm;
+          this->LineOptimize(displacement);
+          this->m_Directions[largestDirection] = this->m_Directions.back();
+          this->m_Directions.back() = displacement;
+        }
+      }
+    }
+
+    this->InvokeEvent(IterationEvent());
+    if (this->m_Stop)
+    {
+      break;
+    }
+
+    if (converged)
+    {
+      this->m_StopCondition = ValueTolerance;
+      this->StopOptimization();
+      break;
+    }
+
+    /** Next iteration. */
+    ++this->m_CurrentIteration;
+    if (this->m_CurrentIteration >= this->m_MaximumIteration)
+    {
+      this->m_StopCondition = MaximumNumberOfIterations;
+      this->StopOptimization();
+      break;
+    }
+  }
+
+} // end ResumeOptimization()
+
+
+/**
+ * ******************* StopOptimization *********************
+ */
+
+void
+ParallelPowellOptimizer::StopOptimization(void)
+{
+  itkDebugMacro("StopOptimization");
+
+  this->m_Stop = true;
+  this->InvokeEvent(EndEvent());
+
+} // end StopOptimization()
+
+
+/**
+ * ******************* LineOptimize *********************
+ */
+
+void
+ParallelPowellOptimizer::LineOptimize(const ParametersType & direction)
+{
+  const ParametersType origin = this->GetScaledCurrentPosition();
+  const unsigned int   numberOfParameters = origin.GetSize();
+  const unsigned int   numberOfProbes = std::max<unsigned int>(
+    this->m_NumberOfLineProbes > 0 ? this->m_NumberOfLineProbes : this->GetNumberOfConcurrentEvaluations(), 2);
+
+  /** The samples along the line, as (step, value) pairs, sorted on the step. */
+  typedef std::pair<double, MeasureType> SampleType;
+  std::vector<SampleType>                samples(1, SampleType(0.0, this->m_CurrentValue));
+
+  /** Evaluate a batch of steps, add them to the samples, and return the index of the best sample. */
+  std::vector<ParametersType> positions;
+  std::vector<MeasureType>    values;
+  const auto                  evaluateSteps = [&](const std::vector<double> & steps) -> std::size_t {
+    positions.assign(steps.size(), origin);
+    for (std::size_t k = 0; k < steps.size(); ++k)
+    {
+      for (unsigned int i = 0; i < numberOfParameters; ++i)
+      {
+        positions[k][i] += steps[k] * direction[i];
+      }
+    }
+    this->EvaluatePositions(positions, values);
+    for (std::size_t k = 0; k < steps.size(); ++k)
+    {
+      samples.push_back(SampleType(steps[k], values[k]));
+    }
+    std::sort(samples.begin(), samples.end());
+    ++this->m_CurrentLineIteration;
+
+    /** The lowest value; of equal values, the one closest to the origin. */
+    std::size_t best = 0;
+    for (std::size_t k = 1; k < samples.size(); ++k)
+    {
+      if (samples[k].second < samples[best].second ||
+          (samples[k].second == samples[best].second && std::abs(samples[k].first) < std::abs(samples[best].first)))
+      {
+        best = k;
+      }
+    }
+    return best;
+  };
+
+  /** Bracket the minimum: probe at multiples of the step length on both sides, and extend
+   * the sampled range beyond its end, with a doubled spacing, when the best sample is there. */
+  this->m_CurrentLineIteration = 0;
+  std::vector<double> steps(numberOfProbes);
+  for (unsigned int k = 0; k < numberOfProbes; ++k)
+  {
+    steps[k] = (k % 2 == 0 ? 1.0 : -1.0) * this->m_StepLength * static_cast<double>(k / 2 + 1);
+  }
+  std::size_t best = evaluateSteps(steps);
+  while ((best == 0 || best == samples.size() - 1) && this->m_CurrentLineIteration < this->m_MaximumLineIteration)
+  {
+    const double end = samples[best].first;
+    const double neighbour = samples[best == 0 ? 1 : best - 1].first;
+    const double spacing = 2.0 * (end - neighbour);
+    for (unsigned int k = 0; k < numberOfProbes; ++k)
+    {
+      steps[k] = end + spacing * static_cast<double>(k + 1);
+    }
+    best = evaluateSteps(steps);
+  }
+
+  /** Refine the interval between the neighbours of the best sample, with uniformly placed probes. */
+  while (this->m_CurrentLineIteration < this->m_MaximumLineIteration)
+  {
+    const double lower = samples[best == 0 ? 0 : best - 1].first;
+    const double upper = samples[best == samples.size() - 1 ? best : best + 1].first;
+    if (0.5 * (upper - lower) <= this->m_StepTolerance)
+    {
+      break;
+    }
+    for (unsigned int k = 0; k < numberOfProbes; ++k)
+    {
+      steps[k] = lower + (upper - lower) * static_cast<double>(k + 1) / static_cast<double>(numberOfProbes + 1);
+    }
+    best = evaluateSteps(steps);
+  }
+
+  /** Move to the best sample. */
+  const double step = samples[best].first;
+  this->m_CurrentStepLength = std::abs(step);
+  if (step != 0.0)
+  {
+    ParametersType position = origin;
+    for (unsigned int i = 0; i < numberOfParameters; ++i)
+    {
+      position[i] += step * direction[i];
+    }
+    this->SetScaledCurrentPosition(position);
+    this->m_CurrentValue = samples[best].second;
+  }
+
+} // end LineOptimize()
+
+
+/**
+ * ******************* EvaluatePositions *********************
+ */
+
+void
+ParallelPowellOptimizer::EvaluatePositions(const std::vector<ParametersType> & positions,
+                                           std::vector<MeasureType> &          values)
+{
+  try
+  {
+    this->EvaluateScaledValues(positions, values);
+  }
+  catch (ExceptionObject & err)
+  {
+    this->m_StopCondition = MetricError;
+    this->StopOptimization();
+    throw err;
+  }
+
+} // end EvaluatePositions()
+
+} // end namespace itk
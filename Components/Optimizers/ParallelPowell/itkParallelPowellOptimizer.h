@@ -0,0 +1,169 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelPowellOptimizer_h
+#define itkParallelPowellOptimizer_h
+
+#include "itkParallelEvaluationOptimizer.h"
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * \class ParallelPowellOptimizer
+ * \brief A Powell optimizer of which the line searches evaluate several probes at once.
+ *
+ * The method of Powell minimizes along each of a set of directions in turn, starting
+ * with the parameter axes, see Press et al., "Numerical Recipes", section 10.5. After
+ * each iteration, the direction of the largest decrease may be replaced by the total
+ * displacement of the iteration.
+ *
+ * The line searches do not use Brent's method, which evaluates one point after the
+ * other, but sample the line in batches of NumberOfLineProbes points, see
+ * ParallelEvaluationOptimizer. First, the probes are placed at multiples of StepLength
+ * on both sides of the current position. As long as the best sample is at the end of
+ * the sampled range, the range is extended beyond it, with a doubled spacing. Then the
+ * interval around the best sample is refined, by placing the probes uniformly inside
+ * it, until its half width is less than StepTolerance, or after MaximumLineIteration
+ * batches. A line search never moves to a position with a higher value.
+ *
+ * The optimization stops after MaximumIteration iterations, or when the relative
+ * decrease of the value in an iteration is less than ValueTolerance.
+ *
+ * \ingroup Numerics Optimizers
+ * \sa ParallelPowell
+ */
+
+class ParallelPowellOptimizer : public ParallelEvaluationOptimizer
+{
+public:
+  /** Standard ITK.*/
+  typedef ParallelPowellOptimizer     Self;
+  typedef ParallelEvaluationOptimizer Superclass;
+  typedef SmartPointer<Self>          Pointer;
+  typedef SmartPointer<const Self>    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelPowellOptimizer, ParallelEvaluationOptimizer);
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType      MeasureType;
+  typedef Superclass::ParametersType   ParametersType;
+  typedef Superclass::CostFunctionType CostFunctionType;
+  typedef Superclass::ScalesType       ScalesType;
+
+  /** Codes of stopping conditions. */
+  typedef enum
+  {
+    MetricError,
+    MaximumNumberOfIterations,
+    ValueTolerance,
+    Unknown
+  } StopConditionType;
+
+  void
+  StartOptimization(void) override;
+
+  virtual void
+  ResumeOptimization(void);
+
+  virtual void
+  StopOptimization(void);
+
+  /** Get information about the optimization process. */
+  itkGetConstMacro(CurrentIteration, unsigned long);
+  itkGetConstMacro(CurrentValue, MeasureType);
+  itkGetConstMacro(StopCondition, StopConditionType);
+
+  /** Get the length of the last line step, in the scaled parameters. */
+  itkGetConstMacro(CurrentStepLength, double);
+
+  /** Get the number of batches of the last line search. */
+  itkGetConstMacro(CurrentLineIteration, unsigned long);
+
+  /** Setting: the spacing of the first probes of a line search. Default: 1.0 */
+  itkSetMacro(StepLength, double);
+  itkGetConstMacro(StepLength, double);
+
+  /** Setting: the accuracy of a line search, in the scaled parameters. Default: 1e-6 */
+  itkSetMacro(StepTolerance, double);
+  itkGetConstMacro(StepTolerance, double);
+
+  /** Setting: the relative value tolerance. Default: 1e-6 */
+  itkSetMacro(ValueTolerance, double);
+  itkGetConstMacro(ValueTolerance, double);
+
+  /** Setting: the maximum number of iterations. Default: 100 */
+  itkSetClampMacro(MaximumIteration, unsigned long, 1, NumericTraits<unsigned long>::max());
+  itkGetConstMacro(MaximumIteration, unsigned long);
+
+  /** Setting: the maximum number of batches of a line search. Default: 100 */
+  itkSetClampMacro(MaximumLineIteration, unsigned long, 1, NumericTraits<unsigned long>::max());
+  itkGetConstMacro(MaximumLineIteration, unsigned long);
+
+  /** Setting: the number of probes in a batch of a line search. If set to 0, the
+   * number of positions that can be evaluated at the same time is used. At least
+   * two probes are used. Default: 0 */
+  itkSetMacro(NumberOfLineProbes, unsigned int);
+  itkGetConstMacro(NumberOfLineProbes, unsigned int);
+
+protected:
+  ParallelPowellOptimizer() = default;
+  ~ParallelPowellOptimizer() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Minimize along the direction, of unit length, starting from the current position.
+   * Moves the current position and updates the current value and step length. */
+  virtual void
+  LineOptimize(const ParametersType & direction);
+
+  /** Evaluate the positions, and stop the optimization in case of an error. */
+  void
+  EvaluatePositions(const std::vector<ParametersType> & positions, std::vector<MeasureType> & values);
+
+  /** The search directions, in the scaled parameter space. */
+  std::vector<ParametersType> m_Directions;
+
+  unsigned long     m_CurrentIteration{ 0 };
+  unsigned long     m_CurrentLineIteration{ 0 };
+  MeasureType       m_CurrentValue{ 0.0 };
+  double            m_CurrentStepLength{ 0.0 };
+  StopConditionType m_StopCondition{ Unknown };
+  bool              m_Stop{ false };
+
+private:
+  ParallelPowellOptimizer(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  double        m_StepLength{ 1.0 };
+  double        m_StepTolerance{ 1e-6 };
+  double        m_ValueTolerance{ 1e-6 };
+  unsigned long m_MaximumIteration{ 100 };
+  unsigned long m_MaximumLineIteration{ 100 };
+  unsigned int  m_NumberOfLineProbes{ 0 };
+};
+
+} // end namespace itk
+
+#endif // end #ifndef itkParallelPowellOptimizer_h
@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxParallelSimplex_h
+#define elxParallelSimplex_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkParallelSimplexOptimizer.h"
+
+namespace elastix
+{
+
+/**
+ * \class ParallelSimplex
+ * \brief An optimizer based on the itk::ParallelSimplexOptimizer.
+ *
+ * A Nelder-Mead simplex optimizer, which evaluates the vertices of the initial simplex
+ * and of a shrink step as one batch. See the documentation of the
+ * itk::ParallelSimplexOptimizer for more information.
+ *
+ * The batches are evaluated concurrently, each thread with its own copy of the metric,
+ * the transform and the interpolator, see the UseMultiThreadingForOptimizer parameter of
+ * the OptimizerBase. When the metric cannot be copied, the positions of a batch are
+ * evaluated one after the other. The iterates are the same in both cases.
+ *
+ * The parameters used in this class are:
+ * \parameter Optimizer: Select this optimizer as follows:\n
+ *    <tt>(Optimizer "ParallelSimplex")</tt>
+ * \parameter MaximumNumberOfIterations: The maximum number of iterations in each resolution. \n
+ *    example: <tt>(MaximumNumberOfIterations 100 100 50)</tt> \n
+ *    Default value: 500.\n
+ * \parameter ValueTolerance: Stop when the values of all vertices differ less than this
+ *    from the best value, and the PositionTolerance is met as well.\n
+ *    example: <tt>(ValueTolerance 0.001 0.0001 0.000001)</tt> \n
+ *    Default value: 1e-8. Can be specified for each resolution.\n
+ * \parameter PositionTolerance: Stop when all vertices lie within this distance, in each
+ *    scaled parameter, from the best vertex, and the ValueTolerance is met as well.\n
+ *    example: <tt>(PositionTolerance 0.001 0.0001 0.000001)</tt> \n
+ *    Default value: 1e-8. Can be specified for each resolution.\n
+ * \parameter AutomaticInitialSimplex: Determine the initial simplex from the initial position.\n
+ *    example: <tt>(AutomaticInitialSimplex "true")</tt> \n
+ *    Default value: "false". Can be specified for each resolution.\n
+ * \parameter InitialSimplexDelta: The size of the initial simplex in each parameter, used when
+ *    AutomaticInitialSimplex is "false".\n
+ *    example: <tt>(InitialSimplexDelta 1.0 1.0 0.1)</tt> \n
+ *    Default value: 1.0 for each parameter.\n
+ *
+ * \ingroup Optimizers
+ * \sa ParallelSimplexOptimizer
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT ParallelSimplex
+  : public itk::ParallelSimplexOptimizer
+  , public OptimizerBase<TElastix>
+{
+public:
+  /** Standard ITK.*/
+  typedef ParallelSimplex               Self;
+  typedef ParallelSimplexOptimizer      Superclass1;
+  typedef OptimizerBase<TElastix>       Superclass2;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ParallelSimplex, ParallelSimplexOptimizer);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific optimizer. \n
+   * example: <tt>(Optimizer "ParallelSimplex")</tt>\n
+   */
+  elxClassNameMacro("ParallelSimplex");
+
+  /** Typedef's inherited from Superclass1.*/
+  typedef Superclass1::CostFunctionType  CostFunctionType;
+  typedef Superclass1::ScalesType        ScalesType;
+  typedef Superclass1::ParametersType    ParametersType;
+  typedef Superclass1::StopConditionType StopConditionType;
+  typedef Superclass1::StepType          StepType;
+
+  /** Typedef's inherited from Elastix.*/
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+
+  /** The copies of the metric for the threads. */
+  typedef typename Superclass2::WorkUnitCostFunctionContainerType WorkUnitCostFunctionContainerType;
+
+  /** Check if any scales are set, and set the UseScales flag on or off;
+   * after that call the superclass' implementation */
+  void
+  StartOptimization(void) override;
+
+  /** Methods invoked by elastix, in which parameters can be set and
+   * progress information can be printed. */
+  void
+  BeforeRegistration(void) override;
+
+  void
+  BeforeEachResolution(void) override;
+
+  void
+  AfterEachResolution(void) override;
+
+  void
+  AfterEachIteration(void) override;
+
+  void
+  AfterRegistration(void) override;
+
+  /** Override the SetInitialPosition.
+   * Override the implementation in itkOptimizer.h, to
+   * ensure that the scales array and the parameters
+   * array have the same size. */
+  void
+  SetInitialPosition(const ParametersType & param) override;
+
+protected:
+  ParallelSimplex() = default;
+  ~ParallelSimplex() override = default;
+
+  /** Create a copy of the metric for each thread, to evaluate the batches concurrently. */
+  void
+  InitializeWorkUnitCostFunctions(void) override;
+
+  /** Update the image sampler that the copies of the metric share. */
+  void
+  BeforeConcurrentEvaluation(void) override;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  ParallelSimplex(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxParallelSimplex.hxx"
+#endif
+
+#endif // end #ifndef elxParallelSimplex_h
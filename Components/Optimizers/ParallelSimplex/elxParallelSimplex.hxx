@@ -0,0 +1,295 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef elxParallelSimplex_hxx
+#define elxParallelSimplex_hxx
+
+#include "elxParallelSimplex.h"
+#include <iomanip>
+#include <string>
+
+namespace elastix
+{
+
+/**
+ * ***************** StartOptimization ************************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::StartOptimization(void)
+{
+  /** Check if the entered scales are correct and != [ 1 1 1 ...] */
+  this->SetUseScales(false);
+  const ScalesType & scales = this->GetScales();
+  if (scales.GetSize() == this->GetInitialPosition().GetSize())
+  {
+    ScalesType unit_scales(scales.GetSize());
+    unit_scales.Fill(1.0);
+    if (scales != unit_scales)
+    {
+      /** only then: */
+      this->SetUseScales(true);
+    }
+  }
+
+  /** Call the superclass */
+  this->Superclass1::StartOptimization();
+
+} // end StartOptimization()
+
+
+/**
+ * ***************** BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::BeforeRegistration(void)
+{
+  /** Add target cells to IterationInfo.*/
+  this->AddTargetCellToIterationInfo("2:Metric");
+  this->AddTargetCellToIterationInfo("3:SimplexSize");
+  this->AddTargetCellToIterationInfo("4:Step");
+
+  /** Format the metric and simplex size as floats */
+  this->GetIterationInfoAt("2:Metric") << std::showpoint << std::fixed;
+  this->GetIterationInfoAt("3:SimplexSize") << std::showpoint << std::fixed;
+
+} // end BeforeRegistration()
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::BeforeEachResolution(void)
+{
+  /** Get the current resolution level.*/
+  unsigned int level = static_cast<unsigned int>(this->m_Registration->GetAsITKBaseType()->GetCurrentLevel());
+
+  /** Set the value tolerance.*/
+  double valueTolerance = 1e-8;
+  this->m_Configuration->ReadParameter(valueTolerance, "ValueTolerance", this->GetComponentLabel(), level, 0);
+  this->SetValueTolerance(valueTolerance);
+
+  /** Set the position tolerance.*/
+  double positionTolerance = 1e-8;
+  this->m_Configuration->ReadParameter(positionTolerance, "PositionTolerance", this->GetComponentLabel(), level, 0);
+  this->SetPositionTolerance(positionTolerance);
+
+  /** Set the maximumNumberOfIterations.*/
+  unsigned int maximumNumberOfIterations = 500;
+  this->m_Configuration->ReadParameter(
+    maximumNumberOfIterations, "MaximumNumberOfIterations", this->GetComponentLabel(), level, 0);
+  this->SetMaximumNumberOfIterations(maximumNumberOfIterations);
+
+  /** Set the automaticinitialsimplex.*/
+  bool automaticinitialsimplex = false;
+  this->m_Configuration->ReadParameter(
+    automaticinitialsimplex, "AutomaticInitialSimplex", this->GetComponentLabel(), level, 0);
+  this->SetAutomaticInitialSimplex(automaticinitialsimplex);
+
+  /** If no automaticinitialsimplex, InitialSimplexDelta should be given.*/
+  if (!automaticinitialsimplex)
+  {
+    unsigned int numberofparameters =
+      this->m_Elastix->GetElxTransformBase()->GetAsITKBaseType()->GetNumberOfParameters();
+    ParametersType initialsimplexdelta(numberofparameters);
+    initialsimplexdelta.Fill(1);
+
+    for (unsigned int i = 0; i < numberofparameters; ++i)
+    {
+      this->m_Configuration->ReadParameter(initialsimplexdelta[i], "InitialSimplexDelta", i);
+    }
+
+    this->SetInitialSimplexDelta(initialsimplexdelta);
+  }
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ***************** AfterEachIteration *************************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::AfterEachIteration(void)
+{
+  /** Print some information */
+  this->GetIterationInfoAt("2:Metric") << this->GetCurrentValue();
+  this->GetIterationInfoAt("3:SimplexSize") << this->GetCurrentSimplexSize();
+
+  std::string step;
+  switch (this->GetCurrentStep())
+  {
+    case Reflection:
+      step = "R";
+      break;
+
+    case Expansion:
+      step = "E";
+      break;
+
+    case OutsideContraction:
+      step = "OC";
+      break;
+
+    case InsideContraction:
+      step = "IC";
+      break;
+
+    case Shrink:
+      step = "S";
+      break;
+
+    default:
+      step = "I";
+      break;
+  }
+  this->GetIterationInfoAt("4:Step") << step;
+
+} // end AfterEachIteration()
+
+
+/**
+ * ***************** AfterEachResolution *************************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::AfterEachResolution(void)
+{
+  /**
+  typedef enum {
+    MetricError,
+    MaximumNumberOfIterations,
+    ValueAndPositionTolerance,
+    Unknown }    StopConditionType;  */
+
+  std::string stopcondition;
+
+  switch (this->GetStopCondition())
+  {
+    case MetricError:
+      stopcondition = "Error in metric";
+      break;
+
+    case MaximumNumberOfIterations:
+      stopcondition = "Maximum number of iterations has been reached";
+      break;
+
+    case ValueAndPositionTolerance:
+      stopcondition = "The simplex has converged in value and position";
+      break;
+
+    default:
+      stopcondition = "Unknown";
+      break;
+  }
+
+  /** Print the stopping condition */
+  elxout << "Stopping condition: " << stopcondition << "." << std::endl;
+  elxout << "Number of metric evaluations: " << this->GetNumberOfCostFunctionEvaluations() << std::endl;
+
+} // end AfterEachResolution()
+
+
+/**
+ * ******************* AfterRegistration ************************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::AfterRegistration(void)
+{
+  /** Print the best metric value */
+  double bestValue = this->GetCurrentValue();
+  elxout << std::endl << "Final metric value  = " << bestValue << std::endl;
+
+} // end AfterRegistration()
+
+
+/**
+ * ******************* SetInitialPosition ***********************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::SetInitialPosition(const ParametersType & param)
+{
+  /** Override the implementation in itkOptimizer.h, to
+   * ensure that the scales array and the parameters
+   * array have the same size.
+   */
+
+  /** Call the Superclass' implementation. */
+  this->Superclass1::SetInitialPosition(param);
+
+  /** Set the scales array to the same size if the size has been changed */
+  ScalesType   scales = this->GetScales();
+  unsigned int paramsize = param.Size();
+
+  if ((scales.Size()) != paramsize)
+  {
+    ScalesType newscales(paramsize);
+    newscales.Fill(1.0);
+    this->SetScales(newscales);
+  }
+
+} // end SetInitialPosition()
+
+
+/**
+ * ******************* InitializeWorkUnitCostFunctions ***********************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::InitializeWorkUnitCostFunctions(void)
+{
+  /** Evaluate the batches concurrently, when the metric can be copied for each thread. */
+  const WorkUnitCostFunctionContainerType copies = this->CreateWorkUnitCostFunctions(this->GetCostFunction());
+  this->SetWorkUnitCostFunctions(copies);
+  this->SetUseMultiThread(!copies.empty());
+  this->SetNumberOfWorkUnits(static_cast<itk::ThreadIdType>(copies.size()));
+
+  /** Call the superclass' implementation. */
+  this->Superclass1::InitializeWorkUnitCostFunctions();
+
+} // end InitializeWorkUnitCostFunctions()
+
+
+/**
+ * ******************* BeforeConcurrentEvaluation ***********************
+ */
+
+template <class TElastix>
+void
+ParallelSimplex<TElastix>::BeforeConcurrentEvaluation(void)
+{
+  this->UpdateWorkUnitCostFunctions();
+
+} // end BeforeConcurrentEvaluation()
+
+} // end namespace elastix
+
+#endif // end #ifndef elxParallelSimplex_hxx
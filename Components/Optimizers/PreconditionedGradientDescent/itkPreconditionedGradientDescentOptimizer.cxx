@@ -240,20 +240,18 @@ PreconditionedGradientDescentOptimizer::AdvanceOneStep(void)
 
   const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-  DerivativeType &       searchDirection = this->m_SearchDirection;
+  ParametersType & currentPosition = this->m_ScaledCurrentPosition;
+  DerivativeType & searchDirection = this->m_SearchDirection;
 
   /** Compute the search direction */
   this->CholmodSolve(this->m_Gradient, searchDirection);
 
-  /** Compute the new position */
-  ParametersType newPosition(spaceDimension);
+  /** Compute the new position, in place */
   for (unsigned int j = 0; j < spaceDimension; ++j)
   {
-    newPosition[j] = currentPosition[j] - this->m_LearningRate * searchDirection[j];
+    currentPosition[j] -= this->m_LearningRate * searchDirection[j];
   }
-
-  this->SetScaledCurrentPosition(newPosition);
+  this->Modified();
 
   this->InvokeEvent(IterationEvent());
 
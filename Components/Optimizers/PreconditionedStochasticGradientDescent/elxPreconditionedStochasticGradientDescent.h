@@ -167,6 +167,25 @@ namespace elastix
  * \parameter RegularizationKappa: Selects for the preconditioner regularization.
  *   The parameter can be specified for each resolution, or for all resolutions at once.\n
  *   example: <tt>(RegularizationKappa 0.9)</tt>\n
+ * \parameter JacobiTypePreconditioner: Selects the preconditioner that only depends on the
+ *   Jacobian of the transform, instead of on the displacements due to the gradient.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(JacobiTypePreconditioner "false")</tt>\n
+ *   Default: false.
+ * \parameter ReusePreconditioner: Selects whether a JacobiTypePreconditioner is reused when
+ *   neither the number of parameters nor the fixed parameters of the transform changed since
+ *   the previous resolution, e.g. for a B-spline grid that is not refined. The reused
+ *   preconditioner is then the one of the previous resolution, which may differ from a new
+ *   estimate for other images or samples.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(ReusePreconditioner "true")</tt>\n
+ *   Default: false.
+ * \parameter PreconditionerRefreshInterval: The number of iterations after which the
+ *   preconditioner is computed again at the current position. The step size settings
+ *   are not estimated again. A value of 0 computes it at the start of the resolution only.
+ *   The parameter can be specified for each resolution, or for all resolutions at once.\n
+ *   example: <tt>(PreconditionerRefreshInterval 100)</tt>\n
+ *   Default: 0. The parameter only has influence when AutomaticParameterEstimation is used.
  *
  * \todo: this class contains a lot of functional code, which actually does not belong here.
  *
@@ -379,6 +398,13 @@ protected:
   virtual void
   AutomaticPreconditionerEstimation(void);
 
+  /** Compute the preconditioner m_PreconditionVector at the current position,
+   * and the maxJJ needed for the noise compensation. When allowReuse is true,
+   * the preconditioner of the previous resolution may be reused.
+   */
+  virtual void
+  ComputePreconditioner(const bool allowReuse, double & maxJJ);
+
   /** Measure some derivatives, exact and approximated. Returns
    * the squared magnitude of the gradient and approximation error.
    * Needed for the automatic parameter estimation.
@@ -425,6 +451,14 @@ private:
   /** The flag of using noise compensation. */
   bool m_UseNoiseCompensation;
   bool m_OriginalButSigmoidToDefault;
+
+  /** Private variables for the preconditioner computation. */
+  bool           m_UseJacobiTypePreconditioner;
+  bool           m_ReusePreconditioner;
+  SizeValueType  m_PreconditionerRefreshInterval;
+  ParametersType m_PreviousPreconditionVector;
+  ParametersType m_PreviousFixedParameters;
+  double         m_PreviousMaxJJ;
 };
 
 } // end namespace elastix
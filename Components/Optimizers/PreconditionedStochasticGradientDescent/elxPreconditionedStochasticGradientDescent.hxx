@@ -30,10 +30,6 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkTimeProbe.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 namespace elastix
 {
 
@@ -69,6 +65,11 @@ PreconditionedStochasticGradientDescent<TElastix>::PreconditionedStochasticGradi
 
   this->m_UseNoiseCompensation = true;
 
+  this->m_UseJacobiTypePreconditioner = false;
+  this->m_ReusePreconditioner = false;
+  this->m_PreconditionerRefreshInterval = 0;
+  this->m_PreviousMaxJJ = 0.0;
+
 } // Constructor
 
 
@@ -95,6 +96,8 @@ PreconditionedStochasticGradientDescent<TElastix>::BeforeRegistration(void)
   this->GetIterationInfoAt("4b:||SearchDirection||") << std::showpoint << std::fixed;
 
   this->m_SettingsVector.clear();
+  this->m_PreviousPreconditionVector = ParametersType();
+  this->m_PreviousFixedParameters = ParametersType();
 
 } // end BeforeRegistration()
 
@@ -247,6 +250,20 @@ PreconditionedStochasticGradientDescent<TElastix>::BeforeEachResolution(void)
     this->GetConfiguration()->ReadParameter(
       this->m_ConditionNumber, "ConditionNumber", this->GetComponentLabel(), level, 0);
 
+    /** Set the type of preconditioner, whether it may be reused, and how often it is refreshed. */
+    this->m_UseJacobiTypePreconditioner = false;
+    this->GetConfiguration()->ReadParameter(
+      this->m_UseJacobiTypePreconditioner, "JacobiTypePreconditioner", this->GetComponentLabel(), level, 0);
+    this->m_ReusePreconditioner = false;
+    this->GetConfiguration()->ReadParameter(
+      this->m_ReusePreconditioner, "ReusePreconditioner", this->GetComponentLabel(), level, 0);
+    this->m_PreconditionerRefreshInterval = 0;
+    this->GetConfiguration()->ReadParameter(this->m_PreconditionerRefreshInterval,
+                                            "PreconditionerRefreshInterval",
+                                            this->GetComponentLabel(),
+                                            level,
+                                            0);
+
   } // end if automatic parameter estimation
   else
   {
@@ -307,12 +324,29 @@ PreconditionedStochasticGradientDescent<TElastix>::AfterEachIteration(void)
     this->GetIterationInfoAt("4b:||SearchDirection||") << this->GetSearchDirection().magnitude();
   }
 
+  /** Refresh the preconditioner at the current position, keeping the step size settings. */
+  const SizeValueType refreshInterval = this->m_PreconditionerRefreshInterval;
+  if (this->m_AutomaticParameterEstimation && refreshInterval > 0 &&
+      (this->GetCurrentIteration() + 1) % refreshInterval == 0 &&
+      this->GetCurrentIteration() + 1 < this->GetNumberOfIterations())
+  {
+    double maxJJ = 0.0;
+    this->ComputePreconditioner(false, maxJJ);
+  }
+
   /** Select new spatial samples for the computation of the metric. */
   if (this->GetNewSamplesEveryIteration())
   {
     this->SelectNewSamples();
   }
 
+  /** Stop when the metric value and the gradient magnitude do not decrease anymore. */
+  if (this->TestForConvergence(this->GetValue(), this->GetGradient().magnitude()))
+  {
+    this->m_StopCondition = ConvergenceDetected;
+    this->StopOptimization();
+  }
+
 } // end AfterEachIteration()
 
 
@@ -331,7 +365,8 @@ PreconditionedStochasticGradientDescent<TElastix>::AfterEachResolution(void)
    * typedef enum {
    *   MaximumNumberOfIterations,
    *   MetricError,
-   *   MinimumStepSize } StopConditionType;
+   *   MinimumStepSize,
+   *   ConvergenceDetected } StopConditionType;
    */
   std::string stopcondition;
 
@@ -349,6 +384,10 @@ PreconditionedStochasticGradientDescent<TElastix>::AfterEachResolution(void)
       stopcondition = "The minimum step length has been reached";
       break;
 
+    case ConvergenceDetected:
+      stopcondition = "The metric value and the gradient magnitude have converged";
+      break;
+
     default:
       stopcondition = "Unknown";
       break;
@@ -419,28 +458,14 @@ template <class TElastix>
 void
 PreconditionedStochasticGradientDescent<TElastix>::AdvanceOneStep(void)
 {
-  /** Get space dimension. */
-  const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
-
   /** Compute and set the learning rate. */
   const double lamda = this->GetParam_a() / (1.0 + this->Superclass1::GetCurrentTime() / this->GetParam_A());
   this->SetLearningRate(lamda);
 
-  DerivativeType & searchDirection = this->m_SearchDirection;
-
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
+  /** Compute the search direction and update the position in place. */
   const double lamda2 = lamda * this->m_NoiseFactor;
-  for (unsigned int j = 0; j < spaceDimension; ++j)
-  {
-    searchDirection[j] = this->m_PreconditionVector[j] * this->m_Gradient[j];
-    newPosition[j] = currentPosition[j] - lamda2 * searchDirection[j];
-  }
+  this->m_ParameterUpdateKernel->Update(
+    lamda2, this->m_Gradient, this->m_PreconditionVector, this->m_SearchDirection, this->m_ScaledCurrentPosition);
 
   this->Superclass1::UpdateCurrentTime();
   this->InvokeEvent(itk::IterationEvent());
@@ -524,8 +549,6 @@ PreconditionedStochasticGradientDescent<TElastix>::AutomaticPreconditionerEstima
 
   this->m_SearchDirection = ParametersType(P);
   this->m_SearchDirection.Fill(0.0); // if the print out is not needed, this could be removed. YQ
-  /** Get the current resolution level. */
-  unsigned int level = static_cast<unsigned int>(this->m_Registration->GetAsITKBaseType()->GetCurrentLevel());
 
   /** Cast to advanced metric type. */
   typedef typename ElastixType::MetricBaseType::AdvancedMetricType MetricType;
@@ -536,89 +559,13 @@ PreconditionedStochasticGradientDescent<TElastix>::AutomaticPreconditionerEstima
                       << "the metric to be of type AdvancedImageToImageMetric!");
   }
 
-  /** Getting pointers to the samplers. */
-  const unsigned int                   M = this->GetElastix()->GetNumberOfMetrics();
-  std::vector<ImageSamplerBasePointer> originalSampler(M);
-  for (unsigned int m = 0; m < M; ++m)
-  {
-    ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
-    originalSampler[m] = sampler.GetPointer();
-  }
-
-  /** Create a random sampler with more samples that can be used for the pre-conditioner computation. */
-  // std::vector< ImageRandomCoordinateSamplerPointer > preconditionSamplers( M, 0 ); // very slow, leave this for
-  // reminder. YQ
-  std::vector<ImageRandomSamplerPointer> preconditionSamplers(M);
-  for (unsigned int m = 0; m < M; ++m)
-  {
-    ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
-    // preconditionSamplers[ m ] = ImageRandomCoordinateSamplerType::New();
-    preconditionSamplers[m] = ImageRandomSamplerType::New();
-    preconditionSamplers[m]->SetInput(sampler->GetInput());
-    preconditionSamplers[m]->SetInputImageRegion(sampler->GetInputImageRegion());
-    preconditionSamplers[m]->SetMask(sampler->GetMask());
-    preconditionSamplers[m]->SetNumberOfSamples(this->m_NumberOfSamplesForPrecondition);
-    preconditionSamplers[m]->Update();
-    this->GetElastix()->GetElxMetricBase(m)->SetAdvancedMetricImageSampler(preconditionSamplers[m]);
-  }
-
-  /** Construct preconditionerEstimator to initialize the preconditioner estimation. */
-  PreconditionerEstimationPointer preconditionerEstimator = PreconditionerEstimationType::New();
-  preconditionerEstimator->SetFixedImage(testPtr->GetFixedImage());
-  preconditionerEstimator->SetFixedImageRegion(testPtr->GetFixedImageRegion());
-  preconditionerEstimator->SetFixedImageMask(testPtr->GetFixedImageMask());
-  preconditionerEstimator->SetTransform(this->GetRegistration()->GetAsITKBaseType()->GetModifiableTransform());
-  preconditionerEstimator->SetCostFunction(this->m_CostFunction);
-  preconditionerEstimator->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
-  preconditionerEstimator->SetRegularizationKappa(this->m_RegularizationKappa);
-  preconditionerEstimator->SetMaximumStepLength(this->m_MaximumStepLength);
-  preconditionerEstimator->SetConditionNumber(this->m_ConditionNumber);
-  preconditionerEstimator->SetUseScales(false); // Make sure scales are not used
-
-  /** Construct the preconditioner and initialize. */
-  this->m_PreconditionVector = ParametersType(P);
-  this->m_PreconditionVector.Fill(0.0);
-
   /** Compute the preconditioner. */
-  itk::TimeProbe timer_P;
-  timer_P.Start();
-  elxout << "  Computing preconditioner ..." << std::endl;
   double maxJJ = 0; // needed for the noise compensation term
-
-  bool useJacobiType = false;
-  this->GetConfiguration()->ReadParameter(
-    useJacobiType, "JacobiTypePreconditioner", this->GetComponentLabel(), level, 0);
-
-  if (useJacobiType)
-  {
-    preconditionerEstimator->ComputeJacobiTypePreconditioner(
-      this->GetScaledCurrentPosition(), maxJJ, this->m_PreconditionVector);
-  }
-  else
-  {
-    preconditionerEstimator->Compute(this->GetScaledCurrentPosition(), maxJJ, this->m_PreconditionVector);
-  }
-
-  timer_P.Stop();
-  elxout << "  Computing the preconditioner took " << Conversion::SecondsToDHMS(timer_P.GetMean(), 6) << std::endl;
-
-#if 0
-  elxout << std::scientific;
-  elxout << "The preconditioner: [ ";
-  for( unsigned int i = 0; i < P; ++i ) elxout << m_PreconditionVector[ i ] << " ";
-  elxout << "]" <<  std::endl;
-  elxout << std::fixed;
-#endif
-
-  /** Set the sampler back to the original. */
-  for (unsigned int m = 0; m < M; ++m)
-  {
-    this->GetElastix()->GetElxMetricBase(m)->SetAdvancedMetricImageSampler(originalSampler[m]);
-  }
+  this->ComputePreconditioner(true, maxJJ);
 
   /** This part is for PSGD-Jacobian type preconditioner, automatic etimation of the step size. */
   double jacg = 0.0;
-  if (useJacobiType)
+  if (this->m_UseJacobiTypePreconditioner)
   {
     itk::TimeProbe timer4;
     /** Construct computeJacobianTerms to initialize the parameter estimation. */
@@ -631,6 +578,7 @@ PreconditionedStochasticGradientDescent<TElastix>::AutomaticPreconditionerEstima
       this->GetRegistration()->GetAsITKBaseType()->GetModifiableTransform());
     computeDisplacementDistribution->SetCostFunction(this->m_CostFunction);
     computeDisplacementDistribution->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
+    computeDisplacementDistribution->SetUseThreadPool(testPtr->GetUseThreadPool());
 
     std::string maximumDisplacementEstimationMethod = "2sigma";
     this->GetConfiguration()->ReadParameter(
@@ -683,7 +631,7 @@ PreconditionedStochasticGradientDescent<TElastix>::AutomaticPreconditionerEstima
   const double A = this->GetParam_A();
   const double delta = this->GetMaximumStepLength();
 
-  if (useJacobiType)
+  if (this->m_UseJacobiTypePreconditioner)
   {
     a = delta * std::pow(A + 1.0, alpha) / (jacg + 1e-14);
   }
@@ -696,6 +644,132 @@ PreconditionedStochasticGradientDescent<TElastix>::AutomaticPreconditionerEstima
 } // end AutomaticPreconditionerEstimation()
 
 
+/**
+ * ******************* ComputePreconditioner **********************
+ */
+
+template <class TElastix>
+void
+PreconditionedStochasticGradientDescent<TElastix>::ComputePreconditioner(const bool allowReuse, double & maxJJ)
+{
+  /** Get current position to compute the preconditioner. */
+  TransformType * transform = this->GetRegistration()->GetAsITKBaseType()->GetModifiableTransform();
+  transform->SetParameters(this->GetCurrentPosition());
+  const unsigned int P = static_cast<unsigned int>(transform->GetNumberOfParameters());
+
+  /** The Jacobi type preconditioner only depends on the Jacobian of the
+   * transform, so it is reused when the transform did not change, e.g. when
+   * consecutive resolutions use the same B-spline grid.
+   */
+  const bool reuse = allowReuse && this->m_UseJacobiTypePreconditioner && this->m_ReusePreconditioner &&
+                     this->m_PreviousPreconditionVector.GetSize() == P &&
+                     this->m_PreviousFixedParameters == transform->GetFixedParameters();
+  if (reuse)
+  {
+    this->m_PreconditionVector = this->m_PreviousPreconditionVector;
+    maxJJ = this->m_PreviousMaxJJ;
+    elxout << "  Reusing the preconditioner of the previous resolution." << std::endl;
+    return;
+  }
+
+  /** Cast to advanced metric type. */
+  typedef typename ElastixType::MetricBaseType::AdvancedMetricType MetricType;
+  MetricType * testPtr = dynamic_cast<MetricType *>(this->GetElastix()->GetElxMetricBase()->GetAsITKBaseType());
+  if (!testPtr)
+  {
+    itkExceptionMacro(<< "ERROR: PreconditionedStochasticGradientDescent expects "
+                      << "the metric to be of type AdvancedImageToImageMetric!");
+  }
+
+  /** Getting pointers to the samplers. */
+  const unsigned int                   M = this->GetElastix()->GetNumberOfMetrics();
+  std::vector<ImageSamplerBasePointer> originalSampler(M);
+  for (unsigned int m = 0; m < M; ++m)
+  {
+    ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
+    originalSampler[m] = sampler.GetPointer();
+  }
+
+  /** Create a random sampler with more samples that can be used for the pre-conditioner computation.
+   * The Jacobi type preconditioner does not need the gradient, so does not need them.
+   */
+  // std::vector< ImageRandomCoordinateSamplerPointer > preconditionSamplers( M, 0 ); // very slow, leave this for
+  // reminder. YQ
+  std::vector<ImageRandomSamplerPointer> preconditionSamplers(M);
+  for (unsigned int m = 0; m < M && !this->m_UseJacobiTypePreconditioner; ++m)
+  {
+    ImageSamplerBasePointer sampler = this->GetElastix()->GetElxMetricBase(m)->GetAdvancedMetricImageSampler();
+    // preconditionSamplers[ m ] = ImageRandomCoordinateSamplerType::New();
+    preconditionSamplers[m] = ImageRandomSamplerType::New();
+    preconditionSamplers[m]->SetInput(sampler->GetInput());
+    preconditionSamplers[m]->SetInputImageRegion(sampler->GetInputImageRegion());
+    preconditionSamplers[m]->SetMask(sampler->GetMask());
+    preconditionSamplers[m]->SetNumberOfSamples(this->m_NumberOfSamplesForPrecondition);
+    preconditionSamplers[m]->Update();
+    this->GetElastix()->GetElxMetricBase(m)->SetAdvancedMetricImageSampler(preconditionSamplers[m]);
+  }
+
+  /** Construct preconditionerEstimator to initialize the preconditioner estimation.
+   * It runs its threads on the same backend as the metric.
+   */
+  PreconditionerEstimationPointer preconditionerEstimator = PreconditionerEstimationType::New();
+  preconditionerEstimator->SetFixedImage(testPtr->GetFixedImage());
+  preconditionerEstimator->SetFixedImageRegion(testPtr->GetFixedImageRegion());
+  preconditionerEstimator->SetFixedImageMask(testPtr->GetFixedImageMask());
+  preconditionerEstimator->SetTransform(transform);
+  preconditionerEstimator->SetCostFunction(this->m_CostFunction);
+  preconditionerEstimator->SetNumberOfJacobianMeasurements(this->m_NumberOfJacobianMeasurements);
+  preconditionerEstimator->SetRegularizationKappa(this->m_RegularizationKappa);
+  preconditionerEstimator->SetMaximumStepLength(this->m_MaximumStepLength);
+  preconditionerEstimator->SetConditionNumber(this->m_ConditionNumber);
+  preconditionerEstimator->SetUseScales(false); // Make sure scales are not used
+  preconditionerEstimator->SetUseThreadPool(testPtr->GetUseThreadPool());
+
+  /** Construct the preconditioner and initialize. */
+  this->m_PreconditionVector = ParametersType(P);
+  this->m_PreconditionVector.Fill(0.0);
+
+  /** Compute the preconditioner. */
+  itk::TimeProbe timer_P;
+  timer_P.Start();
+  elxout << "  Computing preconditioner ..." << std::endl;
+  maxJJ = 0;
+
+  if (this->m_UseJacobiTypePreconditioner)
+  {
+    preconditionerEstimator->ComputeJacobiTypePreconditioner(
+      this->GetScaledCurrentPosition(), maxJJ, this->m_PreconditionVector);
+  }
+  else
+  {
+    preconditionerEstimator->Compute(this->GetScaledCurrentPosition(), maxJJ, this->m_PreconditionVector);
+  }
+
+  timer_P.Stop();
+  elxout << "  Computing the preconditioner took " << Conversion::SecondsToDHMS(timer_P.GetMean(), 6) << std::endl;
+
+#if 0
+  elxout << std::scientific;
+  elxout << "The preconditioner: [ ";
+  for( unsigned int i = 0; i < P; ++i ) elxout << m_PreconditionVector[ i ] << " ";
+  elxout << "]" <<  std::endl;
+  elxout << std::fixed;
+#endif
+
+  /** Set the sampler back to the original. */
+  for (unsigned int m = 0; m < M && !this->m_UseJacobiTypePreconditioner; ++m)
+  {
+    this->GetElastix()->GetElxMetricBase(m)->SetAdvancedMetricImageSampler(originalSampler[m]);
+  }
+
+  /** Store the preconditioner for the next resolution. */
+  this->m_PreviousPreconditionVector = this->m_PreconditionVector;
+  this->m_PreviousFixedParameters = transform->GetFixedParameters();
+  this->m_PreviousMaxJJ = maxJJ;
+
+} // end ComputePreconditioner()
+
+
 /**
  * ******************** SampleGradients **********************
  */
@@ -64,6 +64,12 @@ namespace elastix
  *    itk::MoreThuenteLineSearchOptimizer tries to satisfy.\n
  *    example: <tt>(LineSearchGradientTolerance 0.9 0.9 0.9)</tt> \n
  *    Default value: 0.9.\n
+ * \parameter LineSearchUseValueOnlyProbes: Whether the itk::MoreThuenteLineSearchOptimizer
+ *    first computes only the metric value at a trial step, and skips the derivative
+ *    when the step overshoots the minimum. This pays off when the value is much
+ *    cheaper than the derivative.\n
+ *    example: <tt>(LineSearchUseValueOnlyProbes "true" "true" "false")</tt> \n
+ *    Default value: "false".\n
  * \parameter GradientMagnitudeTolerance: Stopping criterion. See the documentation of the
  *    itk::QuasiNewtonLBFGSOptimizer for more information.\n
  *    example: <tt>(GradientMagnitudeTolerance 0.001 0.0001 0.000001)</tt> \n
@@ -80,6 +86,12 @@ namespace elastix
  *    In general it is wise to do so.\n
  *    example: <tt>(StopIfWolfeNotSatisfied "true" "false")</tt> \n
  *    Default value: "true".\n
+ * \parameter UseFloatHistory: Whether to store the steps and gradient differences
+ *    of the last LBFGSUpdateAccuracy iterations in single precision. This halves
+ *    the memory of the optimizer, which matters for transforms with millions of
+ *    parameters.\n
+ *    example: <tt>(UseFloatHistory "true" "false")</tt> \n
+ *    Default value: "false".\n
  *
  * \ingroup Optimizers
  */
@@ -250,6 +250,12 @@ QuasiNewtonLBFGS<TElastix>::BeforeEachResolution(void)
     lineSearchGradientTolerance, "LineSearchGradientTolerance", this->GetComponentLabel(), level, 0);
   this->m_LineOptimizer->SetGradientTolerance(lineSearchGradientTolerance);
 
+  /** Set whether the line search uses value-only probes */
+  bool lineSearchUseValueOnlyProbes = false;
+  this->m_Configuration->ReadParameter(
+    lineSearchUseValueOnlyProbes, "LineSearchUseValueOnlyProbes", this->GetComponentLabel(), level, 0);
+  this->m_LineOptimizer->SetUseValueOnlyProbes(lineSearchUseValueOnlyProbes);
+
   /** Set the GradientMagnitudeTolerance */
   double gradientMagnitudeTolerance = 0.000001;
   this->m_Configuration->ReadParameter(
@@ -261,6 +267,11 @@ QuasiNewtonLBFGS<TElastix>::BeforeEachResolution(void)
   this->m_Configuration->ReadParameter(LBFGSUpdateAccuracy, "LBFGSUpdateAccuracy", this->GetComponentLabel(), level, 0);
   this->SetMemory(LBFGSUpdateAccuracy);
 
+  /** Set whether the history is stored in single precision. */
+  bool useFloatHistory = false;
+  this->m_Configuration->ReadParameter(useFloatHistory, "UseFloatHistory", this->GetComponentLabel(), level, 0);
+  this->SetUseFloatHistory(useFloatHistory);
+
   /** Check whether to stop optimisation if Wolfe conditions are not satisfied. */
   this->m_StopIfWolfeNotSatisfied = true;
   std::string stopIfWolfeNotSatisfied = "true";
@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkLineSearchOptimizer.h"
+#include "itkLBFGSHistory.h"
 #include <vector>
 
 namespace itk
@@ -51,6 +52,10 @@ namespace itk
  * The steplength is determined at each iteration by means of a
  * line search routine. The itk::MoreThuenteLineSearchOptimizer works well.
  *
+ * The steps and gradient differences of the last \f$M\f$ iterations are
+ * kept by an itk::LBFGSHistory, which may store them in single precision and
+ * computes the search direction with a multi-threaded two-loop recursion.
+ *
  *
  * \ingroup Numerics Optimizers
  */
@@ -73,11 +78,9 @@ public:
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
 
-  typedef Array<double>               RhoType;
-  typedef std::vector<ParametersType> SType;
-  typedef std::vector<DerivativeType> YType;
-  typedef Array<double>               DiagonalMatrixType;
-  typedef LineSearchOptimizer         LineSearchOptimizerType;
+  typedef Array<double>       RhoType;
+  typedef Array<double>       DiagonalMatrixType;
+  typedef LineSearchOptimizer LineSearchOptimizerType;
 
   typedef LineSearchOptimizerType::Pointer LineSearchOptimizerPointer;
 
@@ -131,6 +134,21 @@ public:
   itkSetMacro(Memory, unsigned int);
   itkGetConstMacro(Memory, unsigned int);
 
+  /** Setting: store the steps and gradient differences in single precision,
+   * which halves the memory of the history. The inner products are still
+   * computed in double precision. False by default. */
+  itkSetMacro(UseFloatHistory, bool);
+  itkGetConstMacro(UseFloatHistory, bool);
+  itkBooleanMacro(UseFloatHistory);
+
+  /** Set the number of work units that compute the search direction.
+   * Zero means the global default. */
+  void
+  SetNumberOfWorkUnits(ThreadIdType numberOfWorkUnits)
+  {
+    this->m_History->SetNumberOfWorkUnits(numberOfWorkUnits);
+  }
+
 protected:
   QuasiNewtonLBFGSOptimizer();
   ~QuasiNewtonLBFGSOptimizer() override = default;
@@ -150,9 +168,9 @@ protected:
   /** Is true when the LineSearchOptimizer has been started. */
   bool m_InLineSearch{ false };
 
-  RhoType m_Rho;
-  SType   m_S;
-  YType   m_Y;
+  /** The history of steps s and gradient differences y, and 1/(ys). */
+  LBFGSHistory::Pointer m_History{ LBFGSHistory::New() };
+  RhoType               m_Rho;
 
   unsigned int m_Point{ 0 };
   unsigned int m_PreviousPoint{ 0 };
@@ -183,7 +201,7 @@ protected:
   virtual void
   LineSearch(const ParametersType searchDir, double & step, ParametersType & x, MeasureType & f, DerivativeType & g);
 
-  /** Store s = x_k - x_k-1 and y = g_k - g_k-1 in m_S and m_Y,
+  /** Store s = x_k - x_k-1 and y = g_k - g_k-1 in m_History,
    * and store 1/(ys) in m_Rho. */
   virtual void
   StoreCurrentPoint(const ParametersType & step, const DerivativeType & grad_dif);
@@ -204,6 +222,7 @@ private:
   double                     m_GradientMagnitudeTolerance{ 1e-5 };
   LineSearchOptimizerPointer m_LineSearchOptimizer{ nullptr };
   unsigned int               m_Memory{ 5 };
+  bool                       m_UseFloatHistory{ false };
 };
 
 } // end namespace itk
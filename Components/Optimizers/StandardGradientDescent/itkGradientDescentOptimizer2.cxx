@@ -20,12 +20,9 @@
 
 #include "itkCommand.h"
 #include "itkEventObject.h"
+#include "itkHardwareCounters.h"
 #include "itkMacro.h"
 
-#ifdef ELASTIX_USE_OPENMP
-#  include <omp.h>
-#endif
-
 
 namespace itk
 {
@@ -35,11 +32,6 @@ namespace itk
  */
 
 GradientDescentOptimizer2 ::GradientDescentOptimizer2()
-  : m_UseOpenMP{
-#ifdef ELASTIX_USE_OPENMP
-    true
-#endif
-  }
 {
   itkDebugMacro("Constructor");
 
@@ -117,22 +109,7 @@ GradientDescentOptimizer2 ::ResumeOptimization(void)
       break;
     }
 
-    try
-    {
-      this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), m_Value, m_Gradient);
-    }
-    catch (ExceptionObject & err)
-    {
-      this->MetricErrorResponse(err);
-    }
-
-    /** StopOptimization may have been called. */
-    if (this->m_Stop)
-    {
-      break;
-    }
-
-    this->AdvanceOneStep();
+    this->ComputeValueAndAdvanceOneStep();
 
     /** StopOptimization may have been called. */
     if (this->m_Stop)
@@ -147,6 +124,33 @@ GradientDescentOptimizer2 ::ResumeOptimization(void)
 } // end ResumeOptimization()
 
 
+/**
+ * ***************** ComputeValueAndAdvanceOneStep ************************
+ */
+
+void
+GradientDescentOptimizer2 ::ComputeValueAndAdvanceOneStep(void)
+{
+  try
+  {
+    this->GetScaledValueAndDerivative(this->GetScaledCurrentPosition(), m_Value, m_Gradient);
+  }
+  catch (ExceptionObject & err)
+  {
+    this->MetricErrorResponse(err);
+  }
+
+  /** StopOptimization may have been called. */
+  if (this->m_Stop)
+  {
+    return;
+  }
+
+  this->AdvanceOneStep();
+
+} // end ComputeValueAndAdvanceOneStep()
+
+
 /**
  * ***************** MetricErrorResponse ************************
  */
@@ -187,36 +191,11 @@ GradientDescentOptimizer2 ::AdvanceOneStep(void)
 {
   itkDebugMacro("AdvanceOneStep");
 
-  /** Get space dimension. */
-  const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
-
-  /** Get a reference to the previously allocated newPosition. */
-  ParametersType & newPosition = this->m_ScaledCurrentPosition;
-
-  /** Advance one step. */
-#if 1 // force single-threaded since it is fastest most of the times
-      //#ifndef ELASTIX_USE_OPENMP // If no OpenMP detected then use single-threaded code
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  for (unsigned int j = 0; j < spaceDimension; ++j)
-  {
-    newPosition[j] = currentPosition[j] - this->m_LearningRate * this->m_Gradient[j];
-  }
-#else // Otherwise use OpenMP
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-  /** Update the new position. */
-  const int nthreads = static_cast<int>(this->m_Threader->GetNumberOfWorkUnits());
-  omp_set_num_threads(nthreads);
-#  pragma omp parallel for
-  for (int j = 0; j < static_cast<int>(spaceDimension); ++j)
+  /** Advance one step: x_{k+1} = x_k - a * g_k, in place. */
   {
-    newPosition[j] = currentPosition[j] - this->m_LearningRate * this->m_Gradient[j];
+    const HardwareCounters::ScopedPhase phase("OptimizerStep");
+    this->m_ParameterUpdateKernel->Update(this->m_LearningRate, this->m_Gradient, this->m_ScaledCurrentPosition);
   }
-#endif
 
   this->InvokeEvent(IterationEvent());
 
@@ -19,6 +19,7 @@
 #define itkGradientDescentOptimizer2_h
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkParameterUpdateKernel.h"
 
 
 namespace itk
@@ -76,13 +77,14 @@ public:
   typedef Superclass::ScaledCostFunctionPointer ScaledCostFunctionPointer;
 
   /** Codes of stopping conditions
-   * The MinimumStepSize stopcondition never occurs, but may
-   * be implemented in inheriting classes */
+   * The MinimumStepSize and ConvergenceDetected stopconditions never occur,
+   * but may be implemented in inheriting classes */
   typedef enum
   {
     MaximumNumberOfIterations,
     MetricError,
-    MinimumStepSize
+    MinimumStepSize,
+    ConvergenceDetected
   } StopConditionType;
 
   /** Advance one step following the gradient direction. */
@@ -134,8 +136,12 @@ public:
   /** Get current search direction */
   itkGetConstReferenceMacro(SearchDirection, DerivativeType);
 
-  /** Set use OpenMP or not. */
-  itkSetMacro(UseOpenMP, bool);
+  /** Set the number of threads of the parameter update. */
+  void
+  SetNumberOfWorkUnits(ThreadIdType numberOfThreads)
+  {
+    this->m_ParameterUpdateKernel->SetNumberOfWorkUnits(numberOfThreads);
+  }
 
 protected:
   GradientDescentOptimizer2();
@@ -143,23 +149,29 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
+  /** Perform one iteration of ResumeOptimization(): compute the value and
+   * derivative at the current position, and call AdvanceOneStep(). */
+  virtual void
+  ComputeValueAndAdvanceOneStep(void);
+
   // made protected so subclass can access
+  double            m_Value{ 0.0 };
   DerivativeType    m_Gradient;
   DerivativeType    m_SearchDirection;
   StopConditionType m_StopCondition{ MaximumNumberOfIterations };
 
+  /** The kernel that performs the update of the position. */
+  ParameterUpdateKernel::Pointer m_ParameterUpdateKernel{ ParameterUpdateKernel::New() };
+
 private:
   GradientDescentOptimizer2(const Self &) = delete;
   void
   operator=(const Self &) = delete;
 
-  double        m_Value{ 0.0 };
   double        m_LearningRate{ 1.0 };
   bool          m_Stop{ false };
   unsigned long m_NumberOfIterations{ 100 };
   unsigned long m_CurrentIteration{ 0 };
-
-  bool m_UseOpenMP;
 };
 
 } // end namespace itk
@@ -87,6 +87,22 @@ namespace elastix
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter ShareImageSampler: Whether all metrics that use the first fixed image pyramid
+ *    use the first image sampler, even if more samplers are given. The metrics then share
+ *    one sample set, which is generated only once per iteration. \n
+ *    example: <tt>(ShareImageSampler "true")</tt> \n
+ *    The default is "false".
+ * \parameter ShareTransformEvaluations: Whether the metrics that share the first image sampler
+ *    (see ShareImageSampler) also share the mapped points and transform Jacobians of the
+ *    samples, so that the transform is evaluated only once per sample and iteration. This
+ *    costs memory: one Jacobian per sample. \n
+ *    example: <tt>(ShareTransformEvaluations "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseConcurrentMetricEvaluation: Whether the metrics are evaluated concurrently,
+ *    each in its own thread, instead of one after the other, in each resolution. This only
+ *    takes effect when all metrics support it; the others are always evaluated sequentially. \n
+ *    example: <tt>(UseConcurrentMetricEvaluation "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Registrations
  */
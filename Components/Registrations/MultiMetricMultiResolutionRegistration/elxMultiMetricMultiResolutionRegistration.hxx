@@ -192,6 +192,12 @@ MultiMetricMultiResolutionRegistration<TElastix>::BeforeEachResolution(void)
   this->GetConfiguration()->ReadParameter(useRelativeWeights, "UseRelativeWeights", 0);
   this->GetCombinationMetric()->SetUseRelativeWeights(useRelativeWeights);
 
+  /** Set whether the metrics are evaluated concurrently. */
+  bool useConcurrentMetricEvaluation = false;
+  this->GetConfiguration()->ReadParameter(
+    useConcurrentMetricEvaluation, "UseConcurrentMetricEvaluation", "", level, 0, false);
+  this->GetCombinationMetric()->SetUseConcurrentMetricEvaluation(useConcurrentMetricEvaluation);
+
   /** Set the metric weights. The default metric weight is 1.0 / nrOfMetrics. */
   if (!useRelativeWeights)
   {
@@ -305,13 +311,18 @@ MultiMetricMultiResolutionRegistration<TElastix>::SetComponents(void)
 
   this->SetTransform(this->GetElastix()->GetElxTransformBase()->GetAsITKBaseType());
 
+  /** Let the metrics on the first fixed image pyramid share the first sampler or not. */
+  bool shareImageSampler = false;
+  this->GetConfiguration()->ReadParameter(shareImageSampler, "ShareImageSampler", 0, false);
+
   /** Samplers are not always needed: */
   for (unsigned int i = 0; i < nrOfMetrics; ++i)
   {
     if (this->GetElastix()->GetElxMetricBase(i)->GetAdvancedMetricUseImageSampler())
     {
-      /** Try the i-th sampler for the i-th metric. */
-      if (this->GetElastix()->GetElxImageSamplerBase(i))
+      /** Try the i-th sampler for the i-th metric, unless it is shared. */
+      const bool useSharedSampler = shareImageSampler && this->GetElastix()->GetElxFixedImagePyramidBase(i) == nullptr;
+      if (this->GetElastix()->GetElxImageSamplerBase(i) && !useSharedSampler)
       {
         this->GetElastix()->GetElxMetricBase(i)->SetAdvancedMetricImageSampler(
           this->GetElastix()->GetElxImageSamplerBase(i)->GetAsITKBaseType());
@@ -345,6 +356,40 @@ MultiMetricMultiResolutionRegistration<TElastix>::SetComponents(void)
     } // if sampler required by metric
   }   // for loop over metrics
 
+  /** Let the metrics that share the first sampler also share their transform evaluations. */
+  bool shareTransformEvaluations = false;
+  this->GetConfiguration()->ReadParameter(shareTransformEvaluations, "ShareTransformEvaluations", 0, false);
+  if (shareTransformEvaluations && shareImageSampler && this->GetElastix()->GetElxImageSamplerBase(0))
+  {
+    typedef typename CombinationMetricType::ImageMetricType        ImageMetricType;
+    typedef typename ImageMetricType::TransformEvaluationCacheType TransformEvaluationCacheType;
+
+    const auto * sharedSampler = this->GetElastix()->GetElxImageSamplerBase(0)->GetAsITKBaseType();
+    auto         cache = TransformEvaluationCacheType::New();
+    for (unsigned int i = 0; i < nrOfMetrics; ++i)
+    {
+      ImageMetricType * metric =
+        dynamic_cast<ImageMetricType *>(this->GetElastix()->GetElxMetricBase(i)->GetAsITKBaseType());
+      if (metric && metric->GetUseImageSampler() && metric->GetImageSampler() == sharedSampler)
+      {
+        metric->SetTransformEvaluationCache(cache);
+      }
+    }
+  }
+
+  /** Let all metrics share the image extrema, which are the same for metrics on the same images. */
+  typedef typename CombinationMetricType::ImageMetricType ImageMetricType;
+  const auto imageExtremaCache = ImageMetricType::ImageExtremaCacheType::New();
+  for (unsigned int i = 0; i < nrOfMetrics; ++i)
+  {
+    ImageMetricType * metric =
+      dynamic_cast<ImageMetricType *>(this->GetElastix()->GetElxMetricBase(i)->GetAsITKBaseType());
+    if (metric)
+    {
+      metric->SetImageExtremaCache(imageExtremaCache);
+    }
+  }
+
 } // end SetComponents()
 
 
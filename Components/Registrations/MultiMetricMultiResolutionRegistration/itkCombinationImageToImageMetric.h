@@ -18,7 +18,9 @@
 #ifndef itkCombinationImageToImageMetric_h
 #define itkCombinationImageToImageMetric_h
 
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkReducedDimensionBSplineInterpolateImageFunction.h"
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
 namespace itk
@@ -50,6 +52,12 @@ namespace itk
  * why we chose to reimplement the Get{Transform,Interpolator}()
  * methods.
  *
+ * When several sub metrics interpolate identical moving images with B-spline
+ * interpolators of the same type and order, e.g. when they share a moving image,
+ * or use the same level of two moving image pyramids of the same image, the
+ * B-spline coefficients are only computed by the first interpolator. The others
+ * share its coefficients, see ShareInterpolatorCoefficients().
+ *
  *
  * \ingroup RegistrationMetrics
  *
@@ -202,6 +210,16 @@ public:
   itkSetMacro(UseRelativeWeights, bool);
   itkGetMacro(UseRelativeWeights, bool);
 
+  /** Set/Get whether GetValueAndDerivative() evaluates the sub metrics concurrently,
+   * each in its own thread, instead of one after the other. A cheap penalty term then
+   * no longer waits for an expensive image metric. This is only done when all sub metrics
+   * report GetConcurrentEvaluationSupported(); otherwise they are evaluated sequentially.
+   * Default: false.
+   */
+  itkSetMacro(UseConcurrentMetricEvaluation, bool);
+  itkGetConstMacro(UseConcurrentMetricEvaluation, bool);
+  itkBooleanMacro(UseConcurrentMetricEvaluation);
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -451,11 +469,13 @@ protected:
   std::vector<double>                          m_MetricWeights;
   std::vector<double>                          m_MetricRelativeWeights;
   bool                                         m_UseRelativeWeights;
+  bool                                         m_UseConcurrentMetricEvaluation;
   std::vector<bool>                            m_UseMetric;
   mutable std::vector<MeasureType>             m_MetricValues;
   mutable std::vector<DerivativeType>          m_MetricDerivatives;
   mutable std::vector<double>                  m_MetricDerivativesMagnitude;
   mutable std::vector<double>                  m_MetricComputationTime;
+  mutable std::vector<double>                  m_FinalMetricWeights;
 
   /** Dummy image region and derivatives. */
   FixedImageRegionType m_NullFixedImageRegion;
@@ -478,6 +498,51 @@ private:
    */
   double
   GetFinalMetricWeight(unsigned int pos) const;
+
+  /** Offers the interpolator of sub metric pos the B-spline coefficients of an interpolator
+   * that has already been initialized for an identical moving image: the interpolator of a
+   * sub metric before pos, or its own, so that the Initialize() of sub metric pos does not
+   * compute them again.
+   */
+  void
+  ShareInterpolatorCoefficients(unsigned int pos);
+
+  /** Offers the coefficients of the source to the target interpolator, when both are of
+   * type TBSplineInterpolator, with the same spline order, and the input image of the source
+   * is identical to the moving image. Returns true when the coefficients are offered.
+   */
+  template <class TBSplineInterpolator>
+  static bool
+  OfferInterpolatorCoefficients(const InterpolatorType * source,
+                                InterpolatorType *       target,
+                                const MovingImageType *  movingImage);
+
+  /** Check whether all sub metrics can be evaluated concurrently. */
+  bool
+  CanEvaluateMetricsConcurrently(void) const;
+
+  /** Compute the value and derivative of sub metric pos, and store them
+   * together with the derivative magnitude and the computation time.
+   */
+  void
+  ComputeMetricValueAndDerivative(const ParametersType & parameters, unsigned int pos) const;
+
+  /** Combine the sub metric derivatives with m_FinalMetricWeights, for the
+   * parameter range [ begin, end [.
+   */
+  void
+  CombineMetricDerivatives(DerivativeType & derivative, unsigned int begin, unsigned int end) const;
+
+  /** The threader callback that combines a part of the sub metric derivatives. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  CombineMetricDerivativesThreaderCallback(void * arg);
+
+  /** The user data of CombineMetricDerivativesThreaderCallback(). */
+  struct CombineMetricDerivativesThreaderParameterType
+  {
+    const Self *     st_Metric;
+    DerivativeType * st_Derivative;
+  };
 };
 
 } // end namespace itk
@@ -19,9 +19,14 @@
 #define _itkCombinationImageToImageMetric_hxx
 
 #include "itkCombinationImageToImageMetric.h"
+#include "itkParallelTasks.h"
+#include "itkThreadBudget.h"
 #include "itkTimeProbe.h"
 #include "itkMath.h"
 
+#include <exception>
+#include <thread>
+
 /** Macros to reduce some copy-paste work.
  * These macros provide the implementation of
  * all Set/GetFixedImage, Set/GetInterpolator etc methods
@@ -146,6 +151,7 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::CombinationImageToImag
 {
   this->m_NumberOfMetrics = 0;
   this->m_UseRelativeWeights = false;
+  this->m_UseConcurrentMetricEvaluation = false;
   this->ComputeGradientOff();
 
 } // end Constructor
@@ -164,6 +170,7 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::PrintSelf(std::ostream
 
   /** Add debugging information. */
   os << "NumberOfMetrics: " << this->m_NumberOfMetrics << std::endl;
+  os << "UseConcurrentMetricEvaluation: " << this->m_UseConcurrentMetricEvaluation << std::endl;
   for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
   {
     os << "Metric " << i << ":\n";
@@ -590,6 +597,8 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
     PointSetMetricType * testPtr2 = dynamic_cast<PointSetMetricType *>(this->GetMetric(i));
     if (testPtr1)
     {
+      this->ShareInterpolatorCoefficients(i);
+
       // The NumberOfThreadsPerMetric is changed after Initialize() so we save it before and then
       // set it on.
       unsigned nrOfThreadsPerMetric = this->GetNumberOfWorkUnits();
@@ -605,6 +614,77 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::Initialize(void)
 } // end Initialize()
 
 
+/**
+ * ******************* ShareInterpolatorCoefficients *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::ShareInterpolatorCoefficients(unsigned int pos)
+{
+  typedef AdvancedBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, double>
+    BSplineInterpolatorType;
+  typedef AdvancedBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, float>
+    BSplineInterpolatorFloatType;
+  typedef ReducedDimensionBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, double>
+    ReducedDimensionBSplineInterpolatorType;
+  typedef ReducedDimensionBSplineInterpolateImageFunction<MovingImageType, CoordinateRepresentationType, float>
+    ReducedDimensionBSplineInterpolatorFloatType;
+
+  ImageMetricType * metric = dynamic_cast<ImageMetricType *>(this->GetMetric(pos));
+  if (metric == nullptr || metric->GetModifiableInterpolator() == nullptr)
+  {
+    return;
+  }
+  InterpolatorType *      target = metric->GetModifiableInterpolator();
+  const MovingImageType * movingImage = metric->GetMovingImage();
+
+  /** The sub metrics before pos have been initialized already, and the interpolator of the
+   * first sub metric by the Initialize() of the superclass as well.
+   */
+  for (unsigned int i = 0; i <= pos; ++i)
+  {
+    const InterpolatorType * source = this->GetInterpolator(i);
+    if (source != nullptr &&
+        (OfferInterpolatorCoefficients<BSplineInterpolatorType>(source, target, movingImage) ||
+         OfferInterpolatorCoefficients<BSplineInterpolatorFloatType>(source, target, movingImage) ||
+         OfferInterpolatorCoefficients<ReducedDimensionBSplineInterpolatorType>(source, target, movingImage) ||
+         OfferInterpolatorCoefficients<ReducedDimensionBSplineInterpolatorFloatType>(source, target, movingImage)))
+    {
+      return;
+    }
+  }
+
+} // end ShareInterpolatorCoefficients()
+
+
+/**
+ * ******************* OfferInterpolatorCoefficients *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+template <class TBSplineInterpolator>
+bool
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::OfferInterpolatorCoefficients(
+  const InterpolatorType * source,
+  InterpolatorType *       target,
+  const MovingImageType *  movingImage)
+{
+  const auto * const bsplineSource = dynamic_cast<const TBSplineInterpolator *>(source);
+  auto * const       bsplineTarget = dynamic_cast<TBSplineInterpolator *>(target);
+  if (bsplineSource == nullptr || bsplineTarget == nullptr ||
+      bsplineSource->GetSplineOrder() != bsplineTarget->GetSplineOrder() ||
+      !ImagesAreIdentical(bsplineSource->GetInputImage(), movingImage))
+  {
+    return false;
+  }
+
+  bsplineTarget->SetCachedCoefficients(bsplineSource);
+  return true;
+
+} // end OfferInterpolatorCoefficients()
+
+
 /**
  * ******************* InitializeThreadingParameters *******************
  */
@@ -770,6 +850,159 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetDerivative(const Pa
 } // end GetDerivative()
 
 
+/**
+ * ********************* CanEvaluateMetricsConcurrently ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+bool
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::CanEvaluateMetricsConcurrently(void) const
+{
+  if (!this->m_UseConcurrentMetricEvaluation || this->m_NumberOfMetrics < 2)
+  {
+    return false;
+  }
+
+  /** Every sub metric must leave the shared transform and sampler alone
+   * after BeforeThreadedGetValueAndDerivative() has been called.
+   */
+  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  {
+    const ImageMetricType *    testPtr1 = dynamic_cast<const ImageMetricType *>(this->GetMetric(i));
+    const PointSetMetricType * testPtr2 = dynamic_cast<const PointSetMetricType *>(this->GetMetric(i));
+    if (testPtr1)
+    {
+      if (!testPtr1->GetConcurrentEvaluationSupported())
+      {
+        return false;
+      }
+
+      /** The processes must add their partial sums in the same order. */
+      if (testPtr1->GetUseDistributedSampleEvaluation() && testPtr1->GetDistributedSampleEvaluationSupported())
+      {
+        return false;
+      }
+    }
+    else if (testPtr2)
+    {
+      if (!testPtr2->GetConcurrentEvaluationSupported())
+      {
+        return false;
+      }
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CanEvaluateMetricsConcurrently()
+
+
+/**
+ * ********************* ComputeMetricValueAndDerivative ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::ComputeMetricValueAndDerivative(
+  const ParametersType & parameters,
+  unsigned int           pos) const
+{
+  /** Compute ... */
+  itk::TimeProbe timer;
+  timer.Start();
+  this->m_Metrics[pos]->GetValueAndDerivative(parameters, this->m_MetricValues[pos], this->m_MetricDerivatives[pos]);
+  timer.Stop();
+
+  /** Store computation time and the derivative magnitude. */
+  this->m_MetricComputationTime[pos] = timer.GetMean() * 1000.0;
+  this->m_MetricDerivativesMagnitude[pos] = this->m_MetricDerivatives[pos].magnitude();
+
+} // end ComputeMetricValueAndDerivative()
+
+
+/**
+ * ********************* CombineMetricDerivatives ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::CombineMetricDerivatives(DerivativeType &   derivative,
+                                                                                   const unsigned int begin,
+                                                                                   const unsigned int end) const
+{
+  /** Add the weighted derivatives in the order of the metrics, so that the
+   * result does not depend on the partitioning of the parameters.
+   */
+  bool initialized = false;
+  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  {
+    if (!this->m_UseMetric[i])
+    {
+      continue;
+    }
+
+    const double                weight = this->m_FinalMetricWeights[i];
+    const DerivativeValueType * metricDerivative = this->m_MetricDerivatives[i].data_block();
+    if (!initialized)
+    {
+      for (unsigned int j = begin; j < end; ++j)
+      {
+        derivative[j] = weight * metricDerivative[j];
+      }
+      initialized = true;
+    }
+    else
+    {
+      for (unsigned int j = begin; j < end; ++j)
+      {
+        derivative[j] += weight * metricDerivative[j];
+      }
+    }
+  }
+
+  if (!initialized)
+  {
+    for (unsigned int j = begin; j < end; ++j)
+    {
+      derivative[j] = NumericTraits<DerivativeValueType>::Zero;
+    }
+  }
+
+} // end CombineMetricDerivatives()
+
+
+/**
+ * ********************* CombineMetricDerivativesThreaderCallback ****************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+CombinationImageToImageMetric<TFixedImage, TMovingImage>::CombineMetricDerivativesThreaderCallback(void * arg)
+{
+  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>(arg);
+  ThreadIdType     threadID = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  CombineMetricDerivativesThreaderParameterType * temp =
+    static_cast<CombineMetricDerivativesThreaderParameterType *>(infoStruct->UserData);
+
+  const unsigned int numPar = temp->st_Metric->GetNumberOfParameters();
+  const unsigned int subSize =
+    static_cast<unsigned int>(std::ceil(static_cast<double>(numPar) / static_cast<double>(nrOfThreads)));
+  const unsigned int jmin = std::min(threadID * subSize, numPar);
+  const unsigned int jmax = std::min((threadID + 1) * subSize, numPar);
+
+  temp->st_Metric->CombineMetricDerivatives(*temp->st_Derivative, jmin, jmax);
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end CombineMetricDerivativesThreaderCallback()
+
+
 /**
  * ********************* GetValueAndDerivative ****************************
  */
@@ -780,9 +1013,6 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
                                                                                 MeasureType &          value,
                                                                                 DerivativeType &       derivative) const
 {
-  /** Declare timer. */
-  itk::TimeProbe timer;
-
   /** This function must be called before the multi-threaded code.
    * It calls all the non thread-safe stuff.
    */
@@ -807,55 +1037,109 @@ CombinationImageToImageMetric<TFixedImage, TMovingImage>::GetValueAndDerivative(
   /** Initialize some threading related parameters. */
   this->InitializeThreadingParameters();
 
-  /** Compute all metric values and derivatives. */
-  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  /** Compute all metric values and derivatives. Within a work unit, the
+   * metrics are computed one after the other, like nested work units, as the
+   * threads of the sub metrics could otherwise wait for the busy pool.
+   */
+  if (this->CanEvaluateMetricsConcurrently() && !ParallelTasks::IsInsideWorkUnit())
   {
-    /** Compute ... */
-    timer.Reset();
-    timer.Start();
-    this->m_Metrics[i]->GetValueAndDerivative(parameters, this->m_MetricValues[i], this->m_MetricDerivatives[i]);
-    timer.Stop();
+    /** Metrics may share a sampler, so fill its structure-of-arrays copy
+     * of the samples now, while we are still single-threaded.
+     */
+    for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+    {
+      const ImageMetricType * testPtr1 = dynamic_cast<const ImageMetricType *>(this->GetMetric(i));
+      if (testPtr1 && testPtr1->GetUseImageSampler() && testPtr1->GetUseSampleArrays() &&
+          testPtr1->GetImageSampler() != nullptr)
+      {
+        testPtr1->GetImageSampler()->GetOutputArrays();
+      }
+    }
 
-    /** Store computation time. */
-    this->m_MetricComputationTime[i] = timer.GetMean() * 1000.0;
+    /** Metric 0 is computed by the calling thread, the others each by their own
+     * thread, within the thread budget of the calling thread, so that the work
+     * units of the sub metrics keep to the budget of the registration. These
+     * are not work units themselves: the sub metrics then run their own work
+     * units on the pool. Exceptions are passed on to the calling thread, after
+     * all threads have finished.
+     */
+    const ThreadIdType              numberOfThreads = ThreadBudget::GetNumberOfThreads();
+    std::vector<std::exception_ptr> exceptions(this->m_NumberOfMetrics);
+    std::vector<std::thread>        threads;
+    threads.reserve(this->m_NumberOfMetrics - 1);
+    for (unsigned int i = 1; i < this->m_NumberOfMetrics; ++i)
+    {
+      threads.emplace_back([this, &parameters, &exceptions, numberOfThreads, i] {
+        const ThreadBudget threadBudget(numberOfThreads);
+        try
+        {
+          this->ComputeMetricValueAndDerivative(parameters, i);
+        }
+        catch (...)
+        {
+          exceptions[i] = std::current_exception();
+        }
+      });
+    }
+    try
+    {
+      this->ComputeMetricValueAndDerivative(parameters, 0);
+    }
+    catch (...)
+    {
+      exceptions[0] = std::current_exception();
+    }
+    for (auto & thread : threads)
+    {
+      thread.join();
+    }
+    for (const auto & exception : exceptions)
+    {
+      if (exception)
+      {
+        std::rethrow_exception(exception);
+      }
+    }
   }
-
-  /** Compute the derivative magnitude. */
-  for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+  else
   {
-    this->m_MetricDerivativesMagnitude[i] = this->m_MetricDerivatives[i].magnitude();
+    for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
+    {
+      this->ComputeMetricValueAndDerivative(parameters, i);
+    }
   }
 
   /** Combine the metric values. */
   value = NumericTraits<MeasureType>::Zero;
+  this->m_FinalMetricWeights.assign(this->m_NumberOfMetrics, 0.0);
   for (unsigned int i = 0; i < this->m_NumberOfMetrics; ++i)
   {
     if (this->m_UseMetric[i])
     {
-      const double weight = this->GetFinalMetricWeight(i);
-      value += weight * this->m_MetricValues[i];
+      this->m_FinalMetricWeights[i] = this->GetFinalMetricWeight(i);
+      value += this->m_FinalMetricWeights[i] * this->m_MetricValues[i];
     }
   }
 
-  /** Combine the metric derivatives. First, the first derivative. */
-  if (this->m_UseMetric[0])
+  /** Combine the metric derivatives. Only large derivatives are worth splitting over the threads. */
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  if (derivative.GetSize() != numberOfParameters)
   {
-    const double weight = this->GetFinalMetricWeight(0);
-    derivative = weight * this->m_MetricDerivatives[0];
+    derivative.SetSize(numberOfParameters);
   }
-  else
+
+  constexpr unsigned int minimumNumberOfParametersPerThread = 16384;
+  if (this->m_UseMultiThread && this->GetNumberOfWorkUnits() > 1 &&
+      numberOfParameters >= 2 * minimumNumberOfParametersPerThread)
   {
-    derivative.Fill(0);
+    CombineMetricDerivativesThreaderParameterType userData;
+    userData.st_Metric = this;
+    userData.st_Derivative = &derivative;
+    this->LaunchThreaderCallback(this->CombineMetricDerivativesThreaderCallback, &userData);
   }
-
-  /** Then the remaining derivatives. */
-  for (unsigned int i = 1; i < this->m_NumberOfMetrics; ++i)
+  else
   {
-    if (this->m_UseMetric[i])
-    {
-      const double weight = this->GetFinalMetricWeight(i);
-      derivative += weight * this->m_MetricDerivatives[i];
-    }
+    this->CombineMetricDerivatives(derivative, 0, numberOfParameters);
   }
 
 } // end GetValueAndDerivative()
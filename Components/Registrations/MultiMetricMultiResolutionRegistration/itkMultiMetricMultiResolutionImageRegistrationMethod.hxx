@@ -377,6 +377,12 @@ MultiMetricMultiResolutionImageRegistrationMethod<TFixedImage, TMovingImage>::Ge
       break;
     }
 
+    // Skip the levels that were finished before a resume
+    if (this->PrepareLevelForResume())
+    {
+      continue;
+    }
+
     try
     {
       // initialize the interconnects between components
@@ -37,6 +37,41 @@ namespace elastix
  * \parameter NumberOfResolutions: the number of resolutions used. \n
  *    example: <tt>(NumberOfResolutions 4)</tt> \n
  *    The default is 3.
+ * \parameter CropPyramidImagesToMasks: Flag to specify if the pyramids are only computed for the
+ *    bounding box of the fixed and the moving mask, plus a margin, instead of for the whole images.
+ *    The transform, and the geometry of the result, are not affected.\n
+ *    example: <tt>(CropPyramidImagesToMasks "true")</tt> \n
+ *    The default is "false".
+ * \parameter CropPyramidImagesToMasksMargin: the margin around the bounding boxes, in voxels of the
+ *    coarsest resolution. It should cover the support of the smoothing, of the interpolator and of
+ *    the (dilated) masks.\n
+ *    example: <tt>(CropPyramidImagesToMasksMargin 6)</tt> \n
+ *    The default is 4.
+ * \parameter CropMovingImageToTransform: Flag to specify if the moving image of each resolution is
+ *    cropped to the region to which the transform, at the start of the resolution, maps the fixed
+ *    image region, plus a margin. The interpolator then only prepares, e.g. decomposes into B-spline
+ *    coefficients, that region. Samples that the optimization moves beyond the margin are treated as
+ *    outside the moving image; a warning is printed after the resolution when this happened.\n
+ *    example: <tt>(CropMovingImageToTransform "true")</tt> \n
+ *    The default is "false".
+ * \parameter CropMovingImageToTransformMargin: the margin around the transformed fixed image region,
+ *    in voxels of the moving image of each resolution. It should cover the motion during the
+ *    resolution, and the support of the interpolator.\n
+ *    example: <tt>(CropMovingImageToTransformMargin 12 8 8)</tt> \n
+ *    The default is 8 for each resolution.
+ * \parameter MultiStartParameterOffsets: offsets to the initial transform parameters, of extra
+ *    starts of the optimization. The list contains the offsets of all extra starts after each other,
+ *    so its length is a multiple of the number of transform parameters. The starts are optimized
+ *    one after the other, sharing the pyramids, the samplers and the interpolator. Only meant for
+ *    transforms of which the number of parameters is known before the registration, like the
+ *    Euler or affine transform.\n
+ *    example: <tt>(MultiStartParameterOffsets 0.0 0.0 0.3 0.0 0.0 0.0  0.0 0.0 -0.3 0.0 0.0 0.0)</tt> \n
+ *    The default is no offsets: a single start.
+ * \parameter NumberOfSurvivingStarts: the number of starts, with the lowest metric values, that are
+ *    optimized further after the first resolution. The metric values of all starts are computed
+ *    on one grid of samples, after all of them are optimized. The best of them is the result.\n
+ *    example: <tt>(NumberOfSurvivingStarts 2)</tt> \n
+ *    The default is 1.
  *
  * \ingroup Registrations
  */
@@ -128,10 +163,20 @@ public:
   BeforeRegistration(void) override;
 
   /** Execute stuff before each resolution:
-   * \li Update masks with an erosion. */
+   * \li Update masks with an erosion.
+   * \li Print the metric values of the starts of a multi-start registration. */
   void
   BeforeEachResolution(void) override;
 
+  /** Execute stuff after each resolution:
+   * \li Warn when the motion exceeded the margin of CropMovingImageToTransform. */
+  void
+  AfterEachResolution(void) override;
+
+  /** Print the metric values of the starts of a multi-start registration. */
+  void
+  AfterRegistration(void) override;
+
 protected:
   /** The constructor. */
   MultiResolutionRegistration() = default;
@@ -153,10 +198,21 @@ protected:
   void
   UpdateMasks(unsigned int level);
 
+  /** Print the metric values of the starts of a multi-start registration, if any. */
+  void
+  PrintMultiStartValues(void) const;
+
   /** Read the components from m_Elastix and set them in the Registration class. */
   virtual void
   SetComponents(void);
 
+  /** Returns the region of the image that encloses the nonzero voxels of the mask,
+   * or an empty region when there are none.
+   */
+  template <class TMask, class TImage>
+  static typename TImage::RegionType
+  ComputeMaskBoundingRegion(const TMask & mask, const TImage & image);
+
 private:
   elxOverrideGetSelfMacro;
 
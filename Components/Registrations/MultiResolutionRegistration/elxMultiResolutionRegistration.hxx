@@ -21,6 +21,10 @@
 #include "elxMultiResolutionRegistration.h"
 #include "vnl/vnl_math.h"
 #include "itkTimeProbe.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace elastix
 {
@@ -77,6 +81,61 @@ MultiResolutionRegistration<TElastix>::BeforeRegistration(void)
   /** Set the fixedImageRegion. */
   this->SetFixedImageRegion(this->GetElastix()->GetFixedImage()->GetBufferedRegion());
 
+  /** Decide whether or not to compute the pyramids only for the bounding boxes of the masks. */
+  bool cropToMasks = false;
+  this->m_Configuration->ReadParameter(cropToMasks, "CropPyramidImagesToMasks", 0, false);
+  if (cropToMasks)
+  {
+    unsigned int margin = 4;
+    this->m_Configuration->ReadParameter(margin, "CropPyramidImagesToMasksMargin", 0, false);
+    this->SetPyramidInputRegionMargin(margin);
+
+    const FixedMaskImageType * fixedMask = this->GetElastix()->GetFixedMask();
+    if (fixedMask)
+    {
+      this->SetFixedImagePyramidInputRegion(
+        ComputeMaskBoundingRegion(*fixedMask, *(this->GetElastix()->GetFixedImage())));
+    }
+    const MovingMaskImageType * movingMask = this->GetElastix()->GetMovingMask();
+    if (movingMask)
+    {
+      this->SetMovingImagePyramidInputRegion(
+        ComputeMaskBoundingRegion(*movingMask, *(this->GetElastix()->GetMovingImage())));
+    }
+  }
+
+  /** Decide whether or not to crop the moving image of each resolution to the transformed fixed image region. */
+  bool cropMovingImageToTransform = false;
+  this->m_Configuration->ReadParameter(cropMovingImageToTransform, "CropMovingImageToTransform", 0, false);
+  this->SetCropMovingImageToTransform(cropMovingImageToTransform);
+
+  /** Read the offsets of the extra starts of a multi-start registration. */
+  const unsigned int numberOfParameters =
+    this->GetElastix()->GetElxTransformBase()->GetAsITKBaseType()->GetNumberOfParameters();
+  const std::size_t count = this->m_Configuration->CountNumberOfParameterEntries("MultiStartParameterOffsets");
+  if (count > 0)
+  {
+    if (numberOfParameters == 0 || count % numberOfParameters != 0)
+    {
+      itkExceptionMacro(<< "ERROR: the number of entries of MultiStartParameterOffsets (" << count
+                        << ") should be a multiple of the number of transform parameters (" << numberOfParameters
+                        << ").");
+    }
+    typename Superclass1::ParametersContainerType offsets(count / numberOfParameters,
+                                                          ParametersType(numberOfParameters));
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      double offset = 0.0;
+      this->m_Configuration->ReadParameter(offset, "MultiStartParameterOffsets", i);
+      offsets[i / numberOfParameters][i % numberOfParameters] = offset;
+    }
+    this->SetMultiStartParameterOffsets(offsets);
+
+    unsigned int numberOfSurvivingStarts = 1;
+    this->m_Configuration->ReadParameter(numberOfSurvivingStarts, "NumberOfSurvivingStarts", 0);
+    this->SetNumberOfSurvivingStarts(numberOfSurvivingStarts);
+  }
+
 } // end BeforeRegistration()
 
 
@@ -96,9 +155,81 @@ MultiResolutionRegistration<TElastix>::BeforeEachResolution(void)
    */
   this->UpdateMasks(level);
 
+  /** Set the margin of the cropped moving image of this resolution. */
+  if (this->GetCropMovingImageToTransform())
+  {
+    unsigned int margin = 8;
+    this->m_Configuration->ReadParameter(
+      margin, "CropMovingImageToTransformMargin", this->GetComponentLabel(), level, 0, false);
+    this->SetMovingImageRegionMargin(margin);
+  }
+
+  /** The starts of a multi-start registration were pruned after the first resolution. */
+  if (level > 0 && !this->GetMultiStartValues().empty())
+  {
+    this->PrintMultiStartValues();
+    elxout << "Continuing with the best " << this->GetNumberOfStarts() << " of them." << std::endl;
+  }
+
 } // end BeforeEachResolution()
 
 
+/**
+ * ******************* AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+MultiResolutionRegistration<TElastix>::AfterEachResolution(void)
+{
+  /** Warn when the optimization moved the fixed image region beyond the cropped moving image. */
+  if (!this->IsTransformedFixedRegionInsideMovingImageRegion())
+  {
+    xl::xout["warning"] << "WARNING: In resolution " << this->GetCurrentLevel()
+                        << ", the transform maps a part of the fixed image region outside the cropped moving image.\n"
+                        << "  Consider a larger CropMovingImageToTransformMargin." << std::endl;
+  }
+
+} // end AfterEachResolution()
+
+
+/**
+ * ******************* AfterRegistration ***********************
+ */
+
+template <class TElastix>
+void
+MultiResolutionRegistration<TElastix>::AfterRegistration(void)
+{
+  this->PrintMultiStartValues();
+
+} // end AfterRegistration()
+
+
+/**
+ * ******************* PrintMultiStartValues ***********************
+ */
+
+template <class TElastix>
+void
+MultiResolutionRegistration<TElastix>::PrintMultiStartValues(void) const
+{
+  const auto & values = this->GetMultiStartValues();
+  if (values.empty())
+  {
+    return;
+  }
+
+  elxout << "Final metric values of the " << values.size() << " starts:";
+  for (const auto value : values)
+  {
+    elxout << " " << value;
+  }
+  elxout << std::endl;
+
+} // end PrintMultiStartValues()
+
+
 /**
  * *********************** SetComponents ************************
  */
@@ -216,6 +347,82 @@ MultiResolutionRegistration<TElastix>::UpdateMasks(unsigned int level)
 } // end UpdateMasks()
 
 
+/**
+ * *********************** ComputeMaskBoundingRegion ************************
+ */
+
+template <class TElastix>
+template <class TMask, class TImage>
+typename TImage::RegionType
+MultiResolutionRegistration<TElastix>::ComputeMaskBoundingRegion(const TMask & mask, const TImage & image)
+{
+  typedef typename TImage::RegionType                          RegionType;
+  typedef typename TMask::IndexType                            MaskIndexType;
+  typedef itk::ContinuousIndex<double, TMask::ImageDimension>  MaskContinuousIndexType;
+  typedef itk::ContinuousIndex<double, TImage::ImageDimension> ContinuousIndexType;
+
+  /** The bounding box of the nonzero voxels, in the index space of the mask. */
+  MaskIndexType minIndex;
+  MaskIndexType maxIndex;
+  bool          found = false;
+  for (itk::ImageRegionConstIteratorWithIndex<TMask> it(&mask, mask.GetBufferedRegion()); !it.IsAtEnd(); ++it)
+  {
+    if (it.Get() == 0)
+    {
+      continue;
+    }
+    const MaskIndexType & index = it.GetIndex();
+    for (unsigned int dim = 0; dim < TMask::ImageDimension; ++dim)
+    {
+      minIndex[dim] = found ? std::min(minIndex[dim], index[dim]) : index[dim];
+      maxIndex[dim] = found ? std::max(maxIndex[dim], index[dim]) : index[dim];
+    }
+    found = true;
+  }
+  if (!found)
+  {
+    return RegionType();
+  }
+
+  /** Map the corners of the bounding box to the index space of the image. */
+  ContinuousIndexType minImageIndex;
+  ContinuousIndexType maxImageIndex;
+  for (unsigned int corner = 0; corner < (1u << TMask::ImageDimension); ++corner)
+  {
+    MaskContinuousIndexType maskIndex;
+    for (unsigned int dim = 0; dim < TMask::ImageDimension; ++dim)
+    {
+      maskIndex[dim] = ((corner >> dim) & 1) ? maxIndex[dim] + 0.5 : minIndex[dim] - 0.5;
+    }
+    typename TMask::PointType point;
+    mask.TransformContinuousIndexToPhysicalPoint(maskIndex, point);
+    ContinuousIndexType imageIndex;
+    image.TransformPhysicalPointToContinuousIndex(point, imageIndex);
+    for (unsigned int dim = 0; dim < TImage::ImageDimension; ++dim)
+    {
+      minImageIndex[dim] = corner == 0 ? imageIndex[dim] : std::min(minImageIndex[dim], imageIndex[dim]);
+      maxImageIndex[dim] = corner == 0 ? imageIndex[dim] : std::max(maxImageIndex[dim], imageIndex[dim]);
+    }
+  }
+
+  typename RegionType::IndexType start;
+  typename RegionType::SizeType  size;
+  for (unsigned int dim = 0; dim < TImage::ImageDimension; ++dim)
+  {
+    start[dim] = static_cast<itk::IndexValueType>(std::floor(minImageIndex[dim]));
+    size[dim] = static_cast<itk::SizeValueType>(std::ceil(maxImageIndex[dim]) - start[dim] + 1);
+  }
+
+  RegionType region(start, size);
+  if (!region.Crop(image.GetLargestPossibleRegion()))
+  {
+    return RegionType();
+  }
+  return region;
+
+} // end ComputeMaskBoundingRegion()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxMultiResolutionRegistration_hxx
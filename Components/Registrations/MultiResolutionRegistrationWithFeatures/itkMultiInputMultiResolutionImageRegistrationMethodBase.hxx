@@ -472,6 +472,12 @@ MultiInputMultiResolutionImageRegistrationMethodBase<TFixedImage, TMovingImage>:
       break;
     }
 
+    // Skip the levels that were finished before a resume
+    if (this->PrepareLevelForResume())
+    {
+      continue;
+    }
+
     try
     {
       // initialize the interconnects between components
@@ -19,7 +19,7 @@
 #define elxBSplineResampleInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -52,18 +52,18 @@ namespace elastix
 
 template <class TElastix>
 class ITK_TEMPLATE_EXPORT BSplineResampleInterpolator
-  : public itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                                typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                                double>
+  : public itk::AdvancedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                                        typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                                        double>
   , // CoefficientType
     public ResampleInterpolatorBase<TElastix>
 {
 public:
   /** Standard ITK-stuff. */
   typedef BSplineResampleInterpolator Self;
-  typedef itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                               typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                               double>
+  typedef itk::AdvancedBSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
+                                                       typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+                                                       double>
                                              Superclass1;
   typedef ResampleInterpolatorBase<TElastix> Superclass2;
   typedef itk::SmartPointer<Self>            Pointer;
@@ -73,7 +73,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(BSplineResampleInterpolator, itk::BSplineInterpolateImageFunction);
+  itkTypeMacro(BSplineResampleInterpolator, itk::AdvancedBSplineInterpolateImageFunction);
 
   /** Name of this class.
    * Use this name in the parameter file to select this specific resample interpolator. \n
@@ -115,6 +115,13 @@ public:
   void
   BeforeRegistration(void) override;
 
+  /** Execute stuff after each resolution:
+   * \li Offer the coefficients of the B-spline interpolator of the registration,
+   *   which are reused when the final resampling is done on the same image.
+   */
+  void
+  AfterEachResolution(void) override;
+
   /** Function to read transform-parameters from a file. */
   void
   ReadFromFile(void) override;
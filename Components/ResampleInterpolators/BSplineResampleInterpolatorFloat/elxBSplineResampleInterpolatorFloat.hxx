@@ -46,6 +46,30 @@ BSplineResampleInterpolatorFloat<TElastix>::BeforeRegistration(void)
 } // end BeforeRegistration()
 
 
+/**
+ * ******************* AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+BSplineResampleInterpolatorFloat<TElastix>::AfterEachResolution(void)
+{
+  /** The B-spline interpolator of the registration has just computed the
+   * coefficients of the moving image of this resolution. When the final
+   * resampling is done on the same image, with the same spline order,
+   * these coefficients are reused, instead of computing them again.
+   */
+  const Superclass1 * interpolator =
+    dynamic_cast<const Superclass1 *>(this->GetElastix()->GetElxInterpolatorBase()->GetAsITKBaseType());
+  if (interpolator != nullptr)
+  {
+    this->SetCachedCoefficients(
+      interpolator->GetInputImage(), interpolator->GetCoefficients(), interpolator->GetSplineOrder());
+  }
+
+} // end AfterEachResolution()
+
+
 /*
  * ******************* ReadFromFile  ****************************
  */
@@ -35,6 +35,10 @@ namespace elastix
  *    the deformed moving image; possible values: (0-5) \n
  *    example: <tt>(FinalReducedDimensionBSplineInterpolationOrder 3) </tt> \n
  *    Default: 3.
+ * \parameter ComputeCoefficientsPerFrame: whether the coefficients of a frame, i.e. a slice along the last
+ *    dimension, are only computed when the frame is first needed, instead of those of the whole image at once. \n
+ *    example: <tt>(ComputeCoefficientsPerFrame "true")</tt> \n
+ *    The default is "false".
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
  * \transformparameter FinalReducedDimensionBSplineInterpolationOrder: the order of the B-spline used to resample
@@ -42,9 +46,9 @@ namespace elastix
  *    example: <tt>(FinalReducedDimensionBSplineInterpolationOrder 3) </tt> \n
  *    Default: 3.
  *
- * If you are in memory problems, you may use the LinearResampleInterpolator,
- * or the NearestNeighborResampleInterpolator. Note that the former will also
- * interpolate in the last dimension.
+ * If you are in memory problems, you may use the ReducedDimensionBSplineResampleInterpolatorFloat,
+ * the LinearResampleInterpolator, or the NearestNeighborResampleInterpolator. Note that the
+ * LinearResampleInterpolator will also interpolate in the last dimension.
  *
  * \ingroup ResampleInterpolators
  * \sa ReducedDimensionBSplineResampleInterpolatorFloat
@@ -62,9 +66,10 @@ class ITK_TEMPLATE_EXPORT ReducedDimensionBSplineResampleInterpolator
 public:
   /** Standard ITK-stuff. */
   typedef ReducedDimensionBSplineResampleInterpolator Self;
-  typedef itk::BSplineInterpolateImageFunction<typename ResampleInterpolatorBase<TElastix>::InputImageType,
-                                               typename ResampleInterpolatorBase<TElastix>::CoordRepType,
-                                               double>
+  typedef itk::ReducedDimensionBSplineInterpolateImageFunction<
+    typename ResampleInterpolatorBase<TElastix>::InputImageType,
+    typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+    double>
                                              Superclass1;
   typedef ResampleInterpolatorBase<TElastix> Superclass2;
   typedef itk::SmartPointer<Self>            Pointer;
@@ -110,10 +115,18 @@ public:
 
   /** Execute stuff before the actual registration:
    * \li Set the spline order.
+   * \li Set whether the coefficients are computed per frame.
    */
   void
   BeforeRegistration(void) override;
 
+  /** Execute stuff after each resolution:
+   * \li Offer the coefficients of the reduced dimension B-spline interpolator of the
+   *   registration, which are reused when the final resampling is done on the same image.
+   */
+  void
+  AfterEachResolution(void) override;
+
   /** Function to read transform-parameters from a file. */
   void
   ReadFromFile(void) override;
@@ -49,9 +49,36 @@ ReducedDimensionBSplineResampleInterpolator<TElastix>::BeforeRegistration(void)
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder(splineOrder);
 
+  /** Read whether the coefficients should be computed per frame. */
+  bool computeCoefficientsPerFrame = false;
+  this->m_Configuration->ReadParameter(computeCoefficientsPerFrame, "ComputeCoefficientsPerFrame", 0, false);
+  this->SetComputeCoefficientsPerFrame(computeCoefficientsPerFrame);
+
 } // end BeforeRegistration()
 
 
+/**
+ * ******************* AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+ReducedDimensionBSplineResampleInterpolator<TElastix>::AfterEachResolution(void)
+{
+  /** When the final resampling is done on the moving image of this resolution,
+   * with the same spline order, the coefficients of the interpolator of the
+   * registration are reused, instead of computing them again.
+   */
+  const Superclass1 * interpolator =
+    dynamic_cast<const Superclass1 *>(this->GetElastix()->GetElxInterpolatorBase()->GetAsITKBaseType());
+  if (interpolator != nullptr)
+  {
+    this->SetCachedCoefficients(interpolator);
+  }
+
+} // end AfterEachResolution()
+
+
 /*
  * ******************* ReadFromFile  ****************************
  */
@@ -81,6 +108,11 @@ ReducedDimensionBSplineResampleInterpolator<TElastix>::ReadFromFile(void)
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder(splineOrder);
 
+  /** Read whether the coefficients should be computed per frame. */
+  bool computeCoefficientsPerFrame = false;
+  this->m_Configuration->ReadParameter(computeCoefficientsPerFrame, "ComputeCoefficientsPerFrame", 0, false);
+  this->SetComputeCoefficientsPerFrame(computeCoefficientsPerFrame);
+
 } // end ReadFromFile()
 
 
@@ -0,0 +1,160 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxReducedDimensionBSplineResampleInterpolatorFloat_h
+#define elxReducedDimensionBSplineResampleInterpolatorFloat_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkReducedDimensionBSplineInterpolateImageFunction.h"
+
+namespace elastix
+{
+
+/**
+ * \class ReducedDimensionBSplineResampleInterpolatorFloat
+ * \brief A resample-interpolator based on B-splines which ignores the last dimension.
+ *
+ * Compared to the ReducedDimensionBSplineResampleInterpolator this class uses
+ * a float CoefficientType, instead of double. You can select
+ * this resample interpolator if memory burden is an issue.
+ *
+ * The parameters used in this class are:
+ * \parameter ResampleInterpolator: Select this resample interpolator as follows:\n
+ *   <tt>(ResampleInterpolator "FinalReducedDimensionBSplineInterpolatorFloat")</tt>
+ * \parameter FinalReducedDimensionBSplineInterpolationOrder: the order of the B-spline used to resample
+ *    the deformed moving image; possible values: (0-5) \n
+ *    example: <tt>(FinalReducedDimensionBSplineInterpolationOrder 3) </tt> \n
+ *    Default: 3.
+ * \parameter ComputeCoefficientsPerFrame: whether the coefficients of a frame, i.e. a slice along the last
+ *    dimension, are only computed when the frame is first needed, instead of those of the whole image at once. \n
+ *    example: <tt>(ComputeCoefficientsPerFrame "true")</tt> \n
+ *    The default is "false".
+ *
+ * The transform parameters necessary for transformix, additionally defined by this class, are:
+ * \transformparameter FinalReducedDimensionBSplineInterpolationOrder: the order of the B-spline used to resample
+ *    the deformed moving image; possible values: (0-5) \n
+ *    example: <tt>(FinalReducedDimensionBSplineInterpolationOrder 3) </tt> \n
+ *    Default: 3.
+ *
+ * \ingroup ResampleInterpolators
+ * \sa ReducedDimensionBSplineResampleInterpolator
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT ReducedDimensionBSplineResampleInterpolatorFloat
+  : public itk::ReducedDimensionBSplineInterpolateImageFunction<
+      typename ResampleInterpolatorBase<TElastix>::InputImageType,
+      typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+      float>
+  , // CoefficientType
+    public ResampleInterpolatorBase<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef ReducedDimensionBSplineResampleInterpolatorFloat Self;
+  typedef itk::ReducedDimensionBSplineInterpolateImageFunction<
+    typename ResampleInterpolatorBase<TElastix>::InputImageType,
+    typename ResampleInterpolatorBase<TElastix>::CoordRepType,
+    float>
+                                             Superclass1;
+  typedef ResampleInterpolatorBase<TElastix> Superclass2;
+  typedef itk::SmartPointer<Self>            Pointer;
+  typedef itk::SmartPointer<const Self>      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ReducedDimensionBSplineResampleInterpolatorFloat, itk::ReducedDimensionBSplineInterpolateImageFunction);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific resample interpolator. \n
+   * example: <tt>(ResampleInterpolator "FinalBSplineInterpolator")</tt>\n
+   */
+  elxClassNameMacro("FinalReducedDimensionBSplineInterpolatorFloat");
+
+  /** Dimension of the image. */
+  itkStaticConstMacro(ImageDimension, unsigned int, Superclass1::ImageDimension);
+
+  /** Typedef's inherited from the superclass. */
+  typedef typename Superclass1::OutputType               OutputType;
+  typedef typename Superclass1::InputImageType           InputImageType;
+  typedef typename Superclass1::IndexType                IndexType;
+  typedef typename Superclass1::ContinuousIndexType      ContinuousIndexType;
+  typedef typename Superclass1::PointType                PointType;
+  typedef typename Superclass1::Iterator                 Iterator;
+  typedef typename Superclass1::CoefficientDataType      CoefficientDataType;
+  typedef typename Superclass1::CoefficientImageType     CoefficientImageType;
+  typedef typename Superclass1::CoefficientFilter        CoefficientFilter;
+  typedef typename Superclass1::CoefficientFilterPointer CoefficientFilterPointer;
+  typedef typename Superclass1::CovariantVectorType      CovariantVectorType;
+
+  /** Typedef's from ResampleInterpolatorBase. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+  typedef typename Superclass2::ParameterMapType     ParameterMapType;
+
+  /** Execute stuff before the actual registration:
+   * \li Set the spline order.
+   * \li Set whether the coefficients are computed per frame.
+   */
+  void
+  BeforeRegistration(void) override;
+
+  /** Execute stuff after each resolution:
+   * \li Offer the coefficients of the reduced dimension B-spline interpolator of the
+   *   registration, which are reused when the final resampling is done on the same image.
+   */
+  void
+  AfterEachResolution(void) override;
+
+  /** Function to read transform-parameters from a file. */
+  void
+  ReadFromFile(void) override;
+
+protected:
+  /** The constructor. */
+  ReducedDimensionBSplineResampleInterpolatorFloat() = default;
+  /** The destructor. */
+  ~ReducedDimensionBSplineResampleInterpolatorFloat() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** Creates a map of the parameters specific for this (derived) interpolator type. */
+  ParameterMapType
+  CreateDerivedTransformParametersMap() const override;
+
+  /** The deleted copy constructor. */
+  ReducedDimensionBSplineResampleInterpolatorFloat(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxRDBSplineResampleInterpolatorFloat.hxx"
+#endif
+
+#endif // end elxReducedDimensionBSplineResampleInterpolatorFloat_h
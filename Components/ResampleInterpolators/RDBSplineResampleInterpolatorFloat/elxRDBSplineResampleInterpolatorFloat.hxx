@@ -0,0 +1,135 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxReducedDimensionBSplineResampleInterpolatorFloat_hxx
+#define elxReducedDimensionBSplineResampleInterpolatorFloat_hxx
+
+#include "elxRDBSplineResampleInterpolatorFloat.h"
+
+namespace elastix
+{
+
+/*
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+ReducedDimensionBSplineResampleInterpolatorFloat<TElastix>::BeforeRegistration(void)
+{
+  /** ReducedDimensionBSplineResampleInterpolatorFloat specific. */
+
+  /** Set the SplineOrder, default = 3. */
+  unsigned int splineOrder = 3;
+
+  /** Read the desired splineOrder from the parameterFile. */
+  bool oldstyle =
+    this->m_Configuration->ReadParameter(splineOrder, "FinalReducedDimensionBSplineInterpolationOrder", 0, false);
+  if (oldstyle)
+  {
+    xl::xout["warning"] << "WARNING: FinalReducedDimensionBSplineInterpolator parameter is depecrated. "
+                        << "Replace it by FinalBSplineInterpolationOrder" << std::endl;
+  }
+  this->m_Configuration->ReadParameter(splineOrder, "FinalBSplineInterpolationOrder", 0);
+
+  /** Set the splineOrder in the superclass. */
+  this->SetSplineOrder(splineOrder);
+
+  /** Read whether the coefficients should be computed per frame. */
+  bool computeCoefficientsPerFrame = false;
+  this->m_Configuration->ReadParameter(computeCoefficientsPerFrame, "ComputeCoefficientsPerFrame", 0, false);
+  this->SetComputeCoefficientsPerFrame(computeCoefficientsPerFrame);
+
+} // end BeforeRegistration()
+
+
+/**
+ * ******************* AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+ReducedDimensionBSplineResampleInterpolatorFloat<TElastix>::AfterEachResolution(void)
+{
+  /** When the final resampling is done on the moving image of this resolution,
+   * with the same spline order, the coefficients of the interpolator of the
+   * registration are reused, instead of computing them again.
+   */
+  const Superclass1 * interpolator =
+    dynamic_cast<const Superclass1 *>(this->GetElastix()->GetElxInterpolatorBase()->GetAsITKBaseType());
+  if (interpolator != nullptr)
+  {
+    this->SetCachedCoefficients(interpolator);
+  }
+
+} // end AfterEachResolution()
+
+
+/*
+ * ******************* ReadFromFile  ****************************
+ */
+
+template <class TElastix>
+void
+ReducedDimensionBSplineResampleInterpolatorFloat<TElastix>::ReadFromFile(void)
+{
+  /** Call ReadFromFile of the ResamplerBase. */
+  this->Superclass2::ReadFromFile();
+
+  /** ReducedDimensionBSplineResampleInterpolatorFloat specific. */
+
+  /** Set the SplineOrder, default = 3. */
+  unsigned int splineOrder = 3;
+
+  /** Read the desired splineOrder from the parameterFile. */
+  bool oldstyle =
+    this->m_Configuration->ReadParameter(splineOrder, "FinalReducedDimensionBSplineInterpolationOrder", 0, false);
+  if (oldstyle)
+  {
+    xl::xout["warning"] << "WARNING: FinalReducedDimensionBSplineInterpolator parameter is depecrated. "
+                        << "Replace it by FinalBSplineInterpolationOrder" << std::endl;
+  }
+  this->m_Configuration->ReadParameter(splineOrder, "FinalBSplineInterpolationOrder", 0);
+
+  /** Set the splineOrder in the superclass. */
+  this->SetSplineOrder(splineOrder);
+
+  /** Read whether the coefficients should be computed per frame. */
+  bool computeCoefficientsPerFrame = false;
+  this->m_Configuration->ReadParameter(computeCoefficientsPerFrame, "ComputeCoefficientsPerFrame", 0, false);
+  this->SetComputeCoefficientsPerFrame(computeCoefficientsPerFrame);
+
+} // end ReadFromFile()
+
+
+/**
+ * ******************* CreateDerivedTransformParametersMap ******************************
+ */
+
+template <class TElastix>
+auto
+ReducedDimensionBSplineResampleInterpolatorFloat<TElastix>::CreateDerivedTransformParametersMap() const
+  -> ParameterMapType
+{
+  return { { "FinalBSplineInterpolationOrder", { Conversion::ToString(this->GetSplineOrder()) } } };
+
+} // end CreateDerivedTransformParametersMap()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxReducedDimensionBSplineResampleInterpolatorFloat_hxx
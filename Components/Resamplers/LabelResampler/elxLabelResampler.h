@@ -0,0 +1,136 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxLabelResampler_h
+#define elxLabelResampler_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkBlockwiseLabelResampleImageFilter.h"
+
+namespace elastix
+{
+
+/**
+ * \class LabelResampler
+ * \brief A resampler for label images, based on the itk::BlockwiseLabelResampleImageFilter.
+ *
+ * Together with the FinalNearestNeighborInterpolator, this resampler evaluates the transform
+ * only at the corners of blocks of voxels of the result image. A block of which the moving image
+ * is a single label around all mapped corners gets that label, and only the blocks near label
+ * boundaries are resampled voxel by voxel. This makes transformix much faster for label images
+ * and deformable transforms, like in atlas propagation. For other interpolators this resampler
+ * is the same as the DefaultResampler.
+ *
+ * The parameters used in this class are:
+ * \parameter Resampler: Select this resampler as follows:\n
+ *    <tt>(Resampler "LabelResampler")</tt>
+ * \parameter LabelResampleBlockSize: the size of the blocks, in voxels of the result image,
+ *    along each dimension. The result is exact as long as the transform maps no voxel of a block
+ *    more than a voxel outside the bounding box of the mapped corners, so for smooth transforms.
+ *    Larger blocks are faster, but may miss label structures that are smaller than a block and
+ *    that are not connected to the moving voxels around the corners. A value of 1 resamples
+ *    every voxel.\n
+ *    example: <tt>(LabelResampleBlockSize 8)</tt> \n
+ *    The default is 4.
+ *
+ * \ingroup Resamplers
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT LabelResampler
+  : public itk::BlockwiseLabelResampleImageFilter<typename ResamplerBase<TElastix>::InputImageType,
+                                                  typename ResamplerBase<TElastix>::OutputImageType,
+                                                  typename ResamplerBase<TElastix>::CoordRepType>
+  , public ResamplerBase<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef LabelResampler Self;
+  typedef itk::BlockwiseLabelResampleImageFilter<typename ResamplerBase<TElastix>::InputImageType,
+                                                 typename ResamplerBase<TElastix>::OutputImageType,
+                                                 typename ResamplerBase<TElastix>::CoordRepType>
+                                        Superclass1;
+  typedef ResamplerBase<TElastix>       Superclass2;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LabelResampler, BlockwiseLabelResampleImageFilter);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific resampler. \n
+   * example: <tt>(Resampler "LabelResampler")</tt>\n
+   */
+  elxClassNameMacro("LabelResampler");
+
+  /** Typedef's inherited from the superclass. */
+  typedef typename Superclass1::InputImageType        InputImageType;
+  typedef typename Superclass1::OutputImageType       OutputImageType;
+  typedef typename Superclass1::TransformType         TransformType;
+  typedef typename Superclass1::InterpolatorType      InterpolatorType;
+  typedef typename Superclass1::IndexType             IndexType;
+  typedef typename Superclass1::PixelType             PixelType;
+  typedef typename Superclass1::OutputImageRegionType OutputImageRegionType;
+
+  /** Typedef's from the ResamplerBase. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+  typedef typename Superclass2::ParameterMapType     ParameterMapType;
+
+  /** Read the LabelResampleBlockSize before the registration. */
+  void
+  BeforeRegistration(void) override;
+
+  /** Read the LabelResampleBlockSize from the transform parameter file. */
+  void
+  ReadFromFile(void) override;
+
+protected:
+  /** The constructor. */
+  LabelResampler() = default;
+  /** The destructor. */
+  ~LabelResampler() override = default;
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** Creates a map of the parameters specific for this resampler. */
+  ParameterMapType
+  CreateDerivedTransformParametersMap(void) const override;
+
+  /** The deleted copy constructor. */
+  LabelResampler(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxLabelResampler.hxx"
+#endif
+
+#endif // end #ifndef elxLabelResampler_h
@@ -0,0 +1,75 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxLabelResampler_hxx
+#define elxLabelResampler_hxx
+
+#include "elxLabelResampler.h"
+#include "elxConversion.h"
+
+namespace elastix
+{
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+LabelResampler<TElastix>::BeforeRegistration(void)
+{
+  unsigned int blockSize = this->GetBlockSize();
+  this->m_Configuration->ReadParameter(blockSize, "LabelResampleBlockSize", 0, false);
+  this->SetBlockSize(blockSize);
+
+} // end BeforeRegistration()
+
+
+/*
+ * ******************* ReadFromFile  ****************************
+ */
+
+template <class TElastix>
+void
+LabelResampler<TElastix>::ReadFromFile(void)
+{
+  /** Call ReadFromFile of the ResamplerBase. */
+  this->Superclass2::ReadFromFile();
+
+  unsigned int blockSize = this->GetBlockSize();
+  this->m_Configuration->ReadParameter(blockSize, "LabelResampleBlockSize", 0, false);
+  this->SetBlockSize(blockSize);
+
+} // end ReadFromFile()
+
+
+/**
+ * ************************* CreateDerivedTransformParametersMap ************************
+ */
+
+template <class TElastix>
+auto
+LabelResampler<TElastix>::CreateDerivedTransformParametersMap(void) const -> ParameterMapType
+{
+  return { { "LabelResampleBlockSize", { Conversion::ToString(this->GetBlockSize()) } } };
+
+} // end CreateDerivedTransformParametersMap()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxLabelResampler_hxx
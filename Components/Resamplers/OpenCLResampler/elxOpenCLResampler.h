@@ -25,12 +25,19 @@
 #include "itkGPUAdvancedCombinationTransformCopier.h"
 #include "itkGPUInterpolatorCopier.h"
 
+#include <vector>
+
 namespace elastix
 {
 
 /**
  * \class OpenCLResampler
  * \brief A resampler based on the itk::GPUResampleImageFilter.
+ *
+ * When the input and output image do not fit in the memory of the OpenCL
+ * device together, the output is resampled in slabs along its last dimension.
+ * Only the part of the input that a slab maps to is uploaded for it.
+ *
  * The parameters used in this class are:
  * \parameter Resampler: Select this resampler as follows:\n
  *    <tt>(Resampler "OpenCLResampler")</tt>
@@ -83,6 +90,7 @@ public:
 
   typedef typename Superclass1::InputImageType InputImageType;
   typedef typename InputImageType::PixelType   InputImagePixelType;
+  typedef typename InputImageType::RegionType  InputImageRegionType;
 
   typedef typename Superclass1::OutputImageType OutputImageType;
   typedef typename OutputImageType::PixelType   OutputImagePixelType;
@@ -174,6 +182,41 @@ private:
   void
   ReportToLog(void);
 
+  /** Divides the requested output region into slabs, when the input and the
+   * output do not fit in the memory of the OpenCL device together. Each slab
+   * is resampled from the part of the input it maps to. The slabs are not
+   * created when everything fits. Returns false when not even a single slice
+   * of the output fits.
+   */
+  bool
+  ComputeSlabs(void);
+
+  /** Returns the region of the input that the points of \a outputRegion are
+   * mapped to, padded by the support of the interpolator. The region is
+   * empty when all points map outside the input.
+   */
+  InputImageRegionType
+  ComputeInputRegion(const OutputImageRegionType & outputRegion) const;
+
+  /** Resamples the slabs one by one, and copies them into the output. */
+  void
+  GenerateDataInSlabs(void);
+
+  /** Sets the size and origin of the GPU resampler output to \a region. */
+  void
+  SetGPUResamplerOutputRegion(const OutputImageRegionType & region);
+
+  /** Returns a GPU image of \a input, uploaded through pinned memory. */
+  static GPUInputImagePointer
+  CreateGPUInputImage(const InputImageType * input);
+
+  /** Returns the GPU copy of the input image. The copy is kept on the GPU
+   * between calls, and is only uploaded again when the input has changed.
+   * An input that is a GPU image already is used as it is.
+   */
+  GPUInputImagePointer
+  GetGPUInputImage(void);
+
   TransformCopierPointer   m_TransformCopier;
   InterpolateCopierPointer m_InterpolatorCopier;
   GPUResamplerPointer      m_GPUResampler;
@@ -181,6 +224,15 @@ private:
   bool                     m_GPUResamplerCreated;
   bool                     m_ContextCreated;
   bool                     m_UseOpenCL;
+
+  /** The GPU copy of the input image, and the input it was made of. */
+  GPUInputImagePointer   m_GPUInputImage;
+  const InputImageType * m_GPUInputImageSource;
+  itk::ModifiedTimeType  m_GPUInputImageMTime;
+
+  /** The output slabs, and the input regions they are resampled from. */
+  std::vector<OutputImageRegionType> m_SlabRegions;
+  std::vector<InputImageRegionType>  m_SlabInputRegions;
 };
 
 // end class OpenCLResampler
@@ -20,6 +20,15 @@
 
 #include "elxOpenCLResampler.h"
 #include "itkOpenCLLogger.h"
+#include "itkImageAlgorithm.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkIndexRange.h"
+#include "itkRegionOfInterestImageFilter.h"
+
+#include <algorithm> // For min and max.
+#include <climits>   // For UINT_MAX.
+#include <cmath>     // For floor and ceil.
 
 namespace elastix
 {
@@ -71,6 +80,8 @@ elastix::OpenCLResampler<TElastix>::OpenCLResampler()
 
   this->m_UseOpenCL = true;
   this->m_ShowProgress = false;
+  this->m_GPUInputImageSource = nullptr;
+  this->m_GPUInputImageMTime = 0;
 
 } // end Constructor
 
@@ -160,15 +171,18 @@ OpenCLResampler<TElastix>::BeforeGenerateData(void)
 
   if (this->m_GPUResamplerReady)
   {
-    // Create GPU input image
+    // Create GPU input image, unless the output is resampled in slabs
     try
     {
-      gpuInputImage = GPUInputImageType::New();
-      gpuInputImage->GraftITKImage(this->GetInput());
-      gpuInputImage->AllocateGPU();
-      gpuInputImage->GetGPUDataManager()->SetCPUBufferLock(true);
-      gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
-      gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+      if (!this->ComputeSlabs())
+      {
+        xl::xout["warning"] << "WARNING: The images do not fit in the memory of the OpenCL device." << std::endl;
+        this->SwitchingToCPUAndReport(true);
+      }
+      else if (this->m_SlabRegions.empty())
+      {
+        gpuInputImage = this->GetGPUInputImage();
+      }
     }
     catch (itk::ExceptionObject & e)
     {
@@ -180,19 +194,20 @@ OpenCLResampler<TElastix>::BeforeGenerateData(void)
   if (this->m_GPUResamplerReady)
   {
     // Set the m_GPUResampler properties the same way as Superclass1
-    this->m_GPUResampler->SetSize(this->GetSize());
     this->m_GPUResampler->SetDefaultPixelValue(this->GetDefaultPixelValue());
     this->m_GPUResampler->SetOutputSpacing(this->GetOutputSpacing());
-    this->m_GPUResampler->SetOutputOrigin(this->GetOutputOrigin());
     this->m_GPUResampler->SetOutputDirection(this->GetOutputDirection());
-    this->m_GPUResampler->SetOutputStartIndex(this->GetOutputStartIndex());
+    this->SetGPUResamplerOutputRegion(this->GetOutput()->GetRequestedRegion());
   }
 
   if (this->m_GPUResamplerReady)
   {
     try
     {
-      this->m_GPUResampler->SetInput(gpuInputImage);
+      if (gpuInputImage.IsNotNull())
+      {
+        this->m_GPUResampler->SetInput(gpuInputImage);
+      }
       this->m_GPUResampler->SetTransform(gpuTransform);
       this->m_GPUResampler->SetInterpolator(gpuInterpolator);
     }
@@ -217,6 +232,325 @@ OpenCLResampler<TElastix>::BeforeGenerateData(void)
 } // end BeforeGenerateData()
 
 
+/**
+ * ******************* SetGPUResamplerOutputRegion ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLResampler<TElastix>::SetGPUResamplerOutputRegion(const OutputImageRegionType & region)
+{
+  // When the output is streamed, only the requested tile is resampled. The
+  // GPU kernels ignore the start index, so the tile is described by its size
+  // and the physical position of its first voxel.
+  if (region == this->GetOutput()->GetLargestPossibleRegion())
+  {
+    this->m_GPUResampler->SetSize(this->GetSize());
+    this->m_GPUResampler->SetOutputOrigin(this->GetOutputOrigin());
+    this->m_GPUResampler->SetOutputStartIndex(this->GetOutputStartIndex());
+  }
+  else
+  {
+    typename OutputImageType::PointType tileOrigin;
+    this->GetOutput()->TransformIndexToPhysicalPoint(region.GetIndex(), tileOrigin);
+    typename OutputImageType::IndexType tileStartIndex;
+    tileStartIndex.Fill(0);
+    this->m_GPUResampler->SetSize(region.GetSize());
+    this->m_GPUResampler->SetOutputOrigin(tileOrigin);
+    this->m_GPUResampler->SetOutputStartIndex(tileStartIndex);
+  }
+} // end SetGPUResamplerOutputRegion()
+
+
+/**
+ * ******************* ComputeSlabs ***********************
+ */
+
+template <class TElastix>
+bool
+OpenCLResampler<TElastix>::ComputeSlabs(void)
+{
+  this->m_SlabRegions.clear();
+  this->m_SlabInputRegions.clear();
+
+  // Half of the device memory is used for the images, the rest is left for
+  // the transform, the deformation field chunks and the OpenCL runtime. A
+  // single buffer is also limited by the 32-bit size in GPUDataManager.
+  const itk::OpenCLDevice device = itk::OpenCLContext::GetInstance()->GetDefaultDevice();
+  const double            memoryBudget = 0.5 * static_cast<double>(device.GetGlobalMemorySize());
+  const double            maximumBufferSize =
+    static_cast<double>(std::min<unsigned long>(device.GetMaximumAllocationSize(), UINT_MAX));
+  const double numberOfSplits = std::max(1u, this->m_GPUResampler->GetRequestedNumberOfSplits());
+
+  // The input is stored together with the float coefficients of a B-spline
+  // interpolator, and the output together with its deformation field chunks.
+  const auto fitsOnDevice = [memoryBudget, maximumBufferSize, numberOfSplits](const double inputPixels,
+                                                                               const double outputPixels) {
+    const double inputSize = inputPixels * sizeof(InputImagePixelType);
+    const double coefficientsSize = inputPixels * sizeof(float);
+    const double outputSize = outputPixels * sizeof(OutputImagePixelType);
+    const double fieldSize = outputPixels * sizeof(cl_float4) / numberOfSplits;
+    return std::max(std::max(inputSize, coefficientsSize), std::max(outputSize, fieldSize)) <= maximumBufferSize &&
+           inputSize + coefficientsSize + outputSize + fieldSize <= memoryBudget;
+  };
+
+  const OutputImageRegionType requestedRegion = this->GetOutput()->GetRequestedRegion();
+  const double inputPixels = static_cast<double>(this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels());
+  if (fitsOnDevice(inputPixels, static_cast<double>(requestedRegion.GetNumberOfPixels())))
+  {
+    return true;
+  }
+
+  // Find the smallest number of slabs for which every slab fits
+  typedef itk::ImageRegionSplitterSlowDimension RegionSplitterType;
+  const typename RegionSplitterType::Pointer splitter = RegionSplitterType::New();
+  const unsigned int numberOfSlices = requestedRegion.GetSize(OutputImageType::ImageDimension - 1);
+  for (unsigned int requestedNumberOfSlabs = 1;; requestedNumberOfSlabs *= 2)
+  {
+    const unsigned int numberOfSlabs =
+      splitter->GetNumberOfSplits(requestedRegion, std::min(requestedNumberOfSlabs, numberOfSlices));
+
+    bool allSlabsFit = true;
+    for (unsigned int i = 0; i < numberOfSlabs && allSlabsFit; ++i)
+    {
+      OutputImageRegionType slabRegion = requestedRegion;
+      splitter->GetSplit(i, numberOfSlabs, slabRegion);
+      const InputImageRegionType inputRegion = this->ComputeInputRegion(slabRegion);
+
+      allSlabsFit = fitsOnDevice(static_cast<double>(inputRegion.GetNumberOfPixels()),
+                                 static_cast<double>(slabRegion.GetNumberOfPixels()));
+      this->m_SlabRegions.push_back(slabRegion);
+      this->m_SlabInputRegions.push_back(inputRegion);
+    }
+
+    if (allSlabsFit)
+    {
+      elxout << "  The output is resampled in " << numberOfSlabs << " slabs to fit in the OpenCL device memory."
+             << std::endl;
+      return true;
+    }
+
+    this->m_SlabRegions.clear();
+    this->m_SlabInputRegions.clear();
+    if (requestedNumberOfSlabs >= numberOfSlices)
+    {
+      return false;
+    }
+  }
+} // end ComputeSlabs()
+
+
+/**
+ * ******************* ComputeInputRegion ***********************
+ */
+
+template <class TElastix>
+auto
+OpenCLResampler<TElastix>::ComputeInputRegion(const OutputImageRegionType & outputRegion) const
+  -> InputImageRegionType
+{
+  const unsigned int Dimension = OutputImageType::ImageDimension;
+  typedef typename OutputImageType::IndexType     OutputIndexType;
+  typedef typename OutputImageType::SizeType      OutputSizeType;
+  typedef typename InputImageType::PointType      InputPointType;
+  typedef itk::ContinuousIndex<double, Dimension> ContinuousIndexType;
+  typedef std::vector<itk::IndexValueType>        IndexValueVectorType;
+
+  const OutputImageType * outputPtr = this->GetOutput();
+  const InputImageType *  inputPtr = this->GetInput();
+  const TransformType *   transform = this->GetTransform();
+
+  // The points of the faces of the region are sampled densely, and the interior
+  // coarsely, as for an invertible transform the faces bound the mapped region.
+  const auto samplePositions = [](const itk::IndexValueType start,
+                                   const itk::SizeValueType  size,
+                                   const unsigned int        count) {
+    IndexValueVectorType positions;
+    const itk::SizeValueType numberOfPositions = std::min<itk::SizeValueType>(size, count);
+    for (itk::SizeValueType i = 0; i < numberOfPositions; ++i)
+    {
+      const itk::SizeValueType offset = numberOfPositions > 1 ? (i * (size - 1)) / (numberOfPositions - 1) : 0;
+      positions.push_back(start + static_cast<itk::IndexValueType>(offset));
+    }
+    return positions;
+  };
+
+  std::vector<IndexValueVectorType> facePositions(Dimension);
+  std::vector<IndexValueVectorType> interiorPositions(Dimension);
+  for (unsigned int d = 0; d < Dimension; ++d)
+  {
+    facePositions[d] = samplePositions(outputRegion.GetIndex(d), outputRegion.GetSize(d), 129);
+    interiorPositions[d] = samplePositions(outputRegion.GetIndex(d), outputRegion.GetSize(d), 17);
+  }
+
+  ContinuousIndexType minimumIndex;
+  ContinuousIndexType maximumIndex;
+  minimumIndex.Fill(itk::NumericTraits<double>::max());
+  maximumIndex.Fill(itk::NumericTraits<double>::NonpositiveMin());
+
+  const auto addSamples = [&](const std::vector<IndexValueVectorType> & positions) {
+    OutputSizeType numberOfSamples;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      numberOfSamples[d] = positions[d].size();
+    }
+    for (const auto & sampleIndex : itk::ZeroBasedIndexRange<Dimension>(numberOfSamples))
+    {
+      OutputIndexType index;
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        index[d] = positions[d][sampleIndex[d]];
+      }
+      typename OutputImageType::PointType outputPoint;
+      outputPtr->TransformIndexToPhysicalPoint(index, outputPoint);
+      const InputPointType inputPoint = transform->TransformPoint(outputPoint);
+      ContinuousIndexType  inputIndex;
+      inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, inputIndex);
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        minimumIndex[d] = std::min(minimumIndex[d], inputIndex[d]);
+        maximumIndex[d] = std::max(maximumIndex[d], inputIndex[d]);
+      }
+    }
+  };
+
+  // Every face, at the first and at the last position of one dimension
+  for (unsigned int f = 0; f < Dimension; ++f)
+  {
+    std::vector<IndexValueVectorType> positions = facePositions;
+    positions[f] = IndexValueVectorType{ facePositions[f].front(), facePositions[f].back() };
+    addSamples(positions);
+  }
+  addSamples(interiorPositions);
+
+  // Pad the region by the interpolation support, and by the distance over
+  // which the B-spline coefficients at the border of a cropped input differ
+  // from those of the whole input.
+  const itk::IndexValueType padding = 16;
+
+  InputImageRegionType inputRegion;
+  for (unsigned int d = 0; d < Dimension; ++d)
+  {
+    if (!(minimumIndex[d] <= maximumIndex[d]))
+    {
+      return InputImageRegionType();
+    }
+    const double first = std::floor(minimumIndex[d]) - padding;
+    const double last = std::ceil(maximumIndex[d]) + padding;
+    inputRegion.SetIndex(d, static_cast<itk::IndexValueType>(first));
+    inputRegion.SetSize(d, static_cast<itk::SizeValueType>(last - first + 1.0));
+  }
+  if (!inputRegion.Crop(inputPtr->GetLargestPossibleRegion()))
+  {
+    return InputImageRegionType();
+  }
+  return inputRegion;
+
+} // end ComputeInputRegion()
+
+
+/**
+ * ******************* GenerateDataInSlabs ***********************
+ */
+
+template <class TElastix>
+void
+OpenCLResampler<TElastix>::GenerateDataInSlabs(void)
+{
+  typedef itk::RegionOfInterestImageFilter<InputImageType, InputImageType> RegionOfInterestFilterType;
+
+  OutputImageType * const outputPtr = this->GetOutput();
+
+  for (std::size_t i = 0; i < this->m_SlabRegions.size() && !this->GetAbortGenerateData(); ++i)
+  {
+    const OutputImageRegionType & slabRegion = this->m_SlabRegions[i];
+    const InputImageRegionType &  inputRegion = this->m_SlabInputRegions[i];
+
+    // A slab that maps outside the input is filled with the default value
+    if (inputRegion.GetNumberOfPixels() == 0)
+    {
+      itk::ImageRegionIterator<OutputImageType> it(outputPtr, slabRegion);
+      for (; !it.IsAtEnd(); ++it)
+      {
+        it.Set(this->GetDefaultPixelValue());
+      }
+      continue;
+    }
+
+    // Upload only the part of the input that the slab maps to
+    const typename RegionOfInterestFilterType::Pointer regionOfInterest = RegionOfInterestFilterType::New();
+    regionOfInterest->SetInput(this->GetInput());
+    regionOfInterest->SetRegionOfInterest(inputRegion);
+    regionOfInterest->Update();
+
+    this->SetGPUResamplerOutputRegion(slabRegion);
+    this->m_GPUResampler->SetInput(CreateGPUInputImage(regionOfInterest->GetOutput()));
+    this->m_GPUResampler->Update();
+
+    const OutputImageType * slab = this->m_GPUResampler->GetOutput();
+    itk::ImageAlgorithm::Copy(slab, outputPtr, slab->GetLargestPossibleRegion(), slabRegion);
+  }
+} // end GenerateDataInSlabs()
+
+
+/**
+ * ******************* CreateGPUInputImage ***********************
+ */
+
+template <class TElastix>
+auto
+OpenCLResampler<TElastix>::CreateGPUInputImage(const InputImageType * input) -> GPUInputImagePointer
+{
+  // Upload the input through pinned memory, so that the copy to the GPU
+  // proceeds while the GPU resampler is configured.
+  GPUInputImagePointer gpuInputImage = GPUInputImageType::New();
+  gpuInputImage->GraftITKImage(input);
+  gpuInputImage->AllocateGPU();
+  gpuInputImage->GetGPUDataManager()->SetCPUBufferLock(true);
+  gpuInputImage->GetGPUDataManager()->SetUsePinnedHostMemory(true);
+  gpuInputImage->GetGPUDataManager()->SetGPUDirtyFlag(true);
+  gpuInputImage->GetGPUDataManager()->UpdateGPUBuffer();
+  return gpuInputImage;
+
+} // end CreateGPUInputImage()
+
+
+/**
+ * ******************* GetGPUInputImage ***********************
+ */
+
+template <class TElastix>
+auto
+OpenCLResampler<TElastix>::GetGPUInputImage(void) -> GPUInputImagePointer
+{
+  const InputImageType * input = this->GetInput();
+
+  // An input that has been computed on the GPU stays there.
+  const GPUInputImageType * gpuInput = dynamic_cast<const GPUInputImageType *>(input);
+  if (gpuInput != nullptr)
+  {
+    return const_cast<GPUInputImageType *>(gpuInput);
+  }
+
+  // Reuse the GPU copy of the previous call, which saves both the upload and,
+  // for a B-spline interpolator, the recomputation of its coefficients.
+  if (this->m_GPUInputImage.IsNotNull() && input == this->m_GPUInputImageSource &&
+      input->GetMTime() == this->m_GPUInputImageMTime)
+  {
+    return this->m_GPUInputImage;
+  }
+
+  this->m_GPUInputImage = nullptr;
+  const GPUInputImagePointer gpuInputImage = CreateGPUInputImage(input);
+
+  this->m_GPUInputImage = gpuInputImage;
+  this->m_GPUInputImageSource = input;
+  this->m_GPUInputImageMTime = input->GetMTime();
+  return gpuInputImage;
+
+} // end GetGPUInputImage()
+
+
 /**
  * ******************* GenerateData ***********************
  */
@@ -243,13 +577,34 @@ OpenCLResampler<TElastix>::GenerateData(void)
   // Allocate memory
   this->AllocateOutputs();
 
+  // Resample the output slab by slab, when it does not fit on the device
+  if (!this->m_SlabRegions.empty())
+  {
+    this->GenerateDataInSlabs();
+    this->ReportToLog();
+    return;
+  }
+
   // Perform GPU resampler execution
   this->m_GPUResampler->Update();
 
   // Perform GPU explicit sync and graft the output to this filter
   // itk::GPUExplicitSync< GPUResamplerType, GPUOutputImageType >( this->m_GPUResampler, false );
+  OutputImageType * const     outputPtr = this->GetOutput();
+  const OutputImageRegionType requestedRegion = outputPtr->GetRequestedRegion();
+  const OutputImageRegionType largestRegion = outputPtr->GetLargestPossibleRegion();
   this->GraftOutput(this->m_GPUResampler->GetOutput());
 
+  // A resampled tile is grafted with the geometry of the tile, so restore the
+  // geometry of the whole output image around the buffered tile.
+  if (requestedRegion != largestRegion)
+  {
+    outputPtr->SetOrigin(this->GetOutputOrigin());
+    outputPtr->SetLargestPossibleRegion(largestRegion);
+    outputPtr->SetBufferedRegion(requestedRegion);
+    outputPtr->SetRequestedRegion(requestedRegion);
+  }
+
   // Report OpenCL device to the log
   this->ReportToLog();
 } // end GenerateData()
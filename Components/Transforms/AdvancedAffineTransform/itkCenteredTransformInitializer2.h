@@ -195,7 +195,9 @@ public:
     m_UseTop = true;
   }
 
-  /** Get() access to the moments calculators */
+  /** Get() access to the moments calculators. Note that they are not computed
+   * when the centers of gravity are taken from the cache, see InitializeTransform().
+   */
   itkGetConstObjectMacro(FixedCalculator, FixedImageCalculatorType);
   itkGetConstObjectMacro(MovingCalculator, MovingImageCalculatorType);
 
@@ -231,6 +233,15 @@ private:
 
   FixedImageCalculatorPointer  m_FixedCalculator;
   MovingImageCalculatorPointer m_MovingCalculator;
+
+  /** Returns the center of gravity of the image inside the mask, computed by the
+   * calculator, or taken from a cache that is shared by all initializers.
+   */
+  template <class TCalculator, class TMaskImage>
+  typename TCalculator::VectorType
+  ComputeCenterOfGravity(TCalculator &                           calculator,
+                         const typename TCalculator::ImageType * image,
+                         const TMaskImage *                      mask) const;
 };
 
 } // namespace itk
@@ -37,6 +37,9 @@
 #include "itkCenteredTransformInitializer2.h"
 #include "itkImageMaskSpatialObject.h"
 
+#include <deque>
+#include <mutex>
+
 namespace itk
 {
 
@@ -95,51 +98,12 @@ CenteredTransformInitializer2<TTransform, TFixedImage, TMovingImage>::Initialize
 
   if (m_UseMoments)
   {
-    // Convert the masks to spatial objects
-    typename FixedMaskSpatialObjectType::Pointer fixedMaskAsSpatialObject; // default-constructed (null)
-    if (this->m_FixedImageMask)
-    {
-      fixedMaskAsSpatialObject = FixedMaskSpatialObjectType::New();
-      fixedMaskAsSpatialObject->SetImage(this->m_FixedImageMask);
-      fixedMaskAsSpatialObject->Update();
-    }
-
-    typename MovingMaskSpatialObjectType::Pointer movingMaskAsSpatialObject; // default-constructed (null)
-    if (this->m_MovingImageMask)
-    {
-      movingMaskAsSpatialObject = MovingMaskSpatialObjectType::New();
-      movingMaskAsSpatialObject->SetImage(this->m_MovingImageMask);
-      movingMaskAsSpatialObject->Update();
-    }
+    // Moments, or the centers of gravity computed before for the same images
+    const typename FixedImageCalculatorType::VectorType fixedCenter =
+      this->ComputeCenterOfGravity(*m_FixedCalculator, m_FixedImage.GetPointer(), m_FixedImageMask.GetPointer());
 
-    // Moments
-    m_FixedCalculator->SetImage(m_FixedImage);
-    m_FixedCalculator->SetSpatialObjectMask(fixedMaskAsSpatialObject);
-    if (this->m_CenterOfGravityUsesLowerThreshold)
-    {
-      /** Set the lower threshold for center gravity calculation. */
-      m_FixedCalculator->SetCenterOfGravityUsesLowerThreshold(this->m_CenterOfGravityUsesLowerThreshold);
-      m_FixedCalculator->SetLowerThresholdForCenterGravity(this->m_LowerThresholdForCenterGravity);
-    }
-    m_FixedCalculator->SetNumberOfSamplesForCenteredTransformInitialization(
-      this->m_NumberOfSamplesForCenteredTransformInitialization);
-    m_FixedCalculator->Compute();
-
-    m_MovingCalculator->SetImage(m_MovingImage);
-    m_MovingCalculator->SetSpatialObjectMask(movingMaskAsSpatialObject);
-    if (this->m_CenterOfGravityUsesLowerThreshold)
-    {
-      /** Set the lower threshold for center gravity calculation. */
-      m_MovingCalculator->SetCenterOfGravityUsesLowerThreshold(this->m_CenterOfGravityUsesLowerThreshold);
-      m_MovingCalculator->SetLowerThresholdForCenterGravity(this->m_LowerThresholdForCenterGravity);
-    }
-    m_MovingCalculator->SetNumberOfSamplesForCenteredTransformInitialization(
-      this->m_NumberOfSamplesForCenteredTransformInitialization);
-    m_MovingCalculator->Compute();
-
-    typename FixedImageCalculatorType::VectorType fixedCenter = m_FixedCalculator->GetCenterOfGravity();
-
-    typename MovingImageCalculatorType::VectorType movingCenter = m_MovingCalculator->GetCenterOfGravity();
+    const typename MovingImageCalculatorType::VectorType movingCenter =
+      this->ComputeCenterOfGravity(*m_MovingCalculator, m_MovingImage.GetPointer(), m_MovingImageMask.GetPointer());
 
     for (unsigned int i = 0; i < InputSpaceDimension; ++i)
     {
@@ -349,6 +313,95 @@ CenteredTransformInitializer2<TTransform, TFixedImage, TMovingImage>::Initialize
 }
 
 
+/**
+ * ************************* ComputeCenterOfGravity *********************
+ */
+
+template <class TTransform, class TFixedImage, class TMovingImage>
+template <class TCalculator, class TMaskImage>
+typename TCalculator::VectorType
+CenteredTransformInitializer2<TTransform, TFixedImage, TMovingImage>::ComputeCenterOfGravity(
+  TCalculator &                           calculator,
+  const typename TCalculator::ImageType * image,
+  const TMaskImage *                      mask) const
+{
+  /** The centers of gravity that were computed before, identified by the images, their modified
+   * times and the settings. This allows the next parameter file on the same images to reuse them.
+   */
+  struct CacheEntry
+  {
+    const void *                     m_Image;
+    ModifiedTimeType                 m_ImageMTime;
+    const void *                     m_Mask;
+    ModifiedTimeType                 m_MaskMTime;
+    SizeValueType                    m_NumberOfSamples;
+    bool                             m_UsesLowerThreshold;
+    double                           m_LowerThreshold;
+    typename TCalculator::VectorType m_CenterOfGravity;
+  };
+  static std::mutex             cacheMutex;
+  static std::deque<CacheEntry> cache;
+  const unsigned int            maximumCacheSize = 8;
+
+  CacheEntry entry;
+  entry.m_Image = image;
+  entry.m_ImageMTime = image->GetMTime();
+  entry.m_Mask = mask;
+  entry.m_MaskMTime = mask ? mask->GetMTime() : 0;
+  entry.m_NumberOfSamples = this->m_NumberOfSamplesForCenteredTransformInitialization;
+  entry.m_UsesLowerThreshold = this->m_CenterOfGravityUsesLowerThreshold;
+  entry.m_LowerThreshold =
+    this->m_CenterOfGravityUsesLowerThreshold ? static_cast<double>(this->m_LowerThresholdForCenterGravity) : 0.0;
+
+  {
+    const std::lock_guard<std::mutex> lock(cacheMutex);
+    for (const CacheEntry & cached : cache)
+    {
+      if (cached.m_Image == entry.m_Image && cached.m_ImageMTime == entry.m_ImageMTime &&
+          cached.m_Mask == entry.m_Mask && cached.m_MaskMTime == entry.m_MaskMTime &&
+          cached.m_NumberOfSamples == entry.m_NumberOfSamples &&
+          cached.m_UsesLowerThreshold == entry.m_UsesLowerThreshold &&
+          cached.m_LowerThreshold == entry.m_LowerThreshold)
+      {
+        return cached.m_CenterOfGravity;
+      }
+    }
+  }
+
+  // Convert the mask to a spatial object
+  typedef ImageMaskSpatialObject<TCalculator::ImageDimension> MaskSpatialObjectType;
+  typename MaskSpatialObjectType::Pointer                     maskAsSpatialObject; // default-constructed (null)
+  if (mask)
+  {
+    maskAsSpatialObject = MaskSpatialObjectType::New();
+    maskAsSpatialObject->SetImage(mask);
+    maskAsSpatialObject->Update();
+  }
+
+  calculator.SetImage(image);
+  calculator.SetSpatialObjectMask(maskAsSpatialObject);
+  if (this->m_CenterOfGravityUsesLowerThreshold)
+  {
+    /** Set the lower threshold for center gravity calculation. */
+    calculator.SetCenterOfGravityUsesLowerThreshold(this->m_CenterOfGravityUsesLowerThreshold);
+    calculator.SetLowerThresholdForCenterGravity(this->m_LowerThresholdForCenterGravity);
+  }
+  calculator.SetNumberOfSamplesForCenteredTransformInitialization(
+    this->m_NumberOfSamplesForCenteredTransformInitialization);
+  calculator.Compute();
+  entry.m_CenterOfGravity = calculator.GetCenterOfGravity();
+
+  const std::lock_guard<std::mutex> lock(cacheMutex);
+  cache.push_front(entry);
+  if (cache.size() > maximumCacheSize)
+  {
+    cache.pop_back();
+  }
+  return entry.m_CenterOfGravity;
+
+} // end ComputeCenterOfGravity()
+
+
 template <class TTransform, class TFixedImage, class TMovingImage>
 void
 CenteredTransformInitializer2<TTransform, TFixedImage, TMovingImage>::PrintSelf(std::ostream & os, Indent indent) const
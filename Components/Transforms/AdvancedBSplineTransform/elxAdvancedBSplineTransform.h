@@ -76,6 +76,21 @@ namespace elastix
  *   <em>Nonrigid registration of dynamic medical imaging data using nD+t B-splines and a
  *   groupwise optimization approach</em>, C.T. Metz, S. Klein, M. Schaap, T. van Walsum and
  *   W.J. Niessen, Medical Image Analysis, in press.
+ * \parameter GridAlignedWeightsTableSize: the number n of positions k / n within a grid cell
+ *   for which the B-spline weights are tabulated. Points at such a position, for example
+ *   the voxels of an image aligned with the B-spline grid whose spacing is the grid spacing
+ *   divided by a divisor of n, use table look-ups instead of evaluating the B-spline kernels,
+ *   which makes full sampling and resampling cheaper. Also read by transformix, from the
+ *   transform parameter file. \n
+ *   example: <tt>(GridAlignedWeightsTableSize 120)</tt> \n
+ *   Default value: 0, which disables the tables.
+ * \parameter UseSinglePrecisionCoefficients: let the transform read its coefficients from a
+ *   single precision copy while the metric is evaluated, which halves the memory traffic of
+ *   the coefficient look-ups. The displacements are still accumulated in double precision.
+ *   Can be specified for each resolution. The final transform always uses the double
+ *   precision coefficients. \n
+ *   example: <tt>(UseSinglePrecisionCoefficients "false" "true")</tt> \n
+ *   Default value: false.
  *
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
@@ -249,6 +264,12 @@ public:
   void
   BeforeEachResolution(void) override;
 
+  /** Execute stuff after each pyramid resolution:
+   * \li Switch back to the double precision coefficients.
+   */
+  void
+  AfterEachResolution(void) override;
+
   /** Method to set the initial B-spline grid and initialize the parameters (to 0).
    * \li Define the initial grid region, origin and spacing, using the precomputed grid information.
    * \li Set the initial parameters to zero and set then as InitialParametersOfNextLevel in the registration object.
@@ -92,6 +92,12 @@ AdvancedBSplineTransform<TElastix>::InitializeBSplineTransform(void)
   }
 
   this->SetCurrentTransform(this->m_BSplineTransform);
+
+  /** Tabulate the B-spline weights of grid aligned points, if requested. */
+  unsigned int gridAlignedWeightsTableSize = 0;
+  this->GetConfiguration()->ReadParameter(
+    gridAlignedWeightsTableSize, "GridAlignedWeightsTableSize", this->GetComponentLabel(), 0, 0, false);
+  this->m_BSplineTransform->SetGridAlignedWeightsTableSize(gridAlignedWeightsTableSize);
   this->m_GridUpsampler = GridUpsamplerType::New();
   this->m_GridUpsampler->SetBSplineOrder(this->m_SplineOrder);
 
@@ -202,9 +208,29 @@ AdvancedBSplineTransform<TElastix>::BeforeEachResolution(void)
     passiveEdgeWidth, "PassiveEdgeWidth", this->GetComponentLabel(), level, 0, false);
   this->SetOptimizerScales(passiveEdgeWidth);
 
+  /** Check if the coefficients should be read in single precision. */
+  bool useSinglePrecisionCoefficients = false;
+  this->GetConfiguration()->ReadParameter(
+    useSinglePrecisionCoefficients, "UseSinglePrecisionCoefficients", this->GetComponentLabel(), level, 0, false);
+  this->m_BSplineTransform->SetUseSinglePrecisionCoefficients(useSinglePrecisionCoefficients);
+
 } // end BeforeEachResolution()
 
 
+/**
+ * ***************** AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+AdvancedBSplineTransform<TElastix>::AfterEachResolution(void)
+{
+  /** The transform that is written and used for resampling is evaluated in double precision. */
+  this->m_BSplineTransform->SetUseSinglePrecisionCoefficients(false);
+
+} // end AfterEachResolution()
+
+
 /**
  * ******************** PreComputeGridInformation ***********************
  */
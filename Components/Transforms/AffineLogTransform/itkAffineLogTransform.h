@@ -76,6 +76,8 @@ public:
   typedef typename Superclass::SpatialHessianType            SpatialHessianType;
   typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType            InternalMatrixType;
+  typedef typename Superclass::DerivativeType                DerivativeType;
+  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
 
   typedef FixedArray<ScalarType> ScalarArrayType;
 
@@ -89,6 +91,23 @@ public:
   void
   GetJacobian(const InputPointType &, JacobianType &, NonZeroJacobianIndicesType &) const override;
 
+  /** Compute the inner product of the Jacobian with the moving image gradient,
+   * directly from the precomputed derivatives of the matrix exponential.
+   */
+  void
+  EvaluateJacobianWithImageGradientProduct(const InputPointType &          ipp,
+                                           const MovingImageGradientType & movingImageGradient,
+                                           DerivativeType &                imageJacobian,
+                                           NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
+
+  /** Batch version of EvaluateJacobianWithImageGradientProduct(), without a virtual call per point. */
+  void
+  EvaluateJacobianWithImageGradientProducts(const InputPointType *          ipp,
+                                            const MovingImageGradientType * movingImageGradients,
+                                            DerivativeType *                imageJacobians,
+                                            NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+                                            const SizeValueType             numberOfPoints) const override;
+
   void
   SetIdentity(void) override;
 
@@ -102,7 +121,9 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
-  /** Update the m_JacobianOfSpatialJacobian.  */
+  /** Update the exponential of the log-domain matrix, and its derivatives to the
+   * log-domain matrix elements in m_JacobianOfSpatialJacobian.
+   */
   virtual void
   PrecomputeJacobianOfSpatialJacobian(void);
 
@@ -112,6 +133,7 @@ private:
   operator=(const Self &) = delete;
 
   MatrixType m_MatrixLogDomain;
+  MatrixType m_MatrixExponential;
 };
 
 } // namespace itk
@@ -18,10 +18,11 @@
 #ifndef itkAffineLogTransform_hxx
 #define itkAffineLogTransform_hxx
 
-#include "vnl/vnl_matrix_exp.h"
 #include "itkMath.h"
 #include "itkAffineLogTransform.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -49,6 +50,7 @@ AffineLogTransform<TScalarType, Dimension>::AffineLogTransform(const MatrixType
   }
   this->SetOffset(off);
 
+  this->m_MatrixLogDomain.Fill(itk::NumericTraits<ScalarType>::Zero);
   this->PrecomputeJacobianOfSpatialJacobian();
 }
 
@@ -72,22 +74,27 @@ AffineLogTransform<TScalarType, Dimension>::SetParameters(const ParametersType &
   itkDebugMacro(<< "Setting parameters " << parameters);
   unsigned int k = 0; // Dummy loop index
 
-  MatrixType exponentMatrix;
+  MatrixType matrixLogDomain;
 
   for (unsigned int i = 0; i < Dimension; ++i)
   {
     for (unsigned int j = 0; j < Dimension; ++j)
     {
-      this->m_MatrixLogDomain(i, j) = parameters[k];
+      matrixLogDomain(i, j) = parameters[k];
       k += 1;
     }
   }
 
-  exponentMatrix = vnl_matrix_exp(this->m_MatrixLogDomain.GetVnlMatrix());
-
-  this->PrecomputeJacobianOfSpatialJacobian();
+  /** The exponential and its derivatives only depend on the log-domain matrix. Stack
+   * transforms set the parameters of all sub transforms, also those that did not change.
+   */
+  if (matrixLogDomain != this->m_MatrixLogDomain)
+  {
+    this->m_MatrixLogDomain = matrixLogDomain;
+    this->PrecomputeJacobianOfSpatialJacobian();
+  }
 
-  this->SetVarMatrix(exponentMatrix);
+  this->SetVarMatrix(this->m_MatrixExponential);
 
   OutputVectorType off;
 
@@ -183,74 +190,139 @@ template <class TScalarType, unsigned int Dimension>
 void
 AffineLogTransform<TScalarType, Dimension>::PrecomputeJacobianOfSpatialJacobian(void)
 {
-  unsigned int d = Dimension;
+  const unsigned int d = Dimension;
 
   /** The Jacobian of spatial Jacobian is constant over inputspace, so is precomputed */
   JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
 
   jsj.resize(ParametersDimension);
 
-  vnl_matrix<ScalarType> dA(d, d);
-
-  vnl_matrix<ScalarType> dummymatrix(d, d);
+  /** The exponential exp(A) and its derivatives dexp(A)/dA(i,j) are computed together, by scaling and
+   * squaring: with B = A / 2^s, exp(A) = exp(B)^(2^s). The Taylor series of exp(B) converges fast,
+   * because the norm of B is at most 0.5. The derivatives of its terms T_k = B^k / k! follow from
+   * dT_k = (dT_(k-1) B + T_(k-1) dB) / k, where dB = E(i,j) / 2^s has a single nonzero element,
+   * and those of the squares from d(X X) = dX X + X dX.
+   */
+  const unsigned int taylorOrder = 14;
+  const double       norm = this->m_MatrixLogDomain.GetVnlMatrix().operator_inf_norm();
+  unsigned int       numberOfSquarings = 0;
+  double             scale = 1.0;
+  while (norm * scale > 0.5)
+  {
+    scale *= 0.5;
+    ++numberOfSquarings;
+  }
 
-  vnl_matrix<ScalarType> A_bar(2 * d, 2 * d);
+  InternalMatrixType B = this->m_MatrixLogDomain.GetVnlMatrix();
+  B *= static_cast<ScalarType>(scale);
 
-  vnl_matrix<ScalarType> B_bar(2 * d, 2 * d);
+  InternalMatrixType term;
+  term.set_identity();
+  InternalMatrixType exponential = term;
 
-  dA.fill(itk::NumericTraits<ScalarType>::Zero);
-  dummymatrix.fill(itk::NumericTraits<ScalarType>::Zero);
-  A_bar.fill(itk::NumericTraits<ScalarType>::Zero);
+  InternalMatrixType zero;
+  zero.fill(itk::NumericTraits<ScalarType>::Zero);
+  std::vector<InternalMatrixType> termDerivatives(d * d, zero);
+  std::vector<InternalMatrixType> derivatives(d * d, zero);
 
-  // Fill A_bar top left and bottom right with A
-  for (unsigned int k = 0; k < d; ++k)
+  for (unsigned int k = 1; k <= taylorOrder; ++k)
   {
-    for (unsigned int l = 0; l < d; ++l)
+    const ScalarType factor = static_cast<ScalarType>(1.0 / k);
+    for (unsigned int m = 0; m < d * d; ++m)
     {
-      A_bar(k, l) = this->m_MatrixLogDomain(k, l);
+      /** T_(k-1) E(i,j) has column j equal to column i of T_(k-1). */
+      const unsigned int i = m / d;
+      const unsigned int j = m % d;
+      InternalMatrixType next = termDerivatives[m] * B;
+      for (unsigned int r = 0; r < d; ++r)
+      {
+        next(r, j) += static_cast<ScalarType>(scale) * term(r, i);
+      }
+      next *= factor;
+      termDerivatives[m] = next;
+      derivatives[m] += next;
     }
+    term = term * B;
+    term *= factor;
+    exponential += term;
   }
-  for (unsigned int k = d; k < 2 * d; ++k)
+
+  for (unsigned int s = 0; s < numberOfSquarings; ++s)
   {
-    for (unsigned int l = d; l < 2 * d; ++l)
+    for (unsigned int m = 0; m < d * d; ++m)
     {
-      A_bar(k, l) = this->m_MatrixLogDomain(k - d, l - d);
+      derivatives[m] = derivatives[m] * exponential + exponential * derivatives[m];
     }
+    exponential = exponential * exponential;
   }
 
-  unsigned int m = 0; // Dummy loop index
+  this->m_MatrixExponential = exponential;
 
   // Non-translation derivatives
-  for (unsigned int i = 0; i < d; ++i)
+  for (unsigned int m = 0; m < d * d; ++m)
   {
-    for (unsigned int j = 0; j < d; ++j)
+    jsj[m] = derivatives[m];
+  }
+
+  /** Translation parameters: */
+  for (unsigned int par = d * d; par < ParametersDimension; ++par)
+  {
+    jsj[par].Fill(itk::NumericTraits<ScalarType>::Zero);
+  }
+}
+
+
+// Evaluate Jacobian with image gradient product
+template <class TScalarType, unsigned int Dimension>
+void
+AffineLogTransform<TScalarType, Dimension>::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType &          ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType &                imageJacobian,
+  NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
+{
+  const JacobianOfSpatialJacobianType & jsj = this->m_JacobianOfSpatialJacobian;
+  const InputVectorType                 pp = ipp - this->GetCenter();
+
+  /** g^T dexp(A)/dA(i,j) (p - c) for the matrix parameters, and g for the translation. */
+  for (unsigned int par = 0; par < Dimension * Dimension; ++par)
+  {
+    double value = 0.0;
+    for (unsigned int i = 0; i < Dimension; ++i)
     {
-      dA(i, j) = 1;
-      for (unsigned int k = 0; k < d; ++k)
-      {
-        for (unsigned int l = d; l < 2 * d; ++l)
-        {
-          A_bar(k, l) = dA(k, (l - d));
-        }
-      }
-      B_bar = vnl_matrix_exp(A_bar);
-      for (unsigned int k = 0; k < d; ++k)
+      double row = 0.0;
+      for (unsigned int j = 0; j < Dimension; ++j)
       {
-        for (unsigned int l = d; l < 2 * d; ++l)
-        {
-          dummymatrix(k, (l - d)) = B_bar(k, l);
-        }
+        row += jsj[par](i, j) * pp[j];
       }
-      jsj[m] = dummymatrix;
-      dA.fill(itk::NumericTraits<ScalarType>::Zero);
-      m += 1;
+      value += movingImageGradient[i] * row;
     }
+    imageJacobian[par] = value;
+  }
+  for (unsigned int i = 0; i < Dimension; ++i)
+  {
+    imageJacobian[Dimension * Dimension + i] = movingImageGradient[i];
   }
 
-  /** Translation parameters: */
-  for (unsigned int par = d * d; par < ParametersDimension; ++par)
+  nonZeroJacobianIndices = this->m_NonZeroJacobianIndices;
+}
+
+
+// Evaluate Jacobian with image gradient products
+template <class TScalarType, unsigned int Dimension>
+void
+AffineLogTransform<TScalarType, Dimension>::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType *          ipp,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType *                imageJacobians,
+  NonZeroJacobianIndicesType *    nonZeroJacobianIndices,
+  const SizeValueType             numberOfPoints) const
+{
+  /** Non-virtual calls, so that these can be inlined. */
+  for (SizeValueType i = 0; i < numberOfPoints; ++i)
   {
-    jsj[par].Fill(itk::NumericTraits<ScalarType>::Zero);
+    this->Self::EvaluateJacobianWithImageGradientProduct(
+      ipp[i], movingImageGradients[i], imageJacobians[i], nonZeroJacobianIndices[i]);
   }
 }
 
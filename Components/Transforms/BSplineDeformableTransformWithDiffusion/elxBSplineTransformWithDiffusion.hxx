@@ -23,6 +23,7 @@
 
 #include "itkBSplineResampleImageFunction.h"
 #include "itkBSplineDecompositionImageFilter.h"
+#include "itkMultiThreaderBase.h"
 
 #include <cmath>
 
@@ -1060,35 +1061,41 @@ BSplineTransformWithDiffusion<TElastix>::DiffuseDeformationField(void)
   dummyImage->SetOrigin(this->m_DeformationOrigin);
   dummyImage->SetSpacing(this->m_DeformationSpacing);
 
-  /** Setup an iterator over dummyImage and outputImage. */
-  DummyIteratorType       iter(dummyImage, this->m_DeformationRegion);
-  VectorImageIteratorType iterout(this->m_DeformationField, this->m_DeformationRegion);
-
-  /** Declare stuff. */
-  InputPointType  inputPoint;
-  OutputPointType outputPoint;
-  VectorType      diff_point;
-  IndexType       inputIndex;
-
-  /** Calculate the TransformPoint of all voxels of the image. */
-  iter.GoToBegin();
-  iterout.GoToBegin();
-  while (!iter.IsAtEnd())
-  {
-    inputIndex = iter.GetIndex();
-    /** Transform the points to physical space. */
-    dummyImage->TransformIndexToPhysicalPoint(inputIndex, inputPoint);
-    /** Call TransformPoint. */
-    outputPoint = this->TransformPoint(inputPoint);
-    /** Calculate the difference. */
-    for (unsigned int i = 0; i < this->FixedImageDimension; ++i)
-    {
-      diff_point[i] = outputPoint[i] - inputPoint[i];
-    }
-    iterout.Set(diff_point);
-    ++iter;
-    ++iterout;
-  }
+  /** Calculate the TransformPoint of all voxels of the image. The voxels are
+   * independent of each other, so they are divided over the threads. The
+   * deformation field is allocated once, in BeforeRegistration(), and is
+   * overwritten here.
+   */
+  const DummyImageType * const dummy = dummyImage.GetPointer();
+  VectorImageType * const      deformationField = this->m_DeformationField.GetPointer();
+  const Self * const           transform = this;
+  itk::MultiThreaderBase::New()->ParallelizeImageRegion<FixedImageDimension>(
+    this->m_DeformationRegion,
+    [dummy, deformationField, transform](const RegionType & region) {
+      /** Setup an iterator over dummyImage and outputImage. */
+      DummyIteratorType       iter(dummy, region);
+      VectorImageIteratorType iterout(deformationField, region);
+
+      /** Declare stuff. */
+      InputPointType  inputPoint;
+      OutputPointType outputPoint;
+      VectorType      diff_point;
+
+      for (; !iter.IsAtEnd(); ++iter, ++iterout)
+      {
+        /** Transform the points to physical space. */
+        dummy->TransformIndexToPhysicalPoint(iter.GetIndex(), inputPoint);
+        /** Call TransformPoint. */
+        outputPoint = transform->TransformPoint(inputPoint);
+        /** Calculate the difference. */
+        for (unsigned int i = 0; i < FixedImageDimension; ++i)
+        {
+          diff_point[i] = outputPoint[i] - inputPoint[i];
+        }
+        iterout.Set(diff_point);
+      }
+    },
+    nullptr);
 
   /** ------------- 2: Update the intermediary deformationFieldTransform. ------------- */
 
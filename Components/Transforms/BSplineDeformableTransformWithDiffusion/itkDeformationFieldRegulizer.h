@@ -110,6 +110,14 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & inputPoint) const override;
 
+  /** Method to transform a batch of points. Calls TransformPoint() for each
+   * point, so that the intermediary deformation field is taken into account.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
 protected:
   /** The constructor. */
   DeformationFieldRegulizer();
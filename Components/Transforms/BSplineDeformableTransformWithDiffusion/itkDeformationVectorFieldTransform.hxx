@@ -22,6 +22,7 @@
 #include "itkImageRegionIterator.h"
 #include "itkImageRegionConstIterator.h"
 #include "itkComposeImageFilter.h"
+#include "itkMultiThreaderBase.h"
 
 namespace itk
 {
@@ -73,41 +74,50 @@ DeformationVectorFieldTransform<TScalarType, NDimensions>::SetCoefficientVectorI
   /** Typedef's for iterators. */
   typedef ImageRegionConstIterator<CoefficientVectorImageType> VectorIteratorType;
   typedef ImageRegionIterator<CoefficientImageType>            IteratorType;
+  typedef typename CoefficientVectorImageType::RegionType      RegionType;
 
   /** Create array of images representing the B-spline
-   * coefficients in each dimension.
+   * coefficients in each dimension. The images of the previous
+   * call are reused when they have the same region, because this
+   * function is called repeatedly with fields of the same size.
    */
+  const RegionType region = vecImage->GetLargestPossibleRegion();
   for (unsigned int i = 0; i < SpaceDimension; ++i)
   {
-    this->m_Images[i] = CoefficientImageType::New();
-    this->m_Images[i]->SetRegions(vecImage->GetLargestPossibleRegion());
+    if (this->m_Images[i].IsNull() || this->m_Images[i]->GetBufferedRegion() != region)
+    {
+      this->m_Images[i] = CoefficientImageType::New();
+      this->m_Images[i]->SetRegions(region);
+      this->m_Images[i]->Allocate();
+    }
     this->m_Images[i]->SetOrigin(vecImage->GetOrigin());
     this->m_Images[i]->SetSpacing(vecImage->GetSpacing());
-    this->m_Images[i]->Allocate();
-  }
-
-  /** Setup the iterators. */
-  VectorIteratorType vecit(vecImage, vecImage->GetLargestPossibleRegion());
-  vecit.GoToBegin();
-  IteratorType it[SpaceDimension];
-  for (unsigned int i = 0; i < SpaceDimension; ++i)
-  {
-    it[i] = IteratorType(this->m_Images[i], this->m_Images[i]->GetLargestPossibleRegion());
-    it[i].GoToBegin();
+    this->m_Images[i]->Modified();
   }
 
-  /** Copy one element of a vector to an image. */
-  CoefficientVectorPixelType vect;
-  while (!vecit.IsAtEnd())
-  {
-    vect = vecit.Get();
-    for (unsigned int i = 0; i < SpaceDimension; ++i)
-    {
-      it[i].Set(static_cast<CoefficientPixelType>(vect[i]));
-      ++it[i];
-    }
-    ++vecit;
-  }
+  /** Copy one element of a vector to an image, dividing the voxels over the threads. */
+  const CoefficientImagePointer * images = this->m_Images;
+  MultiThreaderBase::New()->ParallelizeImageRegion<SpaceDimension>(
+    region,
+    [vecImage, images](const RegionType & threadRegion) {
+      VectorIteratorType vecit(vecImage, threadRegion);
+      IteratorType       it[SpaceDimension];
+      for (unsigned int i = 0; i < SpaceDimension; ++i)
+      {
+        it[i] = IteratorType(images[i], threadRegion);
+      }
+
+      for (; !vecit.IsAtEnd(); ++vecit)
+      {
+        const CoefficientVectorPixelType & vect = vecit.Get();
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          it[i].Set(static_cast<CoefficientPixelType>(vect[i]));
+          ++it[i];
+        }
+      }
+    },
+    nullptr);
 
   /** Put it in the Superclass. */
   this->SetCoefficientImages(this->m_Images);
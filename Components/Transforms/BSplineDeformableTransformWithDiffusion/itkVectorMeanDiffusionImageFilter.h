@@ -123,16 +123,10 @@ protected:
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
-  /** MeanImageFilter can be implemented as a multithreaded filter.
-   * Therefore, this implementation provides a ThreadedGenerateData()
-   * routine which is called for each processing thread. The output
-   * image data is allocated automatically by the superclass prior to
-   * calling ThreadedGenerateData().  ThreadedGenerateData can only
-   * write to the portion of the output image specified by the
-   * parameter "outputRegionForThread"
-   *
-   * \sa ImageToImageFilter::ThreadedGenerateData(),
-   *     ImageToImageFilter::GenerateData().
+  /** Performs the iterations of the diffusion. Every iteration reads the
+   * result of the previous one, and writes to a second image, after which
+   * the two images swap roles. The voxels of an iteration are divided over
+   * the threads. The second image is kept, for the next update.
    */
   void
   GenerateData(void) override;
@@ -147,14 +141,23 @@ private:
   unsigned int  m_NumberOfIterations;
 
   /** Declare member images. */
-  GrayValueImagePointer m_GrayValueImage;
-  DoubleImagePointer    m_Cx;
+  GrayValueImagePointer            m_GrayValueImage;
+  DoubleImagePointer               m_Cx;
+  typename InputImageType::Pointer m_TemporaryImage;
 
   RescaleImageFilterPointer m_RescaleFilter;
 
   /** For calculating a feature image from the input m_GrayValueImage. */
   void
   FilterGrayValueImage(void);
+
+  /** One iteration of the diffusion, for a part of the target image. */
+  static void
+  ThreadedDiffuse(const InputImageType *       source,
+                  const DoubleImageType *      cx,
+                  const InputSizeType &        radius,
+                  const InputImageRegionType & region,
+                  InputImageType *             target);
 };
 
 } // end namespace itk
@@ -21,11 +21,12 @@
 
 #include "itkVectorMeanDiffusionImageFilter.h"
 
-#include "itkNeighborhoodIterator.h"
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageAlgorithm.h"
 #include "itkImageRegionIterator.h"
-#include "itkImageRegionConstIterator.h"
 #include "itkZeroFluxNeumannBoundaryCondition.h"
-#include "itkProgressReporter.h"
+
+#include <utility> // For swap.
 
 namespace itk
 {
@@ -43,6 +44,7 @@ VectorMeanDiffusionImageFilter<TInputImage, TGrayValueImage>::VectorMeanDiffusio
   this->m_RescaleFilter = nullptr;
   this->m_GrayValueImage = nullptr;
   this->m_Cx = nullptr;
+  this->m_TemporaryImage = nullptr;
 
 } // end Constructor
 
@@ -110,31 +112,14 @@ template <class TInputImage, class TGrayValueImage>
 void
 VectorMeanDiffusionImageFilter<TInputImage, TGrayValueImage>::GenerateData(void)
 {
-  // \todo to avoid all the copying we can create a vector of
-  // outputs of size this->GetNumberOfIterations(). The last
-  // output should point to this->GetOutput(). In order to avoid
-  // a big memory footprint, at some iteration k, memory of the
-  // former iteration should be released: output[ k - 1 ] = 0,
-  // and memory of the current iteration should only now be created:
-  // output[ k ] = InputImageType::New(); ...; output[ k ]->Allocate().
-  // Only for the last iteration: output[ k ]( this->GetOutput() ).
-
   /** Create feature image. */
   this->FilterGrayValueImage();
 
-  /** Declare things. */
-  unsigned int                                      i, j;
-  ZeroFluxNeumannBoundaryCondition<InputImageType>  nbc;
-  ZeroFluxNeumannBoundaryCondition<DoubleImageType> nbc2;
-  NeighborhoodIterator<InputImageType>              nit;
-  NeighborhoodIterator<DoubleImageType>             nit2;
-  VectorRealType                                    sum;
-
   /** Allocate output. */
   typename InputImageType::ConstPointer input(this->GetInput());
   typename InputImageType::Pointer      output(this->GetOutput());
-  typename InputImageType::Pointer      outputtmp = InputImageType::New();
-  output->SetRegions(input->GetLargestPossibleRegion());
+  const InputImageRegionType            region = input->GetLargestPossibleRegion();
+  output->SetRegions(region);
 
   try
   {
@@ -150,152 +135,170 @@ VectorMeanDiffusionImageFilter<TInputImage, TGrayValueImage>::GenerateData(void)
     throw excp;
   }
 
-  /** Allocate a temporary output image. */
-  outputtmp->SetSpacing(input->GetSpacing());
-  outputtmp->SetOrigin(input->GetOrigin());
-  outputtmp->SetRegions(input->GetLargestPossibleRegion());
-
-  try
-  {
-    outputtmp->Allocate();
-  }
-  catch (itk::ExceptionObject & excp)
+  /** Allocate a temporary output image, only when the region has changed,
+   * so that it is reused by the next calls of this filter.
+   */
+  if (this->m_TemporaryImage.IsNull() || this->m_TemporaryImage->GetBufferedRegion() != region)
   {
-    /** Add information to the exception and throw again. */
-    excp.SetLocation("VectorMeanDiffusionImageFilter - GenerateData()");
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while allocating a temporary copy.\n";
-    excp.SetDescription(err_str);
-    throw excp;
+    this->m_TemporaryImage = InputImageType::New();
+    this->m_TemporaryImage->SetRegions(region);
+
+    try
+    {
+      this->m_TemporaryImage->Allocate();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception and throw again. */
+      excp.SetLocation("VectorMeanDiffusionImageFilter - GenerateData()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while allocating a temporary copy.\n";
+      excp.SetDescription(err_str);
+      throw excp;
+    }
   }
+  this->m_TemporaryImage->CopyInformation(input);
+
+  /** Every iteration reads one image and writes the other, after which they swap roles.
+   * The input is copied to the image that is read first, chosen such that the result of
+   * the last iteration ends up in the output. This avoids copying after every iteration.
+   */
+  InputImageType *   images[2] = { output.GetPointer(), this->m_TemporaryImage.GetPointer() };
+  const unsigned int numberOfIterations = this->GetNumberOfIterations();
+  InputImageType *   source = images[numberOfIterations % 2];
+  InputImageType *   target = images[1 - numberOfIterations % 2];
 
-  // support progress methods/callbacks
-  // ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
+  /** Copy input to the first source. */
+  ImageAlgorithm::Copy(input.GetPointer(), source, region, region);
 
-  /** Copy input to output. */
-  ImageRegionConstIterator<InputImageType> in_it(input, input->GetLargestPossibleRegion());
-  ImageRegionIterator<InputImageType>      out_it(output, input->GetLargestPossibleRegion());
-  in_it.GoToBegin();
-  out_it.GoToBegin();
-  while (!in_it.IsAtEnd())
+  /** Loop over the number of iterations. */
+  const DoubleImageType * cx = this->m_Cx.GetPointer();
+  const InputSizeType     radius = this->m_Radius;
+  for (unsigned int k = 0; k < numberOfIterations; ++k)
   {
-    out_it.Set(in_it.Get());
-    ++in_it;
-    ++out_it;
-  }
+    /** The voxels of an iteration are independent of each other, so they are
+     * divided over the threads.
+     */
+    this->GetMultiThreader()->template ParallelizeImageRegion<InputImageDimension>(
+      region,
+      [source, target, cx, &radius](const InputImageRegionType & threadRegion) {
+        Self::ThreadedDiffuse(source, cx, radius, threadRegion, target);
+      },
+      nullptr);
+
+    std::swap(source, target);
+
+  } // end for NumberOfIterations
 
-  /** Setup neighborhood iterator for the output deformation image. */
-  nit = NeighborhoodIterator<InputImageType>(this->m_Radius, output, output->GetLargestPossibleRegion());
-  unsigned int neighborhoodSize = nit.Size();
+} // end GenerateData()
+
+
+/**
+ * ********************** ThreadedDiffuse ***********************
+ */
+
+template <class TInputImage, class TGrayValueImage>
+void
+VectorMeanDiffusionImageFilter<TInputImage, TGrayValueImage>::ThreadedDiffuse(const InputImageType *       source,
+                                                                              const DoubleImageType *      cx,
+                                                                              const InputSizeType &        radius,
+                                                                              const InputImageRegionType & region,
+                                                                              InputImageType *             target)
+{
+  /** Declare things. */
+  unsigned int                                      i, j;
+  ZeroFluxNeumannBoundaryCondition<InputImageType>  nbc;
+  ZeroFluxNeumannBoundaryCondition<DoubleImageType> nbc2;
+  VectorRealType                                    sum;
+
+  /** Setup neighborhood iterator for the source deformation image. */
+  ConstNeighborhoodIterator<InputImageType> nit(radius, source, region);
+  const unsigned int                        neighborhoodSize = nit.Size();
   nit.OverrideBoundaryCondition(&nbc);
 
   /** Setup neighborhood iterator for the "stiffness coefficient" image. */
-  nit2 = NeighborhoodIterator<DoubleImageType>(this->m_Radius, this->m_Cx, this->m_Cx->GetLargestPossibleRegion());
+  ConstNeighborhoodIterator<DoubleImageType> nit2(radius, cx, region);
   nit2.OverrideBoundaryCondition(&nbc2);
 
-  /** Setup iterator over outputtmp. */
-  ImageRegionIterator<InputImageType> oit(outputtmp, input->GetLargestPossibleRegion());
+  /** Setup iterator over the target. */
+  ImageRegionIterator<InputImageType> oit(target, region);
 
   /** Initialize c and ci. */
   double c = 0.0;
   double ci = 0.0;
 
-  /** Loop over the number of iterations. */
-  for (unsigned int k = 0; k < this->GetNumberOfIterations(); ++k)
+  /** The actual work. */
+  while (!nit.IsAtEnd())
   {
-    /** Reset the iterators. */
-    nit.GoToBegin();
-    nit2.GoToBegin();
-    oit.GoToBegin();
-
-    /** The actual work. */
-    while (!nit.IsAtEnd())
+    /** Speed up: do not filter locations where c(x) = 0. */
+    if (nit2.GetCenterPixel() < 0.000001)
+    {
+      /** Just copy input to output. */
+      oit.Set(nit.GetCenterPixel());
+    }
+    else
     {
-      /** Speed up: do not filter locations where c(x) = 0. */
-      if (nit2.GetCenterPixel() < 0.000001)
+      /** Initialize the sum to 0. */
+      for (j = 0; j < InputImageDimension; ++j)
       {
-        /** Just copy input to output. */
-        oit.Set(nit.GetCenterPixel());
+        sum[j] = NumericTraits<double>::Zero;
       }
-      else
+
+      /** Initialize sumc. */
+      double sumc = 0.0;
+
+      /** Calculate the weighted mean over the neighborhood.
+       * mean = SUM_i{ ci * x_i } / SUM_i{ ci }
+       */
+      for (i = 0; i < neighborhoodSize; ++i)
       {
-        /** Initialize the sum to 0. */
+        /** Get current pixel in this neighborhood. */
+        const InputPixelType pix = nit.GetPixel(i);
+
+        /** Get ci-value on current index. */
+        ci = nit2.GetPixel(i);
+
+        /** Calculate SUM_i{ ci } and SUM_i{ ci * x_i }. */
+        sumc += ci;
         for (j = 0; j < InputImageDimension; ++j)
         {
-          sum[j] = NumericTraits<double>::Zero;
+          sum[j] += ci * static_cast<double>(pix[j]);
         }
+      }
 
-        /** Initialize sumc. */
-        double sumc = 0.0;
-
-        /** Calculate the weighted mean over the neighborhood.
-         * mean = SUthis->m_i{ ci * x_i } / SUthis->m_i{ ci }
-         */
-        for (i = 0; i < neighborhoodSize; ++i)
+      /** Get the mean value by dividing by sumc. */
+      InputPixelType mean;
+      for (j = 0; j < InputImageDimension; ++j)
+      {
+        if (sumc < 0.00001)
         {
-          /** Get current pixel in this neighborhood. */
-          InputPixelType pix = nit.GetPixel(i);
-
-          /** Get ci-value on current index. */
-          ci = nit2.GetPixel(i);
-
-          /** Calculate SUthis->m_i{ ci } and SUthis->m_i{ ci * x_i }. */
-          sumc += ci;
-          for (j = 0; j < InputImageDimension; ++j)
-          {
-            sum[j] += ci * static_cast<double>(pix[j]);
-          }
+          mean[j] = 0.0;
         }
-
-        /** Get the mean value by dividing by sumc. */
-        InputPixelType mean;
-        for (j = 0; j < InputImageDimension; ++j)
+        else
         {
-          if (sumc < 0.00001)
-          {
-            mean[j] = 0.0;
-          }
-          else
-          {
-            mean[j] = static_cast<ValueType>(sum[j] / sumc);
-          }
+          mean[j] = static_cast<ValueType>(sum[j] / sumc);
         }
+      }
 
-        /** Get c. */
-        c = nit2.GetCenterPixel();
-
-        /** Set 'y = (1 - c) * x + c * mean' to the temporary output. */
-        InputPixelType value = nit.GetCenterPixel() * (1.0 - c) + mean * c;
+      /** Get c. */
+      c = nit2.GetCenterPixel();
 
-        /** Set it. */
-        oit.Set(value);
+      /** Set 'y = (1 - c) * x + c * mean' to the target. */
+      InputPixelType value = nit.GetCenterPixel() * (1.0 - c) + mean * c;
 
-      } // end if c < 0.000001
+      /** Set it. */
+      oit.Set(value);
 
-      /** Increase all iterators. */
-      ++nit;
-      ++nit2;
-      ++oit;
-      // progress.CompletedPixel();
+    } // end if c < 0.000001
 
-    } // end while
+    /** Increase all iterators. */
+    ++nit;
+    ++nit2;
+    ++oit;
 
-    /** Copy outputtmp to output. */
-    if (this->GetNumberOfIterations() > 0)
-    {
-      out_it.GoToBegin();
-      oit.GoToBegin();
-      while (!out_it.IsAtEnd())
-      {
-        out_it.Set(oit.Get());
-        ++out_it;
-        ++oit;
-      }
-    } // end if GetNumberOfIterations() > 0
+  } // end while
 
-  } // end for NumberOfIterations
-
-} // end GenerateData()
+} // end ThreadedDiffuse()
 
 
 /**
@@ -23,6 +23,7 @@
 #include "itkMacro.h"
 #include "itkImage.h"
 #include "itkVectorInterpolateImageFunction.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
 #include "itkVectorNearestNeighborInterpolateImageFunction.h"
 
 namespace itk
@@ -36,6 +37,11 @@ namespace itk
  * is not implemented. DO NOT USE IT FOR REGISTRATION.
  * You may set your own interpolator!
  *
+ * When the interpolator is a VectorLinearInterpolateImageFunction, TransformPoint
+ * does not call it, but interpolates the displacement directly from the pixel
+ * buffer, with fixed-length loops over the corners and the components. The
+ * clamping at the border of the buffer is the same as that of the interpolator.
+ *
  * \ingroup Transforms
  */
 
@@ -94,6 +100,7 @@ public:
   typedef typename DeformationFieldInterpolatorType::Pointer               DeformationFieldInterpolatorPointer;
   typedef VectorNearestNeighborInterpolateImageFunction<DeformationFieldType, ScalarType>
     DefaultDeformationFieldInterpolatorType;
+  typedef VectorLinearInterpolateImageFunction<DeformationFieldType, ScalarType> LinearDeformationFieldInterpolatorType;
 
   /** Set the transformation parameters is not supported.
    * Use SetDeformationField() instead
@@ -262,6 +269,13 @@ private:
   DeformationFieldInterpolatingTransform(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  /** Transform a point by linear interpolation of the displacement, directly from the pixel buffer. */
+  OutputPointType
+  TransformPointLinear(const InputPointType & point) const;
+
+  /** True when the interpolator is a LinearDeformationFieldInterpolatorType. */
+  bool m_UseFastLinearInterpolation{ false };
 };
 
 } // namespace itk
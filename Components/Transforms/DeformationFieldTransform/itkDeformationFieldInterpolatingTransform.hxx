@@ -20,6 +20,8 @@
 
 #include "itkDeformationFieldInterpolatingTransform.h"
 
+#include <algorithm> // For min and max.
+
 namespace itk
 {
 
@@ -50,6 +52,11 @@ typename DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TCompo
 DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TComponentType>::TransformPoint(
   const InputPointType & point) const
 {
+  if (this->m_UseFastLinearInterpolation)
+  {
+    return this->TransformPointLinear(point);
+  }
+
   InputContinuousIndexType cindex;
   this->m_DeformationFieldInterpolator->ConvertPointToContinuousIndex(point, cindex);
 
@@ -70,6 +77,81 @@ DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TComponentType>
 }
 
 
+// Transform a point, by linear interpolation directly from the pixel buffer
+template <class TScalarType, unsigned int NDimensions, class TComponentType>
+typename DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TComponentType>::OutputPointType
+DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TComponentType>::TransformPointLinear(
+  const InputPointType & point) const
+{
+  const DeformationFieldType * field = this->m_DeformationField.GetPointer();
+  InputContinuousIndexType     cindex;
+  field->TransformPhysicalPointToContinuousIndex(point, cindex);
+
+  /** Like the interpolator, return the point itself outside the buffer, and clamp
+   * the corners to the buffer, within half a voxel from the outermost voxel centers.
+   * Per dimension, compute the offset of the lower corner, the step to the upper
+   * corner, and the weight of the upper corner.
+   */
+  const typename DeformationFieldType::RegionType & region = field->GetBufferedRegion();
+  const OffsetValueType * const                     offsetTable = field->GetOffsetTable();
+  OffsetValueType                                   lowerOffset = 0;
+  OffsetValueType                                   step[InputSpaceDimension];
+  double                                            upperWeight[InputSpaceDimension];
+  for (unsigned int d = 0; d < InputSpaceDimension; ++d)
+  {
+    const IndexValueType start = region.GetIndex()[d];
+    const IndexValueType end = start + static_cast<IndexValueType>(region.GetSize()[d]) - 1;
+    if (!(cindex[d] >= start - 0.5 && cindex[d] < end + 0.5))
+    {
+      return point;
+    }
+    const IndexValueType base = Math::Floor<IndexValueType>(cindex[d]);
+    const IndexValueType lower = std::max(base, start);
+    const IndexValueType upper = std::min(base + 1, end);
+    upperWeight[d] = cindex[d] - static_cast<double>(base);
+    lowerOffset += (lower - start) * offsetTable[d];
+    step[d] = (upper - lower) * offsetTable[d];
+  }
+
+  /** Sum over the corners, in the same order as the interpolator. */
+  const DeformationFieldVectorType * const buffer = field->GetBufferPointer();
+  double                                   displacement[OutputSpaceDimension] = {};
+  for (unsigned int corner = 0; corner < (1u << InputSpaceDimension); ++corner)
+  {
+    OffsetValueType offset = lowerOffset;
+    double          weight = 1.0;
+    for (unsigned int d = 0; d < InputSpaceDimension; ++d)
+    {
+      if ((corner >> d) & 1u)
+      {
+        offset += step[d];
+        weight *= upperWeight[d];
+      }
+      else
+      {
+        weight *= 1.0 - upperWeight[d];
+      }
+    }
+    if (weight != 0.0)
+    {
+      const DeformationFieldVectorType & vec = buffer[offset];
+      for (unsigned int i = 0; i < OutputSpaceDimension; ++i)
+      {
+        displacement[i] += weight * static_cast<double>(vec[i]);
+      }
+    }
+  }
+
+  OutputPointType outpoint;
+  for (unsigned int i = 0; i < OutputSpaceDimension; ++i)
+  {
+    outpoint[i] = point[i] + static_cast<ScalarType>(displacement[i]);
+  }
+  return outpoint;
+
+} // end TransformPointLinear()
+
+
 // Set the deformation field
 template <class TScalarType, unsigned int NDimensions, class TComponentType>
 void
@@ -101,6 +183,7 @@ DeformationFieldInterpolatingTransform<TScalarType, NDimensions, TComponentType>
     this->m_DeformationFieldInterpolator = _arg;
     this->Modified();
   }
+  this->m_UseFastLinearInterpolation = dynamic_cast<LinearDeformationFieldInterpolatorType *>(_arg) != nullptr;
   if (this->m_DeformationFieldInterpolator.IsNotNull())
   {
     this->m_DeformationFieldInterpolator->SetInputImage(this->m_DeformationField);
@@ -22,6 +22,7 @@
 #include "itkAdvancedCombinationTransform.h"
 #include "itkEulerTransform.h"
 #include "itkCenteredTransformInitializer.h"
+#include "itkPhaseCorrelationTranslationEstimator.h"
 
 namespace elastix
 {
@@ -56,9 +57,20 @@ namespace elastix
  *    example: <tt>(AutomaticTransformInitialization "true")</tt> \n
  *    By default "false" is assumed. So, no initial translation.
  * \parameter AutomaticTransformInitializationMethod: how to initialize this
- *    transform. Should be one of {GeometricalCenter, CenterOfGravity}.\n
+ *    transform. Should be one of {GeometricalCenter, CenterOfGravity, PhaseCorrelation}.
+ *    PhaseCorrelation finds the translation of the best match of the images on a coarse
+ *    grid, by an FFT, for each of the PhaseCorrelationAngles, and keeps the rotation with
+ *    the best match, see itk::PhaseCorrelationTranslationEstimator.\n
  *    example: <tt>(AutomaticTransformInitializationMethod "CenterOfGravity")</tt> \n
  *    By default "GeometricalCenter" is assumed.\n
+ * \parameter PhaseCorrelationGridSize: the number of grid points along the longest side of
+ *    the fixed image, for the PhaseCorrelation initialization.\n
+ *    example: <tt>(PhaseCorrelationGridSize 128)</tt> \n
+ *    By default 64 is assumed.\n
+ * \parameter PhaseCorrelationAngles: the rotation angles, in radians, that the PhaseCorrelation
+ *    initialization tries for each Euler angle. In 3D, all combinations are tried.\n
+ *    example: <tt>(PhaseCorrelationAngles -0.3 0.0 0.3)</tt> \n
+ *    By default only 0.0 is tried.\n
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
  * \transformparameter CenterOfRotation: stores the center of rotation as an index. \n
@@ -157,6 +169,8 @@ public:
   typedef itk::CenteredTransformInitializer<EulerTransformType, FixedImageType, MovingImageType>
                                                      TransformInitializerType;
   typedef typename TransformInitializerType::Pointer TransformInitializerPointer;
+  typedef itk::PhaseCorrelationTranslationEstimator<FixedImageType, MovingImageType> PhaseCorrelationEstimatorType;
+  typedef typename PhaseCorrelationEstimatorType::Pointer                            PhaseCorrelationEstimatorPointer;
 
   /** For scales setting in the optimizer */
   typedef typename Superclass2::ScalesType ScalesType;
@@ -186,6 +200,11 @@ public:
   virtual void
   InitializeTransform(void);
 
+  /** Estimate the rotation and the translation by phase correlation, for each
+   * combination of the PhaseCorrelationAngles. Called by InitializeTransform(). */
+  virtual void
+  InitializeTransformByPhaseCorrelation(void);
+
   /** Set the scales
    * \li If AutomaticScalesEstimation is "true" estimate scales
    * \li If scales are provided by the user use those,
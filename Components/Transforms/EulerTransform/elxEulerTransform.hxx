@@ -217,7 +217,9 @@ EulerTransformElastix<TElastix>::InitializeTransform(void)
    * - No center of rotation was given, or
    * - The user asked for AutomaticTransformInitialization
    */
-  bool centerGiven = centerGivenAsIndex || centerGivenAsPoint;
+  bool        centerGiven = centerGivenAsIndex || centerGivenAsPoint;
+  std::string method = "GeometricalCenter";
+  this->m_Configuration->ReadParameter(method, "AutomaticTransformInitializationMethod", 0);
   if (!centerGiven || automaticTransformInitialization)
   {
 
@@ -231,8 +233,6 @@ EulerTransformElastix<TElastix>::InitializeTransform(void)
 
     /** Select the method of initialization. Default: "GeometricalCenter". */
     transformInitializer->GeometryOn();
-    std::string method = "GeometricalCenter";
-    this->m_Configuration->ReadParameter(method, "AutomaticTransformInitializationMethod", 0);
     if (method == "CenterOfGravity")
     {
       transformInitializer->MomentsOn();
@@ -263,6 +263,12 @@ EulerTransformElastix<TElastix>::InitializeTransform(void)
     this->m_EulerTransform->SetCenter(centerOfRotationPoint);
   }
 
+  /** Estimate the rotation and translation by phase correlation, if desired. */
+  if (automaticTransformInitialization && method == "PhaseCorrelation")
+  {
+    this->InitializeTransformByPhaseCorrelation();
+  }
+
   /** Apply the initial transform to the center of rotation, if
    * composition is used to combine the initial transform with the
    * the current (euler) transform.
@@ -284,6 +290,87 @@ EulerTransformElastix<TElastix>::InitializeTransform(void)
 } // end InitializeTransform()
 
 
+/**
+ * ************************* InitializeTransformByPhaseCorrelation *********************
+ */
+
+template <class TElastix>
+void
+EulerTransformElastix<TElastix>::InitializeTransformByPhaseCorrelation(void)
+{
+  /** Read the settings. */
+  unsigned int gridSize = 64;
+  this->m_Configuration->ReadParameter(gridSize, "PhaseCorrelationGridSize", 0);
+
+  std::vector<double> angles(1, 0.0);
+  const std::size_t   numberOfAngles = this->m_Configuration->CountNumberOfParameterEntries("PhaseCorrelationAngles");
+  if (numberOfAngles > 0)
+  {
+    angles.resize(numberOfAngles);
+    for (std::size_t i = 0; i < numberOfAngles; ++i)
+    {
+      this->m_Configuration->ReadParameter(angles[i], "PhaseCorrelationAngles", i);
+    }
+  }
+
+  PhaseCorrelationEstimatorPointer estimator = PhaseCorrelationEstimatorType::New();
+  estimator->SetFixedImage(this->m_Registration->GetAsITKBaseType()->GetFixedImage());
+  estimator->SetMovingImage(this->m_Registration->GetAsITKBaseType()->GetMovingImage());
+  estimator->SetFixedMask(this->GetElastix()->GetFixedMask());
+  estimator->SetMovingMask(this->GetElastix()->GetMovingMask());
+  estimator->SetGridSize(gridSize);
+  estimator->SetCenter(this->m_EulerTransform->GetCenter());
+
+  /** The parameters are the rotation angles, followed by the translation. Only in 2D
+   * and 3D, the transform has rotation angles; otherwise only the identity is tried. */
+  const unsigned int numberOfRotationParameters =
+    (SpaceDimension == 2 || SpaceDimension == 3) ? this->GetNumberOfParameters() - SpaceDimension : 0;
+  std::size_t numberOfCombinations = 1;
+  for (unsigned int i = 0; i < numberOfRotationParameters; ++i)
+  {
+    numberOfCombinations *= angles.size();
+  }
+
+  /** Try all combinations of the angles, and keep the one with the highest correlation peak. */
+  ParametersType parameters = this->m_EulerTransform->GetParameters();
+  ParametersType bestParameters = parameters;
+  double         bestScore = -1.0;
+  for (std::size_t combination = 0; combination < numberOfCombinations; ++combination)
+  {
+    std::size_t remainder = combination;
+    for (unsigned int i = 0; i < numberOfRotationParameters; ++i)
+    {
+      parameters[i] = angles[remainder % angles.size()];
+      remainder /= angles.size();
+    }
+    for (unsigned int i = numberOfRotationParameters; i < parameters.GetSize(); ++i)
+    {
+      parameters[i] = 0.0;
+    }
+    this->m_EulerTransform->SetParameters(parameters);
+    estimator->SetMatrix(this->m_EulerTransform->GetMatrix());
+    estimator->Compute();
+
+    if (estimator->GetScore() > bestScore)
+    {
+      bestScore = estimator->GetScore();
+
+      /** The moving image is matched at R (x + s - c) + c, so the translation is R s. */
+      const OutputVectorType translation = this->m_EulerTransform->GetMatrix() * estimator->GetShift();
+      bestParameters = parameters;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        bestParameters[numberOfRotationParameters + d] = translation[d];
+      }
+    }
+  }
+
+  this->m_EulerTransform->SetParameters(bestParameters);
+  elxout << "Phase correlation peak: " << bestScore << std::endl;
+
+} // end InitializeTransformByPhaseCorrelation()
+
+
 /**
  * ************************* SetScales *********************
  */
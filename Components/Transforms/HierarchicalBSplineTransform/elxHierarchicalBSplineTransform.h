@@ -0,0 +1,237 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxHierarchicalBSplineTransform_h
+#define elxHierarchicalBSplineTransform_h
+
+#include "elxIncludes.h" // include first to avoid MSVS warning
+#include "itkAdvancedCombinationTransform.h"
+#include "itkHierarchicalBSplineTransform.h"
+
+#include "itkGridScheduleComputer.h"
+
+namespace elastix
+{
+
+/**
+ * \class HierarchicalBSplineTransformElastix
+ * \brief A transform based on the itk::HierarchicalBSplineTransform.
+ *
+ * This transform is a cubic B-spline transformation, of which the control point grid
+ * is only refined where it is needed. The first resolution uses a regular grid. Every
+ * next resolution adds a level with half the grid spacing of the previous level, of which
+ * only the nodes are activated where the derivative of the sum of squared differences
+ * between the fixed and the moving image, to the coefficients of the new nodes, is largest.
+ * This derivative is computed on a grid of samples, inside the fixed mask if one is given,
+ * for the deformation at the end of the previous resolution. So the grid is only refined
+ * where the remaining misalignment is, and only inside the mask, which usually requires
+ * much fewer parameters than a regular grid with the final spacing.
+ *
+ * The parameters used in this class are:
+ * \parameter Transform: Select this transform as follows:\n
+ *    <tt>(%Transform "HierarchicalBSplineTransform")</tt>
+ * \parameter FinalGridSpacingInVoxels: the grid spacing of the finest level, at the last resolution,
+ *    for each dimension. \n
+ *    example: <tt>(FinalGridSpacingInVoxels 8.0 8.0 8.0)</tt> \n
+ *    The spacing is not in millimeters, but in "voxel size units".
+ *    The default is 16.0 in every dimension.
+ * \parameter FinalGridSpacingInPhysicalUnits: the grid spacing of the finest level, at the last
+ *    resolution, for each dimension, in millimeters. \n
+ *    example: <tt>(FinalGridSpacingInPhysicalUnits 8.0 8.0 8.0)</tt> \n
+ *    If not specified, the FinalGridSpacingInVoxels is used.
+ *    The grid of the first resolution has the final grid spacing multiplied by
+ *    2^(NumberOfResolutions - 1). The GridSpacingSchedule is not used by this transform.
+ * \parameter RefinementFraction: the fraction of the candidate nodes that is activated, when
+ *    a level is added. The candidates are the nodes of the new level near an active node of
+ *    the previous level. Can be specified for each resolution; a value of zero keeps the grid
+ *    of the previous resolution. \n
+ *    example: <tt>(RefinementFraction 0.0 0.25 0.25)</tt> \n
+ *    Default value: 0.25.
+ *
+ * The transform parameters necessary for transformix, additionally defined by this class, are:
+ * \transformparameter GridSize: stores the size of the base grid. \n
+ *    example: <tt>(GridSize 16 16 16)</tt>
+ * \transformparameter GridSpacing: stores the spacing of the base grid. \n
+ *    example: <tt>(GridSpacing 16.0 16.0 16.0)</tt>
+ * \transformparameter GridOrigin: stores the origin of the base grid. \n
+ *    example: <tt>(GridOrigin 0.0 0.0 0.0)</tt>
+ * \transformparameter GridDirection: stores the direction cosines of the base grid. \n
+ *    example: <tt>(GridDirection 1.0 0.0 0.0  0.0 1.0 0.0  0.0 0.0 0.1)</tt>
+ * \transformparameter NumberOfActiveNodes: stores the number of active nodes of every level
+ *    after the base grid. \n
+ *    example: <tt>(NumberOfActiveNodes 1520 4096)</tt>
+ * \transformparameter ActiveNodes: stores the linear indices of the active nodes of every level
+ *    after the base grid, in the grid of that level, one level after the other. \n
+ *    example: <tt>(ActiveNodes 1070 1071 1072 ...)</tt>
+ *
+ * \ingroup Transforms
+ * \sa HierarchicalBSplineTransform
+ */
+
+template <class TElastix>
+class ITK_TEMPLATE_EXPORT HierarchicalBSplineTransformElastix
+  : public itk::AdvancedCombinationTransform<typename elx::TransformBase<TElastix>::CoordRepType,
+                                             elx::TransformBase<TElastix>::FixedImageDimension>
+  , public elx::TransformBase<TElastix>
+{
+public:
+  /** Standard ITK-stuff. */
+  typedef HierarchicalBSplineTransformElastix Self;
+
+  typedef itk::AdvancedCombinationTransform<typename elx::TransformBase<TElastix>::CoordRepType,
+                                            elx::TransformBase<TElastix>::FixedImageDimension>
+    Superclass1;
+
+  typedef elx::TransformBase<TElastix> Superclass2;
+
+  /** The ITK-class that provides most of the functionality, and
+   * that is set as the "CurrentTransform" in the CombinationTransform */
+  typedef itk::HierarchicalBSplineTransform<typename elx::TransformBase<TElastix>::CoordRepType,
+                                            elx::TransformBase<TElastix>::FixedImageDimension>
+    HierarchicalBSplineTransformType;
+
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(HierarchicalBSplineTransformElastix, itk::AdvancedCombinationTransform);
+
+  /** Name of this class.
+   * Use this name in the parameter file to select this specific transform. \n
+   * example: <tt>(Transform "HierarchicalBSplineTransform")</tt>\n
+   */
+  elxClassNameMacro("HierarchicalBSplineTransform");
+
+  /** Dimension of the domain space. */
+  itkStaticConstMacro(SpaceDimension, unsigned int, Superclass2::FixedImageDimension);
+
+  /** Typedefs inherited from the superclass. */
+  typedef typename Superclass1::ScalarType             ScalarType;
+  typedef typename Superclass1::ParametersType         ParametersType;
+  typedef typename Superclass1::NumberOfParametersType NumberOfParametersType;
+  typedef typename Superclass1::InputPointType         InputPointType;
+  typedef typename Superclass1::OutputPointType        OutputPointType;
+  typedef typename Superclass1::OutputVectorType       OutputVectorType;
+
+  /** Typedef's specific for the HierarchicalBSplineTransform. */
+  typedef typename HierarchicalBSplineTransformType::Pointer           HierarchicalBSplineTransformPointer;
+  typedef typename HierarchicalBSplineTransformType::RegionType        RegionType;
+  typedef typename HierarchicalBSplineTransformType::SizeType          SizeType;
+  typedef typename HierarchicalBSplineTransformType::SpacingType       SpacingType;
+  typedef typename HierarchicalBSplineTransformType::OriginType        OriginType;
+  typedef typename HierarchicalBSplineTransformType::DirectionType     DirectionType;
+  typedef typename HierarchicalBSplineTransformType::NodeContainerType NodeContainerType;
+
+  /** Typedef's from the TransformBase class. */
+  typedef typename Superclass2::ElastixType          ElastixType;
+  typedef typename Superclass2::ElastixPointer       ElastixPointer;
+  typedef typename Superclass2::ParameterMapType     ParameterMapType;
+  typedef typename Superclass2::ConfigurationType    ConfigurationType;
+  typedef typename Superclass2::ConfigurationPointer ConfigurationPointer;
+  typedef typename Superclass2::RegistrationType     RegistrationType;
+  typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
+  typedef typename Superclass2::CoordRepType         CoordRepType;
+  typedef typename Superclass2::FixedImageType       FixedImageType;
+  typedef typename Superclass2::MovingImageType      MovingImageType;
+  typedef typename Superclass2::ITKBaseType          ITKBaseType;
+  typedef typename Superclass2::ScalesType           ScalesType;
+
+  /** Typedef's for the GridScheduleComputer. */
+  typedef itk::GridScheduleComputer<CoordRepType, SpaceDimension> GridScheduleComputerType;
+  typedef typename GridScheduleComputerType::Pointer              GridScheduleComputerPointer;
+
+  /** Execute stuff before the actual registration:
+   * \li Set a dummy base grid, and give the registration initial parameters.
+   * \li Compute the base grid of the first resolution.
+   */
+  void
+  BeforeRegistration(void) override;
+
+  /** Execute stuff before each new pyramid resolution:
+   * \li In the first resolution call InitializeTransform().
+   * \li In next resolutions add a locally refined level (so, call RefineGrid()).
+   */
+  void
+  BeforeEachResolution(void) override;
+
+  /** Set the base grid, with all coefficients zero, and set the parameters
+   * as InitialParametersOfNextLevel in the registration object.
+   */
+  virtual void
+  InitializeTransform(void);
+
+  /** Add a level with half the grid spacing of the finest level, of which the nodes are
+   * activated where the derivative of the image mismatch to their coefficients is largest.
+   * The coefficients of the previous levels are kept, and those of the new level start
+   * at zero, so the deformation does not change.
+   */
+  virtual void
+  RefineGrid(void);
+
+  /** Function to read transform-parameters from a file. */
+  void
+  ReadFromFile(void) override;
+
+protected:
+  /** The constructor. */
+  HierarchicalBSplineTransformElastix();
+  /** The destructor. */
+  ~HierarchicalBSplineTransformElastix() override = default;
+
+  /** Read the user-specified final grid spacing and compute the base grid. */
+  virtual void
+  PreComputeGridInformation(void);
+
+  /** Computes the points x inside the fixed mask on a grid of the fixed image, and the
+   * forces (M(T(x)) - F(x)) dM/dy(T(x)) at those points, for the current transform.
+   */
+  virtual void
+  ComputeRefinementForces(std::vector<InputPointType> & points, std::vector<OutputVectorType> & forces) const;
+
+  const HierarchicalBSplineTransformPointer m_HierarchicalBSplineTransform{
+    HierarchicalBSplineTransformType::New()
+  };
+  GridScheduleComputerPointer m_GridScheduleComputer{ GridScheduleComputerType::New() };
+
+private:
+  elxOverrideGetSelfMacro;
+
+  /** Creates a map of the parameters specific for this (derived) transform type. */
+  ParameterMapType
+  CreateDerivedTransformParametersMap(void) const override;
+
+  /** Set unit scales for all parameters in the optimizer. */
+  void
+  SetUnitOptimizerScales(void);
+
+  /** The deleted copy constructor. */
+  HierarchicalBSplineTransformElastix(const Self &) = delete;
+  /** The deleted assignment operator. */
+  void
+  operator=(const Self &) = delete;
+};
+
+} // end namespace elastix
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "elxHierarchicalBSplineTransform.hxx"
+#endif
+
+#endif // end #ifndef elxHierarchicalBSplineTransform_h
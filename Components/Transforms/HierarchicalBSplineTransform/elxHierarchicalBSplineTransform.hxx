@@ -0,0 +1,460 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxHierarchicalBSplineTransform_hxx
+#define elxHierarchicalBSplineTransform_hxx
+
+#include "elxHierarchicalBSplineTransform.h"
+
+#include "itkCentralDifferenceImageFunction.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+
+#include <algorithm> // For min and nth_element.
+#include <cmath>     // For ceil and floor.
+#include <numeric>   // For iota.
+
+namespace elastix
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template <class TElastix>
+HierarchicalBSplineTransformElastix<TElastix>::HierarchicalBSplineTransformElastix()
+{
+  this->SetCurrentTransform(this->m_HierarchicalBSplineTransform);
+  this->m_GridScheduleComputer->SetBSplineOrder(HierarchicalBSplineTransformType::SplineOrder);
+} // end Constructor
+
+
+/**
+ * ******************* BeforeRegistration ***********************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::BeforeRegistration(void)
+{
+  /** Set a dummy base grid, with deformation (0,0,0). In BeforeEachResolution()
+   * it is replaced by the right grid, but the registration checks the number of
+   * parameters against the initial parameters before that.
+   */
+  RegionType    gridRegion;
+  SizeType      gridSize;
+  SpacingType   gridSpacing;
+  OriginType    gridOrigin;
+  DirectionType gridDirection;
+  gridSize.Fill(1);
+  gridSize[SpaceDimension - 1] = 4;
+  gridRegion.SetSize(gridSize);
+  gridSpacing.Fill(1.0);
+  gridOrigin.Fill(0.0);
+  gridDirection.SetIdentity();
+  this->m_HierarchicalBSplineTransform->SetBaseGrid(gridRegion, gridSpacing, gridOrigin, gridDirection);
+
+  /** Give the registration an initial parameter-array. */
+  ParametersType dummyInitialParameters(this->GetNumberOfParameters());
+  dummyInitialParameters.Fill(0.0);
+  this->m_Registration->GetAsITKBaseType()->SetInitialTransformParameters(dummyInitialParameters);
+
+  /** Precompute the base grid. */
+  this->PreComputeGridInformation();
+
+} // end BeforeRegistration()
+
+
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::BeforeEachResolution(void)
+{
+  /** What is the current resolution level? */
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** Define the grid. */
+  if (level == 0)
+  {
+    this->InitializeTransform();
+  }
+  else
+  {
+    this->RefineGrid();
+  }
+
+  this->SetUnitOptimizerScales();
+
+} // end BeforeEachResolution()
+
+
+/**
+ * ******************** PreComputeGridInformation ***********************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::PreComputeGridInformation(void)
+{
+  /** Get the total number of resolution levels. */
+  const unsigned int nrOfResolutions = this->m_Registration->GetAsITKBaseType()->GetNumberOfLevels();
+
+  /** Set up grid schedule computer with image info. */
+  this->m_GridScheduleComputer->SetImageOrigin(this->GetElastix()->GetFixedImage()->GetOrigin());
+  this->m_GridScheduleComputer->SetImageSpacing(this->GetElastix()->GetFixedImage()->GetSpacing());
+  this->m_GridScheduleComputer->SetImageDirection(this->GetElastix()->GetFixedImage()->GetDirection());
+  this->m_GridScheduleComputer->SetImageRegion(this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion());
+
+  /** Take the initial transform only into account, if composition is used. */
+  if (this->GetUseComposition())
+  {
+    this->m_GridScheduleComputer->SetInitialTransform(this->Superclass1::GetInitialTransform());
+  }
+
+  /** Determine which method is used to specify the final grid spacing. */
+  const std::size_t count1 = this->m_Configuration->CountNumberOfParameterEntries("FinalGridSpacingInVoxels");
+  const std::size_t count2 = this->m_Configuration->CountNumberOfParameterEntries("FinalGridSpacingInPhysicalUnits");
+  if (count1 > 0 && count2 > 0)
+  {
+    itkExceptionMacro(<< "ERROR: You can not specify both \"FinalGridSpacingInVoxels\""
+                         " and \"FinalGridSpacingInPhysicalUnits\" in the parameter file.");
+  }
+
+  /** Declare variables and set defaults. */
+  SpacingType finalGridSpacingInVoxels;
+  SpacingType finalGridSpacingInPhysicalUnits;
+  finalGridSpacingInVoxels.Fill(16.0);
+  finalGridSpacingInPhysicalUnits.Fill(8.0);
+
+  /** Read the FinalGridSpacingInVoxels, and compute the grid spacing in physical units. */
+  if (count1 > 0 || count2 == 0)
+  {
+    for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+    {
+      this->m_Configuration->ReadParameter(
+        finalGridSpacingInVoxels[dim], "FinalGridSpacingInVoxels", this->GetComponentLabel(), dim, 0, false);
+      finalGridSpacingInPhysicalUnits[dim] =
+        finalGridSpacingInVoxels[dim] * this->GetElastix()->GetFixedImage()->GetSpacing()[dim];
+    }
+  }
+  else
+  {
+    for (unsigned int dim = 0; dim < SpaceDimension; ++dim)
+    {
+      this->m_Configuration->ReadParameter(
+        finalGridSpacingInPhysicalUnits[dim], "FinalGridSpacingInPhysicalUnits", this->GetComponentLabel(), dim, 0);
+    }
+  }
+
+  /** Every resolution halves the grid spacing of the finest level. */
+  this->m_GridScheduleComputer->SetDefaultSchedule(nrOfResolutions, 2.0);
+  this->m_GridScheduleComputer->SetFinalGridSpacing(finalGridSpacingInPhysicalUnits);
+  this->m_GridScheduleComputer->ComputeBSplineGrid();
+
+} // end PreComputeGridInformation()
+
+
+/**
+ * ******************** InitializeTransform ***********************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::InitializeTransform(void)
+{
+  /** Set the base grid, which is the B-spline grid of the first resolution. */
+  RegionType    gridRegion;
+  OriginType    gridOrigin;
+  SpacingType   gridSpacing;
+  DirectionType gridDirection;
+  this->m_GridScheduleComputer->GetBSplineGrid(0, gridRegion, gridSpacing, gridOrigin, gridDirection);
+  this->m_HierarchicalBSplineTransform->SetBaseGrid(gridRegion, gridSpacing, gridOrigin, gridDirection);
+
+  /** Set initial parameters for the first resolution to 0.0. */
+  ParametersType initialParameters(this->GetNumberOfParameters());
+  initialParameters.Fill(0.0);
+  this->m_Registration->GetAsITKBaseType()->SetInitialTransformParametersOfNextLevel(initialParameters);
+
+} // end InitializeTransform()
+
+
+/**
+ * *********************** RefineGrid ************************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::RefineGrid(void)
+{
+  /** What is the current resolution level? */
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** Start from the transform at the end of the previous resolution. */
+  this->m_HierarchicalBSplineTransform->SetParameters(
+    this->m_Registration->GetAsITKBaseType()->GetLastTransformParameters());
+
+  double refinementFraction = 0.25;
+  this->GetConfiguration()->ReadParameter(
+    refinementFraction, "RefinementFraction", this->GetComponentLabel(), level, 0, false);
+
+  if (refinementFraction > 0.0)
+  {
+    /** The derivative of the mismatch to the coefficients of the candidates. */
+    NodeContainerType candidates;
+    this->m_HierarchicalBSplineTransform->ComputeRefinementCandidates(candidates);
+    std::vector<InputPointType>   points;
+    std::vector<OutputVectorType> forces;
+    this->ComputeRefinementForces(points, forces);
+    std::vector<double> indicator;
+    this->m_HierarchicalBSplineTransform->ComputeRefinementIndicator(candidates, points, forces, indicator);
+
+    /** Activate the fraction of the candidates with the largest derivative. Candidates
+     * without any sample in their support, for example outside the mask, are skipped.
+     */
+    std::vector<itk::SizeValueType> order(candidates.size());
+    std::iota(order.begin(), order.end(), itk::SizeValueType{ 0 });
+    const std::size_t numberOfRefinedNodes =
+      std::min(candidates.size(), static_cast<std::size_t>(std::ceil(refinementFraction * candidates.size())));
+    std::nth_element(order.begin(),
+                     order.begin() + numberOfRefinedNodes,
+                     order.end(),
+                     [&indicator](const itk::SizeValueType a, const itk::SizeValueType b) {
+                       return indicator[a] > indicator[b];
+                     });
+    NodeContainerType activeNodes;
+    for (std::size_t i = 0; i < numberOfRefinedNodes; ++i)
+    {
+      if (indicator[order[i]] > 0.0)
+      {
+        activeNodes.push_back(candidates[order[i]]);
+      }
+    }
+
+    if (activeNodes.empty())
+    {
+      xl::xout["warning"] << "WARNING: no nodes of the HierarchicalBSplineTransform were refined, "
+                          << "because no samples were found." << std::endl;
+    }
+    else
+    {
+      this->m_HierarchicalBSplineTransform->AddLevel(activeNodes);
+      elxout << "Added grid level " << this->m_HierarchicalBSplineTransform->GetNumberOfLevels() - 1 << ", with "
+             << activeNodes.size() << " of " << candidates.size() << " candidate nodes active." << std::endl;
+    }
+  }
+  elxout << "The HierarchicalBSplineTransform has " << this->GetNumberOfParameters() << " parameters." << std::endl;
+
+  /** Set the initial parameters for the next level. */
+  this->m_Registration->GetAsITKBaseType()->SetInitialTransformParametersOfNextLevel(
+    this->m_HierarchicalBSplineTransform->GetParameters());
+
+} // end RefineGrid()
+
+
+/**
+ * *********************** ComputeRefinementForces ************************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::ComputeRefinementForces(std::vector<InputPointType> &   points,
+                                                                       std::vector<OutputVectorType> & forces) const
+{
+  typedef itk::LinearInterpolateImageFunction<MovingImageType, CoordRepType> InterpolatorType;
+  typedef itk::CentralDifferenceImageFunction<MovingImageType, CoordRepType> GradientFunctionType;
+  typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType>             IteratorType;
+  typedef typename ElastixType::FixedMaskType                                FixedMaskType;
+
+  const FixedImageType * fixedImage = this->GetElastix()->GetFixedImage();
+  const FixedMaskType *  fixedMask = this->GetElastix()->GetFixedMask();
+
+  const auto interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(this->GetElastix()->GetMovingImage());
+  const auto gradientFunction = GradientFunctionType::New();
+  gradientFunction->SetInputImage(this->GetElastix()->GetMovingImage());
+
+  /** Sample the fixed image with about four samples per grid spacing of the new level. */
+  const double levelFactor = static_cast<double>(1u << this->m_HierarchicalBSplineTransform->GetNumberOfLevels());
+  const typename FixedImageType::RegionType region = fixedImage->GetLargestPossibleRegion();
+  itk::OffsetValueType                      step[SpaceDimension];
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    const double gridSpacing = this->m_HierarchicalBSplineTransform->GetGridSpacing()[d] / levelFactor;
+    step[d] = std::max<itk::OffsetValueType>(
+      1, static_cast<itk::OffsetValueType>(std::floor(gridSpacing / (4.0 * fixedImage->GetSpacing()[d]))));
+  }
+
+  points.clear();
+  forces.clear();
+  for (IteratorType it(fixedImage, region); !it.IsAtEnd(); ++it)
+  {
+    const typename FixedImageType::IndexType & index = it.GetIndex();
+    bool                                       onGrid = true;
+    for (unsigned int d = 0; d < SpaceDimension; ++d)
+    {
+      onGrid &= (index[d] - region.GetIndex()[d]) % step[d] == 0;
+    }
+    if (!onGrid)
+    {
+      continue;
+    }
+
+    InputPointType point;
+    fixedImage->TransformIndexToPhysicalPoint(index, point);
+    if (fixedMask != nullptr)
+    {
+      typename FixedMaskType::IndexType maskIndex;
+      if (!fixedMask->TransformPhysicalPointToIndex(point, maskIndex) || fixedMask->GetPixel(maskIndex) == 0)
+      {
+        continue;
+      }
+    }
+
+    /** The derivative of the squared difference to the displacement, up to a factor two. */
+    const OutputPointType mappedPoint = this->TransformPoint(point);
+    if (!interpolator->IsInsideBuffer(mappedPoint))
+    {
+      continue;
+    }
+    const double     difference = interpolator->Evaluate(mappedPoint) - static_cast<double>(it.Get());
+    const auto       gradient = gradientFunction->Evaluate(mappedPoint);
+    OutputVectorType force;
+    for (unsigned int d = 0; d < SpaceDimension; ++d)
+    {
+      force[d] = difference * gradient[d];
+    }
+    points.push_back(point);
+    forces.push_back(force);
+  }
+
+} // end ComputeRefinementForces()
+
+
+/**
+ * ************************* SetUnitOptimizerScales *********************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::SetUnitOptimizerScales(void)
+{
+  ScalesType newScales(this->GetNumberOfParameters());
+  newScales.Fill(1.0);
+  this->m_Registration->GetAsITKBaseType()->GetModifiableOptimizer()->SetScales(newScales);
+
+} // end SetUnitOptimizerScales()
+
+
+/**
+ * ************************* ReadFromFile ************************
+ */
+
+template <class TElastix>
+void
+HierarchicalBSplineTransformElastix<TElastix>::ReadFromFile(void)
+{
+  /** Declarations. */
+  RegionType    gridregion;
+  SizeType      gridsize;
+  SpacingType   gridspacing;
+  OriginType    gridorigin;
+  DirectionType griddirection;
+
+  /** Fill everything with default values. */
+  gridsize.Fill(1);
+  gridspacing.Fill(1.0);
+  gridorigin.Fill(0.0);
+  griddirection.SetIdentity();
+
+  /** Get GridSize, GridSpacing, GridOrigin and GridDirection. */
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    this->m_Configuration->ReadParameter(gridsize[i], "GridSize", i);
+    this->m_Configuration->ReadParameter(gridspacing[i], "GridSpacing", i);
+    this->m_Configuration->ReadParameter(gridorigin[i], "GridOrigin", i);
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      this->m_Configuration->ReadParameter(griddirection(j, i), "GridDirection", i * SpaceDimension + j);
+    }
+  }
+  gridregion.SetSize(gridsize);
+  this->m_HierarchicalBSplineTransform->SetBaseGrid(gridregion, gridspacing, gridorigin, griddirection);
+
+  /** Add the refined levels. */
+  const auto numberOfActiveNodes =
+    this->m_Configuration->template RetrieveValuesOfParameter<itk::SizeValueType>("NumberOfActiveNodes");
+  const auto activeNodes = this->m_Configuration->template RetrieveValuesOfParameter<itk::SizeValueType>("ActiveNodes");
+  if (numberOfActiveNodes != nullptr)
+  {
+    std::size_t first = 0;
+    for (const itk::SizeValueType numberOfActiveNodesOfLevel : *numberOfActiveNodes)
+    {
+      if (activeNodes == nullptr || first + numberOfActiveNodesOfLevel > activeNodes->size())
+      {
+        itkExceptionMacro(<< "ERROR: the transform parameter file has fewer \"ActiveNodes\" than specified by "
+                          << "\"NumberOfActiveNodes\".");
+      }
+      this->m_HierarchicalBSplineTransform->AddLevel(NodeContainerType(
+        activeNodes->begin() + first, activeNodes->begin() + first + numberOfActiveNodesOfLevel));
+      first += numberOfActiveNodesOfLevel;
+    }
+  }
+
+  /** Call the ReadFromFile from the TransformBase. This must be done after
+   * setting the grid, because it calls SetParameters, which checks the number
+   * of parameters.
+   */
+  this->Superclass2::ReadFromFile();
+
+} // end ReadFromFile()
+
+
+/**
+ * ************************* CreateDerivedTransformParametersMap ************************
+ */
+
+template <class TElastix>
+auto
+HierarchicalBSplineTransformElastix<TElastix>::CreateDerivedTransformParametersMap(void) const -> ParameterMapType
+{
+  const auto & itkTransform = *m_HierarchicalBSplineTransform;
+
+  NodeContainerType numberOfActiveNodes;
+  NodeContainerType activeNodes;
+  for (unsigned int level = 1; level < itkTransform.GetNumberOfLevels(); ++level)
+  {
+    const NodeContainerType & activeNodesOfLevel = itkTransform.GetActiveNodes(level);
+    numberOfActiveNodes.push_back(activeNodesOfLevel.size());
+    activeNodes.insert(activeNodes.end(), activeNodesOfLevel.begin(), activeNodesOfLevel.end());
+  }
+
+  return { { "GridSize", Conversion::ToVectorOfStrings(itkTransform.GetGridRegion().GetSize()) },
+           { "GridSpacing", Conversion::ToVectorOfStrings(itkTransform.GetGridSpacing()) },
+           { "GridOrigin", Conversion::ToVectorOfStrings(itkTransform.GetGridOrigin()) },
+           { "GridDirection", Conversion::ToVectorOfStrings(itkTransform.GetGridDirection()) },
+           { "NumberOfActiveNodes", Conversion::ToVectorOfStrings(numberOfActiveNodes) },
+           { "ActiveNodes", Conversion::ToVectorOfStrings(activeNodes) } };
+
+} // end CreateDerivedTransformParametersMap()
+
+
+} // end namespace elastix
+
+#endif // end #ifndef elxHierarchicalBSplineTransform_hxx
@@ -0,0 +1,380 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkHierarchicalBSplineTransform_h
+#define itkHierarchicalBSplineTransform_h
+
+#include "itkAdvancedTransform.h"
+#include "itkImageBase.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class HierarchicalBSplineTransform
+ * \brief A cubic B-spline transform on a hierarchy of grids, which are only refined locally.
+ *
+ * The displacement is the sum of the cubic B-spline expansions of a number of levels:
+ * \f[T(x) = x + \sum_l \sum_{k \in A_l} c_{l,k} \beta( 2^l M (x - o) - k ),\f]
+ * where \f$M\f$ transforms a physical offset to a continuous index of the base grid,
+ * \f$o\f$ is the origin of the base grid, and \f$A_l\f$ is the set of active nodes of level l.
+ * Level l has the spacing of the base grid divided by 2^l, and the same origin, so that
+ * its grid has (n - 1) 2^l + 1 nodes along a dimension in which the base grid has n nodes.
+ *
+ * All nodes of the base grid (level 0) are active. The finer levels are added by AddLevel(),
+ * with only a part of their nodes active, for example where the image mismatch is large.
+ * Only the coefficients of the active nodes are parameters of the transform, so the number
+ * of parameters grows with the refined region, instead of with the volume of the image.
+ * The parameters are ordered per level; within a level, first the coefficients of all
+ * active nodes for the first dimension, then for the second dimension, and so on.
+ * For every level, a table of the grid size maps a node to its parameter; this costs one
+ * integer per node, while an active node costs SpaceDimension parameters, plus the state
+ * that the optimizer keeps for every parameter.
+ *
+ * The levels are simply added, without truncation of the coarser B-splines, so where
+ * several levels are active the representation is redundant. That does not harm a
+ * gradient based optimization, and keeps the evaluation a plain sum over the levels.
+ *
+ * A point contributes to a level when the support of its B-spline lies inside the grid
+ * of that level. The number of nonzero Jacobian indices is fixed: NumberOfSupportNodes for
+ * every level and every dimension. Entries of inactive nodes are padded with parameter
+ * index 0 and a zero Jacobian.
+ *
+ * \ingroup Transforms
+ */
+
+template <class TScalarType = double, unsigned int NDimensions = 3>
+class ITK_TEMPLATE_EXPORT HierarchicalBSplineTransform : public AdvancedTransform<TScalarType, NDimensions, NDimensions>
+{
+public:
+  /** Standard class typedefs. */
+  typedef HierarchicalBSplineTransform                             Self;
+  typedef AdvancedTransform<TScalarType, NDimensions, NDimensions> Superclass;
+  typedef SmartPointer<Self>                                       Pointer;
+  typedef SmartPointer<const Self>                                 ConstPointer;
+
+  /** New method for creating an object using a factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(HierarchicalBSplineTransform, AdvancedTransform);
+
+  /** Dimension of the domain space. */
+  itkStaticConstMacro(SpaceDimension, unsigned int, NDimensions);
+
+  /** The order of the B-splines, which is fixed to cubic. */
+  itkStaticConstMacro(SplineOrder, unsigned int, 3);
+
+  /** The number of nodes of a level that support a point: 4^SpaceDimension. */
+  itkStaticConstMacro(NumberOfSupportNodes, unsigned int, 1u << (2 * NDimensions));
+
+  /** Typedefs from the Superclass. */
+  typedef typename Superclass::ScalarType                    ScalarType;
+  typedef typename Superclass::ParametersType                ParametersType;
+  typedef typename Superclass::FixedParametersType           FixedParametersType;
+  typedef typename Superclass::NumberOfParametersType        NumberOfParametersType;
+  typedef typename Superclass::DerivativeType                DerivativeType;
+  typedef typename Superclass::JacobianType                  JacobianType;
+  typedef typename Superclass::InputVectorType               InputVectorType;
+  typedef typename Superclass::OutputVectorType              OutputVectorType;
+  typedef typename Superclass::InputCovariantVectorType      InputCovariantVectorType;
+  typedef typename Superclass::OutputCovariantVectorType     OutputCovariantVectorType;
+  typedef typename Superclass::InputVnlVectorType            InputVnlVectorType;
+  typedef typename Superclass::OutputVnlVectorType           OutputVnlVectorType;
+  typedef typename Superclass::InputPointType                InputPointType;
+  typedef typename Superclass::OutputPointType               OutputPointType;
+  typedef typename Superclass::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
+  typedef typename Superclass::SpatialJacobianType           SpatialJacobianType;
+  typedef typename Superclass::JacobianOfSpatialJacobianType JacobianOfSpatialJacobianType;
+  typedef typename Superclass::SpatialHessianType            SpatialHessianType;
+  typedef typename Superclass::JacobianOfSpatialHessianType  JacobianOfSpatialHessianType;
+  typedef typename Superclass::MovingImageGradientType       MovingImageGradientType;
+
+  /** Typedefs for the grid. */
+  typedef ImageBase<NDimensions>                    GridImageBaseType;
+  typedef typename GridImageBaseType::RegionType    RegionType;
+  typedef typename GridImageBaseType::SizeType      SizeType;
+  typedef typename GridImageBaseType::IndexType     IndexType;
+  typedef typename GridImageBaseType::SpacingType   SpacingType;
+  typedef typename GridImageBaseType::PointType     OriginType;
+  typedef typename GridImageBaseType::DirectionType DirectionType;
+  typedef std::vector<SizeValueType>                NodeContainerType;
+
+  /** Set the base grid, and make all its nodes active. Removes all finer levels,
+   * and sets all parameters to zero. The index of the grid region is ignored:
+   * the grid origin is the position of node 0.
+   */
+  virtual void
+  SetBaseGrid(const RegionType &    gridRegion,
+              const SpacingType &   gridSpacing,
+              const OriginType &    gridOrigin,
+              const DirectionType & gridDirection);
+
+  /** Get the base grid. */
+  itkGetConstReferenceMacro(GridRegion, RegionType);
+  itkGetConstReferenceMacro(GridSpacing, SpacingType);
+  itkGetConstReferenceMacro(GridOrigin, OriginType);
+  itkGetConstReferenceMacro(GridDirection, DirectionType);
+
+  /** Add a level with the spacing of the finest level divided by two, with the given
+   * active nodes, as linear indices in the grid of the new level. The coefficients of
+   * the new nodes are appended to the parameters, with value zero, so the transform
+   * does not change.
+   */
+  virtual void
+  AddLevel(const NodeContainerType & activeNodes);
+
+  /** The number of levels, including the base grid. */
+  unsigned int
+  GetNumberOfLevels(void) const
+  {
+    return static_cast<unsigned int>(this->m_Levels.size());
+  }
+
+
+  /** The size of the grid of a level, which may be the next level to be added. */
+  SizeType
+  GetGridSize(const unsigned int level) const;
+
+  /** The sorted linear indices of the active nodes of a level. */
+  const NodeContainerType &
+  GetActiveNodes(const unsigned int level) const
+  {
+    return this->m_Levels[level].m_ActiveNodes;
+  }
+
+
+  /** The nodes of the next level that may be activated by AddLevel(): the nodes
+   * with a position within one node distance of an active node of the finest level.
+   */
+  void
+  ComputeRefinementCandidates(NodeContainerType & candidates) const;
+
+  /** For the candidate nodes k of the next level, computes the magnitude of
+   * \f$\sum_i f_i \beta_k(x_i)\f$, over the given points \f$x_i\f$ and forces \f$f_i\f$.
+   * When the forces are the derivatives of a metric to the displacements at the points,
+   * this is the magnitude of the derivative of the metric to the coefficients of the
+   * candidate, as if it were active.
+   */
+  void
+  ComputeRefinementIndicator(const NodeContainerType &             candidates,
+                             const std::vector<InputPointType> &   points,
+                             const std::vector<OutputVectorType> & forces,
+                             std::vector<double> &                 indicator) const;
+
+  /** Set the transformation parameters and update internal transformation. */
+  void
+  SetParameters(const ParametersType & parameters) override;
+
+  /** Get the transformation parameters. */
+  const ParametersType &
+  GetParameters(void) const override
+  {
+    return this->m_Parameters;
+  }
+
+
+  /** Set the fixed parameters: the base grid size, origin, spacing and direction,
+   * followed by the number of levels, and for every level after the base grid the number
+   * of active nodes followed by their linear indices.
+   */
+  void
+  SetFixedParameters(const FixedParametersType & parameters) override;
+
+  /** Get the fixed parameters, see SetFixedParameters(). */
+  const FixedParametersType &
+  GetFixedParameters(void) const override
+  {
+    return this->m_FixedParameters;
+  }
+
+
+  /** Return the number of parameters: SpaceDimension for every active node. */
+  NumberOfParametersType
+  GetNumberOfParameters(void) const override
+  {
+    return this->m_Parameters.GetSize();
+  }
+
+
+  /** Return the number of nonzero Jacobian indices, which is the same for all points. */
+  NumberOfParametersType
+  GetNumberOfNonZeroJacobianIndices(void) const override
+  {
+    return this->m_Levels.size() * NumberOfSupportNodes * SpaceDimension;
+  }
+
+
+  /** Method to transform a point. */
+  OutputPointType
+  TransformPoint(const InputPointType & ipp) const override;
+
+  /** These vector transforms are not implemented for this transform. */
+  OutputVectorType
+  TransformVector(const InputVectorType &) const override
+  {
+    itkExceptionMacro(<< "TransformVector(const InputVectorType &) is not implemented "
+                      << "for HierarchicalBSplineTransform");
+  }
+
+
+  OutputVnlVectorType
+  TransformVector(const InputVnlVectorType &) const override
+  {
+    itkExceptionMacro(<< "TransformVector(const InputVnlVectorType &) is not implemented "
+                      << "for HierarchicalBSplineTransform");
+  }
+
+
+  OutputCovariantVectorType
+  TransformCovariantVector(const InputCovariantVectorType &) const override
+  {
+    itkExceptionMacro(<< "TransformCovariantVector(const InputCovariantVectorType &) is not implemented "
+                      << "for HierarchicalBSplineTransform");
+  }
+
+
+  /** Compute the Jacobian of the transformation. */
+  void
+  GetJacobian(const InputPointType & ipp, JacobianType & j, NonZeroJacobianIndicesType & nzji) const override;
+
+  /** Compute the inner product of the Jacobian with the moving image gradient. */
+  void
+  EvaluateJacobianWithImageGradientProduct(const InputPointType &          ipp,
+                                           const MovingImageGradientType & movingImageGradient,
+                                           DerivativeType &                imageJacobian,
+                                           NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
+
+  /** Compute the spatial Jacobian of the transformation. */
+  void
+  GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override;
+
+  /** Compute the spatial Hessian of the transformation. */
+  void
+  GetSpatialHessian(const InputPointType & ipp, SpatialHessianType & sh) const override;
+
+  /** Compute the Jacobian of the spatial Jacobian of the transformation. */
+  void
+  GetJacobianOfSpatialJacobian(const InputPointType &          ipp,
+                               JacobianOfSpatialJacobianType & jsj,
+                               NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
+
+  /** Compute both the spatial Jacobian and the Jacobian of the spatial Jacobian. */
+  void
+  GetJacobianOfSpatialJacobian(const InputPointType &          ipp,
+                               SpatialJacobianType &           sj,
+                               JacobianOfSpatialJacobianType & jsj,
+                               NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const override;
+
+  /** Compute the Jacobian of the spatial Hessian of the transformation. */
+  void
+  GetJacobianOfSpatialHessian(const InputPointType &         ipp,
+                              JacobianOfSpatialHessianType & jsh,
+                              NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const override;
+
+  /** Compute both the spatial Hessian and the Jacobian of the spatial Hessian. */
+  void
+  GetJacobianOfSpatialHessian(const InputPointType &         ipp,
+                              SpatialHessianType &           sh,
+                              JacobianOfSpatialHessianType & jsh,
+                              NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const override;
+
+protected:
+  HierarchicalBSplineTransform();
+  ~HierarchicalBSplineTransform() override = default;
+
+  /** Print contents of an HierarchicalBSplineTransform. */
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  HierarchicalBSplineTransform(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  typedef Matrix<double, NDimensions, NDimensions> PointToIndexMatrixType;
+
+  /** The geometry and the active nodes of a level. */
+  struct LevelType
+  {
+    SizeType               m_Size;
+    SizeValueType          m_NumberOfNodes{ 0 };
+    SizeValueType          m_OffsetTable[NDimensions]{};
+    SizeValueType          m_SupportOffsets[NumberOfSupportNodes]{};
+    PointToIndexMatrixType m_PointToIndex;
+    NodeContainerType      m_ActiveNodes;
+
+    /** The position of a node in m_ActiveNodes, or -1 when it is not active. */
+    std::vector<int> m_ActiveNodeNumbers;
+
+    /** The parameter of the first active node, for the first dimension. */
+    NumberOfParametersType m_FirstParameter{ 0 };
+  };
+
+  /** The B-spline weights of one support node, and their derivatives
+   * to the physical coordinates, as far as requested.
+   */
+  struct NodeWeightsType
+  {
+    double m_Value;
+    double m_Gradient[NDimensions];
+    double m_Hessian[NDimensions][NDimensions];
+  };
+
+  /** Create the geometry of a level, without active nodes. */
+  LevelType
+  CreateLevel(const unsigned int level) const;
+
+  /** Computes the first node of the support of the point in a level, and the one-dimensional
+   * weights and their first and second derivatives. Returns false when the support is not
+   * inside the grid.
+   */
+  bool
+  ComputeSupport(const LevelType &      level,
+                 const InputPointType & ipp,
+                 SizeValueType &        firstNode,
+                 double                 weights[3][NDimensions][4]) const;
+
+  /** Calls function(entry, parameter, parameterStride, nodeWeights) for all active support
+   * nodes of the point in all levels. The entry is the position of the node in the nonzero
+   * Jacobian indices of one dimension; the parameter of dimension d is parameter + d * parameterStride.
+   * Derivatives of the weights are computed up to VDerivativeOrder.
+   */
+  template <unsigned int VDerivativeOrder, class TFunction>
+  void
+  VisitActiveSupportNodes(const InputPointType & ipp, TFunction function) const;
+
+  /** Store the grid and the active nodes in m_FixedParameters. */
+  void
+  UpdateFixedParameters(void);
+
+  RegionType    m_GridRegion;
+  SpacingType   m_GridSpacing;
+  OriginType    m_GridOrigin;
+  DirectionType m_GridDirection;
+
+  std::vector<LevelType> m_Levels;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkHierarchicalBSplineTransform.hxx"
+#endif
+
+#endif // end #ifndef itkHierarchicalBSplineTransform_h
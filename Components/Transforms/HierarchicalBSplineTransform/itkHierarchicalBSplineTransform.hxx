@@ -0,0 +1,903 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkHierarchicalBSplineTransform_hxx
+#define itkHierarchicalBSplineTransform_hxx
+
+#include "itkHierarchicalBSplineTransform.h"
+
+#include <algorithm> // For sort and unique.
+#include <cmath>     // For floor and sqrt.
+#include <numeric>   // For iota.
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+HierarchicalBSplineTransform<TScalarType, NDimensions>::HierarchicalBSplineTransform()
+  : Superclass()
+{
+  /** Start with a base grid of a single node. */
+  RegionType gridRegion;
+  SizeType   gridSize;
+  gridSize.Fill(1);
+  gridRegion.SetSize(gridSize);
+  SpacingType gridSpacing;
+  gridSpacing.Fill(1.0);
+  OriginType gridOrigin;
+  gridOrigin.Fill(0.0);
+  DirectionType gridDirection;
+  gridDirection.SetIdentity();
+  this->SetBaseGrid(gridRegion, gridSpacing, gridOrigin, gridDirection);
+
+} // end Constructor
+
+
+/**
+ * ********************* SetBaseGrid ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::SetBaseGrid(const RegionType &    gridRegion,
+                                                                    const SpacingType &   gridSpacing,
+                                                                    const OriginType &    gridOrigin,
+                                                                    const DirectionType & gridDirection)
+{
+  this->m_GridRegion = gridRegion;
+  this->m_GridSpacing = gridSpacing;
+  this->m_GridOrigin = gridOrigin;
+  this->m_GridDirection = gridDirection;
+
+  /** Remove all levels and parameters, and add the base grid with all its nodes active. */
+  this->m_Levels.clear();
+  this->m_Parameters.SetSize(0);
+  NodeContainerType allNodes(gridRegion.GetNumberOfPixels());
+  std::iota(allNodes.begin(), allNodes.end(), SizeValueType{ 0 });
+  this->AddLevel(allNodes);
+
+} // end SetBaseGrid()
+
+
+/**
+ * ********************* AddLevel ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::AddLevel(const NodeContainerType & activeNodes)
+{
+  LevelType level = this->CreateLevel(this->GetNumberOfLevels());
+
+  /** Store the sorted active nodes, and their numbers in the table of the grid. */
+  level.m_ActiveNodes = activeNodes;
+  std::sort(level.m_ActiveNodes.begin(), level.m_ActiveNodes.end());
+  level.m_ActiveNodes.erase(std::unique(level.m_ActiveNodes.begin(), level.m_ActiveNodes.end()),
+                            level.m_ActiveNodes.end());
+  if (!level.m_ActiveNodes.empty() && level.m_ActiveNodes.back() >= level.m_NumberOfNodes)
+  {
+    itkExceptionMacro(<< "ERROR: node " << level.m_ActiveNodes.back() << " is outside the grid of level "
+                      << this->GetNumberOfLevels() << ", which has " << level.m_NumberOfNodes << " nodes.");
+  }
+  level.m_ActiveNodeNumbers.assign(level.m_NumberOfNodes, -1);
+  for (SizeValueType a = 0; a < level.m_ActiveNodes.size(); ++a)
+  {
+    level.m_ActiveNodeNumbers[level.m_ActiveNodes[a]] = static_cast<int>(a);
+  }
+
+  /** Append the coefficients of the new level, with value zero. */
+  level.m_FirstParameter = this->m_Parameters.GetSize();
+  ParametersType parameters(level.m_FirstParameter + level.m_ActiveNodes.size() * SpaceDimension);
+  parameters.Fill(0.0);
+  std::copy(this->m_Parameters.begin(), this->m_Parameters.end(), parameters.begin());
+  this->m_Parameters = parameters;
+
+  this->m_Levels.push_back(std::move(level));
+  this->UpdateFixedParameters();
+  this->Modified();
+
+} // end AddLevel()
+
+
+/**
+ * ********************* CreateLevel ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+auto
+HierarchicalBSplineTransform<TScalarType, NDimensions>::CreateLevel(const unsigned int levelNumber) const
+  -> LevelType
+{
+  LevelType level;
+
+  /** The grid of the level, with the first dimension running fastest. */
+  level.m_NumberOfNodes = 1;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    level.m_Size[d] = ((this->m_GridRegion.GetSize()[d] - 1) << levelNumber) + 1;
+    level.m_OffsetTable[d] = level.m_NumberOfNodes;
+    level.m_NumberOfNodes *= level.m_Size[d];
+  }
+
+  /** The offsets of the support nodes from the first support node. */
+  for (unsigned int s = 0; s < NumberOfSupportNodes; ++s)
+  {
+    level.m_SupportOffsets[s] = 0;
+    for (unsigned int d = 0; d < SpaceDimension; ++d)
+    {
+      level.m_SupportOffsets[s] += ((s >> (2 * d)) & 3) * level.m_OffsetTable[d];
+    }
+  }
+
+  /** The mapping from a physical offset to the origin, to a continuous index of the level. */
+  PointToIndexMatrixType indexToPoint;
+  for (unsigned int i = 0; i < SpaceDimension; ++i)
+  {
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      indexToPoint(i, j) = this->m_GridDirection(i, j) * this->m_GridSpacing[j];
+    }
+  }
+  const PointToIndexMatrixType pointToIndex(indexToPoint.GetInverse());
+  level.m_PointToIndex = pointToIndex * static_cast<double>(SizeValueType(1) << levelNumber);
+
+  return level;
+
+} // end CreateLevel()
+
+
+/**
+ * ********************* GetGridSize ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+auto
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetGridSize(const unsigned int level) const -> SizeType
+{
+  return this->CreateLevel(level).m_Size;
+
+} // end GetGridSize()
+
+
+/**
+ * ********************* ComputeSupport ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+bool
+HierarchicalBSplineTransform<TScalarType, NDimensions>::ComputeSupport(const LevelType &      level,
+                                                                       const InputPointType & ipp,
+                                                                       SizeValueType &        firstNode,
+                                                                       double weights[3][NDimensions][4]) const
+{
+  firstNode = 0;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    double cindex = 0.0;
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      cindex += level.m_PointToIndex(d, j) * (ipp[j] - this->m_GridOrigin[j]);
+    }
+
+    /** The support runs from node floor(cindex) - 1 to floor(cindex) + 2. */
+    const double floored = std::floor(cindex);
+    if (!(floored >= 1.0 && floored + 3.0 <= static_cast<double>(level.m_Size[d])))
+    {
+      return false;
+    }
+    firstNode += (static_cast<SizeValueType>(floored) - 1) * level.m_OffsetTable[d];
+
+    /** The cubic B-spline weights, and their first and second derivatives. */
+    const double u = cindex - floored;
+    const double v = 1.0 - u;
+    weights[0][d][0] = v * v * v / 6.0;
+    weights[0][d][1] = (4.0 + u * u * (3.0 * u - 6.0)) / 6.0;
+    weights[0][d][2] = (1.0 + 3.0 * u * (1.0 + u - u * u)) / 6.0;
+    weights[0][d][3] = u * u * u / 6.0;
+    weights[1][d][0] = -0.5 * v * v;
+    weights[1][d][1] = u * (1.5 * u - 2.0);
+    weights[1][d][2] = 0.5 + u * (1.0 - 1.5 * u);
+    weights[1][d][3] = 0.5 * u * u;
+    weights[2][d][0] = v;
+    weights[2][d][1] = 3.0 * u - 2.0;
+    weights[2][d][2] = 1.0 - 3.0 * u;
+    weights[2][d][3] = u;
+  }
+  return true;
+
+} // end ComputeSupport()
+
+
+/**
+ * ********************* VisitActiveSupportNodes ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+template <unsigned int VDerivativeOrder, class TFunction>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::VisitActiveSupportNodes(const InputPointType & ipp,
+                                                                                TFunction              function) const
+{
+  unsigned int entry = 0;
+  for (const LevelType & level : this->m_Levels)
+  {
+    SizeValueType firstNode;
+    double        weights[3][SpaceDimension][4];
+    if (!this->ComputeSupport(level, ipp, firstNode, weights))
+    {
+      entry += NumberOfSupportNodes;
+      continue;
+    }
+
+    const SizeValueType            parameterStride = level.m_ActiveNodes.size();
+    const PointToIndexMatrixType & M = level.m_PointToIndex;
+    for (unsigned int s = 0; s < NumberOfSupportNodes; ++s, ++entry)
+    {
+      const int number = level.m_ActiveNodeNumbers[firstNode + level.m_SupportOffsets[s]];
+      if (number < 0)
+      {
+        continue;
+      }
+
+      /** The position of the node in the support, for every dimension. */
+      unsigned int position[SpaceDimension];
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        position[d] = (s >> (2 * d)) & 3;
+      }
+
+      NodeWeightsType nodeWeights;
+      nodeWeights.m_Value = 1.0;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        nodeWeights.m_Value *= weights[0][d][position[d]];
+      }
+
+      /** The derivatives to the continuous index, transformed to the physical coordinates. */
+      if (VDerivativeOrder >= 1)
+      {
+        double indexGradient[SpaceDimension];
+        for (unsigned int p = 0; p < SpaceDimension; ++p)
+        {
+          indexGradient[p] = 1.0;
+          for (unsigned int d = 0; d < SpaceDimension; ++d)
+          {
+            indexGradient[p] *= weights[d == p ? 1 : 0][d][position[d]];
+          }
+        }
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          nodeWeights.m_Gradient[i] = 0.0;
+          for (unsigned int p = 0; p < SpaceDimension; ++p)
+          {
+            nodeWeights.m_Gradient[i] += indexGradient[p] * M(p, i);
+          }
+        }
+      }
+
+      if (VDerivativeOrder >= 2)
+      {
+        double indexHessian[SpaceDimension][SpaceDimension];
+        for (unsigned int p = 0; p < SpaceDimension; ++p)
+        {
+          for (unsigned int q = 0; q < SpaceDimension; ++q)
+          {
+            indexHessian[p][q] = 1.0;
+            for (unsigned int d = 0; d < SpaceDimension; ++d)
+            {
+              indexHessian[p][q] *= weights[(d == p ? 1 : 0) + (d == q ? 1 : 0)][d][position[d]];
+            }
+          }
+        }
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          for (unsigned int j = 0; j < SpaceDimension; ++j)
+          {
+            nodeWeights.m_Hessian[i][j] = 0.0;
+            for (unsigned int p = 0; p < SpaceDimension; ++p)
+            {
+              for (unsigned int q = 0; q < SpaceDimension; ++q)
+              {
+                nodeWeights.m_Hessian[i][j] += M(p, i) * indexHessian[p][q] * M(q, j);
+              }
+            }
+          }
+        }
+      }
+
+      function(
+        entry, level.m_FirstParameter + static_cast<NumberOfParametersType>(number), parameterStride, nodeWeights);
+    }
+  }
+
+} // end VisitActiveSupportNodes()
+
+
+/**
+ * ********************* SetParameters ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::SetParameters(const ParametersType & parameters)
+{
+  if (parameters.GetSize() != this->GetNumberOfParameters())
+  {
+    itkExceptionMacro(<< "Mismatch between parameters size " << parameters.GetSize()
+                      << " and the required number of parameters " << this->GetNumberOfParameters());
+  }
+
+  this->m_Parameters = parameters;
+  this->Modified();
+
+} // end SetParameters()
+
+
+/**
+ * ********************* SetFixedParameters ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::SetFixedParameters(const FixedParametersType & parameters)
+{
+  const SizeValueType numberOfGridParameters = SpaceDimension * (3 + SpaceDimension) + 1;
+  if (parameters.GetSize() < numberOfGridParameters)
+  {
+    itkExceptionMacro(<< "The number of fixed parameters is " << parameters.GetSize() << ", but at least "
+                      << numberOfGridParameters << " are required.");
+  }
+
+  /** The base grid: size, origin, spacing and direction, as for the ITK B-spline transforms. */
+  RegionType    gridRegion;
+  SizeType      gridSize;
+  SpacingType   gridSpacing;
+  OriginType    gridOrigin;
+  DirectionType gridDirection;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    gridSize[d] = static_cast<SizeValueType>(parameters[d]);
+    gridOrigin[d] = parameters[SpaceDimension + d];
+    gridSpacing[d] = parameters[2 * SpaceDimension + d];
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      gridDirection(d, j) = parameters[(3 + d) * SpaceDimension + j];
+    }
+  }
+  gridRegion.SetSize(gridSize);
+  this->SetBaseGrid(gridRegion, gridSpacing, gridOrigin, gridDirection);
+
+  /** The active nodes of the finer levels. */
+  SizeValueType      i = numberOfGridParameters - 1;
+  const unsigned int numberOfLevels = static_cast<unsigned int>(parameters[i++]);
+  for (unsigned int level = 1; level < numberOfLevels; ++level)
+  {
+    const SizeValueType numberOfActiveNodes = i < parameters.GetSize() ? static_cast<SizeValueType>(parameters[i]) : 0;
+    if (i + 1 + numberOfActiveNodes > parameters.GetSize())
+    {
+      itkExceptionMacro(<< "The fixed parameters do not contain the active nodes of level " << level << ".");
+    }
+    ++i;
+    NodeContainerType activeNodes(numberOfActiveNodes);
+    for (SizeValueType a = 0; a < numberOfActiveNodes; ++a)
+    {
+      activeNodes[a] = static_cast<SizeValueType>(parameters[i++]);
+    }
+    this->AddLevel(activeNodes);
+  }
+
+} // end SetFixedParameters()
+
+
+/**
+ * ********************* UpdateFixedParameters ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::UpdateFixedParameters(void)
+{
+  std::vector<double> parameters;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    parameters.push_back(static_cast<double>(this->m_GridRegion.GetSize()[d]));
+  }
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    parameters.push_back(this->m_GridOrigin[d]);
+  }
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    parameters.push_back(this->m_GridSpacing[d]);
+  }
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    for (unsigned int j = 0; j < SpaceDimension; ++j)
+    {
+      parameters.push_back(this->m_GridDirection(d, j));
+    }
+  }
+  parameters.push_back(static_cast<double>(this->GetNumberOfLevels()));
+  for (unsigned int level = 1; level < this->GetNumberOfLevels(); ++level)
+  {
+    const NodeContainerType & activeNodes = this->m_Levels[level].m_ActiveNodes;
+    parameters.push_back(static_cast<double>(activeNodes.size()));
+    parameters.insert(parameters.end(), activeNodes.begin(), activeNodes.end());
+  }
+
+  this->m_FixedParameters.SetSize(parameters.size());
+  std::copy(parameters.begin(), parameters.end(), this->m_FixedParameters.begin());
+
+} // end UpdateFixedParameters()
+
+
+/**
+ * ********************* TransformPoint ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+auto
+HierarchicalBSplineTransform<TScalarType, NDimensions>::TransformPoint(const InputPointType & ipp) const
+  -> OutputPointType
+{
+  OutputPointType opp;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    opp[d] = ipp[d];
+  }
+
+  this->template VisitActiveSupportNodes<0>(
+    ipp,
+    [this, &opp](const unsigned int,
+                 const NumberOfParametersType parameter,
+                 const SizeValueType          parameterStride,
+                 const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        opp[d] += nodeWeights.m_Value * this->m_Parameters[parameter + d * parameterStride];
+      }
+    });
+  return opp;
+
+} // end TransformPoint()
+
+
+/**
+ * ********************* GetJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetJacobian(const InputPointType &       ipp,
+                                                                    JacobianType &               j,
+                                                                    NonZeroJacobianIndicesType & nzji) const
+{
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  const NumberOfParametersType entriesPerDimension = nnzji / SpaceDimension;
+  if (j.cols() != nnzji)
+  {
+    j.SetSize(SpaceDimension, nnzji);
+  }
+  j.Fill(0.0);
+  nzji.assign(nnzji, 0);
+
+  this->template VisitActiveSupportNodes<0>(
+    ipp,
+    [&](const unsigned int           entry,
+        const NumberOfParametersType parameter,
+        const SizeValueType          parameterStride,
+        const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const NumberOfParametersType k = d * entriesPerDimension + entry;
+        j(d, k) = nodeWeights.m_Value;
+        nzji[k] = parameter + d * parameterStride;
+      }
+    });
+
+} // end GetJacobian()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProduct ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::EvaluateJacobianWithImageGradientProduct(
+  const InputPointType &          ipp,
+  const MovingImageGradientType & movingImageGradient,
+  DerivativeType &                imageJacobian,
+  NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
+{
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  const NumberOfParametersType entriesPerDimension = nnzji / SpaceDimension;
+  imageJacobian.Fill(0.0);
+  nonZeroJacobianIndices.assign(nnzji, 0);
+
+  this->template VisitActiveSupportNodes<0>(
+    ipp,
+    [&](const unsigned int           entry,
+        const NumberOfParametersType parameter,
+        const SizeValueType          parameterStride,
+        const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const NumberOfParametersType k = d * entriesPerDimension + entry;
+        imageJacobian[k] = nodeWeights.m_Value * movingImageGradient[d];
+        nonZeroJacobianIndices[k] = parameter + d * parameterStride;
+      }
+    });
+
+} // end EvaluateJacobianWithImageGradientProduct()
+
+
+/**
+ * ********************* GetSpatialJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetSpatialJacobian(const InputPointType & ipp,
+                                                                           SpatialJacobianType &  sj) const
+{
+  sj.SetIdentity();
+  this->template VisitActiveSupportNodes<1>(
+    ipp,
+    [this, &sj](const unsigned int,
+                const NumberOfParametersType parameter,
+                const SizeValueType          parameterStride,
+                const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const double coefficient = this->m_Parameters[parameter + d * parameterStride];
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          sj(d, i) += coefficient * nodeWeights.m_Gradient[i];
+        }
+      }
+    });
+
+} // end GetSpatialJacobian()
+
+
+/**
+ * ********************* GetSpatialHessian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetSpatialHessian(const InputPointType & ipp,
+                                                                          SpatialHessianType &   sh) const
+{
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    sh[d].Fill(0.0);
+  }
+  this->template VisitActiveSupportNodes<2>(
+    ipp,
+    [this, &sh](const unsigned int,
+                const NumberOfParametersType parameter,
+                const SizeValueType          parameterStride,
+                const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const double coefficient = this->m_Parameters[parameter + d * parameterStride];
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          for (unsigned int j = 0; j < SpaceDimension; ++j)
+          {
+            sh[d](i, j) += coefficient * nodeWeights.m_Hessian[i][j];
+          }
+        }
+      }
+    });
+
+} // end GetSpatialHessian()
+
+
+/**
+ * ********************* GetJacobianOfSpatialJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetJacobianOfSpatialJacobian(
+  const InputPointType &          ipp,
+  JacobianOfSpatialJacobianType & jsj,
+  NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
+{
+  SpatialJacobianType sj;
+  this->GetJacobianOfSpatialJacobian(ipp, sj, jsj, nonZeroJacobianIndices);
+
+} // end GetJacobianOfSpatialJacobian()
+
+
+/**
+ * ********************* GetJacobianOfSpatialJacobian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetJacobianOfSpatialJacobian(
+  const InputPointType &          ipp,
+  SpatialJacobianType &           sj,
+  JacobianOfSpatialJacobianType & jsj,
+  NonZeroJacobianIndicesType &    nonZeroJacobianIndices) const
+{
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  const NumberOfParametersType entriesPerDimension = nnzji / SpaceDimension;
+  jsj.resize(nnzji);
+  for (SpatialJacobianType & matrix : jsj)
+  {
+    matrix.Fill(0.0);
+  }
+  nonZeroJacobianIndices.assign(nnzji, 0);
+  sj.SetIdentity();
+
+  this->template VisitActiveSupportNodes<1>(
+    ipp,
+    [&](const unsigned int           entry,
+        const NumberOfParametersType parameter,
+        const SizeValueType          parameterStride,
+        const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const NumberOfParametersType k = d * entriesPerDimension + entry;
+        const double                 coefficient = this->m_Parameters[parameter + d * parameterStride];
+        nonZeroJacobianIndices[k] = parameter + d * parameterStride;
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          jsj[k](d, i) = nodeWeights.m_Gradient[i];
+          sj(d, i) += coefficient * nodeWeights.m_Gradient[i];
+        }
+      }
+    });
+
+} // end GetJacobianOfSpatialJacobian()
+
+
+/**
+ * ********************* GetJacobianOfSpatialHessian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHessian(
+  const InputPointType &         ipp,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const
+{
+  SpatialHessianType sh;
+  this->GetJacobianOfSpatialHessian(ipp, sh, jsh, nonZeroJacobianIndices);
+
+} // end GetJacobianOfSpatialHessian()
+
+
+/**
+ * ********************* GetJacobianOfSpatialHessian ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::GetJacobianOfSpatialHessian(
+  const InputPointType &         ipp,
+  SpatialHessianType &           sh,
+  JacobianOfSpatialHessianType & jsh,
+  NonZeroJacobianIndicesType &   nonZeroJacobianIndices) const
+{
+  const NumberOfParametersType nnzji = this->GetNumberOfNonZeroJacobianIndices();
+  const NumberOfParametersType entriesPerDimension = nnzji / SpaceDimension;
+  jsh.resize(nnzji);
+  for (SpatialHessianType & hessian : jsh)
+  {
+    for (unsigned int d = 0; d < SpaceDimension; ++d)
+    {
+      hessian[d].Fill(0.0);
+    }
+  }
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    sh[d].Fill(0.0);
+  }
+  nonZeroJacobianIndices.assign(nnzji, 0);
+
+  this->template VisitActiveSupportNodes<2>(
+    ipp,
+    [&](const unsigned int           entry,
+        const NumberOfParametersType parameter,
+        const SizeValueType          parameterStride,
+        const NodeWeightsType &      nodeWeights) {
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        const NumberOfParametersType k = d * entriesPerDimension + entry;
+        const double                 coefficient = this->m_Parameters[parameter + d * parameterStride];
+        nonZeroJacobianIndices[k] = parameter + d * parameterStride;
+        for (unsigned int i = 0; i < SpaceDimension; ++i)
+        {
+          for (unsigned int j = 0; j < SpaceDimension; ++j)
+          {
+            jsh[k][d](i, j) = nodeWeights.m_Hessian[i][j];
+            sh[d](i, j) += coefficient * nodeWeights.m_Hessian[i][j];
+          }
+        }
+      }
+    });
+
+} // end GetJacobianOfSpatialHessian()
+
+
+/**
+ * ********************* ComputeRefinementCandidates ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::ComputeRefinementCandidates(
+  NodeContainerType & candidates) const
+{
+  const LevelType & finest = this->m_Levels.back();
+  const LevelType   next = this->CreateLevel(this->GetNumberOfLevels());
+
+  unsigned int numberOfNeighbors = 1;
+  for (unsigned int d = 0; d < SpaceDimension; ++d)
+  {
+    numberOfNeighbors *= 3;
+  }
+
+  /** Mark the nodes of the next level around twice the index of an active node. */
+  std::vector<bool> isCandidate(next.m_NumberOfNodes, false);
+  for (const SizeValueType node : finest.m_ActiveNodes)
+  {
+    OffsetValueType center[SpaceDimension];
+    SizeValueType   remainder = node;
+    for (unsigned int d = SpaceDimension; d-- > 0;)
+    {
+      center[d] = 2 * static_cast<OffsetValueType>(remainder / finest.m_OffsetTable[d]);
+      remainder %= finest.m_OffsetTable[d];
+    }
+
+    for (unsigned int n = 0; n < numberOfNeighbors; ++n)
+    {
+      SizeValueType neighbor = 0;
+      bool          inside = true;
+      unsigned int  code = n;
+      for (unsigned int d = 0; d < SpaceDimension && inside; ++d)
+      {
+        const OffsetValueType i = center[d] + static_cast<OffsetValueType>(code % 3) - 1;
+        code /= 3;
+        inside = i >= 0 && i < static_cast<OffsetValueType>(next.m_Size[d]);
+        neighbor += static_cast<SizeValueType>(i) * next.m_OffsetTable[d];
+      }
+      if (inside)
+      {
+        isCandidate[neighbor] = true;
+      }
+    }
+  }
+
+  candidates.clear();
+  for (SizeValueType node = 0; node < next.m_NumberOfNodes; ++node)
+  {
+    if (isCandidate[node])
+    {
+      candidates.push_back(node);
+    }
+  }
+
+} // end ComputeRefinementCandidates()
+
+
+/**
+ * ********************* ComputeRefinementIndicator ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::ComputeRefinementIndicator(
+  const NodeContainerType &             candidates,
+  const std::vector<InputPointType> &   points,
+  const std::vector<OutputVectorType> & forces,
+  std::vector<double> &                 indicator) const
+{
+  if (points.size() != forces.size())
+  {
+    itkExceptionMacro(<< "ERROR: the number of points (" << points.size() << ") and forces (" << forces.size()
+                      << ") differ.");
+  }
+
+  const LevelType  next = this->CreateLevel(this->GetNumberOfLevels());
+  std::vector<int> candidateNumbers(next.m_NumberOfNodes, -1);
+  for (SizeValueType c = 0; c < candidates.size(); ++c)
+  {
+    candidateNumbers[candidates[c]] = static_cast<int>(c);
+  }
+
+  /** Sum the forces, weighted with the B-splines of the candidates. */
+  std::vector<double> sums(candidates.size() * SpaceDimension, 0.0);
+  for (SizeValueType i = 0; i < points.size(); ++i)
+  {
+    SizeValueType firstNode;
+    double        weights[3][SpaceDimension][4];
+    if (!this->ComputeSupport(next, points[i], firstNode, weights))
+    {
+      continue;
+    }
+    for (unsigned int s = 0; s < NumberOfSupportNodes; ++s)
+    {
+      const int number = candidateNumbers[firstNode + next.m_SupportOffsets[s]];
+      if (number < 0)
+      {
+        continue;
+      }
+      double weight = 1.0;
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        weight *= weights[0][d][(s >> (2 * d)) & 3];
+      }
+      for (unsigned int d = 0; d < SpaceDimension; ++d)
+      {
+        sums[number * SpaceDimension + d] += weight * forces[i][d];
+      }
+    }
+  }
+
+  indicator.assign(candidates.size(), 0.0);
+  for (SizeValueType c = 0; c < candidates.size(); ++c)
+  {
+    double squaredMagnitude = 0.0;
+    for (unsigned int d = 0; d < SpaceDimension; ++d)
+    {
+      squaredMagnitude += sums[c * SpaceDimension + d] * sums[c * SpaceDimension + d];
+    }
+    indicator[c] = std::sqrt(squaredMagnitude);
+  }
+
+} // end ComputeRefinementIndicator()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+HierarchicalBSplineTransform<TScalarType, NDimensions>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "GridRegion: " << this->m_GridRegion << std::endl;
+  os << indent << "GridSpacing: " << this->m_GridSpacing << std::endl;
+  os << indent << "GridOrigin: " << this->m_GridOrigin << std::endl;
+  os << indent << "GridDirection: " << this->m_GridDirection << std::endl;
+  os << indent << "NumberOfLevels: " << this->GetNumberOfLevels() << std::endl;
+  for (unsigned int level = 0; level < this->GetNumberOfLevels(); ++level)
+  {
+    os << indent << "NumberOfActiveNodes[" << level << "]: " << this->m_Levels[level].m_ActiveNodes.size()
+       << std::endl;
+  }
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef itkHierarchicalBSplineTransform_hxx
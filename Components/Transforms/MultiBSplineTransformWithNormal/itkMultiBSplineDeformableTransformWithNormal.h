@@ -378,6 +378,14 @@ public:
   OutputPointType
   TransformPoint(const InputPointType & point) const override;
 
+  /** Transform a batch of points. The points are grouped by label, and the B-spline
+   * transforms are called once per group instead of once per point.
+   */
+  void
+  TransformPoints(const InputPointType * inputPoints,
+                  OutputPointType *      outputPoints,
+                  const SizeValueType    numberOfPoints) const override;
+
   /** Compute the Jacobian matrix of the transformation at one point. */
   // virtual const JacobianType & GetJacobian( const InputPointType & point ) const;
 
@@ -522,6 +530,24 @@ private:
 
   void
   PointToLabel(const InputPointType & p, int & l) const;
+
+  /** Cache the geometry and the pixel buffer of the label image, for PointToLabel(). */
+  void
+  UpdateLabelsLookup(void);
+
+  /** The batch methods process the points in chunks of at most this size. */
+  static constexpr unsigned int LabelBatchSize = 64;
+
+  /** The label image lookup, which avoids the interpolator per point. */
+  typedef typename ImageLabelType::DirectionType LabelsPointToIndexType;
+  typedef typename ImageLabelType::PointType     LabelsOriginType;
+  typedef typename ImageLabelType::RegionType    LabelsRegionType;
+
+  const unsigned char *  m_LabelsBuffer{ nullptr };
+  LabelsPointToIndexType m_LabelsPointToIndex;
+  LabelsOriginType       m_LabelsOrigin;
+  LabelsRegionType       m_LabelsBufferedRegion;
+  OffsetValueType        m_LabelsOffsetTable[NDimensions]{};
 };
 
 } // end namespace itk
@@ -29,6 +29,8 @@
 #include "itkMaskImageFilter.h"
 #include "itkConstantPadImageFilter.h"
 
+#include <algorithm> // For stable_sort.
+
 namespace itk
 {
 
@@ -169,12 +171,25 @@ MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder
     }
     this->m_LabelsInterpolator = ImageLabelInterpolator::New();
     this->m_LabelsInterpolator->SetInputImage(this->m_Labels);
+    this->UpdateLabelsLookup();
     // Restore settings
     this->SetFixedParameters(para);
   }
 }
 
 
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder>::UpdateLabelsLookup(void)
+{
+  this->m_LabelsBuffer = this->m_Labels->GetBufferPointer();
+  this->m_LabelsPointToIndex = this->m_Labels->GetPhysicalPointToIndexMatrix();
+  this->m_LabelsOrigin = this->m_Labels->GetOrigin();
+  this->m_LabelsBufferedRegion = this->m_Labels->GetBufferedRegion();
+  std::copy_n(this->m_Labels->GetOffsetTable(), NDimensions, this->m_LabelsOffsetTable);
+}
+
+
 template <class TScalarType, unsigned int NDimensions>
 struct UpdateLocalBases_impl
 {
@@ -638,13 +653,26 @@ MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder
   int &                  l) const
 {
   l = 0;
-  assert(this->m_Labels);
-  typename ImageLabelInterpolator::IndexType idx;
-  this->m_LabelsInterpolator->ConvertPointToNearestIndex(p, idx);
-  if (this->m_LabelsInterpolator->IsInsideBuffer(idx))
+  assert(this->m_LabelsBuffer);
+
+  // Nearest neighbor lookup, as ImageBase::TransformPhysicalPointToIndex() does it
+  OffsetValueType offset = 0;
+  for (unsigned int i = 0; i < NDimensions; ++i)
   {
-    l = static_cast<int>(this->m_LabelsInterpolator->EvaluateAtIndex(idx)) + 1;
+    double cindex = 0.0;
+    for (unsigned int j = 0; j < NDimensions; ++j)
+    {
+      cindex += this->m_LabelsPointToIndex[i][j] * (p[j] - this->m_LabelsOrigin[j]);
+    }
+    const IndexValueType index =
+      Math::RoundHalfIntegerUp<IndexValueType>(cindex) - this->m_LabelsBufferedRegion.GetIndex()[i];
+    if (index < 0 || index >= static_cast<IndexValueType>(this->m_LabelsBufferedRegion.GetSize()[i]))
+    {
+      return;
+    }
+    offset += index * this->m_LabelsOffsetTable[i];
   }
+  l = static_cast<int>(this->m_LabelsBuffer[offset]) + 1;
 }
 
 
@@ -665,6 +693,80 @@ MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder
 }
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template <class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
+void
+MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder>::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType *      outputPoints,
+  const SizeValueType    numberOfPoints) const
+{
+  InputPointType  labelPoints[LabelBatchSize];
+  OutputPointType normalOutputPoints[LabelBatchSize];
+  OutputPointType labelOutputPoints[LabelBatchSize];
+  int             labels[LabelBatchSize];
+  unsigned int    order[LabelBatchSize];
+
+  for (SizeValueType chunkBegin = 0; chunkBegin < numberOfPoints; chunkBegin += LabelBatchSize)
+  {
+    /** Sort the points of the chunk by label, outside the label image (label 0) first. */
+    const unsigned int chunkSize =
+      static_cast<unsigned int>(std::min<SizeValueType>(LabelBatchSize, numberOfPoints - chunkBegin));
+    const InputPointType * chunkInputPoints = inputPoints + chunkBegin;
+    OutputPointType *      chunkOutputPoints = outputPoints + chunkBegin;
+    for (unsigned int i = 0; i < chunkSize; ++i)
+    {
+      this->PointToLabel(chunkInputPoints[i], labels[i]);
+      order[i] = i;
+    }
+    std::stable_sort(order, order + chunkSize, [&labels](const unsigned int a, const unsigned int b) {
+      return labels[a] < labels[b];
+    });
+
+    /** The points outside the label image are not moved. */
+    unsigned int begin = 0;
+    while (begin < chunkSize && labels[order[begin]] == 0)
+    {
+      chunkOutputPoints[order[begin]] = chunkInputPoints[order[begin]];
+      ++begin;
+    }
+
+    /** The normal transform is shared by all labels, so it transforms the remaining points at once.
+     * They are copied first, because the input and output array may be the same.
+     */
+    const unsigned int numberOfLabelPoints = chunkSize - begin;
+    for (unsigned int i = 0; i < numberOfLabelPoints; ++i)
+    {
+      labelPoints[i] = chunkInputPoints[order[begin + i]];
+    }
+    this->m_Trans[0]->TransformPoints(labelPoints, normalOutputPoints, numberOfLabelPoints);
+
+    /** Each label transform transforms its own contiguous block of points. */
+    unsigned int blockBegin = 0;
+    while (blockBegin < numberOfLabelPoints)
+    {
+      const int    lidx = labels[order[begin + blockBegin]];
+      unsigned int n = 1;
+      while (blockBegin + n < numberOfLabelPoints && labels[order[begin + blockBegin + n]] == lidx)
+      {
+        ++n;
+      }
+      this->m_Trans[lidx]->TransformPoints(labelPoints + blockBegin, labelOutputPoints + blockBegin, n);
+      blockBegin += n;
+    }
+
+    for (unsigned int i = 0; i < numberOfLabelPoints; ++i)
+    {
+      chunkOutputPoints[order[begin + i]] = normalOutputPoints[i] + (labelOutputPoints[i] - labelPoints[i]);
+    }
+  }
+
+} // end TransformPoints()
+
+
 // template<class TScalarType, unsigned int NDimensions, unsigned int VSplineOrder>
 // const typename MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder>::JacobianType&
 // MultiBSplineDeformableTransformWithNormal<TScalarType, NDimensions, VSplineOrder>
@@ -91,6 +91,12 @@ RecursiveBSplineTransform<TElastix>::InitializeBSplineTransform(void)
   }
 
   this->SetCurrentTransform(this->m_BSplineTransform);
+
+  /** Tabulate the B-spline weights of grid aligned points, if requested. */
+  unsigned int gridAlignedWeightsTableSize = 0;
+  this->GetConfiguration()->ReadParameter(
+    gridAlignedWeightsTableSize, "GridAlignedWeightsTableSize", this->GetComponentLabel(), 0, 0, false);
+  this->m_BSplineTransform->SetGridAlignedWeightsTableSize(gridAlignedWeightsTableSize);
   this->m_GridUpsampler = GridUpsamplerType::New();
   this->m_GridUpsampler->SetBSplineOrder(this->m_SplineOrder);
 
@@ -201,9 +207,29 @@ RecursiveBSplineTransform<TElastix>::BeforeEachResolution(void)
     passiveEdgeWidth, "PassiveEdgeWidth", this->GetComponentLabel(), level, 0, false);
   this->SetOptimizerScales(passiveEdgeWidth);
 
+  /** Check if the coefficients should be read in single precision. */
+  bool useSinglePrecisionCoefficients = false;
+  this->GetConfiguration()->ReadParameter(
+    useSinglePrecisionCoefficients, "UseSinglePrecisionCoefficients", this->GetComponentLabel(), level, 0, false);
+  this->m_BSplineTransform->SetUseSinglePrecisionCoefficients(useSinglePrecisionCoefficients);
+
 } // end BeforeEachResolution()
 
 
+/**
+ * ***************** AfterEachResolution ***********************
+ */
+
+template <class TElastix>
+void
+RecursiveBSplineTransform<TElastix>::AfterEachResolution(void)
+{
+  /** The transform that is written and used for resampling is evaluated in double precision. */
+  this->m_BSplineTransform->SetUseSinglePrecisionCoefficients(false);
+
+} // end AfterEachResolution()
+
+
 /**
  * ******************** PreComputeGridInformation ***********************
  */
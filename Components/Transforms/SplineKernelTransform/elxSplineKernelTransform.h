@@ -70,6 +70,22 @@ namespace elastix
  * Default: 0.3. You cannot specify this parameter for each resolution differently.\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \parameter TPSMatrixInversionMethod: The decomposition of the L matrix, one of { SVD, QR }.\n
+ *   example: <tt>(TPSMatrixInversionMethod "QR")</tt>\n
+ * Default: SVD.
+ * \parameter TPSUseFarFieldApproximation: Approximate the contribution of far away
+ * groups of landmarks in TransformPoint(), using a tree of the fixed image landmarks.
+ * Only worthwhile for thousands of landmarks.\n
+ *   example: <tt>(TPSUseFarFieldApproximation "true")</tt>\n
+ * Default: false.
+ * \parameter TPSFarFieldOpeningAngle: A group of landmarks is approximated when its
+ * radius is smaller than this factor times its distance. Smaller is more accurate.\n
+ *   example: <tt>(TPSFarFieldOpeningAngle 0.3)</tt>\n
+ * Default: 0.5.
+ * \parameter TPSFarFieldInterpolationOrder: The number of interpolation points per
+ * dimension of the approximation. Larger is more accurate.\n
+ *   example: <tt>(TPSFarFieldInterpolationOrder 6)</tt>\n
+ * Default: 5.
  *
  * \commandlinearg -fp: a file specifying a set of points that will serve
  * as fixed image landmarks.\n
@@ -104,6 +120,26 @@ namespace elastix
  *   example: <tt>(SplinePoissonRatio 0.3 )</tt>\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \transformparameter TPSMatrixInversionMethod: The decomposition of the L matrix, one
+ * of { SVD, QR, Iterative }. The iterative solver does not form the L matrix, and
+ * is therefore much faster and smaller for many landmarks. It cannot be used during
+ * registration, since the Jacobian needs the inverse of L.\n
+ *   example: <tt>(TPSMatrixInversionMethod "Iterative")</tt>\n
+ * Default: SVD.
+ * \transformparameter TPSIterativeSolverMaximumNumberOfIterations: The maximum number
+ * of iterations of the iterative solver.\n
+ *   example: <tt>(TPSIterativeSolverMaximumNumberOfIterations 2000)</tt>\n
+ * Default: 1000.
+ * \transformparameter TPSIterativeSolverTolerance: The relative residual at which the
+ * iterative solver stops.\n
+ *   example: <tt>(TPSIterativeSolverTolerance 1e-6)</tt>\n
+ * Default: 1e-8.
+ * \transformparameter TPSUseFarFieldApproximation: See the parameter above. When used
+ * with the iterative solver, the products with the L matrix are approximated as well.\n
+ *   example: <tt>(TPSUseFarFieldApproximation "true")</tt>\n
+ * Default: false.
+ * \transformparameter TPSFarFieldOpeningAngle: See the parameter above. Default: 0.5.
+ * \transformparameter TPSFarFieldInterpolationOrder: See the parameter above. Default: 5.
  * \transformparameter FixedImageLandmarks: The landmark positions in the
  * fixed image, in world coordinates. Positions written as x1 y1 [z1] x2 y2 [z2] etc.\n
  *   example: <tt>(FixedImageLandmarks 10.0 11.0 12.0 4.0 4.0 4.0 6.0 6.0 6.0 )</tt>
@@ -243,6 +279,10 @@ protected:
                    PointSetPointer &   landmarkPointSet,
                    const bool &        landmarksInFixedImage);
 
+  /** Read the settings of the far field approximation. */
+  void
+  ReadFarFieldApproximationParameters(void);
+
   /** The itk kernel transform. */
   KernelTransformPointer m_KernelTransform;
 
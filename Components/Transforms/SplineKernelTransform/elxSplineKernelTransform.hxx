@@ -188,6 +188,9 @@ SplineKernelTransform<TElastix>::BeforeRegistration(void)
   this->GetConfiguration()->ReadParameter(matrixInversionMethod, "TPSMatrixInversionMethod", 0, true);
   this->m_KernelTransform->SetMatrixInversionMethod(matrixInversionMethod);
 
+  /** Set the far field approximation. */
+  this->ReadFarFieldApproximationParameters();
+
   /** Load fixed image (source) landmark positions. */
   this->DetermineSourceLandmarks();
 
@@ -404,6 +407,23 @@ SplineKernelTransform<TElastix>::ReadFromFile(void)
   this->GetConfiguration()->ReadParameter(poissonRatio, "SplinePoissonRatio", this->GetComponentLabel(), 0, -1);
   this->m_KernelTransform->SetPoissonRatio(poissonRatio);
 
+  /** Set the matrix inversion method (one of {SVD, QR, Iterative}). */
+  std::string matrixInversionMethod = "SVD";
+  this->GetConfiguration()->ReadParameter(matrixInversionMethod, "TPSMatrixInversionMethod", 0, true);
+  this->m_KernelTransform->SetMatrixInversionMethod(matrixInversionMethod);
+
+  /** Settings of the iterative solver. */
+  unsigned int maximumNumberOfIterations = 1000;
+  this->GetConfiguration()->ReadParameter(
+    maximumNumberOfIterations, "TPSIterativeSolverMaximumNumberOfIterations", 0, true);
+  this->m_KernelTransform->SetMaximumNumberOfIterations(maximumNumberOfIterations);
+  double tolerance = 1e-8;
+  this->GetConfiguration()->ReadParameter(tolerance, "TPSIterativeSolverTolerance", 0, true);
+  this->m_KernelTransform->SetIterativeSolverTolerance(tolerance);
+
+  /** Set the far field approximation. */
+  this->ReadFarFieldApproximationParameters();
+
   /** Read number of parameters. */
   unsigned int numberOfParameters = 0;
   this->GetConfiguration()->ReadParameter(numberOfParameters, "NumberOfParameters", 0);
@@ -437,6 +457,29 @@ SplineKernelTransform<TElastix>::ReadFromFile(void)
 } // ReadFromFile()
 
 
+/**
+ * ************************* ReadFarFieldApproximationParameters ************************
+ */
+
+template <class TElastix>
+void
+SplineKernelTransform<TElastix>::ReadFarFieldApproximationParameters(void)
+{
+  bool useFarFieldApproximation = false;
+  this->GetConfiguration()->ReadParameter(useFarFieldApproximation, "TPSUseFarFieldApproximation", 0, true);
+  this->m_KernelTransform->SetUseFarFieldApproximation(useFarFieldApproximation);
+
+  double openingAngle = 0.5;
+  this->GetConfiguration()->ReadParameter(openingAngle, "TPSFarFieldOpeningAngle", 0, true);
+  this->m_KernelTransform->SetFarFieldOpeningAngle(openingAngle);
+
+  unsigned int interpolationOrder = 5;
+  this->GetConfiguration()->ReadParameter(interpolationOrder, "TPSFarFieldInterpolationOrder", 0, true);
+  this->m_KernelTransform->SetFarFieldInterpolationOrder(interpolationOrder);
+
+} // end ReadFarFieldApproximationParameters()
+
+
 /**
  * ************************* CustomizeTransformParametersMap ************************
  */
@@ -40,6 +40,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include "itkMatrix.h"
 #include "itkPointSet.h"
 #include <deque>
+#include <vector>
 #include <math.h>
 #include "vnl/vnl_matrix_fixed.h"
 #include "vnl/vnl_matrix.h"
@@ -86,6 +87,7 @@ namespace itk
  * - Support for matrix inversion by QR decomposition, instead of SVD.
  *   QR is much faster. Used in SetParameters() and SetFixedParameters().
  * - Much faster Jacobian computation for some of the derived kernel transforms.
+ * - An iterative solver and a far field approximation for many landmarks.
  *
  * \ingroup Transforms
  *
@@ -302,10 +304,42 @@ public:
   }
 
 
-  /** Matrix inversion by SVD or QR decomposition. */
+  /** Matrix inversion by SVD or QR decomposition, or "Iterative". The
+   * iterative method solves for the W matrix with MINRES, without forming
+   * the L matrix, and is meant for applying a transform with many landmarks.
+   * It does not compute the inverse of L, so GetJacobian() is not available.
+   */
   itkSetMacro(MatrixInversionMethod, std::string);
   itkGetConstReferenceMacro(MatrixInversionMethod, std::string);
 
+  /** The maximum number of iterations of the iterative solver. */
+  itkSetMacro(MaximumNumberOfIterations, unsigned int);
+  itkGetConstMacro(MaximumNumberOfIterations, unsigned int);
+
+  /** The relative residual at which the iterative solver stops. */
+  itkSetMacro(IterativeSolverTolerance, double);
+  itkGetConstMacro(IterativeSolverTolerance, double);
+
+  /** Approximate the contribution of far away groups of landmarks, both in
+   * TransformPoint() and in the products of the iterative solver. The
+   * landmarks are organised in a k-d tree, and the kernel of a group of
+   * landmarks is interpolated on a tensor grid of Chebyshev points in its
+   * bounding box. A group is approximated when its radius is smaller than
+   * the opening angle times its distance to the point. Set before the
+   * landmarks, since the tree is built with the W matrix.
+   */
+  itkSetMacro(UseFarFieldApproximation, bool);
+  itkGetConstMacro(UseFarFieldApproximation, bool);
+  itkBooleanMacro(UseFarFieldApproximation);
+
+  /** The opening angle of the far field approximation, default 0.5. */
+  itkSetMacro(FarFieldOpeningAngle, double);
+  itkGetConstMacro(FarFieldOpeningAngle, double);
+
+  /** The number of interpolation points per dimension, default 5. */
+  itkSetMacro(FarFieldInterpolationOrder, unsigned int);
+  itkGetConstMacro(FarFieldInterpolationOrder, unsigned int);
+
   /** Must be provided. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override
@@ -459,6 +493,41 @@ protected:
   void
   ReorganizeW(void);
 
+  /** Solve L W = Y with MINRES, without forming L. */
+  void
+  ComputeWMatrixIteratively(void);
+
+  /** Compute y = L x for the iterative solver. */
+  void
+  MultiplyByLMatrix(const vnl_vector<TScalarType> & x, vnl_vector<TScalarType> & y);
+
+  /** Build the k-d tree of the source landmarks. */
+  void
+  ComputeFarFieldTree(void);
+
+  /** Compute the coefficients of the interpolation points of every node
+   * of the tree, for kernel coefficients organised like the D matrix.
+   */
+  void
+  ComputeFarFieldCoefficients(const DMatrixType & coefficients);
+
+  /** Add the contribution of the landmarks to the result, like
+   * ComputeDeformationContribution(), but traversing the tree. The landmark
+   * with index skippedLandmark is left out.
+   */
+  void
+  ComputeFarFieldContribution(const InputPointType & point,
+                              const DMatrixType &    coefficients,
+                              const unsigned long    skippedLandmark,
+                              OutputPointType &      result) const;
+
+  /** Compute the Lagrange polynomials of the interpolation points in [lower, upper] at x. */
+  void
+  ComputeLagrangeWeights(const ScalarType x,
+                         const ScalarType lower,
+                         const ScalarType upper,
+                         ScalarType *     weights) const;
+
   /** Stiffness parameter. */
   double m_Stiffness;
 
@@ -540,6 +609,35 @@ protected:
    */
   bool m_FastComputationPossible;
 
+  /** A node of the k-d tree of the far field approximation. The landmarks
+   * of a node are [m_Begin, m_End) in the tree order. The interpolation
+   * coefficients are only stored for nodes with more landmarks than
+   * interpolation points.
+   */
+  struct FarFieldNodeType
+  {
+    InputPointType          m_LowerBound;
+    InputPointType          m_UpperBound;
+    InputPointType          m_Center;
+    ScalarType              m_Radius;
+    unsigned long           m_Begin;
+    unsigned long           m_End;
+    unsigned long           m_FirstChild; // zero for a leaf
+    std::vector<ScalarType> m_Coefficients;
+  };
+
+  /** The tree, its landmarks in tree order and their original indices. */
+  std::vector<FarFieldNodeType> m_FarFieldTree;
+  std::vector<InputPointType>   m_FarFieldLandmarks;
+  std::vector<unsigned long>    m_FarFieldLandmarkIndices;
+
+  /** The Chebyshev points in [-1, 1] and their barycentric weights. */
+  std::vector<ScalarType> m_FarFieldInterpolationPoints;
+  std::vector<ScalarType> m_FarFieldBarycentricWeights;
+
+  bool m_FarFieldTreeComputed;
+  bool m_FarFieldCoefficientsComputed;
+
 private:
   KernelTransform2(const Self &) = delete;
   void
@@ -547,8 +645,14 @@ private:
 
   TScalarType m_PoissonRatio;
 
-  /** Using SVD or QR decomposition. */
+  /** Using SVD or QR decomposition, or the iterative solver. */
   std::string m_MatrixInversionMethod;
+
+  unsigned int m_MaximumNumberOfIterations;
+  double       m_IterativeSolverTolerance;
+  bool         m_UseFarFieldApproximation;
+  double       m_FarFieldOpeningAngle;
+  unsigned int m_FarFieldInterpolationOrder;
 };
 
 } // end namespace itk
@@ -35,6 +35,11 @@ PURPOSE.  See the above copyright notices for more information.
 #define _itkKernelTransform2_hxx
 
 #include "itkKernelTransform2.h"
+#include "itkParallelTasks.h"
+#include "vnl/vnl_math.h"
+
+#include <algorithm> // For nth_element.
+#include <cmath>     // For cos.
 
 namespace itk
 {
@@ -71,6 +76,14 @@ KernelTransform2<TScalarType, NDimensions>::KernelTransform2()
   this->m_MatrixInversionMethod = "SVD";
   this->m_FastComputationPossible = false;
 
+  this->m_MaximumNumberOfIterations = 1000;
+  this->m_IterativeSolverTolerance = 1e-8;
+  this->m_UseFarFieldApproximation = false;
+  this->m_FarFieldOpeningAngle = 0.5;
+  this->m_FarFieldInterpolationOrder = 5;
+  this->m_FarFieldTreeComputed = false;
+  this->m_FarFieldCoefficientsComputed = false;
+
   this->m_HasNonZeroSpatialHessian = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
 
@@ -110,9 +123,15 @@ KernelTransform2<TScalarType, NDimensions>::SetSourceLandmarks(PointSetType * la
     this->m_LMatrixComputed = false;
     this->m_LInverseComputed = false;
     this->m_LMatrixDecompositionComputed = false;
+    this->m_FarFieldTreeComputed = false;
+    this->m_FarFieldCoefficientsComputed = false;
 
     // you must recompute L and Linv - this does not require the targ landmarks
-    this->ComputeLInverse();
+    // The iterative solver does not need them.
+    if (this->m_MatrixInversionMethod != "Iterative")
+    {
+      this->ComputeLInverse();
+    }
 
     // Precompute the nonzerojacobianindices vector
     const NumberOfParametersType nrParams = this->GetNumberOfParameters();
@@ -243,15 +262,20 @@ template <class TScalarType, unsigned int NDimensions>
 void
 KernelTransform2<TScalarType, NDimensions>::ComputeWMatrix(void)
 {
-  /** Compute L and Y. */
-  if (!this->m_LMatrixComputed)
+  /** Compute L and Y. The iterative solver does not need L. */
+  const bool iterative = this->m_MatrixInversionMethod == "Iterative";
+  if (!this->m_LMatrixComputed && !iterative)
   {
     this->ComputeL();
   }
   this->ComputeY();
 
   /** L matrix decomposition and solving for Y matrix. */
-  if (this->m_MatrixInversionMethod == "SVD")
+  if (iterative)
+  {
+    this->ComputeWMatrixIteratively();
+  }
+  else if (this->m_MatrixInversionMethod == "SVD")
   {
     if (!this->m_LMatrixDecompositionComputed)
     {
@@ -290,9 +314,499 @@ KernelTransform2<TScalarType, NDimensions>::ComputeWMatrix(void)
   this->ReorganizeW();
   this->m_WMatrixComputed = true;
 
+  /** Prepare the far field approximation of TransformPoint(). */
+  this->m_FarFieldCoefficientsComputed = false;
+  if (this->m_UseFarFieldApproximation)
+  {
+    if (!this->m_FarFieldTreeComputed)
+    {
+      this->ComputeFarFieldTree();
+    }
+    this->ComputeFarFieldCoefficients(this->m_DMatrix);
+  }
+
 } // end ComputeWMatrix()
 
 
+/**
+ * ******************* ComputeWMatrixIteratively *******************
+ *
+ * L is symmetric but indefinite, so the MINRES method of Paige and
+ * Saunders is used. Every iteration needs a single product with L.
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::ComputeWMatrixIteratively(void)
+{
+  typedef vnl_vector<TScalarType> VectorType;
+
+  if (!this->m_FarFieldTreeComputed)
+  {
+    this->ComputeFarFieldTree();
+  }
+
+  const VectorType    b = this->m_YMatrix.get_column(0);
+  const unsigned long n = b.size();
+  VectorType          x(n, 0.0);
+
+  const ScalarType beta1 = b.two_norm();
+  if (beta1 == 0.0)
+  {
+    this->m_WMatrix.set_size(n, 1);
+    this->m_WMatrix.set_column(0, x);
+    return;
+  }
+
+  VectorType r1 = b;
+  VectorType r2 = b;
+  VectorType y = b;
+  VectorType v(n);
+  VectorType w(n, 0.0);
+  VectorType w1(n);
+  VectorType w2(n, 0.0);
+
+  ScalarType   oldb = 0.0;
+  ScalarType   beta = beta1;
+  ScalarType   dbar = 0.0;
+  ScalarType   epsln = 0.0;
+  ScalarType   phibar = beta1;
+  ScalarType   cs = -1.0;
+  ScalarType   sn = 0.0;
+  unsigned int iteration = 0;
+
+  while (iteration < this->m_MaximumNumberOfIterations && phibar > this->m_IterativeSolverTolerance * beta1)
+  {
+    /** Lanczos step. */
+    v = y / beta;
+    this->MultiplyByLMatrix(v, y);
+    if (iteration > 0)
+    {
+      y -= (beta / oldb) * r1;
+    }
+    const ScalarType alpha = dot_product(v, y);
+    y -= (alpha / beta) * r2;
+    r1 = r2;
+    r2 = y;
+    oldb = beta;
+    beta = r2.two_norm();
+
+    /** Apply the previous rotation, and compute the next one. */
+    const ScalarType oldeps = epsln;
+    const ScalarType delta = cs * dbar + sn * alpha;
+    const ScalarType gbar = sn * dbar - cs * alpha;
+    epsln = sn * beta;
+    dbar = -cs * beta;
+    const ScalarType gamma =
+      std::max<ScalarType>(std::sqrt(gbar * gbar + beta * beta), NumericTraits<ScalarType>::min());
+    cs = gbar / gamma;
+    sn = beta / gamma;
+    const ScalarType phi = cs * phibar;
+    phibar *= sn;
+
+    /** Update the solution. */
+    w1 = w2;
+    w2 = w;
+    w = (v - oldeps * w1 - delta * w2) / gamma;
+    x += phi * w;
+    ++iteration;
+  }
+
+  if (phibar > this->m_IterativeSolverTolerance * beta1)
+  {
+    itkWarningMacro(<< "The iterative solver did not converge in " << iteration
+                    << " iterations; the relative residual is " << phibar / beta1 << ".");
+  }
+
+  this->m_WMatrix.set_size(n, 1);
+  this->m_WMatrix.set_column(0, x);
+
+} // end ComputeWMatrixIteratively()
+
+
+/**
+ * ******************* MultiplyByLMatrix *******************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::MultiplyByLMatrix(const vnl_vector<TScalarType> & x,
+                                                              vnl_vector<TScalarType> &       y)
+{
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+  const unsigned long affineOffset = numberOfLandmarks * NDimensions;
+
+  /** Organise the kernel part of x like the D matrix. */
+  DMatrixType coefficients(NDimensions, numberOfLandmarks);
+  for (unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd)
+  {
+    for (unsigned int dim = 0; dim < NDimensions; ++dim)
+    {
+      coefficients(dim, lnd) = x[lnd * NDimensions + dim];
+    }
+  }
+  if (this->m_UseFarFieldApproximation)
+  {
+    this->ComputeFarFieldCoefficients(coefficients);
+  }
+
+  /** The reflexive G matrices. */
+  std::vector<GMatrixType> reflexiveG(numberOfLandmarks);
+  PointsIterator           sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for (unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd, ++sp)
+  {
+    this->ComputeReflexiveG(sp, reflexiveG[lnd]);
+  }
+
+  /** The rows of K and P, which are independent for every landmark. */
+  y.set_size(x.size());
+  const PointsContainer * const points = this->m_SourceLandmarks->GetPoints();
+  ParallelTasks::ParallelizeArray(
+    0,
+    numberOfLandmarks,
+    [&](const SizeValueType lnd) {
+      const InputPointType & p = points->ElementAt(lnd);
+      OutputPointType        result;
+      result.Fill(NumericTraits<ScalarType>::ZeroValue());
+      this->ComputeFarFieldContribution(p, coefficients, lnd, result);
+
+      for (unsigned int odim = 0; odim < NDimensions; ++odim)
+      {
+        ScalarType value = result[odim] + x[affineOffset + NDimensions * NDimensions + odim];
+        for (unsigned int dim = 0; dim < NDimensions; ++dim)
+        {
+          value += reflexiveG[lnd](odim, dim) * coefficients(dim, lnd);
+          value += p[dim] * x[affineOffset + dim * NDimensions + odim];
+        }
+        y[lnd * NDimensions + odim] = value;
+      }
+    });
+
+  /** The rows of P transposed. */
+  for (unsigned int i = 0; i < NDimensions * (NDimensions + 1); ++i)
+  {
+    y[affineOffset + i] = 0.0;
+  }
+  for (unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd)
+  {
+    const InputPointType & p = points->ElementAt(lnd);
+    for (unsigned int odim = 0; odim < NDimensions; ++odim)
+    {
+      const ScalarType c = coefficients(odim, lnd);
+      for (unsigned int dim = 0; dim < NDimensions; ++dim)
+      {
+        y[affineOffset + dim * NDimensions + odim] += p[dim] * c;
+      }
+      y[affineOffset + NDimensions * NDimensions + odim] += c;
+    }
+  }
+
+} // end MultiplyByLMatrix()
+
+
+/**
+ * ******************* ComputeFarFieldTree *******************
+ *
+ * The nodes are split at the median of their longest side. The children
+ * are stored after their parent, so that the nodes can be processed
+ * bottom up by a reverse loop.
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::ComputeFarFieldTree(void)
+{
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+  const unsigned long maximumLeafSize = 64;
+
+  std::vector<InputPointType> landmarks(numberOfLandmarks);
+  PointsIterator              sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for (unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd, ++sp)
+  {
+    landmarks[lnd] = sp->Value();
+  }
+
+  std::vector<unsigned long> & indices = this->m_FarFieldLandmarkIndices;
+  indices.resize(numberOfLandmarks);
+  for (unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd)
+  {
+    indices[lnd] = lnd;
+  }
+
+  this->m_FarFieldTree.assign(1, FarFieldNodeType());
+  this->m_FarFieldTree[0].m_Begin = 0;
+  this->m_FarFieldTree[0].m_End = numberOfLandmarks;
+
+  std::vector<unsigned long> nodesToSplit(1, 0);
+  while (!nodesToSplit.empty())
+  {
+    const unsigned long nodeIndex = nodesToSplit.back();
+    nodesToSplit.pop_back();
+    FarFieldNodeType & node = this->m_FarFieldTree[nodeIndex];
+
+    /** Compute the bounding box. */
+    node.m_LowerBound.Fill(NumericTraits<ScalarType>::max());
+    node.m_UpperBound.Fill(NumericTraits<ScalarType>::NonpositiveMin());
+    for (unsigned long i = node.m_Begin; i < node.m_End; ++i)
+    {
+      const InputPointType & p = landmarks[indices[i]];
+      for (unsigned int dim = 0; dim < NDimensions; ++dim)
+      {
+        node.m_LowerBound[dim] = std::min(node.m_LowerBound[dim], p[dim]);
+        node.m_UpperBound[dim] = std::max(node.m_UpperBound[dim], p[dim]);
+      }
+    }
+    ScalarType   squaredRadius = 0.0;
+    unsigned int longestSide = 0;
+    for (unsigned int dim = 0; dim < NDimensions; ++dim)
+    {
+      const ScalarType side = node.m_UpperBound[dim] - node.m_LowerBound[dim];
+      node.m_Center[dim] = 0.5 * (node.m_LowerBound[dim] + node.m_UpperBound[dim]);
+      squaredRadius += 0.25 * side * side;
+      if (side > node.m_UpperBound[longestSide] - node.m_LowerBound[longestSide])
+      {
+        longestSide = dim;
+      }
+    }
+    node.m_Radius = std::sqrt(squaredRadius);
+    node.m_FirstChild = 0;
+
+    /** Split the node. */
+    const unsigned long begin = node.m_Begin;
+    const unsigned long end = node.m_End;
+    if (end - begin > maximumLeafSize)
+    {
+      const unsigned long middle = begin + (end - begin) / 2;
+      std::nth_element(indices.begin() + begin,
+                       indices.begin() + middle,
+                       indices.begin() + end,
+                       [&landmarks, longestSide](const unsigned long a, const unsigned long b) {
+                         return landmarks[a][longestSide] < landmarks[b][longestSide];
+                       });
+
+      const unsigned long firstChild = this->m_FarFieldTree.size();
+      node.m_FirstChild = firstChild;
+      this->m_FarFieldTree.resize(firstChild + 2); // invalidates node
+      this->m_FarFieldTree[firstChild].m_Begin = begin;
+      this->m_FarFieldTree[firstChild].m_End = middle;
+      this->m_FarFieldTree[firstChild + 1].m_Begin = middle;
+      this->m_FarFieldTree[firstChild + 1].m_End = end;
+      nodesToSplit.push_back(firstChild);
+      nodesToSplit.push_back(firstChild + 1);
+    }
+  }
+
+  /** Store the landmarks in tree order. */
+  this->m_FarFieldLandmarks.resize(numberOfLandmarks);
+  for (unsigned long i = 0; i < numberOfLandmarks; ++i)
+  {
+    this->m_FarFieldLandmarks[i] = landmarks[indices[i]];
+  }
+
+  this->m_FarFieldTreeComputed = true;
+  this->m_FarFieldCoefficientsComputed = false;
+
+} // end ComputeFarFieldTree()
+
+
+/**
+ * ******************* ComputeFarFieldCoefficients *******************
+ *
+ * The kernel is interpolated in the landmark position, so the coefficient
+ * of an interpolation point is the sum of the coefficients of the landmarks,
+ * weighted by its Lagrange polynomial.
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::ComputeFarFieldCoefficients(const DMatrixType & coefficients)
+{
+  /** The Chebyshev points of the second kind and their barycentric weights. */
+  const unsigned int order = std::max(this->m_FarFieldInterpolationOrder, 2u);
+  this->m_FarFieldInterpolationPoints.resize(order);
+  this->m_FarFieldBarycentricWeights.resize(order);
+  for (unsigned int k = 0; k < order; ++k)
+  {
+    this->m_FarFieldInterpolationPoints[k] = std::cos(vnl_math::pi * k / (order - 1));
+    this->m_FarFieldBarycentricWeights[k] = ((k % 2) ? -1.0 : 1.0) * ((k == 0 || k == order - 1) ? 0.5 : 1.0);
+  }
+  unsigned long numberOfInterpolationPoints = 1;
+  for (unsigned int dim = 0; dim < NDimensions; ++dim)
+  {
+    numberOfInterpolationPoints *= order;
+  }
+
+  ParallelTasks::ParallelizeArray(
+    0,
+    this->m_FarFieldTree.size(),
+    [&](const SizeValueType nodeIndex) {
+      FarFieldNodeType & node = this->m_FarFieldTree[nodeIndex];
+      if (node.m_End - node.m_Begin <= numberOfInterpolationPoints)
+      {
+        node.m_Coefficients.clear();
+        return;
+      }
+      node.m_Coefficients.assign(numberOfInterpolationPoints * NDimensions, 0.0);
+
+      std::vector<ScalarType> weights(NDimensions * order);
+      for (unsigned long i = node.m_Begin; i < node.m_End; ++i)
+      {
+        const InputPointType & p = this->m_FarFieldLandmarks[i];
+        const unsigned long    lnd = this->m_FarFieldLandmarkIndices[i];
+        for (unsigned int dim = 0; dim < NDimensions; ++dim)
+        {
+          this->ComputeLagrangeWeights(
+            p[dim], node.m_LowerBound[dim], node.m_UpperBound[dim], &weights[dim * order]);
+        }
+
+        for (unsigned long q = 0; q < numberOfInterpolationPoints; ++q)
+        {
+          ScalarType    weight = 1.0;
+          unsigned long rest = q;
+          for (unsigned int dim = 0; dim < NDimensions; ++dim)
+          {
+            weight *= weights[dim * order + rest % order];
+            rest /= order;
+          }
+          if (weight != 0.0)
+          {
+            for (unsigned int dim = 0; dim < NDimensions; ++dim)
+            {
+              node.m_Coefficients[q * NDimensions + dim] += weight * coefficients(dim, lnd);
+            }
+          }
+        }
+      }
+    });
+
+  this->m_FarFieldCoefficientsComputed = true;
+
+} // end ComputeFarFieldCoefficients()
+
+
+/**
+ * ******************* ComputeLagrangeWeights *******************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::ComputeLagrangeWeights(const ScalarType x,
+                                                                   const ScalarType lower,
+                                                                   const ScalarType upper,
+                                                                   ScalarType *     weights) const
+{
+  const unsigned int order = this->m_FarFieldInterpolationPoints.size();
+
+  /** A flat side: all interpolation points coincide with the first. */
+  if (upper <= lower)
+  {
+    std::fill(weights, weights + order, 0.0);
+    weights[0] = 1.0;
+    return;
+  }
+
+  const ScalarType t = 2.0 * (x - lower) / (upper - lower) - 1.0;
+  ScalarType       sum = 0.0;
+  for (unsigned int k = 0; k < order; ++k)
+  {
+    const ScalarType difference = t - this->m_FarFieldInterpolationPoints[k];
+    if (difference == 0.0)
+    {
+      std::fill(weights, weights + order, 0.0);
+      weights[k] = 1.0;
+      return;
+    }
+    weights[k] = this->m_FarFieldBarycentricWeights[k] / difference;
+    sum += weights[k];
+  }
+  for (unsigned int k = 0; k < order; ++k)
+  {
+    weights[k] /= sum;
+  }
+
+} // end ComputeLagrangeWeights()
+
+
+/**
+ * ******************* ComputeFarFieldContribution *******************
+ */
+
+template <class TScalarType, unsigned int NDimensions>
+void
+KernelTransform2<TScalarType, NDimensions>::ComputeFarFieldContribution(const InputPointType & point,
+                                                                        const DMatrixType &    coefficients,
+                                                                        const unsigned long    skippedLandmark,
+                                                                        OutputPointType &      result) const
+{
+  const unsigned int order = this->m_FarFieldInterpolationPoints.size();
+  const ScalarType   openingAngle = this->m_UseFarFieldApproximation ? this->m_FarFieldOpeningAngle : 0.0;
+  GMatrixType        Gmatrix;
+
+  /** The depth of the tree is limited by the median splits. */
+  unsigned long stack[2 * 64];
+  unsigned int  stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while (stackSize > 0)
+  {
+    const FarFieldNodeType & node = this->m_FarFieldTree[stack[--stackSize]];
+    const ScalarType         distance = (point - node.m_Center).GetNorm();
+
+    if (!node.m_Coefficients.empty() && node.m_Radius < openingAngle * distance)
+    {
+      /** Far away: use the interpolation points. */
+      const unsigned long numberOfInterpolationPoints = node.m_Coefficients.size() / NDimensions;
+      for (unsigned long q = 0; q < numberOfInterpolationPoints; ++q)
+      {
+        InputPointType interpolationPoint;
+        unsigned long  rest = q;
+        for (unsigned int dim = 0; dim < NDimensions; ++dim)
+        {
+          const ScalarType t = this->m_FarFieldInterpolationPoints[rest % order];
+          interpolationPoint[dim] =
+            node.m_LowerBound[dim] + 0.5 * (t + 1.0) * (node.m_UpperBound[dim] - node.m_LowerBound[dim]);
+          rest /= order;
+        }
+        this->ComputeG(point - interpolationPoint, Gmatrix);
+        for (unsigned int dim = 0; dim < NDimensions; ++dim)
+        {
+          for (unsigned int odim = 0; odim < NDimensions; ++odim)
+          {
+            result[odim] += Gmatrix(dim, odim) * node.m_Coefficients[q * NDimensions + dim];
+          }
+        }
+      }
+    }
+    else if (node.m_FirstChild == 0 || node.m_Coefficients.empty())
+    {
+      /** Nearby, or too few landmarks: sum directly. */
+      for (unsigned long i = node.m_Begin; i < node.m_End; ++i)
+      {
+        const unsigned long lnd = this->m_FarFieldLandmarkIndices[i];
+        if (lnd == skippedLandmark)
+        {
+          continue;
+        }
+        this->ComputeG(point - this->m_FarFieldLandmarks[i], Gmatrix);
+        for (unsigned int dim = 0; dim < NDimensions; ++dim)
+        {
+          for (unsigned int odim = 0; odim < NDimensions; ++odim)
+          {
+            result[odim] += Gmatrix(dim, odim) * coefficients(dim, lnd);
+          }
+        }
+      }
+    }
+    else
+    {
+      stack[stackSize++] = node.m_FirstChild;
+      stack[stackSize++] = node.m_FirstChild + 1;
+    }
+  }
+
+} // end ComputeFarFieldContribution()
+
+
 /**
  * ******************* ComputeLInverse *******************
  */
@@ -525,7 +1039,15 @@ KernelTransform2<TScalarType, NDimensions>::TransformPoint(const InputPointType
 {
   OutputPointType opp;
   opp.Fill(NumericTraits<typename OutputPointType::ValueType>::ZeroValue());
-  this->ComputeDeformationContribution(thisPoint, opp);
+  if (this->m_UseFarFieldApproximation && this->m_FarFieldCoefficientsComputed)
+  {
+    this->ComputeFarFieldContribution(
+      thisPoint, this->m_DMatrix, this->m_SourceLandmarks->GetNumberOfPoints(), opp);
+  }
+  else
+  {
+    this->ComputeDeformationContribution(thisPoint, opp);
+  }
 
   // Add the rotational part of the Affine component
   for (unsigned int j = 0; j < NDimensions; ++j)
@@ -649,9 +1171,15 @@ KernelTransform2<TScalarType, NDimensions>::SetFixedParameters(const ParametersT
   this->m_LMatrixComputed = false;
   this->m_LInverseComputed = false;
   this->m_LMatrixDecompositionComputed = false;
+  this->m_FarFieldTreeComputed = false;
+  this->m_FarFieldCoefficientsComputed = false;
 
   // you must recompute L and Linv - this does not require the targ lms
-  this->ComputeLInverse();
+  // The iterative solver does not need them.
+  if (this->m_MatrixInversionMethod != "Iterative")
+  {
+    this->ComputeLInverse();
+  }
 
 } // end SetFixedParameters()
 
@@ -733,6 +1261,12 @@ KernelTransform2<TScalarType, NDimensions>::GetJacobian(const InputPointType &
                                                         JacobianType &               jac,
                                                         NonZeroJacobianIndicesType & nonZeroJacobianIndices) const
 {
+  if (this->m_MatrixInversionMethod == "Iterative")
+  {
+    itkExceptionMacro(<< "The Jacobian needs the inverse of the L matrix, "
+                      << "which is not computed by the iterative solver.");
+  }
+
   const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
   jac.SetSize(NDimensions, numberOfLandmarks * NDimensions);
   jac.Fill(0.0);
@@ -895,6 +1429,12 @@ KernelTransform2<TScalarType, NDimensions>::PrintSelf(std::ostream & os, Indent
   os << indent << "FastComputationPossible: " << this->m_FastComputationPossible << std::endl;
   os << indent << "PoissonRatio: " << this->m_PoissonRatio << std::endl;
   os << indent << "MatrixInversionMethod: " << this->m_MatrixInversionMethod << std::endl;
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "IterativeSolverTolerance: " << this->m_IterativeSolverTolerance << std::endl;
+  os << indent << "UseFarFieldApproximation: " << this->m_UseFarFieldApproximation << std::endl;
+  os << indent << "FarFieldOpeningAngle: " << this->m_FarFieldOpeningAngle << std::endl;
+  os << indent << "FarFieldInterpolationOrder: " << this->m_FarFieldInterpolationOrder << std::endl;
+  os << indent << "FarFieldTree: " << this->m_FarFieldTree.size() << " nodes" << std::endl;
 
   /** Just print the sizes of these matrices, not their contents. */
   os << indent << "LMatrix: " << this->m_LMatrix.rows() << " x " << this->m_LMatrix.cols() << std::endl;
@@ -21,6 +21,7 @@
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkAdvancedTranslationTransform.h"
 #include "itkTranslationTransformInitializer.h"
+#include "itkPhaseCorrelationTranslationEstimator.h"
 
 namespace elastix
 {
@@ -39,9 +40,15 @@ namespace elastix
  *    example: <tt>(AutomaticTransformInitialization "true")</tt> \n
  *    By default "false" is assumed. So, no initial translation.
  * \parameter AutomaticTransformInitializationMethod: how to initialize this
- *    transform. Should be one of {GeometricalCenter, CenterOfGravity}.\n
+ *    transform. Should be one of {GeometricalCenter, CenterOfGravity, PhaseCorrelation}.
+ *    PhaseCorrelation finds the translation of the best match of the images on a coarse
+ *    grid, by an FFT, see itk::PhaseCorrelationTranslationEstimator.\n
  *    example: <tt>(AutomaticTransformInitializationMethod "CenterOfGravity")</tt> \n
  *    By default "GeometricalCenter" is assumed.\n
+ * \parameter PhaseCorrelationGridSize: the number of grid points along the longest side of
+ *    the fixed image, for the PhaseCorrelation initialization.\n
+ *    example: <tt>(PhaseCorrelationGridSize 128)</tt> \n
+ *    By default 64 is assumed.\n
  *
  * \ingroup Transforms
  */
@@ -119,6 +126,8 @@ public:
                                                      TransformInitializerType;
   typedef typename TransformInitializerType::Pointer TransformInitializerPointer;
   typedef typename TranslationTransformType::Pointer TranslationTransformPointer;
+  typedef itk::PhaseCorrelationTranslationEstimator<FixedImageType, MovingImageType> PhaseCorrelationEstimatorType;
+  typedef typename PhaseCorrelationEstimatorType::Pointer                            PhaseCorrelationEstimatorPointer;
 
   /** Execute stuff before the actual registration:
    * \li Call InitializeTransform.
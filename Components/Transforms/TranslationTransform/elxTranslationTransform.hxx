@@ -90,7 +90,27 @@ TranslationTransformElastix<TElastix>::InitializeTransform(void)
       transformInitializer->MomentsOn();
     }
 
-    transformInitializer->InitializeTransform();
+    if (method == "PhaseCorrelation")
+    {
+      /** Estimate the translation by phase correlation on a coarse grid. */
+      unsigned int gridSize = 64;
+      this->m_Configuration->ReadParameter(gridSize, "PhaseCorrelationGridSize", 0);
+
+      PhaseCorrelationEstimatorPointer estimator = PhaseCorrelationEstimatorType::New();
+      estimator->SetFixedImage(this->m_Registration->GetAsITKBaseType()->GetFixedImage());
+      estimator->SetMovingImage(this->m_Registration->GetAsITKBaseType()->GetMovingImage());
+      estimator->SetFixedMask(this->GetElastix()->GetFixedMask());
+      estimator->SetMovingMask(this->GetElastix()->GetMovingMask());
+      estimator->SetGridSize(gridSize);
+      estimator->Compute();
+
+      this->m_TranslationTransform->SetOffset(estimator->GetShift());
+      elxout << "Phase correlation peak: " << estimator->GetScore() << std::endl;
+    }
+    else
+    {
+      transformInitializer->InitializeTransform();
+    }
   }
 
   /** Set the initial parameters in this->m_Registration.*/
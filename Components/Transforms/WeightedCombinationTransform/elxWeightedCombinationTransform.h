@@ -53,6 +53,11 @@ namespace elastix
  * \parameter SubTransforms: a list of transform parameter filenames that
  * will serve as subtransforms \f$T_i(x)\f$.\n
  *    <tt>(SubTransforms "tp0.txt" "TransformParameters.1.txt" "tpbspline.txt" )</tt>\n
+ * \parameter CacheSubTransformOutputs: cache the outputs of the subtransforms per point,
+ *    so that they are computed only once for every sample. Only useful when the same samples
+ *    are used in every iteration, i.e. without (NewSamplesEveryIteration "true"). \n
+ *    example: <tt>(CacheSubTransformOutputs "true") </tt> \n
+ *    Default: "false".
  * \parameter AutomaticScalesEstimation: if this parameter is set to "true" the Scales
  *    parameter is ignored and the scales are determined automatically. \n
  *    example: <tt>(AutomaticScalesEstimation "true") </tt> \n
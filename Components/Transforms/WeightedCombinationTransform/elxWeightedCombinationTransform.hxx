@@ -49,6 +49,11 @@ WeightedCombinationTransformElastix<TElastix>::BeforeRegistration(void)
   this->m_Configuration->ReadParameter(normalizeWeights, "NormalizeCombinationWeights", 0);
   this->m_WeightedCombinationTransform->SetNormalizeWeights(normalizeWeights);
 
+  /** Select the cache of the outputs of the subtransforms. */
+  bool cacheSubTransformOutputs = false;
+  this->m_Configuration->ReadParameter(cacheSubTransformOutputs, "CacheSubTransformOutputs", 0, false);
+  this->m_WeightedCombinationTransform->SetUseSubTransformCache(cacheSubTransformOutputs);
+
   /** Give initial parameters to this->m_Registration.*/
   this->InitializeTransform();
 
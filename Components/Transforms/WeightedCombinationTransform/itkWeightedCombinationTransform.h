@@ -20,6 +20,11 @@
 
 #include "itkAdvancedTransform.h"
 
+#include <functional> // For hash.
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 namespace itk
 {
 
@@ -35,6 +40,10 @@ namespace itk
  * the transformation is as follows:
  * \f[T(x) = \sum_i w_i T_i(x) / \sum_i w_i\f]
  *
+ * Only the weights change during a registration. When the same points are
+ * transformed over and over, as for a fixed sample set, the outputs of the
+ * sub-transforms may therefore be cached per point, see SetUseSubTransformCache().
+ *
  * \ingroup Transforms
  *
  */
@@ -162,6 +171,7 @@ public:
   SetTransformContainer(const TransformContainerType & transformContainer)
   {
     this->m_TransformContainer = transformContainer;
+    this->ClearSubTransformCache();
     this->Modified();
   }
 
@@ -182,6 +192,27 @@ public:
   }
 
 
+  /** Set/get if the outputs of the sub-transforms are cached, per input point.
+   * TransformPoint() and GetJacobian() then evaluate the sub-transforms only once for
+   * every point, and afterwards just combine the cached outputs with the weights.
+   * The cache is only valid as long as the sub-transforms are not modified;
+   * it is cleared by SetTransformContainer() and ClearSubTransformCache().
+   * Default: false. */
+  virtual void
+  SetUseSubTransformCache(const bool _arg);
+
+  itkGetConstMacro(UseSubTransformCache, bool);
+
+  /** Set/get the maximum number of points in the cache. When it is full, part of
+   * the cache is cleared to make room. Default: 1000000. */
+  itkSetMacro(MaximumNumberOfCachedPoints, SizeValueType);
+  itkGetConstMacro(MaximumNumberOfCachedPoints, SizeValueType);
+
+  /** Remove all points from the cache of sub-transform outputs. */
+  void
+  ClearSubTransformCache(void);
+
+
   /** Must be provided. */
   void
   GetSpatialJacobian(const InputPointType & ipp, SpatialJacobianType & sj) const override
@@ -250,7 +281,40 @@ private:
   void
   operator=(const Self &) = delete;
 
-  bool m_NormalizeWeights;
+  /** Calls function(i, T_i(x)) for all sub-transforms i, with the output given as an
+   * array of OutputSpaceDimension values. Uses the cache, if selected. */
+  template <class TFunction>
+  void
+  VisitSubTransformOutputs(const InputPointType & ipp, TFunction function) const;
+
+  /** Hash of a point, for the cache. */
+  struct PointHash
+  {
+    std::size_t
+    operator()(const InputPointType & point) const
+    {
+      std::size_t hash = 0;
+      for (unsigned int d = 0; d < InputSpaceDimension; ++d)
+      {
+        hash ^= std::hash<TScalarType>()(point[d]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      }
+      return hash;
+    }
+  };
+
+  /** The cache is divided into shards with their own mutex, so that the
+   * threads of a metric rarely have to wait for each other. */
+  static constexpr unsigned int NumberOfCacheShards = 64;
+  struct CacheShard
+  {
+    std::mutex                                                             m_Mutex;
+    std::unordered_map<InputPointType, std::vector<ScalarType>, PointHash> m_Outputs;
+  };
+
+  bool               m_NormalizeWeights;
+  bool               m_UseSubTransformCache;
+  SizeValueType      m_MaximumNumberOfCachedPoints;
+  mutable CacheShard m_CacheShards[NumberOfCacheShards];
 };
 
 } // end namespace itk
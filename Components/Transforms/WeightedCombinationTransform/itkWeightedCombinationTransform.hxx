@@ -20,6 +20,8 @@
 
 #include "itkWeightedCombinationTransform.h"
 
+#include <algorithm> // For copy.
+
 namespace itk
 {
 
@@ -35,6 +37,8 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
   this->m_NormalizeWeights = false;
   this->m_HasNonZeroSpatialHessian = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
+  this->m_UseSubTransformCache = false;
+  this->m_MaximumNumberOfCachedPoints = 1000000;
 } // end Constructor
 
 
@@ -88,21 +92,16 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
 {
   OutputPointType opp;
   opp.Fill(0.0);
-  OutputPointType                tempopp;
-  const TransformContainerType & tc = this->m_TransformContainer;
-  const unsigned int             N = tc.size();
-  const ParametersType &         param = this->m_Parameters;
+  const ParametersType & param = this->m_Parameters;
 
   /** Calculate sum_i w_i T_i(x) */
-  for (unsigned int i = 0; i < N; ++i)
-  {
-    tempopp = tc[i]->TransformPoint(ipp);
+  this->VisitSubTransformOutputs(ipp, [&opp, &param](const unsigned int i, const ScalarType * tempopp) {
     const double w = param[i];
     for (unsigned int d = 0; d < OutputSpaceDimension; ++d)
     {
       opp[d] += w * tempopp[d];
     }
-  }
+  });
 
   if (this->m_NormalizeWeights)
   {
@@ -137,15 +136,21 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
   JacobianType &               jac,
   NonZeroJacobianIndicesType & nzji) const
 {
-  OutputPointType                tempopp;
-  const TransformContainerType & tc = this->m_TransformContainer;
-  const unsigned int             N = tc.size();
-  const ParametersType &         param = this->m_Parameters;
+  const unsigned int     N = this->m_TransformContainer.size();
+  const ParametersType & param = this->m_Parameters;
   jac.SetSize(OutputSpaceDimension, N);
 
   /** This transform has only nonzero jacobians. */
   nzji = this->m_NonZeroJacobianIndices;
 
+  /** Store T_i(x) in the Jacobian. */
+  this->VisitSubTransformOutputs(ipp, [&jac](const unsigned int i, const ScalarType * tempopp) {
+    for (unsigned int d = 0; d < OutputSpaceDimension; ++d)
+    {
+      jac(d, i) = tempopp[d];
+    }
+  });
+
   if (this->m_NormalizeWeights)
   {
     /** dT/dmu_i = ( T_i(x) - T(x) ) / ( \sum_i w_i ) */
@@ -153,12 +158,10 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
     opp.Fill(0.0);
     for (unsigned int i = 0; i < N; ++i)
     {
-      tempopp = tc[i]->TransformPoint(ipp);
       const double w = param[i];
       for (unsigned int d = 0; d < OutputSpaceDimension; ++d)
       {
-        opp[d] += w * tempopp[d];
-        jac(d, i) = tempopp[d];
+        opp[d] += w * jac(d, i);
       }
     }
     for (unsigned int d = 0; d < OutputSpaceDimension; ++d)
@@ -178,10 +181,9 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
     /** dT/dmu_i = T_i(x) - x */
     for (unsigned int i = 0; i < N; ++i)
     {
-      tempopp = tc[i]->TransformPoint(ipp);
       for (unsigned int d = 0; d < OutputSpaceDimension; ++d)
       {
-        jac(d, i) = tempopp[d] - ipp[d];
+        jac(d, i) -= ipp[d];
       }
     }
   }
@@ -189,6 +191,105 @@ WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::
 } // end GetJacobian()
 
 
+/**
+ * ******************* SetUseSubTransformCache *******************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::SetUseSubTransformCache(
+  const bool _arg)
+{
+  if (this->m_UseSubTransformCache != _arg)
+  {
+    this->m_UseSubTransformCache = _arg;
+    this->ClearSubTransformCache();
+    this->Modified();
+  }
+
+} // end SetUseSubTransformCache()
+
+
+/**
+ * ******************* ClearSubTransformCache *******************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+void
+WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::ClearSubTransformCache(void)
+{
+  for (CacheShard & shard : this->m_CacheShards)
+  {
+    const std::lock_guard<std::mutex> lock(shard.m_Mutex);
+    shard.m_Outputs.clear();
+  }
+
+} // end ClearSubTransformCache()
+
+
+/**
+ * ******************* VisitSubTransformOutputs *******************
+ */
+
+template <class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions>
+template <class TFunction>
+void
+WeightedCombinationTransform<TScalarType, NInputDimensions, NOutputDimensions>::VisitSubTransformOutputs(
+  const InputPointType & ipp,
+  TFunction              function) const
+{
+  const TransformContainerType & tc = this->m_TransformContainer;
+  const unsigned int             N = tc.size();
+
+  /** Without the cache, just call the sub-transforms. */
+  if (!this->m_UseSubTransformCache)
+  {
+    for (unsigned int i = 0; i < N; ++i)
+    {
+      const OutputPointType tempopp = tc[i]->TransformPoint(ipp);
+      function(i, tempopp.GetDataPointer());
+    }
+    return;
+  }
+
+  /** Look up the cached outputs. The function is called while the shard is locked,
+   * because the outputs could be removed by another thread, otherwise.
+   */
+  CacheShard & shard = this->m_CacheShards[(PointHash()(ipp) >> 8) % NumberOfCacheShards];
+  {
+    const std::lock_guard<std::mutex> lock(shard.m_Mutex);
+    const auto                        found = shard.m_Outputs.find(ipp);
+    if (found != shard.m_Outputs.end())
+    {
+      for (unsigned int i = 0; i < N; ++i)
+      {
+        function(i, found->second.data() + i * OutputSpaceDimension);
+      }
+      return;
+    }
+  }
+
+  /** Compute the outputs of all sub-transforms, outside the lock. */
+  std::vector<ScalarType> outputs(N * OutputSpaceDimension);
+  for (unsigned int i = 0; i < N; ++i)
+  {
+    const OutputPointType tempopp = tc[i]->TransformPoint(ipp);
+    std::copy(tempopp.Begin(), tempopp.End(), outputs.begin() + i * OutputSpaceDimension);
+    function(i, tempopp.GetDataPointer());
+  }
+
+  /** Store them, after making room if the shard is full. */
+  const SizeValueType               maximumSize = this->m_MaximumNumberOfCachedPoints / NumberOfCacheShards + 1;
+  const std::lock_guard<std::mutex> lock(shard.m_Mutex);
+  if (shard.m_Outputs.size() >= maximumSize)
+  {
+    shard.m_Outputs.clear();
+  }
+  shard.m_Outputs.emplace(ipp, std::move(outputs));
+
+} // end VisitSubTransformOutputs()
+
+
 } // end namespace itk
 
 #endif
@@ -24,6 +24,13 @@
 #include "elxBaseComponentSE.h"
 #include "itkObject.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
+#include "itkThreadBudget.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace elastix
 {
@@ -49,6 +56,21 @@ namespace elastix
  * \parameter WritePyramidImagesAfterEachResolution: ...\n
  *    example: <tt>(WritePyramidImagesAfterEachResolution "true")</tt>\n
  *    default "false".
+ * \parameter FixedImagePyramidCacheDirectory: a directory in which the pyramid images are stored,
+ *    to be reused by later runs with the same fixed image and the same pyramid settings, e.g. when
+ *    one atlas is registered to many subjects. The cache files are identified by the MD5 hash of the
+ *    fixed image, its geometry, the pyramid type and its schedules. Only used when all resolution
+ *    levels are computed at once.\n
+ *    example: <tt>(FixedImagePyramidCacheDirectory "/data/cache")</tt>\n
+ *    Default: "", i.e. no cache.
+ * \parameter FixedImagePyramidMemoryCacheSize: the number of pyramids that are kept in memory,
+ *    to be reused by later registrations in the same process with the same fixed image and the same
+ *    pyramid settings, e.g. by repeated updates of an ElastixRegistrationMethod with different moving
+ *    images. The pyramids of the most recently used fixed images are kept. The cache entries are
+ *    identified like the files of the FixedImagePyramidCacheDirectory, and are shared by all
+ *    registrations in the process. A pyramid read from the directory is also kept in memory.\n
+ *    example: <tt>(FixedImagePyramidMemoryCacheSize 1)</tt>\n
+ *    Default: 0, i.e. no pyramid is kept in memory.
  *
  * \ingroup ImagePyramids
  * \ingroup ComponentBaseClasses
@@ -121,6 +143,28 @@ public:
                     const unsigned int & level); // const;
 
 protected:
+  /** Reads the pyramid images of all levels from the cache, when the
+   * FixedImagePyramidMemoryCacheSize or the FixedImagePyramidCacheDirectory
+   * is specified, and grafts them onto the outputs. Returns true when all levels were found. Meant to be called from
+   * the GenerateData() of the pyramid, before computing the images.
+   */
+  bool
+  ReadPyramidFromCache(void);
+
+  /** Writes the pyramid images of all levels to the cache, when the
+   * FixedImagePyramidMemoryCacheSize or the FixedImagePyramidCacheDirectory
+   * is specified. Meant to be called from
+   * the GenerateData() of the pyramid, after computing the images.
+   */
+  void
+  WritePyramidToCache(void);
+
+  /** Writes the settings that determine the pyramid images to the stream,
+   * to identify the cache files. By default the schedule.
+   */
+  virtual void
+  WritePyramidCacheKey(std::ostream & os) const;
+
   /** The constructor. */
   FixedImagePyramidBase() = default;
   /** The destructor. */
@@ -129,6 +173,40 @@ protected:
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
+  /** Returns the cache file name of the given level. */
+  std::string
+  GetPyramidCacheFileName(const unsigned int level) const;
+
+  /** The pyramids that are kept in memory, most recently used first, by cache key. */
+  struct PyramidMemoryCache
+  {
+    typedef std::pair<std::string, std::vector<typename OutputImageType::Pointer>> EntryType;
+
+    std::mutex           Mutex;
+    std::list<EntryType> Entries;
+  };
+
+  /** Returns the memory cache, which is shared by all registrations in the process. */
+  static PyramidMemoryCache &
+  GetPyramidMemoryCache(void);
+
+  /** Grafts the pyramid images from the memory cache onto the outputs. Returns true when found. */
+  bool
+  ReadPyramidFromMemoryCache(void);
+
+  /** Stores the pyramid images in the memory cache. */
+  void
+  WritePyramidToMemoryCache(void);
+
+  /** The cache key, empty when there is no cache. */
+  std::string m_PyramidCacheKey;
+
+  /** The cache file name without the level, empty when there is no cache directory. */
+  std::string m_PyramidCacheFileNamePrefix;
+
+  /** The number of pyramids that are kept in memory. */
+  unsigned int m_PyramidMemoryCacheSize{ 0 };
+
   /** The deleted copy constructor. */
   FixedImagePyramidBase(const Self &) = delete;
   /** The deleted assignment operator. */
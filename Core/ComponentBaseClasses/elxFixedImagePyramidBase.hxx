@@ -20,6 +20,17 @@
 
 #include "elxFixedImagePyramidBase.h"
 #include "itkImageFileCastWriter.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itksys/MD5.h"
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <typeinfo>
+#include <vector>
 
 namespace elastix
 {
@@ -35,6 +46,9 @@ FixedImagePyramidBase<TElastix>::BeforeRegistrationBase(void)
   /** Call SetFixedSchedule.*/
   this->SetFixedSchedule();
 
+  /** Use the number of threads of this registration. */
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
+
 } // end BeforeRegistrationBase()
 
 
@@ -197,6 +211,312 @@ FixedImagePyramidBase<TElastix>::WritePyramidImage(const std::string &  filename
 } // end WritePyramidImage()
 
 
+/**
+ * ******************* WritePyramidCacheKey ********************
+ */
+
+template <class TElastix>
+void
+FixedImagePyramidBase<TElastix>::WritePyramidCacheKey(std::ostream & os) const
+{
+  os << "Schedule:\n" << this->GetAsITKBaseType()->GetSchedule() << "\n";
+  os << "UseShrinkImageFilter: " << this->GetAsITKBaseType()->GetUseShrinkImageFilter() << "\n";
+
+} // end WritePyramidCacheKey()
+
+
+/**
+ * ******************* GetPyramidCacheFileName ********************
+ */
+
+template <class TElastix>
+std::string
+FixedImagePyramidBase<TElastix>::GetPyramidCacheFileName(const unsigned int level) const
+{
+  return this->m_PyramidCacheFileNamePrefix + ".R" + std::to_string(level) + ".mha";
+
+} // end GetPyramidCacheFileName()
+
+
+/**
+ * ******************* ReadPyramidFromCache ********************
+ */
+
+template <class TElastix>
+bool
+FixedImagePyramidBase<TElastix>::ReadPyramidFromCache(void)
+{
+  this->m_PyramidCacheKey.clear();
+  this->m_PyramidCacheFileNamePrefix.clear();
+
+  std::string cacheDirectory = "";
+  this->m_Configuration->ReadParameter(cacheDirectory, "FixedImagePyramidCacheDirectory", 0, false);
+  this->m_PyramidMemoryCacheSize = 0;
+  this->m_Configuration->ReadParameter(this->m_PyramidMemoryCacheSize, "FixedImagePyramidMemoryCacheSize", 0, false);
+  const InputImageType * input = this->GetAsITKBaseType()->GetInput();
+  if ((cacheDirectory.empty() && this->m_PyramidMemoryCacheSize == 0) || input == nullptr)
+  {
+    return false;
+  }
+
+  /** The settings and the geometry of the input image. */
+  std::ostringstream key;
+  key << std::setprecision(17);
+  key << this->elxGetClassName() << "\n";
+  key << "PixelTypes: " << typeid(typename InputImageType::PixelType).name() << " "
+      << typeid(typename OutputImageType::PixelType).name() << "\n";
+  key << "Region: " << input->GetLargestPossibleRegion().GetIndex() << " "
+      << input->GetLargestPossibleRegion().GetSize() << "\n";
+  key << "Origin: " << input->GetOrigin() << "\n";
+  key << "Spacing: " << input->GetSpacing() << "\n";
+  key << "Direction:\n" << input->GetDirection() << "\n";
+  this->WritePyramidCacheKey(key);
+  const std::string keyString = key.str();
+
+  /** The MD5 hash of the settings and the content of the input image. */
+  itksysMD5 * md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, reinterpret_cast<const unsigned char *>(keyString.c_str()), static_cast<int>(keyString.size()));
+  const unsigned char * buffer = reinterpret_cast<const unsigned char *>(input->GetBufferPointer());
+  std::size_t numberOfBytes =
+    input->GetBufferedRegion().GetNumberOfPixels() * sizeof(typename InputImageType::PixelType);
+  while (numberOfBytes > 0)
+  {
+    const std::size_t chunkSize = std::min<std::size_t>(numberOfBytes, 1u << 30);
+    itksysMD5_Append(md5, buffer, static_cast<int>(chunkSize));
+    buffer += chunkSize;
+    numberOfBytes -= chunkSize;
+  }
+  const std::size_t digestSize = 32u;
+  char              digest[digestSize];
+  itksysMD5_FinalizeHex(md5, digest);
+  itksysMD5_Delete(md5);
+
+  this->m_PyramidCacheKey = this->elxGetClassName() + std::string(".") + std::string(digest, digestSize);
+  if (this->ReadPyramidFromMemoryCache())
+  {
+    return true;
+  }
+  if (cacheDirectory.empty())
+  {
+    return false;
+  }
+  this->m_PyramidCacheFileNamePrefix = cacheDirectory + "/" + this->m_PyramidCacheKey;
+
+  /** Read all levels, before touching any of the outputs. */
+  typedef itk::ImageFileReader<OutputImageType> ReaderType;
+  const unsigned int                            numberOfLevels = this->GetAsITKBaseType()->GetNumberOfLevels();
+  std::vector<typename OutputImageType::Pointer> images(numberOfLevels);
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    const std::string fileName = this->GetPyramidCacheFileName(level);
+    if (!itksys::SystemTools::FileExists(fileName))
+    {
+      return false;
+    }
+
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(fileName);
+    try
+    {
+      reader->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      xl::xout["warning"] << "WARNING: the fixed pyramid cache file " << fileName << " could not be read.\n"
+                          << excp << "  The pyramid images are computed instead." << std::endl;
+      return false;
+    }
+
+    /** The geometry is taken from the output, as the file may store it with less precision. */
+    images[level] = reader->GetOutput();
+    images[level]->DisconnectPipeline();
+    const OutputImageType * output = this->GetAsITKBaseType()->GetOutput(level);
+    if (images[level]->GetLargestPossibleRegion() != output->GetLargestPossibleRegion())
+    {
+      return false;
+    }
+    images[level]->CopyInformation(output);
+  }
+
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    this->GetAsITKBaseType()->GetOutput(level)->Graft(images[level]);
+  }
+  elxout << "  The fixed pyramid images are read from the cache " << this->m_PyramidCacheFileNamePrefix << std::endl;
+  this->WritePyramidToMemoryCache();
+  return true;
+
+} // end ReadPyramidFromCache()
+
+
+/**
+ * ******************* WritePyramidToCache ********************
+ */
+
+template <class TElastix>
+void
+FixedImagePyramidBase<TElastix>::WritePyramidToCache(void)
+{
+  this->WritePyramidToMemoryCache();
+  if (this->m_PyramidCacheFileNamePrefix.empty())
+  {
+    return;
+  }
+
+  typedef itk::ImageFileWriter<OutputImageType> WriterType;
+  const unsigned int                            numberOfLevels = this->GetAsITKBaseType()->GetNumberOfLevels();
+  itksys::SystemTools::MakeDirectory(itksys::SystemTools::GetFilenamePath(this->m_PyramidCacheFileNamePrefix));
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    const std::string fileName = this->GetPyramidCacheFileName(level);
+    if (itksys::SystemTools::FileExists(fileName))
+    {
+      continue;
+    }
+
+    /** Write to a temporary file first, and rename it afterwards, so that
+     * concurrent runs never read a partially written file.
+     */
+    const std::string temporaryFileName =
+      this->m_PyramidCacheFileNamePrefix + ".R" + std::to_string(level) + "." +
+      std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".mha";
+
+    /** Write a copy that shares the buffer, but is not connected to this pyramid. */
+    const auto image = OutputImageType::New();
+    image->Graft(this->GetAsITKBaseType()->GetOutput(level));
+
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetInput(image);
+    writer->SetFileName(temporaryFileName);
+    writer->SetUseCompression(false);
+    try
+    {
+      writer->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      xl::xout["warning"] << "WARNING: the fixed pyramid cache file " << fileName << " could not be written.\n"
+                          << excp << std::endl;
+      std::remove(temporaryFileName.c_str());
+      return;
+    }
+
+    if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+    {
+      std::remove(temporaryFileName.c_str());
+    }
+  }
+
+} // end WritePyramidToCache()
+
+
+/**
+ * ******************* GetPyramidMemoryCache ********************
+ */
+
+template <class TElastix>
+typename FixedImagePyramidBase<TElastix>::PyramidMemoryCache &
+FixedImagePyramidBase<TElastix>::GetPyramidMemoryCache(void)
+{
+  static PyramidMemoryCache cache;
+  return cache;
+
+} // end GetPyramidMemoryCache()
+
+
+/**
+ * ******************* ReadPyramidFromMemoryCache ********************
+ */
+
+template <class TElastix>
+bool
+FixedImagePyramidBase<TElastix>::ReadPyramidFromMemoryCache(void)
+{
+  if (this->m_PyramidMemoryCacheSize == 0 || this->m_PyramidCacheKey.empty())
+  {
+    return false;
+  }
+
+  /** Look up the entry, and make it the most recently used one. */
+  PyramidMemoryCache &                           cache = GetPyramidMemoryCache();
+  std::vector<typename OutputImageType::Pointer> images;
+  {
+    const std::lock_guard<std::mutex> lock(cache.Mutex);
+    const auto found = std::find_if(
+      cache.Entries.begin(), cache.Entries.end(), [this](const typename PyramidMemoryCache::EntryType & entry) {
+        return entry.first == this->m_PyramidCacheKey;
+      });
+    if (found == cache.Entries.end())
+    {
+      return false;
+    }
+    cache.Entries.splice(cache.Entries.begin(), cache.Entries, found);
+    images = found->second;
+  }
+
+  const unsigned int numberOfLevels = this->GetAsITKBaseType()->GetNumberOfLevels();
+  if (images.size() != numberOfLevels)
+  {
+    return false;
+  }
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    if (images[level]->GetLargestPossibleRegion() !=
+        this->GetAsITKBaseType()->GetOutput(level)->GetLargestPossibleRegion())
+    {
+      return false;
+    }
+  }
+
+  /** The outputs share the buffers of the cached images, which are only read. */
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    this->GetAsITKBaseType()->GetOutput(level)->Graft(images[level]);
+  }
+  elxout << "  The fixed pyramid images are taken from the memory cache." << std::endl;
+  return true;
+
+} // end ReadPyramidFromMemoryCache()
+
+
+/**
+ * ******************* WritePyramidToMemoryCache ********************
+ */
+
+template <class TElastix>
+void
+FixedImagePyramidBase<TElastix>::WritePyramidToMemoryCache(void)
+{
+  if (this->m_PyramidMemoryCacheSize == 0 || this->m_PyramidCacheKey.empty())
+  {
+    return;
+  }
+
+  /** Store copies that share the buffers, but are not connected to this pyramid. */
+  const unsigned int                             numberOfLevels = this->GetAsITKBaseType()->GetNumberOfLevels();
+  std::vector<typename OutputImageType::Pointer> images(numberOfLevels);
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    images[level] = OutputImageType::New();
+    images[level]->Graft(this->GetAsITKBaseType()->GetOutput(level));
+  }
+
+  /** Insert as the most recently used entry, and drop the least recently used ones. */
+  PyramidMemoryCache &              cache = GetPyramidMemoryCache();
+  const std::lock_guard<std::mutex> lock(cache.Mutex);
+  cache.Entries.remove_if([this](const typename PyramidMemoryCache::EntryType & entry) {
+    return entry.first == this->m_PyramidCacheKey;
+  });
+  cache.Entries.emplace_front(this->m_PyramidCacheKey, std::move(images));
+  while (cache.Entries.size() > this->m_PyramidMemoryCacheSize)
+  {
+    cache.Entries.pop_back();
+  }
+
+} // end WritePyramidToMemoryCache()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxFixedImagePyramidBase_hxx
@@ -25,6 +25,7 @@
 #include "elxBaseComponentSE.h"
 
 #include "itkImageSamplerBase.h"
+#include "itkThreadBudget.h"
 
 namespace elastix
 {
@@ -36,6 +37,29 @@ namespace elastix
  *
  * This class contains all the common functionality for ImageSamplers.
  *
+ * The parameters used in this class are:
+ * \parameter SortSamplesInMortonOrder: Whether the random samplers sort the selected
+ *    samples along a Z-order (Morton) curve, so that consecutive samples are close in
+ *    space. This improves the cache use of the metric computations on large images.
+ *    The grid and full samplers ignore it, and keep their samples in scan order.
+ *    Can be given for each resolution. \n
+ *    example: <tt>(SortSamplesInMortonOrder "true")</tt> \n
+ *    The default is "false".
+ * \parameter SampleRefreshFraction: The fraction of the samples that is replaced when
+ *    new samples are selected every iteration (see NewSamplesEveryIteration). The other
+ *    samples, and their image values, are reused, which saves sampling time when many
+ *    samples are used. Can be given for each resolution. \n
+ *    example: <tt>(SampleRefreshFraction 0.25)</tt> \n
+ *    The default is 1.0, which replaces all samples.
+ * \parameter MaximumNumberOfSpatialSamples: Lets the optimizer adapt the number of samples
+ *    during a resolution, between NumberOfSpatialSamples and this maximum. Few samples are
+ *    used while the gradients point in a consistent direction, and more samples as the
+ *    gradient noise starts to dominate, near convergence. Only the AdaptiveStochasticGradientDescent
+ *    optimizer supports this, with NewSamplesEveryIteration "true". The number of samples is
+ *    then reported in the iteration info. Can be given for each resolution. \n
+ *    example: <tt>(MaximumNumberOfSpatialSamples 20000)</tt> \n
+ *    The default is 0, which disables the adaptation.
+ *
  * \ingroup ImageSamplers
  * \ingroup ComponentBaseClasses
  */
@@ -88,12 +112,42 @@ public:
   void
   BeforeEachResolutionBase(void) override;
 
+  /** Execute stuff after each iteration:
+   * \li Report the number of samples, when it is adapted.
+   */
+  void
+  AfterEachIterationBase(void) override;
+
+  /** Adapt the number of samples to the noise level of the gradients, a number
+   * between 0 (no noise) and 1 (noise dominated). Selects a number of samples
+   * between NumberOfSpatialSamples and MaximumNumberOfSpatialSamples.
+   * Does nothing when MaximumNumberOfSpatialSamples is not given.
+   */
+  void
+  AdaptNumberOfSpatialSamples(const double noiseLevel);
+
 protected:
   /** The constructor. */
   ImageSamplerBase() = default;
   /** The destructor. */
   ~ImageSamplerBase() override = default;
 
+  /** Read the parameters that all random samplers share, for the current resolution:
+   * NumberOfSpatialSamples, UseCounterBasedRandomNumbers and RandomSeed. To be called
+   * from BeforeEachResolution(), with the sampler itself as argument.
+   */
+  template <class TRandomSampler>
+  void
+  ReadRandomSamplerParameters(TRandomSampler & sampler);
+
+  /** Read the parameters of the random coordinate samplers, for the current resolution:
+   * FixedImageBSplineInterpolationOrder, UseRandomSampleRegion, SampleRegionSize and the
+   * fixed image tile parameters. Also calls ReadRandomSamplerParameters().
+   */
+  template <class TRandomCoordinateSampler>
+  void
+  ReadRandomCoordinateSamplerParameters(TRandomCoordinateSampler & sampler);
+
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
@@ -102,6 +156,12 @@ private:
   /** The deleted assignment operator. */
   void
   operator=(const Self &) = delete;
+
+  /** The range of the adapted number of samples. The minimum is taken from the
+   * sampler at the first adaptation, after the sampler has read NumberOfSpatialSamples.
+   */
+  unsigned long m_MinimumNumberOfSpatialSamples{ 0 };
+  unsigned long m_MaximumNumberOfSpatialSamples{ 0 };
 };
 
 } // end namespace elastix
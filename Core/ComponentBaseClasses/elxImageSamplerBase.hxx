@@ -20,6 +20,9 @@
 #define elxImageSamplerBase_hxx
 
 #include "elxImageSamplerBase.h"
+#include "itkLinearInterpolateImageFunction.h"
+
+#include <algorithm> // For min and max.
 
 namespace elastix
 {
@@ -35,6 +38,9 @@ ImageSamplerBase<TElastix>::BeforeEachResolutionBase(void)
   /** Get the current resolution level. */
   unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
 
+  /** Use the number of threads of this registration. */
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
+
   /** Check if NewSamplesEveryIteration is possible with the selected ImageSampler.
    * The "" argument means that no prefix is supplied.
    */
@@ -51,6 +57,31 @@ ImageSamplerBase<TElastix>::BeforeEachResolutionBase(void)
     }
   }
 
+  /** Sort the samples along a Morton curve or not. */
+  bool sortSamplesInMortonOrder = false;
+  this->m_Configuration->ReadParameter(
+    sortSamplesInMortonOrder, "SortSamplesInMortonOrder", this->GetComponentLabel(), level, 0);
+  this->GetAsITKBaseType()->SetSortSamplesInMortonOrder(sortSamplesInMortonOrder);
+
+  /** Set the fraction of the samples that is replaced by new samples. */
+  double sampleRefreshFraction = 1.0;
+  this->m_Configuration->ReadParameter(
+    sampleRefreshFraction, "SampleRefreshFraction", this->GetComponentLabel(), level, 0);
+  this->GetAsITKBaseType()->SetSampleRefreshFraction(sampleRefreshFraction);
+
+  /** Let the optimizer adapt the number of samples or not. */
+  std::string numberOfSamplesColumn = "NumberOfSamples";
+  numberOfSamplesColumn += this->GetComponentLabel();
+  this->RemoveTargetCellFromIterationInfo(numberOfSamplesColumn.c_str());
+  this->m_MinimumNumberOfSpatialSamples = 0;
+  this->m_MaximumNumberOfSpatialSamples = 0;
+  this->m_Configuration->ReadParameter(
+    this->m_MaximumNumberOfSpatialSamples, "MaximumNumberOfSpatialSamples", this->GetComponentLabel(), level, 0, false);
+  if (this->m_MaximumNumberOfSpatialSamples > 0)
+  {
+    this->AddTargetCellToIterationInfo(numberOfSamplesColumn.c_str());
+  }
+
   /** Temporary?: Use the multi-threaded version or not. */
   std::string useMultiThread = this->m_Configuration->GetCommandLineArgument("-mts"); // mts: multi-threaded samplers
   if (useMultiThread == "true")
@@ -65,6 +96,207 @@ ImageSamplerBase<TElastix>::BeforeEachResolutionBase(void)
 } // end BeforeEachResolutionBase()
 
 
+/**
+ * ******************* AfterEachIterationBase ******************
+ */
+
+template <class TElastix>
+void
+ImageSamplerBase<TElastix>::AfterEachIterationBase(void)
+{
+  if (this->m_MaximumNumberOfSpatialSamples > 0)
+  {
+    std::string numberOfSamplesColumn = "NumberOfSamples";
+    numberOfSamplesColumn += this->GetComponentLabel();
+    this->GetIterationInfoAt(numberOfSamplesColumn.c_str()) << this->GetAsITKBaseType()->GetNumberOfSamples();
+  }
+
+} // end AfterEachIterationBase()
+
+
+/**
+ * ******************* AdaptNumberOfSpatialSamples ******************
+ */
+
+template <class TElastix>
+void
+ImageSamplerBase<TElastix>::AdaptNumberOfSpatialSamples(const double noiseLevel)
+{
+  if (this->m_MaximumNumberOfSpatialSamples == 0)
+  {
+    return;
+  }
+
+  /** The number of samples that the sampler got from NumberOfSpatialSamples. */
+  if (this->m_MinimumNumberOfSpatialSamples == 0)
+  {
+    this->m_MinimumNumberOfSpatialSamples = this->GetAsITKBaseType()->GetNumberOfSamples();
+  }
+  if (this->m_MaximumNumberOfSpatialSamples <= this->m_MinimumNumberOfSpatialSamples)
+  {
+    return;
+  }
+
+  /** Interpolate linearly between the minimum and the maximum. */
+  const double        clampedNoiseLevel = std::max(0.0, std::min(noiseLevel, 1.0));
+  const unsigned long range = this->m_MaximumNumberOfSpatialSamples - this->m_MinimumNumberOfSpatialSamples;
+  this->GetAsITKBaseType()->SetNumberOfSamples(this->m_MinimumNumberOfSpatialSamples +
+                                               static_cast<unsigned long>(clampedNoiseLevel * range + 0.5));
+
+} // end AdaptNumberOfSpatialSamples()
+
+
+/**
+ * ******************* ReadRandomSamplerParameters ******************
+ */
+
+template <class TElastix>
+template <class TRandomSampler>
+void
+ImageSamplerBase<TElastix>::ReadRandomSamplerParameters(TRandomSampler & sampler)
+{
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** Set the NumberOfSpatialSamples. */
+  unsigned long numberOfSpatialSamples = 5000;
+  this->m_Configuration->ReadParameter(
+    numberOfSpatialSamples, "NumberOfSpatialSamples", this->GetComponentLabel(), level, 0);
+  sampler.SetNumberOfSamples(numberOfSpatialSamples);
+
+  /** Set the UseCounterBasedRandomNumbers bool, and seed it with the RandomSeed. */
+  bool useCounterBasedRandomNumbers = false;
+  this->m_Configuration->ReadParameter(
+    useCounterBasedRandomNumbers, "UseCounterBasedRandomNumbers", this->GetComponentLabel(), level, 0);
+  sampler.SetUseCounterBasedRandomNumbers(useCounterBasedRandomNumbers);
+  unsigned int randomSeed = 121212;
+  this->m_Configuration->ReadParameter(randomSeed, "RandomSeed", 0, false);
+  sampler.SetRandomSeed(randomSeed);
+
+} // end ReadRandomSamplerParameters()
+
+
+/**
+ * ******************* ReadRandomCoordinateSamplerParameters ******************
+ */
+
+template <class TElastix>
+template <class TRandomCoordinateSampler>
+void
+ImageSamplerBase<TElastix>::ReadRandomCoordinateSamplerParameters(TRandomCoordinateSampler & sampler)
+{
+  typedef typename TRandomCoordinateSampler::CoordRepType            CoordRepType;
+  typedef typename TRandomCoordinateSampler::DefaultInterpolatorType DefaultInterpolatorType;
+  typedef typename TRandomCoordinateSampler::InputImageSpacingType   InputImageSpacingType;
+  typedef typename TRandomCoordinateSampler::InputImageSizeType      InputImageSizeType;
+  typedef typename TRandomCoordinateSampler::TileCacheType           TileCacheType;
+  const unsigned int InputImageDimension = TRandomCoordinateSampler::InputImageDimension;
+
+  this->ReadRandomSamplerParameters(sampler);
+
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** Set up the fixed image interpolator and set the SplineOrder, default value = 1. */
+  unsigned int splineOrder = 1;
+  this->m_Configuration->ReadParameter(
+    splineOrder, "FixedImageBSplineInterpolationOrder", this->GetComponentLabel(), level, 0);
+  if (splineOrder == 1)
+  {
+    typedef itk::LinearInterpolateImageFunction<InputImageType, CoordRepType> LinearInterpolatorType;
+    typename LinearInterpolatorType::Pointer fixedImageLinearInterpolator = LinearInterpolatorType::New();
+    sampler.SetInterpolator(fixedImageLinearInterpolator);
+  }
+  else
+  {
+    typename DefaultInterpolatorType::Pointer fixedImageBSplineInterpolator = DefaultInterpolatorType::New();
+    fixedImageBSplineInterpolator->SetSplineOrder(splineOrder);
+    sampler.SetInterpolator(fixedImageBSplineInterpolator);
+  }
+
+  /** Set the UseRandomSampleRegion bool. */
+  bool useRandomSampleRegion = false;
+  this->m_Configuration->ReadParameter(
+    useRandomSampleRegion, "UseRandomSampleRegion", this->GetComponentLabel(), level, 0);
+  sampler.SetUseRandomSampleRegion(useRandomSampleRegion);
+
+  /** Set the SampleRegionSize. */
+  if (useRandomSampleRegion)
+  {
+    InputImageSpacingType sampleRegionSize;
+    InputImageSpacingType fixedImageSpacing = this->GetElastix()->GetFixedImage()->GetSpacing();
+    InputImageSizeType    fixedImageSize = this->GetElastix()->GetFixedImage()->GetLargestPossibleRegion().GetSize();
+
+    /** Estimate default:
+     * sampleRegionSize[i] = min ( fixedImageSizeInMM[i], max_i ( fixedImageSizeInMM[i]/3 ) )
+     */
+    double maxthird = 0.0;
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      sampleRegionSize[i] = (fixedImageSize[i] - 1) * fixedImageSpacing[i];
+      maxthird = std::max(maxthird, sampleRegionSize[i] / 3.0);
+    }
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      sampleRegionSize[i] = std::min(maxthird, sampleRegionSize[i]);
+    }
+
+    /** Read and check user's choice. */
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      this->m_Configuration->ReadParameter(
+        sampleRegionSize[i], "SampleRegionSize", this->GetComponentLabel(), level * InputImageDimension + i, 0);
+    }
+    sampler.SetSampleRegionSize(sampleRegionSize);
+
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      if (sampleRegionSize[i] > (fixedImageSize[i] - 1) * fixedImageSpacing[i])
+      {
+        itkExceptionMacro(<< "ERROR: in your parameter file you selected\n"
+                          << "  SampleRegionSize[ " << i << " ] = " << sampleRegionSize[i]
+                          << " mm,\n  while the fixed image size at dim = " << i << " is " << fixedImageSize[i]
+                          << " voxels or " << fixedImageSize[i] * fixedImageSpacing[i] << " mm.\n"
+                          << "  Please select a smaller SampleRegionSize!\n"
+                          << "  It is recommended to be not larger than 1/3 of the image size in mm.");
+      }
+    }
+  }
+
+  /** Set up the tile cache, from which the sample values are read instead of from the fixed image. */
+  std::string tileFileName = "";
+  this->m_Configuration->ReadParameter(tileFileName, "FixedImageTileFileName", this->GetComponentLabel(), level, 0);
+  if (tileFileName.empty())
+  {
+    sampler.SetTileCache(nullptr);
+  }
+  else
+  {
+    typename TileCacheType::SizeType tileSize;
+    tileSize.Fill(128);
+    for (unsigned int i = 0; i < InputImageDimension; ++i)
+    {
+      this->m_Configuration->ReadParameter(tileSize[i], "FixedImageTileSize", this->GetComponentLabel(), i, 0);
+    }
+    itk::SizeValueType maximumNumberOfTiles = 256;
+    this->m_Configuration->ReadParameter(
+      maximumNumberOfTiles, "MaximumNumberOfFixedImageTiles", this->GetComponentLabel(), 0, 0);
+
+    /** Keep the tiles of the previous resolution, if they are from the same file. */
+    TileCacheType * tileCache = sampler.GetModifiableTileCache();
+    if (tileCache == nullptr || tileCache->GetFileName() != tileFileName || tileCache->GetTileSize() != tileSize)
+    {
+      typename TileCacheType::Pointer newTileCache = TileCacheType::New();
+      newTileCache->SetFileName(tileFileName);
+      newTileCache->SetTileSize(tileSize);
+      newTileCache->Initialize();
+      sampler.SetTileCache(newTileCache);
+      tileCache = newTileCache;
+    }
+    tileCache->SetMaximumNumberOfTiles(maximumNumberOfTiles);
+  }
+
+} // end ReadRandomCoordinateSamplerParameters()
+
+
 } // end namespace elastix
 
 #endif //#ifndef elxImageSamplerBase_hxx
@@ -82,6 +82,15 @@ public:
   }
 
 
+  /** Create an independent copy of this interpolator, with the label of interpolator
+   * interpolatorIndex, for a copy of a metric that is evaluated concurrently, see
+   * MetricBase::CreateWorkUnitCostFunction(). The copy reads its settings in its
+   * BeforeEachResolution(); the metric sets its input image. Returns null when the
+   * interpolator cannot be copied.
+   */
+  virtual typename ITKBaseType::Pointer
+  CreateWorkUnitInterpolator(const unsigned int interpolatorIndex) const;
+
 protected:
   /** The constructor. */
   InterpolatorBase() = default;
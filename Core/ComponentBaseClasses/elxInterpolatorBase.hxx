@@ -21,6 +21,34 @@
 
 #include "elxInterpolatorBase.h"
 
-// nothing
+namespace elastix
+{
+
+/**
+ * ******************* CreateWorkUnitInterpolator ********************
+ */
+
+template <class TElastix>
+typename InterpolatorBase<TElastix>::ITKBaseType::Pointer
+InterpolatorBase<TElastix>::CreateWorkUnitInterpolator(const unsigned int interpolatorIndex) const
+{
+  /** Create another instance of this component. */
+  const itk::LightObject::Pointer anotherObject = this->GetSelf().CreateAnother();
+  Self * const                    copy = dynamic_cast<Self *>(anotherObject.GetPointer());
+  if (copy == nullptr)
+  {
+    return nullptr;
+  }
+
+  /** Let it read its settings, like the original did. */
+  copy->SetElastix(this->GetElastix());
+  copy->SetComponentLabel("Interpolator", interpolatorIndex);
+  copy->BeforeEachResolution();
+
+  return copy->GetAsITKBaseType();
+
+} // end CreateWorkUnitInterpolator()
+
+} // end namespace elastix
 
 #endif //#ifndef elxInterpolatorBase_hxx
@@ -23,6 +23,8 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkAdvancedImageToImageMetric.h"
+#include "itkWorkUnitCostFunction.h"
+#include "itkSingleValuedPointSetToPointSetMetric.h"
 #include "itkImageGridSampler.h"
 #include "itkPointSet.h"
 
@@ -63,6 +65,82 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter MetricThreadingBackend: Selects how the multi-threaded metric computations
+ *    are executed. "Pool" runs them as tasks on the persistent ITK thread pool, which is
+ *    shared with the other multi-threaded parts of elastix and ITK, see itk::ParallelTasks,
+ *    while "Platform" spawns and joins threads for every metric evaluation. Can be given
+ *    for each resolution. \n
+ *    example: <tt>(MetricThreadingBackend "Platform")</tt> \n
+ *    The default is "Pool".
+ * \parameter UseDynamicSampleScheduling: Whether the threads claim small chunks of samples
+ *    from a shared counter, instead of each processing one fixed block of samples. This
+ *    balances the load when many samples are rejected, e.g. by a moving mask. Supported by
+ *    the AdvancedMeanSquares, AdvancedMattesMutualInformation, AdvancedNormalizedCorrelation
+ *    and AdvancedKappaStatistic metrics. Can be given for each resolution. \n
+ *    example: <tt>(UseDynamicSampleScheduling "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseDistributedSampleEvaluation: Whether each process evaluates only its part of the
+ *    samples, when elastix is built with ELASTIX_USE_MPI and started on several processes, e.g. by
+ *    <tt>mpiexec -n 4 elastix ...</tt>. The values and derivatives of all processes are then added,
+ *    and the optimizer runs identically on every process. Requires "UseMultiThreadingForMetrics".
+ *    Supported by the AdvancedMeanSquares metric. Can be given for each resolution. \n
+ *    example: <tt>(UseDistributedSampleEvaluation "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseDeterministicReduction: Whether the contributions of the samples to the value and
+ *    the derivative are stored per sample, in blocks of 8192 samples, and added in sample order.
+ *    The results then no longer depend on the number of threads or on the sample scheduling, so
+ *    that runs on different machines give identical results. Requires "UseMultiThreadingForMetrics".
+ *    Supported by the AdvancedMeanSquares metric. Can be given for each resolution. \n
+ *    example: <tt>(UseDeterministicReduction "true")</tt> \n
+ *    The default is "false".
+ * \parameter MinimumNumberOfSamplesPerThread: Automatically reduces the number of threads
+ *    of the metric in a resolution, such that each thread processes at least this number of
+ *    samples. The maximum is still the number of threads given by "-threads". Few samples
+ *    spread over many threads make the thread overhead and the accumulation of the per-thread
+ *    derivatives dominate, and oversubscribe the machine when several jobs share it. Can be
+ *    given for each resolution. \n
+ *    example: <tt>(MinimumNumberOfSamplesPerThread 1000)</tt> \n
+ *    The default is 0, which means that all threads are used.
+ * \parameter UseSampleArrays: Whether the threads read the fixed image samples from a
+ *    structure-of-arrays copy of the sample container, with contiguous coordinate and value
+ *    arrays, instead of from the array of samples. Supported by the AdvancedMeanSquares and
+ *    AdvancedMattesMutualInformation metrics. Can be given for each resolution. \n
+ *    example: <tt>(UseSampleArrays "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseImplicitSamples: Whether a Grid or Full image sampler passes its samples
+ *    implicitly, as a lattice of voxels, instead of storing a point and a value for every
+ *    sample. The threads then compute the samples on the fly, which saves the memory of the
+ *    sample container. Only used without a fixed image mask, and supported by the multi-threaded
+ *    AdvancedMeanSquares metric. Can be given for each resolution. \n
+ *    example: <tt>(UseImplicitSamples "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseValueAndGradientImage: Whether the moving image values and gradients are
+ *    packed into one float image, when the metric precomputes the moving image gradients,
+ *    which is the case for interpolators that provide no derivatives, such as the nearest
+ *    neighbor interpolator. A sample then reads its gradient, and with a nearest neighbor
+ *    interpolator also its value, in a single look-up. Can be given for each resolution. \n
+ *    example: <tt>(UseValueAndGradientImage "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseLinearTransformSampleRejection: Whether samples are rejected before they are
+ *    transformed, when the transform is linear (e.g. in a rigid or affine stage). Samples that
+ *    the transform maps outside the moving image, or outside the bounding box of the moving mask,
+ *    are then not transformed and not interpolated; the metric value does not change. Used by the
+ *    multi-threaded AdvancedMeanSquares and Parzen window metrics. The fraction of rejected samples
+ *    is shown in the column "RejectedSamples<i>" of the iteration info. Can be given for each resolution. \n
+ *    example: <tt>(UseLinearTransformSampleRejection "true")</tt> \n
+ *    The default is "false".
+ * \parameter CollectThreadStatistics: Whether the time that each thread spends in the metric
+ *    evaluations is measured, together with the number of samples it processed and rejected.
+ *    After each resolution, these are written to the log, and to the timings (see WriteTimings),
+ *    as "Resolution<r>.Metric<i>.Thread<t>.BusyTime" etc., with the load imbalance ratio of each
+ *    block of iterations: the summed busy time of the slowest thread divided by the summed mean
+ *    busy time. Can be given for each resolution. \n
+ *    example: <tt>(CollectThreadStatistics "true")</tt> \n
+ *    The default is "false".
+ * \parameter ThreadStatisticsBlockSize: The number of metric evaluations per block of the load
+ *    imbalance ratios, when CollectThreadStatistics is "true". Can be given for each resolution. \n
+ *    example: <tt>(ThreadStatisticsBlockSize 100)</tt> \n
+ *    The default is 50.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
@@ -125,6 +203,7 @@ public:
                                                      CoordinateRepresentationType,
                                                      CoordinateRepresentationType>>
     MovingPointSetType;
+  typedef itk::SingleValuedPointSetToPointSetMetric<FixedPointSetType, MovingPointSetType> PointSetMetricType;
 
   /** Typedefs for sampler support. */
   typedef typename AdvancedMetricType::ImageSamplerType ImageSamplerBaseType;
@@ -161,6 +240,12 @@ public:
   void
   AfterEachIterationBase(void) override;
 
+  /** Execute stuff after each resolution:
+   * \li Report the statistics of the threads, if they were collected.
+   */
+  void
+  AfterEachResolutionBase(void) override;
+
   /** Force the metric to base its computation on a new subset of image samples.
    * Not every metric may have implemented this.
    */
@@ -187,6 +272,26 @@ public:
   virtual ImageSamplerBaseType *
   GetAdvancedMetricImageSampler(void) const;
 
+  /** Create an independent copy of this metric, for one work unit of an optimizer that
+   * evaluates several positions concurrently, see itk::ParallelEvaluationOptimizer.
+   * The copy has its own transform, a clone of the current transform on top of the
+   * shared initial transform, and its own interpolator. It shares the images, the masks
+   * and the image sampler, which must be updated single-threaded before the concurrent
+   * evaluation, see UpdateImageSamplerForWorkUnits(). The copy reads the settings of this
+   * metric in its BeforeRegistration() and BeforeEachResolution(), and is initialized, so
+   * it must be created after this metric has been initialized, e.g. when the optimization
+   * starts. Returns null when the metric, its transform or its interpolator cannot be
+   * copied: only advanced metrics that support a concurrent evaluation are copied.
+   */
+  virtual typename ITKBaseType::Pointer
+  CreateWorkUnitCostFunction(const unsigned int metricIndex);
+
+  /** Update the image sampler that the copies of CreateWorkUnitCostFunction() share with
+   * this metric. Should be called single-threaded, before every concurrent evaluation.
+   */
+  virtual void
+  UpdateImageSamplerForWorkUnits(void);
+
   /** Get if the exact metric value is computed */
   virtual bool
   GetShowExactMetricValue(void) const
@@ -234,6 +339,7 @@ protected:
   MeasureType                      m_CurrentExactMetricValue;
   ExactMetricSampleGridSpacingType m_ExactMetricSampleGridSpacing;
   unsigned int                     m_ExactMetricEachXNumberOfIterations;
+  bool                             m_ShowRejectedSampleFraction;
 
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
@@ -20,6 +20,8 @@
 
 #include "elxMetricBase.h"
 
+#include <algorithm> // For min.
+
 namespace elastix
 {
 
@@ -36,6 +38,7 @@ MetricBase<TElastix>::MetricBase()
   this->m_CurrentExactMetricValue = 0.0;
   this->m_ExactMetricSampleGridSpacing.Fill(1);
   this->m_ExactMetricEachXNumberOfIterations = 1;
+  this->m_ShowRejectedSampleFraction = false;
 
 } // end Constructor
 
@@ -95,6 +98,12 @@ MetricBase<TElastix>::BeforeEachResolutionBase(void)
     this->m_ExactMetricEachXNumberOfIterations = eachXNumberOfIterations;
   }
 
+  /** Define the name of the RejectedSamples column, and remove it, if it already existed. */
+  std::string rejectedSamplesColumn = "RejectedSamples";
+  rejectedSamplesColumn += this->GetComponentLabel();
+  this->RemoveTargetCellFromIterationInfo(rejectedSamplesColumn.c_str());
+  this->m_ShowRejectedSampleFraction = false;
+
   /** Cast this to AdvancedMetricType. */
   AdvancedMetricType * thisAsAdvanced = dynamic_cast<AdvancedMetricType *>(this);
 
@@ -166,10 +175,115 @@ MetricBase<TElastix>::BeforeEachResolutionBase(void)
         const unsigned int nrOfThreads = atoi(tmp.c_str());
         thisAsAdvanced->SetNumberOfWorkUnits(nrOfThreads);
       }
+
+      /** Which threading backend should execute the multi-threaded metric code? */
+      std::string threadingBackend = "Pool";
+      this->GetConfiguration()->ReadParameter(
+        threadingBackend, "MetricThreadingBackend", this->GetComponentLabel(), level, 0);
+      if (threadingBackend == "Pool")
+      {
+        thisAsAdvanced->SetUseThreadPool(true);
+      }
+      else if (threadingBackend == "Platform")
+      {
+        thisAsAdvanced->SetUseThreadPool(false);
+      }
+      else
+      {
+        itkExceptionMacro(<< "ERROR: The MetricThreadingBackend \"" << threadingBackend
+                          << "\" is not supported. Choose \"Platform\" or \"Pool\".");
+      }
+
+      /** Should the number of threads be limited to the number of samples? */
+      unsigned long minimumNumberOfSamplesPerThread = 0;
+      this->GetConfiguration()->ReadParameter(
+        minimumNumberOfSamplesPerThread, "MinimumNumberOfSamplesPerThread", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetMinimumNumberOfSamplesPerThread(minimumNumberOfSamplesPerThread);
+
+      /** Should the samples be distributed dynamically over the threads? */
+      bool useDynamicSampleScheduling = false;
+      this->GetConfiguration()->ReadParameter(
+        useDynamicSampleScheduling, "UseDynamicSampleScheduling", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetUseDynamicSampleScheduling(useDynamicSampleScheduling);
+
+      /** Should the samples be distributed over the MPI processes? */
+      bool useDistributedSampleEvaluation = false;
+      this->GetConfiguration()->ReadParameter(
+        useDistributedSampleEvaluation, "UseDistributedSampleEvaluation", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetUseDistributedSampleEvaluation(useDistributedSampleEvaluation);
+
+      /** Should the sample contributions be added in a thread-count independent order? */
+      bool useDeterministicReduction = false;
+      this->GetConfiguration()->ReadParameter(
+        useDeterministicReduction, "UseDeterministicReduction", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetUseDeterministicReduction(useDeterministicReduction);
+      if (useDeterministicReduction && !thisAsAdvanced->GetDeterministicReductionSupported())
+      {
+        xl::xout["warning"] << "WARNING: The UseDeterministicReduction option was set to \"true\", but "
+                            << this->GetComponentLabel()
+                            << " does not support it. The sample contributions are added per thread." << std::endl;
+      }
+
+      /** Should the threads read the samples from a structure of arrays? */
+      bool useSampleArrays = false;
+      this->GetConfiguration()->ReadParameter(useSampleArrays, "UseSampleArrays", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetUseSampleArrays(useSampleArrays);
+
+      /** Should a grid or full sampler pass its samples implicitly? */
+      bool useImplicitSamples = false;
+      this->GetConfiguration()->ReadParameter(
+        useImplicitSamples, "UseImplicitSamples", this->GetComponentLabel(), level, 0);
+      thisAsAdvanced->SetUseImplicitSamples(useImplicitSamples);
+    }
+
+    /** Should the moving image values and gradients be packed into one image? */
+    bool useValueAndGradientImage = false;
+    this->GetConfiguration()->ReadParameter(
+      useValueAndGradientImage, "UseValueAndGradientImage", this->GetComponentLabel(), level, 0);
+    thisAsAdvanced->SetUseValueAndGradientImage(useValueAndGradientImage);
+
+    /** Should samples be rejected before they are transformed, for linear transforms? */
+    bool useLinearTransformSampleRejection = false;
+    this->GetConfiguration()->ReadParameter(
+      useLinearTransformSampleRejection, "UseLinearTransformSampleRejection", this->GetComponentLabel(), level, 0);
+    thisAsAdvanced->SetUseLinearTransformSampleRejection(useLinearTransformSampleRejection);
+    this->m_ShowRejectedSampleFraction = useLinearTransformSampleRejection;
+    if (useLinearTransformSampleRejection)
+    {
+      this->AddTargetCellToIterationInfo(rejectedSamplesColumn.c_str());
+      this->GetIterationInfoAt(rejectedSamplesColumn.c_str()) << std::showpoint << std::fixed;
     }
 
+    /** Should the statistics of the threads be collected? */
+    bool collectThreadStatistics = false;
+    this->GetConfiguration()->ReadParameter(
+      collectThreadStatistics, "CollectThreadStatistics", this->GetComponentLabel(), level, 0);
+    unsigned long threadStatisticsBlockSize = 50;
+    this->GetConfiguration()->ReadParameter(
+      threadStatisticsBlockSize, "ThreadStatisticsBlockSize", this->GetComponentLabel(), level, 0);
+    thisAsAdvanced->SetUseThreadStatistics(collectThreadStatistics);
+    thisAsAdvanced->SetThreadStatisticsBlockSize(threadStatisticsBlockSize);
+    thisAsAdvanced->ResetThreadStatistics();
+
   } // end advanced metric
 
+  /** Point set metrics may divide their loops over the points among threads. */
+  PointSetMetricType * thisAsPointSetMetric = dynamic_cast<PointSetMetricType *>(this);
+  if (thisAsPointSetMetric != nullptr)
+  {
+    bool useMultiThreading = true;
+    this->GetConfiguration()->ReadParameter(
+      useMultiThreading, "UseMultiThreadingForMetrics", this->GetComponentLabel(), level, 0);
+    thisAsPointSetMetric->SetUseMultiThread(useMultiThreading);
+
+    std::string tmp = this->m_Configuration->GetCommandLineArgument("-threads");
+    if (!tmp.empty())
+    {
+      const unsigned int nrOfThreads = atoi(tmp.c_str());
+      thisAsPointSetMetric->SetNumberOfWorkUnits(nrOfThreads);
+    }
+  }
+
 } // end BeforeEachResolutionBase()
 
 
@@ -197,9 +311,67 @@ MetricBase<TElastix>::AfterEachIterationBase(void)
     this->GetIterationInfoAt(exactMetricColumn.c_str()) << this->m_CurrentExactMetricValue;
   }
 
+  /** Show the fraction of the samples that were rejected before being transformed. */
+  const AdvancedMetricType * thisAsAdvanced = dynamic_cast<const AdvancedMetricType *>(this);
+  if (this->m_ShowRejectedSampleFraction && thisAsAdvanced != nullptr)
+  {
+    std::string rejectedSamplesColumn = "RejectedSamples";
+    rejectedSamplesColumn += this->GetComponentLabel();
+    this->GetIterationInfoAt(rejectedSamplesColumn.c_str()) << thisAsAdvanced->GetRejectedSampleFraction();
+  }
+
 } // end AfterEachIterationBase()
 
 
+/**
+ * ******************* AfterEachResolutionBase ******************
+ */
+
+template <class TElastix>
+void
+MetricBase<TElastix>::AfterEachResolutionBase(void)
+{
+  const AdvancedMetricType * thisAsAdvanced = dynamic_cast<const AdvancedMetricType *>(this);
+  if (thisAsAdvanced == nullptr || !thisAsAdvanced->GetUseThreadStatistics())
+  {
+    return;
+  }
+
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+  const std::string  prefix = "Resolution" + std::to_string(level) + "." + this->GetComponentLabel() + ".";
+
+  /** Report the busy time and the samples of each thread. */
+  const auto & threadStatistics = thisAsAdvanced->GetThreadStatistics();
+  elxout << "Thread statistics of " << this->GetComponentLabel() << " in resolution " << level << ":\n";
+  for (std::size_t i = 0; i < threadStatistics.size(); ++i)
+  {
+    const auto &        statistics = threadStatistics[i];
+    const std::string   threadName = prefix + "Thread" + std::to_string(i) + ".";
+    const unsigned long numberOfSamples = statistics.m_NumberOfSamples;
+    const double        timePerSample =
+      numberOfSamples > 0 ? statistics.m_BusyTime / static_cast<double>(numberOfSamples) : 0.0;
+
+    elxout << "  thread " << i << ": busy " << statistics.m_BusyTime << " s, " << numberOfSamples << " samples, "
+           << statistics.m_NumberOfRejectedSamples << " rejected, " << 1.0e6 * timePerSample
+           << " microseconds per sample\n";
+    this->m_Elastix->AddTiming(threadName + "BusyTime", statistics.m_BusyTime);
+    this->m_Elastix->AddTiming(threadName + "Samples", numberOfSamples);
+    this->m_Elastix->AddTiming(threadName + "RejectedSamples", statistics.m_NumberOfRejectedSamples);
+  }
+
+  /** Report the load imbalance ratio of each block of iterations. */
+  const std::vector<double> imbalanceRatios = thisAsAdvanced->GetThreadImbalanceRatios();
+  for (std::size_t k = 0; k < imbalanceRatios.size(); ++k)
+  {
+    elxout << "  load imbalance ratio of block " << k << ": " << imbalanceRatios[k] << "\n";
+    this->m_Elastix->AddTiming(prefix + "ImbalanceRatio.Block" + std::to_string(k), imbalanceRatios[k]);
+  }
+
+  thisAsAdvanced->ResetThreadStatistics();
+
+} // end AfterEachResolutionBase()
+
+
 /**
  * ********************* SelectNewSamples ************************
  */
@@ -226,6 +398,135 @@ MetricBase<TElastix>::SelectNewSamples(void)
 } // end SelectNewSamples()
 
 
+/**
+ * ******************* CreateWorkUnitCostFunction ********************
+ */
+
+template <class TElastix>
+typename MetricBase<TElastix>::ITKBaseType::Pointer
+MetricBase<TElastix>::CreateWorkUnitCostFunction(const unsigned int metricIndex)
+{
+  typedef typename AdvancedMetricType::CombinationTransformType   CombinationTransformType;
+  typedef typename CombinationTransformType::CurrentTransformType CurrentTransformType;
+  typedef typename CombinationTransformType::InitialTransformType InitialTransformType;
+  typedef itk::WorkUnitCostFunction<AdvancedMetricType>           WorkUnitCostFunctionType;
+
+  /** Only metrics that set the transform and update the sampler in
+   * BeforeThreadedGetValueAndDerivative() only can be evaluated concurrently.
+   */
+  AdvancedMetricType * const thisAsAdvanced = dynamic_cast<AdvancedMetricType *>(this);
+  if (thisAsAdvanced == nullptr || !thisAsAdvanced->GetConcurrentEvaluationSupported())
+  {
+    return nullptr;
+  }
+
+  /** Clone the current transform. The initial transform is shared; it is only read. */
+  const auto * const transform = dynamic_cast<const CombinationTransformType *>(thisAsAdvanced->GetTransform());
+  if (transform == nullptr || transform->GetCurrentTransform() == nullptr)
+  {
+    return nullptr;
+  }
+  const typename CurrentTransformType::Pointer currentTransform =
+    dynamic_cast<CurrentTransformType *>(transform->GetCurrentTransform()->Clone().GetPointer());
+  if (currentTransform.IsNull() || currentTransform->GetNumberOfParameters() != transform->GetNumberOfParameters())
+  {
+    return nullptr;
+  }
+  const typename CombinationTransformType::Pointer copyTransform = CombinationTransformType::New();
+  copyTransform->SetUseComposition(transform->GetUseComposition());
+  copyTransform->SetCurrentTransform(currentTransform);
+  copyTransform->SetInitialTransform(const_cast<InitialTransformType *>(transform->GetInitialTransform()));
+  if (transform->GetInitialTransformIsFlattened())
+  {
+    copyTransform->FlattenInitialTransform();
+  }
+
+  /** Copy the interpolator of this metric. */
+  const unsigned int numberOfInterpolators = this->m_Elastix->GetNumberOfInterpolators();
+  if (numberOfInterpolators == 0)
+  {
+    return nullptr;
+  }
+  const unsigned int interpolatorIndex = std::min(metricIndex, numberOfInterpolators - 1);
+  const auto         interpolator =
+    this->m_Elastix->GetElxInterpolatorBase(interpolatorIndex)->CreateWorkUnitInterpolator(interpolatorIndex);
+  if (interpolator.IsNull())
+  {
+    return nullptr;
+  }
+
+  /** Create another instance of this component, which reads its settings like this metric. */
+  const itk::LightObject::Pointer anotherObject = this->GetSelf().CreateAnother();
+  Self * const                    copy = dynamic_cast<Self *>(anotherObject.GetPointer());
+  AdvancedMetricType * const      copyAsAdvanced = dynamic_cast<AdvancedMetricType *>(anotherObject.GetPointer());
+  if (copy == nullptr || copyAsAdvanced == nullptr)
+  {
+    return nullptr;
+  }
+  copy->SetElastix(this->GetElastix());
+  copy->SetComponentLabel("Metric", metricIndex);
+  copy->BeforeRegistration();
+  copy->BeforeEachResolution();
+
+  /** Copy the settings of BeforeEachResolutionBase(), which has effects on the iteration info.
+   * The copy evaluates its samples in the calling work unit, and leaves the transform and the
+   * sampler alone, so that the work units do not interfere. It reads the samples from the
+   * sample container, of which the structure-of-arrays copy is not thread-safe to fill.
+   */
+  copyAsAdvanced->SetRequiredRatioOfValidSamples(thisAsAdvanced->GetRequiredRatioOfValidSamples());
+  copyAsAdvanced->SetUseMovingImageDerivativeScales(thisAsAdvanced->GetUseMovingImageDerivativeScales());
+  copyAsAdvanced->SetMovingImageDerivativeScales(thisAsAdvanced->GetMovingImageDerivativeScales());
+  copyAsAdvanced->SetScaleGradientWithRespectToMovingImageOrientation(
+    thisAsAdvanced->GetScaleGradientWithRespectToMovingImageOrientation());
+  copyAsAdvanced->SetUseMultiThread(thisAsAdvanced->GetUseMultiThread());
+  copyAsAdvanced->SetNumberOfWorkUnits(1);
+  copyAsAdvanced->SetUseThreadPool(true);
+  copyAsAdvanced->SetUseDeterministicReduction(thisAsAdvanced->GetUseDeterministicReduction());
+  copyAsAdvanced->SetUseSampleArrays(false);
+  copyAsAdvanced->SetUseImplicitSamples(thisAsAdvanced->GetUseImplicitSamples());
+  copyAsAdvanced->SetUseValueAndGradientImage(thisAsAdvanced->GetUseValueAndGradientImage());
+  copyAsAdvanced->SetUseLinearTransformSampleRejection(thisAsAdvanced->GetUseLinearTransformSampleRejection());
+  copyAsAdvanced->SetUseMetricSingleThreaded(false);
+
+  /** Connect the inputs, like the registration does, and initialize the copy. */
+  copyAsAdvanced->SetFixedImage(thisAsAdvanced->GetFixedImage());
+  copyAsAdvanced->SetMovingImage(thisAsAdvanced->GetMovingImage());
+  copyAsAdvanced->SetFixedImageRegion(thisAsAdvanced->GetFixedImageRegion());
+  copyAsAdvanced->SetFixedImageMask(thisAsAdvanced->GetFixedImageMask());
+  copyAsAdvanced->SetMovingImageMask(thisAsAdvanced->GetMovingImageMask());
+  copyAsAdvanced->SetImageExtremaCache(thisAsAdvanced->GetModifiableImageExtremaCache());
+  copyAsAdvanced->SetTransform(copyTransform);
+  copyAsAdvanced->SetInterpolator(interpolator);
+  if (thisAsAdvanced->GetUseImageSampler())
+  {
+    copyAsAdvanced->SetImageSampler(thisAsAdvanced->GetImageSampler());
+  }
+  copyAsAdvanced->Initialize();
+
+  const typename WorkUnitCostFunctionType::Pointer workUnitCostFunction = WorkUnitCostFunctionType::New();
+  workUnitCostFunction->SetMetric(copyAsAdvanced);
+  return workUnitCostFunction.GetPointer();
+
+} // end CreateWorkUnitCostFunction()
+
+
+/**
+ * ******************* UpdateImageSamplerForWorkUnits ********************
+ */
+
+template <class TElastix>
+void
+MetricBase<TElastix>::UpdateImageSamplerForWorkUnits(void)
+{
+  ImageSamplerBaseType * const sampler = this->GetAdvancedMetricImageSampler();
+  if (sampler != nullptr)
+  {
+    sampler->Update();
+  }
+
+} // end UpdateImageSamplerForWorkUnits()
+
+
 /**
  * ********************* GetExactValue ************************
  */
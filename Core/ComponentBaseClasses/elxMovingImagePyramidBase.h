@@ -26,6 +26,7 @@
 #include "itkObject.h"
 
 #include "itkMultiResolutionPyramidImageFilter.h"
+#include "itkThreadBudget.h"
 
 namespace elastix
 {
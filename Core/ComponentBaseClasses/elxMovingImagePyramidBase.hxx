@@ -36,6 +36,9 @@ MovingImagePyramidBase<TElastix>::BeforeRegistrationBase(void)
   /** Call SetMovingSchedule.*/
   this->SetMovingSchedule();
 
+  /** Use the number of threads of this registration. */
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
+
 } // end BeforeRegistrationBase()
 
 
@@ -24,6 +24,9 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkOptimizer.h"
+#include "itkStochasticConvergenceMonitor.h"
+#include "itkSingleValuedCostFunction.h"
+#include <vector>
 
 namespace elastix
 {
@@ -44,6 +47,35 @@ namespace elastix
  *    Choose one from {"true", "false"} for every resolution.\n
  *    example: <tt>(NewSamplesEveryIteration "true" "true" "true")</tt> \n
  *    Default is "false" for every resolution.\n
+ * \parameter UseConvergenceDetection: if this flag is set to "true", the stochastic
+ *    optimizers (such as the AdaptiveStochasticGradientDescent) stop before the maximum
+ *    number of iterations, when the metric value and the gradient magnitude do not decrease
+ *    anymore. This is tested by a linear regression over a window of iterations, see
+ *    itk::StochasticConvergenceMonitor.\n
+ *    example: <tt>(UseConvergenceDetection "true" "true" "true")</tt> \n
+ *    Default is "false" for every resolution.\n
+ * \parameter ConvergenceWindowSize: the number of iterations in the regression window.\n
+ *    example: <tt>(ConvergenceWindowSize 100 100 200)</tt> \n
+ *    Default is 100 for every resolution.\n
+ * \parameter ConvergenceConfidence: the confidence with which the decrease over the next
+ *    window must be below the tolerance. Higher values stop later.\n
+ *    example: <tt>(ConvergenceConfidence 0.99)</tt> \n
+ *    Default is 0.95 for every resolution.\n
+ * \parameter ConvergenceRelativeTolerance: the tolerance on the decrease of the metric
+ *    value and the gradient magnitude over the next window, relative to their mean
+ *    absolute values in the window.\n
+ *    example: <tt>(ConvergenceRelativeTolerance 0.0001)</tt> \n
+ *    Default is 0.001 for every resolution.\n
+ * \parameter UseMultiThreadingForOptimizer: if this flag is set to "true", the optimizers
+ *    that evaluate several positions at once (such as the ParallelSimplex and the
+ *    ParallelPowell) evaluate them concurrently, each thread with its own copy of the
+ *    metric, the transform and the interpolator, see itk::ParallelEvaluationOptimizer.
+ *    The copies share the images, the masks and the image sampler, but every thread holds
+ *    the image derivatives of its own interpolator, when the interpolator has them. Only
+ *    used with a single metric that supports a concurrent evaluation; otherwise the
+ *    positions are evaluated one after the other.\n
+ *    example: <tt>(UseMultiThreadingForOptimizer "false")</tt> \n
+ *    Default is "true" for every resolution.\n
  *
  * \ingroup Optimizers
  * \ingroup ComponentBaseClasses
@@ -74,6 +106,9 @@ public:
   /** Typedef needed for the SetCurrentPositionPublic function. */
   typedef typename ITKBaseType::ParametersType ParametersType;
 
+  /** Independent copies of the metric, one for each work unit of a concurrent evaluation. */
+  typedef std::vector<itk::SingleValuedCostFunction::Pointer> WorkUnitCostFunctionContainerType;
+
   /** Retrieves this object as ITKBaseType. */
   ITKBaseType *
   GetAsITKBaseType(void)
@@ -128,6 +163,28 @@ protected:
   virtual bool
   GetNewSamplesEveryIteration(void) const;
 
+  /** Pass the value and gradient magnitude of an iteration to the convergence detection,
+   * and return whether the optimizer is converged. Always false when the user did not
+   * ask for convergence detection. Reports the detection to the log.
+   * Also returns true when the iteration callback asked to stop the registration.
+   */
+  virtual bool
+  TestForConvergence(const double value, const double gradientMagnitude);
+
+  /** Create a copy of the metric that is the costFunction of the optimizer, for each thread
+   * of the current thread budget, see MetricBase::CreateWorkUnitCostFunction(). Returns no
+   * copies when the user switched off UseMultiThreadingForOptimizer, when there is only one
+   * thread, or when the metric cannot be copied. Call when the optimization starts.
+   */
+  virtual WorkUnitCostFunctionContainerType
+  CreateWorkUnitCostFunctions(const itk::SingleValuedCostFunction * costFunction);
+
+  /** Update the image sampler that the copies of CreateWorkUnitCostFunctions() share with
+   * the metric. Call single-threaded, before every concurrent evaluation of the copies.
+   */
+  virtual void
+  UpdateWorkUnitCostFunctions(void);
+
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
@@ -141,6 +198,14 @@ private:
    * samples each iteration.
    */
   bool m_NewSamplesEveryIteration;
+
+  /** The convergence detection of the stochastic optimizers. */
+  bool                                       m_UseConvergenceDetection;
+  itk::StochasticConvergenceMonitor::Pointer m_ConvergenceMonitor;
+
+  /** The metric that was copied by the last CreateWorkUnitCostFunctions(). */
+  bool         m_HasWorkUnitCostFunctions;
+  unsigned int m_WorkUnitMetricIndex;
 };
 
 } // end namespace elastix
@@ -21,6 +21,7 @@
 #include "elxOptimizerBase.h"
 
 #include "itkSingleValuedNonLinearOptimizer.h"
+#include "itkThreadBudget.h"
 #include "itk_zlib.h"
 
 namespace elastix
@@ -34,6 +35,10 @@ template <class TElastix>
 OptimizerBase<TElastix>::OptimizerBase()
 {
   this->m_NewSamplesEveryIteration = false;
+  this->m_UseConvergenceDetection = false;
+  this->m_ConvergenceMonitor = itk::StochasticConvergenceMonitor::New();
+  this->m_HasWorkUnitCostFunctions = false;
+  this->m_WorkUnitMetricIndex = 0;
 
 } // end Constructor
 
@@ -75,6 +80,26 @@ OptimizerBase<TElastix>::BeforeEachResolutionBase(void)
   this->GetConfiguration()->ReadParameter(
     this->m_NewSamplesEveryIteration, "NewSamplesEveryIteration", this->GetComponentLabel(), level, 0);
 
+  /** Check if the optimizer should stop when it is converged. */
+  this->m_UseConvergenceDetection = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_UseConvergenceDetection, "UseConvergenceDetection", this->GetComponentLabel(), level, 0);
+
+  if (this->m_UseConvergenceDetection)
+  {
+    unsigned int windowSize = 100;
+    double       confidence = 0.95;
+    double       relativeTolerance = 0.001;
+    this->GetConfiguration()->ReadParameter(windowSize, "ConvergenceWindowSize", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(confidence, "ConvergenceConfidence", this->GetComponentLabel(), level, 0);
+    this->GetConfiguration()->ReadParameter(
+      relativeTolerance, "ConvergenceRelativeTolerance", this->GetComponentLabel(), level, 0);
+    this->m_ConvergenceMonitor->SetWindowSize(windowSize);
+    this->m_ConvergenceMonitor->SetConfidence(confidence);
+    this->m_ConvergenceMonitor->SetRelativeTolerance(relativeTolerance);
+  }
+  this->m_ConvergenceMonitor->Initialize();
+
 } // end BeforeEachResolutionBase()
 
 
@@ -140,6 +165,114 @@ OptimizerBase<TElastix>::GetNewSamplesEveryIteration(void) const
 } // end GetNewSamplesEveryIteration()
 
 
+/**
+ * ****************** TestForConvergence ********************
+ */
+
+template <class TElastix>
+bool
+OptimizerBase<TElastix>::TestForConvergence(const double value, const double gradientMagnitude)
+{
+  if (this->GetElastix()->GetRegistrationStopRequested())
+  {
+    elxout << "Stop requested by the iteration callback." << std::endl;
+    return true;
+  }
+
+  if (!this->m_UseConvergenceDetection)
+  {
+    return false;
+  }
+
+  if (!this->m_ConvergenceMonitor->AddIteration(value, gradientMagnitude))
+  {
+    return false;
+  }
+
+  elxout << "Convergence detected: over the next " << this->m_ConvergenceMonitor->GetWindowSize()
+         << " iterations, the metric value and the gradient magnitude decrease by at most "
+         << this->m_ConvergenceMonitor->GetRelativeValueDecrease() << " and "
+         << this->m_ConvergenceMonitor->GetRelativeGradientMagnitudeDecrease() << " (relative), with confidence "
+         << this->m_ConvergenceMonitor->GetConfidence() << "." << std::endl;
+  return true;
+
+} // end TestForConvergence()
+
+
+/**
+ * ****************** CreateWorkUnitCostFunctions ********************
+ */
+
+template <class TElastix>
+typename OptimizerBase<TElastix>::WorkUnitCostFunctionContainerType
+OptimizerBase<TElastix>::CreateWorkUnitCostFunctions(const itk::SingleValuedCostFunction * costFunction)
+{
+  this->m_HasWorkUnitCostFunctions = false;
+  WorkUnitCostFunctionContainerType copies;
+
+  /** Check if the user wants the positions to be evaluated concurrently. */
+  const unsigned int level = this->GetRegistration()->GetAsITKBaseType()->GetCurrentLevel();
+  bool               useMultiThreading = true;
+  this->GetConfiguration()->ReadParameter(
+    useMultiThreading, "UseMultiThreadingForOptimizer", this->GetComponentLabel(), level, 0);
+  const unsigned int numberOfThreads = itk::ThreadBudget::GetNumberOfThreads();
+  if (!useMultiThreading || numberOfThreads < 2)
+  {
+    return copies;
+  }
+
+  /** Find the metric that is the cost function, e.g. not a combination of metrics. */
+  unsigned int metricIndex = 0;
+  while (metricIndex < this->GetElastix()->GetNumberOfMetrics() &&
+         this->GetElastix()->GetElxMetricBase(metricIndex)->GetAsITKBaseType() != costFunction)
+  {
+    ++metricIndex;
+  }
+  if (metricIndex == this->GetElastix()->GetNumberOfMetrics())
+  {
+    xl::xout["warning"] << "WARNING: The optimizer evaluates the positions one after the other, "
+                        << "because the cost function is not a single metric." << std::endl;
+    return copies;
+  }
+
+  /** Copy the metric for every thread. */
+  for (unsigned int t = 0; t < numberOfThreads; ++t)
+  {
+    const auto copy = this->GetElastix()->GetElxMetricBase(metricIndex)->CreateWorkUnitCostFunction(metricIndex);
+    if (copy.IsNull())
+    {
+      xl::xout["warning"] << "WARNING: The optimizer evaluates the positions one after the other, "
+                          << "because the metric cannot be copied for a concurrent evaluation." << std::endl;
+      copies.clear();
+      return copies;
+    }
+    copies.push_back(copy);
+  }
+
+  this->m_HasWorkUnitCostFunctions = true;
+  this->m_WorkUnitMetricIndex = metricIndex;
+  elxout << "  The optimizer evaluates up to " << numberOfThreads << " positions concurrently." << std::endl;
+  return copies;
+
+} // end CreateWorkUnitCostFunctions()
+
+
+/**
+ * ****************** UpdateWorkUnitCostFunctions ********************
+ */
+
+template <class TElastix>
+void
+OptimizerBase<TElastix>::UpdateWorkUnitCostFunctions(void)
+{
+  if (this->m_HasWorkUnitCostFunctions)
+  {
+    this->GetElastix()->GetElxMetricBase(this->m_WorkUnitMetricIndex)->UpdateImageSamplerForWorkUnits();
+  }
+
+} // end UpdateWorkUnitCostFunctions()
+
+
 /**
  * ****************** SetSinusScales ********************
  */
@@ -28,6 +28,8 @@
 #include "itkImageMaskSpatialObject.h"
 #include "itkErodeMaskImageFilter.h"
 
+#include <vector>
+
 namespace elastix
 {
 
@@ -212,6 +214,30 @@ protected:
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
+  /** A mask, with the squared distance image that serves the erosions of all its resolution levels. */
+  template <class TMaskImage>
+  struct MaskSquaredDistanceImage
+  {
+    typedef itk::ErodeMaskImageFilter<TMaskImage> ErodeFilterType;
+
+    typename TMaskImage::ConstPointer                          m_Mask;
+    itk::ModifiedTimeType                                      m_MaskMTime;
+    typename ErodeFilterType::SquaredDistanceImageConstPointer m_SquaredDistanceImage;
+  };
+
+  /** Returns the squared distance image of the mask, computed once per mask, or null if the
+   * erosion of this level would not use it.
+   */
+  template <class TMaskImage, class TPyramid>
+  static const typename itk::ErodeMaskImageFilter<TMaskImage>::SquaredDistanceImageType *
+  GetMaskSquaredDistanceImage(const TMaskImage *                                 maskImage,
+                              const TPyramid *                                   pyramid,
+                              unsigned int                                       level,
+                              std::vector<MaskSquaredDistanceImage<TMaskImage>> & cache);
+
+  mutable std::vector<MaskSquaredDistanceImage<FixedMaskImageType>>  m_FixedMaskSquaredDistanceImages;
+  mutable std::vector<MaskSquaredDistanceImage<MovingMaskImageType>> m_MovingMaskSquaredDistanceImages;
+
   /** The deleted copy constructor. */
   RegistrationBase(const Self &) = delete;
   /** The deleted assignment operator. */
@@ -122,6 +122,8 @@ RegistrationBase<TElastix>::GenerateFixedMaskSpatialObject(const FixedMaskImageT
   erosion->SetSchedule(pyramid->GetSchedule());
   erosion->SetIsMovingMask(false);
   erosion->SetResolutionLevel(level);
+  erosion->SetSquaredDistanceImage(
+    Self::GetMaskSquaredDistanceImage(maskImage, pyramid, level, this->m_FixedMaskSquaredDistanceImages));
 
   /** Set output of the erosion to fixedImageMaskAsImage. */
   FixedMaskImagePointer erodedFixedMaskAsImage = erosion->GetOutput();
@@ -184,6 +186,8 @@ RegistrationBase<TElastix>::GenerateMovingMaskSpatialObject(const MovingMaskImag
   erosion->SetSchedule(pyramid->GetSchedule());
   erosion->SetIsMovingMask(true);
   erosion->SetResolutionLevel(level);
+  erosion->SetSquaredDistanceImage(
+    Self::GetMaskSquaredDistanceImage(maskImage, pyramid, level, this->m_MovingMaskSquaredDistanceImages));
 
   /** Set output of the erosion to movingImageMaskAsImage. */
   MovingMaskImagePointer erodedMovingMaskAsImage = erosion->GetOutput();
@@ -214,6 +218,54 @@ RegistrationBase<TElastix>::GenerateMovingMaskSpatialObject(const MovingMaskImag
 } // end GenerateMovingMaskSpatialObject()
 
 
+/**
+ * ******************* GetMaskSquaredDistanceImage **********************
+ */
+
+template <class TElastix>
+template <class TMaskImage, class TPyramid>
+const typename itk::ErodeMaskImageFilter<TMaskImage>::SquaredDistanceImageType *
+RegistrationBase<TElastix>::GetMaskSquaredDistanceImage(const TMaskImage *                                 maskImage,
+                                                        const TPyramid *                                   pyramid,
+                                                        unsigned int                                       level,
+                                                        std::vector<MaskSquaredDistanceImage<TMaskImage>> & cache)
+{
+  /** Only worthwhile for more than one level, and only used for an isotropic schedule. */
+  const typename TPyramid::ScheduleType & schedule = pyramid->GetSchedule();
+  bool                                    isotropic = true;
+  for (unsigned int i = 1; i < schedule.cols(); ++i)
+  {
+    isotropic &= schedule[level][i] == schedule[level][0];
+  }
+  if (schedule.rows() < 2 || !isotropic)
+  {
+    return nullptr;
+  }
+
+  for (auto it = cache.begin(); it != cache.end(); ++it)
+  {
+    if (it->m_Mask == maskImage)
+    {
+      if (it->m_MaskMTime == maskImage->GetMTime())
+      {
+        return it->m_SquaredDistanceImage;
+      }
+      /** The mask was modified. */
+      cache.erase(it);
+      break;
+    }
+  }
+
+  MaskSquaredDistanceImage<TMaskImage> entry;
+  entry.m_Mask = maskImage;
+  entry.m_MaskMTime = maskImage->GetMTime();
+  entry.m_SquaredDistanceImage = itk::ErodeMaskImageFilter<TMaskImage>::ComputeSquaredDistanceImage(maskImage);
+  cache.push_back(entry);
+  return entry.m_SquaredDistanceImage;
+
+} // end GetMaskSquaredDistanceImage()
+
+
 } // end namespace elastix
 
 #endif // end #ifndef elxRegistrationBase_hxx
@@ -23,7 +23,9 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkResampleImageFilter.h"
+#include "itkDisplacementFieldTransform.h"
 #include "elxProgressCommand.h"
+#include "itkThreadBudget.h"
 
 namespace elastix
 {
@@ -49,17 +51,22 @@ namespace elastix
  *    result image is resampled and written after each iteration. Choose from {"true", "false"} \n
  *    example: <tt>(WriteResultImageAfterEachIteration "true" "false" "true")</tt> \n
  *    The default is "false" for each iteration.\n
- *    Note that this option is only useful for debugging / tuning purposes.
+ *    Note that this option is only useful for debugging / tuning purposes.\n
+ *    These intermediate result images, and those of WriteResultImageAfterEachResolution, are
+ *    written in the background, while the registration continues, when
+ *    WriteIntermediateResultsInBackground is "true", see ElastixTemplate.
  * \parameter ResultImageFormat: parameter to set the image file format to
  *    to which the resampled image is written to.\n
  *    example: <tt>(ResultImageFormat "mhd")</tt> \n
  *    The default is "mhd".
  * \parameter ResultImagePixelType: parameter to set the pixel type,
  *    used for resampling the moving image. If this is different from
- *    the input pixel type you are casting your data. This is done
- *    using standard c-style casts, so TAKE CARE that you are not
- *    throwing away data (for example when going from unsigned to signed,
- *    or from float to char).\n
+ *    the input pixel type you are casting your data. The values are
+ *    rounded to the nearest integer, for integer types, and clamped to the
+ *    range of the pixel type, so TAKE CARE that you are not throwing away
+ *    data (for example when going from unsigned to signed, or from float
+ *    to char). The image is then resampled and cast in pieces, unless it is
+ *    compressed, so that the whole image is only stored with this pixel type.\n
  *    Choose from (unsigned) char, (unsigned) short, float, double, etc.\n
  *    example: <tt>(ResultImagePixelType "unsigned short")</tt> \n
  *    The default is "short".
@@ -67,6 +74,39 @@ namespace elastix
  *    of the written image is desired.\n
  *    example: <tt>(CompressResultImage "true")</tt> \n
  *    The default is "false".
+ * \parameter ResampleRegionIndex: the start index of a region of interest in the output grid,
+ *    to restrict the resampling to that region. The result image (and the transformix
+ *    deformation field and Jacobian images) then only cover this region, and all voxels outside
+ *    of it are skipped. The written images keep their physical position.\n
+ *    example: <tt>(ResampleRegionIndex 20 40 10)</tt> \n
+ *    The default is the start index of the output grid.
+ * \parameter ResampleRegionSize: the size of the region of interest in the output grid.
+ *    The region is cropped to the output grid.\n
+ *    example: <tt>(ResampleRegionSize 64 64 32)</tt> \n
+ *    The default is the size of the output grid, from ResampleRegionIndex onward.
+ * \parameter NumberOfStreamDivisions: the number of pieces in which the result image is
+ *    resampled and written, to bound the memory usage for very large images. The resampler
+ *    is then driven by the writer, one piece at a time. Only file formats that support
+ *    streamed writing, like mhd and nrrd, are actually written piece by piece; for other
+ *    formats the whole image is still resampled at once.\n
+ *    example: <tt>(NumberOfStreamDivisions 16)</tt> \n
+ *    The default is 1.
+ * \parameter BakeTransformIntoDisplacementField: flag to let transformix evaluate the
+ *    transform once on a grid, and resample the image with the resulting displacement field
+ *    instead of with the transform itself. This pays off for expensive (combined) transforms.\n
+ *    example: <tt>(BakeTransformIntoDisplacementField "true")</tt> \n
+ *    The default is "false".
+ * \parameter BakedDisplacementFieldShrinkFactor: the baked displacement field has a spacing
+ *    that is this factor times the spacing of the result image. In between the grid points
+ *    the field is linearly interpolated. A factor of 1 reproduces the transform at every voxel.\n
+ *    example: <tt>(BakedDisplacementFieldShrinkFactor 2)</tt> \n
+ *    The default is 1.
+ * \parameter BakedDisplacementFieldFileName: optional file in which the baked displacement field
+ *    is cached, as float vectors. When the file exists it is read instead of baking the field again,
+ *    which lets transformix reuse the field for all images that are resampled with the same transform.
+ *    Remove the file when the transform has changed!\n
+ *    example: <tt>(BakedDisplacementFieldFileName "./res/BakedDisplacementField.mha")</tt> \n
+ *    By default the field is not cached.
  *
  * \ingroup Resamplers
  * \ingroup ComponentBaseClasses
@@ -114,6 +154,10 @@ public:
   /** Typedef that is used in the elastix dll version. */
   typedef typename ElastixType::ParameterMapType ParameterMapType;
 
+  /** Typedef's for baking the transform into a displacement field. */
+  typedef itk::DisplacementFieldTransform<CoordRepType, OutputImageType::ImageDimension> DisplacementFieldTransformType;
+  typedef typename DisplacementFieldTransformType::DisplacementFieldType                 DisplacementFieldType;
+
   /** Typedef for the ProgressCommand. */
   typedef elx::ProgressCommand ProgressCommandType;
 
@@ -154,6 +198,12 @@ public:
   void
   BeforeRegistrationBase(void) override;
 
+  /** Execute stuff before each resolution:
+   * \li Read the parameters that are needed after each iteration.
+   */
+  void
+  BeforeEachResolutionBase(void) override;
+
   /** Execute stuff after each resolution:
    * \li Write the resulting output image.
    */
@@ -188,6 +238,13 @@ public:
   virtual void
   ResampleAndWriteResultImage(const char * filename, const bool & showProgress = true);
 
+  /** Function to resample the result image with the current transform parameters, and write it
+   * to a file by the background writer of elastix, see WriteIntermediateResultsInBackground.
+   * Writes the image immediately when there is no background writer, or the image is streamed.
+   */
+  virtual void
+  ResampleAndWriteResultImageInBackground(const char * filename);
+
   /** Function to write the result output image to a file. */
   virtual void
   WriteResultImage(OutputImageType * imageimage, const char * filename, const bool & showProgress = true);
@@ -196,6 +253,13 @@ public:
   virtual void
   CreateItkResultImage(void);
 
+  /** Function to replace the transform of the resampler by a displacement field
+   * of the transform, if BakeTransformIntoDisplacementField is "true".
+   * Transformix calls it just before resampling.
+   */
+  virtual void
+  BakeTransformIntoDisplacementField(void);
+
 protected:
   /** The constructor. */
   ResamplerBase();
@@ -206,9 +270,38 @@ protected:
   virtual void
   SetComponents(void);
 
+  /** Creates the writer of the result image, with the result image pixel type and compression
+   * from the parameter file. Updating the writer writes the image.
+   */
+  itk::ProcessObject::Pointer
+  CreateResultImageWriter(OutputImageType * image, const char * filename);
+
+  /** Returns the number of pieces in which the result image is resampled and written:
+   * the NumberOfStreamDivisions, or, when the image is cast to another ResultImagePixelType
+   * and not compressed, 8 pieces, so that only a piece is stored with the internal pixel type.
+   */
+  unsigned int
+  GetNumberOfResultImageStreamDivisions(void) const;
+
+  /** Resamples the image in pieces, and rounds and clamps every piece to TResultPixel,
+   * so that the whole image is only stored with the result pixel type.
+   */
+  template <class TResultPixel>
+  itk::DataObject::Pointer
+  CreateCastResultImage(OutputImageType * image) const;
+
+  /** Method that restricts the output grid to the region of interest given by
+   * ResampleRegionIndex and ResampleRegionSize, if specified. */
+  void
+  SetResampleRegion(void);
+
   /** Variable that defines to print the progress or not. */
   bool m_ShowProgress;
 
+  /** Whether the result image is written after each iteration of the current
+   * resolution. Read once per resolution, as it is checked every iteration. */
+  bool m_WriteResultImageAfterEachIteration{ false };
+
 private:
   elxDeclarePureVirtualGetSelfMacro(ITKBaseType);
 
@@ -25,6 +25,14 @@
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 #include "itkTimeProbe.h"
+#include "itkTransformToDisplacementFieldFilter.h"
+#include "itkCastImageFilter.h"
+#include "itkRoundAndClampImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include <itksys/SystemTools.hxx>
+#include <algorithm> // For max.
 
 namespace elastix
 {
@@ -66,6 +74,9 @@ ResamplerBase<TElastix>::BeforeRegistrationBase(void)
   this->GetAsITKBaseType()->SetOutputSpacing(fixedImage->GetSpacing());
   this->GetAsITKBaseType()->SetOutputDirection(fixedImage->GetDirection());
 
+  /** Possibly restrict the output to a region of interest. */
+  this->SetResampleRegion();
+
   /** Set the DefaultPixelValue (for pixels in the resampled image
    * that come from outside the original (moving) image.
    */
@@ -78,6 +89,25 @@ ResamplerBase<TElastix>::BeforeRegistrationBase(void)
 } // end BeforeRegistrationBase()
 
 
+/**
+ * ******************* BeforeEachResolutionBase ********************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::BeforeEachResolutionBase(void)
+{
+  /** What is the current resolution level? */
+  const unsigned int level = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** Decide whether or not to write the result image after each iteration. */
+  this->m_WriteResultImageAfterEachIteration = false;
+  this->m_Configuration->ReadParameter(
+    this->m_WriteResultImageAfterEachIteration, "WriteResultImageAfterEachIteration", "", level, 0, false);
+
+} // end BeforeEachResolutionBase()
+
+
 /**
  * ******************* AfterEachResolutionBase ********************
  */
@@ -115,7 +145,7 @@ ResamplerBase<TElastix>::AfterEachResolutionBase(void)
     elxout << "Applying transform this resolution ..." << std::endl;
     try
     {
-      this->ResampleAndWriteResultImage(makeFileName.str().c_str());
+      this->ResampleAndWriteResultImageInBackground(makeFileName.str().c_str());
     }
     catch (itk::ExceptionObject & excp)
     {
@@ -146,13 +176,8 @@ ResamplerBase<TElastix>::AfterEachIterationBase(void)
   /** What is the current iteration number? */
   const unsigned int iter = this->m_Elastix->GetIterationCounter();
 
-  /** Decide whether or not to write the result image this iteration. */
-  bool writeResultImageThisIteration = false;
-  this->m_Configuration->ReadParameter(
-    writeResultImageThisIteration, "WriteResultImageAfterEachIteration", "", level, 0, false);
-
   /** Writing result image. */
-  if (writeResultImageThisIteration)
+  if (this->m_WriteResultImageAfterEachIteration)
   {
     /** Set the final transform parameters. */
     this->GetElastix()->GetElxTransformBase()->SetFinalParameters();
@@ -168,7 +193,7 @@ ResamplerBase<TElastix>::AfterEachIterationBase(void)
     /** Apply the final transform, and save the result. */
     try
     {
-      this->ResampleAndWriteResultImage(makeFileName.str().c_str(), false);
+      this->ResampleAndWriteResultImageInBackground(makeFileName.str().c_str());
     }
     catch (itk::ExceptionObject & excp)
     {
@@ -288,6 +313,48 @@ ResamplerBase<TElastix>::SetComponents(void)
 } // end SetComponents()
 
 
+/**
+ * ******************* SetResampleRegion ************************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::SetResampleRegion(void)
+{
+  typedef itk::ImageRegion<ImageDimension> RegionType;
+
+  /** Read the region of interest, as an index and a size in the output grid. */
+  ITKBaseType * const resampler = this->GetAsITKBaseType();
+  const RegionType    outputRegion(resampler->GetOutputStartIndex(), resampler->GetSize());
+  IndexType           index = outputRegion.GetIndex();
+  SizeType            size = outputRegion.GetSize();
+  unsigned int        numberFound = 0;
+  for (unsigned int i = 0; i < ImageDimension; ++i)
+  {
+    numberFound += this->m_Configuration->ReadParameter(index[i], "ResampleRegionIndex", i, false);
+    numberFound += this->m_Configuration->ReadParameter(size[i], "ResampleRegionSize", i, false);
+  }
+  if (numberFound == 0)
+  {
+    return;
+  }
+  RegionType resampleRegion(index, size);
+
+  /** Voxels outside the output grid are not resampled either. */
+  if (!resampleRegion.Crop(outputRegion))
+  {
+    itkExceptionMacro(<< "ERROR: The region specified by ResampleRegionIndex and ResampleRegionSize "
+                      << "does not overlap with the output image.");
+  }
+
+  elxout << "  The output is restricted to the region with index " << resampleRegion.GetIndex() << " and size "
+         << resampleRegion.GetSize() << "." << std::endl;
+  resampler->SetOutputStartIndex(resampleRegion.GetIndex());
+  resampler->SetSize(resampleRegion.GetSize());
+
+} // end SetResampleRegion()
+
+
 /**
  * ******************* ResampleAndWriteResultImage ********************
  */
@@ -296,8 +363,9 @@ template <class TElastix>
 void
 ResamplerBase<TElastix>::ResampleAndWriteResultImage(const char * filename, const bool & showProgress)
 {
-  /** Make sure the resampler is updated. */
+  /** Make sure the resampler is updated, with the number of threads of this registration. */
   this->GetAsITKBaseType()->Modified();
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
 
   /** Add a progress observer to the resampler. */
   const auto progressObserver = BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::New();
@@ -308,7 +376,63 @@ ResamplerBase<TElastix>::ResampleAndWriteResultImage(const char * filename, cons
     progressObserver->SetEndString("%");
   }
 
-  /** Do the resampling. */
+  /** Do the resampling, unless the writer streams the output. In that case
+   * the resampler is driven by the writer, one piece of the image at a time,
+   * and every piece is cast to the result pixel type before the next one is
+   * resampled, so the whole image is never stored with the internal pixel type. */
+  if (this->GetNumberOfResultImageStreamDivisions() <= 1)
+  {
+    try
+    {
+      this->GetAsITKBaseType()->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception. */
+      excp.SetLocation("ResamplerBase - WriteResultImage()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while resampling the image.\n";
+      excp.SetDescription(err_str);
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+  }
+
+  /** Perform the writing. */
+  this->WriteResultImage(this->GetAsITKBaseType()->GetOutput(), filename, showProgress);
+
+  /** Disconnect from the resampler. */
+  if (showProgress && (progressObserver != nullptr))
+  {
+    progressObserver->DisconnectObserver(this->GetAsITKBaseType());
+  }
+
+} // end ResampleAndWriteResultImage()
+
+
+/**
+ * ******************* ResampleAndWriteResultImageInBackground ********************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::ResampleAndWriteResultImageInBackground(const char * filename)
+{
+  /** A streamed result image is resampled while it is written, so it is written immediately. */
+  itk::BackgroundTaskQueue * backgroundWriter = this->GetElastix()->GetBackgroundWriter();
+  unsigned int               numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+  if (backgroundWriter == nullptr || numberOfStreamDivisions > 1)
+  {
+    this->ResampleAndWriteResultImage(filename, false);
+    return;
+  }
+  this->GetElastix()->ReportBackgroundWriterErrors();
+
+  /** Do the resampling, with the current transform parameters. */
+  this->GetAsITKBaseType()->Modified();
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
   try
   {
     this->GetAsITKBaseType()->Update();
@@ -316,7 +440,7 @@ ResamplerBase<TElastix>::ResampleAndWriteResultImage(const char * filename, cons
   catch (itk::ExceptionObject & excp)
   {
     /** Add information to the exception. */
-    excp.SetLocation("ResamplerBase - WriteResultImage()");
+    excp.SetLocation("ResamplerBase - ResampleAndWriteResultImageInBackground()");
     std::string err_str = excp.GetDescription();
     err_str += "\nError occurred while resampling the image.\n";
     excp.SetDescription(err_str);
@@ -325,25 +449,24 @@ ResamplerBase<TElastix>::ResampleAndWriteResultImage(const char * filename, cons
     throw excp;
   }
 
-  /** Perform the writing. */
-  this->WriteResultImage(this->GetAsITKBaseType()->GetOutput(), filename, showProgress);
-
-  /** Disconnect from the resampler. */
-  if (showProgress && (progressObserver != nullptr))
-  {
-    progressObserver->DisconnectObserver(this->GetAsITKBaseType());
-  }
+  /** Take the result image out of the pipeline, so that the next resampling creates
+   * a new image, while this one is written by the background writer.
+   */
+  const typename OutputImageType::Pointer resultImage = this->GetAsITKBaseType()->GetOutput();
+  resultImage->DisconnectPipeline();
+  const itk::ProcessObject::Pointer writer = this->CreateResultImageWriter(resultImage, filename);
+  backgroundWriter->Push([writer] { writer->Update(); });
 
-} // end ResampleAndWriteResultImage()
+} // end ResampleAndWriteResultImageInBackground()
 
 
 /**
- * ******************* WriteResultImage ********************
+ * ******************* CreateResultImageWriter ********************
  */
 
 template <class TElastix>
-void
-ResamplerBase<TElastix>::WriteResultImage(OutputImageType * image, const char * filename, const bool & showProgress)
+itk::ProcessObject::Pointer
+ResamplerBase<TElastix>::CreateResultImageWriter(OutputImageType * image, const char * filename)
 {
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator  */
   const auto testptr = dynamic_cast<itk::AdvancedRayCastInterpolateImageFunction<InputImageType, CoordRepType> *>(
@@ -396,6 +519,96 @@ ResamplerBase<TElastix>::WriteResultImage(OutputImageType * image, const char *
   writer->SetOutputComponentType(resultImagePixelType.c_str());
   writer->SetUseCompression(doCompression);
 
+  /** Image IOs that can not stream ignore the number of pieces. */
+  writer->SetNumberOfStreamDivisions(this->GetNumberOfResultImageStreamDivisions());
+
+  return writer.GetPointer();
+
+} // end CreateResultImageWriter()
+
+
+/**
+ * ******************* GetNumberOfResultImageStreamDivisions ********************
+ */
+
+template <class TElastix>
+unsigned int
+ResamplerBase<TElastix>::GetNumberOfResultImageStreamDivisions(void) const
+{
+  /** Read the number of pieces in which the image is resampled and written. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+  if (numberOfStreamDivisions > 1)
+  {
+    return numberOfStreamDivisions;
+  }
+
+  /** Read the result pixel type and whether the image is compressed, which can not be streamed. */
+  std::string resultImagePixelType = "short";
+  this->m_Configuration->ReadParameter(resultImagePixelType, "ResultImagePixelType", 0, false);
+  std::replace(resultImagePixelType.begin(), resultImagePixelType.end(), ' ', '_');
+  bool doCompression = false;
+  this->m_Configuration->ReadParameter(doCompression, "CompressResultImage", 0, false);
+
+  /** When the pixels are cast, the image is resampled and cast in pieces. */
+  const std::string outputPixelType = itk::ImageIOBase::GetComponentTypeAsString(
+    itk::ImageIOBase::MapPixelType<typename OutputImageType::PixelType>::CType);
+  const unsigned int numberOfCastDivisions = 8;
+  return (!doCompression && resultImagePixelType != outputPixelType) ? numberOfCastDivisions : 1;
+
+} // end GetNumberOfResultImageStreamDivisions()
+
+
+/**
+ * ******************* CreateCastResultImage ********************
+ */
+
+template <class TElastix>
+template <class TResultPixel>
+itk::DataObject::Pointer
+ResamplerBase<TElastix>::CreateCastResultImage(OutputImageType * image) const
+{
+  typedef itk::Image<TResultPixel, ImageDimension>                        ResultImageType;
+  typedef itk::RoundAndClampImageFilter<OutputImageType, ResultImageType> CastFilterType;
+  typedef itk::StreamingImageFilter<ResultImageType, ResultImageType>     StreamerType;
+
+  /** The streamer pulls the pieces of the image through the cast filter and the resampler. */
+  const auto castFilter = CastFilterType::New();
+  castFilter->SetInput(image);
+  const auto streamer = StreamerType::New();
+  streamer->SetInput(castFilter->GetOutput());
+  streamer->SetNumberOfStreamDivisions(this->GetNumberOfResultImageStreamDivisions());
+  try
+  {
+    streamer->Update();
+  }
+  catch (itk::ExceptionObject & excp)
+  {
+    /** Add information to the exception. */
+    excp.SetLocation("ResamplerBase - CreateItkResultImage()");
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while resampling the image.\n";
+    excp.SetDescription(err_str);
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+  return streamer->GetOutput();
+
+} // end CreateCastResultImage()
+
+
+/**
+ * ******************* WriteResultImage ********************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::WriteResultImage(OutputImageType * image, const char * filename, const bool & showProgress)
+{
+  /** Create the writer. */
+  const itk::ProcessObject::Pointer writer = this->CreateResultImageWriter(image, filename);
+
   /** Do the writing. */
   if (showProgress)
   {
@@ -421,7 +634,6 @@ ResamplerBase<TElastix>::WriteResultImage(OutputImageType * image, const char *
 
 /*
  * ******************* CreateItkResultImage ********************
- * \todo: avoid code duplication with WriteResultImage function
  */
 
 template <class TElastix>
@@ -430,29 +642,13 @@ ResamplerBase<TElastix>::CreateItkResultImage(void)
 {
   itk::DataObject::Pointer resultImage;
 
-  /** Make sure the resampler is updated. */
+  /** Make sure the resampler is updated, with the number of threads of this registration. */
   this->GetAsITKBaseType()->Modified();
+  this->GetAsITKBaseType()->SetNumberOfWorkUnits(itk::ThreadBudget::GetNumberOfThreads());
 
   const auto progressObserver =
     BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(*(this->GetAsITKBaseType()));
 
-  /** Do the resampling. */
-  try
-  {
-    this->GetAsITKBaseType()->Update();
-  }
-  catch (itk::ExceptionObject & excp)
-  {
-    /** Add information to the exception. */
-    excp.SetLocation("ResamplerBase - WriteResultImage()");
-    std::string err_str = excp.GetDescription();
-    err_str += "\nError occurred while resampling the image.\n";
-    excp.SetDescription(err_str);
-
-    /** Pass the exception to an higher level. */
-    throw excp;
-  }
-
   /** Check if ResampleInterpolator is the RayCastResampleInterpolator */
   const auto testptr = dynamic_cast<itk::AdvancedRayCastInterpolateImageFunction<InputImageType, CoordRepType> *>(
     this->GetAsITKBaseType()->GetInterpolator());
@@ -483,91 +679,82 @@ ResamplerBase<TElastix>::CreateItkResultImage(void)
   infoChanger->SetChangeDirection(retdc & !this->GetElastix()->GetUseDirectionCosines());
   infoChanger->SetInput(this->GetAsITKBaseType()->GetOutput());
 
-  typedef itk::CastImageFilter<InputImageType, itk::Image<char, InputImageType::ImageDimension>> CastFilterChar;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<unsigned char, InputImageType::ImageDimension>>
-                                                                                                  CastFilterUChar;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<short, InputImageType::ImageDimension>> CastFilterShort;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<unsigned short, InputImageType::ImageDimension>>
-                                                                                                         CastFilterUShort;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<int, InputImageType::ImageDimension>>          CastFilterInt;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<unsigned int, InputImageType::ImageDimension>> CastFilterUInt;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<long, InputImageType::ImageDimension>>         CastFilterLong;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<unsigned long, InputImageType::ImageDimension>>
-                                                                                                   CastFilterULong;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<float, InputImageType::ImageDimension>>  CastFilterFloat;
-  typedef itk::CastImageFilter<InputImageType, itk::Image<double, InputImageType::ImageDimension>> CastFilterDouble;
-
-  /** cast the image to the correct output image Type */
-  if (resultImagePixelType == "char")
-  {
-    typename CastFilterChar::Pointer castFilter = CastFilterChar::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
-  }
-  if (resultImagePixelType == "unsigned char")
-  {
-    typename CastFilterUChar::Pointer castFilter = CastFilterUChar::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+  /** No cast is needed when the result pixel type is the output pixel type. */
+  std::string outputPixelType = itk::ImageIOBase::GetComponentTypeAsString(
+    itk::ImageIOBase::MapPixelType<typename OutputImageType::PixelType>::CType);
+  std::replace(outputPixelType.begin(), outputPixelType.end(), '_', ' ');
+  const bool isOutputPixelType = resultImagePixelType == outputPixelType ||
+                                 (resultImagePixelType == "ushort" && outputPixelType == "unsigned short");
+
+  /** Cast the image to the correct output image type. Otherwise the resampling is
+   * done while casting, one piece of the image at a time. */
+  if (isOutputPixelType)
+  {
+    /** Do the resampling. */
+    try
+    {
+      infoChanger->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception. */
+      excp.SetLocation("ResamplerBase - CreateItkResultImage()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while resampling the image.\n";
+      excp.SetDescription(err_str);
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+
+    /** The result image shares the pixel buffer of the resampler output, which is
+     * then released, so that a next update of the resampler cannot overwrite it.
+     */
+    const auto outputImage = OutputImageType::New();
+    outputImage->Graft(infoChanger->GetOutput());
+    resultImage = outputImage;
+    this->GetAsITKBaseType()->GetOutput()->ReleaseData();
+  }
+  else if (resultImagePixelType == "char")
+  {
+    resultImage = this->template CreateCastResultImage<char>(infoChanger->GetOutput());
+  }
+  else if (resultImagePixelType == "unsigned char")
+  {
+    resultImage = this->template CreateCastResultImage<unsigned char>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "short")
   {
-    typename CastFilterShort::Pointer castFilter = CastFilterShort::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<short>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "ushort" ||
            resultImagePixelType == "unsigned short") // <-- ushort for backwards compatibility
   {
-    typename CastFilterUShort::Pointer castFilter = CastFilterUShort::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<unsigned short>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "int")
   {
-    typename CastFilterInt::Pointer castFilter = CastFilterInt::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<int>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "unsigned int")
   {
-    typename CastFilterUInt::Pointer castFilter = CastFilterUInt::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<unsigned int>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "long")
   {
-    typename CastFilterLong::Pointer castFilter = CastFilterLong::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<long>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "unsigned long")
   {
-    typename CastFilterULong::Pointer castFilter = CastFilterULong::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<unsigned long>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "float")
   {
-    typename CastFilterFloat::Pointer castFilter = CastFilterFloat::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<float>(infoChanger->GetOutput());
   }
   else if (resultImagePixelType == "double")
   {
-    typename CastFilterDouble::Pointer castFilter = CastFilterDouble::New();
-    castFilter->SetInput(infoChanger->GetOutput());
-    castFilter->Update();
-    resultImage = castFilter->GetOutput();
+    resultImage = this->template CreateCastResultImage<double>(infoChanger->GetOutput());
   }
 
   if (resultImage.IsNull())
@@ -589,6 +776,143 @@ ResamplerBase<TElastix>::CreateItkResultImage(void)
 } // end CreateItkResultImage()
 
 
+/*
+ * ************** BakeTransformIntoDisplacementField ******************
+ */
+
+template <class TElastix>
+void
+ResamplerBase<TElastix>::BakeTransformIntoDisplacementField(void)
+{
+  bool bakeTransform = false;
+  this->m_Configuration->ReadParameter(bakeTransform, "BakeTransformIntoDisplacementField", 0, false);
+  if (!bakeTransform)
+  {
+    return;
+  }
+
+  /** The RayCastResampleInterpolator evaluates its own transform. */
+  if (dynamic_cast<const itk::AdvancedRayCastInterpolateImageFunction<InputImageType, CoordRepType> *>(
+        this->GetAsITKBaseType()->GetInterpolator()) != nullptr)
+  {
+    xl::xout["warning"] << "WARNING: BakeTransformIntoDisplacementField is ignored for the "
+                        << "RayCastResampleInterpolator." << std::endl;
+    return;
+  }
+
+  std::string fileName = "";
+  this->m_Configuration->ReadParameter(fileName, "BakedDisplacementFieldFileName", 0, false);
+
+  typename DisplacementFieldType::Pointer displacementField;
+  if (!fileName.empty() && itksys::SystemTools::FileExists(fileName.c_str()))
+  {
+    /** Reuse the cached displacement field. */
+    elxout << "  Reading the baked displacement field from " << fileName << std::endl;
+    const auto reader = itk::ImageFileReader<DisplacementFieldType>::New();
+    reader->SetFileName(fileName);
+    try
+    {
+      reader->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception. */
+      excp.SetLocation("ResamplerBase - BakeTransformIntoDisplacementField()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while reading the baked displacement field.\n";
+      excp.SetDescription(err_str);
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+    displacementField = reader->GetOutput();
+  }
+  else
+  {
+    unsigned int shrinkFactor = 1;
+    this->m_Configuration->ReadParameter(shrinkFactor, "BakedDisplacementFieldShrinkFactor", 0, false);
+    shrinkFactor = std::max(shrinkFactor, 1u);
+
+    /** The field covers the output grid of the resampler, with a spacing that is
+     * shrinkFactor times larger. Its first grid point is the first output voxel.
+     */
+    const ITKBaseType & resampler = *(this->GetAsITKBaseType());
+    const SizeType      outputSize = resampler.GetSize();
+    const IndexType     outputIndex = resampler.GetOutputStartIndex();
+    const SpacingType   outputSpacing = resampler.GetOutputSpacing();
+
+    SizeType                                 fieldSize;
+    SpacingType                              fieldSpacing;
+    itk::Vector<CoordRepType, ImageDimension> startOffset;
+    for (unsigned int i = 0; i < ImageDimension; ++i)
+    {
+      fieldSize[i] = (outputSize[i] + shrinkFactor - 2) / shrinkFactor + 1;
+      fieldSpacing[i] = outputSpacing[i] * shrinkFactor;
+      startOffset[i] = outputIndex[i] * outputSpacing[i];
+    }
+    const OriginPointType fieldOrigin = resampler.GetOutputOrigin() + resampler.GetOutputDirection() * startOffset;
+
+    typedef itk::TransformToDisplacementFieldFilter<DisplacementFieldType, CoordRepType> DisplacementFieldGeneratorType;
+    const auto generator = DisplacementFieldGeneratorType::New();
+    generator->SetSize(fieldSize);
+    generator->SetOutputSpacing(fieldSpacing);
+    generator->SetOutputOrigin(fieldOrigin);
+    generator->SetOutputDirection(resampler.GetOutputDirection());
+    generator->SetTransform(resampler.GetTransform());
+
+    elxout << "  Baking the transform into a displacement field of size " << fieldSize << " ..." << std::endl;
+    try
+    {
+      generator->Update();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      /** Add information to the exception. */
+      excp.SetLocation("ResamplerBase - BakeTransformIntoDisplacementField()");
+      std::string err_str = excp.GetDescription();
+      err_str += "\nError occurred while baking the transform into a displacement field.\n";
+      excp.SetDescription(err_str);
+
+      /** Pass the exception to an higher level. */
+      throw excp;
+    }
+    displacementField = generator->GetOutput();
+
+    /** Cache the field on disk, compactly as float vectors. */
+    if (!fileName.empty())
+    {
+      typedef itk::Image<itk::Vector<float, ImageDimension>, ImageDimension> FloatDisplacementFieldType;
+      const auto caster = itk::CastImageFilter<DisplacementFieldType, FloatDisplacementFieldType>::New();
+      caster->SetInput(displacementField);
+      const auto writer = itk::ImageFileWriter<FloatDisplacementFieldType>::New();
+      writer->SetInput(caster->GetOutput());
+      writer->SetFileName(fileName);
+      try
+      {
+        writer->Update();
+      }
+      catch (itk::ExceptionObject & excp)
+      {
+        /** Add information to the exception. */
+        excp.SetLocation("ResamplerBase - BakeTransformIntoDisplacementField()");
+        std::string err_str = excp.GetDescription();
+        err_str += "\nError occurred while writing the baked displacement field.\n";
+        excp.SetDescription(err_str);
+
+        /** Pass the exception to an higher level. */
+        throw excp;
+      }
+    }
+  }
+
+  /** Let the resampler use the (linearly interpolated) displacement field. */
+  const auto displacementFieldTransform = DisplacementFieldTransformType::New();
+  displacementFieldTransform->SetDisplacementField(displacementField);
+  this->GetAsITKBaseType()->SetTransform(displacementFieldTransform);
+
+} // end BakeTransformIntoDisplacementField()
+
+
 /*
  * ************************* ReadFromFile ***********************
  */
@@ -662,6 +986,9 @@ ResamplerBase<TElastix>::ReadFromFile(void)
   }
   this->GetAsITKBaseType()->SetOutputDirection(direction);
 
+  /** Possibly restrict the output to a region of interest. */
+  this->SetResampleRegion();
+
   /** Set the DefaultPixelValue (for pixels in the resampled image
    * that come from outside the original (moving) image.
    */
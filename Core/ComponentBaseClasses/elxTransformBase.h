@@ -29,8 +29,13 @@
 #include "elxProgressCommand.h"
 
 // ITK header files:
+#include <itkDefaultStaticMeshTraits.h>
 #include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageSource.h>
+#include <itkMatrix.h>
 #include <itkOptimizerParameters.h>
+#include <itkPointSet.h>
 
 namespace elastix
 {
@@ -73,6 +78,11 @@ namespace elastix
  *   "Compose" by composition: \f$T(x) = T_1 ( T_0(x) )\f$.\n
  *   example: <tt>(HowToCombineTransforms "Add")</tt>\n
  *   Default: "Compose".
+ * \transformparameter FlattenLinearInitialTransform: Whether an initial transform that is linear,
+ *   like a chain of translation, Euler and affine transforms from previous parameter files, is replaced
+ *   by a single equivalent matrix-offset transform, which is much cheaper to evaluate.\n
+ *   example: <tt>(FlattenLinearInitialTransform "false")</tt>\n
+ *   Default: "true".
  * \transformparameter Size: The size (number of voxels in each dimension) of the fixed image
  * that was used during registration, and which is used for resampling the deformed moving image.\n
  * example: <tt>(Size 100 90 90)</tt>\n
@@ -107,6 +117,53 @@ namespace elastix
  * The location is relative to the path from where elastix/transformix is started!\n
  * Default: "NoInitialTransform", which (obviously) means that there is no initial transform
  * to be loaded.
+ * \parameter UseBinaryFormatForTransformationParameters: Write the transform parameters
+ * to a binary data file next to the transform parameter file, as little endian doubles, instead
+ * of as text. The TransformParameters entry of the transform parameter file then holds the name
+ * of the data file. This is much faster to write and read for transforms with many parameters,
+ * like fine B-spline grids. When the data file is not found at its original (relative) location,
+ * it is looked up in the directory of the transform parameter file.\n
+ * example <tt>(UseBinaryFormatForTransformationParameters "true")</tt>\n
+ * Default: "false".
+ * \transformparameter NumberOfStreamDivisions: The number of pieces in which transformix
+ * generates and writes the deformation field (-def all), the spatial Jacobian determinant
+ * (-jac all) and the spatial Jacobian (-jacmat all), to limit the memory usage for large
+ * images. Only file formats that support streamed writing, like mhd and nrrd, are actually
+ * written piece by piece.\n
+ * example <tt>(NumberOfStreamDivisions 16)</tt>\n
+ * Default: 1, which means that each image is generated as a whole.
+ * \transformparameter InverseMaximumNumberOfIterations: The maximum number of Newton iterations
+ * per voxel when transformix computes the deformation field of the inverse transform (-inv all).
+ * Each voxel of the grid of the resampler is inverted independently, in parallel, starting from
+ * an inverse computed on a coarser grid.\n
+ * example <tt>(InverseMaximumNumberOfIterations 50)</tt>\n
+ * Default: 20.
+ * \transformparameter InverseTolerance: The tolerance of the residual of the inverse (-inv all),
+ * as a fraction of the smallest output spacing.\n
+ * example <tt>(InverseTolerance 0.001)</tt>\n
+ * Default: 0.01.
+ * \transformparameter InverseCoarseGridFactor: The factor by which the grid of the initial
+ * estimate of the inverse (-inv all) is coarser than the output grid; 1 starts every voxel
+ * from the identity.\n
+ * example <tt>(InverseCoarseGridFactor 8)</tt>\n
+ * Default: 4.
+ * \parameter TransformUseOpenCL: Whether transformix computes the deformation field (-def all),
+ * the spatial Jacobian determinant (-jac all) and the spatial Jacobian (-jacmat all) with OpenCL,
+ * when elastix is built with ELASTIX_USE_OPENCL. Only 2D and 3D B-spline transforms of order 1, 2
+ * or 3 are supported, possibly composed with linear transforms before and after them. Other
+ * transforms are computed on the CPU.\n
+ * example <tt>(TransformUseOpenCL "true")</tt>\n
+ * Default: "false".
+ * \transformparameter WriteBinaryOutputPoints: When transforming an input point file
+ * (-def inputpoints.txt), also write the transformed points to outputpoints.raw, as
+ * consecutive double precision coordinates in native byte order, one point after the other.
+ * This file is much faster to write and read than outputpoints.txt, for large point sets.\n
+ * example <tt>(WriteBinaryOutputPoints "true")</tt>\n
+ * Default: "false".
+ * \transformparameter WriteBinaryOutputMesh: When transforming an input mesh
+ * (-def inputmesh.vtk), write outputpoints.vtk as a binary instead of an ascii vtk file.\n
+ * example <tt>(WriteBinaryOutputMesh "true")</tt>\n
+ * Default: "false".
  *
  * The command line arguments used by this class are:
  * \commandlinearg -t0: optional argument for elastix for specifying an initial transform
@@ -119,6 +176,8 @@ namespace elastix
  *    "point", depending if the user supplies voxel indices or real world coordinates.
  *    The second line should be the number of points that should be transformed. The
  *    third and following lines give the indices or points.\n
+ *    For large point sets the coordinates may also be given in binary form, as consecutive
+ *    doubles in native byte order after a header line "binarypoint <n>" or "binaryindex <n>".\n
  *    It is also possible to deform all points, thereby generating a deformation field
  *    image. This is done by:\n
  *    example: <tt>-def all</tt> \n
@@ -184,6 +243,16 @@ public:
   typedef itk::Vector<float, FixedImageDimension>          VectorPixelType;
   typedef itk::Image<VectorPixelType, FixedImageDimension> DeformationFieldImageType;
 
+  /** Typedef's for ComputeDeterminantOfSpatialJacobian and ComputeSpatialJacobian. */
+  typedef itk::Image<float, FixedImageDimension>                        DeterminantOfSpatialJacobianImageType;
+  typedef itk::Matrix<float, MovingImageDimension, FixedImageDimension> SpatialJacobianPixelType;
+  typedef itk::Image<SpatialJacobianPixelType, FixedImageDimension>     SpatialJacobianImageType;
+
+  /** Typedef's for the transformed points, when they are kept in memory by the elastix library. */
+  typedef itk::DefaultStaticMeshTraits<unsigned char, FixedImageDimension, FixedImageDimension, CoordRepType>
+                                                                                       OutputPointSetTraitsType;
+  typedef itk::PointSet<unsigned char, FixedImageDimension, OutputPointSetTraitsType> OutputPointSetType;
+
   /** Typedefs needed for AutomaticScalesEstimation function */
   typedef typename RegistrationType::ITKBaseType      ITKRegistrationType;
   typedef typename ITKRegistrationType::OptimizerType OptimizerType;
@@ -225,9 +294,13 @@ public:
   virtual void
   ReadFromFile(void);
 
-  /** Function to create transform-parameters map. */
+  /** Function to create transform-parameters map. The conversion of the transform
+   * parameters to strings may be skipped, for callers that store them otherwise.
+   */
   void
-  CreateTransformParametersMap(const ParametersType & param, ParameterMapType & parameterMap) const;
+  CreateTransformParametersMap(const ParametersType & param,
+                               ParameterMapType &     parameterMap,
+                               const bool             includeTransformParameters = true) const;
 
   /** Function to write transform-parameters to a file. */
   void
@@ -259,6 +332,11 @@ public:
   void
   ComputeSpatialJacobian(void) const;
 
+  /** Function to compute the displacement field of the inverse transform, from
+   * the moving to the fixed image, on the grid of the resampler. */
+  void
+  ComputeInverseDeformationField(void) const;
+
   /** Makes sure that the final parameters from the registration components
    * are copied, set, and stored.
    */
@@ -305,6 +383,15 @@ private:
   void
   ReadInitialTransformFromConfiguration(const Configuration::Pointer);
 
+  /** Creates a source that computes the image of type TImage (a deformation field, spatial
+   * Jacobian determinant, or spatial Jacobian) of this transform with OpenCL, on the grid of
+   * the resampler. Returns a null pointer when TransformUseOpenCL is false, when OpenCL is
+   * not available, or when the transform is not supported.
+   */
+  template <class TImage>
+  typename itk::ImageSource<TImage>::Pointer
+  CreateOpenCLImageSource(void) const;
+
   /** Execute stuff before everything else:
    * \li Check the appearance of an initial transform.
    */
@@ -330,6 +417,13 @@ private:
   /** Get the TransformParametersFileName. */
   itkGetStringMacro(TransformParametersFileName);
 
+  /** Returns true when the results of transformix are written to the output directory.
+   * The elastix library keeps the results in memory, and only writes them when an
+   * output directory is specified.
+   */
+  bool
+  WriteResultsToOutputDirectory(void) const;
+
   /** Function to transform coordinates from fixed to moving image. */
   void
   TransformPointsSomePoints(const std::string & filename) const;
@@ -349,6 +443,14 @@ private:
   typename DeformationFieldImageType::Pointer
   GenerateDeformationFieldImage(void) const;
 
+  /** Idem, but when a writer is specified, it is connected to the end of the
+   * pipeline and updated, instead. The writer may then stream the field to
+   * disk piece by piece, without ever having to hold it in memory. A null
+   * pointer is returned in that case.
+   */
+  typename DeformationFieldImageType::Pointer
+  GenerateDeformationFieldImage(itk::ImageFileWriter<DeformationFieldImageType> * writer) const;
+
   void WriteDeformationFieldImage(typename DeformationFieldImageType::Pointer) const;
 
   /** Legacy function that calls GenerateDeformationFieldImage and WriteDeformationFieldImage. */
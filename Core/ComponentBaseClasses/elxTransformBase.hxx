@@ -32,6 +32,7 @@
 #include "itkTransformToDisplacementFieldFilter.h"
 #include "itkTransformToDeterminantOfSpatialJacobianSource.h"
 #include "itkTransformToSpatialJacobianSource.h"
+#include "itkTransformToInverseDisplacementFieldSource.h"
 #include "itkImageFileWriter.h"
 #include "itkImageGridSampler.h"
 #include "itkContinuousIndex.h"
@@ -39,9 +40,15 @@
 #include "itkMesh.h"
 #include "itkMeshFileReader.h"
 #include "itkMeshFileWriter.h"
-#include "itkTransformMeshFilter.h"
+#include "itkParallelTasks.h"
+#include "itkByteSwapper.h"
 #include "itkCommonEnums.h"
 
+#ifdef ELASTIX_USE_OPENCL
+#  include "itkOpenCLContext.h"
+#  include "itkGPUBSplineTransformToImageSource.h"
+#endif
+
 #include <cassert>
 #include <fstream>
 #include <iomanip> // For setprecision.
@@ -197,6 +204,17 @@ TransformBase<TElastix>::BeforeAllTransformix(void)
     elxout << "-jacmat   " << check << std::endl;
   }
 
+  /** Check for appearance of "-inv". */
+  check = this->m_Configuration->GetCommandLineArgument("-inv");
+  if (check.empty())
+  {
+    elxout << "-inv      unspecified, so no inverse deformation field computed" << std::endl;
+  }
+  else
+  {
+    elxout << "-inv      " << check << std::endl;
+  }
+
   /** Return a value. */
   return returndummy;
 
@@ -275,6 +293,16 @@ TransformBase<TElastix>::SetInitialTransform(InitialTransformType * _arg)
   /** Set initial transform. */
   this->GetAsITKBaseType()->SetInitialTransform(_arg);
 
+  /** Fold a linear chain of initial transforms into a single matrix-offset
+   * transform, so that the chain is not evaluated for every sample.
+   */
+  bool flattenLinearInitialTransform = true;
+  this->m_Configuration->ReadParameter(flattenLinearInitialTransform, "FlattenLinearInitialTransform", 0, false);
+  if (flattenLinearInitialTransform && this->GetAsITKBaseType()->FlattenInitialTransform())
+  {
+    elxout << "The linear initial transform is flattened into a single matrix-offset transform." << std::endl;
+  }
+
   // \todo AdvancedCombinationTransformType
 
 } // end SetInitialTransform()
@@ -352,12 +380,31 @@ TransformBase<TElastix>::ReadFromFile(void)
       {
         std::string dataFileName = "";
         this->m_Configuration->ReadParameter(dataFileName, "TransformParameters", 0);
+
+        /** A relative path that is not found from the working directory is
+         * looked up next to the transform parameter file, so that both files
+         * can be moved together.
+         */
+        if (!itksys::SystemTools::FileExists(dataFileName) && !itksys::SystemTools::FileIsFullPath(dataFileName))
+        {
+          const std::string candidate =
+            itksys::SystemTools::GetFilenamePath(this->m_Configuration->GetParameterFileName()) + "/" +
+            itksys::SystemTools::GetFilenameName(dataFileName);
+          if (itksys::SystemTools::FileExists(candidate))
+          {
+            dataFileName = candidate;
+          }
+        }
+
+        /** Read the little endian doubles directly into the parameter array. */
         std::ifstream infile(dataFileName, std::ios_base::binary);
         m_TransformParameters.SetSize(numberOfParameters);
         infile.read(reinterpret_cast<char *>(m_TransformParameters.data_block()),
                     sizeof(ValueType) * numberOfParameters);
         numberOfParametersFound = infile.gcount() / sizeof(ValueType); // for sanity check
         infile.close();
+        itk::ByteSwapper<ValueType>::SwapRangeFromSystemToLittleEndian(m_TransformParameters.data_block(),
+                                                                        numberOfParametersFound);
       }
       else
       {
@@ -560,7 +607,10 @@ TransformBase<TElastix>::WriteToFile(xl::xoutsimple & transformationParameterInf
 {
   ParameterMapType parameterMap;
 
-  this->CreateTransformParametersMap(param, parameterMap);
+  /** When the parameters are written in binary format, converting them to
+   * strings first would only be a waste of time and memory for large transforms.
+   */
+  this->CreateTransformParametersMap(param, parameterMap, !this->m_UseBinaryFormatForTransformationParameters);
 
   /** Write the parameters of this transform. */
   if (this->m_ReadWriteTransformParameters)
@@ -572,8 +622,19 @@ TransformBase<TElastix>::WriteToFile(xl::xoutsimple & transformationParameterInf
       dataFileName += ".dat";
       parameterMap["TransformParameters"] = { dataFileName };
 
+      /** The data file is always little endian, so that it can be shared between platforms. */
       std::ofstream outfile(dataFileName, std::ios_base::binary);
-      outfile.write(reinterpret_cast<const char *>(param.data_block()), sizeof(ValueType) * param.size());
+      if (itk::ByteSwapper<ValueType>::SystemIsBigEndian())
+      {
+        ParametersType swappedParam(param);
+        itk::ByteSwapper<ValueType>::SwapRangeFromSystemToLittleEndian(swappedParam.data_block(), swappedParam.size());
+        outfile.write(reinterpret_cast<const char *>(swappedParam.data_block()),
+                      sizeof(ValueType) * swappedParam.size());
+      }
+      else
+      {
+        outfile.write(reinterpret_cast<const char *>(param.data_block()), sizeof(ValueType) * param.size());
+      }
       outfile.close();
     }
   }
@@ -629,7 +690,8 @@ TransformBase<TElastix>::WriteToFile(xl::xoutsimple & transformationParameterInf
 template <class TElastix>
 void
 TransformBase<TElastix>::CreateTransformParametersMap(const ParametersType & param,
-                                                      ParameterMapType &     parameterMap) const
+                                                      ParameterMapType &     parameterMap,
+                                                      const bool             includeTransformParameters) const
 {
   const auto & elastixObject = *(this->GetElastix());
 
@@ -671,7 +733,7 @@ TransformBase<TElastix>::CreateTransformParametersMap(const ParametersType & par
                    { "UseDirectionCosines", { Conversion::ToString(elastixObject.GetUseDirectionCosines()) } } };
 
   /** Write the parameters of this transform. */
-  if (this->m_ReadWriteTransformParameters)
+  if (this->m_ReadWriteTransformParameters && includeTransformParameters)
   {
     /** In this case, write in a normal way to the parameter file. */
     parameterMap["TransformParameters"] = { Conversion::ToVectorOfStrings(param) };
@@ -839,10 +901,6 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
   dummyImage->SetSpacing(spacing);
   dummyImage->SetDirection(direction);
 
-  /** Temp vars */
-  FixedImageContinuousIndexType  fixedcindex;
-  MovingImageContinuousIndexType movingcindex;
-
   /** Also output moving image indices if a moving image was supplied. */
   bool                              alsoMovingIndices = false;
   typename MovingImageType::Pointer movingImage = this->GetElastix()->GetMovingImage();
@@ -861,6 +919,7 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
       point.Fill(0.0f);
       inputPointSet->GetPoint(j, &point);
       inputpointvec[j] = point;
+      FixedImageContinuousIndexType fixedcindex;
       dummyImage->TransformPhysicalPointToContinuousIndex(point, fixedcindex);
       for (unsigned int i = 0; i < FixedImageDimension; ++i)
       {
@@ -887,32 +946,74 @@ TransformBase<TElastix>::TransformPointsSomePoints(const std::string & filename)
     }
   }
 
-  /** Apply the transform. */
+  /** Apply the transform. The points are independent of each other, so they are
+   * transformed in parallel. The results are written afterwards, serially. */
   elxout << "  The input points are transformed." << std::endl;
-  for (unsigned int j = 0; j < nrofpoints; ++j)
+  const CombinationTransformType * const transform = this->GetAsITKBaseType();
+  itk::ParallelTasks::ParallelizeArray(
+    0,
+    nrofpoints,
+    [&](const itk::SizeValueType j) {
+      /** Call TransformPoint. */
+      outputpointvec[j] = transform->TransformPoint(inputpointvec[j]);
+
+      /** Transform back to index in fixed image domain. */
+      FixedImageContinuousIndexType fixedcindex;
+      dummyImage->TransformPhysicalPointToContinuousIndex(outputpointvec[j], fixedcindex);
+      for (unsigned int i = 0; i < FixedImageDimension; ++i)
+      {
+        outputindexfixedvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<double>(fixedcindex[i]));
+      }
+
+      if (alsoMovingIndices)
+      {
+        /** Transform back to index in moving image domain. */
+        MovingImageContinuousIndexType movingcindex;
+        movingImage->TransformPhysicalPointToContinuousIndex(outputpointvec[j], movingcindex);
+        for (unsigned int i = 0; i < MovingImageDimension; ++i)
+        {
+          outputindexmovingvec[j][i] =
+            static_cast<MovingImageIndexValueType>(itk::Math::Round<double>(movingcindex[i]));
+        }
+      }
+
+      /** Compute displacement. */
+      deformationvec[j].CastFrom(outputpointvec[j] - inputpointvec[j]);
+    });
+
+  /** The elastix library keeps the transformed points in memory. */
+  if (BaseComponent::IsElastixLibrary())
   {
-    /** Call TransformPoint. */
-    outputpointvec[j] = this->GetAsITKBaseType()->TransformPoint(inputpointvec[j]);
+    const auto outputPoints = OutputPointSetType::PointsContainer::New();
+    outputPoints->CastToSTLContainer() = outputpointvec;
+    const auto outputPointSet = OutputPointSetType::New();
+    outputPointSet->SetPoints(outputPoints);
+    this->m_Elastix->SetResultPointSet(outputPointSet);
+  }
+  if (!this->WriteResultsToOutputDirectory())
+  {
+    return;
+  }
 
-    /** Transform back to index in fixed image domain. */
-    dummyImage->TransformPhysicalPointToContinuousIndex(outputpointvec[j], fixedcindex);
-    for (unsigned int i = 0; i < FixedImageDimension; ++i)
+  /** Optionally also write the output points in binary form, which is much faster
+   * to write and to read back than the formatted text. */
+  bool writeBinaryOutputPoints = false;
+  this->m_Configuration->ReadParameter(writeBinaryOutputPoints, "WriteBinaryOutputPoints", 0, false);
+  if (writeBinaryOutputPoints)
+  {
+    std::string outputPointsBinaryFileName = this->m_Configuration->GetCommandLineArgument("-out");
+    outputPointsBinaryFileName += "outputpoints.raw";
+    elxout << "  The transformed points are also saved in binary form in: " << outputPointsBinaryFileName << std::endl;
+    std::ofstream outputPointsBinaryFile(outputPointsBinaryFileName, std::ios::binary);
+    for (const auto & outputPoint : outputpointvec)
     {
-      outputindexfixedvec[j][i] = static_cast<FixedImageIndexValueType>(itk::Math::Round<double>(fixedcindex[i]));
+      outputPointsBinaryFile.write(reinterpret_cast<const char *>(outputPoint.GetDataPointer()),
+                                   sizeof(typename OutputPointType::ValueType) * MovingImageDimension);
     }
-
-    if (alsoMovingIndices)
+    if (!outputPointsBinaryFile)
     {
-      /** Transform back to index in moving image domain. */
-      movingImage->TransformPhysicalPointToContinuousIndex(outputpointvec[j], movingcindex);
-      for (unsigned int i = 0; i < MovingImageDimension; ++i)
-      {
-        outputindexmovingvec[j][i] = static_cast<MovingImageIndexValueType>(itk::Math::Round<double>(movingcindex[i]));
-      }
+      xl::xout["error"] << "  Error while saving points to " << outputPointsBinaryFileName << std::endl;
     }
-
-    /** Compute displacement. */
-    deformationvec[j].CastFrom(outputpointvec[j] - inputpointvec[j]);
   }
 
   /** Create filename and file stream. */
@@ -998,7 +1099,6 @@ TransformBase<TElastix>::TransformPointsSomePointsVTK(const std::string & filena
   typedef itk::Mesh<DummyIPPPixelType, FixedImageDimension, MeshTraitsType>      MeshType;
   typedef itk::MeshFileReader<MeshType>                                          MeshReaderType;
   typedef itk::MeshFileWriter<MeshType>                                          MeshWriterType;
-  typedef itk::TransformMeshFilter<MeshType, MeshType, CombinationTransformType> TransformMeshFilterType;
 
   /** Read the input points. */
   const auto meshReader = MeshReaderType::New();
@@ -1019,19 +1119,38 @@ TransformBase<TElastix>::TransformPointsSomePointsVTK(const std::string & filena
   unsigned long nrofpoints = meshReader->GetOutput()->GetNumberOfPoints();
   elxout << "  Number of specified input points: " << nrofpoints << std::endl;
 
-  /** Apply the transform. */
+  /** Apply the transform. The points are transformed in place, in parallel, so that
+   * the mesh topology and point data are written unchanged. */
   elxout << "  The input points are transformed." << std::endl;
-  const auto meshTransformer = TransformMeshFilterType::New();
-  meshTransformer->SetTransform(const_cast<CombinationTransformType *>(this->GetAsITKBaseType()));
-  meshTransformer->SetInput(meshReader->GetOutput());
-  try
+  const typename MeshType::Pointer mesh = meshReader->GetOutput();
+  mesh->DisconnectPipeline();
+  typename MeshType::PointsContainer * const points = mesh->GetPoints();
+  if (points != nullptr)
   {
-    meshTransformer->Update();
+    const CombinationTransformType * const transform = this->GetAsITKBaseType();
+    itk::ParallelTasks::ParallelizeArray(
+      0,
+      points->Size(),
+      [points, transform](const itk::SizeValueType j) {
+        points->ElementAt(j) = transform->TransformPoint(points->ElementAt(j));
+      });
   }
-  catch (itk::ExceptionObject & err)
+
+  /** The elastix library keeps the transformed points in memory. */
+  if (BaseComponent::IsElastixLibrary())
   {
-    xl::xout["error"] << "  Error while transforming points." << std::endl;
-    xl::xout["error"] << err << std::endl;
+    const auto outputPoints = OutputPointSetType::PointsContainer::New();
+    if (points != nullptr)
+    {
+      outputPoints->CastToSTLContainer() = points->CastToSTLConstContainer();
+    }
+    const auto outputPointSet = OutputPointSetType::New();
+    outputPointSet->SetPoints(outputPoints);
+    this->m_Elastix->SetResultPointSet(outputPointSet);
+  }
+  if (!this->WriteResultsToOutputDirectory())
+  {
+    return;
   }
 
   /** Create filename and file stream. */
@@ -1040,7 +1159,15 @@ TransformBase<TElastix>::TransformPointsSomePointsVTK(const std::string & filena
   elxout << "  The transformed points are saved in: " << outputPointsFileName << std::endl;
   const auto meshWriter = MeshWriterType::New();
   meshWriter->SetFileName(outputPointsFileName.c_str());
-  meshWriter->SetInput(meshTransformer->GetOutput());
+  meshWriter->SetInput(mesh);
+
+  /** Binary vtk files are much smaller, and faster to write and to read back. */
+  bool writeBinaryOutputMesh = false;
+  this->m_Configuration->ReadParameter(writeBinaryOutputMesh, "WriteBinaryOutputMesh", 0, false);
+  if (writeBinaryOutputMesh)
+  {
+    meshWriter->SetFileTypeAsBINARY();
+  }
 
   try
   {
@@ -1067,15 +1194,31 @@ template <class TElastix>
 void
 TransformBase<TElastix>::TransformPointsAllPoints(void) const
 {
-  typename DeformationFieldImageType::Pointer deformationfield = this->GenerateDeformationFieldImage();
-  // put deformation field in container
-  this->m_Elastix->SetResultDeformationField(deformationfield.GetPointer());
-
-  if (!BaseComponent::IsElastixLibrary())
+  if (BaseComponent::IsElastixLibrary())
   {
-    WriteDeformationFieldImage(deformationfield);
+    typename DeformationFieldImageType::Pointer deformationfield = this->GenerateDeformationFieldImage();
+    // put deformation field in container
+    this->m_Elastix->SetResultDeformationField(deformationfield.GetPointer());
+    return;
   }
 
+  /** Create a name for the deformation field file. */
+  std::string resultImageFormat = "mhd";
+  this->m_Configuration->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
+  std::ostringstream makeFileName("");
+  makeFileName << this->m_Configuration->GetCommandLineArgument("-out") << "deformationField." << resultImageFormat;
+
+  /** Possibly stream the generation and the writing, to limit the memory usage. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+
+  const auto defWriter = itk::ImageFileWriter<DeformationFieldImageType>::New();
+  defWriter->SetFileName(makeFileName.str().c_str());
+  defWriter->SetNumberOfStreamDivisions(numberOfStreamDivisions);
+
+  elxout << "  Computing and writing the deformation field ..." << std::endl;
+  this->GenerateDeformationFieldImage(defWriter);
+
 } // end TransformPointsAllPoints()
 
 
@@ -1090,6 +1233,20 @@ TransformBase<TElastix>::TransformPointsAllPoints(void) const
 template <class TElastix>
 typename TransformBase<TElastix>::DeformationFieldImageType::Pointer
 TransformBase<TElastix>::GenerateDeformationFieldImage(void) const
+{
+  return this->GenerateDeformationFieldImage(nullptr);
+
+} // end GenerateDeformationFieldImage()
+
+
+/**
+ * ************** GenerateDeformationFieldImage **********************
+ */
+
+template <class TElastix>
+typename TransformBase<TElastix>::DeformationFieldImageType::Pointer
+TransformBase<TElastix>::GenerateDeformationFieldImage(
+  itk::ImageFileWriter<DeformationFieldImageType> * const writer) const
 {
   /** Typedef's. */
   typedef typename FixedImageType::DirectionType FixedImageDirectionType;
@@ -1114,15 +1271,28 @@ TransformBase<TElastix>::GenerateDeformationFieldImage(void) const
   bool                    retdc = this->GetElastix()->GetOriginalFixedImageDirection(originalDirection);
   infoChanger->SetOutputDirection(originalDirection);
   infoChanger->SetChangeDirection(retdc & !this->GetElastix()->GetUseDirectionCosines());
-  infoChanger->SetInput(defGenerator->GetOutput());
+
+  /** Possibly generate the deformation field with OpenCL instead. */
+  const auto openCLGenerator = this->template CreateOpenCLImageSource<DeformationFieldImageType>();
+  itk::ImageSource<DeformationFieldImageType> & generator =
+    openCLGenerator.IsNotNull() ? *openCLGenerator : *defGenerator;
+  infoChanger->SetInput(generator.GetOutput());
 
   /** Track the progress of the generation of the deformation field. */
   const auto progressObserver =
-    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(*defGenerator);
+    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(generator);
 
   try
   {
-    infoChanger->Update();
+    if (writer != nullptr)
+    {
+      writer->SetInput(infoChanger->GetOutput());
+      writer->Update();
+    }
+    else
+    {
+      infoChanger->Update();
+    }
   }
   catch (itk::ExceptionObject & excp)
   {
@@ -1136,6 +1306,11 @@ TransformBase<TElastix>::GenerateDeformationFieldImage(void) const
     throw excp;
   }
 
+  /** The output of a streaming writer holds only the last piece of the field. */
+  if (writer != nullptr)
+  {
+    return nullptr;
+  }
   return infoChanger->GetOutput();
 } // end GenerateDeformationFieldImage()
 
@@ -1209,7 +1384,7 @@ TransformBase<TElastix>::ComputeDeterminantOfSpatialJacobian(void) const
   }
 
   /** Typedef's. */
-  typedef itk::Image<float, FixedImageDimension>                                              JacobianImageType;
+  typedef DeterminantOfSpatialJacobianImageType                                               JacobianImageType;
   typedef itk::TransformToDeterminantOfSpatialJacobianSource<JacobianImageType, CoordRepType> JacobianGeneratorType;
   typedef itk::ImageFileWriter<JacobianImageType>                                             JacobianWriterType;
   typedef itk::ChangeInformationImageFilter<JacobianImageType>                                ChangeInfoFilterType;
@@ -1235,27 +1410,48 @@ TransformBase<TElastix>::ComputeDeterminantOfSpatialJacobian(void) const
   bool                    retdc = this->GetElastix()->GetOriginalFixedImageDirection(originalDirection);
   infoChanger->SetOutputDirection(originalDirection);
   infoChanger->SetChangeDirection(retdc & !this->GetElastix()->GetUseDirectionCosines());
-  infoChanger->SetInput(jacGenerator->GetOutput());
+
+  /** Possibly compute the Jacobian with OpenCL instead. */
+  const auto openCLGenerator = this->template CreateOpenCLImageSource<JacobianImageType>();
+  itk::ImageSource<JacobianImageType> & generator = openCLGenerator.IsNotNull() ? *openCLGenerator : *jacGenerator;
+  infoChanger->SetInput(generator.GetOutput());
 
   /** Track the progress of the generation of the deformation field. */
   const auto progressObserver =
-    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(*jacGenerator);
+    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(generator);
   /** Create a name for the deformation field file. */
   std::string resultImageFormat = "mhd";
   this->m_Configuration->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
   std::ostringstream makeFileName("");
   makeFileName << this->m_Configuration->GetCommandLineArgument("-out") << "spatialJacobian." << resultImageFormat;
 
+  /** Possibly stream the generation and the writing, to limit the memory usage. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+
   /** Write outputImage to disk. */
   const auto jacWriter = JacobianWriterType::New();
   jacWriter->SetInput(infoChanger->GetOutput());
   jacWriter->SetFileName(makeFileName.str().c_str());
+  jacWriter->SetNumberOfStreamDivisions(numberOfStreamDivisions);
 
-  /** Do the writing. */
-  elxout << "  Computing and writing the spatial Jacobian determinant..." << std::endl;
+  /** Do the computation and the writing. The elastix library first computes the whole
+   * image, to keep it in memory, and only writes it when an output directory is specified.
+   */
+  const bool writeResults = this->WriteResultsToOutputDirectory();
+  elxout << "  Computing " << (writeResults ? "and writing " : "") << "the spatial Jacobian determinant..."
+         << std::endl;
   try
   {
-    jacWriter->Update();
+    if (BaseComponent::IsElastixLibrary())
+    {
+      infoChanger->Update();
+      this->m_Elastix->SetResultDeterminantOfSpatialJacobian(infoChanger->GetOutput());
+    }
+    if (writeResults)
+    {
+      jacWriter->Update();
+    }
   }
   catch (itk::ExceptionObject & excp)
   {
@@ -1292,10 +1488,7 @@ TransformBase<TElastix>::ComputeSpatialJacobian(void) const
   }
 
   /** Typedef's. */
-  typedef float SpatialJacobianComponentType;
-  typedef itk::Matrix<SpatialJacobianComponentType, MovingImageDimension, FixedImageDimension>
-                                                                                 OutputSpatialJacobianType;
-  typedef itk::Image<OutputSpatialJacobianType, FixedImageDimension>             JacobianImageType;
+  typedef SpatialJacobianImageType                                               JacobianImageType;
   typedef itk::TransformToSpatialJacobianSource<JacobianImageType, CoordRepType> JacobianGeneratorType;
   typedef itk::ImageFileWriter<JacobianImageType>                                JacobianWriterType;
   typedef itk::ChangeInformationImageFilter<JacobianImageType>                   ChangeInfoFilterType;
@@ -1323,20 +1516,29 @@ TransformBase<TElastix>::ComputeSpatialJacobian(void) const
   bool                    retdc = this->GetElastix()->GetOriginalFixedImageDirection(originalDirection);
   infoChanger->SetOutputDirection(originalDirection);
   infoChanger->SetChangeDirection(retdc & !this->GetElastix()->GetUseDirectionCosines());
-  infoChanger->SetInput(jacGenerator->GetOutput());
+
+  /** Possibly compute the Jacobian with OpenCL instead. */
+  const auto openCLGenerator = this->template CreateOpenCLImageSource<JacobianImageType>();
+  itk::ImageSource<JacobianImageType> & generator = openCLGenerator.IsNotNull() ? *openCLGenerator : *jacGenerator;
+  infoChanger->SetInput(generator.GetOutput());
 
   const auto progressObserver =
-    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(*jacGenerator);
+    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(generator);
   /** Create a name for the deformation field file. */
   std::string resultImageFormat = "mhd";
   this->m_Configuration->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
   std::ostringstream makeFileName("");
   makeFileName << this->m_Configuration->GetCommandLineArgument("-out") << "fullSpatialJacobian." << resultImageFormat;
 
+  /** Possibly stream the generation and the writing, to limit the memory usage. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+
   /** Write outputImage to disk. */
   const auto jacWriter = JacobianWriterType::New();
   jacWriter->SetInput(infoChanger->GetOutput());
   jacWriter->SetFileName(makeFileName.str().c_str());
+  jacWriter->SetNumberOfStreamDivisions(numberOfStreamDivisions);
   /** Hack to change the pixel type to vector. Not necessary for mhd. */
   const auto jacStartWriteCommand = PixelTypeChangeCommandType::New();
   if (resultImageFormat != "mhd")
@@ -1344,11 +1546,22 @@ TransformBase<TElastix>::ComputeSpatialJacobian(void) const
     jacWriter->AddObserver(itk::StartEvent(), jacStartWriteCommand);
   }
 
-  /** Do the writing. */
-  elxout << "  Computing and writing the spatial Jacobian..." << std::endl;
+  /** Do the computation and the writing. The elastix library first computes the whole
+   * image, to keep it in memory, and only writes it when an output directory is specified.
+   */
+  const bool writeResults = this->WriteResultsToOutputDirectory();
+  elxout << "  Computing " << (writeResults ? "and writing " : "") << "the spatial Jacobian..." << std::endl;
   try
   {
-    jacWriter->Update();
+    if (BaseComponent::IsElastixLibrary())
+    {
+      infoChanger->Update();
+      this->m_Elastix->SetResultSpatialJacobian(infoChanger->GetOutput());
+    }
+    if (writeResults)
+    {
+      jacWriter->Update();
+    }
   }
   catch (itk::ExceptionObject & excp)
   {
@@ -1365,6 +1578,191 @@ TransformBase<TElastix>::ComputeSpatialJacobian(void) const
 } // end ComputeSpatialJacobian()
 
 
+/**
+ * ************** ComputeInverseDeformationField **********************
+ */
+
+template <class TElastix>
+void
+TransformBase<TElastix>::ComputeInverseDeformationField(void) const
+{
+  /** If the optional command "-inv" is given in the command line arguments,
+   * then and only then we continue.
+   */
+  const std::string inv = this->GetConfiguration()->GetCommandLineArgument("-inv");
+  if (inv != "all")
+  {
+    elxout << "  The command-line option \"-inv\" is not used, "
+           << "so no inverse deformation field computed." << std::endl;
+    return;
+  }
+  if (!this->WriteResultsToOutputDirectory())
+  {
+    elxout << "  No output directory is specified, so no inverse deformation field computed." << std::endl;
+    return;
+  }
+
+  /** Typedef's. */
+  typedef itk::TransformToInverseDisplacementFieldSource<DeformationFieldImageType, CoordRepType>
+                                                                       InverseGeneratorType;
+  typedef itk::ImageFileWriter<DeformationFieldImageType>              InverseWriterType;
+  typedef itk::ChangeInformationImageFilter<DeformationFieldImageType> ChangeInfoFilterType;
+  typedef typename FixedImageType::DirectionType                       FixedImageDirectionType;
+
+  /** Create and setup the inverse generator, on the grid of the resampler. */
+  const auto invGenerator = InverseGeneratorType::New();
+  invGenerator->SetTransform(const_cast<const ITKBaseType *>(this->GetAsITKBaseType()));
+  invGenerator->SetOutputSize(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetSize());
+  invGenerator->SetOutputSpacing(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputSpacing());
+  invGenerator->SetOutputOrigin(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputOrigin());
+  invGenerator->SetOutputIndex(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputStartIndex());
+  invGenerator->SetOutputDirection(this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType()->GetOutputDirection());
+
+  unsigned int maximumNumberOfIterations = invGenerator->GetMaximumNumberOfIterations();
+  this->m_Configuration->ReadParameter(maximumNumberOfIterations, "InverseMaximumNumberOfIterations", 0, false);
+  invGenerator->SetMaximumNumberOfIterations(maximumNumberOfIterations);
+  double tolerance = invGenerator->GetTolerance();
+  this->m_Configuration->ReadParameter(tolerance, "InverseTolerance", 0, false);
+  invGenerator->SetTolerance(tolerance);
+  unsigned int coarseGridFactor = invGenerator->GetCoarseGridFactor();
+  this->m_Configuration->ReadParameter(coarseGridFactor, "InverseCoarseGridFactor", 0, false);
+  invGenerator->SetCoarseGridFactor(coarseGridFactor);
+
+  /** Possibly change direction cosines to their original value, as specified
+   * in the tp-file, or by the fixed image. This is only necessary when
+   * the UseDirectionCosines flag was set to false.
+   */
+  const auto              infoChanger = ChangeInfoFilterType::New();
+  FixedImageDirectionType originalDirection;
+  bool                    retdc = this->GetElastix()->GetOriginalFixedImageDirection(originalDirection);
+  infoChanger->SetOutputDirection(originalDirection);
+  infoChanger->SetChangeDirection(retdc & !this->GetElastix()->GetUseDirectionCosines());
+  infoChanger->SetInput(invGenerator->GetOutput());
+
+  const auto progressObserver =
+    BaseComponent::IsElastixLibrary() ? nullptr : ProgressCommandType::CreateAndConnect(*invGenerator);
+
+  /** Create a name for the inverse deformation field file. */
+  std::string resultImageFormat = "mhd";
+  this->m_Configuration->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
+  std::ostringstream makeFileName("");
+  makeFileName << this->m_Configuration->GetCommandLineArgument("-out") << "inverseDeformationField."
+               << resultImageFormat;
+
+  /** Possibly stream the generation and the writing, to limit the memory usage. */
+  unsigned int numberOfStreamDivisions = 1;
+  this->m_Configuration->ReadParameter(numberOfStreamDivisions, "NumberOfStreamDivisions", 0, false);
+
+  const auto invWriter = InverseWriterType::New();
+  invWriter->SetInput(infoChanger->GetOutput());
+  invWriter->SetFileName(makeFileName.str().c_str());
+  invWriter->SetNumberOfStreamDivisions(numberOfStreamDivisions);
+
+  /** Do the computation and the writing. */
+  elxout << "  Computing and writing the inverse deformation field..." << std::endl;
+  try
+  {
+    invWriter->Update();
+  }
+  catch (itk::ExceptionObject & excp)
+  {
+    /** Add information to the exception. */
+    excp.SetLocation("TransformBase - ComputeInverseDeformationField()");
+    std::string err_str = excp.GetDescription();
+    err_str += "\nError occurred while writing inverse deformation field image.\n";
+    excp.SetDescription(err_str);
+
+    /** Pass the exception to an higher level. */
+    throw excp;
+  }
+
+  const unsigned long numberOfUnconvergedPoints = invGenerator->GetNumberOfUnconvergedPoints();
+  if (numberOfUnconvergedPoints > 0)
+  {
+    xl::xout["warning"] << "WARNING: The inverse did not converge to the tolerance in " << numberOfUnconvergedPoints
+                        << " points, e.g. because the transform folds there, or maps them from outside the grid."
+                        << std::endl;
+  }
+
+} // end ComputeInverseDeformationField()
+
+
+/**
+ * ************** CreateOpenCLImageSource **********************
+ */
+
+template <class TElastix>
+template <class TImage>
+typename itk::ImageSource<TImage>::Pointer
+TransformBase<TElastix>::CreateOpenCLImageSource(void) const
+{
+  bool useOpenCL = false;
+  this->m_Configuration->ReadParameter(useOpenCL, "TransformUseOpenCL", 0, false);
+  if (!useOpenCL)
+  {
+    return nullptr;
+  }
+
+#ifdef ELASTIX_USE_OPENCL
+  typedef itk::GPUBSplineTransformToImageSource<TImage, CoordRepType> OpenCLSourceType;
+
+  if (!itk::OpenCLContext::GetInstance()->IsCreated())
+  {
+    xl::xout["warning"] << "WARNING: The OpenCL context is not created, so the computation is done on the CPU."
+                        << std::endl;
+    return nullptr;
+  }
+  if (!OpenCLSourceType::IsSupportedTransform(this->GetAsITKBaseType()))
+  {
+    elxout << "  The transform is not supported by OpenCL, so the computation is done on the CPU." << std::endl;
+    return nullptr;
+  }
+
+  /** The construction builds the OpenCL program, which may fail. */
+  typename OpenCLSourceType::Pointer source;
+  try
+  {
+    source = OpenCLSourceType::New();
+  }
+  catch (itk::ExceptionObject & excp)
+  {
+    xl::xout["warning"] << "WARNING: The OpenCL program could not be built, so the computation is done on the CPU.\n"
+                        << excp.GetDescription() << std::endl;
+    return nullptr;
+  }
+
+  const auto resampler = this->m_Elastix->GetElxResamplerBase()->GetAsITKBaseType();
+  source->SetTransform(this->GetAsITKBaseType());
+  source->SetOutputSize(resampler->GetSize());
+  source->SetOutputSpacing(resampler->GetOutputSpacing());
+  source->SetOutputOrigin(resampler->GetOutputOrigin());
+  source->SetOutputIndex(resampler->GetOutputStartIndex());
+  source->SetOutputDirection(resampler->GetOutputDirection());
+  elxout << "  The computation is done with OpenCL." << std::endl;
+  return source.GetPointer();
+#else
+  xl::xout["warning"] << "WARNING: elastix is built without OpenCL, so the computation is done on the CPU."
+                      << std::endl;
+  return nullptr;
+#endif
+} // end CreateOpenCLImageSource()
+
+
+/**
+ * ************** WriteResultsToOutputDirectory ****************
+ */
+
+template <class TElastix>
+bool
+TransformBase<TElastix>::WriteResultsToOutputDirectory(void) const
+{
+  /** Without an output directory, the library gets "-out output_path_not_set". */
+  return !BaseComponent::IsElastixLibrary() ||
+         itksys::SystemTools::FileIsDirectory(this->m_Configuration->GetCommandLineArgument("-out"));
+
+} // end WriteResultsToOutputDirectory()
+
+
 /**
  * ************** SetTransformParametersFileName ****************
  */
@@ -21,6 +21,10 @@
 #include "elxConversion.h"
 #include "elxTransformIO.h"
 
+#include <itksys/SystemTools.hxx>
+#include <mutex>
+#include <utility> // For move.
+
 namespace elastix
 {
 namespace
@@ -70,6 +74,30 @@ AddDataFromExternalTransformFile(const std::string &                        para
   return parameterMap;
 }
 
+
+/** The parameter files read by Configuration::Initialize, when caching is enabled. A cached file is
+ * read again when its modification time or its length has changed. */
+struct ParameterFileCache
+{
+  struct Entry
+  {
+    long int                                   ModifiedTime;
+    unsigned long                              FileLength;
+    itk::ParameterFileParser::ParameterMapType ParameterMap;
+  };
+
+  std::mutex                   Mutex;
+  bool                         Enabled{ false };
+  std::map<std::string, Entry> Entries;
+};
+
+ParameterFileCache &
+GetParameterFileCache(void)
+{
+  static ParameterFileCache cache;
+  return cache;
+}
+
 } // namespace
 /**
  * ********************* Constructor ****************************
@@ -146,6 +174,38 @@ Configuration::BeforeAllTransformix(void)
 } // end BeforeAllTransformix()
 
 
+/**
+ * ******************* SetParameterFileCaching *******************
+ */
+
+void
+Configuration::SetParameterFileCaching(const bool enabled)
+{
+  ParameterFileCache &        cache = GetParameterFileCache();
+  std::lock_guard<std::mutex> cacheLock(cache.Mutex);
+  cache.Enabled = enabled;
+  if (!enabled)
+  {
+    cache.Entries.clear();
+  }
+
+} // end SetParameterFileCaching()
+
+
+/**
+ * ******************* GetParameterFileCaching *******************
+ */
+
+bool
+Configuration::GetParameterFileCaching(void)
+{
+  ParameterFileCache &        cache = GetParameterFileCache();
+  std::lock_guard<std::mutex> cacheLock(cache.Mutex);
+  return cache.Enabled;
+
+} // end GetParameterFileCaching()
+
+
 /**
  * ********************** Initialize ****************************
  */
@@ -197,22 +257,45 @@ Configuration::Initialize(const CommandLineArgumentMapType & _arg)
     return 1;
   }
 
-  /** Read the ParameterFile. */
+  /** Read the ParameterFile, unless it is in the cache and has not changed since. */
   this->m_ParameterFileParser->SetParameterFileName(this->m_ParameterFileName);
-  try
+  ParameterFileParserType::ParameterMapType parameterMap;
+  ParameterFileCache &                      cache = GetParameterFileCache();
+  std::unique_lock<std::mutex>              cacheLock(cache.Mutex);
+  const auto                                modifiedTime = itksys::SystemTools::ModifiedTime(m_ParameterFileName);
+  const auto                                fileLength = itksys::SystemTools::FileLength(m_ParameterFileName);
+  const auto                                cachedFile = cache.Entries.find(m_ParameterFileName);
+
+  if (cache.Enabled && (cachedFile != cache.Entries.end()) && (cachedFile->second.ModifiedTime == modifiedTime) &&
+      (cachedFile->second.FileLength == fileLength))
   {
-    xl::xout["standard"] << "Reading the elastix parameters from file ...\n" << std::endl;
-    this->m_ParameterFileParser->ReadParameterFile();
+    xl::xout["standard"] << "Reusing the elastix parameters of the previously read file ...\n" << std::endl;
+    parameterMap = cachedFile->second.ParameterMap;
   }
-  catch (itk::ExceptionObject & excp)
+  else
   {
-    xl::xout["error"] << "ERROR: when reading the parameter file:\n" << excp << std::endl;
-    return 1;
+    try
+    {
+      xl::xout["standard"] << "Reading the elastix parameters from file ...\n" << std::endl;
+      this->m_ParameterFileParser->ReadParameterFile();
+    }
+    catch (itk::ExceptionObject & excp)
+    {
+      xl::xout["error"] << "ERROR: when reading the parameter file:\n" << excp << std::endl;
+      return 1;
+    }
+    parameterMap = m_ParameterFileParser->GetParameterMap();
+
+    if (cache.Enabled)
+    {
+      cache.Entries[m_ParameterFileName] = { modifiedTime, fileLength, parameterMap };
+    }
   }
+  cacheLock.unlock();
 
   /** Connect the parameter file reader to the interface. */
   this->m_ParameterMapInterface->SetParameterMap(
-    AddDataFromExternalTransformFile(m_ParameterFileName, m_ParameterFileParser->GetParameterMap()));
+    AddDataFromExternalTransformFile(m_ParameterFileName, std::move(parameterMap)));
 
   /** Silently check in the parameter file if error messages should be printed. */
   this->m_ParameterMapInterface->SetPrintErrorMessages(false);
@@ -99,6 +99,16 @@ public:
   virtual int
   Initialize(const CommandLineArgumentMapType & _arg, const ParameterFileParserType::ParameterMapType & inputMap);
 
+  /** Set/Get whether the parameter files read by Initialize() are kept for the process, to be reused
+   * by a next Configuration, as long as the file has not been modified. Disabled by default; the
+   * service mode of transformix enables it. Disabling it clears the cache.
+   */
+  static void
+  SetParameterFileCaching(const bool enabled);
+
+  static bool
+  GetParameterFileCaching(void);
+
   /** True, if Initialize was successfully called. */
   virtual bool
   IsInitialized(void) const; // to elxconfigurationbase
@@ -18,6 +18,7 @@
 #include "elxElastixBase.h"
 #include <Core/elxVersionMacros.h>
 #include "elxConversion.h"
+#include <atomic>
 #include <sstream>
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
@@ -122,6 +123,11 @@ GenerateFileNameContainer(const Configuration & configuration,
 
 } // end GenerateFileNameContainer()
 
+
+/** The number of registrations and transformations that are running, and that have been started. */
+std::atomic<unsigned int>  g_NumberOfRunningRegistrations{ 0 };
+std::atomic<std::uint64_t> g_NumberOfStartedRegistrations{ 0 };
+
 } // end unnamed namespace
 
 
@@ -304,8 +310,7 @@ ElastixBase::BeforeAllBase(void)
     ++i;
   }
 
-  /** Check for appearance of "-priority", if this is a Windows station. */
-#ifdef _WIN32
+  /** Check for appearance of "-priority". */
   check = this->GetConfiguration()->GetCommandLineArgument("-priority");
   if (check.empty())
   {
@@ -315,7 +320,13 @@ ElastixBase::BeforeAllBase(void)
   {
     elxout << "-priority " << check << std::endl;
   }
-#endif
+
+  /** Check for appearance of "-affinity", which limits elastix to a list of CPUs. */
+  check = this->GetConfiguration()->GetCommandLineArgument("-affinity");
+  if (!check.empty())
+  {
+    elxout << "-affinity " << check << std::endl;
+  }
 
   /** Check for appearance of -threads, which specifies the maximum number of threads. */
   check = this->GetConfiguration()->GetCommandLineArgument("-threads");
@@ -445,9 +456,50 @@ ElastixBase::BeforeRegistrationBase(void)
   this->m_IterationInfo.SetOutputs(xl::xout.GetCOutputs());
   this->m_IterationInfo.SetOutputs(xl::xout.GetXOutputs());
 
+  /** Write the intermediate results in a background thread, if desired. At most two
+   * results wait to be written, to bound the memory that the queue uses. */
+  bool writeInBackground = false;
+  this->m_Configuration->ReadParameter(writeInBackground, "WriteIntermediateResultsInBackground", 0, false);
+  this->m_BackgroundWriter.reset(writeInBackground ? new itk::BackgroundTaskQueue(2) : nullptr);
+
 } // end BeforeRegistrationBase()
 
 
+/**
+ * ************************ WaitForBackgroundWriter ******************
+ */
+
+void
+ElastixBase::WaitForBackgroundWriter(void)
+{
+  if (this->m_BackgroundWriter)
+  {
+    this->m_BackgroundWriter->Wait();
+    this->ReportBackgroundWriterErrors();
+  }
+
+} // end WaitForBackgroundWriter()
+
+
+/**
+ * ************************ ReportBackgroundWriterErrors ******************
+ */
+
+void
+ElastixBase::ReportBackgroundWriterErrors(void)
+{
+  if (this->m_BackgroundWriter)
+  {
+    for (const auto & errorMessage : this->m_BackgroundWriter->TakeErrorMessages())
+    {
+      xl::xout["error"] << "ERROR: writing an intermediate result failed:\n"
+                        << errorMessage << "\nResuming elastix." << std::endl;
+    }
+  }
+
+} // end ReportBackgroundWriterErrors()
+
+
 /**
  * ********************** GetResultImage *************************
  */
@@ -568,4 +620,47 @@ ElastixBase::GetConfiguration(const size_t index) const
 }
 
 
+/**
+ * ************** GetNumberOfRunningRegistrations ****************
+ */
+
+unsigned int
+ElastixBase::GetNumberOfRunningRegistrations(void)
+{
+  return g_NumberOfRunningRegistrations;
+
+} // end GetNumberOfRunningRegistrations()
+
+
+/**
+ * ************** GetNumberOfStartedRegistrations ****************
+ */
+
+std::uint64_t
+ElastixBase::GetNumberOfStartedRegistrations(void)
+{
+  return g_NumberOfStartedRegistrations;
+
+} // end GetNumberOfStartedRegistrations()
+
+
+/**
+ * ************** RunningRegistrationCounter ****************
+ */
+
+ElastixBase::RunningRegistrationCounter::RunningRegistrationCounter()
+{
+  ++g_NumberOfStartedRegistrations;
+  ++g_NumberOfRunningRegistrations;
+
+} // end RunningRegistrationCounter()
+
+
+ElastixBase::RunningRegistrationCounter::~RunningRegistrationCounter()
+{
+  --g_NumberOfRunningRegistrations;
+
+} // end ~RunningRegistrationCounter()
+
+
 } // end namespace elastix
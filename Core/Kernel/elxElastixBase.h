@@ -33,17 +33,27 @@
 #include "elxConfiguration.h"
 #include "elxMacro.h"
 #include "xoutmain.h"
+#include "itkBackgroundTaskQueue.h"
+#include "itkTransformParametersLog.h"
 
 // ITK header files:
 #include <itkChangeInformationImageFilter.h>
 #include <itkDataObject.h>
 #include <itkImageFileReader.h>
+#include <itkMetaDataDictionary.h>
 #include <itkObject.h>
+#include <itkOptimizerParameters.h>
 #include <itkTimeProbe.h>
 #include <itkVectorContainer.h>
 
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iomanip>
+#include <memory> // For unique_ptr.
+#include <sstream>
+#include <utility> // For pair.
+#include <vector>
 
 /** Like itkGet/SetObjectMacro, but in these macros the itkDebugMacro is
  * not called. Besides, they are not virtual, since
@@ -184,6 +194,13 @@ public:
   /** Typedef's for Timer class. */
   typedef itk::TimeProbe TimerType;
 
+  /** Type of the function that is called after each iteration, with the resolution level,
+   * the iteration number within that level, and the current position of the optimizer.
+   * The registration is stopped when it returns false.
+   */
+  typedef std::function<bool(unsigned int, unsigned int, const itk::OptimizerParameters<double> &)>
+    IterationCallbackType;
+
   /** Set/Get the Configuration Object. */
   elxGetObjectMacro(Configuration, ConfigurationType);
   elxSetObjectMacro(Configuration, ConfigurationType);
@@ -248,6 +265,17 @@ public:
   elxGetObjectMacro(ResultDeformationFieldContainer, DataObjectContainerType);
   elxSetObjectMacro(ResultDeformationFieldContainer, DataObjectContainerType);
 
+  /** Set/Get the other results of transformix, which are kept in memory by the elastix
+   * library: the determinant of the spatial Jacobian, the spatial Jacobian, and the
+   * transformed points of the input point set.
+   */
+  elxGetObjectMacro(ResultDeterminantOfSpatialJacobian, DataObjectType);
+  elxSetObjectMacro(ResultDeterminantOfSpatialJacobian, DataObjectType);
+  elxGetObjectMacro(ResultSpatialJacobian, DataObjectType);
+  elxSetObjectMacro(ResultSpatialJacobian, DataObjectType);
+  elxGetObjectMacro(ResultPointSet, DataObjectType);
+  elxSetObjectMacro(ResultPointSet, DataObjectType);
+
   /** Set/Get The Image FileName containers.
    * Normally, these are filled in the BeforeAllBase function.
    */
@@ -293,6 +321,81 @@ public:
   elxSetObjectMacro(InitialTransform, ObjectType);
   elxGetObjectMacro(InitialTransform, ObjectType);
 
+  /** Set/Get the function that is called after each iteration. It is called by the
+   * thread that runs the registration, and does not depend on the log output.
+   */
+  void
+  SetIterationCallback(const IterationCallbackType & callback)
+  {
+    this->m_IterationCallback = callback;
+  }
+
+
+  const IterationCallbackType &
+  GetIterationCallback(void) const
+  {
+    return this->m_IterationCallback;
+  }
+
+
+  /** Set/Get the parameters from which the registration is warm started, e.g. the final
+   * parameters of the registration of the previous frame of a sequence. The registration
+   * then starts at the last resolution, from these parameters. Empty by default.
+   */
+  void
+  SetWarmStartParameters(const itk::OptimizerParameters<double> & parameters)
+  {
+    this->m_WarmStartParameters = parameters;
+  }
+
+
+  const itk::OptimizerParameters<double> &
+  GetWarmStartParameters(void) const
+  {
+    return this->m_WarmStartParameters;
+  }
+
+
+  /** Set/Get the dictionary by which the components pass data on to the next registration of
+   * a chain of parameter files, e.g. the parameter estimate of an optimizer. The registrations
+   * of a chain share one dictionary, so that concurrent chains do not see each other's data.
+   */
+  typedef std::shared_ptr<itk::MetaDataDictionary> ChainDictionaryPointer;
+  void
+  SetChainDictionary(const ChainDictionaryPointer & dictionary)
+  {
+    this->m_ChainDictionary = dictionary;
+  }
+
+
+  const ChainDictionaryPointer &
+  GetChainDictionary(void) const
+  {
+    return this->m_ChainDictionary;
+  }
+
+
+  /** Returns the number of registrations and transformations that are running in this process,
+   * and the number that have been started, to check whether a registration runs alone, e.g. for
+   * the hardware counters, which count all threads of the process.
+   */
+  static unsigned int
+  GetNumberOfRunningRegistrations(void);
+
+  static std::uint64_t
+  GetNumberOfStartedRegistrations(void);
+
+
+  /** Returns true when the iteration callback has asked to stop the registration.
+   * The optimizers stop at the current iteration, and no further resolutions are done.
+   */
+  bool
+  GetRegistrationStopRequested(void) const
+  {
+    return this->m_RegistrationStopRequested;
+  }
+
+
   /** Set/Get the final transform
    * The type is ObjectType, but the pointer should actually point
    * to an itk::Transform type (or inherited from that one).
@@ -382,6 +485,26 @@ public:
   ConfigurationPointer
   GetConfiguration(const size_t index) const;
 
+  /** Get the queue in which the intermediate results (the result images and transform parameter
+   * files after each iteration or resolution) are written, in a background thread. Returns null
+   * when WriteIntermediateResultsInBackground is false, so when they are written immediately.
+   */
+  itk::BackgroundTaskQueue *
+  GetBackgroundWriter(void) const
+  {
+    return this->m_BackgroundWriter.get();
+  }
+
+  /** Wait until the background writer has written all intermediate results, and report
+   * the errors of the background writer to the log.
+   */
+  void
+  WaitForBackgroundWriter(void);
+
+  /** Report the errors of the background writer to the log, without waiting. */
+  void
+  ReportBackgroundWriterErrors(void);
+
   xl::xoutrow &
   GetIterationInfo(void)
   {
@@ -400,10 +523,33 @@ public:
     m_IterationInfo.AddTargetCell(name);
   }
 
+  /** Add a measurement to the timings, which are written when (WriteTimings "true") is given. */
+  void
+  AddTiming(const std::string & name, const double value)
+  {
+    m_Timings.emplace_back(name, value);
+  }
+
 protected:
   ElastixBase();
   ~ElastixBase() override = default;
 
+  /** Call the iteration callback, if any, and remember when it asks to stop.
+   * Returns true when the registration should stop.
+   */
+  bool
+  CallIterationCallback(const unsigned int                       level,
+                        const unsigned int                       iteration,
+                        const itk::OptimizerParameters<double> & position)
+  {
+    if (this->m_IterationCallback && !this->m_IterationCallback(level, iteration, position))
+    {
+      this->m_RegistrationStopRequested = true;
+    }
+    return this->m_RegistrationStopRequested;
+  }
+
+
   ConfigurationPointer m_Configuration;
   DBIndexType          m_DBIndex;
 
@@ -423,11 +569,42 @@ protected:
   /** Count the number of iterations. */
   unsigned int m_IterationCounter{};
 
+  /** Whether a transform parameter file is written after each iteration. Read
+   * once per resolution, as it is checked every iteration. */
+  bool m_WriteTransformParametersEachIteration{ false };
+
+  /** The log to which the transform parameters of each iteration are appended, when
+   * TransformParametersEachIterationFormat is "log". Shared with the tasks of the
+   * background writer, which may still be writing to it.
+   */
+  std::shared_ptr<itk::TransformParametersLog> m_TransformParametersLog;
+
+  /** Whether a checkpoint is written at the start of each resolution, and the
+   * number of iterations between the checkpoints within a resolution (0 for none).
+   */
+  bool         m_WriteCheckpoint{ false };
+  unsigned int m_CheckpointIterationInterval{ 0 };
+
+  /** The background writer of the intermediate results, see GetBackgroundWriter(). */
+  std::unique_ptr<itk::BackgroundTaskQueue> m_BackgroundWriter;
+
+  /** The wall times (in seconds) of the phases of the registration, and the
+   * number of iterations of each resolution, in the order of measurement. */
+  std::vector<std::pair<std::string, double>> m_Timings;
+
   /** Stores transformation parameters map. */
   ParameterMapType m_TransformParametersMap;
 
   std::ofstream m_IterationInfoFile;
 
+  /** With the background writer, the iteration info of the current resolution is
+   * collected in m_IterationInfoText, and appended to m_IterationInfoFileName by the
+   * background writer in chunks, see ElastixTemplate::OpenIterationInfoFile().
+   */
+  std::ostringstream m_IterationInfoText;
+  std::string        m_IterationInfoFileName;
+  bool               m_IterationInfoTextIsAppended{ false };
+
   /** Convenient mini class to load the files specified by a filename container
    * The function GenerateImageContainer can be used without instantiating an
    * object of this class, since it is static. It has 2 arguments: the
@@ -508,6 +685,19 @@ protected:
   static DataObjectContainerPointer
   GenerateDataObjectContainer(DataObjectPointer dataObject);
 
+  /** Counts a registration or transformation as running, for as long as it exists. */
+  class RunningRegistrationCounter
+  {
+  public:
+    RunningRegistrationCounter();
+    ~RunningRegistrationCounter();
+
+  private:
+    RunningRegistrationCounter(const RunningRegistrationCounter &) = delete;
+    void
+    operator=(const RunningRegistrationCounter &) = delete;
+  };
+
 private:
   ElastixBase(const Self &) = delete;
   void
@@ -543,6 +733,11 @@ private:
   /** The result deformation field container. These are stored as pointers to itk::DataObject. */
   DataObjectContainerPointer m_ResultDeformationFieldContainer;
 
+  /** The other results of transformix, when they are kept in memory. */
+  DataObjectPointer m_ResultDeterminantOfSpatialJacobian;
+  DataObjectPointer m_ResultSpatialJacobian;
+  DataObjectPointer m_ResultPointSet;
+
   /** The image and mask FileNameContainers. */
   FileNameContainerPointer m_FixedImageFileNameContainer;
   FileNameContainerPointer m_MovingImageFileNameContainer;
@@ -553,6 +748,16 @@ private:
   ObjectPointer m_InitialTransform;
   ObjectPointer m_FinalTransform;
 
+  /** The iteration callback, and whether it asked to stop. */
+  IterationCallbackType m_IterationCallback;
+  bool                  m_RegistrationStopRequested{ false };
+
+  /** The parameters from which the registration is warm started, if any. */
+  itk::OptimizerParameters<double> m_WarmStartParameters;
+
+  /** The dictionary that is shared by the registrations of a chain of parameter files. */
+  ChainDictionaryPointer m_ChainDictionary;
+
   /** Use or ignore direction cosines. */
   bool m_UseDirectionCosines;
 };
@@ -22,6 +22,12 @@
 
 #if defined(_WIN32) && !defined(__CYGWIN__)
 #  include <windows.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+#  include <sched.h>
 #endif
 
 #include "elxElastixMain.h"
@@ -29,33 +35,200 @@
 
 #include "elxMacro.h"
 #include "itkPlatformMultiThreader.h"
+#include "itkThreadBudget.h"
+
+#include <algorithm> // For max.
+#include <atomic>
+#include <sstream>
 
 #ifdef ELASTIX_USE_OPENCL
 #  include "itkOpenCLContext.h"
 #  include "itkOpenCLSetup.h"
 #endif
 
-namespace
-{
 /**
  * ******************* Global variables *************************
  *
  * Some global variables (not part of the ElastixMain class, used
- * by xoutSetup.
+ * by xoutSetup. The global data is used when no xoutManager exists
+ * in the calling thread.
  */
 
-struct Data
+struct elastix::xoutManager::Data
 {
   /** xout TargetCells. */
+  std::ofstream  LogFileStream;
   xl::xoutsimple WarningXout;
   xl::xoutsimple ErrorXout;
   xl::xoutsimple StandardXout;
   xl::xoutsimple CoutOnlyXout;
   xl::xoutsimple LogOnlyXout;
-  std::ofstream  LogFileStream;
+
+  /** The xout of a manager. Not used by the global data, which is set up for the global xout. */
+  xl::xoutmain Xout;
 };
 
-Data g_data;
+namespace
+{
+
+elastix::xoutManager::Data g_data;
+
+/** The data of the manager of the calling thread, if any. */
+thread_local elastix::xoutManager::Data * t_data = nullptr;
+
+elastix::xoutManager::Data &
+GetData(void)
+{
+  return t_data == nullptr ? g_data : *t_data;
+}
+
+/** Whether the OpenCL context outlives the ElastixMain objects, see SetKeepOpenCLContext(). */
+std::atomic<bool> g_KeepOpenCLContext{ false };
+
+/** The CPU numbers of an affinity are below this maximum, which is CPU_SETSIZE on Linux. */
+constexpr int maximumNumberOfCpus = 1024;
+
+/** Parses a list of CPU numbers and ranges, e.g. "0-3,8". Returns false when it is malformed, or when
+ * a number is not below maximumNumberOfCpus.
+ */
+bool
+ParseCpuList(const std::string & cpuList, std::vector<int> & cpus)
+{
+  std::istringstream stream(cpuList);
+  std::string        item;
+  while (std::getline(stream, item, ','))
+  {
+    int        first = -1;
+    int        last = -1;
+    char       dash = '\0';
+    const auto dashPosition = item.find('-');
+    if (dashPosition == std::string::npos)
+    {
+      std::istringstream itemStream(item);
+      if (!(itemStream >> first) || !(itemStream >> std::ws).eof())
+      {
+        return false;
+      }
+      last = first;
+    }
+    else
+    {
+      std::istringstream itemStream(item);
+      if (!(itemStream >> first >> dash >> last) || dash != '-' || !(itemStream >> std::ws).eof())
+      {
+        return false;
+      }
+    }
+    if (first < 0 || last < first || last >= maximumNumberOfCpus)
+    {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+    {
+      cpus.push_back(cpu);
+    }
+  }
+  return !cpus.empty();
+}
+
+
+/** Sets the priority of the process to "high", "abovenormal", "normal", "belownormal" or "idle". On Windows, this
+ * is the priority class of the process. Elsewhere, it is the nice value of the calling thread, which is inherited by
+ * the threads it creates, and "idle" also selects the SCHED_IDLE scheduling policy on Linux. Returns a warning when
+ * the priority is not supported or could not be set, and an empty string otherwise.
+ */
+std::string
+SetPriority(const std::string & priority)
+{
+  const std::string unsupported =
+    "Unsupported -priority value. Specify one of <high, abovenormal, normal, belownormal, idle, ''>.";
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+  DWORD priorityClass = 0;
+  if (priority == "high")
+  {
+    priorityClass = HIGH_PRIORITY_CLASS;
+  }
+  else if (priority == "abovenormal")
+  {
+    priorityClass = ABOVE_NORMAL_PRIORITY_CLASS;
+  }
+  else if (priority == "normal")
+  {
+    priorityClass = NORMAL_PRIORITY_CLASS;
+  }
+  else if (priority == "belownormal")
+  {
+    priorityClass = BELOW_NORMAL_PRIORITY_CLASS;
+  }
+  else if (priority == "idle")
+  {
+    priorityClass = IDLE_PRIORITY_CLASS;
+  }
+  else
+  {
+    return unsupported;
+  }
+  if (SetPriorityClass(GetCurrentProcess(), priorityClass) == 0)
+  {
+    return "The -priority " + priority + " could not be set.";
+  }
+#else
+  int niceValue = 0;
+  if (priority == "high")
+  {
+    niceValue = -10;
+  }
+  else if (priority == "abovenormal")
+  {
+    niceValue = -5;
+  }
+  else if (priority == "belownormal")
+  {
+    niceValue = 10;
+  }
+  else if (priority == "idle")
+  {
+    niceValue = 19;
+  }
+  else if (priority != "normal")
+  {
+    return unsupported;
+  }
+  if (setpriority(PRIO_PROCESS, 0, niceValue) != 0)
+  {
+    return "The -priority " + priority + " could not be set.";
+  }
+
+#  if defined(__linux__)
+  /** Only run when a CPU would otherwise be idle. */
+  if (priority == "idle")
+  {
+    const sched_param parameters{};
+    if (sched_setscheduler(0, SCHED_IDLE, &parameters) != 0)
+    {
+      return "The idle scheduling policy could not be set.";
+    }
+  }
+#  endif
+#endif
+  return std::string();
+}
+
+#if defined(__linux__)
+/** Limits the calling thread, and the threads it creates from then on, to the given CPUs. Returns false on failure. */
+bool
+SetAffinity(const std::vector<int> & cpus)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (const int cpu : cpus)
+  {
+    CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+#endif
 
 } // end unnamed namespace
 
@@ -69,13 +242,14 @@ Data g_data;
 int
 elastix::xoutSetup(const char * logfilename, bool setupLogging, bool setupCout)
 {
-  int returndummy = 0;
+  int                          returndummy = 0;
+  elastix::xoutManager::Data & data = GetData();
 
   if (setupLogging)
   {
     /** Open the logfile for writing. */
-    g_data.LogFileStream.open(logfilename);
-    if (!g_data.LogFileStream.is_open())
+    data.LogFileStream.open(logfilename);
+    if (!data.LogFileStream.is_open())
     {
       std::cerr << "ERROR: LogFile cannot be opened!" << std::endl;
       return 1;
@@ -85,7 +259,7 @@ elastix::xoutSetup(const char * logfilename, bool setupLogging, bool setupCout)
   /** Set std::cout and the logfile as outputs of xout. */
   if (setupLogging)
   {
-    returndummy |= xl::xout.AddOutput("log", &g_data.LogFileStream);
+    returndummy |= xl::xout.AddOutput("log", &data.LogFileStream);
   }
   if (setupCout)
   {
@@ -93,24 +267,24 @@ elastix::xoutSetup(const char * logfilename, bool setupLogging, bool setupCout)
   }
 
   /** Set outputs of LogOnly and CoutOnly. */
-  returndummy |= g_data.LogOnlyXout.AddOutput("log", &g_data.LogFileStream);
-  returndummy |= g_data.CoutOnlyXout.AddOutput("cout", &std::cout);
+  returndummy |= data.LogOnlyXout.AddOutput("log", &data.LogFileStream);
+  returndummy |= data.CoutOnlyXout.AddOutput("cout", &std::cout);
 
   /** Copy the outputs to the warning-, error- and standard-xouts. */
-  g_data.WarningXout.SetOutputs(xl::xout.GetCOutputs());
-  g_data.ErrorXout.SetOutputs(xl::xout.GetCOutputs());
-  g_data.StandardXout.SetOutputs(xl::xout.GetCOutputs());
+  data.WarningXout.SetOutputs(xl::xout.GetCOutputs());
+  data.ErrorXout.SetOutputs(xl::xout.GetCOutputs());
+  data.StandardXout.SetOutputs(xl::xout.GetCOutputs());
 
-  g_data.WarningXout.SetOutputs(xl::xout.GetXOutputs());
-  g_data.ErrorXout.SetOutputs(xl::xout.GetXOutputs());
-  g_data.StandardXout.SetOutputs(xl::xout.GetXOutputs());
+  data.WarningXout.SetOutputs(xl::xout.GetXOutputs());
+  data.ErrorXout.SetOutputs(xl::xout.GetXOutputs());
+  data.StandardXout.SetOutputs(xl::xout.GetXOutputs());
 
   /** Link the warning-, error- and standard-xouts to xout. */
-  returndummy |= xl::xout.AddTargetCell("warning", &g_data.WarningXout);
-  returndummy |= xl::xout.AddTargetCell("error", &g_data.ErrorXout);
-  returndummy |= xl::xout.AddTargetCell("standard", &g_data.StandardXout);
-  returndummy |= xl::xout.AddTargetCell("logonly", &g_data.LogOnlyXout);
-  returndummy |= xl::xout.AddTargetCell("coutonly", &g_data.CoutOnlyXout);
+  returndummy |= xl::xout.AddTargetCell("warning", &data.WarningXout);
+  returndummy |= xl::xout.AddTargetCell("error", &data.ErrorXout);
+  returndummy |= xl::xout.AddTargetCell("standard", &data.StandardXout);
+  returndummy |= xl::xout.AddTargetCell("logonly", &data.LogOnlyXout);
+  returndummy |= xl::xout.AddTargetCell("coutonly", &data.CoutOnlyXout);
 
   /** Format the output. */
   xl::xout["standard"] << std::fixed;
@@ -129,7 +303,17 @@ namespace elastix
  * ********************* xoutManager ******************************
  */
 
+xoutManager::xoutManager()
+  : m_Data(new Data)
+  , m_PreviousData(t_data)
+  , m_PreviousXout(xl::set_thread_local_xout(&m_Data->Xout))
+{
+  t_data = m_Data.get();
+}
+
+
 xoutManager::xoutManager(const std::string & logFileName, const bool setupLogging, const bool setupCout)
+  : xoutManager()
 {
   if (xoutSetup(logFileName.c_str(), setupLogging, setupCout))
   {
@@ -137,10 +321,11 @@ xoutManager::xoutManager(const std::string & logFileName, const bool setupLoggin
   }
 }
 
-xoutManager::Guard::~Guard()
+
+xoutManager::~xoutManager()
 {
-  xl::get_xout() = {};
-  g_data = {};
+  xl::set_thread_local_xout(this->m_PreviousXout);
+  t_data = this->m_PreviousData;
 }
 
 
@@ -206,6 +391,42 @@ ElastixMain::GetComponentDatabase(void)
  */
 
 ElastixMain::~ElastixMain()
+{
+  if (!g_KeepOpenCLContext)
+  {
+    ReleaseOpenCLContext();
+  }
+} // end Destructor
+
+
+/**
+ * ******************* SetKeepOpenCLContext *********************
+ */
+
+void
+ElastixMain::SetKeepOpenCLContext(const bool keep)
+{
+  g_KeepOpenCLContext = keep;
+} // end SetKeepOpenCLContext()
+
+
+/**
+ * ******************* GetKeepOpenCLContext *********************
+ */
+
+bool
+ElastixMain::GetKeepOpenCLContext(void)
+{
+  return g_KeepOpenCLContext;
+} // end GetKeepOpenCLContext()
+
+
+/**
+ * ******************* ReleaseOpenCLContext *********************
+ */
+
+void
+ElastixMain::ReleaseOpenCLContext(void)
 {
 #ifdef ELASTIX_USE_OPENCL
   itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
@@ -214,7 +435,7 @@ ElastixMain::~ElastixMain()
     context->Release();
   }
 #endif
-} // end Destructor
+} // end ReleaseOpenCLContext()
 
 
 /**
@@ -301,6 +522,10 @@ ElastixMain::Run(void)
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
 
+  /** Limit the number of threads of this registration, and the CPUs of the thread that runs it. */
+  const itk::ThreadBudget threadBudget(this->GetMaximumNumberOfThreads());
+  const CpuAffinityGuard  cpuAffinity(this->m_Configuration->GetCommandLineArgument("-affinity"));
+
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
   if (errorCode != 0)
@@ -331,9 +556,12 @@ ElastixMain::Run(void)
   int userSuppliedOpenCLDeviceID = -1;
   this->m_Configuration->ReadParameter(userSuppliedOpenCLDeviceID, "OpenCLDeviceID", 0, false);
 
+  bool useMultipleOpenCLDevices = false;
+  this->m_Configuration->ReadParameter(useMultipleOpenCLDevices, "OpenCLUseMultipleDevices", 0, false);
+
   std::string errorMessage = "";
-  const bool  creatingContextSuccessful =
-    itk::CreateOpenCLContext(errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID);
+  const bool  creatingContextSuccessful = itk::CreateOpenCLContext(
+    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID, useMultipleOpenCLDevices);
   if (!creatingContextSuccessful)
   {
     /** Report and disable the GPU by releasing the context. */
@@ -343,6 +571,18 @@ ElastixMain::Run(void)
     itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
     context->Release();
   }
+  else
+  {
+    /** Optionally cache the compiled OpenCL programs on disk. */
+    std::string programCacheDirectory = "";
+    this->m_Configuration->ReadParameter(programCacheDirectory, "OpenCLProgramCacheDirectory", 0, false);
+    itk::OpenCLContext::GetInstance()->SetProgramCacheDirectory(programCacheDirectory);
+
+    /** Collect the timings of the OpenCL kernels, to be reported after the run. */
+    bool openCLProfiling = false;
+    this->m_Configuration->ReadParameter(openCLProfiling, "OpenCLProfiling", 0, false);
+    itk::OpenCLContext::GetInstance()->SetProfilingEnabled(openCLProfiling);
+  }
 
   /** Create a log file. */
   itk::CreateOpenCLLogger("elastix", this->m_Configuration->GetCommandLineArgument("-out"));
@@ -401,6 +641,15 @@ ElastixMain::Run(void)
   /** Set the initial transform, if it happens to be there. */
   elastixBase.SetInitialTransform(this->GetModifiableInitialTransform());
 
+  /** Set the function that is called after each iteration. */
+  elastixBase.SetIterationCallback(this->m_IterationCallback);
+
+  /** Set the parameters of a warm start, if any. */
+  elastixBase.SetWarmStartParameters(this->m_WarmStartParameters);
+
+  /** Set the dictionary of the chain of parameter files. */
+  elastixBase.SetChainDictionary(this->m_ChainDictionary);
+
   /** Set the original fixed image direction cosines (relevant in case the
    * UseDirectionCosines parameter was set to false.
    */
@@ -854,45 +1103,111 @@ ElastixMain::CreateComponents(const std::string &              key,
 void
 ElastixMain::SetProcessPriority(void) const
 {
-  /** If wanted, set the priority of this process high or below normal. */
-  std::string processPriority = this->m_Configuration->GetCommandLineArgument("-priority");
-  if (processPriority == "high")
+  const std::string priority = this->m_Configuration->GetCommandLineArgument("-priority");
+  if (!priority.empty())
   {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-    SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
-#endif
+    const std::string warning = SetPriority(priority);
+    if (!warning.empty())
+    {
+      xl::xout["warning"] << "WARNING: " << warning << std::endl;
+    }
   }
-  else if (processPriority == "abovenormal")
+
+} // end SetProcessPriority()
+
+
+/**
+ * ******************* SetProcessPriorityAndAffinity *************************
+ */
+
+void
+ElastixMain::SetProcessPriorityAndAffinity(const std::string & priority, const std::string & cpuList)
+{
+  /** No log is set up yet, so the warnings go to std::cerr. */
+  if (!priority.empty())
   {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-    SetPriorityClass(GetCurrentProcess(), ABOVE_NORMAL_PRIORITY_CLASS);
-#endif
+    const std::string warning = SetPriority(priority);
+    if (!warning.empty())
+    {
+      std::cerr << "WARNING: " << warning << std::endl;
+    }
   }
-  else if (processPriority == "normal")
+
+  if (!cpuList.empty())
   {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-    SetPriorityClass(GetCurrentProcess(), NORMAL_PRIORITY_CLASS);
+    std::vector<int> cpus;
+    if (!ParseCpuList(cpuList, cpus))
+    {
+      std::cerr << "WARNING: Unsupported -affinity value \"" << cpuList << "\". Specify a list of CPUs and ranges "
+                << "below " << maximumNumberOfCpus << ", e.g. \"0-3,8\"." << std::endl;
+      return;
+    }
+
+#if defined(__linux__)
+    if (!SetAffinity(cpus))
+    {
+      std::cerr << "WARNING: The -affinity " << cpuList << " could not be set." << std::endl;
+    }
+#else
+    std::cerr << "WARNING: -affinity is only supported on Linux, and is ignored." << std::endl;
 #endif
   }
-  else if (processPriority == "belownormal")
+
+} // end SetProcessPriorityAndAffinity()
+
+
+/**
+ * ******************* CpuAffinityGuard *************************
+ */
+
+CpuAffinityGuard::CpuAffinityGuard(const std::string & cpuList)
+{
+  if (cpuList.empty())
   {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-    SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
-#endif
+    return;
   }
-  else if (processPriority == "idle")
+
+  std::vector<int> cpus;
+  if (!ParseCpuList(cpuList, cpus))
   {
-#if defined(_WIN32) && !defined(__CYGWIN__)
-    SetPriorityClass(GetCurrentProcess(), IDLE_PRIORITY_CLASS);
-#endif
+    xl::xout["warning"] << "WARNING: Unsupported -affinity value \"" << cpuList << "\". Specify a list of CPUs and "
+                        << "ranges below " << maximumNumberOfCpus << ", e.g. \"0-3,8\"." << std::endl;
+    return;
   }
-  else if (!processPriority.empty())
+
+#if defined(__linux__)
+  cpu_set_t previousSet;
+  CPU_ZERO(&previousSet);
+  if (sched_getaffinity(0, sizeof(previousSet), &previousSet) != 0 || !SetAffinity(cpus))
   {
-    xl::xout["warning"]
-      << "Unsupported -priority value. Specify one of <high, abovenormal, normal, belownormal, idle, ''>." << std::endl;
+    xl::xout["warning"] << "WARNING: The -affinity " << cpuList << " could not be set." << std::endl;
+    return;
   }
 
-} // end SetProcessPriority()
+  for (int cpu = 0; cpu < maximumNumberOfCpus; ++cpu)
+  {
+    if (CPU_ISSET(cpu, &previousSet))
+    {
+      this->m_PreviousCpus.push_back(cpu);
+    }
+  }
+#else
+  xl::xout["warning"] << "WARNING: -affinity is only supported on Linux, and is ignored." << std::endl;
+#endif
+
+} // end CpuAffinityGuard()
+
+
+CpuAffinityGuard::~CpuAffinityGuard()
+{
+#if defined(__linux__)
+  if (!this->m_PreviousCpus.empty())
+  {
+    SetAffinity(this->m_PreviousCpus);
+  }
+#endif
+
+} // end ~CpuAffinityGuard()
 
 
 /**
@@ -902,18 +1217,35 @@ ElastixMain::SetProcessPriority(void) const
 void
 ElastixMain::SetMaximumNumberOfThreads(void) const
 {
-  /** Get the number of threads from the command line. */
-  std::string maximumNumberOfThreadsString = this->m_Configuration->GetCommandLineArgument("-threads");
-
-  /** If supplied, set the maximum number of threads. */
-  if (!maximumNumberOfThreadsString.empty())
+  /** If supplied, set the maximum number of threads. The library does not change the
+   * global maximum, as it would affect the other registrations in the process.
+   */
+  const unsigned int maximumNumberOfThreads = this->GetMaximumNumberOfThreads();
+  if (maximumNumberOfThreads > 0 && !BaseComponent::IsElastixLibrary())
   {
-    const int maximumNumberOfThreads = atoi(maximumNumberOfThreadsString.c_str());
     itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads(maximumNumberOfThreads);
   }
 } // end SetMaximumNumberOfThreads()
 
 
+/**
+ * *********************** GetMaximumNumberOfThreads *************************
+ */
+
+unsigned int
+ElastixMain::GetMaximumNumberOfThreads(void) const
+{
+  /** Get the number of threads from the command line. */
+  const std::string maximumNumberOfThreadsString = this->m_Configuration->GetCommandLineArgument("-threads");
+  if (maximumNumberOfThreadsString.empty())
+  {
+    return 0;
+  }
+  return static_cast<unsigned int>(std::max(atoi(maximumNumberOfThreadsString.c_str()), 0));
+
+} // end GetMaximumNumberOfThreads()
+
+
 /**
  * ******************** SetOriginalFixedImageDirectionFlat ********************
  */
@@ -28,7 +28,9 @@
 // Standard C++ header files:
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 
 namespace elastix
@@ -55,6 +57,13 @@ xoutSetup(const char * logfilename, bool setupLogging, bool setupCout);
 
 
 /** Manages setting up and closing the "xout" output streams.
+ *
+ * Each manager has its own output streams, to which xout refers in the thread
+ * that constructs the manager, for as long as the manager exists. Registrations
+ * that run concurrently in one process, each in its own thread with its own
+ * manager, therefore write to their own log, without locking. Other threads,
+ * e.g. the worker threads of ITK filters, write to the global xout; which only
+ * has outputs when xoutSetup is called without a manager.
  */
 class xoutManager
 {
@@ -64,21 +73,49 @@ public:
   /** This explicit constructor does set up the "xout" output streams. */
   explicit xoutManager(const std::string & logfilename, const bool setupLogging, const bool setupCout);
 
-  /** The default-constructor only just constructs a manager object */
-  xoutManager() = default;
+  /** The default-constructor only lets xout refer to the (empty) output streams
+   * of this manager, which may then be set up by xoutSetup. */
+  xoutManager();
+
+  /** The destructor closes the "xout" output streams of this manager, and lets xout
+   * refer to the streams it referred to before the construction. */
+  ~xoutManager();
 
-  /** The destructor closes the "xout" output streams. */
-  ~xoutManager() = default;
+  /** The output streams and the xout of a manager. */
+  struct Data;
 
 private:
-  struct Guard
-  {
-    ITK_DISALLOW_COPY_AND_ASSIGN(Guard);
-    Guard() = default;
-    ~Guard();
-  };
+  const std::unique_ptr<Data> m_Data;
+  Data * const                m_PreviousData;
+  xl::xoutmain * const        m_PreviousXout;
+};
+
+
+/** Limits the thread that constructs it, and the threads that this thread creates
+ * from then on, to a set of CPUs, for as long as it exists.
+ *
+ * The set is a comma separated list of CPU numbers and ranges, e.g. "0-3,8", as
+ * given by the command line argument "-affinity". The worker threads of the
+ * "Platform" threaders, e.g. of the metrics, are created per call, so they are
+ * limited as well. The threads of the ITK thread pool are shared by all threads
+ * of the process: the ones that already exist are not limited, and the ones that
+ * are created meanwhile keep the limit afterwards. The guard therefore does not
+ * isolate concurrent registrations from each other; for that, the affinity should
+ * be set for the whole process, see ElastixMain::SetProcessPriorityAndAffinity().
+ * An empty set does nothing. Only supported on Linux; elsewhere a warning is given.
+ */
+class CpuAffinityGuard
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(CpuAffinityGuard);
+
+  explicit CpuAffinityGuard(const std::string & cpuList);
 
-  const Guard m_Guard{};
+  /** Restores the previous set of CPUs of the thread. */
+  ~CpuAffinityGuard();
+
+private:
+  std::vector<int> m_PreviousCpus;
 };
 
 
@@ -239,6 +276,40 @@ public:
   itkSetObjectMacro(InitialTransform, ObjectType);
   itkGetModifiableObjectMacro(InitialTransform, ObjectType);
 
+  /** Set the function that is called after each iteration, see ElastixBase::SetIterationCallback(). */
+  void
+  SetIterationCallback(const ElastixBaseType::IterationCallbackType & callback)
+  {
+    this->m_IterationCallback = callback;
+  }
+
+
+  /** Set the parameters from which the registration is warm started, see ElastixBase::SetWarmStartParameters(). */
+  void
+  SetWarmStartParameters(const itk::OptimizerParameters<double> & parameters)
+  {
+    this->m_WarmStartParameters = parameters;
+  }
+
+
+  /** Set/Get the dictionary that is shared by the registrations of a chain of parameter files, see
+   * ElastixBase::SetChainDictionary(). Each ElastixMain has a dictionary of its own by default, so
+   * the next ElastixMain of a chain should be given the dictionary of the previous one.
+   */
+  void
+  SetChainDictionary(const ElastixBaseType::ChainDictionaryPointer & dictionary)
+  {
+    this->m_ChainDictionary = dictionary;
+  }
+
+
+  const ElastixBaseType::ChainDictionaryPointer &
+  GetChainDictionary(void) const
+  {
+    return this->m_ChainDictionary;
+  }
+
+
   /** Set/Get the original fixed image direction as a flat array
    * (d11 d21 d31 d21 d22 etc ) */
   virtual void
@@ -298,22 +369,63 @@ public:
 
   /** Set process priority, which is read from the command line arguments.
    * Syntax:
-   * -priority \<high, belownormal\>
+   * -priority \<high, abovenormal, normal, belownormal, idle\>
+   * On Windows, it sets the priority class of the process. Elsewhere, it sets the
+   * nice value of the thread that runs elastix, inherited by the threads it
+   * creates; on Linux, "idle" also selects the SCHED_IDLE scheduling policy, so that
+   * batch jobs only get the CPU time that interactive jobs leave unused. Raising
+   * the priority usually requires privileges. It is called by Run(), also by the
+   * library, and the priority is not restored afterwards.
    */
   virtual void
   SetProcessPriority(void) const;
 
+  /** Set the priority and the CPU affinity of the whole process, given by the command line arguments.
+   * Syntax:
+   * -priority \<high, abovenormal, normal, belownormal, idle\>
+   * -affinity \<list of CPU numbers and ranges, e.g. "0-3,8"\>
+   * The priority is set as by SetProcessPriority(). The affinity is only supported on Linux.
+   *
+   * Both apply to the calling thread and to the threads that it creates from then on, and are not
+   * restored. The elastix and transformix executables call this at the start of main(), before the
+   * ITK thread pool and any other thread exists, so that they apply to the whole process, e.g. to
+   * all registrations of a batch. Run() sets them again, the affinity only while it runs, see
+   * CpuAffinityGuard.
+   */
+  static void
+  SetProcessPriorityAndAffinity(const std::string & priority, const std::string & cpuList);
+
   /** Set maximum number of threads, which is read from the command line arguments.
    * Syntax:
    * -threads \<int\>
+   * The ITK global maximum is only set by the elastix and transformix executables.
+   * The library applies the number to its own registration only, see itk::ThreadBudget.
    */
   virtual void
   SetMaximumNumberOfThreads(void) const;
 
+  /** Get the maximum number of threads from the command line arguments, or 0 when not given. */
+  unsigned int
+  GetMaximumNumberOfThreads(void) const;
+
   /** Function to get the ComponentDatabase. */
   static const ComponentDatabase &
   GetComponentDatabase(void);
 
+  /** Set/Get whether the OpenCL context is kept when an ElastixMain object is destroyed, so that
+   * the registrations that still run, or run next, in the process reuse it. Disabled by default;
+   * the batch mode of elastix enables it, and calls ReleaseOpenCLContext() at the end.
+   */
+  static void
+  SetKeepOpenCLContext(const bool keep);
+
+  static bool
+  GetKeepOpenCLContext(void);
+
+  /** Releases the OpenCL context, if it is created. */
+  static void
+  ReleaseOpenCLContext(void);
+
   /** GetTransformParametersMap */
   virtual ParameterMapType
   GetTransformParametersMap(void) const;
@@ -354,6 +466,16 @@ protected:
 
   /** The initial transform. */
   ObjectPointer m_InitialTransform;
+
+  /** The function that is called after each iteration. */
+  ElastixBaseType::IterationCallbackType m_IterationCallback;
+
+  /** The parameters from which the registration is warm started, if any. */
+  itk::OptimizerParameters<double> m_WarmStartParameters;
+
+  /** The dictionary that is shared by the registrations of a chain of parameter files. */
+  ElastixBaseType::ChainDictionaryPointer m_ChainDictionary{ std::make_shared<itk::MetaDataDictionary>() };
+
   /** Transformation parameters map containing parameters that is the
    *  result of registration.
    */
@@ -26,6 +26,8 @@
 #include "itkImage.h"
 #include "itkImageFileReader.h"
 #include "itkImageToImageMetric.h"
+#include "itkMemoryUsageObserver.h"
+#include "itkHardwareCounters.h"
 
 #include "elxRegistrationBase.h"
 #include "elxFixedImagePyramidBase.h"
@@ -38,6 +40,7 @@
 #include "elxResampleInterpolatorBase.h"
 #include "elxTransformBase.h"
 
+#include <future>
 #include <sstream>
 
 /**
@@ -81,11 +84,82 @@ namespace elastix
  *    example: <tt>(WriteTransformParametersEachIteration "true")</tt>\n
  *    This parameter can not be specified for each resolution separately.
  *    Default value: "false".
+ * \parameter TransformParametersEachIterationFormat: The format in which the transform
+ *    parameters of each iteration are saved, with WriteTransformParametersEachIteration.
+ *    With "text", a transform parameter file "TransformParameters.<level>.R<r>.It<i>.txt" is
+ *    written every iteration. With "log", the parameters of all iterations are appended to a
+ *    single compressed binary file "TransformParametersLog.<level>.bin", which stores only
+ *    the changes of the parameters per iteration, see itk::TransformParametersLog. The
+ *    transform parameter file of any iteration is then recreated on demand with the tool
+ *    elxMaterializeTransformParameters.\n
+ *    example: <tt>(TransformParametersEachIterationFormat "log")</tt>\n
+ *    Default value: "text".
  * \parameter WriteTransformParametersEachResolution: Controls whether
  *    to save a transform parameter file to disk in every resolution.\n
  *    example: <tt>(WriteTransformParametersEachResolution "true")</tt>\n
  *    This parameter can not be specified for each resolution separately.
  *    Default value: "false".
+ * \parameter WriteIntermediateResultsInBackground: Controls whether the result images and
+ *    transform parameter files that are written after each iteration or resolution are written
+ *    by a background thread, so that the registration does not wait for the disk. The result
+ *    images are still resampled immediately, with the current transform. The iteration info
+ *    table of each resolution is then kept in memory, and written in chunks of about a
+ *    megabyte, and when the resolution is finished. At most two results wait to be written;
+ *    after that the registration waits after all. All of them are written before the final
+ *    results.\n
+ *    example: <tt>(WriteIntermediateResultsInBackground "true")</tt>\n
+ *    Default value: "false".
+ * \parameter WriteCheckpoint: Controls whether to save a checkpoint "Checkpoint.<level>.bin"
+ *    to the output directory at the start of each resolution, from which an interrupted
+ *    registration can be resumed with the command-line argument "-resume <checkpoint>".
+ *    The resumed registration skips the optimization of the finished resolutions, and
+ *    continues at the resolution of the checkpoint. The state of the optimizer and the
+ *    random samplers is not stored, so the results may differ slightly from an
+ *    uninterrupted registration.\n
+ *    example: <tt>(WriteCheckpoint "true")</tt>\n
+ *    Default value: "false".
+ * \parameter CheckpointIterationInterval: The number of iterations after which the
+ *    checkpoint is also saved within a resolution. A registration that is resumed from
+ *    such a checkpoint restarts the optimization of that resolution from the saved
+ *    parameters, with its full number of iterations.\n
+ *    example: <tt>(CheckpointIterationInterval 100)</tt>\n
+ *    Default value: 0, which means only at the start of each resolution.
+ * \parameter WriteTimings: Controls whether to save the wall times of the
+ *    phases of the registration (reading images, initialization, iterating in
+ *    each resolution, saving the results) to a JSON file "Timings.<level>.json"
+ *    in the output directory.\n
+ *    example: <tt>(WriteTimings "true")</tt>\n
+ *    Default value: "false".
+ * \parameter UseHardwareCounters: Controls whether to count the CPU cycles, instructions and
+ *    last level cache misses of the image sampler, the metric evaluation (including the
+ *    transform Jacobians), the accumulation of the derivatives and the optimizer steps, by
+ *    the hardware performance counters. The counts, the instructions per cycle and the
+ *    estimated memory traffic per sample are written to the log, and to the timings file
+ *    when WriteTimings is enabled. Only available on Linux, when the kernel allows it. The
+ *    counters count all threads of the process, so they are ignored when other registrations
+ *    run in the same process, e.g. those of a batch.\n
+ *    example: <tt>(UseHardwareCounters "true")</tt>\n
+ *    Default value: "false".
+ * \parameter MaximumMemoryBudget: The maximum amount of memory, in megabytes,
+ *    that elastix may use. The memory in use is reported at the first iteration
+ *    of each resolution, when all buffers of that resolution are allocated.
+ *    If it exceeds the budget, the registration is stopped with an error, so
+ *    that a job fails fast instead of being killed later on. To reduce the
+ *    memory usage of the AdvancedMattesMutualInformation metric, see its
+ *    parameter MaximumJointPDFDerivativesMemory.\n
+ *    example: <tt>(MaximumMemoryBudget 8192)</tt>\n
+ *    Default value: 0, which means no limit.
+ * \parameter ReleasePyramidImagesAfterEachResolution: Controls whether to
+ *    free the fixed and moving pyramid images of a resolution as soon as that
+ *    resolution is finished, instead of keeping all pyramid levels in memory
+ *    until the end of the registration. The pyramid image of the first
+ *    resolution is kept, as it drives the update of the pyramid filters. This
+ *    is most useful when the pyramids smooth without downsampling, so that
+ *    all levels have the size of the input image. Note that the pyramid
+ *    parameter ComputePyramidImagesPerResolution avoids computing all levels
+ *    in advance altogether.\n
+ *    example: <tt>(ReleasePyramidImagesAfterEachResolution "true")</tt>\n
+ *    Default value: "false".
  * \parameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
  * Voxel spacing and image origin are always taken into account, regardless
@@ -257,25 +331,99 @@ public:
 
 private:
   ElastixTemplate() = default;
-  ~ElastixTemplate() override = default;
+
+  /** Disables the hardware counters, if this registration has enabled them but not reported them,
+   * e.g. after an exception. */
+  ~ElastixTemplate() override
+  {
+    if (this->m_UsesHardwareCounters)
+    {
+      itk::HardwareCounters::SetEnabled(false);
+      itk::HardwareCounters::Reset();
+    }
+  }
 
   /** CallBack commands. */
   BeforeEachResolutionCommandPointer m_BeforeEachResolutionCommand{};
   AfterEachIterationCommandPointer   m_AfterEachIterationCommand{};
   AfterEachResolutionCommandPointer  m_AfterEachResolutionCommand{};
 
-  /** CreateTransformParameterFile. */
+  /** Whether this registration has enabled the hardware counters, and the number of started
+   * registrations at that time, see ElastixBase::GetNumberOfStartedRegistrations(). */
+  bool          m_UsesHardwareCounters{ false };
+  std::uint64_t m_NumberOfStartedRegistrationsAtHardwareCountersStart{ 0 };
+
+  /** CreateTransformParameterFile. With InBackground, the file is written by the
+   * background writer, if WriteIntermediateResultsInBackground is "true". */
   void
-  CreateTransformParameterFile(const std::string & FileName, const bool ToLog);
+  CreateTransformParameterFile(const std::string & FileName, const bool ToLog, const bool InBackground = false);
 
   /** CreateTransformParametersMap. */
   void
   CreateTransformParametersMap(void) override;
 
-  /** Open the IterationInfoFile, where the table with iteration info is written to. */
+  /** Open the IterationInfoFile, where the table with iteration info is written to. With the
+   * background writer, the table is collected in memory instead, and written by
+   * CloseIterationInfoFile().
+   */
   void
   OpenIterationInfoFile(void);
 
+  /** Close the IterationInfoFile of the current resolution, or let the background writer
+   * write it, so that the next resolution does not wait for the disk. */
+  void
+  CloseIterationInfoFile(void);
+
+  /** Let the background writer append the iteration info that was collected in memory to
+   * the IterationInfoFile, so that the memory use does not grow with the number of iterations.
+   */
+  void
+  PushIterationInfoText(void);
+
+  /** Append the transform parameters to the TransformParametersLog: at the start of a
+   * resolution the text of its transform parameter file, and otherwise the parameters of
+   * the current iteration. Creates the log at the start of the first resolution.
+   */
+  void
+  WriteToTransformParametersLog(const bool startOfResolution);
+
+  /** Report the memory in use, and throw an exception when it exceeds the MaximumMemoryBudget. */
+  void
+  CheckMemoryUsage(void) const;
+
+  /** Release the memory of the pyramid images of the resolution that has just been finished. */
+  void
+  ReleasePyramidImagesOfResolution(const unsigned long level) const;
+
+  /** Write the timings of the registration phases to a JSON file in the output directory. */
+  void
+  WriteTimingsFile(void) const;
+
+  /** Write a checkpoint, from which the registration can be resumed: the resolution
+   * level, and the parameters at which the optimization of that level (re)starts.
+   */
+  void
+  WriteCheckpoint(const unsigned long level, const itk::OptimizerParameters<double> & parameters) const;
+
+  /** Read the checkpoint that is passed by "-resume", and resume the registration from it.
+   * Without a checkpoint, warm start from the WarmStartParameters, if any. */
+  void
+  ResumeFromCheckpoint(void);
+
+  /** Report the timings of the OpenCL kernels and the volume of the transfers
+   * to and from the device, when OpenCL profiling is enabled. When addToTimings
+   * is true, they are added to the timings as well.
+   */
+  void
+  ReportOpenCLProfiling(const bool addToTimings);
+
+  /** Report the counts of the hardware performance counters per phase, when this registration
+   * has enabled them, add them to the timings, and disable the counters. The counts are not
+   * reported when another registration has been started in the meantime.
+   */
+  void
+  ReportHardwareCounters(void);
+
   /** Used by the callback functions, BeforeEachResolution() etc.).
    * This method calls a function in each component, in the following order:
    * \li Registration
@@ -20,6 +20,14 @@
 
 #  include "elxElastixTemplate.h"
 
+#  include <itksys/SystemTools.hxx>
+#  include <fstream>
+#  include <stdexcept>
+
+#  ifdef ELASTIX_USE_OPENCL
+#    include "itkOpenCLContext.h"
+#  endif
+
 #  define elxCheckAndSetComponentMacro(_name)                                                                          \
     _name##BaseType * base = this->GetElx##_name##Base(i);                                                             \
     if (base != nullptr)                                                                                               \
@@ -115,6 +123,8 @@ template <class TFixedImage, class TMovingImage>
 int
 ElastixTemplate<TFixedImage, TMovingImage>::Run(void)
 {
+  const RunningRegistrationCounter runningRegistrationCounter;
+
   /** Tell all components where to find the ElastixTemplate and
    * set there ComponentLabel.
    */
@@ -152,13 +162,48 @@ ElastixTemplate<TFixedImage, TMovingImage>::Run(void)
   this->m_Timer0.Start();
   elxout << "\nReading images..." << std::endl;
 
-  /** Read images and masks, if not set already. */
-  const bool              useDirCos = this->GetUseDirectionCosines();
-  FixedImageDirectionType fixDirCos;
+  /** Read images and masks, if not set already. The files are read
+   * concurrently, as reading, e.g. decompressing, them may take long.
+   */
+  const bool                                           useDirCos = this->GetUseDirectionCosines();
+  FixedImageDirectionType                              fixDirCos;
+  std::future<ElastixBase::DataObjectContainerPointer> fixedImages;
+  std::future<ElastixBase::DataObjectContainerPointer> movingImages;
+  std::future<ElastixBase::DataObjectContainerPointer> fixedMasks;
+  std::future<ElastixBase::DataObjectContainerPointer> movingMasks;
   if (this->GetFixedImage() == nullptr)
   {
-    this->SetFixedImageContainer(MultipleImageLoader<FixedImageType>::GenerateImageContainer(
-      this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, &fixDirCos));
+    fixedImages = std::async(std::launch::async, [this, useDirCos, &fixDirCos]() {
+      return MultipleImageLoader<FixedImageType>::GenerateImageContainer(
+        this->GetFixedImageFileNameContainer(), "Fixed Image", useDirCos, &fixDirCos);
+    });
+  }
+  if (this->GetMovingImage() == nullptr)
+  {
+    movingImages = std::async(std::launch::async, [this, useDirCos]() {
+      return MultipleImageLoader<MovingImageType>::GenerateImageContainer(
+        this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos);
+    });
+  }
+  if (this->GetFixedMask() == nullptr)
+  {
+    fixedMasks = std::async(std::launch::async, [this, useDirCos]() {
+      return MultipleImageLoader<FixedMaskType>::GenerateImageContainer(
+        this->GetFixedMaskFileNameContainer(), "Fixed Mask", useDirCos);
+    });
+  }
+  if (this->GetMovingMask() == nullptr)
+  {
+    movingMasks = std::async(std::launch::async, [this, useDirCos]() {
+      return MultipleImageLoader<MovingMaskType>::GenerateImageContainer(
+        this->GetMovingMaskFileNameContainer(), "Moving Mask", useDirCos);
+    });
+  }
+
+  /** Wait for the reading. Exceptions thrown while reading are rethrown here. */
+  if (fixedImages.valid())
+  {
+    this->SetFixedImageContainer(fixedImages.get());
     this->SetOriginalFixedImageDirection(fixDirCos);
   }
   else
@@ -174,26 +219,49 @@ ElastixTemplate<TFixedImage, TMovingImage>::Run(void)
     this->SetOriginalFixedImageDirection(fixDirCos);
   }
 
-  if (this->GetMovingImage() == nullptr)
+  if (movingImages.valid())
   {
-    this->SetMovingImageContainer(MultipleImageLoader<MovingImageType>::GenerateImageContainer(
-      this->GetMovingImageFileNameContainer(), "Moving Image", useDirCos));
+    this->SetMovingImageContainer(movingImages.get());
   }
-  if (this->GetFixedMask() == nullptr)
+  if (fixedMasks.valid())
   {
-    this->SetFixedMaskContainer(MultipleImageLoader<FixedMaskType>::GenerateImageContainer(
-      this->GetFixedMaskFileNameContainer(), "Fixed Mask", useDirCos));
+    this->SetFixedMaskContainer(fixedMasks.get());
   }
-  if (this->GetMovingMask() == nullptr)
+  if (movingMasks.valid())
   {
-    this->SetMovingMaskContainer(MultipleImageLoader<MovingMaskType>::GenerateImageContainer(
-      this->GetMovingMaskFileNameContainer(), "Moving Mask", useDirCos));
+    this->SetMovingMaskContainer(movingMasks.get());
   }
 
   /** Print the time spent on reading images. */
   this->m_Timer0.Stop();
   elxout << "Reading images took " << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.\n"
          << std::endl;
+  this->m_Timings.clear();
+  this->m_Timings.emplace_back("ReadingImages", this->m_Timer0.GetMean());
+
+  /** Count the CPU events of the registration phases, if desired and possible. The counters count
+   * all threads of the process, so they are only used when no other registration runs.
+   */
+  bool useHardwareCounters = false;
+  this->GetConfiguration()->ReadParameter(useHardwareCounters, "UseHardwareCounters", 0, false);
+  if (useHardwareCounters)
+  {
+    if (GetNumberOfRunningRegistrations() > 1)
+    {
+      xl::xout["warning"] << "WARNING: UseHardwareCounters is ignored, because other registrations run in this "
+                          << "process at the same time." << std::endl;
+    }
+    else
+    {
+      itk::HardwareCounters::Reset();
+      this->m_UsesHardwareCounters = itk::HardwareCounters::SetEnabled(true);
+      this->m_NumberOfStartedRegistrationsAtHardwareCountersStart = GetNumberOfStartedRegistrations();
+      if (!this->m_UsesHardwareCounters)
+      {
+        xl::xout["warning"] << "WARNING: The hardware performance counters are not available." << std::endl;
+      }
+    }
+  }
 
   /** Give all components the opportunity to do some initialization. */
   this->BeforeRegistration();
@@ -257,6 +325,8 @@ template <class TFixedImage, class TMovingImage>
 int
 ElastixTemplate<TFixedImage, TMovingImage>::ApplyTransform(void)
 {
+  const RunningRegistrationCounter runningRegistrationCounter;
+
   /** Timer. */
   TimerType timer;
 
@@ -366,30 +436,72 @@ ElastixTemplate<TFixedImage, TMovingImage>::ApplyTransform(void)
   timer.Stop();
   elxout << "  Computing spatial Jacobian done, it took " << Conversion::SecondsToDHMS(timer.GetMean(), 2) << std::endl;
 
-  /** Resample the image. */
+  /** Call ComputeInverseDeformationField. */
+  timer.Reset();
+  timer.Start();
+  elxout << "Compute inverse deformation field ..." << std::endl;
+  try
+  {
+    this->GetElxTransformBase()->ComputeInverseDeformationField();
+  }
+  catch (itk::ExceptionObject & excp)
+  {
+    xl::xout["error"] << excp << std::endl;
+    xl::xout["error"] << "However, transformix continues anyway." << std::endl;
+  }
+  timer.Stop();
+  elxout << "  Computing inverse deformation field done, it took " << Conversion::SecondsToDHMS(timer.GetMean(), 2)
+         << std::endl;
+
+  /** Resample the images. */
   if (this->GetMovingImage() != nullptr)
   {
     timer.Reset();
     timer.Start();
     elxout << "Resampling image and writing to disk ..." << std::endl;
 
-    /** Create a name for the final result. */
-    std::string resultImageFormat = "mhd";
-    this->GetConfiguration()->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
-    std::ostringstream makeFileName("");
-    makeFileName << this->GetConfiguration()->GetCommandLineArgument("-out") << "result." << resultImageFormat;
+    /** Possibly replace the transform by a (cached) displacement field. */
+    this->GetElxResamplerBase()->BakeTransformIntoDisplacementField();
 
-    /** Write the resampled image to disk.
-     * Actually we could loop over all resamplers.
-     * But for now, there seems to be no use yet for that.
+    /** All input images are resampled with the same transform and the same
+     * resampler, so the components are only set up once.
      */
-    if (!BaseComponent::IsElastixLibrary())
+    std::string resultImageFormat = "mhd";
+    this->GetConfiguration()->ReadParameter(resultImageFormat, "ResultImageFormat", 0, false);
+    const unsigned int numberOfMovingImages = this->GetNumberOfMovingImages();
+    const auto         resultImageContainer = DataObjectContainerType::New();
+    for (unsigned int i = 0; i < numberOfMovingImages; ++i)
     {
-      this->GetElxResamplerBase()->ResampleAndWriteResultImage(makeFileName.str().c_str());
+      this->GetElxResamplerBase()->GetAsITKBaseType()->SetInput(this->GetMovingImage(i));
+
+      /** Create a name for the result. When there are multiple input images,
+       * the name has the index of the input image.
+       */
+      std::ostringstream makeFileName("");
+      makeFileName << this->GetConfiguration()->GetCommandLineArgument("-out") << "result.";
+      if (numberOfMovingImages > 1)
+      {
+        makeFileName << i << ".";
+      }
+      makeFileName << resultImageFormat;
+
+      /** Write the resampled image to disk.
+       * Actually we could loop over all resamplers.
+       * But for now, there seems to be no use yet for that.
+       */
+      if (!BaseComponent::IsElastixLibrary())
+      {
+        this->GetElxResamplerBase()->ResampleAndWriteResultImage(makeFileName.str().c_str());
+      }
+      else
+      {
+        this->GetElxResamplerBase()->CreateItkResultImage();
+        resultImageContainer->InsertElement(i, this->GetResultImage());
+      }
     }
-    else
+    if (BaseComponent::IsElastixLibrary())
     {
-      this->GetElxResamplerBase()->CreateItkResultImage();
+      this->SetResultImageContainer(resultImageContainer);
     }
 
     /** Print the elapsed time for the resampling. */
@@ -397,6 +509,9 @@ ElastixTemplate<TFixedImage, TMovingImage>::ApplyTransform(void)
     elxout << "  Resampling took " << Conversion::SecondsToDHMS(timer.GetMean(), 2) << std::endl;
   }
 
+  /** Report the OpenCL profiling, if enabled. Transformix has no timings file. */
+  this->ReportOpenCLProfiling(false);
+
   /** Return a value. */
   return 0;
 
@@ -482,6 +597,17 @@ ElastixTemplate<TFixedImage, TMovingImage>::BeforeRegistration(void)
   CallInEachComponent(&BaseComponentType::BeforeRegistrationBase);
   CallInEachComponent(&BaseComponentType::BeforeRegistration);
 
+  /** Decide whether and how often to write checkpoints, and resume from one, if requested. */
+  this->m_WriteCheckpoint = false;
+  this->GetConfiguration()->ReadParameter(this->m_WriteCheckpoint, "WriteCheckpoint", 0, false);
+  this->m_CheckpointIterationInterval = 0;
+  if (this->m_WriteCheckpoint)
+  {
+    this->GetConfiguration()->ReadParameter(
+      this->m_CheckpointIterationInterval, "CheckpointIterationInterval", 0, false);
+  }
+  this->ResumeFromCheckpoint();
+
   /** Add a column to iteration with the iteration number. */
   this->AddTargetCellToIterationInfo("1:ItNr");
 
@@ -493,6 +619,7 @@ ElastixTemplate<TFixedImage, TMovingImage>::BeforeRegistration(void)
   this->m_Timer0.Stop();
   elxout << "Initialization of all components (before registration) took: "
          << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.\n";
+  this->m_Timings.emplace_back("InitializationBeforeRegistration", this->m_Timer0.GetMean());
 
   /** Start Timer0 here, to make it possible to measure the time needed for
    * preparation of the first resolution.
@@ -519,6 +646,7 @@ ElastixTemplate<TFixedImage, TMovingImage>::BeforeEachResolution(void)
     this->m_Timer0.Stop();
     elxout << "Preparation of the image pyramids took: " << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000)
            << " ms.\n";
+    this->m_Timings.emplace_back("PreparationOfImagePyramids", this->m_Timer0.GetMean());
     this->m_Timer0.Reset();
     this->m_Timer0.Start();
   }
@@ -537,15 +665,40 @@ ElastixTemplate<TFixedImage, TMovingImage>::BeforeEachResolution(void)
     this->OpenIterationInfoFile();
   }
 
+  /** Decide whether or not to write a TransformParameter-file after each iteration. */
+  this->m_WriteTransformParametersEachIteration = false;
+  this->GetConfiguration()->ReadParameter(
+    this->m_WriteTransformParametersEachIteration, "WriteTransformParametersEachIteration", 0, false);
+
   /** Call all the BeforeEachResolution() functions. */
   this->BeforeEachResolutionBase();
   CallInEachComponent(&BaseComponentType::BeforeEachResolutionBase);
   CallInEachComponent(&BaseComponentType::BeforeEachResolution);
 
+  /** The components have now set the initial parameters of this resolution. The
+   * checkpoint of the first resolution, or of the resolution that is resumed, would
+   * not add anything.
+   */
+  const auto registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+  if (this->m_WriteCheckpoint && level > registration->GetResumeLevel())
+  {
+    this->WriteCheckpoint(level, registration->GetInitialTransformParametersOfNextLevel());
+  }
+
+  /** Start the resolution in the TransformParametersLog, now that the transform is set up for it. */
+  std::string transformParametersEachIterationFormat = "text";
+  this->GetConfiguration()->ReadParameter(
+    transformParametersEachIterationFormat, "TransformParametersEachIterationFormat", 0, false);
+  if (this->m_WriteTransformParametersEachIteration && transformParametersEachIterationFormat == "log")
+  {
+    this->WriteToTransformParametersLog(true);
+  }
+
   /** Print the extra preparation time needed for this resolution. */
   this->m_Timer0.Stop();
   elxout << "Elastix initialization of all components (for this resolution) took: "
          << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.\n";
+  this->m_Timings.emplace_back("Resolution" + std::to_string(level) + ".Initialization", this->m_Timer0.GetMean());
 
   /** Start ResolutionTimer, which measures the total iteration time in this resolution. */
   this->m_ResolutionTimer.Reset();
@@ -577,6 +730,9 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachResolution(void)
   elxout << "Time spent in resolution " << (level)
          << " (ITK initialization and iterating): " << this->m_ResolutionTimer.GetMean() << " s.\n";
   elxout << std::setprecision(this->GetDefaultOutputPrecision());
+  const std::string resolutionName = "Resolution" + std::to_string(level);
+  this->m_Timings.emplace_back(resolutionName + ".Iterating", this->m_ResolutionTimer.GetMean());
+  this->m_Timings.emplace_back(resolutionName + ".NumberOfIterations", this->m_IterationCounter);
 
   /** Call all the AfterEachResolution() functions. */
   this->AfterEachResolutionBase();
@@ -597,7 +753,23 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachResolution(void)
     std::string fileName = makeFileName.str();
 
     /** Create a TransformParameterFile for this iteration. */
-    this->CreateTransformParameterFile(fileName, false);
+    this->CreateTransformParameterFile(fileName, false, true);
+  }
+
+  /** Finish the iteration info of this resolution. With the background writer, it is
+   * written while the next resolution starts, like the results above.
+   */
+  this->CloseIterationInfoFile();
+
+  /** Free the pyramid images of this resolution, if desired. The starts of a
+   * multi-start registration share them, so wait until the last one is done.
+   */
+  bool releasePyramidImages = false;
+  this->GetConfiguration()->ReadParameter(releasePyramidImages, "ReleasePyramidImagesAfterEachResolution", 0, false);
+  const auto * registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+  if (releasePyramidImages && registration->GetCurrentStart() + 1 >= registration->GetNumberOfStarts())
+  {
+    this->ReleasePyramidImagesOfResolution(level);
   }
 
   /** Start Timer0 here, to make it possible to measure the time needed for:
@@ -618,12 +790,28 @@ template <class TFixedImage, class TMovingImage>
 void
 ElastixTemplate<TFixedImage, TMovingImage>::AfterEachIteration(void)
 {
-  /** Write the headers of the columns that are printed each iteration. */
+  /** Write the headers of the columns that are printed each iteration. At
+   * this point all buffers of the current resolution have been allocated, so
+   * it is also the moment to report the memory usage.
+   */
   if (this->m_IterationCounter == 0)
   {
+    this->CheckMemoryUsage();
     this->GetIterationInfo().WriteHeaders();
   }
 
+  /** Report the progress to the iteration callback. When it asks to stop, the remaining
+   * resolutions are skipped, and the optimizers that check GetRegistrationStopRequested()
+   * stop in their AfterEachIteration().
+   */
+  const auto registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+  if (this->CallIterationCallback(registration->GetCurrentLevel(),
+                                  this->m_IterationCounter,
+                                  this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition()))
+  {
+    registration->StopRegistration();
+  }
+
   /** Call all the AfterEachIteration() functions. */
   this->AfterEachIterationBase();
   CallInEachComponent(&BaseComponentType::AfterEachIterationBase);
@@ -636,14 +824,23 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachIteration(void)
   this->m_IterationTimer.Stop();
   this->GetIterationInfoAt("Time[ms]") << this->m_IterationTimer.GetMean() * 1000.0;
 
-  /** Write the iteration info of this iteration. */
+  /** Write the iteration info of this iteration. With the background writer, pass it on
+   * in chunks of about a megabyte, instead of keeping the table of the whole resolution.
+   */
   this->GetIterationInfo().WriteBufferedData();
+  if (!this->m_IterationInfoFileName.empty() && this->m_IterationInfoText.tellp() >= (1 << 20))
+  {
+    this->PushIterationInfoText();
+  }
 
-  /** Create a TransformParameter-file for the current iteration. */
-  bool writeTansformParametersThisIteration = false;
-  this->GetConfiguration()->ReadParameter(
-    writeTansformParametersThisIteration, "WriteTransformParametersEachIteration", 0, false);
-  if (writeTansformParametersThisIteration)
+  /** Append the parameters of the current iteration to the TransformParametersLog, or
+   * create a TransformParameter-file for the current iteration.
+   */
+  if (this->m_WriteTransformParametersEachIteration && this->m_TransformParametersLog != nullptr)
+  {
+    this->WriteToTransformParametersLog(false);
+  }
+  else if (this->m_WriteTransformParametersEachIteration)
   {
     /** Add zeros to the number of iterations, to make sure
      * it always consists of 7 digits.
@@ -676,7 +873,15 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterEachIteration(void)
     std::string tpFileName = makeFileName.str();
 
     /** Create a TransformParameterFile for this iteration. */
-    this->CreateTransformParameterFile(tpFileName, false);
+    this->CreateTransformParameterFile(tpFileName, false, true);
+  }
+
+  /** Write a checkpoint every CheckpointIterationInterval iterations. */
+  if (this->m_CheckpointIterationInterval > 0 &&
+      (this->m_IterationCounter + 1) % this->m_CheckpointIterationInterval == 0)
+  {
+    this->WriteCheckpoint(registration->GetCurrentLevel(),
+                          this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition());
   }
 
   /** Count the number of iterations. */
@@ -700,6 +905,10 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterRegistration(void)
   itk::TimeProbe timer;
   timer.Start();
 
+  /** Finish writing the intermediate results, and close the TransformParametersLog. */
+  this->WaitForBackgroundWriter();
+  this->m_TransformParametersLog.reset();
+
   /** A white line. */
   elxout << std::endl;
 
@@ -725,6 +934,7 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterRegistration(void)
 
   timer.Stop();
   elxout << "\nCreating the TransformParameterFile took " << Conversion::SecondsToDHMS(timer.GetMean(), 2) << std::endl;
+  this->m_Timings.emplace_back("CreatingTransformParameterFile", timer.GetMean());
 
   /** Call all the AfterRegistration() functions. */
   this->AfterRegistrationBase();
@@ -735,10 +945,347 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterRegistration(void)
   this->m_Timer0.Stop();
   elxout << "Time spent on saving the results, applying the final transform etc.: "
          << static_cast<unsigned long>(this->m_Timer0.GetMean() * 1000) << " ms.\n";
+  this->m_Timings.emplace_back("AfterRegistration", this->m_Timer0.GetMean());
+
+  /** Report the OpenCL profiling and the hardware counters, if enabled. */
+  this->ReportOpenCLProfiling(true);
+  this->ReportHardwareCounters();
+
+  /** Write the timings in a machine-readable format, if desired. */
+  bool writeTimings = false;
+  this->GetConfiguration()->ReadParameter(writeTimings, "WriteTimings", 0, false);
+  if (writeTimings)
+  {
+    this->WriteTimingsFile();
+  }
 
 } // end AfterRegistration()
 
 
+/**
+ * ************** CheckMemoryUsage *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::CheckMemoryUsage(void) const
+{
+  const unsigned long level = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
+
+  /** The memory usage is reported in kilobytes. */
+  itk::MemoryUsageObserver memoryUsageObserver;
+  const unsigned long      memoryUsage = memoryUsageObserver.GetMemoryUsage() / 1024;
+  elxout << "Memory in use in resolution " << level << ": " << memoryUsage << " MB.\n";
+
+  unsigned long maximumMemoryBudget = 0;
+  this->GetConfiguration()->ReadParameter(maximumMemoryBudget, "MaximumMemoryBudget", 0, false);
+  if (maximumMemoryBudget > 0 && memoryUsage > maximumMemoryBudget)
+  {
+    itkExceptionMacro(<< "The memory in use in resolution " << level << " (" << memoryUsage
+                      << " MB) exceeds the MaximumMemoryBudget of " << maximumMemoryBudget << " MB.");
+  }
+
+} // end CheckMemoryUsage()
+
+
+/**
+ * ************** ReleasePyramidImagesOfResolution *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::ReleasePyramidImagesOfResolution(const unsigned long level) const
+{
+  /** The output of level 0 is the primary output of a pyramid. The metric
+   * updates the source of its images when it is initialized, which would
+   * recompute all pyramid levels if the primary output had been released.
+   * The other outputs are not touched again once their level is finished.
+   */
+  if (level == 0)
+  {
+    return;
+  }
+
+  for (unsigned int i = 0; i < this->GetNumberOfFixedImagePyramids(); ++i)
+  {
+    this->GetElxFixedImagePyramidBase(i)->GetAsITKBaseType()->GetOutput(level)->ReleaseData();
+  }
+  for (unsigned int i = 0; i < this->GetNumberOfMovingImagePyramids(); ++i)
+  {
+    this->GetElxMovingImagePyramidBase(i)->GetAsITKBaseType()->GetOutput(level)->ReleaseData();
+  }
+
+} // end ReleasePyramidImagesOfResolution()
+
+
+/**
+ * ************** WriteTimingsFile *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::WriteTimingsFile(void) const
+{
+  std::ostringstream makeFileName("");
+  makeFileName << this->GetConfiguration()->GetCommandLineArgument("-out") << "Timings."
+               << this->GetConfiguration()->GetElastixLevel() << ".json";
+  const std::string fileName = makeFileName.str();
+
+  std::ofstream timingsFile(fileName);
+  if (!timingsFile.is_open())
+  {
+    xl::xout["error"] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
+    return;
+  }
+
+  /** Write a flat JSON object, mapping the name of each phase to its wall time in seconds. */
+  timingsFile << std::setprecision(6) << "{";
+  const char * separator = "\n";
+  for (const auto & timing : this->m_Timings)
+  {
+    timingsFile << separator << "  \"" << timing.first << "\": " << timing.second;
+    separator = ",\n";
+  }
+  timingsFile << "\n}\n";
+
+} // end WriteTimingsFile()
+
+
+/**
+ * ************** WriteCheckpoint *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::WriteCheckpoint(const unsigned long                      level,
+                                                            const itk::OptimizerParameters<double> & parameters) const
+{
+  const unsigned int elastixLevel = this->GetConfiguration()->GetElastixLevel();
+  std::ostringstream makeFileName("");
+  makeFileName << this->GetConfiguration()->GetCommandLineArgument("-out") << "Checkpoint." << elastixLevel << ".bin";
+  const std::string fileName = makeFileName.str();
+
+  /** Write to a temporary file first, so that an interruption while writing
+   * leaves the previous checkpoint intact.
+   */
+  const std::string temporaryFileName = fileName + ".tmp";
+  {
+    std::ofstream checkpointFile(temporaryFileName, std::ios::binary);
+    if (!checkpointFile.is_open())
+    {
+      xl::xout["error"] << "ERROR: File \"" << temporaryFileName << "\" could not be opened!" << std::endl;
+      return;
+    }
+
+    /** A text header, followed by the parameters as native doubles. */
+    checkpointFile << "elastixcheckpoint " << elastixLevel << ' ' << level << ' ' << parameters.GetSize() << '\n';
+    checkpointFile.write(reinterpret_cast<const char *>(parameters.data_block()),
+                         static_cast<std::streamsize>(parameters.GetSize() * sizeof(double)));
+    if (!checkpointFile)
+    {
+      xl::xout["error"] << "ERROR: File \"" << temporaryFileName << "\" could not be written!" << std::endl;
+      return;
+    }
+  }
+
+  if (!itksys::SystemTools::RenameFile(temporaryFileName, fileName))
+  {
+    xl::xout["error"] << "ERROR: File \"" << fileName << "\" could not be replaced!" << std::endl;
+  }
+
+} // end WriteCheckpoint()
+
+
+/**
+ * ************** ResumeFromCheckpoint *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::ResumeFromCheckpoint(void)
+{
+  const std::string fileName = this->GetConfiguration()->GetCommandLineArgument("-resume");
+  if (fileName.empty())
+  {
+    /** A warm start resumes at the last resolution, where the number of parameters is
+     * that of the final parameters of the registration that it starts from.
+     */
+    const itk::OptimizerParameters<double> & warmStartParameters = this->GetWarmStartParameters();
+    if (warmStartParameters.GetSize() > 0)
+    {
+      const auto registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+      registration->SetResumeLevel(registration->GetNumberOfLevels() - 1);
+      registration->SetResumeParameters(warmStartParameters);
+      elxout << "Warm starting the registration at the last resolution.\n";
+    }
+    return;
+  }
+
+  std::ifstream checkpointFile(fileName, std::ios::binary);
+  if (!checkpointFile.is_open())
+  {
+    itkExceptionMacro(<< "ERROR: The checkpoint \"" << fileName << "\" could not be opened.");
+  }
+
+  std::string header;
+  std::getline(checkpointFile, header);
+  std::istringstream headerStream(header);
+  std::string        magic;
+  unsigned int       elastixLevel = 0;
+  unsigned long      level = 0;
+  std::size_t        numberOfParameters = 0;
+  if (!(headerStream >> magic >> elastixLevel >> level >> numberOfParameters) || magic != "elastixcheckpoint")
+  {
+    itkExceptionMacro(<< "ERROR: The file \"" << fileName << "\" is not an elastix checkpoint.");
+  }
+
+  /** With several parameter files, the checkpoint belongs to one of them. The
+   * registrations of the others are done from the start.
+   */
+  if (elastixLevel != this->GetConfiguration()->GetElastixLevel())
+  {
+    return;
+  }
+
+  const auto registration = this->GetElxRegistrationBase()->GetAsITKBaseType();
+  if (level >= registration->GetNumberOfLevels())
+  {
+    itkExceptionMacro(<< "ERROR: The checkpoint \"" << fileName << "\" is of resolution " << level
+                      << ", but there are only " << registration->GetNumberOfLevels() << " resolutions.");
+  }
+
+  itk::OptimizerParameters<double> parameters(numberOfParameters);
+  checkpointFile.read(reinterpret_cast<char *>(parameters.data_block()),
+                      static_cast<std::streamsize>(numberOfParameters * sizeof(double)));
+  if (!checkpointFile)
+  {
+    itkExceptionMacro(<< "ERROR: The checkpoint \"" << fileName << "\" is truncated.");
+  }
+
+  registration->SetResumeLevel(level);
+  registration->SetResumeParameters(parameters);
+  elxout << "Resuming the registration at resolution " << level << ", from the checkpoint \"" << fileName << "\".\n";
+
+} // end ResumeFromCheckpoint()
+
+
+/**
+ * ************** ReportOpenCLProfiling *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::ReportOpenCLProfiling(const bool addToTimings)
+{
+#  ifdef ELASTIX_USE_OPENCL
+  itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
+  if (!context->IsCreated() || !context->GetProfilingEnabled())
+  {
+    return;
+  }
+
+  /** The kernel times are summed over all launches, and reported in ms. */
+  elxout << "\nOpenCL kernel timings (launches, queued, submitted, run):\n";
+  for (const auto & kernelProfile : context->GetKernelProfiles())
+  {
+    const std::string &                       name = kernelProfile.first;
+    const itk::OpenCLContext::KernelProfile & profile = kernelProfile.second;
+    elxout << "  " << name << ": " << profile.m_NumberOfLaunches << ", "
+           << static_cast<unsigned long>(profile.m_QueuedTime * 1000) << " ms, "
+           << static_cast<unsigned long>(profile.m_SubmittedTime * 1000) << " ms, "
+           << static_cast<unsigned long>(profile.m_RunTime * 1000) << " ms\n";
+
+    if (addToTimings)
+    {
+      this->m_Timings.emplace_back("OpenCL." + name + ".NumberOfLaunches", profile.m_NumberOfLaunches);
+      this->m_Timings.emplace_back("OpenCL." + name + ".QueuedTime", profile.m_QueuedTime);
+      this->m_Timings.emplace_back("OpenCL." + name + ".SubmittedTime", profile.m_SubmittedTime);
+      this->m_Timings.emplace_back("OpenCL." + name + ".RunTime", profile.m_RunTime);
+    }
+  }
+
+  const double megabytesToDevice = context->GetNumberOfBytesTransferredToDevice() / (1024.0 * 1024.0);
+  const double megabytesToHost = context->GetNumberOfBytesTransferredToHost() / (1024.0 * 1024.0);
+  elxout << "OpenCL transfers: " << megabytesToDevice << " MB to the device, " << megabytesToHost
+         << " MB to the host." << std::endl;
+  if (addToTimings)
+  {
+    this->m_Timings.emplace_back("OpenCL.MegabytesToDevice", megabytesToDevice);
+    this->m_Timings.emplace_back("OpenCL.MegabytesToHost", megabytesToHost);
+  }
+
+  /** The next elastix level starts its own profile. */
+  context->ResetProfiling();
+#  else
+  (void)addToTimings;
+#  endif
+
+} // end ReportOpenCLProfiling()
+
+
+/**
+ * ************** ReportHardwareCounters *******************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::ReportHardwareCounters(void)
+{
+  if (!this->m_UsesHardwareCounters)
+  {
+    return;
+  }
+  this->m_UsesHardwareCounters = false;
+
+  /** The counts are mixed when another registration has been started since the counting started. */
+  if (GetNumberOfStartedRegistrations() != this->m_NumberOfStartedRegistrationsAtHardwareCountersStart)
+  {
+    xl::xout["warning"] << "WARNING: The hardware counters are not reported, because other registrations have run "
+                        << "in this process at the same time." << std::endl;
+    itk::HardwareCounters::SetEnabled(false);
+    itk::HardwareCounters::Reset();
+    return;
+  }
+
+  /** The memory traffic is estimated by a cache line per last level cache miss. */
+  elxout << "\nHardware counters (occurrences, cycles, instructions, LLC misses, instructions per cycle, "
+            "bytes per sample):\n";
+  for (const auto & phaseCounts : itk::HardwareCounters::GetCounts())
+  {
+    const std::string &                   name = phaseCounts.first;
+    const itk::HardwareCounters::Counts & counts = phaseCounts.second;
+
+    const double instructionsPerCycle = (counts.m_Cycles > 0.0) ? counts.m_Instructions / counts.m_Cycles : 0.0;
+    const double bytesPerSample =
+      (counts.m_NumberOfSamples > 0)
+        ? counts.m_LastLevelCacheMisses * itk::HardwareCounters::CacheLineSize / counts.m_NumberOfSamples
+        : 0.0;
+
+    elxout << "  " << name << ": " << counts.m_NumberOfOccurrences << ", " << counts.m_Cycles << ", "
+           << counts.m_Instructions << ", " << counts.m_LastLevelCacheMisses << ", " << instructionsPerCycle << ", "
+           << bytesPerSample << "\n";
+
+    const std::string prefix = "HardwareCounters." + name + ".";
+    this->m_Timings.emplace_back(prefix + "NumberOfOccurrences", counts.m_NumberOfOccurrences);
+    this->m_Timings.emplace_back(prefix + "Cycles", counts.m_Cycles);
+    this->m_Timings.emplace_back(prefix + "Instructions", counts.m_Instructions);
+    this->m_Timings.emplace_back(prefix + "LastLevelCacheMisses", counts.m_LastLevelCacheMisses);
+    this->m_Timings.emplace_back(prefix + "InstructionsPerCycle", instructionsPerCycle);
+    if (counts.m_NumberOfSamples > 0)
+    {
+      this->m_Timings.emplace_back(prefix + "NumberOfSamples", counts.m_NumberOfSamples);
+      this->m_Timings.emplace_back(prefix + "BytesPerSample", bytesPerSample);
+    }
+  }
+  elxout << std::flush;
+
+  /** The next elastix level starts its own counts. */
+  itk::HardwareCounters::SetEnabled(false);
+  itk::HardwareCounters::Reset();
+
+} // end ReportHardwareCounters()
+
+
 /**
  * ************** CreateTransformParameterFile ******************
  *
@@ -748,7 +1295,9 @@ ElastixTemplate<TFixedImage, TMovingImage>::AfterRegistration(void)
 
 template <class TFixedImage, class TMovingImage>
 void
-ElastixTemplate<TFixedImage, TMovingImage>::CreateTransformParameterFile(const std::string & fileName, const bool toLog)
+ElastixTemplate<TFixedImage, TMovingImage>::CreateTransformParameterFile(const std::string & fileName,
+                                                                         const bool          toLog,
+                                                                         const bool          inBackground)
 {
   /** Store CurrentTransformParameterFileName. */
   this->m_CurrentTransformParameterFileName = fileName;
@@ -764,16 +1313,28 @@ ElastixTemplate<TFixedImage, TMovingImage>::CreateTransformParameterFile(const s
   /** Set it in the Transform, for later use. */
   this->GetElxTransformBase()->SetTransformParametersFileName(fileName.c_str());
 
-  /** Open the TransformParameter file. */
-  transformParameterFile.open(fileName.c_str());
-  if (!transformParameterFile.is_open())
+  /** Open the TransformParameter file. The background writer gets the text of the file instead. */
+  itk::BackgroundTaskQueue * backgroundWriter = inBackground ? this->GetBackgroundWriter() : nullptr;
+  std::ostringstream         transformParameterText;
+  if (backgroundWriter == nullptr)
   {
-    xl::xout["error"] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
+    transformParameterFile.open(fileName.c_str());
+    if (!transformParameterFile.is_open())
+    {
+      xl::xout["error"] << "ERROR: File \"" << fileName << "\" could not be opened!" << std::endl;
+    }
   }
 
   /** This xout["transpar"] writes to the log and to the TransformParameter file. */
   transformationParameterInfo.RemoveOutput("cout");
-  transformationParameterInfo.AddOutput("tpf", &transformParameterFile);
+  if (backgroundWriter == nullptr)
+  {
+    transformationParameterInfo.AddOutput("tpf", &transformParameterFile);
+  }
+  else
+  {
+    transformationParameterInfo.AddOutput("tpf", &transformParameterText);
+  }
   if (!toLog)
   {
     transformationParameterInfo.RemoveOutput("log");
@@ -800,6 +1361,21 @@ ElastixTemplate<TFixedImage, TMovingImage>::CreateTransformParameterFile(const s
     xl::xout["logonly"] << "\n=============== end of TransformParameterFile ===============" << std::endl;
   }
 
+  /** Let the background writer write the file. */
+  if (backgroundWriter != nullptr)
+  {
+    this->ReportBackgroundWriterErrors();
+    const std::string text = transformParameterText.str();
+    backgroundWriter->Push([fileName, text] {
+      std::ofstream file(fileName.c_str());
+      file << text;
+      if (!file)
+      {
+        throw std::runtime_error("File \"" + fileName + "\" could not be written!");
+      }
+    });
+  }
+
 } // end CreateTransformParameterFile()
 
 
@@ -1009,13 +1585,8 @@ template <class TFixedImage, class TMovingImage>
 void
 ElastixTemplate<TFixedImage, TMovingImage>::OpenIterationInfoFile(void)
 {
-  /** Remove the current iteration info output file, if any. */
-  this->GetIterationInfo().RemoveOutput("IterationInfoFile");
-
-  if (this->m_IterationInfoFile.is_open())
-  {
-    this->m_IterationInfoFile.close();
-  }
+  /** Close the iteration info output file of the previous resolution, if any. */
+  this->CloseIterationInfoFile();
 
   /** Create the IterationInfo filename for this resolution. */
   std::ostringstream makeFileName("");
@@ -1024,6 +1595,17 @@ ElastixTemplate<TFixedImage, TMovingImage>::OpenIterationInfoFile(void)
                << this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel() << ".txt";
   std::string fileName = makeFileName.str();
 
+  /** With the background writer, collect the table in memory, and write it at the end of the resolution. */
+  if (this->GetBackgroundWriter() != nullptr)
+  {
+    this->m_IterationInfoText.str("");
+    this->m_IterationInfoText.clear();
+    this->m_IterationInfoFileName = fileName;
+    this->m_IterationInfoTextIsAppended = false;
+    this->GetIterationInfo().AddOutput("IterationInfoFile", &(this->m_IterationInfoText));
+    return;
+  }
+
   /** Open the IterationInfoFile. */
   this->m_IterationInfoFile.open(fileName.c_str());
   if (!(this->m_IterationInfoFile.is_open()))
@@ -1039,6 +1621,147 @@ ElastixTemplate<TFixedImage, TMovingImage>::OpenIterationInfoFile(void)
 } // end OpenIterationInfoFile()
 
 
+/**
+ * ************** CloseIterationInfoFile *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::CloseIterationInfoFile(void)
+{
+  /** Remove the current iteration info output file, if any. */
+  this->GetIterationInfo().RemoveOutput("IterationInfoFile");
+
+  if (this->m_IterationInfoFile.is_open())
+  {
+    this->m_IterationInfoFile.close();
+  }
+
+  /** Let the background writer write the rest of the table that was collected in memory. */
+  if (!this->m_IterationInfoFileName.empty())
+  {
+    this->PushIterationInfoText();
+    this->m_IterationInfoFileName.clear();
+  }
+
+} // end CloseIterationInfoFile()
+
+
+/**
+ * ************** PushIterationInfoText *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::PushIterationInfoText(void)
+{
+  itk::BackgroundTaskQueue * backgroundWriter = this->GetBackgroundWriter();
+  if (backgroundWriter == nullptr)
+  {
+    return;
+  }
+
+  /** The first chunk of a resolution replaces the file of a previous run, the others are appended. */
+  this->ReportBackgroundWriterErrors();
+  const std::string             fileName = this->m_IterationInfoFileName;
+  const std::string             text = this->m_IterationInfoText.str();
+  const std::ios_base::openmode mode = this->m_IterationInfoTextIsAppended ? std::ios_base::app : std::ios_base::out;
+  this->m_IterationInfoTextIsAppended = true;
+  this->m_IterationInfoText.str("");
+  backgroundWriter->Push([fileName, text, mode] {
+    std::ofstream file(fileName.c_str(), mode);
+    file << text;
+    if (!file)
+    {
+      throw std::runtime_error("File \"" + fileName + "\" could not be written!");
+    }
+  });
+
+} // end PushIterationInfoText()
+
+
+/**
+ * ************** WriteToTransformParametersLog *************************
+ */
+
+template <class TFixedImage, class TMovingImage>
+void
+ElastixTemplate<TFixedImage, TMovingImage>::WriteToTransformParametersLog(const bool startOfResolution)
+{
+  const unsigned long level = this->GetElxRegistrationBase()->GetAsITKBaseType()->GetCurrentLevel();
+
+  std::function<void()> task;
+  if (startOfResolution)
+  {
+    if (this->m_TransformParametersLog == nullptr)
+    {
+      std::ostringstream makeFileName("");
+      makeFileName << this->GetConfiguration()->GetCommandLineArgument("-out") << "TransformParametersLog."
+                   << this->GetConfiguration()->GetElastixLevel() << ".bin";
+      try
+      {
+        this->m_TransformParametersLog = std::make_shared<itk::TransformParametersLog>(makeFileName.str());
+      }
+      catch (const itk::ExceptionObject & excp)
+      {
+        /** Fall back to a transform parameter file per iteration. */
+        xl::xout["error"] << excp.GetDescription() << std::endl;
+        return;
+      }
+    }
+
+    /** The text of the transform parameter file, in the layout of CreateTransformParameterFile(),
+     * with an empty TransformParameters entry, because they differ per iteration. The
+     * materialization fills them in, always as text.
+     */
+    const auto       transformBase = this->GetElxTransformBase();
+    ParameterMapType transformParameterMap;
+    transformBase->CreateTransformParametersMap(
+      transformBase->GetAsITKBaseType()->GetParameters(), transformParameterMap, false);
+    transformParameterMap["TransformParameters"] = {};
+    transformParameterMap["UseBinaryFormatForTransformationParameters"] = { "false" };
+    ParameterMapType resampleInterpolatorParameterMap;
+    this->GetElxResampleInterpolatorBase()->CreateTransformParametersMap(resampleInterpolatorParameterMap);
+    ParameterMapType resamplerParameterMap;
+    this->GetElxResamplerBase()->CreateTransformParametersMap(resamplerParameterMap);
+
+    const std::shared_ptr<itk::TransformParametersLog> log = this->m_TransformParametersLog;
+    const std::string                                  text =
+      Conversion::ParameterMapToString(transformParameterMap) + "\n// ResampleInterpolator specific\n" +
+      Conversion::ParameterMapToString(resampleInterpolatorParameterMap) + "\n// Resampler specific\n" +
+      Conversion::ParameterMapToString(resamplerParameterMap);
+    task = [log, level, text] { log->WriteResolution(level, text); };
+  }
+  else
+  {
+    const std::shared_ptr<itk::TransformParametersLog> log = this->m_TransformParametersLog;
+    const unsigned long                                iteration = this->m_IterationCounter;
+    const itk::OptimizerParameters<double>             parameters =
+      this->GetElxOptimizerBase()->GetAsITKBaseType()->GetCurrentPosition();
+    task = [log, iteration, parameters] { log->WriteIteration(iteration, parameters); };
+  }
+
+  /** The background writer compresses and writes the records in the order in which they are pushed. */
+  itk::BackgroundTaskQueue * backgroundWriter = this->GetBackgroundWriter();
+  if (backgroundWriter != nullptr)
+  {
+    this->ReportBackgroundWriterErrors();
+    backgroundWriter->Push(task);
+    return;
+  }
+
+  try
+  {
+    task();
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    xl::xout["error"] << excp.GetDescription() << std::endl;
+  }
+
+} // end WriteToTransformParametersLog()
+
+
 /**
  * ************** GetOriginalFixedImageDirection *********************
  * Determine the original fixed image direction (it might have been
@@ -27,12 +27,21 @@
 #include "elxTransformixMain.h"
 
 #include "elxMacro.h"
+#include "itkThreadBudget.h"
 
 #ifdef ELASTIX_USE_OPENCL
 #  include "itkOpenCLContext.h"
 #  include "itkOpenCLSetup.h"
 #endif
 
+#include <atomic>
+
+namespace
+{
+/** Whether the OpenCL context outlives the TransformixMain objects, see SetKeepOpenCLContext(). */
+std::atomic<bool> g_KeepOpenCLContext{ false };
+} // namespace
+
 namespace elastix
 {
 
@@ -50,6 +59,10 @@ TransformixMain::Run(void)
   this->SetProcessPriority();
   this->SetMaximumNumberOfThreads();
 
+  /** Limit the number of threads of this transformation, and the CPUs of the thread that runs it. */
+  const itk::ThreadBudget threadBudget(this->GetMaximumNumberOfThreads());
+  const CpuAffinityGuard  cpuAffinity(this->m_Configuration->GetCommandLineArgument("-affinity"));
+
   /** Initialize database. */
   int errorCode = this->InitDBIndex();
   if (errorCode != 0)
@@ -80,9 +93,12 @@ TransformixMain::Run(void)
   int userSuppliedOpenCLDeviceID = -1;
   this->m_Configuration->ReadParameter(userSuppliedOpenCLDeviceID, "OpenCLDeviceID", 0, false);
 
+  bool useMultipleOpenCLDevices = false;
+  this->m_Configuration->ReadParameter(useMultipleOpenCLDevices, "OpenCLUseMultipleDevices", 0, false);
+
   std::string errorMessage = "";
-  const bool  creatingContextSuccessful =
-    itk::CreateOpenCLContext(errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID);
+  const bool  creatingContextSuccessful = itk::CreateOpenCLContext(
+    errorMessage, userSuppliedOpenCLDeviceType, userSuppliedOpenCLDeviceID, useMultipleOpenCLDevices);
   if (!creatingContextSuccessful)
   {
     /** Report and disable the GPU by releasing the context. */
@@ -92,6 +108,18 @@ TransformixMain::Run(void)
     itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
     context->Release();
   }
+  else
+  {
+    /** Optionally cache the compiled OpenCL programs on disk. */
+    std::string programCacheDirectory = "";
+    this->m_Configuration->ReadParameter(programCacheDirectory, "OpenCLProgramCacheDirectory", 0, false);
+    itk::OpenCLContext::GetInstance()->SetProgramCacheDirectory(programCacheDirectory);
+
+    /** Collect the timings of the OpenCL kernels, to be reported after the run. */
+    bool openCLProfiling = false;
+    this->m_Configuration->ReadParameter(openCLProfiling, "OpenCLProfiling", 0, false);
+    itk::OpenCLContext::GetInstance()->SetProfilingEnabled(openCLProfiling);
+  }
 
   /** Create a log file. */
   itk::CreateOpenCLLogger("transformix", this->m_Configuration->GetCommandLineArgument("-out"));
@@ -151,6 +179,9 @@ TransformixMain::Run(void)
   this->SetMovingImageContainer(elastixBase.GetMovingImageContainer());
   this->SetResultImageContainer(elastixBase.GetResultImageContainer());
   this->SetResultDeformationFieldContainer(elastixBase.GetResultDeformationFieldContainer());
+  this->SetResultDeterminantOfSpatialJacobian(elastixBase.GetResultDeterminantOfSpatialJacobian());
+  this->SetResultSpatialJacobian(elastixBase.GetResultSpatialJacobian());
+  this->SetResultPointSet(elastixBase.GetResultPointSet());
 
   return errorCode;
 
@@ -211,6 +242,42 @@ TransformixMain::SetInputImageContainer(DataObjectContainerType * inputImageCont
  */
 
 TransformixMain::~TransformixMain()
+{
+  if (!g_KeepOpenCLContext)
+  {
+    ReleaseOpenCLContext();
+  }
+} // end Destructor
+
+
+/**
+ * ******************* SetKeepOpenCLContext *********************
+ */
+
+void
+TransformixMain::SetKeepOpenCLContext(const bool keep)
+{
+  g_KeepOpenCLContext = keep;
+} // end SetKeepOpenCLContext()
+
+
+/**
+ * ******************* GetKeepOpenCLContext *********************
+ */
+
+bool
+TransformixMain::GetKeepOpenCLContext(void)
+{
+  return g_KeepOpenCLContext;
+} // end GetKeepOpenCLContext()
+
+
+/**
+ * ******************* ReleaseOpenCLContext *********************
+ */
+
+void
+TransformixMain::ReleaseOpenCLContext(void)
 {
 #ifdef ELASTIX_USE_OPENCL
   itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
@@ -219,7 +286,7 @@ TransformixMain::~TransformixMain()
     context->Release();
   }
 #endif
-} // end Destructor
+} // end ReleaseOpenCLContext()
 
 
 /**
@@ -101,6 +101,30 @@ public:
   virtual void
   SetInputImageContainer(DataObjectContainerType * inputImageContainer);
 
+  /** Get and Set the results that are kept in memory, when transformix is used as library. */
+  itkSetObjectMacro(ResultDeterminantOfSpatialJacobian, DataObjectType);
+  itkGetModifiableObjectMacro(ResultDeterminantOfSpatialJacobian, DataObjectType);
+
+  itkSetObjectMacro(ResultSpatialJacobian, DataObjectType);
+  itkGetModifiableObjectMacro(ResultSpatialJacobian, DataObjectType);
+
+  itkSetObjectMacro(ResultPointSet, DataObjectType);
+  itkGetModifiableObjectMacro(ResultPointSet, DataObjectType);
+
+  /** Set/Get whether the OpenCL context is kept when a TransformixMain object is destroyed, so
+   * that the next one of the process reuses it, instead of creating it again. Disabled by default;
+   * the service mode of transformix enables it, and calls ReleaseOpenCLContext() at the end.
+   */
+  static void
+  SetKeepOpenCLContext(const bool keep);
+
+  static bool
+  GetKeepOpenCLContext(void);
+
+  /** Releases the OpenCL context, if it is created. */
+  static void
+  ReleaseOpenCLContext(void);
+
 protected:
   TransformixMain() = default;
   ~TransformixMain() override;
@@ -115,6 +139,10 @@ private:
   TransformixMain(const Self &) = delete;
   void
   operator=(const Self &) = delete;
+
+  DataObjectPointer m_ResultDeterminantOfSpatialJacobian;
+  DataObjectPointer m_ResultSpatialJacobian;
+  DataObjectPointer m_ResultPointSet;
 };
 
 } // end namespace elastix
@@ -40,4 +40,18 @@ CoreMainGTestUtilities::GetDataDirectoryPath()
   return str + ((str.back() == '/') ? "" : "/") + "Testing/Data";
 }
 
+
+std::string
+CoreMainGTestUtilities::GetCurrentBinaryDirectoryPath()
+{
+  constexpr auto binaryDirectoryPath = ELX_CMAKE_CURRENT_BINARY_DIR;
+  static_assert(std::is_same<decltype(binaryDirectoryPath), const char * const>(),
+                "CMAKE_CURRENT_BINARY_DIR must be a character string!");
+  static_assert(binaryDirectoryPath != nullptr, "CMAKE_CURRENT_BINARY_DIR must not be null!");
+  static_assert(*binaryDirectoryPath != '\0', "CMAKE_CURRENT_BINARY_DIR must not be empty!");
+
+  const std::string str = binaryDirectoryPath;
+  return (str.back() == '/') ? str.substr(0, str.size() - 1) : str;
+}
+
 } // namespace elastix
@@ -240,6 +240,10 @@ GetTransformParametersFromFilter(TFilter & filter)
 std::string
 GetDataDirectoryPath();
 
+/// Returns the path of the binary directory of the tests, in which they may write their output.
+std::string
+GetCurrentBinaryDirectoryPath();
+
 } // namespace CoreMainGTestUtilities
 } // namespace elastix
 
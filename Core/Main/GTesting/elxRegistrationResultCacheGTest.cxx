@@ -0,0 +1,427 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+
+// First include the header file to be tested:
+#include "elxRegistrationResultCache.h"
+
+#include <itkElastixRegistrationMethod.h>
+
+#include "elxCoreMainGTestUtilities.h"
+
+// ITK header files:
+#include <itkImage.h>
+#include <itkIndexRange.h>
+#include <itksys/SystemTools.hxx>
+
+// GoogleTest header file:
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Using-declarations:
+using elx::CoreMainGTestUtilities::CheckNew;
+using elx::CoreMainGTestUtilities::ConvertToOffset;
+using elx::CoreMainGTestUtilities::CreateParameterObject;
+using elx::CoreMainGTestUtilities::Deref;
+using elx::CoreMainGTestUtilities::FillImageRegion;
+using elx::CoreMainGTestUtilities::GetCurrentBinaryDirectoryPath;
+using elx::CoreMainGTestUtilities::GetTransformParametersFromFilter;
+using elx::CoreMainGTestUtilities::GetTransformParametersFromMaps;
+
+namespace
+{
+using CacheType = elx::RegistrationResultCache;
+using KeyType = CacheType::KeyType;
+using ResultType = CacheType::ResultType;
+
+constexpr auto ImageDimension = 2U;
+using ImageType = itk::Image<float, ImageDimension>;
+using RegistrationMethodType = itk::ElastixRegistrationMethod<ImageType, ImageType>;
+
+
+// Returns a key of which the hashes are the specified strings, and the moving signature the specified values.
+KeyType
+MakeKey(const std::string &              fixedHash,
+        const std::string &              movingHash,
+        const std::string &              parameterHash,
+        const CacheType::SignatureType & movingSignature)
+{
+  KeyType key;
+  key.m_FixedHash = fixedHash;
+  key.m_MovingHash = movingHash;
+  key.m_MovingGeometryHash = "geometry";
+  key.m_ParameterHash = parameterHash;
+  key.m_MovingSignature = movingSignature;
+  return key;
+}
+
+
+// Returns a result of which the transform parameter map has the specified name, and that has final parameters.
+ResultType
+MakeResult(const std::string & name)
+{
+  ResultType result;
+  result.m_TransformParameterMaps.resize(1);
+  result.m_TransformParameterMaps.front()["Name"] = { name };
+  result.m_FinalParameters.resize(1, itk::OptimizerParameters<double>(2, 1.0));
+  return result;
+}
+
+
+// Returns the name of the transform parameter map of the specified result.
+std::string
+GetName(const ResultType & result)
+{
+  return result.m_TransformParameterMaps.empty() ? "" : result.m_TransformParameterMaps.front().at("Name").front();
+}
+
+
+// Returns the TransformParameters of the specified transform parameter file.
+std::vector<double>
+ReadTransformParameters(const std::string & fileName)
+{
+  const auto parameterObject = elx::ParameterObject::New();
+  parameterObject->ReadParameterFile(fileName);
+  return GetTransformParametersFromMaps(parameterObject->GetParameterMap());
+}
+
+
+// Writes the specified content to the specified file.
+void
+WriteFile(const std::string & fileName, const std::string & content)
+{
+  std::ofstream file(fileName, std::ios::binary);
+  file << content;
+}
+
+
+// Returns a new (empty) output directory of the specified test, with a trailing slash.
+std::string
+MakeOutputDirectory(const std::string & testName)
+{
+  const std::string outputDirectory = GetCurrentBinaryDirectoryPath() + "/" + testName + "/";
+  itksys::SystemTools::RemoveADirectory(outputDirectory);
+  itksys::SystemTools::MakeDirectory(outputDirectory);
+  EXPECT_TRUE(itksys::SystemTools::FileIsDirectory(outputDirectory));
+  return outputDirectory;
+}
+
+
+// Creates the images of the translation tests of itkElastixRegistrationMethodGTest.
+void
+CreateTranslatedImages(ImageType::Pointer & fixedImage, ImageType::Pointer & movingImage)
+{
+  using SizeType = itk::Size<ImageDimension>;
+  using IndexType = itk::Index<ImageDimension>;
+  using OffsetType = itk::Offset<ImageDimension>;
+
+  const OffsetType translationOffset{ { 1, -2 } };
+  const auto       regionSize = SizeType::Filled(2);
+  const SizeType   imageSize{ { 5, 6 } };
+  const IndexType  fixedImageRegionIndex{ { 1, 3 } };
+
+  fixedImage = ImageType::New();
+  fixedImage->SetRegions(imageSize);
+  fixedImage->Allocate(true);
+  FillImageRegion(*fixedImage, fixedImageRegionIndex, regionSize);
+
+  movingImage = ImageType::New();
+  movingImage->SetRegions(imageSize);
+  movingImage->Allocate(true);
+  FillImageRegion(*movingImage, fixedImageRegionIndex + translationOffset, regionSize);
+}
+
+
+// Runs a translation registration with the specified cache, and returns the registration method.
+itk::SmartPointer<RegistrationMethodType>
+RunRegistration(ImageType &         fixedImage,
+                ImageType &         movingImage,
+                CacheType &         cache,
+                const std::string & outputDirectory,
+                const std::string & initialTransformParameterFileName = "",
+                const std::string & fixedPointSetFileName = "")
+{
+  const auto filter = CheckNew<RegistrationMethodType>();
+  filter->SetFixedImage(&fixedImage);
+  filter->SetMovingImage(&movingImage);
+  filter->SetOutputDirectory(outputDirectory);
+  filter->SetInitialTransformParameterFileName(initialTransformParameterFileName);
+  filter->SetFixedPointSetFileName(fixedPointSetFileName);
+  filter->SetResultCache(&cache);
+  filter->SetParameterObject(CreateParameterObject({ // Parameters in alphabetic order:
+                                                     { "ImageSampler", "Full" },
+                                                     { "MaximumNumberOfIterations", "2" },
+                                                     { "Metric", "AdvancedNormalizedCorrelation" },
+                                                     { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                     { "Transform", "TranslationTransform" } }));
+  filter->Update();
+  return filter;
+}
+
+} // namespace
+
+
+// Tests that a lookup of a key that was added gives an exact match, and a lookup of another key a miss.
+GTEST_TEST(RegistrationResultCache, ExactMatch)
+{
+  const auto cache = CheckNew<CacheType>();
+  cache->AddResult(MakeKey("fixed", "moving", "parameters", { 0.0, 1.0 }), MakeResult("A"));
+  EXPECT_EQ(cache->GetNumberOfEntries(), 1);
+
+  ResultType result;
+  double     difference = -1.0;
+  EXPECT_EQ(cache->FindResult(MakeKey("fixed", "moving", "parameters", { 0.0, 1.0 }), true, result, difference),
+            CacheType::ExactMatch);
+  EXPECT_EQ(GetName(result), "A");
+  EXPECT_EQ(difference, 0.0);
+
+  // Any other hash is a different registration, and the moving images differ too much for a near match.
+  for (const auto & key : { MakeKey("other", "moving", "parameters", { 0.0, 1.0 }),
+                            MakeKey("fixed", "other", "parameters", { 5.0, 6.0 }),
+                            MakeKey("fixed", "moving", "other", { 0.0, 1.0 }) })
+  {
+    EXPECT_EQ(cache->FindResult(key, true, result, difference), CacheType::NoMatch);
+  }
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 1);
+  EXPECT_EQ(cache->GetNumberOfNearMatches(), 0);
+  EXPECT_EQ(cache->GetNumberOfMisses(), 3);
+
+  // Adding the same registration again replaces its result.
+  cache->AddResult(MakeKey("fixed", "moving", "parameters", { 0.0, 1.0 }), MakeResult("B"));
+  EXPECT_EQ(cache->GetNumberOfEntries(), 1);
+  EXPECT_EQ(cache->FindResult(MakeKey("fixed", "moving", "parameters", { 0.0, 1.0 }), true, result, difference),
+            CacheType::ExactMatch);
+  EXPECT_EQ(GetName(result), "B");
+}
+
+
+// Tests the near matches of moving images of which the signature differs by less and by more than the tolerance.
+GTEST_TEST(RegistrationResultCache, NearMatch)
+{
+  const auto cache = CheckNew<CacheType>();
+  cache->SetSimilarityTolerance(0.05);
+  cache->AddResult(MakeKey("fixed", "moving", "parameters", { 0.0, 10.0, 20.0, 30.0 }), MakeResult("A"));
+  cache->AddResult(MakeKey("fixed", "moving2", "parameters", { 0.0, 10.0, 20.0, 33.0 }), MakeResult("B"));
+
+  ResultType result;
+  double     difference = -1.0;
+
+  // The RMS difference relative to the range of the cached signature is 0.5 / 30 with A, and 1 / 33 with B.
+  const KeyType withinTolerance = MakeKey("fixed", "moving3", "parameters", { 0.0, 10.0, 20.0, 31.0 });
+  EXPECT_EQ(cache->FindResult(withinTolerance, true, result, difference), CacheType::NearMatch);
+  EXPECT_EQ(GetName(result), "A");
+  EXPECT_NEAR(difference, 1.0 / 60.0, 1e-12);
+  EXPECT_EQ(result.m_FinalParameters.size(), 1);
+
+  // Without near matches, or with a different fixed image or parameter maps, there is no match.
+  EXPECT_EQ(cache->FindResult(withinTolerance, false, result, difference), CacheType::NoMatch);
+  EXPECT_EQ(cache->FindResult(MakeKey("other", "moving3", "parameters", { 0.0, 10.0, 20.0, 31.0 }),
+                              true,
+                              result,
+                              difference),
+            CacheType::NoMatch);
+  EXPECT_EQ(
+    cache->FindResult(MakeKey("fixed", "moving3", "other", { 0.0, 10.0, 20.0, 31.0 }), true, result, difference),
+    CacheType::NoMatch);
+
+  // A relative RMS difference of 2 / 30 with A, beyond the tolerance, and 0.5 / 33 with B.
+  EXPECT_EQ(
+    cache->FindResult(MakeKey("fixed", "moving4", "parameters", { 0.0, 10.0, 20.0, 34.0 }), true, result, difference),
+    CacheType::NearMatch);
+  EXPECT_EQ(GetName(result), "B");
+
+  // Beyond the tolerance of both: a relative RMS difference of 5 / 30 with A, and 3.5 / 33 with B.
+  EXPECT_EQ(
+    cache->FindResult(MakeKey("fixed", "moving5", "parameters", { 0.0, 10.0, 20.0, 40.0 }), true, result, difference),
+    CacheType::NoMatch);
+
+  // A zero tolerance disables the near matches.
+  cache->SetSimilarityTolerance(0.0);
+  EXPECT_EQ(cache->FindResult(withinTolerance, true, result, difference), CacheType::NoMatch);
+
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 0);
+  EXPECT_EQ(cache->GetNumberOfNearMatches(), 2);
+  EXPECT_EQ(cache->GetNumberOfMisses(), 5);
+}
+
+
+// Tests that the least recently used entry is evicted when the number of entries exceeds the maximum.
+GTEST_TEST(RegistrationResultCache, LeastRecentlyUsedEviction)
+{
+  const auto cache = CheckNew<CacheType>();
+  cache->SetMaximumNumberOfEntries(2);
+
+  const KeyType keyA = MakeKey("fixed", "A", "parameters", { 0.0 });
+  const KeyType keyB = MakeKey("fixed", "B", "parameters", { 100.0 });
+  const KeyType keyC = MakeKey("fixed", "C", "parameters", { 200.0 });
+  cache->AddResult(keyA, MakeResult("A"));
+  cache->AddResult(keyB, MakeResult("B"));
+
+  // Using A makes B the least recently used entry.
+  ResultType result;
+  double     difference = -1.0;
+  EXPECT_EQ(cache->FindResult(keyA, false, result, difference), CacheType::ExactMatch);
+
+  cache->AddResult(keyC, MakeResult("C"));
+  EXPECT_EQ(cache->GetNumberOfEntries(), 2);
+  EXPECT_EQ(cache->FindResult(keyB, false, result, difference), CacheType::NoMatch);
+  EXPECT_EQ(cache->FindResult(keyA, false, result, difference), CacheType::ExactMatch);
+  EXPECT_EQ(GetName(result), "A");
+  EXPECT_EQ(cache->FindResult(keyC, false, result, difference), CacheType::ExactMatch);
+  EXPECT_EQ(GetName(result), "C");
+
+  // Now A is the least recently used entry.
+  cache->AddResult(keyB, MakeResult("B"));
+  EXPECT_EQ(cache->FindResult(keyA, false, result, difference), CacheType::NoMatch);
+  EXPECT_EQ(cache->FindResult(keyC, false, result, difference), CacheType::ExactMatch);
+
+  cache->Clear();
+  EXPECT_EQ(cache->GetNumberOfEntries(), 0);
+}
+
+
+// Tests that an exact match of a registration writes its TransformParameters file, and returns a copy of the image.
+GTEST_TEST(RegistrationResultCache, RegistrationMethodExactMatch)
+{
+  ImageType::Pointer fixedImage;
+  ImageType::Pointer movingImage;
+  CreateTranslatedImages(fixedImage, movingImage);
+
+  const std::string outputDirectory = MakeOutputDirectory("RegistrationResultCacheExactMatch");
+  const std::string transformParameterFileName = outputDirectory + "TransformParameters.0.txt";
+  const auto        cache = CheckNew<CacheType>();
+
+  const auto filter1 = RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+  EXPECT_EQ(cache->GetNumberOfMisses(), 1);
+  EXPECT_EQ(cache->GetNumberOfEntries(), 1);
+  const std::vector<double> transformParameters = ReadTransformParameters(transformParameterFileName);
+  EXPECT_TRUE(itksys::SystemTools::RemoveFile(transformParameterFileName));
+
+  const auto filter2 = RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 1);
+  ASSERT_TRUE(itksys::SystemTools::FileExists(transformParameterFileName));
+  const std::vector<double> cachedTransformParameters = ReadTransformParameters(transformParameterFileName);
+  ASSERT_EQ(cachedTransformParameters.size(), transformParameters.size());
+  for (std::size_t i = 0; i < transformParameters.size(); ++i)
+  {
+    EXPECT_NEAR(cachedTransformParameters[i], transformParameters[i], 1e-6);
+  }
+  EXPECT_EQ(GetTransformParametersFromFilter(*filter2), GetTransformParametersFromFilter(*filter1));
+  EXPECT_EQ(ConvertToOffset<ImageDimension>(GetTransformParametersFromFilter(*filter2)),
+            (itk::Offset<ImageDimension>{ { 1, -2 } }));
+
+  // The result image is a copy, equal to the result of the registration.
+  auto &             output1 = Deref(filter1->GetOutput());
+  auto &             output2 = Deref(filter2->GetOutput());
+  const auto &       imageSize = fixedImage->GetBufferedRegion().GetSize();
+  const auto * const outputBufferPointer2 = output2.GetBufferPointer();
+  ASSERT_EQ(output2.GetBufferedRegion().GetSize(), imageSize);
+  ASSERT_NE(outputBufferPointer2, nullptr);
+  EXPECT_NE(outputBufferPointer2, output1.GetBufferPointer());
+  for (const auto index : itk::ZeroBasedIndexRange<ImageDimension>(imageSize))
+  {
+    EXPECT_EQ(output2.GetPixel(index), output1.GetPixel(index));
+  }
+
+  // Modifying the output in place does not affect the cached result.
+  output2.FillBuffer(-1.0f);
+  const auto filter3 = RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 2);
+  auto & output3 = Deref(filter3->GetOutput());
+  EXPECT_NE(output3.GetBufferPointer(), outputBufferPointer2);
+  for (const auto index : itk::ZeroBasedIndexRange<ImageDimension>(imageSize))
+  {
+    EXPECT_EQ(output3.GetPixel(index), output1.GetPixel(index));
+  }
+}
+
+
+// Tests that a registration of slightly different moving images is a near match, and of different ones a miss.
+GTEST_TEST(RegistrationResultCache, RegistrationMethodNearMatch)
+{
+  ImageType::Pointer fixedImage;
+  ImageType::Pointer movingImage;
+  CreateTranslatedImages(fixedImage, movingImage);
+
+  const std::string outputDirectory = MakeOutputDirectory("RegistrationResultCacheNearMatch");
+  const auto        cache = CheckNew<CacheType>();
+  RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+
+  // One pixel of 30 changes by 0.1 of the range: a relative RMS difference of about 0.018.
+  const itk::Index<ImageDimension> backgroundIndex{ { 4, 5 } };
+  ASSERT_EQ(movingImage->GetPixel(backgroundIndex), 0.0f);
+  movingImage->SetPixel(backgroundIndex, 0.1f);
+  const auto filter = RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+  EXPECT_EQ(cache->GetNumberOfNearMatches(), 1);
+  EXPECT_EQ(ConvertToOffset<ImageDimension>(GetTransformParametersFromFilter(*filter)),
+            (itk::Offset<ImageDimension>{ { 1, -2 } }));
+
+  // One pixel of 30 changes by the range: a relative RMS difference of about 0.18, beyond the tolerance.
+  movingImage->SetPixel(backgroundIndex, 1.0f);
+  const auto numberOfMisses = cache->GetNumberOfMisses();
+  RunRegistration(*fixedImage, *movingImage, *cache, outputDirectory);
+  EXPECT_EQ(cache->GetNumberOfNearMatches(), 1);
+  EXPECT_EQ(cache->GetNumberOfMisses(), numberOfMisses + 1);
+}
+
+
+// Tests that the key of a registration changes when the content of its initial transform file or fixed point set
+// file changes, while its name stays the same.
+GTEST_TEST(RegistrationResultCache, RegistrationMethodFileContent)
+{
+  ImageType::Pointer fixedImage;
+  ImageType::Pointer movingImage;
+  CreateTranslatedImages(fixedImage, movingImage);
+
+  const std::string outputDirectory = MakeOutputDirectory("RegistrationResultCacheFileContent");
+  const std::string initialTransformParameterFileName = outputDirectory + "InitialTransformParameters.txt";
+  const std::string fixedPointSetFileName = outputDirectory + "FixedPoints.txt";
+  const std::string initialTransform = "(NumberOfParameters 2)\n(Transform \"TranslationTransform\")\n";
+  WriteFile(initialTransformParameterFileName, initialTransform + "(TransformParameters 1 -2)\n");
+  WriteFile(fixedPointSetFileName, "point\n1\n1.0 3.0\n");
+
+  // No near matches, so that every change of the key is a miss.
+  const auto cache = CheckNew<CacheType>();
+  cache->SetSimilarityTolerance(0.0);
+  const auto runRegistration = [&] {
+    RunRegistration(
+      *fixedImage, *movingImage, *cache, outputDirectory, initialTransformParameterFileName, fixedPointSetFileName);
+  };
+
+  runRegistration();
+  runRegistration();
+  EXPECT_EQ(cache->GetNumberOfMisses(), 1);
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 1);
+
+  WriteFile(initialTransformParameterFileName, initialTransform + "(TransformParameters 0 -1)\n");
+  runRegistration();
+  EXPECT_EQ(cache->GetNumberOfMisses(), 2);
+  runRegistration();
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 2);
+
+  WriteFile(fixedPointSetFileName, "point\n1\n2.0 3.0\n");
+  runRegistration();
+  EXPECT_EQ(cache->GetNumberOfMisses(), 3);
+  runRegistration();
+  EXPECT_EQ(cache->GetNumberOfExactMatches(), 3);
+  EXPECT_EQ(cache->GetNumberOfEntries(), 3);
+}
@@ -25,6 +25,7 @@
 // ITK header file:
 #include <itkImage.h>
 #include <itkIndexRange.h>
+#include <itksys/SystemTools.hxx>
 
 // GoogleTest header file:
 #include <gtest/gtest.h>
@@ -33,6 +34,7 @@
 #include <map>
 #include <string>
 #include <utility> // For pair
+#include <vector>
 
 
 // Using-declarations:
@@ -42,8 +44,10 @@ using elx::CoreMainGTestUtilities::CreateParameterObject;
 using elx::CoreMainGTestUtilities::Deref;
 using elx::CoreMainGTestUtilities::FillImageRegion;
 using elx::CoreMainGTestUtilities::Front;
+using elx::CoreMainGTestUtilities::GetCurrentBinaryDirectoryPath;
 using elx::CoreMainGTestUtilities::GetDataDirectoryPath;
 using elx::CoreMainGTestUtilities::GetTransformParametersFromFilter;
+using elx::CoreMainGTestUtilities::GetTransformParametersFromMaps;
 
 
 // Tests registering two small (5x6) binary images, which are translated with respect to each other.
@@ -392,3 +396,104 @@ GTEST_TEST(itkElastixRegistrationMethod, InitialTransformParameterFileLinkToTran
     }
   }
 }
+
+
+// Tests registering a batch of two moving images, one after the other and concurrently. Each registration of the
+// batch must give the same result as a single registration of its moving image, in a subdirectory of its own.
+GTEST_TEST(itkElastixRegistrationMethod, BatchMovingImages)
+{
+  constexpr auto ImageDimension = 2U;
+  using ImageType = itk::Image<float, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+  using IndexType = itk::Index<ImageDimension>;
+  using OffsetType = itk::Offset<ImageDimension>;
+  using RegistrationMethodType = itk::ElastixRegistrationMethod<ImageType, ImageType>;
+
+  const OffsetType translationOffsets[] = { { { 1, -2 } }, { { 2, 0 } }, { { -1, 1 } } };
+  const auto       regionSize = SizeType::Filled(2);
+  const SizeType   imageSize{ { 5, 6 } };
+  const IndexType  fixedImageRegionIndex{ { 1, 3 } };
+
+  const auto fixedImage = ImageType::New();
+  fixedImage->SetRegions(imageSize);
+  fixedImage->Allocate(true);
+  FillImageRegion(*fixedImage, fixedImageRegionIndex, regionSize);
+
+  std::vector<ImageType::Pointer> movingImages;
+  for (const auto & translationOffset : translationOffsets)
+  {
+    const auto movingImage = ImageType::New();
+    movingImage->SetRegions(imageSize);
+    movingImage->Allocate(true);
+    FillImageRegion(*movingImage, fixedImageRegionIndex + translationOffset, regionSize);
+    movingImages.push_back(movingImage);
+  }
+
+  // A single thread for each registration, so that the results do not depend on the division of the threads.
+  const auto createFilter = [fixedImage](ImageType & movingImage) {
+    const auto filter = CheckNew<RegistrationMethodType>();
+    filter->SetFixedImage(fixedImage);
+    filter->SetMovingImage(&movingImage);
+    filter->SetNumberOfThreads(1);
+    filter->SetParameterObject(CreateParameterObject({ // Parameters in alphabetic order:
+                                                       { "ImageSampler", "Full" },
+                                                       { "MaximumNumberOfIterations", "2" },
+                                                       { "Metric", "AdvancedNormalizedCorrelation" },
+                                                       { "Optimizer", "AdaptiveStochasticGradientDescent" },
+                                                       { "Transform", "TranslationTransform" },
+                                                       { "WriteResultImage", "true" } }));
+    return filter;
+  };
+
+  // The results of the single registrations of the moving images of the batch.
+  std::vector<std::vector<double>> expectedTransformParameters;
+  std::vector<ImageType::Pointer>  expectedOutputs;
+  for (unsigned int i = 1; i < movingImages.size(); ++i)
+  {
+    const auto filter = createFilter(*movingImages[i]);
+    filter->Update();
+    expectedTransformParameters.push_back(GetTransformParametersFromFilter(*filter));
+    expectedOutputs.push_back(filter->GetOutput());
+  }
+
+  for (const unsigned int numberOfConcurrentRegistrations : { 1U, 2U })
+  {
+    const std::string outputDirectory = GetCurrentBinaryDirectoryPath() + "/itkElastixRegistrationMethod.Batch" +
+                                        std::to_string(numberOfConcurrentRegistrations) + "/";
+    itksys::SystemTools::RemoveADirectory(outputDirectory);
+    itksys::SystemTools::MakeDirectory(outputDirectory);
+
+    const auto filter = createFilter(*movingImages.front());
+    filter->SetOutputDirectory(outputDirectory);
+    filter->SetNumberOfConcurrentRegistrations(numberOfConcurrentRegistrations);
+    for (unsigned int i = 1; i < movingImages.size(); ++i)
+    {
+      filter->AddBatchMovingImage(movingImages[i]);
+    }
+    filter->Update();
+
+    EXPECT_EQ(ConvertToOffset<ImageDimension>(GetTransformParametersFromFilter(*filter)), translationOffsets[0]);
+    EXPECT_TRUE(itksys::SystemTools::FileExists(outputDirectory + "TransformParameters.0.txt"));
+
+    for (unsigned int i = 0; i < expectedOutputs.size(); ++i)
+    {
+      const auto transformParameters =
+        GetTransformParametersFromMaps(Deref(filter->GetBatchTransformParameterObject(i)).GetParameterMap());
+      ASSERT_EQ(transformParameters.size(), expectedTransformParameters[i].size());
+      for (unsigned int j = 0; j < transformParameters.size(); ++j)
+      {
+        EXPECT_NEAR(transformParameters[j], expectedTransformParameters[i][j], 1e-6);
+      }
+
+      const auto & output = Deref(filter->GetBatchOutput(i));
+      ASSERT_EQ(output.GetBufferedRegion().GetSize(), imageSize);
+      for (const auto index : itk::ZeroBasedIndexRange<ImageDimension>(imageSize))
+      {
+        EXPECT_NEAR(output.GetPixel(index), expectedOutputs[i]->GetPixel(index), 1e-4);
+      }
+
+      const std::string batchDirectory = outputDirectory + "batch" + std::to_string(i) + "/";
+      EXPECT_TRUE(itksys::SystemTools::FileExists(batchDirectory + "TransformParameters.0.txt"));
+    }
+  }
+}
@@ -480,3 +480,41 @@ GTEST_TEST(itkTransformixFilter, ITKBSplineTransform3D)
   Expect_TransformixFilter_output_equals_ResampleImageFilter_output(
     *CreateImageFilledWithSequenceOfNaturalNumbers<float>(imageSize), *itkTransform);
 }
+
+
+// Tests that each of multiple moving images is resampled as if it were the only moving image.
+GTEST_TEST(itkTransformixFilter, MultipleMovingImages)
+{
+  constexpr auto ImageDimension = 2U;
+  using ImageType = itk::Image<float, ImageDimension>;
+
+  const itk::Offset<ImageDimension> translationOffset{ { 1, -2 } };
+  const auto                        imageSize = MakeSize(5, 6);
+  const auto                        firstMovingImage = CreateImageFilledWithSequenceOfNaturalNumbers<float>(imageSize);
+  const auto                        secondMovingImage = ImageType::New();
+  secondMovingImage->SetRegions(imageSize);
+  secondMovingImage->Allocate(true);
+  FillImageRegion(*secondMovingImage, itk::Index<ImageDimension>{ { 2, 1 } }, MakeSize(2, 2));
+
+  const auto filter = itk::TransformixFilter<ImageType>::New();
+  filter->AddMovingImage(firstMovingImage);
+  filter->AddMovingImage(secondMovingImage);
+  EXPECT_EQ(filter->GetNumberOfMovingImages(), 2U);
+
+  filter->SetTransformParameterObject(
+    CreateParameterObject({ // Parameters in alphabetic order:
+                            { "Direction", CreateDefaultDirectionParameterValues<ImageDimension>() },
+                            { "Index", ParameterValuesType(ImageDimension, "0") },
+                            { "NumberOfParameters", { std::to_string(ImageDimension) } },
+                            { "Origin", ParameterValuesType(ImageDimension, "0") },
+                            { "ResampleInterpolator", { "FinalLinearInterpolator" } },
+                            { "Size", ConvertToParameterValues(imageSize) },
+                            { "Transform", ParameterValuesType{ "TranslationTransform" } },
+                            { "TransformParameters", ConvertToParameterValues(translationOffset) },
+                            { "Spacing", ParameterValuesType(ImageDimension, "1") } }));
+  filter->Update();
+
+  EXPECT_EQ(filter->GetResultImage(0), filter->GetOutput());
+  ExpectEqualImages(Deref(filter->GetResultImage(0)), *TranslateImage(*firstMovingImage, translationOffset));
+  ExpectEqualImages(Deref(filter->GetResultImage(1)), *TranslateImage(*secondMovingImage, translationOffset));
+}
@@ -22,97 +22,61 @@
 #include "elxElastixMain.h"
 #include <Core/elxVersionMacros.h>
 #include "itkUseMevisDicomTiff.h"
+#include "itkProcessGroup.h"
 
 // ITK header files:
+#include <itkMultiThreaderBase.h>
 #include <itkTimeProbe.h>
 #include <itksys/SystemInformation.hxx>
 #include <itksys/SystemTools.hxx>
 
 // Standard C++ header files:
+#include <algorithm> // For find, min and max.
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <climits> // For UINT_MAX.
 #include <cstddef> // For size_t.
+#include <cstdlib> // For atoi.
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <string>
+#include <thread>
+#include <utility> // For pair.
 #include <vector>
 
+
+namespace
+{
+/** Some typedef's. */
+typedef elx::ElastixMain                            ElastixMainType;
+typedef ElastixMainType::ObjectPointer              ObjectPointer;
+typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
+typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
+
+typedef ElastixMainType::ArgumentMapType ArgumentMapType;
+typedef ArgumentMapType::value_type      ArgumentMapEntryType;
+
+/** Runs elastix with the specified command line arguments (argv[1], argv[2], ...). In batch mode,
+ * elastix only writes to the log file in the output directory, and not to the standard output.
+ * Returns the error code of elastix, which is zero on success.
+ */
 int
-main(int argc, char ** argv)
+RunElastix(const std::vector<std::string> & arguments, const std::string & argv0, const bool batchMode)
 {
-  elastix::BaseComponent::InitializeElastixExecutable();
-  assert(!elastix::BaseComponent::IsElastixLibrary());
-
-  /** Check if "--help" or "--version" was asked for. */
-  if (argc == 1)
-  {
-    std::cout << "Use \"elastix --help\" for information about elastix-usage." << std::endl;
-    return 0;
-  }
-  else if (argc == 2)
-  {
-    std::string argument(argv[1]);
-    if (argument == "-help" || argument == "--help" || argument == "-h")
-    {
-      PrintHelp();
-      return 0;
-    }
-    else if (argument == "--version")
-    {
-      std::cout << "elastix version: " ELASTIX_VERSION_STRING << std::endl;
-      return 0;
-    }
-    else if (argument == "--extended-version")
-    {
-      std::cout << "elastix version: " ELASTIX_VERSION_STRING << "\nITK version: " << ITK_VERSION_MAJOR << '.'
-                << ITK_VERSION_MINOR << '.' << ITK_VERSION_PATCH << "\nBuild date: " << __DATE__ << ' ' << __TIME__
-#ifdef _MSC_FULL_VER
-                << "\nCompiler: Visual C++ version " << _MSC_FULL_VER << '.' << _MSC_BUILD
-#endif
-#ifdef __clang__
-                << "\nCompiler: Clang"
-#  ifdef __VERSION__
-                << " version " << __VERSION__
-#  endif
-#endif
-#if defined(__GNUC__)
-                << "\nCompiler: GCC"
-#  ifdef __VERSION__
-                << " version " << __VERSION__
-#  endif
-#endif
-                << "\nMemory address size: " << std::numeric_limits<std::size_t>::digits << "-bit"
-                << "\nCMake version: " << ELX_CMAKE_VERSION << std::endl;
-      return 0;
-    }
-    else
-    {
-      std::cout << "Use \"elastix --help\" for information about elastix-usage." << std::endl;
-      return 0;
-    }
-  }
-
-  /** Some typedef's. */
-  typedef elx::ElastixMain                            ElastixMainType;
-  typedef ElastixMainType::ObjectPointer              ObjectPointer;
-  typedef ElastixMainType::DataObjectContainerPointer DataObjectContainerPointer;
-  typedef ElastixMainType::FlatDirectionCosinesType   FlatDirectionCosinesType;
-
-  typedef ElastixMainType::ArgumentMapType ArgumentMapType;
-  typedef ArgumentMapType::value_type      ArgumentMapEntryType;
-
-  /** Support Mevis Dicom Tiff (if selected in cmake) */
-  RegisterMevisDicomTiff();
-
   ArgumentMapType         argMap;
   std::queue<std::string> parameterFileList;
   std::string             outFolder;
 
   /** Put command line parameters into parameterFileList. */
-  for (unsigned int i = 1; static_cast<long>(i) < (argc - 1); i += 2)
+  for (std::size_t i = 0; i + 1 < arguments.size(); i += 2)
   {
-    std::string key(argv[i]);
-    std::string value(argv[i + 1]);
+    std::string key(arguments[i]);
+    std::string value(arguments[i + 1]);
 
     if (key == "-p")
     {
@@ -160,7 +124,7 @@ main(int argc, char ** argv)
   } // end for loop
 
   /** The argv0 argument, required for finding the component.dll/so's. */
-  argMap.insert(ArgumentMapEntryType("-argv0", argv[0]));
+  argMap.insert(ArgumentMapEntryType("-argv0", argv0));
 
   int returndummy{};
 
@@ -171,7 +135,10 @@ main(int argc, char ** argv)
     returndummy |= -1;
   }
 
-  /** Check if the -out option is given. */
+  /** Check if the -out option is given. In batch mode, each pair has its own log, which is set up
+   * for the thread that runs the pair, see elx::xoutManager.
+   */
+  const std::unique_ptr<const elx::xoutManager> manager(batchMode ? new elx::xoutManager() : nullptr);
   if (!outFolder.empty())
   {
     /** Check if the output directory exists. */
@@ -183,9 +150,19 @@ main(int argc, char ** argv)
     }
     else
     {
+      /** The other processes of a distributed registration write into their own subdirectory. */
+      const unsigned int rank = itk::ProcessGroup::GetRank();
+      if (rank > 0)
+      {
+        outFolder += "rank" + std::to_string(rank);
+        itksys::SystemTools::MakeDirectory(outFolder);
+        outFolder = elx::Conversion::ToNativePathNameSeparators(outFolder + "/");
+        argMap["-out"] = outFolder;
+      }
+
       /** Setup xout. */
       const std::string logFileName = outFolder + "elastix.log";
-      const int         returndummy2{ elx::xoutSetup(logFileName.c_str(), true, true) };
+      const int         returndummy2{ elx::xoutSetup(logFileName.c_str(), true, !batchMode) };
       if (returndummy2 != 0)
       {
         std::cerr << "ERROR while setting up xout." << std::endl;
@@ -213,7 +190,7 @@ main(int argc, char ** argv)
   elxout << "elastix is started at " << GetCurrentDateAndTime() << ".\n" << std::endl;
 
   /** Print where elastix was run. */
-  elxout << "which elastix:   " << argv[0] << std::endl;
+  elxout << "which elastix:   " << argv0 << std::endl;
   itksys::SystemInformation info;
   info.RunCPUCheck();
   info.RunOSCheck();
@@ -241,6 +218,9 @@ main(int argc, char ** argv)
   const auto nrOfParameterFiles = parameterFileList.size();
   assert(nrOfParameterFiles <= UINT_MAX);
 
+  /** The registrations of the chain share one dictionary, see ElastixBase::SetChainDictionary(). */
+  const auto chainDictionary = std::make_shared<itk::MetaDataDictionary>();
+
   for (unsigned i{}; i < static_cast<unsigned>(nrOfParameterFiles); ++i)
   {
     /** Create another instance of ElastixMain. */
@@ -248,6 +228,7 @@ main(int argc, char ** argv)
 
     /** Set stuff we get from a former registration. */
     elastixMain->SetInitialTransform(transform);
+    elastixMain->SetChainDictionary(chainDictionary);
     elastixMain->SetFixedImageContainer(fixedImageContainer);
     elastixMain->SetMovingImageContainer(movingImageContainer);
     elastixMain->SetFixedMaskContainer(fixedMaskContainer);
@@ -330,6 +311,397 @@ main(int argc, char ** argv)
   /** Exit and return the error code. */
   return 0;
 
+} // end RunElastix()
+
+
+/** Splits a line of a batch manifest into its fields, which are separated by commas. Leading and
+ * trailing white space of a field is removed. A field that contains a comma, like a file name, can
+ * be put between double quotes.
+ */
+std::vector<std::string>
+SplitManifestLine(const std::string & line)
+{
+  std::vector<std::string> fields;
+  std::string              field;
+  bool                     inQuotes = false;
+
+  const auto addField = [&fields, &field] {
+    const auto first = field.find_first_not_of(" \t\r");
+    const auto last = field.find_last_not_of(" \t\r");
+    fields.push_back(first == std::string::npos ? std::string() : field.substr(first, last - first + 1));
+    field.clear();
+  };
+
+  for (const char c : line)
+  {
+    if (c == '"')
+    {
+      inQuotes = !inQuotes;
+    }
+    else if (c == ',' && !inQuotes)
+    {
+      addField();
+    }
+    else
+    {
+      field.push_back(c);
+    }
+  }
+  addField();
+  return fields;
+
+} // end SplitManifestLine()
+
+
+/** Runs elastix for each pair of images of a batch manifest, in one process. The manifest is a
+ * comma separated file, of which the first line has the names of the command line options of the
+ * columns, without the dash, e.g. "f,m,fMask,mMask,out". Each following line has the arguments of
+ * a pair; an empty field omits the option for that pair. Lines that start with '#' are skipped.
+ * The arguments of the pairs replace the command line arguments of the batch with the same option,
+ * and the other command line arguments, like "-p", apply to all pairs.
+ *
+ * The number of pairs given by "-batchpairs" run concurrently, each in its own thread, with an
+ * equal share of the number of threads given by "-threads". The parsed parameter files and the
+ * OpenCL context are shared by the pairs. The error code and the wall time of each pair are
+ * written to the summary file given by "-batchsummary", by default the name of the manifest with
+ * ".summary.csv" appended. Returns the error code of the first pair that failed, or zero.
+ */
+int
+RunElastixBatch(const std::vector<std::string> & arguments, const std::string & argv0)
+{
+  /** Separate the options of the batch from the arguments of all pairs. */
+  std::string                                      manifestFileName;
+  std::string                                      summaryFileName;
+  unsigned int                                     numberOfConcurrentPairs = 1;
+  unsigned int                                     numberOfThreads = 0;
+  std::vector<std::pair<std::string, std::string>> commonArguments;
+
+  for (std::size_t i = 0; i + 1 < arguments.size(); i += 2)
+  {
+    const std::string & key = arguments[i];
+    const std::string & value = arguments[i + 1];
+
+    if (key == "-batch")
+    {
+      manifestFileName = value;
+    }
+    else if (key == "-batchsummary")
+    {
+      summaryFileName = value;
+    }
+    else if (key == "-batchpairs")
+    {
+      numberOfConcurrentPairs = static_cast<unsigned int>(std::max(atoi(value.c_str()), 1));
+    }
+    else if (key == "-threads")
+    {
+      numberOfThreads = static_cast<unsigned int>(std::max(atoi(value.c_str()), 0));
+    }
+    else
+    {
+      commonArguments.emplace_back(key, value);
+    }
+  }
+  if (summaryFileName.empty())
+  {
+    summaryFileName = manifestFileName + ".summary.csv";
+  }
+
+  /** Read the manifest. */
+  std::ifstream manifest(manifestFileName);
+  if (!manifest.is_open())
+  {
+    std::cerr << "ERROR: the batch manifest \"" << manifestFileName << "\" could not be opened." << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string>              columns;
+  std::vector<std::vector<std::string>> pairs;
+  std::string                           line;
+  unsigned int                          lineNumber = 0;
+  while (std::getline(manifest, line))
+  {
+    ++lineNumber;
+    const auto firstCharacter = line.find_first_not_of(" \t\r");
+    if (firstCharacter == std::string::npos || line[firstCharacter] == '#')
+    {
+      continue;
+    }
+
+    const std::vector<std::string> fields = SplitManifestLine(line);
+    if (columns.empty())
+    {
+      columns = fields;
+      if (std::find(columns.begin(), columns.end(), std::string()) != columns.end())
+      {
+        std::cerr << "ERROR: the header of the batch manifest \"" << manifestFileName << "\" has an empty column."
+                  << std::endl;
+        return -1;
+      }
+    }
+    else if (fields.size() > columns.size())
+    {
+      std::cerr << "ERROR: line " << lineNumber << " of the batch manifest \"" << manifestFileName
+                << "\" has more fields than the header." << std::endl;
+      return -1;
+    }
+    else
+    {
+      pairs.push_back(fields);
+    }
+  }
+
+  const auto outColumn = std::find(columns.begin(), columns.end(), "out") - columns.begin();
+  if (static_cast<std::size_t>(outColumn) == columns.size())
+  {
+    std::cerr << "ERROR: the batch manifest \"" << manifestFileName << "\" has no column \"out\"." << std::endl;
+    return -1;
+  }
+  if (pairs.empty())
+  {
+    std::cerr << "ERROR: the batch manifest \"" << manifestFileName << "\" has no pairs." << std::endl;
+    return -1;
+  }
+
+  /** Divide the threads over the pairs that run concurrently. */
+  numberOfConcurrentPairs = std::min<unsigned int>(numberOfConcurrentPairs, pairs.size());
+  if (numberOfThreads == 0)
+  {
+    numberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  }
+  const unsigned int numberOfThreadsPerPair = std::max(numberOfThreads / numberOfConcurrentPairs, 1u);
+  const bool         hasThreadsColumn = std::find(columns.begin(), columns.end(), "threads") != columns.end();
+
+  /** Determine the arguments and the output directory of each pair. */
+  std::vector<std::vector<std::string>> pairArguments(pairs.size());
+  std::vector<std::string>              outFolders(pairs.size());
+  for (std::size_t i = 0; i < pairs.size(); ++i)
+  {
+    for (const auto & argument : commonArguments)
+    {
+      if (std::find(columns.begin(), columns.end(), argument.first.substr(1)) == columns.end())
+      {
+        pairArguments[i].push_back(argument.first);
+        pairArguments[i].push_back(argument.second);
+      }
+    }
+    for (std::size_t j = 0; j < pairs[i].size(); ++j)
+    {
+      if (!pairs[i][j].empty())
+      {
+        pairArguments[i].push_back("-" + columns[j]);
+        pairArguments[i].push_back(pairs[i][j]);
+      }
+    }
+    if (!hasThreadsColumn)
+    {
+      pairArguments[i].push_back("-threads");
+      pairArguments[i].push_back(std::to_string(numberOfThreadsPerPair));
+    }
+    if (static_cast<std::size_t>(outColumn) < pairs[i].size())
+    {
+      outFolders[i] = pairs[i][outColumn];
+    }
+  }
+
+  std::cout << "elastix runs " << pairs.size() << " pairs of the batch manifest \"" << manifestFileName << "\", "
+            << numberOfConcurrentPairs << " at a time, with " << numberOfThreadsPerPair << " threads each."
+            << std::endl;
+
+  /** Let the registrations share the parsed parameter files and the OpenCL context. */
+  elx::Configuration::SetParameterFileCaching(true);
+  ElastixMainType::SetKeepOpenCLContext(true);
+
+  /** The error codes, and the start and wall times in seconds since the start of the batch. */
+  struct PairSummary
+  {
+    int    ErrorCode{ 0 };
+    double StartTime{ 0.0 };
+    double WallTime{ 0.0 };
+  };
+  std::vector<PairSummary> summaries(pairs.size());
+  std::atomic<std::size_t> nextPair{ 0 };
+  std::mutex               coutMutex;
+  const auto               batchStartTime = std::chrono::steady_clock::now();
+
+  /** Each worker runs the next pair that has not been started yet, until all pairs are done. */
+  const auto runPairs = [&] {
+    for (std::size_t i = nextPair++; i < pairs.size(); i = nextPair++)
+    {
+      PairSummary & summary = summaries[i];
+      const auto    startTime = std::chrono::steady_clock::now();
+      summary.StartTime = std::chrono::duration<double>(startTime - batchStartTime).count();
+
+      if (outFolders[i].empty())
+      {
+        const std::lock_guard<std::mutex> lock(coutMutex);
+        std::cerr << "ERROR: pair " << i << " of the batch manifest has no output directory." << std::endl;
+        summary.ErrorCode = -2;
+        continue;
+      }
+      itksys::SystemTools::MakeDirectory(outFolders[i]);
+
+      try
+      {
+        summary.ErrorCode = RunElastix(pairArguments[i], argv0, true);
+      }
+      catch (const std::exception & excp)
+      {
+        const std::lock_guard<std::mutex> lock(coutMutex);
+        std::cerr << "ERROR: " << excp.what() << std::endl;
+        summary.ErrorCode = 1;
+      }
+      summary.WallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+      const std::lock_guard<std::mutex> lock(coutMutex);
+      std::cout << "elastix batch: pair " << i << " (\"" << outFolders[i] << "\") finished with error code "
+                << summary.ErrorCode << " in " << ConvertSecondsToDHMS(summary.WallTime, 1) << "." << std::endl;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned int k = 1; k < numberOfConcurrentPairs; ++k)
+  {
+    workers.emplace_back(runPairs);
+  }
+  runPairs();
+  for (auto & worker : workers)
+  {
+    worker.join();
+  }
+
+  ElastixMainType::SetKeepOpenCLContext(false);
+  ElastixMainType::ReleaseOpenCLContext();
+  elx::Configuration::SetParameterFileCaching(false);
+
+  /** Write the summary, in the order of the manifest. */
+  int           errorCode = 0;
+  unsigned int  numberOfFailedPairs = 0;
+  std::ofstream summaryFile(summaryFileName);
+  summaryFile << "pair,out,errorcode,starttime,walltime\n";
+  for (std::size_t i = 0; i < pairs.size(); ++i)
+  {
+    summaryFile << i << ",\"" << outFolders[i] << "\"," << summaries[i].ErrorCode << ',' << summaries[i].StartTime
+                << ',' << summaries[i].WallTime << '\n';
+    if (summaries[i].ErrorCode != 0)
+    {
+      ++numberOfFailedPairs;
+      if (errorCode == 0)
+      {
+        errorCode = summaries[i].ErrorCode;
+      }
+    }
+  }
+  if (!summaryFile)
+  {
+    std::cerr << "ERROR: the batch summary \"" << summaryFileName << "\" could not be written." << std::endl;
+  }
+
+  const double batchWallTime =
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStartTime).count();
+  std::cout << "elastix batch: " << pairs.size() - numberOfFailedPairs << " of the " << pairs.size()
+            << " pairs finished without errors, in " << ConvertSecondsToDHMS(batchWallTime, 1)
+            << ". The summary is written to \"" << summaryFileName << "\"." << std::endl;
+
+  return errorCode;
+
+} // end RunElastixBatch()
+
+} // end unnamed namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  elastix::BaseComponent::InitializeElastixExecutable();
+  assert(!elastix::BaseComponent::IsElastixLibrary());
+
+  /** Set the priority and the CPU affinity of the process, before any other thread is created, so
+   * that these apply to all threads of the process.
+   */
+  std::string priority;
+  std::string cpuList;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (std::string(argv[i]) == "-priority")
+    {
+      priority = argv[i + 1];
+    }
+    else if (std::string(argv[i]) == "-affinity")
+    {
+      cpuList = argv[i + 1];
+    }
+  }
+  ElastixMainType::SetProcessPriorityAndAffinity(priority, cpuList);
+
+  /** Join the other processes, when started by mpiexec. */
+  const itk::ProcessGroup processGroup(argc, argv);
+
+  /** Check if "--help" or "--version" was asked for. */
+  if (argc == 1)
+  {
+    std::cout << "Use \"elastix --help\" for information about elastix-usage." << std::endl;
+    return 0;
+  }
+  else if (argc == 2)
+  {
+    std::string argument(argv[1]);
+    if (argument == "-help" || argument == "--help" || argument == "-h")
+    {
+      PrintHelp();
+      return 0;
+    }
+    else if (argument == "--version")
+    {
+      std::cout << "elastix version: " ELASTIX_VERSION_STRING << std::endl;
+      return 0;
+    }
+    else if (argument == "--extended-version")
+    {
+      std::cout << "elastix version: " ELASTIX_VERSION_STRING << "\nITK version: " << ITK_VERSION_MAJOR << '.'
+                << ITK_VERSION_MINOR << '.' << ITK_VERSION_PATCH << "\nBuild date: " << __DATE__ << ' ' << __TIME__
+#ifdef _MSC_FULL_VER
+                << "\nCompiler: Visual C++ version " << _MSC_FULL_VER << '.' << _MSC_BUILD
+#endif
+#ifdef __clang__
+                << "\nCompiler: Clang"
+#  ifdef __VERSION__
+                << " version " << __VERSION__
+#  endif
+#endif
+#if defined(__GNUC__)
+                << "\nCompiler: GCC"
+#  ifdef __VERSION__
+                << " version " << __VERSION__
+#  endif
+#endif
+                << "\nMemory address size: " << std::numeric_limits<std::size_t>::digits << "-bit"
+                << "\nCMake version: " << ELX_CMAKE_VERSION << std::endl;
+      return 0;
+    }
+    else
+    {
+      std::cout << "Use \"elastix --help\" for information about elastix-usage." << std::endl;
+      return 0;
+    }
+  }
+
+  /** Support Mevis Dicom Tiff (if selected in cmake) */
+  RegisterMevisDicomTiff();
+
+  const std::vector<std::string> arguments(argv + 1, argv + argc);
+
+  /** Run the pairs of a batch manifest, when "-batch" is given. */
+  for (std::size_t i = 0; i + 1 < arguments.size(); i += 2)
+  {
+    if (arguments[i] == "-batch")
+    {
+      return RunElastixBatch(arguments, argv[0]);
+    }
+  }
+
+  return RunElastix(arguments, argv[0], false);
+
 } // end main
 
 
@@ -365,8 +737,13 @@ PrintHelp(void)
             << "  -mp       point set for moving image\n"
             << "  -t0       parameter file for initial transform\n"
             << "  -priority set the process priority to high, abovenormal, normal (default),\n"
-            << "            belownormal, or idle (Windows only option)\n"
-            << "  -threads  set the maximum number of threads of elastix\n\n";
+            << "            belownormal, or idle\n"
+            << "  -affinity limit elastix to a list of CPUs, e.g. \"0-3,8\" (Linux only option)\n"
+            << "  -threads  set the maximum number of threads of elastix\n"
+            << "  -resume   checkpoint file to resume an interrupted registration from\n"
+            << "  -batch    manifest of the pairs of images to register in one process, see below\n"
+            << "  -batchpairs    the number of pairs of a batch that run concurrently, default 1\n"
+            << "  -batchsummary  the file to write the error code and time of each pair of a batch to\n\n";
 
   /** The parameter file.*/
   std::cout << "The parameter-file must contain all the information "
@@ -375,6 +752,16 @@ PrintHelp(void)
                "information specific for the metric, optimizer, transform, etc. "
                "For a usable parameter-file, see the website.\n\n";
 
+  /** The batch mode. */
+  std::cout << "With \"-batch manifest.csv\", elastix registers many pairs of images in one process. "
+               "The first line of the comma separated manifest has the command line options of its "
+               "columns, without the dash, e.g. \"f,m,fMask,mMask,out\", and each following line has "
+               "the arguments of one pair. These replace the command line arguments with the same option; "
+               "the other arguments, like \"-p\", apply to all pairs. The output directories of the pairs "
+               "are created when they do not exist. The \"-threads\" are divided over the pairs that run "
+               "concurrently. The summary is written to \"-batchsummary\", by default to the name of the "
+               "manifest with \".summary.csv\" appended.\n\n";
+
   std::cout << "Need further help? Please check:\n"
                " * the elastix website: https://elastix.lumc.nl\n"
                " * the source code repository site: https://github.com/SuperElastix/elastix\n"
@@ -251,6 +251,9 @@ ELASTIX::RegisterImages(ImagePointer                          fixedImage,
   const auto nrOfParameterFiles = parameterMaps.size();
   assert(nrOfParameterFiles <= UINT_MAX);
 
+  /** The registrations of the chain share one dictionary, see ElastixBase::SetChainDictionary(). */
+  const auto chainDictionary = std::make_shared<itk::MetaDataDictionary>();
+
   for (unsigned i{}; i < static_cast<unsigned>(nrOfParameterFiles); ++i)
   {
     /** Create another instance of ElastixMain. */
@@ -258,6 +261,7 @@ ELASTIX::RegisterImages(ImagePointer                          fixedImage,
 
     /** Set stuff we get from a former registration. */
     elastixMain->SetInitialTransform(transform);
+    elastixMain->SetChainDictionary(chainDictionary);
     elastixMain->SetFixedImageContainer(fixedImageContainer);
     elastixMain->SetMovingImageContainer(movingImageContainer);
     elastixMain->SetFixedMaskContainer(fixedMaskContainer);
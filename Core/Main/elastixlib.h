@@ -64,6 +64,10 @@ public:
    *    - itk::Image::PixelType must be the same as specified in ParameterMap
    *      ('Fixed/MovingInternalImagePixelType')
    *    - Direction cosines are taken from fixed image (always set UseDirectionCosines TRUE)
+   *    - The images are used as they are, without copying. Buffers owned by the caller can
+   *      be passed without copying by wrapping them in an image by an itk::ImportImageFilter,
+   *      with SetImportPointer(buffer, numberOfPixels, false), so that the buffer is not
+   *      released by ITK. The buffer must stay valid until RegisterImages returns.
    *  Params:
    *    fixedImage  itk::Image note type should be the same as specified in the Parameterfile
    *      FixedInternalImagePixelType and dimensions!
@@ -20,6 +20,7 @@
 
 #include <algorithm> // For find.
 #include <memory>    // For unique_ptr.
+#include <utility>   // For move.
 
 namespace elastix
 {
@@ -200,6 +201,9 @@ ElastixFilter<TFixedImage, TMovingImage>::GenerateData(void)
   const std::unique_ptr<const elx::xoutManager> manager(
     m_EnableOutput ? new elx::xoutManager(logFileName, this->GetLogToFile(), this->GetLogToConsole()) : nullptr);
 
+  // The registrations of the chain share one dictionary, see ElastixBase::SetChainDictionary()
+  const auto chainDictionary = std::make_shared<itk::MetaDataDictionary>();
+
   // Run the (possibly multiple) registration(s)
   for (unsigned int i = 0; i < parameterMapVector.size(); ++i)
   {
@@ -225,6 +229,7 @@ ElastixFilter<TFixedImage, TMovingImage>::GenerateData(void)
 
     // Set stuff we get from a previous registration
     elastix->SetInitialTransform(transform);
+    elastix->SetChainDictionary(chainDictionary);
     elastix->SetFixedImageContainer(fixedImageContainer);
     elastix->SetMovingImageContainer(movingImageContainer);
     elastix->SetFixedMaskContainer(fixedMaskContainer);
@@ -291,7 +296,7 @@ ElastixFilter<TFixedImage, TMovingImage>::GenerateData(void)
 
   // Save parameter map
   ParameterObject::Pointer transformParameterObject = ParameterObject::New();
-  transformParameterObject->SetParameterMap(transformParameterMapVector);
+  transformParameterObject->SetParameterMap(std::move(transformParameterMapVector));
   this->SetOutput("TransformParameterObject", transformParameterObject);
 }
 
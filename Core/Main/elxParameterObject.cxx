@@ -33,8 +33,7 @@ namespace elastix
 void
 ParameterObject::SetParameterMap(const ParameterMapType & parameterMap)
 {
-  ParameterMapVectorType parameterMapVector = ParameterMapVectorType(1, parameterMap);
-  this->SetParameterMap(parameterMapVector);
+  this->SetParameterMap(ParameterMapVectorType(1, parameterMap));
 }
 
 /**
@@ -44,7 +43,7 @@ ParameterObject::SetParameterMap(const ParameterMapType & parameterMap)
 void
 ParameterObject::SetParameterMap(const unsigned int & index, const ParameterMapType & parameterMap)
 {
-  this->m_ParameterMap[index] = parameterMap;
+  this->GetWritableParameterMap()[index] = parameterMap;
 }
 
 
@@ -55,9 +54,24 @@ ParameterObject::SetParameterMap(const unsigned int & index, const ParameterMapT
 void
 ParameterObject::SetParameterMap(const ParameterMapVectorType & parameterMap)
 {
-  if (this->m_ParameterMap != parameterMap)
+  if (*this->m_ParameterMap != parameterMap)
   {
-    this->m_ParameterMap = parameterMap;
+    this->m_ParameterMap = std::make_shared<ParameterMapVectorType>(parameterMap);
+    this->Modified();
+  }
+}
+
+
+/**
+ * ********************* SetParameterMap *********************
+ */
+
+void
+ParameterObject::SetParameterMap(ParameterMapVectorType && parameterMap)
+{
+  if (*this->m_ParameterMap != parameterMap)
+  {
+    this->m_ParameterMap = std::make_shared<ParameterMapVectorType>(std::move(parameterMap));
     this->Modified();
   }
 }
@@ -70,7 +84,7 @@ ParameterObject::SetParameterMap(const ParameterMapVectorType & parameterMap)
 void
 ParameterObject::AddParameterMap(const ParameterMapType & parameterMap)
 {
-  this->m_ParameterMap.push_back(parameterMap);
+  this->GetWritableParameterMap().push_back(parameterMap);
   this->Modified();
 }
 
@@ -82,7 +96,43 @@ ParameterObject::AddParameterMap(const ParameterMapType & parameterMap)
 const ParameterObject::ParameterMapType &
 ParameterObject::GetParameterMap(const unsigned int & index) const
 {
-  return this->m_ParameterMap[index];
+  return (*this->m_ParameterMap)[index];
+}
+
+
+/**
+ * ********************* Graft *********************
+ */
+
+void
+ParameterObject::Graft(const itk::DataObject * data)
+{
+  const auto * const parameterObject = dynamic_cast<const Self *>(data);
+  if (parameterObject == nullptr)
+  {
+    itkExceptionMacro("Can only graft a ParameterObject.");
+  }
+
+  if (this->m_ParameterMap != parameterObject->m_ParameterMap)
+  {
+    this->m_ParameterMap = parameterObject->m_ParameterMap;
+    this->Modified();
+  }
+}
+
+
+/**
+ * ********************* GetWritableParameterMap *********************
+ */
+
+ParameterObject::ParameterMapVectorType &
+ParameterObject::GetWritableParameterMap(void)
+{
+  if (this->m_ParameterMap.use_count() > 1)
+  {
+    this->m_ParameterMap = std::make_shared<ParameterMapVectorType>(*this->m_ParameterMap);
+  }
+  return *this->m_ParameterMap;
 }
 
 
@@ -95,7 +145,7 @@ ParameterObject::SetParameter(const unsigned int &       index,
                               const ParameterKeyType &   key,
                               const ParameterValueType & value)
 {
-  this->m_ParameterMap[index][key] = ParameterValueVectorType(1, value);
+  this->GetWritableParameterMap()[index][key] = ParameterValueVectorType(1, value);
 }
 
 
@@ -108,7 +158,7 @@ ParameterObject::SetParameter(const unsigned int &             index,
                               const ParameterKeyType &         key,
                               const ParameterValueVectorType & value)
 {
-  this->m_ParameterMap[index][key] = value;
+  this->GetWritableParameterMap()[index][key] = value;
 }
 
 
@@ -147,7 +197,7 @@ ParameterObject::SetParameter(const ParameterKeyType & key, const ParameterValue
 const ParameterObject::ParameterValueVectorType &
 ParameterObject::GetParameter(const unsigned int & index, const ParameterKeyType & key)
 {
-  return this->m_ParameterMap[index][key];
+  return this->GetWritableParameterMap()[index][key];
 }
 
 
@@ -158,7 +208,7 @@ ParameterObject::GetParameter(const unsigned int & index, const ParameterKeyType
 void
 ParameterObject::RemoveParameter(const unsigned int & index, const ParameterKeyType & key)
 {
-  this->m_ParameterMap[index].erase(key);
+  this->GetWritableParameterMap()[index].erase(key);
 }
 
 
@@ -202,7 +252,7 @@ ParameterObject::ReadParameterFile(const ParameterFileNameVectorType & parameter
     itkExceptionMacro("Parameter filename container is empty.");
   }
 
-  this->m_ParameterMap.clear();
+  this->GetWritableParameterMap().clear();
 
   for (unsigned int i = 0; i < parameterFileNameVector.size(); ++i)
   {
@@ -226,7 +276,7 @@ ParameterObject::AddParameterFile(const ParameterFileNameType & parameterFileNam
   ParameterFileParserPointer parameterFileParser = ParameterFileParserType::New();
   parameterFileParser->SetParameterFileName(parameterFileName);
   parameterFileParser->ReadParameterFile();
-  this->m_ParameterMap.push_back(parameterFileParser->GetParameterMap());
+  this->GetWritableParameterMap().push_back(parameterFileParser->GetParameterMap());
 }
 
 
@@ -239,12 +289,12 @@ void
 ParameterObject::WriteParameterFile(void)
 {
   ParameterFileNameVectorType parameterFileNameVector;
-  for (unsigned int i = 0; i < m_ParameterMap.size(); ++i)
+  for (unsigned int i = 0; i < this->m_ParameterMap->size(); ++i)
   {
     parameterFileNameVector.push_back("ParametersFile." + std::to_string(i) + ".txt");
   }
 
-  this->WriteParameterFile(this->m_ParameterMap, parameterFileNameVector);
+  this->WriteParameterFile(*this->m_ParameterMap, parameterFileNameVector);
 }
 
 
@@ -277,7 +327,7 @@ ParameterObject::WriteParameterFile(const ParameterMapType &      parameterMap,
     {
       parameterFile << "(" << parameterMapIterator->first;
 
-      ParameterValueVectorType parameterMapValueVector = parameterMapIterator->second;
+      const ParameterValueVectorType & parameterMapValueVector = parameterMapIterator->second;
       for (unsigned int i = 0; i < parameterMapValueVector.size(); ++i)
       {
         std::stringstream stream(parameterMapValueVector[i]);
@@ -320,18 +370,18 @@ ParameterObject::WriteParameterFile(const ParameterMapType &      parameterMap,
 void
 ParameterObject::WriteParameterFile(const ParameterFileNameType & parameterFileName)
 {
-  if (this->m_ParameterMap.empty())
+  if (this->m_ParameterMap->empty())
   {
     itkExceptionMacro("Error writing parameter map to disk: The parameter object is empty.");
   }
 
-  if (this->m_ParameterMap.size() > 1)
+  if (this->m_ParameterMap->size() > 1)
   {
-    itkExceptionMacro(<< "Error writing to disk: The number of parameter maps (" << this->m_ParameterMap.size() << ")"
+    itkExceptionMacro(<< "Error writing to disk: The number of parameter maps (" << this->m_ParameterMap->size() << ")"
                       << " does not match the number of provided filenames (1). Please provide a vector of filenames.");
   }
 
-  this->WriteParameterFile(this->m_ParameterMap[0], parameterFileName);
+  this->WriteParameterFile((*this->m_ParameterMap)[0], parameterFileName);
 }
 
 
@@ -373,7 +423,7 @@ ParameterObject::WriteParameterFile(const ParameterMapVectorType &      paramete
 void
 ParameterObject::WriteParameterFile(const ParameterFileNameVectorType & parameterFileNameVector)
 {
-  this->WriteParameterFile(this->m_ParameterMap, parameterFileNameVector);
+  this->WriteParameterFile(*this->m_ParameterMap, parameterFileNameVector);
 }
 
 
@@ -500,15 +550,15 @@ ParameterObject::PrintSelf(std::ostream & os, itk::Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
 
-  for (unsigned int i = 0; i < this->m_ParameterMap.size(); ++i)
+  for (unsigned int i = 0; i < this->m_ParameterMap->size(); ++i)
   {
     os << "ParameterMap " << i << ": " << std::endl;
-    ParameterMapConstIterator parameterMapIterator = this->m_ParameterMap[i].begin();
-    ParameterMapConstIterator parameterMapIteratorEnd = this->m_ParameterMap[i].end();
+    ParameterMapConstIterator parameterMapIterator = (*this->m_ParameterMap)[i].begin();
+    ParameterMapConstIterator parameterMapIteratorEnd = (*this->m_ParameterMap)[i].end();
     while (parameterMapIterator != parameterMapIteratorEnd)
     {
       os << "  (" << parameterMapIterator->first;
-      ParameterValueVectorType parameterMapValueVector = parameterMapIterator->second;
+      const ParameterValueVectorType & parameterMapValueVector = parameterMapIterator->second;
 
       for (unsigned int j = 0; j < parameterMapValueVector.size(); ++j)
       {
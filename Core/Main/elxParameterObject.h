@@ -24,6 +24,8 @@
 
 #include "itkParameterFileParser.h"
 
+#include <memory>
+
 namespace elastix
 {
 
@@ -31,6 +33,13 @@ namespace elastix
 //   error: variable has incomplete type 'class ELASTIXLIB_API'
 // with class ELASTIXLIB_API ParameterObject : public itk::DataObject
 
+/** \class ParameterObject
+ * \brief Holds the parameter maps of elastix and transformix.
+ *
+ * The parameter maps are stored copy-on-write: Graft() shares them with another
+ * parameter object, and they are only copied when one of the objects modifies them.
+ */
+
 class ParameterObject : public itk::DataObject
 {
 public:
@@ -64,16 +73,26 @@ public:
   void
   SetParameterMap(const ParameterMapVectorType & parameterMap);
   void
+  SetParameterMap(ParameterMapVectorType && parameterMap);
+  void
   AddParameterMap(const ParameterMapType & parameterMap);
   const ParameterMapType &
   GetParameterMap(const unsigned int & index) const;
-  itkGetConstReferenceMacro(ParameterMap, ParameterMapVectorType);
+  const ParameterMapVectorType &
+  GetParameterMap(void) const
+  {
+    return *this->m_ParameterMap;
+  }
   unsigned int
   GetNumberOfParameterMaps() const
   {
-    return static_cast<unsigned int>(this->m_ParameterMap.size());
+    return static_cast<unsigned int>(this->m_ParameterMap->size());
   }
 
+  /* Share the parameter maps of another parameter object, without copying them. */
+  void
+  Graft(const itk::DataObject * data) override;
+
   void
   SetParameter(const unsigned int & index, const ParameterKeyType & key, const ParameterValueType & value);
   void
@@ -119,7 +138,12 @@ protected:
   PrintSelf(std::ostream & os, itk::Indent indent) const override;
 
 private:
-  ParameterMapVectorType m_ParameterMap;
+  /** Returns the parameter maps for modification. They are copied first when they are
+   * shared with another parameter object. */
+  ParameterMapVectorType &
+  GetWritableParameterMap(void);
+
+  std::shared_ptr<ParameterMapVectorType> m_ParameterMap{ std::make_shared<ParameterMapVectorType>() };
 };
 
 } // namespace elastix
@@ -0,0 +1,274 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "elxRegistrationResultCache.h"
+
+#include "itksys/MD5.h"
+
+#include <algorithm> // For min and minmax_element.
+#include <cmath>
+
+namespace elastix
+{
+
+namespace
+{
+
+/** Returns whether the keys identify the same registration. */
+bool
+IsSameRegistration(const RegistrationResultCache::KeyType & key1, const RegistrationResultCache::KeyType & key2)
+{
+  return key1.m_FixedHash == key2.m_FixedHash && key1.m_MovingHash == key2.m_MovingHash &&
+         key1.m_MovingGeometryHash == key2.m_MovingGeometryHash && key1.m_ParameterHash == key2.m_ParameterHash;
+}
+
+} // end namespace
+
+
+/**
+ * ********************* ComputeHash *********************
+ */
+
+std::string
+RegistrationResultCache::ComputeHash(const std::string & text,
+                                     const void * const  buffer,
+                                     const std::size_t   numberOfBytes)
+{
+  itksysMD5 * md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, reinterpret_cast<const unsigned char *>(text.c_str()), static_cast<int>(text.size()));
+
+  /** Append the buffer in chunks, as the length is passed as an int. */
+  const unsigned char * bytes = static_cast<const unsigned char *>(buffer);
+  std::size_t           remainingNumberOfBytes = bytes == nullptr ? 0 : numberOfBytes;
+  while (remainingNumberOfBytes > 0)
+  {
+    const std::size_t chunkSize = std::min<std::size_t>(remainingNumberOfBytes, 1u << 30);
+    itksysMD5_Append(md5, bytes, static_cast<int>(chunkSize));
+    bytes += chunkSize;
+    remainingNumberOfBytes -= chunkSize;
+  }
+
+  const std::size_t digestSize = 32u;
+  char              digest[digestSize];
+  itksysMD5_FinalizeHex(md5, digest);
+  itksysMD5_Delete(md5);
+  return std::string(digest, digestSize);
+
+} // end ComputeHash()
+
+
+/**
+ * ********************* ComputeSignatureDifference *********************
+ */
+
+double
+RegistrationResultCache::ComputeSignatureDifference(const SignatureType & cachedSignature,
+                                                    const SignatureType & signature)
+{
+  if (cachedSignature.empty() || cachedSignature.size() != signature.size())
+  {
+    return -1.0;
+  }
+
+  double sumOfSquares = 0.0;
+  for (std::size_t i = 0; i < signature.size(); ++i)
+  {
+    const double difference = signature[i] - cachedSignature[i];
+    sumOfSquares += difference * difference;
+  }
+  const double rms = std::sqrt(sumOfSquares / static_cast<double>(signature.size()));
+
+  /** Relative to the range of the cached values, or absolute for a constant image. */
+  const auto   minmax = std::minmax_element(cachedSignature.cbegin(), cachedSignature.cend());
+  const double range = *minmax.second - *minmax.first;
+  return range > 0.0 ? rms / range : rms;
+
+} // end ComputeSignatureDifference()
+
+
+/**
+ * ********************* FindResult *********************
+ */
+
+RegistrationResultCache::MatchType
+RegistrationResultCache::FindResult(const KeyType & key,
+                                    const bool      allowNearMatch,
+                                    ResultType &    result,
+                                    double &        difference)
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+
+  difference = 0.0;
+  auto bestEntry = this->m_Entries.end();
+  for (auto entry = this->m_Entries.begin(); entry != this->m_Entries.end(); ++entry)
+  {
+    if (IsSameRegistration(entry->first, key))
+    {
+      bestEntry = entry;
+      difference = 0.0;
+      break;
+    }
+
+    /** A near match registers the same fixed images, with the same parameter maps, to moving
+     * images of the same geometry.
+     */
+    if (!allowNearMatch || this->m_SimilarityTolerance <= 0.0 || entry->first.m_FixedHash != key.m_FixedHash ||
+        entry->first.m_ParameterHash != key.m_ParameterHash ||
+        entry->first.m_MovingGeometryHash != key.m_MovingGeometryHash || entry->second.m_FinalParameters.empty())
+    {
+      continue;
+    }
+    const double entryDifference = ComputeSignatureDifference(entry->first.m_MovingSignature, key.m_MovingSignature);
+    if (entryDifference >= 0.0 && entryDifference <= this->m_SimilarityTolerance &&
+        (bestEntry == this->m_Entries.end() || entryDifference < difference))
+    {
+      bestEntry = entry;
+      difference = entryDifference;
+    }
+  }
+
+  if (bestEntry == this->m_Entries.end())
+  {
+    ++this->m_NumberOfMisses;
+    return NoMatch;
+  }
+
+  /** Move the entry to the front, as the most recently used one. */
+  this->m_Entries.splice(this->m_Entries.begin(), this->m_Entries, bestEntry);
+  result = bestEntry->second;
+
+  if (IsSameRegistration(bestEntry->first, key))
+  {
+    ++this->m_NumberOfExactMatches;
+    return ExactMatch;
+  }
+  ++this->m_NumberOfNearMatches;
+  return NearMatch;
+
+} // end FindResult()
+
+
+/**
+ * ********************* AddResult *********************
+ */
+
+void
+RegistrationResultCache::AddResult(const KeyType & key, const ResultType & result)
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+
+  /** Replace an earlier result of the same registration. */
+  this->m_Entries.remove_if([&key](const EntryType & entry) { return IsSameRegistration(entry.first, key); });
+
+  this->m_Entries.emplace_front(key, result);
+  while (this->m_Entries.size() > std::max(this->m_MaximumNumberOfEntries, 1u))
+  {
+    this->m_Entries.pop_back();
+  }
+
+} // end AddResult()
+
+
+/**
+ * ********************* Clear *********************
+ */
+
+void
+RegistrationResultCache::Clear(void)
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  this->m_Entries.clear();
+
+} // end Clear()
+
+
+/**
+ * ********************* GetNumberOfEntries *********************
+ */
+
+unsigned int
+RegistrationResultCache::GetNumberOfEntries(void) const
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  return static_cast<unsigned int>(this->m_Entries.size());
+
+} // end GetNumberOfEntries()
+
+
+/**
+ * ********************* GetNumberOfExactMatches *********************
+ */
+
+unsigned long
+RegistrationResultCache::GetNumberOfExactMatches(void) const
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  return this->m_NumberOfExactMatches;
+
+} // end GetNumberOfExactMatches()
+
+
+/**
+ * ********************* GetNumberOfNearMatches *********************
+ */
+
+unsigned long
+RegistrationResultCache::GetNumberOfNearMatches(void) const
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  return this->m_NumberOfNearMatches;
+
+} // end GetNumberOfNearMatches()
+
+
+/**
+ * ********************* GetNumberOfMisses *********************
+ */
+
+unsigned long
+RegistrationResultCache::GetNumberOfMisses(void) const
+{
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  return this->m_NumberOfMisses;
+
+} // end GetNumberOfMisses()
+
+
+/**
+ * ********************* PrintSelf *********************
+ */
+
+void
+RegistrationResultCache::PrintSelf(std::ostream & os, itk::Indent indent) const
+{
+  this->Superclass::PrintSelf(os, indent);
+
+  const std::lock_guard<std::mutex> lock(this->m_Mutex);
+  os << indent << "MaximumNumberOfEntries: " << this->m_MaximumNumberOfEntries << std::endl;
+  os << indent << "SimilarityTolerance: " << this->m_SimilarityTolerance << std::endl;
+  os << indent << "NumberOfSignatureSamples: " << this->m_NumberOfSignatureSamples << std::endl;
+  os << indent << "NumberOfEntries: " << this->m_Entries.size() << std::endl;
+  os << indent << "NumberOfExactMatches: " << this->m_NumberOfExactMatches << std::endl;
+  os << indent << "NumberOfNearMatches: " << this->m_NumberOfNearMatches << std::endl;
+  os << indent << "NumberOfMisses: " << this->m_NumberOfMisses << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace elastix
@@ -0,0 +1,204 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef elxRegistrationResultCache_h
+#define elxRegistrationResultCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkDataObject.h"
+#include "itkOptimizerParameters.h"
+
+#include "elxParameterObject.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace elastix
+{
+
+/** \class RegistrationResultCache
+ * \brief Keeps the results of registrations in memory, to reuse them for the same or similar image pairs.
+ *
+ * In longitudinal and atlas studies, nearly identical image pairs are often registered
+ * again, e.g. when a study is reprocessed. An ElastixRegistrationMethod that has a result
+ * cache, see ElastixRegistrationMethod::SetResultCache(), looks up each registration
+ * before running it. The entries are identified by the MD5 hash of the content and the
+ * geometry of the fixed images and masks, of the moving images and masks, and of the
+ * parameter maps, and the names and contents of the initial transform and point set files.
+ *
+ * For an exact match, the cached result image and transform parameter maps are returned,
+ * without registration. For a near match, with the same fixed images and parameter maps,
+ * and moving images of the same geometry of which the content differs by at most the
+ * SimilarityTolerance, the registration is warm started from the final parameters of the
+ * cached registration, of each parameter map, so that it starts at the last resolution.
+ * The content of the moving images is compared by a signature of at most
+ * NumberOfSignatureSamples pixel values, at regular intervals in the buffers. Their
+ * difference is the root mean square difference of the signatures, relative to the
+ * range of the values of the cached signature.
+ *
+ * One cache may be shared by several registration methods, also when these run
+ * concurrently. Entries are evicted when the number of entries exceeds the
+ * MaximumNumberOfEntries, least recently used first. The registration methods store and
+ * take copies of the result images, so that their outputs may be modified in place.
+ *
+ * \ingroup Elastix
+ */
+
+class RegistrationResultCache : public itk::Object
+{
+public:
+  /** Standard ITK typedefs. */
+  typedef RegistrationResultCache       Self;
+  typedef itk::Object                   Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(RegistrationResultCache, itk::Object);
+
+  /** Typedefs. */
+  typedef ParameterObject::ParameterMapVectorType       ParameterMapVectorType;
+  typedef std::vector<itk::OptimizerParameters<double>> FinalParametersVectorType;
+  typedef std::vector<double>                           SignatureType;
+
+  /** The kinds of match of a lookup. */
+  enum MatchType
+  {
+    NoMatch,
+    NearMatch,
+    ExactMatch
+  };
+
+  /** The identification of a registration. */
+  struct KeyType
+  {
+    /** The MD5 hash of the fixed images and masks. */
+    std::string m_FixedHash;
+
+    /** The MD5 hash of the moving images and masks. */
+    std::string m_MovingHash;
+
+    /** The MD5 hash of the geometry of the moving images and masks. */
+    std::string m_MovingGeometryHash;
+
+    /** The MD5 hash of the parameter maps, and of the initial transform and point set files. */
+    std::string m_ParameterHash;
+
+    /** The signature of the moving images. */
+    SignatureType m_MovingSignature;
+  };
+
+  /** The result of a registration. */
+  struct ResultType
+  {
+    /** The result image, which may be null. */
+    itk::DataObject::Pointer m_ResultImage;
+
+    /** The transform parameter maps. */
+    ParameterMapVectorType m_TransformParameterMaps;
+
+    /** The final parameters of the registration of each parameter map. */
+    FinalParametersVectorType m_FinalParameters;
+  };
+
+  /** Returns the MD5 hash, as a hexadecimal string, of a string followed by a buffer. */
+  static std::string
+  ComputeHash(const std::string & text, const void * const buffer = nullptr, const std::size_t numberOfBytes = 0);
+
+  /** Returns the relative difference of two signatures, as described in the class description,
+   * or a negative value when the signatures cannot be compared.
+   */
+  static double
+  ComputeSignatureDifference(const SignatureType & cachedSignature, const SignatureType & signature);
+
+  /** Looks up the registration with the specified key: an exact match, or, when allowNearMatch
+   * is true and there is no exact match, the most similar near match within the
+   * SimilarityTolerance. The difference of the signatures of a near match is returned in
+   * difference.
+   */
+  MatchType
+  FindResult(const KeyType & key, const bool allowNearMatch, ResultType & result, double & difference);
+
+  /** Stores the result of the registration with the specified key. */
+  void
+  AddResult(const KeyType & key, const ResultType & result);
+
+  /** Removes all entries. */
+  void
+  Clear(void);
+
+  /** Returns the number of entries. */
+  unsigned int
+  GetNumberOfEntries(void) const;
+
+  /** Set/Get the maximum number of entries. Default: 100. */
+  itkSetMacro(MaximumNumberOfEntries, unsigned int);
+  itkGetConstMacro(MaximumNumberOfEntries, unsigned int);
+
+  /** Set/Get the maximum relative difference of the signatures of the moving images of a near
+   * match. Zero disables the near matches. Default: 0.05.
+   */
+  itkSetMacro(SimilarityTolerance, double);
+  itkGetConstMacro(SimilarityTolerance, double);
+
+  /** Set/Get the maximum number of pixel values of the signature of the moving images. Default: 4096. */
+  itkSetMacro(NumberOfSignatureSamples, unsigned int);
+  itkGetConstMacro(NumberOfSignatureSamples, unsigned int);
+
+  /** Get the number of exact matches, near matches and misses of the lookups. */
+  unsigned long
+  GetNumberOfExactMatches(void) const;
+  unsigned long
+  GetNumberOfNearMatches(void) const;
+  unsigned long
+  GetNumberOfMisses(void) const;
+
+protected:
+  RegistrationResultCache() = default;
+  ~RegistrationResultCache() override = default;
+
+  void
+  PrintSelf(std::ostream & os, itk::Indent indent) const override;
+
+private:
+  RegistrationResultCache(const Self &) = delete;
+  void
+  operator=(const Self &) = delete;
+
+  typedef std::pair<KeyType, ResultType> EntryType;
+
+  unsigned int m_MaximumNumberOfEntries{ 100 };
+  double       m_SimilarityTolerance{ 0.05 };
+  unsigned int m_NumberOfSignatureSamples{ 4096 };
+
+  /** The entries, most recently used first, and the statistics of the lookups. */
+  mutable std::mutex   m_Mutex;
+  std::list<EntryType> m_Entries;
+  unsigned long        m_NumberOfExactMatches{ 0 };
+  unsigned long        m_NumberOfNearMatches{ 0 };
+  unsigned long        m_NumberOfMisses{ 0 };
+};
+
+} // end namespace elastix
+
+#endif // end #ifndef elxRegistrationResultCache_h
@@ -275,7 +275,7 @@ TransformixFilter<TMovingImage>::GenerateOutputInformation(void)
 
   // Get world coordinate system from the last map
   const unsigned int     lastIndex = transformParameterObjectPtr->GetNumberOfParameterMaps() - 1;
-  const ParameterMapType transformParameterMap = transformParameterObjectPtr->GetParameterMap(lastIndex);
+  const ParameterMapType & transformParameterMap = transformParameterObjectPtr->GetParameterMap(lastIndex);
 
   ParameterMapType::const_iterator spacingMapIter = transformParameterMap.find("Spacing");
   if (spacingMapIter == transformParameterMap.end())
@@ -39,11 +39,66 @@
 
 #include "elxElastixMain.h"
 #include "elxParameterObject.h"
+#include "elxRegistrationResultCache.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
 
 /**
  * \class ElastixRegistrationMethod
  * \brief ITK Filter interface to the Elastix registration library.
  *
+ * The input images are used as they are, without copying: the internal pixel types
+ * of the registration (FixedInternalImagePixelType and MovingInternalImagePixelType)
+ * are set to the pixel types of TFixedImage and TMovingImage, overriding the user
+ * settings, and the internal pixel types must therefore be among the pixel types that
+ * elastix is compiled for. Buffers that are owned by the caller, e.g. NumPy arrays, can
+ * be passed without copying by wrapping them in an image by an ImportImageFilter, with
+ * SetImportPointer(buffer, numberOfPixels, false), so that the buffer is not released
+ * by ITK. The buffer must then stay valid until the registration has finished. The
+ * result image is not a copy of the resampler output either, when ResultImagePixelType
+ * is the pixel type of TMovingImage.
+ *
+ * To register one fixed image to many moving images, the filter may be updated
+ * repeatedly, replacing only the moving image. With FixedImagePyramidMemoryCacheSize
+ * in the parameter maps, the fixed image pyramids are then computed only once.
+ *
+ * Alternatively, a batch of moving images may be added by AddBatchMovingImage(). A
+ * single Update() then registers each of them separately to the fixed images, after
+ * the moving images given by SetMovingImage() and AddMovingImage(), with the same
+ * parameter maps, fixed masks and fixed point set. The moving masks and the moving
+ * point set only apply to the latter. The fixed image pyramids are computed once and
+ * kept in memory for all of these registrations, unless the parameter maps specify
+ * the FixedImagePyramidMemoryCacheSize otherwise. With SetNumberOfConcurrentRegistrations()
+ * the registrations run concurrently, each in its own thread with its own share of the
+ * threads, so that a batch of small images keeps all CPUs busy. The registration of
+ * batch image k writes its output files and its log file to the subdirectory "batchk"
+ * of the output directory, which is created when it does not exist yet.
+ *
+ * For the frames of a time series, SequenceModeOn() registers the batch in order,
+ * after the moving images given by SetMovingImage(), with warm starts: each frame
+ * starts at the last resolution, from the final parameters of the previous frame, for
+ * each parameter map. Optionally, the warm started frames use fewer iterations, see
+ * SetWarmStartMaximumNumberOfIterations(). Because each frame waits for the previous
+ * one, the frames of a sequence do not run concurrently, but all threads work on each.
+ * The fixed image pyramids are shared, as for any batch.
+ *
+ * With a result cache, see SetResultCache(), a registration that has been run before,
+ * with the same images and parameter maps, returns a copy of the cached result immediately,
+ * and writes its TransformParameters files to the output directory. A registration of
+ * similar moving images is warm started from the cached result, see
+ * elastix::RegistrationResultCache. The cache may be shared by several registration
+ * methods. It is not used in sequence mode, as a frame depends on the previous one.
+ *
+ * The progress can be followed, independently of the log, by an iteration callback.
+ * For a registration that does not block the caller, Update() may be run by another
+ * thread, e.g. by std::async, which has its own log streams. StopRegistration() may
+ * then be called from any thread: the registration stops after the current iteration,
+ * and the outputs are computed from the transform at that point. The optimizers that
+ * support convergence detection stop immediately; the others finish the current
+ * resolution, after which the remaining resolutions and parameter maps are skipped.
+ *
  * \ingroup Elastix
  */
 
@@ -75,6 +130,8 @@ public:
   typedef ArgumentMapType::value_type               ArgumentMapEntryType;
   typedef ElastixMainType::FlatDirectionCosinesType FlatDirectionCosinesType;
 
+  typedef ElastixMainType::ElastixBaseType::IterationCallbackType IterationCallbackType;
+
   typedef ElastixMainType::DataObjectContainerType      DataObjectContainerType;
   typedef ElastixMainType::DataObjectContainerPointer   DataObjectContainerPointer;
   typedef DataObjectContainerType::Iterator             DataObjectContainerIterator;
@@ -89,6 +146,10 @@ public:
   typedef ParameterObjectType::Pointer                  ParameterObjectPointer;
   typedef ParameterObjectType::ConstPointer             ParameterObjectConstPointer;
 
+  typedef elastix::RegistrationResultCache        RegistrationResultCacheType;
+  typedef RegistrationResultCacheType::KeyType    ResultCacheKeyType;
+  typedef RegistrationResultCacheType::ResultType ResultCacheResultType;
+
   static constexpr unsigned int FixedImageDimension = TFixedImage::ImageDimension;
   static constexpr unsigned int MovingImageDimension = TMovingImage::ImageDimension;
 
@@ -151,6 +212,48 @@ public:
   unsigned int
   GetNumberOfMovingMasks() const;
 
+  /** Add/Get/Remove/NumberOf the moving images of the batch, see the class description. */
+  void
+  AddBatchMovingImage(TMovingImage * movingImage);
+  const MovingImageType *
+  GetBatchMovingImage(const unsigned int index) const;
+  void
+  RemoveBatchMovingImages();
+  unsigned int
+  GetNumberOfBatchMovingImages() const;
+
+  /** The result image and the transform parameter object of a moving image of the batch. */
+  ResultImageType *
+  GetBatchOutput(const unsigned int index);
+  ParameterObjectType *
+  GetBatchTransformParameterObject(const unsigned int index);
+
+  /** Set/Get the maximum number of registrations of the batch that run concurrently.
+   * The default is one, so that the registrations run one after the other, in the
+   * thread that calls Update().
+   */
+  itkSetMacro(NumberOfConcurrentRegistrations, unsigned int);
+  itkGetConstMacro(NumberOfConcurrentRegistrations, unsigned int);
+
+  /** Set/Get whether the batch is registered as a sequence, with warm starts, see the class
+   * description. The default is false.
+   */
+  itkSetMacro(SequenceMode, bool);
+  itkGetConstMacro(SequenceMode, bool);
+  itkBooleanMacro(SequenceMode);
+
+  /** Set/Get the MaximumNumberOfIterations of the warm started frames of a sequence. The
+   * default, zero, keeps the MaximumNumberOfIterations of the parameter maps.
+   */
+  itkSetMacro(WarmStartMaximumNumberOfIterations, unsigned int);
+  itkGetConstMacro(WarmStartMaximumNumberOfIterations, unsigned int);
+
+  /** Set/Get the cache of registration results, see the class description. The default, null,
+   * means no cache.
+   */
+  itkSetObjectMacro(ResultCache, RegistrationResultCacheType);
+  itkGetModifiableObjectMacro(ResultCache, RegistrationResultCacheType);
+
   /** Set/Get parameter object.*/
   virtual void
   SetParameterObject(ParameterObjectType * parameterObject);
@@ -240,9 +343,44 @@ public:
   itkGetConstReferenceMacro(LogToFile, bool);
   itkBooleanMacro(LogToFile);
 
+  /** Set/Get the maximum number of threads of this registration. It does not change
+   * the ITK global maximum, so registrations that run concurrently in other threads
+   * may each have their own number of threads. Zero means the ITK default.
+   */
   itkSetMacro(NumberOfThreads, int);
   itkGetMacro(NumberOfThreads, int);
 
+  /** Set/Get the CPUs to which the thread that runs the registration is limited, as a list like "0-3,8".
+   * The affinity of the thread is restored afterwards. Empty means no limit. Only supported on Linux.
+   * The threads of the ITK thread pool are shared by the whole process, so the limit does not isolate
+   * concurrent registrations from each other, see elastix::CpuAffinityGuard.
+   */
+  itkSetMacro(CpuAffinity, std::string);
+  itkGetConstMacro(CpuAffinity, std::string);
+
+  /** Set the function that is called after each iteration, with the resolution level,
+   * the iteration number and the current position of the optimizer. It is called by the
+   * thread that runs Update(), or, for concurrent registrations of a batch, by the thread
+   * of each registration. The registration stops when it returns false.
+   */
+  void
+  SetIterationCallback(const IterationCallbackType & callback)
+  {
+    this->m_IterationCallback = callback;
+  }
+
+
+  /** Stop the running registration after the current iteration, and skip the remaining
+   * registrations of the batch. A request made before Update() stops the next update.
+   * Thread-safe.
+   */
+  void
+  StopRegistration(void)
+  {
+    this->m_StopRequested = true;
+  }
+
+
 protected:
   ElastixRegistrationMethod();
 
@@ -275,6 +413,75 @@ private:
   void
   RemoveInputsOfType(const DataObjectIdentifierType & inputName);
 
+  /** The names of the input and the outputs of the moving image of the batch with the specified index. */
+  static DataObjectIdentifierType
+  MakeBatchMovingImageName(const unsigned int index);
+  static DataObjectIdentifierType
+  MakeBatchResultImageName(const unsigned int index);
+  static DataObjectIdentifierType
+  MakeBatchTransformParameterObjectName(const unsigned int index);
+
+  /** Returns a container with a graft of each of the images. A graft shares the pixel buffer,
+   * but not the pipeline of the image, so that concurrent registrations do not update a
+   * shared pipeline.
+   */
+  template <typename TImage>
+  static DataObjectContainerPointer
+  GraftImages(const DataObjectContainerType * images);
+
+  /** The final parameters of the registration of each parameter map, for the warm starts of a sequence. */
+  typedef std::vector<OptimizerParameters<double>> WarmStartParametersVectorType;
+
+  /** Runs the registration of the moving images for all parameter maps, and returns the
+   * result image, which may be null, and the transform parameter maps. When warmStartParameters
+   * is not null, the registration of each parameter map is warm started from its parameters,
+   * if any, after which they are replaced by the final parameters of the registration.
+   * Returns false when the registration was stopped before it finished.
+   */
+  bool
+  RunRegistration(const ArgumentMapType &         argumentMap,
+                  const ParameterMapVectorType &  parameterMapVector,
+                  DataObjectContainerPointer      fixedImageContainer,
+                  DataObjectContainerPointer      movingImageContainer,
+                  DataObjectContainerPointer      fixedMaskContainer,
+                  DataObjectContainerPointer      movingMaskContainer,
+                  DataObjectPointer &             resultImage,
+                  ParameterMapVectorType &        transformParameterMapVector,
+                  WarmStartParametersVectorType * warmStartParameters = nullptr);
+
+  /** Returns the key of a registration in the result cache. */
+  ResultCacheKeyType
+  MakeResultCacheKey(const ArgumentMapType &         argumentMap,
+                     const ParameterMapVectorType &  parameterMapVector,
+                     const DataObjectContainerType * fixedImageContainer,
+                     const DataObjectContainerType * movingImageContainer,
+                     const DataObjectContainerType * fixedMaskContainer,
+                     const DataObjectContainerType * movingMaskContainer) const;
+
+  /** Returns a copy of the result image, which may be null, so that the result cache and the
+   * outputs do not share pixel buffers. */
+  static DataObjectPointer
+  DuplicateResultImage(const DataObject * resultImage);
+
+  /** Writes the TransformParameters files of a registration of which the result is taken from
+   * the result cache to the output directory, as the registration itself would have done. */
+  static void
+  WriteTransformParameterFiles(const std::string &            outputDirectory,
+                               const ParameterMapVectorType & parameterMapVector,
+                               const ParameterMapVectorType & transformParameterMapVector);
+
+  /** Returns the MD5 hash of the geometry, and, unless geometryOnly, of the content of the images. */
+  template <typename TImage>
+  static std::string
+  ComputeImagesHash(const DataObjectContainerType * images, const bool geometryOnly);
+
+  /** Appends the pixel values at regular intervals in the buffers of the images to signature. */
+  template <typename TImage>
+  static void
+  AppendImagesSignature(const DataObjectContainerType *              images,
+                        const unsigned int                           numberOfSamples,
+                        RegistrationResultCacheType::SignatureType & signature);
+
   std::string m_InitialTransformParameterFileName;
   std::string m_FixedPointSetFileName;
   std::string m_MovingPointSetFileName;
@@ -285,9 +492,18 @@ private:
   bool m_LogToConsole;
   bool m_LogToFile;
 
-  int m_NumberOfThreads;
+  int         m_NumberOfThreads;
+  std::string m_CpuAffinity;
 
   unsigned int m_InputUID;
+  unsigned int m_NumberOfConcurrentRegistrations{ 1 };
+  bool         m_SequenceMode{ false };
+  unsigned int m_WarmStartMaximumNumberOfIterations{ 0 };
+
+  RegistrationResultCacheType::Pointer m_ResultCache;
+
+  IterationCallbackType m_IterationCallback;
+  std::atomic<bool>     m_StopRequested{ false };
 };
 
 } // namespace itk
@@ -38,7 +38,19 @@
 #include "elxPixelType.h"
 #include "itkElastixRegistrationMethod.h"
 
-#include <algorithm> // For find.
+#include "itkImageDuplicator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkTransformBase.h"
+
+#include <algorithm> // For find, min and max.
+#include <exception>
+#include <fstream>
+#include <iomanip>  // For setprecision.
+#include <iterator> // For istreambuf_iterator.
+#include <sstream>
+#include <thread>
+#include <typeinfo>
+#include <utility> // For move.
 
 namespace itk
 {
@@ -99,10 +111,6 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
   DataObjectContainerPointer movingImageContainer = DataObjectContainerType::New();
   DataObjectContainerPointer fixedMaskContainer = nullptr;
   DataObjectContainerPointer movingMaskContainer = nullptr;
-  DataObjectContainerPointer resultImageContainer = nullptr;
-  ElastixMainObjectPointer   transform = nullptr;
-  ParameterMapVectorType     transformParameterMapVector;
-  FlatDirectionCosinesType   fixedImageOriginalDirection;
 
   // Split inputs into separate containers
   const NameArrayType inputNames = this->GetInputNames();
@@ -152,6 +160,42 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     itkExceptionMacro("Empty parameter map in parameter object.");
   }
 
+  // The registrations of the moving images of the batch follow the registration of the other moving images
+  const unsigned int numberOfBatchMovingImages = this->GetNumberOfBatchMovingImages();
+  const unsigned int numberOfRegistrations = 1 + numberOfBatchMovingImages;
+  const unsigned int numberOfConcurrentRegistrations =
+    this->m_SequenceMode ? 1u : std::max(1u, std::min(this->m_NumberOfConcurrentRegistrations, numberOfRegistrations));
+
+  for (unsigned int i = 0; i < parameterMapVector.size(); ++i)
+  {
+    // Set image dimension from input images (overrides user settings)
+    parameterMapVector[i]["FixedImageDimension"] = ParameterValueVectorType(1, std::to_string(fixedImageDimension));
+    parameterMapVector[i]["MovingImageDimension"] = ParameterValueVectorType(1, std::to_string(movingImageDimension));
+    parameterMapVector[i]["ResultImagePixelType"] =
+      ParameterValueVectorType(1, elastix::PixelType<typename TFixedImage::PixelType>::ToString());
+
+    // Set the internal pixel types from the input images, so that these are used without copying
+    parameterMapVector[i]["FixedInternalImagePixelType"] =
+      ParameterValueVectorType(1, elastix::PixelType<typename TFixedImage::PixelType>::ToString());
+    parameterMapVector[i]["MovingInternalImagePixelType"] =
+      ParameterValueVectorType(1, elastix::PixelType<typename TMovingImage::PixelType>::ToString());
+
+    // Initial transform parameter files are handled via arguments and enclosing loop, not
+    // InitialTransformParametersFileName
+    if (parameterMapVector[i].find("InitialTransformParametersFileName") != parameterMapVector[i].end())
+    {
+      parameterMapVector[i]["InitialTransformParametersFileName"] = ParameterValueVectorType(1, "NoInitialTransform");
+    }
+
+    // The registrations of a batch share the fixed image pyramids, one for each parameter map
+    if (numberOfBatchMovingImages > 0 &&
+        parameterMapVector[i].find("FixedImagePyramidMemoryCacheSize") == parameterMapVector[i].end())
+    {
+      parameterMapVector[i]["FixedImagePyramidMemoryCacheSize"] =
+        ParameterValueVectorType(1, std::to_string(parameterMapVector.size()));
+    }
+  }
+
   // Setup argument map
   ArgumentMapType argumentMap;
 
@@ -165,11 +209,6 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     argumentMap.insert(ArgumentMapEntryType("-fp", this->m_FixedPointSetFileName));
   }
 
-  if (!this->m_MovingPointSetFileName.empty())
-  {
-    argumentMap.insert(ArgumentMapEntryType("-mp", this->m_MovingPointSetFileName));
-  }
-
   // Setup output directory
   if (this->GetOutputDirectory().empty())
   {
@@ -210,31 +249,283 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     }
   }
 
-  // Set Number of threads
-  if (this->m_NumberOfThreads > 0)
+  // Set Number of threads, which are divided over the concurrent registrations
+  if (this->m_NumberOfThreads > 0 || numberOfConcurrentRegistrations > 1)
   {
-    argumentMap.insert(ArgumentMapEntryType("-threads", std::to_string(this->m_NumberOfThreads)));
+    const unsigned int numberOfThreads = this->m_NumberOfThreads > 0
+                                           ? static_cast<unsigned int>(this->m_NumberOfThreads)
+                                           : MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    argumentMap.insert(ArgumentMapEntryType(
+      "-threads", std::to_string(std::max(1u, numberOfThreads / numberOfConcurrentRegistrations))));
   }
 
-  // Setup xout
-  const elastix::xoutManager manager(logFileName, this->GetLogToFile(), this->GetLogToConsole());
+  // Set CPU affinity
+  if (!this->m_CpuAffinity.empty())
+  {
+    argumentMap.insert(ArgumentMapEntryType("-affinity", this->m_CpuAffinity));
+  }
 
-  // Run the (possibly multiple) registration(s)
-  for (unsigned int i = 0; i < parameterMapVector.size(); ++i)
+  // The frames of a sequence are warm started from the previous frame, possibly with fewer iterations
+  ParameterMapVectorType warmStartParameterMapVector = parameterMapVector;
+  if (this->m_SequenceMode && this->m_WarmStartMaximumNumberOfIterations > 0)
   {
-    // Set image dimension from input images (overrides user settings)
-    parameterMapVector[i]["FixedImageDimension"] = ParameterValueVectorType(1, std::to_string(fixedImageDimension));
-    parameterMapVector[i]["MovingImageDimension"] = ParameterValueVectorType(1, std::to_string(movingImageDimension));
-    parameterMapVector[i]["ResultImagePixelType"] =
-      ParameterValueVectorType(1, elastix::PixelType<typename TFixedImage::PixelType>::ToString());
+    for (auto & parameterMap : warmStartParameterMapVector)
+    {
+      parameterMap["MaximumNumberOfIterations"] =
+        ParameterValueVectorType(1, std::to_string(this->m_WarmStartMaximumNumberOfIterations));
+    }
+  }
+  WarmStartParametersVectorType         warmStartParameters;
+  WarmStartParametersVectorType * const sequenceWarmStartParameters =
+    this->m_SequenceMode ? &warmStartParameters : nullptr;
 
-    // Initial transform parameter files are handled via arguments and enclosing loop, not
-    // InitialTransformParametersFileName
-    if (parameterMapVector[i].find("InitialTransformParametersFileName") != parameterMapVector[i].end())
+  // The result cache is not used in sequence mode, as each frame depends on the previous one
+  const bool useResultCache = this->m_ResultCache.IsNotNull() && !this->m_SequenceMode;
+
+  // Run the registration with the specified index, in the calling thread or in a thread of its own
+  std::vector<DataObjectPointer>      resultImages(numberOfRegistrations);
+  std::vector<ParameterMapVectorType> transformParameterMapVectors(numberOfRegistrations);
+  std::vector<std::exception_ptr>     exceptions(numberOfRegistrations);
+
+  const auto runRegistration = [&](const unsigned int registrationIndex) {
+    if (this->m_StopRequested)
     {
-      parameterMapVector[i]["InitialTransformParametersFileName"] = ParameterValueVectorType(1, "NoInitialTransform");
+      return;
+    }
+
+    try
+    {
+      // Each registration of the batch writes its output files and its log file to a subdirectory of its own, so
+      // that these do not overwrite those of the other registrations
+      ArgumentMapType registrationArgumentMap = argumentMap;
+      std::string     registrationLogFileName = logFileName;
+      if (registrationIndex > 0 && !this->GetOutputDirectory().empty())
+      {
+        const std::string batchDirectory = "batch" + std::to_string(registrationIndex - 1) + "/";
+        const std::string registrationOutputDirectory = this->GetOutputDirectory() + batchDirectory;
+        if (!itksys::SystemTools::MakeDirectory(registrationOutputDirectory))
+        {
+          itkExceptionMacro("Output directory \"" << registrationOutputDirectory << "\" could not be created.");
+        }
+        registrationArgumentMap["-out"] = registrationOutputDirectory;
+        if (!logFileName.empty())
+        {
+          registrationLogFileName.insert(this->GetOutputDirectory().size(), batchDirectory);
+        }
+      }
+
+      // Setup xout
+      const elastix::xoutManager manager(registrationLogFileName, this->GetLogToFile(), this->GetLogToConsole());
+
+      // The moving images given by SetMovingImage() and AddMovingImage(), or a moving image of the batch
+      DataObjectContainerPointer registrationMovingImageContainer = movingImageContainer;
+      DataObjectContainerPointer registrationMovingMaskContainer = movingMaskContainer;
+      if (registrationIndex == 0)
+      {
+        if (!this->m_MovingPointSetFileName.empty())
+        {
+          registrationArgumentMap.insert(ArgumentMapEntryType("-mp", this->m_MovingPointSetFileName));
+        }
+      }
+      else
+      {
+        registrationMovingImageContainer = DataObjectContainerType::New();
+        registrationMovingImageContainer->push_back(
+          const_cast<MovingImageType *>(this->GetBatchMovingImage(registrationIndex - 1)));
+        registrationMovingMaskContainer = nullptr;
+      }
+      const ParameterMapVectorType & registrationParameterMapVector =
+        this->m_SequenceMode && registrationIndex > 0 ? warmStartParameterMapVector : parameterMapVector;
+
+      // Take the result from the cache, or warm start from the result of a similar registration
+      ResultCacheKeyType              resultCacheKey;
+      WarmStartParametersVectorType   cacheWarmStartParameters;
+      WarmStartParametersVectorType * registrationWarmStartParameters = sequenceWarmStartParameters;
+      if (useResultCache)
+      {
+        resultCacheKey = this->MakeResultCacheKey(registrationArgumentMap,
+                                                  registrationParameterMapVector,
+                                                  fixedImageContainer,
+                                                  registrationMovingImageContainer,
+                                                  fixedMaskContainer,
+                                                  registrationMovingMaskContainer);
+        ResultCacheResultType cachedResult;
+        double                difference = 0.0;
+        const auto            match = this->m_ResultCache->FindResult(resultCacheKey, true, cachedResult, difference);
+        if (match == RegistrationResultCacheType::ExactMatch)
+        {
+          elxout << "The result of this registration is taken from the result cache." << std::endl;
+          resultImages[registrationIndex] = DuplicateResultImage(cachedResult.m_ResultImage);
+          transformParameterMapVectors[registrationIndex] = cachedResult.m_TransformParameterMaps;
+          if (!this->GetOutputDirectory().empty())
+          {
+            WriteTransformParameterFiles(registrationArgumentMap["-out"],
+                                         registrationParameterMapVector,
+                                         cachedResult.m_TransformParameterMaps);
+          }
+          return;
+        }
+        if (match == RegistrationResultCacheType::NearMatch)
+        {
+          elxout << "This registration is warm started from the result of a similar registration in the result "
+                 << "cache, of which the moving images differ by " << difference << "." << std::endl;
+          cacheWarmStartParameters = cachedResult.m_FinalParameters;
+        }
+        registrationWarmStartParameters = &cacheWarmStartParameters;
+      }
+
+      bool finished = false;
+      if (numberOfConcurrentRegistrations > 1)
+      {
+        finished = this->RunRegistration(registrationArgumentMap,
+                                         registrationParameterMapVector,
+                                         GraftImages<TFixedImage>(fixedImageContainer),
+                                         GraftImages<TMovingImage>(registrationMovingImageContainer),
+                                         GraftImages<FixedMaskType>(fixedMaskContainer),
+                                         GraftImages<MovingMaskType>(registrationMovingMaskContainer),
+                                         resultImages[registrationIndex],
+                                         transformParameterMapVectors[registrationIndex],
+                                         registrationWarmStartParameters);
+      }
+      else
+      {
+        finished = this->RunRegistration(registrationArgumentMap,
+                                         registrationParameterMapVector,
+                                         fixedImageContainer,
+                                         registrationMovingImageContainer,
+                                         fixedMaskContainer,
+                                         registrationMovingMaskContainer,
+                                         resultImages[registrationIndex],
+                                         transformParameterMapVectors[registrationIndex],
+                                         registrationWarmStartParameters);
+      }
+
+      // Keep the result of a registration that has finished
+      if (useResultCache && finished)
+      {
+        ResultCacheResultType result;
+        result.m_ResultImage = DuplicateResultImage(resultImages[registrationIndex]);
+        result.m_TransformParameterMaps = transformParameterMapVectors[registrationIndex];
+        result.m_FinalParameters = std::move(cacheWarmStartParameters);
+        this->m_ResultCache->AddResult(resultCacheKey, result);
+      }
+    }
+    catch (...)
+    {
+      exceptions[registrationIndex] = std::current_exception();
+    }
+  };
+
+  // Run the registrations, one after the other or concurrently
+  if (numberOfConcurrentRegistrations == 1)
+  {
+    for (unsigned int i = 0; i < numberOfRegistrations; ++i)
+    {
+      runRegistration(i);
+    }
+  }
+  else
+  {
+    std::atomic<unsigned int> nextRegistrationIndex{ 0 };
+    std::vector<std::thread>  threads;
+    for (unsigned int t = 0; t < numberOfConcurrentRegistrations; ++t)
+    {
+      threads.emplace_back([&] {
+        for (unsigned int i = nextRegistrationIndex++; i < numberOfRegistrations; i = nextRegistrationIndex++)
+        {
+          runRegistration(i);
+        }
+      });
+    }
+    for (auto & thread : threads)
+    {
+      thread.join();
     }
+  }
+
+  // A stop request, also one made before the update, applies to this update only
+  this->m_StopRequested = false;
 
+  // Pass the first error on to the caller
+  for (const auto & exception : exceptions)
+  {
+    if (exception)
+    {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  // Save the result images and the parameter maps of the registrations that have run
+  const auto & parameterMap = parameterMapVector.back();
+  const auto   endOfParameterMap = parameterMap.cend();
+  const bool   writeResultImage =
+    std::find(parameterMap.cbegin(),
+              endOfParameterMap,
+              typename ParameterMapType::value_type{ "WriteResultImage", { "false" } }) == endOfParameterMap;
+
+  for (unsigned int i = 0; i < numberOfRegistrations; ++i)
+  {
+    if (transformParameterMapVectors[i].empty())
+    {
+      continue;
+    }
+
+    // Save result image
+    if (resultImages[i].IsNotNull())
+    {
+      if (i == 0)
+      {
+        this->GraftOutput(resultImages[i]);
+      }
+      else
+      {
+        this->GraftOutput(MakeBatchResultImageName(i - 1), resultImages[i]);
+      }
+    }
+    else if (writeResultImage)
+    {
+      itkExceptionMacro("Errors occured during registration: Could not read result image.");
+    }
+
+    // Save parameter map
+    elastix::ParameterObject::Pointer transformParameterObject = elastix::ParameterObject::New();
+    transformParameterObject->SetParameterMap(std::move(transformParameterMapVectors[i]));
+    if (i == 0)
+    {
+      this->SetNthOutput(1, transformParameterObject);
+    }
+    else
+    {
+      this->ProcessObject::SetOutput(MakeBatchTransformParameterObjectName(i - 1), transformParameterObject);
+    }
+  }
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+bool
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::RunRegistration(
+  const ArgumentMapType &         argumentMap,
+  const ParameterMapVectorType &  parameterMapVector,
+  DataObjectContainerPointer      fixedImageContainer,
+  DataObjectContainerPointer      movingImageContainer,
+  DataObjectContainerPointer      fixedMaskContainer,
+  DataObjectContainerPointer      movingMaskContainer,
+  DataObjectPointer &             resultImage,
+  ParameterMapVectorType &        transformParameterMapVector,
+  WarmStartParametersVectorType * warmStartParameters)
+{
+  DataObjectContainerPointer resultImageContainer = nullptr;
+  ElastixMainObjectPointer   transform = nullptr;
+  FlatDirectionCosinesType   fixedImageOriginalDirection;
+  bool                       finished = true;
+
+  // The registrations of the chain share one dictionary, see ElastixBase::SetChainDictionary()
+  const auto chainDictionary = std::make_shared<itk::MetaDataDictionary>();
+
+  // Run the (possibly multiple) registration(s)
+  for (unsigned int i = 0; i < parameterMapVector.size(); ++i)
+  {
     // Create new instance of ElastixMain
     ElastixMainPointer elastix = ElastixMainType::New();
 
@@ -244,6 +535,7 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
 
     // Set stuff we get from a previous registration
     elastix->SetInitialTransform(transform);
+    elastix->SetChainDictionary(chainDictionary);
     elastix->SetFixedImageContainer(fixedImageContainer);
     elastix->SetMovingImageContainer(movingImageContainer);
     elastix->SetFixedMaskContainer(fixedMaskContainer);
@@ -251,6 +543,20 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     elastix->SetResultImageContainer(resultImageContainer);
     elastix->SetOriginalFixedImageDirectionFlat(fixedImageOriginalDirection);
 
+    // Warm start from the final parameters of the previous frame of a sequence
+    if (warmStartParameters != nullptr && i < warmStartParameters->size())
+    {
+      elastix->SetWarmStartParameters((*warmStartParameters)[i]);
+    }
+
+    // Report the progress, and stop when requested
+    elastix->SetIterationCallback([this](const unsigned int                       level,
+                                         const unsigned int                       iteration,
+                                         const itk::OptimizerParameters<double> & position) {
+      return !this->m_StopRequested &&
+             (!this->m_IterationCallback || this->m_IterationCallback(level, iteration, position));
+    });
+
     // Start registration
     unsigned int isError = 0;
     try
@@ -276,6 +582,17 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     resultImageContainer = elastix->GetResultImageContainer();
     fixedImageOriginalDirection = elastix->GetOriginalFixedImageDirectionFlat();
 
+    // Keep the final parameters, to warm start the next frame of a sequence
+    if (warmStartParameters != nullptr)
+    {
+      const auto * const finalTransform = dynamic_cast<const TransformBaseTemplate<double> *>(transform.GetPointer());
+      if (finalTransform != nullptr)
+      {
+        warmStartParameters->resize(std::max<std::size_t>(warmStartParameters->size(), i + 1));
+        (*warmStartParameters)[i] = finalTransform->GetParameters();
+      }
+    }
+
     transformParameterMapVector.push_back(elastix->GetTransformParametersMap());
     if (i > 0)
     {
@@ -284,34 +601,23 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GenerateData()
     }
 
     // TODO: Fix elastix corrupting default pixel value parameter
-    transformParameterMapVector.back()["DefaultPixelValue"] = parameterMapVector[i]["DefaultPixelValue"];
-  } // End loop over registrations
-
-  // Save result image
-  if (resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 &&
-      resultImageContainer->ElementAt(0).IsNotNull())
-  {
-    this->GraftOutput(resultImageContainer->ElementAt(0));
-  }
-  else
-  {
-    const auto & parameterMap = parameterMapVector.back();
-    const auto   endOfParameterMap = parameterMap.cend();
-    const bool   writeResultImage =
-      std::find(parameterMap.cbegin(),
-                endOfParameterMap,
-                typename ParameterMapType::value_type{ "WriteResultImage", { "false" } }) == endOfParameterMap;
+    const auto defaultPixelValue = parameterMapVector[i].find("DefaultPixelValue");
+    transformParameterMapVector.back()["DefaultPixelValue"] =
+      defaultPixelValue == parameterMapVector[i].end() ? ParameterValueVectorType() : defaultPixelValue->second;
 
-    if (writeResultImage)
+    // Skip the remaining registrations after a stop request
+    if (elastix->GetElastixBase().GetRegistrationStopRequested())
     {
-      itkExceptionMacro("Errors occured during registration: Could not read result image.");
+      finished = false;
+      break;
     }
-  }
+  } // End loop over registrations
 
-  // Save parameter map
-  elastix::ParameterObject::Pointer transformParameterObject = elastix::ParameterObject::New();
-  transformParameterObject->SetParameterMap(transformParameterMapVector);
-  this->SetNthOutput(1, transformParameterObject);
+  if (resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0)
+  {
+    resultImage = resultImageContainer->ElementAt(0);
+  }
+  return finished;
 }
 
 
@@ -538,6 +844,69 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::GetNumberOfMovingImages()
 }
 
 
+template <typename TFixedImage, typename TMovingImage>
+void
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::AddBatchMovingImage(TMovingImage * movingImage)
+{
+  const unsigned int index = this->GetNumberOfBatchMovingImages();
+  this->ProcessObject::SetInput(MakeBatchMovingImageName(index), movingImage);
+  this->ProcessObject::SetOutput(MakeBatchResultImageName(index), ResultImageType::New());
+  this->ProcessObject::SetOutput(MakeBatchTransformParameterObjectName(index), elastix::ParameterObject::New());
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+const typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::MovingImageType *
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::GetBatchMovingImage(const unsigned int index) const
+{
+  return itkDynamicCastInDebugMode<const TMovingImage *>(
+    this->ProcessObject::GetInput(MakeBatchMovingImageName(index)));
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+void
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::RemoveBatchMovingImages()
+{
+  for (unsigned int i = this->GetNumberOfBatchMovingImages(); i > 0; --i)
+  {
+    this->ProcessObject::RemoveInput(MakeBatchMovingImageName(i - 1));
+    this->ProcessObject::RemoveOutput(MakeBatchResultImageName(i - 1));
+    this->ProcessObject::RemoveOutput(MakeBatchTransformParameterObjectName(i - 1));
+  }
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+unsigned int
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::GetNumberOfBatchMovingImages() const
+{
+  unsigned int numberOfBatchMovingImages = 0;
+  while (this->ProcessObject::GetInput(MakeBatchMovingImageName(numberOfBatchMovingImages)) != nullptr)
+  {
+    ++numberOfBatchMovingImages;
+  }
+  return numberOfBatchMovingImages;
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::ResultImageType *
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::GetBatchOutput(const unsigned int index)
+{
+  return itkDynamicCastInDebugMode<ResultImageType *>(this->ProcessObject::GetOutput(MakeBatchResultImageName(index)));
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::ParameterObjectType *
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::GetBatchTransformParameterObject(const unsigned int index)
+{
+  return itkDynamicCastInDebugMode<ParameterObjectType *>(
+    this->ProcessObject::GetOutput(MakeBatchTransformParameterObjectName(index)));
+}
+
+
 template <typename TFixedImage, typename TMovingImage>
 void
 ElastixRegistrationMethod<TFixedImage, TMovingImage>::SetFixedMask(FixedMaskType * fixedMask)
@@ -792,6 +1161,245 @@ ElastixRegistrationMethod<TFixedImage, TMovingImage>::RemoveInputsOfType(const D
 }
 
 
+template <typename TFixedImage, typename TMovingImage>
+ProcessObject::DataObjectIdentifierType
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::MakeBatchMovingImageName(const unsigned int index)
+{
+  return "BatchMovingImage" + std::to_string(index);
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+ProcessObject::DataObjectIdentifierType
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::MakeBatchResultImageName(const unsigned int index)
+{
+  return "BatchResultImage" + std::to_string(index);
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+ProcessObject::DataObjectIdentifierType
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::MakeBatchTransformParameterObjectName(const unsigned int index)
+{
+  return "BatchTransformParameterObject" + std::to_string(index);
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+template <typename TImage>
+typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::DataObjectContainerPointer
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::GraftImages(const DataObjectContainerType * const images)
+{
+  if (images == nullptr)
+  {
+    return nullptr;
+  }
+
+  const DataObjectContainerPointer grafts = DataObjectContainerType::New();
+  for (unsigned int i = 0; i < images->Size(); ++i)
+  {
+    const auto graft = TImage::New();
+    graft->Graft(images->ElementAt(i).GetPointer());
+    grafts->push_back(graft.GetPointer());
+  }
+  return grafts;
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::ResultCacheKeyType
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::MakeResultCacheKey(
+  const ArgumentMapType &               argumentMap,
+  const ParameterMapVectorType &        parameterMapVector,
+  const DataObjectContainerType * const fixedImageContainer,
+  const DataObjectContainerType * const movingImageContainer,
+  const DataObjectContainerType * const fixedMaskContainer,
+  const DataObjectContainerType * const movingMaskContainer) const
+{
+  ResultCacheKeyType key;
+  key.m_FixedHash = RegistrationResultCacheType::ComputeHash(
+    ComputeImagesHash<TFixedImage>(fixedImageContainer, false) +
+    ComputeImagesHash<FixedMaskType>(fixedMaskContainer, false));
+  key.m_MovingHash = RegistrationResultCacheType::ComputeHash(
+    ComputeImagesHash<TMovingImage>(movingImageContainer, false) +
+    ComputeImagesHash<MovingMaskType>(movingMaskContainer, false));
+  key.m_MovingGeometryHash = RegistrationResultCacheType::ComputeHash(
+    ComputeImagesHash<TMovingImage>(movingImageContainer, true) +
+    ComputeImagesHash<MovingMaskType>(movingMaskContainer, true));
+
+  // The parameter maps, and the arguments that affect the result, such as the point set file names
+  std::ostringstream parameters;
+  for (const auto & parameterMap : parameterMapVector)
+  {
+    for (const auto & parameter : parameterMap)
+    {
+      parameters << parameter.first;
+      for (const auto & value : parameter.second)
+      {
+        parameters << " \"" << value << "\"";
+      }
+      parameters << "\n";
+    }
+    parameters << "\n";
+  }
+  for (const auto & argument : argumentMap)
+  {
+    if (argument.first != "-out" && argument.first != "-threads" && argument.first != "-affinity")
+    {
+      parameters << argument.first << " \"" << argument.second << "\"\n";
+    }
+
+    // The content of the initial transform and point set files, which may change under the same name
+    if (argument.first == "-t0" || argument.first == "-fp" || argument.first == "-mp")
+    {
+      std::ifstream file(argument.second, std::ios::binary);
+      if (file)
+      {
+        parameters << std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()) << "\n";
+      }
+    }
+  }
+  key.m_ParameterHash = RegistrationResultCacheType::ComputeHash(parameters.str());
+
+  AppendImagesSignature<TMovingImage>(
+    movingImageContainer, this->m_ResultCache->GetNumberOfSignatureSamples(), key.m_MovingSignature);
+  return key;
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+typename ElastixRegistrationMethod<TFixedImage, TMovingImage>::DataObjectPointer
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::DuplicateResultImage(const DataObject * const resultImage)
+{
+  if (resultImage == nullptr)
+  {
+    return nullptr;
+  }
+
+  const auto * const image = dynamic_cast<const TFixedImage *>(resultImage);
+  if (image == nullptr)
+  {
+    itkGenericExceptionMacro(<< "The result image of the registration is not of the expected type.");
+  }
+
+  const auto duplicator = ImageDuplicator<TFixedImage>::New();
+  duplicator->SetInputImage(image);
+  duplicator->Update();
+  return duplicator->GetOutput();
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+void
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::WriteTransformParameterFiles(
+  const std::string &            outputDirectory,
+  const ParameterMapVectorType & parameterMapVector,
+  const ParameterMapVectorType & transformParameterMapVector)
+{
+  const auto parameterObject = elastix::ParameterObject::New();
+  for (unsigned int i = 0; i < transformParameterMapVector.size(); ++i)
+  {
+    // As written by the registration, unless WriteFinalTransformParameters is false
+    if (i < parameterMapVector.size())
+    {
+      const auto writeFinalTransformParameters = parameterMapVector[i].find("WriteFinalTransformParameters");
+      if (writeFinalTransformParameters != parameterMapVector[i].end() &&
+          writeFinalTransformParameters->second == ParameterValueVectorType(1, "false"))
+      {
+        continue;
+      }
+    }
+
+    // Each file refers to the file of the previous parameter map in the same directory
+    ParameterMapType transformParameterMap = transformParameterMapVector[i];
+    if (i > 0)
+    {
+      transformParameterMap["InitialTransformParametersFileName"] =
+        ParameterValueVectorType(1, outputDirectory + "TransformParameters." + std::to_string(i - 1) + ".txt");
+    }
+    parameterObject->WriteParameterFile(transformParameterMap,
+                                        outputDirectory + "TransformParameters." + std::to_string(i) + ".txt");
+  }
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+template <typename TImage>
+std::string
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::ComputeImagesHash(
+  const DataObjectContainerType * const images,
+  const bool                            geometryOnly)
+{
+  if (images == nullptr)
+  {
+    return "";
+  }
+
+  std::string imageHashes;
+  for (unsigned int i = 0; i < images->Size(); ++i)
+  {
+    const auto * const image = dynamic_cast<const TImage *>(images->ElementAt(i).GetPointer());
+    if (image == nullptr)
+    {
+      itkGenericExceptionMacro(<< "The images of the registration are not of the expected type.");
+    }
+
+    std::ostringstream geometry;
+    geometry << std::setprecision(17);
+    geometry << "PixelType: " << typeid(typename TImage::PixelType).name() << "\n";
+    geometry << "Region: " << image->GetBufferedRegion().GetIndex() << " " << image->GetBufferedRegion().GetSize()
+             << "\n";
+    geometry << "Origin: " << image->GetOrigin() << "\n";
+    geometry << "Spacing: " << image->GetSpacing() << "\n";
+    geometry << "Direction:\n" << image->GetDirection() << "\n";
+
+    const std::size_t numberOfBytes =
+      geometryOnly ? 0 : image->GetBufferedRegion().GetNumberOfPixels() * sizeof(typename TImage::PixelType);
+    imageHashes += RegistrationResultCacheType::ComputeHash(geometry.str(), image->GetBufferPointer(), numberOfBytes);
+  }
+  return RegistrationResultCacheType::ComputeHash(imageHashes);
+}
+
+
+template <typename TFixedImage, typename TMovingImage>
+template <typename TImage>
+void
+ElastixRegistrationMethod<TFixedImage, TMovingImage>::AppendImagesSignature(
+  const DataObjectContainerType * const        images,
+  const unsigned int                           numberOfSamples,
+  RegistrationResultCacheType::SignatureType & signature)
+{
+  if (images == nullptr || images->Size() == 0)
+  {
+    return;
+  }
+
+  // The samples are divided over the images
+  const SizeValueType numberOfSamplesPerImage =
+    std::max<SizeValueType>(numberOfSamples / static_cast<SizeValueType>(images->Size()), 1);
+  for (unsigned int i = 0; i < images->Size(); ++i)
+  {
+    const auto * const image = dynamic_cast<const TImage *>(images->ElementAt(i).GetPointer());
+    if (image == nullptr)
+    {
+      continue;
+    }
+
+    const SizeValueType numberOfPixels = image->GetBufferedRegion().GetNumberOfPixels();
+    const SizeValueType numberOfImageSamples = std::min(numberOfSamplesPerImage, numberOfPixels);
+    if (numberOfImageSamples == 0)
+    {
+      continue;
+    }
+    const SizeValueType stride = numberOfPixels / numberOfImageSamples;
+    const auto * const  buffer = image->GetBufferPointer();
+    for (SizeValueType k = 0; k < numberOfImageSamples; ++k)
+    {
+      signature.push_back(static_cast<double>(buffer[k * stride]));
+    }
+  }
+}
+
 } // namespace itk
 
 #endif
@@ -36,6 +36,8 @@
 #define itkTransformixFilter_h
 
 #include "itkImageSource.h"
+#include "itkDefaultStaticMeshTraits.h"
+#include "itkPointSet.h"
 
 #include "elxTransformixMain.h"
 #include "elxParameterObject.h"
@@ -44,6 +46,20 @@
  * \class TransformixFilter
  * \brief ITK Filter interface to the Transformix library.
  *
+ * The moving images are used as they are, without copying: MovingInternalImagePixelType
+ * is set to the pixel type of TMovingImage, overriding the transform parameter maps.
+ * Buffers that are owned by the caller can be passed without copying by wrapping them
+ * in an image by an ImportImageFilter, with SetImportPointer(buffer, numberOfPixels, false).
+ * The result image and the deformation field are grafted onto the outputs, without
+ * copying, and the result image is not a copy of the resampler output when the
+ * ResultImagePixelType is the internal moving image pixel type.
+ *
+ * The determinant of the spatial Jacobian, the spatial Jacobian and the transformed
+ * points of the fixed point set are also kept in memory, and are available as outputs
+ * of the filter. They are only written to disk when an output directory is specified,
+ * so that no files are written at all when neither an output directory is specified,
+ * nor LogToFileOn() is called.
+ *
  * \ingroup Elastix
  */
 
@@ -87,12 +103,21 @@ public:
   typedef typename Superclass::OutputImageType OutputImageType;
   typedef typename itk::Image<itk::Vector<float, TMovingImage::ImageDimension>, TMovingImage::ImageDimension>
     OutputDeformationFieldType;
+  typedef typename itk::Image<float, TMovingImage::ImageDimension> OutputDeterminantOfSpatialJacobianType;
+  typedef typename itk::Image<itk::Matrix<float, TMovingImage::ImageDimension, TMovingImage::ImageDimension>,
+                              TMovingImage::ImageDimension>
+    OutputSpatialJacobianType;
 
   using DataObjectPointerArraySizeType = ProcessObject::DataObjectPointerArraySizeType;
 
   using InputImageType = TMovingImage;
   itkStaticConstMacro(MovingImageDimension, unsigned int, TMovingImage::ImageDimension);
 
+  /** The transformed points. The point type is the same as that of the transform. */
+  typedef DefaultStaticMeshTraits<unsigned char, MovingImageDimension, MovingImageDimension, double>
+                                                                               OutputPointSetTraitsType;
+  typedef PointSet<unsigned char, MovingImageDimension, OutputPointSetTraitsType> OutputPointSetType;
+
   /** Set/Get/Add moving image. */
   virtual void
   SetMovingImage(TMovingImage * inputImage);
@@ -101,6 +126,21 @@ public:
   virtual void
   RemoveMovingImage();
 
+  /** Add another moving image, to be resampled with the same transform. All moving
+   * images are resampled in a single run of transformix, so the transform and the
+   * other components are set up only once. They should have the same pixel type.
+   * The result of the moving image with a specific index is retrieved by
+   * GetResultImage(index); GetOutput() is the result of the first moving image.
+   */
+  virtual void
+  AddMovingImage(TMovingImage * movingImage);
+  unsigned int
+  GetNumberOfMovingImages() const;
+  const InputImageType *
+  GetMovingImage(unsigned int index) const;
+  OutputImageType *
+  GetResultImage(unsigned int index);
+
   /* Standard filter indexed input / output methods */
   void
   SetInput(InputImageType * movingImage);
@@ -161,6 +201,18 @@ public:
   const OutputDeformationFieldType *
   GetOutputDeformationField() const;
 
+  /** The determinant of the spatial Jacobian, when ComputeDeterminantOfSpatialJacobianOn(). */
+  OutputDeterminantOfSpatialJacobianType *
+  GetOutputDeterminantOfSpatialJacobian();
+
+  /** The spatial Jacobian, when ComputeSpatialJacobianOn(). */
+  OutputSpatialJacobianType *
+  GetOutputSpatialJacobian();
+
+  /** The transformed points of the fixed point set, given by SetFixedPointSetFileName(). */
+  OutputPointSetType *
+  GetOutputPointSet();
+
   /** Set/Get/Remove output directory. */
   itkSetMacro(OutputDirectory, std::string);
   itkGetConstMacro(OutputDirectory, std::string);
@@ -213,6 +265,12 @@ private:
   static bool
   IsEmpty(const InputImageType * inputImage);
 
+  /** The names of the inputs and outputs of the moving image with the specified index. */
+  static DataObjectIdentifierType
+  MakeMovingImageName(unsigned int index);
+  static DataObjectIdentifierType
+  MakeResultImageName(unsigned int index);
+
   /** Tell the compiler we want all definitions of Get/Set/Remove
    *  from ProcessObject and TransformixFilter.
    */
@@ -48,6 +48,9 @@ TransformixFilter<TMovingImage>::TransformixFilter()
   this->AddRequiredInputName("TransformParameterObject", 1);
 
   this->SetOutput("ResultDeformationField", this->MakeOutput("ResultDeformationField"));
+  this->SetOutput("ResultDeterminantOfSpatialJacobian", this->MakeOutput("ResultDeterminantOfSpatialJacobian"));
+  this->SetOutput("ResultSpatialJacobian", this->MakeOutput("ResultSpatialJacobian"));
+  this->SetOutput("ResultPointSet", this->MakeOutput("ResultPointSet"));
 
   this->m_FixedPointSetFileName = "";
   this->m_ComputeSpatialJacobian = false;
@@ -116,10 +119,8 @@ TransformixFilter<TMovingImage>::GenerateData()
   }
 
   // Setup output directory
-  // Only the input "MovingImage" does not require an output directory
-  if ((this->GetComputeSpatialJacobian() || this->GetComputeDeterminantOfSpatialJacobian() ||
-       this->GetComputeDeformationField() || !this->GetFixedPointSetFileName().empty() || this->GetLogToFile()) &&
-      this->GetOutputDirectory().empty())
+  // Only the log file requires an output directory, all results are also kept in memory
+  if (this->GetLogToFile() && this->GetOutputDirectory().empty())
   {
     this->SetOutputDirectory(".");
   }
@@ -164,12 +165,16 @@ TransformixFilter<TMovingImage>::GenerateData()
   // Instantiate transformix
   TransformixMainPointer transformix = TransformixMainType::New();
 
-  // Setup transformix for warping input image if given
+  // Setup transformix for warping the input images if given
   DataObjectContainerPointer inputImageContainer = nullptr;
   if (!this->IsEmpty(this->GetMovingImage()))
   {
     inputImageContainer = DataObjectContainerType::New();
-    inputImageContainer->InsertElement(0, const_cast<InputImageType *>(this->GetMovingImage()));
+    const unsigned int numberOfMovingImages = this->GetNumberOfMovingImages();
+    for (unsigned int i = 0; i < numberOfMovingImages; ++i)
+    {
+      inputImageContainer->InsertElement(i, const_cast<InputImageType *>(this->GetMovingImage(i)));
+    }
     transformix->SetInputImageContainer(inputImageContainer);
   }
 
@@ -192,6 +197,8 @@ TransformixFilter<TMovingImage>::GenerateData()
       ParameterValueVectorType(1, std::to_string(movingImageDimension));
     transformParameterMapVector[i]["ResultImagePixelType"] =
       ParameterValueVectorType(1, elastix::PixelType<typename TMovingImage::PixelType>::ToString());
+    transformParameterMapVector[i]["MovingInternalImagePixelType"] =
+      ParameterValueVectorType(1, elastix::PixelType<typename TMovingImage::PixelType>::ToString());
 
     if (i > 0)
     {
@@ -216,12 +223,25 @@ TransformixFilter<TMovingImage>::GenerateData()
     itkExceptionMacro("Internal transformix error: See transformix log (use LogToConsoleOn() or LogToFileOn())");
   }
 
-  // Save result image
+  // Save result images
   DataObjectContainerPointer resultImageContainer = transformix->GetResultImageContainer();
-  if (resultImageContainer.IsNotNull() && resultImageContainer->Size() > 0 &&
-      resultImageContainer->ElementAt(0).IsNotNull())
+  if (resultImageContainer.IsNotNull())
   {
-    this->GraftOutput(resultImageContainer->ElementAt(0));
+    for (unsigned int i = 0; i < resultImageContainer->Size(); ++i)
+    {
+      if (resultImageContainer->ElementAt(i).IsNull())
+      {
+        continue;
+      }
+      if (i == 0)
+      {
+        this->GraftOutput(resultImageContainer->ElementAt(0));
+      }
+      else
+      {
+        this->GraftOutput(MakeResultImageName(i), resultImageContainer->ElementAt(i));
+      }
+    }
   }
   // Optionally, save result deformation field
   DataObjectContainerPointer resultDeformationFieldContainer = transformix->GetResultDeformationFieldContainer();
@@ -230,6 +250,20 @@ TransformixFilter<TMovingImage>::GenerateData()
   {
     this->GraftOutput("ResultDeformationField", resultDeformationFieldContainer->ElementAt(0));
   }
+
+  // Optionally, save the other results that are kept in memory
+  if (transformix->GetResultDeterminantOfSpatialJacobian() != nullptr)
+  {
+    this->GraftOutput("ResultDeterminantOfSpatialJacobian", transformix->GetResultDeterminantOfSpatialJacobian());
+  }
+  if (transformix->GetResultSpatialJacobian() != nullptr)
+  {
+    this->GraftOutput("ResultSpatialJacobian", transformix->GetResultSpatialJacobian());
+  }
+  if (transformix->GetResultPointSet() != nullptr)
+  {
+    this->GraftOutput("ResultPointSet", transformix->GetResultPointSet());
+  }
 }
 
 
@@ -241,6 +275,18 @@ TransformixFilter<TMovingImage>::MakeOutput(const DataObjectIdentifierType & key
   {
     return OutputDeformationFieldType::New().GetPointer();
   }
+  else if (key == "ResultDeterminantOfSpatialJacobian")
+  {
+    return OutputDeterminantOfSpatialJacobianType::New().GetPointer();
+  }
+  else if (key == "ResultSpatialJacobian")
+  {
+    return OutputSpatialJacobianType::New().GetPointer();
+  }
+  else if (key == "ResultPointSet")
+  {
+    return OutputPointSetType::New().GetPointer();
+  }
   else
   {
     // Primary and all other outputs default to ResultImage.
@@ -271,7 +317,7 @@ TransformixFilter<TMovingImage>::GenerateOutputInformation()
 
   // Get world coordinate system from the last map
   const unsigned int     lastIndex = transformParameterObjectPtr->GetNumberOfParameterMaps() - 1;
-  const ParameterMapType transformParameterMap = transformParameterObjectPtr->GetParameterMap(lastIndex);
+  const ParameterMapType & transformParameterMap = transformParameterObjectPtr->GetParameterMap(lastIndex);
 
   ParameterMapType::const_iterator spacingMapIter = transformParameterMap.find("Spacing");
   if (spacingMapIter == transformParameterMap.end())
@@ -343,6 +389,27 @@ TransformixFilter<TMovingImage>::GenerateOutputInformation()
 
   outputPtr->SetNumberOfComponentsPerPixel(1);
   outputOutputDeformationFieldPtr->SetNumberOfComponentsPerPixel(TMovingImage::ImageDimension);
+
+  // The spatial Jacobian images share the geometry of the deformation field
+  OutputDeterminantOfSpatialJacobianType * outputDeterminantOfSpatialJacobianPtr =
+    this->GetOutputDeterminantOfSpatialJacobian();
+  OutputSpatialJacobianType * outputSpatialJacobianPtr = this->GetOutputSpatialJacobian();
+
+  outputDeterminantOfSpatialJacobianPtr->SetSpacing(outputSpacing);
+  outputSpatialJacobianPtr->SetSpacing(outputSpacing);
+  outputDeterminantOfSpatialJacobianPtr->SetOrigin(outputOrigin);
+  outputSpatialJacobianPtr->SetOrigin(outputOrigin);
+  outputDeterminantOfSpatialJacobianPtr->SetDirection(outputDirection);
+  outputSpatialJacobianPtr->SetDirection(outputDirection);
+  outputDeterminantOfSpatialJacobianPtr->SetLargestPossibleRegion(outputLargestPossibleRegion);
+  outputSpatialJacobianPtr->SetLargestPossibleRegion(outputLargestPossibleRegion);
+
+  // The results of the additional moving images share the geometry of the first one
+  const unsigned int numberOfMovingImages = this->GetNumberOfMovingImages();
+  for (unsigned int i = 1; i < numberOfMovingImages; ++i)
+  {
+    this->GetResultImage(i)->CopyInformation(outputPtr);
+  }
 }
 
 
@@ -366,9 +433,61 @@ template <typename TMovingImage>
 void
 TransformixFilter<TMovingImage>::RemoveMovingImage()
 {
+  for (unsigned int i = this->GetNumberOfMovingImages(); i > 1; --i)
+  {
+    this->ProcessObject::RemoveInput(MakeMovingImageName(i - 1));
+    this->ProcessObject::RemoveOutput(MakeResultImageName(i - 1));
+  }
   this->ProcessObject::RemoveInput("MovingImage");
 }
 
+
+template <typename TMovingImage>
+void
+TransformixFilter<TMovingImage>::AddMovingImage(TMovingImage * movingImage)
+{
+  const unsigned int index = this->GetNumberOfMovingImages();
+  if (index > 0)
+  {
+    this->SetOutput(MakeResultImageName(index), this->MakeOutput(MakeResultImageName(index)));
+  }
+  this->ProcessObject::SetInput(MakeMovingImageName(index), movingImage);
+}
+
+
+template <typename TMovingImage>
+unsigned int
+TransformixFilter<TMovingImage>::GetNumberOfMovingImages() const
+{
+  unsigned int numberOfMovingImages = 0;
+  while (this->ProcessObject::GetInput(MakeMovingImageName(numberOfMovingImages)) != nullptr)
+  {
+    ++numberOfMovingImages;
+  }
+  return numberOfMovingImages;
+}
+
+
+template <typename TMovingImage>
+const typename TransformixFilter<TMovingImage>::InputImageType *
+TransformixFilter<TMovingImage>::GetMovingImage(unsigned int index) const
+{
+  return itkDynamicCastInDebugMode<const TMovingImage *>(this->ProcessObject::GetInput(MakeMovingImageName(index)));
+}
+
+
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::OutputImageType *
+TransformixFilter<TMovingImage>::GetResultImage(unsigned int index)
+{
+  if (index == 0)
+  {
+    return this->GetOutput();
+  }
+  return itkDynamicCastInDebugMode<OutputImageType *>(this->ProcessObject::GetOutput(MakeResultImageName(index)));
+}
+
+
 template <typename TMovingImage>
 void
 TransformixFilter<TMovingImage>::SetInput(InputImageType * inputImage)
@@ -460,6 +579,32 @@ TransformixFilter<TMovingImage>::GetOutputDeformationField() const
 }
 
 
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::OutputDeterminantOfSpatialJacobianType *
+TransformixFilter<TMovingImage>::GetOutputDeterminantOfSpatialJacobian()
+{
+  return itkDynamicCastInDebugMode<OutputDeterminantOfSpatialJacobianType *>(
+    this->itk::ProcessObject::GetOutput("ResultDeterminantOfSpatialJacobian"));
+}
+
+
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::OutputSpatialJacobianType *
+TransformixFilter<TMovingImage>::GetOutputSpatialJacobian()
+{
+  return itkDynamicCastInDebugMode<OutputSpatialJacobianType *>(
+    this->itk::ProcessObject::GetOutput("ResultSpatialJacobian"));
+}
+
+
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::OutputPointSetType *
+TransformixFilter<TMovingImage>::GetOutputPointSet()
+{
+  return itkDynamicCastInDebugMode<OutputPointSetType *>(this->itk::ProcessObject::GetOutput("ResultPointSet"));
+}
+
+
 template <typename TMovingImage>
 typename TransformixFilter<TMovingImage>::OutputImageType *
 TransformixFilter<TMovingImage>::GetOutput()
@@ -506,6 +651,23 @@ TransformixFilter<TMovingImage>::IsEmpty(const InputImageType * inputImage)
 }
 
 
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::DataObjectIdentifierType
+TransformixFilter<TMovingImage>::MakeMovingImageName(unsigned int index)
+{
+  return (index == 0) ? "MovingImage" : "MovingImage" + std::to_string(index);
+}
+
+
+template <typename TMovingImage>
+typename TransformixFilter<TMovingImage>::DataObjectIdentifierType
+TransformixFilter<TMovingImage>::MakeResultImageName(unsigned int index)
+{
+  // Only used for the additional moving images: the result of the first one is the primary output.
+  return "ResultImage" + std::to_string(index);
+}
+
+
 template <typename TMovingImage>
 void
 TransformixFilter<TMovingImage>::SetLogFileName(std::string logFileName)
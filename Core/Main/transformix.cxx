@@ -27,50 +27,26 @@
 #include <itkTimeProbe.h>
 
 // Standard C++ header files:
+#include <cctype> // For isspace.
 #include <iostream>
+#include <string>
+#include <vector>
 
 
+namespace
+{
+/** Some typedef's.*/
+typedef elx::TransformixMain                 TransformixMainType;
+typedef TransformixMainType::Pointer         TransformixMainPointer;
+typedef TransformixMainType::ArgumentMapType ArgumentMapType;
+typedef ArgumentMapType::value_type          ArgumentMapEntryType;
+
+/** Runs transformix with the specified command line arguments (argv[1], argv[2], ...).
+ * Returns the error code of transformix, which is zero on success.
+ */
 int
-main(int argc, char ** argv)
+RunTransformix(const std::vector<std::string> & arguments, const std::string & argv0, const bool setupCout)
 {
-  elastix::BaseComponent::InitializeElastixExecutable();
-  assert(!elastix::BaseComponent::IsElastixLibrary());
-
-  /** Check if "-help" or "--version" was asked for.*/
-  if (argc == 1)
-  {
-    std::cout << "Use \"transformix --help\" for information about transformix-usage." << std::endl;
-    return 0;
-  }
-  else if (argc == 2)
-  {
-    std::string argument(argv[1]);
-    if (argument == "-help" || argument == "--help" || argument == "-h")
-    {
-      PrintHelp();
-      return 0;
-    }
-    else if (argument == "--version")
-    {
-      std::cout << "transformix version: " ELASTIX_VERSION_STRING << std::endl;
-      return 0;
-    }
-    else
-    {
-      std::cout << "Use \"transformix --help\" for information about transformix-usage." << std::endl;
-      return 0;
-    }
-  }
-
-  /** Some typedef's.*/
-  typedef elx::TransformixMain                 TransformixMainType;
-  typedef TransformixMainType::Pointer         TransformixMainPointer;
-  typedef TransformixMainType::ArgumentMapType ArgumentMapType;
-  typedef ArgumentMapType::value_type          ArgumentMapEntryType;
-
-  /** Support Mevis Dicom Tiff (if selected in cmake) */
-  RegisterMevisDicomTiff();
-
   /** Declare an instance of the Transformix class. */
   TransformixMainPointer transformix;
 
@@ -82,10 +58,10 @@ main(int argc, char ** argv)
   std::string     logFileName = "";
 
   /** Put command line parameters into parameterFileList. */
-  for (unsigned int i = 1; static_cast<long>(i) < argc - 1; i += 2)
+  for (std::size_t i = 0; i + 1 < arguments.size(); i += 2)
   {
-    std::string key(argv[i]);
-    std::string value(argv[i + 1]);
+    std::string key(arguments[i]);
+    std::string value(arguments[i + 1]);
 
     if (key == "-out")
     {
@@ -119,7 +95,7 @@ main(int argc, char ** argv)
   } // end for loop
 
   /** The argv0 argument, required for finding the component.dll/so's. */
-  argMap.insert(ArgumentMapEntryType("-argv0", argv[0]));
+  argMap.insert(ArgumentMapEntryType("-argv0", argv0));
 
   /** Check that the option "-tp" is given. */
   if (argMap.count("-tp") == 0)
@@ -129,15 +105,16 @@ main(int argc, char ** argv)
   }
 
   /** Check that at least one of the following options is given. */
-  if (argMap.count("-in") == 0 && argMap.count("-ipp") == 0 && argMap.count("-def") == 0 && argMap.count("-jac") == 0 &&
-      argMap.count("-jacmat") == 0)
+  if (argMap.count("-in") == 0 && argMap.count("-in0") == 0 && argMap.count("-ipp") == 0 && argMap.count("-def") == 0 &&
+      argMap.count("-jac") == 0 && argMap.count("-jacmat") == 0 && argMap.count("-inv") == 0)
   {
     std::cerr << "ERROR: At least one of the CommandLine options \"-in\", "
-              << "\"-def\", \"-jac\", or \"-jacmat\" should be given!" << std::endl;
+              << "\"-def\", \"-jac\", \"-jacmat\", or \"-inv\" should be given!" << std::endl;
     returndummy |= -1;
   }
 
   /** Check if the -out option is given and setup xout. */
+  const elx::xoutManager manager{};
   if (outFolderPresent)
   {
     /** Check if the output directory exists. */
@@ -152,7 +129,7 @@ main(int argc, char ** argv)
     {
       /** Setup xout. */
       logFileName = argMap["-out"] + "transformix.log";
-      int returndummy2 = elx::xoutSetup(logFileName.c_str(), true, true);
+      int returndummy2 = elx::xoutSetup(logFileName.c_str(), true, setupCout);
       if (returndummy2)
       {
         std::cerr << "ERROR while setting up xout." << std::endl;
@@ -180,7 +157,7 @@ main(int argc, char ** argv)
   elxout << "transformix is started at " << GetCurrentDateAndTime() << ".\n" << std::endl;
 
   /** Print where transformix was run. */
-  elxout << "which transformix:   " << argv[0] << std::endl;
+  elxout << "which transformix:   " << argv0 << std::endl;
   itksys::SystemInformation info;
   info.RunCPUCheck();
   info.RunOSCheck();
@@ -222,6 +199,162 @@ main(int argc, char ** argv)
   /** Exit and return the error code. */
   return returndummy;
 
+} // end RunTransformix()
+
+
+/** Splits a request of the service mode into its arguments, which are separated by white space.
+ * An argument that contains white space, like a file name, can be put between double quotes.
+ */
+std::vector<std::string>
+SplitRequest(const std::string & request)
+{
+  std::vector<std::string> arguments;
+  std::string              argument;
+  bool                     inArgument = false;
+  bool                     inQuotes = false;
+
+  for (const char c : request)
+  {
+    if (c == '"')
+    {
+      inQuotes = !inQuotes;
+      inArgument = true;
+    }
+    else if (!inQuotes && std::isspace(static_cast<unsigned char>(c)))
+    {
+      if (inArgument)
+      {
+        arguments.push_back(argument);
+        argument.clear();
+        inArgument = false;
+      }
+    }
+    else
+    {
+      argument.push_back(c);
+      inArgument = true;
+    }
+  }
+  if (inArgument)
+  {
+    arguments.push_back(argument);
+  }
+  return arguments;
+
+} // end SplitRequest()
+
+
+/** Runs transformix as a service: reads the requests from the standard input, one per line, each
+ * with the command line arguments of a single transformix run, and answers every request with a
+ * line "transformix: <error code>" on the standard output, after the run. Stops at the end of the
+ * input, or at a line "quit". The parsed transform parameter files and the OpenCL context are kept
+ * between the requests, so a client that transforms many images or point sets with the same
+ * transforms does not pay the start-up costs of transformix for each of them.
+ */
+int
+ServeTransformix(const std::string & argv0)
+{
+  elx::Configuration::SetParameterFileCaching(true);
+  TransformixMainType::SetKeepOpenCLContext(true);
+
+  std::string request;
+  while (std::getline(std::cin, request))
+  {
+    const std::vector<std::string> arguments = SplitRequest(request);
+    if (arguments.empty())
+    {
+      continue;
+    }
+    if (arguments.size() == 1 && arguments.front() == "quit")
+    {
+      break;
+    }
+
+    int errorCode = 0;
+    try
+    {
+      errorCode = RunTransformix(arguments, argv0, false);
+    }
+    catch (const std::exception & excp)
+    {
+      std::cerr << "ERROR: " << excp.what() << std::endl;
+      errorCode = 1;
+    }
+    std::cout << "transformix: " << errorCode << std::endl;
+  }
+
+  TransformixMainType::SetKeepOpenCLContext(false);
+  TransformixMainType::ReleaseOpenCLContext();
+  elx::Configuration::SetParameterFileCaching(false);
+  return 0;
+
+} // end ServeTransformix()
+
+} // end unnamed namespace
+
+
+int
+main(int argc, char ** argv)
+{
+  elastix::BaseComponent::InitializeElastixExecutable();
+  assert(!elastix::BaseComponent::IsElastixLibrary());
+
+  /** Set the priority and the CPU affinity of the process, before any other thread is created, so
+   * that these apply to all threads of the process.
+   */
+  std::string priority;
+  std::string cpuList;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (std::string(argv[i]) == "-priority")
+    {
+      priority = argv[i + 1];
+    }
+    else if (std::string(argv[i]) == "-affinity")
+    {
+      cpuList = argv[i + 1];
+    }
+  }
+  TransformixMainType::SetProcessPriorityAndAffinity(priority, cpuList);
+
+  /** Check if "-help" or "--version" was asked for.*/
+  if (argc == 1)
+  {
+    std::cout << "Use \"transformix --help\" for information about transformix-usage." << std::endl;
+    return 0;
+  }
+  else if (argc == 2)
+  {
+    std::string argument(argv[1]);
+    if (argument == "-help" || argument == "--help" || argument == "-h")
+    {
+      PrintHelp();
+      return 0;
+    }
+    else if (argument == "--version")
+    {
+      std::cout << "transformix version: " ELASTIX_VERSION_STRING << std::endl;
+      return 0;
+    }
+    else if (argument == "--serve")
+    {
+      /** Support Mevis Dicom Tiff (if selected in cmake) */
+      RegisterMevisDicomTiff();
+
+      return ServeTransformix(argv[0]);
+    }
+    else
+    {
+      std::cout << "Use \"transformix --help\" for information about transformix-usage." << std::endl;
+      return 0;
+    }
+  }
+
+  /** Support Mevis Dicom Tiff (if selected in cmake) */
+  RegisterMevisDicomTiff();
+
+  return RunTransformix(std::vector<std::string>(argv + 1, argv + argc), argv[0], true);
+
 } // end main
 
 
@@ -240,7 +373,8 @@ PrintHelp(void)
                "generates a deformation field.\n"
             << "The transform is specified in the transform-parameter file.\n"
             << "  --help, -h displays this message and exit\n"
-            << "  --version  output version information and exit\n\n";
+            << "  --version  output version information and exit\n"
+            << "  --serve    run as a service, see below\n\n";
 
   /** Mandatory arguments. */
   std::cout << "Call transformix from the command line with mandatory arguments:\n"
@@ -250,6 +384,8 @@ PrintHelp(void)
   /** Optional arguments. */
   std::cout << "Optional extra commands:\n"
             << "  -in       input image to deform\n"
+            << "            use \"-in0 <image0> -in1 <image1> ...\" to deform multiple images of the same\n"
+            << "            type with a single run, which writes result.0, result.1, etc.\n"
             << "  -def      file containing input-image points; the point are transformed\n"
             << "            according to the specified transform-parameter file\n"
             << "            use \"-def all\" to transform all points from the input-image, which\n"
@@ -258,10 +394,14 @@ PrintHelp(void)
             << "            spatial Jacobian\n"
             << "  -jacmat   use \"-jacmat all\" to generate an image with the spatial Jacobian\n"
             << "            matrix at each voxel\n"
+            << "  -inv      use \"-inv all\" to generate the deformation field of the inverse\n"
+            << "            transform, which maps the moving image to the fixed image\n"
             << "  -priority set the process priority to high, abovenormal, normal (default),\n"
-            << "            belownormal, or idle (Windows only option)\n"
+            << "            belownormal, or idle\n"
+            << "  -affinity limit transformix to a list of CPUs, e.g. \"0-3,8\" (Linux only option)\n"
             << "  -threads  set the maximum number of threads of transformix\n"
-            << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n\n";
+            << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", \"-jacmat\", or \"-inv\" should be "
+            << "given.\n\n";
 
   /** The parameter file. */
   std::cout << "The transform-parameter file must contain all the information "
@@ -269,6 +409,15 @@ PrintHelp(void)
                "to use, with which parameters, etc. For a usable transform-parameter file, "
                "run elastix, and inspect the output file \"TransformParameters.0.txt\".\n\n";
 
+  /** The service mode. */
+  std::cout << "With \"transformix --serve\", transformix reads requests from the standard input, "
+               "one per line, each with the arguments of a single run, as they would be given on the "
+               "command line. Every request is answered by a line \"transformix: <error code>\" on the "
+               "standard output. Between the requests, the transform-parameter files that have not been "
+               "modified and the OpenCL context are reused. The service stops at the end of the input, "
+               "or at a line \"quit\". The -priority of a request applies to the process from then on, its "
+               "-affinity only to the request.\n\n";
+
   std::cout << "Need further help? Please check:\n"
                " * the elastix website: https://elastix.lumc.nl\n"
                " * the source code repository site: https://github.com/SuperElastix/elastix\n"
@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Recreate the transform parameter file of an iteration from a transform parameters log.
+
+ The log is written by elastix, with (WriteTransformParametersEachIteration "true") and
+ (TransformParametersEachIterationFormat "log"). See itk::TransformParametersLog.
+ */
+#include "itkCommandLineArgumentParser.h"
+#include "itkTransformParametersLog.h"
+
+#include <fstream>
+#include <iostream>
+
+/**
+ * ******************* GetHelpString *******************
+ */
+
+std::string
+GetHelpString(void)
+{
+  std::stringstream ss;
+  ss << "Usage:" << std::endl
+     << "elxMaterializeTransformParameters" << std::endl
+     << "  -in    transform parameters log, TransformParametersLog.<level>.bin\n"
+     << "  -out   output transform parameters filename\n"
+     << "  -r     resolution\n"
+     << "  [-it]  iteration, default the last iteration of the resolution";
+  return ss.str();
+
+} // end GetHelpString()
+
+
+int
+main(int argc, char ** argv)
+{
+  /** Create command line argument parser. */
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments(argc, argv);
+  parser->SetProgramHelpText(GetHelpString());
+
+  parser->MarkArgumentAsRequired("-in", "The transform parameters log.");
+  parser->MarkArgumentAsRequired("-out", "The output transform parameters filename.");
+  parser->MarkArgumentAsRequired("-r", "The resolution.");
+
+  itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+
+  if (validateArguments == itk::CommandLineArgumentParser::FAILED)
+  {
+    return EXIT_FAILURE;
+  }
+  else if (validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED)
+  {
+    return EXIT_SUCCESS;
+  }
+
+  std::string logFileName;
+  parser->GetCommandLineArgument("-in", logFileName);
+
+  std::string outputFileName;
+  parser->GetCommandLineArgument("-out", outputFileName);
+
+  unsigned long resolution = 0;
+  parser->GetCommandLineArgument("-r", resolution);
+
+  unsigned long iteration = itk::TransformParametersLog::LastIteration;
+  parser->GetCommandLineArgument("-it", iteration);
+
+  /** Read the log, and write the transform parameter file. */
+  std::string text;
+  try
+  {
+    text = itk::TransformParametersLog::ReadTransformParameterFileText(logFileName, resolution, iteration);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp.GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream outputFile(outputFileName);
+  outputFile << text;
+  if (!outputFile)
+  {
+    std::cerr << "ERROR: File \"" << outputFileName << "\" could not be written!" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main()
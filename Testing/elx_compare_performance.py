@@ -0,0 +1,91 @@
+import sys
+import os
+import os.path
+import json
+import shutil
+from optparse import OptionParser
+
+#-------------------------------------------------------------------------------
+# the main function
+# This python script compares the measurements of a performance test, as written
+# by elx_run_performance.py, with a baseline file of the same format. A regression
+# is reported when the wall time, the peak RSS or the time of a phase exceeds its
+# baseline value by more than the tolerance. Phases that take less than a minimum
+# time in the baseline are not compared, because their timing is dominated by noise.
+#
+# Timings depend on the machine, so baselines are site specific. When the baseline
+# file does not exist, the comparison passes, and the measurements can be stored as
+# the new baseline with the option -u.
+
+def main():
+    # usage, parse parameters
+    usage = "usage: %prog [options] arg"
+    parser = OptionParser( usage )
+
+    # option to debug and verbose
+    parser.add_option( "-v", "--verbose", action="store_true", dest="verbose" )
+
+    # options to control files
+    parser.add_option( "-b", "--baseline", dest="baseline", help="baseline JSON file" )
+    parser.add_option( "-d", "--result", dest="result", help="JSON file with the measurements" )
+    parser.add_option( "-t", "--tolerance", dest="tolerance", type="float", default=0.2,
+        help="allowed relative increase, default 0.2" )
+    parser.add_option( "-m", "--minimumtime", dest="minimumTime", type="float", default=0.5,
+        help="minimum baseline time in seconds of a phase to be compared, default 0.5" )
+    parser.add_option( "-u", "--update", action="store_true", dest="update",
+        help="store the measurements as the new baseline" )
+
+    (options, args) = parser.parse_args()
+
+    # Check if option -b and -d are given
+    if options.baseline == None :
+        parser.error( "The option baseline (-b) should be given" )
+    if options.result == None :
+        parser.error( "The option result (-d) should be given" )
+
+    with open( options.result ) as resultFile:
+        result = json.load( resultFile )
+
+    if options.update:
+        shutil.copyfile( options.result, options.baseline )
+        print( "The measurements are stored as baseline '" + options.baseline + "'" )
+        return 0
+
+    if not os.path.exists( options.baseline ):
+        print( "No baseline '" + options.baseline + "' exists, so no comparison is done" )
+        return 0
+
+    with open( options.baseline ) as baselineFile:
+        baseline = json.load( baselineFile )
+
+    # Collect the quantities to compare: ( name, baseline value, value, unit )
+    quantities = [ ( "wall time", baseline.get( "wall_time" ), result.get( "wall_time" ), "s" ),
+        ( "peak RSS", baseline.get( "peak_rss_mb" ), result.get( "peak_rss_mb" ), "MB" ) ]
+    for phase, seconds in sorted( baseline.get( "phases", {} ).items() ):
+        if seconds >= options.minimumTime:
+            quantities.append( ( "phase " + phase, seconds, result.get( "phases", {} ).get( phase ), "s" ) )
+
+    regressions = 0
+    for name, baselineValue, value, unit in quantities:
+        if baselineValue == None or value == None :
+            continue
+        ratio = value / baselineValue if baselineValue > 0 else 1.0
+        message = name + ": " + "%.3f" % value + " " + unit + ", baseline " + "%.3f" % baselineValue + " " + unit \
+            + " (" + "%+.1f" % ( 100.0 * ( ratio - 1.0 ) ) + "%)"
+        if ratio > 1.0 + options.tolerance:
+            print( "REGRESSION: " + message )
+            regressions = regressions + 1
+        elif options.verbose:
+            print( message )
+
+    if regressions > 0:
+        print( "ERROR: " + str( regressions ) + " of the measurements exceed the baseline by more than "
+            + "%.0f" % ( 100.0 * options.tolerance ) + "%" )
+        return 1
+
+    print( "SUCCESS: the measurements are within " + "%.0f" % ( 100.0 * options.tolerance ) + "% of the baseline" )
+    return 0
+
+#-------------------------------------------------------------------------------
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,112 @@
+import sys, subprocess
+import os
+import os.path
+import glob
+import json
+import platform
+import time
+from optparse import OptionParser
+
+#-------------------------------------------------------------------------------
+# the main function
+# This python script runs elastix or transformix once, and records the wall time,
+# the maximum resident set size (peak RSS) and, for elastix, the wall times of the
+# phases of the registration in a JSON file, which can be compared to a baseline
+# with elx_compare_performance.py.
+#
+# The phase times are taken from the files Timings.<level>.json, which elastix
+# writes when (WriteTimings "true") is specified. To this end, the parameter files
+# are copied to the output directory, with this parameter appended.
+
+def main():
+    # usage, parse parameters
+    usage = "usage: %prog [options] executable arguments"
+    parser = OptionParser( usage )
+    parser.disable_interspersed_args()
+
+    # option to debug and verbose
+    parser.add_option( "-v", "--verbose", action="store_true", dest="verbose" )
+
+    # options to control files
+    parser.add_option( "-n", "--name", dest="name", help="name of the performance test" )
+    parser.add_option( "-r", "--result", dest="result", help="JSON file to write the measurements to" )
+
+    (options, args) = parser.parse_args()
+
+    # Check if the options and the command are given
+    if options.name == None :
+        parser.error( "The option name (-n) should be given" )
+    if options.result == None :
+        parser.error( "The option result (-r) should be given" )
+    if len( args ) == 0 :
+        parser.error( "The executable should be given" )
+
+    # Find the output directory in the arguments
+    command = list( args )
+    if "-out" not in command[ :-1 ] :
+        print( "ERROR: the command line option -out should be given" )
+        return 1
+    outputDirectory = command[ command.index( "-out" ) + 1 ]
+
+    # Let elastix write the phase times, by appending WriteTimings to copies of the parameter files
+    for f in glob.glob( os.path.join( outputDirectory, "Timings.*.json" ) ):
+        os.remove( f )
+    for i in range( 1, len( command ) - 1 ):
+        if command[ i ] == "-p":
+            copiedFileName = os.path.join( outputDirectory, "PerformanceParameters." + str( i ) + ".txt" )
+            with open( command[ i + 1 ] ) as parameterFile:
+                parameters = parameterFile.read()
+            with open( copiedFileName, "w" ) as copiedFile:
+                copiedFile.write( parameters + "\n(WriteTimings \"true\")\n" )
+            command[ i + 1 ] = copiedFileName
+
+    if options.verbose:
+        print( "Running: " + " ".join( command ) )
+
+    # Run the executable, and measure its wall time
+    startTime = time.time()
+    returnCode = subprocess.call( command, stdout=subprocess.DEVNULL )
+    wallTime = time.time() - startTime
+
+    if returnCode != 0:
+        print( "ERROR: " + command[ 0 ] + " returned " + str( returnCode ) )
+        return 1
+
+    # The peak RSS of the child process, in megabytes; not available on Windows
+    peakRSS = None
+    try:
+        import resource
+        maxrss = resource.getrusage( resource.RUSAGE_CHILDREN ).ru_maxrss
+        # ru_maxrss is in bytes on macOS, and in kilobytes elsewhere
+        peakRSS = maxrss / ( 1024.0 * 1024.0 ) if platform.system() == "Darwin" else maxrss / 1024.0
+    except ImportError:
+        pass
+
+    # Collect the phase times of all elastix levels
+    phases = {}
+    for f in sorted( glob.glob( os.path.join( outputDirectory, "Timings.*.json" ) ) ):
+        level = os.path.basename( f ).split( "." )[ 1 ]
+        with open( f ) as timingsFile:
+            for phase, seconds in json.load( timingsFile ).items():
+                phases[ level + "." + phase ] = seconds
+
+    # Write the measurements
+    result = {
+        "name": options.name,
+        "host": platform.node(),
+        "wall_time": wallTime,
+        "peak_rss_mb": peakRSS,
+        "phases": phases }
+    with open( options.result, "w" ) as resultFile:
+        json.dump( result, resultFile, indent=2, sort_keys=True )
+        resultFile.write( "\n" )
+
+    print( "Wall time: " + "%.3f" % wallTime + " s" )
+    if peakRSS != None:
+        print( "Peak RSS: " + "%.1f" % peakRSS + " MB" )
+    print( "The measurements are written to '" + options.result + "'" )
+    return 0
+
+#-------------------------------------------------------------------------------
+if __name__ == '__main__':
+    sys.exit(main())
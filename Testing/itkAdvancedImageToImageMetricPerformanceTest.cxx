@@ -0,0 +1,275 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkImageRandomSampler.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreaderBase.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <utility> // For pair.
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test times GetValueAndDerivative() of the metrics, for combinations of
+// transforms, interpolators, numbers of samples and numbers of threads, on synthetic
+// images. Each combination is reported as one comma separated line on std::cout, so
+// that the timings can be compared between versions:
+//   metric,transform,interpolator,samples,threads,seconds_per_call
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef float                                                PixelType;
+typedef itk::Image<PixelType, Dimension>                     ImageType;
+typedef itk::AdvancedTransform<double, Dimension, Dimension> TransformType;
+typedef itk::InterpolateImageFunction<ImageType, double>     InterpolatorType;
+
+typedef itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>           MeanSquaresMetricType;
+typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<ImageType, ImageType> NormalizedCorrelationMetricType;
+typedef itk::ParzenWindowMutualInformationImageToImageMetric<ImageType, ImageType> MattesMutualInformationMetricType;
+
+
+/** Creates an image with a smooth blob, centered at the given position. */
+ImageType::Pointer
+CreateBlobImage(const double center)
+{
+  ImageType::SizeType size;
+  size.Fill(64);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<PixelType>(100.0 * std::exp(-squaredDistance / 200.0)));
+  }
+  return image;
+}
+
+
+/** Sets up a B-spline transform with a grid of 10^3 control points, and a smooth deformation. */
+template <class TBSplineTransform>
+typename TBSplineTransform::Pointer
+CreateBSplineTransform(void)
+{
+  const auto                              transform = TBSplineTransform::New();
+  typename TBSplineTransform::SizeType    gridSize;
+  typename TBSplineTransform::SpacingType gridSpacing;
+  typename TBSplineTransform::OriginType  gridOrigin;
+  gridSize.Fill(10);
+  gridSpacing.Fill(9.0);
+  gridOrigin.Fill(-9.0);
+  transform->SetGridRegion(typename TBSplineTransform::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  typename TBSplineTransform::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.1 * static_cast<double>((i * 5) % 7) - 0.3;
+  }
+  transform->SetParameters(parameters);
+  return transform;
+}
+
+
+/** Sets the options that elastix sets for the metric by default. Only the mutual information has any. */
+template <class TMetric>
+void
+SetDefaultOptions(TMetric &)
+{}
+
+
+void
+SetDefaultOptions(MattesMutualInformationMetricType & metric)
+{
+  metric.SetUseDerivative(true);
+  metric.SetUseExplicitPDFDerivatives(false);
+}
+
+
+/** Returns the mean time of GetValueAndDerivative() of the metric, in seconds per call. */
+template <class TMetric>
+double
+TimeGetValueAndDerivative(const ImageType::Pointer & fixedImage,
+                          const ImageType::Pointer & movingImage,
+                          TransformType &            transform,
+                          InterpolatorType &         interpolator,
+                          const unsigned long        numberOfSamples,
+                          const itk::ThreadIdType    numberOfThreads,
+                          const unsigned int         numberOfCalls)
+{
+  typedef itk::ImageRandomSampler<ImageType> SamplerType;
+  const auto                                 sampler = SamplerType::New();
+  sampler->SetNumberOfSamples(numberOfSamples);
+
+  const auto metric = TMetric::New();
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  metric->SetTransform(&transform);
+  metric->SetInterpolator(&interpolator);
+  metric->SetImageSampler(sampler);
+  metric->SetUseMultiThread(true);
+  metric->SetNumberOfWorkUnits(numberOfThreads);
+  SetDefaultOptions(*metric);
+  metric->Initialize();
+
+  const typename TMetric::TransformParametersType parameters = transform.GetParameters();
+  typename TMetric::MeasureType                   value{};
+  typename TMetric::DerivativeType                derivative;
+
+  /** The first call also samples the fixed image, so it is not timed. */
+  metric->GetValueAndDerivative(parameters, value, derivative);
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for (unsigned int i = 0; i < numberOfCalls; ++i)
+  {
+    metric->GetValueAndDerivative(parameters, value, derivative);
+  }
+  timer.Stop();
+  return timer.GetTotal() / numberOfCalls;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** The number of calls to GetValueAndDerivative(). Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int numberOfCalls = 2;
+#else
+  const unsigned int numberOfCalls = 20;
+#endif
+
+  const ImageType::Pointer fixedImage = CreateBlobImage(30.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(33.0);
+
+  /** The transforms. */
+  typedef itk::AdvancedMatrixOffsetTransformBase<double, Dimension, Dimension> AffineTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>       BSplineTransformType;
+  typedef itk::RecursiveBSplineTransform<double, Dimension, 3>                RecursiveBSplineTransformType;
+  const std::pair<std::string, TransformType::Pointer> transforms[] = {
+    { "Affine", AffineTransformType::New().GetPointer() },
+    { "BSpline", CreateBSplineTransform<BSplineTransformType>().GetPointer() },
+    { "RecursiveBSpline", CreateBSplineTransform<RecursiveBSplineTransformType>().GetPointer() }
+  };
+
+  /** The interpolators. */
+  typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>  LinearInterpolatorType;
+  typedef itk::BSplineInterpolateImageFunction<ImageType, double, double> BSplineInterpolatorType;
+  const auto bsplineInterpolator = BSplineInterpolatorType::New();
+  bsplineInterpolator->SetSplineOrder(3);
+  const std::pair<std::string, InterpolatorType::Pointer> interpolators[] = {
+    { "Linear", LinearInterpolatorType::New().GetPointer() }, { "BSpline3", bsplineInterpolator.GetPointer() }
+  };
+
+  const unsigned long samples[] = { 2048, 16384 };
+
+  /** The parallel efficiency follows from the timings for 1, 2, 4, ... threads. */
+  std::vector<itk::ThreadIdType> threads;
+  const itk::ThreadIdType        maximumNumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  for (itk::ThreadIdType numberOfThreads = 1; numberOfThreads < maximumNumberOfThreads; numberOfThreads *= 2)
+  {
+    threads.push_back(numberOfThreads);
+  }
+  threads.push_back(maximumNumberOfThreads);
+
+  std::cout << "metric,transform,interpolator,samples,threads,seconds_per_call" << std::endl;
+  for (const auto & transform : transforms)
+  {
+    for (const auto & interpolator : interpolators)
+    {
+      for (const auto numberOfSamples : samples)
+      {
+        for (const auto numberOfThreads : threads)
+        {
+          const std::string combination = transform.first + "," + interpolator.first + "," +
+                                          std::to_string(numberOfSamples) + "," + std::to_string(numberOfThreads);
+          try
+          {
+            std::cout << "AdvancedMeanSquares," << combination << ","
+                      << TimeGetValueAndDerivative<MeanSquaresMetricType>(fixedImage,
+                                                                          movingImage,
+                                                                          *transform.second,
+                                                                          *interpolator.second,
+                                                                          numberOfSamples,
+                                                                          numberOfThreads,
+                                                                          numberOfCalls)
+                      << std::endl;
+            std::cout << "AdvancedNormalizedCorrelation," << combination << ","
+                      << TimeGetValueAndDerivative<NormalizedCorrelationMetricType>(fixedImage,
+                                                                                    movingImage,
+                                                                                    *transform.second,
+                                                                                    *interpolator.second,
+                                                                                    numberOfSamples,
+                                                                                    numberOfThreads,
+                                                                                    numberOfCalls)
+                      << std::endl;
+            std::cout << "AdvancedMattesMutualInformation," << combination << ","
+                      << TimeGetValueAndDerivative<MattesMutualInformationMetricType>(fixedImage,
+                                                                                      movingImage,
+                                                                                      *transform.second,
+                                                                                      *interpolator.second,
+                                                                                      numberOfSamples,
+                                                                                      numberOfThreads,
+                                                                                      numberOfCalls)
+                      << std::endl;
+          }
+          catch (const itk::ExceptionObject & excp)
+          {
+            std::cerr << "ERROR: " << combination << ": " << excp << std::endl;
+            return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
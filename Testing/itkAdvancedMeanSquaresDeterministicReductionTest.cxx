@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the AdvancedMeanSquaresImageToImageMetric with UseDeterministicReduction gives
+ * bit-identical values and derivatives for any number of threads, with static and with dynamic
+ * sample scheduling, over several blocks of samples. */
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef float                                                            PixelType;
+typedef itk::Image<PixelType, Dimension>                                 ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>    TransformType;
+typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>   InterpolatorType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType> MetricType;
+
+
+/** Creates an image with a smooth blob, centered at the given position. */
+ImageType::Pointer
+CreateBlobImage(const double center)
+{
+  ImageType::SizeType size;
+  size.Fill(40);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center - d;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<PixelType>(100.0 * std::exp(-squaredDistance / 150.0)));
+  }
+  return image;
+}
+
+
+/** Returns the value and derivative of the metric with deterministic reduction, for the given
+ * number of threads. The full sampler gives 40^3 samples, which is several blocks.
+ */
+void
+ComputeValueAndDerivative(const ImageType::Pointer &   fixedImage,
+                          const ImageType::Pointer &   movingImage,
+                          TransformType &              transform,
+                          const itk::ThreadIdType      numberOfThreads,
+                          const bool                   useDynamicSampleScheduling,
+                          MetricType::MeasureType &    value,
+                          MetricType::DerivativeType & derivative)
+{
+  const auto metric = MetricType::New();
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  metric->SetTransform(&transform);
+  metric->SetInterpolator(InterpolatorType::New());
+  metric->SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+  metric->SetUseMultiThread(true);
+  metric->SetNumberOfWorkUnits(numberOfThreads);
+  metric->SetUseDynamicSampleScheduling(useDynamicSampleScheduling);
+  metric->SetUseDeterministicReduction(true);
+  metric->Initialize();
+  metric->GetValueAndDerivative(transform.GetParameters(), value, derivative);
+
+  /** GetValue() takes the same deterministic path. */
+  if (metric->GetValue(transform.GetParameters()) != value)
+  {
+    itkGenericExceptionMacro(<< "GetValue() differs from GetValueAndDerivative() for " << numberOfThreads
+                             << " threads.");
+  }
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const ImageType::Pointer fixedImage = CreateBlobImage(18.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(20.0);
+
+  /** A B-spline transform with a grid of 8^3 control points, and a smooth deformation. */
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(8);
+  gridSpacing.Fill(8.0);
+  gridOrigin.Fill(-8.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.1 * static_cast<double>((i * 5) % 7) - 0.3;
+  }
+  transform->SetParameters(parameters);
+
+  try
+  {
+    MetricType::MeasureType    referenceValue{};
+    MetricType::DerivativeType referenceDerivative;
+    ComputeValueAndDerivative(fixedImage, movingImage, *transform, 1, false, referenceValue, referenceDerivative);
+
+    const itk::ThreadIdType threads[] = { 2, 3, 8 };
+    for (const bool useDynamicSampleScheduling : { false, true })
+    {
+      for (const itk::ThreadIdType numberOfThreads : threads)
+      {
+        MetricType::MeasureType    value{};
+        MetricType::DerivativeType derivative;
+        ComputeValueAndDerivative(
+          fixedImage, movingImage, *transform, numberOfThreads, useDynamicSampleScheduling, value, derivative);
+
+        std::cerr << numberOfThreads << " threads, dynamic scheduling " << useDynamicSampleScheduling
+                  << ": value " << value << " (1 thread: " << referenceValue << ")" << std::endl;
+        if (value != referenceValue || derivative != referenceDerivative)
+        {
+          std::cerr << "ERROR: the value or derivative for " << numberOfThreads
+                    << " threads differs from the one for 1 thread." << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,218 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests the matrix exponential of the AffineLogTransform, and its derivatives, which are computed together
+ * by scaling and squaring: the matrix against vnl_matrix_exp(), the Jacobian of the spatial Jacobian against
+ * central differences of vnl_matrix_exp(), and GetJacobian() and EvaluateJacobianWithImageGradientProduct()
+ * against central differences of TransformPoint(). The log-domain matrices have an infinity norm below 0.5,
+ * without squaring, and above it, with several squarings, in 2D and 3D. */
+
+#include "AffineLogTransform/itkAffineLogTransform.h"
+
+#include <vnl/vnl_matrix_exp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+/** Returns the matrix exponential by vnl_matrix_exp(), with a tighter truncation error than its default, so that
+ * central differences of it are accurate. */
+vnl_matrix<double>
+ComputeMatrixExponential(const vnl_matrix<double> & matrix)
+{
+  vnl_matrix<double> exponential(matrix.rows(), matrix.cols());
+  vnl_matrix_exp(matrix, exponential, 1e-15);
+  return exponential;
+}
+
+
+/** Returns the difference of the matrices, relative to the largest element of the expected one, if that exceeds 1. */
+double
+GetMatrixDifference(const vnl_matrix<double> & actual, const vnl_matrix<double> & expected)
+{
+  return (actual - expected).absolute_value_max() / std::max(1.0, expected.absolute_value_max());
+}
+
+
+/** Checks the transform with the log-domain matrix A(i,j) = scale * sin(1.3 (i d + j) + 0.4). */
+template <unsigned int VDimension>
+bool
+TestAffineLogTransform(const double scale, const bool expectSquaring)
+{
+  typedef itk::AffineLogTransform<double, VDimension> TransformType;
+  typedef typename TransformType::ParametersType      ParametersType;
+
+  const unsigned int d = VDimension;
+  const std::string  name = std::to_string(d) + "D, scale " + std::to_string(scale);
+
+  ParametersType     parameters(TransformType::ParametersDimension);
+  vnl_matrix<double> logMatrix(d, d);
+  for (unsigned int m = 0; m < d * d; ++m)
+  {
+    parameters[m] = scale * std::sin(1.3 * m + 0.4);
+    logMatrix(m / d, m % d) = parameters[m];
+  }
+  for (unsigned int i = 0; i < d; ++i)
+  {
+    parameters[d * d + i] = 2.0 - 1.5 * i;
+  }
+  if ((logMatrix.operator_inf_norm() > 0.5) != expectSquaring)
+  {
+    std::cerr << "ERROR: " << name << ": the infinity norm " << logMatrix.operator_inf_norm()
+              << " does not select the intended path." << std::endl;
+    return false;
+  }
+
+  typename TransformType::InputPointType center;
+  for (unsigned int i = 0; i < d; ++i)
+  {
+    center[i] = 1.0 + 0.5 * i;
+  }
+  const auto transform = TransformType::New();
+  transform->SetCenter(center);
+  transform->SetParameters(parameters);
+
+  /** The matrix exponential. */
+  const vnl_matrix<double> exponential = ComputeMatrixExponential(logMatrix);
+  double                   maximumDifference = GetMatrixDifference(transform->GetMatrix().GetVnlMatrix(), exponential);
+  std::cerr << name << ": matrix exponential difference " << maximumDifference;
+  if (maximumDifference > 1e-10)
+  {
+    std::cerr << std::endl << "ERROR: " << name << ": the matrix differs from vnl_matrix_exp()." << std::endl;
+    return false;
+  }
+
+  /** The derivatives of the matrix exponential, which are the Jacobian of the spatial Jacobian. */
+  const double                                          h = 1e-5;
+  typename TransformType::InputPointType                point;
+  typename TransformType::SpatialJacobianType           sj;
+  typename TransformType::JacobianOfSpatialJacobianType jsj;
+  typename TransformType::NonZeroJacobianIndicesType    nzji;
+  for (unsigned int i = 0; i < d; ++i)
+  {
+    point[i] = 4.0 - 3.0 * i;
+  }
+  transform->GetJacobianOfSpatialJacobian(point, sj, jsj, nzji);
+  maximumDifference = GetMatrixDifference(sj.GetVnlMatrix().as_matrix(), exponential);
+  for (unsigned int m = 0; m < d * d; ++m)
+  {
+    vnl_matrix<double> forward = logMatrix;
+    vnl_matrix<double> backward = logMatrix;
+    forward(m / d, m % d) += h;
+    backward(m / d, m % d) -= h;
+    const vnl_matrix<double> expected =
+      (ComputeMatrixExponential(forward) - ComputeMatrixExponential(backward)) / (2.0 * h);
+    maximumDifference = std::max(maximumDifference, GetMatrixDifference(jsj[m].GetVnlMatrix().as_matrix(), expected));
+  }
+  for (unsigned int m = d * d; m < TransformType::ParametersDimension; ++m)
+  {
+    maximumDifference = std::max(maximumDifference, jsj[m].GetVnlMatrix().absolute_value_max());
+  }
+  std::cerr << ", derivative difference " << maximumDifference;
+  if (maximumDifference > 1e-7)
+  {
+    std::cerr << std::endl
+              << "ERROR: " << name << ": the derivatives of the matrix exponential differ from the finite differences."
+              << std::endl;
+    return false;
+  }
+
+  /** The Jacobian, against central differences of the mapped point, and its product with an image gradient. */
+  typename TransformType::JacobianType jacobian;
+  transform->GetJacobian(point, jacobian, nzji);
+
+  const auto         perturbedTransform = TransformType::New();
+  vnl_matrix<double> expectedJacobian(d, TransformType::ParametersDimension);
+  perturbedTransform->SetCenter(center);
+  for (unsigned int mu = 0; mu < TransformType::ParametersDimension; ++mu)
+  {
+    ParametersType perturbedParameters = parameters;
+    perturbedParameters[mu] = parameters[mu] + h;
+    perturbedTransform->SetParameters(perturbedParameters);
+    const typename TransformType::OutputPointType forward = perturbedTransform->TransformPoint(point);
+    perturbedParameters[mu] = parameters[mu] - h;
+    perturbedTransform->SetParameters(perturbedParameters);
+    const typename TransformType::OutputPointType backward = perturbedTransform->TransformPoint(point);
+    for (unsigned int i = 0; i < d; ++i)
+    {
+      expectedJacobian(i, mu) = (forward[i] - backward[i]) / (2.0 * h);
+    }
+  }
+  maximumDifference = GetMatrixDifference(jacobian, expectedJacobian);
+
+  typename TransformType::MovingImageGradientType movingImageGradient;
+  for (unsigned int i = 0; i < d; ++i)
+  {
+    movingImageGradient[i] = 0.7 - 0.6 * i;
+  }
+  typename TransformType::DerivativeType imageJacobian(TransformType::ParametersDimension);
+  transform->EvaluateJacobianWithImageGradientProduct(point, movingImageGradient, imageJacobian, nzji);
+  vnl_vector<double> gradient(d);
+  for (unsigned int i = 0; i < d; ++i)
+  {
+    gradient[i] = movingImageGradient[i];
+  }
+  const vnl_vector<double> expectedImageJacobian = gradient * expectedJacobian;
+  maximumDifference = std::max(maximumDifference,
+                               (imageJacobian - expectedImageJacobian).inf_norm() /
+                                 std::max(1.0, expectedImageJacobian.inf_norm()));
+  std::cerr << ", Jacobian difference " << maximumDifference << std::endl;
+  if (maximumDifference > 1e-7)
+  {
+    std::cerr << "ERROR: " << name << ": the Jacobian or its product with the image gradient differs from the "
+              << "finite differences." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  bool success = true;
+  try
+  {
+    success &= TestAffineLogTransform<2>(0.1, false);
+    success &= TestAffineLogTransform<2>(1.0, true);
+    success &= TestAffineLogTransform<2>(2.5, true);
+    success &= TestAffineLogTransform<3>(0.1, false);
+    success &= TestAffineLogTransform<3>(1.0, true);
+    success &= TestAffineLogTransform<3>(2.5, true);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "The results are good." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the asynchronous gradient descent of the AdvancedMeanSquaresImageToImageMetric stays close
+ * to the synchronous gradient descent along the derivative of GetValueAndDerivative(), on a small B-spline
+ * registration problem, with one and with several threads. Within a pass, the asynchronous mode maps the
+ * later samples with the updates of the earlier ones, so it only approximates the synchronous steps. */
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const unsigned int Dimension = 2;
+
+typedef float                                                            PixelType;
+typedef itk::Image<PixelType, Dimension>                                 ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>    TransformType;
+typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>   InterpolatorType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType> MetricType;
+typedef TransformType::ParametersType                                    ParametersType;
+
+const unsigned int NumberOfIterations = 40;
+
+
+/** Creates an image of 32 x 32 voxels with a smooth blob, centered at the given position. */
+ImageType::Pointer
+CreateBlobImage(const double center)
+{
+  ImageType::SizeType size;
+  size.Fill(32);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center - 0.5 * d;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<PixelType>(100.0 * std::exp(-squaredDistance / 50.0)));
+  }
+  return image;
+}
+
+
+/** Creates a metric with a B-spline transform of 7 x 7 control points, that reads the given parameters in place. */
+MetricType::Pointer
+CreateMetric(const ImageType::Pointer & fixedImage,
+             const ImageType::Pointer & movingImage,
+             ParametersType &           parameters,
+             const itk::ThreadIdType    numberOfThreads)
+{
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(7);
+  gridSpacing.Fill(8.0);
+  gridOrigin.Fill(-8.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  parameters.SetSize(transform->GetNumberOfParameters());
+  parameters.Fill(0.0);
+  transform->SetParameters(parameters);
+
+  const auto metric = MetricType::New();
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  metric->SetTransform(transform.GetPointer());
+  metric->SetInterpolator(InterpolatorType::New());
+  metric->SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+  metric->SetUseMultiThread(true);
+  metric->SetNumberOfWorkUnits(numberOfThreads);
+  metric->Initialize();
+  return metric;
+}
+
+
+/** Performs the iterations of gradient descent with the given step size, synchronously or asynchronously,
+ * and returns the final parameters.
+ */
+ParametersType
+RunGradientDescent(const ImageType::Pointer & fixedImage,
+                   const ImageType::Pointer & movingImage,
+                   const double               stepSize,
+                   const bool                 useAsynchronousGradientDescent,
+                   const itk::ThreadIdType    numberOfThreads)
+{
+  ParametersType            parameters;
+  const MetricType::Pointer metric = CreateMetric(fixedImage, movingImage, parameters, numberOfThreads);
+
+  MetricType::MeasureType    value{};
+  MetricType::DerivativeType derivative;
+  for (unsigned int k = 0; k < NumberOfIterations; ++k)
+  {
+    if (useAsynchronousGradientDescent)
+    {
+      metric->AsynchronousGradientDescent(parameters, stepSize, value);
+    }
+    else
+    {
+      metric->GetValueAndDerivative(parameters, value, derivative);
+      parameters -= stepSize * derivative;
+    }
+  }
+  return parameters;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const ImageType::Pointer fixedImage = CreateBlobImage(14.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(16.0);
+
+  bool success = true;
+  try
+  {
+    /** A step size of which the first step moves the control points by at most 0.1 voxel. */
+    ParametersType             initialParameters;
+    const MetricType::Pointer  metric = CreateMetric(fixedImage, movingImage, initialParameters, 1);
+    MetricType::MeasureType    initialValue{};
+    MetricType::DerivativeType initialDerivative;
+    metric->GetValueAndDerivative(initialParameters, initialValue, initialDerivative);
+    const double stepSize = 0.1 / initialDerivative.inf_norm();
+
+    const ParametersType synchronousParameters = RunGradientDescent(fixedImage, movingImage, stepSize, false, 1);
+    const double         synchronousValue = metric->GetValue(synchronousParameters);
+    if (!(synchronousValue < 0.8 * initialValue))
+    {
+      std::cerr << "ERROR: the synchronous gradient descent does not converge: value " << synchronousValue
+                << ", initial value " << initialValue << std::endl;
+      success = false;
+    }
+
+    const itk::ThreadIdType threads[] = { 1, 4 };
+    for (const itk::ThreadIdType numberOfThreads : threads)
+    {
+      const ParametersType asynchronousParameters =
+        RunGradientDescent(fixedImage, movingImage, stepSize, true, numberOfThreads);
+      const double asynchronousValue = metric->GetValue(asynchronousParameters);
+
+      const double parameterDifference =
+        (asynchronousParameters - synchronousParameters).magnitude() / synchronousParameters.magnitude();
+      const double valueDifference = std::abs(asynchronousValue - synchronousValue) / initialValue;
+      std::cerr << numberOfThreads << " threads: value " << asynchronousValue << " (synchronous: " << synchronousValue
+                << ", initial: " << initialValue << "), relative difference " << parameterDifference
+                << " (parameters), " << valueDifference << " (value)" << std::endl;
+      if (parameterDifference > 0.05 || valueDifference > 0.01)
+      {
+        std::cerr << "ERROR: the asynchronous gradient descent with " << numberOfThreads
+                  << " threads differs from the synchronous one." << std::endl;
+        success = false;
+      }
+    }
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "The results are good." << std::endl;
+  return EXIT_SUCCESS;
+}
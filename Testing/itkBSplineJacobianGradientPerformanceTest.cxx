@@ -23,8 +23,10 @@
 #include "itkTimeProbe.h"
 #include "itkTimeProbesCollectorBase.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 //-------------------------------------------------------------------------------------
 
@@ -150,6 +152,7 @@ main(int argc, char * argv[])
   DerivativeType               imageJacobian_recursive(nnzji);
   NonZeroJacobianIndicesType   nzji(nnzji);
   itk::TimeProbesCollectorBase timeCollector;
+  itk::TimeProbe               timeProbePlainNew, timeProbeRecursiveNew, timeProbeRecursiveBatch;
   double                       sum = 0.0;
 
   /** Time the plain old way. */
@@ -178,6 +181,7 @@ main(int argc, char * argv[])
 
   /** Time the plain new way. */
   timeCollector.Start("JacobianGradient plain new");
+  timeProbePlainNew.Start();
   for (unsigned int i = 0; i < N; ++i)
   {
     /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
@@ -185,6 +189,7 @@ main(int argc, char * argv[])
 
     sum += imageJacobian_new(0); // just to avoid compiler to optimize away
   }
+  timeProbePlainNew.Stop();
   timeCollector.Stop("JacobianGradient plain new");
 
   /** Time the recursive old way. */
@@ -213,6 +218,7 @@ main(int argc, char * argv[])
 
   /** Time the recursive new way. */
   timeCollector.Start("JacobianGradient recursive new");
+  timeProbeRecursiveNew.Start();
   for (unsigned int i = 0; i < N; ++i)
   {
     /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
@@ -221,10 +227,34 @@ main(int argc, char * argv[])
 
     sum += imageJacobian_new(0); // just to avoid compiler to optimize away
   }
+  timeProbeRecursiveNew.Stop();
   timeCollector.Stop("JacobianGradient recursive new");
 
+  /** Time the recursive way, evaluating a batch of points per call. */
+  const unsigned int                      batchSize = 64;
+  std::vector<InputPointType>             inputPoints(batchSize, inputPoint);
+  std::vector<MovingImageGradientType>    movingImageGradients(batchSize, movingImageGradient);
+  std::vector<DerivativeType>             imageJacobians(batchSize, imageJacobian_new);
+  std::vector<NonZeroJacobianIndicesType> nzjis(batchSize, nzji);
+  timeCollector.Start("JacobianGradient recursive batch");
+  timeProbeRecursiveBatch.Start();
+  for (unsigned int i = 0; i < N; i += batchSize)
+  {
+    recursiveTransform->EvaluateJacobianWithImageGradientProducts(
+      inputPoints.data(), movingImageGradients.data(), imageJacobians.data(), nzjis.data(), std::min(batchSize, N - i));
+
+    sum += imageJacobians[0](0); // just to avoid compiler to optimize away
+  }
+  timeProbeRecursiveBatch.Stop();
+  timeCollector.Stop("JacobianGradient recursive batch");
+
   /** Report timings. */
   timeCollector.Report();
+  std::cerr << std::setprecision(4);
+  std::cerr << "Speedup factor recursive new vs plain new = "
+            << timeProbePlainNew.GetMean() / timeProbeRecursiveNew.GetMean() << std::endl;
+  std::cerr << "Speedup factor recursive batch vs recursive new = "
+            << timeProbeRecursiveNew.GetMean() / timeProbeRecursiveBatch.GetMean() << std::endl;
 
   // Avoid compiler optimizations, so use sum
   std::cerr << sum << std::endl; // works but ugly on screen
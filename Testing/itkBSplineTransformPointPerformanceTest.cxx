@@ -16,14 +16,17 @@
  *
  *=========================================================================*/
 #include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
 
 #include "itkImageRegionIterator.h"
 
 // Report timings
 #include "itkTimeProbe.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 //-------------------------------------------------------------------------------------
 // Create a class that inherits from the B-spline transform,
@@ -191,6 +194,7 @@ main(int argc, char * argv[])
 
   /** Typedefs. */
   typedef itk::BSplineTransform_TEST<CoordinateRepresentationType, Dimension, SplineOrder> TransformType;
+  typedef itk::RecursiveBSplineTransform<CoordinateRepresentationType, Dimension, SplineOrder> RecursiveTransformType;
 
   typedef TransformType::InputPointType  InputPointType;
   typedef TransformType::OutputPointType OutputPointType;
@@ -205,7 +209,8 @@ main(int argc, char * argv[])
   typedef InputImageType::DirectionType                       DirectionType;
 
   /** Create the transform. */
-  TransformType::Pointer transform = TransformType::New();
+  TransformType::Pointer          transform = TransformType::New();
+  RecursiveTransformType::Pointer recursiveTransform = RecursiveTransformType::New();
 
   /** Setup the B-spline transform:
    * (GridSize 44 43 35)
@@ -238,6 +243,11 @@ main(int argc, char * argv[])
   transform->SetGridRegion(gridRegion);
   transform->SetGridDirection(gridDirection);
 
+  recursiveTransform->SetGridOrigin(gridOrigin);
+  recursiveTransform->SetGridSpacing(gridSpacing);
+  recursiveTransform->SetGridRegion(gridRegion);
+  recursiveTransform->SetGridDirection(gridDirection);
+
   /** Now read the parameters as defined in the file par.txt. */
   ParametersType parameters(transform->GetNumberOfParameters());
   std::ifstream  input(argv[1]);
@@ -255,13 +265,14 @@ main(int argc, char * argv[])
     return 1;
   }
   transform->SetParameters(parameters);
+  recursiveTransform->SetParameters(parameters);
 
   /** Declare variables. */
   InputPointType inputPoint;
   inputPoint.Fill(4.1);
   OutputPointType outputPoint;
   double          sum = 0.0;
-  itk::TimeProbe  timeProbeOLD, timeProbeNEW;
+  itk::TimeProbe  timeProbeOLD, timeProbeNEW, timeProbeRecursive, timeProbeRecursiveBatch;
 
   /** Time the TransformPoint with the old region iterator. */
   timeProbeOLD.Start();
@@ -287,6 +298,33 @@ main(int argc, char * argv[])
   timeProbeNEW.Stop();
   const double newTime = timeProbeNEW.GetMean();
 
+  /** Time the TransformPoint of the recursive B-spline transform. */
+  timeProbeRecursive.Start();
+  for (unsigned int i = 0; i < N; ++i)
+  {
+    outputPoint = recursiveTransform->TransformPoint(inputPoint);
+    sum += outputPoint[0];
+    sum += outputPoint[1];
+    sum += outputPoint[2];
+  }
+  timeProbeRecursive.Stop();
+  const double recursiveTime = timeProbeRecursive.GetMean();
+
+  /** Time the recursive B-spline transform, transforming a batch of points per call. */
+  const unsigned int           batchSize = 64;
+  std::vector<InputPointType>  inputPoints(batchSize, inputPoint);
+  std::vector<OutputPointType> outputPoints(batchSize);
+  timeProbeRecursiveBatch.Start();
+  for (unsigned int i = 0; i < N; i += batchSize)
+  {
+    recursiveTransform->TransformPoints(inputPoints.data(), outputPoints.data(), std::min(batchSize, N - i));
+    sum += outputPoints[0][0];
+    sum += outputPoints[0][1];
+    sum += outputPoints[0][2];
+  }
+  timeProbeRecursiveBatch.Stop();
+  const double recursiveBatchTime = timeProbeRecursiveBatch.GetMean();
+
   // Avoid compiler optimizations, so use sum
   std::cerr << sum << std::endl; // works but ugly on screen
   //  volatile double a = sum; // works but gives unused variable warning
@@ -297,7 +335,21 @@ main(int argc, char * argv[])
   std::cerr << std::setprecision(4);
   std::cerr << "Time OLD = " << oldTime << " " << timeProbeOLD.GetUnit() << std::endl;
   std::cerr << "Time NEW = " << newTime << " " << timeProbeNEW.GetUnit() << std::endl;
+  std::cerr << "Time recursive = " << recursiveTime << " " << timeProbeRecursive.GetUnit() << std::endl;
+  std::cerr << "Time recursive batch = " << recursiveBatchTime << " " << timeProbeRecursiveBatch.GetUnit() << std::endl;
   std::cerr << "Speedup factor = " << oldTime / newTime << std::endl;
+  std::cerr << "Speedup factor recursive = " << oldTime / recursiveTime << std::endl;
+  std::cerr << "Speedup factor recursive batch = " << oldTime / recursiveBatchTime << std::endl;
+
+  /** Check that the recursive implementation gives the same result. */
+  const OutputPointType recursiveOutputPoint = recursiveTransform->TransformPoint(inputPoint);
+  const double          diffNorm = (transform->TransformPoint(inputPoint) - recursiveOutputPoint).GetNorm();
+  std::cerr << "Recursive B-spline difference with previous: " << diffNorm << std::endl;
+  if (diffNorm > 1e-5 || outputPoints[0] != recursiveOutputPoint)
+  {
+    std::cerr << "ERROR: Recursive B-spline TransformPoint() returning incorrect result." << std::endl;
+    return 1;
+  }
 
   /** Return a value. */
   return 0;
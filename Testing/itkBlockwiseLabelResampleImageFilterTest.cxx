@@ -0,0 +1,137 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the BlockwiseLabelResampleImageFilter gives the same label image as the
+ * ResampleImageFilter with a nearest neighbor interpolator, for a smooth B-spline transform
+ * that maps part of the output outside the moving image, for several block sizes. */
+
+#include "itkBlockwiseLabelResampleImageFilter.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkResampleImageFilter.h"
+
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const unsigned int Dimension = 3;
+  typedef unsigned char                                                        PixelType;
+  typedef itk::Image<PixelType, Dimension>                                     ImageType;
+  typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>        TransformType;
+  typedef itk::ResampleImageFilter<ImageType, ImageType, double>               ResampleFilterType;
+  typedef itk::BlockwiseLabelResampleImageFilter<ImageType, ImageType, double> BlockwiseFilterType;
+  typedef itk::NearestNeighborInterpolateImageFunction<ImageType, double>      InterpolatorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator               RandomGeneratorType;
+
+  /** A label image of 40^3 voxels with 5 labels in slanted slabs, so that many blocks are
+   * uniform, and many others lie on a label boundary.
+   */
+  ImageType::SizeType imageSize;
+  imageSize.Fill(40);
+  const auto labelImage = ImageType::New();
+  labelImage->SetRegions(imageSize);
+  labelImage->Allocate();
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(labelImage, labelImage->GetBufferedRegion()); !it.IsAtEnd();
+       ++it)
+  {
+    const ImageType::IndexType & index = it.GetIndex();
+    it.Set(static_cast<PixelType>(1 + ((index[0] + 2 * index[1] + 3 * index[2]) / 17) % 5));
+  }
+
+  /** A smooth B-spline transform with a grid spacing of 10 voxels, of which the grid covers the
+   * output region. The displacements of up to 2 voxels map part of the border outside the image.
+   */
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(7);
+  gridSpacing.Fill(10.0);
+  gridOrigin.Fill(-10.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(2357);
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = randomGenerator->GetUniformVariate(-2.0, 2.0);
+  }
+  transform->SetParameters(parameters);
+
+  /** The reference: every voxel resampled by the ResampleImageFilter. */
+  const auto resampler = ResampleFilterType::New();
+  resampler->SetInput(labelImage);
+  resampler->SetTransform(transform);
+  resampler->SetInterpolator(InterpolatorType::New());
+  resampler->SetOutputParametersFromImage(labelImage);
+  resampler->SetDefaultPixelValue(0);
+
+  try
+  {
+    resampler->Update();
+
+    for (const unsigned int blockSize : { 1, 2, 4, 7 })
+    {
+      const auto blockwiseResampler = BlockwiseFilterType::New();
+      blockwiseResampler->SetInput(labelImage);
+      blockwiseResampler->SetTransform(transform);
+      blockwiseResampler->SetInterpolator(InterpolatorType::New());
+      blockwiseResampler->SetOutputParametersFromImage(labelImage);
+      blockwiseResampler->SetDefaultPixelValue(0);
+      blockwiseResampler->SetBlockSize(blockSize);
+      blockwiseResampler->Update();
+
+      itk::SizeValueType                       numberOfDifferences = 0;
+      itk::SizeValueType                       numberOfOutsideVoxels = 0;
+      itk::ImageRegionConstIterator<ImageType> referenceIt(resampler->GetOutput(),
+                                                           resampler->GetOutput()->GetBufferedRegion());
+      itk::ImageRegionConstIterator<ImageType> it(blockwiseResampler->GetOutput(),
+                                                  blockwiseResampler->GetOutput()->GetBufferedRegion());
+      for (; !referenceIt.IsAtEnd(); ++referenceIt, ++it)
+      {
+        numberOfDifferences += it.Get() != referenceIt.Get();
+        numberOfOutsideVoxels += referenceIt.Get() == 0;
+      }
+      std::cerr << "Block size " << blockSize << ": " << numberOfDifferences << " voxels differ, "
+                << numberOfOutsideVoxels << " voxels are mapped outside the image." << std::endl;
+      if (numberOfDifferences != 0)
+      {
+        std::cerr << "ERROR: the blockwise resampled image differs from the resampled image." << std::endl;
+        return 1;
+      }
+    }
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,211 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the exact TrC, TrCC, maxJJ and maxJCJ of the ComputeJacobianTerms equal the ones of
+ * a dense covariance matrix C = 1/n \sum_i J_i^T J_i of the scaled Jacobians, which the sparse and
+ * band covariance matrix of the original computation should equal, with one and with several threads. */
+
+#include "itkComputeJacobianTerms.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkThreadBudget.h"
+#include <vnl/vnl_trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+const unsigned int Dimension = 2;
+
+typedef itk::Image<float, Dimension>                                  ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3> TransformType;
+typedef itk::ComputeJacobianTerms<ImageType, TransformType>           ComputeJacobianTermsType;
+typedef vnl_matrix<double>                                            MatrixType;
+
+
+/** Gives access to the samples of the ComputeJacobianTerms, so that the reference uses the same ones. */
+class JacobianTermsSampler : public ComputeJacobianTermsType
+{
+public:
+  typedef JacobianTermsSampler    Self;
+  typedef itk::SmartPointer<Self> Pointer;
+  itkNewMacro(Self);
+
+  typedef ComputeJacobianTermsType::ImageSampleContainerPointer ImageSampleContainerPointer;
+
+  ImageSampleContainerPointer
+  GetSamples(void)
+  {
+    ImageSampleContainerPointer sampleContainer;
+    this->SampleFixedImageForJacobianTerms(sampleContainer);
+    return sampleContainer;
+  }
+};
+
+
+/** Returns the dense Jacobian of the transform at the point, with columns divided by the scales. */
+MatrixType
+GetDenseScaledJacobian(const TransformType &                        transform,
+                       const TransformType::InputPointType &        point,
+                       const ComputeJacobianTermsType::ScalesType & scales)
+{
+  TransformType::JacobianType               jacobian;
+  TransformType::NonZeroJacobianIndicesType nonZeroJacobianIndices;
+  transform.GetJacobian(point, jacobian, nonZeroJacobianIndices);
+
+  MatrixType denseJacobian(Dimension, transform.GetNumberOfParameters(), 0.0);
+  for (unsigned int pi = 0; pi < nonZeroJacobianIndices.size(); ++pi)
+  {
+    const unsigned int p = nonZeroJacobianIndices[pi];
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      denseJacobian(d, p) = jacobian(d, pi) / scales[p];
+    }
+  }
+  return denseJacobian;
+}
+
+
+/** Checks that the result equals the reference, up to the rounding of the different summation order. */
+bool
+CheckTerm(const std::string & name, const double result, const double reference)
+{
+  if (std::abs(result - reference) > 1e-10 * std::abs(reference))
+  {
+    std::cerr << "ERROR: " << name << " is " << result << ", instead of " << reference << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** A fixed image of 20^2 voxels, which is covered by the valid region of the B-spline grid. */
+  ImageType::SizeType imageSize;
+  imageSize.Fill(20);
+  const auto fixedImage = ImageType::New();
+  fixedImage->SetRegions(imageSize);
+  fixedImage->Allocate(true);
+
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(6);
+  gridSpacing.Fill(7.0);
+  gridOrigin.Fill(-7.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  parameters.Fill(0.0);
+  transform->SetParameters(parameters);
+
+  /** Scales that differ per parameter, so that the scaling of the rows and columns is tested. */
+  const unsigned int P = transform->GetNumberOfParameters();
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed(1357);
+  ComputeJacobianTermsType::ScalesType scales(P);
+  for (unsigned int p = 0; p < P; ++p)
+  {
+    scales[p] = itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->GetUniformVariate(0.5, 2.0);
+  }
+
+  const auto computeJacobianTerms = JacobianTermsSampler::New();
+  computeJacobianTerms->SetFixedImage(fixedImage);
+  computeJacobianTerms->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  computeJacobianTerms->SetTransform(transform);
+  computeJacobianTerms->SetScales(scales);
+  computeJacobianTerms->SetUseScales(true);
+  computeJacobianTerms->SetMaxBandCovSize(8);
+  computeJacobianTerms->SetNumberOfBandStructureSamples(10);
+  computeJacobianTerms->SetNumberOfJacobianMeasurements(200);
+  computeJacobianTerms->SetUseRandomizedTraceEstimator(false);
+
+  bool success = true;
+  try
+  {
+    /** The reference: the dense covariance matrix of the same samples. */
+    const JacobianTermsSampler::ImageSampleContainerPointer sampleContainer = computeJacobianTerms->GetSamples();
+    const unsigned int                                      n = sampleContainer->Size();
+    MatrixType                                              covariance(P, P, 0.0);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      const MatrixType jacobian =
+        GetDenseScaledJacobian(*transform, sampleContainer->GetElement(i).m_ImageCoordinates, scales);
+      covariance += jacobian.transpose() * jacobian;
+    }
+    covariance /= static_cast<double>(n);
+
+    const double sqrt2 = std::sqrt(2.0);
+    const double referenceTrC = vnl_trace(covariance);
+    const double referenceTrCC = vnl_math::sqr(covariance.frobenius_norm());
+    double       referenceMaxJJ = 0.0;
+    double       referenceMaxJCJ = 0.0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      const MatrixType jacobian =
+        GetDenseScaledJacobian(*transform, sampleContainer->GetElement(i).m_ImageCoordinates, scales);
+      const MatrixType jacobianJacobian = jacobian * jacobian.transpose();
+      const MatrixType jacobianCovarianceJacobian = jacobian * covariance * jacobian.transpose();
+      const double     JJ = vnl_math::sqr(jacobian.frobenius_norm()) + 2.0 * sqrt2 * jacobianJacobian.frobenius_norm();
+      const double     JCJ =
+        vnl_trace(jacobianCovarianceJacobian) + 2.0 * sqrt2 * jacobianCovarianceJacobian.frobenius_norm();
+      referenceMaxJJ = std::max(referenceMaxJJ, JJ);
+      referenceMaxJCJ = std::max(referenceMaxJCJ, JCJ);
+    }
+
+    for (const itk::ThreadIdType numberOfThreads : { 1, 4 })
+    {
+      const itk::ThreadBudget threadBudget(numberOfThreads);
+      double                  TrC = 0.0;
+      double                  TrCC = 0.0;
+      double                  maxJJ = 0.0;
+      double                  maxJCJ = 0.0;
+      computeJacobianTerms->Compute(TrC, TrCC, maxJJ, maxJCJ);
+
+      std::cerr << numberOfThreads << " threads, " << n << " samples: TrC " << TrC << ", TrCC " << TrCC << ", maxJJ "
+                << maxJJ << ", maxJCJ " << maxJCJ << std::endl;
+      success &= CheckTerm("TrC", TrC, referenceTrC);
+      success &= CheckTerm("TrCC", TrCC, referenceTrCC);
+      success &= CheckTerm("maxJJ", maxJJ, referenceMaxJJ);
+      success &= CheckTerm("maxJCJ", maxJCJ, referenceMaxJCJ);
+    }
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,243 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests TransformPoint(), GetJacobian() and EvaluateJacobianWithImageGradientProduct() of the
+ * CyclicBSplineDeformableTransform against a direct evaluation of the cubic B-spline, of which
+ * the support region is wrapped around in the last dimension index by index, as the original
+ * implementation did. The points include support regions that wrap around at both ends. */
+
+#include "itkCyclicBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const unsigned int Dimension = 3;
+const unsigned int SplineOrder = 3;
+const unsigned int SupportSize = SplineOrder + 1;
+const unsigned int NumberOfSupportNodes = SupportSize * SupportSize * SupportSize;
+
+typedef itk::CyclicBSplineDeformableTransform<double, Dimension, SplineOrder> TransformType;
+
+
+/** The cubic B-spline. */
+double
+CubicBSpline(const double x)
+{
+  const double absoluteX = std::abs(x);
+  if (absoluteX < 1.0)
+  {
+    return (4.0 - 6.0 * absoluteX * absoluteX + 3.0 * absoluteX * absoluteX * absoluteX) / 6.0;
+  }
+  if (absoluteX < 2.0)
+  {
+    return (2.0 - absoluteX) * (2.0 - absoluteX) * (2.0 - absoluteX) / 6.0;
+  }
+  return 0.0;
+}
+
+
+/** Computes the weights and the linear grid indices of the support nodes of a continuous grid index,
+ * with the first dimension running fastest, wrapping the index of the last dimension around. */
+void
+ComputeReferenceSupport(const double                    cindex[Dimension],
+                        const TransformType::SizeType & gridSize,
+                        double                          weights[NumberOfSupportNodes],
+                        std::size_t                     nodes[NumberOfSupportNodes])
+{
+  for (unsigned int n = 0; n < NumberOfSupportNodes; ++n)
+  {
+    weights[n] = 1.0;
+    nodes[n] = 0;
+    unsigned int remainder = n;
+    std::size_t  stride = 1;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const long firstIndex = static_cast<long>(std::floor(cindex[d])) - 1;
+      long       index = firstIndex + static_cast<long>(remainder % SupportSize);
+      remainder /= SupportSize;
+      weights[n] *= CubicBSpline(cindex[d] - static_cast<double>(index));
+
+      const long size = static_cast<long>(gridSize[d]);
+      if (d == Dimension - 1)
+      {
+        index = ((index % size) + size) % size;
+      }
+      nodes[n] += static_cast<std::size_t>(index) * stride;
+      stride *= gridSize[d];
+    }
+  }
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  typedef TransformType::ParametersType                          ParametersType;
+  typedef TransformType::InputPointType                          InputPointType;
+  typedef TransformType::OutputPointType                         OutputPointType;
+  typedef TransformType::JacobianType                            JacobianType;
+  typedef TransformType::NonZeroJacobianIndicesType              NonZeroJacobianIndicesType;
+  typedef TransformType::DerivativeType                          DerivativeType;
+  typedef TransformType::MovingImageGradientType                 MovingImageGradientType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  /** A grid of which the last dimension, with 5 nodes, wraps around. */
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize[0] = 7;
+  gridSize[1] = 6;
+  gridSize[2] = 5;
+  gridSpacing[0] = 2.0;
+  gridSpacing[1] = 3.0;
+  gridSpacing[2] = 1.0;
+  gridOrigin[0] = -3.0;
+  gridOrigin[1] = 1.0;
+  gridOrigin[2] = 0.0;
+
+  const auto transform = TransformType::New();
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  /** Random coefficients. The transform keeps a reference to them. */
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(4321);
+  ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+  }
+  transform->SetParameters(parameters);
+
+  const std::size_t  numberOfNodes = gridSize[0] * gridSize[1] * gridSize[2];
+  const unsigned int nnzji = transform->GetNumberOfNonZeroJacobianIndices();
+  if (nnzji != Dimension * NumberOfSupportNodes)
+  {
+    std::cerr << "ERROR: the transform has " << nnzji << " nonzero Jacobian indices." << std::endl;
+    return 1;
+  }
+
+  JacobianType               jacobian(Dimension, nnzji);
+  DerivativeType             imageJacobian(nnzji);
+  NonZeroJacobianIndicesType nzji(nnzji);
+  NonZeroJacobianIndicesType gradientProductNzji(nnzji);
+
+  const double tolerance = 1e-10;
+  for (unsigned int n = 0; n < 1000; ++n)
+  {
+    /** A point of which the support lies inside the grid in the first dimensions. In the last
+     * dimension, the first points have support regions that wrap around at the start or the end.
+     */
+    double cindex[Dimension];
+    for (unsigned int d = 0; d < Dimension - 1; ++d)
+    {
+      cindex[d] = randomGenerator->GetUniformVariate(1.25, gridSize[d] - 2.25);
+    }
+    const double lastDimensionSize = static_cast<double>(gridSize[Dimension - 1]);
+    if (n < 100)
+    {
+      cindex[Dimension - 1] = randomGenerator->GetUniformVariate(0.0, 1.0);
+    }
+    else if (n < 200)
+    {
+      cindex[Dimension - 1] = randomGenerator->GetUniformVariate(lastDimensionSize - 2.0, lastDimensionSize);
+    }
+    else
+    {
+      cindex[Dimension - 1] = randomGenerator->GetUniformVariate(0.0, lastDimensionSize);
+    }
+    InputPointType point;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      point[d] = gridOrigin[d] + gridSpacing[d] * cindex[d];
+    }
+
+    double      weights[NumberOfSupportNodes];
+    std::size_t nodes[NumberOfSupportNodes];
+    ComputeReferenceSupport(cindex, gridSize, weights, nodes);
+
+    /** The last dimension is not displaced. */
+    OutputPointType referencePoint = point;
+    for (unsigned int k = 0; k < NumberOfSupportNodes; ++k)
+    {
+      for (unsigned int d = 0; d < Dimension - 1; ++d)
+      {
+        referencePoint[d] += weights[k] * parameters[d * numberOfNodes + nodes[k]];
+      }
+    }
+    const OutputPointType transformedPoint = transform->TransformPoint(point);
+    if (transformedPoint.EuclideanDistanceTo(referencePoint) > tolerance)
+    {
+      std::cerr << "ERROR: TransformPoint(" << point << ") gives " << transformedPoint << ", instead of "
+                << referencePoint << "." << std::endl;
+      return 1;
+    }
+
+    /** The Jacobian covers all dimensions. */
+    MovingImageGradientType movingImageGradient;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      movingImageGradient[d] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+    }
+    transform->GetJacobian(point, jacobian, nzji);
+    transform->EvaluateJacobianWithImageGradientProduct(point, movingImageGradient, imageJacobian, gradientProductNzji);
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      for (unsigned int k = 0; k < NumberOfSupportNodes; ++k)
+      {
+        const unsigned int entry = d * NumberOfSupportNodes + k;
+        if (nzji[entry] != d * numberOfNodes + nodes[k] || gradientProductNzji[entry] != nzji[entry])
+        {
+          std::cerr << "ERROR: nonzero Jacobian index " << entry << " at " << point << " is " << nzji[entry]
+                    << " (GetJacobian) and " << gradientProductNzji[entry]
+                    << " (EvaluateJacobianWithImageGradientProduct), instead of " << d * numberOfNodes + nodes[k]
+                    << "." << std::endl;
+          return 1;
+        }
+        for (unsigned int i = 0; i < Dimension; ++i)
+        {
+          const double referenceJacobian = i == d ? weights[k] : 0.0;
+          if (std::abs(jacobian(i, entry) - referenceJacobian) > tolerance)
+          {
+            std::cerr << "ERROR: GetJacobian(" << point << ")(" << i << ", " << entry << ") is "
+                      << jacobian(i, entry) << ", instead of " << referenceJacobian << "." << std::endl;
+            return 1;
+          }
+        }
+        if (std::abs(imageJacobian[entry] - weights[k] * movingImageGradient[d]) > tolerance)
+        {
+          std::cerr << "ERROR: EvaluateJacobianWithImageGradientProduct(" << point << ")[" << entry << "] is "
+                    << imageJacobian[entry] << ", instead of " << weights[k] * movingImageGradient[d] << "."
+                    << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,238 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests RecursiveBSplineTransform::GetSpatialJacobianAndJacobianOfLogDeterminant() against the
+ * determinant and the trace of the inverse spatial Jacobian times the Jacobian of the spatial Jacobian,
+ * and tests that the SumSquaredTissueVolumeDifference metric gives the same value and derivative with
+ * the fused determinant derivative as with the generic one, single- and multi-threaded, in 2D and 3D. */
+
+#include "SumSquaredTissueVolumeDifferenceMetric/itkSumSquaredTissueVolumeDifferenceImageToImageMetric.h"
+
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include <vnl/vnl_det.h>
+#include <vnl/vnl_inverse.h>
+#include <vnl/vnl_trace.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+/** Sets a grid with spacing 4 over an image of 16 voxels in each dimension, and a smooth deformation. */
+template <class TTransform>
+void
+SetGridAndParameters(TTransform & transform)
+{
+  typename TTransform::SizeType    gridSize;
+  typename TTransform::SpacingType gridSpacing;
+  typename TTransform::OriginType  gridOrigin;
+  gridSize.Fill(7);
+  gridSpacing.Fill(4.0);
+  gridOrigin.Fill(-4.0);
+  transform.SetGridRegion(typename TTransform::RegionType(gridSize));
+  transform.SetGridSpacing(gridSpacing);
+  transform.SetGridOrigin(gridOrigin);
+
+  typename TTransform::ParametersType parameters(transform.GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.1 * static_cast<double>((i * 5) % 7) - 0.3;
+  }
+  transform.SetParametersByValue(parameters);
+}
+
+
+/** Creates an image of 16 voxels in each dimension between the air and the tissue value, with a smooth blob. */
+template <unsigned int VDimension>
+typename itk::Image<float, VDimension>::Pointer
+CreateBlobImage(const double center)
+{
+  typedef itk::Image<float, VDimension> ImageType;
+
+  typename ImageType::SizeType size;
+  size.Fill(16);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < VDimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center - 0.5 * d;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<float>(-1000.0 + 1055.0 * std::exp(-squaredDistance / 40.0)));
+  }
+  return image;
+}
+
+
+/** Checks the fused determinant derivative of the transform against the generic computation. */
+template <class TTransform>
+bool
+TestTransform(const TTransform & transform, const std::string & name)
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(1357);
+
+  double maximumDifference = 0.0;
+  for (unsigned int n = 0; n < 100; ++n)
+  {
+    typename TTransform::InputPointType point;
+    for (unsigned int d = 0; d < TTransform::SpaceDimension; ++d)
+    {
+      point[d] = randomGenerator->GetUniformVariate(0.0, 15.9);
+    }
+
+    typename TTransform::SpatialJacobianType           sj;
+    typename TTransform::SpatialJacobianType           fusedSj;
+    typename TTransform::JacobianOfSpatialJacobianType jsj;
+    typename TTransform::JacobianType                  jacobian;
+    typename TTransform::NonZeroJacobianIndicesType    nzji;
+    typename TTransform::NonZeroJacobianIndicesType    jacobianNzji;
+    typename TTransform::DerivativeType                jacobianOfLogDeterminant;
+    double                                             determinant = 0.0;
+    transform.GetJacobianOfSpatialJacobian(point, sj, jsj, nzji);
+    transform.GetJacobian(point, jacobian, jacobianNzji);
+    if (!transform.GetSpatialJacobianAndJacobianOfLogDeterminant(point, fusedSj, determinant, jacobianOfLogDeterminant))
+    {
+      std::cerr << "ERROR: " << name << ": the spatial Jacobian is reported singular." << std::endl;
+      return false;
+    }
+    if (jacobianNzji != nzji || jacobianOfLogDeterminant.GetSize() != nzji.size())
+    {
+      std::cerr << "ERROR: " << name << ": the derivative is not in the order of the nonzero Jacobian indices."
+                << std::endl;
+      return false;
+    }
+
+    /** d log(det(sj)) / dmu = trace(sj^-1 d(sj)/dmu). */
+    const vnl_matrix<double> inverseSj = vnl_inverse(sj.GetVnlMatrix().as_matrix());
+    const double             expectedDeterminant = vnl_det(sj.GetVnlMatrix());
+    maximumDifference = std::max(maximumDifference, (fusedSj - sj).GetVnlMatrix().absolute_value_max());
+    maximumDifference = std::max(maximumDifference, std::abs(determinant - expectedDeterminant));
+    for (unsigned int mu = 0; mu < nzji.size(); ++mu)
+    {
+      const double expected = vnl_trace(inverseSj * jsj[mu].GetVnlMatrix().as_matrix());
+      maximumDifference = std::max(maximumDifference, std::abs(jacobianOfLogDeterminant[mu] - expected));
+    }
+  }
+
+  std::cerr << name << ": maximum difference of the fused and generic determinant derivative: " << maximumDifference
+            << std::endl;
+  if (maximumDifference > 1e-10)
+  {
+    std::cerr << "ERROR: " << name << ": the fused determinant derivative differs from the generic one." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+/** Checks that the metric gives the same value and derivative with and without the fused determinant derivative. */
+template <unsigned int VDimension>
+bool
+TestMetric(const std::string & name)
+{
+  typedef itk::Image<float, VDimension>                                                 ImageType;
+  typedef itk::RecursiveBSplineTransform<double, VDimension, 3>                         TransformType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>                InterpolatorType;
+  typedef itk::SumSquaredTissueVolumeDifferenceImageToImageMetric<ImageType, ImageType> MetricType;
+
+  const typename ImageType::Pointer fixedImage = CreateBlobImage<VDimension>(7.0);
+  const typename ImageType::Pointer movingImage = CreateBlobImage<VDimension>(8.0);
+  const auto                        transform = TransformType::New();
+  SetGridAndParameters(*transform);
+
+  bool success = TestTransform(*transform, name);
+  for (const bool useMultiThread : { false, true })
+  {
+    const std::string threads = useMultiThread ? ", multi-threaded" : ", single-threaded";
+
+    typename MetricType::MeasureType    values[2];
+    typename MetricType::DerivativeType derivatives[2];
+    for (const bool useFusedDeterminantDerivative : { false, true })
+    {
+      const auto metric = MetricType::New();
+      metric->SetUseFusedDeterminantDerivative(useFusedDeterminantDerivative);
+      metric->SetFixedImage(fixedImage);
+      metric->SetMovingImage(movingImage);
+      metric->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+      metric->SetTransform(transform.GetPointer());
+      metric->SetInterpolator(InterpolatorType::New());
+      metric->SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+      metric->SetUseMultiThread(useMultiThread);
+      metric->SetNumberOfWorkUnits(4);
+      metric->Initialize();
+      metric->GetValueAndDerivative(
+        transform->GetParameters(), values[useFusedDeterminantDerivative], derivatives[useFusedDeterminantDerivative]);
+    }
+
+    const double valueDifference = std::abs(values[1] - values[0]) / std::abs(values[0]);
+    const double derivativeDifference = (derivatives[1] - derivatives[0]).magnitude() / derivatives[0].magnitude();
+    std::cerr << name << threads << ": value " << values[1] << ", relative difference " << valueDifference
+              << " (value), " << derivativeDifference << " (derivative)" << std::endl;
+    if (valueDifference > 1e-10 || derivativeDifference > 1e-10)
+    {
+      std::cerr << "ERROR: " << name << threads
+                << ": the metric differs with the fused and the generic determinant derivative." << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  bool success = true;
+  try
+  {
+    success &= TestMetric<2>("2D RecursiveBSplineTransform");
+    success &= TestMetric<3>("3D RecursiveBSplineTransform");
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "The results are good." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests the grid-based bending energy value and derivative of the AdvancedBSplineDeformableTransform
+ * and the RecursiveBSplineTransform against the sampled computation with a full sampler, in 2D and 3D.
+ *
+ * The sampled computation is the midpoint rule of the integral that the grid-based computation evaluates
+ * exactly. The knots of the grid lie on voxel boundaries, so that the midpoint rule converges quadratically
+ * in the voxel spacing: the Richardson extrapolation of the sampled results of two voxel spacings must then
+ * equal the grid-based results. */
+
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkRecursiveBSplineTransform.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+
+/** Sets a grid with spacing 4, of which the knots of the splines of order 2 and 3 lie on the
+ * voxel boundaries of the images of ComputeBendingEnergy(), and a smooth deformation. */
+template <class TTransform>
+void
+SetGridAndParameters(TTransform & transform)
+{
+  typename TTransform::SizeType    gridSize;
+  typename TTransform::SpacingType gridSpacing;
+  typename TTransform::OriginType  gridOrigin;
+  gridSize.Fill(6);
+  gridSpacing.Fill(4.0);
+  gridOrigin.Fill(-8.5);
+  transform.SetGridRegion(typename TTransform::RegionType(gridSize));
+  transform.SetGridSpacing(gridSpacing);
+  transform.SetGridOrigin(gridOrigin);
+
+  typename TTransform::ParametersType parameters(transform.GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.5 * std::sin(0.7 * static_cast<double>(i)) + 0.1 * static_cast<double>(i % 3);
+  }
+  transform.SetParametersByValue(parameters);
+}
+
+
+/** Computes the bending energy for a fixed image of which the voxels cover [-0.5, 7.5] in each
+ * dimension, with the given voxel spacing. Returns whether the grid-based computation was used. */
+template <class TTransform>
+bool
+ComputeBendingEnergy(TTransform &         transform,
+                     const double         voxelSpacing,
+                     const bool           useGridBasedBendingEnergy,
+                     double &             value,
+                     itk::Array<double> & derivative)
+{
+  typedef itk::Image<float, TTransform::SpaceDimension>                  ImageType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double> InterpolatorType;
+  typedef itk::TransformBendingEnergyPenaltyTerm<ImageType, double>      BendingEnergyType;
+
+  typename ImageType::SizeType    size;
+  typename ImageType::SpacingType spacing;
+  typename ImageType::PointType   origin;
+  size.Fill(static_cast<itk::SizeValueType>(8.0 / voxelSpacing + 0.5));
+  spacing.Fill(voxelSpacing);
+  origin.Fill(-0.5 + 0.5 * voxelSpacing);
+
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->Allocate(true);
+
+  const auto bendingEnergy = BendingEnergyType::New();
+  bendingEnergy->SetUseGridBasedBendingEnergy(useGridBasedBendingEnergy);
+  bendingEnergy->SetFixedImage(image);
+  bendingEnergy->SetMovingImage(image);
+  bendingEnergy->SetFixedImageRegion(image->GetBufferedRegion());
+  bendingEnergy->SetTransform(&transform);
+  bendingEnergy->SetInterpolator(InterpolatorType::New());
+  bendingEnergy->SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+  bendingEnergy->Initialize();
+
+  typename BendingEnergyType::MeasureType    measure{};
+  typename BendingEnergyType::DerivativeType metricDerivative;
+  bendingEnergy->GetValueAndDerivative(transform.GetParameters(), measure, metricDerivative);
+  value = measure;
+  derivative = metricDerivative;
+
+  /** GetValue() must give the same value. */
+  const double valueOnly = bendingEnergy->GetValue(transform.GetParameters());
+  if (std::abs(valueOnly - value) > 1e-12 * std::abs(value))
+  {
+    itkGenericExceptionMacro(<< "GetValue() gives " << valueOnly << ", GetValueAndDerivative() gives " << value);
+  }
+  return bendingEnergy->GetGridBasedBendingEnergyActive();
+}
+
+
+/** Compares the grid-based bending energy with the extrapolated sampled bending energy. */
+template <class TTransform>
+bool
+TestGridBasedBendingEnergy(const std::string & name)
+{
+  const auto transform = TTransform::New();
+  SetGridAndParameters(*transform);
+
+  double             gridValue = 0.0;
+  double             coarseValue = 0.0;
+  double             fineValue = 0.0;
+  itk::Array<double> gridDerivative;
+  itk::Array<double> coarseDerivative;
+  itk::Array<double> fineDerivative;
+  if (!ComputeBendingEnergy(*transform, 0.5, true, gridValue, gridDerivative))
+  {
+    std::cerr << "ERROR: " << name << ": the bending energy is not computed from the grid." << std::endl;
+    return false;
+  }
+  if (ComputeBendingEnergy(*transform, 0.5, false, coarseValue, coarseDerivative) ||
+      ComputeBendingEnergy(*transform, 0.25, false, fineValue, fineDerivative))
+  {
+    std::cerr << "ERROR: " << name << ": the bending energy is computed from the grid, although switched off."
+              << std::endl;
+    return false;
+  }
+
+  /** Eliminate the quadratic term of the error of the midpoint rule. */
+  const double             extrapolatedValue = (4.0 * fineValue - coarseValue) / 3.0;
+  const vnl_vector<double> extrapolatedDerivative = (4.0 * fineDerivative - coarseDerivative) / 3.0;
+
+  const double sampledDifference = std::abs(fineValue - gridValue) / std::abs(gridValue);
+  const double valueDifference = std::abs(extrapolatedValue - gridValue) / std::abs(gridValue);
+  const double derivativeDifference =
+    (extrapolatedDerivative - gridDerivative).magnitude() / gridDerivative.magnitude();
+  std::cerr << name << ": grid-based value " << gridValue << ", sampled value " << fineValue
+            << ", relative difference " << sampledDifference << " (sampled), " << valueDifference
+            << " (extrapolated value), " << derivativeDifference << " (extrapolated derivative)" << std::endl;
+
+  if (!(gridValue > 0.0) || valueDifference > 2e-4 || derivativeDifference > 2e-4)
+  {
+    std::cerr << "ERROR: " << name << ": the grid-based bending energy differs from the sampled one." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  bool success = true;
+  try
+  {
+    success &= TestGridBasedBendingEnergy<itk::AdvancedBSplineDeformableTransform<double, 2, 2>>(
+      "2D AdvancedBSplineDeformableTransform of order 2");
+    success &= TestGridBasedBendingEnergy<itk::AdvancedBSplineDeformableTransform<double, 2, 3>>(
+      "2D AdvancedBSplineDeformableTransform of order 3");
+    success &= TestGridBasedBendingEnergy<itk::RecursiveBSplineTransform<double, 2, 3>>(
+      "2D RecursiveBSplineTransform of order 3");
+    success &= TestGridBasedBendingEnergy<itk::AdvancedBSplineDeformableTransform<double, 3, 2>>(
+      "3D AdvancedBSplineDeformableTransform of order 2");
+    success &= TestGridBasedBendingEnergy<itk::AdvancedBSplineDeformableTransform<double, 3, 3>>(
+      "3D AdvancedBSplineDeformableTransform of order 3");
+    success &= TestGridBasedBendingEnergy<itk::RecursiveBSplineTransform<double, 3, 3>>(
+      "3D RecursiveBSplineTransform of order 3");
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "The results are good." << std::endl;
+  return EXIT_SUCCESS;
+}
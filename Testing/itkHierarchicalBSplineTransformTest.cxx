@@ -0,0 +1,138 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that a HierarchicalBSplineTransform with only its base grid is the same transform as an
+ * AdvancedBSplineDeformableTransform of order 3 on that grid: the same transformed points, the
+ * same Jacobians, and the same nonzero Jacobian indices. */
+
+#include "HierarchicalBSplineTransform/itkHierarchicalBSplineTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const unsigned int Dimension = 2;
+  typedef itk::HierarchicalBSplineTransform<double, Dimension>          HierarchicalTransformType;
+  typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3> BSplineTransformType;
+  typedef HierarchicalTransformType::ParametersType                     ParametersType;
+  typedef HierarchicalTransformType::InputPointType                     InputPointType;
+  typedef HierarchicalTransformType::OutputPointType                    OutputPointType;
+  typedef HierarchicalTransformType::JacobianType                       JacobianType;
+  typedef HierarchicalTransformType::NonZeroJacobianIndicesType         NonZeroJacobianIndicesType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator        RandomGeneratorType;
+
+  /** A grid with a rotated direction, so that the mapping to the grid is not trivial. */
+  HierarchicalTransformType::RegionType    gridRegion;
+  HierarchicalTransformType::SpacingType   gridSpacing;
+  HierarchicalTransformType::OriginType    gridOrigin;
+  HierarchicalTransformType::DirectionType gridDirection;
+  gridRegion.SetSize(0, 8);
+  gridRegion.SetSize(1, 7);
+  gridSpacing[0] = 3.0;
+  gridSpacing[1] = 4.0;
+  gridOrigin[0] = -2.0;
+  gridOrigin[1] = 1.0;
+  const double angle = 0.3;
+  gridDirection(0, 0) = std::cos(angle);
+  gridDirection(0, 1) = -std::sin(angle);
+  gridDirection(1, 0) = std::sin(angle);
+  gridDirection(1, 1) = std::cos(angle);
+
+  HierarchicalTransformType::Pointer hierarchicalTransform = HierarchicalTransformType::New();
+  hierarchicalTransform->SetBaseGrid(gridRegion, gridSpacing, gridOrigin, gridDirection);
+
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridRegion(gridRegion);
+  bsplineTransform->SetGridSpacing(gridSpacing);
+  bsplineTransform->SetGridOrigin(gridOrigin);
+  bsplineTransform->SetGridDirection(gridDirection);
+
+  if (hierarchicalTransform->GetNumberOfParameters() != bsplineTransform->GetNumberOfParameters() ||
+      hierarchicalTransform->GetNumberOfNonZeroJacobianIndices() !=
+        bsplineTransform->GetNumberOfNonZeroJacobianIndices())
+  {
+    std::cerr << "ERROR: the transforms have a different number of parameters or nonzero Jacobian indices."
+              << std::endl;
+    return 1;
+  }
+
+  /** Random coefficients. The B-spline transform keeps a reference to them. */
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(1234);
+  ParametersType parameters(bsplineTransform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = randomGenerator->GetUniformVariate(-2.0, 2.0);
+  }
+  hierarchicalTransform->SetParameters(parameters);
+  bsplineTransform->SetParameters(parameters);
+
+  /** Compare the transforms at random points, of which the support lies inside the grid. */
+  const unsigned int         nnzji = bsplineTransform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType               hierarchicalJacobian(Dimension, nnzji);
+  JacobianType               bsplineJacobian(Dimension, nnzji);
+  NonZeroJacobianIndicesType hierarchicalIndices(nnzji);
+  NonZeroJacobianIndicesType bsplineIndices(nnzji);
+
+  const double tolerance = 1e-10;
+  for (unsigned int n = 0; n < 1000; ++n)
+  {
+    InputPointType point = gridOrigin;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double cindex = randomGenerator->GetUniformVariate(1.25, gridRegion.GetSize(d) - 2.25);
+      for (unsigned int i = 0; i < Dimension; ++i)
+      {
+        point[i] += gridDirection(i, d) * gridSpacing[d] * cindex;
+      }
+    }
+
+    const OutputPointType hierarchicalPoint = hierarchicalTransform->TransformPoint(point);
+    const OutputPointType bsplinePoint = bsplineTransform->TransformPoint(point);
+    if (hierarchicalPoint.EuclideanDistanceTo(bsplinePoint) > tolerance)
+    {
+      std::cerr << "ERROR: TransformPoint(" << point << ") gives " << hierarchicalPoint << ", instead of "
+                << bsplinePoint << "." << std::endl;
+      return 1;
+    }
+
+    hierarchicalTransform->GetJacobian(point, hierarchicalJacobian, hierarchicalIndices);
+    bsplineTransform->GetJacobian(point, bsplineJacobian, bsplineIndices);
+    if (hierarchicalIndices != bsplineIndices)
+    {
+      std::cerr << "ERROR: the nonzero Jacobian indices at " << point << " differ." << std::endl;
+      return 1;
+    }
+    if ((hierarchicalJacobian - bsplineJacobian).frobenius_norm() > tolerance)
+    {
+      std::cerr << "ERROR: GetJacobian(" << point << ") differs by "
+                << (hierarchicalJacobian - bsplineJacobian).frobenius_norm() << "." << std::endl;
+      return 1;
+    }
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
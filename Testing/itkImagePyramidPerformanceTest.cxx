@@ -0,0 +1,184 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkMultiResolutionGaussianSmoothingPyramidImageFilter.h"
+#include "itkMultiResolutionShrinkPyramidImageFilter.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiResolutionPyramidImageFilter.h"
+#include "itkRecursiveMultiResolutionPyramidImageFilter.h"
+
+// Report timings and memory
+#include "itkMemoryProbe.h"
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility> // For pair.
+
+//-------------------------------------------------------------------------------------
+// This test measures the time and the memory of the image pyramids, for different
+// image sizes and numbers of levels, on synthetic images. Each combination is reported
+// as one comma separated line on std::cout, so that the pyramids can be compared, also
+// between versions:
+//   pyramid,size,levels,seconds_per_update,output_mb,memory_mb
+// The output is the memory of the images of all levels. The memory is the increase of
+// the memory use of the process by the first update, which includes the outputs, and
+// the intermediate images that are still allocated afterwards.
+//
+// The CPU and OpenCL versions of the generic pyramid are compared by the OpenCL test
+// GPUGenericMultiResolutionPyramidImageFilterTest.
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef float                                                        PixelType;
+typedef itk::Image<PixelType, Dimension>                             ImageType;
+typedef itk::MultiResolutionPyramidImageFilter<ImageType, ImageType> PyramidType;
+typedef std::function<PyramidType::Pointer(void)>                    PyramidFactoryType;
+
+
+/** Creates an image of the given size with a smooth pattern. */
+ImageType::Pointer
+CreateImage(const unsigned int imageSize)
+{
+  ImageType::SizeType size;
+  size.Fill(imageSize);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double value = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      value += std::sin(0.2 * (d + 1) * it.GetIndex()[d]);
+    }
+    it.Set(static_cast<PixelType>(100.0 * value));
+  }
+  return image;
+}
+
+
+/** Returns the mean time of an update of the pyramid, in seconds, the memory of its
+ * outputs in outputMegabytes, and the memory increase of the first update in memoryMegabytes.
+ */
+double
+TimePyramid(PyramidType &              pyramid,
+            const ImageType::Pointer & image,
+            const unsigned int         numberOfLevels,
+            const unsigned int         numberOfUpdates,
+            double &                   outputMegabytes,
+            double &                   memoryMegabytes)
+{
+  pyramid.SetInput(image);
+  pyramid.SetNumberOfLevels(numberOfLevels);
+
+  itk::MemoryProbe memoryProbe;
+  memoryProbe.Start();
+  pyramid.Update();
+  memoryProbe.Stop();
+  memoryMegabytes = memoryProbe.GetMean() / 1024.0;
+
+  outputMegabytes = 0.0;
+  for (unsigned int level = 0; level < numberOfLevels; ++level)
+  {
+    outputMegabytes += pyramid.GetOutput(level)->GetBufferedRegion().GetNumberOfPixels() * sizeof(PixelType);
+  }
+  outputMegabytes /= 1024.0 * 1024.0;
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for (unsigned int i = 0; i < numberOfUpdates; ++i)
+  {
+    pyramid.Modified();
+    pyramid.Update();
+  }
+  timer.Stop();
+  return timer.GetTotal() / numberOfUpdates;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** The number of updates of each pyramid, and the image sizes. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int numberOfUpdates = 1;
+  const unsigned int sizes[] = { 32, 64 };
+#else
+  const unsigned int numberOfUpdates = 5;
+  const unsigned int sizes[] = { 64, 128, 256 };
+#endif
+
+  const unsigned int levels[] = { 2, 4 };
+
+  /** The pyramids of the elastix ImagePyramid components. */
+  typedef itk::MultiResolutionGaussianSmoothingPyramidImageFilter<ImageType, ImageType> SmoothingPyramidType;
+  typedef itk::RecursiveMultiResolutionPyramidImageFilter<ImageType, ImageType>         RecursivePyramidType;
+  typedef itk::MultiResolutionShrinkPyramidImageFilter<ImageType, ImageType>            ShrinkingPyramidType;
+  typedef itk::GenericMultiResolutionPyramidImageFilter<ImageType, ImageType>           GenericPyramidType;
+  const std::pair<std::string, PyramidFactoryType> pyramids[] = {
+    { "Smoothing", []() -> PyramidType::Pointer { return SmoothingPyramidType::New().GetPointer(); } },
+    { "Recursive", []() -> PyramidType::Pointer { return RecursivePyramidType::New().GetPointer(); } },
+    { "Shrinking", []() -> PyramidType::Pointer { return ShrinkingPyramidType::New().GetPointer(); } },
+    { "Generic", []() -> PyramidType::Pointer { return GenericPyramidType::New().GetPointer(); } }
+  };
+
+  std::cout << "pyramid,size,levels,seconds_per_update,output_mb,memory_mb" << std::endl;
+  for (const auto size : sizes)
+  {
+    const ImageType::Pointer image = CreateImage(size);
+    for (const auto & pyramid : pyramids)
+    {
+      for (const auto numberOfLevels : levels)
+      {
+        const std::string combination =
+          pyramid.first + "," + std::to_string(size) + "," + std::to_string(numberOfLevels);
+        try
+        {
+          double       outputMegabytes = 0.0;
+          double       memoryMegabytes = 0.0;
+          const double secondsPerUpdate =
+            TimePyramid(*pyramid.second(), image, numberOfLevels, numberOfUpdates, outputMegabytes, memoryMegabytes);
+          std::cout << combination << "," << secondsPerUpdate << "," << outputMegabytes << "," << memoryMegabytes
+                    << std::endl;
+        }
+        catch (const itk::ExceptionObject & excp)
+        {
+          std::cerr << "ERROR: " << combination << ": " << excp << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,231 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkImageFullSampler.h"
+#include "itkImageGridSampler.h"
+#include "itkImageQuasiRandomCoordinateSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageRandomSampler.h"
+#include "itkImageRandomSamplerSparseMask.h"
+#include "itkMultiInputImageRandomCoordinateSampler.h"
+
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreaderBase.h"
+
+// Report timings
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility> // For pair.
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// This test measures the throughput of the image samplers, for masks that cover
+// different fractions of the image, and for different numbers of threads, on a
+// synthetic image. Each combination is reported as one comma separated line on
+// std::cout, so that the samplers can be compared, also between versions:
+//   sampler,mask_fill,threads,samples,samples_per_second
+// The mask fill "none" means that no mask is used.
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef float                                     PixelType;
+typedef itk::Image<PixelType, Dimension>          ImageType;
+typedef itk::Image<unsigned char, Dimension>      MaskImageType;
+typedef itk::ImageMaskSpatialObject<Dimension>    MaskType;
+typedef itk::ImageSamplerBase<ImageType>          SamplerType;
+typedef std::function<SamplerType::Pointer(void)> SamplerFactoryType;
+
+const unsigned int ImageSize = 64;
+
+
+/** Creates an image with a smooth pattern. */
+ImageType::Pointer
+CreateImage(void)
+{
+  ImageType::SizeType size;
+  size.Fill(ImageSize);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double value = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      value += std::sin(0.2 * (d + 1) * it.GetIndex()[d]);
+    }
+    it.Set(static_cast<PixelType>(100.0 * value));
+  }
+  return image;
+}
+
+
+/** Creates a mask of a centered block that covers about the given fraction of the image. */
+MaskType::Pointer
+CreateMask(const double fillRatio)
+{
+  const double side = ImageSize * std::pow(fillRatio, 1.0 / Dimension);
+  const double begin = 0.5 * (ImageSize - side);
+
+  MaskImageType::SizeType size;
+  size.Fill(ImageSize);
+  const auto maskImage = MaskImageType::New();
+  maskImage->SetRegions(size);
+  maskImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<MaskImageType> it(maskImage, maskImage->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    bool inside = true;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      inside = inside && it.GetIndex()[d] >= begin && it.GetIndex()[d] < begin + side;
+    }
+    it.Set(inside ? 1 : 0);
+  }
+
+  const auto mask = MaskType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+  return mask;
+}
+
+
+/** Returns the number of samples that the sampler generates per second, and the number of
+ * samples of one update in numberOfSamples.
+ */
+double
+TimeSampler(SamplerType &              sampler,
+            const ImageType::Pointer & image,
+            const MaskType *           mask,
+            const itk::ThreadIdType    numberOfThreads,
+            const unsigned int         numberOfUpdates,
+            std::size_t &              numberOfSamples)
+{
+  sampler.SetInput(image);
+  sampler.SetInputImageRegion(image->GetBufferedRegion());
+  if (mask != nullptr)
+  {
+    sampler.SetMask(mask);
+  }
+  sampler.SetNumberOfSamples(20000);
+  sampler.SetUseMultiThread(numberOfThreads > 1);
+  sampler.SetNumberOfWorkUnits(numberOfThreads);
+
+  /** The first update also prepares the mask, so it is not timed. */
+  sampler.Update();
+
+  itk::TimeProbe timer;
+  timer.Start();
+  for (unsigned int i = 0; i < numberOfUpdates; ++i)
+  {
+    sampler.Modified();
+    sampler.Update();
+  }
+  timer.Stop();
+
+  numberOfSamples = sampler.GetOutput()->Size();
+  return timer.GetTotal() > 0.0 ? numberOfSamples * numberOfUpdates / timer.GetTotal() : 0.0;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** The number of updates of each sampler. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  const unsigned int numberOfUpdates = 2;
+#else
+  const unsigned int numberOfUpdates = 20;
+#endif
+
+  const ImageType::Pointer image = CreateImage();
+
+  /** The samplers of the elastix ImageSampler components. */
+  const std::pair<std::string, SamplerFactoryType> samplers[] = {
+    { "Full", []() -> SamplerType::Pointer { return itk::ImageFullSampler<ImageType>::New().GetPointer(); } },
+    { "Grid", []() -> SamplerType::Pointer { return itk::ImageGridSampler<ImageType>::New().GetPointer(); } },
+    { "Random", []() -> SamplerType::Pointer { return itk::ImageRandomSampler<ImageType>::New().GetPointer(); } },
+    { "RandomSparseMask",
+      []() -> SamplerType::Pointer { return itk::ImageRandomSamplerSparseMask<ImageType>::New().GetPointer(); } },
+    { "RandomCoordinate",
+      []() -> SamplerType::Pointer { return itk::ImageRandomCoordinateSampler<ImageType>::New().GetPointer(); } },
+    { "QuasiRandomCoordinate",
+      []() -> SamplerType::Pointer { return itk::ImageQuasiRandomCoordinateSampler<ImageType>::New().GetPointer(); } },
+    { "MultiInputRandomCoordinate",
+      []() -> SamplerType::Pointer {
+        return itk::MultiInputImageRandomCoordinateSampler<ImageType>::New().GetPointer();
+      } }
+  };
+
+  /** The masks, covering all of the image down to a small part of it. */
+  const std::pair<std::string, MaskType::Pointer> masks[] = {
+    { "none", nullptr }, { "1.0", CreateMask(1.0) }, { "0.5", CreateMask(0.5) }, { "0.1", CreateMask(0.1) },
+    { "0.01", CreateMask(0.01) }
+  };
+
+  /** The parallel efficiency follows from the throughput for 1, 2, 4, ... threads. */
+  std::vector<itk::ThreadIdType> threads;
+  const itk::ThreadIdType        maximumNumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  for (itk::ThreadIdType numberOfThreads = 1; numberOfThreads < maximumNumberOfThreads; numberOfThreads *= 2)
+  {
+    threads.push_back(numberOfThreads);
+  }
+  threads.push_back(maximumNumberOfThreads);
+
+  std::cout << "sampler,mask_fill,threads,samples,samples_per_second" << std::endl;
+  for (const auto & sampler : samplers)
+  {
+    for (const auto & mask : masks)
+    {
+      for (const auto numberOfThreads : threads)
+      {
+        const std::string combination = sampler.first + "," + mask.first + "," + std::to_string(numberOfThreads);
+        try
+        {
+          std::size_t  numberOfSamples = 0;
+          const double samplesPerSecond =
+            TimeSampler(*sampler.second(), image, mask.second, numberOfThreads, numberOfUpdates, numberOfSamples);
+          std::cout << combination << "," << numberOfSamples << "," << samplesPerSecond << std::endl;
+        }
+        catch (const itk::ExceptionObject & excp)
+        {
+          std::cerr << "ERROR: " << combination << ": " << excp << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,211 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the search direction of the LBFGSHistory equals the one of the original two-loop
+ * recursion of the QuasiNewtonLBFGSOptimizer, in double and in float storage, computed by the
+ * calling thread and divided over work units, after the circular buffer has wrapped around. */
+
+#include "itkLBFGSHistory.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+typedef itk::LBFGSHistory::VectorType         VectorType;
+typedef itk::LBFGSHistory::RhoType            RhoType;
+typedef itk::LBFGSHistory::DiagonalMatrixType DiagonalMatrixType;
+
+const unsigned int Memory = 5;
+const unsigned int NumberOfPairs = 7;
+
+
+/** The two-loop recursion as the QuasiNewtonLBFGSOptimizer computed it before the LBFGSHistory. */
+void
+ReferenceSearchDirection(const std::vector<VectorType> & S,
+                         const std::vector<VectorType> & Y,
+                         const VectorType &              gradient,
+                         const RhoType &                 rho,
+                         const unsigned int              point,
+                         const unsigned int              bound,
+                         const DiagonalMatrixType &      H0,
+                         VectorType &                    searchDir)
+{
+  const unsigned int numberOfParameters = gradient.GetSize();
+  itk::Array<double> alpha(Memory);
+
+  searchDir = -gradient;
+
+  int cp = static_cast<int>(point);
+  for (unsigned int i = 0; i < bound; ++i)
+  {
+    --cp;
+    if (cp == -1)
+    {
+      cp = Memory - 1;
+    }
+    const double sq = inner_product(S[cp], searchDir);
+    alpha[cp] = rho[cp] * sq;
+    for (unsigned int j = 0; j < numberOfParameters; ++j)
+    {
+      searchDir[j] -= alpha[cp] * Y[cp][j];
+    }
+  }
+
+  for (unsigned int j = 0; j < numberOfParameters; ++j)
+  {
+    searchDir[j] *= H0[j];
+  }
+
+  for (unsigned int i = 0; i < bound; ++i)
+  {
+    const double yr = inner_product(Y[cp], searchDir);
+    const double beta = rho[cp] * yr;
+    for (unsigned int j = 0; j < numberOfParameters; ++j)
+    {
+      searchDir[j] += (alpha[cp] - beta) * S[cp][j];
+    }
+    ++cp;
+    if (static_cast<unsigned int>(cp) == Memory)
+    {
+      cp = 0;
+    }
+  }
+}
+
+
+/** Stores random pairs with s'y > 0 in the history, and compares its search directions with the
+ * reference, for a diagonal and for a scalar initial matrix.
+ */
+bool
+TestHistory(const unsigned int      numberOfParameters,
+            const bool              useFloatStorage,
+            const itk::ThreadIdType numberOfWorkUnits)
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(2468);
+
+  const auto history = itk::LBFGSHistory::New();
+  history->SetUseFloatStorage(useFloatStorage);
+  history->SetNumberOfWorkUnits(numberOfWorkUnits);
+  history->SetMinimumNumberOfParametersPerWorkUnit(1000);
+  history->Initialize(Memory, numberOfParameters);
+
+  /** The reference works on the values as they are stored, so in float storage on rounded values. */
+  std::vector<VectorType> S(Memory);
+  std::vector<VectorType> Y(Memory);
+  RhoType                 rho(Memory);
+  unsigned int            point = 0;
+  for (unsigned int k = 0; k < NumberOfPairs; ++k)
+  {
+    VectorType s(numberOfParameters);
+    VectorType y(numberOfParameters);
+    for (unsigned int j = 0; j < numberOfParameters; ++j)
+    {
+      s[j] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+      y[j] = (1.0 + j % 3) * s[j] + randomGenerator->GetUniformVariate(-0.1, 0.1);
+      if (useFloatStorage)
+      {
+        s[j] = static_cast<float>(s[j]);
+        y[j] = static_cast<float>(y[j]);
+      }
+    }
+    history->Store(point, s, y);
+    S[point] = s;
+    Y[point] = y;
+    rho[point] = 1.0 / inner_product(s, y);
+
+    const double relativeDifference = std::abs(history->GetInnerProductSY(point) * rho[point] - 1.0);
+    if (relativeDifference > 1e-12)
+    {
+      std::cerr << "ERROR: s'y of pair " << k << " differs by a factor " << relativeDifference << "." << std::endl;
+      return false;
+    }
+    point = (point + 1) % Memory;
+  }
+  const unsigned int bound = Memory;
+
+  VectorType gradient(numberOfParameters);
+  for (unsigned int j = 0; j < numberOfParameters; ++j)
+  {
+    gradient[j] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+  }
+  const double       h0 = 0.7;
+  DiagonalMatrixType H0(numberOfParameters);
+  DiagonalMatrixType scalarH0(numberOfParameters);
+  for (unsigned int j = 0; j < numberOfParameters; ++j)
+  {
+    H0[j] = 0.5 + 0.25 * (j % 4);
+  }
+  scalarH0.Fill(h0);
+
+  VectorType referenceDir;
+  VectorType searchDir(numberOfParameters);
+  VectorType scalarReferenceDir;
+  VectorType scalarSearchDir(numberOfParameters);
+  ReferenceSearchDirection(S, Y, gradient, rho, point, bound, H0, referenceDir);
+  ReferenceSearchDirection(S, Y, gradient, rho, point, bound, scalarH0, scalarReferenceDir);
+  history->ComputeSearchDirection(gradient, rho, point, bound, H0, searchDir);
+  history->ComputeSearchDirection(gradient, rho, point, bound, h0, scalarSearchDir);
+
+  const double difference = (searchDir - referenceDir).magnitude() / referenceDir.magnitude();
+  const double scalarDifference = (scalarSearchDir - scalarReferenceDir).magnitude() / scalarReferenceDir.magnitude();
+  std::cerr << numberOfParameters << " parameters, float storage " << useFloatStorage << ", " << numberOfWorkUnits
+            << " work units: relative difference " << difference << " (diagonal H0), " << scalarDifference
+            << " (scalar H0)" << std::endl;
+  if (difference > 1e-10 || scalarDifference > 1e-10)
+  {
+    std::cerr << "ERROR: the search direction differs from the reference." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  bool success = true;
+  try
+  {
+    /** Small problems are handled by the calling thread; large ones are divided over the work units. */
+    success &= TestHistory(1000, false, 1);
+    success &= TestHistory(1000, true, 1);
+    success &= TestHistory(100000, false, 4);
+    success &= TestHistory(100000, true, 4);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
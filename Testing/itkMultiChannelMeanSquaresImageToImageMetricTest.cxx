@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the MultiChannelMeanSquaresImageToImageMetric with a single channel gives the same
+ * value and derivative as the AdvancedMeanSquaresImageToImageMetric, for the same images, samples,
+ * B-spline interpolator and B-spline transform. */
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "MultiChannelMeanSquares/itkMultiChannelMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const unsigned int Dimension = 2;
+
+typedef float                                                           PixelType;
+typedef itk::Image<PixelType, Dimension>                                ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>   TransformType;
+typedef itk::BSplineInterpolateImageFunction<ImageType, double, double> InterpolatorType;
+
+
+/** Creates an image with a smooth blob, centered at the given position. */
+ImageType::Pointer
+CreateBlobImage(const double center)
+{
+  ImageType::SizeType size;
+  size.Fill(48);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center - 2.0 * d;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<PixelType>(100.0 * std::exp(-squaredDistance / 100.0)));
+  }
+  return image;
+}
+
+
+/** Returns the value and derivative of the metric, with its own sampler and interpolator. */
+template <class TMetric>
+void
+ComputeValueAndDerivative(const ImageType::Pointer &         fixedImage,
+                          const ImageType::Pointer &         movingImage,
+                          TransformType &                    transform,
+                          typename TMetric::MeasureType &    value,
+                          typename TMetric::DerivativeType & derivative)
+{
+  const auto sampler = itk::ImageFullSampler<ImageType>::New();
+  const auto interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder(3);
+
+  const auto metric = TMetric::New();
+  metric->SetFixedImage(fixedImage);
+  metric->SetMovingImage(movingImage);
+  metric->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  metric->SetTransform(&transform);
+  metric->SetInterpolator(interpolator);
+  metric->SetImageSampler(sampler);
+  metric->Initialize();
+  metric->GetValueAndDerivative(transform.GetParameters(), value, derivative);
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const ImageType::Pointer fixedImage = CreateBlobImage(22.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(25.0);
+
+  /** A B-spline transform with a grid of 8^2 control points, and a smooth deformation. */
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(8);
+  gridSpacing.Fill(9.0);
+  gridOrigin.Fill(-9.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.2 * static_cast<double>((i * 5) % 7) - 0.6;
+  }
+  transform->SetParameters(parameters);
+
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>     MeanSquaresMetricType;
+  typedef itk::MultiChannelMeanSquaresImageToImageMetric<ImageType, ImageType> MultiChannelMetricType;
+
+  MeanSquaresMetricType::MeasureType     meanSquaresValue{};
+  MeanSquaresMetricType::DerivativeType  meanSquaresDerivative;
+  MultiChannelMetricType::MeasureType    multiChannelValue{};
+  MultiChannelMetricType::DerivativeType multiChannelDerivative;
+  try
+  {
+    ComputeValueAndDerivative<MeanSquaresMetricType>(
+      fixedImage, movingImage, *transform, meanSquaresValue, meanSquaresDerivative);
+    ComputeValueAndDerivative<MultiChannelMetricType>(
+      fixedImage, movingImage, *transform, multiChannelValue, multiChannelDerivative);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  std::cerr << "AdvancedMeanSquares value: " << meanSquaresValue << "\n"
+            << "MultiChannelMeanSquares value: " << multiChannelValue << std::endl;
+
+  const double tolerance = 1e-6;
+  if (std::abs(multiChannelValue - meanSquaresValue) > tolerance * std::abs(meanSquaresValue))
+  {
+    std::cerr << "ERROR: the values of the metrics differ." << std::endl;
+    return 1;
+  }
+  if (multiChannelDerivative.GetSize() != meanSquaresDerivative.GetSize())
+  {
+    std::cerr << "ERROR: the derivatives of the metrics have a different size." << std::endl;
+    return 1;
+  }
+  const double derivativeDifference = (multiChannelDerivative - meanSquaresDerivative).magnitude();
+  std::cerr << "Difference of the derivatives: " << derivativeDifference << ", magnitude "
+            << meanSquaresDerivative.magnitude() << std::endl;
+  if (derivativeDifference > tolerance * meanSquaresDerivative.magnitude())
+  {
+    std::cerr << "ERROR: the derivatives of the metrics differ." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
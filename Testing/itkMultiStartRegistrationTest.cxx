@@ -0,0 +1,201 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests the multi-start registration of MultiResolutionImageRegistrationMethod2 with two starts, of
+ * which the first one, the initial parameters, lies in the basin of a clearly worse local minimum.
+ * Both starts must be optimized at the first level, after which only the best one, the second start,
+ * survives: it must be the only start that is optimized at the second level, and be the result. */
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiResolutionImageRegistrationMethod2.h"
+#include "itkParallelSimplexOptimizer.h"
+
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+const unsigned int Dimension = 2;
+
+typedef float                                                              PixelType;
+typedef itk::Image<PixelType, Dimension>                                   ImageType;
+typedef itk::AdvancedTranslationTransform<double, Dimension>               TransformType;
+typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>     InterpolatorType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<ImageType, ImageType>   MetricType;
+typedef itk::MultiResolutionImageRegistrationMethod2<ImageType, ImageType> RegistrationType;
+typedef itk::MultiResolutionPyramidImageFilter<ImageType, ImageType>       PyramidType;
+typedef itk::ParallelSimplexOptimizer                                      OptimizerType;
+typedef RegistrationType::ParametersType                                   ParametersType;
+typedef std::set<std::pair<unsigned long, itk::SizeValueType>>             LevelAndStartSetType;
+
+
+/** Creates an image of 64 x 32 voxels with a blob of the given amplitude at each of the given x positions. */
+ImageType::Pointer
+CreateBlobImage(const std::vector<std::pair<double, double>> & blobs)
+{
+  ImageType::SizeType size;
+  size[0] = 64;
+  size[1] = 32;
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double value = 0.0;
+    for (const auto & blob : blobs)
+    {
+      const double dx = it.GetIndex()[0] - blob.first;
+      const double dy = it.GetIndex()[1] - 16.0;
+      value += blob.second * std::exp(-(dx * dx + dy * dy) / 8.0);
+    }
+    it.Set(static_cast<PixelType>(value));
+  }
+  return image;
+}
+
+
+/** Records the level and the start of every iteration of the optimizer. */
+struct RecorderType
+{
+  RegistrationType *   m_Registration;
+  LevelAndStartSetType m_LevelsAndStarts;
+};
+
+
+void
+RecordLevelAndStart(itk::Object *, const itk::EventObject &, void * clientData)
+{
+  auto * recorder = static_cast<RecorderType *>(clientData);
+  recorder->m_LevelsAndStarts.insert(
+    std::make_pair(recorder->m_Registration->GetCurrentLevel(), recorder->m_Registration->GetCurrentStart()));
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** The moving image has the blob of the fixed image at a translation of (2, 0), and a
+   * weaker one at (22, 0), which gives a local minimum with a clearly higher value.
+   */
+  const ImageType::Pointer fixedImage = CreateBlobImage({ { 24.0, 100.0 } });
+  const ImageType::Pointer movingImage = CreateBlobImage({ { 26.0, 100.0 }, { 46.0, 60.0 } });
+
+  const auto optimizer = OptimizerType::New();
+  ParametersType simplexDelta(Dimension);
+  simplexDelta.Fill(1.0);
+  optimizer->SetInitialSimplexDelta(simplexDelta);
+  optimizer->SetMaximumNumberOfIterations(100);
+
+  const auto metric = MetricType::New();
+  metric->SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+
+  const auto registration = RegistrationType::New();
+  registration->SetFixedImage(fixedImage);
+  registration->SetMovingImage(movingImage);
+  registration->SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  registration->SetFixedImagePyramid(PyramidType::New());
+  registration->SetMovingImagePyramid(PyramidType::New());
+  registration->SetNumberOfLevels(2);
+  registration->SetTransform(TransformType::New());
+  registration->SetInterpolator(InterpolatorType::New());
+  registration->SetMetric(metric);
+  registration->SetOptimizer(optimizer);
+
+  /** The first start lies near the worse minimum, the second one near the best. */
+  ParametersType initialParameters(Dimension);
+  initialParameters[0] = 21.0;
+  initialParameters[1] = 0.5;
+  ParametersType offset(Dimension);
+  offset[0] = -20.0;
+  offset[1] = -1.0;
+  registration->SetInitialTransformParameters(initialParameters);
+  registration->SetMultiStartParameterOffsets(RegistrationType::ParametersContainerType(1, offset));
+  registration->SetNumberOfSurvivingStarts(1);
+
+  RecorderType recorder;
+  recorder.m_Registration = registration;
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback(&RecordLevelAndStart);
+  command->SetClientData(&recorder);
+  optimizer->AddObserver(itk::IterationEvent(), command);
+
+  try
+  {
+    registration->StartRegistration();
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const ParametersType &                       result = registration->GetLastTransformParameters();
+  const RegistrationType::MeasureContainerType values = registration->GetMultiStartValues();
+  std::cerr << "Result: " << result << ", values of the starts after the first level:";
+  for (const auto value : values)
+  {
+    std::cerr << " " << value;
+  }
+  std::cerr << std::endl;
+
+  bool success = true;
+  const LevelAndStartSetType expectedLevelsAndStarts = { { 0, 0 }, { 0, 1 }, { 1, 0 } };
+  if (recorder.m_LevelsAndStarts != expectedLevelsAndStarts)
+  {
+    std::cerr << "ERROR: both starts must be optimized at the first level, and only one at the second level."
+              << std::endl;
+    success = false;
+  }
+  if (registration->GetNumberOfStarts() != 1)
+  {
+    std::cerr << "ERROR: the worse start is not pruned: " << registration->GetNumberOfStarts() << " starts remain."
+              << std::endl;
+    success = false;
+  }
+  if (values.size() != 2 || !(values[0] < 0.5 * values[1]))
+  {
+    std::cerr << "ERROR: the values of the starts are not sorted, or do not differ clearly." << std::endl;
+    success = false;
+  }
+  if (std::abs(result[0] - 2.0) > 0.1 || std::abs(result[1]) > 0.1)
+  {
+    std::cerr << "ERROR: the result is not the best start, which converges to (2, 0)." << std::endl;
+    success = false;
+  }
+
+  if (!success)
+  {
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "The results are good." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkOpenCLDeviceLoadBalancer.h"
+#include "itkTestHelper.h"
+
+#include <numeric>
+
+int
+main(void)
+{
+  try
+  {
+    itk::OpenCLDeviceLoadBalancer balancer;
+    ITK_OPENCL_COMPARE(balancer.GetNumberOfDevices(), (std::size_t)1);
+
+    // Without measurements the work is spread evenly
+    balancer.SetNumberOfDevices(3);
+    for (std::size_t device = 0; device < 3; ++device)
+    {
+      ITK_OPENCL_COMPARE(balancer.SelectDevice(10.0), device);
+      balancer.AddWork(device, 10.0);
+    }
+    ITK_OPENCL_COMPARE(balancer.GetNumberOfPendingWorkItems(1), (std::size_t)1);
+
+    const std::vector<std::size_t> workSizes = balancer.SplitWork(100);
+    ITK_OPENCL_COMPARE(workSizes.size(), (std::size_t)3);
+    ITK_OPENCL_COMPARE(std::accumulate(workSizes.begin(), workSizes.end(), (std::size_t)0), (std::size_t)100);
+    ITK_OPENCL_COMPARE(workSizes[1], (std::size_t)33);
+
+    // Finishing work removes it from the device
+    balancer.FinishWork(1);
+    balancer.FinishWork(1);
+    ITK_OPENCL_COMPARE(balancer.GetNumberOfPendingWorkItems(1), (std::size_t)0);
+    ITK_OPENCL_COMPARE(balancer.SelectDevice(10.0), (std::size_t)1);
+
+    // Pending work is discarded when the number of devices is set again
+    balancer.SetNumberOfDevices(3);
+    ITK_OPENCL_COMPARE(balancer.GetNumberOfPendingWorkItems(0), (std::size_t)0);
+  }
+  catch (itk::ExceptionObject & e)
+  {
+    std::cerr << "Caught ITK exception: " << e << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
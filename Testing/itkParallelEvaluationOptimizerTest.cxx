@@ -0,0 +1,200 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the optimizers that evaluate independent positions in batches give
+ * the same result when the batches are evaluated by work units, each with its
+ * own copy of the cost function, as when they are evaluated one by one. */
+
+#include "CMAEvolutionStrategy/itkCMAEvolutionStrategyOptimizer.h"
+#include "FiniteDifferenceGradientDescent/itkFiniteDifferenceGradientDescentOptimizer.h"
+#include "FullSearch/itkFullSearchOptimizer.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+const unsigned int NumberOfParameters = 3;
+const unsigned int NumberOfWorkUnits = 4;
+
+/** A quadratic cost function with its minimum at (1, 2, 3), which is safe to evaluate concurrently. */
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+  typedef QuadraticCostFunction         Self;
+  typedef itk::SingleValuedCostFunction Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+  itkNewMacro(Self);
+
+  MeasureType
+  GetValue(const ParametersType & parameters) const override
+  {
+    MeasureType value = 0.0;
+    for (unsigned int i = 0; i < NumberOfParameters; ++i)
+    {
+      const double difference = parameters[i] - (i + 1.0);
+      value += (i + 1.0) * difference * difference;
+    }
+    return value;
+  }
+
+  void
+  GetDerivative(const ParametersType &, DerivativeType &) const override
+  {
+    itkExceptionMacro(<< "The derivative is not implemented.");
+  }
+
+  unsigned int
+  GetNumberOfParameters(void) const override
+  {
+    return NumberOfParameters;
+  }
+};
+
+
+typedef itk::SingleValuedCostFunction::ParametersType ParametersType;
+
+/** Give the optimizer its cost function, and optionally let it evaluate the batches with work units. */
+template <class TOptimizer>
+void
+SetCostFunctions(TOptimizer * optimizer, const bool useWorkUnits)
+{
+  optimizer->SetCostFunction(QuadraticCostFunction::New());
+  if (useWorkUnits)
+  {
+    typename TOptimizer::CostFunctionContainerType workUnitCostFunctions;
+    for (unsigned int k = 0; k < NumberOfWorkUnits; ++k)
+    {
+      workUnitCostFunctions.push_back(QuadraticCostFunction::New());
+    }
+    optimizer->SetUseMultiThread(true);
+    optimizer->SetNumberOfWorkUnits(NumberOfWorkUnits);
+    optimizer->SetWorkUnitCostFunctions(workUnitCostFunctions);
+  }
+}
+
+
+/** Check that the final positions of the sequential and the parallel evaluation are the same. */
+bool
+CheckPositions(const char * name, const ParametersType & sequentialPosition, const ParametersType & parallelPosition)
+{
+  std::cerr << name << ": " << sequentialPosition << " (sequential), " << parallelPosition << " (work units)"
+            << std::endl;
+  if (sequentialPosition != parallelPosition)
+  {
+    std::cerr << "ERROR: the work units of " << name << " give a different result." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+/** Run the CMAEvolutionStrategyOptimizer, of which the work units evaluate the offspring. */
+ParametersType
+RunCMAEvolutionStrategy(const bool useWorkUnits)
+{
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed(121212);
+
+  ParametersType initialPosition(NumberOfParameters);
+  initialPosition.Fill(0.0);
+  itk::CMAEvolutionStrategyOptimizer::ScalesType scales(NumberOfParameters);
+  scales[0] = 1.0;
+  scales[1] = 4.0;
+  scales[2] = 0.25;
+
+  itk::CMAEvolutionStrategyOptimizer::Pointer optimizer = itk::CMAEvolutionStrategyOptimizer::New();
+  SetCostFunctions(optimizer.GetPointer(), useWorkUnits);
+  optimizer->SetInitialPosition(initialPosition);
+  optimizer->SetScales(scales);
+  optimizer->SetUseScales(true);
+  optimizer->SetMaximumNumberOfIterations(30);
+  optimizer->StartOptimization();
+  return optimizer->GetCurrentPosition();
+}
+
+
+/** Run the FiniteDifferenceGradientDescentOptimizer, of which the work units evaluate the finite differences. */
+ParametersType
+RunFiniteDifferenceGradientDescent(const bool useWorkUnits)
+{
+  ParametersType initialPosition(NumberOfParameters);
+  initialPosition.Fill(0.0);
+  itk::FiniteDifferenceGradientDescentOptimizer::ScalesType scales(NumberOfParameters);
+  scales[0] = 1.0;
+  scales[1] = 2.0;
+  scales[2] = 0.5;
+
+  itk::FiniteDifferenceGradientDescentOptimizer::Pointer optimizer =
+    itk::FiniteDifferenceGradientDescentOptimizer::New();
+  SetCostFunctions(optimizer.GetPointer(), useWorkUnits);
+  optimizer->SetInitialPosition(initialPosition);
+  optimizer->SetScales(scales);
+  optimizer->SetUseScales(true);
+  optimizer->SetNumberOfIterations(50);
+  optimizer->SetParam_a(0.1);
+  optimizer->SetParam_c(0.1);
+  optimizer->StartOptimization();
+  return optimizer->GetCurrentPosition();
+}
+
+
+/** Run the FullSearchOptimizer, of which the work units evaluate the grid points, coarse-to-fine. */
+ParametersType
+RunFullSearch(const bool useWorkUnits)
+{
+  ParametersType initialPosition(NumberOfParameters);
+  initialPosition.Fill(0.0);
+
+  itk::FullSearchOptimizer::Pointer optimizer = itk::FullSearchOptimizer::New();
+  SetCostFunctions(optimizer.GetPointer(), useWorkUnits);
+  optimizer->SetInitialPosition(initialPosition);
+  for (unsigned int i = 0; i < NumberOfParameters; ++i)
+  {
+    optimizer->AddSearchDimension(i, -4.0, 6.0, 0.125);
+  }
+  optimizer->SetCoarseToFine(true);
+  optimizer->StartOptimization();
+  return optimizer->GetCurrentPosition();
+}
+
+} // end namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  bool success = true;
+  success &= CheckPositions("CMAEvolutionStrategy", RunCMAEvolutionStrategy(false), RunCMAEvolutionStrategy(true));
+  success &= CheckPositions("FiniteDifferenceGradientDescent",
+                            RunFiniteDifferenceGradientDescent(false),
+                            RunFiniteDifferenceGradientDescent(true));
+  success &= CheckPositions("FullSearch", RunFullSearch(false), RunFullSearch(true));
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
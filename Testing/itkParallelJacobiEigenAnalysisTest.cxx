@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelJacobiEigenAnalysis.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  typedef itk::ParallelJacobiEigenAnalysis                       EigenAnalysisType;
+  typedef EigenAnalysisType::MatrixType                          MatrixType;
+  typedef EigenAnalysisType::VectorType                          VectorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::New();
+  randomGenerator->SetSeed(12345);
+
+  /** Sizes below, at and above the work unit count, odd and even, and with a covariance
+   * matrix of which the eigenvalues differ by orders of magnitude. */
+  const unsigned int sizes[] = { 1, 2, 5, 33, 70, 70 };
+  for (unsigned int c = 0; c < 6; ++c)
+  {
+    const unsigned int n = sizes[c];
+    const bool         covariance = (c == 5);
+
+    MatrixType matrix(n, n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      for (unsigned int j = i; j < n; ++j)
+      {
+        matrix[i][j] = randomGenerator->GetNormalVariate();
+        matrix[j][i] = matrix[i][j];
+      }
+    }
+    if (covariance)
+    {
+      MatrixType scaled = matrix;
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        scaled.scale_row(i, std::pow(10.0, 4.0 * i / n));
+      }
+      matrix = scaled * scaled.transpose();
+    }
+
+    /** Only the upper triangle is read: spoil the lower one. */
+    MatrixType upper = matrix;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      for (unsigned int j = 0; j < i; ++j)
+      {
+        upper[i][j] = 1e10;
+      }
+    }
+
+    VectorType sequentialValues;
+    MatrixType sequentialVectors;
+    VectorType parallelValues;
+    MatrixType parallelVectors;
+    if (!EigenAnalysisType::ComputeEigenValuesAndVectors(upper, sequentialValues, sequentialVectors, 1) ||
+        !EigenAnalysisType::ComputeEigenValuesAndVectors(upper, parallelValues, parallelVectors, 4))
+    {
+      std::cerr << "ERROR: the eigen analysis of size " << n << " did not converge." << std::endl;
+      return 1;
+    }
+
+    /** The result does not depend on the number of work units. */
+    if (parallelValues != sequentialValues || parallelVectors != sequentialVectors)
+    {
+      std::cerr << "ERROR: the eigen analysis of size " << n << " depends on the number of work units." << std::endl;
+      return 1;
+    }
+
+    /** The eigenvalues are those of vnl, in ascending order. */
+    const vnl_symmetric_eigensystem<double> eigenSystem(matrix);
+    const double                            scale = std::max(1.0, matrix.frobenius_norm());
+    for (unsigned int k = 0; k < n; ++k)
+    {
+      if (std::abs(sequentialValues[k] - eigenSystem.get_eigenvalue(k)) > 1e-12 * scale)
+      {
+        std::cerr << "ERROR: eigenvalue " << k << " of size " << n << " is " << sequentialValues[k]
+                  << ", but vnl gives " << eigenSystem.get_eigenvalue(k) << "." << std::endl;
+        return 1;
+      }
+    }
+
+    /** The eigenvectors are orthonormal, and A V = V D. */
+    MatrixType residual = matrix * sequentialVectors;
+    for (unsigned int k = 0; k < n; ++k)
+    {
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        residual[i][k] -= sequentialVectors[i][k] * sequentialValues[k];
+      }
+    }
+    MatrixType identity(n, n);
+    identity.set_identity();
+    const double orthogonality = (sequentialVectors.transpose() * sequentialVectors - identity).absolute_value_max();
+    std::cerr << "Size " << n << ": residual " << residual.absolute_value_max() << ", orthogonality " << orthogonality
+              << "." << std::endl;
+    if (residual.absolute_value_max() > 1e-12 * scale || orthogonality > 1e-12)
+    {
+      std::cerr << "ERROR: the eigenvectors of size " << n << " are not accurate." << std::endl;
+      return 1;
+    }
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
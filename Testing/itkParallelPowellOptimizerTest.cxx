@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "ParallelPowell/itkParallelPowellOptimizer.h"
+#include "itkCommand.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+/** A quadratic with coupled parameters, of which the minimum is at (1, -2, 0.5). */
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+  typedef QuadraticCostFunction         Self;
+  typedef itk::SingleValuedCostFunction Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+  itkNewMacro(Self);
+
+  MeasureType
+  GetValue(const ParametersType & parameters) const override
+  {
+    ++this->m_NumberOfEvaluations;
+    const double x = parameters[0] - 1.0;
+    const double y = parameters[1] + 2.0;
+    const double z = parameters[2] - 0.5;
+    return x * x + 2.0 * y * y + 3.0 * z * z + x * y - 0.5 * y * z;
+  }
+
+  void
+  GetDerivative(const ParametersType &, DerivativeType &) const override
+  {
+    itkExceptionMacro(<< "The derivative is not implemented.");
+  }
+
+  unsigned int
+  GetNumberOfParameters(void) const override
+  {
+    return 3;
+  }
+
+  mutable unsigned long m_NumberOfEvaluations{ 0 };
+};
+
+
+/** Records the current position of the optimizer at every iteration. */
+void
+RecordIterate(itk::Object * caller, const itk::EventObject &, void * clientData)
+{
+  const auto * optimizer = dynamic_cast<itk::ParallelPowellOptimizer *>(caller);
+  auto *       iterates = static_cast<std::vector<itk::ParallelPowellOptimizer::ParametersType> *>(clientData);
+  iterates->push_back(optimizer->GetCurrentPosition());
+}
+
+
+/** Creates an optimizer of the quadratic, with four probes per batch. */
+itk::ParallelPowellOptimizer::Pointer
+CreateOptimizer(void)
+{
+  itk::ParallelPowellOptimizer::ParametersType initialPosition(3);
+  initialPosition[0] = -3.0;
+  initialPosition[1] = 4.0;
+  initialPosition[2] = 2.0;
+
+  itk::ParallelPowellOptimizer::Pointer optimizer = itk::ParallelPowellOptimizer::New();
+  optimizer->SetCostFunction(QuadraticCostFunction::New());
+  optimizer->SetInitialPosition(initialPosition);
+  optimizer->SetStepLength(1.0);
+  optimizer->SetStepTolerance(1e-8);
+  optimizer->SetValueTolerance(1e-12);
+  optimizer->SetMaximumIteration(50);
+  optimizer->SetNumberOfLineProbes(4);
+  return optimizer;
+}
+
+
+/** Runs the optimizer, and returns its iterates. */
+std::vector<itk::ParallelPowellOptimizer::ParametersType>
+RunOptimizer(itk::ParallelPowellOptimizer * optimizer)
+{
+  std::vector<itk::ParallelPowellOptimizer::ParametersType> iterates;
+
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback(&RecordIterate);
+  command->SetClientData(&iterates);
+  optimizer->AddObserver(itk::IterationEvent(), command);
+
+  optimizer->StartOptimization();
+  return iterates;
+}
+
+} // end namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  typedef itk::ParallelPowellOptimizer OptimizerType;
+  typedef OptimizerType::ParametersType ParametersType;
+
+  /** Run the optimizer with sequential evaluation of the probes. */
+  OptimizerType::Pointer            sequentialOptimizer = CreateOptimizer();
+  const std::vector<ParametersType> sequentialIterates = RunOptimizer(sequentialOptimizer);
+
+  /** The optimizer finds the minimum. */
+  const ParametersType & position = sequentialOptimizer->GetCurrentPosition();
+  std::cerr << "The optimizer stopped at " << position << " after " << sequentialIterates.size() << " iterations, "
+            << "with stop condition " << sequentialOptimizer->GetStopCondition() << "." << std::endl;
+  if (std::abs(position[0] - 1.0) > 1e-4 || std::abs(position[1] + 2.0) > 1e-4 || std::abs(position[2] - 0.5) > 1e-4)
+  {
+    std::cerr << "ERROR: the optimizer did not find the minimum at (1, -2, 0.5)." << std::endl;
+    return 1;
+  }
+  if (sequentialOptimizer->GetStopCondition() != OptimizerType::ValueTolerance)
+  {
+    std::cerr << "ERROR: the optimizer did not converge." << std::endl;
+    return 1;
+  }
+
+  /** Run the optimizer with multi-threaded evaluation, each work unit with its own cost function. */
+  OptimizerType::CostFunctionContainerType    workUnitCostFunctions;
+  std::vector<QuadraticCostFunction::Pointer> copies;
+  for (unsigned int k = 0; k < 4; ++k)
+  {
+    copies.push_back(QuadraticCostFunction::New());
+    workUnitCostFunctions.push_back(copies.back());
+  }
+
+  OptimizerType::Pointer parallelOptimizer = CreateOptimizer();
+  parallelOptimizer->SetUseMultiThread(true);
+  parallelOptimizer->SetNumberOfWorkUnits(4);
+  parallelOptimizer->SetWorkUnitCostFunctions(workUnitCostFunctions);
+  const std::vector<ParametersType> parallelIterates = RunOptimizer(parallelOptimizer);
+
+  /** The work units evaluated the probes. */
+  unsigned long numberOfWorkUnitEvaluations = 0;
+  for (const auto & copy : copies)
+  {
+    numberOfWorkUnitEvaluations += copy->m_NumberOfEvaluations;
+  }
+  if (numberOfWorkUnitEvaluations == 0)
+  {
+    std::cerr << "ERROR: the work unit cost functions were not used." << std::endl;
+    return 1;
+  }
+
+  /** With a fixed number of probes, the parallel evaluation gives the same iterates as the sequential one. */
+  if (parallelIterates != sequentialIterates)
+  {
+    std::cerr << "ERROR: the iterates of the parallel evaluation differ from the sequential ones." << std::endl;
+    return 1;
+  }
+  if (parallelOptimizer->GetCurrentValue() != sequentialOptimizer->GetCurrentValue() ||
+      parallelOptimizer->GetNumberOfCostFunctionEvaluations() !=
+        sequentialOptimizer->GetNumberOfCostFunctionEvaluations())
+  {
+    std::cerr << "ERROR: the final value or the number of evaluations of the parallel evaluation differs from the "
+              << "sequential one." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
@@ -0,0 +1,221 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkParallelSimplexOptimizer.h"
+#include "itkCommand.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include <vnl/algo/vnl_amoeba.h>
+#include <vnl/vnl_cost_function.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+/** The Rosenbrock function, of which the valley keeps the simplex large for many iterations. */
+double
+Rosenbrock(const double x, const double y)
+{
+  return 100.0 * (y - x * x) * (y - x * x) + (1.0 - x) * (1.0 - x);
+}
+
+
+/** The Rosenbrock function as an ITK cost function, which optionally records the evaluated positions. */
+class RosenbrockCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+  typedef RosenbrockCostFunction        Self;
+  typedef itk::SingleValuedCostFunction Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+  itkNewMacro(Self);
+
+  MeasureType
+  GetValue(const ParametersType & parameters) const override
+  {
+    if (this->m_RecordPositions)
+    {
+      this->m_EvaluatedPositions.push_back(parameters);
+    }
+    return Rosenbrock(parameters[0], parameters[1]);
+  }
+
+  void
+  GetDerivative(const ParametersType &, DerivativeType &) const override
+  {
+    itkExceptionMacro(<< "The derivative is not implemented.");
+  }
+
+  unsigned int
+  GetNumberOfParameters(void) const override
+  {
+    return 2;
+  }
+
+  bool                                m_RecordPositions{ false };
+  mutable std::vector<ParametersType> m_EvaluatedPositions;
+};
+
+
+/** The Rosenbrock function as a vnl cost function, which records the evaluated positions. */
+class VnlRosenbrockCostFunction : public vnl_cost_function
+{
+public:
+  VnlRosenbrockCostFunction()
+    : vnl_cost_function(2)
+  {}
+
+  double
+  f(const vnl_vector<double> & x) override
+  {
+    this->m_EvaluatedPositions.push_back(x);
+    return Rosenbrock(x[0], x[1]);
+  }
+
+  std::vector<vnl_vector<double>> m_EvaluatedPositions;
+};
+
+
+/** Records the current position of the optimizer at every iteration. */
+void
+RecordIterate(itk::Object * caller, const itk::EventObject &, void * clientData)
+{
+  const auto * optimizer = dynamic_cast<itk::ParallelSimplexOptimizer *>(caller);
+  auto *       iterates = static_cast<std::vector<itk::ParallelSimplexOptimizer::ParametersType> *>(clientData);
+  iterates->push_back(optimizer->GetCurrentPosition());
+}
+
+
+/** Runs the optimizer, and returns its iterates. */
+std::vector<itk::ParallelSimplexOptimizer::ParametersType>
+RunOptimizer(itk::ParallelSimplexOptimizer * optimizer)
+{
+  std::vector<itk::ParallelSimplexOptimizer::ParametersType> iterates;
+
+  itk::CStyleCommand::Pointer command = itk::CStyleCommand::New();
+  command->SetCallback(&RecordIterate);
+  command->SetClientData(&iterates);
+  optimizer->AddObserver(itk::IterationEvent(), command);
+
+  optimizer->StartOptimization();
+  return iterates;
+}
+
+} // end namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  typedef itk::ParallelSimplexOptimizer OptimizerType;
+  typedef OptimizerType::ParametersType ParametersType;
+
+  const unsigned int numberOfIterations = 40;
+
+  ParametersType initialPosition(2);
+  initialPosition[0] = -1.2;
+  initialPosition[1] = 1.0;
+  ParametersType initialSimplexDelta(2);
+  initialSimplexDelta[0] = 0.1;
+  initialSimplexDelta[1] = 0.1;
+
+  /** Run the optimizer with sequential evaluation. */
+  RosenbrockCostFunction::Pointer costFunction = RosenbrockCostFunction::New();
+  costFunction->m_RecordPositions = true;
+
+  OptimizerType::Pointer sequentialOptimizer = OptimizerType::New();
+  sequentialOptimizer->SetCostFunction(costFunction);
+  sequentialOptimizer->SetInitialPosition(initialPosition);
+  sequentialOptimizer->SetInitialSimplexDelta(initialSimplexDelta);
+  sequentialOptimizer->SetMaximumNumberOfIterations(numberOfIterations);
+  sequentialOptimizer->SetValueTolerance(0.0);
+  sequentialOptimizer->SetPositionTolerance(0.0);
+  const std::vector<ParametersType> sequentialIterates = RunOptimizer(sequentialOptimizer);
+
+  /** Run vnl_amoeba, without convergence tests, for more evaluations than the optimizer. */
+  VnlRosenbrockCostFunction vnlCostFunction;
+  vnl_amoeba                amoeba(vnlCostFunction);
+  amoeba.set_max_iterations(static_cast<int>(10 * costFunction->m_EvaluatedPositions.size()));
+  amoeba.set_x_tolerance(0.0);
+  amoeba.set_f_tolerance(0.0);
+  vnl_vector<double> x(initialPosition.data_block(), 2);
+  amoeba.minimize(x, vnl_vector<double>(initialSimplexDelta.data_block(), 2));
+
+  /** The optimizer evaluates the same positions as vnl_amoeba, in the same order. */
+  const std::vector<ParametersType> &     positions = costFunction->m_EvaluatedPositions;
+  const std::vector<vnl_vector<double>> & vnlPositions = vnlCostFunction.m_EvaluatedPositions;
+  std::cerr << "The optimizer evaluated " << positions.size() << " positions in " << sequentialIterates.size()
+            << " iterations; vnl_amoeba evaluated " << vnlPositions.size() << " positions." << std::endl;
+  if (vnlPositions.size() < positions.size())
+  {
+    std::cerr << "ERROR: vnl_amoeba stopped before the optimizer." << std::endl;
+    return 1;
+  }
+  for (std::size_t k = 0; k < positions.size(); ++k)
+  {
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+      if (std::abs(positions[k][i] - vnlPositions[k][i]) > 1e-12 * std::max(1.0, std::abs(vnlPositions[k][i])))
+      {
+        std::cerr << "ERROR: evaluation " << k << " of the optimizer is at " << positions[k]
+                  << ", but vnl_amoeba evaluated " << vnlPositions[k] << "." << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  /** Run the optimizer with speculative, multi-threaded evaluation, each work unit with its own cost function. */
+  OptimizerType::CostFunctionContainerType workUnitCostFunctions;
+  for (unsigned int k = 0; k < 4; ++k)
+  {
+    workUnitCostFunctions.push_back(RosenbrockCostFunction::New());
+  }
+
+  OptimizerType::Pointer parallelOptimizer = OptimizerType::New();
+  parallelOptimizer->SetCostFunction(RosenbrockCostFunction::New());
+  parallelOptimizer->SetInitialPosition(initialPosition);
+  parallelOptimizer->SetInitialSimplexDelta(initialSimplexDelta);
+  parallelOptimizer->SetMaximumNumberOfIterations(numberOfIterations);
+  parallelOptimizer->SetValueTolerance(0.0);
+  parallelOptimizer->SetPositionTolerance(0.0);
+  parallelOptimizer->SetUseMultiThread(true);
+  parallelOptimizer->SetNumberOfWorkUnits(4);
+  parallelOptimizer->SetWorkUnitCostFunctions(workUnitCostFunctions);
+  const std::vector<ParametersType> parallelIterates = RunOptimizer(parallelOptimizer);
+
+  /** The speculative evaluation gives the same iterates as the sequential evaluation. */
+  if (parallelIterates != sequentialIterates)
+  {
+    std::cerr << "ERROR: the iterates of the speculative evaluation differ from the sequential ones." << std::endl;
+    return 1;
+  }
+  if (parallelOptimizer->GetCurrentValue() != sequentialOptimizer->GetCurrentValue())
+  {
+    std::cerr << "ERROR: the final value of the speculative evaluation (" << parallelOptimizer->GetCurrentValue()
+              << ") differs from the sequential one (" << sequentialOptimizer->GetCurrentValue() << ")." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
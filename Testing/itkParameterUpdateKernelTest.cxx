@@ -0,0 +1,299 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the ParameterUpdateKernel gives the same updates as the loops that the gradient descent
+ * optimizers had before: the plain step, the preconditioned step of PreconditionedStochasticGradientDescent,
+ * the AdaGrad step, the bounded step and the control variate of the variance reduced methods. Also the
+ * conjugate gradient inner products and search direction update are tested. Every case runs in the
+ * calling thread, and divided over work units. */
+
+#include "itkParameterUpdateKernel.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+typedef itk::ParameterUpdateKernel::ValueType ValueType;
+typedef std::vector<ValueType>                VectorType;
+
+
+/** Returns a vector of random values in [minimum, maximum). */
+VectorType
+CreateRandomVector(const std::size_t size, const double minimum, const double maximum)
+{
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::Pointer randomGenerator =
+    itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  VectorType vector(size);
+  for (auto & value : vector)
+  {
+    value = randomGenerator->GetUniformVariate(minimum, maximum);
+  }
+  return vector;
+}
+
+
+/** Checks that the vectors are equal, up to the rounding of a contracted multiply-add. */
+bool
+CheckVectors(const std::string & name, const VectorType & result, const VectorType & reference)
+{
+  for (std::size_t j = 0; j < reference.size(); ++j)
+  {
+    if (std::abs(result[j] - reference[j]) > 1e-14 * std::max(1.0, std::abs(reference[j])))
+    {
+      std::cerr << "ERROR: " << name << ": element " << j << " is " << result[j] << ", instead of " << reference[j]
+                << "." << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/** Compares every kind of update with the original loops, for the given number of parameters. */
+bool
+TestUpdates(const itk::ParameterUpdateKernel * kernel, const std::size_t n)
+{
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->SetSeed(13579);
+  const VectorType gradient = CreateRandomVector(n, -1.0, 1.0);
+  const VectorType position = CreateRandomVector(n, -2.0, 2.0);
+  const VectorType preconditioner = CreateRandomVector(n, 0.5, 2.0);
+  const VectorType squaredGradientSum = CreateRandomVector(n, 0.0, 1.0);
+  const VectorType lowerBounds = CreateRandomVector(n, -2.0, -1.0);
+  const VectorType upperBounds = CreateRandomVector(n, 1.0, 2.0);
+  const VectorType snapshotStochasticGradient = CreateRandomVector(n, -1.0, 1.0);
+  const VectorType snapshotGradient = CreateRandomVector(n, -1.0, 1.0);
+
+  const std::vector<float> floatSnapshotGradient(snapshotGradient.begin(), snapshotGradient.end());
+
+  const double stepSize = 1.7;
+  const double epsilon = 1e-14;
+  const double controlVariateFactor = 0.8;
+  bool         success = true;
+
+  /** The plain step, x = x - a g. */
+  {
+    VectorType referencePosition = position;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referencePosition[j] = position[j] - stepSize * gradient[j];
+    }
+    VectorType                                newPosition = position;
+    itk::ParameterUpdateKernel::ArgumentsType arguments;
+    arguments.m_NumberOfParameters = n;
+    arguments.m_StepSize = stepSize;
+    arguments.m_Gradient = gradient.data();
+    arguments.m_Position = newPosition.data();
+    kernel->Update(arguments);
+    success &= CheckVectors("plain step", newPosition, referencePosition);
+  }
+
+  /** The preconditioned step of PreconditionedStochasticGradientDescent. */
+  {
+    VectorType referencePosition(n);
+    VectorType referenceSearchDirection(n);
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referenceSearchDirection[j] = preconditioner[j] * gradient[j];
+      referencePosition[j] = position[j] - stepSize * referenceSearchDirection[j];
+    }
+    VectorType                                newPosition = position;
+    VectorType                                searchDirection(n);
+    itk::ParameterUpdateKernel::ArgumentsType arguments;
+    arguments.m_NumberOfParameters = n;
+    arguments.m_StepSize = stepSize;
+    arguments.m_Gradient = gradient.data();
+    arguments.m_Position = newPosition.data();
+    arguments.m_Preconditioner = preconditioner.data();
+    arguments.m_SearchDirection = searchDirection.data();
+    kernel->Update(arguments);
+    success &= CheckVectors("preconditioned step", newPosition, referencePosition);
+    success &= CheckVectors("preconditioned search direction", searchDirection, referenceSearchDirection);
+  }
+
+  /** The AdaGrad step, which also updates the sum of squared gradients. */
+  {
+    VectorType referencePosition(n);
+    VectorType referenceSearchDirection(n);
+    VectorType referenceSquaredGradientSum = squaredGradientSum;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referenceSquaredGradientSum[j] += gradient[j] * gradient[j];
+      referenceSearchDirection[j] = gradient[j] / (std::sqrt(referenceSquaredGradientSum[j] + epsilon));
+      referencePosition[j] = position[j] - stepSize * referenceSearchDirection[j];
+    }
+    VectorType                                newPosition = position;
+    VectorType                                searchDirection(n);
+    VectorType                                newSquaredGradientSum = squaredGradientSum;
+    itk::ParameterUpdateKernel::ArgumentsType arguments;
+    arguments.m_NumberOfParameters = n;
+    arguments.m_StepSize = stepSize;
+    arguments.m_Gradient = gradient.data();
+    arguments.m_Position = newPosition.data();
+    arguments.m_SquaredGradientSum = newSquaredGradientSum.data();
+    arguments.m_Epsilon = epsilon;
+    arguments.m_SearchDirection = searchDirection.data();
+    kernel->Update(arguments);
+    success &= CheckVectors("AdaGrad step", newPosition, referencePosition);
+    success &= CheckVectors("AdaGrad search direction", searchDirection, referenceSearchDirection);
+    success &= CheckVectors("AdaGrad squared gradient sum", newSquaredGradientSum, referenceSquaredGradientSum);
+  }
+
+  /** The bounded step. */
+  {
+    VectorType referencePosition(n);
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referencePosition[j] = std::min(std::max(position[j] - stepSize * gradient[j], lowerBounds[j]), upperBounds[j]);
+    }
+    VectorType                                newPosition = position;
+    itk::ParameterUpdateKernel::ArgumentsType arguments;
+    arguments.m_NumberOfParameters = n;
+    arguments.m_StepSize = stepSize;
+    arguments.m_Gradient = gradient.data();
+    arguments.m_Position = newPosition.data();
+    arguments.m_LowerBounds = lowerBounds.data();
+    arguments.m_UpperBounds = upperBounds.data();
+    kernel->Update(arguments);
+    success &= CheckVectors("bounded step", newPosition, referencePosition);
+  }
+
+  /** The control variate of the variance reduced methods, with the snapshot gradient in double
+   * and in float precision.
+   */
+  for (const bool useFloatSnapshotGradient : { false, true })
+  {
+    VectorType referencePosition(n);
+    VectorType referenceSearchDirection(n);
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      const double snapshot = useFloatSnapshotGradient ? floatSnapshotGradient[j] : snapshotGradient[j];
+      referenceSearchDirection[j] = controlVariateFactor * (gradient[j] - snapshotStochasticGradient[j]) + snapshot;
+      referencePosition[j] = position[j] - stepSize * referenceSearchDirection[j];
+    }
+    VectorType                                newPosition = position;
+    VectorType                                searchDirection(n);
+    itk::ParameterUpdateKernel::ArgumentsType arguments;
+    arguments.m_NumberOfParameters = n;
+    arguments.m_StepSize = stepSize;
+    arguments.m_Gradient = gradient.data();
+    arguments.m_Position = newPosition.data();
+    arguments.m_SearchDirection = searchDirection.data();
+    arguments.m_SnapshotStochasticGradient = snapshotStochasticGradient.data();
+    arguments.m_ControlVariateFactor = controlVariateFactor;
+    if (useFloatSnapshotGradient)
+    {
+      arguments.m_FloatSnapshotGradient = floatSnapshotGradient.data();
+    }
+    else
+    {
+      arguments.m_SnapshotGradient = snapshotGradient.data();
+    }
+    kernel->Update(arguments);
+    success &= CheckVectors("control variate step", newPosition, referencePosition);
+    success &= CheckVectors("control variate search direction", searchDirection, referenceSearchDirection);
+  }
+
+  /** The conjugate gradient inner products, and the search direction update d = -g + beta d. */
+  {
+    const VectorType & previousGradient = snapshotGradient;
+    const VectorType & previousSearchDirection = snapshotStochasticGradient;
+    double             gg = 0.0;
+    double             hh = 0.0;
+    double             gy = 0.0;
+    double             dy = 0.0;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      const double y = gradient[j] - previousGradient[j];
+      gg += gradient[j] * gradient[j];
+      hh += previousGradient[j] * previousGradient[j];
+      gy += gradient[j] * y;
+      dy += previousSearchDirection[j] * y;
+    }
+    const itk::ParameterUpdateKernel::ConjugateGradientInnerProductsType innerProducts =
+      kernel->ComputeConjugateGradientInnerProducts(
+        n, gradient.data(), previousGradient.data(), previousSearchDirection.data());
+    const double innerProduct = kernel->InnerProduct(n, gradient.data(), previousGradient.data());
+    double       referenceInnerProduct = 0.0;
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referenceInnerProduct += gradient[j] * previousGradient[j];
+    }
+    const double tolerance = 1e-12 * n;
+    if (std::abs(innerProducts.m_GradientGradient - gg) > tolerance ||
+        std::abs(innerProducts.m_PreviousGradientPreviousGradient - hh) > tolerance ||
+        std::abs(innerProducts.m_GradientGradientChange - gy) > tolerance ||
+        std::abs(innerProducts.m_SearchDirectionGradientChange - dy) > tolerance ||
+        std::abs(innerProduct - referenceInnerProduct) > tolerance)
+    {
+      std::cerr << "ERROR: the conjugate gradient inner products differ from the reference." << std::endl;
+      success = false;
+    }
+
+    const double beta = 0.3;
+    VectorType   referenceSearchDirection(n);
+    for (std::size_t j = 0; j < n; ++j)
+    {
+      referenceSearchDirection[j] = -gradient[j] + beta * previousSearchDirection[j];
+    }
+    VectorType searchDirection = previousSearchDirection;
+    kernel->UpdateSearchDirection(n, beta, gradient.data(), searchDirection.data());
+    success &= CheckVectors("conjugate gradient search direction", searchDirection, referenceSearchDirection);
+  }
+
+  return success;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** Fewer parameters than twice the minimum per work unit are updated by the calling thread,
+   * more are divided over the work units.
+   */
+  const auto kernel = itk::ParameterUpdateKernel::New();
+  kernel->SetNumberOfWorkUnits(4);
+  kernel->SetMinimumNumberOfParametersPerWorkUnit(1000);
+
+  bool success = true;
+  try
+  {
+    success &= TestUpdates(kernel, 1000);
+    success &= TestUpdates(kernel, 100003);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
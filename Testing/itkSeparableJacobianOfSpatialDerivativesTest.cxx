@@ -0,0 +1,323 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests the separable Jacobian of the spatial Jacobian and of the spatial Hessian of the
+ * AdvancedBSplineDeformableTransform against the dense forms, and tests that the bending energy
+ * penalty and the SumSquaredTissueVolumeDifference metric give the same value and derivative with
+ * the separable form as with the dense form, which they used before, single- and multi-threaded. */
+
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+#include "SumSquaredTissueVolumeDifferenceMetric/itkSumSquaredTissueVolumeDifferenceImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef float                                                                         PixelType;
+typedef itk::Image<PixelType, Dimension>                                              ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>                 TransformType;
+typedef itk::AdvancedLinearInterpolateImageFunction<ImageType, double>                InterpolatorType;
+typedef itk::TransformBendingEnergyPenaltyTerm<ImageType, double>                     BendingEnergyType;
+typedef itk::SumSquaredTissueVolumeDifferenceImageToImageMetric<ImageType, ImageType> TissueVolumeDifferenceType;
+
+
+/** A B-spline transform that does not provide the separable forms, so that the metrics use the dense ones. */
+class DenseBSplineTransform : public TransformType
+{
+public:
+  typedef DenseBSplineTransform   Self;
+  typedef itk::SmartPointer<Self> Pointer;
+  itkNewMacro(Self);
+
+  bool
+  GetSeparableJacobianOfSpatialJacobian(const InputPointType &,
+                                        SpatialJacobianType &,
+                                        SeparableJacobianOfSpatialJacobianType &,
+                                        NonZeroJacobianIndicesType &) const override
+  {
+    return false;
+  }
+
+  bool
+  GetSeparableJacobianOfSpatialHessian(const InputPointType &,
+                                       SpatialHessianType &,
+                                       SeparableJacobianOfSpatialHessianType &,
+                                       NonZeroJacobianIndicesType &) const override
+  {
+    return false;
+  }
+};
+
+
+/** Sets the same grid and smooth deformation for each transform. */
+void
+SetGridAndParameters(TransformType & transform, TransformType::ParametersType & parameters)
+{
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(7);
+  gridSpacing.Fill(4.0);
+  gridOrigin.Fill(-4.0);
+  transform.SetGridRegion(TransformType::RegionType(gridSize));
+  transform.SetGridSpacing(gridSpacing);
+  transform.SetGridOrigin(gridOrigin);
+
+  parameters.SetSize(transform.GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.1 * static_cast<double>((i * 5) % 7) - 0.3;
+  }
+  transform.SetParameters(parameters);
+}
+
+
+/** Creates an image of 16^3 voxels between the air and the tissue value, with a smooth blob. */
+ImageType::Pointer
+CreateBlobImage(const double center)
+{
+  ImageType::SizeType size;
+  size.Fill(16);
+  const auto image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    double squaredDistance = 0.0;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      const double difference = it.GetIndex()[d] - center - 0.5 * d;
+      squaredDistance += difference * difference;
+    }
+    it.Set(static_cast<PixelType>(-1000.0 + 1055.0 * std::exp(-squaredDistance / 40.0)));
+  }
+  return image;
+}
+
+
+/** Checks that the separable forms equal the only nonzero row, or component, of the dense forms. */
+bool
+TestSeparableForms(const TransformType & transform)
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(8642);
+
+  double maximumDifference = 0.0;
+  for (unsigned int n = 0; n < 100; ++n)
+  {
+    TransformType::InputPointType point;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      point[d] = randomGenerator->GetUniformVariate(0.0, 15.9);
+    }
+
+    TransformType::SpatialJacobianType                    sj;
+    TransformType::SpatialJacobianType                    separableSj;
+    TransformType::JacobianOfSpatialJacobianType          jsj;
+    TransformType::SeparableJacobianOfSpatialJacobianType separableJsj;
+    TransformType::SpatialHessianType                     sh;
+    TransformType::SpatialHessianType                     separableSh;
+    TransformType::JacobianOfSpatialHessianType           jsh;
+    TransformType::SeparableJacobianOfSpatialHessianType  separableJsh;
+    TransformType::NonZeroJacobianIndicesType             nzji;
+    TransformType::NonZeroJacobianIndicesType             separableNzji;
+    transform.GetJacobianOfSpatialJacobian(point, sj, jsj, nzji);
+    transform.GetJacobianOfSpatialHessian(point, sh, jsh, nzji);
+    if (!transform.GetSeparableJacobianOfSpatialJacobian(point, separableSj, separableJsj, separableNzji) ||
+        separableNzji != nzji ||
+        !transform.GetSeparableJacobianOfSpatialHessian(point, separableSh, separableJsh, separableNzji) ||
+        separableNzji != nzji || Dimension * separableJsj.size() != nzji.size() ||
+        Dimension * separableJsh.size() != nzji.size())
+    {
+      std::cerr << "ERROR: the separable forms are not provided, or have other nonzero Jacobian indices."
+                << std::endl;
+      return false;
+    }
+
+    maximumDifference = std::max(maximumDifference, (sj - separableSj).GetVnlMatrix().absolute_value_max());
+    for (unsigned int k = 0; k < Dimension; ++k)
+    {
+      maximumDifference = std::max(maximumDifference, (sh[k] - separableSh[k]).GetVnlMatrix().absolute_value_max());
+    }
+
+    const unsigned int numberOfWeights = separableJsj.size();
+    for (unsigned int mu = 0; mu < numberOfWeights; ++mu)
+    {
+      for (unsigned int k = 0; k < Dimension; ++k)
+      {
+        const TransformType::SpatialJacobianType & denseJsj = jsj[mu + k * numberOfWeights];
+        const TransformType::SpatialHessianType &  denseJsh = jsh[mu + k * numberOfWeights];
+        for (unsigned int i = 0; i < Dimension; ++i)
+        {
+          for (unsigned int j = 0; j < Dimension; ++j)
+          {
+            const double separableJsjValue = i == k ? separableJsj[mu][j] : 0.0;
+            maximumDifference = std::max(maximumDifference, std::abs(denseJsj(i, j) - separableJsjValue));
+          }
+          for (unsigned int j = 0; j < Dimension; ++j)
+          {
+            for (unsigned int l = 0; l < Dimension; ++l)
+            {
+              const double separableJshValue = i == k ? separableJsh[mu](j, l) : 0.0;
+              maximumDifference = std::max(maximumDifference, std::abs(denseJsh[i](j, l) - separableJshValue));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::cerr << "Maximum difference of the separable and dense forms: " << maximumDifference << std::endl;
+  if (maximumDifference > 1e-12)
+  {
+    std::cerr << "ERROR: the separable forms differ from the dense forms." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+/** Initializes the metric and returns its value and derivative. */
+template <class TMetric>
+void
+ComputeValueAndDerivative(TMetric &                          metric,
+                          const ImageType::Pointer &         fixedImage,
+                          const ImageType::Pointer &         movingImage,
+                          TransformType &                    transform,
+                          const bool                         useMultiThread,
+                          typename TMetric::MeasureType &    value,
+                          typename TMetric::DerivativeType & derivative)
+{
+  metric.SetFixedImage(fixedImage);
+  metric.SetMovingImage(movingImage);
+  metric.SetFixedImageRegion(fixedImage->GetBufferedRegion());
+  metric.SetTransform(&transform);
+  metric.SetInterpolator(InterpolatorType::New());
+  metric.SetImageSampler(itk::ImageFullSampler<ImageType>::New());
+  metric.SetUseMultiThread(useMultiThread);
+  metric.SetNumberOfWorkUnits(4);
+  metric.Initialize();
+  metric.GetValueAndDerivative(transform.GetParameters(), value, derivative);
+}
+
+
+/** Checks that the value and derivative with the separable forms equal the ones with the dense forms. */
+bool
+CheckValueAndDerivative(const std::string &        name,
+                        const double               value,
+                        const itk::Array<double> & derivative,
+                        const double               denseValue,
+                        const itk::Array<double> & denseDerivative)
+{
+  const double valueDifference = std::abs(value - denseValue) / std::abs(denseValue);
+  const double derivativeDifference = (derivative - denseDerivative).magnitude() / denseDerivative.magnitude();
+  std::cerr << name << ": value " << value << ", relative difference " << valueDifference << " (value), "
+            << derivativeDifference << " (derivative)" << std::endl;
+  if (valueDifference > 1e-12 || derivativeDifference > 1e-12)
+  {
+    std::cerr << "ERROR: " << name << " differs with the separable and the dense forms." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const ImageType::Pointer fixedImage = CreateBlobImage(7.0);
+  const ImageType::Pointer movingImage = CreateBlobImage(8.0);
+
+  /** The same B-spline transform, once with and once without the separable forms. */
+  const auto                    transform = TransformType::New();
+  const auto                    denseTransform = DenseBSplineTransform::New();
+  TransformType::ParametersType parameters;
+  TransformType::ParametersType denseParameters;
+  SetGridAndParameters(*transform, parameters);
+  SetGridAndParameters(*denseTransform, denseParameters);
+
+  bool success = true;
+  try
+  {
+    success &= TestSeparableForms(*transform);
+
+    for (const bool useMultiThread : { false, true })
+    {
+      const std::string threads = useMultiThread ? ", multi-threaded" : ", single-threaded";
+
+      BendingEnergyType::MeasureType    value{};
+      BendingEnergyType::DerivativeType derivative;
+      BendingEnergyType::MeasureType    denseValue{};
+      BendingEnergyType::DerivativeType denseDerivative;
+      const auto                        bendingEnergy = BendingEnergyType::New();
+      const auto                        denseBendingEnergy = BendingEnergyType::New();
+      /** Only the sampled bending energy uses the spatial Hessians. The grid-based one, the default, is
+       * tested against the sampled one by itkGridBasedBendingEnergyTest. */
+      bendingEnergy->SetUseGridBasedBendingEnergy(false);
+      denseBendingEnergy->SetUseGridBasedBendingEnergy(false);
+      ComputeValueAndDerivative(*bendingEnergy, fixedImage, movingImage, *transform, useMultiThread, value, derivative);
+      ComputeValueAndDerivative(
+        *denseBendingEnergy, fixedImage, movingImage, *denseTransform, useMultiThread, denseValue, denseDerivative);
+      success &= CheckValueAndDerivative("bending energy" + threads, value, derivative, denseValue, denseDerivative);
+
+      const auto tissueVolumeDifference = TissueVolumeDifferenceType::New();
+      const auto denseTissueVolumeDifference = TissueVolumeDifferenceType::New();
+      ComputeValueAndDerivative(
+        *tissueVolumeDifference, fixedImage, movingImage, *transform, useMultiThread, value, derivative);
+      ComputeValueAndDerivative(*denseTissueVolumeDifference,
+                                fixedImage,
+                                movingImage,
+                                *denseTransform,
+                                useMultiThread,
+                                denseValue,
+                                denseDerivative);
+      success &= CheckValueAndDerivative(
+        "sum of squared tissue volume differences" + threads, value, derivative, denseValue, denseDerivative);
+    }
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
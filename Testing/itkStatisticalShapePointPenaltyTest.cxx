@@ -0,0 +1,237 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests the value and derivative of the StatisticalShapePointPenalty, for every supported shape
+ * model calculation. The value of GetValueAndDerivative() should equal GetValue(), which still
+ * transforms and aligns the shape as before, and the derivative should equal the central finite
+ * differences of GetValue(), which the previous derivative of the proposal derivative vectors also
+ * did. The multi-threaded derivative should equal the single-threaded one. */
+
+#include "StatisticalShapePenalty/itkStatisticalShapePointPenalty.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPointSet.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const unsigned int Dimension = 3;
+
+typedef itk::PointSet<double, Dimension>                              PointSetType;
+typedef itk::StatisticalShapePointPenalty<PointSetType, PointSetType> MetricType;
+typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3> TransformType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator        RandomGeneratorType;
+
+
+/** Creates a metric for the given shape model. The metric takes ownership of the model. */
+MetricType::Pointer
+CreateMetric(const PointSetType::Pointer & pointSet,
+             TransformType *               transform,
+             const bool                    normalizedShapeModel,
+             const int                     shapeModelCalculation,
+             const bool                    useMultiThread)
+{
+  const unsigned int shapeLength = Dimension * pointSet->GetNumberOfPoints();
+  const unsigned int proposalLength = normalizedShapeModel ? shapeLength + Dimension + 1 : shapeLength;
+
+  /** A random mean shape and a random symmetric positive definite covariance, which are the same
+   * for every call, since the generator is reseeded.
+   */
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(97531);
+
+  auto * const meanVector = new vnl_vector<double>(proposalLength);
+  for (unsigned int i = 0; i < proposalLength; ++i)
+  {
+    (*meanVector)[i] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+  }
+  if (!normalizedShapeModel)
+  {
+    PointSetType::PointsContainer::ConstIterator pointIt = pointSet->GetPoints()->Begin();
+    for (unsigned int i = 0; i < shapeLength; i += Dimension, ++pointIt)
+    {
+      for (unsigned int d = 0; d < Dimension; ++d)
+      {
+        (*meanVector)[i + d] += pointIt.Value()[d];
+      }
+    }
+  }
+
+  vnl_matrix<double> factor(proposalLength, proposalLength);
+  for (unsigned int i = 0; i < proposalLength; ++i)
+  {
+    for (unsigned int j = 0; j < proposalLength; ++j)
+    {
+      factor(i, j) = randomGenerator->GetUniformVariate(-1.0, 1.0);
+    }
+  }
+  auto * const covarianceMatrix = new vnl_matrix<double>(factor * factor.transpose() / proposalLength);
+  for (unsigned int i = 0; i < proposalLength; ++i)
+  {
+    (*covarianceMatrix)(i, i) += 0.1;
+  }
+
+  const auto metric = MetricType::New();
+  metric->SetFixedPointSet(pointSet);
+  metric->SetMovingPointSet(pointSet);
+  metric->SetTransform(transform);
+  metric->SetNormalizedShapeModel(normalizedShapeModel);
+  metric->SetShapeModelCalculation(shapeModelCalculation);
+  metric->SetMeanVector(meanVector);
+  metric->SetCovarianceMatrix(covarianceMatrix);
+  metric->SetShrinkageIntensity(0.5);
+  metric->SetBaseVariance(2.0);
+  metric->SetCentroidXVariance(3.0);
+  metric->SetCentroidYVariance(4.0);
+  metric->SetCentroidZVariance(5.0);
+  metric->SetSizeVariance(6.0);
+  metric->SetCutOffValue(0.0);
+  metric->SetCutOffSharpness(2.0);
+  metric->SetUseMultiThread(useMultiThread);
+  metric->SetNumberOfWorkUnits(4);
+  metric->SetMinimumNumberOfPointsPerWorkUnit(8);
+  metric->Initialize();
+  return metric;
+}
+
+
+/** Compares the derivative of the shape model with the finite differences of the value. */
+bool
+TestShapeModel(const PointSetType::Pointer & pointSet,
+               TransformType *               transform,
+               const bool                    normalizedShapeModel,
+               const int                     shapeModelCalculation)
+{
+  const MetricType::Pointer metric =
+    CreateMetric(pointSet, transform, normalizedShapeModel, shapeModelCalculation, false);
+  const MetricType::Pointer threadedMetric =
+    CreateMetric(pointSet, transform, normalizedShapeModel, shapeModelCalculation, true);
+
+  const MetricType::TransformParametersType parameters = transform->GetParameters();
+  MetricType::MeasureType                   value{};
+  MetricType::DerivativeType                derivative;
+  MetricType::MeasureType                   threadedValue{};
+  MetricType::DerivativeType                threadedDerivative;
+  metric->GetValueAndDerivative(parameters, value, derivative);
+  threadedMetric->GetValueAndDerivative(parameters, threadedValue, threadedDerivative);
+  const MetricType::MeasureType referenceValue = metric->GetValue(parameters);
+
+  /** The transform keeps a reference to the parameters, so they are perturbed in place. */
+  MetricType::TransformParametersType perturbed = parameters;
+  MetricType::DerivativeType          finiteDifferences(parameters.GetSize());
+  const double                        delta = 1e-5;
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    perturbed[i] = parameters[i] + delta;
+    const MetricType::MeasureType valueUp = metric->GetValue(perturbed);
+    perturbed[i] = parameters[i] - delta;
+    const MetricType::MeasureType valueDown = metric->GetValue(perturbed);
+    perturbed[i] = parameters[i];
+    finiteDifferences[i] = (valueUp - valueDown) / (2.0 * delta);
+  }
+  transform->SetParameters(parameters);
+
+  const double finiteDifferenceError = (derivative - finiteDifferences).magnitude() / derivative.magnitude();
+  const double threadedError = (threadedDerivative - derivative).magnitude() / derivative.magnitude();
+  std::cerr << "NormalizedShapeModel " << normalizedShapeModel << ", ShapeModelCalculation " << shapeModelCalculation
+            << ": value " << value << ", relative derivative error " << finiteDifferenceError
+            << " (finite differences), " << threadedError << " (threads)" << std::endl;
+
+  if (std::abs(value - referenceValue) > 1e-12 * std::abs(referenceValue) || threadedValue != value)
+  {
+    std::cerr << "ERROR: GetValueAndDerivative() gives the value " << value << " single-threaded and "
+              << threadedValue << " multi-threaded, while GetValue() gives " << referenceValue << "." << std::endl;
+    return false;
+  }
+  if (finiteDifferenceError > 1e-5)
+  {
+    std::cerr << "ERROR: the derivative differs from the finite differences of the value." << std::endl;
+    return false;
+  }
+  if (threadedError > 1e-12)
+  {
+    std::cerr << "ERROR: the multi-threaded derivative differs from the single-threaded one." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  /** A shape of points on an ellipsoid. */
+  const auto pointSet = PointSetType::New();
+  for (unsigned int i = 0; i < 40; ++i)
+  {
+    const double            theta = 0.3 + 2.4 * i / 40.0;
+    const double            phi = 0.7 * i;
+    PointSetType::PointType point;
+    point[0] = 20.0 + 8.0 * std::sin(theta) * std::cos(phi);
+    point[1] = 20.0 + 6.0 * std::sin(theta) * std::sin(phi);
+    point[2] = 20.0 + 7.0 * std::cos(theta);
+    pointSet->SetPoint(i, point);
+  }
+
+  /** A B-spline transform with a smooth deformation, of which the grid covers the shape. */
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(6);
+  gridSpacing.Fill(8.0);
+  gridOrigin.Fill(0.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = 0.2 * static_cast<double>((i * 5) % 7) - 0.6;
+  }
+  transform->SetParameters(parameters);
+
+  bool success = true;
+  try
+  {
+    success &= TestShapeModel(pointSet, transform, false, 0);
+    success &= TestShapeModel(pointSet, transform, false, 1);
+    success &= TestShapeModel(pointSet, transform, true, 0);
+    success &= TestShapeModel(pointSet, transform, true, 2);
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+
+  if (!success)
+  {
+    return 1;
+  }
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main
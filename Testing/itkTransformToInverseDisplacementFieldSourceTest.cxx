@@ -0,0 +1,150 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** Tests that the TransformToInverseDisplacementFieldSource inverts a smooth B-spline transform:
+ * at every point y of the output grid, the transform maps y plus the inverse displacement back
+ * to y, and for points x inside the image, the interpolated inverse of T(x) gives x again. */
+
+#include "itkTransformToInverseDisplacementFieldSource.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkVectorLinearInterpolateImageFunction.h"
+
+#include <algorithm>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+
+int
+main(void)
+{
+  const unsigned int Dimension = 2;
+  typedef itk::Vector<float, Dimension>                                                 VectorPixelType;
+  typedef itk::Image<VectorPixelType, Dimension>                                        DisplacementFieldType;
+  typedef itk::AdvancedBSplineDeformableTransform<double, Dimension, 3>                 TransformType;
+  typedef itk::TransformToInverseDisplacementFieldSource<DisplacementFieldType, double> InverseSourceType;
+  typedef itk::VectorLinearInterpolateImageFunction<DisplacementFieldType, double>      InterpolatorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator                        RandomGeneratorType;
+
+  /** A B-spline transform with a grid spacing of 10 voxels over an image of 40^2 voxels. The
+   * coefficients are at most one voxel, which keeps the transform smooth and invertible.
+   */
+  const auto                 transform = TransformType::New();
+  TransformType::SizeType    gridSize;
+  TransformType::SpacingType gridSpacing;
+  TransformType::OriginType  gridOrigin;
+  gridSize.Fill(7);
+  gridSpacing.Fill(10.0);
+  gridOrigin.Fill(-10.0);
+  transform->SetGridRegion(TransformType::RegionType(gridSize));
+  transform->SetGridSpacing(gridSpacing);
+  transform->SetGridOrigin(gridOrigin);
+
+  RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
+  randomGenerator->SetSeed(5678);
+  TransformType::ParametersType parameters(transform->GetNumberOfParameters());
+  for (unsigned int i = 0; i < parameters.GetSize(); ++i)
+  {
+    parameters[i] = randomGenerator->GetUniformVariate(-1.0, 1.0);
+  }
+  transform->SetParameters(parameters);
+
+  /** Compute the inverse displacement field. */
+  DisplacementFieldType::SizeType outputSize;
+  outputSize.Fill(40);
+  const auto inverseSource = InverseSourceType::New();
+  inverseSource->SetTransform(transform);
+  inverseSource->SetOutputSize(outputSize);
+  try
+  {
+    inverseSource->Update();
+  }
+  catch (const itk::ExceptionObject & excp)
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return 1;
+  }
+  const DisplacementFieldType * inverseField = inverseSource->GetOutput();
+
+  if (inverseSource->GetNumberOfUnconvergedPoints() != 0)
+  {
+    std::cerr << "ERROR: " << inverseSource->GetNumberOfUnconvergedPoints() << " points did not converge."
+              << std::endl;
+    return 1;
+  }
+
+  /** At the grid points, the residual is below the tolerance of 0.01 voxel, up to the float precision
+   * of the output.
+   */
+  double maximumResidual = 0.0;
+  itk::ImageRegionConstIteratorWithIndex<DisplacementFieldType> it(inverseField,
+                                                                   inverseField->GetLargestPossibleRegion());
+  for (; !it.IsAtEnd(); ++it)
+  {
+    DisplacementFieldType::PointType y;
+    inverseField->TransformIndexToPhysicalPoint(it.GetIndex(), y);
+    TransformType::InputPointType x;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      x[d] = y[d] + it.Get()[d];
+    }
+    maximumResidual = std::max(maximumResidual, transform->TransformPoint(x).EuclideanDistanceTo(y));
+  }
+  std::cerr << "Maximum residual at the grid points: " << maximumResidual << std::endl;
+  if (maximumResidual > 0.011)
+  {
+    std::cerr << "ERROR: the inverse does not map the grid points back." << std::endl;
+    return 1;
+  }
+
+  /** Inverse after forward is the identity, up to the linear interpolation of the inverse field. */
+  const auto interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(inverseField);
+  double maximumError = 0.0;
+  for (unsigned int n = 0; n < 1000; ++n)
+  {
+    TransformType::InputPointType x;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      x[d] = randomGenerator->GetUniformVariate(5.0, 34.0);
+    }
+    const TransformType::OutputPointType y = transform->TransformPoint(x);
+    if (!interpolator->IsInsideBuffer(y))
+    {
+      continue;
+    }
+    const InterpolatorType::OutputType displacement = interpolator->Evaluate(y);
+    TransformType::InputPointType      inverse;
+    for (unsigned int d = 0; d < Dimension; ++d)
+    {
+      inverse[d] = y[d] + displacement[d];
+    }
+    maximumError = std::max(maximumError, inverse.EuclideanDistanceTo(x));
+  }
+  std::cerr << "Maximum error of the inverse after the forward transform: " << maximumError << std::endl;
+  if (maximumError > 0.05)
+  {
+    std::cerr << "ERROR: the inverse after the forward transform is not the identity." << std::endl;
+    return 1;
+  }
+
+  std::cerr << "The results are good.\n" << std::endl;
+  return 0;
+
+} // end main